@@ -0,0 +1,1059 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * iproto_load: a native iproto load generator.
+ *
+ * Opens a number of connections to a Tarantool instance, keeps
+ * up to `depth' requests in flight on each of them and measures
+ * the latency of every request. The request mix is a weighted
+ * set of SELECT, REPLACE, UPDATE, CALL and EXECUTE requests
+ * against integer keys drawn uniformly from [0, keys).
+ *
+ * Latencies are collected into log-linear histograms with two
+ * significant decimal digits of precision and reported per
+ * request type. With -o the merged distribution is written in
+ * the HdrHistogram percentile text format (.hgrm), which can be
+ * plotted with the standard HdrHistogram tooling.
+ *
+ * Example:
+ *	iproto_load -c 16 -d 32 -t 4 -D 30 \
+ *		-m select=80,replace=20 -s 512 -o out.hgrm
+ */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "box/iproto_constants.h"
+#include "scramble.h"
+#include "third_party/base64.h"
+
+enum req_kind {
+	REQ_SELECT,
+	REQ_REPLACE,
+	REQ_UPDATE,
+	REQ_CALL,
+	REQ_EXECUTE,
+	req_kind_MAX
+};
+
+static const char *req_kind_strs[] = {
+	"select", "replace", "update", "call", "execute"
+};
+
+/** Run configuration, filled from the command line. */
+static struct {
+	const char *host;
+	const char *port;
+	const char *user;
+	const char *password;
+	int connections;
+	int depth;
+	int threads;
+	double duration;
+	uint64_t requests;
+	uint32_t space_id;
+	uint32_t index_id;
+	uint64_t keys;
+	int payload_size;
+	const char *function;
+	const char *sql;
+	const char *hgrm_path;
+	/** Cumulative weights of request kinds. */
+	unsigned weights[req_kind_MAX];
+	unsigned total_weight;
+} opts = {
+	.host = "localhost",
+	.port = "3301",
+	.connections = 1,
+	.depth = 1,
+	.threads = 1,
+	.duration = 0,
+	.requests = 0,
+	.space_id = 512,
+	.index_id = 0,
+	.keys = 100000,
+	.payload_size = 32,
+	.function = "bench",
+	.sql = NULL,
+	.hgrm_path = NULL,
+};
+
+/** Payload string used by REPLACE and UPDATE requests. */
+static char *payload;
+
+static void
+die(const char *fmt, ...) __attribute__((format(printf, 1, 2), noreturn));
+
+static void
+die(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static inline uint64_t
+clock_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* {{{ Latency histogram */
+
+enum {
+	/**
+	 * Number of bits in the sub-bucket index. Values below
+	 * 2^HIST_SUB_BITS are recorded exactly, larger values
+	 * with a relative error below 2^-(HIST_SUB_BITS - 1),
+	 * i.e. with two significant decimal digits.
+	 */
+	HIST_SUB_BITS = 8,
+	HIST_SUB_COUNT = 1 << HIST_SUB_BITS,
+	HIST_HALF_COUNT = HIST_SUB_COUNT / 2,
+	HIST_BUCKETS = (64 - HIST_SUB_BITS) * HIST_HALF_COUNT +
+		       HIST_SUB_COUNT,
+};
+
+/** Log-linear histogram of latencies in nanoseconds. */
+struct hist {
+	uint64_t counts[HIST_BUCKETS];
+	uint64_t total;
+	uint64_t max;
+	double sum;
+	double sum_sq;
+};
+
+static inline int
+hist_index(uint64_t value)
+{
+	if (value < HIST_SUB_COUNT)
+		return value;
+	int shift = 63 - __builtin_clzll(value) - (HIST_SUB_BITS - 1);
+	return shift * HIST_HALF_COUNT + (int)(value >> shift);
+}
+
+/** Highest value that falls into the bucket @a idx. */
+static inline uint64_t
+hist_value(int idx)
+{
+	if (idx < HIST_SUB_COUNT)
+		return idx;
+	int shift = idx / HIST_HALF_COUNT - 1;
+	uint64_t sub = idx - shift * HIST_HALF_COUNT;
+	return ((sub + 1) << shift) - 1;
+}
+
+static inline void
+hist_record(struct hist *h, uint64_t value)
+{
+	h->counts[hist_index(value)]++;
+	h->total++;
+	if (value > h->max)
+		h->max = value;
+	h->sum += value;
+	h->sum_sq += (double)value * value;
+}
+
+static void
+hist_merge(struct hist *dst, const struct hist *src)
+{
+	for (int i = 0; i < HIST_BUCKETS; i++)
+		dst->counts[i] += src->counts[i];
+	dst->total += src->total;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->sum += src->sum;
+	dst->sum_sq += src->sum_sq;
+}
+
+/**
+ * Value at the given percentile (0..100) and the number of
+ * recorded values not greater than it.
+ */
+static uint64_t
+hist_percentile(const struct hist *h, double percentile, uint64_t *count)
+{
+	uint64_t target = (uint64_t)ceil(percentile / 100 * h->total);
+	if (target == 0)
+		target = 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < HIST_BUCKETS; i++) {
+		seen += h->counts[i];
+		if (seen >= target) {
+			if (count != NULL)
+				*count = seen;
+			uint64_t value = hist_value(i);
+			return value < h->max ? value : h->max;
+		}
+	}
+	if (count != NULL)
+		*count = h->total;
+	return h->max;
+}
+
+static double
+hist_mean(const struct hist *h)
+{
+	return h->total == 0 ? 0 : h->sum / h->total;
+}
+
+static double
+hist_stddev(const struct hist *h)
+{
+	if (h->total == 0)
+		return 0;
+	double mean = hist_mean(h);
+	double var = h->sum_sq / h->total - mean * mean;
+	return var > 0 ? sqrt(var) : 0;
+}
+
+/**
+ * Write the histogram in the HdrHistogram percentile
+ * distribution format, values in milliseconds. Percentiles
+ * are reported with five ticks per half distance, the same
+ * way HdrHistogram's outputPercentileDistribution() does.
+ */
+static void
+hist_write_hgrm(const struct hist *h, FILE *out)
+{
+	const double scale = 1e6;
+	fprintf(out, "%12s %14s %10s %14s\n\n", "Value", "Percentile",
+		"TotalCount", "1/(1-Percentile)");
+	if (h->total == 0)
+		return;
+	for (int half = 0; half < 64; half++) {
+		double lo = 100 - 100 / ldexp(1, half);
+		double hi = 100 - 100 / ldexp(1, half + 1);
+		bool done = false;
+		for (int tick = 0; tick < 5 && !done; tick++) {
+			double p = lo + (hi - lo) * tick / 5;
+			uint64_t count;
+			uint64_t value = hist_percentile(h, p, &count);
+			fprintf(out, "%12.3f %2.12f %10" PRIu64 " %14.2f\n",
+				value / scale, p / 100, count,
+				1 / (1 - p / 100));
+			done = count == h->total;
+		}
+		if (done)
+			break;
+	}
+	fprintf(out, "%12.3f %2.12f %10" PRIu64 "\n", h->max / scale, 1.0,
+		h->total);
+	fprintf(out, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n",
+		hist_mean(h) / scale, hist_stddev(h) / scale);
+	fprintf(out, "#[Max     = %12.3f, Total count    = %12" PRIu64 "]\n",
+		h->max / scale, h->total);
+	fprintf(out, "#[Buckets = %12d, SubBuckets     = %12d]\n",
+		64 - HIST_SUB_BITS + 1, HIST_SUB_COUNT);
+}
+
+/* }}} */
+
+/* {{{ Connection */
+
+/** A growable byte buffer, [rpos, wpos) is unprocessed data. */
+struct buf {
+	char *data;
+	size_t rpos;
+	size_t wpos;
+	size_t capacity;
+};
+
+static char *
+buf_reserve(struct buf *b, size_t size)
+{
+	if (b->wpos + size <= b->capacity)
+		return b->data + b->wpos;
+	if (b->rpos > 0) {
+		memmove(b->data, b->data + b->rpos, b->wpos - b->rpos);
+		b->wpos -= b->rpos;
+		b->rpos = 0;
+		if (b->wpos + size <= b->capacity)
+			return b->data + b->wpos;
+	}
+	size_t capacity = b->capacity > 0 ? b->capacity : 16384;
+	while (capacity < b->wpos + size)
+		capacity *= 2;
+	b->data = realloc(b->data, capacity);
+	if (b->data == NULL)
+		die("failed to allocate %zu bytes", capacity);
+	b->capacity = capacity;
+	return b->data + b->wpos;
+}
+
+static inline size_t
+buf_used(const struct buf *b)
+{
+	return b->wpos - b->rpos;
+}
+
+/** A request sent but not yet answered. */
+struct slot {
+	uint64_t sent_at;
+	enum req_kind kind;
+};
+
+struct conn {
+	int fd;
+	struct buf in;
+	struct buf out;
+	/**
+	 * In-flight requests. The slot index is used as the
+	 * request sync, so a slot can be reused only after its
+	 * response has been received.
+	 */
+	struct slot *slots;
+	/** Stack of free slot indexes. */
+	uint32_t *free_slots;
+	int free_count;
+};
+
+static void
+read_full(int fd, char *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t n = read(fd, data, size);
+		if (n == 0)
+			die("connection closed by peer");
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			die("read: %s", strerror(errno));
+		}
+		data += n;
+		size -= n;
+	}
+}
+
+static void
+write_full(int fd, const char *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			die("write: %s", strerror(errno));
+		}
+		data += n;
+		size -= n;
+	}
+}
+
+/**
+ * Begin a request packet in @a b: reserve space for the fixed
+ * size length prefix and encode the header. The body must be
+ * encoded at the returned position and finished with
+ * packet_end().
+ */
+static char *
+packet_begin(struct buf *b, size_t body_size, uint32_t type, uint64_t sync)
+{
+	char *p = buf_reserve(b, 5 + 32 + body_size);
+	p += 5;
+	p = mp_encode_map(p, 2);
+	p = mp_encode_uint(p, IPROTO_REQUEST_TYPE);
+	p = mp_encode_uint(p, type);
+	p = mp_encode_uint(p, IPROTO_SYNC);
+	p = mp_encode_uint(p, sync);
+	return p;
+}
+
+static void
+packet_end(struct buf *b, char *end)
+{
+	char *start = b->data + b->wpos;
+	*start = 0xce;
+	mp_store_u32(start + 1, end - start - 5);
+	b->wpos = end - b->data;
+}
+
+/**
+ * Try to cut a complete packet from the input buffer.
+ * Returns the packet boundaries or NULL if more data is needed.
+ */
+static const char *
+packet_next(struct buf *b, const char **end)
+{
+	const char *p = b->data + b->rpos;
+	const char *data_end = b->data + b->wpos;
+	if (p == data_end)
+		return NULL;
+	if (mp_typeof(*p) != MP_UINT)
+		die("invalid packet length");
+	if (mp_check_uint(p, data_end) > 0)
+		return NULL;
+	uint64_t len = mp_decode_uint(&p);
+	if ((uint64_t)(data_end - p) < len)
+		return NULL;
+	*end = p + len;
+	b->rpos = *end - b->data;
+	return p;
+}
+
+/** Decode the response header, return the body position. */
+static const char *
+response_decode(const char *p, const char *end, uint32_t *type,
+		uint64_t *sync)
+{
+	*type = IPROTO_TYPE_ERROR;
+	*sync = UINT64_MAX;
+	const char *check = p;
+	if (mp_check(&check, end) != 0 || mp_typeof(*p) != MP_MAP)
+		die("invalid response header");
+	uint32_t size = mp_decode_map(&p);
+	for (uint32_t i = 0; i < size; i++) {
+		if (mp_typeof(*p) != MP_UINT) {
+			mp_next(&p);
+			mp_next(&p);
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&p);
+		if (key == IPROTO_REQUEST_TYPE && mp_typeof(*p) == MP_UINT)
+			*type = mp_decode_uint(&p);
+		else if (key == IPROTO_SYNC && mp_typeof(*p) == MP_UINT)
+			*sync = mp_decode_uint(&p);
+		else
+			mp_next(&p);
+	}
+	return p;
+}
+
+/** Print the error message from an error response body. */
+static void
+response_print_error(const char *p, const char *end, uint32_t type)
+{
+	if (p < end && mp_typeof(*p) == MP_MAP) {
+		uint32_t size = mp_decode_map(&p);
+		for (uint32_t i = 0; i < size; i++) {
+			uint64_t key = mp_typeof(*p) == MP_UINT ?
+				       mp_decode_uint(&p) : (mp_next(&p), 0);
+			if (key == IPROTO_ERROR_24 &&
+			    mp_typeof(*p) == MP_STR) {
+				uint32_t len;
+				const char *msg = mp_decode_str(&p, &len);
+				fprintf(stderr, "error %u: %.*s\n",
+					type & (IPROTO_TYPE_ERROR - 1),
+					(int)len, msg);
+				return;
+			}
+			mp_next(&p);
+		}
+	}
+	fprintf(stderr, "error %u\n", type & (IPROTO_TYPE_ERROR - 1));
+}
+
+static void
+conn_auth(struct conn *conn, const char *salt)
+{
+	char scramble[SCRAMBLE_SIZE];
+	scramble_prepare(scramble, salt, opts.password,
+			 strlen(opts.password));
+	size_t body_size = 64 + strlen(opts.user);
+	char *p = packet_begin(&conn->out, body_size, IPROTO_AUTH, 0);
+	p = mp_encode_map(p, 2);
+	p = mp_encode_uint(p, IPROTO_USER_NAME);
+	p = mp_encode_str(p, opts.user, strlen(opts.user));
+	p = mp_encode_uint(p, IPROTO_TUPLE);
+	p = mp_encode_array(p, 2);
+	p = mp_encode_str(p, "chap-sha1", strlen("chap-sha1"));
+	p = mp_encode_str(p, scramble, SCRAMBLE_SIZE);
+	packet_end(&conn->out, p);
+	write_full(conn->fd, conn->out.data, conn->out.wpos);
+	conn->out.rpos = conn->out.wpos = 0;
+
+	char len_buf[5];
+	read_full(conn->fd, len_buf, sizeof(len_buf));
+	const char *lp = len_buf;
+	if (mp_typeof(*lp) != MP_UINT || mp_check_uint(lp, lp + 5) > 0)
+		die("invalid auth response");
+	uint32_t len = mp_decode_uint(&lp);
+	char *resp = buf_reserve(&conn->in, len);
+	read_full(conn->fd, resp, len);
+	uint32_t type;
+	uint64_t sync;
+	const char *body = response_decode(resp, resp + len, &type, &sync);
+	if (iproto_type_is_error(type)) {
+		response_print_error(body, resp + len, type);
+		die("authentication failed");
+	}
+}
+
+static void
+conn_create(struct conn *conn)
+{
+	memset(conn, 0, sizeof(*conn));
+	struct addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	int rc = getaddrinfo(opts.host, opts.port, &hints, &res);
+	if (rc != 0)
+		die("%s:%s: %s", opts.host, opts.port, gai_strerror(rc));
+	conn->fd = -1;
+	for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+		conn->fd = socket(ai->ai_family, ai->ai_socktype,
+				  ai->ai_protocol);
+		if (conn->fd < 0)
+			continue;
+		if (connect(conn->fd, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		close(conn->fd);
+		conn->fd = -1;
+	}
+	freeaddrinfo(res);
+	if (conn->fd < 0)
+		die("failed to connect to %s:%s: %s", opts.host, opts.port,
+		    strerror(errno));
+	int one = 1;
+	setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	char greeting[IPROTO_GREETING_SIZE];
+	read_full(conn->fd, greeting, sizeof(greeting));
+	if (memcmp(greeting, "Tarantool ", strlen("Tarantool ")) != 0)
+		die("%s:%s is not a Tarantool instance", opts.host,
+		    opts.port);
+	if (opts.user != NULL) {
+		/* The second line holds the base64-encoded salt. */
+		const char *salt_base64 = greeting + IPROTO_GREETING_SIZE / 2;
+		int salt_base64_len = 0;
+		while (salt_base64_len < IPROTO_GREETING_SIZE / 2 - 1 &&
+		       salt_base64[salt_base64_len] != ' ')
+			salt_base64_len++;
+		char salt[IPROTO_GREETING_SIZE / 2];
+		int salt_len = base64_decode(salt_base64, salt_base64_len,
+					     salt, sizeof(salt));
+		if (salt_len < SCRAMBLE_SIZE)
+			die("invalid salt in the greeting");
+		conn_auth(conn, salt);
+	}
+	if (fcntl(conn->fd, F_SETFL,
+		  fcntl(conn->fd, F_GETFL) | O_NONBLOCK) != 0)
+		die("fcntl: %s", strerror(errno));
+
+	conn->slots = calloc(opts.depth, sizeof(*conn->slots));
+	conn->free_slots = calloc(opts.depth, sizeof(*conn->free_slots));
+	if (conn->slots == NULL || conn->free_slots == NULL)
+		die("failed to allocate connection slots");
+	for (int i = 0; i < opts.depth; i++)
+		conn->free_slots[i] = opts.depth - 1 - i;
+	conn->free_count = opts.depth;
+}
+
+static void
+conn_destroy(struct conn *conn)
+{
+	if (conn->fd >= 0)
+		close(conn->fd);
+	free(conn->in.data);
+	free(conn->out.data);
+	free(conn->slots);
+	free(conn->free_slots);
+}
+
+static inline int
+conn_inflight(const struct conn *conn)
+{
+	return opts.depth - conn->free_count;
+}
+
+/* }}} */
+
+/* {{{ Workers */
+
+/** Set when the run is over and no new requests must be sent. */
+static bool stopping;
+/** Number of requests issued so far, used with -n. */
+static uint64_t issued;
+
+struct worker {
+	pthread_t thread;
+	struct conn *conns;
+	int conn_count;
+	/** xorshift64 state. */
+	uint64_t rand_state;
+	/** Completed requests, read by the main thread. */
+	uint64_t done;
+	uint64_t errors[req_kind_MAX];
+	struct hist hist[req_kind_MAX];
+	bool finished;
+};
+
+static inline uint64_t
+worker_rand(struct worker *w)
+{
+	uint64_t x = w->rand_state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return w->rand_state = x;
+}
+
+static enum req_kind
+worker_pick_kind(struct worker *w)
+{
+	unsigned r = worker_rand(w) % opts.total_weight;
+	int kind = 0;
+	while (r >= opts.weights[kind])
+		kind++;
+	return kind;
+}
+
+/** Encode a request of the given kind into the output buffer. */
+static void
+worker_encode(struct worker *w, struct conn *conn, enum req_kind kind,
+	      uint32_t sync)
+{
+	struct buf *out = &conn->out;
+	uint64_t key = worker_rand(w) % opts.keys;
+	size_t body_size = 64 + opts.payload_size;
+	char *p;
+	switch (kind) {
+	case REQ_SELECT:
+		p = packet_begin(out, body_size, IPROTO_SELECT, sync);
+		p = mp_encode_map(p, 4);
+		p = mp_encode_uint(p, IPROTO_SPACE_ID);
+		p = mp_encode_uint(p, opts.space_id);
+		p = mp_encode_uint(p, IPROTO_INDEX_ID);
+		p = mp_encode_uint(p, opts.index_id);
+		p = mp_encode_uint(p, IPROTO_LIMIT);
+		p = mp_encode_uint(p, 1);
+		p = mp_encode_uint(p, IPROTO_KEY);
+		p = mp_encode_array(p, 1);
+		p = mp_encode_uint(p, key);
+		break;
+	case REQ_REPLACE:
+		p = packet_begin(out, body_size, IPROTO_REPLACE, sync);
+		p = mp_encode_map(p, 2);
+		p = mp_encode_uint(p, IPROTO_SPACE_ID);
+		p = mp_encode_uint(p, opts.space_id);
+		p = mp_encode_uint(p, IPROTO_TUPLE);
+		p = mp_encode_array(p, 2);
+		p = mp_encode_uint(p, key);
+		p = mp_encode_str(p, payload, opts.payload_size);
+		break;
+	case REQ_UPDATE:
+		p = packet_begin(out, body_size, IPROTO_UPDATE, sync);
+		p = mp_encode_map(p, 4);
+		p = mp_encode_uint(p, IPROTO_SPACE_ID);
+		p = mp_encode_uint(p, opts.space_id);
+		p = mp_encode_uint(p, IPROTO_INDEX_ID);
+		p = mp_encode_uint(p, opts.index_id);
+		p = mp_encode_uint(p, IPROTO_KEY);
+		p = mp_encode_array(p, 1);
+		p = mp_encode_uint(p, key);
+		p = mp_encode_uint(p, IPROTO_TUPLE);
+		p = mp_encode_array(p, 1);
+		p = mp_encode_array(p, 3);
+		p = mp_encode_str(p, "=", 1);
+		/* Zero-based, i.e. the second field. */
+		p = mp_encode_uint(p, 1);
+		p = mp_encode_str(p, payload, opts.payload_size);
+		break;
+	case REQ_CALL:
+		body_size += strlen(opts.function);
+		p = packet_begin(out, body_size, IPROTO_CALL, sync);
+		p = mp_encode_map(p, 2);
+		p = mp_encode_uint(p, IPROTO_FUNCTION_NAME);
+		p = mp_encode_str(p, opts.function, strlen(opts.function));
+		p = mp_encode_uint(p, IPROTO_TUPLE);
+		p = mp_encode_array(p, 1);
+		p = mp_encode_uint(p, key);
+		break;
+	case REQ_EXECUTE:
+		body_size += strlen(opts.sql);
+		p = packet_begin(out, body_size, IPROTO_EXECUTE, sync);
+		p = mp_encode_map(p, 2);
+		p = mp_encode_uint(p, IPROTO_SQL_TEXT);
+		p = mp_encode_str(p, opts.sql, strlen(opts.sql));
+		p = mp_encode_uint(p, IPROTO_SQL_BIND);
+		p = mp_encode_array(p, 1);
+		p = mp_encode_uint(p, key);
+		break;
+	default:
+		unreachable();
+	}
+	packet_end(out, p);
+}
+
+/** Fill the pipeline of a connection up to the configured depth. */
+static void
+worker_send(struct worker *w, struct conn *conn)
+{
+	while (conn->free_count > 0 &&
+	       !__atomic_load_n(&stopping, __ATOMIC_RELAXED)) {
+		if (opts.requests > 0 &&
+		    __atomic_fetch_add(&issued, 1, __ATOMIC_RELAXED) >=
+		    opts.requests)
+			break;
+		uint32_t sync = conn->free_slots[--conn->free_count];
+		struct slot *slot = &conn->slots[sync];
+		slot->kind = worker_pick_kind(w);
+		worker_encode(w, conn, slot->kind, sync);
+		slot->sent_at = clock_ns();
+	}
+}
+
+static void
+worker_flush(struct conn *conn)
+{
+	struct buf *out = &conn->out;
+	while (buf_used(out) > 0) {
+		ssize_t n = write(conn->fd, out->data + out->rpos,
+				  buf_used(out));
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			die("write: %s", strerror(errno));
+		}
+		out->rpos += n;
+	}
+	out->rpos = out->wpos = 0;
+}
+
+static void
+worker_receive(struct worker *w, struct conn *conn)
+{
+	struct buf *in = &conn->in;
+	while (true) {
+		char *p = buf_reserve(in, 16384);
+		size_t avail = in->capacity - in->wpos;
+		ssize_t n = read(conn->fd, p, avail);
+		if (n == 0)
+			die("connection closed by peer");
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			die("read: %s", strerror(errno));
+		}
+		in->wpos += n;
+		if ((size_t)n < avail)
+			break;
+	}
+	uint64_t now = clock_ns();
+	const char *packet, *end;
+	while ((packet = packet_next(in, &end)) != NULL) {
+		uint32_t type;
+		uint64_t sync;
+		const char *body = response_decode(packet, end, &type, &sync);
+		if (sync >= (uint64_t)opts.depth)
+			die("unexpected response sync %" PRIu64, sync);
+		struct slot *slot = &conn->slots[sync];
+		hist_record(&w->hist[slot->kind], now - slot->sent_at);
+		if (iproto_type_is_error(type)) {
+			/* Report only the first error of each kind. */
+			if (w->errors[slot->kind]++ == 0)
+				response_print_error(body, end, type);
+		}
+		conn->free_slots[conn->free_count++] = sync;
+		__atomic_fetch_add(&w->done, 1, __ATOMIC_RELAXED);
+	}
+	if (buf_used(in) == 0)
+		in->rpos = in->wpos = 0;
+}
+
+static void *
+worker_f(void *arg)
+{
+	struct worker *w = arg;
+	struct pollfd *fds = calloc(w->conn_count, sizeof(*fds));
+	if (fds == NULL)
+		die("failed to allocate poll descriptors");
+	while (true) {
+		int inflight = 0;
+		for (int i = 0; i < w->conn_count; i++) {
+			struct conn *conn = &w->conns[i];
+			worker_send(w, conn);
+			worker_flush(conn);
+			inflight += conn_inflight(conn);
+			fds[i].fd = conn->fd;
+			fds[i].events = POLLIN;
+			if (buf_used(&conn->out) > 0)
+				fds[i].events |= POLLOUT;
+			fds[i].revents = 0;
+		}
+		if (inflight == 0)
+			break;
+		int rc = poll(fds, w->conn_count, 100);
+		if (rc < 0 && errno != EINTR)
+			die("poll: %s", strerror(errno));
+		for (int i = 0; i < w->conn_count && rc > 0; i++) {
+			if (fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+				worker_receive(w, &w->conns[i]);
+		}
+	}
+	free(fds);
+	__atomic_store_n(&w->finished, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/* }}} */
+
+static void
+parse_mix(const char *mix)
+{
+	unsigned weights[req_kind_MAX] = {0};
+	char *copy = strdup(mix);
+	char *saveptr = NULL;
+	for (char *tok = strtok_r(copy, ",", &saveptr); tok != NULL;
+	     tok = strtok_r(NULL, ",", &saveptr)) {
+		char *eq = strchr(tok, '=');
+		unsigned weight = 1;
+		if (eq != NULL) {
+			*eq = '\0';
+			weight = strtoul(eq + 1, NULL, 10);
+		}
+		int kind = 0;
+		while (kind < req_kind_MAX &&
+		       strcmp(tok, req_kind_strs[kind]) != 0)
+			kind++;
+		if (kind == req_kind_MAX)
+			die("unknown request type '%s' in the mix", tok);
+		weights[kind] += weight;
+	}
+	free(copy);
+	opts.total_weight = 0;
+	for (int kind = 0; kind < req_kind_MAX; kind++) {
+		opts.total_weight += weights[kind];
+		opts.weights[kind] = opts.total_weight;
+	}
+	if (opts.total_weight == 0)
+		die("empty request mix");
+}
+
+static void
+usage(const char *prog)
+{
+	printf("Usage: %s [options]\n"
+	       "  -h host        server host (localhost)\n"
+	       "  -p port        server port (3301)\n"
+	       "  -u user        user name, guest if omitted\n"
+	       "  -P password    password\n"
+	       "  -c count       number of connections (1)\n"
+	       "  -d depth       requests in flight per connection (1)\n"
+	       "  -t count       number of threads (1)\n"
+	       "  -D seconds     duration of the run (10 if -n is not set)\n"
+	       "  -n count       total number of requests\n"
+	       "  -m mix         request mix, e.g. select=80,replace=20\n"
+	       "                 types: select, replace, update, call,\n"
+	       "                 execute (select=100)\n"
+	       "  -s id          space id (512)\n"
+	       "  -i id          index id (0)\n"
+	       "  -k count       keys are drawn from [0, count) (100000)\n"
+	       "  -l size        REPLACE/UPDATE payload size (32)\n"
+	       "  -f name        function to CALL with the key (bench)\n"
+	       "  -q sql         statement to EXECUTE with the key bound\n"
+	       "  -o file        write the latency distribution (.hgrm)\n",
+	       prog);
+}
+
+static void
+print_row(const char *name, const struct hist *h, uint64_t errors,
+	  double elapsed)
+{
+	const double us = 1e3;
+	printf("%-8s %10" PRIu64 " %8" PRIu64 " %10.0f %9.1f %9.1f %9.1f "
+	       "%9.1f %9.1f %9.1f\n", name, h->total, errors,
+	       h->total / elapsed,
+	       hist_percentile(h, 50, NULL) / us,
+	       hist_percentile(h, 90, NULL) / us,
+	       hist_percentile(h, 99, NULL) / us,
+	       hist_percentile(h, 99.9, NULL) / us,
+	       hist_percentile(h, 99.99, NULL) / us,
+	       h->max / us);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *mix = "select=100";
+	int c;
+	while ((c = getopt(argc, argv, "h:p:u:P:c:d:t:D:n:m:s:i:k:l:f:q:o:"))
+	       != -1) {
+		switch (c) {
+		case 'h': opts.host = optarg; break;
+		case 'p': opts.port = optarg; break;
+		case 'u': opts.user = optarg; break;
+		case 'P': opts.password = optarg; break;
+		case 'c': opts.connections = atoi(optarg); break;
+		case 'd': opts.depth = atoi(optarg); break;
+		case 't': opts.threads = atoi(optarg); break;
+		case 'D': opts.duration = atof(optarg); break;
+		case 'n': opts.requests = strtoull(optarg, NULL, 10); break;
+		case 'm': mix = optarg; break;
+		case 's': opts.space_id = strtoul(optarg, NULL, 10); break;
+		case 'i': opts.index_id = strtoul(optarg, NULL, 10); break;
+		case 'k': opts.keys = strtoull(optarg, NULL, 10); break;
+		case 'l': opts.payload_size = atoi(optarg); break;
+		case 'f': opts.function = optarg; break;
+		case 'q': opts.sql = optarg; break;
+		case 'o': opts.hgrm_path = optarg; break;
+		default:
+			usage(argv[0]);
+			return c == '?' ? 1 : 0;
+		}
+	}
+	parse_mix(mix);
+	if (opts.connections < 1 || opts.depth < 1 || opts.threads < 1 ||
+	    opts.keys == 0 || opts.payload_size < 0)
+		die("invalid arguments, see %s -?", argv[0]);
+	if (opts.threads > opts.connections)
+		opts.threads = opts.connections;
+	if (opts.duration <= 0 && opts.requests == 0)
+		opts.duration = 10;
+	if (opts.password == NULL)
+		opts.password = "";
+	bool has_execute = opts.weights[REQ_EXECUTE] !=
+			   opts.weights[REQ_EXECUTE - 1];
+	if (has_execute && opts.sql == NULL)
+		die("execute requests need a statement, use -q");
+
+	payload = malloc(opts.payload_size + 1);
+	if (payload == NULL)
+		die("failed to allocate payload");
+	memset(payload, 'x', opts.payload_size);
+
+	struct conn *conns = calloc(opts.connections, sizeof(*conns));
+	struct worker *workers = calloc(opts.threads, sizeof(*workers));
+	if (conns == NULL || workers == NULL)
+		die("failed to allocate connections");
+	for (int i = 0; i < opts.connections; i++)
+		conn_create(&conns[i]);
+
+	uint64_t start = clock_ns();
+	int conn_offset = 0;
+	for (int i = 0; i < opts.threads; i++) {
+		struct worker *w = &workers[i];
+		w->conns = conns + conn_offset;
+		w->conn_count = opts.connections / opts.threads +
+				(i < opts.connections % opts.threads);
+		conn_offset += w->conn_count;
+		w->rand_state = start ^ ((uint64_t)(i + 1) << 32) ^ 0x9e37;
+		if (pthread_create(&w->thread, NULL, worker_f, w) != 0)
+			die("failed to start a worker thread");
+	}
+
+	/* Report progress once a second until the run is over. */
+	uint64_t last_done = 0;
+	uint64_t last_time = start;
+	for (int second = 1; ; second++) {
+		uint64_t deadline = start + (uint64_t)second * 1000000000;
+		bool finished = false;
+		while (!finished && clock_ns() < deadline) {
+			usleep(10000);
+			finished = true;
+			for (int i = 0; i < opts.threads; i++) {
+				finished &= __atomic_load_n(&workers[i].finished,
+							    __ATOMIC_ACQUIRE);
+			}
+		}
+		uint64_t now = clock_ns();
+		uint64_t done = 0;
+		for (int i = 0; i < opts.threads; i++)
+			done += __atomic_load_n(&workers[i].done,
+						__ATOMIC_RELAXED);
+		fprintf(stderr, "%4ds: %10.0f rps, %" PRIu64 " total\n",
+			second, (done - last_done) * 1e9 / (now - last_time),
+			done);
+		last_done = done;
+		last_time = now;
+		if (finished)
+			break;
+		if (opts.duration > 0 && now - start >= opts.duration * 1e9)
+			__atomic_store_n(&stopping, true, __ATOMIC_RELAXED);
+	}
+	for (int i = 0; i < opts.threads; i++)
+		pthread_join(workers[i].thread, NULL);
+	double elapsed = (clock_ns() - start) / 1e9;
+
+	static struct hist total_hist;
+	uint64_t total_errors = 0;
+	printf("%-8s %10s %8s %10s %9s %9s %9s %9s %9s %9s\n", "type",
+	       "count", "errors", "rps", "p50,us", "p90,us", "p99,us",
+	       "p99.9,us", "p99.99,us", "max,us");
+	for (int kind = 0; kind < req_kind_MAX; kind++) {
+		static struct hist hist;
+		memset(&hist, 0, sizeof(hist));
+		uint64_t errors = 0;
+		for (int i = 0; i < opts.threads; i++) {
+			hist_merge(&hist, &workers[i].hist[kind]);
+			errors += workers[i].errors[kind];
+		}
+		if (hist.total == 0)
+			continue;
+		print_row(req_kind_strs[kind], &hist, errors, elapsed);
+		hist_merge(&total_hist, &hist);
+		total_errors += errors;
+	}
+	print_row("total", &total_hist, total_errors, elapsed);
+
+	if (opts.hgrm_path != NULL) {
+		FILE *out = fopen(opts.hgrm_path, "w");
+		if (out == NULL)
+			die("%s: %s", opts.hgrm_path, strerror(errno));
+		hist_write_hgrm(&total_hist, out);
+		fclose(out);
+	}
+
+	for (int i = 0; i < opts.connections; i++)
+		conn_destroy(&conns[i]);
+	free(conns);
+	free(workers);
+	free(payload);
+	return total_errors > 0 ? 2 : 0;
+}
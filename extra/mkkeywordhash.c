@@ -128,6 +128,7 @@ static Keyword aKeywordTable[] = {
   { "LIKE",                   "TK_LIKE_KW",     true  },
   { "LIMIT",                  "TK_LIMIT",       false },
   { "MATCH",                  "TK_MATCH",       true  },
+  { "MATERIALIZED",           "TK_MATERIALIZED", false },
   { "NATURAL",                "TK_JOIN_KW",     true  },
   { "NO",                     "TK_NO",          false },
   { "NOT",                    "TK_NOT",         true  },
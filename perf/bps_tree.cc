@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+static int
+compare(int64_t a, int64_t b)
+{
+	return a < b ? -1 : a > b;
+}
+
+#define BPS_TREE_NAME perf_tree
+#define BPS_TREE_BLOCK_SIZE 512
+#define BPS_TREE_EXTENT_SIZE 16 * 1024
+#define BPS_TREE_IS_IDENTICAL(a, b) ((a) == (b))
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define bps_tree_elem_t int64_t
+#define bps_tree_key_t int64_t
+#define bps_tree_arg_t int
+#include "salad/bps_tree.h"
+
+static void *
+extent_alloc(void *ctx)
+{
+	(void)ctx;
+	return malloc(BPS_TREE_EXTENT_SIZE);
+}
+
+static void
+extent_free(void *ctx, void *extent)
+{
+	(void)ctx;
+	free(extent);
+}
+
+/** Distinct keys in random order. */
+static std::vector<int64_t>
+make_keys(size_t count)
+{
+	std::vector<int64_t> keys(count);
+	for (size_t i = 0; i < count; i++)
+		keys[i] = i;
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+	return keys;
+}
+
+static void
+bench_bps_tree_insert(benchmark::State &state)
+{
+	std::vector<int64_t> keys = make_keys(state.range(0));
+	for (auto _ : state) {
+		struct perf_tree tree;
+		perf_tree_create(&tree, 0, extent_alloc, extent_free, NULL);
+		for (int64_t key : keys)
+			perf_tree_insert(&tree, key, NULL);
+		state.PauseTiming();
+		perf_tree_destroy(&tree);
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(bench_bps_tree_insert)->Range(1 << 10, 1 << 20);
+
+static void
+bench_bps_tree_find(benchmark::State &state)
+{
+	std::vector<int64_t> keys = make_keys(state.range(0));
+	struct perf_tree tree;
+	perf_tree_create(&tree, 0, extent_alloc, extent_free, NULL);
+	for (int64_t key : keys)
+		perf_tree_insert(&tree, key, NULL);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(perf_tree_find(&tree, keys[i]));
+		if (++i == keys.size())
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+	perf_tree_destroy(&tree);
+}
+BENCHMARK(bench_bps_tree_find)->Range(1 << 10, 1 << 20);
+
+static void
+bench_bps_tree_iterate(benchmark::State &state)
+{
+	std::vector<int64_t> keys = make_keys(state.range(0));
+	struct perf_tree tree;
+	perf_tree_create(&tree, 0, extent_alloc, extent_free, NULL);
+	for (int64_t key : keys)
+		perf_tree_insert(&tree, key, NULL);
+	for (auto _ : state) {
+		struct perf_tree_iterator it = perf_tree_iterator_first(&tree);
+		int64_t *elem;
+		while ((elem = perf_tree_iterator_get_elem(&tree, &it)) != NULL) {
+			benchmark::DoNotOptimize(*elem);
+			perf_tree_iterator_next(&tree, &it);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * keys.size());
+	perf_tree_destroy(&tree);
+}
+BENCHMARK(bench_bps_tree_iterate)->Range(1 << 10, 1 << 20);
+
+BENCHMARK_MAIN();
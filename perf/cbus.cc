@@ -0,0 +1,153 @@
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+
+#include "memory.h"
+#include "fiber.h"
+#include "cbus.h"
+
+enum {
+	/** Number of messages in flight in the pipelined test. */
+	BATCH_SIZE = 64,
+};
+
+/** Worker thread echoing messages back to the main thread. */
+static struct cord worker;
+/** Queue of messages from the main to the worker thread. */
+static struct cpipe pipe_to_worker;
+/** Queue of messages from the worker to the main thread. */
+static struct cpipe pipe_to_main;
+
+static int
+worker_f(va_list ap)
+{
+	(void)ap;
+	cpipe_create(&pipe_to_main, "main");
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "worker", fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&pipe_to_main);
+	return 0;
+}
+
+/** Fiber processing messages sent to the main thread. */
+static int
+main_endpoint_f(va_list ap)
+{
+	(void)ap;
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "main", fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	return 0;
+}
+
+static int
+do_nothing_f(struct cbus_call_msg *msg)
+{
+	(void)msg;
+	return 0;
+}
+
+static void
+bench_cbus_call(benchmark::State &state)
+{
+	for (auto _ : state) {
+		struct cbus_call_msg msg;
+		if (cbus_call(&pipe_to_worker, &pipe_to_main, &msg,
+			      do_nothing_f, NULL, TIMEOUT_INFINITY) != 0)
+			abort();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bench_cbus_call);
+
+/** Number of messages of the current batch not returned yet. */
+static int batch_pending;
+/** Fiber waiting for the current batch. */
+static struct fiber *batch_waiter;
+
+static void
+do_nothing(struct cmsg *msg)
+{
+	(void)msg;
+}
+
+static void
+batch_msg_done(struct cmsg *msg)
+{
+	(void)msg;
+	if (--batch_pending == 0)
+		fiber_wakeup(batch_waiter);
+}
+
+static void
+bench_cbus_pipelined(benchmark::State &state)
+{
+	static const struct cmsg_hop route[] = {
+		{do_nothing, &pipe_to_main},
+		{batch_msg_done, NULL},
+	};
+	struct cmsg msgs[BATCH_SIZE];
+	batch_waiter = fiber();
+	for (auto _ : state) {
+		batch_pending = BATCH_SIZE;
+		for (int i = 0; i < BATCH_SIZE; i++) {
+			cmsg_init(&msgs[i], route);
+			cpipe_push(&pipe_to_worker, &msgs[i]);
+		}
+		while (batch_pending > 0)
+			fiber_yield();
+	}
+	state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+BENCHMARK(bench_cbus_pipelined);
+
+/** Benchmarks run in a fiber, because cbus_call() yields. */
+static int
+main_f(va_list ap)
+{
+	(void)ap;
+	struct fiber *endpoint_fiber = fiber_new("main_endpoint",
+						 main_endpoint_f);
+	if (endpoint_fiber == NULL)
+		abort();
+	fiber_set_joinable(endpoint_fiber, true);
+	fiber_start(endpoint_fiber);
+	if (cord_costart(&worker, "worker", worker_f, NULL) != 0)
+		abort();
+	cpipe_create(&pipe_to_worker, "worker");
+
+	benchmark::RunSpecifiedBenchmarks();
+
+	cbus_stop_loop(&pipe_to_worker);
+	cpipe_destroy(&pipe_to_worker);
+	if (cord_cojoin(&worker) != 0)
+		abort();
+	fiber_cancel(endpoint_fiber);
+	fiber_join(endpoint_fiber);
+	ev_break(loop(), EVBREAK_ALL);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	cbus_init();
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	struct fiber *main_fiber = fiber_new("main", main_f);
+	if (main_fiber == NULL)
+		abort();
+	fiber_wakeup(main_fiber);
+	ev_run(loop(), 0);
+	benchmark::Shutdown();
+	cbus_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
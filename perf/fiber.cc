@@ -0,0 +1,100 @@
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+
+#include "memory.h"
+#include "fiber.h"
+
+static int
+yield_loop_f(va_list ap)
+{
+	(void)ap;
+	while (!fiber_is_cancelled())
+		fiber_yield();
+	return 0;
+}
+
+/**
+ * Direct switch to another fiber and back, without going
+ * through the scheduler: fiber_call() + fiber_yield().
+ */
+static void
+bench_fiber_call(benchmark::State &state)
+{
+	struct fiber *peer = fiber_new("peer", yield_loop_f);
+	if (peer == NULL)
+		abort();
+	fiber_set_joinable(peer, true);
+	fiber_start(peer);
+	for (auto _ : state)
+		fiber_call(peer);
+	state.SetItemsProcessed(state.iterations());
+	fiber_cancel(peer);
+	fiber_join(peer);
+}
+BENCHMARK(bench_fiber_call);
+
+/**
+ * Wakeup and yield: the fiber is resumed by the scheduler on
+ * the next event loop iteration.
+ */
+static void
+bench_fiber_yield(benchmark::State &state)
+{
+	for (auto _ : state) {
+		fiber_wakeup(fiber());
+		fiber_yield();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bench_fiber_yield);
+
+static int
+noop_f(va_list ap)
+{
+	(void)ap;
+	return 0;
+}
+
+/** Create a fiber and run it to completion. */
+static void
+bench_fiber_new(benchmark::State &state)
+{
+	for (auto _ : state) {
+		struct fiber *f = fiber_new("noop", noop_f);
+		if (f == NULL)
+			abort();
+		fiber_start(f);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bench_fiber_new);
+
+/** Benchmarks run in a fiber, because they switch fibers. */
+static int
+main_f(va_list ap)
+{
+	(void)ap;
+	benchmark::RunSpecifiedBenchmarks();
+	ev_break(loop(), EVBREAK_ALL);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	struct fiber *main_fiber = fiber_new("main", main_f);
+	if (main_fiber == NULL)
+		abort();
+	fiber_wakeup(main_fiber);
+	ev_run(loop(), 0);
+	benchmark::Shutdown();
+	fiber_free();
+	memory_free();
+	return 0;
+}
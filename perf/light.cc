@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+static const size_t light_extent_size = 16 * 1024;
+
+static inline uint32_t
+hash(uint64_t value)
+{
+	/* Finalizer of MurmurHash3, spreads sequential keys. */
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	return (uint32_t)value;
+}
+
+#define LIGHT_NAME
+#define LIGHT_DATA_TYPE uint64_t
+#define LIGHT_KEY_TYPE uint64_t
+#define LIGHT_CMP_ARG_TYPE int
+#define LIGHT_EQUAL(a, b, arg) ((a) == (b))
+#define LIGHT_EQUAL_KEY(a, b, arg) ((a) == (b))
+#include "salad/light.h"
+
+static void *
+extent_alloc(void *ctx)
+{
+	(void)ctx;
+	return malloc(light_extent_size);
+}
+
+static void
+extent_free(void *ctx, void *extent)
+{
+	(void)ctx;
+	free(extent);
+}
+
+/** Distinct keys in random order. */
+static std::vector<uint64_t>
+make_keys(size_t count)
+{
+	std::vector<uint64_t> keys(count);
+	for (size_t i = 0; i < count; i++)
+		keys[i] = i;
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+	return keys;
+}
+
+static void
+bench_light_insert(benchmark::State &state)
+{
+	std::vector<uint64_t> keys = make_keys(state.range(0));
+	for (auto _ : state) {
+		struct light_core ht;
+		light_create(&ht, light_extent_size,
+			     extent_alloc, extent_free, NULL, 0);
+		for (uint64_t key : keys)
+			light_insert(&ht, hash(key), key);
+		state.PauseTiming();
+		light_destroy(&ht);
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(bench_light_insert)->Range(1 << 10, 1 << 20);
+
+static void
+bench_light_find(benchmark::State &state)
+{
+	std::vector<uint64_t> keys = make_keys(state.range(0));
+	struct light_core ht;
+	light_create(&ht, light_extent_size,
+		     extent_alloc, extent_free, NULL, 0);
+	for (uint64_t key : keys)
+		light_insert(&ht, hash(key), key);
+	size_t i = 0;
+	for (auto _ : state) {
+		uint64_t key = keys[i];
+		benchmark::DoNotOptimize(light_find(&ht, hash(key), key));
+		if (++i == keys.size())
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+	light_destroy(&ht);
+}
+BENCHMARK(bench_light_find)->Range(1 << 10, 1 << 20);
+
+static void
+bench_light_find_miss(benchmark::State &state)
+{
+	std::vector<uint64_t> keys = make_keys(state.range(0));
+	struct light_core ht;
+	light_create(&ht, light_extent_size,
+		     extent_alloc, extent_free, NULL, 0);
+	for (uint64_t key : keys)
+		light_insert(&ht, hash(key), key);
+	size_t i = 0;
+	for (auto _ : state) {
+		/* Keys start from keys.size() are not in the table. */
+		uint64_t key = keys[i] + keys.size();
+		benchmark::DoNotOptimize(light_find(&ht, hash(key), key));
+		if (++i == keys.size())
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+	light_destroy(&ht);
+}
+BENCHMARK(bench_light_find_miss)->Range(1 << 10, 1 << 20);
+
+BENCHMARK_MAIN();
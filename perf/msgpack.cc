@@ -0,0 +1,162 @@
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <vector>
+#include <random>
+
+#include "msgpuck.h"
+
+enum {
+	/** Number of values in a decoded buffer. */
+	VALUE_COUNT = 1024,
+	/** Maximal length of a string value. */
+	STR_LEN_MAX = 64,
+};
+
+/**
+ * Encode VALUE_COUNT values produced by @a encode into a buffer
+ * big enough to hold @a max_size bytes per value.
+ */
+static std::vector<char>
+make_buffer(size_t max_size, char *(*encode)(char *, std::mt19937_64 &))
+{
+	std::vector<char> buf(VALUE_COUNT * max_size);
+	std::mt19937_64 rng(42);
+	char *pos = buf.data();
+	for (int i = 0; i < VALUE_COUNT; i++)
+		pos = encode(pos, rng);
+	buf.resize(pos - buf.data());
+	return buf;
+}
+
+/** Values of all sizes: fixint, uint8, ..., uint64. */
+static char *
+encode_uint(char *pos, std::mt19937_64 &rng)
+{
+	return mp_encode_uint(pos, rng() >> (rng() % 64));
+}
+
+static char *
+encode_int(char *pos, std::mt19937_64 &rng)
+{
+	int64_t value = (int64_t)(rng() >> (rng() % 64 + 1));
+	if (rng() % 2 == 0 && value > 0)
+		return mp_encode_int(pos, -value);
+	return mp_encode_uint(pos, value);
+}
+
+static char *
+encode_str(char *pos, std::mt19937_64 &rng)
+{
+	static const char data[STR_LEN_MAX] = {0};
+	return mp_encode_str(pos, data, rng() % STR_LEN_MAX);
+}
+
+static char *
+encode_double(char *pos, std::mt19937_64 &rng)
+{
+	return mp_encode_double(pos, (double)rng() / 3);
+}
+
+static void
+bench_mp_decode_uint(benchmark::State &state)
+{
+	std::vector<char> buf = make_buffer(9, encode_uint);
+	for (auto _ : state) {
+		const char *pos = buf.data();
+		for (int i = 0; i < VALUE_COUNT; i++)
+			benchmark::DoNotOptimize(mp_decode_uint(&pos));
+	}
+	state.SetItemsProcessed(state.iterations() * VALUE_COUNT);
+}
+BENCHMARK(bench_mp_decode_uint);
+
+static void
+bench_mp_read_int64(benchmark::State &state)
+{
+	std::vector<char> buf = make_buffer(9, encode_int);
+	for (auto _ : state) {
+		const char *pos = buf.data();
+		for (int i = 0; i < VALUE_COUNT; i++) {
+			int64_t value;
+			mp_read_int64(&pos, &value);
+			benchmark::DoNotOptimize(value);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * VALUE_COUNT);
+}
+BENCHMARK(bench_mp_read_int64);
+
+static void
+bench_mp_decode_str(benchmark::State &state)
+{
+	std::vector<char> buf = make_buffer(5 + STR_LEN_MAX, encode_str);
+	for (auto _ : state) {
+		const char *pos = buf.data();
+		for (int i = 0; i < VALUE_COUNT; i++) {
+			uint32_t len;
+			benchmark::DoNotOptimize(mp_decode_str(&pos, &len));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * VALUE_COUNT);
+}
+BENCHMARK(bench_mp_decode_str);
+
+static void
+bench_mp_decode_double(benchmark::State &state)
+{
+	std::vector<char> buf = make_buffer(9, encode_double);
+	for (auto _ : state) {
+		const char *pos = buf.data();
+		for (int i = 0; i < VALUE_COUNT; i++)
+			benchmark::DoNotOptimize(mp_decode_double(&pos));
+	}
+	state.SetItemsProcessed(state.iterations() * VALUE_COUNT);
+}
+BENCHMARK(bench_mp_decode_double);
+
+/** A typical tuple: [uint, str, uint, double, [uint, uint]]. */
+static char *
+encode_tuple(char *pos, std::mt19937_64 &rng)
+{
+	pos = mp_encode_array(pos, 5);
+	pos = mp_encode_uint(pos, rng() % 1000000);
+	pos = mp_encode_str0(pos, "some string value");
+	pos = mp_encode_uint(pos, rng() % 100);
+	pos = mp_encode_double(pos, 1.5);
+	pos = mp_encode_array(pos, 2);
+	pos = mp_encode_uint(pos, 1);
+	return mp_encode_uint(pos, rng());
+}
+
+static void
+bench_mp_next(benchmark::State &state)
+{
+	std::vector<char> buf = make_buffer(64, encode_tuple);
+	for (auto _ : state) {
+		const char *pos = buf.data();
+		for (int i = 0; i < VALUE_COUNT; i++)
+			mp_next(&pos);
+		benchmark::DoNotOptimize(pos);
+	}
+	state.SetItemsProcessed(state.iterations() * VALUE_COUNT);
+	state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(bench_mp_next);
+
+static void
+bench_mp_check(benchmark::State &state)
+{
+	std::vector<char> buf = make_buffer(64, encode_tuple);
+	for (auto _ : state) {
+		const char *pos = buf.data();
+		const char *end = buf.data() + buf.size();
+		for (int i = 0; i < VALUE_COUNT; i++)
+			benchmark::DoNotOptimize(mp_check(&pos, end));
+	}
+	state.SetItemsProcessed(state.iterations() * VALUE_COUNT);
+	state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(bench_mp_check);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,172 @@
+#!/usr/bin/env tarantool
+
+-- Replication throughput benchmark.
+--
+-- Starts a master in this process and a read-only replica in a
+-- child process, loads the master and reports how fast rows are
+-- written on the master and applied on the replica, as well as
+-- the replication lag observed by the replica applier.
+--
+-- Usage:
+--   tarantool replication.lua [--rows N] [--size BYTES]
+--       [--batch ROWS] [--fibers N] [--engine memtx|vinyl]
+--       [--wal_compression_level N] [--replication_compression C]
+--       [--wal_group_commit_delay S] [--dir PATH]
+--
+-- The replica is the same script started with the `replica'
+-- positional argument, it isn't supposed to be run by hand.
+
+local fiber = require('fiber')
+local fio = require('fio')
+local clock = require('clock')
+local log = require('log')
+local popen = require('popen')
+local net_box = require('net.box')
+local argparse = require('internal.argparse')
+
+local params = argparse.parse(arg, {
+    {'rows', 'number'},
+    {'size', 'number'},
+    {'batch', 'number'},
+    {'fibers', 'number'},
+    {'engine', 'string'},
+    {'wal_compression_level', 'number'},
+    {'replication_compression', 'string'},
+    {'wal_group_commit_delay', 'number'},
+    {'dir', 'string'},
+})
+
+local ROWS = params.rows or 1000000
+local SIZE = params.size or 100
+local BATCH = params.batch or 100
+local FIBERS = params.fibers or 16
+local ENGINE = params.engine or 'memtx'
+
+local function instance_cfg(dir, name)
+    return {
+        work_dir = dir,
+        log = fio.pathjoin(dir, name .. '.log'),
+        memtx_memory = 1024 * 1024 * 1024,
+        wal_compression_level = params.wal_compression_level,
+        replication_compression = params.replication_compression,
+        wal_group_commit_delay = params.wal_group_commit_delay,
+    }
+end
+
+if params[1] == 'replica' then
+    local master_uri, listen, dir = params[2], params[3], params[4]
+    local cfg = instance_cfg(dir, 'replica')
+    cfg.listen = listen
+    cfg.replication = master_uri
+    cfg.read_only = true
+    box.cfg(cfg)
+    return
+end
+
+local dir = params.dir or fio.tempdir()
+local master_dir = fio.pathjoin(dir, 'master')
+local replica_dir = fio.pathjoin(dir, 'replica')
+fio.mkdir(master_dir)
+fio.mkdir(replica_dir)
+local master_uri = 'unix/:' .. fio.pathjoin(dir, 'master.sock')
+local replica_uri = 'unix/:' .. fio.pathjoin(dir, 'replica.sock')
+
+local cfg = instance_cfg(master_dir, 'master')
+cfg.listen = master_uri
+box.cfg(cfg)
+box.schema.user.grant('guest', 'super')
+local space = box.schema.space.create('bench', {engine = ENGINE})
+space:create_index('pk')
+
+local replica = popen.new({arg[-1], arg[0], 'replica', master_uri,
+                           replica_uri, replica_dir})
+
+-- Wait until the replica bootstraps and follows the master.
+local function downstream()
+    local info = box.info.replication[2]
+    return info ~= nil and info.downstream or nil
+end
+while downstream() == nil or downstream().status ~= 'follow' do
+    fiber.sleep(0.01)
+end
+local conn = net_box.connect(replica_uri, {wait_connected = true})
+
+-- Sample the replica applier lag while the load is running.
+local lag_samples = {}
+local sampling = true
+local sampler = fiber.new(function()
+    while sampling do
+        local ok, lag = pcall(conn.eval, conn,
+            'return box.info.replication[1].upstream.lag')
+        if ok and lag ~= nil then
+            table.insert(lag_samples, lag)
+        end
+        fiber.sleep(0.01)
+    end
+end)
+sampler:set_joinable(true)
+
+local payload = string.rep('x', SIZE)
+local next_key = 0
+local function loader()
+    while next_key < ROWS do
+        local first = next_key
+        local last = math.min(first + BATCH, ROWS)
+        next_key = last
+        box.begin()
+        for key = first, last - 1 do
+            space:replace({key, payload})
+        end
+        box.commit()
+    end
+end
+
+local start = clock.monotonic()
+local loaders = {}
+for i = 1, FIBERS do
+    loaders[i] = fiber.new(loader)
+    loaders[i]:set_joinable(true)
+end
+for i = 1, FIBERS do
+    loaders[i]:join()
+end
+local master_time = clock.monotonic() - start
+
+-- Wait until the replica acknowledges the last row.
+local lsn = box.info.lsn
+while (downstream().vclock[1] or 0) < lsn do
+    fiber.sleep(0.001)
+end
+local replica_time = clock.monotonic() - start
+
+sampling = false
+sampler:join()
+
+table.sort(lag_samples)
+local function percentile(p)
+    if #lag_samples == 0 then
+        return 0
+    end
+    return lag_samples[math.max(1, math.ceil(#lag_samples * p / 100))]
+end
+
+print(string.format('rows: %d, size: %d, batch: %d, fibers: %d, engine: %s',
+                    ROWS, SIZE, BATCH, FIBERS, ENGINE))
+print(string.format('master:  %.3f s, %.0f rows/s, %.1f MB/s', master_time,
+                    ROWS / master_time, ROWS * SIZE / master_time / 1e6))
+print(string.format('replica: %.3f s, %.0f rows/s, catch-up %.3f s',
+                    replica_time, ROWS / replica_time,
+                    replica_time - master_time))
+print(string.format('lag: p50 %.3f ms, p99 %.3f ms, max %.3f ms',
+                    percentile(50) * 1e3, percentile(99) * 1e3,
+                    percentile(100) * 1e3))
+
+conn:close()
+replica:kill()
+replica:wait()
+replica:close()
+if params.dir == nil then
+    fio.rmtree(dir)
+end
+log.info('replication benchmark finished')
+os.exit(0)
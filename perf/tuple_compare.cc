@@ -0,0 +1,164 @@
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <random>
+
+#include "trivia/util.h"
+#include "memory.h"
+#include "fiber.h"
+#include "msgpuck.h"
+#include "box/tuple.h"
+#include "box/tuple_format.h"
+#include "box/key_def.h"
+
+enum {
+	/** Number of tuples compared with each other. */
+	TUPLE_COUNT = 1024,
+	/** Number of distinct values of each field. */
+	VALUE_COUNT = 64,
+};
+
+/** A key shape: types of the indexed fields. */
+struct key_shape {
+	const char *name;
+	uint32_t part_count;
+	enum field_type types[3];
+	bool is_nullable;
+};
+
+static const struct key_shape key_shapes[] = {
+	{"unsigned", 1, {FIELD_TYPE_UNSIGNED}, false},
+	{"unsigned_nullable", 1, {FIELD_TYPE_UNSIGNED}, true},
+	{"string", 1, {FIELD_TYPE_STRING}, false},
+	{"unsigned_unsigned", 2,
+	 {FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED}, false},
+	{"unsigned_string", 2,
+	 {FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING}, false},
+	{"scalar_scalar_scalar", 3,
+	 {FIELD_TYPE_SCALAR, FIELD_TYPE_SCALAR, FIELD_TYPE_SCALAR}, false},
+};
+
+/** Tuples matching a key shape along with their hints. */
+struct tuple_set {
+	struct key_def *key_def;
+	struct tuple_format *format;
+	std::vector<struct tuple *> tuples;
+	std::vector<hint_t> hints;
+};
+
+static char *
+encode_field(char *data, enum field_type type, unsigned value)
+{
+	char buf[32];
+	switch (type) {
+	case FIELD_TYPE_STRING:
+		/* Common prefix makes comparisons look at the tail. */
+		snprintf(buf, sizeof(buf), "key_prefix_%08u", value);
+		return mp_encode_str0(data, buf);
+	default:
+		return mp_encode_uint(data, value);
+	}
+}
+
+static void
+tuple_set_create(struct tuple_set *set, const struct key_shape *shape)
+{
+	struct key_part_def parts[3];
+	for (uint32_t i = 0; i < shape->part_count; i++) {
+		parts[i] = key_part_def_default;
+		parts[i].fieldno = i;
+		parts[i].type = shape->types[i];
+		parts[i].is_nullable = shape->is_nullable;
+	}
+	set->key_def = key_def_new(parts, shape->part_count, false);
+	set->format = box_tuple_format_new(&set->key_def, 1);
+	std::mt19937 rng(42);
+	char data[128];
+	for (int i = 0; i < TUPLE_COUNT; i++) {
+		char *end = mp_encode_array(data, shape->part_count);
+		for (uint32_t j = 0; j < shape->part_count; j++) {
+			end = encode_field(end, shape->types[j],
+					   rng() % VALUE_COUNT);
+		}
+		struct tuple *tuple = tuple_new(set->format, data, end);
+		tuple_ref(tuple);
+		set->tuples.push_back(tuple);
+		set->hints.push_back(tuple_hint(tuple, set->key_def));
+	}
+}
+
+static void
+tuple_set_destroy(struct tuple_set *set)
+{
+	for (struct tuple *tuple : set->tuples)
+		tuple_unref(tuple);
+	tuple_format_unref(set->format);
+	key_def_delete(set->key_def);
+}
+
+static void
+bench_tuple_compare(benchmark::State &state)
+{
+	const struct key_shape *shape = &key_shapes[state.range(0)];
+	bool use_hints = state.range(1) != 0;
+	state.SetLabel(shape->name);
+	struct tuple_set set;
+	tuple_set_create(&set, shape);
+	size_t i = 0;
+	for (auto _ : state) {
+		size_t j = (i * 7 + 13) % TUPLE_COUNT;
+		hint_t hint_a = use_hints ? set.hints[i] : HINT_NONE;
+		hint_t hint_b = use_hints ? set.hints[j] : HINT_NONE;
+		benchmark::DoNotOptimize(tuple_compare(set.tuples[i], hint_a,
+						       set.tuples[j], hint_b,
+						       set.key_def));
+		if (++i == TUPLE_COUNT)
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+	tuple_set_destroy(&set);
+}
+BENCHMARK(bench_tuple_compare)
+	->ArgsProduct({benchmark::CreateDenseRange(
+			0, lengthof(key_shapes) - 1, 1), {0, 1}})
+	->ArgNames({"shape", "hints"});
+
+static void
+bench_tuple_hint(benchmark::State &state)
+{
+	const struct key_shape *shape = &key_shapes[state.range(0)];
+	state.SetLabel(shape->name);
+	struct tuple_set set;
+	tuple_set_create(&set, shape);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(tuple_hint(set.tuples[i],
+						    set.key_def));
+		if (++i == TUPLE_COUNT)
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+	tuple_set_destroy(&set);
+}
+BENCHMARK(bench_tuple_hint)
+	->DenseRange(0, lengthof(key_shapes) - 1, 1)
+	->ArgName("shape");
+
+int
+main(int argc, char **argv)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	tuple_init(NULL);
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	tuple_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -0,0 +1,301 @@
+#include <benchmark/benchmark.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memory.h"
+#include "fiber.h"
+#include "cbus.h"
+#include "diag.h"
+#include "msgpuck.h"
+#include "trivia/util.h"
+#include "uuid/tt_uuid.h"
+#include "replication.h"
+#include "wal.h"
+#include "xlog.h"
+#include "xrow.h"
+
+/*
+ * WAL write throughput. Every benchmark keeps a number of
+ * journal entries in flight and waits until the WAL thread
+ * confirms all of them, so that the group commit has something
+ * to batch. Entries are written to a real xdir created in a
+ * temporary directory.
+ *
+ * The WAL itself is configured once per run with the options:
+ *
+ *   --wal_mode=write|fsync          (write)
+ *   --wal_compression_level=N       (0, compression disabled)
+ *   --wal_compression_threshold=N   (2048)
+ *   --wal_compression_threads=N     (0)
+ *   --wal_group_commit_delay=S      (0)
+ *   --wal_group_commit_max_size=N   (1048576)
+ *   --wal_dir=PATH                  (a temporary directory)
+ */
+static struct {
+	enum wal_mode mode;
+	int compression_level;
+	size_t compression_threshold;
+	int compression_threads;
+	double group_commit_delay;
+	int64_t group_commit_max_size;
+	const char *dir;
+} wal_opts = {
+	WAL_WRITE, 0, 2048, 0, 0, 1024 * 1024, NULL,
+};
+
+/** Number of entries of the current batch not written yet. */
+static int batch_pending;
+/** Fiber waiting for the current batch. */
+static struct fiber *batch_waiter;
+
+static void
+write_async_cb(struct journal_entry *entry)
+{
+	if (entry->res < 0)
+		abort();
+	if (--batch_pending == 0)
+		fiber_wakeup(batch_waiter);
+}
+
+/**
+ * Encode an INSERT request body with a tuple of the given size,
+ * so that rows look like the ones written by memtx.
+ */
+static char *
+encode_body(size_t tuple_size, size_t *size)
+{
+	size_t str_size = tuple_size > 16 ? tuple_size - 16 : 1;
+	char *body = (char *)xmalloc(str_size + 32);
+	char *p = body;
+	p = mp_encode_map(p, 2);
+	p = mp_encode_uint(p, IPROTO_SPACE_ID);
+	p = mp_encode_uint(p, 512);
+	p = mp_encode_uint(p, IPROTO_TUPLE);
+	p = mp_encode_array(p, 2);
+	p = mp_encode_uint(p, 1);
+	p = mp_encode_strl(p, str_size);
+	memset(p, 'x', str_size);
+	p += str_size;
+	*size = p - body;
+	return body;
+}
+
+/**
+ * Write batches of entries. Arguments: tuple size, number of
+ * entries in flight, number of rows per entry.
+ */
+static void
+bench_journal_write(benchmark::State &state)
+{
+	size_t body_size;
+	char *body = encode_body(state.range(0), &body_size);
+	int concurrency = state.range(1);
+	int n_rows = state.range(2);
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	batch_waiter = fiber();
+	for (auto _ : state) {
+		batch_pending = concurrency;
+		for (int i = 0; i < concurrency; i++) {
+			struct journal_entry *entry =
+				journal_entry_new(n_rows, region, NULL);
+			if (entry == NULL)
+				abort();
+			for (int j = 0; j < n_rows; j++) {
+				struct xrow_header *row = (struct xrow_header *)
+					region_alloc(region, sizeof(*row));
+				if (row == NULL)
+					abort();
+				memset(row, 0, sizeof(*row));
+				row->type = IPROTO_INSERT;
+				row->bodycnt = 1;
+				row->body[0].iov_base = body;
+				row->body[0].iov_len = body_size;
+				entry->rows[j] = row;
+				entry->approx_len += xrow_approx_len(row);
+			}
+			if (journal_write_async(entry) != 0)
+				abort();
+		}
+		while (batch_pending > 0)
+			fiber_yield();
+		region_truncate(region, used);
+	}
+	int64_t rows = state.iterations() * concurrency * n_rows;
+	state.SetItemsProcessed(rows);
+	state.SetBytesProcessed(rows * body_size);
+	free(body);
+}
+BENCHMARK(bench_journal_write)
+	->ArgNames({"size", "inflight", "rows"})
+	->Args({64, 1, 1})
+	->Args({64, 64, 1})
+	->Args({64, 1024, 1})
+	->Args({1024, 1, 1})
+	->Args({1024, 64, 1})
+	->Args({1024, 1024, 1})
+	->Args({16384, 64, 1})
+	->Args({64, 64, 16})
+	->Args({1024, 64, 16})
+	->UseRealTime();
+
+static void
+on_garbage_collection(const struct vclock *vclock)
+{
+	(void)vclock;
+}
+
+static void
+on_checkpoint_threshold(void)
+{
+}
+
+static void
+wal_start(const char *dir)
+{
+	struct tt_uuid uuid;
+	tt_uuid_create(&uuid);
+	instance_id = 1;
+	if ((wal_opts.compression_threads > 0 &&
+	     xlog_zpool_start(wal_opts.compression_threads) != 0) ||
+	    wal_init(wal_opts.mode, write_async_cb, dir, 256 * 1024 * 1024,
+		     wal_opts.compression_level,
+		     wal_opts.compression_threshold, &uuid,
+		     on_garbage_collection, on_checkpoint_threshold) != 0 ||
+	    wal_enable() != 0) {
+		diag_log();
+		abort();
+	}
+	if (wal_opts.group_commit_delay > 0)
+		wal_set_group_commit(wal_opts.group_commit_delay,
+				     wal_opts.group_commit_max_size);
+}
+
+static void
+wal_stop(void)
+{
+	wal_free();
+	if (wal_opts.compression_threads > 0)
+		xlog_zpool_stop();
+}
+
+/** Fiber processing messages sent by the WAL thread. */
+static int
+tx_prio_f(va_list ap)
+{
+	(void)ap;
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "tx_prio", fiber_schedule_cb,
+			     fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	return 0;
+}
+
+/** Benchmarks run in a fiber, because WAL writes yield. */
+static int
+main_f(va_list ap)
+{
+	(void)ap;
+	struct fiber *tx_prio = fiber_new("tx_prio", tx_prio_f);
+	if (tx_prio == NULL)
+		abort();
+	fiber_set_joinable(tx_prio, true);
+	fiber_start(tx_prio);
+
+	char tmpdir[] = "/tmp/wal.perftest.XXXXXX";
+	const char *dir = wal_opts.dir;
+	if (dir == NULL && (dir = mkdtemp(tmpdir)) == NULL)
+		abort();
+	wal_start(dir);
+
+	benchmark::RunSpecifiedBenchmarks();
+
+	wal_stop();
+	if (wal_opts.dir == NULL) {
+		char cmd[PATH_MAX];
+		snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+		if (system(cmd) != 0)
+			abort();
+	}
+	fiber_cancel(tx_prio);
+	fiber_join(tx_prio);
+	ev_break(loop(), EVBREAK_ALL);
+	return 0;
+}
+
+/** Return the rest of @a str if it starts with @a prefix. */
+static const char *
+option_value(const char *str, const char *prefix)
+{
+	size_t len = strlen(prefix);
+	return strncmp(str, prefix, len) == 0 ? str + len : NULL;
+}
+
+/**
+ * Consume the WAL options from the command line, leaving
+ * the rest to Google Benchmark.
+ */
+static void
+parse_wal_opts(int *argc, char **argv)
+{
+	int n = 1;
+	for (int i = 1; i < *argc; i++) {
+		const char *arg = argv[i];
+		const char *value;
+		if ((value = option_value(arg, "--wal_mode=")) != NULL) {
+			if (strcmp(value, "write") == 0)
+				wal_opts.mode = WAL_WRITE;
+			else if (strcmp(value, "fsync") == 0)
+				wal_opts.mode = WAL_FSYNC;
+			else
+				exit(1);
+		} else if ((value = option_value(arg,
+				"--wal_compression_level=")) != NULL) {
+			wal_opts.compression_level = atoi(value);
+		} else if ((value = option_value(arg,
+				"--wal_compression_threshold=")) != NULL) {
+			wal_opts.compression_threshold = atoll(value);
+		} else if ((value = option_value(arg,
+				"--wal_compression_threads=")) != NULL) {
+			wal_opts.compression_threads = atoi(value);
+		} else if ((value = option_value(arg,
+				"--wal_group_commit_delay=")) != NULL) {
+			wal_opts.group_commit_delay = atof(value);
+		} else if ((value = option_value(arg,
+				"--wal_group_commit_max_size=")) != NULL) {
+			wal_opts.group_commit_max_size = atoll(value);
+		} else if ((value = option_value(arg, "--wal_dir=")) != NULL) {
+			wal_opts.dir = value;
+		} else {
+			argv[n++] = argv[i];
+		}
+	}
+	*argc = n;
+}
+
+int
+main(int argc, char **argv)
+{
+	parse_wal_opts(&argc, argv);
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	cbus_init();
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	struct fiber *main_fiber = fiber_new("main", main_f);
+	if (main_fiber == NULL)
+		abort();
+	fiber_wakeup(main_fiber);
+	ev_run(loop(), 0);
+	benchmark::Shutdown();
+	cbus_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "memory.h"
+#include "fiber.h"
+#include "msgpuck.h"
+#include "box/xrow.h"
+#include "box/iproto_constants.h"
+
+/**
+ * Encode a typical WAL row header: type, replica id, lsn,
+ * timestamp, sync, tsn and commit flag.
+ */
+static const char *
+encode_header(size_t *size)
+{
+	struct xrow_header header;
+	memset(&header, 0, sizeof(header));
+	header.type = IPROTO_INSERT;
+	header.replica_id = 1;
+	header.lsn = 123456789;
+	header.tm = 1600000000.123;
+	header.tsn = header.lsn;
+	header.is_commit = true;
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(&header, 100500, iov, 0);
+	if (iovcnt != 1)
+		abort();
+	*size = iov[0].iov_len;
+	return (const char *)iov[0].iov_base;
+}
+
+static void
+bench_xrow_header_decode(benchmark::State &state)
+{
+	size_t size;
+	const char *data = encode_header(&size);
+	for (auto _ : state) {
+		struct xrow_header header;
+		const char *pos = data;
+		if (xrow_header_decode(&header, &pos, data + size, true) != 0)
+			abort();
+		benchmark::DoNotOptimize(header);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bench_xrow_header_decode);
+
+static void
+bench_xrow_header_encode(benchmark::State &state)
+{
+	struct xrow_header header;
+	memset(&header, 0, sizeof(header));
+	header.type = IPROTO_INSERT;
+	header.replica_id = 1;
+	header.lsn = 123456789;
+	header.tm = 1600000000.123;
+	header.tsn = header.lsn;
+	header.is_commit = true;
+	struct region *region = &fiber()->gc;
+	size_t svp = region_used(region);
+	for (auto _ : state) {
+		struct iovec iov[XROW_IOVMAX];
+		benchmark::DoNotOptimize(xrow_header_encode(&header, 100500,
+							    iov, 0));
+		region_truncate(region, svp);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bench_xrow_header_encode);
+
+static void
+bench_xrow_decode_dml(benchmark::State &state)
+{
+	/* {space_id: 512, tuple: [1, 'value', 2.5]} */
+	char body[64];
+	char *end = mp_encode_map(body, 2);
+	end = mp_encode_uint(end, IPROTO_SPACE_ID);
+	end = mp_encode_uint(end, 512);
+	end = mp_encode_uint(end, IPROTO_TUPLE);
+	end = mp_encode_array(end, 3);
+	end = mp_encode_uint(end, 1);
+	end = mp_encode_str0(end, "value");
+	end = mp_encode_double(end, 2.5);
+	struct xrow_header row;
+	memset(&row, 0, sizeof(row));
+	row.type = IPROTO_INSERT;
+	row.bodycnt = 1;
+	row.body[0].iov_base = body;
+	row.body[0].iov_len = end - body;
+	uint64_t key_map = dml_request_key_map(row.type);
+	for (auto _ : state) {
+		struct request request;
+		if (xrow_decode_dml(&row, &request, key_map) != 0)
+			abort();
+		benchmark::DoNotOptimize(request);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bench_xrow_decode_dml);
+
+int
+main(int argc, char **argv)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	fiber_free();
+	memory_free();
+	return 0;
+}
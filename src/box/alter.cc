@@ -31,6 +31,7 @@
 #include "alter.h"
 #include "assoc.h"
 #include "ck_constraint.h"
+#include "matview.h"
 #include "column_mask.h"
 #include "schema.h"
 #include "user.h"
@@ -234,6 +235,12 @@ index_opts_decode(struct index_opts *opts, const char *map,
 			 "run_size_ratio must be greater than 1");
 		return -1;
 	}
+	if (opts->compaction_strategy == index_compaction_strategy_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "compaction_strategy must be "
+			 "either 'leveled' or 'tiered'");
+		return -1;
+	}
 	if (opts->bloom_fpr <= 0 || opts->bloom_fpr > 1) {
 		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
 			 BOX_INDEX_FIELD_OPTS,
@@ -241,6 +248,24 @@ index_opts_decode(struct index_opts *opts, const char *map,
 			 "less than or equal to 1");
 		return -1;
 	}
+	if (opts->bloom_type == tuple_bloom_type_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "bloom_type must be either "
+			 "'bloom' or 'xor'");
+		return -1;
+	}
+	if (opts->ttl < 0) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS,
+			 "ttl must be greater than or equal to 0");
+		return -1;
+	}
+	if (opts->hash_type == index_hash_type_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "hash_type must be either "
+			 "'light' or 'swiss'");
+		return -1;
+	}
 	return 0;
 }
 
@@ -502,6 +527,12 @@ field_def_decode(struct field_def *field, const char **data,
 				    "string, scalar and any fields"));
 		return -1;
 	}
+	if (field->compression_type == compression_type_MAX) {
+		diag_set(ClientError, errcode, tt_cstr(space_name, name_len),
+			 tt_sprintf("field %d has unknown compression type",
+				    fieldno + TUPLE_INDEX_BASE));
+		return -1;
+	}
 
 	const char *dv = field->default_value;
 	if (dv != NULL) {
@@ -659,7 +690,7 @@ space_def_new_from_tuple(struct tuple *tuple, uint32_t errcode,
 			 int2str(opts.group_id));
 		return NULL;
 	}
-	if (opts.is_view && opts.sql == NULL) {
+	if ((opts.is_view || opts.is_materialized) && opts.sql == NULL) {
 		diag_set(ClientError, ER_VIEW_MISSING_SQL);
 		return NULL;
 	}
@@ -1045,12 +1076,13 @@ alter_space_rollback(struct trigger *trigger, void * /* event */)
 	space_fill_index_map(alter->old_space);
 	space_fill_index_map(alter->new_space);
 	/*
-	 * Don't forget about space triggers, foreign keys and
-	 * constraints.
+	 * Don't forget about space triggers, foreign keys,
+	 * constraints and request statistics.
 	 */
 	space_swap_triggers(alter->new_space, alter->old_space);
 	space_swap_fk_constraints(alter->new_space, alter->old_space);
 	space_swap_constraint_ids(alter->new_space, alter->old_space);
+	SWAP(alter->new_space->stat, alter->old_space->stat);
 	space_cache_replace(alter->new_space, alter->old_space);
 	alter_space_delete(alter);
 	return 0;
@@ -1157,12 +1189,13 @@ alter_space_do(struct txn_stmt *stmt, struct alter_space *alter)
 	space_fill_index_map(alter->old_space);
 	space_fill_index_map(alter->new_space);
 	/*
-	 * Don't forget about space triggers, foreign keys and
-	 * constraints.
+	 * Don't forget about space triggers, foreign keys,
+	 * constraints and request statistics.
 	 */
 	space_swap_triggers(alter->new_space, alter->old_space);
 	space_swap_fk_constraints(alter->new_space, alter->old_space);
 	space_swap_constraint_ids(alter->new_space, alter->old_space);
+	SWAP(alter->new_space->stat, alter->old_space->stat);
 	/*
 	 * The new space is ready. Time to update the space
 	 * cache with it.
@@ -2143,6 +2176,43 @@ on_drop_view_rollback(struct trigger *trigger, void *event)
 	return 0;
 }
 
+/**
+ * Rollback creation of the primary key of a materialized view:
+ * stop maintaining the view.
+ */
+static int
+on_create_matview_rollback(struct trigger *trigger, void *event)
+{
+	(void) event;
+	struct matview *matview = (struct matview *)trigger->data;
+	matview_detach(matview);
+	matview_delete(matview);
+	return 0;
+}
+
+/** Commit drop of the primary key of a materialized view. */
+static int
+on_drop_matview_commit(struct trigger *trigger, void *event)
+{
+	(void) event;
+	struct matview *matview = (struct matview *)trigger->data;
+	matview_delete(matview);
+	return 0;
+}
+
+/**
+ * Rollback drop of the primary key of a materialized view:
+ * resume maintaining the view.
+ */
+static int
+on_drop_matview_rollback(struct trigger *trigger, void *event)
+{
+	(void) event;
+	struct matview *matview = (struct matview *)trigger->data;
+	matview_attach(matview);
+	return 0;
+}
+
 /**
  * A trigger which is invoked on replace in a data dictionary
  * space _space.
@@ -2261,7 +2331,7 @@ on_replace_dd_space(struct trigger * /* trigger */, void *event)
 		if (on_rollback == NULL)
 			return -1;
 		txn_stmt_on_rollback(stmt, on_rollback);
-		if (def->opts.is_view) {
+		if (def->opts.is_view || def->opts.is_materialized) {
 			struct Select *select = sql_view_compile(sql_get(),
 								 def->opts.sql);
 			if (select == NULL)
@@ -2372,7 +2442,8 @@ on_replace_dd_space(struct trigger * /* trigger */, void *event)
 		if (on_rollback == NULL)
 			return -1;
 		txn_stmt_on_rollback(stmt, on_rollback);
-		if (old_space->def->opts.is_view) {
+		if (old_space->def->opts.is_view ||
+		    old_space->def->opts.is_materialized) {
 			struct Select *select =
 				sql_view_compile(sql_get(),
 						 old_space->def->opts.sql);
@@ -2433,6 +2504,30 @@ on_replace_dd_space(struct trigger * /* trigger */, void *event)
 				  "a view and vice versa");
 			return -1;
 		}
+		if (def->opts.is_materialized !=
+		    old_space->def->opts.is_materialized) {
+			diag_set(ClientError, ER_ALTER_SPACE,
+				  space_name(old_space),
+				  "can not convert a space to "
+				  "a materialized view and vice versa");
+			return -1;
+		}
+		if (def->opts.is_materialized &&
+		    strcmp(def->opts.sql, old_space->def->opts.sql) != 0) {
+			diag_set(ClientError, ER_ALTER_SPACE,
+				  space_name(old_space),
+				  "can not change SQL of a materialized view");
+			return -1;
+		}
+		if (def->opts.defer_deletes !=
+		    old_space->def->opts.defer_deletes &&
+		    old_space->index_count > 1) {
+			diag_set(ClientError, ER_ALTER_SPACE,
+				  space_name(old_space),
+				  "can not change defer_deletes of a space "
+				  "with secondary indexes");
+			return -1;
+		}
 		if (strcmp(def->name, old_space->def->name) != 0 &&
 		    old_space->def->view_ref_count > 0) {
 			diag_set(ClientError, ER_ALTER_SPACE,
@@ -2630,6 +2725,24 @@ on_replace_dd_index(struct trigger * /* trigger */, void *event)
 		return -1;
 	}
 
+	/*
+	 * The primary key of a materialized view is made of the
+	 * GROUP BY columns of its SELECT, the view is maintained
+	 * while the key exists.
+	 */
+	bool is_matview_pk = iid == 0 && old_space->def->opts.is_materialized;
+	if (is_matview_pk && old_index != NULL && new_tuple != NULL) {
+		diag_set(ClientError, ER_ALTER_SPACE,
+			  space_name(old_space),
+			  "can not alter primary key of a materialized view");
+		return -1;
+	}
+	struct matview *new_matview = NULL;
+	auto matview_guard = make_scoped_guard([&] {
+		if (new_matview != NULL)
+			matview_delete(new_matview);
+	});
+
 	struct alter_space *alter = alter_space_new(old_space);
 	if (alter == NULL)
 		return -1;
@@ -2677,6 +2790,14 @@ on_replace_dd_index(struct trigger * /* trigger */, void *event)
 		if (def == NULL)
 			return -1;
 		index_def_update_optionality(def, alter->new_min_field_count);
+		if (is_matview_pk) {
+			new_matview = matview_new(old_space->def,
+						  def->key_def);
+			if (new_matview == NULL) {
+				index_def_delete(def);
+				return -1;
+			}
+		}
 		try {
 			if (def->opts.is_unique) {
 				(void) new CreateConstraintID(
@@ -2824,6 +2945,32 @@ on_replace_dd_index(struct trigger * /* trigger */, void *event)
 		return -1;
 	}
 	scoped_guard.is_active = false;
+	if (new_matview != NULL) {
+		struct trigger *on_rollback =
+			txn_alter_trigger_new(on_create_matview_rollback,
+					      new_matview);
+		if (on_rollback == NULL)
+			return -1;
+		matview_attach(new_matview);
+		txn_stmt_on_rollback(stmt, on_rollback);
+		matview_guard.is_active = false;
+		if (matview_populate(new_matview, stmt) != 0)
+			return -1;
+	} else if (is_matview_pk && new_tuple == NULL) {
+		struct matview *old_matview = matview_by_id(id);
+		assert(old_matview != NULL);
+		struct trigger *on_commit =
+			txn_alter_trigger_new(on_drop_matview_commit,
+					      old_matview);
+		struct trigger *on_rollback =
+			txn_alter_trigger_new(on_drop_matview_rollback,
+					      old_matview);
+		if (on_commit == NULL || on_rollback == NULL)
+			return -1;
+		matview_detach(old_matview);
+		txn_stmt_on_commit(stmt, on_commit);
+		txn_stmt_on_rollback(stmt, on_rollback);
+	}
 	return 0;
 }
 
@@ -2876,6 +3023,18 @@ on_replace_dd_truncate(struct trigger * /* trigger */, void *event)
 		return -1;
 	}
 
+	/*
+	 * Neither does it update materialized views, so a view
+	 * and its source can't be truncated.
+	 */
+	if (old_space->def->opts.is_materialized ||
+	    space_is_matview_source(space_id)) {
+		diag_set(ClientError, ER_ALTER_SPACE, space_name(old_space),
+			  "can not truncate a materialized view or its "
+			  "source");
+		return -1;
+	}
+
 	/*
 	 * Check if a write privilege was given, return an error if not.
 	 */
@@ -4363,6 +4522,11 @@ sequence_def_new_from_tuple(struct tuple *tuple, uint32_t errcode)
 			 "start must be between min and max");
 		return NULL;
 	}
+	if (def->cache < 0) {
+		diag_set(ClientError, errcode, def->name,
+			 "cache must be non-negative");
+		return NULL;
+	}
 	def_guard.is_active = false;
 	return def;
 }
@@ -4569,8 +4733,16 @@ on_replace_dd_sequence_data(struct trigger * /* trigger */, void *event)
 		if (tuple_field_i64(new_tuple, BOX_SEQUENCE_DATA_FIELD_VALUE,
 				    &value) != 0)
 			return -1;
-		if (sequence_set(seq, value) != 0)
+		if (seq->is_reserving) {
+			/*
+			 * The end of a block reserved by
+			 * box_sequence_next(), the sequence
+			 * value is already up to date.
+			 */
+			seq->is_reserving = false;
+		} else if (sequence_set(seq, value) != 0) {
 			return -1;
+		}
 	} else {					/* DELETE */
 		/*
 		 * A sequence isn't supposed to roll back to the old
@@ -53,6 +53,9 @@
 #include "box.h"
 #include "scoped_guard.h"
 #include "txn_limbo.h"
+#include "space.h"
+#include "index.h"
+#include "tuple.h"
 
 STRS(applier_state, applier_STATE);
 
@@ -148,6 +151,7 @@ applier_writer_f(va_list ap)
 	struct applier *applier = va_arg(ap, struct applier *);
 	struct ev_io io;
 	coio_create(&io, applier->io.fd);
+	double last_ack_time = 0;
 
 	while (!fiber_is_cancelled()) {
 		/*
@@ -163,6 +167,22 @@ applier_writer_f(va_list ap)
 				fiber_cond_wait_timeout(&applier->writer_cond,
 							replication_timeout);
 		}
+		/*
+		 * Let more WAL writes accumulate to send them in
+		 * one ACK. Don't delay it though if the master
+		 * waits for this replica to confirm synchronous
+		 * transactions.
+		 */
+		while (applier->has_acks_to_send &&
+		       txn_limbo_is_empty(&txn_limbo) &&
+		       !fiber_is_cancelled()) {
+			double deadline = last_ack_time +
+					  replication_ack_interval;
+			if (ev_monotonic_now(loop()) >= deadline)
+				break;
+			fiber_cond_wait_deadline(&applier->writer_cond,
+						 deadline);
+		}
 		/*
 		 * A writer fiber is going to be awaken after a commit or
 		 * a heartbeat message. So this is an appropriate place to
@@ -180,6 +200,7 @@ applier_writer_f(va_list ap)
 			struct xrow_header xrow;
 			xrow_encode_vclock(&xrow, &replicaset.vclock);
 			coio_write_xrow(&io, &xrow);
+			last_ack_time = ev_monotonic_now(loop());
 			ERROR_INJECT(ERRINJ_APPLIER_SLOW_ACK, {
 				fiber_sleep(0.01);
 			});
@@ -668,6 +689,104 @@ struct applier_tx_row {
 	struct xrow_header row;
 };
 
+/** Start decompressing the replication stream. */
+static void
+applier_zstd_start(struct applier *applier)
+{
+	assert(applier->zstd == NULL);
+	applier->zstd = ZSTD_createDStream();
+	if (applier->zstd == NULL)
+		tnt_raise(OutOfMemory, 0, "ZSTD_createDStream", "zstd");
+	size_t rc = ZSTD_initDStream(applier->zstd);
+	if (ZSTD_isError(rc))
+		tnt_raise(ClientError, ER_DECOMPRESSION, ZSTD_getErrorName(rc));
+	applier->zstd_has_output = false;
+	/*
+	 * Everything the master sent after the response to
+	 * SUBSCRIBE is compressed, including the data which
+	 * has already been read ahead to the input buffer.
+	 */
+	struct ibuf *ibuf = &applier->ibuf;
+	struct ibuf *zbuf = &applier->zstd_ibuf;
+	size_t size = ibuf_used(ibuf);
+	if (size > 0) {
+		memcpy(ibuf_reserve_xc(zbuf, size), ibuf->rpos, size);
+		zbuf->wpos += size;
+	}
+	ibuf_reset(ibuf);
+}
+
+/** Stop decompressing the replication stream. */
+static void
+applier_zstd_stop(struct applier *applier)
+{
+	ZSTD_freeDStream(applier->zstd);
+	applier->zstd = NULL;
+	ibuf_reinit(&applier->zstd_ibuf);
+}
+
+/**
+ * Decompress the replication stream to the applier input
+ * buffer until it has at least @a size bytes.
+ */
+static void
+applier_zstd_readn(struct applier *applier, size_t size, double timeout)
+{
+	struct ibuf *ibuf = &applier->ibuf;
+	struct ibuf *zbuf = &applier->zstd_ibuf;
+	while (ibuf_used(ibuf) < size) {
+		if (ibuf_used(zbuf) == 0 && !applier->zstd_has_output) {
+			ibuf_reset(zbuf);
+			coio_breadn_timeout(&applier->io, zbuf, 1, timeout);
+		}
+		ibuf_reserve_xc(ibuf, MAX(size - ibuf_used(ibuf),
+					  ZSTD_DStreamOutSize()));
+		ZSTD_inBuffer src = { zbuf->rpos, ibuf_used(zbuf), 0 };
+		ZSTD_outBuffer dst = { ibuf->wpos, ibuf_unused(ibuf), 0 };
+		size_t rc = ZSTD_decompressStream(applier->zstd, &dst, &src);
+		if (ZSTD_isError(rc)) {
+			tnt_raise(ClientError, ER_DECOMPRESSION,
+				  ZSTD_getErrorName(rc));
+		}
+		zbuf->rpos += src.pos;
+		ibuf->wpos += dst.pos;
+		applier->zstd_has_output = dst.pos == dst.size;
+	}
+}
+
+/**
+ * Read a row from the compressed replication stream,
+ * see coio_read_xrow_timeout_xc().
+ */
+static void
+applier_read_xrow_zstd(struct applier *applier, struct xrow_header *row,
+		       double timeout)
+{
+	struct ibuf *in = &applier->ibuf;
+	ev_tstamp start, delay;
+	coio_timeout_init(&start, &delay, timeout);
+	/* Read fixed header */
+	applier_zstd_readn(applier, 1, delay);
+	coio_timeout_update(&start, &delay);
+
+	/* Read length */
+	if (mp_typeof(*in->rpos) != MP_UINT) {
+		tnt_raise(ClientError, ER_INVALID_MSGPACK,
+			  "packet length");
+	}
+	ssize_t to_read = mp_check_uint(in->rpos, in->wpos);
+	if (to_read > 0)
+		applier_zstd_readn(applier, ibuf_used(in) + to_read, delay);
+	coio_timeout_update(&start, &delay);
+
+	uint32_t len = mp_decode_uint((const char **) &in->rpos);
+
+	/* Read header and body */
+	applier_zstd_readn(applier, len, delay);
+	xrow_header_decode_xc(row, (const char **) &in->rpos, in->rpos + len,
+			      true);
+}
+
 static struct applier_tx_row *
 applier_read_tx_row(struct applier *applier)
 {
@@ -689,7 +808,9 @@ applier_read_tx_row(struct applier *applier)
 	 * from the master for quite a while the connection is
 	 * broken - the master might just be idle.
 	 */
-	if (applier->version_id < version_id(1, 7, 7))
+	if (applier->zstd != NULL)
+		applier_read_xrow_zstd(applier, row, timeout);
+	else if (applier->version_id < version_id(1, 7, 7))
 		coio_read_xrow(coio, ibuf, row);
 	else
 		coio_read_xrow_timeout_xc(coio, ibuf, row, timeout);
@@ -820,17 +941,14 @@ applier_txn_wal_write_cb(struct trigger *trigger, void *event)
 }
 
 /**
- * Apply all rows in the rows queue as a single transaction.
- *
- * Return 0 for success or -1 in case of an error.
+ * Return the latch ordering the changes which originate from
+ * the same instance as the transaction in the rows queue.
  */
-static int
-applier_apply_tx(struct stailq *rows)
+static struct latch *
+applier_tx_latch(struct stailq *rows)
 {
 	struct xrow_header *first_row = &stailq_first_entry(rows,
 					struct applier_tx_row, next)->row;
-	struct xrow_header *last_row;
-	last_row = &stailq_last_entry(rows, struct applier_tx_row, next)->row;
 	struct replica *replica = replica_by_id(first_row->replica_id);
 	/*
 	 * In a full mesh topology, the same set of changes
@@ -838,13 +956,27 @@ applier_apply_tx(struct stailq *rows)
 	 * Hence we need a latch to strictly order all changes
 	 * that belong to the same server id.
 	 */
-	struct latch *latch = (replica ? &replica->order_latch :
-			       &replicaset.applier.order_latch);
-	latch_lock(latch);
+	return replica ? &replica->order_latch :
+			 &replicaset.applier.order_latch;
+}
+
+/**
+ * Remove the rows which have already been applied from the
+ * rows queue. Must be called with the latch returned by
+ * applier_tx_latch() held.
+ *
+ * Return true if the whole transaction has been applied.
+ */
+static bool
+applier_skip_applied_rows(struct stailq *rows)
+{
+	struct xrow_header *first_row = &stailq_first_entry(rows,
+					struct applier_tx_row, next)->row;
+	struct xrow_header *last_row;
+	last_row = &stailq_last_entry(rows, struct applier_tx_row, next)->row;
 	if (vclock_get(&replicaset.applier.vclock,
 		       last_row->replica_id) >= last_row->lsn) {
-		latch_unlock(latch);
-		return 0;
+		return true;
 	} else if (vclock_get(&replicaset.applier.vclock,
 			      first_row->replica_id) >= first_row->lsn) {
 		/*
@@ -865,7 +997,19 @@ applier_apply_tx(struct stailq *rows)
 			}
 		}
 	}
+	return false;
+}
 
+/**
+ * Begin a transaction and apply all rows in the rows queue in
+ * its scope. On success the transaction is ready to be submitted
+ * to WAL with txn_commit_async().
+ *
+ * Return NULL in case of an error.
+ */
+static struct txn *
+applier_begin_tx(struct stailq *rows)
+{
 	/**
 	 * Explicitly begin the transaction so that we can
 	 * control fiber->gc life cycle and, in case of apply
@@ -874,10 +1018,8 @@ applier_apply_tx(struct stailq *rows)
 	 */
 	struct txn *txn = txn_begin();
 	struct applier_tx_row *item;
-	if (txn == NULL) {
-		latch_unlock(latch);
-		return -1;
-	}
+	if (txn == NULL)
+		return NULL;
 	stailq_foreach_entry(item, rows, next) {
 		struct xrow_header *row = &item->row;
 		int res = apply_row(row);
@@ -937,7 +1079,34 @@ applier_apply_tx(struct stailq *rows)
 
 	trigger_create(on_wal_write, applier_txn_wal_write_cb, NULL, NULL);
 	txn_on_wal_write(txn, on_wal_write);
+	return txn;
+rollback:
+	txn_rollback(txn);
+	fiber_gc();
+	return NULL;
+}
 
+/**
+ * Apply all rows in the rows queue as a single transaction.
+ *
+ * Return 0 for success or -1 in case of an error.
+ */
+static int
+applier_apply_tx(struct stailq *rows)
+{
+	struct xrow_header *last_row;
+	last_row = &stailq_last_entry(rows, struct applier_tx_row, next)->row;
+	struct latch *latch = applier_tx_latch(rows);
+	latch_lock(latch);
+	if (applier_skip_applied_rows(rows)) {
+		latch_unlock(latch);
+		return 0;
+	}
+	struct txn *txn = applier_begin_tx(rows);
+	if (txn == NULL) {
+		latch_unlock(latch);
+		return -1;
+	}
 	if (txn_commit_async(txn) < 0)
 		goto fail;
 
@@ -952,14 +1121,421 @@ applier_apply_tx(struct stailq *rows)
 		      last_row->lsn);
 	latch_unlock(latch);
 	return 0;
-rollback:
-	txn_rollback(txn);
 fail:
 	latch_unlock(latch);
 	fiber_gc();
 	return -1;
 }
 
+enum {
+	/**
+	 * Max number of transactions dispatched to apply fibers
+	 * and not submitted to WAL yet. The reader stops reading
+	 * from the master when the limit is reached.
+	 */
+	APPLIER_APPLY_QUEUE_MAX = 1024,
+};
+
+/**
+ * A key changed by a transaction applied in parallel mode.
+ * Transactions changing the same keys are applied one after
+ * another, in the order they were received from the master.
+ */
+struct applier_tx_key {
+	/** Space id. */
+	uint32_t space_id;
+	/**
+	 * Hash of the primary key or 0 if the transaction
+	 * conflicts with any change of the space.
+	 */
+	uint32_t hash;
+};
+
+/**
+ * A transaction dispatched to apply fibers. Rows and their
+ * bodies are copied from the reader fiber region to the memory
+ * allocated along with the object.
+ */
+struct applier_tx {
+	/** Link in applier::apply_queue. */
+	struct rlist in_queue;
+	/** Set if an apply fiber has picked the transaction. */
+	bool is_taken;
+	/**
+	 * Set if the transaction may not be applied concurrently
+	 * with any other transaction, because it changes memtx
+	 * or system spaces, spaces with triggers or is not a DML.
+	 */
+	bool is_barrier;
+	/** Keys changed by the transaction, sorted. */
+	struct applier_tx_key *keys;
+	/** Number of elements in keys array. */
+	uint32_t key_count;
+	/** Transaction rows. */
+	struct stailq rows;
+};
+
+static int
+applier_tx_key_cmp(const void *a, const void *b)
+{
+	const struct applier_tx_key *ka = (const struct applier_tx_key *)a;
+	const struct applier_tx_key *kb = (const struct applier_tx_key *)b;
+	if (ka->space_id != kb->space_id)
+		return ka->space_id < kb->space_id ? -1 : 1;
+	if (ka->hash != kb->hash)
+		return ka->hash < kb->hash ? -1 : 1;
+	return 0;
+}
+
+/**
+ * Copy the rows of a transaction from the fiber region to a
+ * new applier_tx object.
+ */
+static struct applier_tx *
+applier_tx_new(struct stailq *rows)
+{
+	uint32_t row_count = 0;
+	size_t body_size = 0;
+	struct applier_tx_row *item;
+	stailq_foreach_entry(item, rows, next) {
+		row_count++;
+		if (item->row.bodycnt == 1)
+			body_size += item->row.body->iov_len;
+	}
+	size_t size = sizeof(struct applier_tx) +
+		      row_count * (sizeof(struct applier_tx_key) +
+				   sizeof(struct applier_tx_row)) + body_size;
+	struct applier_tx *tx = (struct applier_tx *)malloc(size);
+	if (tx == NULL)
+		tnt_raise(OutOfMemory, size, "malloc", "struct applier_tx");
+	tx->is_taken = false;
+	tx->is_barrier = false;
+	tx->keys = (struct applier_tx_key *)(tx + 1);
+	tx->key_count = 0;
+	stailq_create(&tx->rows);
+	struct applier_tx_row *copy =
+		(struct applier_tx_row *)(tx->keys + row_count);
+	char *body = (char *)(copy + row_count);
+	stailq_foreach_entry(item, rows, next) {
+		copy->row = item->row;
+		if (copy->row.bodycnt == 1) {
+			memcpy(body, item->row.body->iov_base,
+			       item->row.body->iov_len);
+			copy->row.body->iov_base = body;
+			body += item->row.body->iov_len;
+		}
+		stailq_add_tail_entry(&tx->rows, copy, next);
+		copy++;
+	}
+	return tx;
+}
+
+/**
+ * Add the key changed by a row to the transaction key set.
+ *
+ * Return -1 if the row can't be applied concurrently with
+ * other transactions.
+ */
+static int
+applier_tx_add_key(struct applier_tx *tx, struct xrow_header *row)
+{
+	if (row->type != IPROTO_INSERT && row->type != IPROTO_REPLACE &&
+	    row->type != IPROTO_UPDATE && row->type != IPROTO_DELETE &&
+	    row->type != IPROTO_UPSERT)
+		return -1;
+	struct request request;
+	if (xrow_decode_dml(row, &request,
+			    dml_request_key_map(row->type)) != 0) {
+		/* Let the apply fiber report the error. */
+		diag_clear(diag_get());
+		return -1;
+	}
+	struct space *space = space_by_id(request.space_id);
+	/*
+	 * Memtx transactions can't yield, so there is nothing to
+	 * gain from applying them concurrently.
+	 */
+	if (space == NULL || !space_is_vinyl(space) ||
+	    space_is_system(space) || space->def->opts.is_sync ||
+	    !rlist_empty(&space->before_replace) ||
+	    !rlist_empty(&space->on_replace))
+		return -1;
+	struct applier_tx_key *key = &tx->keys[tx->key_count++];
+	key->space_id = request.space_id;
+	key->hash = 0;
+	/*
+	 * Changes of different primary keys commute unless there
+	 * is a unique secondary index in the space.
+	 */
+	struct index *pk = space_index(space, 0);
+	if (pk == NULL || request.index_id != 0)
+		return 0;
+	for (uint32_t i = 1; i < space->index_count; i++) {
+		if (space->index[i]->def->opts.is_unique)
+			return 0;
+	}
+	struct key_def *key_def = pk->def->key_def;
+	const char *data;
+	if (request.type == IPROTO_UPDATE || request.type == IPROTO_DELETE) {
+		data = request.key;
+	} else {
+		data = tuple_extract_key_raw(request.tuple, request.tuple_end,
+					     key_def, MULTIKEY_NONE, NULL);
+		if (data == NULL) {
+			diag_clear(diag_get());
+			return 0;
+		}
+	}
+	if (mp_decode_array(&data) != key_def->part_count)
+		return 0;
+	key->hash = key_hash(data, key_def);
+	return 0;
+}
+
+/** Collect keys changed by a transaction. */
+static void
+applier_tx_collect_keys(struct applier_tx *tx)
+{
+	struct applier_tx_row *item;
+	stailq_foreach_entry(item, &tx->rows, next) {
+		if (applier_tx_add_key(tx, &item->row) != 0) {
+			tx->is_barrier = true;
+			return;
+		}
+	}
+	qsort(tx->keys, tx->key_count, sizeof(tx->keys[0]),
+	      applier_tx_key_cmp);
+}
+
+/** Check if two transactions may not be applied concurrently. */
+static bool
+applier_tx_is_conflicting(struct applier_tx *a, struct applier_tx *b)
+{
+	if (a->is_barrier || b->is_barrier)
+		return true;
+	uint32_t i = 0, j = 0;
+	while (i < a->key_count && j < b->key_count) {
+		struct applier_tx_key *ka = &a->keys[i];
+		struct applier_tx_key *kb = &b->keys[j];
+		if (ka->space_id != kb->space_id) {
+			if (ka->space_id < kb->space_id)
+				i++;
+			else
+				j++;
+			continue;
+		}
+		if (ka->hash == 0 || kb->hash == 0 || ka->hash == kb->hash)
+			return true;
+		if (ka->hash < kb->hash)
+			i++;
+		else
+			j++;
+	}
+	return false;
+}
+
+/**
+ * Check if a transaction may be applied, i.e. it doesn't
+ * conflict with any transaction received before it and not
+ * submitted to WAL yet.
+ */
+static bool
+applier_tx_can_start(struct applier *applier, struct applier_tx *tx)
+{
+	struct applier_tx *prev;
+	rlist_foreach_entry(prev, &applier->apply_queue, in_queue) {
+		if (prev == tx)
+			return true;
+		if (applier_tx_is_conflicting(prev, tx))
+			return false;
+	}
+	unreachable();
+	return false;
+}
+
+/**
+ * Apply a transaction in an apply fiber. Transactions are
+ * submitted to WAL strictly in the order they were received.
+ *
+ * Return 0 for success or -1 in case of an error.
+ */
+static int
+applier_tx_apply(struct applier *applier, struct applier_tx *tx)
+{
+	while (!applier_tx_can_start(applier, tx))
+		fiber_cond_wait(&applier->apply_cond);
+	if (applier->apply_failed)
+		return 0;
+	struct txn *txn = applier_begin_tx(&tx->rows);
+	if (txn == NULL)
+		return -1;
+	while (rlist_first_entry(&applier->apply_queue, struct applier_tx,
+				 in_queue) != tx)
+		fiber_cond_wait(&applier->apply_cond);
+	if (applier->apply_failed) {
+		txn_rollback(txn);
+		fiber_gc();
+		return 0;
+	}
+	int rc = txn_commit_async(txn);
+	fiber_gc();
+	return rc < 0 ? -1 : 0;
+}
+
+static int
+applier_apply_f(va_list ap)
+{
+	struct applier *applier = va_arg(ap, struct applier *);
+	/* See applier_f(). */
+	struct session *session = session_create_on_demand();
+	if (session == NULL)
+		return -1;
+	session_set_type(session, SESSION_TYPE_APPLIER);
+
+	while (true) {
+		struct applier_tx *tx = NULL, *next;
+		rlist_foreach_entry(next, &applier->apply_queue, in_queue) {
+			if (!next->is_taken) {
+				tx = next;
+				break;
+			}
+		}
+		if (tx == NULL) {
+			if (applier->apply_stop)
+				break;
+			fiber_cond_wait(&applier->apply_cond);
+			continue;
+		}
+		tx->is_taken = true;
+		if (applier_tx_apply(applier, tx) != 0 &&
+		    !applier->apply_failed) {
+			/*
+			 * Make the other fibers drop the
+			 * transactions which are not submitted
+			 * yet and stop the reader.
+			 */
+			struct error *e = diag_last_error(diag_get());
+			applier->apply_failed = true;
+			diag_set_error(&replicaset.applier.diag, e);
+			if (!applier->apply_stop) {
+				diag_set_error(&applier->diag, e);
+				fiber_cancel(applier->reader);
+			}
+		}
+		rlist_del_entry(tx, in_queue);
+		applier->apply_queue_len--;
+		free(tx);
+		fiber_cond_broadcast(&applier->apply_cond);
+	}
+	return 0;
+}
+
+/**
+ * Start apply fibers if parallel apply is enabled with
+ * box.cfg.replication_apply_fibers.
+ */
+static void
+applier_apply_start(struct applier *applier)
+{
+	int count = replication_apply_fibers;
+	if (count <= 1)
+		return;
+	assert(applier->apply_fibers == NULL);
+	assert(rlist_empty(&applier->apply_queue));
+	applier->apply_fibers =
+		(struct fiber **)calloc(count, sizeof(struct fiber *));
+	if (applier->apply_fibers == NULL) {
+		tnt_raise(OutOfMemory, count * sizeof(struct fiber *),
+			  "calloc", "apply fibers");
+	}
+	applier->apply_stop = false;
+	applier->apply_failed = false;
+
+	char name[FIBER_NAME_MAX];
+	int pos = snprintf(name, sizeof(name), "appliera/");
+	uri_format(name + pos, sizeof(name) - pos, &applier->uri, false);
+	for (int i = 0; i < count; i++) {
+		struct fiber *f = fiber_new_xc(name, applier_apply_f);
+		fiber_set_joinable(f, true);
+		applier->apply_fibers[applier->apply_fiber_count++] = f;
+		fiber_start(f, applier);
+	}
+}
+
+/**
+ * Wait until apply fibers process all dispatched transactions
+ * and stop them. If @a discard is set, the transactions which
+ * haven't been submitted to WAL yet are dropped.
+ */
+static void
+applier_apply_stop(struct applier *applier, bool discard)
+{
+	if (applier->apply_fibers == NULL)
+		return;
+	if (discard && !rlist_empty(&applier->apply_queue)) {
+		applier->apply_failed = true;
+		if (!diag_is_empty(diag_get())) {
+			diag_set_error(&replicaset.applier.diag,
+				       diag_last_error(diag_get()));
+		}
+	}
+	applier->apply_stop = true;
+	fiber_cond_broadcast(&applier->apply_cond);
+	for (int i = 0; i < applier->apply_fiber_count; i++)
+		fiber_join(applier->apply_fibers[i]);
+	assert(rlist_empty(&applier->apply_queue));
+	free(applier->apply_fibers);
+	applier->apply_fibers = NULL;
+	applier->apply_fiber_count = 0;
+	if (!applier->apply_failed)
+		return;
+	/*
+	 * The applier vclock was promoted when the dropped
+	 * transactions were dispatched. Roll it back to the
+	 * committed one and make all appliers resubscribe, like
+	 * applier_txn_rollback_cb() does.
+	 */
+	wal_sync(NULL);
+	trigger_run(&replicaset.applier.on_rollback, NULL);
+	vclock_copy(&replicaset.applier.vclock, &replicaset.vclock);
+}
+
+/**
+ * Dispatch a transaction to apply fibers.
+ */
+static void
+applier_apply_tx_async(struct applier *applier, struct stailq *rows)
+{
+	while (applier->apply_queue_len >= APPLIER_APPLY_QUEUE_MAX) {
+		fiber_cond_wait(&applier->apply_cond);
+		fiber_testcancel();
+	}
+	struct applier_tx *tx = applier_tx_new(rows);
+	struct latch *latch = applier_tx_latch(&tx->rows);
+	latch_lock(latch);
+	if (applier_skip_applied_rows(&tx->rows)) {
+		latch_unlock(latch);
+		free(tx);
+		return;
+	}
+	/*
+	 * Promote vclock right away so that concurrent appliers
+	 * skip the transaction received by the time it is
+	 * applied.
+	 */
+	struct xrow_header *last_row;
+	last_row = &stailq_last_entry(&tx->rows, struct applier_tx_row,
+				      next)->row;
+	vclock_follow(&replicaset.applier.vclock, last_row->replica_id,
+		      last_row->lsn);
+	latch_unlock(latch);
+
+	applier_tx_collect_keys(tx);
+	rlist_add_tail_entry(&applier->apply_queue, tx, in_queue);
+	applier->apply_queue_len++;
+	fiber_cond_broadcast(&applier->apply_cond);
+}
+
 /**
  * Notify the applier's write fiber that there are more ACKs to
  * send to master.
@@ -1021,8 +1597,11 @@ applier_subscribe(struct applier *applier)
 	 * instance as soon as local WAL starts accepting writes.
 	 */
 	uint32_t id_filter = box_is_orphan() ? 0 : 1 << instance_id;
+	enum compression_type compression = replication_compression;
 	xrow_encode_subscribe_xc(&row, &REPLICASET_UUID, &INSTANCE_UUID,
-				 &vclock, replication_anon, id_filter);
+				 &vclock, replication_anon, id_filter,
+				 compression, replication_spaces,
+				 replication_space_count);
 	coio_write_xrow(coio, &row);
 
 	/* Read SUBSCRIBE response */
@@ -1043,8 +1622,10 @@ applier_subscribe(struct applier *applier)
 		 * its and master's cluster ids match.
 		 */
 		vclock_create(&applier->remote_vclock_at_subscribe);
+		enum compression_type remote_compression;
 		xrow_decode_subscribe_response_xc(&row, &cluster_id,
-					&applier->remote_vclock_at_subscribe);
+					&applier->remote_vclock_at_subscribe,
+					&remote_compression);
 		/*
 		 * If master didn't send us its cluster id
 		 * assume that it has done all the checks.
@@ -1061,6 +1642,21 @@ applier_subscribe(struct applier *applier)
 		say_info("remote vclock %s local vclock %s",
 			 vclock_to_string(&applier->remote_vclock_at_subscribe),
 			 vclock_to_string(&vclock));
+		/*
+		 * Masters which don't support compression of the
+		 * replication stream don't confirm it, and the
+		 * stream stays plain.
+		 */
+		if (remote_compression != COMPRESSION_TYPE_NONE) {
+			if (remote_compression != compression) {
+				tnt_raise(ClientError, ER_PROTOCOL,
+					  "Unexpected compression of the "
+					  "replication stream");
+			}
+			say_info("replication stream is compressed with %s",
+				 compression_type_strs[remote_compression]);
+			applier_zstd_start(applier);
+		}
 	}
 	/*
 	 * Tarantool < 1.6.7:
@@ -1122,6 +1718,8 @@ applier_subscribe(struct applier *applier)
 		trigger_clear(&on_rollback);
 	});
 
+	applier_apply_start(applier);
+
 	/*
 	 * Process a stream of rows from the binary log.
 	 */
@@ -1145,6 +1743,8 @@ applier_subscribe(struct applier *applier)
 		if (stailq_first_entry(&rows, struct applier_tx_row,
 				       next)->row.lsn == 0)
 			applier_signal_ack(applier);
+		else if (applier->apply_fibers != NULL)
+			applier_apply_tx_async(applier, &rows);
 		else if (applier_apply_tx(&rows) != 0)
 			diag_raise();
 
@@ -1158,6 +1758,7 @@ static inline void
 applier_disconnect(struct applier *applier, enum applier_state state)
 {
 	applier_set_state(applier, state);
+	applier_apply_stop(applier, state == APPLIER_STOPPED);
 	if (applier->writer != NULL) {
 		fiber_cancel(applier->writer);
 		fiber_join(applier->writer);
@@ -1167,6 +1768,7 @@ applier_disconnect(struct applier *applier, enum applier_state state)
 	coio_close_io(loop(), &applier->io);
 	/* Clear all unparsed input. */
 	ibuf_reinit(&applier->ibuf);
+	applier_zstd_stop(applier);
 	fiber_gc();
 }
 
@@ -1338,6 +1940,7 @@ applier_new(const char *uri)
 	}
 	coio_create(&applier->io, -1);
 	ibuf_create(&applier->ibuf, &cord()->slabc, 1024);
+	ibuf_create(&applier->zstd_ibuf, &cord()->slabc, 1024);
 
 	/* uri_parse() sets pointers to applier->source buffer */
 	snprintf(applier->source, sizeof(applier->source), "%s", uri);
@@ -1350,6 +1953,8 @@ applier_new(const char *uri)
 	rlist_create(&applier->on_state);
 	fiber_cond_create(&applier->resume_cond);
 	fiber_cond_create(&applier->writer_cond);
+	rlist_create(&applier->apply_queue);
+	fiber_cond_create(&applier->apply_cond);
 	diag_create(&applier->diag);
 
 	return applier;
@@ -1359,7 +1964,10 @@ void
 applier_delete(struct applier *applier)
 {
 	assert(applier->reader == NULL && applier->writer == NULL);
+	assert(applier->apply_fibers == NULL);
 	ibuf_destroy(&applier->ibuf);
+	assert(applier->zstd == NULL);
+	ibuf_destroy(&applier->zstd_ibuf);
 	assert(applier->io.fd == -1);
 	trigger_destroy(&applier->on_state);
 	diag_destroy(&applier->diag);
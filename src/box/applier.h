@@ -36,6 +36,7 @@
 #include <tarantool_ev.h>
 
 #include <small/ibuf.h>
+#include <zstd.h>
 
 #include "fiber_cond.h"
 #include "trigger.h"
@@ -116,6 +117,19 @@ struct applier {
 	struct ev_io io;
 	/** Input buffer */
 	struct ibuf ibuf;
+	/**
+	 * Decompression context if the master agreed to compress
+	 * the replication stream on subscribe, NULL otherwise.
+	 * See replication_compression.
+	 */
+	ZSTD_DStream *zstd;
+	/** Compressed input which is not decompressed yet. */
+	struct ibuf zstd_ibuf;
+	/**
+	 * True if the decompressor may have more output, which
+	 * didn't fit into the input buffer.
+	 */
+	bool zstd_has_output;
 	/** Triggers invoked on state change */
 	struct rlist on_state;
 	/**
@@ -129,6 +143,30 @@ struct applier {
 	struct diag diag;
 	/* Master's vclock at the time of SUBSCRIBE. */
 	struct vclock remote_vclock_at_subscribe;
+	/**
+	 * Fibers applying transactions in parallel or NULL if
+	 * transactions are applied by the reader fiber itself,
+	 * see replication_apply_fibers.
+	 */
+	struct fiber **apply_fibers;
+	/** Number of fibers in apply_fibers array. */
+	int apply_fiber_count;
+	/**
+	 * Transactions dispatched to apply fibers and not
+	 * submitted to WAL yet, in the order of arrival.
+	 */
+	struct rlist apply_queue;
+	/** Length of apply_queue. */
+	int apply_queue_len;
+	/** Signaled when apply_queue changes. */
+	struct fiber_cond apply_cond;
+	/** Set to stop apply fibers once apply_queue is empty. */
+	bool apply_stop;
+	/**
+	 * Set if a transaction failed to apply, so the rest of
+	 * apply_queue is dropped.
+	 */
+	bool apply_failed;
 };
 
 /**
@@ -0,0 +1,746 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "arrow.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+#include "msgpuck.h"
+#include "trivia/util.h"
+#include "tt_static.h"
+
+#include "errcode.h"
+#include "field_def.h"
+
+/**
+ * Variable size values of a batch are addressed with 32-bit
+ * offsets, so a batch is encoded before its data gets close
+ * to the limit. A single value can't exceed it because tuple
+ * size is limited.
+ */
+enum { ARROW_BATCH_DATA_MAX = 1 << 30 };
+
+/* Constants of the Arrow format, see Schema.fbs and Message.fbs. */
+enum {
+	ARROW_METADATA_V5 = 4,
+	ARROW_HEADER_SCHEMA = 1,
+	ARROW_HEADER_RECORD_BATCH = 3,
+	ARROW_FB_INT = 2,
+	ARROW_FB_FLOATING_POINT = 3,
+	ARROW_FB_BINARY = 4,
+	ARROW_FB_UTF8 = 5,
+	ARROW_FB_BOOL = 6,
+	ARROW_PRECISION_DOUBLE = 2,
+	ARROW_CONTINUATION = 0xffffffff,
+};
+
+/**
+ * Allocate @a size zeroed bytes at the end of a buffer.
+ * Returns the offset of the allocated bytes or -1 and sets
+ * diag. Offsets are used instead of pointers because the
+ * buffer may be reallocated.
+ */
+static ssize_t
+arrow_buf_alloc(struct arrow_buf *buf, size_t size)
+{
+	if (buf->size + size > buf->capacity) {
+		size_t capacity = MAX(buf->capacity * 2, (size_t)4096);
+		while (capacity < buf->size + size)
+			capacity *= 2;
+		char *data = realloc(buf->data, capacity);
+		if (data == NULL) {
+			diag_set(OutOfMemory, capacity, "realloc",
+				 "arrow buffer");
+			return -1;
+		}
+		buf->data = data;
+		buf->capacity = capacity;
+	}
+	ssize_t pos = buf->size;
+	memset(buf->data + pos, 0, size);
+	buf->size += size;
+	return pos;
+}
+
+static int
+arrow_buf_append(struct arrow_buf *buf, const void *data, size_t size)
+{
+	ssize_t pos = arrow_buf_alloc(buf, size);
+	if (pos < 0)
+		return -1;
+	memcpy(buf->data + pos, data, size);
+	return 0;
+}
+
+/** Pad a buffer with zeros to a multiple of @a align. */
+static int
+arrow_buf_pad(struct arrow_buf *buf, size_t align)
+{
+	size_t size = buf->size % align;
+	if (size == 0)
+		return 0;
+	return arrow_buf_alloc(buf, align - size) < 0 ? -1 : 0;
+}
+
+static void
+arrow_buf_destroy(struct arrow_buf *buf)
+{
+	free(buf->data);
+}
+
+/**
+ * Flatbuffers are built front to back: a table is preceded by
+ * its vtable and followed by the objects it refers to, whose
+ * offsets are patched when they are written. Scalars are laid
+ * out in the natural alignment, which holds as long as the
+ * buffer itself is 8-byte aligned. The host is assumed to be
+ * little-endian, as required by flatbuffers and Arrow.
+ */
+static void
+fb_store(struct arrow_buf *fb, size_t pos, const void *value, size_t size)
+{
+	assert(pos + size <= fb->size);
+	memcpy(fb->data + pos, value, size);
+}
+
+/** Store the offset of the object at @a target at @a pos. */
+static void
+fb_store_offset(struct arrow_buf *fb, size_t pos, size_t target)
+{
+	assert(target > pos);
+	uint32_t offset = target - pos;
+	fb_store(fb, pos, &offset, sizeof(offset));
+}
+
+/**
+ * Write a table with fields of the given sizes. A field of zero
+ * size is absent. Positions of the fields are returned in @a pos
+ * to be filled by the caller. Returns the position of the table
+ * or -1 and sets diag.
+ */
+static ssize_t
+fb_table(struct arrow_buf *fb, const uint8_t *sizes, int field_count,
+	 size_t *pos)
+{
+	uint16_t vtable[8];
+	assert(field_count + 2 <= (int)lengthof(vtable));
+	size_t vtable_size = (field_count + 2) * sizeof(uint16_t);
+	if (arrow_buf_pad(fb, sizeof(uint16_t)) != 0)
+		return -1;
+	ssize_t vtable_pos = arrow_buf_alloc(fb, vtable_size);
+	if (vtable_pos < 0 || arrow_buf_pad(fb, sizeof(uint64_t)) != 0)
+		return -1;
+	size_t table_pos = fb->size;
+	/* The table starts with the offset of its vtable. */
+	uint16_t table_size = sizeof(int32_t);
+	for (int i = 0; i < field_count; i++) {
+		if (sizes[i] == 0) {
+			vtable[i + 2] = 0;
+			continue;
+		}
+		table_size = (table_size + sizes[i] - 1) / sizes[i] * sizes[i];
+		vtable[i + 2] = table_size;
+		pos[i] = table_pos + table_size;
+		table_size += sizes[i];
+	}
+	vtable[0] = vtable_size;
+	vtable[1] = table_size;
+	if (arrow_buf_alloc(fb, table_size) < 0)
+		return -1;
+	fb_store(fb, vtable_pos, vtable, vtable_size);
+	int32_t vtable_offset = table_pos - vtable_pos;
+	fb_store(fb, table_pos, &vtable_offset, sizeof(vtable_offset));
+	return table_pos;
+}
+
+/**
+ * Write a vector of @a count elements of @a elem_size bytes
+ * aligned to @a align, to be filled by the caller. Returns the
+ * position of the vector, the elements follow its 4-byte length.
+ */
+static ssize_t
+fb_vector(struct arrow_buf *fb, uint32_t count, size_t elem_size,
+	  size_t align)
+{
+	align = MAX(align, sizeof(uint32_t));
+	while ((fb->size + sizeof(uint32_t)) % align != 0) {
+		if (arrow_buf_alloc(fb, 1) < 0)
+			return -1;
+	}
+	ssize_t pos = arrow_buf_alloc(fb, sizeof(uint32_t) +
+				      count * elem_size);
+	if (pos < 0)
+		return -1;
+	fb_store(fb, pos, &count, sizeof(count));
+	return pos;
+}
+
+/** Write a zero-terminated string, return its position. */
+static ssize_t
+fb_string(struct arrow_buf *fb, const char *str)
+{
+	uint32_t len = strlen(str);
+	ssize_t pos = fb_vector(fb, len + 1, 1, 1);
+	if (pos < 0)
+		return -1;
+	fb_store(fb, pos, &len, sizeof(len));
+	fb_store(fb, pos + sizeof(len), str, len);
+	return pos;
+}
+
+/**
+ * Write the header of a Message table referring to a union
+ * value written next. Returns the position of the header
+ * offset to patch or -1.
+ */
+static ssize_t
+arrow_message_begin(struct arrow_buf *fb, uint8_t header_type,
+		    int64_t body_length)
+{
+	fb->size = 0;
+	/* Root offset. */
+	if (arrow_buf_alloc(fb, sizeof(uint32_t)) < 0)
+		return -1;
+	/* version, header_type, header, bodyLength. */
+	static const uint8_t sizes[] = {2, 1, 4, 8};
+	size_t pos[lengthof(sizes)];
+	ssize_t table = fb_table(fb, sizes, lengthof(sizes), pos);
+	if (table < 0)
+		return -1;
+	fb_store_offset(fb, 0, table);
+	int16_t version = ARROW_METADATA_V5;
+	fb_store(fb, pos[0], &version, sizeof(version));
+	fb_store(fb, pos[1], &header_type, sizeof(header_type));
+	fb_store(fb, pos[3], &body_length, sizeof(body_length));
+	return pos[2];
+}
+
+/**
+ * Append an encapsulated message with the metadata built in
+ * @a writer->meta to the output, the body is appended by the
+ * caller.
+ */
+static int
+arrow_message_end(struct arrow_writer *writer)
+{
+	if (arrow_buf_pad(&writer->meta, 8) != 0)
+		return -1;
+	uint32_t prefix[2] = {ARROW_CONTINUATION, writer->meta.size};
+	if (arrow_buf_append(&writer->out, prefix, sizeof(prefix)) != 0 ||
+	    arrow_buf_append(&writer->out, writer->meta.data,
+			     writer->meta.size) != 0)
+		return -1;
+	return 0;
+}
+
+/** Write the Type union value of a column, return its position. */
+static ssize_t
+arrow_write_type(struct arrow_buf *fb, enum arrow_type type)
+{
+	size_t pos[2];
+	ssize_t table;
+	switch (type) {
+	case ARROW_TYPE_INT64:
+	case ARROW_TYPE_UINT64: {
+		/* bitWidth, is_signed. */
+		static const uint8_t sizes[] = {4, 1};
+		table = fb_table(fb, sizes, lengthof(sizes), pos);
+		if (table < 0)
+			return -1;
+		int32_t bit_width = 64;
+		uint8_t is_signed = type == ARROW_TYPE_INT64;
+		fb_store(fb, pos[0], &bit_width, sizeof(bit_width));
+		fb_store(fb, pos[1], &is_signed, sizeof(is_signed));
+		return table;
+	}
+	case ARROW_TYPE_DOUBLE: {
+		/* precision. */
+		static const uint8_t sizes[] = {2};
+		table = fb_table(fb, sizes, lengthof(sizes), pos);
+		if (table < 0)
+			return -1;
+		int16_t precision = ARROW_PRECISION_DOUBLE;
+		fb_store(fb, pos[0], &precision, sizeof(precision));
+		return table;
+	}
+	default:
+		/* Bool, Utf8 and Binary tables have no fields. */
+		return fb_table(fb, NULL, 0, pos);
+	}
+}
+
+static uint8_t
+arrow_type_union_type(enum arrow_type type)
+{
+	switch (type) {
+	case ARROW_TYPE_INT64:
+	case ARROW_TYPE_UINT64:
+		return ARROW_FB_INT;
+	case ARROW_TYPE_DOUBLE:
+		return ARROW_FB_FLOATING_POINT;
+	case ARROW_TYPE_BOOL:
+		return ARROW_FB_BOOL;
+	case ARROW_TYPE_UTF8:
+		return ARROW_FB_UTF8;
+	case ARROW_TYPE_BINARY:
+		return ARROW_FB_BINARY;
+	}
+	unreachable();
+	return 0;
+}
+
+/** Append the schema message to the output. */
+static int
+arrow_write_schema(struct arrow_writer *writer)
+{
+	struct arrow_buf *fb = &writer->meta;
+	ssize_t header = arrow_message_begin(fb, ARROW_HEADER_SCHEMA, 0);
+	if (header < 0)
+		return -1;
+	/* endianness (little is default), fields. */
+	static const uint8_t schema_sizes[] = {0, 4};
+	size_t schema_pos[lengthof(schema_sizes)];
+	ssize_t schema = fb_table(fb, schema_sizes, lengthof(schema_sizes),
+				  schema_pos);
+	if (schema < 0)
+		return -1;
+	fb_store_offset(fb, header, schema);
+	ssize_t fields = fb_vector(fb, writer->column_count,
+				   sizeof(uint32_t), sizeof(uint32_t));
+	if (fields < 0)
+		return -1;
+	fb_store_offset(fb, schema_pos[1], fields);
+	for (uint32_t i = 0; i < writer->column_count; i++) {
+		struct arrow_column *column = &writer->columns[i];
+		/* name, nullable, type_type, type, dictionary, children. */
+		static const uint8_t sizes[] = {4, 1, 1, 4, 0, 4};
+		size_t pos[lengthof(sizes)];
+		ssize_t field = fb_table(fb, sizes, lengthof(sizes), pos);
+		if (field < 0)
+			return -1;
+		fb_store_offset(fb, fields + sizeof(uint32_t) * (i + 1),
+				field);
+		uint8_t nullable = 1;
+		uint8_t type_type = arrow_type_union_type(column->type);
+		fb_store(fb, pos[1], &nullable, sizeof(nullable));
+		fb_store(fb, pos[2], &type_type, sizeof(type_type));
+		ssize_t name = fb_string(fb, column->name);
+		if (name < 0)
+			return -1;
+		fb_store_offset(fb, pos[0], name);
+		ssize_t type = arrow_write_type(fb, column->type);
+		if (type < 0)
+			return -1;
+		fb_store_offset(fb, pos[3], type);
+		ssize_t children = fb_vector(fb, 0, sizeof(uint32_t),
+					     sizeof(uint32_t));
+		if (children < 0)
+			return -1;
+		fb_store_offset(fb, pos[5], children);
+	}
+	return arrow_message_end(writer);
+}
+
+/** Number of Arrow buffers of a column. */
+static int
+arrow_column_buffer_count(struct arrow_column *column)
+{
+	return column->type == ARROW_TYPE_UTF8 ||
+	       column->type == ARROW_TYPE_BINARY ? 3 : 2;
+}
+
+/** Get the i-th Arrow buffer of a column. */
+static struct arrow_buf *
+arrow_column_buffer(struct arrow_column *column, int i)
+{
+	switch (i) {
+	case 0:
+		return &column->validity;
+	case 1:
+		return arrow_column_buffer_count(column) == 3 ?
+		       &column->offsets : &column->values;
+	default:
+		return &column->values;
+	}
+}
+
+/** Prepare a column for a new record batch. */
+static int
+arrow_column_reset(struct arrow_column *column)
+{
+	column->validity.size = 0;
+	column->values.size = 0;
+	column->offsets.size = 0;
+	column->null_count = 0;
+	if (arrow_column_buffer_count(column) == 3) {
+		int32_t offset = 0;
+		return arrow_buf_append(&column->offsets, &offset,
+					sizeof(offset));
+	}
+	return 0;
+}
+
+/** Set the bit of a row in a bitmap, growing it if needed. */
+static int
+arrow_bitmap_set(struct arrow_buf *bitmap, uint32_t row, bool value)
+{
+	if (bitmap->size <= row / 8 && arrow_buf_alloc(bitmap, 1) < 0)
+		return -1;
+	if (value)
+		bitmap->data[row / 8] |= 1 << (row % 8);
+	return 0;
+}
+
+int
+arrow_writer_flush(struct arrow_writer *writer)
+{
+	uint32_t row_count = writer->row_count;
+	if (row_count == 0)
+		return 0;
+	/* Bitmaps must cover all rows, even if trailing bits are 0. */
+	uint32_t buffer_count = 0;
+	int64_t body_length = 0;
+	for (uint32_t i = 0; i < writer->column_count; i++) {
+		struct arrow_column *column = &writer->columns[i];
+		size_t bitmap_size = (row_count + 7) / 8;
+		if (arrow_buf_alloc(&column->validity, bitmap_size -
+				    column->validity.size) < 0)
+			return -1;
+		if (column->type == ARROW_TYPE_BOOL &&
+		    arrow_buf_alloc(&column->values, bitmap_size -
+				    column->values.size) < 0)
+			return -1;
+		int count = arrow_column_buffer_count(column);
+		for (int j = 0; j < count; j++) {
+			size_t size = arrow_column_buffer(column, j)->size;
+			body_length += (size + 7) / 8 * 8;
+		}
+		buffer_count += count;
+	}
+	struct arrow_buf *fb = &writer->meta;
+	ssize_t header = arrow_message_begin(fb, ARROW_HEADER_RECORD_BATCH,
+					     body_length);
+	if (header < 0)
+		return -1;
+	/* length, nodes, buffers. */
+	static const uint8_t sizes[] = {8, 4, 4};
+	size_t pos[lengthof(sizes)];
+	ssize_t batch = fb_table(fb, sizes, lengthof(sizes), pos);
+	if (batch < 0)
+		return -1;
+	fb_store_offset(fb, header, batch);
+	int64_t length = row_count;
+	fb_store(fb, pos[0], &length, sizeof(length));
+	/* Vectors of FieldNode and Buffer structs of two longs. */
+	ssize_t nodes = fb_vector(fb, writer->column_count,
+				  2 * sizeof(int64_t), sizeof(int64_t));
+	if (nodes < 0)
+		return -1;
+	fb_store_offset(fb, pos[1], nodes);
+	ssize_t buffers = fb_vector(fb, buffer_count, 2 * sizeof(int64_t),
+				    sizeof(int64_t));
+	if (buffers < 0)
+		return -1;
+	fb_store_offset(fb, pos[2], buffers);
+	size_t node_pos = nodes + sizeof(uint32_t);
+	size_t buffer_pos = buffers + sizeof(uint32_t);
+	int64_t offset = 0;
+	for (uint32_t i = 0; i < writer->column_count; i++) {
+		struct arrow_column *column = &writer->columns[i];
+		int64_t node[2] = {row_count, column->null_count};
+		fb_store(fb, node_pos, node, sizeof(node));
+		node_pos += sizeof(node);
+		int count = arrow_column_buffer_count(column);
+		for (int j = 0; j < count; j++) {
+			int64_t size = arrow_column_buffer(column, j)->size;
+			int64_t buffer[2] = {offset, size};
+			fb_store(fb, buffer_pos, buffer, sizeof(buffer));
+			buffer_pos += sizeof(buffer);
+			offset += (size + 7) / 8 * 8;
+		}
+	}
+	if (arrow_message_end(writer) != 0)
+		return -1;
+	for (uint32_t i = 0; i < writer->column_count; i++) {
+		struct arrow_column *column = &writer->columns[i];
+		int count = arrow_column_buffer_count(column);
+		for (int j = 0; j < count; j++) {
+			struct arrow_buf *buf = arrow_column_buffer(column, j);
+			if (arrow_buf_append(&writer->out, buf->data,
+					     buf->size) != 0 ||
+			    arrow_buf_pad(&writer->out, 8) != 0)
+				return -1;
+		}
+		if (arrow_column_reset(column) != 0)
+			return -1;
+	}
+	writer->row_count = 0;
+	return 0;
+}
+
+int
+arrow_writer_finish(struct arrow_writer *writer)
+{
+	if (arrow_writer_flush(writer) != 0)
+		return -1;
+	uint32_t eos[2] = {ARROW_CONTINUATION, 0};
+	return arrow_buf_append(&writer->out, eos, sizeof(eos));
+}
+
+/** Map a field type to an Arrow type. Returns -1 if unsupported. */
+static int
+arrow_type_by_field_type(enum field_type type)
+{
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return ARROW_TYPE_UINT64;
+	case FIELD_TYPE_INTEGER:
+		return ARROW_TYPE_INT64;
+	case FIELD_TYPE_NUMBER:
+	case FIELD_TYPE_DOUBLE:
+		return ARROW_TYPE_DOUBLE;
+	case FIELD_TYPE_BOOLEAN:
+		return ARROW_TYPE_BOOL;
+	case FIELD_TYPE_STRING:
+		return ARROW_TYPE_UTF8;
+	case FIELD_TYPE_VARBINARY:
+		return ARROW_TYPE_BINARY;
+	default:
+		return -1;
+	}
+}
+
+struct arrow_writer *
+arrow_writer_new(const struct field_def *fields, const uint32_t *fieldnos,
+		 uint32_t column_count, uint32_t batch_size)
+{
+	assert(batch_size > 0);
+	struct arrow_writer *writer = calloc(1, sizeof(*writer));
+	if (writer == NULL) {
+		diag_set(OutOfMemory, sizeof(*writer), "calloc",
+			 "struct arrow_writer");
+		return NULL;
+	}
+	writer->batch_size = batch_size;
+	writer->columns = calloc(column_count, sizeof(*writer->columns));
+	if (writer->columns == NULL && column_count > 0) {
+		diag_set(OutOfMemory, column_count * sizeof(*writer->columns),
+			 "calloc", "struct arrow_column");
+		goto fail;
+	}
+	for (uint32_t i = 0; i < column_count; i++) {
+		const struct field_def *field = &fields[fieldnos[i]];
+		int type = arrow_type_by_field_type(field->type);
+		if (type < 0) {
+			diag_set(ClientError, ER_UNSUPPORTED, "Arrow export",
+				 tt_sprintf("field type '%s'",
+					    field_type_strs[field->type]));
+			goto fail;
+		}
+		struct arrow_column *column = &writer->columns[i];
+		writer->column_count++;
+		column->name = strdup(field->name);
+		if (column->name == NULL) {
+			diag_set(OutOfMemory, strlen(field->name) + 1,
+				 "strdup", "column name");
+			goto fail;
+		}
+		column->fieldno = fieldnos[i];
+		column->type = type;
+		if (arrow_column_reset(column) != 0)
+			goto fail;
+		writer->field_count = MAX(writer->field_count,
+					  fieldnos[i] + 1);
+	}
+	writer->fields = calloc(writer->field_count, sizeof(*writer->fields));
+	if (writer->fields == NULL && writer->field_count > 0) {
+		diag_set(OutOfMemory,
+			 writer->field_count * sizeof(*writer->fields),
+			 "calloc", "tuple fields");
+		goto fail;
+	}
+	if (arrow_write_schema(writer) != 0)
+		goto fail;
+	return writer;
+fail:
+	arrow_writer_delete(writer);
+	return NULL;
+}
+
+void
+arrow_writer_delete(struct arrow_writer *writer)
+{
+	for (uint32_t i = 0; i < writer->column_count; i++) {
+		struct arrow_column *column = &writer->columns[i];
+		free(column->name);
+		arrow_buf_destroy(&column->validity);
+		arrow_buf_destroy(&column->values);
+		arrow_buf_destroy(&column->offsets);
+	}
+	free(writer->columns);
+	free(writer->fields);
+	arrow_buf_destroy(&writer->meta);
+	arrow_buf_destroy(&writer->out);
+	free(writer);
+}
+
+/** Names of field types compatible with Arrow types. */
+static const char *arrow_type_expected[] = {
+	/* [ARROW_TYPE_INT64]	= */ "integer",
+	/* [ARROW_TYPE_UINT64]	= */ "unsigned",
+	/* [ARROW_TYPE_DOUBLE]	= */ "number",
+	/* [ARROW_TYPE_BOOL]	= */ "boolean",
+	/* [ARROW_TYPE_UTF8]	= */ "string",
+	/* [ARROW_TYPE_BINARY]	= */ "varbinary",
+};
+
+/**
+ * Append a value to a column. @a value is NULL if the field
+ * is missing.
+ */
+static int
+arrow_column_add(struct arrow_column *column, uint32_t row,
+		 const char *value)
+{
+	if (value == NULL || mp_typeof(*value) == MP_NIL) {
+		column->null_count++;
+		if (arrow_bitmap_set(&column->validity, row, false) != 0)
+			return -1;
+		switch (column->type) {
+		case ARROW_TYPE_BOOL:
+			return arrow_bitmap_set(&column->values, row, false);
+		case ARROW_TYPE_UTF8:
+		case ARROW_TYPE_BINARY:
+			return arrow_buf_append(&column->offsets,
+				column->offsets.data +
+				column->offsets.size - sizeof(int32_t),
+				sizeof(int32_t));
+		default:
+			return arrow_buf_alloc(&column->values,
+					       sizeof(uint64_t)) < 0 ? -1 : 0;
+		}
+	}
+	if (arrow_bitmap_set(&column->validity, row, true) != 0)
+		return -1;
+	enum mp_type mp_type = mp_typeof(*value);
+	switch (column->type) {
+	case ARROW_TYPE_UINT64: {
+		if (mp_type != MP_UINT)
+			break;
+		uint64_t v = mp_decode_uint(&value);
+		return arrow_buf_append(&column->values, &v, sizeof(v));
+	}
+	case ARROW_TYPE_INT64: {
+		int64_t v;
+		if (mp_type == MP_INT) {
+			v = mp_decode_int(&value);
+		} else if (mp_type == MP_UINT) {
+			uint64_t u = mp_decode_uint(&value);
+			if (u > INT64_MAX)
+				break;
+			v = u;
+		} else {
+			break;
+		}
+		return arrow_buf_append(&column->values, &v, sizeof(v));
+	}
+	case ARROW_TYPE_DOUBLE: {
+		double v;
+		if (mp_type == MP_UINT)
+			v = mp_decode_uint(&value);
+		else if (mp_type == MP_INT)
+			v = mp_decode_int(&value);
+		else if (mp_type == MP_FLOAT)
+			v = mp_decode_float(&value);
+		else if (mp_type == MP_DOUBLE)
+			v = mp_decode_double(&value);
+		else
+			break;
+		return arrow_buf_append(&column->values, &v, sizeof(v));
+	}
+	case ARROW_TYPE_BOOL:
+		if (mp_type != MP_BOOL)
+			break;
+		return arrow_bitmap_set(&column->values, row,
+					mp_decode_bool(&value));
+	case ARROW_TYPE_UTF8:
+	case ARROW_TYPE_BINARY: {
+		uint32_t len;
+		const char *str;
+		if (column->type == ARROW_TYPE_UTF8 && mp_type == MP_STR)
+			str = mp_decode_str(&value, &len);
+		else if (column->type == ARROW_TYPE_BINARY &&
+			 mp_type == MP_BIN)
+			str = mp_decode_bin(&value, &len);
+		else
+			break;
+		int32_t offset = column->values.size + len;
+		if (arrow_buf_append(&column->values, str, len) != 0)
+			return -1;
+		return arrow_buf_append(&column->offsets, &offset,
+					sizeof(offset));
+	}
+	}
+	diag_set(ClientError, ER_FIELD_TYPE,
+		 tt_sprintf("'%s'", column->name),
+		 arrow_type_expected[column->type]);
+	return -1;
+}
+
+int
+arrow_writer_add(struct arrow_writer *writer, const char *data)
+{
+	uint32_t field_count = mp_decode_array(&data);
+	for (uint32_t i = 0; i < writer->field_count; i++) {
+		if (i < field_count) {
+			writer->fields[i] = data;
+			mp_next(&data);
+		} else {
+			writer->fields[i] = NULL;
+		}
+	}
+	bool is_batch_full = ++writer->row_count >= writer->batch_size;
+	for (uint32_t i = 0; i < writer->column_count; i++) {
+		struct arrow_column *column = &writer->columns[i];
+		if (arrow_column_add(column, writer->row_count - 1,
+				     writer->fields[column->fieldno]) != 0) {
+			/* Drop the partially added batch. */
+			for (uint32_t j = 0; j < writer->column_count; j++)
+				(void)arrow_column_reset(&writer->columns[j]);
+			writer->row_count = 0;
+			return -1;
+		}
+		if (column->values.size >= ARROW_BATCH_DATA_MAX)
+			is_batch_full = true;
+	}
+	return is_batch_full ? arrow_writer_flush(writer) : 0;
+}
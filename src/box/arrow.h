@@ -0,0 +1,165 @@
+#ifndef TARANTOOL_BOX_ARROW_H_INCLUDED
+#define TARANTOOL_BOX_ARROW_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct field_def;
+
+/** Growable memory buffer used by the Arrow writer. */
+struct arrow_buf {
+	/** Buffer data. */
+	char *data;
+	/** Number of used bytes. */
+	size_t size;
+	/** Number of allocated bytes. */
+	size_t capacity;
+};
+
+/** Arrow data types tuple fields are converted to. */
+enum arrow_type {
+	ARROW_TYPE_INT64,
+	ARROW_TYPE_UINT64,
+	ARROW_TYPE_DOUBLE,
+	ARROW_TYPE_BOOL,
+	ARROW_TYPE_UTF8,
+	ARROW_TYPE_BINARY,
+};
+
+/** A column of a record batch being built. */
+struct arrow_column {
+	/** Column name, the same as the field name. */
+	char *name;
+	/** Zero-based number of the tuple field. */
+	uint32_t fieldno;
+	/** Arrow type of the column. */
+	enum arrow_type type;
+	/** Validity bitmap, a bit is set for each non-null value. */
+	struct arrow_buf validity;
+	/** Fixed size values or bitmap or variable size data. */
+	struct arrow_buf values;
+	/** Offsets of variable size values in @a values. */
+	struct arrow_buf offsets;
+	/** Number of null values in the batch. */
+	uint64_t null_count;
+};
+
+/**
+ * Converter of tuples to the Apache Arrow IPC streaming format.
+ *
+ * Tuple fields are converted to columns according to the types
+ * of the space format: unsigned, integer, number, double,
+ * boolean, string and varbinary fields are supported. Missing
+ * and nil values are stored as nulls.
+ *
+ * Tuples are accumulated in a record batch, which is encoded to
+ * the output buffer once it is full. The schema message is
+ * written on creation and the end-of-stream marker by
+ * arrow_writer_finish(), so the output is a complete Arrow
+ * stream, which the caller drains with arrow_writer_output().
+ *
+ * The writer doesn't use thread-local allocators so it may be
+ * used in any thread, one at a time.
+ */
+struct arrow_writer {
+	/** Columns of the stream. */
+	struct arrow_column *columns;
+	/** Number of columns. */
+	uint32_t column_count;
+	/** Number of rows in the current record batch. */
+	uint32_t row_count;
+	/** Max number of rows in a record batch. */
+	uint32_t batch_size;
+	/** Positions of tuple fields, used while adding a tuple. */
+	const char **fields;
+	/** Size of @a fields, max column field number + 1. */
+	uint32_t field_count;
+	/** Flatbuffer with the metadata of a message. */
+	struct arrow_buf meta;
+	/** Encoded stream not consumed yet. */
+	struct arrow_buf out;
+};
+
+/**
+ * Create an Arrow writer with the columns for the given fields
+ * of a space format. Returns NULL and sets diag if the type of
+ * a field is not supported.
+ */
+struct arrow_writer *
+arrow_writer_new(const struct field_def *fields, const uint32_t *fieldnos,
+		 uint32_t column_count, uint32_t batch_size);
+
+/** Free an Arrow writer. */
+void
+arrow_writer_delete(struct arrow_writer *writer);
+
+/**
+ * Append a tuple given as a MsgPack array to the current record
+ * batch, encoding the batch if it's full. Returns -1 and sets
+ * diag if a value doesn't match the column type.
+ */
+int
+arrow_writer_add(struct arrow_writer *writer, const char *data);
+
+/** Encode the current record batch, if it isn't empty. */
+int
+arrow_writer_flush(struct arrow_writer *writer);
+
+/** Encode the current batch and the end-of-stream marker. */
+int
+arrow_writer_finish(struct arrow_writer *writer);
+
+/** Get the encoded data not consumed yet. */
+static inline const char *
+arrow_writer_output(struct arrow_writer *writer, size_t *size)
+{
+	*size = writer->out.size;
+	return writer->out.data;
+}
+
+/** Discard the data returned by arrow_writer_output(). */
+static inline void
+arrow_writer_consume(struct arrow_writer *writer)
+{
+	writer->out.size = 0;
+}
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_ARROW_H_INCLUDED */
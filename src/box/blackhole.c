@@ -109,10 +109,12 @@ blackhole_space_create_index(struct space *space, struct index_def *def)
 static const struct space_vtab blackhole_space_vtab = {
 	/* .destroy = */ blackhole_space_destroy,
 	/* .bsize = */ generic_space_bsize,
+	/* .tuple_mem = */ generic_space_tuple_mem,
 	/* .execute_replace = */ blackhole_space_execute_replace,
 	/* .execute_delete = */ blackhole_space_execute_delete,
 	/* .execute_update = */ blackhole_space_execute_update,
 	/* .execute_upsert = */ blackhole_space_execute_upsert,
+	/* .execute_delete_range = */ generic_space_execute_delete_range,
 	/* .ephemeral_replace = */ generic_space_ephemeral_replace,
 	/* .ephemeral_delete = */ generic_space_ephemeral_delete,
 	/* .ephemeral_rowid_next = */ generic_space_ephemeral_rowid_next,
@@ -156,7 +158,7 @@ blackhole_engine_create_space(struct engine *engine, struct space_def *def,
 	format = tuple_format_new(&tuple_format_runtime->vtab, NULL, NULL, 0,
 				  def->fields, def->field_count,
 				  def->exact_field_count, def->dict, false,
-				  false);
+				  false, true);
 	if (format == NULL) {
 		free(space);
 		return NULL;
@@ -44,30 +44,38 @@
 #include "relay.h"
 #include "applier.h"
 #include <rmean.h>
+#include "clock.h"
 #include "main.h"
 #include "tuple.h"
 #include "tuple_format.h"
+#include "tuple_compression.h"
 #include "session.h"
 #include "schema.h"
 #include "engine.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "read_view.h"
+#include "box/lua/func_worker.h"
 #include "sysview.h"
 #include "blackhole.h"
 #include "service_engine.h"
 #include "vinyl.h"
 #include "space.h"
 #include "index.h"
+#include "assoc.h"
 #include "port.h"
 #include "txn.h"
 #include "txn_limbo.h"
 #include "user.h"
 #include "cfg.h"
 #include "coio.h"
+#include "coio_task.h"
 #include "replication.h" /* replica */
 #include "title.h"
 #include "xrow.h"
 #include "xrow_io.h"
 #include "xstream.h"
+#include "xlog.h"
 #include "authentication.h"
 #include "path_lock.h"
 #include "gc.h"
@@ -79,6 +87,7 @@
 #include "sql_stmt_cache.h"
 #include "msgpack.h"
 #include "trivia/util.h"
+#include "numa.h"
 
 static char status[64] = "unknown";
 
@@ -183,7 +192,8 @@ box_process_rw(struct request *request, struct space *space,
 	if (is_autocommit && (txn = txn_begin()) == NULL)
 		return -1;
 	assert(iproto_type_is_dml(request->type));
-	rmean_collect(rmean_box, request->type, 1);
+	rmean_collect(rmean_box, request->type != IPROTO_DELETE_RANGE ?
+		      request->type : IPROTO_DELETE, 1);
 	if (access_check_space(space, PRIV_W) != 0)
 		goto rollback;
 	if (txn_begin_stmt(txn, space) != 0)
@@ -192,6 +202,14 @@ box_process_rw(struct request *request, struct space *space,
 		txn_rollback_stmt(txn);
 		goto rollback;
 	}
+	if (result != NULL && tuple != NULL) {
+		/* Never return compressed fields to the user. */
+		tuple = tuple_decompress(tuple);
+		if (tuple == NULL) {
+			txn_rollback_stmt(txn);
+			goto rollback;
+		}
+	}
 	if (result != NULL)
 		*result = tuple;
 
@@ -320,6 +338,8 @@ struct wal_stream {
 	struct xstream base;
 	/** How many rows have been recovered so far. */
 	size_t rows;
+	/** Approximate size of the rows recovered so far. */
+	size_t bytes;
 };
 
 /**
@@ -395,6 +415,7 @@ apply_wal_row(struct xstream *stream, struct xrow_header *row)
 	}
 	struct wal_stream *xstream =
 		container_of(stream, struct wal_stream, base);
+	xstream->bytes += xrow_approx_len(row);
 	/**
 	 * Yield once in a while, but not too often,
 	 * mostly to allow signal handling to take place.
@@ -408,6 +429,7 @@ wal_stream_create(struct wal_stream *ctx)
 {
 	xstream_create(&ctx->base, apply_wal_row);
 	ctx->rows = 0;
+	ctx->bytes = 0;
 }
 
 /* {{{ configuration bindings */
@@ -438,10 +460,11 @@ box_check_say(void)
 	enum say_format format = say_format_by_name(log_format);
 	if (format == say_format_MAX)
 		tnt_raise(ClientError, ER_CFG, "log_format",
-			 "expected 'plain' or 'json'");
-	if (type == SAY_LOGGER_SYSLOG && format == SF_JSON) {
+			 "expected 'plain', 'json' or 'binary'");
+	if (type == SAY_LOGGER_SYSLOG && format != SF_PLAIN) {
 		tnt_raise(ClientError, ER_CFG, "log_format",
-			  "'json' can't be used with syslog logger");
+			  tt_sprintf("'%s' can't be used with syslog logger",
+				     log_format));
 	}
 	int log_nonblock = cfg_getb("log_nonblock");
 	if (log_nonblock == 1 &&
@@ -556,6 +579,78 @@ box_check_replication_sync_timeout(void)
 	return timeout;
 }
 
+static int
+box_check_replication_apply_fibers(void)
+{
+	int count = cfg_geti("replication_apply_fibers");
+	if (count <= 0) {
+		tnt_raise(ClientError, ER_CFG, "replication_apply_fibers",
+			  "must be greater than or equal to 1");
+	}
+	return count;
+}
+
+static int
+box_check_worker_pool_threads(const char *option)
+{
+	int count = cfg_geti(option);
+	if (count <= 0) {
+		tnt_raise(ClientError, ER_CFG, option,
+			  "must be greater than or equal to 1");
+	}
+	return count;
+}
+
+static double
+box_check_dns_cache_ttl(void)
+{
+	double ttl = cfg_getd("dns_cache_ttl");
+	if (ttl < 0) {
+		tnt_raise(ClientError, ER_CFG, "dns_cache_ttl",
+			  "must be greater than or equal to 0");
+	}
+	return ttl;
+}
+
+static void
+box_check_replication_spaces(void)
+{
+	int count = cfg_getarr_size("replication_spaces");
+	for (int i = 0; i < count; i++) {
+		const char *str = cfg_getarr_elem("replication_spaces", i);
+		char *end;
+		long long id = str != NULL ? strtoll(str, &end, 10) : -1;
+		if (str == NULL || end == str || *end != '\0' || id < 0 ||
+		    id > BOX_SPACE_MAX) {
+			tnt_raise(ClientError, ER_CFG, "replication_spaces",
+				  "must be an array of space ids");
+		}
+	}
+}
+
+static double
+box_check_replication_ack_interval(void)
+{
+	double interval = cfg_getd("replication_ack_interval");
+	if (interval < 0) {
+		tnt_raise(ClientError, ER_CFG, "replication_ack_interval",
+			  "the value must be greater or equal to 0");
+	}
+	return interval;
+}
+
+static enum compression_type
+box_check_replication_compression(void)
+{
+	const char *name = cfg_gets("replication_compression");
+	enum compression_type type = STR2ENUM(compression_type, name);
+	if (type == compression_type_MAX) {
+		tnt_raise(ClientError, ER_CFG, "replication_compression",
+			  "must be 'none' or 'zstd'");
+	}
+	return type;
+}
+
 static inline void
 box_check_uuid(struct tt_uuid *uuid, const char *name)
 {
@@ -630,6 +725,98 @@ box_check_readahead(int readahead)
 	}
 }
 
+static int
+box_check_iproto_threads(void)
+{
+	int threads = cfg_geti("iproto_threads");
+	if (threads <= 0 || threads > IPROTO_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_threads",
+			  tt_sprintf("must be greater than or equal to 1 "
+				     "and less than or equal to %d",
+				     IPROTO_THREADS_MAX));
+	}
+	return threads;
+}
+
+static enum numa_policy
+box_check_memtx_numa_policy(void)
+{
+	const char *name = cfg_gets("memtx_numa_policy");
+	assert(name != NULL); /* checked in Lua */
+	int policy = strindex(numa_policy_strs, name, numa_policy_MAX);
+	if (policy == numa_policy_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_numa_policy",
+			  "must be one of 'default', 'local', 'interleave'");
+	}
+	return (enum numa_policy)policy;
+}
+
+static int
+box_check_memtx_snapshot_threads(void)
+{
+	int threads = cfg_geti("memtx_snapshot_threads");
+	if (threads <= 0) {
+		tnt_raise(ClientError, ER_CFG, "memtx_snapshot_threads",
+			  "must be greater than or equal to 1");
+	}
+	return threads;
+}
+
+static double
+box_check_memtx_checkpoint_delta_ratio(void)
+{
+	double ratio = cfg_getd("memtx_checkpoint_delta_ratio");
+	if (ratio < 0 || ratio > 1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_checkpoint_delta_ratio",
+			  "the value must be between 0 and 1");
+	}
+	return ratio;
+}
+
+static double
+box_check_memtx_defrag_budget(void)
+{
+	double budget = cfg_getd("memtx_defrag_budget");
+	if (budget < 0 || budget > 1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_defrag_budget",
+			  "the value must be between 0 and 1");
+	}
+	return budget;
+}
+
+static double
+box_check_memtx_expire_rate(void)
+{
+	double rate = cfg_getd("memtx_expire_rate");
+	if (rate < 0) {
+		tnt_raise(ClientError, ER_CFG, "memtx_expire_rate",
+			  "the value must not be negative");
+	}
+	return rate;
+}
+
+static int
+box_check_read_view_threads(void)
+{
+	int threads = cfg_geti("read_view_threads");
+	if (threads <= 0) {
+		tnt_raise(ClientError, ER_CFG, "read_view_threads",
+			  "must be greater than or equal to 1");
+	}
+	return threads;
+}
+
+static int
+box_check_func_worker_threads(void)
+{
+	int threads = cfg_geti("func_worker_threads");
+	if (threads <= 0) {
+		tnt_raise(ClientError, ER_CFG, "func_worker_threads",
+			  "must be greater than or equal to 1");
+	}
+	return threads;
+}
+
 static void
 box_check_checkpoint_count(int checkpoint_count)
 {
@@ -639,6 +826,17 @@ box_check_checkpoint_count(int checkpoint_count)
 	}
 }
 
+static double
+box_check_checkpoint_recovery_time(void)
+{
+	double recovery_time = cfg_getd("checkpoint_recovery_time");
+	if (recovery_time < 0) {
+		tnt_raise(ClientError, ER_CFG, "checkpoint_recovery_time",
+			  "the value must not be negative");
+	}
+	return recovery_time;
+}
+
 static int64_t
 box_check_wal_max_size(int64_t wal_max_size)
 {
@@ -650,6 +848,122 @@ box_check_wal_max_size(int64_t wal_max_size)
 	return wal_max_size;
 }
 
+static int
+box_check_wal_compression_level(void)
+{
+	int level = cfg_geti("wal_compression_level");
+	if (level < 1 || level > ZSTD_maxCLevel()) {
+		tnt_raise(ClientError, ER_CFG, "wal_compression_level",
+			  tt_sprintf("must be greater than or equal to 1 "
+				     "and less than or equal to %d",
+				     ZSTD_maxCLevel()));
+	}
+	return level;
+}
+
+static int64_t
+box_check_wal_compression_threshold(void)
+{
+	int64_t threshold = cfg_geti64("wal_compression_threshold");
+	if (threshold < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_compression_threshold",
+			  "must be greater than or equal to 0");
+	}
+	return threshold;
+}
+
+static int
+box_check_wal_compression_threads(void)
+{
+	int threads = cfg_geti("wal_compression_threads");
+	if (threads < 0 || threads > XLOG_ZPOOL_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "wal_compression_threads",
+			  tt_sprintf("must be greater than or equal to 0 "
+				     "and less than or equal to %d",
+				     XLOG_ZPOOL_THREADS_MAX));
+	}
+	return threads;
+}
+
+static double
+box_check_wal_group_commit_delay(void)
+{
+	double delay = cfg_getd("wal_group_commit_delay");
+	if (delay < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_group_commit_delay",
+			  "must be greater than or equal to 0");
+	}
+	return delay;
+}
+
+static double
+box_check_busy_poll_timeout(void)
+{
+	double timeout = cfg_getd("busy_poll_timeout");
+	if (timeout < 0) {
+		tnt_raise(ClientError, ER_CFG, "busy_poll_timeout",
+			  "must be greater than or equal to 0");
+	}
+	return timeout;
+}
+
+static int64_t
+box_check_net_fiber_stack_size(void)
+{
+	int64_t size = cfg_geti64("net_fiber_stack_size");
+	struct fiber_attr attr;
+	fiber_attr_create(&attr);
+	if (size <= 0 || fiber_attr_setstacksize(&attr, size) != 0) {
+		tnt_raise(ClientError, ER_CFG, "net_fiber_stack_size",
+			  "is too small");
+	}
+	return size;
+}
+
+static double
+box_check_net_trace_sample_rate(void)
+{
+	double rate = cfg_getd("net_trace_sample_rate");
+	if (rate < 0 || rate > 1) {
+		tnt_raise(ClientError, ER_CFG, "net_trace_sample_rate",
+			  "must be in range [0, 1]");
+	}
+	return rate;
+}
+
+static int64_t
+box_check_wal_group_commit_max_size(void)
+{
+	int64_t max_size = cfg_geti64("wal_group_commit_max_size");
+	if (max_size <= 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_group_commit_max_size",
+			  "the value must be greater than 0");
+	}
+	return max_size;
+}
+
+static int
+box_check_wal_recycle_count(void)
+{
+	int count = cfg_geti("wal_recycle_count");
+	if (count < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_recycle_count",
+			  "must be greater than or equal to 0");
+	}
+	return count;
+}
+
+static int64_t
+box_check_wal_tail_size(void)
+{
+	int64_t size = cfg_geti64("wal_tail_size");
+	if (size < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_tail_size",
+			  "must be greater than or equal to 0");
+	}
+	return size;
+}
+
 static ssize_t
 box_check_memory_quota(const char *quota_name)
 {
@@ -662,11 +976,57 @@ box_check_memory_quota(const char *quota_name)
 	return -1;
 }
 
+static int
+box_check_vinyl_max_subcompactions(void)
+{
+	int max_subcompactions = cfg_geti("vinyl_max_subcompactions");
+	if (max_subcompactions <= 0) {
+		tnt_raise(ClientError, ER_CFG, "vinyl_max_subcompactions",
+			  "must be greater than or equal to 1");
+	}
+	return max_subcompactions;
+}
+
+static int64_t
+box_check_vinyl_compaction_readahead(void)
+{
+	int64_t readahead = cfg_geti64("vinyl_compaction_readahead");
+	if (readahead < 0) {
+		tnt_raise(ClientError, ER_CFG, "vinyl_compaction_readahead",
+			  "must be greater than or equal to 0");
+	}
+	return readahead;
+}
+
+static int64_t
+box_check_vinyl_blob_threshold(void)
+{
+	int64_t threshold = cfg_geti64("vinyl_blob_threshold");
+	if (threshold < 0) {
+		tnt_raise(ClientError, ER_CFG, "vinyl_blob_threshold",
+			  "must be greater than or equal to 0");
+	}
+	return threshold;
+}
+
+static int
+box_check_vinyl_upsert_squash_threshold(void)
+{
+	int threshold = cfg_geti("vinyl_upsert_squash_threshold");
+	if (threshold < 1 || threshold > VINYL_UPSERT_SQUASH_THRESHOLD_MAX) {
+		tnt_raise(ClientError, ER_CFG, "vinyl_upsert_squash_threshold",
+			  tt_sprintf("must be between 1 and %d",
+				     VINYL_UPSERT_SQUASH_THRESHOLD_MAX));
+	}
+	return threshold;
+}
+
 static void
 box_check_vinyl_options(void)
 {
 	int read_threads = cfg_geti("vinyl_read_threads");
 	int write_threads = cfg_geti("vinyl_write_threads");
+	int dump_threads = cfg_geti("vinyl_dump_threads");
 	int64_t range_size = cfg_geti64("vinyl_range_size");
 	int64_t page_size = cfg_geti64("vinyl_page_size");
 	int run_count_per_level = cfg_geti("vinyl_run_count_per_level");
@@ -684,6 +1044,10 @@ box_check_vinyl_options(void)
 		tnt_raise(ClientError, ER_CFG, "vinyl_write_threads",
 			  "must be greater than or equal to 2");
 	}
+	if (dump_threads < 0) {
+		tnt_raise(ClientError, ER_CFG, "vinyl_dump_threads",
+			  "must be greater than or equal to 0");
+	}
 	if (page_size <= 0 || (range_size > 0 && page_size > range_size)) {
 		tnt_raise(ClientError, ER_CFG, "vinyl_page_size",
 			  "must be greater than 0 and less than "
@@ -732,14 +1096,45 @@ box_check_config(void)
 	if (box_check_replication_synchro_timeout() < 0)
 		diag_raise();
 	box_check_replication_sync_timeout();
+	box_check_replication_apply_fibers();
+	box_check_worker_pool_threads("worker_pool_threads");
+	box_check_worker_pool_threads("worker_pool_file_threads");
+	box_check_worker_pool_threads("worker_pool_resolve_threads");
+	box_check_dns_cache_ttl();
+	box_check_replication_ack_interval();
+	box_check_replication_spaces();
+	box_check_replication_compression();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_iproto_threads();
+	box_check_busy_poll_timeout();
+	box_check_net_fiber_stack_size();
+	box_check_net_trace_sample_rate();
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
+	box_check_checkpoint_recovery_time();
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
+	box_check_wal_compression_level();
+	box_check_wal_compression_threshold();
+	box_check_wal_compression_threads();
+	box_check_wal_group_commit_delay();
+	box_check_wal_group_commit_max_size();
+	box_check_wal_recycle_count();
+	box_check_wal_tail_size();
 	if (box_check_memory_quota("memtx_memory") < 0)
 		diag_raise();
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
+	box_check_memtx_numa_policy();
+	box_check_memtx_snapshot_threads();
+	box_check_memtx_checkpoint_delta_ratio();
+	box_check_memtx_defrag_budget();
+	box_check_memtx_expire_rate();
+	box_check_read_view_threads();
+	box_check_func_worker_threads();
 	box_check_vinyl_options();
+	box_check_vinyl_max_subcompactions();
+	box_check_vinyl_compaction_readahead();
+	box_check_vinyl_blob_threshold();
+	box_check_vinyl_upsert_squash_threshold();
 	if (box_check_sql_cache_size(cfg_geti("sql_cache_size")) != 0)
 		diag_raise();
 }
@@ -884,6 +1279,65 @@ box_set_replication_skip_conflict(void)
 	replication_skip_conflict = cfg_geti("replication_skip_conflict");
 }
 
+void
+box_set_replication_apply_fibers(void)
+{
+	replication_apply_fibers = box_check_replication_apply_fibers();
+}
+
+void
+box_set_worker_pool_threads(void)
+{
+	int call = box_check_worker_pool_threads("worker_pool_threads");
+	int file = box_check_worker_pool_threads("worker_pool_file_threads");
+	int resolve =
+		box_check_worker_pool_threads("worker_pool_resolve_threads");
+	coio_pool_set_size(COIO_POOL_CALL, call);
+	coio_pool_set_size(COIO_POOL_FILE, file);
+	coio_pool_set_size(COIO_POOL_RESOLVE, resolve);
+}
+
+void
+box_set_dns_cache_ttl(void)
+{
+	coio_dns_cache_set_ttl(box_check_dns_cache_ttl());
+}
+
+void
+box_set_replication_ack_interval(void)
+{
+	replication_ack_interval = box_check_replication_ack_interval();
+}
+
+void
+box_set_replication_spaces(void)
+{
+	box_check_replication_spaces();
+	free(replication_spaces);
+	replication_spaces = NULL;
+	replication_space_count = 0;
+	int count = cfg_getarr_size("replication_spaces");
+	if (count == 0)
+		return;
+	size_t size = count * sizeof(uint32_t);
+	replication_spaces = (uint32_t *)malloc(size);
+	if (replication_spaces == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "replication_spaces");
+		diag_raise();
+	}
+	for (int i = 0; i < count; i++) {
+		const char *str = cfg_getarr_elem("replication_spaces", i);
+		replication_spaces[i] = strtoll(str, NULL, 10);
+	}
+	replication_space_count = count;
+}
+
+void
+box_set_replication_compression(void)
+{
+	replication_compression = box_check_replication_compression();
+}
+
 void
 box_set_replication_anon(void)
 {
@@ -1053,6 +1507,76 @@ box_set_memtx_max_tuple_size(void)
 			cfg_geti("memtx_max_tuple_size"));
 }
 
+void
+box_set_xlog_compression_dict(void)
+{
+	int64_t id = cfg_geti64("xlog_compression_dict");
+	if (id < 0 || id > UINT32_MAX) {
+		tnt_raise(ClientError, ER_CFG, "xlog_compression_dict",
+			  "must be a dictionary id or 0");
+	}
+	struct xlog_dict *dict = NULL;
+	if (id != 0) {
+		/* Dictionaries are saved to both directories. */
+		dict = xlog_dict_load(cfg_gets("wal_dir"), id);
+		if (dict == NULL)
+			diag_raise();
+	}
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_snap_dict(memtx, dict);
+	wal_set_dict(dict);
+}
+
+void
+box_set_memtx_snapshot_threads(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_snapshot_threads(memtx,
+			box_check_memtx_snapshot_threads());
+}
+
+void
+box_set_memtx_checkpoint_delta_ratio(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_checkpoint_delta_ratio(memtx,
+			box_check_memtx_checkpoint_delta_ratio());
+}
+
+void
+box_set_memtx_defrag_budget(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_defrag_budget(memtx, box_check_memtx_defrag_budget());
+}
+
+void
+box_set_memtx_update_in_place(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_update_in_place(memtx,
+					 cfg_getb("memtx_update_in_place"));
+}
+
+void
+box_set_memtx_expire_rate(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_expire_rate(memtx, box_check_memtx_expire_rate());
+}
+
 void
 box_set_too_long_threshold(void)
 {
@@ -1063,6 +1587,29 @@ box_set_too_long_threshold(void)
 	vinyl_engine_set_too_long_threshold(vinyl, too_long_threshold);
 }
 
+void
+box_set_busy_poll_timeout(void)
+{
+	double timeout = box_check_busy_poll_timeout();
+	/* Both tx and the network threads are polled. */
+	cbus_set_busy_poll(timeout);
+	iproto_set_busy_poll(timeout);
+}
+
+void
+box_set_net_fiber_stack_size(void)
+{
+	int64_t size = box_check_net_fiber_stack_size();
+	if (fiber_pool_set_stack_size(&tx_fiber_pool, size) != 0)
+		diag_raise();
+}
+
+void
+box_set_net_trace_sample_rate(void)
+{
+	iproto_set_trace_sample_rate(box_check_net_trace_sample_rate());
+}
+
 void
 box_set_readahead(void)
 {
@@ -1090,7 +1637,34 @@ void
 box_set_checkpoint_wal_threshold(void)
 {
 	int64_t threshold = cfg_geti64("checkpoint_wal_threshold");
-	wal_set_checkpoint_threshold(threshold);
+	gc_set_checkpoint_wal_threshold(threshold);
+}
+
+void
+box_set_checkpoint_recovery_time(void)
+{
+	double recovery_time = box_check_checkpoint_recovery_time();
+	gc_set_checkpoint_recovery_time(recovery_time);
+}
+
+void
+box_set_wal_group_commit(void)
+{
+	double delay = box_check_wal_group_commit_delay();
+	int64_t max_size = box_check_wal_group_commit_max_size();
+	wal_set_group_commit(delay, max_size);
+}
+
+void
+box_set_wal_recycle_count(void)
+{
+	wal_set_recycle_count(box_check_wal_recycle_count());
+}
+
+void
+box_set_wal_tail_size(void)
+{
+	wal_set_tail_size(box_check_wal_tail_size());
 }
 
 void
@@ -1121,6 +1695,50 @@ box_set_vinyl_cache(void)
 	vinyl_engine_set_cache(vinyl, cfg_geti64("vinyl_cache"));
 }
 
+void
+box_set_vinyl_page_cache(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_page_cache(vinyl, cfg_geti64("vinyl_page_cache"));
+}
+
+void
+box_set_vinyl_max_subcompactions(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_max_subcompactions(vinyl,
+			box_check_vinyl_max_subcompactions());
+}
+
+void
+box_set_vinyl_compaction_direct_io(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_compaction_direct_io(vinyl,
+			cfg_geti("vinyl_compaction_direct_io") != 0);
+}
+
+void
+box_set_vinyl_compaction_readahead(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_compaction_readahead(vinyl,
+			box_check_vinyl_compaction_readahead());
+}
+
+void
+box_set_vinyl_blob_threshold(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_blob_threshold(vinyl,
+			box_check_vinyl_blob_threshold());
+}
+
 void
 box_set_vinyl_timeout(void)
 {
@@ -1129,14 +1747,25 @@ box_set_vinyl_timeout(void)
 	vinyl_engine_set_timeout(vinyl,	cfg_getd("vinyl_timeout"));
 }
 
+void
+box_set_vinyl_upsert_squash_threshold(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_upsert_squash_threshold(vinyl,
+			box_check_vinyl_upsert_squash_threshold());
+}
+
 void
 box_set_net_msg_max(void)
 {
 	int new_iproto_msg_max = cfg_geti("net_msg_max");
 	iproto_set_msg_max(new_iproto_msg_max);
+	/* The limit is applied to every network thread. */
 	fiber_pool_set_max_size(&tx_fiber_pool,
 				new_iproto_msg_max *
-				IPROTO_FIBER_POOL_SIZE_FACTOR);
+				IPROTO_FIBER_POOL_SIZE_FACTOR *
+				iproto_thread_count());
 }
 
 int
@@ -1226,6 +1855,12 @@ box_return_mp(box_function_ctx_t *ctx, const char *mp, const char *mp_end)
 	return port_c_add_mp(ctx->port, mp, mp_end);
 }
 
+API_EXPORT char *
+box_return_mp_alloc(box_function_ctx_t *ctx, uint32_t size)
+{
+	return port_c_alloc_mp(ctx->port, size);
+}
+
 /* schema_find_id()-like method using only public API */
 API_EXPORT uint32_t
 box_space_id_by_name(const char *name, uint32_t len)
@@ -1294,14 +1929,61 @@ box_process1(struct request *request, box_tuple_t **result)
 	return box_process_rw(request, space, result);
 }
 
-API_EXPORT int
-box_select(uint32_t space_id, uint32_t index_id,
-	   int iterator, uint32_t offset, uint32_t limit,
-	   const char *key, const char *key_end,
-	   struct port *port)
+/**
+ * Add a selected tuple to a port decompressing it if needed,
+ * so that the user never sees compressed fields.
+ */
+static int
+box_select_add_tuple(struct port *port, struct tuple *tuple)
+{
+	struct tuple *plain = tuple_decompress(tuple);
+	if (plain == NULL)
+		return -1;
+	if (plain == tuple)
+		return port_c_add_tuple(port, tuple);
+	/* Free the copy if the port fails to reference it. */
+	tuple_ref(plain);
+	int rc = port_c_add_tuple(port, plain);
+	tuple_unref(plain);
+	return rc;
+}
+
+/**
+ * Append at most @a limit tuples returned by @a it to @a port,
+ * skipping @a offset tuples first.
+ *
+ * @retval  1 The limit is reached, there may be more tuples.
+ * @retval  0 The iterator is exhausted.
+ * @retval -1 Error.
+ */
+static int
+box_select_iterate(struct iterator *it, uint32_t offset, uint32_t limit,
+		   struct port *port)
+{
+	uint32_t found = 0;
+	struct tuple *tuple;
+	if (limit > 0 && offset > 0 && iterator_skip(it, offset) != 0)
+		return -1;
+	while (found < limit) {
+		if (iterator_next(it, &tuple) != 0)
+			return -1;
+		if (tuple == NULL)
+			return 0;
+		if (box_select_add_tuple(port, tuple) != 0)
+			return -1;
+		found++;
+	}
+	return 1;
+}
+
+/**
+ * Implementation of box_select() and box_select_keys().
+ */
+static int
+box_select_impl(uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, bool keys_only, struct port *port)
 {
-	(void)key_end;
-
 	rmean_collect(rmean_box, IPROTO_SELECT, 1);
 
 	if (iterator < 0 || iterator >= iterator_type_MAX) {
@@ -1324,6 +2006,7 @@ box_select(uint32_t space_id, uint32_t index_id,
 	uint32_t part_count = key ? mp_decode_array(&key) : 0;
 	if (key_validate(index->def, type, key, part_count))
 		return -1;
+	uint64_t start = clock_monotonic64();
 
 	ERROR_INJECT(ERRINJ_TESTING, {
 		diag_set(ClientError, ER_INJECTION, "ERRINJ_TESTING");
@@ -1334,41 +2017,376 @@ box_select(uint32_t space_id, uint32_t index_id,
 	if (txn_begin_ro_stmt(space, &txn) != 0)
 		return -1;
 
-	struct iterator *it = index_create_iterator(index, type,
-						    key, part_count);
+	struct iterator *it = keys_only ?
+		index_create_key_iterator(index, type, key, part_count) :
+		index_create_iterator(index, type, key, part_count);
 	if (it == NULL) {
 		txn_rollback_stmt(txn);
 		return -1;
 	}
 
+	port_c_create(port);
+	int rc = box_select_iterate(it, offset, limit, port);
+	iterator_delete(it);
+
+	if (rc < 0) {
+		port_destroy(port);
+		txn_rollback_stmt(txn);
+		return -1;
+	}
+	txn_commit_ro_stmt(txn);
+	index->op_stat.scan++;
+	index->op_stat.rows += ((struct port_c *)port)->size;
+	index->op_stat.time += clock_monotonic64() - start;
+	return 0;
+}
+
+API_EXPORT int
+box_select(uint32_t space_id, uint32_t index_id,
+	   int iterator, uint32_t offset, uint32_t limit,
+	   const char *key, const char *key_end,
+	   struct port *port)
+{
+	(void)key_end;
+	return box_select_impl(space_id, index_id, iterator, offset, limit,
+			       key, false, port);
+}
+
+int
+box_select_keys(uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, const char *key_end,
+		struct port *port)
+{
+	(void)key_end;
+	return box_select_impl(space_id, index_id, iterator, offset, limit,
+			       key, true, port);
+}
+
+int
+box_get_batch(uint32_t space_id, uint32_t index_id,
+	      const char *keys, const char *keys_end, struct port *port)
+{
+	(void)keys_end;
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	if (access_check_space(space, PRIV_R) != 0)
+		return -1;
+	struct index *index = index_find(space, index_id);
+	if (index == NULL)
+		return -1;
+	if (!index->def->opts.is_unique) {
+		diag_set(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		return -1;
+	}
+	uint32_t key_count = mp_decode_array(&keys);
+	const char *key = keys;
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (mp_typeof(*key) != MP_ARRAY) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "keys must be arrays");
+			return -1;
+		}
+		const char *parts = key;
+		uint32_t part_count = mp_decode_array(&parts);
+		if (exact_key_validate(index->def->key_def, parts,
+				       part_count) != 0)
+			return -1;
+		mp_next(&key);
+	}
+
+	rmean_collect(rmean_box, IPROTO_SELECT, key_count);
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size_t size;
+	struct tuple **result = region_alloc_array(region, struct tuple *,
+						   key_count, &size);
+	if (result == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "result");
+		return -1;
+	}
+	struct txn *txn;
+	if (txn_begin_ro_stmt(space, &txn) != 0) {
+		region_truncate(region, region_svp);
+		return -1;
+	}
+	if (index_get_batch(index, keys, key_count, result) != 0) {
+		txn_rollback_stmt(txn);
+		region_truncate(region, region_svp);
+		return -1;
+	}
+	txn_commit_ro_stmt(txn);
+	index->op_stat.lookup += key_count;
+
 	int rc = 0;
-	uint32_t found = 0;
-	struct tuple *tuple;
 	port_c_create(port);
-	while (found < limit) {
-		rc = iterator_next(it, &tuple);
-		if (rc != 0 || tuple == NULL)
-			break;
-		if (offset > 0) {
-			offset--;
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (result[i] == NULL)
 			continue;
-		}
-		rc = port_c_add_tuple(port, tuple);
-		if (rc != 0)
-			break;
-		found++;
+		index->op_stat.rows++;
+		if (rc == 0)
+			rc = box_select_add_tuple(port, result[i]);
+		tuple_unref(result[i]);
 	}
-	iterator_delete(it);
+	region_truncate(region, region_svp);
+	if (rc != 0)
+		port_destroy(port);
+	return rc;
+}
 
-	if (rc != 0) {
+int
+box_index_split(uint32_t space_id, uint32_t index_id, uint32_t count,
+		struct port *port)
+{
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	if (access_check_space(space, PRIV_R) != 0)
+		return -1;
+	struct index *index = index_find(space, index_id);
+	if (index == NULL)
+		return -1;
+	port_c_create(port);
+	if (index_split(index, count, port) != 0) {
 		port_destroy(port);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Server-side iterator opened by box_select_open(): the position
+ * of a SELECT, which result is sent to the client in chunks.
+ */
+struct box_select_cursor {
+	/** Index iterator, references @a key. */
+	struct iterator *it;
+	/** Space of the iterator, for access checks and txn. */
+	uint32_t space_id;
+	/** True while a chunk of tuples is being fetched. */
+	bool is_busy;
+	/** Copy of the search key, it outlives the request. */
+	char key[0];
+};
+
+/** The last id assigned to a select cursor. */
+static uint32_t box_select_cursor_id_max = 0;
+
+static void
+box_select_cursor_delete(struct box_select_cursor *cursor)
+{
+	iterator_delete(cursor->it);
+	free(cursor);
+}
+
+/**
+ * Find a cursor of the current session.
+ * @retval NULL The cursor doesn't exist, diag is set.
+ */
+static struct box_select_cursor *
+box_select_cursor_find(uint32_t iterator_id)
+{
+	struct mh_i32ptr_t *hash = current_session()->select_cursors;
+	mh_int_t i;
+	if (hash == NULL ||
+	    (i = mh_i32ptr_find(hash, iterator_id, NULL)) == mh_end(hash)) {
+		diag_set(ClientError, ER_NO_SUCH_ITERATOR, iterator_id);
+		return NULL;
+	}
+	struct box_select_cursor *cursor = (struct box_select_cursor *)
+		mh_i32ptr_node(hash, i)->val;
+	if (cursor->is_busy) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "iterator is being fetched by another request");
+		return NULL;
+	}
+	return cursor;
+}
+
+/** Remove a cursor from the current session and delete it. */
+static void
+box_select_cursor_close(uint32_t iterator_id)
+{
+	struct mh_i32ptr_t *hash = current_session()->select_cursors;
+	mh_int_t i = mh_i32ptr_find(hash, iterator_id, NULL);
+	assert(i != mh_end(hash));
+	struct box_select_cursor *cursor = (struct box_select_cursor *)
+		mh_i32ptr_node(hash, i)->val;
+	mh_i32ptr_del(hash, i, NULL);
+	box_select_cursor_delete(cursor);
+}
+
+/**
+ * Register a cursor in the current session.
+ * @retval Cursor id, or 0 on memory error.
+ */
+static uint32_t
+box_select_cursor_register(struct box_select_cursor *cursor)
+{
+	struct session *session = current_session();
+	if (session->select_cursors == NULL) {
+		session->select_cursors = mh_i32ptr_new();
+		if (session->select_cursors == NULL) {
+			diag_set(OutOfMemory, 0, "mh_i32ptr_new",
+				 "session select cursor hash");
+			return 0;
+		}
+	}
+	if (++box_select_cursor_id_max == 0)
+		box_select_cursor_id_max = 1;
+	const struct mh_i32ptr_node_t node = {
+		box_select_cursor_id_max, cursor
+	};
+	mh_int_t i = mh_i32ptr_put(session->select_cursors, &node,
+				   NULL, NULL);
+	if (i == mh_end(session->select_cursors)) {
+		diag_set(OutOfMemory, 0, "mh_i32ptr_put", "mh_i32ptr_node");
+		return 0;
+	}
+	return box_select_cursor_id_max;
+}
+
+int
+box_select_open(uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, const char *key_end,
+		struct port *port, uint32_t *iterator_id)
+{
+	rmean_collect(rmean_box, IPROTO_SELECT, 1);
+
+	if (iterator < 0 || iterator >= iterator_type_MAX) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "Invalid iterator type");
+		return -1;
+	}
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	if (access_check_space(space, PRIV_R) != 0)
+		return -1;
+	struct index *index = index_find(space, index_id);
+	if (index == NULL)
+		return -1;
+
+	/*
+	 * Iterators may refer to the key until they are deleted,
+	 * so the key is copied out of the request.
+	 */
+	size_t key_size = key_end - key;
+	struct box_select_cursor *cursor = (struct box_select_cursor *)
+		malloc(sizeof(*cursor) + key_size);
+	if (cursor == NULL) {
+		diag_set(OutOfMemory, sizeof(*cursor) + key_size,
+			 "malloc", "cursor");
+		return -1;
+	}
+	memcpy(cursor->key, key, key_size);
+	cursor->space_id = space_id;
+	cursor->is_busy = false;
+	key = cursor->key;
+
+	enum iterator_type type = (enum iterator_type) iterator;
+	uint32_t part_count = mp_decode_array(&key);
+	struct txn *txn;
+	if (key_validate(index->def, type, key, part_count) != 0 ||
+	    txn_begin_ro_stmt(space, &txn) != 0) {
+		free(cursor);
+		return -1;
+	}
+	cursor->it = index_create_iterator(index, type, key, part_count);
+	if (cursor->it == NULL) {
 		txn_rollback_stmt(txn);
+		free(cursor);
 		return -1;
 	}
+	port_c_create(port);
+	int rc = box_select_iterate(cursor->it, offset, limit, port);
+	if (rc < 0) {
+		txn_rollback_stmt(txn);
+		goto error;
+	}
 	txn_commit_ro_stmt(txn);
+	*iterator_id = 0;
+	if (rc == 0) {
+		box_select_cursor_delete(cursor);
+		return 0;
+	}
+	*iterator_id = box_select_cursor_register(cursor);
+	if (*iterator_id == 0)
+		goto error;
+	return 0;
+error:
+	port_destroy(port);
+	box_select_cursor_delete(cursor);
+	return -1;
+}
+
+int
+box_select_fetch(uint32_t iterator_id, uint32_t limit, struct port *port,
+		 bool *is_eof)
+{
+	rmean_collect(rmean_box, IPROTO_SELECT, 1);
+
+	struct box_select_cursor *cursor = box_select_cursor_find(iterator_id);
+	if (cursor == NULL)
+		return -1;
+	port_c_create(port);
+	int rc = 0;
+	/* The iterator ends if its space is dropped. */
+	struct space *space = space_by_id(cursor->space_id);
+	if (space != NULL) {
+		struct txn *txn;
+		if (access_check_space(space, PRIV_R) != 0 ||
+		    txn_begin_ro_stmt(space, &txn) != 0) {
+			port_destroy(port);
+			return -1;
+		}
+		cursor->is_busy = true;
+		rc = box_select_iterate(cursor->it, 0, limit, port);
+		cursor->is_busy = false;
+		if (rc < 0)
+			txn_rollback_stmt(txn);
+		else
+			txn_commit_ro_stmt(txn);
+	}
+	*is_eof = rc == 0;
+	if (rc > 0)
+		return 0;
+	/* The hash could have been rehashed while iterating. */
+	box_select_cursor_close(iterator_id);
+	if (rc < 0) {
+		port_destroy(port);
+		return -1;
+	}
+	return 0;
+}
+
+int
+box_select_close(uint32_t iterator_id)
+{
+	if (box_select_cursor_find(iterator_id) == NULL)
+		return -1;
+	box_select_cursor_close(iterator_id);
 	return 0;
 }
 
+void
+box_select_cursor_hash_erase(struct mh_i32ptr_t *hash)
+{
+	if (hash == NULL)
+		return;
+	mh_int_t i;
+	mh_foreach(hash, i) {
+		struct box_select_cursor *cursor = (struct box_select_cursor *)
+			mh_i32ptr_node(hash, i)->val;
+		assert(!cursor->is_busy);
+		box_select_cursor_delete(cursor);
+	}
+	mh_i32ptr_delete(hash);
+}
+
 API_EXPORT int
 box_insert(uint32_t space_id, const char *tuple, const char *tuple_end,
 	   box_tuple_t **result)
@@ -1412,6 +2430,68 @@ box_delete(uint32_t space_id, uint32_t index_id, const char *key,
 	return box_process1(&request, result);
 }
 
+int
+box_delete_range(uint32_t space_id, uint32_t index_id,
+		 const char *begin, const char *begin_end,
+		 const char *end, const char *end_end)
+{
+	mp_tuple_assert(begin, begin_end);
+	mp_tuple_assert(end, end_end);
+	struct request request;
+	memset(&request, 0, sizeof(request));
+	request.type = IPROTO_DELETE_RANGE;
+	request.space_id = space_id;
+	request.index_id = index_id;
+	request.key = begin;
+	request.key_end = begin_end;
+	request.tuple = end;
+	request.tuple_end = end_end;
+	return box_process1(&request, NULL);
+}
+
+int
+box_process_batch(const char *requests, const char *requests_end,
+		  struct port *port)
+{
+	(void)requests_end;
+	struct txn *txn = in_txn();
+	bool is_autocommit = txn == NULL;
+	box_txn_savepoint_t *svp = NULL;
+	if (is_autocommit) {
+		if (txn_begin() == NULL)
+			return -1;
+	} else if ((svp = box_txn_savepoint()) == NULL) {
+		return -1;
+	}
+	port_c_create(port);
+	uint32_t count = mp_decode_array(&requests);
+	for (uint32_t i = 0; i < count; i++) {
+		struct xrow_header row;
+		struct request request;
+		struct tuple *tuple;
+		if (xrow_decode_batch_next(&requests, &row, &request) != 0 ||
+		    box_process1(&request, &tuple) != 0)
+			goto rollback;
+		/* Keep results positional, push nil for no tuple. */
+		static const char nil[] = { (char)0xc0 };
+		int rc = tuple != NULL ? port_c_add_tuple(port, tuple) :
+			 port_c_add_mp(port, nil, nil + sizeof(nil));
+		if (rc != 0)
+			goto rollback;
+	}
+	if (is_autocommit && box_txn_commit() != 0)
+		goto error;
+	return 0;
+rollback:
+	if (is_autocommit)
+		box_txn_rollback();
+	else
+		box_txn_rollback_to_savepoint(svp);
+error:
+	port_destroy(port);
+	return -1;
+}
+
 API_EXPORT int
 box_update(uint32_t space_id, uint32_t index_id, const char *key,
 	   const char *key_end, const char *ops, const char *ops_end,
@@ -1562,8 +2642,26 @@ box_sequence_next(uint32_t seq_id, int64_t *result)
 	int64_t value;
 	if (sequence_next(seq, &value) != 0)
 		return -1;
-	if (sequence_data_update(seq_id, value) != 0)
-		return -1;
+	if (in_txn() != NULL) {
+		/*
+		 * The transaction may be rolled back, so don't
+		 * hand out values of a block that may be lost.
+		 */
+		if (sequence_data_update(seq_id, value) != 0)
+			return -1;
+		*result = value;
+		return 0;
+	}
+	int64_t reserved;
+	if (sequence_reserve(seq, value, &reserved)) {
+		seq->is_reserving = true;
+		int rc = sequence_data_update(seq_id, reserved);
+		seq->is_reserving = false;
+		if (rc != 0) {
+			sequence_unreserve(seq);
+			return -1;
+		}
+	}
 	*result = value;
 	return 0;
 }
@@ -1980,8 +3078,14 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	vclock_create(&replica_clock);
 	bool anon;
 	uint32_t id_filter;
+	enum compression_type compression;
 	xrow_decode_subscribe_xc(header, NULL, &replica_uuid, &replica_clock,
-				 &replica_version_id, &anon, &id_filter);
+				 &replica_version_id, &anon, &id_filter,
+				 &compression);
+	uint32_t *space_filter;
+	uint32_t space_filter_size;
+	xrow_decode_subscribe_space_filter_xc(header, &space_filter,
+					      &space_filter_size);
 
 	/* Forbid connection to itself */
 	if (tt_uuid_is_equal(&replica_uuid, &INSTANCE_UUID))
@@ -2035,9 +3139,15 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	 * id to replica, and replica checks that its cluster id
 	 * matches master's one. Older versions will just ignore
 	 * the additional field.
+	 *
+	 * If the replica asked for a compressed stream, confirm
+	 * it in the response. A replica which doesn't get the
+	 * confirmation (e.g. from an older master) falls back to
+	 * the plain stream.
 	 */
 	struct xrow_header row;
-	xrow_encode_subscribe_response_xc(&row, &REPLICASET_UUID, &vclock);
+	xrow_encode_subscribe_response_xc(&row, &REPLICASET_UUID, &vclock,
+					  compression);
 	/*
 	 * Identify the message with the replica id of this
 	 * instance, this is the only way for a replica to find
@@ -2084,7 +3194,8 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	 * indefinitely).
 	 */
 	relay_subscribe(replica, io->fd, header->sync, &replica_clock,
-			replica_version_id, id_filter);
+			replica_version_id, id_filter, compression,
+			space_filter, space_filter_size);
 }
 
 void
@@ -2139,8 +3250,11 @@ box_free(void)
 		replication_free();
 		sequence_free();
 		gc_free();
+		read_view_free();
+		func_worker_free();
 		engine_shutdown();
 		wal_free();
+		xlog_zpool_stop();
 	}
 }
 
@@ -2154,14 +3268,23 @@ engine_init()
 	 * so it must be registered first.
 	 */
 	struct memtx_engine *memtx;
+	memtx_tx_manager_use_mvcc_engine = cfg_getb("memtx_use_mvcc_engine");
 	memtx = memtx_engine_new_xc(cfg_gets("memtx_dir"),
 				    cfg_geti("force_recovery"),
 				    cfg_getd("memtx_memory"),
 				    cfg_geti("memtx_min_tuple_size"),
 				    cfg_geti("strip_core"),
-				    cfg_getd("slab_alloc_factor"));
+				    cfg_getd("slab_alloc_factor"),
+				    box_check_memtx_numa_policy(),
+				    cfg_geti("memtx_use_hugepages"),
+				    cfg_gets("memtx_heap_dir"));
 	engine_register((struct engine *)memtx);
 	box_set_memtx_max_tuple_size();
+	box_set_memtx_snapshot_threads();
+	box_set_memtx_checkpoint_delta_ratio();
+	box_set_memtx_defrag_budget();
+	box_set_memtx_update_in_place();
+	box_set_memtx_expire_rate();
 
 	struct sysview_engine *sysview = sysview_engine_new_xc();
 	engine_register((struct engine *)sysview);
@@ -2177,11 +3300,18 @@ engine_init()
 				    cfg_geti64("vinyl_memory"),
 				    cfg_geti("vinyl_read_threads"),
 				    cfg_geti("vinyl_write_threads"),
+				    cfg_geti("vinyl_dump_threads"),
 				    cfg_geti("force_recovery"));
 	engine_register((struct engine *)vinyl);
 	box_set_vinyl_max_tuple_size();
 	box_set_vinyl_cache();
+	box_set_vinyl_page_cache();
+	box_set_vinyl_max_subcompactions();
+	box_set_vinyl_compaction_direct_io();
+	box_set_vinyl_compaction_readahead();
+	box_set_vinyl_blob_threshold();
 	box_set_vinyl_timeout();
+	box_set_vinyl_upsert_squash_threshold();
 }
 
 /**
@@ -2367,6 +3497,12 @@ bootstrap(const struct tt_uuid *instance_uuid,
 	}
 }
 
+/**
+ * How often a hot standby instance tries to lock the WAL
+ * directory to take over the master.
+ */
+static const double HOT_STANDBY_LOCK_POLL_INTERVAL = 0.01;
+
 /**
  * Recover the instance from the local directory.
  * Enter hot standby if the directory is locked.
@@ -2397,6 +3533,7 @@ local_recovery(const struct tt_uuid *instance_uuid,
 	recovery = recovery_new(cfg_gets("wal_dir"),
 				cfg_geti("force_recovery"),
 				checkpoint_vclock);
+	recovery->read_ahead = true;
 
 	/*
 	 * Make sure we report the actual recovery position
@@ -2456,7 +3593,16 @@ local_recovery(const struct tt_uuid *instance_uuid,
 	memtx_engine_recover_snapshot_xc(memtx, checkpoint_vclock);
 
 	engine_begin_final_recovery_xc();
+	double replay_start = ev_monotonic_time();
 	recover_remaining_wals(recovery, &wal_stream.base, NULL, false);
+	/*
+	 * Measure the WAL replay rate for estimating the recovery
+	 * time, see box.cfg.checkpoint_recovery_time. Ignore tiny
+	 * WALs, the measurement would be too noisy.
+	 */
+	double replay_time = ev_monotonic_time() - replay_start;
+	if (wal_stream.bytes >= WAL_REPLAY_RATE_MIN_BYTES && replay_time > 0)
+		gc_set_wal_replay_rate(wal_stream.bytes / replay_time);
 	engine_end_recovery_xc();
 	/*
 	 * Leave hot standby mode, if any, only after
@@ -2467,13 +3613,20 @@ local_recovery(const struct tt_uuid *instance_uuid,
 		say_info("Entering hot standby mode");
 		recovery_follow_local(recovery, &wal_stream.base, "hot_standby",
 				      cfg_getd("wal_dir_rescan_delay"));
+		/*
+		 * The standby follows the WAL continuously so
+		 * there's little left to replay once the lock is
+		 * released. Poll the lock often enough not to make
+		 * the failover time dominated by the poll period.
+		 */
 		while (true) {
 			if (path_lock(cfg_gets("wal_dir"), &wal_dir_lock))
 				diag_raise();
 			if (wal_dir_lock >= 0)
 				break;
-			fiber_sleep(0.1);
+			fiber_sleep(HOT_STANDBY_LOCK_POLL_INTERVAL);
 		}
+		double takeover_start = ev_monotonic_time();
 		recovery_stop_local(recovery);
 		recover_remaining_wals(recovery, &wal_stream.base, NULL, true);
 		/*
@@ -2483,6 +3636,8 @@ local_recovery(const struct tt_uuid *instance_uuid,
 		vclock_copy(&replicaset.vclock, &recovery->vclock);
 		box_listen();
 		box_sync_replication(false);
+		say_info("left hot standby mode in %.3f sec",
+			 ev_monotonic_time() - takeover_start);
 	}
 	recovery_finalize(recovery);
 	is_local_recovery = false;
@@ -2575,16 +3730,24 @@ box_cfg_xc(void)
 	schema_init();
 	replication_init();
 	port_init();
-	iproto_init();
+	iproto_init(box_check_iproto_threads());
+	read_view_init(box_check_read_view_threads());
+	func_worker_init(box_check_func_worker_threads());
 	sql_init();
 
 	int64_t wal_max_size = box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
+	if (xlog_zpool_start(box_check_wal_compression_threads()) != 0)
+		diag_raise();
 	if (wal_init(wal_mode, txn_complete_async, cfg_gets("wal_dir"),
-		     wal_max_size, &INSTANCE_UUID, on_wal_garbage_collection,
+		     wal_max_size, box_check_wal_compression_level(),
+		     box_check_wal_compression_threshold(),
+		     &INSTANCE_UUID, on_wal_garbage_collection,
 		     on_wal_checkpoint_threshold) != 0) {
 		diag_raise();
 	}
+	box_set_wal_tail_size();
+	box_set_xlog_compression_dict();
 
 	title("loading");
 
@@ -2595,6 +3758,9 @@ box_cfg_xc(void)
 	if (box_set_prepared_stmt_cache_size() != 0)
 		diag_raise();
 	box_set_net_msg_max();
+	box_set_net_fiber_stack_size();
+	box_set_net_trace_sample_rate();
+	box_set_busy_poll_timeout();
 	box_set_readahead();
 	box_set_too_long_threshold();
 	box_set_replication_timeout();
@@ -2607,6 +3773,10 @@ box_cfg_xc(void)
 		diag_raise();
 	box_set_replication_sync_timeout();
 	box_set_replication_skip_conflict();
+	box_set_replication_apply_fibers();
+	box_set_replication_ack_interval();
+	box_set_replication_spaces();
+	box_set_replication_compression();
 	box_set_replication_anon();
 
 	struct gc_checkpoint *checkpoint = gc_last_checkpoint();
@@ -2764,6 +3934,97 @@ box_backup_stop(void)
 	}
 }
 
+enum {
+	/** Max number of files to train a dictionary on. */
+	TRAIN_DICT_FILES_MAX = 16,
+};
+
+struct train_dict_arg {
+	/** Files to read samples from, most recent first. */
+	const char *paths[TRAIN_DICT_FILES_MAX];
+	int path_count;
+	/** Directories to save the dictionary to. */
+	const char *dirnames[2];
+	/** Max dictionary size. */
+	size_t size;
+	/** Id of the trained dictionary. */
+	uint32_t id;
+};
+
+/**
+ * Add the most recent files of a directory to the list of
+ * files to train a dictionary on.
+ */
+static int
+train_dict_add_files(struct train_dict_arg *arg, const char *dirname,
+		     enum xdir_type type, int count)
+{
+	struct xdir dir;
+	xdir_create(&dir, dirname, type, &INSTANCE_UUID, &xlog_opts_default);
+	int rc = xdir_scan(&dir);
+	if (rc == 0) {
+		struct vclock *vclock = vclockset_last(&dir.index);
+		while (vclock != NULL && count-- > 0 &&
+		       arg->path_count < TRAIN_DICT_FILES_MAX) {
+			const char *path = xdir_format_filename(&dir,
+					vclock_sum(vclock), NONE);
+			char *copy = strdup(path);
+			if (copy == NULL) {
+				diag_set(OutOfMemory, strlen(path) + 1,
+					 "strdup", "path");
+				rc = -1;
+				break;
+			}
+			arg->paths[arg->path_count++] = copy;
+			vclock = vclockset_prev(&dir.index, vclock);
+		}
+	}
+	xdir_destroy(&dir);
+	return rc;
+}
+
+static int
+train_dict_f(va_list ap)
+{
+	struct train_dict_arg *arg = va_arg(ap, struct train_dict_arg *);
+	return xlog_dict_train(arg->paths, arg->path_count, arg->size,
+			       arg->dirnames, lengthof(arg->dirnames),
+			       &arg->id);
+}
+
+int
+box_train_xlog_dict(size_t size, uint32_t *id)
+{
+	if (!is_box_configured) {
+		diag_set(ClientError, ER_LOADING);
+		return -1;
+	}
+	struct train_dict_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	arg.size = size;
+	arg.dirnames[0] = cfg_gets("wal_dir");
+	arg.dirnames[1] = cfg_gets("memtx_dir");
+	int rc = -1;
+	struct cord cord;
+	/* The last snapshot goes first: it covers all spaces. */
+	if (train_dict_add_files(&arg, arg.dirnames[1], SNAP, 1) != 0 ||
+	    train_dict_add_files(&arg, arg.dirnames[0], XLOG,
+				 TRAIN_DICT_FILES_MAX) != 0)
+		goto out;
+	/* Reading and training take long, do it in a thread. */
+	if (cord_costart(&cord, "train_dict", train_dict_f, &arg) != 0)
+		goto out;
+	if (cord_cojoin(&cord) != 0)
+		goto out;
+	say_info("trained compression dictionary %u", (unsigned)arg.id);
+	*id = arg.id;
+	rc = 0;
+out:
+	for (int i = 0; i < arg.path_count; i++)
+		free((char *)arg.paths[i]);
+	return rc;
+}
+
 const char *
 box_status(void)
 {
@@ -2776,6 +4037,7 @@ box_reset_space_stat(struct space *space, void *arg)
 	(void)arg;
 	for (uint32_t i = 0; i < space->index_count; i++)
 		index_reset_stat(space->index[i]);
+	space_stat_reset(space);
 	return 0;
 }
 
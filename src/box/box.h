@@ -165,6 +165,18 @@ box_backup_start(int checkpoint_idx, box_backup_cb cb, void *cb_arg);
 void
 box_backup_stop(void);
 
+/**
+ * Train a compression dictionary of at most @a size bytes on
+ * rows of the last snapshot and WAL files and save it to the
+ * WAL and snapshot directories. The dictionary is used once its
+ * id is set in box.cfg.xlog_compression_dict.
+ *
+ * @retval 0 success, the dictionary id is returned in @a id
+ * @retval -1 error
+ */
+int
+box_train_xlog_dict(size_t size, uint32_t *id);
+
 /**
  * Spit out some basic module status (master/slave, etc.
  */
@@ -233,12 +245,28 @@ void box_set_readahead(void);
 void box_set_checkpoint_count(void);
 void box_set_checkpoint_interval(void);
 void box_set_checkpoint_wal_threshold(void);
+void box_set_checkpoint_recovery_time(void);
+void box_set_wal_group_commit(void);
+void box_set_wal_recycle_count(void);
+void box_set_wal_tail_size(void);
 void box_set_memtx_memory(void);
 void box_set_memtx_max_tuple_size(void);
+void box_set_memtx_snapshot_threads(void);
+void box_set_memtx_checkpoint_delta_ratio(void);
+void box_set_memtx_defrag_budget(void);
+void box_set_memtx_update_in_place(void);
+void box_set_memtx_expire_rate(void);
+void box_set_xlog_compression_dict(void);
 void box_set_vinyl_memory(void);
 void box_set_vinyl_max_tuple_size(void);
 void box_set_vinyl_cache(void);
+void box_set_vinyl_page_cache(void);
+void box_set_vinyl_max_subcompactions(void);
+void box_set_vinyl_compaction_direct_io(void);
+void box_set_vinyl_compaction_readahead(void);
+void box_set_vinyl_blob_threshold(void);
 void box_set_vinyl_timeout(void);
+void box_set_vinyl_upsert_squash_threshold(void);
 void box_set_replication_timeout(void);
 void box_set_replication_connect_timeout(void);
 void box_set_replication_connect_quorum(void);
@@ -247,8 +275,17 @@ int box_set_replication_synchro_quorum(void);
 int box_set_replication_synchro_timeout(void);
 void box_set_replication_sync_timeout(void);
 void box_set_replication_skip_conflict(void);
+void box_set_replication_apply_fibers(void);
+void box_set_worker_pool_threads(void);
+void box_set_dns_cache_ttl(void);
+void box_set_replication_ack_interval(void);
+void box_set_replication_spaces(void);
+void box_set_replication_compression(void);
 void box_set_replication_anon(void);
 void box_set_net_msg_max(void);
+void box_set_net_fiber_stack_size(void);
+void box_set_net_trace_sample_rate(void);
+void box_set_busy_poll_timeout(void);
 
 int
 box_set_prepared_stmt_cache_size(void);
@@ -267,6 +304,92 @@ box_select(uint32_t space_id, uint32_t index_id,
 	   const char *key, const char *key_end,
 	   struct port *port);
 
+/**
+ * Same as box_select(), but return extended keys of the index
+ * (see index_create_key_iterator()) instead of full tuples.
+ */
+int
+box_select_keys(uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, const char *key_end,
+		struct port *port);
+
+/**
+ * Look up tuples by a batch of full keys in a unique index.
+ * @keys is a MsgPack array of keys, each of which is an array.
+ * The tuples found are stored in @port in the order of keys.
+ * Keys that match no tuple are skipped.
+ */
+int
+box_get_batch(uint32_t space_id, uint32_t index_id,
+	      const char *keys, const char *keys_end, struct port *port);
+
+/**
+ * Split an index into at most @count key ranges of about the
+ * same size, see index_vtab::split(). The keys separating the
+ * ranges are stored in @port in ascending order.
+ */
+int
+box_index_split(uint32_t space_id, uint32_t index_id, uint32_t count,
+		struct port *port);
+
+/**
+ * Same as box_select(), but keep the iterator open in the
+ * current session if there may be more than @a limit tuples,
+ * and return its id in @a iterator_id, or 0 otherwise. The
+ * rest of the tuples is read with box_select_fetch().
+ */
+int
+box_select_open(uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, const char *key_end,
+		struct port *port, uint32_t *iterator_id);
+
+/**
+ * Return at most @a limit next tuples of an iterator opened by
+ * box_select_open() in the current session. The iterator is
+ * closed when it is exhausted, then @a is_eof is set, or on
+ * error.
+ */
+int
+box_select_fetch(uint32_t iterator_id, uint32_t limit, struct port *port,
+		 bool *is_eof);
+
+/**
+ * Delete all tuples whose keys are greater than or equal to
+ * @a begin and less than @a end. Both keys are MsgPack arrays,
+ * an empty key stands for infinity. The range is deleted with
+ * a single statement, without reading the tuples, so it's only
+ * supported by engines that can store range tombstones.
+ */
+int
+box_delete_range(uint32_t space_id, uint32_t index_id,
+		 const char *begin, const char *begin_end,
+		 const char *end, const char *end_end);
+
+/**
+ * Execute a MsgPack array of DML requests, as encoded in the body
+ * of a BATCH request, in one transaction, so that either all of
+ * them are committed with a single WAL write or none. If there's
+ * an active transaction, the requests are executed in it and
+ * rolled back to the state before the batch on error. The result
+ * of each request, a tuple or nil, is stored in @a port in the
+ * order of requests.
+ */
+int
+box_process_batch(const char *requests, const char *requests_end,
+		  struct port *port);
+
+/** Close an iterator opened by box_select_open(). */
+int
+box_select_close(uint32_t iterator_id);
+
+struct mh_i32ptr_t;
+
+/** Delete all iterators of a session, see box_select_open(). */
+void
+box_select_cursor_hash_erase(struct mh_i32ptr_t *hash);
+
 /** \cond public */
 
 /*
@@ -307,6 +430,22 @@ box_return_tuple(box_function_ctx_t *ctx, box_tuple_t *tuple);
 API_EXPORT int
 box_return_mp(box_function_ctx_t *ctx, const char *mp, const char *mp_end);
 
+/**
+ * Allocate space for MessagePack returned from a stored C
+ * procedure. The procedure encodes the value right into the
+ * returned buffer, which saves a copy compared to
+ * box_return_mp(). Exactly \a size bytes must be filled with a
+ * single encoded object, see box_return_mp().
+ *
+ * \param ctx An opaque structure passed to the stored C procedure
+ *        by Tarantool.
+ * \param size Size of the encoded object, must be positive.
+ * \retval NULL On error, check box_error_last().
+ * \retval Buffer to encode the object into.
+ */
+API_EXPORT char *
+box_return_mp_alloc(box_function_ctx_t *ctx, uint32_t size);
+
 /**
  * Find space id by name.
  *
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "bulk_load.h"
+
+#include <stdlib.h>
+
+#include "diag.h"
+#include "msgpuck.h"
+#include "trivia/util.h"
+
+#include "box.h"
+#include "errcode.h"
+#include "index.h"
+#include "key_def.h"
+#include "memtx_space.h"
+#include "memtx_tree.h"
+#include "schema.h"
+#include "space.h"
+#include "tuple.h"
+#include "txn.h"
+
+/**
+ * Look up a space and check that it can be bulk loaded.
+ * Returns NULL and sets diag on error.
+ */
+static struct space *
+bulk_load_find_space(uint32_t space_id)
+{
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return NULL;
+	if (access_check_space(space, PRIV_W) != 0)
+		return NULL;
+	if (!space_is_memtx(space)) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 space->engine->name, "bulk load");
+		return NULL;
+	}
+	if (space->sequence != NULL) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 "Space with a sequence", "bulk load");
+		return NULL;
+	}
+	if (!rlist_empty(&space->ck_constraint) ||
+	    !rlist_empty(&space->parent_fk_constraint) ||
+	    !rlist_empty(&space->child_fk_constraint)) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 "Space with constraints", "bulk load");
+		return NULL;
+	}
+	if (!rlist_empty(&space->before_replace) ||
+	    !rlist_empty(&space->on_replace)) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 "Space with triggers", "bulk load");
+		return NULL;
+	}
+	struct index *pk = index_find(space, 0);
+	if (pk == NULL)
+		return NULL;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (!memtx_tree_index_can_prepare_build(space->index[i])) {
+			diag_set(ClientError, ER_UNSUPPORTED,
+				 "Space with indexes other than TREE",
+				 "bulk load");
+			return NULL;
+		}
+	}
+	if (index_size(pk) != 0) {
+		diag_set(ClientError, ER_UNSUPPORTED,
+			 "Non-empty space", "bulk load");
+		return NULL;
+	}
+	return space;
+}
+
+struct bulk_load *
+bulk_load_new(uint32_t space_id)
+{
+	struct space *space = bulk_load_find_space(space_id);
+	if (space == NULL)
+		return NULL;
+	struct bulk_load *bl = malloc(sizeof(*bl));
+	if (bl == NULL) {
+		diag_set(OutOfMemory, sizeof(*bl), "malloc",
+			 "struct bulk_load");
+		return NULL;
+	}
+	bl->key_def = key_def_dup(space->index[0]->def->key_def);
+	if (bl->key_def == NULL) {
+		free(bl);
+		return NULL;
+	}
+	bl->space_id = space_id;
+	bl->format = space->format;
+	tuple_format_ref(bl->format);
+	bl->tuples = NULL;
+	bl->count = 0;
+	bl->capacity = 0;
+	return bl;
+}
+
+void
+bulk_load_delete(struct bulk_load *bl)
+{
+	for (size_t i = 0; i < bl->count; i++)
+		tuple_unref(bl->tuples[i]);
+	free(bl->tuples);
+	key_def_delete(bl->key_def);
+	tuple_format_unref(bl->format);
+	free(bl);
+}
+
+int
+bulk_load_add(struct bulk_load *bl, const char *data, const char *data_end)
+{
+	if (mp_typeof(*data) != MP_ARRAY) {
+		diag_set(ClientError, ER_TUPLE_NOT_ARRAY);
+		return -1;
+	}
+	if (bl->count == bl->capacity) {
+		size_t capacity = MAX(bl->capacity * 2, (size_t)1024);
+		struct tuple **tuples = realloc(bl->tuples,
+						capacity * sizeof(*tuples));
+		if (tuples == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*tuples),
+				 "realloc", "bulk load tuples");
+			return -1;
+		}
+		bl->tuples = tuples;
+		bl->capacity = capacity;
+	}
+	struct tuple *tuple = tuple_new(bl->format, data, data_end);
+	if (tuple == NULL)
+		return -1;
+	tuple_ref(tuple);
+	if (bl->count > 0) {
+		struct tuple *last = bl->tuples[bl->count - 1];
+		int cmp = tuple_compare(last, HINT_NONE, tuple, HINT_NONE,
+					bl->key_def);
+		if (cmp >= 0) {
+			struct space *space = space_by_id(bl->space_id);
+			if (cmp == 0 && space != NULL) {
+				diag_set(ClientError, ER_TUPLE_FOUND,
+					 space->index[0]->def->name,
+					 space_name(space));
+			} else {
+				diag_set(ClientError, ER_ILLEGAL_PARAMS,
+					 "tuples must be sorted by "
+					 "the primary key");
+			}
+			tuple_unref(tuple);
+			return -1;
+		}
+	}
+	bl->tuples[bl->count++] = tuple;
+	return 0;
+}
+
+int
+bulk_load_write(struct bulk_load *bl, const char *data, size_t size)
+{
+	const char *end = data + size;
+	while (data < end) {
+		const char *tuple_end = data;
+		if (mp_check(&tuple_end, end) != 0) {
+			diag_set(ClientError, ER_INVALID_MSGPACK,
+				 "bulk load data");
+			return -1;
+		}
+		if (bulk_load_add(bl, data, tuple_end) != 0)
+			return -1;
+		data = tuple_end;
+	}
+	return 0;
+}
+
+int
+bulk_load_commit(struct bulk_load *bl)
+{
+	if (in_txn() != NULL) {
+		diag_set(ClientError, ER_ACTIVE_TRANSACTION);
+		return -1;
+	}
+	struct space *space = bulk_load_find_space(bl->space_id);
+	if (space == NULL)
+		return -1;
+	if (space->format != bl->format) {
+		diag_set(ClientError, ER_ALTER_SPACE, space_name(space),
+			 "space was altered during bulk load");
+		return -1;
+	}
+	if (memtx_space_bulk_load(space, bl->tuples, bl->count) != 0)
+		return -1;
+	/* The tuples are now referenced by the space. */
+	for (size_t i = 0; i < bl->count; i++)
+		tuple_unref(bl->tuples[i]);
+	bl->count = 0;
+	/*
+	 * Nothing was written to WAL, so the loaded data
+	 * survives a restart only if it gets into a snapshot.
+	 * Temporary spaces are not checkpointed.
+	 */
+	if (space_is_temporary(space))
+		return 0;
+	return box_checkpoint();
+}
@@ -0,0 +1,115 @@
+#ifndef TARANTOOL_BOX_BULK_LOAD_H_INCLUDED
+#define TARANTOOL_BOX_BULK_LOAD_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct tuple;
+struct tuple_format;
+struct key_def;
+
+/**
+ * Bulk load of an empty memtx space.
+ *
+ * Tuples are accumulated in a loader in the order of the
+ * primary key and inserted into the space at once on commit.
+ * Instead of inserting tuples one by one, the primary index is
+ * built from the sorted input and secondary indexes are sorted
+ * once, the same way indexes are built on recovery from a
+ * snapshot.
+ *
+ * Loaded tuples are not written to WAL and so are neither
+ * replicated nor rolled back. Instead, a checkpoint is made
+ * on commit, so the whole load is persisted by one snapshot.
+ */
+struct bulk_load {
+	/** Id of the space to load. */
+	uint32_t space_id;
+	/** Space format, referenced. Checked on commit. */
+	struct tuple_format *format;
+	/** Primary key definition of the space. */
+	struct key_def *key_def;
+	/** Tuples to load sorted by the primary key, referenced. */
+	struct tuple **tuples;
+	/** Number of tuples to load. */
+	size_t count;
+	/** Capacity of the tuples array. */
+	size_t capacity;
+};
+
+/**
+ * Start a bulk load of a space. The space must be an empty
+ * memtx space with TREE indexes only and without sequences,
+ * constraints and triggers. Returns NULL and sets diag on
+ * error.
+ */
+struct bulk_load *
+bulk_load_new(uint32_t space_id);
+
+/**
+ * Append a tuple to a bulk load. Tuples must be appended
+ * in the ascending order of the primary key. Returns -1 and
+ * sets diag if the tuple doesn't match the space format or
+ * breaks the order.
+ */
+int
+bulk_load_add(struct bulk_load *bl, const char *data, const char *data_end);
+
+/**
+ * Append tuples from a chunk of concatenated MsgPack arrays.
+ * The chunk must not split tuples. Returns -1 and sets diag on
+ * error, in which case a prefix of the chunk may be appended.
+ */
+int
+bulk_load_write(struct bulk_load *bl, const char *data, size_t size);
+
+/**
+ * Insert the tuples appended to a bulk load into the space and
+ * make a checkpoint. The space must still be empty and have
+ * the same format. Does not free the bulk load.
+ */
+int
+bulk_load_commit(struct bulk_load *bl);
+
+/** Free a bulk load, discarding tuples that weren't committed. */
+void
+bulk_load_delete(struct bulk_load *bl);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_BULK_LOAD_H_INCLUDED */
@@ -138,6 +138,64 @@ box_module_reload(const char *name)
 	return -1;
 }
 
+enum {
+	/** Number of entries in the call target cache. */
+	CALL_CACHE_SIZE = 64,
+	/** Max length of a name kept in the call target cache. */
+	CALL_CACHE_NAME_MAX = 64,
+};
+
+/**
+ * Resolved target of IPROTO_CALL. Clients tend to call the same
+ * few functions over and over again, so remember what a name
+ * refers to instead of looking it up in the function cache and
+ * hashing its pieces in Lua on every request.
+ */
+struct call_cache_entry {
+	/** Function name, not null-terminated. */
+	char name[CALL_CACHE_NAME_MAX];
+	/** Length of the name, 0 if the entry is unused. */
+	uint32_t name_len;
+	/** Value of func_cache_version @a func was looked up at. */
+	uint32_t func_cache_version;
+	/** Registered function or NULL if there's no such one. */
+	struct func *func;
+	/** Pieces of the name, see box_lua_path_new(), or 0. */
+	int lua_path_ref;
+};
+
+/** Direct-mapped cache of call targets, used in tx only. */
+static struct call_cache_entry call_cache[CALL_CACHE_SIZE];
+
+/**
+ * Find the cache entry for a function name, resetting the entry
+ * if it is occupied by another name or is outdated. Return NULL
+ * if the name is too long to be cached.
+ */
+static struct call_cache_entry *
+call_cache_lookup(const char *name, uint32_t name_len)
+{
+	if (name_len == 0 || name_len > CALL_CACHE_NAME_MAX)
+		return NULL;
+	uint32_t slot = (name_len * 31 + (unsigned char)name[0] * 7 +
+			 (unsigned char)name[name_len - 1]) % CALL_CACHE_SIZE;
+	struct call_cache_entry *entry = &call_cache[slot];
+	if (entry->name_len != name_len ||
+	    memcmp(entry->name, name, name_len) != 0) {
+		if (entry->lua_path_ref != 0)
+			box_lua_path_delete(entry->lua_path_ref);
+		memcpy(entry->name, name, name_len);
+		entry->name_len = name_len;
+		entry->lua_path_ref = 0;
+		entry->func = func_by_name(name, name_len);
+		entry->func_cache_version = func_cache_version;
+	} else if (entry->func_cache_version != func_cache_version) {
+		entry->func = func_by_name(name, name_len);
+		entry->func_cache_version = func_cache_version;
+	}
+	return entry;
+}
+
 int
 box_process_call(struct call_request *request, struct port *port)
 {
@@ -155,12 +213,23 @@ box_process_call(struct call_request *request, struct port *port)
 	struct port args;
 	port_msgpack_create(&args, request->args,
 			    request->args_end - request->args);
-	struct func *func = func_by_name(name, name_len);
+	struct call_cache_entry *entry = call_cache_lookup(name, name_len);
+	struct func *func = entry != NULL ? entry->func :
+			    func_by_name(name, name_len);
 	if (func != NULL) {
 		rc = func_call(func, &args, port);
 	} else if ((rc = access_check_universe_object(PRIV_X | PRIV_U,
 				SC_FUNCTION, tt_cstr(name, name_len))) == 0) {
-		rc = box_lua_call(name, name_len, &args, port);
+		if (entry == NULL) {
+			rc = box_lua_call(name, name_len, &args, port);
+		} else {
+			if (entry->lua_path_ref == 0) {
+				entry->lua_path_ref =
+					box_lua_path_new(name, name_len);
+			}
+			rc = box_lua_call_path(entry->lua_path_ref, name,
+					       name_len, &args, port);
+		}
 	}
 	if (rc != 0)
 		return -1;
@@ -0,0 +1,330 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "cdc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+#include "fiber.h"
+#include "say.h"
+#include "cfg.h"
+#include "error.h"
+#include "gc.h"
+#include "iproto_constants.h"
+#include "replication.h"
+#include "schema_def.h"
+#include "wal.h"
+#include "xrow.h"
+
+enum {
+	/** Yield after reading this many rows from xlog files. */
+	CDC_YIELD_ROWS = 1024,
+};
+
+/** State of a cdc_cursor_read() call. */
+struct cdc_read {
+	/** Number of changes after which the batch may end. */
+	int limit;
+	/** Number of changes read so far. */
+	int count;
+	/** Number of rows read from xlog files so far. */
+	int64_t row_count;
+	/** Callback invoked for each change and its argument. */
+	cdc_cursor_cb cb;
+	void *arg;
+};
+
+static int
+cdc_space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *)a;
+	uint32_t id_b = *(const uint32_t *)b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+struct cdc_cursor *
+cdc_cursor_new(const char *name, const struct vclock *vclock,
+	       const uint32_t *space_ids, uint32_t space_count)
+{
+	/*
+	 * Rows following a vclock incomparable with the oldest
+	 * one stored may be missing too, but that will only be
+	 * found out when the xlog files are read.
+	 */
+	if (vclock_compare_ignore0(vclock, &gc.vclock) < 0) {
+		diag_set(XlogGapError, vclock, &gc.vclock);
+		return NULL;
+	}
+	struct cdc_cursor *cursor = calloc(1, sizeof(*cursor));
+	if (cursor == NULL) {
+		diag_set(OutOfMemory, sizeof(*cursor), "malloc",
+			 "struct cdc_cursor");
+		return NULL;
+	}
+	if (space_count > 0) {
+		cursor->space_ids = malloc(space_count * sizeof(*space_ids));
+		if (cursor->space_ids == NULL) {
+			diag_set(OutOfMemory, space_count * sizeof(*space_ids),
+				 "malloc", "space ids");
+			free(cursor);
+			return NULL;
+		}
+		memcpy(cursor->space_ids, space_ids,
+		       space_count * sizeof(*space_ids));
+		qsort(cursor->space_ids, space_count, sizeof(*space_ids),
+		      cdc_space_id_cmp);
+		cursor->space_count = space_count;
+	}
+	cursor->gc = gc_consumer_register(vclock, "cdc %s", name);
+	if (cursor->gc == NULL) {
+		free(cursor->space_ids);
+		free(cursor);
+		return NULL;
+	}
+	vclock_copy(&cursor->vclock, vclock);
+	xdir_create(&cursor->wal_dir, cfg_gets("wal_dir"), XLOG,
+		    &INSTANCE_UUID, &xlog_opts_default);
+	/* See recovery_new(). */
+	cursor->wal_dir.use_mmap = true;
+	cursor->xlog.state = XLOG_CURSOR_NEW;
+	cursor->eof_signature = -1;
+	cursor->wal_tail_pos = -1;
+	ibuf_create(&cursor->wal_tail_buf, &cord()->slabc, 1024);
+	return cursor;
+}
+
+/** Close the WAL file the cursor reads rows from, if any. */
+static void
+cdc_cursor_close_wal(struct cdc_cursor *cursor)
+{
+	if (xlog_cursor_is_open(&cursor->xlog))
+		xlog_cursor_close(&cursor->xlog, false);
+	cursor->xlog.state = XLOG_CURSOR_NEW;
+	cursor->eof_signature = -1;
+}
+
+void
+cdc_cursor_delete(struct cdc_cursor *cursor)
+{
+	assert(!cursor->is_busy);
+	cdc_cursor_close_wal(cursor);
+	ibuf_destroy(&cursor->wal_tail_buf);
+	xdir_destroy(&cursor->wal_dir);
+	gc_consumer_unregister(cursor->gc);
+	free(cursor->space_ids);
+	free(cursor);
+}
+
+int
+cdc_cursor_ack(struct cdc_cursor *cursor, const struct vclock *vclock)
+{
+	if (vclock_compare(vclock, &cursor->vclock) > 0) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "vclock is ahead of the cursor");
+		return -1;
+	}
+	gc_consumer_advance(cursor->gc, vclock);
+	return 0;
+}
+
+static bool
+cdc_cursor_has_space(struct cdc_cursor *cursor, uint32_t space_id)
+{
+	if (cursor->space_count == 0)
+		return space_id > BOX_SYSTEM_ID_MAX;
+	return bsearch(&space_id, cursor->space_ids, cursor->space_count,
+		       sizeof(space_id), cdc_space_id_cmp) != NULL;
+}
+
+/**
+ * Advance the cursor past a row and pass it to the callback
+ * if it's a change of one of the cursor spaces. Returns 1 if
+ * the batch is complete.
+ */
+static int
+cdc_cursor_process_row(struct cdc_cursor *cursor, struct xrow_header *row,
+		       struct cdc_read *read)
+{
+	/* Skip rows read before, see recover_xlog(). */
+	if (row->lsn <= vclock_get(&cursor->vclock, row->replica_id))
+		return 0;
+	vclock_follow_xrow(&cursor->vclock, row);
+	if (iproto_type_is_dml(row->type) && row->type != IPROTO_NOP) {
+		struct request request;
+		if (xrow_decode_dml(row, &request,
+				    dml_request_key_map(row->type)) != 0)
+			return -1;
+		if (cdc_cursor_has_space(cursor, request.space_id)) {
+			if (read->cb(row, &request, read->arg) != 0)
+				return -1;
+			read->count++;
+		}
+	}
+	/* Don't split transactions between batches. */
+	return read->count >= read->limit && row->is_commit ? 1 : 0;
+}
+
+/**
+ * Read rows written to WAL since the last call from memory.
+ * Returns 0 if the rows aren't in memory anymore and must be
+ * read from xlog files, 1 otherwise.
+ */
+static int
+cdc_cursor_read_wal_tail(struct cdc_cursor *cursor, struct cdc_read *read)
+{
+	struct ibuf *buf = &cursor->wal_tail_buf;
+	ibuf_reset(buf);
+	int64_t pos = cursor->wal_tail_pos;
+	if (wal_tail_read(&cursor->wal_tail_pos, &cursor->vclock, buf) != 0) {
+		cursor->wal_tail_pos = -1;
+		return 0;
+	}
+	/* The position in the current WAL file gets stale. */
+	cdc_cursor_close_wal(cursor);
+	const char *data = buf->rpos;
+	const char *data_end = buf->wpos;
+	while (data < data_end) {
+		struct xrow_header row;
+		int rc = wal_tail_next(&data, data_end, &row);
+		if (rc < 0)
+			return -1;
+		if (rc > 0)
+			continue;
+		rc = cdc_cursor_process_row(cursor, &row, read);
+		if (rc < 0)
+			return -1;
+		if (rc > 0) {
+			/*
+			 * Copy the rest of the rows again on the
+			 * next call, the ones read by now will be
+			 * skipped by vclock.
+			 */
+			if (data < data_end)
+				cursor->wal_tail_pos = pos;
+			break;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Open the WAL file containing the rows following the cursor
+ * vclock. Returns 1 if there's no such file.
+ */
+static int
+cdc_cursor_open_wal(struct cdc_cursor *cursor)
+{
+	if (xdir_scan(&cursor->wal_dir) != 0)
+		return -1;
+	vclockset_t *index = &cursor->wal_dir.index;
+	struct vclock *clock = vclockset_match(index, &cursor->vclock);
+	/* Skip the files read to the end, see recover_remaining_wals(). */
+	while (clock != NULL && vclock_sum(clock) <= cursor->eof_signature)
+		clock = vclockset_next(index, clock);
+	if (clock == NULL)
+		return 1;
+	if (cursor->eof_signature < 0 &&
+	    vclock_compare_ignore0(clock, &cursor->vclock) > 0) {
+		/* See recovery_open_log(). */
+		diag_set(XlogGapError, &cursor->vclock, clock);
+		return -1;
+	}
+	return xdir_open_cursor(&cursor->wal_dir, vclock_sum(clock),
+				&cursor->xlog);
+}
+
+/**
+ * Read rows from xlog files. Returns 1 if the batch is
+ * complete, 0 if all rows stored on disk have been read.
+ */
+static int
+cdc_cursor_read_wal(struct cdc_cursor *cursor, struct cdc_read *read)
+{
+	while (true) {
+		if (!xlog_cursor_is_open(&cursor->xlog)) {
+			int rc = cdc_cursor_open_wal(cursor);
+			if (rc != 0)
+				return rc < 0 ? -1 : 0;
+		}
+		struct xrow_header row;
+		int rc;
+		while ((rc = xlog_cursor_next(&cursor->xlog, &row,
+					      false)) == 0) {
+			rc = cdc_cursor_process_row(cursor, &row, read);
+			if (rc != 0)
+				return rc;
+			if (++read->row_count % CDC_YIELD_ROWS == 0)
+				fiber_sleep(0);
+		}
+		if (rc < 0)
+			return -1;
+		int64_t signature = vclock_sum(&cursor->xlog.meta.vclock);
+		if (!xlog_cursor_is_eof(&cursor->xlog)) {
+			/*
+			 * The file is being written, unless it was
+			 * not closed properly and there are newer
+			 * files.
+			 */
+			if (xdir_scan(&cursor->wal_dir) != 0)
+				return -1;
+			vclockset_t *index = &cursor->wal_dir.index;
+			struct vclock *clock = vclockset_search(index,
+					&cursor->xlog.meta.vclock);
+			if (clock != NULL &&
+			    vclockset_next(index, clock) == NULL)
+				return 0;
+			say_warn("file `%s` wasn't correctly closed",
+				 cursor->xlog.name);
+		}
+		xlog_cursor_close(&cursor->xlog, false);
+		cursor->eof_signature = signature;
+	}
+}
+
+int
+cdc_cursor_read(struct cdc_cursor *cursor, int limit,
+		cdc_cursor_cb cb, void *arg)
+{
+	assert(!cursor->is_busy);
+	struct cdc_read read;
+	read.limit = limit;
+	read.count = 0;
+	read.row_count = 0;
+	read.cb = cb;
+	read.arg = arg;
+	cursor->is_busy = true;
+	int rc = cdc_cursor_read_wal_tail(cursor, &read);
+	if (rc == 0)
+		rc = cdc_cursor_read_wal(cursor, &read);
+	cursor->is_busy = false;
+	return rc < 0 ? -1 : read.count;
+}
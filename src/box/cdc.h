@@ -0,0 +1,140 @@
+#ifndef TARANTOOL_BOX_CDC_H_INCLUDED
+#define TARANTOOL_BOX_CDC_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "small/ibuf.h"
+#include "vclock.h"
+#include "xlog.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct gc_consumer;
+struct request;
+struct xrow_header;
+
+/**
+ * A change data capture (CDC) cursor.
+ *
+ * A cursor reads data change requests of the given spaces
+ * written to the local WAL, both by this instance and received
+ * from other replicas, in the order they were written. Rows
+ * recently written to WAL are copied from memory, see
+ * wal_tail_read(), older ones are read from xlog files.
+ *
+ * The position of a cursor is a vclock. A consumer that saves
+ * the vclock returned along with a batch of changes atomically
+ * with the result of processing the batch can resume reading
+ * exactly where it stopped by opening a cursor at this vclock.
+ *
+ * WAL files following the vclock acknowledged by the consumer,
+ * see cdc_cursor_ack(), are pinned by a garbage collector
+ * consumer so that rows aren't removed before being processed.
+ */
+struct cdc_cursor {
+	/** Vclock of the last row read by the cursor. */
+	struct vclock vclock;
+	/** Sorted ids of spaces to read changes of. */
+	uint32_t *space_ids;
+	/**
+	 * Number of spaces to read changes of. If 0, changes
+	 * of all non-system spaces are read.
+	 */
+	uint32_t space_count;
+	/** Pins WAL files not acknowledged by the consumer. */
+	struct gc_consumer *gc;
+	/** Index of the WAL directory. */
+	struct xdir wal_dir;
+	/** WAL file rows are read from, if not from memory. */
+	struct xlog_cursor xlog;
+	/** Signature of the last WAL read to the end, or -1. */
+	int64_t eof_signature;
+	/** Position in the in-memory WAL, see wal_tail_read(). */
+	int64_t wal_tail_pos;
+	/** Buffer for rows copied from the in-memory WAL. */
+	struct ibuf wal_tail_buf;
+	/** Set while the cursor is read, which may yield. */
+	bool is_busy;
+};
+
+/**
+ * Callback invoked by cdc_cursor_read() for each change.
+ * Returns 0 to continue reading, -1 to abort it.
+ */
+typedef int
+(*cdc_cursor_cb)(const struct xrow_header *row,
+		 const struct request *request, void *arg);
+
+/**
+ * Open a cursor reading changes of the given spaces or of all
+ * non-system spaces if @a space_count is 0, starting after
+ * @a vclock. @a name is used for listing the cursor in
+ * box.info.gc().consumers. Returns NULL and sets diag if rows
+ * following @a vclock have already been removed.
+ */
+struct cdc_cursor *
+cdc_cursor_new(const char *name, const struct vclock *vclock,
+	       const uint32_t *space_ids, uint32_t space_count);
+
+/** Close a cursor and unpin WAL files. */
+void
+cdc_cursor_delete(struct cdc_cursor *cursor);
+
+/**
+ * Read the next batch of changes, calling @a cb for each of
+ * them. A batch ends at a transaction boundary after at least
+ * @a limit changes or when there are no more rows to read, so
+ * it may be empty. The cursor vclock is advanced past all rows
+ * read, including ones of other spaces. Reading xlog files
+ * yields. Returns the number of changes read or -1 on error.
+ */
+int
+cdc_cursor_read(struct cdc_cursor *cursor, int limit,
+		cdc_cursor_cb cb, void *arg);
+
+/**
+ * Acknowledge that all changes up to @a vclock have been
+ * processed by the consumer so that WAL files containing
+ * them may be removed. Returns -1 and sets diag if the
+ * vclock is ahead of the cursor.
+ */
+int
+cdc_cursor_ack(struct cdc_cursor *cursor, const struct vclock *vclock);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_CDC_H_INCLUDED */
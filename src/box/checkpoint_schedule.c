@@ -74,3 +74,52 @@ checkpoint_schedule_timeout(struct checkpoint_schedule *sched, double now)
 	assert(timeout > 0);
 	return timeout;
 }
+
+void
+checkpoint_schedule_cfg_recovery_time(struct checkpoint_schedule *sched,
+				      double recovery_time)
+{
+	sched->recovery_time = recovery_time;
+}
+
+void
+checkpoint_schedule_add_checkpoint_time(struct checkpoint_schedule *sched,
+					double duration)
+{
+	/*
+	 * Smooth out the estimate, because the time of writing
+	 * a checkpoint depends on the load of the instance.
+	 */
+	if (sched->load_time == 0)
+		sched->load_time = duration;
+	else
+		sched->load_time = 0.7 * sched->load_time + 0.3 * duration;
+}
+
+void
+checkpoint_schedule_set_replay_rate(struct checkpoint_schedule *sched,
+				    double rate)
+{
+	sched->replay_rate = rate;
+}
+
+int64_t
+checkpoint_schedule_wal_budget(struct checkpoint_schedule *sched)
+{
+	if (sched->recovery_time <= 0)
+		return INT64_MAX; /* the target is disabled */
+
+	double rate = sched->replay_rate;
+	if (rate <= 0)
+		rate = CHECKPOINT_DEFAULT_REPLAY_RATE;
+
+	/* Time left for replaying WALs after loading a checkpoint. */
+	double replay_time = sched->recovery_time - sched->load_time;
+	if (replay_time <= 0)
+		return 0;
+
+	double budget = replay_time * rate;
+	if (budget >= (double)INT64_MAX)
+		return INT64_MAX;
+	return (int64_t)budget;
+}
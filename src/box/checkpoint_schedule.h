@@ -31,10 +31,20 @@
  * SUCH DAMAGE.
  */
 
+#include <stdint.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+enum {
+	/**
+	 * WAL replay rate assumed until it is measured on
+	 * local recovery, in bytes per second.
+	 */
+	CHECKPOINT_DEFAULT_REPLAY_RATE = 32 * 1024 * 1024,
+};
+
 struct checkpoint_schedule {
 	/**
 	 * Configured interval between checkpoints, in seconds.
@@ -46,6 +56,23 @@ struct checkpoint_schedule {
 	 * for calculating times of all subsequent checkpoints.
 	 */
 	double start_time;
+	/**
+	 * Configured target of the time needed to recover from
+	 * the last checkpoint and the WALs written after it, in
+	 * seconds. Set to 0 if the target is disabled.
+	 */
+	double recovery_time;
+	/**
+	 * Estimated time of loading the last checkpoint, in
+	 * seconds. Approximated with the average time of writing
+	 * a checkpoint, 0 if no checkpoint has been written yet.
+	 */
+	double load_time;
+	/**
+	 * Measured WAL replay rate, in bytes per second, or 0
+	 * if it hasn't been measured yet.
+	 */
+	double replay_rate;
 };
 
 /**
@@ -78,6 +105,37 @@ checkpoint_schedule_reset(struct checkpoint_schedule *sched, double now);
 double
 checkpoint_schedule_timeout(struct checkpoint_schedule *sched, double now);
 
+/**
+ * Configure the target of the recovery time, in seconds.
+ * Setting it to 0 disables the target.
+ */
+void
+checkpoint_schedule_cfg_recovery_time(struct checkpoint_schedule *sched,
+				      double recovery_time);
+
+/**
+ * Account the time it took to write a checkpoint, in seconds,
+ * in the estimate of the time of loading a checkpoint.
+ */
+void
+checkpoint_schedule_add_checkpoint_time(struct checkpoint_schedule *sched,
+					double duration);
+
+/**
+ * Set the measured WAL replay rate, in bytes per second.
+ */
+void
+checkpoint_schedule_set_replay_rate(struct checkpoint_schedule *sched,
+				    double rate);
+
+/**
+ * Return the size of WALs that may be written after the last
+ * checkpoint without exceeding the recovery time target. If the
+ * target is disabled, returns INT64_MAX.
+ */
+int64_t
+checkpoint_schedule_wal_budget(struct checkpoint_schedule *sched);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
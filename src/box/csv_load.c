@@ -0,0 +1,480 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "csv_load.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "coio_task.h"
+#include "diag.h"
+#include "fiber.h"
+#include "msgpuck.h"
+#include "csv/csv.h"
+#include "trivia/util.h"
+#include "tt_static.h"
+
+#include "box.h"
+#include "errcode.h"
+#include "field_def.h"
+#include "schema.h"
+#include "space.h"
+#include "txn.h"
+
+enum {
+	/** Size of a single read from a CSV file. */
+	CSV_LOAD_CHUNK_SIZE = 1024 * 1024,
+	/** Max length of a field converted to a number. */
+	CSV_LOAD_NUMBER_MAX = 64,
+};
+
+void
+csv_load_opts_create(struct csv_load_opts *opts)
+{
+	opts->delimiter = ',';
+	opts->quote_char = '"';
+	opts->skip_head_lines = 0;
+	opts->batch_size = 1000;
+}
+
+/** A growing malloc'ed buffer. */
+struct csv_load_buf {
+	char *data;
+	size_t size;
+	size_t capacity;
+};
+
+/**
+ * Reserve @a size bytes at the end of a buffer. Returns NULL
+ * and sets diag on error.
+ */
+static char *
+csv_load_buf_reserve(struct csv_load_buf *buf, size_t size)
+{
+	if (buf->size + size > buf->capacity) {
+		size_t capacity = MAX(buf->capacity * 2, buf->size + size);
+		capacity = MAX(capacity, 4096);
+		char *data = realloc(buf->data, capacity);
+		if (data == NULL) {
+			diag_set(OutOfMemory, capacity, "realloc", "buffer");
+			return NULL;
+		}
+		buf->data = data;
+		buf->capacity = capacity;
+	}
+	return buf->data + buf->size;
+}
+
+/** Tuples parsed from a part of a CSV file. */
+struct csv_load_batch {
+	/** Concatenated MessagePack arrays. */
+	struct csv_load_buf data;
+	/** Number of tuples. */
+	uint32_t count;
+};
+
+/**
+ * Parser state. It is used by one coio thread at a time, the
+ * tx thread only waits for the parser to finish a batch.
+ */
+struct csv_load_parser {
+	const char *path;
+	int fd;
+	bool is_eof;
+	struct csv csv;
+	/** Buffer for a chunk read from the file. */
+	char *chunk;
+	/** Types of the fields of the space format. */
+	enum field_type *types;
+	/** Nullability of the fields of the space format. */
+	bool *is_nullable;
+	uint32_t field_count;
+	/** Encoded fields of the current row. */
+	struct csv_load_buf row;
+	/** Number of fields in the current row. */
+	uint32_t row_field_count;
+	/** Length of the text of the current row. */
+	size_t row_len;
+	/** Number of rows parsed so far, including skipped ones. */
+	uint64_t row_no;
+	/** Number of rows to skip at the beginning. */
+	uint32_t skip_rows;
+	/** Batch being filled. */
+	struct csv_load_batch *batch;
+	/** Set on error in a callback, diag is set. */
+	bool is_failed;
+};
+
+/**
+ * Encode a field converted from text to a non-string type.
+ * Returns NULL if the text can't be converted.
+ */
+static char *
+csv_load_encode_field(char *pos, enum field_type type,
+		      const char *field, size_t len)
+{
+	char str[CSV_LOAD_NUMBER_MAX];
+	if (len == 0 || len >= sizeof(str))
+		return NULL;
+	memcpy(str, field, len);
+	str[len] = '\0';
+	char *str_end;
+	switch (type) {
+	case FIELD_TYPE_BOOLEAN:
+		if (strcmp(str, "true") == 0)
+			return mp_encode_bool(pos, true);
+		if (strcmp(str, "false") == 0)
+			return mp_encode_bool(pos, false);
+		return NULL;
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+	case FIELD_TYPE_NUMBER:
+		errno = 0;
+		if (str[0] == '-') {
+			long long value = strtoll(str, &str_end, 10);
+			if (*str_end == '\0' && errno == 0 &&
+			    type != FIELD_TYPE_UNSIGNED) {
+				if (value >= 0)
+					return mp_encode_uint(pos, value);
+				return mp_encode_int(pos, value);
+			}
+		} else {
+			unsigned long long value = strtoull(str, &str_end, 10);
+			if (*str_end == '\0' && errno == 0)
+				return mp_encode_uint(pos, value);
+		}
+		if (type != FIELD_TYPE_NUMBER)
+			return NULL;
+		FALLTHROUGH;
+	case FIELD_TYPE_DOUBLE: {
+		errno = 0;
+		double value = strtod(str, &str_end);
+		if (*str_end != '\0' || errno != 0)
+			return NULL;
+		return mp_encode_double(pos, value);
+	}
+	default:
+		unreachable();
+		return NULL;
+	}
+}
+
+/**
+ * Encode a field of the current row according to the space
+ * format. Returns NULL and sets diag on error.
+ */
+static char *
+csv_load_convert_field(struct csv_load_parser *p, char *pos,
+		       uint32_t fieldno, const char *field, uint32_t len)
+{
+	enum field_type type = FIELD_TYPE_STRING;
+	bool is_nullable = false;
+	if (fieldno < p->field_count) {
+		type = p->types[fieldno];
+		is_nullable = p->is_nullable[fieldno];
+	}
+	if (len == 0 && is_nullable)
+		return mp_encode_nil(pos);
+	if (type == FIELD_TYPE_ANY || type == FIELD_TYPE_STRING ||
+	    type == FIELD_TYPE_SCALAR)
+		return mp_encode_str(pos, field, len);
+	pos = csv_load_encode_field(pos, type, field, len);
+	if (pos == NULL) {
+		diag_set(IllegalParams, "CSV row %llu, field %u: "
+			 "'%.*s' can't be converted to %s",
+			 (unsigned long long)p->row_no, fieldno + 1,
+			 (int)MIN(len, 32), field, field_type_strs[type]);
+	}
+	return pos;
+}
+
+/** Save a field of the current row as a MessagePack string. */
+static void
+csv_load_emit_field(void *ctx, const char *field, const char *end)
+{
+	struct csv_load_parser *p = ctx;
+	if (p->is_failed)
+		return;
+	size_t len = end - field;
+	char *pos = csv_load_buf_reserve(&p->row, mp_sizeof_str(len));
+	if (pos == NULL) {
+		p->is_failed = true;
+		return;
+	}
+	pos = mp_encode_str(pos, field, len);
+	p->row.size = pos - p->row.data;
+	p->row_field_count++;
+	p->row_len += len;
+}
+
+/** Convert the current row and append it to the batch. */
+static void
+csv_load_emit_row(void *ctx)
+{
+	struct csv_load_parser *p = ctx;
+	uint32_t field_count = p->row_field_count;
+	bool is_blank = p->row_len == 0 && field_count <= 1;
+	p->row_field_count = 0;
+	p->row_len = 0;
+	if (p->is_failed || is_blank)
+		goto out;
+	if (++p->row_no <= p->skip_rows)
+		goto out;
+	/* A converted field is never longer than 9 bytes. */
+	struct csv_load_batch *batch = p->batch;
+	char *pos = csv_load_buf_reserve(&batch->data,
+					 mp_sizeof_array(field_count) +
+					 p->row.size + field_count * 9);
+	if (pos == NULL) {
+		p->is_failed = true;
+		goto out;
+	}
+	pos = mp_encode_array(pos, field_count);
+	const char *field = p->row.data;
+	for (uint32_t i = 0; i < field_count; i++) {
+		uint32_t len;
+		const char *str = mp_decode_str(&field, &len);
+		pos = csv_load_convert_field(p, pos, i, str, len);
+		if (pos == NULL) {
+			p->is_failed = true;
+			goto out;
+		}
+	}
+	batch->data.size = pos - batch->data.data;
+	batch->count++;
+out:
+	p->row.size = 0;
+}
+
+/**
+ * Parse the file until a batch gets at least @a batch_size rows
+ * or the file ends. Runs in a coio thread.
+ */
+static ssize_t
+csv_load_parse_f(va_list ap)
+{
+	struct csv_load_parser *p = va_arg(ap, struct csv_load_parser *);
+	struct csv_load_batch *batch = va_arg(ap, struct csv_load_batch *);
+	uint32_t batch_size = va_arg(ap, uint32_t);
+	batch->data.size = 0;
+	batch->count = 0;
+	p->batch = batch;
+	if (p->fd < 0) {
+		p->fd = open(p->path, O_RDONLY);
+		if (p->fd < 0) {
+			diag_set(SystemError, "failed to open '%s'", p->path);
+			return -1;
+		}
+	}
+	while (batch->count < batch_size && !p->is_eof) {
+		ssize_t n = read(p->fd, p->chunk, CSV_LOAD_CHUNK_SIZE);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			diag_set(SystemError, "failed to read '%s'", p->path);
+			return -1;
+		}
+		if (n == 0) {
+			csv_finish_parsing(&p->csv);
+			p->is_eof = true;
+		} else {
+			csv_parse_chunk(&p->csv, p->chunk, p->chunk + n);
+		}
+		if (p->is_failed)
+			return -1;
+		if (csv_get_error_status(&p->csv) != CSV_ER_OK) {
+			diag_set(IllegalParams, "CSV file '%s' is malformed "
+				 "near row %llu", p->path,
+				 (unsigned long long)p->row_no + 1);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+csv_load_parse_fiber_f(va_list ap)
+{
+	struct csv_load_parser *p = va_arg(ap, struct csv_load_parser *);
+	struct csv_load_batch *batch = va_arg(ap, struct csv_load_batch *);
+	uint32_t batch_size = va_arg(ap, uint32_t);
+	if (coio_call(csv_load_parse_f, p, batch, batch_size) != 0)
+		return -1;
+	return 0;
+}
+
+/**
+ * Start parsing the next batch in a coio thread. The returned
+ * fiber must be joined.
+ */
+static struct fiber *
+csv_load_parse_start(struct csv_load_parser *p,
+		     struct csv_load_batch *batch, uint32_t batch_size)
+{
+	struct fiber *f = fiber_new("csv_load", csv_load_parse_fiber_f);
+	if (f == NULL)
+		return NULL;
+	fiber_set_joinable(f, true);
+	fiber_start(f, p, batch, batch_size);
+	return f;
+}
+
+/** Insert a batch in transactions of @a batch_size rows. */
+static int
+csv_load_insert(uint32_t space_id, const struct csv_load_batch *batch,
+		uint32_t batch_size, uint64_t *count)
+{
+	const char *data = batch->data.data;
+	uint32_t i = 0;
+	while (i < batch->count) {
+		if (box_txn_begin() != 0)
+			return -1;
+		uint32_t txn_count = MIN(batch_size, batch->count - i);
+		for (uint32_t j = 0; j < txn_count; j++) {
+			const char *end = data;
+			mp_next(&end);
+			if (box_insert(space_id, data, end, NULL) != 0) {
+				box_txn_rollback();
+				return -1;
+			}
+			data = end;
+		}
+		if (box_txn_commit() != 0)
+			return -1;
+		i += txn_count;
+		*count += txn_count;
+	}
+	return 0;
+}
+
+int
+csv_load(uint32_t space_id, const char *path,
+	 const struct csv_load_opts *opts, uint64_t *count)
+{
+	assert(opts->batch_size > 0);
+	*count = 0;
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	struct csv_load_parser p;
+	memset(&p, 0, sizeof(p));
+	p.path = path;
+	p.fd = -1;
+	p.skip_rows = opts->skip_head_lines;
+	p.field_count = space->def->field_count;
+	struct csv_load_batch batches[2];
+	memset(batches, 0, sizeof(batches));
+	int rc = -1;
+
+	p.types = malloc(p.field_count * sizeof(*p.types) + 1);
+	p.is_nullable = malloc(p.field_count * sizeof(*p.is_nullable) + 1);
+	p.chunk = malloc(CSV_LOAD_CHUNK_SIZE);
+	if (p.types == NULL || p.is_nullable == NULL || p.chunk == NULL) {
+		diag_set(OutOfMemory, CSV_LOAD_CHUNK_SIZE, "malloc",
+			 "CSV parser");
+		goto out_free;
+	}
+	for (uint32_t i = 0; i < p.field_count; i++) {
+		const struct field_def *field = &space->def->fields[i];
+		switch (field->type) {
+		case FIELD_TYPE_ANY:
+		case FIELD_TYPE_UNSIGNED:
+		case FIELD_TYPE_STRING:
+		case FIELD_TYPE_NUMBER:
+		case FIELD_TYPE_DOUBLE:
+		case FIELD_TYPE_INTEGER:
+		case FIELD_TYPE_BOOLEAN:
+		case FIELD_TYPE_SCALAR:
+			break;
+		default:
+			diag_set(ClientError, ER_UNSUPPORTED,
+				 tt_sprintf("Field type '%s'",
+					    field_type_strs[field->type]),
+				 "CSV load");
+			goto out_free;
+		}
+		p.types[i] = field->type;
+		p.is_nullable[i] = field->is_nullable;
+	}
+	csv_create(&p.csv);
+	csv_setopt(&p.csv, CSV_OPT_DELIMITER, opts->delimiter);
+	csv_setopt(&p.csv, CSV_OPT_QUOTE, opts->quote_char);
+	csv_setopt(&p.csv, CSV_OPT_EMIT_FIELD, csv_load_emit_field);
+	csv_setopt(&p.csv, CSV_OPT_EMIT_ROW, csv_load_emit_row);
+	csv_setopt(&p.csv, CSV_OPT_EMIT_CTX, &p);
+
+	/*
+	 * Parse the next batch in a coio thread while the current
+	 * one is inserted.
+	 */
+	struct fiber *parser = csv_load_parse_start(&p, &batches[0],
+						    opts->batch_size);
+	for (int i = 0; parser != NULL; i++) {
+		if (fiber_join(parser) != 0)
+			goto out;
+		parser = NULL;
+		if (!p.is_eof) {
+			parser = csv_load_parse_start(&p, &batches[(i + 1) % 2],
+						      opts->batch_size);
+			if (parser == NULL)
+				goto out;
+		}
+		if (csv_load_insert(space_id, &batches[i % 2],
+				    opts->batch_size, count) != 0) {
+			if (parser != NULL) {
+				/* Keep the insert error. */
+				struct diag diag;
+				diag_create(&diag);
+				diag_move(diag_get(), &diag);
+				fiber_join(parser);
+				diag_move(&diag, diag_get());
+				diag_destroy(&diag);
+			}
+			goto out;
+		}
+	}
+	if (p.is_eof)
+		rc = 0;
+out:
+	csv_destroy(&p.csv);
+	if (p.fd >= 0)
+		close(p.fd);
+out_free:
+	free(batches[0].data.data);
+	free(batches[1].data.data);
+	free(p.row.data);
+	free(p.chunk);
+	free(p.is_nullable);
+	free(p.types);
+	return rc;
+}
@@ -0,0 +1,84 @@
+#ifndef TARANTOOL_BOX_CSV_LOAD_H_INCLUDED
+#define TARANTOOL_BOX_CSV_LOAD_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** Options of a CSV load. */
+struct csv_load_opts {
+	/** Field delimiter. */
+	char delimiter;
+	/** Quote character. */
+	char quote_char;
+	/** Number of rows to skip at the beginning, e.g. a header. */
+	uint32_t skip_head_lines;
+	/** Number of rows inserted in one transaction. */
+	uint32_t batch_size;
+};
+
+/** Initialize CSV load options with default values. */
+void
+csv_load_opts_create(struct csv_load_opts *opts);
+
+/**
+ * Load a CSV file into a space.
+ *
+ * The file is read and parsed in a coio thread chunk by chunk.
+ * Fields are converted to MessagePack according to the types
+ * of the space format: unsigned, integer, number, double and
+ * boolean fields are converted from text, empty nullable fields
+ * become nil, other fields are stored as strings. Fields of
+ * other types aren't supported.
+ *
+ * Rows are inserted in transactions of batch_size rows while
+ * the next chunk is parsed. On error, the rows inserted by the
+ * committed transactions stay in the space.
+ *
+ * @param space_id id of the space to load.
+ * @param path path to the CSV file.
+ * @param opts load options.
+ * @param[out] count number of inserted rows.
+ * @retval 0 success.
+ * @retval -1 error, diag is set.
+ */
+int
+csv_load(uint32_t space_id, const char *path,
+	 const struct csv_load_opts *opts, uint64_t *count);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_CSV_LOAD_H_INCLUDED */
@@ -216,6 +216,13 @@ enum {
 	 * transactions w/o throwing ER_CROSS_ENGINE_TRANSACTION.
 	 */
 	ENGINE_BYPASS_TX = 1 << 0,
+	/**
+	 * If set, reading a tuple from a secondary index takes
+	 * a lookup in the primary index, and the lookup can be
+	 * avoided with index_create_key_iterator() for spaces
+	 * that don't defer deletes.
+	 */
+	ENGINE_KEY_ITERATOR = 1 << 1,
 };
 
 struct engine {
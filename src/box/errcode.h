@@ -271,6 +271,8 @@ struct errcode_record {
         /*216 */_(ER_SYNC_QUORUM_TIMEOUT,       "Quorum collection for a synchronous transaction is timed out") \
         /*217 */_(ER_SYNC_ROLLBACK,             "A rollback for a synchronous transaction is received") \
 	/*218 */_(ER_TUPLE_METADATA_IS_TOO_BIG,	"Can't create tuple: metadata size %u is too big") \
+	/*219 */_(ER_NO_SUCH_SQL_CURSOR,	"SQL cursor with id %u does not exist") \
+	/*220 */_(ER_NO_SUCH_ITERATOR,		"Iterator with id %u does not exist") \
 
 /*
  * !IMPORTANT! Please follow instructions at start of the file
@@ -73,7 +73,17 @@ static_assert(sizeof(struct port_sql) <= sizeof(struct port),
  * |                                              |
  * |     IPROTO_DATA: [                           |
  * |         tuple, tuple, tuple, ...             |
- * |     ]                                        |
+ * |     ],                                       |
+ * |                                              |
+ * |     IPROTO_SQL_CURSOR_ID: number (optional)  |
+ * | }                                            |
+ * +-------------------- OR ----------------------+
+ * | IPROTO_BODY: {                               |
+ * |     IPROTO_DATA: [                           |
+ * |         tuple, tuple, tuple, ...             |
+ * |     ],                                       |
+ * |                                              |
+ * |     IPROTO_SQL_CURSOR_ID: number (optional)  |
  * | }                                            |
  * +-------------------- OR ----------------------+
  * | IPROTO_BODY: {                               |
@@ -129,6 +139,7 @@ port_sql_create(struct port *port, struct sql_stmt *stmt,
 	port_sql->stmt = stmt;
 	port_sql->serialization_format = format;
 	port_sql->do_finalize = do_finalize;
+	port_sql->cursor_id = 0;
 }
 
 /**
@@ -476,8 +487,13 @@ port_sql_dump_msgpack(struct port *port, struct obuf *out)
 	struct port_sql *sql_port = (struct port_sql *)port;
 	struct sql_stmt *stmt = sql_port->stmt;
 	switch (sql_port->serialization_format) {
-	case DQL_EXECUTE: {
-		int keys = 2;
+	case DQL_EXECUTE:
+	case DQL_FETCH: {
+		uint32_t cursor_id = sql_port->cursor_id;
+		int keys = sql_port->serialization_format == DQL_EXECUTE ?
+			   2 : 1;
+		if (cursor_id != 0)
+			keys++;
 		int size = mp_sizeof_map(keys);
 		char *pos = (char *) obuf_alloc(out, size);
 		if (pos == NULL) {
@@ -485,7 +501,8 @@ port_sql_dump_msgpack(struct port *port, struct obuf *out)
 			return -1;
 		}
 		pos = mp_encode_map(pos, keys);
-		if (sql_get_metadata(stmt, out, sql_column_count(stmt)) != 0)
+		if (sql_port->serialization_format == DQL_EXECUTE &&
+		    sql_get_metadata(stmt, out, sql_column_count(stmt)) != 0)
 			return -1;
 		size = mp_sizeof_uint(IPROTO_DATA);
 		pos = (char *) obuf_alloc(out, size);
@@ -496,6 +513,17 @@ port_sql_dump_msgpack(struct port *port, struct obuf *out)
 		pos = mp_encode_uint(pos, IPROTO_DATA);
 		if (port_c_vtab.dump_msgpack(port, out) < 0)
 			return -1;
+		if (cursor_id == 0)
+			break;
+		size = mp_sizeof_uint(IPROTO_SQL_CURSOR_ID) +
+		       mp_sizeof_uint(cursor_id);
+		pos = (char *) obuf_alloc(out, size);
+		if (pos == NULL) {
+			diag_set(OutOfMemory, size, "obuf_alloc", "pos");
+			return -1;
+		}
+		pos = mp_encode_uint(pos, IPROTO_SQL_CURSOR_ID);
+		pos = mp_encode_uint(pos, cursor_id);
 		break;
 	}
 	case DML_EXECUTE: {
@@ -733,11 +761,73 @@ sql_execute_prepared(uint32_t stmt_id, const struct sql_bind *bind,
 	return 0;
 }
 
+/**
+ * Execute SQL statement using the plan cache: replace literals
+ * with parameters, find the plan compiled from the normalized
+ * text or compile and cache it, then bind the literal values.
+ *
+ * @retval  0 Success.
+ * @retval -1 Error.
+ * @retval  1 The statement can't use the plan cache.
+ */
+static int
+sql_execute_cached(const char *sql, int len, struct port *port,
+		   struct region *region)
+{
+	size_t svp = region_used(region);
+	char *norm_sql;
+	int norm_len;
+	struct sql_bind *bind;
+	uint32_t bind_count;
+	if (sql_normalize(sql, len, region, &norm_sql, &norm_len, &bind,
+			  &bind_count) != 0)
+		return -1;
+	if (norm_sql == NULL) {
+		region_truncate(region, svp);
+		return 1;
+	}
+	uint32_t sql_flags = current_session()->sql_flags;
+	struct sql_stmt *stmt = sql_plan_cache_find(norm_sql, norm_len,
+						    sql_flags);
+	bool do_finalize = false;
+	if (stmt == NULL || sql_stmt_busy(stmt) ||
+	    !sql_stmt_schema_version_is_valid(stmt)) {
+		if (sql_stmt_compile(norm_sql, norm_len, NULL, &stmt,
+				     NULL) != 0) {
+			/* Let the original text report the error. */
+			diag_clear(diag_get());
+			region_truncate(region, svp);
+			return 1;
+		}
+		do_finalize = !sql_plan_cache_insert(stmt, sql_flags);
+	}
+	enum sql_serialization_format format = sql_column_count(stmt) > 0 ?
+					       DQL_EXECUTE : DML_EXECUTE;
+	port_sql_create(port, stmt, format, do_finalize);
+	int rc = 0;
+	if (sql_bind(stmt, bind, bind_count) != 0 ||
+	    sql_execute(stmt, port, region) != 0) {
+		port_destroy(port);
+		rc = -1;
+	}
+	if (!do_finalize) {
+		sql_stmt_reset(stmt);
+		/* Bound strings are allocated on the region. */
+		sql_unbind(stmt);
+	}
+	return rc;
+}
+
 int
 sql_prepare_and_execute(const char *sql, int len, const struct sql_bind *bind,
 			uint32_t bind_count, struct port *port,
 			struct region *region)
 {
+	if (bind_count == 0) {
+		int rc = sql_execute_cached(sql, len, port, region);
+		if (rc <= 0)
+			return rc;
+	}
 	struct sql_stmt *stmt;
 	if (sql_stmt_compile(sql, len, NULL, &stmt, NULL) != 0)
 		return -1;
@@ -751,3 +841,244 @@ sql_prepare_and_execute(const char *sql, int len, const struct sql_bind *bind,
 	port_destroy(port);
 	return -1;
 }
+
+/**
+ * Server-side SQL cursor: a statement in the middle of execution,
+ * which result set is sent to the client in chunks.
+ */
+struct sql_cursor {
+	/** Statement owned by the cursor. */
+	struct sql_stmt *stmt;
+	/** True while a chunk of rows is being fetched. */
+	bool is_busy;
+};
+
+/** The last id assigned to a cursor. */
+static uint32_t sql_cursor_id_max = 0;
+
+static void
+sql_cursor_delete(struct sql_cursor *cursor)
+{
+	sql_stmt_finalize(cursor->stmt);
+	free(cursor);
+}
+
+/**
+ * Create a cursor in the current session for a statement which
+ * has more rows to return. The cursor takes the ownership of the
+ * statement.
+ *
+ * @retval Cursor id, or 0 on memory error.
+ */
+static uint32_t
+sql_cursor_new(struct sql_stmt *stmt)
+{
+	struct session *session = current_session();
+	if (session->sql_cursors == NULL) {
+		session->sql_cursors = mh_i32ptr_new();
+		if (session->sql_cursors == NULL) {
+			diag_set(OutOfMemory, 0, "mh_i32ptr_new",
+				 "session cursor hash");
+			return 0;
+		}
+	}
+	struct sql_cursor *cursor =
+		(struct sql_cursor *) malloc(sizeof(*cursor));
+	if (cursor == NULL) {
+		diag_set(OutOfMemory, sizeof(*cursor), "malloc", "cursor");
+		return 0;
+	}
+	cursor->stmt = stmt;
+	cursor->is_busy = false;
+	if (++sql_cursor_id_max == 0)
+		sql_cursor_id_max = 1;
+	const struct mh_i32ptr_node_t node = { sql_cursor_id_max, cursor };
+	mh_int_t i = mh_i32ptr_put(session->sql_cursors, &node, NULL, NULL);
+	if (i == mh_end(session->sql_cursors)) {
+		free(cursor);
+		diag_set(OutOfMemory, 0, "mh_i32ptr_put", "mh_i32ptr_node");
+		return 0;
+	}
+	return sql_cursor_id_max;
+}
+
+void
+sql_session_cursor_hash_erase(struct mh_i32ptr_t *hash)
+{
+	if (hash == NULL)
+		return;
+	mh_int_t i;
+	mh_foreach(hash, i) {
+		struct sql_cursor *cursor = (struct sql_cursor *)
+			mh_i32ptr_node(hash, i)->val;
+		assert(!cursor->is_busy);
+		sql_cursor_delete(cursor);
+	}
+	mh_i32ptr_delete(hash);
+}
+
+/**
+ * Step a statement until it returns @a fetch_size rows or
+ * completes. The rows are appended to @a port.
+ *
+ * @retval  0 The statement is complete.
+ * @retval  1 The statement may have more rows.
+ * @retval -1 Error.
+ */
+static int
+sql_execute_chunk(struct sql_stmt *stmt, uint32_t fetch_size,
+		  struct port *port, struct region *region)
+{
+	int column_count = sql_column_count(stmt);
+	assert(column_count > 0);
+	for (uint32_t i = 0; i < fetch_size; i++) {
+		int rc = sql_step(stmt);
+		if (rc == SQL_DONE)
+			return 0;
+		if (rc != SQL_ROW)
+			return -1;
+		if (sql_row_to_port(stmt, column_count, region, port) != 0)
+			return -1;
+	}
+	return 1;
+}
+
+/**
+ * Execute a compiled statement, which is owned by the caller,
+ * returning at most @a fetch_size rows. The statement is either
+ * finalized with the port or passed to a new cursor.
+ */
+static int
+sql_execute_and_open_cursor(struct sql_stmt *stmt,
+			    const struct sql_bind *bind, uint32_t bind_count,
+			    uint32_t fetch_size, struct port *port,
+			    struct region *region)
+{
+	assert(fetch_size > 0);
+	if (sql_column_count(stmt) == 0) {
+		port_sql_create(port, stmt, DML_EXECUTE, true);
+		if (sql_bind(stmt, bind, bind_count) == 0 &&
+		    sql_execute(stmt, port, region) == 0)
+			return 0;
+		port_destroy(port);
+		return -1;
+	}
+	rmean_collect(rmean_box, IPROTO_EXECUTE, 1);
+	port_sql_create(port, stmt, DQL_EXECUTE, true);
+	int rc;
+	/*
+	 * Bound strings point to the request, which is gone
+	 * by the time the next chunk is fetched.
+	 */
+	if (sql_bind(stmt, bind, bind_count) != 0 ||
+	    sql_bind_copy_static(stmt) != 0)
+		goto error;
+	rc = sql_execute_chunk(stmt, fetch_size, port, region);
+	if (rc < 0)
+		goto error;
+	if (rc > 0) {
+		uint32_t cursor_id = sql_cursor_new(stmt);
+		if (cursor_id == 0)
+			goto error;
+		struct port_sql *port_sql = (struct port_sql *) port;
+		port_sql->cursor_id = cursor_id;
+		port_sql->do_finalize = false;
+	}
+	return 0;
+error:
+	port_destroy(port);
+	return -1;
+}
+
+int
+sql_prepare_and_open_cursor(const char *sql, int len,
+			    const struct sql_bind *bind, uint32_t bind_count,
+			    uint32_t fetch_size, struct port *port,
+			    struct region *region)
+{
+	struct sql_stmt *stmt;
+	if (sql_stmt_compile(sql, len, NULL, &stmt, NULL) != 0)
+		return -1;
+	assert(stmt != NULL);
+	return sql_execute_and_open_cursor(stmt, bind, bind_count, fetch_size,
+					   port, region);
+}
+
+int
+sql_execute_prepared_and_open_cursor(uint32_t stmt_id,
+				     const struct sql_bind *bind,
+				     uint32_t bind_count, uint32_t fetch_size,
+				     struct port *port, struct region *region)
+{
+	if (!session_check_stmt_id(current_session(), stmt_id)) {
+		diag_set(ClientError, ER_WRONG_QUERY_ID, stmt_id);
+		return -1;
+	}
+	struct sql_stmt *stmt = sql_stmt_cache_find(stmt_id);
+	assert(stmt != NULL);
+	if (!sql_stmt_schema_version_is_valid(stmt)) {
+		diag_set(ClientError, ER_SQL_EXECUTE, "statement has expired");
+		return -1;
+	}
+	/*
+	 * The cached statement can't be kept busy by a cursor,
+	 * so the cursor gets its own copy.
+	 */
+	const char *sql_str = sql_stmt_query_str(stmt);
+	return sql_prepare_and_open_cursor(sql_str, strlen(sql_str), bind,
+					   bind_count, fetch_size, port,
+					   region);
+}
+
+int
+sql_cursor_fetch(uint32_t cursor_id, uint32_t fetch_size, struct port *port,
+		 struct region *region)
+{
+	assert(fetch_size > 0);
+	struct mh_i32ptr_t *hash = current_session()->sql_cursors;
+	mh_int_t i;
+	if (hash == NULL ||
+	    (i = mh_i32ptr_find(hash, cursor_id, NULL)) == mh_end(hash)) {
+		diag_set(ClientError, ER_NO_SUCH_SQL_CURSOR, cursor_id);
+		return -1;
+	}
+	struct sql_cursor *cursor =
+		(struct sql_cursor *) mh_i32ptr_node(hash, i)->val;
+	if (cursor->is_busy) {
+		diag_set(ClientError, ER_SQL_EXECUTE,
+			 "cursor is being fetched by another request");
+		return -1;
+	}
+	struct sql_stmt *stmt = cursor->stmt;
+	port_sql_create(port, stmt, DQL_FETCH, false);
+	int rc;
+	/*
+	 * The spaces and indexes the statement iterates over
+	 * may be gone after a schema change.
+	 */
+	if (!sql_stmt_schema_version_is_valid(stmt)) {
+		diag_set(ClientError, ER_SQL_EXECUTE, "statement has expired");
+		rc = -1;
+	} else {
+		cursor->is_busy = true;
+		rc = sql_execute_chunk(stmt, fetch_size, port, region);
+		cursor->is_busy = false;
+	}
+	if (rc > 0) {
+		((struct port_sql *) port)->cursor_id = cursor_id;
+		return 0;
+	}
+	/* The hash could have been rehashed while stepping. */
+	i = mh_i32ptr_find(hash, cursor_id, NULL);
+	assert(i != mh_end(hash));
+	mh_i32ptr_del(hash, i, NULL);
+	if (rc == 0) {
+		/* The port finalizes the statement after dump. */
+		((struct port_sql *) port)->do_finalize = true;
+		free(cursor);
+		return 0;
+	}
+	port_destroy(port);
+	sql_cursor_delete(cursor);
+	return -1;
+}
@@ -55,12 +55,14 @@ enum sql_serialization_format {
 	DML_EXECUTE = 1,
 	DQL_PREPARE = 2,
 	DML_PREPARE = 3,
+	DQL_FETCH = 4,
 };
 
 extern const char *sql_info_key_strs[];
 
 struct region;
 struct sql_bind;
+struct mh_i32ptr_t;
 
 int
 sql_unprepare(uint32_t stmt_id);
@@ -88,6 +90,56 @@ sql_prepare_and_execute(const char *sql, int len, const struct sql_bind *bind,
 			uint32_t bind_count, struct port *port,
 			struct region *region);
 
+/**
+ * Execute an SQL statement and return at most @a fetch_size rows
+ * of its result set. If there are more rows, the statement is
+ * left open in a server-side cursor of the current session, and
+ * the cursor id is sent along with the rows. The rest of the
+ * rows is read with sql_cursor_fetch(). Statements without a
+ * result set are executed as usual.
+ * @param sql SQL statement.
+ * @param len Length of @a sql.
+ * @param bind Array of parameters.
+ * @param bind_count Length of @a bind.
+ * @param fetch_size Maximal number of rows to return, > 0.
+ * @param[out] port Port to store SQL response.
+ * @param region Runtime allocator for temporary objects.
+ *
+ * @retval  0 Success.
+ * @retval -1 Client or memory error.
+ */
+int
+sql_prepare_and_open_cursor(const char *sql, int len,
+			    const struct sql_bind *bind, uint32_t bind_count,
+			    uint32_t fetch_size, struct port *port,
+			    struct region *region);
+
+/**
+ * Same as sql_prepare_and_open_cursor(), but for a statement
+ * prepared in the current session.
+ */
+int
+sql_execute_prepared_and_open_cursor(uint32_t stmt_id,
+				     const struct sql_bind *bind,
+				     uint32_t bind_count, uint32_t fetch_size,
+				     struct port *port, struct region *region);
+
+/**
+ * Return at most @a fetch_size next rows of a cursor opened in
+ * the current session. The cursor is closed when its result set
+ * is exhausted, in which case the response has no cursor id.
+ *
+ * @retval  0 Success.
+ * @retval -1 No such cursor, client or memory error.
+ */
+int
+sql_cursor_fetch(uint32_t cursor_id, uint32_t fetch_size, struct port *port,
+		 struct region *region);
+
+/** Close all cursors stored in a session cursor hash. */
+void
+sql_session_cursor_hash_erase(struct mh_i32ptr_t *hash);
+
 /**
  * Port implementation that is used to store SQL responses and
  * output them to obuf or Lua. This port implementation is
@@ -113,6 +165,11 @@ struct port_sql {
 	 * statement remains in cache and will be deleted later.
 	 */
 	bool do_finalize;
+	/**
+	 * Id of the cursor left open to fetch the rest of the
+	 * result set, or 0.
+	 */
+	uint32_t cursor_id;
 };
 
 extern const struct port_vtab port_sql_vtab;
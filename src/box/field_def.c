@@ -75,7 +75,8 @@ const uint32_t field_mp_type[] = {
 };
 
 const uint32_t field_ext_type[] = {
-	/* [FIELD_TYPE_ANY]       = */ UINT32_MAX ^ (1U << MP_UNKNOWN_EXTENSION),
+	/* [FIELD_TYPE_ANY]       = */ UINT32_MAX ^ (1U << MP_UNKNOWN_EXTENSION) ^
+		(1U << MP_COMPRESSION), /* only in compressed fields */
 	/* [FIELD_TYPE_UNSIGNED]  = */ 0,
 	/* [FIELD_TYPE_STRING]    = */ 0,
 	/* [FIELD_TYPE_NUMBER]    = */ 1U << MP_DECIMAL,
@@ -116,6 +117,11 @@ const char *on_conflict_action_strs[] = {
 	/* [ON_CONFLICT_ACTION_DEFAULT]  = */ "default"
 };
 
+const char *compression_type_strs[] = {
+	/* [COMPRESSION_TYPE_NONE] = */ "none",
+	/* [COMPRESSION_TYPE_ZSTD] = */ "zstd",
+};
+
 static int64_t
 field_type_by_name_wrapper(const char *str, uint32_t len)
 {
@@ -160,6 +166,8 @@ const struct opt_def field_def_reg[] = {
 		     nullable_action, NULL),
 	OPT_DEF("collation", OPT_UINT32, struct field_def, coll_id),
 	OPT_DEF("default", OPT_STRPTR, struct field_def, default_value),
+	OPT_DEF_ENUM("compression", compression_type, struct field_def,
+		     compression_type, NULL),
 	OPT_END,
 };
 
@@ -170,7 +178,8 @@ const struct field_def field_def_default = {
 	.nullable_action = ON_CONFLICT_ACTION_DEFAULT,
 	.coll_id = COLL_NONE,
 	.default_value = NULL,
-	.default_value_expr = NULL
+	.default_value_expr = NULL,
+	.compression_type = COMPRESSION_TYPE_NONE,
 };
 
 enum field_type
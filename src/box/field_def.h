@@ -77,6 +77,15 @@ enum on_conflict_action {
 	on_conflict_action_MAX
 };
 
+/** How a field value is stored in memory. */
+enum compression_type {
+	/** The value is stored as is. */
+	COMPRESSION_TYPE_NONE = 0,
+	/** Large values are compressed with zstd. */
+	COMPRESSION_TYPE_ZSTD,
+	compression_type_MAX
+};
+
 /** \endcond public */
 
 enum {
@@ -99,6 +108,8 @@ extern const char *field_type_strs[];
 
 extern const char *on_conflict_action_strs[];
 
+extern const char *compression_type_strs[];
+
 /** Check if @a type1 can store values of @a type2. */
 bool
 field_type1_contains_type2(enum field_type type1, enum field_type type2);
@@ -144,6 +155,8 @@ struct field_def {
 	char *default_value;
 	/** AST for parsed default value. */
 	struct Expr *default_value_expr;
+	/** Compression of the field value. */
+	enum compression_type compression_type;
 };
 
 /**
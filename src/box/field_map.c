@@ -34,11 +34,13 @@
 
 int
 field_map_builder_create(struct field_map_builder *builder,
-			 uint32_t minimal_field_map_size,
+			 uint32_t minimal_field_map_size, bool is_compact,
 			 struct region *region)
 {
 	builder->extents_size = 0;
-	builder->slot_count = minimal_field_map_size / sizeof(uint32_t);
+	builder->is_compact = is_compact;
+	uint32_t slot_size = is_compact ? sizeof(uint16_t) : sizeof(uint32_t);
+	builder->slot_count = minimal_field_map_size / slot_size;
 	if (minimal_field_map_size == 0) {
 		builder->slots = NULL;
 		return 0;
@@ -97,6 +99,14 @@ field_map_build(struct field_map_builder *builder, char *buffer)
 	 * The buffer size is assumed to be sufficient to write
 	 * field_map_build_size(builder) bytes there.
 	 */
+	if (builder->is_compact) {
+		assert(builder->extents_size == 0);
+		uint16_t *field_map = (uint16_t *)(buffer +
+				field_map_build_size(builder));
+		for (int32_t i = -1; i >= -(int32_t)builder->slot_count; i--)
+			store_u16(&field_map[i], builder->slots[i].offset);
+		return;
+	}
 	uint32_t *field_map =
 		(uint32_t *)(buffer + field_map_build_size(builder));
 	char *extent_wptr = buffer;
@@ -65,6 +65,12 @@ enum { MULTIKEY_NONE = -1 };
  *             +----------------------------------------------+
  *             (offset_slot = N, extent_slot = 1) --> offset
  *
+ * A compact field map stores 16-bit offsets instead. It is used
+ * by tuple formats that guarantee that all indexed fields are
+ * located in the first 64 KB of a tuple, see
+ * tuple_format::is_field_map_compact. A compact field map never
+ * has extents since multikey indexes are not allowed there.
+ *
  * This field_map_builder class is used for tuple field_map
  * construction. It encapsulates field_map build logic and size
  * estimation implementation-specific details.
@@ -97,6 +103,8 @@ struct field_map_builder {
 	 * extents.
 	 */
 	uint32_t extents_size;
+	/** True if the field map to be built is compact. */
+	bool is_compact;
 };
 
 /**
@@ -150,8 +158,12 @@ struct field_map_builder_slot {
  */
 static inline uint32_t
 field_map_get_offset(const uint32_t *field_map, int32_t offset_slot,
-		     int multikey_idx)
+		     int multikey_idx, bool is_compact)
 {
+	if (is_compact) {
+		const uint16_t *compact_map = (const uint16_t *)field_map;
+		return load_u16(&compact_map[offset_slot]);
+	}
 	/*
 	 * Can not access field_map as a normal uint32 array
 	 * because its alignment may be < 4 bytes. Need to use
@@ -177,6 +189,8 @@ field_map_get_offset(const uint32_t *field_map, int32_t offset_slot,
  *
  * The field_map_size argument is a size of the minimal field_map
  * allocation where each indexed field has own offset slot.
+ * The is_compact argument is set to build a field map of 16-bit
+ * offsets.
  *
  * Routine uses region to perform memory allocation for internal
  * structures.
@@ -186,7 +200,7 @@ field_map_get_offset(const uint32_t *field_map, int32_t offset_slot,
  */
 int
 field_map_builder_create(struct field_map_builder *builder,
-			 uint32_t minimal_field_map_size,
+			 uint32_t minimal_field_map_size, bool is_compact,
 			 struct region *region);
 
 /**
@@ -218,6 +232,8 @@ field_map_builder_set_slot(struct field_map_builder *builder,
 	assert(offset_slot < 0);
 	assert((uint32_t)-offset_slot <= builder->slot_count);
 	assert(offset > 0);
+	assert(!builder->is_compact ||
+	       (offset <= UINT16_MAX && multikey_idx == MULTIKEY_NONE));
 	if (multikey_idx == MULTIKEY_NONE) {
 		builder->slots[offset_slot].offset = offset;
 	} else {
@@ -245,8 +261,9 @@ field_map_builder_set_slot(struct field_map_builder *builder,
 static inline uint32_t
 field_map_build_size(struct field_map_builder *builder)
 {
-	return builder->slot_count * sizeof(uint32_t) +
-	       builder->extents_size;
+	uint32_t slot_size = builder->is_compact ? sizeof(uint16_t) :
+						   sizeof(uint32_t);
+	return builder->slot_count * slot_size + builder->extents_size;
 }
 
 /**
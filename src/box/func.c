@@ -617,6 +617,8 @@ func_access_check(struct func *func)
 	    (PRIV_X | PRIV_U))
 		return 0;
 	user_access_t access = PRIV_X | PRIV_U;
+	if (credentials_access_is_cached(credentials, func, access))
+		return 0;
 	/* Check access for all functions. */
 	access &= ~entity_access_get(SC_FUNCTION)[credentials->auth_token].effective;
 	user_access_t func_access = access & ~credentials->universal_access;
@@ -632,6 +634,7 @@ func_access_check(struct func *func)
 		}
 		return -1;
 	}
+	credentials_access_cache_put(credentials, func, PRIV_X | PRIV_U);
 	return 0;
 }
 
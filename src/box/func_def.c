@@ -40,10 +40,13 @@ const char *func_aggregate_strs[] = {"none", "group"};
 
 const struct func_opts func_opts_default = {
 	/* .is_multikey = */ false,
+	/* .is_parallel = */ false,
 };
 
 const struct opt_def func_opts_reg[] = {
 	OPT_DEF("is_multikey", OPT_BOOL, struct func_opts, is_multikey),
+	OPT_DEF("is_parallel", OPT_BOOL, struct func_opts, is_parallel),
+	OPT_END,
 };
 
 int
@@ -51,6 +54,8 @@ func_opts_cmp(struct func_opts *o1, struct func_opts *o2)
 {
 	if (o1->is_multikey != o2->is_multikey)
 		return o1->is_multikey - o2->is_multikey;
+	if (o1->is_parallel != o2->is_parallel)
+		return o1->is_parallel - o2->is_parallel;
 	return 0;
 }
 
@@ -99,6 +104,13 @@ func_def_cmp(struct func_def *def1, struct func_def *def2)
 int
 func_def_check(struct func_def *def)
 {
+	if (def->opts.is_parallel &&
+	    (def->language != FUNC_LANGUAGE_LUA || !def->is_sandboxed)) {
+		diag_set(ClientError, ER_CREATE_FUNCTION, def->name,
+			 "is_parallel option may be set only for a sandboxed "
+			 "persistent Lua function");
+		return -1;
+	}
 	switch (def->language) {
 	case FUNC_LANGUAGE_C:
 		if (def->body != NULL || def->is_sandboxed) {
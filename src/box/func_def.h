@@ -68,6 +68,11 @@ struct func_opts {
 	 * packed in array.
 	 */
 	bool is_multikey;
+	/**
+	 * True if a sandboxed persistent Lua function may be
+	 * executed in a worker thread, see func_worker.h.
+	 */
+	bool is_parallel;
 };
 
 extern const struct func_opts func_opts_default;
@@ -58,6 +58,15 @@
 #include "wal.h"		/* wal_collect_garbage() */
 #include "checkpoint_schedule.h"
 #include "txn_limbo.h"
+#include "replication.h"	/* replicaset.vclock */
+
+enum {
+	/**
+	 * How often the checkpoint daemon checks the load of
+	 * the instance while putting off a checkpoint, seconds.
+	 */
+	GC_LOAD_CHECK_INTERVAL = 1,
+};
 
 struct gc_state gc;
 
@@ -113,6 +122,8 @@ gc_init(void)
 	gc_tree_new(&gc.consumers);
 	fiber_cond_create(&gc.cleanup_cond);
 	checkpoint_schedule_cfg(&gc.checkpoint_schedule, 0, 0);
+	gc.checkpoint_time = ev_monotonic_now(loop());
+	gc.checkpoint_wal_threshold = INT64_MAX;
 	engine_collect_garbage(&gc.vclock);
 
 	gc.cleanup_fiber = fiber_new("gc", gc_cleanup_fiber_f);
@@ -343,6 +354,49 @@ gc_set_checkpoint_interval(double interval)
 		fiber_wakeup(gc.checkpoint_fiber);
 }
 
+/**
+ * Pass the WAL size threshold to the WAL thread. If the recovery
+ * time target is set and it's stricter than the configured
+ * threshold, a checkpoint is triggered when half of the WAL budget
+ * is used up: the other half is the headroom that allows to put
+ * off the checkpoint while the instance is loaded.
+ */
+static void
+gc_update_wal_threshold(void)
+{
+	int64_t threshold = gc.checkpoint_wal_threshold;
+	int64_t budget = checkpoint_schedule_wal_budget(&gc.checkpoint_schedule);
+	gc.wal_threshold_is_soft = budget / 2 < threshold;
+	if (gc.wal_threshold_is_soft)
+		threshold = budget / 2;
+	wal_set_checkpoint_threshold(threshold);
+}
+
+void
+gc_set_checkpoint_wal_threshold(int64_t threshold)
+{
+	gc.checkpoint_wal_threshold = threshold;
+	gc_update_wal_threshold();
+}
+
+void
+gc_set_checkpoint_recovery_time(double recovery_time)
+{
+	checkpoint_schedule_cfg_recovery_time(&gc.checkpoint_schedule,
+					      recovery_time);
+	gc_update_wal_threshold();
+}
+
+void
+gc_set_wal_replay_rate(double rate)
+{
+	/*
+	 * The rate is measured on recovery, before the WAL
+	 * threshold is configured, so don't update it here.
+	 */
+	checkpoint_schedule_set_replay_rate(&gc.checkpoint_schedule, rate);
+}
+
 void
 gc_add_checkpoint(const struct vclock *vclock)
 {
@@ -385,6 +439,7 @@ gc_do_checkpoint(bool is_scheduled)
 
 	assert(!gc.checkpoint_is_in_progress);
 	gc.checkpoint_is_in_progress = true;
+	double start = ev_monotonic_now(loop());
 
 	/*
 	 * Rotate WAL and call engine callbacks to create a checkpoint
@@ -415,11 +470,20 @@ gc_do_checkpoint(bool is_scheduled)
 	 * collector state.
 	 */
 	gc_add_checkpoint(&checkpoint.vclock);
+	gc.checkpoint_time = ev_monotonic_now(loop());
+	checkpoint_schedule_add_checkpoint_time(&gc.checkpoint_schedule,
+						gc.checkpoint_time - start);
 out:
 	if (rc != 0)
 		engine_abort_checkpoint();
 
 	gc.checkpoint_is_in_progress = false;
+	/*
+	 * The WAL budget depends on the time of writing
+	 * a checkpoint, so update it.
+	 */
+	if (rc == 0 && gc.checkpoint_schedule.recovery_time > 0)
+		gc_update_wal_threshold();
 	return rc;
 }
 
@@ -468,11 +532,47 @@ gc_trigger_checkpoint(void)
 		return;
 
 	gc.checkpoint_is_pending = true;
+	gc.checkpoint_is_deferrable = gc.wal_threshold_is_soft;
 	checkpoint_schedule_reset(&gc.checkpoint_schedule,
 				  ev_monotonic_now(loop()));
 	fiber_wakeup(gc.checkpoint_fiber);
 }
 
+/**
+ * Put off a checkpoint triggered by the recovery time target
+ * while the instance is loaded, i.e. while rows are written
+ * faster than on average since the last checkpoint. The WAL
+ * threshold is set to half the WAL budget, so the checkpoint is
+ * put off until as many rows as written before the trigger are
+ * written after it at most.
+ */
+static void
+gc_defer_checkpoint(void)
+{
+	struct gc_checkpoint *last = gc_last_checkpoint();
+	int64_t start = last != NULL ? vclock_sum(&last->vclock) : 0;
+	int64_t rows = vclock_sum(&replicaset.vclock);
+	int64_t limit = rows + (rows - start);
+	double now = ev_monotonic_now(loop());
+	double avg_rate = (rows - start) / MAX(now - gc.checkpoint_time, 1.);
+	bool is_logged = false;
+	while (gc.checkpoint_is_deferrable && rows < limit) {
+		fiber_sleep(GC_LOAD_CHECK_INTERVAL);
+		double elapsed = ev_monotonic_now(loop()) - now;
+		int64_t new_rows = vclock_sum(&replicaset.vclock);
+		double rate = (new_rows - rows) / MAX(elapsed, 1e-3);
+		if (rate <= avg_rate)
+			break;
+		if (!is_logged) {
+			say_info("putting off checkpoint while the instance "
+				 "is loaded");
+			is_logged = true;
+		}
+		now += elapsed;
+		rows = new_rows;
+	}
+}
+
 static int
 gc_checkpoint_fiber_f(va_list ap)
 {
@@ -508,7 +608,10 @@ gc_checkpoint_fiber_f(va_list ap)
 			continue;
 		}
 		/* Time to make the next scheduled checkpoint. */
+		if (gc.checkpoint_is_pending && gc.checkpoint_is_deferrable)
+			gc_defer_checkpoint();
 		gc.checkpoint_is_pending = false;
+		gc.checkpoint_is_deferrable = false;
 		if (gc.checkpoint_is_in_progress) {
 			/*
 			 * Another fiber is making a checkpoint.
@@ -156,6 +156,25 @@ struct gc_state {
 	 * a checkpoint as soon as possible despite the schedule.
 	 */
 	bool checkpoint_is_pending;
+	/**
+	 * Set if the pending checkpoint was triggered by the
+	 * recovery time target and so may be put off while the
+	 * instance is loaded.
+	 */
+	bool checkpoint_is_deferrable;
+	/** Monotonic time when the last checkpoint was made. */
+	double checkpoint_time;
+	/**
+	 * WAL size threshold configured by
+	 * box.cfg.checkpoint_wal_threshold.
+	 */
+	int64_t checkpoint_wal_threshold;
+	/**
+	 * Set if the threshold passed to the WAL thread is
+	 * derived from the recovery time target rather than
+	 * configured, see gc_update_wal_threshold().
+	 */
+	bool wal_threshold_is_soft;
 };
 extern struct gc_state gc;
 
@@ -231,6 +250,29 @@ gc_set_min_checkpoint_count(int min_checkpoint_count);
 void
 gc_set_checkpoint_interval(double interval);
 
+/**
+ * Set the size of WAL files written since the last checkpoint
+ * exceeding which triggers a checkpoint.
+ */
+void
+gc_set_checkpoint_wal_threshold(int64_t threshold);
+
+/**
+ * Set the target of the time needed to recover the instance,
+ * in seconds. Checkpoints are triggered as often as needed
+ * to keep the size of WAL files to replay within the target.
+ * Setting the target to 0 disables it.
+ */
+void
+gc_set_checkpoint_recovery_time(double recovery_time);
+
+/**
+ * Set the WAL replay rate measured on local recovery, in bytes
+ * per second. Used for estimating the recovery time.
+ */
+void
+gc_set_wal_replay_rate(double rate);
+
 /**
  * Track an existing checkpoint in the garbage collector state.
  * Note, this function may trigger garbage collection to remove
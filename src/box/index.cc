@@ -30,14 +30,17 @@
  */
 #include "index.h"
 #include "tuple.h"
+#include "tuple_compression.h"
 #include "say.h"
 #include "schema.h"
 #include "user_def.h"
 #include "space.h"
 #include "iproto_constants.h"
 #include "txn.h"
+#include "memtx_tx.h"
 #include "rmean.h"
 #include "info/info.h"
+#include "clock.h"
 
 /* {{{ Utilities. **********************************************/
 
@@ -71,11 +74,12 @@ key_validate(const struct index_def *index_def, enum iterator_type type,
 	if (part_count == 0) {
 		/*
 		 * Zero key parts are allowed:
-		 * - for TREE index, all iterator types,
+		 * - for TREE and ART indexes, all iterator types,
 		 * - ITER_ALL iterator type, all index types
 		 * - ITER_GT iterator in HASH index (legacy)
 		 */
-		if (index_def->type == TREE || type == ITER_ALL ||
+		if (index_def->type == TREE || index_def->type == ART ||
+		    type == ITER_ALL ||
 		    (index_def->type == HASH && type == ITER_GT))
 			return 0;
 		/* Fall through. */
@@ -118,8 +122,9 @@ key_validate(const struct index_def *index_def, enum iterator_type type,
 			return -1;
 		}
 
-		/* Partial keys are allowed only for TREE index type. */
-		if (index_def->type != TREE && part_count < index_def->key_def->part_count) {
+		/* Partial keys are allowed only for TREE and ART index types. */
+		if (index_def->type != TREE && index_def->type != ART &&
+		    part_count < index_def->key_def->part_count) {
 			diag_set(ClientError, ER_PARTIAL_KEY,
 				 index_type_strs[index_def->type],
 				 index_def->key_def->part_count,
@@ -203,6 +208,20 @@ box_index_bsize(uint32_t space_id, uint32_t index_id)
 	return index_bsize(index);
 }
 
+/**
+ * Pin a tuple returned to the user. Compressed fields are
+ * decompressed so that the user never sees them.
+ */
+static int
+box_result_bless(struct tuple **result)
+{
+	struct tuple *tuple = tuple_decompress(*result);
+	if (tuple == NULL)
+		return -1;
+	*result = tuple_bless(tuple);
+	return 0;
+}
+
 int
 box_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd,
 		box_tuple_t **result)
@@ -216,10 +235,21 @@ box_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd,
 	if (index_random(index, rnd, result) != 0)
 		return -1;
 	if (*result != NULL)
-		tuple_bless(*result);
+		return box_result_bless(result);
 	return 0;
 }
 
+/** Account a point lookup started at @a start. */
+static inline void
+index_op_stat_lookup(struct index *index, struct tuple *result,
+		     uint64_t start)
+{
+	index->op_stat.lookup++;
+	if (result != NULL)
+		index->op_stat.rows++;
+	index->op_stat.time += clock_monotonic64() - start;
+}
+
 int
 box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result)
@@ -237,6 +267,7 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	uint32_t part_count = mp_decode_array(&key);
 	if (exact_key_validate(index->def->key_def, key, part_count))
 		return -1;
+	uint64_t start = clock_monotonic64();
 	/* Start transaction in the engine. */
 	struct txn *txn;
 	if (txn_begin_ro_stmt(space, &txn) != 0)
@@ -248,8 +279,9 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	txn_commit_ro_stmt(txn);
 	/* Count statistics. */
 	rmean_collect(rmean_box, IPROTO_SELECT, 1);
+	index_op_stat_lookup(index, *result, start);
 	if (*result != NULL)
-		tuple_bless(*result);
+		return box_result_bless(result);
 	return 0;
 }
 
@@ -263,7 +295,7 @@ box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	struct index *index;
 	if (check_index(space_id, index_id, &space, &index) != 0)
 		return -1;
-	if (index->def->type != TREE) {
+	if (index->def->type != TREE && index->def->type != ART) {
 		/* Show nice error messages in Lua. */
 		diag_set(UnsupportedIndexFeature, index->def, "min()");
 		return -1;
@@ -271,6 +303,7 @@ box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	uint32_t part_count = mp_decode_array(&key);
 	if (key_validate(index->def, ITER_GE, key, part_count))
 		return -1;
+	uint64_t start = clock_monotonic64();
 	/* Start transaction in the engine. */
 	struct txn *txn;
 	if (txn_begin_ro_stmt(space, &txn) != 0)
@@ -280,8 +313,9 @@ box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 		return -1;
 	}
 	txn_commit_ro_stmt(txn);
+	index_op_stat_lookup(index, *result, start);
 	if (*result != NULL)
-		tuple_bless(*result);
+		return box_result_bless(result);
 	return 0;
 }
 
@@ -295,7 +329,7 @@ box_index_max(uint32_t space_id, uint32_t index_id, const char *key,
 	struct index *index;
 	if (check_index(space_id, index_id, &space, &index) != 0)
 		return -1;
-	if (index->def->type != TREE) {
+	if (index->def->type != TREE && index->def->type != ART) {
 		/* Show nice error messages in Lua. */
 		diag_set(UnsupportedIndexFeature, index->def, "max()");
 		return -1;
@@ -303,6 +337,7 @@ box_index_max(uint32_t space_id, uint32_t index_id, const char *key,
 	uint32_t part_count = mp_decode_array(&key);
 	if (key_validate(index->def, ITER_LE, key, part_count))
 		return -1;
+	uint64_t start = clock_monotonic64();
 	/* Start transaction in the engine. */
 	struct txn *txn;
 	if (txn_begin_ro_stmt(space, &txn) != 0)
@@ -312,8 +347,9 @@ box_index_max(uint32_t space_id, uint32_t index_id, const char *key,
 		return -1;
 	}
 	txn_commit_ro_stmt(txn);
+	index_op_stat_lookup(index, *result, start);
 	if (*result != NULL)
-		tuple_bless(*result);
+		return box_result_bless(result);
 	return 0;
 }
 
@@ -346,6 +382,7 @@ box_index_count(uint32_t space_id, uint32_t index_id, int type,
 		return -1;
 	}
 	txn_commit_ro_stmt(txn);
+	index->op_stat.scan++;
 	return count;
 }
 
@@ -384,6 +421,7 @@ box_index_iterator(uint32_t space_id, uint32_t index_id, int type,
 	}
 	txn_commit_ro_stmt(txn);
 	rmean_collect(rmean_box, IPROTO_SELECT, 1);
+	index->op_stat.scan++;
 	return it;
 }
 
@@ -393,8 +431,10 @@ box_iterator_next(box_iterator_t *itr, box_tuple_t **result)
 	assert(result != NULL);
 	if (iterator_next(itr, result) != 0)
 		return -1;
-	if (*result != NULL)
-		tuple_bless(*result);
+	if (*result != NULL) {
+		itr->index->op_stat.rows++;
+		return box_result_bless(result);
+	}
 	return 0;
 }
 
@@ -404,6 +444,33 @@ box_iterator_free(box_iterator_t *it)
 	iterator_delete(it);
 }
 
+int
+box_iterator_next_batch(box_iterator_t *itr, box_tuple_t **result,
+			uint32_t size)
+{
+	uint32_t count = 0;
+	while (count < size) {
+		struct tuple *tuple;
+		if (iterator_next(itr, &tuple) != 0) {
+			box_tuple_unref_batch(result, count);
+			return -1;
+		}
+		if (tuple == NULL)
+			break;
+		tuple_ref(tuple);
+		result[count++] = tuple;
+	}
+	itr->index->op_stat.rows += count;
+	return count;
+}
+
+void
+box_tuple_unref_batch(box_tuple_t **tuples, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+		tuple_unref(tuples[i]);
+}
+
 /* }}} */
 
 /* {{{ Other index functions */
@@ -439,6 +506,7 @@ void
 iterator_create(struct iterator *it, struct index *index)
 {
 	it->next = NULL;
+	it->skip = NULL;
 	it->free = NULL;
 	it->space_cache_version = space_cache_version;
 	it->space_id = index->def->space_id;
@@ -463,13 +531,46 @@ iterator_next(struct iterator *it, struct tuple **ret)
 			goto invalidate;
 		it->space_cache_version = space_cache_version;
 	}
-	return it->next(it, ret);
+	if (likely(!memtx_tx_manager_use_mvcc_engine))
+		return it->next(it, ret);
+	/* Skip tuples invisible to the current transaction. */
+	while (true) {
+		if (it->next(it, ret) != 0)
+			return -1;
+		if (*ret == NULL)
+			return 0;
+		if (memtx_tx_tuple_clarify(it->index, ret) != 0)
+			return -1;
+		if (*ret != NULL)
+			return 0;
+	}
 
 invalidate:
 	*ret = NULL;
 	return 0;
 }
 
+int
+iterator_skip(struct iterator *it, uint32_t count)
+{
+	/*
+	 * The fast path can be taken only if the iterator is
+	 * valid and every tuple it steps over is visible to
+	 * the current transaction.
+	 */
+	if (it->skip != NULL && !memtx_tx_manager_use_mvcc_engine &&
+	    it->space_cache_version == space_cache_version)
+		return it->skip(it, count);
+	struct tuple *tuple;
+	for (; count > 0; count--) {
+		if (iterator_next(it, &tuple) != 0)
+			return -1;
+		if (tuple == NULL)
+			break;
+	}
+	return 0;
+}
+
 void
 iterator_delete(struct iterator *it)
 {
@@ -490,6 +591,9 @@ index_create(struct index *index, struct engine *engine,
 	index->def = def;
 	index->refs = 1;
 	index->space_cache_version = space_cache_version;
+	index->eq_est = NULL;
+	index->eq_est_size = 0;
+	memset(&index->op_stat, 0, sizeof(index->op_stat));
 	return 0;
 }
 
@@ -503,10 +607,50 @@ index_delete(struct index *index)
 	 * the index is primary or secondary.
 	 */
 	struct index_def *def = index->def;
+	free(index->eq_est);
 	index->vtab->destroy(index);
 	index_def_delete(def);
 }
 
+const uint64_t *
+index_estimate_eq(struct index *index)
+{
+	ssize_t size = index_size(index);
+	if (size < 0)
+		return NULL;
+	/*
+	 * Reuse the estimates until the index grows or shrinks
+	 * by more than 1/8.
+	 */
+	if (index->eq_est != NULL &&
+	    index->eq_est_size >= size - size / 8 &&
+	    index->eq_est_size <= size + size / 8)
+		return index->eq_est;
+	uint32_t part_count = index->def->key_def->part_count;
+	if (index->eq_est == NULL) {
+		index->eq_est = (uint64_t *)malloc(part_count *
+						   sizeof(*index->eq_est));
+		if (index->eq_est == NULL)
+			return NULL;
+	}
+	if (index->vtab->estimate_eq(index, index->eq_est) != 0) {
+		free(index->eq_est);
+		index->eq_est = NULL;
+		return NULL;
+	}
+	/* A longer key prefix can't be shared by more tuples. */
+	uint64_t max = size;
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (index->eq_est[i] == 0)
+			continue;
+		if (index->eq_est[i] > max)
+			index->eq_est[i] = max;
+		max = index->eq_est[i];
+	}
+	index->eq_est_size = size;
+	return index->eq_est;
+}
+
 int
 index_build(struct index *index, struct index *pk)
 {
@@ -657,6 +801,23 @@ generic_index_count(struct index *index, enum iterator_type type,
 	return count;
 }
 
+int
+generic_index_estimate_eq(struct index *index, uint64_t *eq)
+{
+	(void)index;
+	(void)eq;
+	return -1;
+}
+
+int
+generic_index_split(struct index *index, uint32_t count, struct port *port)
+{
+	(void)index;
+	(void)count;
+	(void)port;
+	return 0;
+}
+
 int
 generic_index_get(struct index *index, const char *key,
 		  uint32_t part_count, struct tuple **result)
@@ -668,6 +829,29 @@ generic_index_get(struct index *index, const char *key,
 	return -1;
 }
 
+int
+generic_index_get_batch(struct index *index, const char *keys,
+			uint32_t key_count, struct tuple **result)
+{
+	const char *key = keys;
+	for (uint32_t i = 0; i < key_count; i++) {
+		const char *next_key = key;
+		mp_next(&next_key);
+		uint32_t part_count = mp_decode_array(&key);
+		if (index_get(index, key, part_count, &result[i]) != 0) {
+			for (uint32_t j = 0; j < i; j++) {
+				if (result[j] != NULL)
+					tuple_unref(result[j]);
+			}
+			return -1;
+		}
+		if (result[i] != NULL)
+			tuple_ref(result[i]);
+		key = next_key;
+	}
+	return 0;
+}
+
 int
 generic_index_replace(struct index *index, struct tuple *old_tuple,
 		      struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -681,6 +865,14 @@ generic_index_replace(struct index *index, struct tuple *old_tuple,
 	return -1;
 }
 
+int
+generic_index_replace_unchanged(struct index *index, struct tuple *old_tuple,
+				struct tuple *new_tuple)
+{
+	struct tuple *unused;
+	return index_replace(index, old_tuple, new_tuple, DUP_REPLACE, &unused);
+}
+
 struct iterator *
 generic_index_create_iterator(struct index *base, enum iterator_type type,
 			      const char *key, uint32_t part_count)
@@ -691,6 +883,15 @@ generic_index_create_iterator(struct index *base, enum iterator_type type,
 }
 
 
+struct iterator *
+generic_index_create_key_iterator(struct index *base, enum iterator_type type,
+				  const char *key, uint32_t part_count)
+{
+	(void) type; (void) key; (void) part_count;
+	diag_set(UnsupportedIndexFeature, base->def, "keys only iterator");
+	return NULL;
+}
+
 struct snapshot_iterator *
 generic_index_create_snapshot_iterator(struct index *index)
 {
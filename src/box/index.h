@@ -45,6 +45,7 @@ struct index;
 struct index_def;
 struct key_def;
 struct info_handler;
+struct port;
 
 /** \cond public */
 
@@ -235,6 +236,29 @@ box_index_stat(uint32_t space_id, uint32_t index_id,
 int
 box_index_compact(uint32_t space_id, uint32_t index_id);
 
+/**
+ * Retrieve up to @a size next tuples from the iterator at once.
+ * The returned tuples are referenced and must be released with
+ * box_tuple_unref_batch(). Used by index:foreach() to iterate
+ * without a Lua finalizer per tuple.
+ *
+ * \param iterator an iterator returned by box_index_iterator()
+ * \param[out] result array of at least @a size tuples
+ * \param size maximal number of tuples to retrieve
+ * \retval -1 on error (check box_error_last() for details)
+ * \retval >=0 the number of retrieved tuples, less than @a size
+ *         only at the end of data
+ */
+int
+box_iterator_next_batch(box_iterator_t *iterator, box_tuple_t **result,
+			uint32_t size);
+
+/**
+ * Unreference tuples returned by box_iterator_next_batch().
+ */
+void
+box_tuple_unref_batch(box_tuple_t **tuples, uint32_t count);
+
 struct iterator {
 	/**
 	 * Iterate to the next tuple.
@@ -242,6 +266,12 @@ struct iterator {
 	 * Returns 0 on success, -1 on error.
 	 */
 	int (*next)(struct iterator *it, struct tuple **ret);
+	/**
+	 * Skip @count tuples without returning them. Optional,
+	 * NULL if the index can't do it faster than calling
+	 * next() @count times. Returns 0 on success, -1 on error.
+	 */
+	int (*skip)(struct iterator *it, uint32_t count);
 	/** Destroy the iterator. */
 	void (*free)(struct iterator *);
 	/** Space cache version at the time of the last index lookup. */
@@ -277,6 +307,14 @@ iterator_create(struct iterator *it, struct index *index);
 int
 iterator_next(struct iterator *it, struct tuple **ret);
 
+/**
+ * Skip @count tuples, as if iterator_next() was called @count
+ * times and its results were discarded. Stops early if the
+ * iterator is exhausted. Returns 0 on success, -1 on error.
+ */
+int
+iterator_skip(struct iterator *it, uint32_t count);
+
 /**
  * Destroy an iterator instance and free associated memory.
  */
@@ -410,15 +448,57 @@ struct index_vtab {
 	int (*random)(struct index *index, uint32_t rnd, struct tuple **result);
 	ssize_t (*count)(struct index *index, enum iterator_type type,
 			 const char *key, uint32_t part_count);
+	/**
+	 * Estimate how many tuples share a key prefix. On success
+	 * @eq[i] is set to the average number of tuples having
+	 * equal first i + 1 key parts or to 0 if it is unknown.
+	 * Must be cheap, i.e. not scan the index. Returns -1
+	 * without setting diag if the engine can't estimate it.
+	 */
+	int (*estimate_eq)(struct index *index, uint64_t *eq);
+	/**
+	 * Split the index into at most @count key ranges of about
+	 * the same size and append the keys separating them to
+	 * @port as MsgPack arrays, in ascending order. Must not
+	 * scan the index. An index that can't be split appends
+	 * nothing, i.e. makes a single range.
+	 */
+	int (*split)(struct index *index, uint32_t count, struct port *port);
 	int (*get)(struct index *index, const char *key,
 		   uint32_t part_count, struct tuple **result);
+	/**
+	 * Look up tuples by a batch of full keys. @keys points
+	 * to @key_count MsgPack arrays. On success @result[i]
+	 * is set to the tuple matching the i-th key, referenced,
+	 * or NULL if there's no such tuple.
+	 */
+	int (*get_batch)(struct index *index, const char *keys,
+			 uint32_t key_count, struct tuple **result);
 	int (*replace)(struct index *index, struct tuple *old_tuple,
 		       struct tuple *new_tuple, enum dup_replace_mode mode,
 		       struct tuple **result);
+	/**
+	 * Replace @a old_tuple with @a new_tuple which has the
+	 * same key in this index, i.e. the update didn't change
+	 * any of the key parts. The new tuple takes the place of
+	 * the old one, so the index may skip the search for
+	 * duplicates and the removal of the old entries.
+	 */
+	int (*replace_unchanged)(struct index *index, struct tuple *old_tuple,
+				 struct tuple *new_tuple);
 	/** Create an index iterator. */
 	struct iterator *(*create_iterator)(struct index *index,
 			enum iterator_type type,
 			const char *key, uint32_t part_count);
+	/**
+	 * Create an index iterator returning extended keys
+	 * (index parts followed by the primary key parts absent
+	 * from the index) instead of full tuples. Supported by
+	 * indexes that need an extra lookup to fetch a tuple.
+	 */
+	struct iterator *(*create_key_iterator)(struct index *index,
+			enum iterator_type type,
+			const char *key, uint32_t part_count);
 	/**
 	 * Create an ALL iterator with personal read view so further
 	 * index modifications will not affect the iteration results.
@@ -448,6 +528,21 @@ struct index_vtab {
 	void (*end_build)(struct index *index);
 };
 
+/**
+ * Engine independent counters of read requests served by
+ * an index. Exported by space:stat().
+ */
+struct index_op_stat {
+	/** Number of point lookups: get(), min(), max(). */
+	uint64_t lookup;
+	/** Number of scans: select(), pairs(), count(). */
+	uint64_t scan;
+	/** Number of tuples returned by lookups and selects. */
+	uint64_t rows;
+	/** Time spent in lookups and selects, in nanoseconds. */
+	uint64_t time;
+};
+
 struct index {
 	/** Virtual function table. */
 	const struct index_vtab *vtab;
@@ -459,6 +554,15 @@ struct index {
 	int refs;
 	/* Space cache version at the time of construction. */
 	uint32_t space_cache_version;
+	/**
+	 * Estimates returned by index_estimate_eq(), one per key
+	 * part, or NULL if they haven't been requested yet.
+	 */
+	uint64_t *eq_est;
+	/** Index size at the time eq_est was computed. */
+	ssize_t eq_est_size;
+	/** Read request counters. */
+	struct index_op_stat op_stat;
 };
 
 /**
@@ -615,6 +719,18 @@ index_count(struct index *index, enum iterator_type type,
 	return index->vtab->count(index, type, key, part_count);
 }
 
+/**
+ * Estimate the average number of tuples sharing the first
+ * i + 1 key parts for each i < part count, see the vtab method
+ * estimate_eq. The estimates are cached and recomputed when
+ * the index size changes noticeably.
+ *
+ * @retval Array of part count estimates, 0 means unknown.
+ * @retval NULL if the engine doesn't provide estimates.
+ */
+const uint64_t *
+index_estimate_eq(struct index *index);
+
 static inline int
 index_get(struct index *index, const char *key,
 	   uint32_t part_count, struct tuple **result)
@@ -622,6 +738,19 @@ index_get(struct index *index, const char *key,
 	return index->vtab->get(index, key, part_count, result);
 }
 
+static inline int
+index_split(struct index *index, uint32_t count, struct port *port)
+{
+	return index->vtab->split(index, count, port);
+}
+
+static inline int
+index_get_batch(struct index *index, const char *keys,
+		uint32_t key_count, struct tuple **result)
+{
+	return index->vtab->get_batch(index, keys, key_count, result);
+}
+
 static inline int
 index_replace(struct index *index, struct tuple *old_tuple,
 	      struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -630,6 +759,13 @@ index_replace(struct index *index, struct tuple *old_tuple,
 	return index->vtab->replace(index, old_tuple, new_tuple, mode, result);
 }
 
+static inline int
+index_replace_unchanged(struct index *index, struct tuple *old_tuple,
+			struct tuple *new_tuple)
+{
+	return index->vtab->replace_unchanged(index, old_tuple, new_tuple);
+}
+
 static inline struct iterator *
 index_create_iterator(struct index *index, enum iterator_type type,
 		      const char *key, uint32_t part_count)
@@ -637,6 +773,13 @@ index_create_iterator(struct index *index, enum iterator_type type,
 	return index->vtab->create_iterator(index, type, key, part_count);
 }
 
+static inline struct iterator *
+index_create_key_iterator(struct index *index, enum iterator_type type,
+			  const char *key, uint32_t part_count)
+{
+	return index->vtab->create_key_iterator(index, type, key, part_count);
+}
+
 static inline struct snapshot_iterator *
 index_create_snapshot_iterator(struct index *index)
 {
@@ -703,9 +846,15 @@ int generic_index_max(struct index *, const char *, uint32_t, struct tuple **);
 int generic_index_random(struct index *, uint32_t, struct tuple **);
 ssize_t generic_index_count(struct index *, enum iterator_type,
 			    const char *, uint32_t);
+int generic_index_estimate_eq(struct index *, uint64_t *);
+int generic_index_split(struct index *, uint32_t, struct port *);
 int generic_index_get(struct index *, const char *, uint32_t, struct tuple **);
+int generic_index_get_batch(struct index *, const char *, uint32_t,
+			    struct tuple **);
 int generic_index_replace(struct index *, struct tuple *, struct tuple *,
 			  enum dup_replace_mode, struct tuple **);
+int generic_index_replace_unchanged(struct index *, struct tuple *,
+				    struct tuple *);
 struct snapshot_iterator *generic_index_create_snapshot_iterator(struct index *);
 void generic_index_stat(struct index *, struct info_handler *);
 void generic_index_compact(struct index *);
@@ -715,6 +864,9 @@ int generic_index_reserve(struct index *, uint32_t);
 struct iterator *
 generic_index_create_iterator(struct index *base, enum iterator_type type,
 			      const char *key, uint32_t part_count);
+struct iterator *
+generic_index_create_key_iterator(struct index *base, enum iterator_type type,
+				  const char *key, uint32_t part_count);
 int generic_index_build_next(struct index *, struct tuple *);
 void generic_index_end_build(struct index *);
 int
@@ -35,10 +35,16 @@
 #include "json/json.h"
 #include "fiber.h"
 
-const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE" };
+const char *index_type_strs[] = {
+	"HASH", "TREE", "BITSET", "RTREE", "ART", "TEXT"
+};
 
 const char *rtree_index_distance_type_strs[] = { "EUCLID", "MANHATTAN" };
 
+const char *index_compaction_strategy_strs[] = { "leveled", "tiered" };
+
+const char *index_hash_type_strs[] = { "light", "swiss" };
+
 const struct index_opts index_opts_default = {
 	/* .unique              = */ true,
 	/* .dimension           = */ 2,
@@ -47,10 +53,19 @@ const struct index_opts index_opts_default = {
 	/* .page_size           = */ 8192,
 	/* .run_count_per_level = */ 2,
 	/* .run_size_ratio      = */ 3.5,
+	/* .compaction_strategy = */ INDEX_COMPACTION_LEVELED,
 	/* .bloom_fpr           = */ 0.05,
+	/* .bloom_type          = */ TUPLE_BLOOM_BLOOM,
+	/* .bloom_per_page      = */ false,
+	/* .bloom_part_count    = */ 0,
+	/* .prefix_compression  = */ false,
+	/* .ttl                 = */ 0,
+	/* .ttl_field           = */ 0,
 	/* .lsn                 = */ 0,
 	/* .stat                = */ NULL,
 	/* .func                = */ 0,
+	/* .hash_type           = */ INDEX_HASH_LIGHT,
+	/* .count_keys          = */ false,
 };
 
 const struct opt_def index_opts_reg[] = {
@@ -62,9 +77,22 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("page_size", OPT_INT64, struct index_opts, page_size),
 	OPT_DEF("run_count_per_level", OPT_INT64, struct index_opts, run_count_per_level),
 	OPT_DEF("run_size_ratio", OPT_FLOAT, struct index_opts, run_size_ratio),
+	OPT_DEF_ENUM("compaction_strategy", index_compaction_strategy,
+		     struct index_opts, compaction_strategy, NULL),
 	OPT_DEF("bloom_fpr", OPT_FLOAT, struct index_opts, bloom_fpr),
+	OPT_DEF_ENUM("bloom_type", tuple_bloom_type, struct index_opts,
+		     bloom_type, NULL),
+	OPT_DEF("bloom_per_page", OPT_BOOL, struct index_opts, bloom_per_page),
+	OPT_DEF("bloom_part_count", OPT_UINT32, struct index_opts, bloom_part_count),
+	OPT_DEF("prefix_compression", OPT_BOOL, struct index_opts,
+		prefix_compression),
+	OPT_DEF("ttl", OPT_FLOAT, struct index_opts, ttl),
+	OPT_DEF("ttl_field", OPT_UINT32, struct index_opts, ttl_field),
 	OPT_DEF("lsn", OPT_INT64, struct index_opts, lsn),
 	OPT_DEF("func", OPT_UINT32, struct index_opts, func_id),
+	OPT_DEF_ENUM("hash_type", index_hash_type, struct index_opts,
+		     hash_type, NULL),
+	OPT_DEF("count_keys", OPT_BOOL, struct index_opts, count_keys),
 	OPT_DEF_LEGACY("sql"),
 	OPT_END,
 };
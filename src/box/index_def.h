@@ -33,6 +33,7 @@
 
 #include "key_def.h"
 #include "opt_def.h"
+#include "tuple_bloom.h"
 #include "small/rlist.h"
 
 #if defined(__cplusplus)
@@ -44,6 +45,8 @@ enum index_type {
 	TREE,     /* TREE Index */
 	BITSET,   /* BITSET Index */
 	RTREE,    /* R-Tree Index */
+	ART,      /* Adaptive Radix Tree Index */
+	TEXT,     /* Full-text Index */
 	index_type_MAX,
 };
 
@@ -58,6 +61,26 @@ enum rtree_index_distance_type {
 };
 extern const char *rtree_index_distance_type_strs[];
 
+/** Policy used by vinyl for choosing runs to compact. */
+enum index_compaction_strategy {
+	/** Levels of runs, one run at the last level. */
+	INDEX_COMPACTION_LEVELED,
+	/** Tiers of runs of similar size, no limit on the last one. */
+	INDEX_COMPACTION_TIERED,
+	index_compaction_strategy_MAX
+};
+extern const char *index_compaction_strategy_strs[];
+
+/** Hash table used by memtx HASH index. */
+enum index_hash_type {
+	/** Linear hashing with chains, see salad/light.h. */
+	INDEX_HASH_LIGHT,
+	/** Open addressing with probing by groups, see salad/swiss.h. */
+	INDEX_HASH_SWISS,
+	index_hash_type_MAX
+};
+extern const char *index_hash_type_strs[];
+
 /** Simple alias to represent logarithm metrics. */
 typedef int16_t log_est_t;
 
@@ -151,8 +174,42 @@ struct index_opts {
 	 * previous one.
 	 */
 	double run_size_ratio;
+	/**
+	 * Compaction strategy, see
+	 * vy_range_update_compaction_priority().
+	 */
+	enum index_compaction_strategy compaction_strategy;
 	/* Bloom filter false positive rate. */
 	double bloom_fpr;
+	/** Type of filters to build for runs. */
+	enum tuple_bloom_type bloom_type;
+	/**
+	 * Build a bloom filter per each run page instead of one
+	 * filter per run.
+	 */
+	bool bloom_per_page;
+	/**
+	 * Number of leading key parts to build the bloom filter
+	 * for. Lookups by longer keys check only these parts.
+	 * 0 means all key parts.
+	 */
+	uint32_t bloom_part_count;
+	/**
+	 * Write run pages in the prefix-compressed format, see
+	 * VY_RUN_PREFIX_ROW.
+	 */
+	bool prefix_compression;
+	/**
+	 * Time to live of a tuple, in seconds. Tuples that are
+	 * older than that are discarded by dump and compaction.
+	 * 0 means tuples never expire.
+	 */
+	double ttl;
+	/**
+	 * Number of the field storing the tuple time, in seconds
+	 * since the Epoch. Used only if ttl is set.
+	 */
+	uint32_t ttl_field;
 	/**
 	 * LSN from the time of index creation.
 	 */
@@ -165,6 +222,14 @@ struct index_opts {
 	struct index_stat *stat;
 	/** Identifier of the functional index function. */
 	uint32_t func_id;
+	/** Hash table used by memtx HASH index. */
+	enum index_hash_type hash_type;
+	/**
+	 * Maintain the number of tuples per full key so that
+	 * counting tuples by a full key takes O(1). Supported
+	 * by non-unique memtx TREE indexes.
+	 */
+	bool count_keys;
 };
 
 extern const struct index_opts index_opts_default;
@@ -207,10 +272,30 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		       -1 : 1;
 	if (o1->run_size_ratio != o2->run_size_ratio)
 		return o1->run_size_ratio < o2->run_size_ratio ? -1 : 1;
+	if (o1->compaction_strategy != o2->compaction_strategy)
+		return o1->compaction_strategy < o2->compaction_strategy ?
+		       -1 : 1;
 	if (o1->bloom_fpr != o2->bloom_fpr)
 		return o1->bloom_fpr < o2->bloom_fpr ? -1 : 1;
+	if (o1->bloom_type != o2->bloom_type)
+		return o1->bloom_type < o2->bloom_type ? -1 : 1;
+	if (o1->bloom_per_page != o2->bloom_per_page)
+		return o1->bloom_per_page < o2->bloom_per_page ? -1 : 1;
+	if (o1->bloom_part_count != o2->bloom_part_count)
+		return o1->bloom_part_count < o2->bloom_part_count ? -1 : 1;
+	if (o1->prefix_compression != o2->prefix_compression)
+		return o1->prefix_compression < o2->prefix_compression ?
+		       -1 : 1;
+	if (o1->ttl != o2->ttl)
+		return o1->ttl < o2->ttl ? -1 : 1;
+	if (o1->ttl_field != o2->ttl_field)
+		return o1->ttl_field < o2->ttl_field ? -1 : 1;
 	if (o1->func_id != o2->func_id)
 		return o1->func_id - o2->func_id;
+	if (o1->hash_type != o2->hash_type)
+		return o1->hash_type < o2->hash_type ? -1 : 1;
+	if (o1->count_keys != o2->count_keys)
+		return o1->count_keys < o2->count_keys ? -1 : 1;
 	return 0;
 }
 
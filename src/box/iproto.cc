@@ -56,17 +56,31 @@
 #include "tuple_convert.h"
 #include "session.h"
 #include "xrow.h"
+#include "wal.h"
 #include "schema.h" /* schema_version */
 #include "replication.h" /* instance_uuid */
 #include "iproto_constants.h"
+#include "iproto_shm.h"
 #include "rmean.h"
 #include "execute.h"
 #include "errinj.h"
 #include "tt_static.h"
+#include "tuple.h"
+#include "latency.h"
+#include "info/info.h"
+#include <pmatomic.h>
+#include <zstd.h>
 
 enum {
 	IPROTO_SALT_SIZE = 32,
 	IPROTO_PACKET_SIZE_MAX = 2UL * 1024 * 1024 * 1024,
+	/**
+	 * SELECT results are sent to the socket right from
+	 * tuples of at least this size, see iproto_zc_seg.
+	 */
+	IPROTO_ZC_TUPLE_SIZE_MIN = 1024,
+	/** Max number of tuples sent by a single writev(). */
+	IPROTO_ZC_IOV_MAX = 64,
 };
 
 /**
@@ -109,6 +123,80 @@ struct iproto_kharon {
 	struct iproto_wpos wpos;
 };
 
+/**
+ * A tuple sent to the socket right from the tuple memory
+ * instead of being copied to the output buffer. It is spliced
+ * into the buffer output at a given position. The tuple is
+ * referenced until tx learns that the buffer has been flushed
+ * and resets it (see tx_accept_wpos()).
+ */
+struct iproto_zc_seg {
+	/** Next segment of the same output buffer. */
+	struct iproto_zc_seg *next;
+	/**
+	 * Size of the buffer output preceding the segment, i.e.
+	 * the segment is sent before the byte of the buffer at
+	 * this offset. Comparable with obuf_svp::used.
+	 */
+	size_t pos;
+	/** The referenced tuple. */
+	struct tuple *tuple;
+	/** Tuple MessagePack. */
+	const char *data;
+	/** Size of the tuple MessagePack. */
+	uint32_t size;
+};
+
+/**
+ * Zero-copy segments of an output buffer, in the order of their
+ * positions. Appended and released by tx, read by the iproto
+ * thread up to the position it has been told to flush to.
+ */
+struct iproto_zc {
+	struct iproto_zc_seg *first;
+	struct iproto_zc_seg **last;
+};
+
+/** Segments are allocated and freed in tx. */
+static struct mempool iproto_zc_seg_pool;
+
+static void
+iproto_zc_create(struct iproto_zc *zc)
+{
+	zc->first = NULL;
+	zc->last = &zc->first;
+}
+
+/**
+ * Append a list of segments. The segments are completely
+ * initialized before they're linked, because the iproto
+ * thread may be reading the list concurrently.
+ */
+static void
+iproto_zc_splice(struct iproto_zc *zc, struct iproto_zc *src)
+{
+	if (src->first == NULL)
+		return;
+	pm_atomic_store_explicit(zc->last, src->first,
+				 pm_memory_order_release);
+	zc->last = src->last;
+	iproto_zc_create(src);
+}
+
+/** Release the segments and unreference their tuples. */
+static void
+iproto_zc_reset(struct iproto_zc *zc)
+{
+	struct iproto_zc_seg *seg = zc->first;
+	while (seg != NULL) {
+		struct iproto_zc_seg *next = seg->next;
+		tuple_unref(seg->tuple);
+		mempool_free(&iproto_zc_seg_pool, seg);
+		seg = next;
+	}
+	iproto_zc_create(zc);
+}
+
 /**
  * Network readahead. A signed integer to avoid
  * automatic type coercion to an unsigned type.
@@ -129,6 +217,17 @@ unsigned iproto_readahead = 16320;
 /* The maximal number of iproto messages in fly. */
 static int iproto_msg_max = IPROTO_MSG_MAX_MIN;
 
+/**
+ * Weights of session priority classes. When the message limit
+ * is reached, stopped connections of each class are resumed
+ * in proportion to its weight.
+ */
+static const int iproto_priority_weight[] = {
+	/* HIGH */ 4,
+	/* NORMAL */ 2,
+	/* LOW */ 1,
+};
+
 /**
  * Address the iproto listens for, stored in TX
  * thread. Is kept in TX to be shown in box.info.
@@ -146,6 +245,150 @@ iproto_bound_address(void)
 			    iproto_bound_address_len);
 }
 
+/**
+ * Compression state of a connection, see IPROTO_COMPRESS.
+ * Input is compressed starting right after the COMPRESS
+ * request, output - after the response to it. Is used
+ * exclusively by the iproto thread.
+ */
+struct iproto_zstd {
+	/** Compressed input which is not decompressed yet. */
+	struct ibuf in;
+	/** Compressed output which is not written yet. */
+	struct ibuf out;
+	ZSTD_CStream *cstream;
+	ZSTD_DStream *dstream;
+	/**
+	 * True if the decompressor may have more output, which
+	 * didn't fit into the input buffer.
+	 */
+	bool has_input;
+	/**
+	 * True if the response to COMPRESS is written to the
+	 * output buffer, and out_wpos points to its end.
+	 */
+	bool is_output_pending;
+	/** True if the output is compressed. */
+	bool is_output;
+	/** Position the output is compressed from. */
+	struct iproto_wpos out_wpos;
+};
+
+enum {
+	/** zstd level used for the connection output. */
+	IPROTO_ZSTD_LEVEL = 1,
+};
+
+static struct iproto_zstd *
+iproto_zstd_new(void)
+{
+	struct iproto_zstd *z =
+		(struct iproto_zstd *) calloc(1, sizeof(*z));
+	if (z == NULL) {
+		diag_set(OutOfMemory, sizeof(*z), "calloc", "zstd");
+		return NULL;
+	}
+	z->cstream = ZSTD_createCStream();
+	z->dstream = ZSTD_createDStream();
+	if (z->cstream == NULL || z->dstream == NULL) {
+		diag_set(OutOfMemory, 0, "ZSTD_createStream", "zstd");
+		goto error;
+	}
+	size_t rc;
+	rc = ZSTD_initCStream(z->cstream, IPROTO_ZSTD_LEVEL);
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_COMPRESSION, ZSTD_getErrorName(rc));
+		goto error;
+	}
+	rc = ZSTD_initDStream(z->dstream);
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_DECOMPRESSION, ZSTD_getErrorName(rc));
+		goto error;
+	}
+	ibuf_create(&z->in, cord_slab_cache(), iproto_readahead);
+	ibuf_create(&z->out, cord_slab_cache(), iproto_readahead);
+	return z;
+error:
+	ZSTD_freeCStream(z->cstream);
+	ZSTD_freeDStream(z->dstream);
+	free(z);
+	return NULL;
+}
+
+static void
+iproto_zstd_delete(struct iproto_zstd *z)
+{
+	ibuf_destroy(&z->in);
+	ibuf_destroy(&z->out);
+	ZSTD_freeCStream(z->cstream);
+	ZSTD_freeDStream(z->dstream);
+	free(z);
+}
+
+/**
+ * Compress @a iov and flush the compressor, so the peer can
+ * decompress all of it as soon as it gets the output buffer.
+ */
+static int
+iproto_zstd_compress(struct iproto_zstd *z, const struct iovec *iov,
+		     int iovcnt)
+{
+	size_t out_size = ZSTD_CStreamOutSize();
+	size_t rc;
+	for (int i = 0; i < iovcnt; i++) {
+		ZSTD_inBuffer src = { iov[i].iov_base, iov[i].iov_len, 0 };
+		while (src.pos < src.size) {
+			if (ibuf_reserve(&z->out, out_size) == NULL)
+				goto oom;
+			ZSTD_outBuffer dst = { z->out.wpos,
+					       ibuf_unused(&z->out), 0 };
+			rc = ZSTD_compressStream(z->cstream, &dst, &src);
+			if (ZSTD_isError(rc))
+				goto error;
+			z->out.wpos += dst.pos;
+		}
+	}
+	do {
+		if (ibuf_reserve(&z->out, out_size) == NULL)
+			goto oom;
+		ZSTD_outBuffer dst = { z->out.wpos, ibuf_unused(&z->out), 0 };
+		rc = ZSTD_flushStream(z->cstream, &dst);
+		if (ZSTD_isError(rc))
+			goto error;
+		z->out.wpos += dst.pos;
+	} while (rc != 0);
+	return 0;
+oom:
+	diag_set(OutOfMemory, out_size, "ibuf_reserve", "zstd");
+	return -1;
+error:
+	diag_set(ClientError, ER_COMPRESSION, ZSTD_getErrorName(rc));
+	return -1;
+}
+
+/**
+ * Shared memory transport state of a connection, see IPROTO_SHM.
+ * Input goes through the rings starting right after the SHM
+ * request, output - after the response to it. Is used
+ * exclusively by the iproto thread.
+ */
+struct iproto_conn_shm {
+	struct iproto_shm shm;
+	/** Watcher of the eventfd the client wakes us up with. */
+	struct ev_io wakeup;
+	/** True if the output waits for space in the ring. */
+	bool is_output_blocked;
+	/**
+	 * True if the response to SHM is written to the output
+	 * buffer, and out_wpos points to its end.
+	 */
+	bool is_output_pending;
+	/** True if the output goes through the ring. */
+	bool is_output;
+	/** Position the output goes through the ring from. */
+	struct iproto_wpos out_wpos;
+};
+
 /**
  * How big is a buffer which needs to be shrunk before
  * it is put back into buffer cache.
@@ -193,6 +436,8 @@ struct iproto_msg
 		struct request dml;
 		/** Box request, if this is a call or eval. */
 		struct call_request call;
+		/** Box request, if this is a batch of DML. */
+		struct batch_request batch;
 		/** Authentication request. */
 		struct auth_request auth;
 		/* SQL request, if this is the EXECUTE/PREPARE request. */
@@ -232,9 +477,130 @@ struct iproto_msg
 	 * and the connection must be closed.
 	 */
 	bool close_connection;
+	/** Priority class the message is accounted in. */
+	enum session_priority priority;
+	/** Time when the request was read by the iproto thread. */
+	double recv_time;
+	/**
+	 * Time when the tx thread started processing the
+	 * request or 0 if it isn't a request.
+	 */
+	double tx_start;
+};
+
+/**
+ * Network thread context. Each network thread runs an event
+ * loop in its own cord, accepts connections on the shared
+ * listening socket and talks to the tx thread over a dedicated
+ * pair of pipes, so request parsing and socket I/O of different
+ * connections can be spread across several cores.
+ */
+struct iproto_thread {
+	/** Thread id, an index in the iproto_threads array. */
+	uint32_t id;
+	/** Network cord. */
+	struct cord net_cord;
+	/**
+	 * A queue of requests of all connections served by this
+	 * thread. All requests from all connections are processed
+	 * concurrently. Is also used as a queue for just
+	 * established connections and to execute disconnect
+	 * triggers. A few notes about these triggers:
+	 * - they need to be run in a fiber
+	 * - unlike an ordinary request failure, on_connect trigger
+	 *   failure must lead to connection close.
+	 * - on_connect trigger must be processed before any other
+	 *   request on this connection.
+	 */
+	struct cpipe tx_pipe;
+	/** A pipe from tx to the network thread. */
+	struct cpipe net_pipe;
+	/**
+	 * Slab cache used for allocating memory for output
+	 * network buffers in the tx thread.
+	 */
+	struct slab_cache net_slabc;
+	/** Pool of iproto messages of this thread. */
+	struct mempool iproto_msg_pool;
+	/** Pool of connections served by this thread. */
+	struct mempool iproto_connection_pool;
+	/**
+	 * Connections stopped by the net_msg_max limit, by
+	 * priority class.
+	 */
+	struct rlist stopped_connections[session_priority_MAX];
+	/** The number of messages in flight, by priority class. */
+	int msg_count[session_priority_MAX];
+	/**
+	 * Credits of priority classes used to resume stopped
+	 * connections in the weighted round robin order.
+	 */
+	int resume_credit[session_priority_MAX];
+	/** Binary listener attached to the shared socket. */
+	struct evio_service binary;
+	/** Network statistics of this thread. */
+	struct rmean *rmean;
+	/*
+	 * Message routes. Since every route ends up in the
+	 * thread-specific net_pipe, the routes are per thread too.
+	 */
+	struct cmsg_hop destroy_route[2];
+	struct cmsg_hop disconnect_route[2];
+	struct cmsg_hop push_route[2];
+	struct cmsg_hop misc_route[2];
+	struct cmsg_hop compress_route[2];
+	struct cmsg_hop shm_route[2];
+	struct cmsg_hop call_route[2];
+	struct cmsg_hop select_route[2];
+	struct cmsg_hop process1_route[2];
+	struct cmsg_hop batch_route[2];
+	struct cmsg_hop sql_route[2];
+	struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX];
+	struct cmsg_hop join_route[2];
+	struct cmsg_hop subscribe_route[2];
+	struct cmsg_hop error_route[2];
+	struct cmsg_hop connect_route[2];
 };
 
-static struct mempool iproto_msg_pool;
+/** Network threads, configured with box.cfg.iproto_threads. */
+static struct iproto_thread *iproto_threads;
+/** Number of network threads. */
+static int iproto_threads_count;
+
+/** Stages of request processing with tracked latency. */
+enum iproto_latency_stage {
+	/** Time spent in the queue to the tx thread. */
+	IPROTO_LATENCY_NET,
+	/** Time of request execution in the tx thread. */
+	IPROTO_LATENCY_TX,
+	/** Time spent waiting for WAL writes, a part of tx time. */
+	IPROTO_LATENCY_WAL,
+	iproto_latency_stage_MAX,
+};
+
+static const char *iproto_latency_stage_strs[] = {"net", "tx", "wal"};
+
+/** Latency of requests by type and stage, tx thread only. */
+static struct latency
+iproto_latency[IPROTO_TYPE_STAT_MAX][iproto_latency_stage_MAX];
+/** Number of requests accounted in iproto_latency by type. */
+static int64_t iproto_latency_count[IPROTO_TYPE_STAT_MAX];
+/** Max fiber region memory used by a request, by request type. */
+static size_t iproto_region_max[IPROTO_TYPE_STAT_MAX];
+/** Total fiber region memory used by requests, by request type. */
+static int64_t iproto_region_total[IPROTO_TYPE_STAT_MAX];
+
+enum {
+	/** Number of request traces kept, must be a power of 2. */
+	IPROTO_TRACE_MAX = 1024,
+};
+
+/** Ring buffer of request traces, tx thread only. */
+static struct iproto_trace iproto_traces[IPROTO_TRACE_MAX];
+/** Number of traces ever written to iproto_traces. */
+static uint64_t iproto_trace_count;
+/** Share of requests without a trace id that are traced. */
+static double iproto_trace_sample_rate;
 
 static struct iproto_msg *
 iproto_msg_new(struct iproto_connection *con);
@@ -243,45 +609,14 @@ iproto_msg_new(struct iproto_connection *con);
  * Resume stopped connections, if any.
  */
 static void
-iproto_resume(void);
+iproto_resume(struct iproto_thread *iproto_thread);
 
 static void
 iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input);
 
 static inline void
-iproto_msg_delete(struct iproto_msg *msg)
-{
-	mempool_free(&iproto_msg_pool, msg);
-	iproto_resume();
-}
-
-/**
- * A single global queue for all requests in all connections. All
- * requests from all connections are processed concurrently.
- * Is also used as a queue for just established connections and to
- * execute disconnect triggers. A few notes about these triggers:
- * - they need to be run in a fiber
- * - unlike an ordinary request failure, on_connect trigger
- *   failure must lead to connection close.
- * - on_connect trigger must be processed before any other
- *   request on this connection.
- */
-static struct cpipe tx_pipe;
-static struct cpipe net_pipe;
-
-/**
- * Network thread.
- */
-static struct cord net_cord;
-
-/**
- * Slab cache used for allocating memory for output network buffers
- * in the tx thread.
- */
-static struct slab_cache net_slabc;
-
-struct rmean *rmean_net;
+iproto_msg_delete(struct iproto_msg *msg);
 
 enum rmean_net_name {
 	IPROTO_SENT,
@@ -304,11 +639,6 @@ tx_process_destroy(struct cmsg *m);
 static void
 net_finish_destroy(struct cmsg *m);
 
-static const struct cmsg_hop destroy_route[] = {
-	{ tx_process_destroy, &net_pipe },
-	{ net_finish_destroy, NULL },
-};
-
 /** Fire on_disconnect triggers in the tx thread. */
 static void
 tx_process_disconnect(struct cmsg *m);
@@ -317,11 +647,6 @@ tx_process_disconnect(struct cmsg *m);
 static void
 net_finish_disconnect(struct cmsg *m);
 
-static const struct cmsg_hop disconnect_route[] = {
-	{ tx_process_disconnect, &net_pipe },
-	{ net_finish_disconnect, NULL }
-};
-
 /**
  * Kharon is in the dead world (iproto). Schedule an event to
  * flush new obuf as reflected in the fresh wpos.
@@ -339,12 +664,6 @@ iproto_process_push(struct cmsg *m);
 static void
 tx_end_push(struct cmsg *m);
 
-static const struct cmsg_hop push_route[] = {
-	{ iproto_process_push, &tx_pipe },
-	{ tx_end_push, NULL }
-};
-
-
 /* }}} */
 
 /* {{{ iproto_connection - declaration and definition */
@@ -428,12 +747,30 @@ struct iproto_connection
 	 * is flushed by the iproto thread.
 	 */
 	struct obuf obuf[2];
+	/** Zero-copy segments of the output buffers. */
+	struct iproto_zc zc[2];
 	/**
 	 * Position in the output buffer that points to the beginning
 	 * of the data awaiting to be flushed. Advanced by the iproto
 	 * thread upon successfull flush.
 	 */
 	struct iproto_wpos wpos;
+	/**
+	 * The last completely flushed zero-copy segment of the
+	 * buffer pointed to by wpos, NULL if there is none yet.
+	 */
+	struct iproto_zc_seg *wseg;
+	/** How much of the segment following wseg is flushed. */
+	uint32_t wseg_offset;
+	/** Compression state, NULL unless COMPRESS is received. */
+	struct iproto_zstd *zstd;
+	/** Shared memory transport, NULL unless SHM is received. */
+	struct iproto_conn_shm *shm;
+	/** True if the connection is accepted on a unix socket. */
+	bool is_unix;
+	/** Descriptors received for SHM request, not attached yet. */
+	int shm_fds[iproto_shm_fd_MAX];
+	int shm_fd_count;
 	/**
 	 * Position in the output buffer that points to the end of the
 	 * data awaiting to be flushed. Advanced by the iproto thread
@@ -485,6 +822,11 @@ struct iproto_connection
 	 */
 	enum iproto_connection_state state;
 	struct rlist in_stop_list;
+	/**
+	 * Priority class of the connection, set by the tx thread
+	 * with box.session.priority().
+	 */
+	enum session_priority priority;
 	/**
 	 * Kharon is used to implement box.session.push().
 	 * When a new push is ready, tx uses kharon to notify
@@ -534,29 +876,54 @@ struct iproto_connection
 	} tx;
 	/** Authentication salt. */
 	char salt[IPROTO_SALT_SIZE];
+	/** Network thread serving the connection. */
+	struct iproto_thread *iproto_thread;
 };
 
-static struct mempool iproto_connection_pool;
-static RLIST_HEAD(stopped_connections);
-
 /**
- * Return true if we have not enough spare messages
- * in the message pool.
+ * Return true if we have not enough spare messages in the
+ * message pool of a network thread for a priority class.
+ *
+ * Low priority connections may use only a quarter of
+ * net_msg_max, while high priority ones may exceed it by a
+ * quarter, so that a burst of requests from other connections
+ * can't lock them out of the tx thread.
  */
 static inline bool
-iproto_check_msg_max(void)
+iproto_check_msg_max(struct iproto_thread *iproto_thread,
+		     enum session_priority priority)
+{
+	size_t request_count = mempool_count(&iproto_thread->iproto_msg_pool);
+	int reserve = MAX(iproto_msg_max / 4, 1);
+	switch (priority) {
+	case SESSION_PRIORITY_HIGH:
+		return request_count > (size_t) (iproto_msg_max + reserve);
+	case SESSION_PRIORITY_LOW:
+		if (iproto_thread->msg_count[priority] > reserve)
+			return true;
+		FALLTHROUGH;
+	default:
+		return request_count > (size_t) iproto_msg_max;
+	}
+}
+
+static inline void
+iproto_msg_delete(struct iproto_msg *msg)
 {
-	size_t request_count = mempool_count(&iproto_msg_pool);
-	return request_count > (size_t) iproto_msg_max;
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
+	iproto_thread->msg_count[msg->priority]--;
+	mempool_free(&iproto_thread->iproto_msg_pool, msg);
+	iproto_resume(iproto_thread);
 }
 
 static struct iproto_msg *
 iproto_msg_new(struct iproto_connection *con)
 {
+	struct mempool *iproto_msg_pool = &con->iproto_thread->iproto_msg_pool;
 	struct iproto_msg *msg =
-		(struct iproto_msg *) mempool_alloc(&iproto_msg_pool);
+		(struct iproto_msg *) mempool_alloc(iproto_msg_pool);
 	ERROR_INJECT(ERRINJ_TESTING, {
-		mempool_free(&iproto_msg_pool, msg);
+		mempool_free(iproto_msg_pool, msg);
 		msg = NULL;
 	});
 	if (msg == NULL) {
@@ -566,7 +933,10 @@ iproto_msg_new(struct iproto_connection *con)
 		return NULL;
 	}
 	msg->connection = con;
-	rmean_collect(rmean_net, IPROTO_REQUESTS, 1);
+	msg->priority = con->priority;
+	msg->tx_start = 0;
+	con->iproto_thread->msg_count[msg->priority]++;
+	rmean_collect(con->iproto_thread->rmean, IPROTO_REQUESTS, 1);
 	return msg;
 }
 
@@ -621,7 +991,8 @@ iproto_connection_stop_msg_max_limit(struct iproto_connection *con)
 	 * Important to add to tail and fetch from head to ensure
 	 * strict lifo order (fairness) for stopped connections.
 	 */
-	rlist_add_tail(&stopped_connections, &con->in_stop_list);
+	rlist_add_tail(&con->iproto_thread->stopped_connections[con->priority],
+		       &con->in_stop_list);
 }
 
 /**
@@ -650,7 +1021,7 @@ iproto_connection_try_to_start_destroy(struct iproto_connection *con)
 	 * other parts of the connection.
 	 */
 	con->state = IPROTO_CONNECTION_DESTROYED;
-	cpipe_push(&tx_pipe, &con->destroy_msg);
+	cpipe_push(&con->iproto_thread->tx_pipe, &con->destroy_msg);
 }
 
 /**
@@ -670,6 +1041,10 @@ iproto_connection_close(struct iproto_connection *con)
 		/* Make evio_has_fd() happy */
 		con->input.fd = con->output.fd = -1;
 		close(fd);
+		if (con->shm != NULL) {
+			ev_io_stop(con->loop, &con->shm->wakeup);
+			iproto_shm_close(&con->shm->shm);
+		}
 		/*
 		 * Discard unparsed data, to recycle the
 		 * connection in net_send_msg() as soon as all
@@ -677,7 +1052,7 @@ iproto_connection_close(struct iproto_connection *con)
 		 * is done only once.
 		 */
 		con->p_ibuf->wpos -= con->parse_size;
-		cpipe_push(&tx_pipe, &con->disconnect_msg);
+		cpipe_push(&con->iproto_thread->tx_pipe, &con->disconnect_msg);
 		assert(con->state == IPROTO_CONNECTION_ALIVE);
 		con->state = IPROTO_CONNECTION_CLOSED;
 	} else if (con->state == IPROTO_CONNECTION_PENDING_DESTROY) {
@@ -792,6 +1167,116 @@ iproto_connection_input_buffer(struct iproto_connection *con)
 	return new_ibuf;
 }
 
+/**
+ * True if there is compressed input which is read from the
+ * socket, but not decompressed yet.
+ */
+static inline bool
+iproto_connection_has_zstd_input(struct iproto_connection *con)
+{
+	return con->zstd != NULL &&
+	       (ibuf_used(&con->zstd->in) != 0 || con->zstd->has_input);
+}
+
+/**
+ * Start decompressing the input of a connection on COMPRESS
+ * request. The input following the request, which ends at
+ * @a reqend of @a in, is moved to the compressed input buffer.
+ */
+static int
+iproto_connection_compress(struct iproto_connection *con, struct ibuf *in,
+			   const char *reqend, enum compression_type type)
+{
+	if (type == COMPRESSION_TYPE_NONE && con->zstd == NULL)
+		return 0;
+	if (con->zstd != NULL || con->shm != NULL) {
+		diag_set(ClientError, ER_UNSUPPORTED, "IPROTO",
+			 "changing connection compression");
+		return -1;
+	}
+	assert(type == COMPRESSION_TYPE_ZSTD);
+	struct iproto_zstd *z = iproto_zstd_new();
+	if (z == NULL)
+		return -1;
+	size_t size = in->wpos - reqend;
+	if (size > 0) {
+		if (ibuf_reserve(&z->in, size) == NULL) {
+			iproto_zstd_delete(z);
+			diag_set(OutOfMemory, size, "ibuf_reserve", "zstd");
+			return -1;
+		}
+		memcpy(z->in.wpos, reqend, size);
+		z->in.wpos += size;
+		in->wpos -= size;
+		assert(con->parse_size >= size);
+		con->parse_size -= size;
+	}
+	con->zstd = z;
+	return 0;
+}
+
+static void
+iproto_connection_on_shm_wakeup(ev_loop *loop, struct ev_io *watcher,
+				int revents);
+
+/**
+ * Switch the input of a connection to the shared memory rings
+ * passed along with SHM request, which ends at @a reqend of
+ * @a in. The client must not send anything after the request
+ * until it gets the response.
+ */
+static int
+iproto_connection_attach_shm(struct iproto_connection *con, struct ibuf *in,
+			     const char *reqend)
+{
+	if (con->zstd != NULL || con->shm != NULL) {
+		diag_set(ClientError, ER_UNSUPPORTED, "IPROTO",
+			 "changing connection transport");
+		return -1;
+	}
+	if (con->shm_fd_count != iproto_shm_fd_MAX) {
+		diag_set(ClientError, ER_PROTOCOL, "SHM request must be sent "
+			 "over a unix socket along with the descriptors");
+		return -1;
+	}
+	if (reqend != in->wpos) {
+		diag_set(ClientError, ER_PROTOCOL,
+			 "Unexpected data after SHM request");
+		return -1;
+	}
+	struct iproto_conn_shm *s =
+		(struct iproto_conn_shm *) calloc(1, sizeof(*s));
+	if (s == NULL) {
+		diag_set(OutOfMemory, sizeof(*s), "calloc", "shm");
+		return -1;
+	}
+	/* The descriptors are closed on failure. */
+	con->shm_fd_count = 0;
+	if (iproto_shm_attach(&s->shm, con->shm_fds) != 0) {
+		free(s);
+		return -1;
+	}
+	ev_io_init(&s->wakeup, iproto_connection_on_shm_wakeup,
+		   s->shm.wait_fd, EV_READ);
+	s->wakeup.data = con;
+	ev_io_start(con->loop, &s->wakeup);
+	con->shm = s;
+	return 0;
+}
+
+static void
+iproto_connection_delete_shm(struct iproto_connection *con)
+{
+	for (int i = 0; i < con->shm_fd_count; i++)
+		close(con->shm_fds[i]);
+	con->shm_fd_count = 0;
+	if (con->shm != NULL) {
+		iproto_shm_destroy(&con->shm->shm);
+		free(con->shm);
+		con->shm = NULL;
+	}
+}
+
 /**
  * Enqueue all requests which were read up. If a request limit is
  * reached - stop the connection input even if not the whole batch
@@ -807,13 +1292,14 @@ static inline int
 iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 {
 	assert(rlist_empty(&con->in_stop_list));
+	struct cpipe *tx_pipe = &con->iproto_thread->tx_pipe;
 	int n_requests = 0;
 	bool stop_input = false;
 	const char *errmsg;
 	while (con->parse_size != 0 && !stop_input) {
-		if (iproto_check_msg_max()) {
+		if (iproto_check_msg_max(con->iproto_thread, con->priority)) {
 			iproto_connection_stop_msg_max_limit(con);
-			cpipe_flush_input(&tx_pipe);
+			cpipe_flush_input(tx_pipe);
 			return 0;
 		}
 		const char *reqstart = in->wpos - con->parse_size;
@@ -822,7 +1308,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		if (mp_typeof(*pos) != MP_UINT) {
 			errmsg = "packet length";
 err_msgpack:
-			cpipe_flush_input(&tx_pipe);
+			cpipe_flush_input(tx_pipe);
 			diag_set(ClientError, ER_INVALID_MSGPACK,
 				 errmsg);
 			return -1;
@@ -854,11 +1340,12 @@ err_msgpack:
 		msg->len = reqend - reqstart; /* total request length */
 
 		iproto_msg_decode(msg, &pos, reqend, &stop_input);
+		msg->recv_time = ev_monotonic_now(con->loop);
 		/*
 		 * This can't throw, but should not be
 		 * done in case of exception.
 		 */
-		cpipe_push_input(&tx_pipe, &msg->base);
+		cpipe_push_input(tx_pipe, &msg->base);
 		n_requests++;
 		/* Request is parsed */
 		assert(reqend > reqstart);
@@ -876,7 +1363,14 @@ err_msgpack:
 		 */
 		ev_io_stop(con->loop, &con->output);
 		ev_io_stop(con->loop, &con->input);
-	} else if (n_requests != 1 || con->parse_size != 0) {
+	} else if (con->shm != NULL) {
+		/*
+		 * The client wakes us up only after we find the
+		 * ring empty, so read it until then.
+		 */
+		ev_feed_event(con->loop, &con->input, EV_CUSTOM);
+	} else if (n_requests != 1 || con->parse_size != 0 ||
+		   iproto_connection_has_zstd_input(con)) {
 		/*
 		 * Keep reading input, as long as the socket
 		 * supplies data, but don't waste CPU on an extra
@@ -896,7 +1390,7 @@ err_msgpack:
 		 */
 		ev_feed_event(con->loop, &con->input, EV_READ);
 	}
-	cpipe_flush_input(&tx_pipe);
+	cpipe_flush_input(tx_pipe);
 	return 0;
 }
 
@@ -908,7 +1402,7 @@ err_msgpack:
 static void
 iproto_connection_resume(struct iproto_connection *con)
 {
-	assert(! iproto_check_msg_max());
+	assert(!iproto_check_msg_max(con->iproto_thread, con->priority));
 	rlist_del(&con->in_stop_list);
 	/*
 	 * Enqueue_batch() stops the connection again, if the
@@ -930,26 +1424,143 @@ iproto_connection_resume(struct iproto_connection *con)
  * as an iproto message and exhaust the limit. Thus we aren't
  * really resuming all connections here: only as many as is
  * necessary to use up the limit.
+ *
+ * Priority classes take turns in the smooth weighted round
+ * robin order: every class which has a connection to resume
+ * gains its weight in credits, and the richest one pays the
+ * sum of the weights for the turn.
  */
 static void
-iproto_resume(void)
-{
-	while (!iproto_check_msg_max() && !rlist_empty(&stopped_connections)) {
+iproto_resume(struct iproto_thread *iproto_thread)
+{
+	int *credit = iproto_thread->resume_credit;
+	while (true) {
+		int next = -1;
+		int total_weight = 0;
+		for (int i = 0; i < session_priority_MAX; i++) {
+			enum session_priority priority =
+				(enum session_priority) i;
+			if (rlist_empty(&iproto_thread->stopped_connections[i]) ||
+			    iproto_check_msg_max(iproto_thread, priority))
+				continue;
+			credit[i] += iproto_priority_weight[i];
+			total_weight += iproto_priority_weight[i];
+			if (next < 0 || credit[i] > credit[next])
+				next = i;
+		}
+		if (next < 0)
+			break;
+		credit[next] -= total_weight;
 		/*
 		 * Shift from list head to ensure strict FIFO
 		 * (fairness) for resumed connections.
 		 */
 		struct iproto_connection *con =
-			rlist_first_entry(&stopped_connections,
+			rlist_first_entry(&iproto_thread->
+					  stopped_connections[next],
 					  struct iproto_connection,
 					  in_stop_list);
 		iproto_connection_resume(con);
 	}
 }
 
+/**
+ * Read compressed input and decompress it to @a in.
+ * @return the number of bytes decompressed, or the result of
+ * sio_read() if there is nothing to decompress.
+ */
+static int
+iproto_connection_read_zstd(struct iproto_connection *con, struct ibuf *in)
+{
+	struct iproto_zstd *z = con->zstd;
+	while (true) {
+		if (ibuf_used(&z->in) != 0 || z->has_input) {
+			ZSTD_inBuffer src = { z->in.rpos, ibuf_used(&z->in), 0 };
+			ZSTD_outBuffer dst = { in->wpos, ibuf_unused(in), 0 };
+			size_t rc = ZSTD_decompressStream(z->dstream, &dst, &src);
+			if (ZSTD_isError(rc)) {
+				tnt_raise(ClientError, ER_DECOMPRESSION,
+					  ZSTD_getErrorName(rc));
+			}
+			z->in.rpos += src.pos;
+			z->has_input = dst.pos == dst.size;
+			if (dst.pos > 0)
+				return dst.pos;
+		}
+		if (ibuf_used(&z->in) == 0)
+			ibuf_reset(&z->in);
+		ibuf_reserve_xc(&z->in, ZSTD_DStreamInSize());
+		int nrd = sio_read(con->input.fd, z->in.wpos,
+				   ibuf_unused(&z->in));
+		if (nrd <= 0)
+			return nrd;
+		rmean_collect(con->iproto_thread->rmean, IPROTO_RECEIVED, nrd);
+		z->in.wpos += nrd;
+	}
+}
+
+/**
+ * Read input from the shared memory ring to @a in. If the ring
+ * is empty, the socket is read on EV_READ only, to find out if
+ * the client is gone.
+ * @return the number of bytes read, or the result of sio_read()
+ * if the ring is empty.
+ */
+static int
+iproto_connection_read_shm(struct iproto_connection *con, struct ibuf *in,
+			   int revents)
+{
+	struct iproto_shm *shm = &con->shm->shm;
+	while (true) {
+		ssize_t nrd = iproto_shm_read(shm, in->wpos, ibuf_unused(in));
+		if (nrd < 0)
+			diag_raise();
+		if (nrd > 0) {
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_RECEIVED, nrd);
+			return nrd;
+		}
+		if (iproto_shm_is_closed(shm))
+			return 0;
+		if (iproto_shm_wait_read(shm))
+			break;
+	}
+	if ((revents & EV_READ) == 0) {
+		errno = EAGAIN;
+		return -1;
+	}
+	char c;
+	int nrd = sio_read(con->input.fd, &c, sizeof(c));
+	if (nrd > 0) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Unexpected data on a shared memory connection");
+	}
+	return nrd;
+}
+
+/**
+ * Read input from a unix socket, keeping the descriptors
+ * passed along with SHM request until it is decoded.
+ */
+static int
+iproto_connection_read_fds(struct iproto_connection *con, struct ibuf *in)
+{
+	int fds[iproto_shm_fd_MAX];
+	int fd_count = iproto_shm_fd_MAX;
+	int nrd = sio_read_fds(con->input.fd, in->wpos, ibuf_unused(in),
+			       fds, &fd_count);
+	if (fd_count > 0) {
+		for (int i = 0; i < con->shm_fd_count; i++)
+			close(con->shm_fds[i]);
+		memcpy(con->shm_fds, fds, fd_count * sizeof(fds[0]));
+		con->shm_fd_count = fd_count;
+	}
+	return nrd;
+}
+
 static void
 iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
-			   int /* revents */)
+			   int revents)
 {
 	struct iproto_connection *con =
 		(struct iproto_connection *) watcher->data;
@@ -962,7 +1573,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	 * otherwise we might deplete the fiber pool in tx
 	 * thread and deadlock.
 	 */
-	if (iproto_check_msg_max()) {
+	if (iproto_check_msg_max(con->iproto_thread, con->priority)) {
 		iproto_connection_stop_msg_max_limit(con);
 		return;
 	}
@@ -975,7 +1586,15 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 			return;
 		}
 		/* Read input. */
-		int nrd = sio_read(fd, in->wpos, ibuf_unused(in));
+		int nrd;
+		if (con->shm != NULL)
+			nrd = iproto_connection_read_shm(con, in, revents);
+		else if (con->zstd != NULL)
+			nrd = iproto_connection_read_zstd(con, in);
+		else if (con->is_unix)
+			nrd = iproto_connection_read_fds(con, in);
+		else
+			nrd = sio_read(fd, in->wpos, ibuf_unused(in));
 		if (nrd < 0) {                  /* Socket is not ready. */
 			if (! sio_wouldblock(errno))
 				diag_raise();
@@ -987,7 +1606,10 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 			return;
 		}
 		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
+		if (con->zstd == NULL && con->shm == NULL) {
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_RECEIVED, nrd);
+		}
 
 		/* Update the read position and connection state. */
 		in->wpos += nrd;
@@ -1003,12 +1625,254 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
+static inline struct iproto_zc *
+iproto_obuf_zc(struct iproto_connection *con, struct obuf *obuf)
+{
+	return &con->zc[obuf - con->obuf];
+}
+
+/**
+ * Get the segment following @a seg, or the first one if @a seg
+ * is NULL, provided it is sent before the buffer position @a end.
+ */
+static inline struct iproto_zc_seg *
+iproto_zc_next(struct iproto_zc *zc, struct iproto_zc_seg *seg, size_t end)
+{
+	struct iproto_zc_seg **link = seg == NULL ? &zc->first : &seg->next;
+	struct iproto_zc_seg *next =
+		pm_atomic_load_explicit(link, pm_memory_order_acquire);
+	return next != NULL && next->pos <= end ? next : NULL;
+}
+
+enum {
+	/** Each zero-copy segment may split a buffer iovec in two. */
+	IPROTO_FLUSH_IOV_MAX = SMALL_OBUF_IOV_MAX + 1 + 2 * IPROTO_ZC_IOV_MAX,
+};
+
+/**
+ * Interleave the buffer output with zero-copy segments.
+ * @a iov is the buffer output from the flushed position to
+ * @a end, @a seg is the first segment to send. The segment
+ * sent by each of the resulting @a out iovecs is stored in
+ * @a out_seg, NULL for the buffer output.
+ *
+ * @return the number of iovecs in @a out.
+ */
+static int
+iproto_flush_prepare(struct iproto_connection *con, struct iovec *iov,
+		     int iovcnt, struct iproto_zc_seg *seg,
+		     const struct obuf_svp *end, struct iovec *out,
+		     struct iproto_zc_seg **out_seg, size_t *total)
+{
+	struct iproto_zc *zc = iproto_obuf_zc(con, con->wpos.obuf);
+	int outcnt = 0;
+	int segcnt = 0;
+	size_t pos = con->wpos.svp.used;
+	uint32_t seg_offset = con->wseg_offset;
+	int i = 0;
+	size_t offset = 0;
+	*total = 0;
+	while (true) {
+		while (seg != NULL && seg->pos == pos &&
+		       segcnt < IPROTO_ZC_IOV_MAX) {
+			out[outcnt].iov_base = (char *) seg->data + seg_offset;
+			out[outcnt].iov_len = seg->size - seg_offset;
+			*total += out[outcnt].iov_len;
+			out_seg[outcnt++] = seg;
+			segcnt++;
+			seg_offset = 0;
+			seg = iproto_zc_next(zc, seg, end->used);
+		}
+		/*
+		 * Stop at the end of the buffer output or at a
+		 * segment which doesn't fit into this writev().
+		 */
+		if (i == iovcnt || (seg != NULL && seg->pos == pos))
+			break;
+		size_t len = iov[i].iov_len - offset;
+		if (seg != NULL)
+			len = MIN(len, seg->pos - pos);
+		out[outcnt].iov_base = (char *) iov[i].iov_base + offset;
+		out[outcnt].iov_len = len;
+		*total += len;
+		out_seg[outcnt++] = NULL;
+		pos += len;
+		offset += len;
+		if (offset == iov[i].iov_len) {
+			i++;
+			offset = 0;
+		}
+	}
+	assert(outcnt <= IPROTO_FLUSH_IOV_MAX);
+	return outcnt;
+}
+
+/**
+ * Advance the flushed position by @a nwr bytes of the output
+ * prepared by iproto_flush_prepare().
+ */
+static void
+iproto_flush_advance(struct iproto_connection *con, struct iovec *iov,
+		     const struct iovec *out, struct iproto_zc_seg **out_seg,
+		     int outcnt, size_t nwr, const struct obuf_svp *end)
+{
+	struct obuf_svp *begin = &con->wpos.svp;
+	size_t obuf_nwr = 0;
+	for (int j = 0; j < outcnt; j++) {
+		size_t len = MIN(nwr, out[j].iov_len);
+		nwr -= len;
+		if (out_seg[j] == NULL) {
+			obuf_nwr += len;
+		} else if (len == out[j].iov_len) {
+			con->wseg = out_seg[j];
+			con->wseg_offset = 0;
+		} else {
+			con->wseg_offset += len;
+		}
+		if (len < out[j].iov_len)
+			break;
+	}
+	if (obuf_nwr == 0)
+		return;
+	if (begin->used + obuf_nwr == end->used) {
+		*begin = *end;
+	} else {
+		size_t offset = 0;
+		int advance = sio_move_iov(iov, obuf_nwr, &offset);
+		begin->used += obuf_nwr;
+		begin->iov_len = advance == 0 ?
+				 begin->iov_len + offset : offset;
+		begin->pos += advance;
+		assert(begin->pos <= end->pos);
+	}
+}
+
+/**
+ * writev() the buffer output interleaved with zero-copy segments
+ * and handle the result.
+ */
+static int
+iproto_flush_zc(struct iproto_connection *con, struct iovec *iov, int iovcnt,
+		struct iproto_zc_seg *seg, const struct obuf_svp *end)
+{
+	struct iovec out[IPROTO_FLUSH_IOV_MAX];
+	struct iproto_zc_seg *out_seg[IPROTO_FLUSH_IOV_MAX];
+	size_t total;
+	int outcnt = iproto_flush_prepare(con, iov, iovcnt, seg, end,
+					  out, out_seg, &total);
+	ssize_t nwr = sio_writev(con->output.fd, out, outcnt);
+	if (nwr < 0) {
+		if (! sio_wouldblock(errno))
+			diag_raise();
+		return -1;
+	}
+	rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+	iproto_flush_advance(con, iov, out, out_seg, outcnt, nwr, end);
+	/*
+	 * Even if everything is written, there may be segments
+	 * left which didn't fit, so let the caller retry.
+	 */
+	return (size_t) nwr == total ? 0 : -1;
+}
+
+/** write() the compressed output and handle the result. */
+static int
+iproto_flush_zstd_output(struct iproto_connection *con)
+{
+	struct ibuf *out = &con->zstd->out;
+	ssize_t nwr = sio_write(con->output.fd, out->rpos, ibuf_used(out));
+	if (nwr < 0) {
+		if (! sio_wouldblock(errno))
+			diag_raise();
+		return -1;
+	}
+	rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+	out->rpos += nwr;
+	if (ibuf_used(out) != 0)
+		return -1;
+	ibuf_reset(out);
+	return 0;
+}
+
+/**
+ * Compress the buffer output along with zero-copy segments,
+ * consider it flushed and write the compressed output.
+ */
+static int
+iproto_flush_zstd(struct iproto_connection *con, struct iovec *iov,
+		  int iovcnt, struct iproto_zc_seg *seg,
+		  const struct obuf_svp *end)
+{
+	struct iovec out[IPROTO_FLUSH_IOV_MAX];
+	struct iproto_zc_seg *out_seg[IPROTO_FLUSH_IOV_MAX];
+	size_t total;
+	int outcnt = iproto_flush_prepare(con, iov, iovcnt, seg, end,
+					  out, out_seg, &total);
+	if (iproto_zstd_compress(con->zstd, out, outcnt) != 0)
+		diag_raise();
+	iproto_flush_advance(con, iov, out, out_seg, outcnt, total, end);
+	return iproto_flush_zstd_output(con);
+}
+
+/**
+ * Copy the buffer output along with zero-copy segments to the
+ * shared memory ring. If the ring is full, the output waits for
+ * the client to wake us up rather than for the socket.
+ */
+static int
+iproto_flush_shm(struct iproto_connection *con, struct iovec *iov,
+		 int iovcnt, struct iproto_zc_seg *seg,
+		 const struct obuf_svp *end)
+{
+	struct iproto_conn_shm *s = con->shm;
+	struct iovec out[IPROTO_FLUSH_IOV_MAX];
+	struct iproto_zc_seg *out_seg[IPROTO_FLUSH_IOV_MAX];
+	size_t total;
+	int outcnt = iproto_flush_prepare(con, iov, iovcnt, seg, end,
+					  out, out_seg, &total);
+	ssize_t nwr = iproto_shm_writev(&s->shm, out, outcnt);
+	if (nwr < 0)
+		diag_raise();
+	if (nwr == 0 && total != 0) {
+		if (!iproto_shm_wait_write(&s->shm))
+			return 0;
+		s->is_output_blocked = true;
+		return -1;
+	}
+	rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+	iproto_flush_advance(con, iov, out, out_seg, outcnt, nwr, end);
+	/* Let the caller retry until the ring is full. */
+	return 0;
+}
+
 /** writev() to the socket and handle the result. */
 
 static int
 iproto_flush(struct iproto_connection *con)
 {
 	int fd = con->output.fd;
+	struct iproto_zstd *z = con->zstd;
+	if (z != NULL) {
+		if (z->is_output_pending &&
+		    z->out_wpos.obuf == con->wpos.obuf &&
+		    z->out_wpos.svp.used == con->wpos.svp.used) {
+			/* The response to COMPRESS is flushed. */
+			z->is_output_pending = false;
+			z->is_output = true;
+		}
+		/* Send what's compressed before compressing more. */
+		if (ibuf_used(&z->out) != 0 &&
+		    iproto_flush_zstd_output(con) != 0)
+			return -1;
+	}
+	struct iproto_conn_shm *shm = con->shm;
+	if (shm != NULL && shm->is_output_pending &&
+	    shm->out_wpos.obuf == con->wpos.obuf &&
+	    shm->out_wpos.svp.used == con->wpos.svp.used) {
+		/* The response to SHM is flushed. */
+		shm->is_output_pending = false;
+		shm->is_output = true;
+	}
 	struct obuf *obuf = con->wpos.obuf;
 	struct obuf_svp obuf_end = obuf_create_svp(obuf);
 	struct obuf_svp *begin = &con->wpos.svp;
@@ -1018,35 +1882,64 @@ iproto_flush(struct iproto_connection *con)
 		 * Flush the current buffer before
 		 * advancing to the next one.
 		 */
-		if (begin->used == obuf_end.used) {
+		if (begin->used == obuf_end.used &&
+		    iproto_zc_next(iproto_obuf_zc(con, obuf), con->wseg,
+				   obuf_end.used) == NULL) {
 			obuf = con->wpos.obuf = con->wend.obuf;
 			obuf_svp_reset(begin);
+			con->wseg = NULL;
+			con->wseg_offset = 0;
 		} else {
 			end = &obuf_end;
 		}
 	}
-	if (begin->used == end->used) {
+	if (z != NULL && z->is_output_pending &&
+	    z->out_wpos.obuf == obuf && z->out_wpos.svp.used < end->used) {
+		/* Don't compress the response to COMPRESS. */
+		end = &z->out_wpos.svp;
+	}
+	if (shm != NULL && shm->is_output_pending &&
+	    shm->out_wpos.obuf == obuf && shm->out_wpos.svp.used < end->used) {
+		/* Send the response to SHM over the socket. */
+		end = &shm->out_wpos.svp;
+	}
+	struct iproto_zc_seg *seg = iproto_zc_next(iproto_obuf_zc(con, obuf),
+						   con->wseg, end->used);
+	if (begin->used == end->used && seg == NULL) {
 		/* Nothing to do. */
 		return 1;
 	}
-	assert(begin->used < end->used);
+	assert(begin->used <= end->used);
 	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
-	struct iovec *src = obuf->iov;
-	int iovcnt = end->pos - begin->pos + 1;
-	/*
-	 * iov[i].iov_len may be concurrently modified in tx thread,
-	 * but only for the last position.
-	 */
-	memcpy(iov, src + begin->pos, iovcnt * sizeof(struct iovec));
-	sio_add_to_iov(iov, -begin->iov_len);
-	/* *Overwrite* iov_len of the last pos as it may be garbage. */
-	iov[iovcnt-1].iov_len = end->iov_len - begin->iov_len * (iovcnt == 1);
+	int iovcnt = 0;
+	if (begin->used < end->used) {
+		struct iovec *src = obuf->iov;
+		iovcnt = end->pos - begin->pos + 1;
+		/*
+		 * iov[i].iov_len may be concurrently modified in tx
+		 * thread, but only for the last position.
+		 */
+		memcpy(iov, src + begin->pos, iovcnt * sizeof(struct iovec));
+		sio_add_to_iov(iov, -begin->iov_len);
+		/*
+		 * *Overwrite* iov_len of the last pos as it may be
+		 * garbage.
+		 */
+		iov[iovcnt-1].iov_len = end->iov_len -
+					begin->iov_len * (iovcnt == 1);
+	}
+	if (z != NULL && z->is_output)
+		return iproto_flush_zstd(con, iov, iovcnt, seg, end);
+	if (shm != NULL && shm->is_output)
+		return iproto_flush_shm(con, iov, iovcnt, seg, end);
+	if (seg != NULL)
+		return iproto_flush_zc(con, iov, iovcnt, seg, end);
 
 	ssize_t nwr = sio_writev(fd, iov, iovcnt);
 
 	if (nwr > 0) {
 		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_SENT, nwr);
+		rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
 		if (begin->used + nwr == end->used) {
 			*begin = *end;
 			return 0;
@@ -1074,7 +1967,13 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 		int rc;
 		while ((rc = iproto_flush(con)) <= 0) {
 			if (rc != 0) {
-				ev_io_start(loop, &con->output);
+				if (con->shm != NULL &&
+				    con->shm->is_output_blocked) {
+					/* Wait for the client wakeup. */
+					ev_io_stop(loop, &con->output);
+				} else {
+					ev_io_start(loop, &con->output);
+				}
 				return;
 			}
 			if (! ev_is_active(&con->input) &&
@@ -1090,11 +1989,32 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
+/**
+ * The client wakes us up when it writes to the input ring or
+ * reads from the output ring we are waiting for.
+ */
+static void
+iproto_connection_on_shm_wakeup(ev_loop *loop, struct ev_io *watcher,
+				int /* revents */)
+{
+	struct iproto_connection *con =
+		(struct iproto_connection *) watcher->data;
+	struct iproto_conn_shm *s = con->shm;
+	iproto_shm_clear_wakeup(&s->shm);
+	if (s->is_output_blocked) {
+		s->is_output_blocked = false;
+		ev_feed_event(loop, &con->output, EV_WRITE);
+	}
+	/* Stopped input is resumed with the ring read anyway. */
+	if (ev_is_active(&con->input))
+		ev_feed_event(loop, &con->input, EV_CUSTOM);
+}
+
 static struct iproto_connection *
-iproto_connection_new(int fd)
+iproto_connection_new(struct iproto_thread *iproto_thread, int fd)
 {
 	struct iproto_connection *con = (struct iproto_connection *)
-		mempool_alloc(&iproto_connection_pool);
+		mempool_alloc(&iproto_thread->iproto_connection_pool);
 	if (con == NULL) {
 		diag_set(OutOfMemory, sizeof(*con), "mempool_alloc", "con");
 		return NULL;
@@ -1105,23 +2025,33 @@ iproto_connection_new(int fd)
 	ev_io_init(&con->output, iproto_connection_on_output, fd, EV_WRITE);
 	ibuf_create(&con->ibuf[0], cord_slab_cache(), iproto_readahead);
 	ibuf_create(&con->ibuf[1], cord_slab_cache(), iproto_readahead);
-	obuf_create(&con->obuf[0], &net_slabc, iproto_readahead);
-	obuf_create(&con->obuf[1], &net_slabc, iproto_readahead);
+	obuf_create(&con->obuf[0], &iproto_thread->net_slabc, iproto_readahead);
+	obuf_create(&con->obuf[1], &iproto_thread->net_slabc, iproto_readahead);
 	con->p_ibuf = &con->ibuf[0];
+	iproto_zc_create(&con->zc[0]);
+	iproto_zc_create(&con->zc[1]);
 	con->tx.p_obuf = &con->obuf[0];
 	iproto_wpos_create(&con->wpos, con->tx.p_obuf);
 	iproto_wpos_create(&con->wend, con->tx.p_obuf);
+	con->wseg = NULL;
+	con->wseg_offset = 0;
+	con->zstd = NULL;
+	con->shm = NULL;
+	con->is_unix = false;
+	con->shm_fd_count = 0;
 	con->parse_size = 0;
 	con->long_poll_count = 0;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
+	con->priority = SESSION_PRIORITY_NORMAL;
+	con->iproto_thread = iproto_thread;
 	/* It may be very awkward to allocate at close. */
-	cmsg_init(&con->destroy_msg, destroy_route);
-	cmsg_init(&con->disconnect_msg, disconnect_route);
+	cmsg_init(&con->destroy_msg, iproto_thread->destroy_route);
+	cmsg_init(&con->disconnect_msg, iproto_thread->disconnect_route);
 	con->state = IPROTO_CONNECTION_ALIVE;
 	con->tx.is_push_pending = false;
 	con->tx.is_push_sent = false;
-	rmean_collect(rmean_net, IPROTO_CONNECTIONS, 1);
+	rmean_collect(iproto_thread->rmean, IPROTO_CONNECTIONS, 1);
 	return con;
 }
 
@@ -1140,11 +2070,14 @@ iproto_connection_delete(struct iproto_connection *con)
 	 */
 	ibuf_destroy(&con->ibuf[0]);
 	ibuf_destroy(&con->ibuf[1]);
+	if (con->zstd != NULL)
+		iproto_zstd_delete(con->zstd);
+	iproto_connection_delete_shm(con);
 	assert(con->obuf[0].pos == 0 &&
 	       con->obuf[0].iov[0].iov_base == NULL);
 	assert(con->obuf[1].pos == 0 &&
 	       con->obuf[1].iov[0].iov_base == NULL);
-	mempool_free(&iproto_connection_pool, con);
+	mempool_free(&con->iproto_thread->iproto_connection_pool, con);
 }
 
 /* }}} iproto_connection */
@@ -1154,6 +2087,9 @@ iproto_connection_delete(struct iproto_connection *con)
 static void
 tx_process_misc(struct cmsg *msg);
 
+static void
+tx_process_switch(struct cmsg *msg);
+
 static void
 tx_process_call(struct cmsg *msg);
 
@@ -1163,6 +2099,9 @@ tx_process1(struct cmsg *msg);
 static void
 tx_process_select(struct cmsg *msg);
 
+static void
+tx_process_batch(struct cmsg *msg);
+
 static void
 tx_process_sql(struct cmsg *msg);
 
@@ -1185,70 +2124,17 @@ static void
 net_end_join(struct cmsg *msg);
 
 static void
-net_end_subscribe(struct cmsg *msg);
-
-static const struct cmsg_hop misc_route[] = {
-	{ tx_process_misc, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop call_route[] = {
-	{ tx_process_call, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop select_route[] = {
-	{ tx_process_select, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop process1_route[] = {
-	{ tx_process1, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop sql_route[] = {
-	{ tx_process_sql, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
-	NULL,                                   /* IPROTO_OK */
-	select_route,                           /* IPROTO_SELECT */
-	process1_route,                         /* IPROTO_INSERT */
-	process1_route,                         /* IPROTO_REPLACE */
-	process1_route,                         /* IPROTO_UPDATE */
-	process1_route,                         /* IPROTO_DELETE */
-	call_route,                             /* IPROTO_CALL_16 */
-	misc_route,                             /* IPROTO_AUTH */
-	call_route,                             /* IPROTO_EVAL */
-	process1_route,                         /* IPROTO_UPSERT */
-	call_route,                             /* IPROTO_CALL */
-	sql_route,                              /* IPROTO_EXECUTE */
-	NULL,                                   /* IPROTO_NOP */
-	sql_route,                              /* IPROTO_PREPARE */
-};
-
-static const struct cmsg_hop join_route[] = {
-	{ tx_process_replication, &net_pipe },
-	{ net_end_join, NULL },
-};
-
-static const struct cmsg_hop subscribe_route[] = {
-	{ tx_process_replication, &net_pipe },
-	{ net_end_subscribe, NULL },
-};
+net_end_compress(struct cmsg *msg);
 
-static const struct cmsg_hop error_route[] = {
-	{ tx_reply_iproto_error, &net_pipe },
-	{ net_send_error, NULL },
-};
+static void
+net_end_subscribe(struct cmsg *msg);
 
 static void
 iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input)
 {
 	uint8_t type;
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
 
 	if (xrow_header_decode(&msg->header, pos, reqend, true))
 		goto error;
@@ -1268,46 +2154,78 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 	case IPROTO_UPDATE:
 	case IPROTO_DELETE:
 	case IPROTO_UPSERT:
+	case IPROTO_GET_BATCH:
+	case IPROTO_SELECT_OPEN:
+	case IPROTO_SELECT_FETCH:
+	case IPROTO_SELECT_CLOSE:
+	case IPROTO_DELETE_RANGE:
 		if (xrow_decode_dml(&msg->header, &msg->dml,
 				    dml_request_key_map(type)))
 			goto error;
-		assert(type < sizeof(dml_route)/sizeof(*dml_route));
-		cmsg_init(&msg->base, dml_route[type]);
+		assert(type < sizeof(iproto_thread->dml_route) /
+			      sizeof(*iproto_thread->dml_route));
+		cmsg_init(&msg->base, iproto_thread->dml_route[type]);
 		break;
 	case IPROTO_CALL_16:
 	case IPROTO_CALL:
 	case IPROTO_EVAL:
 		if (xrow_decode_call(&msg->header, &msg->call))
 			goto error;
-		cmsg_init(&msg->base, call_route);
+		cmsg_init(&msg->base, iproto_thread->call_route);
+		break;
+	case IPROTO_BATCH:
+		if (xrow_decode_batch(&msg->header, &msg->batch) != 0)
+			goto error;
+		cmsg_init(&msg->base, iproto_thread->batch_route);
 		break;
 	case IPROTO_EXECUTE:
 	case IPROTO_PREPARE:
+	case IPROTO_FETCH:
 		if (xrow_decode_sql(&msg->header, &msg->sql) != 0)
 			goto error;
-		cmsg_init(&msg->base, sql_route);
+		cmsg_init(&msg->base, iproto_thread->sql_route);
 		break;
 	case IPROTO_PING:
-		cmsg_init(&msg->base, misc_route);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	case IPROTO_JOIN:
 	case IPROTO_FETCH_SNAPSHOT:
 	case IPROTO_REGISTER:
-		cmsg_init(&msg->base, join_route);
+		cmsg_init(&msg->base, iproto_thread->join_route);
 		*stop_input = true;
 		break;
 	case IPROTO_SUBSCRIBE:
-		cmsg_init(&msg->base, subscribe_route);
+		cmsg_init(&msg->base, iproto_thread->subscribe_route);
 		*stop_input = true;
 		break;
 	case IPROTO_VOTE_DEPRECATED:
 	case IPROTO_VOTE:
-		cmsg_init(&msg->base, misc_route);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	case IPROTO_AUTH:
 		if (xrow_decode_auth(&msg->header, &msg->auth))
 			goto error;
-		cmsg_init(&msg->base, misc_route);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
+		break;
+	case IPROTO_COMPRESS: {
+		/*
+		 * The input is switched right away, since the
+		 * rest of it may be compressed already.
+		 */
+		enum compression_type compression;
+		if (xrow_decode_compress(&msg->header, &compression) != 0 ||
+		    iproto_connection_compress(msg->connection, msg->p_ibuf,
+					       reqend, compression) != 0)
+			goto error;
+		cmsg_init(&msg->base, iproto_thread->compress_route);
+		break;
+	}
+	case IPROTO_SHM:
+		/* The rest of the input goes through the rings. */
+		if (iproto_connection_attach_shm(msg->connection,
+						 msg->p_ibuf, reqend) != 0)
+			goto error;
+		cmsg_init(&msg->base, iproto_thread->shm_route);
 		break;
 	default:
 		diag_set(ClientError, ER_UNKNOWN_REQUEST_TYPE,
@@ -1320,7 +2238,7 @@ error:
 	diag_log();
 	diag_create(&msg->diag);
 	diag_move(&fiber()->diag, &msg->diag);
-	cmsg_init(&msg->base, error_route);
+	cmsg_init(&msg->base, iproto_thread->error_route);
 }
 
 static void
@@ -1388,6 +2306,8 @@ tx_process_destroy(struct cmsg *m)
 	 */
 	obuf_destroy(&con->obuf[0]);
 	obuf_destroy(&con->obuf[1]);
+	iproto_zc_reset(&con->zc[0]);
+	iproto_zc_reset(&con->zc[1]);
 }
 
 /**
@@ -1415,6 +2335,22 @@ tx_check_schema(uint32_t new_schema_version)
 	return 0;
 }
 
+/**
+ * Wait until the replica set vclock reaches the vclock passed
+ * in IPROTO_WAIT_VCLOCK, if any, so that a request sent to a
+ * replica sees the writes the client has made on the master.
+ */
+static int
+tx_wait_vclock(const struct xrow_header *header)
+{
+	if (header->wait_vclock == NULL)
+		return 0;
+	struct vclock vclock;
+	if (xrow_decode_wait_vclock(header, &vclock) != 0)
+		return -1;
+	return wal_wait_vclock(&vclock, header->wait_vclock_timeout);
+}
+
 static void
 net_discard_input(struct cmsg *m)
 {
@@ -1436,7 +2372,8 @@ tx_discard_input(struct iproto_msg *msg)
 		{ net_discard_input, NULL },
 	};
 	cmsg_init(&msg->discard_input, discard_input_route);
-	cpipe_push(&net_pipe, &msg->discard_input);
+	cpipe_push(&msg->connection->iproto_thread->net_pipe,
+		   &msg->discard_input);
 }
 
 /**
@@ -1465,8 +2402,11 @@ tx_accept_wpos(struct iproto_connection *con, const struct iproto_wpos *wpos)
 		 * guaranteed to have been flushed first, since
 		 * buffers are never flushed out of order.
 		 */
-		if (obuf_size(prev) != 0)
+		if (obuf_size(prev) != 0) {
 			obuf_reset(prev);
+			/* The tuples sent from the buffer are free. */
+			iproto_zc_reset(iproto_obuf_zc(con, prev));
+		}
 	}
 	if (obuf_size(con->tx.p_obuf) != 0 && obuf_size(prev) == 0) {
 		/*
@@ -1482,11 +2422,64 @@ static inline struct iproto_msg *
 tx_accept_msg(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
+	msg->tx_start = ev_monotonic_time();
 	tx_accept_wpos(msg->connection, &msg->wpos);
 	tx_fiber_init(msg->connection->session, msg->header.sync);
+	fiber()->storage.net.wal_wait = 0;
+	fiber()->storage.net.limbo_wait = 0;
+	fiber()->gc_peak = 0;
 	return msg;
 }
 
+/**
+ * Add a trace of the request to the trace buffer if it carries
+ * a trace id or is chosen by sampling.
+ */
+static void
+tx_trace_msg(struct iproto_msg *msg, double tx_end)
+{
+	if (msg->header.trace_id == 0 && (iproto_trace_sample_rate == 0 ||
+	    rand() >= iproto_trace_sample_rate * RAND_MAX))
+		return;
+	struct iproto_trace *trace =
+		&iproto_traces[iproto_trace_count++ & (IPROTO_TRACE_MAX - 1)];
+	trace->id = msg->header.trace_id;
+	trace->type = msg->header.type;
+	trace->sync = msg->header.sync;
+	trace->start = ev_time() - (tx_end - msg->recv_time);
+	trace->net = msg->tx_start - msg->recv_time;
+	trace->tx = tx_end - msg->tx_start;
+	trace->wal = fiber()->storage.net.wal_wait;
+	trace->limbo = fiber()->storage.net.limbo_wait;
+}
+
+/**
+ * Set the write position after the reply to a request and
+ * account the request latency.
+ */
+static void
+tx_end_msg(struct iproto_msg *msg, struct obuf *out)
+{
+	iproto_wpos_create(&msg->wpos, out);
+	uint32_t type = msg->header.type;
+	if (msg->tx_start == 0 || type >= IPROTO_TYPE_STAT_MAX)
+		return;
+	double tx_end = ev_monotonic_time();
+	struct latency *latency = iproto_latency[type];
+	latency_collect(&latency[IPROTO_LATENCY_NET],
+			msg->tx_start - msg->recv_time);
+	latency_collect(&latency[IPROTO_LATENCY_TX],
+			tx_end - msg->tx_start);
+	latency_collect(&latency[IPROTO_LATENCY_WAL],
+			fiber()->storage.net.wal_wait);
+	iproto_latency_count[type]++;
+	size_t region_peak = MAX(fiber()->gc_peak,
+				 region_used(&fiber()->gc));
+	iproto_region_max[type] = MAX(iproto_region_max[type], region_peak);
+	iproto_region_total[type] += region_peak;
+	tx_trace_msg(msg, tx_end);
+}
+
 /**
  * Write error message to the output buffer and advance
  * write position. Doesn't throw.
@@ -1497,7 +2490,7 @@ tx_reply_error(struct iproto_msg *msg)
 	struct obuf *out = msg->connection->tx.p_obuf;
 	iproto_reply_error(out, diag_last_error(&fiber()->diag),
 			   msg->header.sync, ::schema_version);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 }
 
 /**
@@ -1528,7 +2521,8 @@ static void
 tx_process1(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_wait_vclock(&msg->header) != 0 ||
+	    tx_check_schema(msg->header.schema_version))
 		goto error;
 
 	struct tuple *tuple;
@@ -1544,12 +2538,65 @@ tx_process1(struct cmsg *m)
 		goto error;
 	iproto_reply_select(out, &svp, msg->header.sync, ::schema_version,
 			    tuple != 0);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
 }
 
+/**
+ * Dump a SELECT result to the output buffer. Tuples of at least
+ * IPROTO_ZC_TUPLE_SIZE_MIN bytes aren't copied, zero-copy segments
+ * referencing them are appended to @a zc instead, and their size
+ * is added to @a zc_size.
+ *
+ * @retval -1 error
+ * @retval >=0 the number of tuples
+ */
+static int
+tx_dump_select(struct port *base, struct obuf *out, struct iproto_zc *zc,
+	       uint32_t *zc_size)
+{
+	if (base->vtab != &port_c_vtab)
+		return port_dump_msgpack_16(base, out);
+	struct port_c *port = (struct port_c *) base;
+	for (struct port_c_entry *pe = port->first; pe != NULL;
+	     pe = pe->next) {
+		uint32_t size = pe->mp_size;
+		if (size == 0 &&
+		    tuple_bsize(pe->tuple) >= IPROTO_ZC_TUPLE_SIZE_MIN) {
+			struct iproto_zc_seg *seg = (struct iproto_zc_seg *)
+				mempool_alloc(&iproto_zc_seg_pool);
+			if (seg == NULL) {
+				diag_set(OutOfMemory, sizeof(*seg),
+					 "mempool_alloc", "seg");
+				return -1;
+			}
+			seg->next = NULL;
+			seg->pos = obuf_size(out);
+			seg->tuple = pe->tuple;
+			tuple_ref(seg->tuple);
+			seg->data = tuple_data_range(seg->tuple, &seg->size);
+			*zc->last = seg;
+			zc->last = &seg->next;
+			*zc_size += seg->size;
+		} else if (size == 0) {
+			if (tuple_to_obuf(pe->tuple, out) != 0)
+				return -1;
+		} else if (obuf_dup(out, pe->mp, size) != size) {
+			diag_set(OutOfMemory, size, "obuf_dup", "data");
+			return -1;
+		}
+		ERROR_INJECT(ERRINJ_PORT_DUMP, {
+			diag_set(OutOfMemory,
+				 size == 0 ? tuple_size(pe->tuple) : size,
+				 "obuf_dup", "data");
+			return -1;
+		});
+	}
+	return port->size;
+}
+
 static void
 tx_process_select(struct cmsg *m)
 {
@@ -1557,16 +2604,46 @@ tx_process_select(struct cmsg *m)
 	struct obuf *out;
 	struct obuf_svp svp;
 	struct port port;
+	struct iproto_zc zc;
+	uint32_t zc_size = 0;
 	int count;
 	int rc;
+	uint32_t iterator_id = 0;
+	bool is_eof;
 	struct request *req = &msg->dml;
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_wait_vclock(&msg->header) != 0 ||
+	    tx_check_schema(msg->header.schema_version))
 		goto error;
 
 	tx_inject_delay();
-	rc = box_select(req->space_id, req->index_id,
-			req->iterator, req->offset, req->limit,
-			req->key, req->key_end, &port);
+	switch (msg->header.type) {
+	case IPROTO_GET_BATCH:
+		rc = box_get_batch(req->space_id, req->index_id,
+				   req->key, req->key_end, &port);
+		break;
+	case IPROTO_SELECT_OPEN:
+		rc = box_select_open(req->space_id, req->index_id,
+				     req->iterator, req->offset, req->limit,
+				     req->key, req->key_end, &port,
+				     &iterator_id);
+		break;
+	case IPROTO_SELECT_FETCH:
+		rc = box_select_fetch(req->iterator_id, req->limit, &port,
+				      &is_eof);
+		if (rc == 0 && !is_eof)
+			iterator_id = req->iterator_id;
+		break;
+	case IPROTO_SELECT_CLOSE:
+		rc = box_select_close(req->iterator_id);
+		if (rc == 0)
+			port_c_create(&port);
+		break;
+	default:
+		rc = box_select(req->space_id, req->index_id,
+				req->iterator, req->offset, req->limit,
+				req->key, req->key_end, &port);
+		break;
+	}
 	if (rc < 0)
 		goto error;
 
@@ -1578,16 +2655,66 @@ tx_process_select(struct cmsg *m)
 	/*
 	 * SELECT output format has not changed since Tarantool 1.6
 	 */
-	count = port_dump_msgpack_16(&port, out);
+	iproto_zc_create(&zc);
+	count = tx_dump_select(&port, out, &zc, &zc_size);
 	port_destroy(&port);
 	if (count < 0) {
 		/* Discard the prepared select. */
+		iproto_zc_reset(&zc);
 		obuf_rollback_to_svp(out, &svp);
 		goto error;
 	}
-	iproto_reply_select(out, &svp, msg->header.sync,
-			    ::schema_version, count);
-	iproto_wpos_create(&msg->wpos, out);
+	if (iproto_reply_select_iterator(out, &svp, msg->header.sync,
+					 ::schema_version, count, zc_size,
+					 iterator_id) != 0) {
+		iproto_zc_reset(&zc);
+		obuf_rollback_to_svp(out, &svp);
+		if (iterator_id != 0)
+			box_select_close(iterator_id);
+		goto error;
+	}
+	/* Let the iproto thread see the segments. */
+	iproto_zc_splice(iproto_obuf_zc(msg->connection, out), &zc);
+	tx_end_msg(msg, out);
+	return;
+error:
+	tx_reply_error(msg);
+}
+
+/**
+ * Execute the DML requests of a BATCH request in one transaction
+ * and reply with an array of their results.
+ */
+static void
+tx_process_batch(struct cmsg *m)
+{
+	struct iproto_msg *msg = tx_accept_msg(m);
+	struct obuf *out;
+	struct obuf_svp svp;
+	struct port port;
+	int count;
+	if (tx_wait_vclock(&msg->header) != 0 ||
+	    tx_check_schema(msg->header.schema_version))
+		goto error;
+
+	tx_inject_delay();
+	if (box_process_batch(msg->batch.requests, msg->batch.requests_end,
+			      &port) != 0)
+		goto error;
+	out = msg->connection->tx.p_obuf;
+	if (iproto_prepare_select(out, &svp) != 0) {
+		port_destroy(&port);
+		goto error;
+	}
+	count = port_dump_msgpack_16(&port, out);
+	port_destroy(&port);
+	if (count < 0) {
+		obuf_rollback_to_svp(out, &svp);
+		goto error;
+	}
+	iproto_reply_select(out, &svp, msg->header.sync, ::schema_version,
+			    count);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1608,7 +2735,8 @@ static void
 tx_process_call(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_wait_vclock(&msg->header) != 0 ||
+	    tx_check_schema(msg->header.schema_version))
 		goto error;
 
 	/*
@@ -1677,7 +2805,7 @@ tx_process_call(struct cmsg *m)
 
 	iproto_reply_select(out, &svp, msg->header.sync,
 			    ::schema_version, count);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1717,7 +2845,7 @@ tx_process_misc(struct cmsg *m)
 		default:
 			unreachable();
 		}
-		iproto_wpos_create(&msg->wpos, out);
+		tx_end_msg(msg, out);
 	} catch (Exception *e) {
 		tx_reply_error(msg);
 	}
@@ -1726,6 +2854,24 @@ error:
 	tx_reply_error(msg);
 }
 
+/** Reply to a request switching the transport: COMPRESS, SHM. */
+static void
+tx_process_switch(struct cmsg *m)
+{
+	struct iproto_msg *msg = tx_accept_msg(m);
+	struct obuf *out = msg->connection->tx.p_obuf;
+	/*
+	 * No schema version check: the request doesn't depend
+	 * on the schema, and the response must be plain OK for
+	 * the transport to be switched right after it.
+	 */
+	if (iproto_reply_ok(out, msg->header.sync, ::schema_version) != 0) {
+		tx_reply_error(msg);
+		return;
+	}
+	tx_end_msg(msg, out);
+}
+
 static void
 tx_process_sql(struct cmsg *m)
 {
@@ -1738,10 +2884,12 @@ tx_process_sql(struct cmsg *m)
 	uint32_t len;
 	bool is_unprepare = false;
 
-	if (tx_check_schema(msg->header.schema_version))
+	if (tx_wait_vclock(&msg->header) != 0 ||
+	    tx_check_schema(msg->header.schema_version))
 		goto error;
 	assert(msg->header.type == IPROTO_EXECUTE ||
-	       msg->header.type == IPROTO_PREPARE);
+	       msg->header.type == IPROTO_PREPARE ||
+	       msg->header.type == IPROTO_FETCH);
 	tx_inject_delay();
 	if (msg->sql.bind != NULL) {
 		bind_count = sql_bind_list_decode(msg->sql.bind, &bind);
@@ -1749,28 +2897,52 @@ tx_process_sql(struct cmsg *m)
 			goto error;
 	}
 	/*
-	 * There are four options:
+	 * There are five options:
 	 * 1. Prepare SQL query (IPROTO_PREPARE + SQL string);
 	 * 2. Unprepare SQL query (IPROTO_PREPARE + stmt id);
 	 * 3. Execute SQL query (IPROTO_EXECUTE + SQL string);
-	 * 4. Execute prepared query (IPROTO_EXECUTE + stmt id).
+	 * 4. Execute prepared query (IPROTO_EXECUTE + stmt id);
+	 * 5. Fetch rows of a cursor (IPROTO_FETCH + cursor id).
+	 * A fetch size in EXECUTE opens a cursor, if the result
+	 * set has more rows than that.
 	 */
-	if (msg->header.type == IPROTO_EXECUTE) {
+	if (msg->header.type == IPROTO_FETCH) {
+		if (sql_cursor_fetch(msg->sql.cursor_id, msg->sql.fetch_size,
+				     &port, &fiber()->gc) != 0)
+			goto error;
+	} else if (msg->header.type == IPROTO_EXECUTE) {
+		uint32_t fetch_size = msg->sql.fetch_size;
 		if (msg->sql.sql_text != NULL) {
 			assert(msg->sql.stmt_id == NULL);
 			sql = msg->sql.sql_text;
 			sql = mp_decode_str(&sql, &len);
-			if (sql_prepare_and_execute(sql, len, bind, bind_count,
-						    &port, &fiber()->gc) != 0)
+			if (fetch_size > 0) {
+				if (sql_prepare_and_open_cursor(sql, len, bind,
+								bind_count,
+								fetch_size,
+								&port,
+								&fiber()->gc) != 0)
+					goto error;
+			} else if (sql_prepare_and_execute(sql, len, bind,
+							   bind_count, &port,
+							   &fiber()->gc) != 0) {
 				goto error;
+			}
 		} else {
 			assert(msg->sql.sql_text == NULL);
 			assert(msg->sql.stmt_id != NULL);
 			sql = msg->sql.stmt_id;
 			uint32_t stmt_id = mp_decode_uint(&sql);
-			if (sql_execute_prepared(stmt_id, bind, bind_count,
-						 &port, &fiber()->gc) != 0)
+			if (fetch_size > 0) {
+				if (sql_execute_prepared_and_open_cursor(
+					stmt_id, bind, bind_count, fetch_size,
+					&port, &fiber()->gc) != 0)
+					goto error;
+			} else if (sql_execute_prepared(stmt_id, bind,
+							bind_count, &port,
+							&fiber()->gc) != 0) {
 				goto error;
+			}
 		}
 	} else {
 		/* IPROTO_PREPARE */
@@ -1800,7 +2972,7 @@ tx_process_sql(struct cmsg *m)
 	if (is_unprepare) {
 		if (iproto_reply_ok(out, msg->header.sync, schema_version) != 0)
 			goto error;
-		iproto_wpos_create(&msg->wpos, out);
+		tx_end_msg(msg, out);
 		return;
 	}
 	struct obuf_svp header_svp;
@@ -1816,7 +2988,7 @@ tx_process_sql(struct cmsg *m)
 	}
 	port_destroy(&port);
 	iproto_reply_sql(out, &header_svp, msg->header.sync, schema_version);
-	iproto_wpos_create(&msg->wpos, out);
+	tx_end_msg(msg, out);
 	return;
 error:
 	tx_reply_error(msg);
@@ -1903,6 +3075,38 @@ net_send_error(struct cmsg *m)
 	net_send_msg(m);
 }
 
+/**
+ * Complete a COMPRESS request: the output following the response
+ * is compressed.
+ */
+static void
+net_end_compress(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	struct iproto_zstd *z = msg->connection->zstd;
+	if (z != NULL && !z->is_output && !z->is_output_pending) {
+		z->out_wpos = msg->wpos;
+		z->is_output_pending = true;
+	}
+	net_send_msg(m);
+}
+
+/**
+ * Complete a SHM request: the output following the response
+ * goes through the shared memory ring.
+ */
+static void
+net_end_shm(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	struct iproto_conn_shm *s = msg->connection->shm;
+	if (s != NULL && !s->is_output && !s->is_output_pending) {
+		s->out_wpos = msg->wpos;
+		s->is_output_pending = true;
+	}
+	net_send_msg(m);
+}
+
 static void
 net_end_join(struct cmsg *m)
 {
@@ -1986,7 +3190,8 @@ net_send_greeting(struct cmsg *m)
 
 		if (nwr > 0) {
 			/* Count statistics. */
-			rmean_collect(rmean_net, IPROTO_SENT, nwr);
+			rmean_collect(con->iproto_thread->rmean, IPROTO_SENT,
+				      nwr);
 		} else if (nwr < 0 && ! sio_wouldblock(errno)) {
 			diag_log();
 		}
@@ -2007,26 +3212,25 @@ net_send_greeting(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
-static const struct cmsg_hop connect_route[] = {
-	{ tx_process_connect, &net_pipe },
-	{ net_send_greeting, NULL },
-};
-
 /** }}} */
 
 /**
  * Create a connection and start input.
  */
 static int
-iproto_on_accept(struct evio_service * /* service */, int fd,
+iproto_on_accept(struct evio_service *service, int fd,
 		 struct sockaddr *addr, socklen_t addrlen)
 {
-	(void) addr;
 	(void) addrlen;
 	struct iproto_msg *msg;
-	struct iproto_connection *con = iproto_connection_new(fd);
+	struct iproto_thread *iproto_thread =
+		(struct iproto_thread *) service->on_accept_param;
+	struct iproto_connection *con =
+		iproto_connection_new(iproto_thread, fd);
 	if (con == NULL)
 		return -1;
+	/* Only a local client can pass the shared memory rings. */
+	con->is_unix = addr->sa_family == AF_UNIX;
 	/*
 	 * Ignore msg allocation failure - the queue size is
 	 * fixed so there is a limited number of msgs in
@@ -2034,62 +3238,138 @@ iproto_on_accept(struct evio_service * /* service */, int fd,
 	 */
 	msg = iproto_msg_new(con);
 	if (msg == NULL) {
-		mempool_free(&iproto_connection_pool, con);
+		mempool_free(&iproto_thread->iproto_connection_pool, con);
 		return -1;
 	}
-	cmsg_init(&msg->base, connect_route);
+	cmsg_init(&msg->base, iproto_thread->connect_route);
 	msg->p_ibuf = con->p_ibuf;
 	msg->wpos = con->wpos;
 	msg->close_connection = false;
-	cpipe_push(&tx_pipe, &msg->base);
+	cpipe_push(&iproto_thread->tx_pipe, &msg->base);
 	return 0;
 }
 
-static struct evio_service binary; /* iproto binary listener */
+/**
+ * Fill in message routes of a network thread. Every route
+ * returns to the network thread it has been sent from.
+ */
+static void
+iproto_thread_init_routes(struct iproto_thread *iproto_thread)
+{
+	struct cpipe *net_pipe = &iproto_thread->net_pipe;
+	struct cpipe *tx_pipe = &iproto_thread->tx_pipe;
+
+	iproto_thread->destroy_route[0] = { tx_process_destroy, net_pipe };
+	iproto_thread->destroy_route[1] = { net_finish_destroy, NULL };
+	iproto_thread->disconnect_route[0] =
+		{ tx_process_disconnect, net_pipe };
+	iproto_thread->disconnect_route[1] = { net_finish_disconnect, NULL };
+	iproto_thread->push_route[0] = { iproto_process_push, tx_pipe };
+	iproto_thread->push_route[1] = { tx_end_push, NULL };
+	iproto_thread->misc_route[0] = { tx_process_misc, net_pipe };
+	iproto_thread->misc_route[1] = { net_send_msg, NULL };
+	iproto_thread->compress_route[0] = { tx_process_switch, net_pipe };
+	iproto_thread->compress_route[1] = { net_end_compress, NULL };
+	iproto_thread->shm_route[0] = { tx_process_switch, net_pipe };
+	iproto_thread->shm_route[1] = { net_end_shm, NULL };
+	iproto_thread->call_route[0] = { tx_process_call, net_pipe };
+	iproto_thread->call_route[1] = { net_send_msg, NULL };
+	iproto_thread->select_route[0] = { tx_process_select, net_pipe };
+	iproto_thread->select_route[1] = { net_send_msg, NULL };
+	iproto_thread->process1_route[0] = { tx_process1, net_pipe };
+	iproto_thread->process1_route[1] = { net_send_msg, NULL };
+	iproto_thread->batch_route[0] = { tx_process_batch, net_pipe };
+	iproto_thread->batch_route[1] = { net_send_msg, NULL };
+	iproto_thread->sql_route[0] = { tx_process_sql, net_pipe };
+	iproto_thread->sql_route[1] = { net_send_msg, NULL };
+	iproto_thread->join_route[0] = { tx_process_replication, net_pipe };
+	iproto_thread->join_route[1] = { net_end_join, NULL };
+	iproto_thread->subscribe_route[0] =
+		{ tx_process_replication, net_pipe };
+	iproto_thread->subscribe_route[1] = { net_end_subscribe, NULL };
+	iproto_thread->error_route[0] = { tx_reply_iproto_error, net_pipe };
+	iproto_thread->error_route[1] = { net_send_error, NULL };
+	iproto_thread->connect_route[0] = { tx_process_connect, net_pipe };
+	iproto_thread->connect_route[1] = { net_send_greeting, NULL };
+
+	struct cmsg_hop **dml_route = iproto_thread->dml_route;
+	dml_route[IPROTO_OK] = NULL;
+	dml_route[IPROTO_SELECT] = iproto_thread->select_route;
+	dml_route[IPROTO_INSERT] = iproto_thread->process1_route;
+	dml_route[IPROTO_REPLACE] = iproto_thread->process1_route;
+	dml_route[IPROTO_UPDATE] = iproto_thread->process1_route;
+	dml_route[IPROTO_DELETE] = iproto_thread->process1_route;
+	dml_route[IPROTO_CALL_16] = iproto_thread->call_route;
+	dml_route[IPROTO_AUTH] = iproto_thread->misc_route;
+	dml_route[IPROTO_EVAL] = iproto_thread->call_route;
+	dml_route[IPROTO_UPSERT] = iproto_thread->process1_route;
+	dml_route[IPROTO_CALL] = iproto_thread->call_route;
+	dml_route[IPROTO_EXECUTE] = iproto_thread->sql_route;
+	dml_route[IPROTO_NOP] = NULL;
+	dml_route[IPROTO_PREPARE] = iproto_thread->sql_route;
+	dml_route[IPROTO_GET_BATCH] = iproto_thread->select_route;
+	dml_route[IPROTO_SELECT_OPEN] = iproto_thread->select_route;
+	dml_route[IPROTO_SELECT_FETCH] = iproto_thread->select_route;
+	dml_route[IPROTO_SELECT_CLOSE] = iproto_thread->select_route;
+	dml_route[IPROTO_DELETE_RANGE] = iproto_thread->process1_route;
+	dml_route[IPROTO_BATCH] = iproto_thread->batch_route;
+	dml_route[IPROTO_FETCH] = iproto_thread->sql_route;
+}
 
 /**
  * The network io thread main function:
  * begin serving the message bus.
  */
 static int
-net_cord_f(va_list /* ap */)
+net_cord_f(va_list ap)
 {
-	mempool_create(&iproto_msg_pool, &cord()->slabc,
+	struct iproto_thread *iproto_thread =
+		va_arg(ap, struct iproto_thread *);
+
+	mempool_create(&iproto_thread->iproto_msg_pool, &cord()->slabc,
 		       sizeof(struct iproto_msg));
-	mempool_create(&iproto_connection_pool, &cord()->slabc,
+	mempool_create(&iproto_thread->iproto_connection_pool, &cord()->slabc,
 		       sizeof(struct iproto_connection));
 
-	evio_service_init(loop(), &binary, "binary",
-			  iproto_on_accept, NULL);
-
+	evio_service_init(loop(), &iproto_thread->binary, "binary",
+			  iproto_on_accept, iproto_thread);
 
 	/* Init statistics counter */
-	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
+	iproto_thread->rmean = rmean_new(rmean_net_strings, IPROTO_LAST);
 
-	if (rmean_net == NULL) {
+	if (iproto_thread->rmean == NULL) {
 		tnt_raise(OutOfMemory, sizeof(struct rmean),
 			  "rmean", "struct rmean");
 	}
 
+	char endpoint_name[FIBER_NAME_MAX];
+	snprintf(endpoint_name, sizeof(endpoint_name), "net%u",
+		 iproto_thread->id);
+
 	struct cbus_endpoint endpoint;
 	/* Create "net" endpoint. */
-	cbus_endpoint_create(&endpoint, "net", fiber_schedule_cb, fiber());
+	cbus_endpoint_create(&endpoint, endpoint_name,
+			     fiber_schedule_cb, fiber());
 	/* Create a pipe to "tx" thread. */
-	cpipe_create(&tx_pipe, "tx");
-	cpipe_set_max_input(&tx_pipe, iproto_msg_max / 2);
+	cpipe_create(&iproto_thread->tx_pipe, "tx");
+	cpipe_set_max_input(&iproto_thread->tx_pipe, iproto_msg_max / 2);
 	/* Process incomming messages. */
 	cbus_loop(&endpoint);
 
-	cpipe_destroy(&tx_pipe);
+	cpipe_destroy(&iproto_thread->tx_pipe);
 	/*
 	 * Nothing to do in the fiber so far, the service
 	 * will take care of creating events for incoming
 	 * connections.
 	 */
-	if (evio_service_is_active(&binary))
-		evio_service_stop(&binary);
+	if (evio_service_is_active(&iproto_thread->binary)) {
+		if (iproto_thread->id == 0)
+			evio_service_stop(&iproto_thread->binary);
+		else
+			evio_service_detach(&iproto_thread->binary);
+	}
 
-	rmean_delete(rmean_net);
+	rmean_delete(iproto_thread->rmean);
 	return 0;
 }
 
@@ -2109,6 +3389,62 @@ iproto_session_sync(struct session *session)
 	return fiber()->storage.net.sync;
 }
 
+/** A message changing the priority class of a connection. */
+struct iproto_priority_msg {
+	struct cmsg base;
+	struct iproto_connection *connection;
+	enum session_priority priority;
+};
+
+/**
+ * Move the connection to the stopped list of the new class if it
+ * is waiting for the message limit, and retry resuming, since the
+ * connection may be allowed to go on in the new class.
+ */
+static void
+net_set_priority(struct cmsg *m)
+{
+	struct iproto_priority_msg *msg = (struct iproto_priority_msg *) m;
+	struct iproto_connection *con = msg->connection;
+	struct iproto_thread *iproto_thread = con->iproto_thread;
+	con->priority = msg->priority;
+	free(msg);
+	if (!rlist_empty(&con->in_stop_list)) {
+		rlist_del(&con->in_stop_list);
+		rlist_add_tail(&iproto_thread->stopped_connections[con->priority],
+			       &con->in_stop_list);
+		iproto_resume(iproto_thread);
+	}
+}
+
+/**
+ * The connection is owned by the network thread, so the new
+ * class is sent there. The message is delivered before the
+ * connection can be destroyed, since destruction is initiated
+ * from tx after the session is closed.
+ */
+static int
+iproto_session_set_priority(struct session *session,
+			    enum session_priority priority)
+{
+	static const struct cmsg_hop route[] = {
+		{ net_set_priority, NULL },
+	};
+	struct iproto_connection *con =
+		(struct iproto_connection *) session->meta.connection;
+	struct iproto_priority_msg *msg =
+		(struct iproto_priority_msg *) malloc(sizeof(*msg));
+	if (msg == NULL) {
+		diag_set(OutOfMemory, sizeof(*msg), "malloc", "msg");
+		return -1;
+	}
+	cmsg_init(&msg->base, route);
+	msg->connection = con;
+	msg->priority = priority;
+	cpipe_push(&con->iproto_thread->net_pipe, &msg->base);
+	return 0;
+}
+
 /** {{{ IPROTO_PUSH implementation. */
 
 static void
@@ -2131,11 +3467,12 @@ static void
 tx_begin_push(struct iproto_connection *con)
 {
 	assert(! con->tx.is_push_sent);
-	cmsg_init(&con->kharon.base, push_route);
+	cmsg_init(&con->kharon.base, con->iproto_thread->push_route);
 	iproto_wpos_create(&con->kharon.wpos, con->tx.p_obuf);
 	con->tx.is_push_pending = false;
 	con->tx.is_push_sent = true;
-	cpipe_push(&net_pipe, (struct cmsg *) &con->kharon);
+	cpipe_push(&con->iproto_thread->net_pipe,
+		   (struct cmsg *) &con->kharon);
 }
 
 static void
@@ -2183,29 +3520,75 @@ iproto_session_push(struct session *session, struct port *port)
 
 /** }}} */
 
-/** Initialize the iproto subsystem and start network io thread */
-void
-iproto_init(void)
+/**
+ * Initialize a network thread context and start the
+ * network cord.
+ */
+static void
+iproto_thread_init(struct iproto_thread *iproto_thread, uint32_t id)
 {
-	slab_cache_create(&net_slabc, &runtime);
+	iproto_thread->id = id;
+	for (int i = 0; i < session_priority_MAX; i++) {
+		rlist_create(&iproto_thread->stopped_connections[i]);
+		iproto_thread->msg_count[i] = 0;
+		iproto_thread->resume_credit[i] = 0;
+	}
+	iproto_thread_init_routes(iproto_thread);
+	slab_cache_create(&iproto_thread->net_slabc, &runtime);
 
-	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
+	char name[FIBER_NAME_MAX];
+	if (id == 0)
+		snprintf(name, sizeof(name), "iproto");
+	else
+		snprintf(name, sizeof(name), "iproto%u", id);
+	if (cord_costart(&iproto_thread->net_cord, name, net_cord_f,
+			 iproto_thread) != 0)
 		panic("failed to initialize iproto thread");
 
 	/* Create a pipe to "net" thread. */
-	cpipe_create(&net_pipe, "net");
-	cpipe_set_max_input(&net_pipe, iproto_msg_max / 2);
+	char endpoint_name[FIBER_NAME_MAX];
+	snprintf(endpoint_name, sizeof(endpoint_name), "net%u", id);
+	cpipe_create(&iproto_thread->net_pipe, endpoint_name);
+	cpipe_set_max_input(&iproto_thread->net_pipe, iproto_msg_max / 2);
+}
+
+/** Initialize the iproto subsystem and start network io threads */
+void
+iproto_init(int threads_count)
+{
+	assert(threads_count > 0 && threads_count <= IPROTO_THREADS_MAX);
+	iproto_threads = (struct iproto_thread *)
+		calloc(threads_count, sizeof(struct iproto_thread));
+	if (iproto_threads == NULL)
+		panic("failed to allocate iproto threads");
+	iproto_threads_count = threads_count;
+	for (int i = 0; i < threads_count; i++)
+		iproto_thread_init(&iproto_threads[i], i);
+
 	struct session_vtab iproto_session_vtab = {
 		/* .push = */ iproto_session_push,
 		/* .fd = */ iproto_session_fd,
 		/* .sync = */ iproto_session_sync,
+		/* .set_priority = */ iproto_session_set_priority,
 	};
 	session_vtab_registry[SESSION_TYPE_BINARY] = iproto_session_vtab;
+
+	mempool_create(&iproto_zc_seg_pool, &cord()->slabc,
+		       sizeof(struct iproto_zc_seg));
+
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		for (int j = 0; j < iproto_latency_stage_MAX; j++) {
+			if (latency_create(&iproto_latency[i][j]) != 0)
+				panic("failed to allocate iproto latency");
+		}
+	}
 }
 
 /** Available iproto configuration changes. */
 enum iproto_cfg_op {
 	IPROTO_CFG_MSG_MAX,
+	IPROTO_CFG_BUSY_POLL,
+	IPROTO_CFG_STOP,
 	IPROTO_CFG_LISTEN
 };
 
@@ -2219,6 +3602,8 @@ struct iproto_cfg_msg: public cbus_call_msg
 {
 	/** Operation to execute in iproto thread. */
 	enum iproto_cfg_op op;
+	/** Network thread the operation is executed in. */
+	struct iproto_thread *iproto_thread;
 	union {
 		struct {
 			/** New URI to bind to. */
@@ -2231,6 +3616,8 @@ struct iproto_cfg_msg: public cbus_call_msg
 
 		/** New iproto max message count. */
 		int iproto_msg_max;
+		/** New busy polling time, seconds. */
+		double busy_poll_timeout;
 	};
 };
 
@@ -2245,26 +3632,44 @@ static int
 iproto_do_cfg_f(struct cbus_call_msg *m)
 {
 	struct iproto_cfg_msg *cfg_msg = (struct iproto_cfg_msg *) m;
+	struct iproto_thread *iproto_thread = cfg_msg->iproto_thread;
+	struct evio_service *binary = &iproto_thread->binary;
 	int old;
 	try {
 		switch (cfg_msg->op) {
 		case IPROTO_CFG_MSG_MAX:
-			cpipe_set_max_input(&tx_pipe,
+			cpipe_set_max_input(&iproto_thread->tx_pipe,
 					    cfg_msg->iproto_msg_max / 2);
 			old = iproto_msg_max;
 			iproto_msg_max = cfg_msg->iproto_msg_max;
 			if (old < iproto_msg_max)
-				iproto_resume();
+				iproto_resume(iproto_thread);
+			break;
+		case IPROTO_CFG_BUSY_POLL:
+			cbus_set_busy_poll(cfg_msg->busy_poll_timeout);
+			break;
+		case IPROTO_CFG_STOP:
+			/*
+			 * Only the first thread owns the listening
+			 * socket, the others merely watch it.
+			 */
+			if (iproto_thread->id != 0)
+				evio_service_detach(binary);
+			else if (evio_service_is_active(binary))
+				evio_service_stop(binary);
 			break;
 		case IPROTO_CFG_LISTEN:
-			if (evio_service_is_active(&binary))
-				evio_service_stop(&binary);
-			if (cfg_msg->uri != NULL &&
-			    (evio_service_bind(&binary, cfg_msg->uri) != 0 ||
-			     evio_service_listen(&binary) != 0))
+			assert(cfg_msg->uri != NULL);
+			if (iproto_thread->id != 0) {
+				evio_service_attach(binary,
+						    &iproto_threads[0].binary);
+			} else if (evio_service_bind(binary,
+						     cfg_msg->uri) != 0 ||
+				   evio_service_listen(binary) != 0) {
 				diag_raise();
-			cfg_msg->addrlen = binary.addr_len;
-			cfg_msg->addr = binary.addrstorage;
+			}
+			cfg_msg->addrlen = binary->addr_len;
+			cfg_msg->addr = binary->addrstorage;
 			break;
 		default:
 			unreachable();
@@ -2276,10 +3681,11 @@ iproto_do_cfg_f(struct cbus_call_msg *m)
 }
 
 static inline void
-iproto_do_cfg(struct iproto_cfg_msg *msg)
+iproto_do_cfg(struct iproto_thread *iproto_thread, struct iproto_cfg_msg *msg)
 {
-	if (cbus_call(&net_pipe, &tx_pipe, msg, iproto_do_cfg_f,
-		      NULL, TIMEOUT_INFINITY) != 0)
+	msg->iproto_thread = iproto_thread;
+	if (cbus_call(&iproto_thread->net_pipe, &iproto_thread->tx_pipe, msg,
+		      iproto_do_cfg_f, NULL, TIMEOUT_INFINITY) != 0)
 		diag_raise();
 }
 
@@ -2287,9 +3693,22 @@ void
 iproto_listen(const char *uri)
 {
 	struct iproto_cfg_msg cfg_msg;
-	iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_LISTEN);
-	cfg_msg.uri = uri;
-	iproto_do_cfg(&cfg_msg);
+	/*
+	 * Detach the secondary threads before the first one
+	 * closes the socket they are watching.
+	 */
+	for (int i = iproto_threads_count - 1; i >= 0; i--) {
+		iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_STOP);
+		iproto_do_cfg(&iproto_threads[i], &cfg_msg);
+	}
+	iproto_bound_address_len = 0;
+	if (uri == NULL)
+		return;
+	for (int i = 0; i < iproto_threads_count; i++) {
+		iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_LISTEN);
+		cfg_msg.uri = uri;
+		iproto_do_cfg(&iproto_threads[i], &cfg_msg);
+	}
 	iproto_bound_address_storage = cfg_msg.addr;
 	iproto_bound_address_len = cfg_msg.addrlen;
 }
@@ -2297,25 +3716,97 @@ iproto_listen(const char *uri)
 size_t
 iproto_mem_used(void)
 {
-	return slab_cache_used(&net_cord.slabc) + slab_cache_used(&net_slabc);
+	size_t mem = 0;
+	for (int i = 0; i < iproto_threads_count; i++) {
+		mem += slab_cache_used(&iproto_threads[i].net_cord.slabc);
+		mem += slab_cache_used(&iproto_threads[i].net_slabc);
+	}
+	return mem;
 }
 
 size_t
 iproto_connection_count(void)
 {
-	return mempool_count(&iproto_connection_pool);
+	size_t count = 0;
+	for (int i = 0; i < iproto_threads_count; i++)
+		count += mempool_count(&iproto_threads[i].iproto_connection_pool);
+	return count;
 }
 
 size_t
 iproto_request_count(void)
 {
-	return mempool_count(&iproto_msg_pool);
+	size_t count = 0;
+	for (int i = 0; i < iproto_threads_count; i++)
+		count += mempool_count(&iproto_threads[i].iproto_msg_pool);
+	return count;
+}
+
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx)
+{
+	for (size_t i = 0; i < IPROTO_LAST; i++) {
+		int64_t mean = 0;
+		int64_t total = 0;
+		for (int j = 0; j < iproto_threads_count; j++) {
+			struct rmean *rmean = iproto_threads[j].rmean;
+			mean += rmean_mean(rmean, i);
+			total += rmean_total(rmean, i);
+		}
+		int rc = cb(rmean_net_strings[i], mean, total, cb_ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+int
+iproto_thread_count(void)
+{
+	return iproto_threads_count;
 }
 
 void
 iproto_reset_stat(void)
 {
-	rmean_cleanup(rmean_net);
+	for (int i = 0; i < iproto_threads_count; i++)
+		rmean_cleanup(iproto_threads[i].rmean);
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		for (int j = 0; j < iproto_latency_stage_MAX; j++)
+			latency_reset(&iproto_latency[i][j]);
+		iproto_latency_count[i] = 0;
+		iproto_region_max[i] = 0;
+		iproto_region_total[i] = 0;
+	}
+	iproto_trace_count = 0;
+}
+
+void
+iproto_latency_stat(struct info_handler *h)
+{
+	info_begin(h);
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		const char *name = iproto_type_name(i);
+		if (name == NULL || iproto_latency_count[i] == 0)
+			continue;
+		info_table_begin(h, name);
+		info_append_int(h, "count", iproto_latency_count[i]);
+		info_append_int(h, "region_max", iproto_region_max[i]);
+		info_append_int(h, "region_avg", iproto_region_total[i] /
+				iproto_latency_count[i]);
+		for (int j = 0; j < iproto_latency_stage_MAX; j++) {
+			struct latency *latency = &iproto_latency[i][j];
+			info_table_begin(h, iproto_latency_stage_strs[j]);
+			info_append_double(h, "p50", latency_get(latency, 50));
+			info_append_double(h, "p75", latency_get(latency, 75));
+			info_append_double(h, "p90", latency_get(latency, 90));
+			info_append_double(h, "p95", latency_get(latency, 95));
+			info_append_double(h, "p99", latency_get(latency, 99));
+			info_table_end(h);
+		}
+		info_table_end(h);
+	}
+	info_end(h);
 }
 
 void
@@ -2327,22 +3818,59 @@ iproto_set_msg_max(int new_iproto_msg_max)
 				     IPROTO_MSG_MAX_MIN));
 	}
 	struct iproto_cfg_msg cfg_msg;
-	iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_MSG_MAX);
-	cfg_msg.iproto_msg_max = new_iproto_msg_max;
-	iproto_do_cfg(&cfg_msg);
-	cpipe_set_max_input(&net_pipe, new_iproto_msg_max / 2);
+	for (int i = 0; i < iproto_threads_count; i++) {
+		iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_MSG_MAX);
+		cfg_msg.iproto_msg_max = new_iproto_msg_max;
+		iproto_do_cfg(&iproto_threads[i], &cfg_msg);
+		cpipe_set_max_input(&iproto_threads[i].net_pipe,
+				    new_iproto_msg_max / 2);
+	}
+}
+
+int
+iproto_trace_foreach(iproto_trace_cb cb, void *cb_ctx)
+{
+	uint64_t first = iproto_trace_count > IPROTO_TRACE_MAX ?
+			 iproto_trace_count - IPROTO_TRACE_MAX : 0;
+	for (uint64_t i = first; i < iproto_trace_count; i++) {
+		int rc = cb(&iproto_traces[i & (IPROTO_TRACE_MAX - 1)],
+			    cb_ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+void
+iproto_set_trace_sample_rate(double rate)
+{
+	iproto_trace_sample_rate = rate;
+}
+
+void
+iproto_set_busy_poll(double timeout)
+{
+	struct iproto_cfg_msg cfg_msg;
+	for (int i = 0; i < iproto_threads_count; i++) {
+		iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_BUSY_POLL);
+		cfg_msg.busy_poll_timeout = timeout;
+		iproto_do_cfg(&iproto_threads[i], &cfg_msg);
+	}
 }
 
 void
 iproto_free(void)
 {
-	tt_pthread_cancel(net_cord.id);
-	tt_pthread_join(net_cord.id, NULL);
+	for (int i = 0; i < iproto_threads_count; i++) {
+		tt_pthread_cancel(iproto_threads[i].net_cord.id);
+		tt_pthread_join(iproto_threads[i].net_cord.id, NULL);
+	}
 	/*
 	* Close socket descriptor to prevent hot standby instance
 	* failing to bind in case it tries to bind before socket
 	* is closed by OS.
 	*/
-	if (evio_service_is_active(&binary))
-		close(binary.ev.fd);
+	if (iproto_threads_count > 0 &&
+	    evio_service_is_active(&iproto_threads[0].binary))
+		close(iproto_threads[0].binary.ev.fd);
 }
@@ -32,6 +32,9 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "rmean.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -52,6 +55,8 @@ enum {
 	 * processing stops until some new fibers are freed up.
 	 */
 	IPROTO_FIBER_POOL_SIZE_FACTOR = 5,
+	/** The maximal number of network threads. */
+	IPROTO_THREADS_MAX = 1000,
 };
 
 extern unsigned iproto_readahead;
@@ -74,12 +79,79 @@ iproto_connection_count(void);
 size_t
 iproto_request_count(void);
 
+/**
+ * Return the number of network threads.
+ */
+int
+iproto_thread_count(void);
+
+/**
+ * Invoke @a cb for every network statistics counter, summed
+ * up over all network threads.
+ */
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx);
+
 /**
  * Reset network statistics.
  */
 void
 iproto_reset_stat(void);
 
+struct info_handler;
+
+/**
+ * Dump latency percentiles of iproto requests by request type,
+ * split into time spent in the queue to the tx thread, time of
+ * execution in the tx thread and time of waiting for WAL writes,
+ * and the max and average fiber region memory used by a request.
+ */
+void
+iproto_latency_stat(struct info_handler *h);
+
+/** A trace of an iproto request. */
+struct iproto_trace {
+	/** Trace id sent by the client, 0 if sampled by server. */
+	uint64_t id;
+	/** Request type and sync. */
+	uint32_t type;
+	uint64_t sync;
+	/** Wall clock time when the request was read, seconds. */
+	double start;
+	/** Time spent in the queue to the tx thread. */
+	double net;
+	/** Time of request execution in the tx thread. */
+	double tx;
+	/** Time spent waiting for WAL writes, a part of tx time. */
+	double wal;
+	/**
+	 * Time spent waiting for synchronous replication quorum,
+	 * a part of tx time.
+	 */
+	double limbo;
+};
+
+typedef int (*iproto_trace_cb)(const struct iproto_trace *trace,
+			       void *cb_ctx);
+
+/**
+ * Invoke @a cb for every trace kept in the trace buffer, the
+ * oldest first. Requests carrying IPROTO_TRACE_ID are always
+ * traced, other requests are sampled, see
+ * iproto_set_trace_sample_rate(). Only the most recent traces
+ * are kept. Stops and returns the value returned by @a cb if it
+ * isn't 0.
+ */
+int
+iproto_trace_foreach(iproto_trace_cb cb, void *cb_ctx);
+
+/**
+ * Set the share of requests traced even if they don't carry
+ * a trace id, from 0 to 1.
+ */
+void
+iproto_set_trace_sample_rate(double rate);
+
 /**
  * String representation of the address served by
  * iproto. To be shown in box.info.
@@ -90,8 +162,13 @@ iproto_bound_address(void);
 #if defined(__cplusplus)
 } /* extern "C" */
 
+/**
+ * Start @a threads_count network threads. Connections are
+ * distributed among the threads by the kernel: each thread
+ * accepts on the same listening socket.
+ */
 void
-iproto_init(void);
+iproto_init(int threads_count);
 
 void
 iproto_listen(const char *uri);
@@ -99,6 +176,13 @@ iproto_listen(const char *uri);
 void
 iproto_set_msg_max(int iproto_msg_max);
 
+/**
+ * Set the time the network threads busy poll their cbus
+ * endpoints for before going to sleep, see cbus_set_busy_poll().
+ */
+void
+iproto_set_busy_poll(double timeout);
+
 void
 iproto_free(void);
 
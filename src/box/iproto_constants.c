@@ -43,12 +43,12 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 		/* 0x07 */	MP_UINT,   /* IPROTO_GROUP_ID */
 		/* 0x08 */	MP_UINT,   /* IPROTO_TSN */
 		/* 0x09 */	MP_UINT,   /* IPROTO_FLAGS */
+		/* 0x0a */	MP_UINT,   /* IPROTO_TRACE_ID */
+		/* 0x0b */	MP_MAP,    /* IPROTO_WAIT_VCLOCK */
+		/* 0x0c */	MP_DOUBLE, /* IPROTO_WAIT_VCLOCK_TIMEOUT */
 	/* }}} */
 
 	/* {{{ unused */
-		/* 0x0a */	MP_UINT,
-		/* 0x0b */	MP_UINT,
-		/* 0x0c */	MP_UINT,
 		/* 0x0d */	MP_UINT,
 		/* 0x0e */	MP_UINT,
 		/* 0x0f */	MP_UINT,
@@ -61,10 +61,10 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 		/* 0x13 */	MP_UINT, /* IPROTO_OFFSET */
 		/* 0x14 */	MP_UINT, /* IPROTO_ITERATOR */
 		/* 0x15 */	MP_UINT, /* IPROTO_INDEX_BASE */
+		/* 0x16 */	MP_UINT, /* IPROTO_ITERATOR_ID */
 	/* }}} */
 
 	/* {{{ unused */
-		/* 0x16 */	MP_UINT,
 		/* 0x17 */	MP_UINT,
 		/* 0x18 */	MP_UINT,
 		/* 0x19 */	MP_UINT,
@@ -89,6 +89,7 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 	/* 0x29 */	MP_MAP, /* IPROTO_BALLOT */
 	/* 0x2a */	MP_MAP, /* IPROTO_TUPLE_META */
 	/* 0x2b */	MP_MAP, /* IPROTO_OPTIONS */
+	/* 0x2c */	MP_ARRAY, /* IPROTO_REQUESTS */
 	/* }}} */
 };
 
@@ -108,6 +109,13 @@ const char *iproto_type_strs[] =
 	"EXECUTE",
 	NULL, /* NOP */
 	"PREPARE",
+	NULL, /* GET_BATCH */
+	NULL, /* FETCH */
+	NULL, /* SELECT_OPEN */
+	NULL, /* SELECT_FETCH */
+	NULL, /* SELECT_CLOSE */
+	NULL, /* DELETE_RANGE */
+	NULL, /* BATCH */
 };
 
 #define bit(c) (1ULL<<IPROTO_##c)
@@ -126,6 +134,13 @@ const uint64_t iproto_body_key_map[IPROTO_TYPE_STAT_MAX] = {
 	0,                                                     /* EXECUTE */
 	0,                                                     /* NOP */
 	0,                                                     /* PREPARE */
+	bit(SPACE_ID) | bit(KEY),                              /* GET_BATCH */
+	0,                                                     /* FETCH */
+	bit(SPACE_ID) | bit(LIMIT) | bit(KEY),                 /* SELECT_OPEN */
+	bit(ITERATOR_ID) | bit(LIMIT),                         /* SELECT_FETCH */
+	bit(ITERATOR_ID),                                      /* SELECT_CLOSE */
+	bit(SPACE_ID) | bit(KEY) | bit(TUPLE),                 /* DELETE_RANGE */
+	bit(REQUESTS),                                         /* BATCH */
 };
 #undef bit
 
@@ -140,9 +155,9 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"group id",         /* 0x07 */
 	"tsn",              /* 0x08 */
 	"flags",            /* 0x09 */
-	NULL,               /* 0x0a */
-	NULL,               /* 0x0b */
-	NULL,               /* 0x0c */
+	"trace id",         /* 0x0a */
+	"wait vclock",      /* 0x0b */
+	"wait vclock timeout", /* 0x0c */
 	NULL,               /* 0x0d */
 	NULL,               /* 0x0e */
 	NULL,               /* 0x0f */
@@ -152,7 +167,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"offset",           /* 0x13 */
 	"iterator",         /* 0x14 */
 	"index base",       /* 0x15 */
-	NULL,               /* 0x16 */
+	"iterator id",      /* 0x16 */
 	NULL,               /* 0x17 */
 	NULL,               /* 0x18 */
 	NULL,               /* 0x19 */
@@ -174,7 +189,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"ballot",           /* 0x29 */
 	"tuple meta",       /* 0x2a */
 	"options",          /* 0x2b */
-	NULL,               /* 0x2c */
+	"requests",         /* 0x2c */
 	NULL,               /* 0x2d */
 	NULL,               /* 0x2e */
 	NULL,               /* 0x2f */
@@ -198,6 +213,23 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"SQL bind",         /* 0x41 */
 	"SQL info",         /* 0x42 */
 	"stmt id",          /* 0x43 */
+	"SQL fetch size",   /* 0x44 */
+	"SQL cursor id",    /* 0x45 */
+	NULL,               /* 0x46 */
+	NULL,               /* 0x47 */
+	NULL,               /* 0x48 */
+	NULL,               /* 0x49 */
+	NULL,               /* 0x4a */
+	NULL,               /* 0x4b */
+	NULL,               /* 0x4c */
+	NULL,               /* 0x4d */
+	NULL,               /* 0x4e */
+	NULL,               /* 0x4f */
+	"replica anon",     /* 0x50 */
+	"id filter",        /* 0x51 */
+	"error",            /* 0x52 */
+	"compression",      /* 0x53 */
+	"space filter",     /* 0x54 */
 };
 
 const char *vy_page_info_key_strs[VY_PAGE_INFO_KEY_MAX] = {
@@ -207,7 +239,8 @@ const char *vy_page_info_key_strs[VY_PAGE_INFO_KEY_MAX] = {
 	"unpacked size",
 	"row count",
 	"min key",
-	"row index offset"
+	"row index offset",
+	"bloom filter",
 };
 
 const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
@@ -220,9 +253,26 @@ const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
 	"bloom filter legacy",
 	"bloom filter",
 	"stmt stat",
+	"blobs",
+	"range tombstone lsn",
 };
 
 const char *vy_row_index_key_strs[VY_ROW_INDEX_KEY_MAX] = {
 	NULL,
 	"row index",
+	"restart interval",
+};
+
+const char *vy_blob_ref_key_strs[VY_BLOB_REF_KEY_MAX] = {
+	NULL,
+	"blob id",
+	"offset",
+	"size",
+};
+
+const char *vy_prefix_row_key_strs[VY_PREFIX_ROW_KEY_MAX] = {
+	NULL,
+	"type",
+	"shared size",
+	"suffix",
 };
@@ -67,6 +67,15 @@ enum iproto_key {
 	IPROTO_GROUP_ID = 0x07,
 	IPROTO_TSN = 0x08,
 	IPROTO_FLAGS = 0x09,
+	/** Request trace id, see box.stat.traces(). */
+	IPROTO_TRACE_ID = 0x0a,
+	/**
+	 * Vclock the replica set vclock must reach before the
+	 * request is executed, see wal_wait_vclock().
+	 */
+	IPROTO_WAIT_VCLOCK = 0x0b,
+	/** Timeout of waiting for IPROTO_WAIT_VCLOCK, in seconds. */
+	IPROTO_WAIT_VCLOCK_TIMEOUT = 0x0c,
 	/* Leave a gap for other keys in the header. */
 	IPROTO_SPACE_ID = 0x10,
 	IPROTO_INDEX_ID = 0x11,
@@ -74,6 +83,8 @@ enum iproto_key {
 	IPROTO_OFFSET = 0x13,
 	IPROTO_ITERATOR = 0x14,
 	IPROTO_INDEX_BASE = 0x15,
+	/** Server-side iterator, SELECT_FETCH and SELECT_CLOSE. */
+	IPROTO_ITERATOR_ID = 0x16,
 
 	/* Leave a gap between integer values and other keys */
 	IPROTO_KEY = 0x20,
@@ -98,6 +109,8 @@ enum iproto_key {
 	IPROTO_BALLOT = 0x29,
 	IPROTO_TUPLE_META = 0x2a,
 	IPROTO_OPTIONS = 0x2b,
+	/** DML requests of a BATCH request. */
+	IPROTO_REQUESTS = 0x2c,
 
 	/* Leave a gap between request keys and response keys */
 	IPROTO_DATA = 0x30,
@@ -123,10 +136,18 @@ enum iproto_key {
 	 */
 	IPROTO_SQL_INFO = 0x42,
 	IPROTO_STMT_ID = 0x43,
+	/** Number of rows to return at once, EXECUTE and FETCH. */
+	IPROTO_SQL_FETCH_SIZE = 0x44,
+	/** Server-side cursor, in FETCH and EXECUTE response. */
+	IPROTO_SQL_CURSOR_ID = 0x45,
 	/* Leave a gap between SQL keys and additional request keys */
 	IPROTO_REPLICA_ANON = 0x50,
 	IPROTO_ID_FILTER = 0x51,
 	IPROTO_ERROR = 0x52,
+	/** Compression algorithm name, in COMPRESS request. */
+	IPROTO_COMPRESSION = 0x53,
+	/** Ids of user spaces to relay, in SUBSCRIBE request. */
+	IPROTO_SPACE_FILTER = 0x54,
 	IPROTO_KEY_MAX
 };
 
@@ -157,7 +178,8 @@ enum iproto_ballot_key {
 			  bit(LSN) | bit(SCHEMA_VERSION))
 #define IPROTO_DML_BODY_BMAP (bit(SPACE_ID) | bit(INDEX_ID) | bit(LIMIT) |\
 			      bit(OFFSET) | bit(ITERATOR) | bit(INDEX_BASE) |\
-			      bit(KEY) | bit(TUPLE) | bit(OPS) | bit(TUPLE_META))
+			      bit(ITERATOR_ID) | bit(KEY) | bit(TUPLE) |\
+			      bit(OPS) | bit(TUPLE_META))
 
 static inline bool
 xrow_header_has_key(const char *pos, const char *end)
@@ -216,6 +238,20 @@ enum iproto_type {
 	IPROTO_NOP = 12,
 	/** Prepare SQL statement. */
 	IPROTO_PREPARE = 13,
+	/** Look up tuples by a batch of keys. */
+	IPROTO_GET_BATCH = 14,
+	/** Fetch next rows of an SQL cursor. */
+	IPROTO_FETCH = 15,
+	/** SELECT, which keeps the iterator open on the server. */
+	IPROTO_SELECT_OPEN = 16,
+	/** Fetch next tuples of a server-side iterator. */
+	IPROTO_SELECT_FETCH = 17,
+	/** Close a server-side iterator. */
+	IPROTO_SELECT_CLOSE = 18,
+	/** Delete all tuples whose keys fall in a range. */
+	IPROTO_DELETE_RANGE = 19,
+	/** Execute a batch of DML requests in one transaction. */
+	IPROTO_BATCH = 20,
 	/** The maximum typecode used for box.stat() */
 	IPROTO_TYPE_STAT_MAX,
 
@@ -238,6 +274,18 @@ enum iproto_type {
 	IPROTO_FETCH_SNAPSHOT = 69,
 	/** REGISTER request to leave anonymous replication. */
 	IPROTO_REGISTER = 70,
+	/**
+	 * COMPRESS request. All the data following the request
+	 * and its response on the connection is compressed.
+	 */
+	IPROTO_COMPRESS = 71,
+	/**
+	 * SHM request, sent over a unix socket along with
+	 * the descriptors of the shared memory rings. All the data
+	 * following the request and its response on the connection
+	 * goes through the rings.
+	 */
+	IPROTO_SHM = 72,
 
 	/** Vinyl run info stored in .index file */
 	VY_INDEX_RUN_INFO = 100,
@@ -245,6 +293,10 @@ enum iproto_type {
 	VY_INDEX_PAGE_INFO = 101,
 	/** Vinyl row index stored in .run file */
 	VY_RUN_ROW_INDEX = 102,
+	/** Reference to a statement stored in a vinyl blob file */
+	VY_RUN_BLOB_REF = 103,
+	/** Vinyl statement with a prefix-compressed body */
+	VY_RUN_PREFIX_ROW = 104,
 
 	/** Non-final response type. */
 	IPROTO_CHUNK = 128,
@@ -267,10 +319,29 @@ iproto_type_name(uint32_t type)
 {
 	/*
 	 * Sic: iptoto_type_strs[IPROTO_NOP] is NULL
-	 * to suppress box.stat() output.
+	 * to suppress box.stat() output. The same is true
+	 * for IPROTO_GET_BATCH and IPROTO_SELECT_*, which are
+	 * accounted as SELECT, IPROTO_DELETE_RANGE, which is
+	 * accounted as DELETE, IPROTO_FETCH, which is a part
+	 * of EXECUTE, and IPROTO_BATCH, whose statements are
+	 * accounted one by one.
 	 */
 	if (type == IPROTO_NOP)
 		return "NOP";
+	if (type == IPROTO_GET_BATCH)
+		return "GET_BATCH";
+	if (type == IPROTO_FETCH)
+		return "FETCH";
+	if (type == IPROTO_SELECT_OPEN)
+		return "SELECT_OPEN";
+	if (type == IPROTO_SELECT_FETCH)
+		return "SELECT_FETCH";
+	if (type == IPROTO_SELECT_CLOSE)
+		return "SELECT_CLOSE";
+	if (type == IPROTO_DELETE_RANGE)
+		return "DELETE_RANGE";
+	if (type == IPROTO_BATCH)
+		return "BATCH";
 
 	if (type < IPROTO_TYPE_STAT_MAX)
 		return iproto_type_strs[type];
@@ -280,12 +351,20 @@ iproto_type_name(uint32_t type)
 		return "CONFIRM";
 	case IPROTO_ROLLBACK:
 		return "ROLLBACK";
+	case IPROTO_COMPRESS:
+		return "COMPRESS";
+	case IPROTO_SHM:
+		return "SHM";
 	case VY_INDEX_RUN_INFO:
 		return "RUNINFO";
 	case VY_INDEX_PAGE_INFO:
 		return "PAGEINFO";
 	case VY_RUN_ROW_INDEX:
 		return "ROWINDEX";
+	case VY_RUN_BLOB_REF:
+		return "BLOBREF";
+	case VY_RUN_PREFIX_ROW:
+		return "PREFIXROW";
 	default:
 		return NULL;
 	}
@@ -309,7 +388,9 @@ static inline bool
 iproto_type_is_dml(uint32_t type)
 {
 	return (type >= IPROTO_SELECT && type <= IPROTO_DELETE) ||
-		type == IPROTO_UPSERT || type == IPROTO_NOP;
+		type == IPROTO_UPSERT || type == IPROTO_NOP ||
+		type == IPROTO_GET_BATCH || type == IPROTO_DELETE_RANGE ||
+		(type >= IPROTO_SELECT_OPEN && type <= IPROTO_SELECT_CLOSE);
 }
 
 /**
@@ -380,6 +461,10 @@ enum vy_run_info_key {
 	VY_RUN_INFO_BLOOM = 7,
 	/** Number of statements of each type (map). */
 	VY_RUN_INFO_STMT_STAT = 8,
+	/** IDs of blob files referenced by the run (array). */
+	VY_RUN_INFO_BLOBS = 9,
+	/** Max LSN of range tombstones applied to the run. */
+	VY_RUN_INFO_RANGE_TOMBSTONE_LSN = 10,
 	/** The last key in this enum + 1 */
 	VY_RUN_INFO_KEY_MAX
 };
@@ -414,6 +499,8 @@ enum vy_page_info_key {
 	VY_PAGE_INFO_MIN_KEY = 5,
 	/** Offset of the row index in the page. */
 	VY_PAGE_INFO_ROW_INDEX_OFFSET = 6,
+	/** Bloom filter for keys stored in the page. */
+	VY_PAGE_INFO_BLOOM = 7,
 	/** The last key in this enum + 1 */
 	VY_PAGE_INFO_KEY_MAX
 };
@@ -438,6 +525,11 @@ vy_page_info_key_name(enum vy_page_info_key key)
 enum vy_row_index_key {
 	/** Array of row offsets. */
 	VY_ROW_INDEX_DATA = 1,
+	/**
+	 * Distance between restart points of prefix-compressed
+	 * rows, see VY_RUN_PREFIX_ROW.
+	 */
+	VY_ROW_INDEX_RESTART_INTERVAL = 2,
 	/** The last key in this enum + 1 */
 	VY_ROW_INDEX_KEY_MAX
 };
@@ -455,6 +547,62 @@ vy_row_index_key_name(enum vy_row_index_key key)
 	return vy_row_index_key_strs[key];
 }
 
+/**
+ * Xrow keys for Vinyl blob references.
+ * @sa struct vy_blob_ref.
+ */
+enum vy_blob_ref_key {
+	/** ID of the blob file. */
+	VY_BLOB_REF_ID = 1,
+	/** Offset of the statement in the blob file. */
+	VY_BLOB_REF_OFFSET = 2,
+	/** Size of the statement in the blob file. */
+	VY_BLOB_REF_SIZE = 3,
+	/** The last key in this enum + 1 */
+	VY_BLOB_REF_KEY_MAX
+};
+
+/**
+ * Return vy_blob_ref key name by @a key code.
+ * @param key key
+ */
+static inline const char *
+vy_blob_ref_key_name(enum vy_blob_ref_key key)
+{
+	if (key <= 0 || key >= VY_BLOB_REF_KEY_MAX)
+		return NULL;
+	extern const char *vy_blob_ref_key_strs[];
+	return vy_blob_ref_key_strs[key];
+}
+
+/**
+ * Xrow keys for Vinyl prefix-compressed statements.
+ * @sa VY_RUN_PREFIX_ROW.
+ */
+enum vy_prefix_row_key {
+	/** Type of the statement. */
+	VY_PREFIX_ROW_TYPE = 1,
+	/** Size of the prefix shared with the previous row body. */
+	VY_PREFIX_ROW_SHARED = 2,
+	/** The rest of the statement body. */
+	VY_PREFIX_ROW_SUFFIX = 3,
+	/** The last key in this enum + 1 */
+	VY_PREFIX_ROW_KEY_MAX
+};
+
+/**
+ * Return vy_prefix_row key name by @a key code.
+ * @param key key
+ */
+static inline const char *
+vy_prefix_row_key_name(enum vy_prefix_row_key key)
+{
+	if (key <= 0 || key >= VY_PREFIX_ROW_KEY_MAX)
+		return NULL;
+	extern const char *vy_prefix_row_key_strs[];
+	return vy_prefix_row_key_strs[key];
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "iproto_shm.h"
+
+#include <fcntl.h>
+#include <stdalign.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pmatomic.h>
+
+#include "trivia/config.h"
+#include "trivia/util.h"
+#include "diag.h"
+#include "error.h"
+
+#if defined(TARGET_OS_LINUX)
+#include <sys/eventfd.h>
+#endif
+
+enum {
+	/** Written by the client to the header once it's ready. */
+	IPROTO_SHM_MAGIC = 0x6d687369,
+	/** Offset of the ring data in the memory file. */
+	IPROTO_SHM_DATA_OFFSET = 4096,
+};
+
+/** Ring of bytes in shared memory. */
+struct iproto_shm_ring {
+	/** Number of bytes ever written, advanced by the producer. */
+	alignas(CACHELINE_SIZE) uint64_t wpos;
+	/** Set by the producer going to wait for space. */
+	uint32_t producer_waits;
+	/** Number of bytes ever read, advanced by the consumer. */
+	alignas(CACHELINE_SIZE) uint64_t rpos;
+	/** Set by the consumer going to wait for data. */
+	uint32_t consumer_waits;
+};
+
+/** Header of the memory file, followed by the ring data. */
+struct iproto_shm_header {
+	uint32_t magic;
+	/** Size of each ring, a power of two. */
+	uint32_t ring_size;
+	/** Set by the side which closes the connection. */
+	uint32_t is_closed;
+	/** Requests, then responses. */
+	struct iproto_shm_ring rings[2];
+};
+
+static_assert(sizeof(struct iproto_shm_header) <= IPROTO_SHM_DATA_OFFSET,
+	      "shared memory header must fit before the ring data");
+
+/** Point the rings of @a shm to the mapped memory file. */
+static void
+iproto_shm_setup(struct iproto_shm *shm, uint32_t ring_size, bool is_server)
+{
+	struct iproto_shm_header *header = shm->header;
+	char *data = (char *)header + IPROTO_SHM_DATA_OFFSET;
+	shm->ring_size = ring_size;
+	shm->in = &header->rings[!is_server];
+	shm->in_data = data + (!is_server) * (size_t)ring_size;
+	shm->out = &header->rings[is_server];
+	shm->out_data = data + is_server * (size_t)ring_size;
+	shm->in_pos = 0;
+	shm->out_pos = 0;
+	shm->wait_fd = shm->fds[is_server ? IPROTO_SHM_FD_SERVER :
+					    IPROTO_SHM_FD_CLIENT];
+	shm->signal_fd = shm->fds[is_server ? IPROTO_SHM_FD_CLIENT :
+					      IPROTO_SHM_FD_SERVER];
+}
+
+int
+iproto_shm_create(struct iproto_shm *shm, uint32_t ring_size)
+{
+	shm->header = NULL;
+	for (int i = 0; i < iproto_shm_fd_MAX; i++)
+		shm->fds[i] = -1;
+#if defined(TARGET_OS_LINUX)
+	uint32_t size = IPROTO_SHM_RING_SIZE_MIN;
+	while (size < ring_size && size < IPROTO_SHM_RING_SIZE_MAX)
+		size *= 2;
+	shm->size = IPROTO_SHM_DATA_OFFSET + 2 * (size_t)size;
+	int fd = memfd_create("iproto_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to create shared memory");
+		goto error;
+	}
+	shm->fds[IPROTO_SHM_FD_MEM] = fd;
+	if (ftruncate(fd, shm->size) != 0 ||
+	    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+		  F_SEAL_SEAL) != 0) {
+		diag_set(SystemError, "failed to resize shared memory");
+		goto error;
+	}
+	for (int i = IPROTO_SHM_FD_SERVER; i <= IPROTO_SHM_FD_CLIENT; i++) {
+		shm->fds[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (shm->fds[i] < 0) {
+			diag_set(SystemError, "failed to create eventfd");
+			goto error;
+		}
+	}
+	void *map = mmap(NULL, shm->size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		diag_set(SystemError, "failed to map shared memory");
+		goto error;
+	}
+	shm->header = (struct iproto_shm_header *)map;
+	/* The memory file is zeroed, so the rings are empty. */
+	shm->header->ring_size = size;
+	pm_atomic_store_explicit(&shm->header->magic, IPROTO_SHM_MAGIC,
+				 pm_memory_order_release);
+	iproto_shm_setup(shm, size, false);
+	return 0;
+error:
+	iproto_shm_destroy(shm);
+	return -1;
+#else
+	(void)ring_size;
+	diag_set(ClientError, ER_UNSUPPORTED, "IPROTO",
+		 "shared memory transport");
+	return -1;
+#endif
+}
+
+int
+iproto_shm_attach(struct iproto_shm *shm, const int *fds)
+{
+	shm->header = NULL;
+	for (int i = 0; i < iproto_shm_fd_MAX; i++)
+		shm->fds[i] = fds[i];
+#if defined(TARGET_OS_LINUX)
+	int fd = shm->fds[IPROTO_SHM_FD_MEM];
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		diag_set(SystemError, "failed to stat shared memory");
+		goto error;
+	}
+	/*
+	 * The client keeps the memory file, so it could shrink
+	 * it and make us crash with SIGBUS on access.
+	 */
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+		diag_set(ClientError, ER_PROTOCOL,
+			 "Shared memory file must be sealed");
+		goto error;
+	}
+	for (int i = IPROTO_SHM_FD_SERVER; i <= IPROTO_SHM_FD_CLIENT; i++) {
+		int flags = fcntl(shm->fds[i], F_GETFL);
+		if (flags < 0 ||
+		    fcntl(shm->fds[i], F_SETFL, flags | O_NONBLOCK) != 0) {
+			diag_set(SystemError, "failed to set up eventfd");
+			goto error;
+		}
+	}
+	if (st.st_size < IPROTO_SHM_DATA_OFFSET)
+		goto invalid;
+	shm->size = st.st_size;
+	void *map = mmap(NULL, shm->size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		diag_set(SystemError, "failed to map shared memory");
+		goto error;
+	}
+	shm->header = (struct iproto_shm_header *)map;
+	/* Read the size once, the client may change it later. */
+	uint32_t size = pm_atomic_load_explicit(&shm->header->ring_size,
+						pm_memory_order_relaxed);
+	if (pm_atomic_load_explicit(&shm->header->magic,
+				    pm_memory_order_acquire) !=
+	    IPROTO_SHM_MAGIC || size < IPROTO_SHM_RING_SIZE_MIN ||
+	    size > IPROTO_SHM_RING_SIZE_MAX || (size & (size - 1)) != 0 ||
+	    IPROTO_SHM_DATA_OFFSET + 2 * (size_t)size > shm->size)
+		goto invalid;
+	iproto_shm_setup(shm, size, true);
+	return 0;
+invalid:
+	diag_set(ClientError, ER_PROTOCOL, "Invalid shared memory file");
+error:
+	iproto_shm_destroy(shm);
+	return -1;
+#else
+	diag_set(ClientError, ER_UNSUPPORTED, "IPROTO",
+		 "shared memory transport");
+	iproto_shm_destroy(shm);
+	return -1;
+#endif
+}
+
+void
+iproto_shm_destroy(struct iproto_shm *shm)
+{
+	if (shm->header != NULL) {
+		munmap(shm->header, shm->size);
+		shm->header = NULL;
+	}
+	for (int i = 0; i < iproto_shm_fd_MAX; i++) {
+		if (shm->fds[i] >= 0)
+			close(shm->fds[i]);
+		shm->fds[i] = -1;
+	}
+}
+
+/** Wake up the peer if it has set the @a waits flag. */
+static void
+iproto_shm_wakeup(struct iproto_shm *shm, uint32_t *waits)
+{
+	/*
+	 * Pairs with the fence in iproto_shm_wait_*(): either the
+	 * peer sees the new ring position, or we see its flag.
+	 */
+	pm_atomic_thread_fence(pm_memory_order_seq_cst);
+	if (pm_atomic_load_explicit(waits, pm_memory_order_relaxed) == 0)
+		return;
+	pm_atomic_store_explicit(waits, 0, pm_memory_order_relaxed);
+	uint64_t one = 1;
+	ssize_t rc = write(shm->signal_fd, &one, sizeof(one));
+	(void)rc;
+}
+
+static void
+iproto_shm_corrupted(void)
+{
+	diag_set(ClientError, ER_PROTOCOL, "Shared memory ring is corrupted");
+}
+
+ssize_t
+iproto_shm_read(struct iproto_shm *shm, char *buf, size_t size)
+{
+	struct iproto_shm_ring *ring = shm->in;
+	uint64_t wpos = pm_atomic_load_explicit(&ring->wpos,
+						pm_memory_order_acquire);
+	/* Ring positions are written by the peer, don't trust them. */
+	uint64_t used = wpos - shm->in_pos;
+	if (used > shm->ring_size) {
+		iproto_shm_corrupted();
+		return -1;
+	}
+	size_t len = MIN(size, used);
+	if (len == 0)
+		return 0;
+	size_t offset = shm->in_pos & (shm->ring_size - 1);
+	size_t n = MIN(len, shm->ring_size - offset);
+	memcpy(buf, shm->in_data + offset, n);
+	memcpy(buf + n, shm->in_data, len - n);
+	shm->in_pos += len;
+	pm_atomic_store_explicit(&ring->rpos, shm->in_pos,
+				 pm_memory_order_release);
+	iproto_shm_wakeup(shm, &ring->producer_waits);
+	return len;
+}
+
+ssize_t
+iproto_shm_writev(struct iproto_shm *shm, const struct iovec *iov,
+		  int iovcnt)
+{
+	struct iproto_shm_ring *ring = shm->out;
+	uint64_t rpos = pm_atomic_load_explicit(&ring->rpos,
+						pm_memory_order_acquire);
+	uint64_t used = shm->out_pos - rpos;
+	if (used > shm->ring_size) {
+		iproto_shm_corrupted();
+		return -1;
+	}
+	size_t space = shm->ring_size - used;
+	size_t total = 0;
+	for (int i = 0; i < iovcnt && space > 0; i++) {
+		const char *src = (const char *)iov[i].iov_base;
+		size_t len = MIN(iov[i].iov_len, space);
+		size_t offset = (shm->out_pos + total) & (shm->ring_size - 1);
+		size_t n = MIN(len, shm->ring_size - offset);
+		memcpy(shm->out_data + offset, src, n);
+		memcpy(shm->out_data, src + n, len - n);
+		total += len;
+		space -= len;
+	}
+	if (total == 0)
+		return 0;
+	shm->out_pos += total;
+	pm_atomic_store_explicit(&ring->wpos, shm->out_pos,
+				 pm_memory_order_release);
+	iproto_shm_wakeup(shm, &ring->consumer_waits);
+	return total;
+}
+
+bool
+iproto_shm_wait_read(struct iproto_shm *shm)
+{
+	struct iproto_shm_ring *ring = shm->in;
+	pm_atomic_store_explicit(&ring->consumer_waits, 1,
+				 pm_memory_order_relaxed);
+	pm_atomic_thread_fence(pm_memory_order_seq_cst);
+	uint64_t wpos = pm_atomic_load_explicit(&ring->wpos,
+						pm_memory_order_acquire);
+	if (wpos == shm->in_pos && !iproto_shm_is_closed(shm))
+		return true;
+	pm_atomic_store_explicit(&ring->consumer_waits, 0,
+				 pm_memory_order_relaxed);
+	return false;
+}
+
+bool
+iproto_shm_wait_write(struct iproto_shm *shm)
+{
+	struct iproto_shm_ring *ring = shm->out;
+	pm_atomic_store_explicit(&ring->producer_waits, 1,
+				 pm_memory_order_relaxed);
+	pm_atomic_thread_fence(pm_memory_order_seq_cst);
+	uint64_t rpos = pm_atomic_load_explicit(&ring->rpos,
+						pm_memory_order_acquire);
+	if (shm->out_pos - rpos >= shm->ring_size &&
+	    !iproto_shm_is_closed(shm))
+		return true;
+	pm_atomic_store_explicit(&ring->producer_waits, 0,
+				 pm_memory_order_relaxed);
+	return false;
+}
+
+void
+iproto_shm_clear_wakeup(struct iproto_shm *shm)
+{
+	uint64_t count;
+	ssize_t rc = read(shm->wait_fd, &count, sizeof(count));
+	(void)rc;
+}
+
+void
+iproto_shm_close(struct iproto_shm *shm)
+{
+	pm_atomic_store_explicit(&shm->header->is_closed, 1,
+				 pm_memory_order_release);
+	uint64_t one = 1;
+	ssize_t rc = write(shm->signal_fd, &one, sizeof(one));
+	(void)rc;
+}
+
+bool
+iproto_shm_is_closed(struct iproto_shm *shm)
+{
+	return pm_atomic_load_explicit(&shm->header->is_closed,
+				       pm_memory_order_acquire) != 0;
+}
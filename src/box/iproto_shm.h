@@ -0,0 +1,183 @@
+#ifndef TARANTOOL_BOX_IPROTO_SHM_H_INCLUDED
+#define TARANTOOL_BOX_IPROTO_SHM_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Shared memory transport of an iproto connection.
+ *
+ * A client running on the same host as the server creates
+ * a memory file with two byte rings, one for requests and one
+ * for responses, and two eventfds, one to wake up the server
+ * and one to wake up the client. It passes them to the server
+ * along with IPROTO_SHM request over a unix socket. The data
+ * sent after the request and received after the response to
+ * it goes through the rings, while the socket is only used to
+ * detect that the peer is gone.
+ *
+ * Each ring has one producer and one consumer. A side going
+ * to wait for data or space sets a flag in the ring, and the
+ * other side writes to the eventfd only if the flag is set,
+ * so no syscalls are made while both sides are busy.
+ */
+
+/** Descriptors passed along with IPROTO_SHM request. */
+enum iproto_shm_fd {
+	/** Memory file with the rings. */
+	IPROTO_SHM_FD_MEM,
+	/** Eventfd the server waits on. */
+	IPROTO_SHM_FD_SERVER,
+	/** Eventfd the client waits on. */
+	IPROTO_SHM_FD_CLIENT,
+	iproto_shm_fd_MAX,
+};
+
+enum {
+	/** Min size of a ring, fits any reasonable request. */
+	IPROTO_SHM_RING_SIZE_MIN = 64 * 1024,
+	/** Max size of a ring. */
+	IPROTO_SHM_RING_SIZE_MAX = 1024 * 1024 * 1024,
+};
+
+struct iproto_shm_header;
+struct iproto_shm_ring;
+
+/** Rings of a connection mapped by one of the sides. */
+struct iproto_shm {
+	/** Start of the mapped memory file. */
+	struct iproto_shm_header *header;
+	/** Size of the mapping. */
+	size_t size;
+	/** Size of each ring, a power of two. */
+	uint32_t ring_size;
+	/** Ring this side reads from and its data. */
+	struct iproto_shm_ring *in;
+	char *in_data;
+	/** Ring this side writes to and its data. */
+	struct iproto_shm_ring *out;
+	char *out_data;
+	/**
+	 * Positions in the rings advanced by this side. Private
+	 * copies are kept since the shared ones may be written
+	 * by the peer.
+	 */
+	uint64_t in_pos;
+	uint64_t out_pos;
+	/** Descriptors, see enum iproto_shm_fd. */
+	int fds[iproto_shm_fd_MAX];
+	/** Eventfd this side waits on. */
+	int wait_fd;
+	/** Eventfd the peer waits on. */
+	int signal_fd;
+};
+
+/**
+ * Create the rings on the client side. @a ring_size is rounded
+ * up to a power of two. Descriptors to pass to the server are
+ * stored in shm->fds.
+ */
+int
+iproto_shm_create(struct iproto_shm *shm, uint32_t ring_size);
+
+/**
+ * Map the rings created by a client on the server side. Takes
+ * ownership of @a fds, which are closed on failure. The memory
+ * file must be sealed against shrinking, so the client can't
+ * crash the server by truncating it.
+ */
+int
+iproto_shm_attach(struct iproto_shm *shm, const int *fds);
+
+/** Unmap the rings and close the descriptors. */
+void
+iproto_shm_destroy(struct iproto_shm *shm);
+
+/**
+ * Read up to @a size bytes from the input ring and wake up
+ * the peer if it waits for space.
+ * @return the number of bytes read, 0 if the ring is empty,
+ * -1 if the ring is corrupted (diag is set).
+ */
+ssize_t
+iproto_shm_read(struct iproto_shm *shm, char *buf, size_t size);
+
+/**
+ * Write as much of @a iov as fits to the output ring and wake
+ * up the peer if it waits for data.
+ * @return the number of bytes written, 0 if the ring is full,
+ * -1 if the ring is corrupted (diag is set).
+ */
+ssize_t
+iproto_shm_writev(struct iproto_shm *shm, const struct iovec *iov,
+		  int iovcnt);
+
+/**
+ * Prepare to wait for data in the input ring. Returns false if
+ * there's data already, otherwise the peer will wake us up on
+ * wait_fd once it writes some.
+ */
+bool
+iproto_shm_wait_read(struct iproto_shm *shm);
+
+/**
+ * Prepare to wait for space in the output ring. Returns false
+ * if there's space already, otherwise the peer will wake us up
+ * on wait_fd once it reads something.
+ */
+bool
+iproto_shm_wait_write(struct iproto_shm *shm);
+
+/** Reset wait_fd after a wakeup. */
+void
+iproto_shm_clear_wakeup(struct iproto_shm *shm);
+
+/** Tell the peer that this side is gone and wake it up. */
+void
+iproto_shm_close(struct iproto_shm *shm);
+
+/** True if either side closed the connection. */
+bool
+iproto_shm_is_closed(struct iproto_shm *shm);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_IPROTO_SHM_H_INCLUDED */
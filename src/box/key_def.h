@@ -184,6 +184,15 @@ struct key_def {
 	tuple_hint_t tuple_hint;
 	/** @see key_hint() */
 	key_hint_t key_hint;
+	/**
+	 * Number of leading key parts packed in a comparison hint.
+	 * If the first parts are integers, the hint is composed of
+	 * several parts so that it settles most comparisons of
+	 * compound keys, see tuple_compare.cc. Hints of key
+	 * definitions with different hint_part_count aren't
+	 * comparable.
+	 */
+	uint32_t hint_part_count;
 	/**
 	 * Minimal part count which always is unique. For example,
 	 * if a secondary index is unique, then
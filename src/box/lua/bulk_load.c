@@ -0,0 +1,180 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/bulk_load.h"
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "lua/utils.h"
+
+#include "box/lua/tuple.h"
+#include "box/bulk_load.h"
+#include "box/tuple.h"
+
+static const char bulk_load_typename[] = "box.bulk_load";
+
+static struct bulk_load **
+luaT_checkbulkload(struct lua_State *L, int idx, const char *usage)
+{
+	if (idx > lua_gettop(L))
+		luaL_error(L, "usage: %s", usage);
+	return (struct bulk_load **)luaL_checkudata(L, idx,
+						     bulk_load_typename);
+}
+
+/** Get a bulk load that is still open, raise an error otherwise. */
+static struct bulk_load *
+luaT_checkopenbulkload(struct lua_State *L, int idx, const char *usage)
+{
+	struct bulk_load **ptr = luaT_checkbulkload(L, idx, usage);
+	if (*ptr == NULL)
+		luaL_error(L, "bulk load is closed");
+	return *ptr;
+}
+
+/**
+ * box.bulk_load.new(space_id) starts a bulk load of an empty
+ * memtx space.
+ */
+static int
+lbox_bulk_load_new(struct lua_State *L)
+{
+	if (lua_gettop(L) != 1 || lua_type(L, 1) != LUA_TNUMBER)
+		return luaL_error(L, "usage: box.bulk_load.new(space_id)");
+	uint32_t space_id = lua_tointeger(L, 1);
+	struct bulk_load **ptr = lua_newuserdata(L, sizeof(*ptr));
+	*ptr = bulk_load_new(space_id);
+	if (*ptr == NULL)
+		return luaT_error(L);
+	luaL_getmetatable(L, bulk_load_typename);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+/**
+ * loader:insert(tuple) appends a tuple given as a table or
+ * a tuple object. Tuples must be inserted in the order of the
+ * primary key.
+ */
+static int
+lbox_bulk_load_insert(struct lua_State *L)
+{
+	static const char usage[] = "loader:insert(tuple)";
+	struct bulk_load *bl = luaT_checkopenbulkload(L, 1, usage);
+	if (lua_gettop(L) != 2)
+		return luaL_error(L, "usage: %s", usage);
+	struct tuple *tuple = luaT_istuple(L, 2);
+	if (tuple == NULL) {
+		tuple = luaT_tuple_new(L, 2, tuple_format_runtime);
+		if (tuple == NULL)
+			return luaT_error(L);
+	}
+	tuple_ref(tuple);
+	uint32_t size;
+	const char *data = tuple_data_range(tuple, &size);
+	int rc = bulk_load_add(bl, data, data + size);
+	tuple_unref(tuple);
+	if (rc != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+/**
+ * loader:write(data) appends tuples from a string of
+ * concatenated MsgPack arrays, e.g. a chunk of a dump file.
+ */
+static int
+lbox_bulk_load_write(struct lua_State *L)
+{
+	static const char usage[] = "loader:write(data)";
+	struct bulk_load *bl = luaT_checkopenbulkload(L, 1, usage);
+	if (lua_gettop(L) != 2 || lua_type(L, 2) != LUA_TSTRING)
+		return luaL_error(L, "usage: %s", usage);
+	size_t size;
+	const char *data = lua_tolstring(L, 2, &size);
+	if (bulk_load_write(bl, data, size) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+/**
+ * loader:commit() inserts the appended tuples into the space
+ * and makes a checkpoint. The loader is closed on success.
+ */
+static int
+lbox_bulk_load_commit(struct lua_State *L)
+{
+	static const char usage[] = "loader:commit()";
+	struct bulk_load **ptr = luaT_checkbulkload(L, 1, usage);
+	struct bulk_load *bl = *ptr;
+	if (bl == NULL)
+		return luaL_error(L, "bulk load is closed");
+	/* Close the loader first: checkpointing yields. */
+	*ptr = NULL;
+	int rc = bulk_load_commit(bl);
+	bulk_load_delete(bl);
+	if (rc != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+/** loader:rollback() discards the appended tuples. */
+static int
+lbox_bulk_load_rollback(struct lua_State *L)
+{
+	struct bulk_load **ptr = luaT_checkbulkload(L, 1,
+						    "loader:rollback()");
+	if (*ptr != NULL)
+		bulk_load_delete(*ptr);
+	*ptr = NULL;
+	return 0;
+}
+
+void
+box_lua_bulk_load_init(struct lua_State *L)
+{
+	static const struct luaL_Reg bulk_load_meta[] = {
+		{"__gc", lbox_bulk_load_rollback},
+		{"insert", lbox_bulk_load_insert},
+		{"write", lbox_bulk_load_write},
+		{"commit", lbox_bulk_load_commit},
+		{"rollback", lbox_bulk_load_rollback},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, bulk_load_typename, bulk_load_meta);
+
+	static const struct luaL_Reg bulk_load_lib[] = {
+		{"new", lbox_bulk_load_new},
+		{NULL, NULL}
+	};
+	luaL_register_module(L, "box.bulk_load", bulk_load_lib);
+	lua_pop(L, 1);
+}
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "box/lua/call.h"
+#include "box/lua/func_worker.h"
 #include "box/call.h"
 #include "box/error.h"
 #include "box/func.h"
@@ -66,20 +67,40 @@ enum handlers {
 
 static int execute_lua_refs[HANDLER_MAX];
 
+/**
+ * Push a piece of a function path on the stack. If @a path_ref
+ * refers to a table of pieces built by box_lua_path_new(), take
+ * the pre-interned string from it instead of hashing the piece.
+ */
+static inline void
+box_lua_push_piece(lua_State *L, int path_ref, int piece,
+		   const char *start, const char *end)
+{
+	if (path_ref == LUA_NOREF) {
+		lua_pushlstring(L, start, end - start);
+		return;
+	}
+	lua_rawgeti(L, LUA_REGISTRYINDEX, path_ref);
+	lua_rawgeti(L, -1, piece);
+	lua_replace(L, -2);
+}
+
 /**
  * A helper to find a Lua function by name and put it
  * on top of the stack.
  */
 static int
-box_lua_find(lua_State *L, const char *name, const char *name_end)
+box_lua_find_path(lua_State *L, const char *name, const char *name_end,
+		  int path_ref)
 {
 	int index = LUA_GLOBALSINDEX;
 	int objstack = 0, top = lua_gettop(L);
 	const char *start = name, *end;
+	int piece = 1;
 
 	while ((end = (const char *) memchr(start, '.', name_end - start))) {
 		lua_checkstack(L, 3);
-		lua_pushlstring(L, start, end - start);
+		box_lua_push_piece(L, path_ref, piece++, start, end);
 		lua_gettable(L, index);
 		if (! lua_istable(L, -1)) {
 			diag_set(ClientError, ER_NO_SUCH_PROC,
@@ -93,7 +114,7 @@ box_lua_find(lua_State *L, const char *name, const char *name_end)
 	/* box.something:method */
 	if ((end = (const char *) memchr(start, ':', name_end - start))) {
 		lua_checkstack(L, 3);
-		lua_pushlstring(L, start, end - start);
+		box_lua_push_piece(L, path_ref, piece++, start, end);
 		lua_gettable(L, index);
 		if (! (lua_istable(L, -1) ||
 			lua_islightuserdata(L, -1) || lua_isuserdata(L, -1) )) {
@@ -107,8 +128,8 @@ box_lua_find(lua_State *L, const char *name, const char *name_end)
 		objstack = index - top;
 	}
 
-
-	lua_pushlstring(L, start, name_end - start);
+	lua_checkstack(L, 2);
+	box_lua_push_piece(L, path_ref, piece, start, name_end);
 	lua_gettable(L, index);
 	if (!lua_isfunction(L, -1) && !lua_istable(L, -1)) {
 		/* lua_call or lua_gettable would raise a type error
@@ -137,6 +158,42 @@ box_lua_find(lua_State *L, const char *name, const char *name_end)
 	return 1 + objstack;
 }
 
+static int
+box_lua_find(lua_State *L, const char *name, const char *name_end)
+{
+	return box_lua_find_path(L, name, name_end, LUA_NOREF);
+}
+
+int
+box_lua_path_new(const char *name, uint32_t name_len)
+{
+	lua_State *L = tarantool_L;
+	const char *name_end = name + name_len;
+	const char *start = name, *end;
+	int piece = 1;
+	lua_newtable(L);
+	/* Split the path the same way box_lua_find_path() does. */
+	while ((end = (const char *) memchr(start, '.', name_end - start))) {
+		lua_pushlstring(L, start, end - start);
+		lua_rawseti(L, -2, piece++);
+		start = end + 1;
+	}
+	if ((end = (const char *) memchr(start, ':', name_end - start))) {
+		lua_pushlstring(L, start, end - start);
+		lua_rawseti(L, -2, piece++);
+		start = end + 1;
+	}
+	lua_pushlstring(L, start, name_end - start);
+	lua_rawseti(L, -2, piece);
+	return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+void
+box_lua_path_delete(int path_ref)
+{
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, path_ref);
+}
+
 /**
  * A helper to find lua stored procedures for box.call.
  * box.call iteslf is pure Lua, to avoid issues
@@ -313,6 +370,8 @@ port_lua_create(struct port *port, struct lua_State *L)
 
 struct execute_lua_ctx {
 	int lua_ref;
+	/** Pieces of @a name or LUA_NOREF, see box_lua_path_new(). */
+	int path_ref;
 	const char *name;
 	uint32_t name_len;
 	struct port *args;
@@ -322,7 +381,8 @@ struct execute_lua_ctx {
  * Find a lua function by name and execute it. Used for body-less
  * UDFs, which may not yet be defined when a function definition
  * is loaded from _func table, or dynamically re-defined at any
- * time. We don't cache references to such functions.
+ * time. We don't cache references to such functions, only
+ * interned pieces of their names.
  */
 static int
 execute_lua_call(lua_State *L)
@@ -335,7 +395,7 @@ execute_lua_call(lua_State *L)
 	uint32_t name_len = ctx->name_len;
 
 	/* How many objects are on stack after box_lua_find. */
-	int oc = box_lua_find(L, name, name + name_len);
+	int oc = box_lua_find_path(L, name, name + name_len, ctx->path_ref);
 	if (oc < 0)
 		return luaT_error(L);
 
@@ -595,8 +655,16 @@ box_process_lua(enum handlers handler, struct execute_lua_ctx *ctx,
 int
 box_lua_call(const char *name, uint32_t name_len,
 	     struct port *args, struct port *ret)
+{
+	return box_lua_call_path(LUA_NOREF, name, name_len, args, ret);
+}
+
+int
+box_lua_call_path(int path_ref, const char *name, uint32_t name_len,
+		  struct port *args, struct port *ret)
 {
 	struct execute_lua_ctx ctx;
+	ctx.path_ref = path_ref;
 	ctx.name = name;
 	ctx.name_len = name_len;
 	ctx.args = args;
@@ -619,7 +687,8 @@ struct func_lua {
 	struct func base;
 	/**
 	 * For a persistent function: a reference to the
-	 * function body. Otherwise LUA_REFNIL.
+	 * function body. Otherwise a reference to the pieces
+	 * of the function name, see box_lua_path_new().
 	 */
 	int lua_ref;
 };
@@ -772,7 +841,7 @@ func_lua_new(struct func_def *def)
 			return NULL;
 		}
 	} else {
-		func->lua_ref = LUA_REFNIL;
+		func->lua_ref = box_lua_path_new(def->name, def->name_len);
 		func->base.vtab = &func_lua_vtab;
 	}
 	return &func->base;
@@ -783,6 +852,7 @@ func_lua_destroy(struct func *func)
 {
 	assert(func != NULL && func->def->language == FUNC_LANGUAGE_LUA);
 	assert(func->vtab == &func_lua_vtab);
+	box_lua_path_delete(((struct func_lua *)func)->lua_ref);
 	TRASH(func);
 	free(func);
 }
@@ -792,7 +862,9 @@ func_lua_call(struct func *func, struct port *args, struct port *ret)
 {
 	assert(func != NULL && func->def->language == FUNC_LANGUAGE_LUA);
 	assert(func->vtab == &func_lua_vtab);
-	return box_lua_call(func->def->name, func->def->name_len, args, ret);
+	return box_lua_call_path(((struct func_lua *)func)->lua_ref,
+				 func->def->name, func->def->name_len,
+				 args, ret);
 }
 
 static struct func_vtab func_lua_vtab = {
@@ -823,6 +895,8 @@ func_persistent_lua_call(struct func *base, struct port *args, struct port *ret)
 	assert(base != NULL && base->def->language == FUNC_LANGUAGE_LUA &&
 	       base->def->body != NULL);
 	assert(base->vtab == &func_persistent_lua_vtab);
+	if (base->def->opts.is_parallel)
+		return func_worker_call(base, args, ret);
 	struct func_lua *func = (struct func_lua *)base;
 	struct execute_lua_ctx ctx;
 	ctx.lua_ref = func->lua_ref;
@@ -54,6 +54,28 @@ int
 box_lua_call(const char *name, uint32_t name_len,
 	     struct port *args, struct port *ret);
 
+/**
+ * Split a Lua function path like 'a.b:c' into pieces and keep
+ * them as interned Lua strings, so that box_lua_call_path() can
+ * look up the function without hashing its name every time.
+ * The function itself is not referenced, because it may be
+ * redefined at any time. Returns a positive Lua registry
+ * reference, to be released with box_lua_path_delete().
+ */
+int
+box_lua_path_new(const char *name, uint32_t name_len);
+
+void
+box_lua_path_delete(int path_ref);
+
+/**
+ * Same as box_lua_call(), but use the pieces of @a name
+ * prepared by box_lua_path_new().
+ */
+int
+box_lua_call_path(int path_ref, const char *name, uint32_t name_len,
+		  struct port *args, struct port *ret);
+
 int
 box_lua_eval(const char *expr, uint32_t expr_len,
 	     struct port *args, struct port *ret);
@@ -0,0 +1,333 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/cdc.h"
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "lua/msgpack.h"
+#include "lua/utils.h"
+#include "msgpuck.h"
+
+#include "box/box.h"
+#include "box/cdc.h"
+#include "box/iproto_constants.h"
+#include "box/lua/tuple.h"
+#include "box/tuple.h"
+#include "box/xrow.h"
+
+static const char cdc_cursor_typename[] = "box.cdc.cursor";
+
+enum {
+	/** Default number of changes returned by cursor:fetch(). */
+	LBOX_CDC_FETCH_LIMIT = 1000,
+};
+
+static struct cdc_cursor **
+luaT_checkcdccursorptr(struct lua_State *L, int idx, const char *usage)
+{
+	if (idx > lua_gettop(L))
+		luaL_error(L, "usage: %s", usage);
+	return (struct cdc_cursor **)luaL_checkudata(L, idx,
+						     cdc_cursor_typename);
+}
+
+/** Check that a cursor is open and not being read. */
+static struct cdc_cursor *
+luaT_checkcdccursor(struct lua_State *L, int idx, const char *usage)
+{
+	struct cdc_cursor *cursor = *luaT_checkcdccursorptr(L, idx, usage);
+	if (cursor == NULL)
+		luaL_error(L, "cursor is closed");
+	if (cursor->is_busy)
+		luaL_error(L, "cursor is in use");
+	return cursor;
+}
+
+/**
+ * Decode a vclock from a Lua table {[replica_id] = lsn, ...},
+ * e.g. box.info.vclock.
+ */
+static void
+luaT_checkvclock(struct lua_State *L, int idx, struct vclock *vclock,
+		 const char *usage)
+{
+	if (lua_type(L, idx) != LUA_TTABLE)
+		luaL_error(L, "usage: %s", usage);
+	vclock_create(vclock);
+	lua_pushnil(L);
+	while (lua_next(L, idx) != 0) {
+		if (lua_type(L, -2) != LUA_TNUMBER ||
+		    lua_type(L, -1) != LUA_TNUMBER)
+			luaL_error(L, "usage: %s", usage);
+		double id = lua_tonumber(L, -2);
+		double lsn = lua_tonumber(L, -1);
+		if (id < 0 || id >= VCLOCK_MAX || id != (uint32_t)id ||
+		    lsn < 0 || lsn != (int64_t)lsn)
+			luaL_error(L, "usage: %s", usage);
+		vclock_reset(vclock, id, lsn);
+		lua_pop(L, 1);
+	}
+}
+
+/** See lbox_pushvclock() in box/lua/info.c. */
+static void
+lbox_cdc_pushvclock(struct lua_State *L, const struct vclock *vclock)
+{
+	lua_createtable(L, 0, vclock_size(vclock));
+	struct vclock_iterator it;
+	vclock_iterator_init(&it, vclock);
+	vclock_foreach(&it, replica) {
+		lua_pushinteger(L, replica.id);
+		luaL_pushuint64(L, replica.lsn);
+		lua_settable(L, -3);
+	}
+	luaL_setmaphint(L, -1); /* compact flow */
+}
+
+/**
+ * box.cdc.cursor([opts]) opens a cursor reading changes of
+ * the spaces given in opts.spaces, all non-system spaces by
+ * default, made after opts.vclock, the instance vclock by
+ * default. opts.name is shown in box.info.gc().consumers.
+ */
+static int
+lbox_cdc_cursor_open(struct lua_State *L)
+{
+	static const char usage[] =
+		"box.cdc.cursor([{name = string, spaces = {space, ...}, "
+		"vclock = vclock}])";
+	if (!box_is_configured())
+		return luaL_error(L, "Please call box.cfg{} first");
+	int top = lua_gettop(L);
+	if (top > 1 || (top == 1 && lua_type(L, 1) != LUA_TTABLE))
+		return luaL_error(L, "usage: %s", usage);
+	if (top == 0)
+		lua_newtable(L);
+
+	const char *name = "cursor";
+	lua_getfield(L, 1, "name");
+	if (!lua_isnil(L, -1)) {
+		if (lua_type(L, -1) != LUA_TSTRING)
+			return luaL_error(L, "usage: %s", usage);
+		name = lua_tostring(L, -1);
+	}
+
+	struct vclock vclock;
+	lua_getfield(L, 1, "vclock");
+	if (!lua_isnil(L, -1))
+		luaT_checkvclock(L, lua_gettop(L), &vclock, usage);
+	else
+		vclock_copy(&vclock, box_vclock);
+
+	uint32_t space_count = 0;
+	uint32_t *space_ids = NULL;
+	lua_getfield(L, 1, "spaces");
+	if (!lua_isnil(L, -1)) {
+		if (lua_type(L, -1) != LUA_TTABLE)
+			return luaL_error(L, "usage: %s", usage);
+		int spaces_idx = lua_gettop(L);
+		space_count = lua_objlen(L, spaces_idx);
+		space_ids = lua_newuserdata(L, space_count *
+					    sizeof(*space_ids));
+		for (uint32_t i = 0; i < space_count; i++) {
+			lua_rawgeti(L, spaces_idx, i + 1);
+			if (lua_type(L, -1) == LUA_TTABLE) {
+				lua_getfield(L, -1, "id");
+				lua_replace(L, -2);
+			}
+			if (lua_type(L, -1) != LUA_TNUMBER)
+				return luaL_error(L, "usage: %s", usage);
+			space_ids[i] = lua_tointeger(L, -1);
+			lua_pop(L, 1);
+		}
+	}
+
+	struct cdc_cursor **ptr = lua_newuserdata(L, sizeof(*ptr));
+	*ptr = cdc_cursor_new(name, &vclock, space_ids, space_count);
+	if (*ptr == NULL)
+		return luaT_error(L);
+	luaL_getmetatable(L, cdc_cursor_typename);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+/** Argument of lbox_cdc_push_change(). */
+struct lbox_cdc_batch {
+	struct lua_State *L;
+	/** Number of changes pushed to the batch table. */
+	int count;
+};
+
+static int
+lbox_cdc_push_change(const struct xrow_header *row,
+		     const struct request *request, void *arg)
+{
+	struct lbox_cdc_batch *batch = arg;
+	struct lua_State *L = batch->L;
+	lua_createtable(L, 0, 8);
+	lua_pushstring(L, iproto_type_name(row->type));
+	lua_setfield(L, -2, "type");
+	lua_pushinteger(L, row->replica_id);
+	lua_setfield(L, -2, "replica_id");
+	luaL_pushint64(L, row->lsn);
+	lua_setfield(L, -2, "lsn");
+	lua_pushnumber(L, row->tm);
+	lua_setfield(L, -2, "timestamp");
+	lua_pushinteger(L, request->space_id);
+	lua_setfield(L, -2, "space_id");
+	if (request->key != NULL) {
+		const char *data = request->key;
+		luamp_decode(L, luaL_msgpack_default, &data);
+		lua_setfield(L, -2, "key");
+	}
+	if (request->tuple != NULL && row->type == IPROTO_UPDATE) {
+		/* Update operations are stored in the tuple field. */
+		const char *data = request->tuple;
+		luamp_decode(L, luaL_msgpack_default, &data);
+		lua_setfield(L, -2, "ops");
+	} else if (request->tuple != NULL) {
+		struct tuple *tuple = box_tuple_new(box_tuple_format_default(),
+						    request->tuple,
+						    request->tuple_end);
+		if (tuple == NULL)
+			return -1;
+		luaT_pushtuple(L, tuple);
+		lua_setfield(L, -2, "tuple");
+	}
+	if (request->ops != NULL) {
+		const char *data = request->ops;
+		luamp_decode(L, luaL_msgpack_default, &data);
+		lua_setfield(L, -2, "ops");
+	}
+	lua_rawseti(L, -2, ++batch->count);
+	return 0;
+}
+
+/**
+ * cursor:fetch([limit]) returns the next batch of changes and
+ * the cursor vclock after it, which may be passed to
+ * box.cdc.cursor() to resume reading after the batch. The batch
+ * is empty if there are no new changes.
+ */
+static int
+lbox_cdc_cursor_fetch(struct lua_State *L)
+{
+	static const char usage[] = "cursor:fetch([limit])";
+	struct cdc_cursor *cursor = luaT_checkcdccursor(L, 1, usage);
+	int limit = LBOX_CDC_FETCH_LIMIT;
+	if (lua_gettop(L) > 1 && !lua_isnil(L, 2)) {
+		if (lua_type(L, 2) != LUA_TNUMBER || lua_tointeger(L, 2) < 1)
+			return luaL_error(L, "usage: %s", usage);
+		limit = lua_tointeger(L, 2);
+	}
+	lua_settop(L, 1);
+	lua_newtable(L);
+	struct lbox_cdc_batch batch;
+	batch.L = L;
+	batch.count = 0;
+	if (cdc_cursor_read(cursor, limit, lbox_cdc_push_change, &batch) < 0)
+		return luaT_error(L);
+	lbox_cdc_pushvclock(L, &cursor->vclock);
+	return 2;
+}
+
+/**
+ * cursor:ack([vclock]) lets WAL files with changes up to the
+ * vclock, all fetched changes by default, be removed.
+ */
+static int
+lbox_cdc_cursor_ack(struct lua_State *L)
+{
+	static const char usage[] = "cursor:ack([vclock])";
+	struct cdc_cursor *cursor = luaT_checkcdccursor(L, 1, usage);
+	struct vclock vclock;
+	if (lua_gettop(L) > 1 && !lua_isnil(L, 2))
+		luaT_checkvclock(L, 2, &vclock, usage);
+	else
+		vclock_copy(&vclock, &cursor->vclock);
+	if (cdc_cursor_ack(cursor, &vclock) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_cdc_cursor_vclock(struct lua_State *L)
+{
+	struct cdc_cursor *cursor = luaT_checkcdccursor(L, 1,
+							"cursor:vclock()");
+	lbox_cdc_pushvclock(L, &cursor->vclock);
+	return 1;
+}
+
+static int
+lbox_cdc_cursor_close(struct lua_State *L)
+{
+	struct cdc_cursor **ptr = luaT_checkcdccursorptr(L, 1,
+							 "cursor:close()");
+	if (*ptr != NULL && (*ptr)->is_busy)
+		return luaL_error(L, "cursor is in use");
+	if (*ptr != NULL)
+		cdc_cursor_delete(*ptr);
+	*ptr = NULL;
+	return 0;
+}
+
+static int
+lbox_cdc_cursor_gc(struct lua_State *L)
+{
+	struct cdc_cursor **ptr = luaT_checkcdccursorptr(L, 1, "");
+	if (*ptr != NULL)
+		cdc_cursor_delete(*ptr);
+	*ptr = NULL;
+	return 0;
+}
+
+void
+box_lua_cdc_init(struct lua_State *L)
+{
+	static const struct luaL_Reg cdc_cursor_meta[] = {
+		{"__gc", lbox_cdc_cursor_gc},
+		{"fetch", lbox_cdc_cursor_fetch},
+		{"ack", lbox_cdc_cursor_ack},
+		{"vclock", lbox_cdc_cursor_vclock},
+		{"close", lbox_cdc_cursor_close},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, cdc_cursor_typename, cdc_cursor_meta);
+
+	static const struct luaL_Reg cdc_lib[] = {
+		{"cursor", lbox_cdc_cursor_open},
+		{NULL, NULL}
+	};
+	luaL_register_module(L, "box.cdc", cdc_lib);
+	lua_pop(L, 1);
+}
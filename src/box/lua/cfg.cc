@@ -37,7 +37,6 @@
 #include "lua/utils.h"
 
 #include "box/box.h"
-#include "libeio/eio.h"
 
 extern "C" {
 	#include <lua.h>
@@ -164,6 +163,50 @@ lbox_cfg_set_checkpoint_wal_threshold(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_checkpoint_recovery_time(struct lua_State *L)
+{
+	try {
+		box_set_checkpoint_recovery_time();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_wal_group_commit(struct lua_State *L)
+{
+	try {
+		box_set_wal_group_commit();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_wal_recycle_count(struct lua_State *L)
+{
+	try {
+		box_set_wal_recycle_count();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_wal_tail_size(struct lua_State *L)
+{
+	try {
+		box_set_wal_tail_size();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_read_only(struct lua_State *L)
 {
@@ -197,6 +240,69 @@ lbox_cfg_set_memtx_max_tuple_size(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_memtx_snapshot_threads(struct lua_State *L)
+{
+	try {
+		box_set_memtx_snapshot_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_xlog_compression_dict(struct lua_State *L)
+{
+	try {
+		box_set_xlog_compression_dict();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_checkpoint_delta_ratio(struct lua_State *L)
+{
+	try {
+		box_set_memtx_checkpoint_delta_ratio();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_defrag_budget(struct lua_State *L)
+{
+	try {
+		box_set_memtx_defrag_budget();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_expire_rate(struct lua_State *L)
+{
+	try {
+		box_set_memtx_expire_rate();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_update_in_place(struct lua_State *L)
+{
+	(void)L;
+	box_set_memtx_update_in_place();
+	return 0;
+}
+
 static int
 lbox_cfg_set_vinyl_memory(struct lua_State *L)
 {
@@ -230,6 +336,61 @@ lbox_cfg_set_vinyl_cache(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_vinyl_page_cache(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_page_cache();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_vinyl_max_subcompactions(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_max_subcompactions();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_vinyl_compaction_direct_io(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_compaction_direct_io();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_vinyl_compaction_readahead(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_compaction_readahead();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_vinyl_blob_threshold(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_blob_threshold();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_vinyl_timeout(struct lua_State *L)
 {
@@ -241,6 +402,17 @@ lbox_cfg_set_vinyl_timeout(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_vinyl_upsert_squash_threshold(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_upsert_squash_threshold();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_net_msg_max(struct lua_State *L)
 {
@@ -252,6 +424,39 @@ lbox_cfg_set_net_msg_max(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_net_fiber_stack_size(struct lua_State *L)
+{
+	try {
+		box_set_net_fiber_stack_size();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_net_trace_sample_rate(struct lua_State *L)
+{
+	try {
+		box_set_net_trace_sample_rate();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_busy_poll_timeout(struct lua_State *L)
+{
+	try {
+		box_set_busy_poll_timeout();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_set_prepared_stmt_cache_size(struct lua_State *L)
 {
@@ -263,9 +468,22 @@ lbox_set_prepared_stmt_cache_size(struct lua_State *L)
 static int
 lbox_cfg_set_worker_pool_threads(struct lua_State *L)
 {
-	(void) L;
-	eio_set_min_parallel(cfg_geti("worker_pool_threads"));
-	eio_set_max_parallel(cfg_geti("worker_pool_threads"));
+	try {
+		box_set_worker_pool_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_dns_cache_ttl(struct lua_State *L)
+{
+	try {
+		box_set_dns_cache_ttl();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
 	return 0;
 }
 
@@ -359,6 +577,50 @@ lbox_cfg_set_replication_skip_conflict(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_replication_apply_fibers(struct lua_State *L)
+{
+	try {
+		box_set_replication_apply_fibers();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_ack_interval(struct lua_State *L)
+{
+	try {
+		box_set_replication_ack_interval();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_spaces(struct lua_State *L)
+{
+	try {
+		box_set_replication_spaces();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_compression(struct lua_State *L)
+{
+	try {
+		box_set_replication_compression();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 void
 box_lua_cfg_init(struct lua_State *L)
 {
@@ -368,6 +630,7 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_listen", lbox_cfg_set_listen},
 		{"cfg_set_replication", lbox_cfg_set_replication},
 		{"cfg_set_worker_pool_threads", lbox_cfg_set_worker_pool_threads},
+		{"cfg_set_dns_cache_ttl", lbox_cfg_set_dns_cache_ttl},
 		{"cfg_set_readahead", lbox_cfg_set_readahead},
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
@@ -375,13 +638,29 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_checkpoint_count", lbox_cfg_set_checkpoint_count},
 		{"cfg_set_checkpoint_interval", lbox_cfg_set_checkpoint_interval},
 		{"cfg_set_checkpoint_wal_threshold", lbox_cfg_set_checkpoint_wal_threshold},
+		{"cfg_set_checkpoint_recovery_time", lbox_cfg_set_checkpoint_recovery_time},
+		{"cfg_set_wal_group_commit", lbox_cfg_set_wal_group_commit},
+		{"cfg_set_wal_recycle_count", lbox_cfg_set_wal_recycle_count},
+		{"cfg_set_wal_tail_size", lbox_cfg_set_wal_tail_size},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{"cfg_set_memtx_memory", lbox_cfg_set_memtx_memory},
 		{"cfg_set_memtx_max_tuple_size", lbox_cfg_set_memtx_max_tuple_size},
+		{"cfg_set_memtx_snapshot_threads", lbox_cfg_set_memtx_snapshot_threads},
+		{"cfg_set_memtx_checkpoint_delta_ratio", lbox_cfg_set_memtx_checkpoint_delta_ratio},
+		{"cfg_set_memtx_defrag_budget", lbox_cfg_set_memtx_defrag_budget},
+		{"cfg_set_memtx_update_in_place", lbox_cfg_set_memtx_update_in_place},
+		{"cfg_set_memtx_expire_rate", lbox_cfg_set_memtx_expire_rate},
+		{"cfg_set_xlog_compression_dict", lbox_cfg_set_xlog_compression_dict},
 		{"cfg_set_vinyl_memory", lbox_cfg_set_vinyl_memory},
 		{"cfg_set_vinyl_max_tuple_size", lbox_cfg_set_vinyl_max_tuple_size},
 		{"cfg_set_vinyl_cache", lbox_cfg_set_vinyl_cache},
+		{"cfg_set_vinyl_page_cache", lbox_cfg_set_vinyl_page_cache},
+		{"cfg_set_vinyl_max_subcompactions", lbox_cfg_set_vinyl_max_subcompactions},
+		{"cfg_set_vinyl_compaction_direct_io", lbox_cfg_set_vinyl_compaction_direct_io},
+		{"cfg_set_vinyl_compaction_readahead", lbox_cfg_set_vinyl_compaction_readahead},
+		{"cfg_set_vinyl_blob_threshold", lbox_cfg_set_vinyl_blob_threshold},
 		{"cfg_set_vinyl_timeout", lbox_cfg_set_vinyl_timeout},
+		{"cfg_set_vinyl_upsert_squash_threshold", lbox_cfg_set_vinyl_upsert_squash_threshold},
 		{"cfg_set_replication_timeout", lbox_cfg_set_replication_timeout},
 		{"cfg_set_replication_connect_quorum", lbox_cfg_set_replication_connect_quorum},
 		{"cfg_set_replication_connect_timeout", lbox_cfg_set_replication_connect_timeout},
@@ -390,8 +669,15 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_replication_synchro_timeout", lbox_cfg_set_replication_synchro_timeout},
 		{"cfg_set_replication_sync_timeout", lbox_cfg_set_replication_sync_timeout},
 		{"cfg_set_replication_skip_conflict", lbox_cfg_set_replication_skip_conflict},
+		{"cfg_set_replication_apply_fibers", lbox_cfg_set_replication_apply_fibers},
+		{"cfg_set_replication_ack_interval", lbox_cfg_set_replication_ack_interval},
+		{"cfg_set_replication_spaces", lbox_cfg_set_replication_spaces},
+		{"cfg_set_replication_compression", lbox_cfg_set_replication_compression},
 		{"cfg_set_replication_anon", lbox_cfg_set_replication_anon},
 		{"cfg_set_net_msg_max", lbox_cfg_set_net_msg_max},
+		{"cfg_set_busy_poll_timeout", lbox_cfg_set_busy_poll_timeout},
+		{"cfg_set_net_fiber_stack_size", lbox_cfg_set_net_fiber_stack_size},
+		{"cfg_set_net_trace_sample_rate", lbox_cfg_set_net_trace_sample_rate},
 		{"cfg_set_sql_cache_size", lbox_set_prepared_stmt_cache_size},
 		{NULL, NULL}
 	};
@@ -660,6 +660,7 @@ tarantool_lua_console_init(struct lua_State *L)
 		.push	= console_session_push,
 		.fd	= console_session_fd,
 		.sync	= generic_session_sync,
+		.set_priority = generic_session_set_priority,
 	};
 	session_vtab_registry[SESSION_TYPE_CONSOLE] = console_session_vtab;
 	session_vtab_registry[SESSION_TYPE_REPL] = console_session_vtab;
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/csv_load.h"
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "lua/utils.h"
+
+#include "box/csv_load.h"
+
+/** Get a single character option, raise an error if it's invalid. */
+static char
+luaT_csv_load_char_opt(struct lua_State *L, int idx, const char *name,
+		       char value)
+{
+	lua_getfield(L, idx, name);
+	if (!lua_isnil(L, -1)) {
+		size_t len;
+		const char *str = lua_tolstring(L, -1, &len);
+		if (lua_type(L, -1) != LUA_TSTRING || len != 1)
+			luaL_error(L, "%s must be a single character", name);
+		value = str[0];
+	}
+	lua_pop(L, 1);
+	return value;
+}
+
+/** Get a number option, raise an error if it's less than @a min. */
+static uint32_t
+luaT_csv_load_uint_opt(struct lua_State *L, int idx, const char *name,
+		       uint32_t value, uint32_t min)
+{
+	lua_getfield(L, idx, name);
+	if (!lua_isnil(L, -1)) {
+		if (lua_type(L, -1) != LUA_TNUMBER ||
+		    lua_tonumber(L, -1) < min ||
+		    lua_tonumber(L, -1) > UINT32_MAX)
+			luaL_error(L, "%s must be a number >= %d", name, min);
+		value = lua_tointeger(L, -1);
+	}
+	lua_pop(L, 1);
+	return value;
+}
+
+/**
+ * box.csv_load(space_id, path[, opts]) loads a CSV file into
+ * a space and returns the number of inserted rows. Options:
+ * delimiter, quote_char, skip_head_lines, batch_size.
+ */
+static int
+lbox_csv_load(struct lua_State *L)
+{
+	static const char usage[] = "box.csv_load(space_id, path[, opts])";
+	int top = lua_gettop(L);
+	if (top < 2 || top > 3 || lua_type(L, 1) != LUA_TNUMBER ||
+	    lua_type(L, 2) != LUA_TSTRING ||
+	    (top == 3 && !lua_isnil(L, 3) && !lua_istable(L, 3)))
+		return luaL_error(L, "usage: %s", usage);
+	struct csv_load_opts opts;
+	csv_load_opts_create(&opts);
+	if (top == 3 && lua_istable(L, 3)) {
+		opts.delimiter = luaT_csv_load_char_opt(L, 3, "delimiter",
+							opts.delimiter);
+		opts.quote_char = luaT_csv_load_char_opt(L, 3, "quote_char",
+							 opts.quote_char);
+		opts.skip_head_lines = luaT_csv_load_uint_opt(
+			L, 3, "skip_head_lines", opts.skip_head_lines, 0);
+		opts.batch_size = luaT_csv_load_uint_opt(
+			L, 3, "batch_size", opts.batch_size, 1);
+	}
+	uint64_t count;
+	if (csv_load(lua_tointeger(L, 1), lua_tostring(L, 2), &opts,
+		     &count) != 0)
+		return luaT_error(L);
+	luaL_pushuint64(L, count);
+	return 1;
+}
+
+void
+box_lua_csv_load_init(struct lua_State *L)
+{
+	static const struct luaL_Reg csv_load_lib[] = {
+		{"csv_load", lbox_csv_load},
+		{NULL, NULL}
+	};
+	luaL_register(L, "box", csv_load_lib);
+	lua_pop(L, 1);
+}
@@ -41,6 +41,7 @@
 
 #include "box/box.h"
 #include "box/schema.h"
+#include "box/xlog.h"
 
 static int
 lbox_ctl_wait_ro(struct lua_State *L)
@@ -86,12 +87,30 @@ lbox_ctl_clear_synchro_queue(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_ctl_train_xlog_dict(struct lua_State *L)
+{
+	size_t size = XLOG_DICT_SIZE_DEFAULT;
+	if (lua_gettop(L) > 0 && !lua_isnil(L, 1)) {
+		lua_Integer n = luaL_checkinteger(L, 1);
+		if (n <= 0)
+			return luaL_error(L, "dictionary size must be positive");
+		size = n;
+	}
+	uint32_t id;
+	if (box_train_xlog_dict(size, &id) != 0)
+		return luaT_error(L);
+	lua_pushinteger(L, id);
+	return 1;
+}
+
 static const struct luaL_Reg lbox_ctl_lib[] = {
 	{"wait_ro", lbox_ctl_wait_ro},
 	{"wait_rw", lbox_ctl_wait_rw},
 	{"on_shutdown", lbox_ctl_on_shutdown},
 	{"on_schema_init", lbox_ctl_on_schema_init},
 	{"clear_synchro_queue", lbox_ctl_clear_synchro_queue},
+	{"train_xlog_dict", lbox_ctl_train_xlog_dict},
 	{NULL, NULL}
 };
 
@@ -0,0 +1,405 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/func_worker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+#include "cbus.h"
+#include "diag.h"
+#include "fiber.h"
+#include "tt_pthread.h"
+#include "msgpuck.h"
+#include "mpstream/mpstream.h"
+#include "lua/msgpack.h"
+#include "lua/utils.h"
+
+#include "box/func.h"
+#include "box/port.h"
+
+/** A worker thread executing parallel functions. */
+struct func_worker {
+	/** The worker thread. */
+	struct cord cord;
+	/** Pipe from the tx thread to the worker. */
+	struct cpipe worker_pipe;
+	/** Pipe from the worker to the tx thread. */
+	struct cpipe tx_pipe;
+	/** Lua state used by the worker only. */
+	struct lua_State *L;
+	/**
+	 * Reference to a table mapping function bodies to
+	 * functions compiled in the worker Lua state.
+	 */
+	int cache_ref;
+	/** Number of calls sent to the worker, tx thread only. */
+	int load;
+};
+
+/** Pool of worker threads. */
+static struct {
+	/** Worker threads, started on demand. */
+	struct func_worker *pool;
+	/** Max number of threads in the pool. */
+	int pool_size;
+	/** Number of started threads. */
+	int started;
+} workers;
+
+/**
+ * Globals available to parallel functions. The same as the
+ * sandbox of persistent functions in the tx thread, except
+ * utf8, which isn't available in a plain Lua state.
+ */
+static const char *func_worker_exports[] = {
+	"assert", "error", "ipairs", "math", "next", "pairs", "pcall", "print",
+	"select", "string", "table", "tonumber", "tostring", "type", "unpack",
+	"xpcall",
+};
+
+/** A growing malloc'ed buffer for return values. */
+struct func_worker_buf {
+	char *data;
+	size_t used;
+	size_t capacity;
+};
+
+/** Cbus message for a parallel function call. */
+struct func_worker_call_msg {
+	/** Parent. */
+	struct cbus_call_msg base;
+	/** Worker executing the call. */
+	struct func_worker *worker;
+	/** Function body. */
+	const char *body;
+	/** Arguments, a MessagePack array. */
+	const char *args;
+	/** Encoded return values. */
+	struct func_worker_buf ret;
+	/** Number of return values. */
+	uint32_t ret_count;
+};
+
+static void *
+func_worker_buf_reserve(void *ctx, size_t *size)
+{
+	struct func_worker_buf *buf = ctx;
+	if (buf->used + *size > buf->capacity) {
+		size_t capacity = MAX(buf->capacity * 2, buf->used + *size);
+		capacity = MAX(capacity, 256);
+		char *data = realloc(buf->data, capacity);
+		if (data == NULL) {
+			diag_set(OutOfMemory, capacity, "realloc",
+				 "return values");
+			return NULL;
+		}
+		buf->data = data;
+		buf->capacity = capacity;
+	}
+	*size = buf->capacity - buf->used;
+	return buf->data + buf->used;
+}
+
+static void *
+func_worker_buf_alloc(void *ctx, size_t size)
+{
+	struct func_worker_buf *buf = ctx;
+	size_t reserved = size;
+	char *data = func_worker_buf_reserve(buf, &reserved);
+	if (data == NULL)
+		return NULL;
+	buf->used += size;
+	return data;
+}
+
+/**
+ * Push a sandbox for a parallel function. Library tables are
+ * copied, so that functions can't change them for each other.
+ */
+static void
+func_worker_push_sandbox(struct lua_State *L)
+{
+	lua_createtable(L, 0, nelem(func_worker_exports));
+	for (unsigned i = 0; i < nelem(func_worker_exports); i++) {
+		lua_getglobal(L, func_worker_exports[i]);
+		if (lua_istable(L, -1)) {
+			lua_newtable(L);
+			lua_pushnil(L);
+			while (lua_next(L, -3) != 0) {
+				lua_pushvalue(L, -2);
+				lua_insert(L, -2);
+				lua_settable(L, -4);
+			}
+			lua_remove(L, -2);
+		}
+		lua_setfield(L, -2, func_worker_exports[i]);
+	}
+}
+
+/**
+ * Push a function compiled from the given body, loading it
+ * on the first call.
+ */
+static void
+func_worker_push_func(struct lua_State *L, struct func_worker *worker,
+		      const char *body)
+{
+	lua_rawgeti(L, LUA_REGISTRYINDEX, worker->cache_ref);
+	lua_getfield(L, -1, body);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_pushfstring(L, "return %s", body);
+		if (luaL_loadstring(L, lua_tostring(L, -1)) != 0)
+			lua_error(L);
+		lua_remove(L, -2);
+		func_worker_push_sandbox(L);
+		lua_pushvalue(L, -1);
+		lua_setfenv(L, -3);
+		lua_insert(L, -2);
+		lua_call(L, 0, 1);
+		if (!lua_isfunction(L, -1))
+			luaL_error(L, "given body doesn't define a function");
+		lua_insert(L, -2);
+		lua_setfenv(L, -2);
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -3, body);
+	}
+	lua_remove(L, -2);
+}
+
+/** Execute a call in the worker Lua state, used with lua_cpcall(). */
+static int
+func_worker_execute(struct lua_State *L)
+{
+	struct func_worker_call_msg *msg = lua_touserdata(L, 1);
+	lua_settop(L, 0);
+	func_worker_push_func(L, msg->worker, msg->body);
+
+	const char *args = msg->args;
+	uint32_t arg_count = mp_decode_array(&args);
+	luaL_checkstack(L, arg_count, "too many arguments");
+	for (uint32_t i = 0; i < arg_count; i++)
+		luamp_decode(L, luaL_msgpack_default, &args);
+	lua_call(L, arg_count, LUA_MULTRET);
+
+	struct mpstream stream;
+	mpstream_init(&stream, &msg->ret, func_worker_buf_reserve,
+		      func_worker_buf_alloc, luamp_error, L);
+	int count = lua_gettop(L);
+	for (int i = 1; i <= count; i++)
+		luamp_encode(L, luaL_msgpack_default, NULL, &stream, i);
+	mpstream_flush(&stream);
+	msg->ret_count = count;
+	return 0;
+}
+
+/** Execute a call on behalf of a worker thread. */
+static int
+func_worker_call_f(struct cbus_call_msg *base)
+{
+	struct func_worker_call_msg *msg = (struct func_worker_call_msg *)base;
+	struct lua_State *L = msg->worker->L;
+	int rc = 0;
+	if (lua_cpcall(L, func_worker_execute, msg) != 0) {
+		diag_set(LuajitError, lua_tostring(L, -1));
+		rc = -1;
+	}
+	lua_settop(L, 0);
+	return rc;
+}
+
+/** Worker thread function. */
+static int
+func_worker_f(va_list ap)
+{
+	struct func_worker *worker = va_arg(ap, struct func_worker *);
+	struct cbus_endpoint endpoint;
+
+	cpipe_create(&worker->tx_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&worker->tx_pipe);
+	return 0;
+}
+
+/** Start a worker thread. Returns -1 and sets diag on error. */
+static int
+func_worker_start(struct func_worker *worker, int id)
+{
+	worker->L = luaL_newstate();
+	if (worker->L == NULL) {
+		diag_set(OutOfMemory, 0, "luaL_newstate", "lua_State");
+		return -1;
+	}
+	luaL_openlibs(worker->L);
+	lua_newtable(worker->L);
+	worker->cache_ref = luaL_ref(worker->L, LUA_REGISTRYINDEX);
+	worker->load = 0;
+
+	char name[FIBER_NAME_MAX];
+	snprintf(name, sizeof(name), "func.%d", id);
+	if (cord_costart(&worker->cord, name, func_worker_f, worker) != 0) {
+		lua_close(worker->L);
+		worker->L = NULL;
+		return -1;
+	}
+	cpipe_create(&worker->worker_pipe, name);
+	return 0;
+}
+
+/**
+ * Pick the least loaded worker thread. Another thread is
+ * started if all started ones are busy and the pool isn't
+ * full yet. Returns NULL and sets diag on failure.
+ */
+static struct func_worker *
+func_worker_get(void)
+{
+	assert(workers.pool_size > 0);
+	if (workers.pool == NULL) {
+		workers.pool = calloc(workers.pool_size,
+				      sizeof(*workers.pool));
+		if (workers.pool == NULL) {
+			diag_set(OutOfMemory,
+				 workers.pool_size * sizeof(*workers.pool),
+				 "calloc", "struct func_worker");
+			return NULL;
+		}
+	}
+	struct func_worker *best = NULL;
+	for (int i = 0; i < workers.started; i++) {
+		struct func_worker *worker = &workers.pool[i];
+		if (best == NULL || worker->load < best->load)
+			best = worker;
+	}
+	if (best != NULL &&
+	    (best->load == 0 || workers.started == workers.pool_size))
+		return best;
+	struct func_worker *worker = &workers.pool[workers.started];
+	if (func_worker_start(worker, workers.started) != 0) {
+		if (best == NULL)
+			return NULL;
+		diag_log();
+		return best;
+	}
+	workers.started++;
+	return worker;
+}
+
+int
+func_worker_call(struct func *func, struct port *args, struct port *ret)
+{
+	assert(func->def->language == FUNC_LANGUAGE_LUA);
+	assert(func->def->body != NULL && func->def->opts.is_parallel);
+	struct func_worker *worker = func_worker_get();
+	if (worker == NULL)
+		return -1;
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t args_size;
+	const char *args_data = port_get_msgpack(args, &args_size);
+	if (args_data == NULL)
+		return -1;
+	/* The function may be dropped while the call is in progress. */
+	size_t body_size = strlen(func->def->body) + 1;
+	char *body = region_alloc(region, body_size);
+	if (body == NULL) {
+		diag_set(OutOfMemory, body_size, "region", "body");
+		region_truncate(region, region_svp);
+		return -1;
+	}
+	memcpy(body, func->def->body, body_size);
+
+	struct func_worker_call_msg msg;
+	msg.worker = worker;
+	msg.body = body;
+	msg.args = args_data;
+	memset(&msg.ret, 0, sizeof(msg.ret));
+	msg.ret_count = 0;
+	/*
+	 * The message lives on the stack so the fiber can't
+	 * leave until the worker thread is done with it.
+	 */
+	worker->load++;
+	bool cancellable = fiber_set_cancellable(false);
+	int rc = cbus_call(&worker->worker_pipe, &worker->tx_pipe,
+			   &msg.base, func_worker_call_f, NULL,
+			   TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+	worker->load--;
+	region_truncate(region, region_svp);
+	if (rc != 0)
+		goto out;
+
+	port_c_create(ret);
+	const char *data = msg.ret.data;
+	for (uint32_t i = 0; i < msg.ret_count; i++) {
+		const char *end = data;
+		mp_next(&end);
+		if (port_c_add_mp(ret, data, end) != 0) {
+			port_destroy(ret);
+			rc = -1;
+			break;
+		}
+		data = end;
+	}
+out:
+	free(msg.ret.data);
+	return rc;
+}
+
+void
+func_worker_init(int threads)
+{
+	assert(threads > 0);
+	workers.pool_size = threads;
+}
+
+void
+func_worker_free(void)
+{
+	for (int i = 0; i < workers.started; i++) {
+		struct func_worker *worker = &workers.pool[i];
+		tt_pthread_cancel(worker->cord.id);
+		tt_pthread_join(worker->cord.id, NULL);
+		lua_close(worker->L);
+	}
+	free(workers.pool);
+	memset(&workers, 0, sizeof(workers));
+}
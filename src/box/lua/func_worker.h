@@ -0,0 +1,79 @@
+#ifndef INCLUDES_TARANTOOL_BOX_LUA_FUNC_WORKER_H
+#define INCLUDES_TARANTOOL_BOX_LUA_FUNC_WORKER_H
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct func;
+struct port;
+
+/**
+ * Parallel functions.
+ *
+ * A persistent sandboxed Lua function created with the
+ * is_parallel option doesn't access the database, so it may
+ * run outside the tx thread. Such functions are executed in a
+ * pool of worker threads, each with its own Lua state, where
+ * the function body is compiled on the first call. Arguments
+ * and return values are passed as MessagePack.
+ *
+ * The calling fiber yields until the function returns, while
+ * other tx fibers keep running, so CPU-heavy functions don't
+ * stall the tx thread and may use several cores.
+ */
+
+/**
+ * Call a parallel function in a worker thread. Return values
+ * are stored in @a ret, which is a C port. Returns -1 and sets
+ * diag on error.
+ */
+int
+func_worker_call(struct func *func, struct port *args, struct port *ret);
+
+/**
+ * Initialize the pool of worker threads. Threads are started
+ * on demand.
+ */
+void
+func_worker_init(int threads);
+
+/** Stop worker threads. */
+void
+func_worker_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* INCLUDES_TARANTOOL_BOX_LUA_FUNC_WORKER_H */
@@ -0,0 +1,965 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/httpd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <small/ibuf.h>
+#include <small/rlist.h>
+
+#include "cbus.h"
+#include "coio.h"
+#include "diag.h"
+#include "evio.h"
+#include "fiber.h"
+#include "fiber_cond.h"
+#include "say.h"
+#include "sio.h"
+#include "http_parser/http_parser.h"
+#include "lua/utils.h"
+
+#include "box/box.h"
+
+enum {
+	/** Max size of a request line with headers. */
+	HTTPD_HEAD_MAX = 8192,
+	/** Max number of headers in a request. */
+	HTTPD_HEADERS_MAX = 64,
+	/** Size of a single read from a socket. */
+	HTTPD_READAHEAD = 16320,
+};
+
+/** Default max size of a request body. */
+static const size_t HTTPD_MAX_BODY_SIZE_DEFAULT = 1024 * 1024;
+/** Default time to wait for a client to send or receive data. */
+static const double HTTPD_IDLE_TIMEOUT_DEFAULT = 60;
+
+static const char httpd_server_typename[] = "box.httpd.server";
+
+/**
+ * An HTTP server. Connections are accepted and requests are
+ * parsed in a separate thread, handlers are run in the tx
+ * thread by the fiber pool, the same way iproto does it.
+ */
+struct httpd_server {
+	/** The server thread. */
+	struct cord cord;
+	/** Thread and cbus endpoint name. */
+	char name[FIBER_NAME_MAX];
+	/** Pipe from the tx thread to the server thread. */
+	struct cpipe httpd_pipe;
+	/** Pipe from the server thread to the tx fiber pool. */
+	struct cpipe tx_pipe;
+	/** Pipe from the server thread to the tx_prio endpoint. */
+	struct cpipe tx_prio_pipe;
+	/** Acceptor, server thread only. */
+	struct evio_service service;
+	/** Bound address, set once the server is listening. */
+	char listen[SERVICE_NAME_MAXLEN];
+	/** Fiber running the server thread cbus loop. */
+	struct fiber *main_fiber;
+	/** Open connections, server thread only. */
+	struct rlist connections;
+	/** Set when the server thread is asked to stop. */
+	bool is_stopping;
+	/** Tells the server thread to stop. */
+	struct cmsg stop_msg;
+	/** Tells the tx thread that the server thread is done. */
+	struct cmsg stopped_msg;
+	/** Signaled on stopped_msg, tx thread only. */
+	struct fiber_cond stopped_cond;
+	/** Set on stopped_msg, tx thread only. */
+	bool is_stopped;
+	/** True between a start and a stop, tx thread only. */
+	bool is_running;
+	/** Requests being handled, tx thread only. */
+	struct rlist requests;
+	/** Number of handled requests, tx thread only. */
+	uint64_t request_count;
+	/** Reference to the Lua handler. */
+	int handler_ref;
+	/** Reference to the Lua object, held while running. */
+	int self_ref;
+	/** Time to wait for a client to send or receive data. */
+	double idle_timeout;
+	/** Max size of a request body. */
+	size_t max_body_size;
+};
+
+/** A request header, the name is lowercased. */
+struct httpd_header {
+	const char *name;
+	int name_len;
+	const char *value;
+	int value_len;
+};
+
+/** A request parsed in the server thread. */
+struct httpd_request {
+	const char *method;
+	int method_len;
+	/** Path with an optional query, e.g. "/path?a=b". */
+	const char *target;
+	int target_len;
+	int http_major;
+	int http_minor;
+	struct httpd_header headers[HTTPD_HEADERS_MAX];
+	int header_count;
+	const char *body;
+	size_t body_len;
+	/** Set if the client waits for 100 Continue. */
+	bool expect_continue;
+	/** Set if the connection is kept after the response. */
+	bool keep_alive;
+	/** Size of the request in the input buffer. */
+	size_t size;
+};
+
+/** A connection, lives on the stack of its fiber. */
+struct httpd_connection {
+	struct fiber *fiber;
+	/** Set while a request is handled in the tx thread. */
+	bool is_processing;
+	/** Link in httpd_server::connections. */
+	struct rlist in_server;
+};
+
+/** Cbus message to start listening on a URI. */
+struct httpd_listen_msg {
+	struct cbus_call_msg base;
+	struct httpd_server *srv;
+	const char *uri;
+};
+
+/** Cbus message passing a request to the tx thread. */
+struct httpd_process_msg {
+	struct cbus_call_msg base;
+	struct httpd_server *srv;
+	const struct httpd_request *request;
+	/** Encoded response, malloc'ed in the tx thread. */
+	char *response;
+	size_t response_size;
+	/** Fiber running the handler, tx thread only. */
+	struct fiber *fiber;
+	/** Link in httpd_server::requests. */
+	struct rlist in_server;
+};
+
+static int httpd_server_count;
+
+static const char *
+httpd_reason(int status)
+{
+	switch (status) {
+	case 200: return "OK";
+	case 201: return "Created";
+	case 202: return "Accepted";
+	case 204: return "No Content";
+	case 206: return "Partial Content";
+	case 301: return "Moved Permanently";
+	case 302: return "Found";
+	case 303: return "See Other";
+	case 304: return "Not Modified";
+	case 307: return "Temporary Redirect";
+	case 308: return "Permanent Redirect";
+	case 400: return "Bad Request";
+	case 401: return "Unauthorized";
+	case 403: return "Forbidden";
+	case 404: return "Not Found";
+	case 405: return "Method Not Allowed";
+	case 409: return "Conflict";
+	case 413: return "Content Too Large";
+	case 429: return "Too Many Requests";
+	case 431: return "Request Header Fields Too Large";
+	case 500: return "Internal Server Error";
+	case 501: return "Not Implemented";
+	case 502: return "Bad Gateway";
+	case 503: return "Service Unavailable";
+	case 504: return "Gateway Timeout";
+	case 505: return "HTTP Version Not Supported";
+	default: return "Unknown";
+	}
+}
+
+static bool
+httpd_header_is(const struct httpd_header *header, const char *name)
+{
+	return header->name_len == (int)strlen(name) &&
+	       memcmp(header->name, name, header->name_len) == 0;
+}
+
+static bool
+httpd_value_is(const struct httpd_header *header, const char *value)
+{
+	return header->value_len == (int)strlen(value) &&
+	       strncasecmp(header->value, value, header->value_len) == 0;
+}
+
+/**
+ * Return the size of a request head starting at @a start, or 0
+ * if the empty line ending the head hasn't been read yet.
+ */
+static size_t
+httpd_head_size(const char *start, const char *end)
+{
+	const char *p = start;
+	while ((p = memchr(p, '\n', end - p)) != NULL) {
+		p++;
+		if (p < end && *p == '\r')
+			p++;
+		if (p == end)
+			break;
+		if (*p == '\n')
+			return p + 1 - start;
+	}
+	return 0;
+}
+
+/**
+ * Parse a request head ending at @a end. Returns 0 on success,
+ * otherwise an HTTP status to reply with.
+ */
+static int
+httpd_parse_head(struct httpd_request *req, char *pos, char *end)
+{
+	struct http_parser parser;
+	http_parser_create(&parser);
+	char *method, *target;
+	if (http_parse_request_line(&parser, &pos, end, &method,
+				    &req->method_len, &target,
+				    &req->target_len) != HTTP_PARSE_OK)
+		return 400;
+	if (parser.http_major != 1)
+		return 505;
+	req->method = method;
+	req->target = target;
+	req->http_major = parser.http_major;
+	req->http_minor = parser.http_minor;
+	req->header_count = 0;
+	req->body_len = 0;
+	req->expect_continue = false;
+	req->keep_alive = parser.http_minor > 0;
+	while (true) {
+		/*
+		 * Header names are lowercased in place: the parser
+		 * never writes a name character ahead of the one
+		 * it reads.
+		 */
+		char *name = pos;
+		parser.hdr_name = name;
+		int rc = http_parse_header_line(&parser, &pos, end,
+						HTTPD_HEAD_MAX);
+		if (rc == HTTP_PARSE_DONE)
+			break;
+		if (rc != HTTP_PARSE_OK || parser.hdr_name_idx == 0)
+			return 400;
+		if (req->header_count == HTTPD_HEADERS_MAX)
+			return 431;
+		struct httpd_header *h = &req->headers[req->header_count++];
+		h->name = name;
+		h->name_len = parser.hdr_name_idx;
+		h->value = parser.hdr_value_start;
+		h->value_len = parser.hdr_value_end - parser.hdr_value_start;
+		if (httpd_header_is(h, "content-length")) {
+			if (h->value_len == 0)
+				return 400;
+			size_t len = 0;
+			for (int i = 0; i < h->value_len; i++) {
+				if (h->value[i] < '0' || h->value[i] > '9')
+					return 400;
+				if (len > (SIZE_MAX - 9) / 10)
+					return 413;
+				len = len * 10 + h->value[i] - '0';
+			}
+			req->body_len = len;
+		} else if (httpd_header_is(h, "transfer-encoding")) {
+			return 501;
+		} else if (httpd_header_is(h, "connection")) {
+			if (httpd_value_is(h, "close"))
+				req->keep_alive = false;
+			else if (httpd_value_is(h, "keep-alive"))
+				req->keep_alive = true;
+		} else if (httpd_header_is(h, "expect")) {
+			req->expect_continue = httpd_value_is(h,
+							      "100-continue");
+		}
+	}
+	return 0;
+}
+
+/** Rebase a parsed request after the input buffer was moved. */
+static void
+httpd_request_move(struct httpd_request *req, ptrdiff_t delta)
+{
+	req->method += delta;
+	req->target += delta;
+	for (int i = 0; i < req->header_count; i++) {
+		req->headers[i].name += delta;
+		req->headers[i].value += delta;
+	}
+}
+
+/** Read more data into the unused space of the input buffer. */
+static int
+httpd_read(struct httpd_server *srv, struct ev_io *io, struct ibuf *in)
+{
+	ssize_t n = coio_read_ahead_timeout_noxc(io, in->wpos, 1,
+						 ibuf_unused(in),
+						 srv->idle_timeout);
+	if (n <= 0)
+		return -1;
+	in->wpos += n;
+	return 0;
+}
+
+/**
+ * Read a request into the input buffer. Returns 0 if the request
+ * is read, -1 if the connection must be closed silently, or an
+ * HTTP status to reply with before closing the connection.
+ */
+static int
+httpd_read_request(struct httpd_server *srv, struct ev_io *io,
+		   struct ibuf *in, struct httpd_request *req)
+{
+	size_t head_size;
+	while (true) {
+		/* Empty lines before a request must be ignored. */
+		while (in->rpos < in->wpos &&
+		       (*in->rpos == '\r' || *in->rpos == '\n'))
+			in->rpos++;
+		head_size = httpd_head_size(in->rpos, in->wpos);
+		if (head_size > HTTPD_HEAD_MAX ||
+		    (head_size == 0 && ibuf_used(in) >= HTTPD_HEAD_MAX))
+			return 431;
+		if (head_size > 0)
+			break;
+		if (ibuf_reserve(in, HTTPD_READAHEAD) == NULL) {
+			diag_log();
+			return -1;
+		}
+		if (httpd_read(srv, io, in) != 0)
+			return -1;
+	}
+	int status = httpd_parse_head(req, in->rpos, in->rpos + head_size);
+	if (status != 0)
+		return status;
+	if (req->body_len > srv->max_body_size)
+		return 413;
+	req->size = head_size + req->body_len;
+	if (ibuf_used(in) < req->size) {
+		static const char continue_msg[] = "HTTP/1.1 100 Continue\r\n\r\n";
+		if (req->expect_continue &&
+		    coio_write_timeout_noxc(io, continue_msg,
+					    strlen(continue_msg),
+					    srv->idle_timeout) < 0)
+			return -1;
+		const char *rpos = in->rpos;
+		if (ibuf_reserve(in, req->size - ibuf_used(in)) == NULL) {
+			diag_log();
+			return 500;
+		}
+		httpd_request_move(req, in->rpos - rpos);
+		while (ibuf_used(in) < req->size) {
+			if (httpd_read(srv, io, in) != 0)
+				return -1;
+		}
+	}
+	req->body = in->rpos + head_size;
+	return 0;
+}
+
+/** Write a response with an empty body. */
+static int
+httpd_write_status(struct httpd_server *srv, struct ev_io *io, int status,
+		   bool keep_alive)
+{
+	char buf[128];
+	int len = snprintf(buf, sizeof(buf), "HTTP/1.1 %d %s\r\n"
+			   "Content-Length: 0\r\nConnection: %s\r\n\r\n",
+			   status, httpd_reason(status),
+			   keep_alive ? "keep-alive" : "close");
+	if (coio_write_timeout_noxc(io, buf, len, srv->idle_timeout) < 0)
+		return -1;
+	return 0;
+}
+
+/** Push a request table for a Lua handler. */
+static void
+httpd_push_request(struct lua_State *L, const struct httpd_request *req)
+{
+	lua_createtable(L, 0, 6);
+	lua_pushlstring(L, req->method, req->method_len);
+	lua_setfield(L, -2, "method");
+	const char *query = memchr(req->target, '?', req->target_len);
+	const char *target_end = req->target + req->target_len;
+	lua_pushlstring(L, req->target,
+			(query != NULL ? query : target_end) - req->target);
+	lua_setfield(L, -2, "path");
+	if (query != NULL) {
+		lua_pushlstring(L, query + 1, target_end - query - 1);
+		lua_setfield(L, -2, "query");
+	}
+	lua_createtable(L, 2, 0);
+	lua_pushinteger(L, req->http_major);
+	lua_rawseti(L, -2, 1);
+	lua_pushinteger(L, req->http_minor);
+	lua_rawseti(L, -2, 2);
+	lua_setfield(L, -2, "proto");
+	lua_createtable(L, 0, req->header_count);
+	for (int i = 0; i < req->header_count; i++) {
+		const struct httpd_header *h = &req->headers[i];
+		lua_pushlstring(L, h->name, h->name_len);
+		lua_pushvalue(L, -1);
+		lua_rawget(L, -3);
+		/* Repeated headers are joined with commas. */
+		if (lua_isnil(L, -1)) {
+			lua_pop(L, 1);
+			lua_pushlstring(L, h->value, h->value_len);
+		} else {
+			lua_pushliteral(L, ",");
+			lua_pushlstring(L, h->value, h->value_len);
+			lua_concat(L, 3);
+		}
+		lua_rawset(L, -3);
+	}
+	lua_setfield(L, -2, "headers");
+	lua_pushlstring(L, req->body, req->body_len);
+	lua_setfield(L, -2, "body");
+}
+
+/**
+ * Encode a value returned by a Lua handler into a response:
+ * either a body string or a table {status, headers, body}.
+ */
+static void
+httpd_encode_response(struct lua_State *L, struct httpd_process_msg *msg)
+{
+	const struct httpd_request *req = msg->request;
+	int ret = lua_gettop(L);
+	int status = 200;
+	int headers = 0;
+	int body = ret;
+	if (lua_istable(L, ret)) {
+		lua_getfield(L, ret, "status");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TNUMBER)
+				luaL_error(L, "HTTP status must be a number");
+			status = lua_tointeger(L, -1);
+			if (status < 200 || status > 599)
+				luaL_error(L, "invalid HTTP status %d", status);
+		}
+		lua_getfield(L, ret, "headers");
+		if (!lua_isnil(L, -1)) {
+			if (!lua_istable(L, -1))
+				luaL_error(L, "HTTP headers must be a table");
+			headers = lua_gettop(L);
+		}
+		lua_getfield(L, ret, "body");
+		if (lua_isnil(L, -1)) {
+			lua_pop(L, 1);
+			lua_pushliteral(L, "");
+		} else if (lua_type(L, -1) != LUA_TSTRING) {
+			luaL_error(L, "HTTP body must be a string");
+		}
+		body = lua_gettop(L);
+	} else if (lua_type(L, ret) != LUA_TSTRING) {
+		luaL_error(L, "HTTP handler must return a string or a table");
+	}
+	bool has_body = status != 204 && status != 304;
+	lua_pushfstring(L, "HTTP/1.1 %d %s\r\n", status, httpd_reason(status));
+	int count = 1;
+	if (headers != 0) {
+		lua_pushnil(L);
+		while (lua_next(L, headers) != 0) {
+			if (lua_type(L, -2) != LUA_TSTRING ||
+			    (lua_type(L, -1) != LUA_TSTRING &&
+			     lua_type(L, -1) != LUA_TNUMBER))
+				luaL_error(L, "HTTP headers must be strings");
+			const char *name = lua_tostring(L, -2);
+			const char *value = lua_tostring(L, -1);
+			/* These headers are set by the server. */
+			if (strcasecmp(name, "content-length") == 0 ||
+			    strcasecmp(name, "connection") == 0 ||
+			    strcasecmp(name, "transfer-encoding") == 0) {
+				lua_pop(L, 1);
+				continue;
+			}
+			if (strpbrk(name, "\r\n:") != NULL ||
+			    strpbrk(value, "\r\n") != NULL)
+				luaL_error(L, "invalid HTTP header '%s'", name);
+			luaL_checkstack(L, 2, "too many HTTP headers");
+			lua_pushfstring(L, "%s: %s\r\n", name, value);
+			lua_replace(L, -2);
+			lua_insert(L, -2);
+			count++;
+		}
+	}
+	size_t body_len;
+	lua_tolstring(L, body, &body_len);
+	if (has_body) {
+		char len_str[32];
+		snprintf(len_str, sizeof(len_str), "%zu", body_len);
+		lua_pushfstring(L, "Content-Length: %s\r\n", len_str);
+		count++;
+	}
+	lua_pushfstring(L, "Connection: %s\r\n\r\n",
+			req->keep_alive ? "keep-alive" : "close");
+	count++;
+	bool is_head = req->method_len == 4 &&
+		       memcmp(req->method, "HEAD", 4) == 0;
+	if (has_body && !is_head) {
+		lua_pushvalue(L, body);
+		count++;
+	}
+	lua_concat(L, count);
+	size_t size;
+	const char *response = lua_tolstring(L, -1, &size);
+	msg->response = malloc(size);
+	if (msg->response == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "response");
+		luaT_error(L);
+	}
+	memcpy(msg->response, response, size);
+	msg->response_size = size;
+}
+
+/** Run a Lua handler, used with luaT_cpcall(). */
+static int
+httpd_handle_request(struct lua_State *L)
+{
+	struct httpd_process_msg *msg = lua_touserdata(L, 1);
+	lua_settop(L, 0);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, msg->srv->handler_ref);
+	httpd_push_request(L, msg->request);
+	lua_call(L, 1, 1);
+	httpd_encode_response(L, msg);
+	return 0;
+}
+
+/**
+ * Handle a request in the tx thread. A handler error is logged
+ * and the response is left empty, so that the server thread
+ * replies with 500.
+ */
+static int
+httpd_process_f(struct cbus_call_msg *base)
+{
+	struct httpd_process_msg *msg = (struct httpd_process_msg *)base;
+	struct httpd_server *srv = msg->srv;
+	struct lua_State *L = luaT_newthread(tarantool_L);
+	if (L == NULL)
+		return -1;
+	int coro_ref = luaL_ref(tarantool_L, LUA_REGISTRYINDEX);
+	msg->fiber = fiber();
+	rlist_add_entry(&srv->requests, msg, in_server);
+	srv->request_count++;
+	if (luaT_cpcall(L, httpd_handle_request, msg) != 0) {
+		diag_log();
+		free(msg->response);
+		msg->response = NULL;
+	}
+	rlist_del_entry(msg, in_server);
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, coro_ref);
+	return 0;
+}
+
+/** Pass a request to the tx thread and write the response. */
+static int
+httpd_process_request(struct httpd_server *srv, struct ev_io *io,
+		      const struct httpd_request *req)
+{
+	struct httpd_process_msg msg;
+	msg.srv = srv;
+	msg.request = req;
+	msg.response = NULL;
+	msg.response_size = 0;
+	/* The message and the request live on the stack. */
+	bool cancellable = fiber_set_cancellable(false);
+	int rc = cbus_call(&srv->tx_pipe, &srv->httpd_pipe, &msg.base,
+			   httpd_process_f, NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+	if (rc != 0)
+		diag_log();
+	if (msg.response == NULL)
+		return httpd_write_status(srv, io, 500, req->keep_alive);
+	rc = 0;
+	if (coio_write_timeout_noxc(io, msg.response, msg.response_size,
+				    srv->idle_timeout) < 0)
+		rc = -1;
+	free(msg.response);
+	return rc;
+}
+
+static int
+httpd_connection_f(va_list ap)
+{
+	struct httpd_server *srv = va_arg(ap, struct httpd_server *);
+	int fd = va_arg(ap, int);
+	struct httpd_connection conn;
+	conn.fiber = fiber();
+	conn.is_processing = false;
+	rlist_add_entry(&srv->connections, &conn, in_server);
+	struct ev_io io;
+	coio_create(&io, fd);
+	struct ibuf in;
+	ibuf_create(&in, cord_slab_cache(), HTTPD_READAHEAD);
+	struct httpd_request req;
+	/* Pipelined requests are handled one by one. */
+	while (!srv->is_stopping) {
+		int status = httpd_read_request(srv, &io, &in, &req);
+		if (status > 0)
+			httpd_write_status(srv, &io, status, false);
+		if (status != 0)
+			break;
+		conn.is_processing = true;
+		int rc = httpd_process_request(srv, &io, &req);
+		conn.is_processing = false;
+		if (rc != 0 || !req.keep_alive)
+			break;
+		in.rpos += req.size;
+		if (ibuf_used(&in) == 0)
+			ibuf_reset(&in);
+	}
+	ibuf_destroy(&in);
+	coio_close_io(loop(), &io);
+	rlist_del_entry(&conn, in_server);
+	if (srv->is_stopping && rlist_empty(&srv->connections))
+		fiber_wakeup(srv->main_fiber);
+	return 0;
+}
+
+static int
+httpd_on_accept(struct evio_service *service, int fd,
+		struct sockaddr *addr, socklen_t addrlen)
+{
+	struct httpd_server *srv = service->on_accept_param;
+	char name[SERVICE_NAME_MAXLEN];
+	snprintf(name, sizeof(name), "%s/%s", srv->name,
+		 sio_strfaddr(addr, addrlen));
+	struct fiber *f = fiber_new(name, httpd_connection_f);
+	if (f == NULL)
+		return -1;
+	fiber_start(f, srv, fd);
+	return 0;
+}
+
+static int
+httpd_listen_f(struct cbus_call_msg *base)
+{
+	struct httpd_listen_msg *msg = (struct httpd_listen_msg *)base;
+	struct httpd_server *srv = msg->srv;
+	if (evio_service_bind(&srv->service, msg->uri) != 0 ||
+	    evio_service_listen(&srv->service) != 0) {
+		evio_service_stop(&srv->service);
+		return -1;
+	}
+	snprintf(srv->listen, sizeof(srv->listen), "%s",
+		 sio_strfaddr(&srv->service.addr, srv->service.addr_len));
+	return 0;
+}
+
+/** Stop accepting and close connections, server thread. */
+static void
+httpd_stop_f(struct cmsg *msg)
+{
+	struct httpd_server *srv = container_of(msg, struct httpd_server,
+						stop_msg);
+	srv->is_stopping = true;
+	evio_service_stop(&srv->service);
+	/*
+	 * Idle connections are closed, the others are closed
+	 * once their responses are written.
+	 */
+	struct httpd_connection *conn;
+	rlist_foreach_entry(conn, &srv->connections, in_server) {
+		if (!conn->is_processing)
+			fiber_cancel(conn->fiber);
+	}
+}
+
+/** Wake up the fiber stopping the server, tx thread. */
+static void
+httpd_stopped_f(struct cmsg *msg)
+{
+	struct httpd_server *srv = container_of(msg, struct httpd_server,
+						stopped_msg);
+	srv->is_stopped = true;
+	fiber_cond_signal(&srv->stopped_cond);
+}
+
+/** Server thread function. */
+static int
+httpd_server_f(va_list ap)
+{
+	struct httpd_server *srv = va_arg(ap, struct httpd_server *);
+	struct cbus_endpoint endpoint;
+
+	srv->main_fiber = fiber();
+	evio_service_init(loop(), &srv->service, "httpd", httpd_on_accept,
+			  srv);
+	cpipe_create(&srv->tx_pipe, "tx");
+	cpipe_create(&srv->tx_prio_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, srv->name, fiber_schedule_cb,
+			     fiber());
+	while (true) {
+		cbus_process(&endpoint);
+		if (srv->is_stopping && rlist_empty(&srv->connections))
+			break;
+		fiber_yield();
+	}
+	static const struct cmsg_hop stopped_route[1] = {
+		{httpd_stopped_f, NULL}
+	};
+	cmsg_init(&srv->stopped_msg, stopped_route);
+	cpipe_push(&srv->tx_prio_pipe, &srv->stopped_msg);
+	cpipe_destroy(&srv->tx_pipe);
+	cpipe_destroy(&srv->tx_prio_pipe);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	return 0;
+}
+
+/** Stop the server thread and wait for it to exit. */
+static void
+httpd_server_stop(struct httpd_server *srv)
+{
+	assert(srv->is_running);
+	srv->is_running = false;
+	static const struct cmsg_hop stop_route[1] = {
+		{httpd_stop_f, NULL}
+	};
+	cmsg_init(&srv->stop_msg, stop_route);
+	cpipe_push(&srv->httpd_pipe, &srv->stop_msg);
+	bool cancellable = fiber_set_cancellable(false);
+	while (!srv->is_stopped)
+		fiber_cond_wait(&srv->stopped_cond);
+	fiber_set_cancellable(cancellable);
+	cpipe_destroy(&srv->httpd_pipe);
+	if (cord_cojoin(&srv->cord) != 0)
+		diag_log();
+}
+
+/**
+ * Start the server thread and listen on the given URI.
+ * Returns -1 and sets diag on error.
+ */
+static int
+httpd_server_start(struct httpd_server *srv, const char *uri)
+{
+	snprintf(srv->name, sizeof(srv->name), "httpd.%d",
+		 ++httpd_server_count);
+	if (cord_costart(&srv->cord, srv->name, httpd_server_f, srv) != 0)
+		return -1;
+	cpipe_create(&srv->httpd_pipe, srv->name);
+	srv->is_running = true;
+
+	struct httpd_listen_msg msg;
+	msg.srv = srv;
+	msg.uri = uri;
+	bool cancellable = fiber_set_cancellable(false);
+	int rc = cbus_call(&srv->httpd_pipe, &srv->tx_prio_pipe, &msg.base,
+			   httpd_listen_f, NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+	if (rc != 0) {
+		struct diag diag;
+		diag_create(&diag);
+		diag_move(diag_get(), &diag);
+		httpd_server_stop(srv);
+		diag_move(&diag, diag_get());
+		diag_destroy(&diag);
+		return -1;
+	}
+	return 0;
+}
+
+/** Check if the current fiber runs a handler of the server. */
+static bool
+httpd_server_is_handling(struct httpd_server *srv)
+{
+	struct httpd_process_msg *msg;
+	rlist_foreach_entry(msg, &srv->requests, in_server) {
+		if (msg->fiber == fiber())
+			return true;
+	}
+	return false;
+}
+
+static struct httpd_server *
+luaT_checkhttpdserver(struct lua_State *L, int idx, const char *usage)
+{
+	if (idx > lua_gettop(L))
+		luaL_error(L, "usage: %s", usage);
+	return *(struct httpd_server **)luaL_checkudata(L, idx,
+							httpd_server_typename);
+}
+
+/**
+ * box.httpd.new(uri, handler[, opts]) starts an HTTP/1.1
+ * server listening on the given URI. The handler is called
+ * with a request table {method, path, query, proto, headers,
+ * body} and returns either a body string or a table
+ * {status, headers, body}. Options: idle_timeout in seconds,
+ * max_body_size in bytes.
+ */
+static int
+lbox_httpd_new(struct lua_State *L)
+{
+	static const char usage[] = "box.httpd.new(uri, handler[, opts])";
+	int top = lua_gettop(L);
+	if (top < 2 || top > 3 || lua_type(L, 1) != LUA_TSTRING ||
+	    lua_type(L, 2) != LUA_TFUNCTION ||
+	    (top == 3 && !lua_isnil(L, 3) && !lua_istable(L, 3)))
+		return luaL_error(L, "usage: %s", usage);
+	if (!box_is_configured())
+		return luaL_error(L, "Please call box.cfg{} first");
+	double idle_timeout = HTTPD_IDLE_TIMEOUT_DEFAULT;
+	size_t max_body_size = HTTPD_MAX_BODY_SIZE_DEFAULT;
+	if (top == 3 && lua_istable(L, 3)) {
+		lua_getfield(L, 3, "idle_timeout");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TNUMBER ||
+			    lua_tonumber(L, -1) <= 0)
+				return luaL_error(L, "idle_timeout must be "
+						  "a positive number");
+			idle_timeout = lua_tonumber(L, -1);
+		}
+		lua_getfield(L, 3, "max_body_size");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TNUMBER ||
+			    lua_tonumber(L, -1) < 0)
+				return luaL_error(L, "max_body_size must be "
+						  "a non-negative number");
+			max_body_size = lua_tonumber(L, -1);
+		}
+		lua_pop(L, 2);
+	}
+	struct httpd_server *srv = calloc(1, sizeof(*srv));
+	if (srv == NULL) {
+		diag_set(OutOfMemory, sizeof(*srv), "calloc",
+			 "struct httpd_server");
+		return luaT_error(L);
+	}
+	rlist_create(&srv->connections);
+	rlist_create(&srv->requests);
+	fiber_cond_create(&srv->stopped_cond);
+	srv->idle_timeout = idle_timeout;
+	srv->max_body_size = max_body_size;
+	srv->self_ref = LUA_NOREF;
+	lua_pushvalue(L, 2);
+	srv->handler_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	struct httpd_server **ptr = lua_newuserdata(L, sizeof(*ptr));
+	*ptr = srv;
+	luaL_getmetatable(L, httpd_server_typename);
+	lua_setmetatable(L, -2);
+	if (httpd_server_start(srv, lua_tostring(L, 1)) != 0)
+		return luaT_error(L);
+	/* A running server must not be collected. */
+	lua_pushvalue(L, -1);
+	srv->self_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	return 1;
+}
+
+/**
+ * server:stop() stops accepting connections and waits until
+ * requests being handled are done. Other connections are
+ * closed.
+ */
+static int
+lbox_httpd_server_stop(struct lua_State *L)
+{
+	struct httpd_server *srv = luaT_checkhttpdserver(L, 1,
+							 "server:stop()");
+	if (!srv->is_running)
+		return 0;
+	if (httpd_server_is_handling(srv))
+		return luaL_error(L, "HTTP server can't be stopped "
+				  "from its handler");
+	httpd_server_stop(srv);
+	luaL_unref(L, LUA_REGISTRYINDEX, srv->self_ref);
+	srv->self_ref = LUA_NOREF;
+	return 0;
+}
+
+/** server:info() returns {listen, requests}. */
+static int
+lbox_httpd_server_info(struct lua_State *L)
+{
+	struct httpd_server *srv = luaT_checkhttpdserver(L, 1,
+							 "server:info()");
+	lua_createtable(L, 0, 2);
+	if (srv->is_running) {
+		lua_pushstring(L, srv->listen);
+		lua_setfield(L, -2, "listen");
+	}
+	luaL_pushuint64(L, srv->request_count);
+	lua_setfield(L, -2, "requests");
+	return 1;
+}
+
+static int
+lbox_httpd_server_gc(struct lua_State *L)
+{
+	struct httpd_server **ptr = luaL_checkudata(L, 1,
+						    httpd_server_typename);
+	struct httpd_server *srv = *ptr;
+	/* Only possible on exit, the thread is left as is. */
+	if (srv->is_running)
+		return 0;
+	luaL_unref(L, LUA_REGISTRYINDEX, srv->handler_ref);
+	fiber_cond_destroy(&srv->stopped_cond);
+	free(srv);
+	*ptr = NULL;
+	return 0;
+}
+
+void
+box_lua_httpd_init(struct lua_State *L)
+{
+	static const struct luaL_Reg httpd_server_meta[] = {
+		{"__gc", lbox_httpd_server_gc},
+		{"stop", lbox_httpd_server_stop},
+		{"info", lbox_httpd_server_info},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, httpd_server_typename, httpd_server_meta);
+
+	static const struct luaL_Reg httpd_lib[] = {
+		{"new", lbox_httpd_new},
+		{NULL, NULL}
+	};
+	luaL_register_module(L, "box.httpd", httpd_lib);
+	lua_pop(L, 1);
+}
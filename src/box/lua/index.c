@@ -135,6 +135,26 @@ lbox_index_delete(lua_State *L)
 	return luaT_pushtupleornil(L, result);
 }
 
+static int
+lbox_index_delete_range(lua_State *L)
+{
+	if (lua_gettop(L) != 4 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    (lua_type(L, 3) != LUA_TTABLE && luaT_istuple(L, 3) == NULL) ||
+	    (lua_type(L, 4) != LUA_TTABLE && luaT_istuple(L, 4) == NULL))
+		return luaL_error(L, "Usage index:delete_range(begin, end)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	size_t begin_len, end_len;
+	const char *begin = lbox_encode_tuple_on_gc(L, 3, &begin_len);
+	const char *end = lbox_encode_tuple_on_gc(L, 4, &end_len);
+
+	if (box_delete_range(space_id, index_id, begin, begin + begin_len,
+			     end, end + end_len) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
 static int
 lbox_index_random(lua_State *L)
 {
@@ -355,6 +375,7 @@ box_lua_index_init(struct lua_State *L)
 		{"update", lbox_index_update},
 		{"upsert",  lbox_upsert},
 		{"delete",  lbox_index_delete},
+		{"delete_range", lbox_index_delete_range},
 		{"random", lbox_index_random},
 		{"get",  lbox_index_get},
 		{"min", lbox_index_min},
@@ -141,6 +141,37 @@ lbox_pushrelay(lua_State *L, struct relay *relay)
 		lua_pushnumber(L, ev_monotonic_now(loop()) -
 			       relay_last_row_time(relay));
 		lua_settable(L, -3);
+		int64_t hits, misses;
+		relay_wal_tail_stat(relay, &hits, &misses);
+		lua_pushstring(L, "wal_tail");
+		lua_createtable(L, 0, 2);
+		lua_pushstring(L, "hits");
+		luaL_pushint64(L, hits);
+		lua_settable(L, -3);
+		lua_pushstring(L, "misses");
+		luaL_pushint64(L, misses);
+		lua_settable(L, -3);
+		lua_settable(L, -3);
+		int64_t raw, compressed;
+		enum compression_type compression =
+			relay_compression_stat(relay, &raw, &compressed);
+		if (compression == COMPRESSION_TYPE_NONE)
+			break;
+		lua_pushstring(L, "compression");
+		lua_createtable(L, 0, 4);
+		lua_pushstring(L, "algorithm");
+		lua_pushstring(L, compression_type_strs[compression]);
+		lua_settable(L, -3);
+		lua_pushstring(L, "raw");
+		luaL_pushint64(L, raw);
+		lua_settable(L, -3);
+		lua_pushstring(L, "compressed");
+		luaL_pushint64(L, compressed);
+		lua_settable(L, -3);
+		lua_pushstring(L, "ratio");
+		lua_pushnumber(L, compressed != 0 ? (double)raw / compressed : 1);
+		lua_settable(L, -3);
+		lua_settable(L, -3);
 		break;
 	case RELAY_STOPPED:
 	{
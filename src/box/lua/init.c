@@ -40,8 +40,10 @@
 
 #include "box/box.h"
 #include "box/txn.h"
+#include "box/error.h"
 #include "box/func.h"
 #include "box/vclock.h"
+#include "box/wal.h"
 #include "box/session.h"
 #include "box/mp_error.h"
 
@@ -56,10 +58,16 @@
 #include "box/lua/stat.h"
 #include "box/lua/info.h"
 #include "box/lua/ctl.h"
+#include "box/lua/profiler.h"
 #include "box/lua/session.h"
 #include "box/lua/net_box.h"
 #include "box/lua/cfg.h"
 #include "box/lua/xlog.h"
+#include "box/lua/read_view.h"
+#include "box/lua/cdc.h"
+#include "box/lua/bulk_load.h"
+#include "box/lua/csv_load.h"
+#include "box/lua/httpd.h"
 #include "box/lua/console.h"
 #include "box/lua/tuple.h"
 #include "box/lua/execute.h"
@@ -106,11 +114,111 @@ static const char *lua_sources[] = {
 	NULL
 };
 
+static const char txn_future_typename[] = "box.txn_future";
+
+static struct txn_future *
+luaT_checktxnfuture(struct lua_State *L, int idx, const char *usage)
+{
+	if (idx > lua_gettop(L))
+		luaL_error(L, "usage: %s", usage);
+	return *(struct txn_future **)luaL_checkudata(L, idx,
+						      txn_future_typename);
+}
+
+/**
+ * box.commit() commits the current transaction and waits until
+ * it is committed. box.commit({wait = 'wal'}) returns a future
+ * once the transaction is written to WAL, and box.commit({wait =
+ * 'none'}) right after the WAL write is submitted. The rest of
+ * the commit, including waiting for a quorum, is carried on in
+ * background.
+ */
 static int
 lbox_commit(lua_State *L)
 {
-	if (box_txn_commit() != 0)
+	static const char usage[] =
+		"box.commit([{wait = 'none' | 'wal' | 'quorum'}])";
+	enum txn_future_state wait = TXN_FUTURE_COMMITTED;
+	if (lua_gettop(L) > 0 && !lua_isnil(L, 1)) {
+		if (lua_type(L, 1) != LUA_TTABLE)
+			return luaL_error(L, "usage: %s", usage);
+		lua_getfield(L, 1, "wait");
+		const char *str = lua_tostring(L, -1);
+		if (str == NULL && !lua_isnil(L, -1))
+			return luaL_error(L, "usage: %s", usage);
+		if (str == NULL || strcmp(str, "quorum") == 0)
+			wait = TXN_FUTURE_COMMITTED;
+		else if (strcmp(str, "wal") == 0)
+			wait = TXN_FUTURE_WAL;
+		else if (strcmp(str, "none") == 0)
+			wait = TXN_FUTURE_PENDING;
+		else
+			return luaL_error(L, "usage: %s", usage);
+		lua_pop(L, 1);
+	}
+	if (wait == TXN_FUTURE_COMMITTED) {
+		if (box_txn_commit() != 0)
+			return luaT_error(L);
+		return 0;
+	}
+	struct txn *txn = in_txn();
+	if (txn != NULL && txn->in_sub_stmt) {
+		diag_set(ClientError, ER_COMMIT_IN_SUB_STMT);
+		return luaT_error(L);
+	}
+	struct txn_future **ptr = lua_newuserdata(L, sizeof(*ptr));
+	*ptr = txn_commit_future(txn);
+	if (*ptr == NULL)
+		return luaT_error(L);
+	luaL_getmetatable(L, txn_future_typename);
+	lua_setmetatable(L, -2);
+	if (txn_future_wait(*ptr, wait, TIMEOUT_INFINITY) != 0)
+		return luaT_error(L);
+	return 1;
+}
+
+/**
+ * future:wait([timeout]) waits until the transaction is
+ * committed. Raises an error if it is rolled back or the timeout
+ * expires.
+ */
+static int
+lbox_txn_future_wait(struct lua_State *L)
+{
+	static const char usage[] = "future:wait([timeout])";
+	struct txn_future *future = luaT_checktxnfuture(L, 1, usage);
+	double timeout = TIMEOUT_INFINITY;
+	if (!lua_isnoneornil(L, 2)) {
+		if (lua_type(L, 2) != LUA_TNUMBER)
+			return luaL_error(L, "usage: %s", usage);
+		timeout = lua_tonumber(L, 2);
+	}
+	if (txn_future_wait(future, TXN_FUTURE_COMMITTED, timeout) != 0)
 		return luaT_error(L);
+	lua_pushboolean(L, true);
+	return 1;
+}
+
+/**
+ * future:is_ready() returns true if the transaction is either
+ * committed or rolled back.
+ */
+static int
+lbox_txn_future_is_ready(struct lua_State *L)
+{
+	struct txn_future *future =
+		luaT_checktxnfuture(L, 1, "future:is_ready()");
+	lua_pushboolean(L, future->state >= TXN_FUTURE_COMMITTED);
+	return 1;
+}
+
+static int
+lbox_txn_future_gc(struct lua_State *L)
+{
+	struct txn_future **ptr = luaL_checkudata(L, 1, txn_future_typename);
+	if (*ptr != NULL)
+		txn_future_unref(*ptr);
+	*ptr = NULL;
 	return 0;
 }
 
@@ -340,6 +448,44 @@ lbox_snapshot(struct lua_State *L)
 	return luaT_error(L);
 }
 
+/**
+ * box.wait_vclock(vclock[, timeout]) - wait until the replica
+ * set vclock reaches the given one, e.g. box.info.vclock taken
+ * on the master after a write. The 0th component is ignored.
+ */
+static int
+lbox_wait_vclock(struct lua_State *L)
+{
+	static const char usage[] = "box.wait_vclock(vclock[, timeout])";
+	if (lua_gettop(L) < 1 || lua_type(L, 1) != LUA_TTABLE)
+		return luaL_error(L, "usage: %s", usage);
+	double timeout = TIMEOUT_INFINITY;
+	if (lua_gettop(L) > 1 && !lua_isnil(L, 2)) {
+		if (lua_type(L, 2) != LUA_TNUMBER)
+			return luaL_error(L, "usage: %s", usage);
+		timeout = lua_tonumber(L, 2);
+	}
+	struct vclock vclock;
+	vclock_create(&vclock);
+	lua_pushnil(L);
+	while (lua_next(L, 1) != 0) {
+		if (lua_type(L, -2) != LUA_TNUMBER ||
+		    lua_type(L, -1) != LUA_TNUMBER)
+			return luaL_error(L, "usage: %s", usage);
+		double id = lua_tonumber(L, -2);
+		double lsn = lua_tonumber(L, -1);
+		if (id < 0 || id >= VCLOCK_MAX || id != (uint32_t)id ||
+		    lsn < 0 || lsn != (int64_t)lsn)
+			return luaL_error(L, "usage: %s", usage);
+		if (id != 0)
+			vclock_reset(&vclock, id, lsn);
+		lua_pop(L, 1);
+	}
+	if (wal_wait_vclock(&vclock, timeout) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
 /** Argument passed to lbox_backup_fn(). */
 struct lbox_backup_arg {
 	/** Lua state. */
@@ -391,6 +537,7 @@ static const struct luaL_Reg boxlib[] = {
 	{"on_rollback", lbox_on_rollback},
 	{"snapshot", lbox_snapshot},
 	{"rollback_to_savepoint", lbox_rollback_to_savepoint},
+	{"wait_vclock", lbox_wait_vclock},
 	{NULL, NULL}
 };
 
@@ -455,6 +602,14 @@ box_lua_init(struct lua_State *L)
 	CTID_STRUCT_TXN_SAVEPOINT_PTR = luaL_ctypeid(L,
 						     "struct txn_savepoint*");
 
+	static const struct luaL_Reg txn_future_meta[] = {
+		{"__gc", lbox_txn_future_gc},
+		{"wait", lbox_txn_future_wait},
+		{"is_ready", lbox_txn_future_is_ready},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, txn_future_typename, txn_future_meta);
+
 	/* Use luaL_register() to set _G.box */
 	luaL_register(L, "box", boxlib);
 	lua_pop(L, 1);
@@ -474,8 +629,14 @@ box_lua_init(struct lua_State *L)
 	box_lua_info_init(L);
 	box_lua_stat_init(L);
 	box_lua_ctl_init(L);
+	box_lua_profiler_init(L);
 	box_lua_session_init(L);
 	box_lua_xlog_init(L);
+	box_lua_read_view_init(L);
+	box_lua_cdc_init(L);
+	box_lua_bulk_load_init(L);
+	box_lua_csv_load_init(L);
+	box_lua_httpd_init(L);
 	box_lua_sql_init(L);
 	luaopen_net_box(L);
 	lua_pop(L, 1);
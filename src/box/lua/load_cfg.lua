@@ -42,6 +42,17 @@ local default_cfg = {
     strip_core          = true,
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_snapshot_threads = 1,
+    memtx_checkpoint_delta_ratio = 0,
+    memtx_defrag_budget = 0,
+    memtx_update_in_place = false,
+    memtx_expire_rate   = 1000,
+    memtx_use_mvcc_engine = false,
+    memtx_numa_policy   = 'default',
+    memtx_use_hugepages = false,
+    memtx_heap_dir      = nil,
+    read_view_threads   = 1,
+    func_worker_threads = 1,
     slab_alloc_factor   = 1.05,
     work_dir            = nil,
     memtx_dir           = ".",
@@ -50,10 +61,17 @@ local default_cfg = {
     vinyl_dir           = '.',
     vinyl_memory        = 128 * 1024 * 1024,
     vinyl_cache         = 128 * 1024 * 1024,
+    vinyl_page_cache    = 0,
+    vinyl_max_subcompactions = 1,
+    vinyl_compaction_direct_io = false,
+    vinyl_compaction_readahead = 0,
+    vinyl_blob_threshold      = 0,
     vinyl_max_tuple_size = 1024 * 1024,
     vinyl_read_threads  = 1,
     vinyl_write_threads = 4,
+    vinyl_dump_threads  = 0,
     vinyl_timeout       = 60,
+    vinyl_upsert_squash_threshold = 128,
     vinyl_run_count_per_level = 2,
     vinyl_run_size_ratio      = 3.5,
     vinyl_range_size          = nil, -- set automatically
@@ -66,10 +84,19 @@ local default_cfg = {
 
     io_collect_interval = nil,
     readahead           = 16320,
+    iproto_threads      = 1,
     snap_io_rate_limit  = nil, -- no limit
     too_long_threshold  = 0.5,
     wal_mode            = "write",
     wal_max_size        = 256 * 1024 * 1024,
+    wal_group_commit_delay = 0,
+    wal_group_commit_max_size = 1024 * 1024,
+    wal_recycle_count   = 0,
+    wal_tail_size       = 16 * 1024 * 1024,
+    wal_compression_level = 3,
+    wal_compression_threshold = 2048,
+    wal_compression_threads = 0,
+    xlog_compression_dict = 0,
     wal_dir_rescan_delay= 2,
     force_recovery      = false,
     replication         = nil,
@@ -84,8 +111,12 @@ local default_cfg = {
     hot_standby         = false,
     checkpoint_interval = 3600,
     checkpoint_wal_threshold = 1e18,
+    checkpoint_recovery_time = 0,
     checkpoint_count    = 2,
     worker_pool_threads = 4,
+    dns_cache_ttl       = 10,
+    worker_pool_file_threads = 4,
+    worker_pool_resolve_threads = 2,
     replication_timeout = 1,
     replication_sync_lag = 10,
     replication_sync_timeout = 300,
@@ -94,11 +125,18 @@ local default_cfg = {
     replication_connect_timeout = 30,
     replication_connect_quorum = nil, -- connect all
     replication_skip_conflict = false,
+    replication_apply_fibers = 1,
+    replication_ack_interval = 0,
+    replication_spaces    = nil, -- all spaces
+    replication_compression = 'none',
     replication_anon      = false,
     feedback_enabled      = true,
     feedback_host         = "https://feedback.tarantool.io",
     feedback_interval     = 3600,
     net_msg_max           = 768,
+    net_fiber_stack_size  = 512 * 1024,
+    net_trace_sample_rate = 0,
+    busy_poll_timeout     = 0,
     sql_cache_size        = 5 * 1024 * 1024,
 }
 
@@ -107,6 +145,7 @@ local module_cfg = {
     -- logging
     log                 = log.box_api,
     log_nonblock        = log.box_api,
+    log_async           = log.box_api,
     log_level           = log.box_api,
     log_format          = log.box_api,
 }
@@ -119,6 +158,17 @@ local template_cfg = {
     strip_core          = 'boolean',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_snapshot_threads = 'number',
+    memtx_checkpoint_delta_ratio = 'number',
+    memtx_defrag_budget = 'number',
+    memtx_update_in_place = 'boolean',
+    memtx_expire_rate   = 'number',
+    memtx_use_mvcc_engine = 'boolean',
+    memtx_numa_policy   = 'string',
+    memtx_use_hugepages = 'boolean',
+    memtx_heap_dir      = 'string',
+    read_view_threads   = 'number',
+    func_worker_threads = 'number',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
@@ -126,10 +176,17 @@ local template_cfg = {
     vinyl_dir           = 'string',
     vinyl_memory        = 'number',
     vinyl_cache               = 'number',
+    vinyl_page_cache          = 'number',
+    vinyl_max_subcompactions  = 'number',
+    vinyl_compaction_direct_io = 'boolean',
+    vinyl_compaction_readahead = 'number',
+    vinyl_blob_threshold      = 'number',
     vinyl_max_tuple_size      = 'number',
     vinyl_read_threads        = 'number',
     vinyl_write_threads       = 'number',
+    vinyl_dump_threads        = 'number',
     vinyl_timeout             = 'number',
+    vinyl_upsert_squash_threshold = 'number',
     vinyl_run_count_per_level = 'number',
     vinyl_run_size_ratio      = 'number',
     vinyl_range_size          = 'number',
@@ -138,15 +195,25 @@ local template_cfg = {
 
     log                 = 'module',
     log_nonblock        = 'module',
+    log_async           = 'module',
     log_level           = 'module',
     log_format          = 'module',
 
     io_collect_interval = 'number',
     readahead           = 'number',
+    iproto_threads      = 'number',
     snap_io_rate_limit  = 'number',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
     wal_max_size        = 'number',
+    wal_group_commit_delay = 'number',
+    wal_group_commit_max_size = 'number',
+    wal_recycle_count   = 'number',
+    wal_tail_size       = 'number',
+    wal_compression_level = 'number',
+    wal_compression_threshold = 'number',
+    wal_compression_threads = 'number',
+    xlog_compression_dict = 'number',
     wal_dir_rescan_delay= 'number',
     force_recovery      = 'boolean',
     replication         = 'string, number, table',
@@ -159,10 +226,14 @@ local template_cfg = {
     coredump            = 'boolean',
     checkpoint_interval = 'number',
     checkpoint_wal_threshold = 'number',
+    checkpoint_recovery_time = 'number',
     checkpoint_count    = 'number',
     read_only           = 'boolean',
     hot_standby         = 'boolean',
     worker_pool_threads = 'number',
+    dns_cache_ttl       = 'number',
+    worker_pool_file_threads = 'number',
+    worker_pool_resolve_threads = 'number',
     replication_timeout = 'number',
     replication_sync_lag = 'number',
     replication_sync_timeout = 'number',
@@ -171,11 +242,18 @@ local template_cfg = {
     replication_connect_timeout = 'number',
     replication_connect_quorum = 'number',
     replication_skip_conflict = 'boolean',
+    replication_apply_fibers = 'number',
+    replication_ack_interval = 'number',
+    replication_spaces    = 'number, table',
+    replication_compression = 'string',
     replication_anon      = 'boolean',
     feedback_enabled      = ifdef_feedback('boolean'),
     feedback_host         = ifdef_feedback('string'),
     feedback_interval     = ifdef_feedback('number'),
     net_msg_max           = 'number',
+    net_fiber_stack_size  = 'number',
+    net_trace_sample_rate = 'number',
+    busy_poll_timeout     = 'number',
     sql_cache_size        = 'number',
 }
 
@@ -262,14 +340,35 @@ local dynamic_cfg = {
     read_only               = private.cfg_set_read_only,
     memtx_memory            = private.cfg_set_memtx_memory,
     memtx_max_tuple_size    = private.cfg_set_memtx_max_tuple_size,
+    memtx_snapshot_threads  = private.cfg_set_memtx_snapshot_threads,
+    memtx_checkpoint_delta_ratio = private.cfg_set_memtx_checkpoint_delta_ratio,
+    memtx_defrag_budget     = private.cfg_set_memtx_defrag_budget,
+    memtx_update_in_place   = private.cfg_set_memtx_update_in_place,
+    memtx_expire_rate       = private.cfg_set_memtx_expire_rate,
+    xlog_compression_dict   = private.cfg_set_xlog_compression_dict,
     vinyl_memory            = private.cfg_set_vinyl_memory,
     vinyl_max_tuple_size    = private.cfg_set_vinyl_max_tuple_size,
     vinyl_cache             = private.cfg_set_vinyl_cache,
+    vinyl_page_cache        = private.cfg_set_vinyl_page_cache,
+    vinyl_max_subcompactions = private.cfg_set_vinyl_max_subcompactions,
+    vinyl_compaction_direct_io = private.cfg_set_vinyl_compaction_direct_io,
+    vinyl_compaction_readahead = private.cfg_set_vinyl_compaction_readahead,
+    vinyl_blob_threshold    = private.cfg_set_vinyl_blob_threshold,
     vinyl_timeout           = private.cfg_set_vinyl_timeout,
+    vinyl_upsert_squash_threshold =
+        private.cfg_set_vinyl_upsert_squash_threshold,
     checkpoint_count        = private.cfg_set_checkpoint_count,
     checkpoint_interval     = private.cfg_set_checkpoint_interval,
     checkpoint_wal_threshold = private.cfg_set_checkpoint_wal_threshold,
+    checkpoint_recovery_time = private.cfg_set_checkpoint_recovery_time,
+    wal_group_commit_delay  = private.cfg_set_wal_group_commit,
+    wal_group_commit_max_size = private.cfg_set_wal_group_commit,
+    wal_recycle_count       = private.cfg_set_wal_recycle_count,
+    wal_tail_size           = private.cfg_set_wal_tail_size,
     worker_pool_threads     = private.cfg_set_worker_pool_threads,
+    worker_pool_file_threads = private.cfg_set_worker_pool_threads,
+    worker_pool_resolve_threads = private.cfg_set_worker_pool_threads,
+    dns_cache_ttl           = private.cfg_set_dns_cache_ttl,
     feedback_enabled        = ifdef_feedback_set_params,
     feedback_host           = ifdef_feedback_set_params,
     feedback_interval       = ifdef_feedback_set_params,
@@ -287,10 +386,17 @@ local dynamic_cfg = {
     replication_synchro_quorum = private.cfg_set_replication_synchro_quorum,
     replication_synchro_timeout = private.cfg_set_replication_synchro_timeout,
     replication_skip_conflict = private.cfg_set_replication_skip_conflict,
+    replication_apply_fibers = private.cfg_set_replication_apply_fibers,
+    replication_ack_interval = private.cfg_set_replication_ack_interval,
+    replication_spaces      = private.cfg_set_replication_spaces,
+    replication_compression = private.cfg_set_replication_compression,
     replication_anon        = private.cfg_set_replication_anon,
     instance_uuid           = check_instance_uuid,
     replicaset_uuid         = check_replicaset_uuid,
     net_msg_max             = private.cfg_set_net_msg_max,
+    net_fiber_stack_size    = private.cfg_set_net_fiber_stack_size,
+    net_trace_sample_rate   = private.cfg_set_net_trace_sample_rate,
+    busy_poll_timeout       = private.cfg_set_busy_poll_timeout,
     sql_cache_size          = private.cfg_set_sql_cache_size,
 }
 
@@ -323,6 +429,7 @@ local dynamic_cfg_order = {
     replication_synchro_timeout = 150,
     replication_connect_timeout = 150,
     replication_connect_quorum  = 150,
+    replication_spaces      = 150,
     replication             = 200,
     -- Anon is set after `replication` as a temporary workaround
     -- for the problem, that `replication` and `replication_anon`
@@ -345,10 +452,22 @@ local dynamic_cfg_skip_at_load = {
     listen                  = true,
     memtx_memory            = true,
     memtx_max_tuple_size    = true,
+    memtx_snapshot_threads  = true,
+    memtx_checkpoint_delta_ratio = true,
+    memtx_defrag_budget     = true,
+    memtx_update_in_place   = true,
+    memtx_expire_rate       = true,
+    xlog_compression_dict   = true,
     vinyl_memory            = true,
     vinyl_max_tuple_size    = true,
     vinyl_cache             = true,
+    vinyl_page_cache        = true,
+    vinyl_max_subcompactions = true,
+    vinyl_compaction_direct_io = true,
+    vinyl_compaction_readahead = true,
+    vinyl_blob_threshold    = true,
     vinyl_timeout           = true,
+    vinyl_upsert_squash_threshold = true,
     too_long_threshold      = true,
     replication             = true,
     replication_timeout     = true,
@@ -359,6 +478,11 @@ local dynamic_cfg_skip_at_load = {
     replication_synchro_quorum = true,
     replication_synchro_timeout = true,
     replication_skip_conflict = true,
+    replication_apply_fibers = true,
+    replication_ack_interval = true,
+    replication_spaces      = true,
+    replication_compression = true,
+    wal_tail_size           = true,
     replication_anon        = true,
     wal_dir_rescan_delay    = true,
     custom_proc_title       = true,
@@ -366,6 +490,9 @@ local dynamic_cfg_skip_at_load = {
     instance_uuid           = true,
     replicaset_uuid         = true,
     net_msg_max             = true,
+    net_fiber_stack_size    = true,
+    net_trace_sample_rate   = true,
+    busy_poll_timeout       = true,
     readahead               = true,
 }
 
@@ -1008,6 +1008,325 @@ lbox_merger_new_tuple_source(struct lua_State *L)
 
 /* }}} */
 
+/* {{{ Prefetch merge source */
+
+/*
+ * A source, which receives chunks of tuples into buffers using
+ * asynchronous requests (say, net.box selects with `is_async`,
+ * `buffer` and `skip_header` options). A request for a next
+ * chunk is issued as soon as the current chunk arrives, so a
+ * network round trip is overlapped with merging of the current
+ * chunk.
+ */
+struct merge_source_prefetch {
+	struct merge_source base;
+	/*
+	 * A reference to a Lua function to issue a request for a
+	 * next chunk: request(buf, last_tuple) -> future. The
+	 * last tuple of the previous chunk is nil for the first
+	 * request.
+	 */
+	int request_ref;
+	/*
+	 * References to the buffers. Needed to prevent LuaJIT
+	 * from collecting them while they are in use.
+	 */
+	int buf_ref[2];
+	/*
+	 * Buffers for the current chunk and for the next one,
+	 * which is being received.
+	 */
+	struct ibuf *buf[2];
+	/*
+	 * Index of the buffer with the current chunk.
+	 */
+	int cur;
+	/*
+	 * A reference to a future of the request in flight or
+	 * LUA_NOREF when the last chunk is received.
+	 */
+	int future_ref;
+	/*
+	 * Tuples of the current chunk, which are not read yet.
+	 */
+	size_t remaining_tuple_count;
+	/*
+	 * Number of tuples a request asks for. A shorter chunk
+	 * means that there are no more tuples.
+	 */
+	uint32_t fetch_size;
+};
+
+/* Virtual methods declarations */
+
+static void
+luaL_merge_source_prefetch_destroy(struct merge_source *base);
+static int
+luaL_merge_source_prefetch_next(struct merge_source *base,
+				struct tuple_format *format,
+				struct tuple **out);
+
+/* Non-virtual methods */
+
+/**
+ * Call a user provided function to request a next chunk into
+ * the buffer, which is not the current one, and save the
+ * returned future.
+ *
+ * @a last and @a last_end point to the last tuple of the
+ * previous chunk or are NULL for the first request.
+ *
+ * Return 0 at success and -1 at error and set a diag.
+ */
+static int
+luaL_merge_source_prefetch_request(struct merge_source_prefetch *source,
+				   struct lua_State *L, const char *last,
+				   const char *last_end)
+{
+	assert(source->future_ref == LUA_NOREF);
+	int next = 1 - source->cur;
+	ibuf_reset(source->buf[next]);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, source->request_ref);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, source->buf_ref[next]);
+	if (last != NULL) {
+		struct tuple *tuple = tuple_new(tuple_format_runtime, last,
+						last_end);
+		if (tuple == NULL) {
+			lua_pop(L, 2);
+			return -1;
+		}
+		luaT_pushtuple(L, tuple);
+	} else {
+		lua_pushnil(L);
+	}
+	if (luaT_call(L, 2, 1) != 0)
+		return -1;
+	source->future_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	return 0;
+}
+
+/**
+ * Helper for `luaL_merge_source_prefetch_fetch()`.
+ */
+static int
+luaL_merge_source_prefetch_fetch_impl(struct merge_source_prefetch *source,
+				      struct lua_State *L)
+{
+	/* Wait for the request in flight: future:wait_result(). */
+	lua_rawgeti(L, LUA_REGISTRYINDEX, source->future_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, source->future_ref);
+	source->future_ref = LUA_NOREF;
+	lua_getfield(L, -1, "wait_result");
+	lua_insert(L, -2);
+	if (luaT_call(L, 1, 2) != 0)
+		return -1;
+	if (lua_isnil(L, -2)) {
+		luaT_toerror(L);
+		return -1;
+	}
+	lua_pop(L, 2);
+
+	/* Set the received buffer as the current chunk. */
+	source->cur = 1 - source->cur;
+	struct ibuf *buf = source->buf[source->cur];
+	if (decode_header(buf, &source->remaining_tuple_count) != 0) {
+		diag_set(IllegalParams, "Invalid merge source %p",
+			 &source->base);
+		return -1;
+	}
+	if (source->remaining_tuple_count < source->fetch_size)
+		return 0;
+
+	/*
+	 * The chunk is full, so there may be more tuples: ask
+	 * for them before the chunk is merged.
+	 */
+	const char *last = buf->rpos;
+	const char *last_end = buf->rpos;
+	for (size_t i = 0; i < source->remaining_tuple_count; ++i) {
+		last = last_end;
+		if (mp_check(&last_end, buf->wpos) != 0) {
+			diag_set(IllegalParams, "Unexpected msgpack buffer end");
+			return -1;
+		}
+	}
+	return luaL_merge_source_prefetch_request(source, L, last, last_end);
+}
+
+/**
+ * Wait for the chunk requested before, set it as the current
+ * one and request a next chunk if there may be more tuples.
+ *
+ * Return 0 at success and -1 at error and set a diag.
+ */
+static int
+luaL_merge_source_prefetch_fetch(struct merge_source_prefetch *source)
+{
+	int coro_ref = LUA_NOREF;
+	int top = -1;
+	struct lua_State *L = luaT_temp_luastate(&coro_ref, &top);
+	if (L == NULL)
+		return -1;
+	int rc = luaL_merge_source_prefetch_fetch_impl(source, L);
+	luaT_release_temp_luastate(L, coro_ref, top);
+	return rc;
+}
+
+/**
+ * Create a new merge source of the prefetch type and issue the
+ * first request.
+ *
+ * Reads request, fetch_size, buf, buf from a Lua stack.
+ *
+ * In case of an error it returns NULL and sets a diag.
+ */
+static struct merge_source *
+luaL_merge_source_prefetch_new(struct lua_State *L)
+{
+	static struct merge_source_vtab merge_source_prefetch_vtab = {
+		.destroy = luaL_merge_source_prefetch_destroy,
+		.next = luaL_merge_source_prefetch_next,
+	};
+
+	struct merge_source_prefetch *source = malloc(
+		sizeof(struct merge_source_prefetch));
+	if (source == NULL) {
+		diag_set(OutOfMemory, sizeof(struct merge_source_prefetch),
+			 "malloc", "merge_source_prefetch");
+		return NULL;
+	}
+
+	merge_source_create(&source->base, &merge_source_prefetch_vtab);
+
+	lua_pushvalue(L, 1); /* Popped by luaL_ref(). */
+	source->request_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	source->fetch_size = lua_tointeger(L, 2);
+	for (int i = 0; i < 2; ++i) {
+		source->buf[i] = luaL_checkibuf(L, 3 + i);
+		lua_pushvalue(L, 3 + i); /* Popped by luaL_ref(). */
+		source->buf_ref[i] = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+	source->cur = 1;
+	source->future_ref = LUA_NOREF;
+	source->remaining_tuple_count = 0;
+
+	/*
+	 * Issue the first request right away: a merger fetches
+	 * first tuples from its sources one by one, so the
+	 * requests of all sources are in flight simultaneously.
+	 */
+	if (luaL_merge_source_prefetch_request(source, L, NULL, NULL) != 0) {
+		merge_source_unref(&source->base);
+		return NULL;
+	}
+	return &source->base;
+}
+
+/* Virtual methods */
+
+/**
+ * destroy() virtual method implementation for a prefetch
+ * source.
+ *
+ * A response to a request in flight is still written to the
+ * buffer: it is referenced by the request itself.
+ *
+ * @see struct merge_source_vtab
+ */
+static void
+luaL_merge_source_prefetch_destroy(struct merge_source *base)
+{
+	struct merge_source_prefetch *source = container_of(base,
+		struct merge_source_prefetch, base);
+
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, source->request_ref);
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, source->buf_ref[0]);
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, source->buf_ref[1]);
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, source->future_ref);
+
+	free(source);
+}
+
+/**
+ * next() virtual method implementation for a prefetch source.
+ *
+ * @see struct merge_source_vtab
+ */
+static int
+luaL_merge_source_prefetch_next(struct merge_source *base,
+				struct tuple_format *format,
+				struct tuple **out)
+{
+	struct merge_source_prefetch *source = container_of(base,
+		struct merge_source_prefetch, base);
+
+	/*
+	 * Handle the case when all data were processed: wait for
+	 * a next chunk until a non-empty chunk is received or
+	 * there are no more requests in flight.
+	 */
+	while (source->remaining_tuple_count == 0) {
+		if (source->future_ref == LUA_NOREF) {
+			*out = NULL;
+			return 0;
+		}
+		if (luaL_merge_source_prefetch_fetch(source) != 0)
+			return -1;
+	}
+	struct ibuf *buf = source->buf[source->cur];
+	if (ibuf_used(buf) == 0) {
+		diag_set(IllegalParams, "Unexpected msgpack buffer end");
+		return -1;
+	}
+	const char *tuple_beg = buf->rpos;
+	const char *tuple_end = tuple_beg;
+	if (mp_check(&tuple_end, buf->wpos) != 0) {
+		diag_set(IllegalParams, "Unexpected msgpack buffer end");
+		return -1;
+	}
+	--source->remaining_tuple_count;
+	buf->rpos = (char *) tuple_end;
+	if (format == NULL)
+		format = tuple_format_runtime;
+	struct tuple *tuple = tuple_new(format, tuple_beg, tuple_end);
+	if (tuple == NULL)
+		return -1;
+
+	tuple_ref(tuple);
+	*out = tuple;
+	return 0;
+}
+
+/* Lua functions */
+
+/**
+ * Create a new prefetch source and push it onto the Lua stack.
+ *
+ * It is the backend of merger.new_netbox_source().
+ */
+static int
+lbox_merger_new_prefetch_source(struct lua_State *L)
+{
+	if (lua_gettop(L) != 4 || !luaL_iscallable(L, 1) ||
+	    !lua_isnumber(L, 2) || lua_tointeger(L, 2) <= 0 ||
+	    luaL_checkibuf(L, 3) == NULL || luaL_checkibuf(L, 4) == NULL)
+		return luaL_error(L, "Usage: merger.internal."
+				  "new_prefetch_source(request, fetch_size, "
+				  "buf, buf)");
+
+	struct merge_source *source = luaL_merge_source_prefetch_new(L);
+	if (source == NULL)
+		return luaT_error(L);
+	*(struct merge_source **)
+		luaL_pushcdata(L, CTID_STRUCT_MERGE_SOURCE_REF) = source;
+	lua_pushcfunction(L, lbox_merge_source_gc);
+	luaL_setcdatagc(L, -2);
+
+	return 1;
+}
+
+/* }}} */
+
 /* {{{ Merge source Lua methods */
 
 /**
@@ -1271,12 +1590,14 @@ luaopen_merger(struct lua_State *L)
 	};
 	luaL_register_module(L, "merger", meta);
 
-	/* Add internal.{select,ipairs}(). */
+	/* Add internal.{select,ipairs,new_prefetch_source}(). */
 	lua_newtable(L); /* merger.internal */
 	lua_pushcfunction(L, lbox_merge_source_select);
 	lua_setfield(L, -2, "select");
 	lua_pushcfunction(L, lbox_merge_source_ipairs);
 	lua_setfield(L, -2, "ipairs");
+	lua_pushcfunction(L, lbox_merger_new_prefetch_source);
+	lua_setfield(L, -2, "new_prefetch_source");
 	lua_setfield(L, -2, "internal");
 
 	return 1;
@@ -1,6 +1,8 @@
 local ffi = require('ffi')
 local fun = require('fun')
 local merger = require('merger')
+local buffer = require('buffer')
+local key_def_lib = require('key_def')
 
 local ibuf_t = ffi.typeof('struct ibuf')
 local merge_source_t = ffi.typeof('struct merge_source')
@@ -25,6 +27,60 @@ merger.new_source_fromtable = function(tbl)
     return merger.new_table_source(fun.iter({tbl}))
 end
 
+-- An iterator to continue a chunked select after the last
+-- tuple of a previous chunk.
+local netbox_next_iterator = {
+    ['ALL'] = 'GT',
+    ['GE'] = 'GT',
+    ['GT'] = 'GT',
+    ['LE'] = 'LT',
+    ['LT'] = 'LT',
+}
+
+-- Create a source, which reads tuples from a remote index
+-- using chunked net.box selects. A select for a next chunk is
+-- in flight while the current chunk is being merged.
+--
+-- The index should be unique: a next chunk starts after a key
+-- of the last tuple of the previous one.
+merger.new_netbox_source = function(index, key, opts)
+    local func_name = 'merger.new_netbox_source'
+    if type(index) ~= 'table' or type(index.parts) ~= 'table' or
+            (opts ~= nil and type(opts) ~= 'table') then
+        error(('Usage: %s(<net.box index>, key[, {iterator = <string>, ' ..
+               'fetch_size = <number>}])'):format(func_name), 0)
+    end
+    if not index.unique then
+        error(('%s: the index should be unique'):format(func_name), 0)
+    end
+    opts = opts or {}
+    local iterator = string.upper(opts.iterator or 'GE')
+    local next_iterator = netbox_next_iterator[iterator]
+    if next_iterator == nil then
+        error(('%s: unsupported iterator %s'):format(func_name, iterator), 0)
+    end
+    local fetch_size = opts.fetch_size or 1000
+
+    local key_def = key_def_lib.new(index.parts)
+    local function request(buf, last_tuple)
+        local select_key = key
+        local select_iterator = iterator
+        if last_tuple ~= nil then
+            select_key = key_def:extract_key(last_tuple)
+            select_iterator = next_iterator
+        end
+        return index:select(select_key, {
+            iterator = select_iterator,
+            limit = fetch_size,
+            buffer = buf,
+            skip_header = true,
+            is_async = true,
+        })
+    end
+    return merger.internal.new_prefetch_source(request, fetch_size,
+                                               buffer.ibuf(), buffer.ibuf())
+end
+
 local methods = {
     ['select'] = merger.internal.select,
     ['pairs']  = merger.internal.ipairs,
@@ -41,6 +41,7 @@
 #include "box/tuple_format.h"
 #include "box/lua/tuple.h"
 #include "mpstream/mpstream.h"
+#include "third_party/lua-cjson/lua_cjson.h"
 
 static uint32_t CTID_STRUCT_TUPLE_FORMAT_PTR;
 
@@ -100,10 +101,12 @@ port_msgpack_dump_lua(struct port *base, struct lua_State *L, bool is_flat)
 static int
 lbox_select(lua_State *L)
 {
-	if (lua_gettop(L) != 6 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
-		!lua_isnumber(L, 3) || !lua_isnumber(L, 4) || !lua_isnumber(L, 5)) {
+	int argc = lua_gettop(L);
+	if ((argc != 6 && argc != 7) || !lua_isnumber(L, 1) ||
+	    !lua_isnumber(L, 2) || !lua_isnumber(L, 3) ||
+	    !lua_isnumber(L, 4) || !lua_isnumber(L, 5)) {
 		return luaL_error(L, "Usage index:select(iterator, offset, "
-				  "limit, key)");
+				  "limit, key[, keys_only])");
 	}
 
 	uint32_t space_id = lua_tonumber(L, 1);
@@ -115,11 +118,16 @@ lbox_select(lua_State *L)
 	size_t key_len;
 	const char *key = lbox_encode_tuple_on_gc(L, 6, &key_len);
 
+	bool keys_only = argc == 7 && lua_toboolean(L, 7);
+
 	struct port port;
-	if (box_select(space_id, index_id, iterator, offset, limit,
-		       key, key + key_len, &port) != 0) {
+	int rc = keys_only ?
+		 box_select_keys(space_id, index_id, iterator, offset, limit,
+				 key, key + key_len, &port) :
+		 box_select(space_id, index_id, iterator, offset, limit,
+			    key, key + key_len, &port);
+	if (rc != 0)
 		return luaT_error(L);
-	}
 
 	/*
 	 * Lua may raise an exception during allocating table or pushing
@@ -135,6 +143,114 @@ lbox_select(lua_State *L)
 	return 1; /* lua table with tuples */
 }
 
+struct select_json_ctx {
+	struct port *port;
+	bool use_names;
+};
+
+static int
+lbox_select_json_encode(lua_State *L)
+{
+	struct select_json_ctx *ctx =
+		(struct select_json_ctx *)lua_topointer(L, 1);
+	struct port_c *port = (struct port_c *)ctx->port;
+	json_mp_start();
+	json_mp_append_char('[');
+	for (struct port_c_entry *pe = port->first; pe != NULL;
+	     pe = pe->next) {
+		if (pe != port->first)
+			json_mp_append_char(',');
+		luaT_tuple_append_json(L, pe->tuple, ctx->use_names);
+	}
+	json_mp_append_char(']');
+	return 0;
+}
+
+/**
+ * Like lbox_select(), but returns a JSON array of the selected
+ * tuples encoded straight from MessagePack, see tuple:tojson().
+ */
+static int
+lbox_select_json(lua_State *L)
+{
+	if (lua_gettop(L) != 7 || !lua_isnumber(L, 1) ||
+	    !lua_isnumber(L, 2) || !lua_isnumber(L, 3) ||
+	    !lua_isnumber(L, 4) || !lua_isnumber(L, 5)) {
+		return luaL_error(L, "Usage index:select_json(iterator, "
+				  "offset, limit, key, names)");
+	}
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	int iterator = lua_tonumber(L, 3);
+	uint32_t offset = lua_tonumber(L, 4);
+	uint32_t limit = lua_tonumber(L, 5);
+
+	size_t key_len;
+	const char *key = lbox_encode_tuple_on_gc(L, 6, &key_len);
+
+	struct port port;
+	if (box_select(space_id, index_id, iterator, offset, limit,
+		       key, key + key_len, &port) != 0)
+		return luaT_error(L);
+
+	/*
+	 * Unlike pushing tuples, encoding may fail on malformed
+	 * data, so run it in a protected call not to leak the port.
+	 */
+	struct select_json_ctx ctx;
+	ctx.port = &port;
+	ctx.use_names = lua_toboolean(L, 7);
+	int rc = luaT_cpcall(L, lbox_select_json_encode, &ctx);
+	port_destroy(&port);
+	if (rc != 0)
+		return luaT_error(L);
+	json_mp_push(L);
+	return 1; /* JSON string */
+}
+
+static int
+lbox_get_batch(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2))
+		return luaL_error(L, "Usage index:get_batch(keys)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+
+	size_t keys_len;
+	const char *keys = lbox_encode_tuple_on_gc(L, 3, &keys_len);
+
+	struct port port;
+	if (box_get_batch(space_id, index_id, keys, keys + keys_len,
+			  &port) != 0) {
+		return luaT_error(L);
+	}
+	/* See the comment in lbox_select(). */
+	port_dump_lua(&port, L, false);
+	port_destroy(&port);
+	return 1; /* lua table with tuples */
+}
+
+static int
+lbox_index_split(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) ||
+	    !lua_isnumber(L, 2) || !lua_isnumber(L, 3))
+		return luaL_error(L, "Usage index:split(count)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	uint32_t count = lua_tonumber(L, 3);
+
+	struct port port;
+	if (box_index_split(space_id, index_id, count, &port) != 0)
+		return luaT_error(L);
+	port_dump_lua(&port, L, false);
+	port_destroy(&port);
+	return 1; /* lua table with keys */
+}
+
 /* }}} */
 
 /** {{{ Utils to work with tuple_format. **/
@@ -232,7 +348,7 @@ lbox_tuple_format_new(struct lua_State *L)
 		return luaT_error(L);
 	struct tuple_format *format =
 		tuple_format_new(&tuple_format_runtime->vtab, NULL, NULL, 0,
-				 NULL, 0, 0, dict, false, false);
+				 NULL, 0, 0, dict, false, false, true);
 	/*
 	 * Since dictionary reference counter is 1 from the
 	 * beginning and after creation of the tuple_format
@@ -251,6 +367,9 @@ box_lua_misc_init(struct lua_State *L)
 {
 	static const struct luaL_Reg boxlib_internal[] = {
 		{"select", lbox_select},
+		{"select_json", lbox_select_json},
+		{"get_batch", lbox_get_batch},
+		{"split", lbox_index_split},
 		{"new_tuple_format", lbox_tuple_format_new},
 		{NULL, NULL}
 	};
@@ -33,18 +33,24 @@
 
 #include <small/ibuf.h>
 #include <msgpuck.h> /* mp_store_u32() */
+#include <zstd.h>
 #include "scramble.h"
 
 #include "box/iproto_constants.h"
+#include "box/iproto_shm.h"
 #include "box/lua/tuple.h" /* luamp_convert_tuple() / luamp_convert_key() */
 #include "box/xrow.h"
 #include "box/tuple.h"
 #include "box/execute.h"
 
 #include "lua/msgpack.h"
+#include "lua/utils.h"
 #include "third_party/base64.h"
 
+#include "assoc.h"
 #include "coio.h"
+#include "fiber.h"
+#include "sio.h"
 #include "box/errcode.h"
 #include "lua/fiber.h"
 #include "mpstream/mpstream.h"
@@ -52,6 +58,50 @@
 
 #define cfg luaL_msgpack_default
 
+static const char netbox_zstd_typename[] = "net.box.zstd";
+static const char netbox_shm_typename[] = "net.box.shm";
+static const char netbox_registry_typename[] = "net.box.registry";
+
+static uint32_t CTID_CONST_CHAR_PTR;
+
+/**
+ * Requests of a connection waiting for responses, keyed by
+ * sync. Values are references to the request objects in the
+ * Lua registry, so a request is kept alive until a response
+ * to it is dispatched, it is discarded, or the connection
+ * fails.
+ */
+struct netbox_registry {
+	struct mh_i64ptr_t *requests;
+};
+
+/**
+ * Compression state of a connection, see IPROTO_COMPRESS.
+ * Once the server responds to COMPRESS, communicate() sends
+ * and receives data through this object.
+ */
+struct netbox_zstd {
+	/** Received input which is not decompressed yet. */
+	struct ibuf in;
+	/** Compressed output which is not sent yet. */
+	struct ibuf out;
+	ZSTD_CStream *cstream;
+	ZSTD_DStream *dstream;
+};
+
+enum {
+	/** zstd level used for the connection output. */
+	NETBOX_ZSTD_LEVEL = 1,
+	/** Start size of the compressed data buffers. */
+	NETBOX_ZSTD_BUF_SIZE = 16320,
+	/**
+	 * How often, in seconds, a connection waiting on the
+	 * shared memory rings checks if the server is gone without
+	 * closing them.
+	 */
+	NETBOX_SHM_CHECK_INTERVAL = 1,
+};
+
 static inline size_t
 netbox_prepare_request(lua_State *L, struct mpstream *stream, uint32_t r_type)
 {
@@ -223,17 +273,22 @@ netbox_encode_eval(lua_State *L)
 	return 0;
 }
 
+/**
+ * Encode SELECT or SELECT_OPEN request, they have the same
+ * arguments.
+ */
 static int
-netbox_encode_select(lua_State *L)
+netbox_encode_select_request(lua_State *L, enum iproto_type type)
 {
 	if (lua_gettop(L) < 8) {
-		return luaL_error(L, "Usage netbox.encode_select(ibuf, sync, "
+		return luaL_error(L, "Usage netbox.encode_%s(ibuf, sync, "
 				     "space_id, index_id, iterator, offset, "
-				     "limit, key)");
+				     "limit, key)", type == IPROTO_SELECT ?
+				  "select" : "select_open");
 	}
 
 	struct mpstream stream;
-	size_t svp = netbox_prepare_request(L, &stream, IPROTO_SELECT);
+	size_t svp = netbox_prepare_request(L, &stream, type);
 
 	mpstream_encode_map(&stream, 6);
 
@@ -271,6 +326,98 @@ netbox_encode_select(lua_State *L)
 	return 0;
 }
 
+static int
+netbox_encode_select(lua_State *L)
+{
+	return netbox_encode_select_request(L, IPROTO_SELECT);
+}
+
+static int
+netbox_encode_select_open(lua_State *L)
+{
+	return netbox_encode_select_request(L, IPROTO_SELECT_OPEN);
+}
+
+static int
+netbox_encode_select_fetch(lua_State *L)
+{
+	if (lua_gettop(L) < 4)
+		return luaL_error(L, "Usage: netbox.encode_select_fetch(ibuf, "\
+				  "sync, iterator_id, limit)");
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_SELECT_FETCH);
+
+	mpstream_encode_map(&stream, 2);
+
+	uint32_t iterator_id = lua_tointeger(L, 3);
+	mpstream_encode_uint(&stream, IPROTO_ITERATOR_ID);
+	mpstream_encode_uint(&stream, iterator_id);
+
+	uint32_t limit = lua_tonumber(L, 4);
+	mpstream_encode_uint(&stream, IPROTO_LIMIT);
+	mpstream_encode_uint(&stream, limit);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_select_close(lua_State *L)
+{
+	if (lua_gettop(L) < 3)
+		return luaL_error(L, "Usage: netbox.encode_select_close(ibuf, "\
+				  "sync, iterator_id)");
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_SELECT_CLOSE);
+
+	mpstream_encode_map(&stream, 1);
+
+	uint32_t iterator_id = lua_tointeger(L, 3);
+	mpstream_encode_uint(&stream, IPROTO_ITERATOR_ID);
+	mpstream_encode_uint(&stream, iterator_id);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_get_batch(lua_State *L)
+{
+	if (lua_gettop(L) < 5 || lua_type(L, 5) != LUA_TTABLE) {
+		return luaL_error(L, "Usage netbox.encode_get_batch(ibuf, "
+				     "sync, space_id, index_id, keys)");
+	}
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_GET_BATCH);
+
+	mpstream_encode_map(&stream, 3);
+
+	uint32_t space_id = lua_tonumber(L, 3);
+	uint32_t index_id = lua_tonumber(L, 4);
+
+	/* encode space_id */
+	mpstream_encode_uint(&stream, IPROTO_SPACE_ID);
+	mpstream_encode_uint(&stream, space_id);
+
+	/* encode index_id */
+	mpstream_encode_uint(&stream, IPROTO_INDEX_ID);
+	mpstream_encode_uint(&stream, index_id);
+
+	/* encode keys */
+	mpstream_encode_uint(&stream, IPROTO_KEY);
+	uint32_t key_count = lua_objlen(L, 5);
+	mpstream_encode_array(&stream, key_count);
+	for (uint32_t i = 1; i <= key_count; i++) {
+		lua_rawgeti(L, 5, i);
+		luamp_convert_key(L, cfg, &stream, lua_gettop(L));
+		lua_pop(L, 1);
+	}
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
 static inline int
 netbox_encode_insert_or_replace(lua_State *L, uint32_t reqtype)
 {
@@ -416,6 +563,509 @@ netbox_encode_upsert(lua_State *L)
 	return 0;
 }
 
+/**
+ * Encode the header of a BATCH operation map of @a size keys.
+ */
+static inline void
+netbox_encode_batch_op(struct mpstream *stream, uint32_t size,
+		       uint32_t type, uint32_t space_id)
+{
+	mpstream_encode_map(stream, size);
+	mpstream_encode_uint(stream, IPROTO_REQUEST_TYPE);
+	mpstream_encode_uint(stream, type);
+	mpstream_encode_uint(stream, IPROTO_SPACE_ID);
+	mpstream_encode_uint(stream, space_id);
+}
+
+/**
+ * Encode BATCH request. Each operation is a table
+ * {type, space_id, arg1, arg2}, where type is an IPROTO DML
+ * request type and arguments are:
+ * - INSERT, REPLACE: tuple;
+ * - DELETE: key;
+ * - UPDATE: key, operations;
+ * - UPSERT: tuple, operations.
+ */
+static int
+netbox_encode_batch(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || lua_type(L, 3) != LUA_TTABLE) {
+		return luaL_error(L, "Usage: netbox.encode_batch(ibuf, sync, "
+				     "ops)");
+	}
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_BATCH);
+
+	mpstream_encode_map(&stream, 1);
+	mpstream_encode_uint(&stream, IPROTO_REQUESTS);
+	uint32_t count = lua_objlen(L, 3);
+	mpstream_encode_array(&stream, count);
+	for (uint32_t i = 1; i <= count; i++) {
+		lua_rawgeti(L, 3, i);
+		lua_rawgeti(L, 4, 1);
+		lua_rawgeti(L, 4, 2);
+		lua_rawgeti(L, 4, 3);
+		lua_rawgeti(L, 4, 4);
+		uint32_t type = lua_tonumber(L, 5);
+		uint32_t space_id = lua_tonumber(L, 6);
+		switch (type) {
+		case IPROTO_INSERT:
+		case IPROTO_REPLACE:
+			netbox_encode_batch_op(&stream, 3, type, space_id);
+			mpstream_encode_uint(&stream, IPROTO_TUPLE);
+			luamp_encode_tuple(L, cfg, &stream, 7);
+			break;
+		case IPROTO_DELETE:
+			netbox_encode_batch_op(&stream, 4, type, space_id);
+			mpstream_encode_uint(&stream, IPROTO_INDEX_ID);
+			mpstream_encode_uint(&stream, 0);
+			mpstream_encode_uint(&stream, IPROTO_KEY);
+			luamp_convert_key(L, cfg, &stream, 7);
+			break;
+		case IPROTO_UPDATE:
+			netbox_encode_batch_op(&stream, 6, type, space_id);
+			mpstream_encode_uint(&stream, IPROTO_INDEX_ID);
+			mpstream_encode_uint(&stream, 0);
+			mpstream_encode_uint(&stream, IPROTO_INDEX_BASE);
+			mpstream_encode_uint(&stream, 1);
+			mpstream_encode_uint(&stream, IPROTO_KEY);
+			luamp_convert_key(L, cfg, &stream, 7);
+			/* Legacy: update operations go in IPROTO_TUPLE. */
+			mpstream_encode_uint(&stream, IPROTO_TUPLE);
+			luamp_encode_tuple(L, cfg, &stream, 8);
+			break;
+		case IPROTO_UPSERT:
+			netbox_encode_batch_op(&stream, 5, type, space_id);
+			mpstream_encode_uint(&stream, IPROTO_INDEX_BASE);
+			mpstream_encode_uint(&stream, 1);
+			mpstream_encode_uint(&stream, IPROTO_TUPLE);
+			luamp_encode_tuple(L, cfg, &stream, 7);
+			mpstream_encode_uint(&stream, IPROTO_OPS);
+			luamp_encode_tuple(L, cfg, &stream, 8);
+			break;
+		default:
+			unreachable();
+		}
+		lua_settop(L, 3);
+	}
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_compress(lua_State *L)
+{
+	if (lua_gettop(L) < 3) {
+		return luaL_error(L, "Usage: netbox.encode_compress(ibuf, "
+				     "sync, compression)");
+	}
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_COMPRESS);
+
+	size_t len;
+	const char *compression = lua_tolstring(L, 3, &len);
+	mpstream_encode_map(&stream, 1);
+	mpstream_encode_uint(&stream, IPROTO_COMPRESSION);
+	mpstream_encode_strn(&stream, compression, len);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+/**
+ * new_zstd(recv_buf) -> zstd
+ *
+ * Create the compression state of a connection. The data left
+ * in @a recv_buf after the response to COMPRESS is compressed,
+ * so it is moved to the new object.
+ */
+static int
+netbox_new_zstd(lua_State *L)
+{
+	struct ibuf *recv_buf = (struct ibuf *) lua_topointer(L, 1);
+	struct netbox_zstd *z = (struct netbox_zstd *)
+		lua_newuserdata(L, sizeof(*z));
+	z->cstream = ZSTD_createCStream();
+	z->dstream = ZSTD_createDStream();
+	ibuf_create(&z->in, cord_slab_cache(), NETBOX_ZSTD_BUF_SIZE);
+	ibuf_create(&z->out, cord_slab_cache(), NETBOX_ZSTD_BUF_SIZE);
+	luaL_getmetatable(L, netbox_zstd_typename);
+	lua_setmetatable(L, -2);
+	if (z->cstream == NULL || z->dstream == NULL)
+		return luaL_error(L, "out of memory");
+	size_t rc = ZSTD_initCStream(z->cstream, NETBOX_ZSTD_LEVEL);
+	if (!ZSTD_isError(rc))
+		rc = ZSTD_initDStream(z->dstream);
+	if (ZSTD_isError(rc))
+		return luaL_error(L, "zstd: %s", ZSTD_getErrorName(rc));
+	size_t size = ibuf_used(recv_buf);
+	if (size > 0) {
+		if (ibuf_reserve(&z->in, size) == NULL)
+			return luaL_error(L, "out of memory");
+		memcpy(z->in.wpos, recv_buf->rpos, size);
+		z->in.wpos += size;
+		recv_buf->wpos = recv_buf->rpos;
+	}
+	return 1;
+}
+
+static int
+netbox_zstd_gc(lua_State *L)
+{
+	struct netbox_zstd *z = (struct netbox_zstd *)
+		luaL_checkudata(L, 1, netbox_zstd_typename);
+	ibuf_destroy(&z->in);
+	ibuf_destroy(&z->out);
+	ZSTD_freeCStream(z->cstream);
+	ZSTD_freeDStream(z->dstream);
+	return 0;
+}
+
+/**
+ * Compress everything in @a send_buf to the compressed output
+ * and flush the compressor.
+ */
+static int
+netbox_zstd_compress(struct netbox_zstd *z, struct ibuf *send_buf)
+{
+	size_t out_size = ZSTD_CStreamOutSize();
+	ZSTD_inBuffer src = { send_buf->rpos, ibuf_used(send_buf), 0 };
+	size_t rc;
+	do {
+		if (ibuf_reserve(&z->out, out_size) == NULL)
+			return -1;
+		ZSTD_outBuffer dst = { z->out.wpos, ibuf_unused(&z->out), 0 };
+		if (src.pos < src.size)
+			rc = ZSTD_compressStream(z->cstream, &dst, &src);
+		else
+			rc = ZSTD_flushStream(z->cstream, &dst);
+		if (ZSTD_isError(rc))
+			return -1;
+		z->out.wpos += dst.pos;
+	} while (src.pos < src.size || rc != 0);
+	send_buf->rpos = send_buf->wpos;
+	return 0;
+}
+
+/** Decompress all the received input to @a recv_buf. */
+static int
+netbox_zstd_decompress(struct netbox_zstd *z, struct ibuf *recv_buf)
+{
+	ZSTD_inBuffer src = { z->in.rpos, ibuf_used(&z->in), 0 };
+	size_t out_size = ZSTD_DStreamOutSize();
+	bool is_full;
+	do {
+		if (ibuf_reserve(recv_buf, out_size) == NULL)
+			return -1;
+		ZSTD_outBuffer dst = { recv_buf->wpos,
+				       ibuf_unused(recv_buf), 0 };
+		size_t rc = ZSTD_decompressStream(z->dstream, &dst, &src);
+		if (ZSTD_isError(rc))
+			return -1;
+		recv_buf->wpos += dst.pos;
+		/* The decompressor may have more output. */
+		is_full = dst.pos == dst.size;
+	} while (src.pos < src.size || is_full);
+	ibuf_reset(&z->in);
+	return 0;
+}
+
+static int
+netbox_encode_shm(lua_State *L)
+{
+	if (lua_gettop(L) < 2)
+		return luaL_error(L, "Usage: netbox.encode_shm(ibuf, sync)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_SHM);
+
+	mpstream_encode_map(&stream, 0);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+/**
+ * new_shm([ring_size]) -> shm
+ *
+ * Create the shared memory rings of a connection.
+ */
+static int
+netbox_new_shm(lua_State *L)
+{
+	uint32_t ring_size = 0;
+	if (lua_type(L, 1) == LUA_TNUMBER)
+		ring_size = lua_tointeger(L, 1);
+	struct iproto_shm *shm = (struct iproto_shm *)
+		lua_newuserdata(L, sizeof(*shm));
+	if (iproto_shm_create(shm, ring_size) != 0)
+		return luaT_error(L);
+	luaL_getmetatable(L, netbox_shm_typename);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int
+netbox_shm_gc(lua_State *L)
+{
+	struct iproto_shm *shm = (struct iproto_shm *)
+		luaL_checkudata(L, 1, netbox_shm_typename);
+	if (shm->header != NULL)
+		iproto_shm_close(shm);
+	iproto_shm_destroy(shm);
+	return 0;
+}
+
+/**
+ * send_shm(fd, send_buf, shm) -> errno, error
+ *
+ * Send SHM request encoded in @a send_buf along with the
+ * descriptors of @a shm. The rest of the request, if it
+ * doesn't fit into the socket, is sent by communicate().
+ */
+static int
+netbox_send_shm(lua_State *L)
+{
+	int fd = lua_tointeger(L, 1);
+	struct ibuf *send_buf = (struct ibuf *) lua_topointer(L, 2);
+	struct iproto_shm *shm = (struct iproto_shm *)
+		luaL_checkudata(L, 3, netbox_shm_typename);
+	while (true) {
+		ssize_t rc = sio_write_fds(fd, send_buf->rpos,
+					   ibuf_used(send_buf), shm->fds,
+					   iproto_shm_fd_MAX);
+		if (rc >= 0) {
+			send_buf->rpos += rc;
+			return 0;
+		}
+		if (!sio_wouldblock(errno)) {
+			lua_pushinteger(L, ER_NO_CONNECTION);
+			lua_pushstring(L, strerror(errno));
+			return 2;
+		}
+		coio_wait(fd, EV_WRITE, TIMEOUT_INFINITY);
+		luaL_testcancel(L);
+	}
+}
+
+static struct netbox_registry *
+netbox_check_registry(lua_State *L, int idx)
+{
+	return (struct netbox_registry *)
+		luaL_checkudata(L, idx, netbox_registry_typename);
+}
+
+/** new_registry() -> registry */
+static int
+netbox_new_registry(lua_State *L)
+{
+	struct netbox_registry *registry = (struct netbox_registry *)
+		lua_newuserdata(L, sizeof(*registry));
+	registry->requests = mh_i64ptr_new();
+	if (registry->requests == NULL)
+		return luaL_error(L, "out of memory");
+	luaL_getmetatable(L, netbox_registry_typename);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int
+netbox_registry_gc(lua_State *L)
+{
+	struct netbox_registry *registry = netbox_check_registry(L, 1);
+	struct mh_i64ptr_t *h = registry->requests;
+	if (h == NULL)
+		return 0;
+	mh_int_t k;
+	mh_foreach(h, k) {
+		int ref = (intptr_t) mh_i64ptr_node(h, k)->val;
+		luaL_unref(L, LUA_REGISTRYINDEX, ref);
+	}
+	mh_i64ptr_delete(h);
+	registry->requests = NULL;
+	return 0;
+}
+
+/** registry:add(sync, request) */
+static int
+netbox_registry_add(lua_State *L)
+{
+	struct netbox_registry *registry = netbox_check_registry(L, 1);
+	uint64_t sync = luaL_checkinteger(L, 2);
+	luaL_checktype(L, 3, LUA_TTABLE);
+	lua_pushvalue(L, 3);
+	int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	struct mh_i64ptr_t *h = registry->requests;
+	struct mh_i64ptr_node_t node = { sync, (void *)(intptr_t) ref };
+	struct mh_i64ptr_node_t old, *p_old = &old;
+	if (mh_i64ptr_put(h, &node, &p_old, NULL) == mh_end(h)) {
+		luaL_unref(L, LUA_REGISTRYINDEX, ref);
+		return luaL_error(L, "out of memory");
+	}
+	if (p_old != NULL)
+		luaL_unref(L, LUA_REGISTRYINDEX, (intptr_t) old.val);
+	return 0;
+}
+
+/**
+ * Push the request with the given sync onto the Lua stack and
+ * return true, or return false if there is no such request.
+ * If @a remove is set, the request is removed from @a registry.
+ */
+static bool
+netbox_registry_push(lua_State *L, struct netbox_registry *registry,
+		     uint64_t sync, bool remove)
+{
+	struct mh_i64ptr_t *h = registry->requests;
+	mh_int_t k = mh_i64ptr_find(h, sync, NULL);
+	if (k == mh_end(h))
+		return false;
+	int ref = (intptr_t) mh_i64ptr_node(h, k)->val;
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+	if (remove) {
+		mh_i64ptr_del(h, k, NULL);
+		luaL_unref(L, LUA_REGISTRYINDEX, ref);
+	}
+	return true;
+}
+
+/** registry:get(sync) -> request or nil */
+static int
+netbox_registry_get(lua_State *L)
+{
+	struct netbox_registry *registry = netbox_check_registry(L, 1);
+	uint64_t sync = luaL_checkinteger(L, 2);
+	if (!netbox_registry_push(L, registry, sync, false))
+		lua_pushnil(L);
+	return 1;
+}
+
+/** registry:remove(sync) -> request or nil */
+static int
+netbox_registry_remove(lua_State *L)
+{
+	struct netbox_registry *registry = netbox_check_registry(L, 1);
+	uint64_t sync = luaL_checkinteger(L, 2);
+	if (!netbox_registry_push(L, registry, sync, true))
+		lua_pushnil(L);
+	return 1;
+}
+
+/**
+ * registry:reset() -> {request, ...}
+ *
+ * Remove all requests from the registry and return them.
+ */
+static int
+netbox_registry_reset(lua_State *L)
+{
+	struct netbox_registry *registry = netbox_check_registry(L, 1);
+	struct mh_i64ptr_t *h = registry->requests;
+	lua_createtable(L, mh_size(h), 0);
+	int i = 0;
+	mh_int_t k;
+	mh_foreach(h, k) {
+		int ref = (intptr_t) mh_i64ptr_node(h, k)->val;
+		lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+		lua_rawseti(L, -2, ++i);
+		luaL_unref(L, LUA_REGISTRYINDEX, ref);
+	}
+	mh_i64ptr_clear(h);
+	return 1;
+}
+
+/**
+ * dispatch(registry, recv_buf, handler, schema_version)
+ *  -> size
+ *  -> nil, new_schema_version
+ *
+ * Dispatch all the complete responses in @a recv_buf. For
+ * every response to a request found in @a registry, call
+ * handler(request, status, body_rpos, body_end). A request is
+ * removed from the registry unless the response is a push.
+ *
+ * Stop after a response with a schema version different from
+ * @a schema_version and return the new version. Otherwise
+ * return the size @a recv_buf must have to contain the next
+ * response.
+ */
+static int
+netbox_dispatch(lua_State *L)
+{
+	struct netbox_registry *registry = netbox_check_registry(L, 1);
+	struct ibuf *recv_buf = (struct ibuf *) lua_topointer(L, 2);
+	luaL_checktype(L, 3, LUA_TFUNCTION);
+	uint64_t schema_version = lua_tointeger(L, 4);
+	while (true) {
+		const char *rpos = recv_buf->rpos;
+		const char *wpos = recv_buf->wpos;
+		/* Length is encoded as MP_UINT32 by the server. */
+		if (wpos - rpos < 5) {
+			lua_pushinteger(L, 5);
+			return 1;
+		}
+		const char *data = rpos;
+		if (mp_typeof(*data) != MP_UINT)
+			return luaL_error(L, "Invalid response length");
+		ptrdiff_t missing = mp_check_uint(rpos, wpos);
+		if (missing > 0) {
+			lua_pushinteger(L, (wpos - rpos) + missing);
+			return 1;
+		}
+		uint32_t len = mp_decode_uint(&data);
+		size_t required = (data - rpos) + len;
+		if ((size_t)(wpos - rpos) < required) {
+			lua_pushinteger(L, required);
+			return 1;
+		}
+		const char *body_end = data + len;
+		const char *p = data;
+		if (mp_typeof(*data) != MP_MAP || mp_check(&p, body_end) != 0)
+			return luaL_error(L, "Invalid response header");
+		uint64_t status = 0, sync = 0, version = 0;
+		uint32_t size = mp_decode_map(&data);
+		for (uint32_t i = 0; i < size; i++) {
+			if (mp_typeof(*data) != MP_UINT) {
+				mp_next(&data);
+				mp_next(&data);
+				continue;
+			}
+			uint64_t key = mp_decode_uint(&data);
+			if (mp_typeof(*data) != MP_UINT) {
+				mp_next(&data);
+				continue;
+			}
+			uint64_t value = mp_decode_uint(&data);
+			if (key == IPROTO_REQUEST_TYPE)
+				status = value;
+			else if (key == IPROTO_SYNC)
+				sync = value;
+			else if (key == IPROTO_SCHEMA_VERSION)
+				version = value;
+		}
+		recv_buf->rpos = (char *) body_end;
+		if (netbox_registry_push(L, registry, sync,
+					 status != IPROTO_CHUNK)) {
+			lua_pushvalue(L, 3);
+			lua_insert(L, -2);
+			lua_pushinteger(L, status);
+			*(const char **) luaL_pushcdata(L, CTID_CONST_CHAR_PTR) =
+				data;
+			*(const char **) luaL_pushcdata(L, CTID_CONST_CHAR_PTR) =
+				body_end;
+			lua_call(L, 4, 0);
+		}
+		if (version > 0 && version != schema_version) {
+			lua_pushnil(L);
+			lua_pushinteger(L, version);
+			return 2;
+		}
+	}
+}
+
 static int
 netbox_decode_greeting(lua_State *L)
 {
@@ -451,7 +1101,113 @@ netbox_decode_greeting(lua_State *L)
 }
 
 /**
- * communicate(fd, send_buf, recv_buf, limit_or_boundary, timeout)
+ * Push the result of communicate() if @a recv_buf has @a limit
+ * bytes or @a boundary in it.
+ * @return the number of pushed values, 0 if more data is needed.
+ */
+static int
+netbox_communicate_check(lua_State *L, struct ibuf *recv_buf, size_t limit,
+			 const void *boundary, size_t boundary_len)
+{
+	if (ibuf_used(recv_buf) >= limit) {
+		lua_pushnil(L);
+		lua_pushinteger(L, (lua_Integer)limit);
+		return 2;
+	}
+	const char *p;
+	if (boundary != NULL && (p = memmem(
+				recv_buf->rpos,
+				ibuf_used(recv_buf),
+				boundary, boundary_len)) != NULL) {
+		lua_pushnil(L);
+		lua_pushinteger(L, (lua_Integer)(
+				p - recv_buf->rpos));
+		return 2;
+	}
+	return 0;
+}
+
+/**
+ * communicate() through the shared memory rings. The eventfd
+ * the server wakes us up with is waited on instead of @a fd,
+ * which is only checked for the server being gone.
+ */
+static int
+netbox_communicate_shm(lua_State *L, int fd, struct iproto_shm *shm,
+		       struct ibuf *send_buf, struct ibuf *recv_buf,
+		       size_t limit, const void *boundary,
+		       size_t boundary_len, ev_tstamp timeout)
+{
+	const int NETBOX_READAHEAD = 16320;
+	while (true) {
+		ssize_t rc;
+		do {
+			if (ibuf_reserve(recv_buf, NETBOX_READAHEAD) == NULL)
+				luaL_error(L, "out of memory");
+			rc = iproto_shm_read(shm, recv_buf->wpos,
+					     ibuf_unused(recv_buf));
+			if (rc < 0)
+				goto shm_error;
+			recv_buf->wpos += rc;
+		} while (rc > 0);
+		int nret = netbox_communicate_check(L, recv_buf, limit,
+						    boundary, boundary_len);
+		if (nret != 0)
+			return nret;
+		if (ibuf_used(send_buf) != 0) {
+			struct iovec iov = { send_buf->rpos,
+					     ibuf_used(send_buf) };
+			rc = iproto_shm_writev(shm, &iov, 1);
+			if (rc < 0)
+				goto shm_error;
+			send_buf->rpos += rc;
+		}
+		if (iproto_shm_is_closed(shm)) {
+			lua_pushinteger(L, ER_NO_CONNECTION);
+			lua_pushstring(L, "Peer closed");
+			return 2;
+		}
+		if (!iproto_shm_wait_read(shm) ||
+		    (ibuf_used(send_buf) != 0 && !iproto_shm_wait_write(shm)))
+			continue;
+
+		ev_tstamp deadline = ev_monotonic_now(loop()) + timeout;
+		int revents = coio_wait(shm->wait_fd, EV_READ,
+					MIN(timeout, NETBOX_SHM_CHECK_INTERVAL));
+		luaL_testcancel(L);
+		timeout = deadline - ev_monotonic_now(loop());
+		timeout = MAX(0.0, timeout);
+		if (revents != 0) {
+			iproto_shm_clear_wakeup(shm);
+			continue;
+		}
+		if (timeout == 0.0) {
+			lua_pushinteger(L, ER_TIMEOUT);
+			lua_pushstring(L, "Timeout exceeded");
+			return 2;
+		}
+		char c;
+		rc = recv(fd, &c, sizeof(c), MSG_PEEK | MSG_DONTWAIT);
+		if (rc == 0) {
+			lua_pushinteger(L, ER_NO_CONNECTION);
+			lua_pushstring(L, "Peer closed");
+			return 2;
+		}
+		if (rc < 0 && !sio_wouldblock(errno) && errno != EINTR) {
+			lua_pushinteger(L, ER_NO_CONNECTION);
+			lua_pushstring(L, strerror(errno));
+			return 2;
+		}
+	}
+shm_error:
+	lua_pushinteger(L, ER_NO_CONNECTION);
+	lua_pushstring(L, "Shared memory ring is corrupted");
+	return 2;
+}
+
+/**
+ * communicate(fd, send_buf, recv_buf, limit_or_boundary, timeout[, zstd
+ *             [, shm]])
  *  -> errno, error
  *  -> nil, limit/boundary_pos
  *
@@ -463,6 +1219,11 @@ netbox_decode_greeting(lua_State *L)
  * Instead, this function takes an fd, input and output buffer,
  * and does sending and receiving on it in a single event loop
  * interaction.
+ *
+ * If the connection is compressed, the output is compressed and
+ * the input is decompressed through @a zstd object. If it uses
+ * the shared memory transport, the data goes through @a shm
+ * object rather than @a fd.
  */
 static int
 netbox_communicate(lua_State *L)
@@ -491,38 +1252,53 @@ netbox_communicate(lua_State *L)
 		lua_pushstring(L, "Timeout exceeded");
 		return 2;
 	}
+
+	/* shared memory */
+	if (!lua_isnoneornil(L, 7)) {
+		struct iproto_shm *shm = (struct iproto_shm *)
+			luaL_checkudata(L, 7, netbox_shm_typename);
+		return netbox_communicate_shm(L, fd, shm, send_buf, recv_buf,
+					      limit, boundary, boundary_len,
+					      timeout);
+	}
+
+	/* compression */
+	struct netbox_zstd *z = NULL;
+	struct ibuf *in = recv_buf;
+	struct ibuf *out = send_buf;
+	if (!lua_isnoneornil(L, 6)) {
+		z = (struct netbox_zstd *)
+			luaL_checkudata(L, 6, netbox_zstd_typename);
+		in = &z->in;
+		out = &z->out;
+		if (ibuf_used(in) != 0 &&
+		    netbox_zstd_decompress(z, recv_buf) != 0)
+			goto zstd_error;
+	}
 	int revents = COIO_READ;
+	int nret;
 	while (true) {
 		/* reader serviced first */
 check_limit:
-		if (ibuf_used(recv_buf) >= limit) {
-			lua_pushnil(L);
-			lua_pushinteger(L, (lua_Integer)limit);
-			return 2;
-		}
-		const char *p;
-		if (boundary != NULL && (p = memmem(
-					recv_buf->rpos,
-					ibuf_used(recv_buf),
-					boundary, boundary_len)) != NULL) {
-			lua_pushnil(L);
-			lua_pushinteger(L, (lua_Integer)(
-					p - recv_buf->rpos));
-			return 2;
-		}
+		nret = netbox_communicate_check(L, recv_buf, limit,
+						    boundary, boundary_len);
+		if (nret != 0)
+			return nret;
 
 		while (revents & COIO_READ) {
-			void *p = ibuf_reserve(recv_buf, NETBOX_READAHEAD);
+			void *p = ibuf_reserve(in, NETBOX_READAHEAD);
 			if (p == NULL)
 				luaL_error(L, "out of memory");
-			ssize_t rc = recv(
-				fd, recv_buf->wpos, ibuf_unused(recv_buf), 0);
+			ssize_t rc = recv(fd, in->wpos, ibuf_unused(in), 0);
 			if (rc == 0) {
 				lua_pushinteger(L, ER_NO_CONNECTION);
 				lua_pushstring(L, "Peer closed");
 				return 2;
 			} if (rc > 0) {
-				recv_buf->wpos += rc;
+				in->wpos += rc;
+				if (z != NULL &&
+				    netbox_zstd_decompress(z, recv_buf) != 0)
+					goto zstd_error;
 				goto check_limit;
 			} else if (errno == EAGAIN || errno == EWOULDBLOCK)
 				revents &= ~COIO_READ;
@@ -530,11 +1306,16 @@ check_limit:
 				goto handle_error;
 		}
 
-		while ((revents & COIO_WRITE) && ibuf_used(send_buf) != 0) {
-			ssize_t rc = send(
-				fd, send_buf->rpos, ibuf_used(send_buf), 0);
+		if (z != NULL && ibuf_used(send_buf) != 0) {
+			if (ibuf_used(out) == 0)
+				ibuf_reset(out);
+			if (netbox_zstd_compress(z, send_buf) != 0)
+				goto zstd_error;
+		}
+		while ((revents & COIO_WRITE) && ibuf_used(out) != 0) {
+			ssize_t rc = send(fd, out->rpos, ibuf_used(out), 0);
 			if (rc >= 0)
-				send_buf->rpos += rc;
+				out->rpos += rc;
 			else if (errno == EAGAIN || errno == EWOULDBLOCK)
 				revents &= ~COIO_WRITE;
 			else if (errno != EINTR)
@@ -542,7 +1323,7 @@ check_limit:
 		}
 
 		ev_tstamp deadline = ev_monotonic_now(loop()) + timeout;
-		revents = coio_wait(fd, EV_READ | (ibuf_used(send_buf) != 0 ?
+		revents = coio_wait(fd, EV_READ | (ibuf_used(out) != 0 ?
 				EV_WRITE : 0), timeout);
 		luaL_testcancel(L);
 		timeout = deadline - ev_monotonic_now(loop());
@@ -557,6 +1338,10 @@ handle_error:
 	lua_pushinteger(L, ER_NO_CONNECTION);
 	lua_pushstring(L, strerror(errno));
 	return 2;
+zstd_error:
+	lua_pushinteger(L, ER_NO_CONNECTION);
+	lua_pushstring(L, "Compressed stream error");
+	return 2;
 }
 
 static int
@@ -564,11 +1349,13 @@ netbox_encode_execute(lua_State *L)
 {
 	if (lua_gettop(L) < 5)
 		return luaL_error(L, "Usage: netbox.encode_execute(ibuf, "\
-				  "sync, query, parameters, options)");
+				  "sync, query, parameters, options, "\
+				  "[fetch_size])");
 	struct mpstream stream;
 	size_t svp = netbox_prepare_request(L, &stream, IPROTO_EXECUTE);
 
-	mpstream_encode_map(&stream, 3);
+	uint32_t fetch_size = lua_isnoneornil(L, 6) ? 0 : lua_tointeger(L, 6);
+	mpstream_encode_map(&stream, fetch_size > 0 ? 4 : 3);
 
 	if (lua_type(L, 3) == LUA_TNUMBER) {
 		uint32_t query_id = lua_tointeger(L, 3);
@@ -587,6 +1374,34 @@ netbox_encode_execute(lua_State *L)
 	mpstream_encode_uint(&stream, IPROTO_OPTIONS);
 	luamp_encode_tuple(L, cfg, &stream, 5);
 
+	if (fetch_size > 0) {
+		mpstream_encode_uint(&stream, IPROTO_SQL_FETCH_SIZE);
+		mpstream_encode_uint(&stream, fetch_size);
+	}
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_fetch(lua_State *L)
+{
+	if (lua_gettop(L) < 4)
+		return luaL_error(L, "Usage: netbox.encode_fetch(ibuf, "\
+				  "sync, cursor_id, fetch_size)");
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_FETCH);
+
+	mpstream_encode_map(&stream, 2);
+
+	uint32_t cursor_id = lua_tointeger(L, 3);
+	mpstream_encode_uint(&stream, IPROTO_SQL_CURSOR_ID);
+	mpstream_encode_uint(&stream, cursor_id);
+
+	uint32_t fetch_size = lua_tointeger(L, 4);
+	mpstream_encode_uint(&stream, IPROTO_SQL_FETCH_SIZE);
+	mpstream_encode_uint(&stream, fetch_size);
+
 	netbox_encode_request(&stream, svp);
 	return 0;
 }
@@ -670,6 +1485,78 @@ netbox_decode_select(struct lua_State *L)
 	return 2;
 }
 
+/**
+ * Decode a response to BATCH into an array of results. A result
+ * is a tuple or box.NULL, if the operation returned nothing.
+ * @param Lua stack[1] Raw MessagePack pointer.
+ * @retval Results array and position of the body end.
+ */
+static int
+netbox_decode_batch(struct lua_State *L)
+{
+	uint32_t ctypeid;
+	const char *data = *(const char **)luaL_checkcdata(L, 1, &ctypeid);
+	assert(mp_typeof(*data) == MP_MAP);
+	uint32_t map_size = mp_decode_map(&data);
+	assert(map_size == 1);
+	(void) map_size;
+	uint32_t key = mp_decode_uint(&data);
+	assert(key == IPROTO_DATA);
+	(void) key;
+	uint32_t count = mp_decode_array(&data);
+	lua_createtable(L, count, 0);
+	for (uint32_t i = 0; i < count; ++i) {
+		const char *begin = data;
+		mp_next(&data);
+		if (mp_typeof(*begin) == MP_NIL) {
+			luaL_pushnull(L);
+		} else {
+			struct tuple *tuple =
+				box_tuple_new(tuple_format_runtime,
+					      begin, data);
+			if (tuple == NULL)
+				luaT_error(L);
+			luaT_pushtuple(L, tuple);
+		}
+		lua_rawseti(L, -2, i + 1);
+	}
+	*(const char **)luaL_pushcdata(L, ctypeid) = data;
+	return 2;
+}
+
+/**
+ * Decode a response to SELECT_OPEN or SELECT_FETCH into a table
+ * {tuples = {...}, iterator_id = <number or nil>}.
+ */
+static int
+netbox_decode_select_open(struct lua_State *L)
+{
+	uint32_t ctypeid;
+	assert(lua_gettop(L) == 3);
+	struct tuple_format *format;
+	if (lua_type(L, 3) == LUA_TCDATA)
+		format = lbox_check_tuple_format(L, 3);
+	else
+		format = tuple_format_runtime;
+	const char *data = *(const char **)luaL_checkcdata(L, 1, &ctypeid);
+	assert(mp_typeof(*data) == MP_MAP);
+	uint32_t map_size = mp_decode_map(&data);
+	lua_createtable(L, 0, 2);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		uint32_t key = mp_decode_uint(&data);
+		if (key == IPROTO_ITERATOR_ID) {
+			luaL_pushuint64(L, mp_decode_uint(&data));
+			lua_setfield(L, -2, "iterator_id");
+		} else {
+			assert(key == IPROTO_DATA);
+			netbox_decode_data(L, &data, format);
+			lua_setfield(L, -2, "tuples");
+		}
+	}
+	*(const char **)luaL_pushcdata(L, ctypeid) = data;
+	return 2;
+}
+
 /** Decode optional (i.e. may be present in response) metadata fields. */
 static void
 decode_metadata_optional(struct lua_State *L, const char **data,
@@ -793,7 +1680,7 @@ netbox_decode_execute(struct lua_State *L)
 	const char *data = *(const char **)luaL_checkcdata(L, 1, &ctypeid);
 	assert(mp_typeof(*data) == MP_MAP);
 	uint32_t map_size = mp_decode_map(&data);
-	int rows_index = 0, meta_index = 0, info_index = 0;
+	int rows_index = 0, meta_index = 0, info_index = 0, cursor_index = 0;
 	for (uint32_t i = 0; i < map_size; ++i) {
 		uint32_t key = mp_decode_uint(&data);
 		switch(key) {
@@ -805,6 +1692,10 @@ netbox_decode_execute(struct lua_State *L)
 			netbox_decode_metadata(L, &data);
 			meta_index = i - map_size;
 			break;
+		case IPROTO_SQL_CURSOR_ID:
+			luaL_pushuint64(L, mp_decode_uint(&data));
+			cursor_index = i - map_size;
+			break;
 		default:
 			assert(key == IPROTO_SQL_INFO);
 			netbox_decode_sql_info(L, &data);
@@ -813,16 +1704,23 @@ netbox_decode_execute(struct lua_State *L)
 		}
 	}
 	if (info_index == 0) {
-		assert(meta_index != 0);
+		/* Response to FETCH has no metadata. */
 		assert(rows_index != 0);
-		lua_createtable(L, 0, 2);
-		lua_pushvalue(L, meta_index - 1);
-		lua_setfield(L, -2, "metadata");
+		lua_createtable(L, 0, 3);
+		if (meta_index != 0) {
+			lua_pushvalue(L, meta_index - 1);
+			lua_setfield(L, -2, "metadata");
+		}
 		lua_pushvalue(L, rows_index - 1);
 		lua_setfield(L, -2, "rows");
+		if (cursor_index != 0) {
+			lua_pushvalue(L, cursor_index - 1);
+			lua_setfield(L, -2, "cursor_id");
+		}
 	} else {
 		assert(meta_index == 0);
 		assert(rows_index == 0);
+		assert(cursor_index == 0);
 	}
 	*(const char **)luaL_pushcdata(L, ctypeid) = data;
 	return 2;
@@ -893,21 +1791,57 @@ luaopen_net_box(struct lua_State *L)
 		{ "encode_call",    netbox_encode_call },
 		{ "encode_eval",    netbox_encode_eval },
 		{ "encode_select",  netbox_encode_select },
+		{ "encode_get_batch", netbox_encode_get_batch },
 		{ "encode_insert",  netbox_encode_insert },
 		{ "encode_replace", netbox_encode_replace },
 		{ "encode_delete",  netbox_encode_delete },
 		{ "encode_update",  netbox_encode_update },
 		{ "encode_upsert",  netbox_encode_upsert },
+		{ "encode_batch",   netbox_encode_batch },
 		{ "encode_execute", netbox_encode_execute},
 		{ "encode_prepare", netbox_encode_prepare},
+		{ "encode_fetch",   netbox_encode_fetch},
+		{ "encode_select_open", netbox_encode_select_open },
+		{ "encode_select_fetch", netbox_encode_select_fetch },
+		{ "encode_select_close", netbox_encode_select_close },
 		{ "encode_auth",    netbox_encode_auth },
+		{ "encode_compress", netbox_encode_compress },
+		{ "new_zstd",       netbox_new_zstd },
+		{ "encode_shm",     netbox_encode_shm },
+		{ "new_shm",        netbox_new_shm },
+		{ "send_shm",       netbox_send_shm },
 		{ "decode_greeting",netbox_decode_greeting },
 		{ "communicate",    netbox_communicate },
 		{ "decode_select",  netbox_decode_select },
+		{ "decode_batch",   netbox_decode_batch },
 		{ "decode_execute", netbox_decode_execute },
 		{ "decode_prepare", netbox_decode_prepare },
+		{ "decode_select_open", netbox_decode_select_open },
+		{ "new_registry",   netbox_new_registry },
+		{ "dispatch",       netbox_dispatch },
 		{ NULL, NULL}
 	};
+	static const struct luaL_Reg netbox_zstd_meta[] = {
+		{ "__gc", netbox_zstd_gc },
+		{ NULL, NULL }
+	};
+	luaL_register_type(L, netbox_zstd_typename, netbox_zstd_meta);
+	static const struct luaL_Reg netbox_shm_meta[] = {
+		{ "__gc", netbox_shm_gc },
+		{ NULL, NULL }
+	};
+	luaL_register_type(L, netbox_shm_typename, netbox_shm_meta);
+	static const struct luaL_Reg netbox_registry_meta[] = {
+		{ "__gc", netbox_registry_gc },
+		{ "add", netbox_registry_add },
+		{ "get", netbox_registry_get },
+		{ "remove", netbox_registry_remove },
+		{ "reset", netbox_registry_reset },
+		{ NULL, NULL }
+	};
+	luaL_register_type(L, netbox_registry_typename, netbox_registry_meta);
+	CTID_CONST_CHAR_PTR = luaL_ctypeid(L, "const char *");
+
 	/* luaL_register_module polutes _G */
 	lua_newtable(L);
 	luaL_openlib(L, NULL, net_box_lib, 0);
@@ -15,6 +15,7 @@ local fiber_clock       = fiber.clock
 local fiber_self        = fiber.self
 local decode            = msgpack.decode_unchecked
 local decode_map_header = msgpack.decode_map_header
+local object_from_raw   = msgpack.object_from_raw
 local buffer_reg        = buffer.reg1
 
 local table_new           = require('table.new')
@@ -25,6 +26,13 @@ local check_primary_index = box.internal.check_primary_index
 
 local communicate     = internal.communicate
 local encode_auth     = internal.encode_auth
+local encode_compress = internal.encode_compress
+local new_zstd        = internal.new_zstd
+local encode_shm      = internal.encode_shm
+local new_shm         = internal.new_shm
+local send_shm        = internal.send_shm
+local new_registry    = internal.new_registry
+local dispatch        = internal.dispatch
 local encode_select   = internal.encode_select
 local decode_greeting = internal.decode_greeting
 
@@ -45,6 +53,15 @@ local IPROTO_GREETING_SIZE = 128
 local IPROTO_CHUNK_KEY     = 128
 local IPROTO_OK_KEY        = 0
 
+-- DML request types allowed in a transaction sent in one request
+local IPROTO_TXN_OP = {
+    insert  = 2,
+    replace = 3,
+    update  = 4,
+    delete  = 5,
+    upsert  = 9,
+}
+
 -- select errors from box.error
 local E_UNKNOWN              = box.error.UNKNOWN
 local E_NO_CONNECTION        = box.error.NO_CONNECTION
@@ -112,7 +129,13 @@ local method_encoder = {
     execute = internal.encode_execute,
     prepare = internal.encode_prepare,
     unprepare = internal.encode_prepare,
+    fetch   = internal.encode_fetch,
     get     = internal.encode_select,
+    get_batch = internal.encode_get_batch,
+    atomic  = internal.encode_batch,
+    select_open = internal.encode_select_open,
+    select_fetch = internal.encode_select_fetch,
+    select_close = internal.encode_select_close,
     min     = internal.encode_select,
     max     = internal.encode_select,
     count   = internal.encode_call,
@@ -138,7 +161,13 @@ local method_decoder = {
     execute = internal.decode_execute,
     prepare = internal.decode_prepare,
     unprepare = decode_nil,
+    fetch   = internal.decode_execute,
     get     = decode_get,
+    get_batch = internal.decode_select,
+    atomic  = internal.decode_batch,
+    select_open = internal.decode_select_open,
+    select_fetch = internal.decode_select_open,
+    select_close = decode_nil,
     min     = decode_get,
     max     = decode_get,
     count   = decode_count,
@@ -273,19 +302,25 @@ local function create_transport(host, port, user, password, callback,
     local state_cond       = fiber.cond() -- signaled when the state changes
 
     -- Async requests currently 'in flight', keyed by a request
-    -- id. Value refs are weak hence if a client dies
-    -- unexpectedly, GC cleans the mess.
+    -- id. The registry is kept in C, so that responses are
+    -- matched to requests without leaving the dispatch loop.
+    -- A request is referenced until a response to it arrives,
+    -- it is discarded or the connection fails.
     -- Async request can not be timed out completely. Instead a
     -- user must decide when he does not want to wait for
     -- response anymore.
     -- Sync requests are implemented as async call + immediate
     -- wait for a result.
-    local requests         = setmetatable({}, { __mode = 'v' })
+    local requests         = new_registry()
     local next_request_id  = 1
 
     local worker_fiber
     local send_buf         = buffer.ibuf(buffer.READAHEAD)
     local recv_buf         = buffer.ibuf(buffer.READAHEAD)
+    -- Compression state, set once the server accepts COMPRESS.
+    local zstd
+    -- Shared memory rings, set once the server accepts SHM.
+    local shm
 
     --
     -- Async request metamethods.
@@ -430,7 +465,7 @@ local function create_transport(host, port, user, password, callback,
     --
     function request_index:discard()
         if self.id then
-            requests[self.id] = nil
+            requests:remove(self.id)
             self.id = nil
             self.errno = box.error.PROC_LUA
             self.response = 'Response is discarded'
@@ -448,13 +483,12 @@ local function create_transport(host, port, user, password, callback,
         state_cond:broadcast()
         if state == 'error' or state == 'error_reconnect' or
            state == 'closed' then
-            for _, request in pairs(requests) do
+            for _, request in ipairs(requests:reset()) do
                 request.id = nil
                 request.errno = new_errno
                 request.response = new_error
                 request.cond:broadcast()
             end
-            requests = {}
         end
     end
 
@@ -514,6 +548,8 @@ local function create_transport(host, port, user, password, callback,
     ::stop::
             send_buf:recycle()
             recv_buf:recycle()
+            zstd = nil
+            shm = nil
             worker_fiber = nil
         end)
     end
@@ -529,23 +565,14 @@ local function create_transport(host, port, user, password, callback,
     end
 
     --
-    -- Send a request and do not wait for response.
-    -- @retval nil, error Error occured.
-    -- @retval not nil Future object.
+    -- Encode a request to @a buf and create a future object for
+    -- it. The request isn't registered, so a response to it is
+    -- ignored until it is passed to perform_batch().
     --
-    local function perform_async_request(buffer, skip_header, method, on_push,
-                                         on_push_ctx, request_ctx, ...)
-        if state ~= 'active' and state ~= 'fetch_schema' then
-            return nil, box.error.new({code = last_errno or E_NO_CONNECTION,
-                                       reason = last_error})
-        end
-        -- alert worker to notify it of the queued outgoing data;
-        -- if the buffer wasn't empty, assume the worker was already alerted
-        if send_buf:size() == 0 then
-            worker_fiber:wakeup()
-        end
+    local function prepare_request(buf, buffer, skip_header, method, on_push,
+                                   on_push_ctx, request_ctx, ...)
         local id = next_request_id
-        method_encoder[method](send_buf, id, ...)
+        method_encoder[method](buf, id, ...)
         next_request_id = next_id(id)
         -- Request in most cases has maximum 10 members:
         -- method, buffer, skip_header, id, cond, errno, response,
@@ -556,13 +583,60 @@ local function create_transport(host, port, user, password, callback,
         request.skip_header = skip_header
         request.id = id
         request.cond = fiber.cond()
-        requests[id] = request
         request.on_push = on_push
         request.on_push_ctx = on_push_ctx
         request.ctx = request_ctx
         return request
     end
 
+    local function check_can_send()
+        if state ~= 'active' and state ~= 'fetch_schema' then
+            return box.error.new({code = last_errno or E_NO_CONNECTION,
+                                  reason = last_error})
+        end
+        -- alert worker to notify it of the queued outgoing data;
+        -- if the buffer wasn't empty, assume the worker was already alerted
+        if send_buf:size() == 0 then
+            worker_fiber:wakeup()
+        end
+    end
+
+    --
+    -- Send a request and do not wait for response.
+    -- @retval nil, error Error occured.
+    -- @retval not nil Future object.
+    --
+    local function perform_async_request(buffer, skip_header, method, on_push,
+                                         on_push_ctx, request_ctx, ...)
+        local err = check_can_send()
+        if err then
+            return nil, err
+        end
+        local request = prepare_request(send_buf, buffer, skip_header, method,
+                                        on_push, on_push_ctx, request_ctx, ...)
+        requests:add(request.id, request)
+        return request
+    end
+
+    --
+    -- Send requests prepared with prepare_request() to @a buf
+    -- at once and do not wait for responses.
+    -- @retval nil, error Error occured.
+    -- @retval not nil Array of future objects.
+    --
+    local function perform_batch(buf, batch)
+        local err = check_can_send()
+        if err then
+            return nil, err
+        end
+        local len = buf:size()
+        ffi.copy(send_buf:alloc(len), buf.rpos, len)
+        for _, request in ipairs(batch) do
+            requests:add(request.id, request)
+        end
+        return batch
+    end
+
     --
     -- Send a request and wait for response.
     -- @retval nil, error Error occured.
@@ -579,19 +653,17 @@ local function create_transport(host, port, user, password, callback,
         return request:wait_result(timeout)
     end
 
-    local function dispatch_response_iproto(hdr, body_rpos, body_end)
-        local id = hdr[IPROTO_SYNC_KEY]
-        local request = requests[id]
-        if request == nil then -- nobody is waiting for the response
-            return
-        end
-        local status = hdr[IPROTO_STATUS_KEY]
+    --
+    -- Complete a request or handle a push to it. The request is
+    -- expected to be removed from the registry by the caller
+    -- unless the response is a push.
+    --
+    local function dispatch_response(request, status, body_rpos, body_end)
         local body
         local body_len = body_end - body_rpos
 
         if status > IPROTO_CHUNK_KEY then
             -- Handle errors
-            requests[id] = nil
             request.id = nil
             local map_len, key
             map_len, body_rpos = decode_map_header(body_rpos, body_len)
@@ -643,7 +715,6 @@ local function create_transport(host, port, user, password, callback,
             body_len = tonumber(body_len)
             if status == IPROTO_OK_KEY then
                 request.response = body_len
-                requests[id] = nil
                 request.id = nil
             else
                 request.on_push(request.on_push_ctx, body_len)
@@ -652,13 +723,27 @@ local function create_transport(host, port, user, password, callback,
             return
         end
 
+        if request.return_raw then
+            -- Wrap xrow.body[DATA] into a lazily decoded object
+            -- without converting it to Lua tables.
+            local body_obj = object_from_raw(body_rpos, tonumber(body_len))
+            local data = body_obj:get(IPROTO_DATA_KEY)
+            if status == IPROTO_OK_KEY then
+                request.response = data
+                request.id = nil
+            else
+                request.on_push(request.on_push_ctx, data)
+            end
+            request.cond:broadcast()
+            return
+        end
+
         local real_end
         -- Decode xrow.body[DATA] to Lua objects
         if status == IPROTO_OK_KEY then
             request.response, real_end, request.errno =
                 method_decoder[request.method](body_rpos, body_end, request.ctx)
             assert(real_end == body_end, "invalid body length")
-            requests[id] = nil
             request.id = nil
         else
             local msg
@@ -670,6 +755,21 @@ local function create_transport(host, port, user, password, callback,
         request.cond:broadcast()
     end
 
+    local function dispatch_response_iproto(hdr, body_rpos, body_end)
+        local id = hdr[IPROTO_SYNC_KEY]
+        local status = hdr[IPROTO_STATUS_KEY]
+        local request
+        if status == IPROTO_CHUNK_KEY then
+            request = requests:get(id)
+        else
+            request = requests:remove(id)
+        end
+        if request == nil then -- nobody is waiting for the response
+            return
+        end
+        dispatch_response(request, status, body_rpos, body_end)
+    end
+
     local function new_request_id()
         local id = next_request_id;
         next_request_id = next_id(id)
@@ -679,7 +779,7 @@ local function create_transport(host, port, user, password, callback,
     -- IO (WORKER FIBER) --
     local function send_and_recv(limit_or_boundary, timeout)
         return communicate(connection:fd(), send_buf, recv_buf,
-                           limit_or_boundary, timeout)
+                           limit_or_boundary, timeout, zstd, shm)
     end
 
     local function send_and_recv_iproto(timeout)
@@ -725,7 +825,9 @@ local function create_transport(host, port, user, password, callback,
     -- tail-recursive calls to each other. Yep, Lua optimizes
     -- such calls, and yep, this is the canonical way to implement
     -- a state machine in Lua.
-    local console_sm, iproto_auth_sm, iproto_schema_sm, iproto_sm, error_sm
+    local console_sm, iproto_compress_sm, iproto_shm_sm
+    local iproto_auth_sm, iproto_schema_sm
+    local iproto_sm, error_sm
 
     --
     -- Protocol_sm is a core function of netbox. It calls all
@@ -758,6 +860,14 @@ local function create_transport(host, port, user, password, callback,
             set_state('active')
             return console_sm(rid)
         elseif greeting.protocol == 'Binary' then
+            local ring_size = callback('fetch_shm')
+            if ring_size ~= nil then
+                return iproto_shm_sm(ring_size, greeting.salt)
+            end
+            local compression = callback('fetch_compression')
+            if compression ~= nil and compression ~= 'none' then
+                return iproto_compress_sm(compression, greeting.salt)
+            end
             return iproto_auth_sm(greeting.salt)
         else
             return error_sm(E_NO_CONNECTION,
@@ -770,18 +880,67 @@ local function create_transport(host, port, user, password, callback,
         if err then
             return error_sm(err, response)
         else
-            local request = requests[rid]
+            local request = requests:remove(rid)
             if request == nil then -- nobody is waiting for the response
                 return
             end
             request.id = nil
-            requests[rid] = nil
             request.response = response
             request.cond:broadcast()
             return console_sm(next_id(rid))
         end
     end
 
+    --
+    -- Everything sent after COMPRESS request and received after
+    -- the response to it is compressed. Nothing is sent until
+    -- the response arrives, so the response is the last thing
+    -- received uncompressed.
+    --
+    iproto_compress_sm = function(compression, salt)
+        set_state('auth')
+        encode_compress(send_buf, new_request_id(), compression)
+        local err, hdr, body_rpos = send_and_recv_iproto()
+        if err then
+            return error_sm(err, hdr)
+        end
+        if hdr[IPROTO_STATUS_KEY] ~= 0 then
+            local body = decode(body_rpos)
+            return error_sm(E_NO_CONNECTION, body[IPROTO_ERROR_24])
+        end
+        zstd = new_zstd(recv_buf)
+        return iproto_auth_sm(salt)
+    end
+
+    --
+    -- Everything sent after SHM request and received after the
+    -- response to it goes through the shared memory rings, which
+    -- are passed to the server along with the request. As with
+    -- COMPRESS, the response is the last thing received from the
+    -- socket.
+    --
+    iproto_shm_sm = function(ring_size, salt)
+        set_state('auth')
+        local ok, rings = pcall(new_shm, ring_size)
+        if not ok then
+            return error_sm(E_NO_CONNECTION, tostring(rings))
+        end
+        encode_shm(send_buf, new_request_id())
+        local err, hdr, body_rpos = send_shm(connection:fd(), send_buf, rings)
+        if not err then
+            err, hdr, body_rpos = send_and_recv_iproto()
+        end
+        if err then
+            return error_sm(err, hdr)
+        end
+        if hdr[IPROTO_STATUS_KEY] ~= 0 then
+            local body = decode(body_rpos)
+            return error_sm(E_NO_CONNECTION, body[IPROTO_ERROR_24])
+        end
+        shm = rings
+        return iproto_auth_sm(salt)
+    end
+
     iproto_auth_sm = function(salt)
         set_state('auth')
         if not user or not password then
@@ -867,18 +1026,21 @@ local function create_transport(host, port, user, password, callback,
         return iproto_sm(schema_version)
     end
 
+    --
+    -- All the responses received are dispatched in C in one go,
+    -- calling back into Lua only to complete the requests.
+    --
     iproto_sm = function(schema_version)
-        local err, hdr, body_rpos, body_end = send_and_recv_iproto()
-        if err then return error_sm(err, hdr) end
-        dispatch_response_iproto(hdr, body_rpos, body_end)
-        local response_schema_version = hdr[IPROTO_SCHEMA_VERSION_KEY]
-        if response_schema_version > 0 and
-           response_schema_version ~= schema_version then
+        local required = dispatch(requests, recv_buf, dispatch_response,
+                                  schema_version)
+        if required == nil then
             -- schema_version has been changed - start to load a new version.
             -- Sic: self.schema_version will be updated only after reload.
             set_state('fetch_schema')
             return iproto_schema_sm(schema_version)
         end
+        local err, extra = send_and_recv(required)
+        if err then return error_sm(err, extra) end
         return iproto_sm(schema_version)
     end
 
@@ -886,6 +1048,8 @@ local function create_transport(host, port, user, password, callback,
         if connection then connection:close(); connection = nil end
         send_buf:recycle()
         recv_buf:recycle()
+        zstd = nil
+        shm = nil
         if state ~= 'closed' then
             if callback('reconnect_timeout') then
                 set_state('error_reconnect', err, msg)
@@ -901,6 +1065,8 @@ local function create_transport(host, port, user, password, callback,
         wait_state      = wait_state,
         perform_request = perform_request,
         perform_async_request = perform_async_request,
+        prepare_request = prepare_request,
+        perform_batch   = perform_batch,
     }
 end
 
@@ -1028,6 +1194,14 @@ local function new_sm(host, port, opts, connection, greeting)
             remote.peer_version_id = greeting.version_id
         elseif what == 'will_fetch_schema' then
             return not opts.console
+        elseif what == 'fetch_compression' then
+            return opts.compression
+        elseif what == 'fetch_shm' then
+            -- The rings can only be passed over a unix socket,
+            -- other connections silently use the socket.
+            if opts.shm and host == 'unix/' then
+                return opts.shm == true and 0 or opts.shm
+            end
         elseif what == 'fetch_connect_timeout' then
             return opts.connect_timeout or DEFAULT_CONNECT_TIMEOUT
         elseif what == 'did_fetch_schema' then
@@ -1172,6 +1346,7 @@ function remote_methods:_request(method, opts, request_ctx, ...)
             if err then
                 box.error(err)
             end
+            res.return_raw = opts.return_raw
             return res
         end
         if opts.timeout then
@@ -1194,9 +1369,21 @@ function remote_methods:_request(method, opts, request_ctx, ...)
         transport.wait_state('active', timeout)
         timeout = deadline and max(0, deadline - fiber_clock())
     end
-    local res, err = transport.perform_request(timeout, buffer, skip_header,
-                                               method, on_push, on_push_ctx,
-                                               request_ctx, ...)
+    local res, err
+    if opts and opts.return_raw then
+        res, err = transport.perform_async_request(buffer, skip_header,
+                                                   method, on_push,
+                                                   on_push_ctx, request_ctx,
+                                                   ...)
+        if res then
+            res.return_raw = true
+            res, err = res:wait_result(timeout)
+        end
+    else
+        res, err = transport.perform_request(timeout, buffer, skip_header,
+                                             method, on_push, on_push_ctx,
+                                             request_ctx, ...)
+    end
     if err then
         box.error(err)
     end
@@ -1254,13 +1441,89 @@ function remote_methods:eval(code, args, opts)
     return unpack(res)
 end
 
+--
+-- Execute DML operations in one transaction on the server, sent
+-- in one request and committed with one WAL write. Operations
+-- are {'insert', space, tuple}, {'replace', space, tuple},
+-- {'delete', space, key}, {'update', space, key, ops} and
+-- {'upsert', space, tuple, ops}, where space is a name or an id.
+-- Returns an array of results: a tuple or box.NULL for each
+-- operation. If one of them fails, none is applied.
+--
+function remote_methods:atomic(ops, opts)
+    check_remote_arg(self, 'atomic')
+    if type(ops) ~= 'table' then
+        error("Usage: remote:atomic({{op, space, ...}, ...}[, opts])")
+    end
+    local requests = table_new(#ops, 0)
+    for i, op in ipairs(ops) do
+        local op_type = type(op) == 'table' and IPROTO_TXN_OP[op[1]]
+        if not op_type then
+            error(string.format("Unknown operation #%d", i))
+        end
+        local space = op[2]
+        if type(space) ~= 'number' then
+            local s = self.space[space]
+            if s == nil then
+                box.error(E_NO_SUCH_SPACE, tostring(space))
+            end
+            space = s.id
+        end
+        requests[i] = {op_type, space, op[3] or {}, op[4] or {}}
+    end
+    return self:_request('atomic', opts, nil, requests)
+end
+
 function remote_methods:execute(query, parameters, sql_opts, netbox_opts)
     check_remote_arg(self, "execute")
+    local fetch_size
     if sql_opts ~= nil then
-        box.error(box.error.UNSUPPORTED, "execute", "options")
+        for k in pairs(sql_opts) do
+            if k ~= 'fetch_size' then
+                box.error(box.error.UNSUPPORTED, "execute", "options")
+            end
+        end
+        fetch_size = sql_opts.fetch_size
+        if fetch_size ~= nil and
+           (type(fetch_size) ~= 'number' or fetch_size <= 0) then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "fetch_size should be a positive number")
+        end
     end
     return self:_request('execute', netbox_opts, nil, query, parameters or {},
-                         sql_opts or {})
+                         {}, fetch_size)
+end
+
+function remote_methods:fetch(cursor_id, fetch_size, netbox_opts)
+    check_remote_arg(self, "fetch")
+    if type(cursor_id) ~= "number" then
+        box.error("cursor id is expected to be numeric")
+    end
+    if type(fetch_size) ~= 'number' or fetch_size <= 0 then
+        box.error(box.error.ILLEGAL_PARAMS,
+                  "fetch_size should be a positive number")
+    end
+    return self:_request('fetch', netbox_opts, nil, cursor_id, fetch_size)
+end
+
+-- Read next tuples of an iterator opened by index:select_open().
+function remote_methods:select_fetch(iterator_id, limit, netbox_opts)
+    check_remote_arg(self, "select_fetch")
+    if type(iterator_id) ~= "number" then
+        box.error("iterator id is expected to be numeric")
+    end
+    if type(limit) ~= 'number' or limit <= 0 then
+        box.error(box.error.ILLEGAL_PARAMS, "limit should be a positive number")
+    end
+    return self:_request('select_fetch', netbox_opts, nil, iterator_id, limit)
+end
+
+function remote_methods:select_close(iterator_id, netbox_opts)
+    check_remote_arg(self, "select_close")
+    if type(iterator_id) ~= "number" then
+        box.error("iterator id is expected to be numeric")
+    end
+    return self:_request('select_close', netbox_opts, nil, iterator_id)
 end
 
 function remote_methods:prepare(query, parameters, sql_opts, netbox_opts) -- luacheck: no unused args
@@ -1286,6 +1549,122 @@ function remote_methods:unprepare(query, parameters, sql_opts, netbox_opts)
                          sql_opts or {})
 end
 
+--
+-- A batch collects requests encoded in advance and sends them
+-- to the connection in one write. Every request of a batch
+-- yields a future object, like a request with is_async option.
+--
+local batch_methods = {}
+
+local batch_mt = { __index = batch_methods, __metatable = false }
+
+function remote_methods:batch()
+    check_remote_arg(self, 'batch')
+    return setmetatable({
+        _remote = self,
+        _buf = buffer.ibuf(buffer.READAHEAD),
+        _requests = {},
+    }, batch_mt)
+end
+
+function batch_methods:_add(method, request_ctx, ...)
+    local buf = self._buf
+    -- Drop the part of a request encoded before an error.
+    local size = buf:size()
+    local ok, request = pcall(self._remote._transport.prepare_request, buf,
+                              nil, false, method, table.insert, {},
+                              request_ctx, ...)
+    if not ok then
+        buf.wpos = buf.rpos + size
+        error(request)
+    end
+    table.insert(self._requests, request)
+    return request
+end
+
+function batch_methods:_space(space)
+    local s = self._remote.space[space]
+    if s == nil then
+        box.error(E_NO_SUCH_SPACE, tostring(space))
+    end
+    return s
+end
+
+function batch_methods:ping()
+    return self:_add('ping', nil)
+end
+
+function batch_methods:call(func_name, args)
+    check_call_args(args)
+    return self:_add('call_17', nil, tostring(func_name), args or {})
+end
+
+function batch_methods:eval(code, args)
+    check_eval_args(args)
+    return self:_add('eval', nil, code, args or {})
+end
+
+function batch_methods:execute(query, parameters)
+    return self:_add('execute', nil, query, parameters or {}, {})
+end
+
+function batch_methods:insert(space, tuple)
+    local s = self:_space(space)
+    return self:_add('insert', s._format_cdata, s.id, tuple)
+end
+
+function batch_methods:replace(space, tuple)
+    local s = self:_space(space)
+    return self:_add('replace', s._format_cdata, s.id, tuple)
+end
+
+function batch_methods:delete(space, key)
+    local s = self:_space(space)
+    return self:_add('delete', s._format_cdata, s.id, 0, key)
+end
+
+function batch_methods:update(space, key, oplist)
+    local s = self:_space(space)
+    return self:_add('update', s._format_cdata, s.id, 0, key, oplist)
+end
+
+function batch_methods:upsert(space, tuple, oplist)
+    local s = self:_space(space)
+    return self:_add('upsert', nil, s.id, tuple, oplist)
+end
+
+function batch_methods:select(space, key, opts)
+    local s = self:_space(space)
+    local key_is_nil = (key == nil or (type(key) == 'table' and #key == 0))
+    local iterator = check_iterator_type(opts, key_is_nil)
+    local offset = tonumber(opts and opts.offset) or 0
+    local limit = tonumber(opts and opts.limit) or 0xFFFFFFFF
+    return self:_add('select', s._format_cdata, s.id, 0, iterator, offset,
+                     limit, key)
+end
+
+function batch_methods:get(space, key)
+    local s = self:_space(space)
+    return self:_add('get', s._format_cdata, s.id, 0, box.index.EQ, 0, 2, key)
+end
+
+--
+-- Send all the requests added to the batch and return their
+-- futures in the order they were added. The batch is empty
+-- and can be reused afterwards.
+--
+function batch_methods:send()
+    local requests = self._requests
+    local res, err = self._remote._transport.perform_batch(self._buf,
+                                                            requests)
+    self._buf:recycle()
+    self._requests = {}
+    if err then
+        box.error(err)
+    end
+    return res
+end
+
 function remote_methods:wait_state(state, timeout)
     check_remote_arg(self, 'wait_state')
     if timeout == nil then
@@ -1494,6 +1873,11 @@ space_metatable = function(remote)
         return check_primary_index(self):get(key, opts)
     end
 
+    function methods:get_batch(keys, opts)
+        check_space_arg(self, 'get_batch')
+        return check_primary_index(self):get_batch(keys, opts)
+    end
+
     function methods:format(format)
         if format == nil then
             return self._format
@@ -1520,6 +1904,25 @@ index_metatable = function(remote)
                                 limit, key))
     end
 
+    -- Same as select(), but if there are more than `limit`
+    -- tuples, the iterator is kept open on the server and its
+    -- id is returned along with the tuples. The rest of the
+    -- tuples is read with conn:select_fetch().
+    function methods:select_open(key, opts)
+        check_index_arg(self, 'select_open')
+        if opts and opts.buffer then
+            error("index:select_open() doesn't support `buffer` argument")
+        end
+        local key_is_nil = (key == nil or
+                            (type(key) == 'table' and #key == 0))
+        local iterator = check_iterator_type(opts, key_is_nil)
+        local offset = tonumber(opts and opts.offset) or 0
+        local limit = tonumber(opts and opts.limit) or 0xFFFFFFFF
+        return (remote:_request('select_open', opts, self.space._format_cdata,
+                                self.space.id, self.id, iterator, offset,
+                                limit, key))
+    end
+
     function methods:get(key, opts)
         check_index_arg(self, 'get')
         if opts and opts.buffer then
@@ -1531,6 +1934,15 @@ index_metatable = function(remote)
                                                box.index.EQ, 0, 2, key))
     end
 
+    function methods:get_batch(keys, opts)
+        check_index_arg(self, 'get_batch')
+        if type(keys) ~= 'table' then
+            error("Usage: index:get_batch({key1, key2, ...})")
+        end
+        return (remote:_request('get_batch', opts, self.space._format_cdata,
+                                self.space.id, self.id, keys))
+    end
+
     function methods:min(key, opts)
         check_index_arg(self, 'min')
         if opts and opts.buffer then
@@ -1581,12 +1993,273 @@ index_metatable = function(remote)
     return { __index = methods, __metatable = false }
 end
 
+--
+-- A pool of connections to instances of a replica set. Write
+-- requests go to the instance which is writable, read requests
+-- are spread across all healthy instances: the one with the
+-- least EWMA of response time multiplied by the number of
+-- requests in flight is picked. A background fiber checks the
+-- instances with box.info: an instance is unhealthy if it is
+-- disconnected or if it lags behind any of its upstreams by more
+-- than max_lag seconds. A read request failed because of a lost
+-- connection is retried on another instance.
+--
+-- Options, in addition to the connect() ones:
+--   check_interval  period of health checks, seconds (1)
+--   max_lag         max replication lag of a healthy instance,
+--                   seconds (1)
+--
+local POOL_EWMA_ALPHA = 0.2
+local POOL_CHECK_INTERVAL = 1
+local POOL_MAX_LAG = 1
+
+local POOL_CHECK_CODE = [[
+local info = box.info
+local lag = 0
+for _, r in pairs(info.replication) do
+    local u = r.upstream
+    if u ~= nil then
+        if u.status ~= 'follow' then
+            lag = 1e100
+        elseif u.lag > lag then
+            lag = u.lag
+        end
+    end
+end
+return info.ro, lag
+]]
+
+local pool_methods = {}
+local pool_mt = { __index = pool_methods, __metatable = false }
+
+local function pool_check_member(pool, member)
+    local conn = member.conn
+    if not conn:is_connected() then
+        member.is_healthy = false
+        return
+    end
+    local ok, ro, lag = pcall(conn.eval, conn, POOL_CHECK_CODE, {},
+                              {timeout = pool.check_interval})
+    if not ok then
+        member.is_healthy = false
+        return
+    end
+    member.is_rw = not ro
+    member.lag = lag
+    member.is_healthy = lag <= pool.max_lag
+end
+
+local function pool_check_f(pool)
+    fiber.name('net.box.pool', {truncate = true})
+    while true do
+        fiber.sleep(pool.check_interval)
+        if pool.is_closed then
+            break
+        end
+        for _, member in ipairs(pool.members) do
+            pool_check_member(pool, member)
+        end
+    end
+end
+
+--
+-- Return the instance to send a request to in the given mode
+-- ('rw' or 'ro') skipping the instances from the exclude set.
+--
+local function pool_pick(pool, mode, exclude)
+    local best, best_score
+    for _, member in ipairs(pool.members) do
+        if member.is_healthy and member.conn:is_connected() and
+           not exclude[member] and (mode == 'ro' or member.is_rw) then
+            local score = (member.ewma or 0) * (member.inflight + 1)
+            if best == nil or score < best_score then
+                best, best_score = member, score
+            end
+        end
+    end
+    return best
+end
+
+local function pool_check_mode(mode)
+    if mode ~= 'ro' and mode ~= 'rw' then
+        box.error(E_PROC_LUA, "pool: mode must be 'ro' or 'rw'")
+    end
+end
+
+--
+-- Return the connection a request in the given mode would be
+-- sent to, e.g. to issue requests not wrapped by the pool.
+--
+function pool_methods:connection(mode)
+    mode = mode or 'rw'
+    pool_check_mode(mode)
+    local member = pool_pick(self, mode, {})
+    if member == nil then
+        box.error(E_NO_CONNECTION)
+    end
+    return member.conn
+end
+
+local function pool_complete(member, start, ok, ...)
+    member.inflight = member.inflight - 1
+    if ok then
+        local rtt = fiber_clock() - start
+        local ewma = member.ewma
+        member.ewma = ewma == nil and rtt or
+                      ewma + POOL_EWMA_ALPHA * (rtt - ewma)
+    end
+    return ok, ...
+end
+
+--
+-- Execute fn(conn, ...) on an instance suitable for the mode.
+-- A read request is retried on another instance if it fails
+-- because the connection is lost.
+--
+function pool_methods:_request(mode, fn, ...)
+    pool_check_mode(mode)
+    local exclude = {}
+    while true do
+        local member = pool_pick(self, mode, exclude)
+        if member == nil then
+            box.error(E_NO_CONNECTION)
+        end
+        member.inflight = member.inflight + 1
+        local res = {pool_complete(member, fiber_clock(),
+                                   pcall(fn, member.conn, ...))}
+        if res[1] then
+            return select(2, unpack(res, 1, table.maxn(res)))
+        end
+        local err = res[2]
+        if mode == 'rw' or type(err) ~= 'cdata' or
+           err.code ~= E_NO_CONNECTION then
+            error(err)
+        end
+        member.is_healthy = false
+        exclude[member] = true
+    end
+end
+
+local function pool_opts(opts)
+    local mode = opts and opts.mode
+    if mode == nil then
+        return nil, opts
+    end
+    local copy = {}
+    for k, v in pairs(opts) do copy[k] = v end
+    copy.mode = nil
+    return mode, copy
+end
+
+function pool_methods:call(func_name, args, opts)
+    local mode, netbox_opts = pool_opts(opts)
+    return self:_request(mode or 'rw', function(conn)
+        return conn:call(func_name, args, netbox_opts)
+    end)
+end
+
+function pool_methods:eval(code, args, opts)
+    local mode, netbox_opts = pool_opts(opts)
+    return self:_request(mode or 'rw', function(conn)
+        return conn:eval(code, args, netbox_opts)
+    end)
+end
+
+function pool_methods:execute(query, parameters, sql_opts, opts)
+    local mode, netbox_opts = pool_opts(opts)
+    return self:_request(mode or 'rw', function(conn)
+        return conn:execute(query, parameters, sql_opts, netbox_opts)
+    end)
+end
+
+function pool_methods:select(space, key, opts)
+    local mode, netbox_opts = pool_opts(opts)
+    return self:_request(mode or 'ro', function(conn)
+        return conn.space[space]:select(key, netbox_opts)
+    end)
+end
+
+function pool_methods:get(space, key, opts)
+    local mode, netbox_opts = pool_opts(opts)
+    return self:_request(mode or 'ro', function(conn)
+        return conn.space[space]:get(key, netbox_opts)
+    end)
+end
+
+function pool_methods:info()
+    local info = {}
+    for _, member in ipairs(self.members) do
+        table.insert(info, {
+            uri = member.uri,
+            state = member.conn.state,
+            is_healthy = member.is_healthy,
+            is_rw = member.is_rw,
+            lag = member.lag,
+            latency = member.ewma,
+            inflight = member.inflight,
+        })
+    end
+    return info
+end
+
+function pool_methods:close()
+    self.is_closed = true
+    for _, member in ipairs(self.members) do
+        member.conn:close()
+    end
+end
+
+local function pool_new(uris, opts)
+    if type(uris) ~= 'table' or #uris == 0 then
+        box.error(E_PROC_LUA, 'usage: pool({uri, ...}[, opts])')
+    end
+    opts = opts or {}
+    local pool = setmetatable({
+        members = {},
+        check_interval = opts.check_interval or POOL_CHECK_INTERVAL,
+        max_lag = opts.max_lag or POOL_MAX_LAG,
+        is_closed = false,
+    }, pool_mt)
+    local conn_opts = {}
+    for k, v in pairs(opts) do conn_opts[k] = v end
+    conn_opts.check_interval = nil
+    conn_opts.max_lag = nil
+    conn_opts.wait_connected = false
+    if conn_opts.reconnect_after == nil then
+        conn_opts.reconnect_after = pool.check_interval
+    end
+    for _, uri in ipairs(uris) do
+        table.insert(pool.members, {
+            uri = uri,
+            conn = connect(uri, conn_opts),
+            is_healthy = false,
+            is_rw = false,
+            inflight = 0,
+        })
+    end
+    -- Check the instances synchronously once, so that the pool
+    -- is usable right away. Unless wait_connected is false, wait
+    -- for the connections for up to wait_connected seconds in
+    -- total (check_interval by default).
+    if opts.wait_connected ~= false then
+        local timeout = tonumber(opts.wait_connected) or pool.check_interval
+        local deadline = fiber_clock() + timeout
+        for _, member in ipairs(pool.members) do
+            member.conn:wait_connected(max(0, deadline - fiber_clock()))
+            pool_check_member(pool, member)
+        end
+    end
+    fiber.create(pool_check_f, pool)
+    return pool
+end
+
 local this_module = {
     create_transport = create_transport,
     connect = connect,
     new = connect, -- Tarantool < 1.7.1 compatibility,
     wrap = wrap,
     establish_connection = establish_connection,
+    pool = pool_new,
 }
 
 function this_module.timeout(timeout, ...)
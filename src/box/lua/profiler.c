@@ -0,0 +1,314 @@
+/*
+ * Copyright 2010-2021, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <luajit.h>
+
+#include "lua/utils.h"
+#include "diag.h"
+#include "trivia/util.h"
+#ifdef ENABLE_BACKTRACE
+#include "backtrace.h"
+#endif /* ENABLE_BACKTRACE */
+
+/**
+ * Sampling profiler of the tx thread.
+ *
+ * Sampling is driven by the LuaJIT profiler: it arms a timer,
+ * and the signal handler makes the VM invoke profiler_sample()
+ * at the next safe point. This way samples are taken correctly
+ * from both interpreted and compiled code. Each sample is a
+ * folded stack: the C frames that entered the VM, taken with
+ * backtrace_foreach(), followed by the Lua frames and a marker
+ * of the VM state if it wasn't executing Lua code. Identical
+ * stacks are counted in a Lua table, which is dumped in the
+ * format accepted by flamegraph.pl on stop.
+ */
+
+enum {
+	/** Max number of C frames kept in a sample. */
+	PROFILER_C_DEPTH_MAX = 64,
+	/** Max length of a C function name. */
+	PROFILER_NAME_MAX = 128,
+	/** Max length of a folded stack. */
+	PROFILER_STACK_MAX = 8192,
+};
+
+static struct {
+	/** True if the profiler is running. */
+	bool is_running;
+	/** Include C frames into samples. */
+	bool c_stack;
+	/** Max number of Lua frames in a sample. */
+	int depth;
+	/** Reference to the table: folded stack -> sample count. */
+	int stacks_ref;
+	/** Total number of samples. */
+	int64_t samples;
+} profiler = {
+	.is_running = false,
+	.stacks_ref = LUA_NOREF,
+};
+
+/** A buffer the folded stack is built in. */
+struct profiler_stack {
+	char data[PROFILER_STACK_MAX];
+	size_t len;
+};
+
+static void
+profiler_stack_append(struct profiler_stack *stack, const char *str,
+		      size_t len)
+{
+	if (stack->len > 0 && stack->len < sizeof(stack->data))
+		stack->data[stack->len++] = ';';
+	len = MIN(len, sizeof(stack->data) - stack->len);
+	memcpy(stack->data + stack->len, str, len);
+	stack->len += len;
+}
+
+#ifdef ENABLE_BACKTRACE
+/** C frames of a sample, the innermost first. */
+struct profiler_frames {
+	char names[PROFILER_C_DEPTH_MAX][PROFILER_NAME_MAX];
+	int count;
+};
+
+static int
+profiler_frame_cb(int frameno, void *frameret, const char *func,
+		  size_t offset, void *cb_ctx)
+{
+	(void)frameno;
+	(void)frameret;
+	(void)offset;
+	struct profiler_frames *frames = (struct profiler_frames *)cb_ctx;
+	if (frames->count == PROFILER_C_DEPTH_MAX)
+		return -1;
+	snprintf(frames->names[frames->count++], PROFILER_NAME_MAX, "%s",
+		 func != NULL && *func != '\0' ? func : "??");
+	return 0;
+}
+
+/**
+ * Append the C frames that precede the outermost LuaJIT VM frame
+ * to the folded stack, the outermost first. Frames of the VM
+ * itself and the profiler callback are replaced by Lua frames.
+ */
+static void
+profiler_append_c_stack(struct profiler_stack *stack)
+{
+	/* Called at most once at a time, no need to use the stack. */
+	static struct profiler_frames frames;
+	frames.count = 0;
+	backtrace_foreach(profiler_frame_cb, NULL, &frames);
+	int vm = -1;
+	for (int i = 0; i < frames.count; i++) {
+		if (strncmp(frames.names[i], "lj_", 3) == 0)
+			vm = i;
+	}
+	for (int i = frames.count - 1; i > vm; i--) {
+		profiler_stack_append(stack, frames.names[i],
+				      strlen(frames.names[i]));
+	}
+}
+#endif /* ENABLE_BACKTRACE */
+
+/** Name of the VM state, NULL for Lua code. */
+static const char *
+profiler_vmstate_name(int vmstate)
+{
+	switch (vmstate) {
+	case 'C':
+		return "[C]";
+	case 'G':
+		return "[GC]";
+	case 'J':
+		return "[JIT compiler]";
+	default:
+		return NULL;
+	}
+}
+
+/** LuaJIT profiler callback. */
+static void
+profiler_sample(void *data, struct lua_State *L, int samples, int vmstate)
+{
+	(void)data;
+	static struct profiler_stack stack;
+	stack.len = 0;
+#ifdef ENABLE_BACKTRACE
+	if (profiler.c_stack)
+		profiler_append_c_stack(&stack);
+#endif /* ENABLE_BACKTRACE */
+	size_t len;
+	const char *lua_stack = luaJIT_profile_dumpstack(L, "FZ;",
+							 -profiler.depth,
+							 &len);
+	if (len > 0)
+		profiler_stack_append(&stack, lua_stack, len);
+	const char *state = profiler_vmstate_name(vmstate);
+	if (state != NULL)
+		profiler_stack_append(&stack, state, strlen(state));
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, profiler.stacks_ref);
+	lua_pushlstring(L, stack.data, stack.len);
+	lua_pushvalue(L, -1);
+	lua_rawget(L, -3);
+	lua_Integer count = lua_tointeger(L, -1) + samples;
+	lua_pop(L, 1);
+	lua_pushinteger(L, count);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+	profiler.samples += samples;
+}
+
+/**
+ * box.profiler.start([opts]). Options:
+ *
+ *   interval  sampling interval in seconds (0.01)
+ *   depth     max number of Lua frames in a sample (64)
+ *   c_stack   include C frames into samples (true)
+ */
+static int
+lbox_profiler_start(struct lua_State *L)
+{
+	if (lua_gettop(L) > 1 || (!lua_isnoneornil(L, 1) &&
+				  !lua_istable(L, 1)))
+		return luaL_error(L, "Usage: box.profiler.start([opts])");
+	if (profiler.is_running)
+		return luaL_error(L, "profiler is already running");
+	double interval = 0.01;
+	int depth = 64;
+	bool c_stack = true;
+	if (lua_istable(L, 1)) {
+		lua_getfield(L, 1, "interval");
+		if (!lua_isnil(L, -1))
+			interval = luaL_checknumber(L, -1);
+		lua_getfield(L, 1, "depth");
+		if (!lua_isnil(L, -1))
+			depth = luaL_checkinteger(L, -1);
+		lua_getfield(L, 1, "c_stack");
+		if (!lua_isnil(L, -1))
+			c_stack = lua_toboolean(L, -1);
+		lua_pop(L, 3);
+	}
+	if (interval < 0.001)
+		return luaL_error(L, "interval must be at least 0.001");
+	if (depth <= 0)
+		return luaL_error(L, "depth must be positive");
+
+	char mode[32];
+	snprintf(mode, sizeof(mode), "i%d", (int)(interval * 1000));
+	lua_newtable(L);
+	profiler.stacks_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	profiler.depth = depth;
+	profiler.c_stack = c_stack;
+	profiler.samples = 0;
+	profiler.is_running = true;
+	luaJIT_profile_start(tarantool_L, mode, profiler_sample, NULL);
+	return 0;
+}
+
+/**
+ * box.profiler.stop([path]). Stop the profiler and return the
+ * collected folded stacks, one "stack count" line per stack.
+ * If a path is given, the stacks are written to the file and
+ * the number of samples is returned instead.
+ */
+static int
+lbox_profiler_stop(struct lua_State *L)
+{
+	const char *path = NULL;
+	if (!lua_isnoneornil(L, 1))
+		path = luaL_checkstring(L, 1);
+	if (!profiler.is_running)
+		return luaL_error(L, "profiler is not running");
+	luaJIT_profile_stop(tarantool_L);
+	profiler.is_running = false;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, profiler.stacks_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, profiler.stacks_ref);
+	profiler.stacks_ref = LUA_NOREF;
+	int stacks = lua_gettop(L);
+	lua_newtable(L);
+	int lines = lua_gettop(L);
+	int line_count = 0;
+	lua_pushnil(L);
+	while (lua_next(L, stacks) != 0) {
+		lua_pushfstring(L, "%s %d\n", lua_tostring(L, -2),
+				(int)lua_tointeger(L, -1));
+		lua_rawseti(L, lines, ++line_count);
+		lua_pop(L, 1);
+	}
+	/* The buffer may use the stack, so it can't be used above. */
+	luaL_Buffer b;
+	luaL_buffinit(L, &b);
+	for (int i = 1; i <= line_count; i++) {
+		lua_rawgeti(L, lines, i);
+		luaL_addvalue(&b);
+	}
+	luaL_pushresult(&b);
+	if (path == NULL)
+		return 1;
+
+	size_t len;
+	const char *data = lua_tolstring(L, -1, &len);
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		diag_set(SystemError, "failed to open file '%s'", path);
+		return luaT_error(L);
+	}
+	bool ok = fwrite(data, 1, len, f) == len;
+	if (fclose(f) != 0 || !ok) {
+		diag_set(SystemError, "failed to write file '%s'", path);
+		return luaT_error(L);
+	}
+	lua_pushinteger(L, profiler.samples);
+	return 1;
+}
+
+static const struct luaL_Reg lbox_profiler_lib[] = {
+	{"start", lbox_profiler_start},
+	{"stop", lbox_profiler_stop},
+	{NULL, NULL}
+};
+
+void
+box_lua_profiler_init(struct lua_State *L)
+{
+	luaL_register_module(L, "box.profiler", lbox_profiler_lib);
+	lua_pop(L, 1);
+}
@@ -0,0 +1,643 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "box/lua/read_view.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "lua/utils.h"
+#include "coio_file.h"
+#include "fiber.h"
+#include "msgpuck.h"
+
+#include "box/lua/tuple.h"
+#include "box/arrow.h"
+#include "box/read_view.h"
+#include "box/schema.h"
+#include "box/space.h"
+#include "box/tuple.h"
+#include "box/tuple_compression.h"
+
+static const char read_view_typename[] = "box.read_view";
+static const char arrow_writer_typename[] = "box.read_view.arrow";
+
+static struct read_view **
+luaT_checkreadview(struct lua_State *L, int idx, const char *usage)
+{
+	if (idx > lua_gettop(L))
+		luaL_error(L, "usage: %s", usage);
+	return (struct read_view **)luaL_checkudata(L, idx,
+						     read_view_typename);
+}
+
+/**
+ * Get an id of the space at the given index of the Lua stack.
+ * The space is given either by id or by a space object.
+ */
+static uint32_t
+luaT_checkspaceid(struct lua_State *L, int idx, const char *usage)
+{
+	if (lua_type(L, idx) == LUA_TTABLE) {
+		lua_getfield(L, idx, "id");
+		if (lua_type(L, -1) != LUA_TNUMBER)
+			luaL_error(L, "usage: %s", usage);
+		uint32_t space_id = lua_tointeger(L, -1);
+		lua_pop(L, 1);
+		return space_id;
+	}
+	if (lua_type(L, idx) != LUA_TNUMBER)
+		luaL_error(L, "usage: %s", usage);
+	return lua_tointeger(L, idx);
+}
+
+/**
+ * box.read_view.open({space, ...}) opens a consistent read
+ * view of the given memtx spaces.
+ */
+static int
+lbox_read_view_open(struct lua_State *L)
+{
+	static const char usage[] = "box.read_view.open({space, ...})";
+	if (lua_gettop(L) != 1 || lua_type(L, 1) != LUA_TTABLE)
+		return luaL_error(L, "usage: %s", usage);
+	uint32_t space_count = lua_objlen(L, 1);
+	uint32_t *space_ids = lua_newuserdata(L, space_count *
+					      sizeof(*space_ids));
+	for (uint32_t i = 0; i < space_count; i++) {
+		lua_rawgeti(L, 1, i + 1);
+		space_ids[i] = luaT_checkspaceid(L, -1, usage);
+		lua_pop(L, 1);
+	}
+	struct read_view **ptr = lua_newuserdata(L, sizeof(*ptr));
+	*ptr = read_view_open(space_ids, space_count);
+	if (*ptr == NULL)
+		return luaT_error(L);
+	luaL_getmetatable(L, read_view_typename);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int
+lbox_read_view_close(struct lua_State *L)
+{
+	struct read_view **ptr = luaT_checkreadview(L, 1,
+						    "read_view:close()");
+	if (*ptr != NULL && (*ptr)->is_busy)
+		return luaL_error(L, "read view is in use");
+	if (*ptr != NULL)
+		read_view_close(*ptr);
+	*ptr = NULL;
+	return 0;
+}
+
+static int
+lbox_read_view_gc(struct lua_State *L)
+{
+	struct read_view **ptr = luaT_checkreadview(L, 1, "");
+	if (*ptr != NULL)
+		read_view_close(*ptr);
+	*ptr = NULL;
+	return 0;
+}
+
+/**
+ * Get a read view space for a scan, raising an error if the
+ * read view can't be scanned.
+ */
+static struct read_view_space *
+luaT_checkreadviewspace(struct lua_State *L, struct read_view *rv,
+			uint32_t space_id)
+{
+	if (rv == NULL)
+		luaL_error(L, "read view is closed");
+	if (rv->is_busy)
+		luaL_error(L, "read view is in use");
+	struct read_view_space *space = read_view_find_space(rv, space_id);
+	if (space == NULL)
+		luaL_error(L, "space is not in the read view");
+	return space;
+}
+
+static int
+lbox_read_view_iterator_next(struct lua_State *L)
+{
+	static const char usage[] = "read_view:pairs(space)";
+	struct read_view **ptr = luaT_checkreadview(L, 1, usage);
+	uint32_t space_id = luaT_checkspaceid(L, 2, usage);
+	struct read_view_space *space =
+		luaT_checkreadviewspace(L, *ptr, space_id);
+	const char *data;
+	uint32_t size;
+	if (read_view_space_next(space, &data, &size) != 0)
+		return luaT_error(L);
+	if (data == NULL)
+		return 0;
+	/*
+	 * The space format may have changed since the read
+	 * view was opened so return tuples in the runtime format.
+	 * This also keeps the garbage created by a scan out of
+	 * the memtx arena.
+	 */
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	const char *data_end = data + size;
+	struct tuple *tuple = NULL;
+	if (tuple_data_decompress(&data, &data_end) == 0)
+		tuple = tuple_new(tuple_format_runtime, data, data_end);
+	region_truncate(region, region_svp);
+	if (tuple == NULL)
+		return luaT_error(L);
+	lua_pushinteger(L, space_id);
+	luaT_pushtuple(L, tuple);
+	return 2;
+}
+
+/**
+ * read_view:pairs(space) iterates over tuples of a space as
+ * they were when the read view was opened, in the order of
+ * the primary index. A space can be iterated only once.
+ */
+static int
+lbox_read_view_pairs(struct lua_State *L)
+{
+	static const char usage[] = "read_view:pairs(space)";
+	struct read_view **ptr = luaT_checkreadview(L, 1, usage);
+	uint32_t space_id = luaT_checkspaceid(L, 2, usage);
+	luaT_checkreadviewspace(L, *ptr, space_id);
+	lua_pushcfunction(L, lbox_read_view_iterator_next);
+	lua_pushvalue(L, 1);
+	lua_pushinteger(L, space_id);
+	return 3;
+}
+
+static int
+read_view_count_cb(uint32_t space_id, const char *data, uint32_t size,
+		   void *arg)
+{
+	(void)space_id;
+	(void)data;
+	(void)size;
+	++*(uint64_t *)arg;
+	return 0;
+}
+
+/**
+ * read_view:count(space) counts tuples of a space in a reader
+ * thread.
+ */
+static int
+lbox_read_view_count(struct lua_State *L)
+{
+	static const char usage[] = "read_view:count(space)";
+	struct read_view **ptr = luaT_checkreadview(L, 1, usage);
+	uint32_t space_id = luaT_checkspaceid(L, 2, usage);
+	struct read_view_space *space =
+		luaT_checkreadviewspace(L, *ptr, space_id);
+	uint64_t count = 0;
+	if (read_view_scan(*ptr, space, read_view_count_cb, &count) != 0)
+		return luaT_error(L);
+	luaL_pushuint64(L, count);
+	return 1;
+}
+
+/** Aggregates of a numeric field computed by a scan. */
+struct read_view_aggregate {
+	/** Zero-based number of the field. */
+	uint32_t fieldno;
+	/** Number of tuples with a numeric field. */
+	uint64_t count;
+	/** Sum of the field values. */
+	double sum;
+	/** Min field value. */
+	double min;
+	/** Max field value. */
+	double max;
+};
+
+static int
+read_view_aggregate_cb(uint32_t space_id, const char *data, uint32_t size,
+		       void *arg)
+{
+	(void)space_id;
+	(void)size;
+	struct read_view_aggregate *agg = arg;
+	uint32_t field_count = mp_decode_array(&data);
+	if (agg->fieldno >= field_count)
+		return 0;
+	for (uint32_t i = 0; i < agg->fieldno; i++)
+		mp_next(&data);
+	double value;
+	if (mp_read_double(&data, &value) != 0)
+		return 0;
+	if (agg->count == 0 || value < agg->min)
+		agg->min = value;
+	if (agg->count == 0 || value > agg->max)
+		agg->max = value;
+	agg->sum += value;
+	agg->count++;
+	return 0;
+}
+
+/**
+ * read_view:aggregate(space, fieldno) computes the count, sum,
+ * min and max of a numeric field over a space in a reader thread.
+ * Tuples where the field is missing or isn't a number are
+ * skipped. The sum is computed in double precision.
+ */
+static int
+lbox_read_view_aggregate(struct lua_State *L)
+{
+	static const char usage[] = "read_view:aggregate(space, fieldno)";
+	struct read_view **ptr = luaT_checkreadview(L, 1, usage);
+	uint32_t space_id = luaT_checkspaceid(L, 2, usage);
+	if (lua_type(L, 3) != LUA_TNUMBER || lua_tointeger(L, 3) < 1)
+		return luaL_error(L, "usage: %s", usage);
+	struct read_view_space *space =
+		luaT_checkreadviewspace(L, *ptr, space_id);
+	struct read_view_aggregate agg;
+	memset(&agg, 0, sizeof(agg));
+	agg.fieldno = lua_tointeger(L, 3) - 1;
+	if (read_view_scan(*ptr, space, read_view_aggregate_cb, &agg) != 0)
+		return luaT_error(L);
+	lua_createtable(L, 0, 4);
+	luaL_pushuint64(L, agg.count);
+	lua_setfield(L, -2, "count");
+	lua_pushnumber(L, agg.sum);
+	lua_setfield(L, -2, "sum");
+	if (agg.count > 0) {
+		lua_pushnumber(L, agg.min);
+		lua_setfield(L, -2, "min");
+		lua_pushnumber(L, agg.max);
+		lua_setfield(L, -2, "max");
+	}
+	return 1;
+}
+
+/** Default number of rows in an Arrow record batch. */
+enum { ARROW_BATCH_SIZE_DEFAULT = 65536 };
+
+/**
+ * Arrow export writes the output to a file once this much
+ * is accumulated.
+ */
+enum { ARROW_EXPORT_WRITE_SIZE = 1 << 20 };
+
+/**
+ * Get a zero-based number of a space format field given by
+ * name or by one-based number at the given index of the Lua
+ * stack.
+ */
+static uint32_t
+luaT_checkfieldno(struct lua_State *L, int idx, struct space *space,
+		  const char *usage)
+{
+	struct space_def *def = space->def;
+	if (lua_type(L, idx) == LUA_TNUMBER) {
+		int64_t fieldno = lua_tointeger(L, idx);
+		if (fieldno < 1 || fieldno > def->field_count) {
+			diag_set(ClientError, ER_NO_SUCH_FIELD_NO, (int)fieldno);
+			luaT_error(L);
+		}
+		return fieldno - 1;
+	}
+	if (lua_type(L, idx) != LUA_TSTRING)
+		luaL_error(L, "usage: %s", usage);
+	const char *name = lua_tostring(L, idx);
+	for (uint32_t i = 0; i < def->field_count; i++) {
+		if (strcmp(def->fields[i].name, name) == 0)
+			return i;
+	}
+	diag_set(ClientError, ER_NO_SUCH_FIELD_NAME_IN_SPACE, name,
+		 space_name(space));
+	luaT_error(L);
+	unreachable();
+	return 0;
+}
+
+/**
+ * Create an Arrow writer for a space given the options at the
+ * given index of the Lua stack: {fields = {name or fieldno, ...},
+ * batch_size = rows}. The columns are typed according to the
+ * current space format. The writer must be freed by the caller.
+ */
+static struct arrow_writer *
+luaT_newarrowwriter(struct lua_State *L, uint32_t space_id, int idx,
+		    const char *usage)
+{
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL) {
+		luaT_error(L);
+		return NULL;
+	}
+	struct space_def *def = space->def;
+	uint32_t batch_size = ARROW_BATCH_SIZE_DEFAULT;
+	uint32_t column_count = def->field_count;
+	uint32_t *fieldnos = NULL;
+	if (!lua_isnoneornil(L, idx)) {
+		if (lua_type(L, idx) != LUA_TTABLE)
+			luaL_error(L, "usage: %s", usage);
+		lua_getfield(L, idx, "batch_size");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TNUMBER ||
+			    lua_tointeger(L, -1) <= 0)
+				luaL_error(L, "usage: %s", usage);
+			batch_size = lua_tointeger(L, -1);
+		}
+		lua_pop(L, 1);
+		lua_getfield(L, idx, "fields");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TTABLE)
+				luaL_error(L, "usage: %s", usage);
+			column_count = lua_objlen(L, -1);
+			fieldnos = lua_newuserdata(L, column_count *
+						   sizeof(*fieldnos));
+			for (uint32_t i = 0; i < column_count; i++) {
+				lua_rawgeti(L, -2, i + 1);
+				fieldnos[i] = luaT_checkfieldno(L, -1, space,
+								usage);
+				lua_pop(L, 1);
+			}
+		}
+	}
+	if (column_count == 0) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Arrow export",
+			 "spaces without format");
+		luaT_error(L);
+	}
+	if (fieldnos == NULL) {
+		fieldnos = lua_newuserdata(L, column_count * sizeof(*fieldnos));
+		for (uint32_t i = 0; i < column_count; i++)
+			fieldnos[i] = i;
+	}
+	struct arrow_writer *writer = arrow_writer_new(def->fields, fieldnos,
+						       column_count,
+						       batch_size);
+	if (writer == NULL)
+		luaT_error(L);
+	return writer;
+}
+
+/**
+ * Convert a read view tuple to Arrow. Compressed fields are
+ * decompressed on the fiber region.
+ */
+static int
+read_view_arrow_add(struct arrow_writer *writer, const char *data,
+		    uint32_t size)
+{
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	const char *data_end = data + size;
+	int rc = tuple_data_decompress(&data, &data_end);
+	if (rc == 0)
+		rc = arrow_writer_add(writer, data);
+	region_truncate(region, region_svp);
+	return rc;
+}
+
+/** Arrow export state shared with the reader thread. */
+struct read_view_arrow_export {
+	/** Arrow stream writer. */
+	struct arrow_writer *writer;
+	/** Output file descriptor. */
+	int fd;
+	/** Number of exported rows. */
+	uint64_t row_count;
+	/** Use coio, set unless called from a reader thread. */
+	bool is_coio;
+};
+
+/** Write the Arrow data accumulated by an export to the file. */
+static int
+read_view_arrow_export_write(struct read_view_arrow_export *export)
+{
+	size_t size;
+	const char *data = arrow_writer_output(export->writer, &size);
+	while (size > 0) {
+		ssize_t rc = export->is_coio ?
+			     coio_write(export->fd, data, size) :
+			     write(export->fd, data, size);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0) {
+			diag_set(SystemError, "failed to write Arrow file");
+			return -1;
+		}
+		data += rc;
+		size -= rc;
+	}
+	arrow_writer_consume(export->writer);
+	return 0;
+}
+
+static int
+read_view_arrow_export_cb(uint32_t space_id, const char *data,
+			  uint32_t size, void *arg)
+{
+	(void)space_id;
+	struct read_view_arrow_export *export = arg;
+	if (read_view_arrow_add(export->writer, data, size) != 0)
+		return -1;
+	export->row_count++;
+	size_t output_size;
+	arrow_writer_output(export->writer, &output_size);
+	if (output_size >= ARROW_EXPORT_WRITE_SIZE)
+		return read_view_arrow_export_write(export);
+	return 0;
+}
+
+/**
+ * read_view:arrow_export(space, path[, opts]) writes tuples of
+ * a space to a file in the Apache Arrow IPC streaming format.
+ * Tuples are converted in a reader thread. Returns the number
+ * of exported rows.
+ */
+static int
+lbox_read_view_arrow_export(struct lua_State *L)
+{
+	static const char usage[] =
+		"read_view:arrow_export(space, path[, opts])";
+	struct read_view **ptr = luaT_checkreadview(L, 1, usage);
+	uint32_t space_id = luaT_checkspaceid(L, 2, usage);
+	if (lua_type(L, 3) != LUA_TSTRING)
+		return luaL_error(L, "usage: %s", usage);
+	const char *path = lua_tostring(L, 3);
+	struct read_view_space *space =
+		luaT_checkreadviewspace(L, *ptr, space_id);
+	struct read_view_arrow_export export;
+	export.writer = luaT_newarrowwriter(L, space_id, 4, usage);
+	export.row_count = 0;
+	export.is_coio = true;
+	export.fd = coio_file_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (export.fd < 0) {
+		diag_set(SystemError, "failed to open file '%s'", path);
+		arrow_writer_delete(export.writer);
+		return luaT_error(L);
+	}
+	int rc = read_view_arrow_export_write(&export);
+	if (rc == 0) {
+		export.is_coio = false;
+		rc = read_view_scan(*ptr, space, read_view_arrow_export_cb,
+				    &export);
+		export.is_coio = true;
+	}
+	if (rc == 0)
+		rc = arrow_writer_finish(export.writer);
+	if (rc == 0)
+		rc = read_view_arrow_export_write(&export);
+	arrow_writer_delete(export.writer);
+	if (coio_file_close(export.fd) != 0 && rc == 0) {
+		diag_set(SystemError, "failed to close file '%s'", path);
+		rc = -1;
+	}
+	if (rc != 0)
+		return luaT_error(L);
+	luaL_pushuint64(L, export.row_count);
+	return 1;
+}
+
+static int
+lbox_read_view_arrow_gc(struct lua_State *L)
+{
+	struct arrow_writer **ptr =
+		luaL_checkudata(L, 1, arrow_writer_typename);
+	if (*ptr != NULL)
+		arrow_writer_delete(*ptr);
+	*ptr = NULL;
+	return 0;
+}
+
+/**
+ * Get the next chunk of an Arrow stream of a read view space.
+ * The upvalues are the read view, the space id and the writer.
+ */
+static int
+lbox_read_view_arrow_next(struct lua_State *L)
+{
+	struct read_view **ptr = luaT_checkreadview(L, lua_upvalueindex(1),
+						    "read_view:arrow(space)");
+	uint32_t space_id = lua_tointeger(L, lua_upvalueindex(2));
+	struct arrow_writer **writer_ptr =
+		luaL_checkudata(L, lua_upvalueindex(3), arrow_writer_typename);
+	struct arrow_writer *writer = *writer_ptr;
+	if (writer == NULL)
+		return 0;
+	struct read_view_space *space =
+		luaT_checkreadviewspace(L, *ptr, space_id);
+	size_t size;
+	bool is_eof = false;
+	while (arrow_writer_output(writer, &size), size == 0) {
+		const char *data;
+		uint32_t data_size;
+		if (read_view_space_next(space, &data, &data_size) != 0)
+			return luaT_error(L);
+		if (data == NULL) {
+			if (arrow_writer_finish(writer) != 0)
+				return luaT_error(L);
+			is_eof = true;
+			break;
+		}
+		if (read_view_arrow_add(writer, data, data_size) != 0)
+			return luaT_error(L);
+	}
+	const char *output = arrow_writer_output(writer, &size);
+	lua_pushlstring(L, output, size);
+	arrow_writer_consume(writer);
+	if (is_eof) {
+		arrow_writer_delete(writer);
+		*writer_ptr = NULL;
+	}
+	return 1;
+}
+
+/**
+ * read_view:arrow(space[, opts]) iterates over chunks of an
+ * Apache Arrow IPC stream with tuples of a space: the schema,
+ * record batches and the end-of-stream marker. Concatenated,
+ * they make a complete stream, so the chunks can be sent to a
+ * client as they are produced, e.g. with box.session.push().
+ */
+static int
+lbox_read_view_arrow(struct lua_State *L)
+{
+	static const char usage[] = "read_view:arrow(space[, opts])";
+	struct read_view **ptr = luaT_checkreadview(L, 1, usage);
+	uint32_t space_id = luaT_checkspaceid(L, 2, usage);
+	luaT_checkreadviewspace(L, *ptr, space_id);
+	struct arrow_writer **writer_ptr = lua_newuserdata(L,
+							   sizeof(*writer_ptr));
+	*writer_ptr = NULL;
+	luaL_getmetatable(L, arrow_writer_typename);
+	lua_setmetatable(L, -2);
+	int writer_idx = lua_gettop(L);
+	*writer_ptr = luaT_newarrowwriter(L, space_id, 3, usage);
+	lua_settop(L, writer_idx);
+	lua_pushvalue(L, 1);
+	lua_pushinteger(L, space_id);
+	lua_pushvalue(L, writer_idx);
+	lua_pushcclosure(L, lbox_read_view_arrow_next, 3);
+	return 1;
+}
+
+void
+box_lua_read_view_init(struct lua_State *L)
+{
+	static const struct luaL_Reg read_view_meta[] = {
+		{"__gc", lbox_read_view_gc},
+		{"pairs", lbox_read_view_pairs},
+		{"count", lbox_read_view_count},
+		{"aggregate", lbox_read_view_aggregate},
+		{"arrow", lbox_read_view_arrow},
+		{"arrow_export", lbox_read_view_arrow_export},
+		{"close", lbox_read_view_close},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, read_view_typename, read_view_meta);
+
+	static const struct luaL_Reg arrow_writer_meta[] = {
+		{"__gc", lbox_read_view_arrow_gc},
+		{NULL, NULL}
+	};
+	luaL_register_type(L, arrow_writer_typename, arrow_writer_meta);
+
+	static const struct luaL_Reg read_view_lib[] = {
+		{"open", lbox_read_view_open},
+		{NULL, NULL}
+	};
+	luaL_register_module(L, "box.read_view", read_view_lib);
+	lua_pop(L, 1);
+}
@@ -1,6 +1,7 @@
 -- schema.lua (internal file)
 --
 local ffi = require('ffi')
+local fiber = require('fiber')
 local msgpack = require('msgpack')
 local fun = require('fun')
 local log = require('log')
@@ -16,6 +17,7 @@ local builtin = ffi.C
 -- performance fixup for hot functions
 local tuple_encode = box.internal.tuple.encode
 local tuple_bless = box.internal.tuple.bless
+local tuple_adopt = box.internal.tuple.adopt
 local is_tuple = box.tuple.is
 assert(tuple_encode ~= nil and tuple_bless ~= nil and is_tuple ~= nil)
 
@@ -40,6 +42,11 @@ ffi.cdef[[
     void
     box_iterator_free(box_iterator_t *itr);
     /** \endcond public */
+    int
+    box_iterator_next_batch(box_iterator_t *itr, box_tuple_t **result,
+                            uint32_t size);
+    void
+    box_tuple_unref_batch(box_tuple_t **tuples, uint32_t count);
     /** \cond public */
     ssize_t
     box_index_len(uint32_t space_id, uint32_t index_id);
@@ -98,6 +105,9 @@ ffi.cdef[[
     void
     port_destroy(struct port *port);
 
+    void
+    port_c_destroy_keep_refs(struct port *port);
+
     int
     box_select(uint32_t space_id, uint32_t index_id,
                int iterator, uint32_t offset, uint32_t limit,
@@ -412,6 +422,8 @@ box.schema.space.create = function(name, options)
         is_local = 'boolean',
         temporary = 'boolean',
         is_sync = 'boolean',
+        defer_deletes = 'boolean',
+        expire_field = 'number, string',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -452,11 +464,26 @@ box.schema.space.create = function(name, options)
     local format = options.format and options.format or {}
     check_param(format, 'format', 'table')
     format = update_format(format)
+    local expire_field = options.expire_field
+    if type(expire_field) == 'string' then
+        for i, field in ipairs(format) do
+            if field.name == expire_field then
+                expire_field = i
+                break
+            end
+        end
+        if type(expire_field) == 'string' then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "no field '" .. expire_field .. "' in space format")
+        end
+    end
     -- filter out global parameters from the options array
     local space_options = setmap({
         group_id = options.is_local and 1 or nil,
         temporary = options.temporary and true or nil,
-        is_sync = options.is_sync
+        is_sync = options.is_sync,
+        defer_deletes = options.defer_deletes,
+        expire_field = expire_field and expire_field - 1
     })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -940,8 +967,17 @@ local index_options = {
     run_size_ratio = 'number',
     range_size = 'number',
     page_size = 'number',
+    compaction_strategy = 'string',
     bloom_fpr = 'number',
+    bloom_type = 'string',
+    bloom_per_page = 'boolean',
+    bloom_part_count = 'number',
+    prefix_compression = 'boolean',
+    ttl = 'number',
+    ttl_field = 'number, string',
     func = 'number, string',
+    hash_type = 'string',
+    count_keys = 'boolean',
 }
 
 --
@@ -975,6 +1011,18 @@ local function func_id_by_name(func_name)
     return func.id
 end
 
+-- Get the 0-based number of the TTL field given by a 1-based
+-- number or a field name.
+local function ttl_field_resolve(format, ttl_field)
+    local fieldno, path = format_field_resolve(format, ttl_field,
+                                               'options.ttl_field')
+    if path ~= nil then
+        box.error(box.error.ILLEGAL_PARAMS,
+                  "options.ttl_field: JSON path is not supported")
+    end
+    return fieldno
+end
+
 box.schema.index.create = function(space_id, name, options)
     check_param(space_id, 'space_id', 'number')
     check_param(name, 'name', 'string')
@@ -992,6 +1040,7 @@ box.schema.index.create = function(space_id, name, options)
     local type_dependent_defaults = {
         rtree = {parts = { 2, 'array' }, unique = false},
         bitset = {parts = { 2, 'unsigned' }, unique = false},
+        text = {parts = { 2, 'string' }, unique = false},
         other = {parts = { 1, 'unsigned' }, unique = true},
     }
     options_defaults = type_dependent_defaults[options.type]
@@ -1055,8 +1104,16 @@ box.schema.index.create = function(space_id, name, options)
             range_size = options.range_size,
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
+            compaction_strategy = options.compaction_strategy,
             bloom_fpr = options.bloom_fpr,
+            bloom_type = options.bloom_type,
+            bloom_per_page = options.bloom_per_page,
+            bloom_part_count = options.bloom_part_count,
+            prefix_compression = options.prefix_compression,
+            ttl = options.ttl,
             func = options.func,
+            hash_type = options.hash_type,
+            count_keys = options.count_keys,
     }
     local field_type_aliases = {
         num = 'unsigned'; -- Deprecated since 1.7.2
@@ -1080,6 +1137,9 @@ box.schema.index.create = function(space_id, name, options)
     if index_opts.func ~= nil and type(index_opts.func) == 'string' then
         index_opts.func = func_id_by_name(index_opts.func)
     end
+    if options.ttl_field ~= nil then
+        index_opts.ttl_field = ttl_field_resolve(format, options.ttl_field)
+    end
     local sequence_proxy = space_sequence_alter_prepare(format, parts, options,
                                                         space_id, iid,
                                                         space.name, name)
@@ -1207,6 +1267,9 @@ box.schema.index.alter = function(space_id, index_id, options)
     if index_opts.func ~= nil and type(index_opts.func) == 'string' then
         index_opts.func = func_id_by_name(index_opts.func)
     end
+    if options.ttl_field ~= nil then
+        index_opts.ttl_field = ttl_field_resolve(format, options.ttl_field)
+    end
     local sequence_proxy = space_sequence_alter_prepare(format, parts, options,
                                                         space_id, index_id,
                                                         space.name, options.name)
@@ -1479,6 +1542,71 @@ base_index_mt.pairs_luac = function(index, key, opts)
         ffi.gc(cdata, builtin.box_iterator_free))
 end
 
+--
+-- Call @fn for every tuple matching @key in the given order,
+-- stop if it returns false. Tuples are fetched in batches, each
+-- referenced once in C and released after the batch, so no
+-- per-tuple Lua finalizer is set. Consequently, a tuple passed
+-- to @fn must not be used after @fn returns.
+--
+local FOREACH_BATCH_SIZE = 256
+local foreach_batch = ffi.new('box_tuple_t *[?]', FOREACH_BATCH_SIZE)
+local borrowed_tuple_t = ffi.typeof('box_tuple_t&')
+
+local function foreach_process(fn, tuples, count)
+    for i = 0, count - 1 do
+        if fn(ffi.cast(borrowed_tuple_t, tuples[i])) == false then
+            return false
+        end
+    end
+    return true
+end
+
+base_index_mt.foreach = function(index, fn, key, opts)
+    check_index_arg(index, 'foreach')
+    if type(fn) ~= 'function' then
+        error('Usage: index:foreach(fn[, key[, opts]])')
+    end
+    local pkey, pkey_end = tuple_encode(key)
+    local itype = check_iterator_type(opts, pkey + 1 >= pkey_end);
+    -- The iterator may refer to the key, keep a copy of it.
+    local keybuf = ffi.string(pkey, pkey_end - pkey)
+    local pkeybuf = ffi.cast('const char *', keybuf)
+    local it = builtin.box_index_iterator(index.space_id, index.id, itype,
+                                          pkeybuf, pkeybuf + #keybuf)
+    if it == nil then
+        box.error()
+    end
+    it = ffi.gc(it, builtin.box_iterator_free)
+    -- The batch array is shared, a nested foreach() or a yield
+    -- in @fn get their own one.
+    local tuples = foreach_batch
+    foreach_batch = nil
+    if tuples == nil then
+        tuples = ffi.new('box_tuple_t *[?]', FOREACH_BATCH_SIZE)
+    end
+    while true do
+        local count = builtin.box_iterator_next_batch(it, tuples,
+                                                      FOREACH_BATCH_SIZE)
+        if count < 0 then
+            foreach_batch = tuples
+            box.error()
+        end
+        local ok, res = pcall(foreach_process, fn, tuples, count)
+        builtin.box_tuple_unref_batch(tuples, count)
+        if not ok then
+            foreach_batch = tuples
+            error(res, 0)
+        end
+        if not res or count < FOREACH_BATCH_SIZE then
+            break
+        end
+    end
+    foreach_batch = tuples
+    it = nil -- luacheck: no unused
+    keybuf = nil -- luacheck: no unused
+end
+
 -- index subtree size
 base_index_mt.count_ffi = function(index, key, opts)
     check_index_arg(index, 'count')
@@ -1519,6 +1647,7 @@ end
 local function check_select_opts(opts, key_is_nil)
     local offset = 0
     local limit = 4294967295
+    local keys_only = false
     local iterator = check_iterator_type(opts, key_is_nil)
     if opts ~= nil then
         if opts.offset ~= nil then
@@ -1527,12 +1656,18 @@ local function check_select_opts(opts, key_is_nil)
         if opts.limit ~= nil then
             limit = opts.limit
         end
+        if opts.keys_only ~= nil then
+            keys_only = opts.keys_only
+        end
     end
-    return iterator, offset, limit
+    return iterator, offset, limit, keys_only
 end
 
 base_index_mt.select_ffi = function(index, key, opts)
     check_index_arg(index, 'select')
+    if opts ~= nil and opts.keys_only then
+        return base_index_mt.select_luac(index, key, opts)
+    end
     local key, key_end = tuple_encode(key)
     local iterator, offset, limit = check_select_opts(opts, key + 1 >= key_end)
 
@@ -1543,22 +1678,172 @@ base_index_mt.select_ffi = function(index, key, opts)
         return box.error()
     end
 
+    -- Tuple references held by the port are handed over to
+    -- the Lua objects instead of taking new ones.
     local ret = {}
     local entry = port_c.first
     for i=1,tonumber(port_c.size),1 do
-        ret[i] = tuple_bless(entry.tuple)
+        ret[i] = tuple_adopt(entry.tuple)
         entry = entry.next
     end
-    builtin.port_destroy(port);
+    builtin.port_c_destroy_keep_refs(port);
     return ret
 end
 
 base_index_mt.select_luac = function(index, key, opts)
     check_index_arg(index, 'select')
     local key = keify(key)
-    local iterator, offset, limit = check_select_opts(opts, #key == 0)
+    local iterator, offset, limit, keys_only =
+        check_select_opts(opts, #key == 0)
     return internal.select(index.space_id, index.id, iterator,
-        offset, limit, key)
+        offset, limit, key, keys_only)
+end
+
+-- Like select(), but returns a JSON array of tuples encoded
+-- straight from MessagePack, see tuple:tojson().
+base_index_mt.select_json = function(index, key, opts)
+    check_index_arg(index, 'select_json')
+    local key = keify(key)
+    local iterator, offset, limit = check_select_opts(opts, #key == 0)
+    local names = true
+    if opts ~= nil and opts.names ~= nil then
+        names = opts.names
+    end
+    return internal.select_json(index.space_id, index.id, iterator,
+        offset, limit, key, names)
+end
+
+base_index_mt.get_batch = function(index, keys)
+    check_index_arg(index, 'get_batch')
+    if type(keys) ~= 'table' then
+        box.error(box.error.ILLEGAL_PARAMS,
+                  "Usage: index:get_batch({key1, key2, ...})")
+    end
+    local batch = {}
+    for i, key in ipairs(keys) do
+        batch[i] = keify(key)
+    end
+    return internal.get_batch(index.space_id, index.id, batch)
+end
+
+--
+-- Return keys splitting the index into at most @count ranges of
+-- about the same size, in ascending order. Vinyl uses boundaries
+-- of its on-disk ranges, other engines don't split indexes.
+--
+base_index_mt.split = function(index, count)
+    check_index_arg(index, 'split')
+    if type(count) ~= 'number' or count < 1 then
+        box.error(box.error.ILLEGAL_PARAMS, "Usage: index:split(count)")
+    end
+    return internal.split(index.space_id, index.id, count)
+end
+
+--
+-- Scan a range of the index in chunks of @chunk_size tuples and
+-- put them to @ch, then put false. On error put {error = err}.
+-- Stop if the channel is closed.
+--
+local function parallel_scan_f(index, key_def, range, chunk_size, ch)
+    local chunk = {}
+    local ok, err = pcall(function()
+        for _, tuple in index:pairs(range.first, {iterator = 'GE'}) do
+            if range.last ~= nil and
+               key_def:compare_with_key(tuple, range.last) >= 0 then
+                break
+            end
+            table.insert(chunk, tuple)
+            if #chunk == chunk_size then
+                if not ch:put(chunk) then
+                    return
+                end
+                chunk = {}
+            end
+        end
+    end)
+    if not ok then
+        ch:put({error = err})
+    elseif #chunk == 0 or ch:put(chunk) then
+        ch:put(false)
+    end
+end
+
+local PARALLEL_SCAN_FIBERS = 4
+local PARALLEL_SCAN_CHUNK = 256
+
+--
+-- Iterate over all tuples of the index, scanning ranges returned
+-- by index:split() in separate fibers, so that disk reads of all
+-- ranges are issued at once. Each fiber reads up to two chunks
+-- ahead. If opts.ordered is set, tuples are returned in the index
+-- order, otherwise chunks are returned as soon as they are read.
+-- The fibers don't share a read view, so unlike pairs() the scan
+-- may see changes made while it is in progress.
+--
+base_index_mt.pairs_parallel = function(index, opts)
+    check_index_arg(index, 'pairs_parallel')
+    local fibers = PARALLEL_SCAN_FIBERS
+    local chunk_size = PARALLEL_SCAN_CHUNK
+    local ordered = false
+    if opts ~= nil then
+        if type(opts) ~= 'table' then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "Usage: index:pairs_parallel([{fibers = <number>, " ..
+                      "chunk = <number>, ordered = <boolean>}])")
+        end
+        fibers = opts.fibers or fibers
+        chunk_size = opts.chunk or chunk_size
+        ordered = opts.ordered or false
+    end
+    local keys = index:split(fibers)
+    local key_def = require('key_def').new(index.parts)
+    local range_count = #keys + 1
+    local channels = {}
+    local shared = not ordered and fiber.channel(2 * range_count) or nil
+    for i = 1, range_count do
+        local ch = shared or fiber.channel(2)
+        channels[i] = ch
+        fiber.new(parallel_scan_f, index, key_def,
+                  {first = keys[i - 1], last = keys[i]}, chunk_size, ch)
+    end
+    local function close()
+        for _, ch in ipairs(channels) do
+            ch:close()
+        end
+    end
+    -- Stop the fibers if the iterator is dropped halfway.
+    local guard = ffi.gc(ffi.new('char[1]'), close)
+    local chunk = {}
+    local pos = 0
+    local current = 1
+    local function next_chunk()
+        while current <= range_count do
+            local msg = channels[current]:get()
+            if msg == false then
+                current = current + 1
+            elseif msg.error ~= nil then
+                close()
+                error(msg.error, 0)
+            else
+                return msg
+            end
+        end
+        close()
+        return nil
+    end
+    local function gen(_, state)
+        pos = pos + 1
+        if pos > #chunk then
+            local msg = next_chunk()
+            if msg == nil then
+                return nil
+            end
+            chunk = msg
+            pos = 1
+        end
+        return state + 1, chunk[pos]
+    end
+    return fun.wrap(gen, guard, 0)
 end
 
 base_index_mt.update = function(index, key, ops)
@@ -1569,6 +1854,11 @@ base_index_mt.delete = function(index, key)
     check_index_arg(index, 'delete')
     return internal.delete(index.space_id, index.id, keify(key));
 end
+base_index_mt.delete_range = function(index, begin_key, end_key)
+    check_index_arg(index, 'delete_range')
+    return internal.delete_range(index.space_id, index.id,
+                                 keify(begin_key), keify(end_key))
+end
 
 base_index_mt.stat = function(index)
     return internal.stat(index.space_id, index.id);
@@ -1631,14 +1921,31 @@ space_mt.bsize = function(space)
     return builtin.space_bsize(s)
 end
 
+space_mt.stat = function(space)
+    check_space_arg(space, 'stat')
+    return box.internal.space.stat(space.id)
+end
+
 space_mt.get = function(space, key)
     check_space_arg(space, 'get')
     return check_primary_index(space):get(key)
 end
+space_mt.get_batch = function(space, keys)
+    check_space_arg(space, 'get_batch')
+    return check_primary_index(space):get_batch(keys)
+end
+space_mt.pairs_parallel = function(space, opts)
+    check_space_arg(space, 'pairs_parallel')
+    return check_primary_index(space):pairs_parallel(opts)
+end
 space_mt.select = function(space, key, opts)
     check_space_arg(space, 'select')
     return check_primary_index(space):select(key, opts)
 end
+space_mt.select_json = function(space, key, opts)
+    check_space_arg(space, 'select_json')
+    return check_primary_index(space):select_json(key, opts)
+end
 space_mt.insert = function(space, tuple)
     check_space_arg(space, 'insert')
     return internal.insert(space.id, tuple);
@@ -1666,6 +1973,10 @@ space_mt.delete = function(space, key)
     check_space_arg(space, 'delete')
     return check_primary_index(space):delete(key)
 end
+space_mt.delete_range = function(space, begin_key, end_key)
+    check_space_arg(space, 'delete_range')
+    return check_primary_index(space):delete_range(begin_key, end_key)
+end
 -- Assumes that spaceno has a TREE (NUM) primary key
 -- inserts a tuple after getting the next value of the
 -- primary key and returns it back to the user
@@ -1731,6 +2042,127 @@ space_mt.run_triggers = function(space, yesno)
     end
     builtin.space_run_triggers(s, yesno)
 end
+space_mt.bulk_load = function(space)
+    check_space_arg(space, 'bulk_load')
+    check_space_exists(space)
+    return box.bulk_load.new(space.id)
+end
+
+--
+-- Background space upgrade. Tuples are converted by @func in
+-- primary key order, @batch_size tuples per transaction, so that
+-- the space stays available while a big space is migrated. Once
+-- all tuples are converted, @format (if given) is installed. The
+-- conversion function must keep the primary key and must accept
+-- tuples that are already converted, because they may be written
+-- by the application during the upgrade.
+--
+local upgrade_mt = {}
+upgrade_mt.__index = upgrade_mt
+
+local function upgrade_batch(space, pk, key_def, func, last, batch_size)
+    box.begin()
+    local tuples = pk:select(last, {iterator = 'GT', limit = batch_size})
+    for _, tuple in ipairs(tuples) do
+        local new_tuple = box.tuple.new(func(tuple))
+        if key_def:compare(tuple, new_tuple) ~= 0 then
+            box.error(box.error.PROC_LUA,
+                      'space upgrade function must not change ' ..
+                      'the primary key')
+        end
+        space:replace(new_tuple)
+    end
+    box.commit()
+    return tuples
+end
+
+local function upgrade_f(upgrade, space, func, format, batch_size)
+    local pk = space.index[0]
+    local key_def = require('key_def').new(pk.parts)
+    local last = nil
+    while not upgrade.is_cancelled do
+        local ok, tuples = pcall(upgrade_batch, space, pk, key_def,
+                                 func, last, batch_size)
+        if not ok then
+            if box.is_in_txn() then
+                box.rollback()
+            end
+            upgrade.error = tuples
+            break
+        end
+        if #tuples == 0 then
+            break
+        end
+        upgrade.processed = upgrade.processed + #tuples
+        last = key_def:extract_key(tuples[#tuples])
+        fiber.yield()
+    end
+    if upgrade.error == nil and upgrade.is_cancelled then
+        upgrade.error = 'space upgrade was cancelled'
+    end
+    if upgrade.error == nil and format ~= nil then
+        local ok, err = pcall(space.format, space, format)
+        if not ok then
+            upgrade.error = err
+        end
+    end
+    upgrade.status = upgrade.error == nil and 'done' or 'error'
+    if upgrade.error ~= nil then
+        log.error("space '%s' upgrade failed: %s", space.name,
+                  tostring(upgrade.error))
+    else
+        log.info("space '%s' upgraded, %d tuples converted", space.name,
+                 upgrade.processed)
+    end
+    upgrade.cond:broadcast()
+end
+
+-- Return the upgrade progress.
+function upgrade_mt:info()
+    return {status = self.status, processed = self.processed,
+            error = self.error}
+end
+
+-- Wait until the upgrade ends. Returns true on success.
+function upgrade_mt:wait(timeout)
+    local deadline = timeout and fiber.clock() + timeout
+    while self.status == 'inprogress' do
+        local wait_timeout = deadline and deadline - fiber.clock()
+        if wait_timeout ~= nil and wait_timeout <= 0 then
+            break
+        end
+        self.cond:wait(wait_timeout)
+    end
+    return self.status == 'done'
+end
+
+-- Stop the upgrade after the current batch.
+function upgrade_mt:cancel()
+    self.is_cancelled = true
+end
+
+space_mt.upgrade = function(space, opts)
+    check_space_arg(space, 'upgrade')
+    check_space_exists(space)
+    check_param(opts, 'opts', 'table')
+    check_param_table(opts, {func = 'function', format = 'table',
+                             batch_size = 'number'})
+    if opts.func == nil then
+        box.error(box.error.ILLEGAL_PARAMS, "options parameter 'func' " ..
+                  "is mandatory")
+    end
+    check_primary_index(space)
+    local upgrade = setmetatable({
+        status = 'inprogress',
+        processed = 0,
+        is_cancelled = false,
+        cond = fiber.cond(),
+    }, upgrade_mt)
+    local f = fiber.new(upgrade_f, upgrade, space, opts.func, opts.format,
+                        opts.batch_size or 1000)
+    f:name('space_upgrade', {truncate = true})
+    return upgrade
+end
 space_mt.frommap = box.internal.space.frommap
 space_mt.__index = space_mt
 
@@ -388,6 +388,34 @@ lbox_session_push(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * box.session.priority([priority])
+ * Return the priority class of the current session requests,
+ * set it first if a new class is given.
+ */
+static int
+lbox_session_priority(struct lua_State *L)
+{
+	struct session *session = current_session();
+	int top = lua_gettop(L);
+	if (top > 1 || (top == 1 && lua_type(L, 1) != LUA_TSTRING))
+		return luaL_error(L, "Usage: box.session.priority([priority])");
+	if (top == 1) {
+		const char *name = lua_tostring(L, 1);
+		enum session_priority priority =
+			STR2ENUM(session_priority, name);
+		if (priority == session_priority_MAX) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "priority must be 'high', 'normal' or 'low'");
+			return luaT_error(L);
+		}
+		if (session_set_priority(session, priority) != 0)
+			return luaT_error(L);
+	}
+	lua_pushstring(L, session_priority_strs[session->priority]);
+	return 1;
+}
+
 /**
  * Sets trigger on_access_denied.
  * For test purposes only.
@@ -570,6 +598,7 @@ box_lua_session_init(struct lua_State *L)
 		{"on_auth", lbox_session_on_auth},
 		{"on_access_denied", lbox_session_on_access_denied},
 		{"push", lbox_session_push},
+		{"priority", lbox_session_priority},
 		{NULL, NULL}
 	};
 	luaL_register_module(L, sessionlib_name, sessionlib);
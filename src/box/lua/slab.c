@@ -43,6 +43,9 @@
 #include "memory.h"
 #include "box/engine.h"
 #include "box/memtx_engine.h"
+#include "box/iproto.h"
+#include "box/tuple.h"
+#include "fiber.h"
 
 static int
 small_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
@@ -228,6 +231,50 @@ lbox_slab_info(struct lua_State *L)
 	lua_pushstring(L, ratio_buf);
 	lua_settable(L, -3);
 
+	/*
+	 * NUMA policy applied to the arena and the node
+	 * the tx thread ran on at startup, -1 if unknown.
+	 */
+	lua_pushstring(L, "numa_policy");
+	lua_pushstring(L, numa_policy_strs[memtx->numa_policy]);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "numa_node");
+	lua_pushinteger(L, memtx->numa_node);
+	lua_settable(L, -3);
+
+	/*
+	 * Kind of huge pages backing the arena and how much of
+	 * the touched arena they cover.
+	 */
+	lua_pushstring(L, "hugepages");
+	lua_pushstring(L, hugepages_mode_strs[memtx->hugepages]);
+	lua_settable(L, -3);
+
+	ssize_t huge_used = 0;
+	if (memtx->hugepages != HUGEPAGES_NONE) {
+		huge_used = hugepages_used(memtx->arena.arena,
+					   memtx->arena.prealloc);
+		if (huge_used < 0)
+			huge_used = 0;
+	}
+	lua_pushstring(L, "hugepages_used");
+	luaL_pushuint64(L, huge_used);
+	lua_settable(L, -3);
+
+	ratio = 100 * ((double) huge_used /
+		       ((double) arena_size + 0.0001));
+	snprintf(ratio_buf, sizeof(ratio_buf), "%0.1lf%%", ratio);
+
+	lua_pushstring(L, "hugepages_ratio");
+	lua_pushstring(L, ratio_buf);
+	lua_settable(L, -3);
+
+	/* Tuples moved by defragmentation, see memtx_defrag_budget. */
+	lua_pushstring(L, "defrag_relocated");
+	luaL_pushuint64(L, memtx->defrag_relocated);
+	lua_settable(L, -3);
+
 	return 1;
 }
 
@@ -251,6 +298,25 @@ lbox_runtime_info(struct lua_State *L)
 	lua_pushinteger(L, G(L)->gc.total);
 	lua_settable(L, -3);
 
+	/*
+	 * Breakdown of the runtime arena by subsystem.
+	 */
+	lua_pushstring(L, "tuple");
+	luaL_pushuint64(L, tuple_runtime_mem_used());
+	lua_settable(L, -3);
+
+	size_t region = region_total(&cord()->sched.gc);
+	struct fiber *f;
+	rlist_foreach_entry(f, &cord()->alive, link)
+		region += region_total(&f->gc);
+	lua_pushstring(L, "region");
+	luaL_pushuint64(L, region);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "net");
+	luaL_pushuint64(L, iproto_mem_used());
+	lua_settable(L, -3);
+
 	return 1;
 }
 
@@ -35,6 +35,8 @@
 #include "box/sql/sqlLimit.h"
 #include "lua/utils.h"
 #include "lua/trigger.h"
+#include "lua/info.h"
+#include "info/info.h"
 
 extern "C" {
 	#include <lua.h>
@@ -258,6 +260,14 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 	lua_pushboolean(L, space->def->opts.is_sync);
 	lua_settable(L, i);
 
+	/* space.expire_field */
+	lua_pushstring(L, "expire_field");
+	if (space->def->opts.expire_field != UINT32_MAX)
+		lua_pushinteger(L, space->def->opts.expire_field + 1);
+	else
+		lua_pushnil(L);
+	lua_settable(L, i);
+
 	lua_pushstring(L, "enabled");
 	lua_pushboolean(L, space_index(space, 0) != 0);
 	lua_settable(L, i);
@@ -364,6 +374,23 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 		lua_pushstring(L, index_type_strs[index_def->type]);
 		lua_setfield(L, -2, "type");
 
+		lua_pushstring(L, "hash_type");
+		if (index_def->type == HASH &&
+		    index_opts->hash_type != INDEX_HASH_LIGHT) {
+			lua_pushstring(L, index_hash_type_strs[
+					index_opts->hash_type]);
+		} else {
+			lua_pushnil(L);
+		}
+		lua_rawset(L, -3);
+
+		lua_pushstring(L, "count_keys");
+		if (index_opts->count_keys)
+			lua_pushboolean(L, true);
+		else
+			lua_pushnil(L);
+		lua_rawset(L, -3);
+
 		lua_pushnumber(L, index_def->iid);
 		lua_setfield(L, -2, "id");
 
@@ -429,9 +456,45 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 			lua_pushnumber(L, index_opts->run_size_ratio);
 			lua_setfield(L, -2, "run_size_ratio");
 
+			enum index_compaction_strategy strategy =
+				index_opts->compaction_strategy;
+			if (strategy != INDEX_COMPACTION_LEVELED) {
+				lua_pushstring(L,
+					index_compaction_strategy_strs[strategy]);
+				lua_setfield(L, -2, "compaction_strategy");
+			}
+
 			lua_pushnumber(L, index_opts->bloom_fpr);
 			lua_setfield(L, -2, "bloom_fpr");
 
+			if (index_opts->bloom_type != TUPLE_BLOOM_BLOOM) {
+				lua_pushstring(L, tuple_bloom_type_strs[
+						index_opts->bloom_type]);
+				lua_setfield(L, -2, "bloom_type");
+			}
+
+			if (index_opts->bloom_per_page) {
+				lua_pushboolean(L, true);
+				lua_setfield(L, -2, "bloom_per_page");
+			}
+
+			if (index_opts->bloom_part_count > 0) {
+				lua_pushnumber(L, index_opts->bloom_part_count);
+				lua_setfield(L, -2, "bloom_part_count");
+			}
+
+			if (index_opts->prefix_compression) {
+				lua_pushboolean(L, true);
+				lua_setfield(L, -2, "prefix_compression");
+			}
+
+			if (index_opts->ttl > 0) {
+				lua_pushnumber(L, index_opts->ttl);
+				lua_setfield(L, -2, "ttl");
+				lua_pushnumber(L, index_opts->ttl_field + 1);
+				lua_setfield(L, -2, "ttl_field");
+			}
+
 			lua_settable(L, -3);
 		}
 		lua_setfield(L, -2, index_def->name);
@@ -603,6 +666,26 @@ usage_error:
 	return luaL_error(L, "Usage: space:frommap(map, opts)");
 }
 
+/**
+ * Request counters of a space and its indexes.
+ * @param Lua space id.
+ * @retval A table with counters.
+ */
+static int
+lbox_space_stat(struct lua_State *L)
+{
+	if (lua_gettop(L) != 1 || !lua_isnumber(L, 1))
+		return luaL_error(L, "usage space.stat(space_id)");
+	uint32_t space_id = lua_tonumber(L, 1);
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return luaT_error(L);
+	struct info_handler info;
+	luaT_info_handler_create(&info, L);
+	space_stat_info(space, &info);
+	return 1;
+}
+
 void
 box_lua_space_init(struct lua_State *L)
 {
@@ -702,6 +785,7 @@ box_lua_space_init(struct lua_State *L)
 
 	static const struct luaL_Reg space_internal_lib[] = {
 		{"frommap", lbox_space_frommap},
+		{"stat", lbox_space_stat},
 		{NULL, NULL}
 	};
 	luaL_register(L, "box.internal.space", space_internal_lib);
@@ -40,17 +40,18 @@
 
 #include "box/box.h"
 #include "box/iproto.h"
+#include "box/iproto_constants.h"
 #include "box/engine.h"
 #include "box/vinyl.h"
 #include "box/sql.h"
+#include "box/wal.h"
+#include "coio_task.h"
 #include "info/info.h"
 #include "lua/info.h"
 #include "lua/utils.h"
 
 extern struct rmean *rmean_box;
 extern struct rmean *rmean_error;
-/** network statistics (iproto & cbus) */
-extern struct rmean *rmean_net;
 extern struct rmean *rmean_tx_wal_bus;
 
 static void
@@ -148,7 +149,7 @@ static int
 lbox_stat_net_index(struct lua_State *L)
 {
 	const char *key = luaL_checkstring(L, -1);
-	if (rmean_foreach(rmean_net, seek_stat_item, L) == 0)
+	if (iproto_rmean_foreach(seek_stat_item, L) == 0)
 		return 0;
 
 	if (strcmp(key, "CONNECTIONS") == 0) {
@@ -183,7 +184,7 @@ static int
 lbox_stat_net_call(struct lua_State *L)
 {
 	lua_newtable(L);
-	rmean_foreach(rmean_net, set_stat_item, L);
+	iproto_rmean_foreach(set_stat_item, L);
 
 	lua_pushstring(L, "CONNECTIONS");
 	lua_rawget(L, -2);
@@ -211,6 +212,118 @@ lbox_stat_sql(struct lua_State *L)
 	return 1;
 }
 
+static void
+lbox_stat_wal_dist(struct info_handler *h, const char *name,
+		   const struct wal_stat_dist *dist)
+{
+	info_table_begin(h, name);
+	info_append_double(h, "p50", dist->p50);
+	info_append_double(h, "p90", dist->p90);
+	info_append_double(h, "p99", dist->p99);
+	info_table_end(h);
+}
+
+static int
+lbox_stat_wal(struct lua_State *L)
+{
+	struct wal_stat stat;
+	wal_get_stat(&stat);
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	info_begin(&h);
+	info_append_int(&h, "writes", stat.writes);
+	info_append_int(&h, "entries", stat.entries);
+	info_append_int(&h, "rows", stat.rows);
+	info_append_int(&h, "bytes", stat.bytes);
+	info_append_int(&h, "syncs", stat.syncs);
+	info_append_int(&h, "rollbacks", stat.rollbacks);
+	info_table_begin(&h, "batch");
+	lbox_stat_wal_dist(&h, "rows", &stat.batch_rows);
+	lbox_stat_wal_dist(&h, "bytes", &stat.batch_bytes);
+	info_table_end(&h);
+	info_table_begin(&h, "time");
+	lbox_stat_wal_dist(&h, "write", &stat.write_time);
+	lbox_stat_wal_dist(&h, "sync", &stat.sync_time);
+	lbox_stat_wal_dist(&h, "commit", &stat.commit_time);
+	info_table_end(&h);
+	info_table_begin(&h, "group_commit");
+	info_append_int(&h, "delayed", stat.delayed);
+	info_append_int(&h, "merged", stat.merged);
+	info_append_int(&h, "timeouts", stat.timeouts);
+	info_table_end(&h);
+	info_end(&h);
+	return 1;
+}
+
+static int
+lbox_stat_latency(struct lua_State *L)
+{
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	iproto_latency_stat(&h);
+	return 1;
+}
+
+static int
+lbox_stat_push_trace(const struct iproto_trace *trace, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *)cb_ctx;
+	lua_newtable(L);
+	luaL_pushuint64(L, trace->id);
+	lua_setfield(L, -2, "id");
+	const char *type = iproto_type_name(trace->type);
+	if (type != NULL)
+		lua_pushstring(L, type);
+	else
+		lua_pushinteger(L, trace->type);
+	lua_setfield(L, -2, "type");
+	luaL_pushuint64(L, trace->sync);
+	lua_setfield(L, -2, "sync");
+	lua_pushnumber(L, trace->start);
+	lua_setfield(L, -2, "start");
+	lua_pushnumber(L, trace->net);
+	lua_setfield(L, -2, "net");
+	lua_pushnumber(L, trace->tx);
+	lua_setfield(L, -2, "tx");
+	lua_pushnumber(L, trace->wal);
+	lua_setfield(L, -2, "wal");
+	lua_pushnumber(L, trace->limbo);
+	lua_setfield(L, -2, "limbo");
+	lua_rawseti(L, -2, lua_objlen(L, -2) + 1);
+	return 0;
+}
+
+/**
+ * Return the recent request traces, the oldest first, see
+ * iproto_trace_foreach().
+ */
+static int
+lbox_stat_traces(struct lua_State *L)
+{
+	lua_newtable(L);
+	iproto_trace_foreach(lbox_stat_push_trace, L);
+	return 1;
+}
+
+static int
+lbox_stat_worker_pool(struct lua_State *L)
+{
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	info_begin(&h);
+	for (int i = 0; i < coio_pool_MAX; i++) {
+		struct coio_pool_stat stat;
+		coio_pool_stat(i, &stat);
+		info_table_begin(&h, coio_pool_strs[i]);
+		info_append_int(&h, "threads", stat.threads);
+		info_append_int(&h, "running", stat.running);
+		info_append_int(&h, "queued", stat.queued);
+		info_table_end(&h);
+	}
+	info_end(&h);
+	return 1;
+}
+
 static const struct luaL_Reg lbox_stat_meta [] = {
 	{"__index", lbox_stat_index},
 	{"__call",  lbox_stat_call},
@@ -231,6 +344,10 @@ box_lua_stat_init(struct lua_State *L)
 		{"vinyl", lbox_stat_vinyl},
 		{"reset", lbox_stat_reset},
 		{"sql", lbox_stat_sql},
+		{"wal", lbox_stat_wal},
+		{"latency", lbox_stat_latency},
+		{"traces", lbox_stat_traces},
+		{"worker_pool", lbox_stat_worker_pool},
 		{NULL, NULL}
 	};
 
@@ -43,6 +43,7 @@
 #include "box/errcode.h"
 #include "json/json.h"
 #include "mpstream/mpstream.h"
+#include "third_party/lua-cjson/lua_cjson.h"
 
 /** {{{ box.tuple Lua library
  *
@@ -101,11 +102,22 @@ luaT_istuple(struct lua_State *L, int narg)
 struct tuple *
 luaT_tuple_new(struct lua_State *L, int idx, box_tuple_format_t *format)
 {
-	if (idx != 0 && !lua_istable(L, idx) && !luaT_istuple(L, idx)) {
+	struct tuple *src = idx != 0 ? luaT_istuple(L, idx) : NULL;
+	if (idx != 0 && !lua_istable(L, idx) && src == NULL) {
 		diag_set(IllegalParams, "A tuple or a table expected, got %s",
 			 lua_typename(L, lua_type(L, idx)));
 		return NULL;
 	}
+	if (src != NULL) {
+		/*
+		 * The source tuple is already encoded, create
+		 * the new one right from its data without copying
+		 * it to the buffer first.
+		 */
+		uint32_t bsize;
+		const char *data = tuple_data_range(src, &bsize);
+		return box_tuple_new(format, data, data + bsize);
+	}
 
 	struct ibuf *buf = tarantool_lua_ibuf;
 	ibuf_reset(buf);
@@ -348,6 +360,53 @@ error:
 	return 1;
 }
 
+void
+luaT_tuple_append_json(struct lua_State *L, struct tuple *tuple,
+		       bool use_names)
+{
+	struct tuple_dictionary *dict = tuple_format(tuple)->dict;
+	const char *data = tuple_data(tuple);
+	if (use_names && dict->name_count > 0) {
+		json_mp_append(L, NULL, &data,
+			       (const char *const *)dict->names,
+			       dict->name_count);
+	} else {
+		json_mp_append(L, NULL, &data, NULL, 0);
+	}
+}
+
+/**
+ * Encode a tuple as JSON straight from MessagePack, without
+ * converting it into a Lua table. Named fields are encoded as
+ * {"name": value} pairs, not named ones are keyed by their
+ * 1-based number. If the format has no names or names = false
+ * is passed, the tuple is encoded as an array.
+ */
+static int
+lbox_tuple_to_json(struct lua_State *L)
+{
+	int argc = lua_gettop(L);
+	if (argc < 1 || argc > 2)
+		goto error;
+	bool use_names = true;
+	if (argc == 2) {
+		if (!lua_istable(L, 2))
+			goto error;
+		lua_getfield(L, 2, "names");
+		if (!lua_isboolean(L, -1) && !lua_isnil(L, -1))
+			goto error;
+		use_names = lua_isnil(L, -1) || lua_toboolean(L, -1);
+		lua_pop(L, 1);
+	}
+	struct tuple *tuple = luaT_checktuple(L, 1);
+	json_mp_start();
+	luaT_tuple_append_json(L, tuple, use_names);
+	json_mp_push(L);
+	return 1;
+error:
+	return luaL_error(L, "Usage: tuple:tojson(opts)");
+}
+
 /**
  * Tuple transforming function.
  *
@@ -455,40 +514,6 @@ lbox_tuple_transform(struct lua_State *L)
 	return 1;
 }
 
-/**
- * Find a tuple field by JSON path. If a field was not found and a
- * path contains JSON syntax errors, then an exception is raised.
- * @param L Lua state.
- * @param tuple 1-th argument on a lua stack, tuple to get field
- *        from.
- * @param path 2-th argument on lua stack. Can be field name or a
- *        JSON path to a field.
- *
- * @retval not nil Found field value.
- * @retval     nil A field is NULL or does not exist.
- */
-static int
-lbox_tuple_field_by_path(struct lua_State *L)
-{
-	struct tuple *tuple = luaT_istuple(L, 1);
-	/* Is checked in Lua wrapper. */
-	assert(tuple != NULL);
-	assert(lua_isstring(L, 2));
-	size_t len;
-	const char *field = NULL, *path = lua_tolstring(L, 2, &len);
-	if (len == 0)
-		return 0;
-	field = tuple_field_raw_by_full_path(tuple_format(tuple),
-					     tuple_data(tuple),
-					     tuple_field_map(tuple),
-					     path, (uint32_t)len,
-					     lua_hashstring(L, 2));
-	if (field == NULL)
-		return 0;
-	luamp_decode(L, luaL_msgpack_default, &field);
-	return 1;
-}
-
 static int
 lbox_tuple_to_string(struct lua_State *L)
 {
@@ -523,7 +548,7 @@ static const struct luaL_Reg lbox_tuple_meta[] = {
 	{"slice", lbox_tuple_slice},
 	{"transform", lbox_tuple_transform},
 	{"tuple_to_map", lbox_tuple_to_map},
-	{"tuple_field_by_path", lbox_tuple_field_by_path},
+	{"tuple_to_json", lbox_tuple_to_json},
 	{NULL, NULL}
 };
 
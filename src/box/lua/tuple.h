@@ -30,6 +30,7 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
 #include <stddef.h>
 
 #if defined(__cplusplus)
@@ -113,6 +114,17 @@ luamp_encode_tuple(struct lua_State *L, struct luaL_serializer *cfg,
 void
 tuple_to_mpstream(struct tuple *tuple, struct mpstream *stream);
 
+/**
+ * Append @a tuple as JSON to the encoding buffer of the json
+ * module, see json_mp_append(). If @a use_names is set and the
+ * tuple format has field names, the tuple is encoded as an
+ * object keyed by them, otherwise as an array.
+ * @throws Lua error on encoding failure.
+ */
+void
+luaT_tuple_append_json(struct lua_State *L, struct tuple *tuple,
+		       bool use_names);
+
 void
 box_lua_tuple_init(struct lua_State *L);
 
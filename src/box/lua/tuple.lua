@@ -56,6 +56,10 @@ box_tuple_update(box_tuple_t *tuple, const char *expr, const char *expr_end);
 
 box_tuple_t *
 box_tuple_upsert(box_tuple_t *tuple, const char *expr, const char *expr_end);
+
+const char *
+box_tuple_field_by_path(box_tuple_t *tuple, const char *path,
+                        uint32_t path_len);
 ]]
 
 local builtin = ffi.C
@@ -101,6 +105,12 @@ local tuple_bless = function(tuple)
     return ffi.gc(ffi.cast(const_tuple_ref_t, tuple), tuple_gc)
 end
 
+-- Like tuple_bless(), but take over a reference the caller
+-- already holds instead of taking a new one.
+local tuple_adopt = function(tuple)
+    return ffi.gc(ffi.cast(const_tuple_ref_t, tuple), tuple_gc)
+end
+
 local tuple_check = function(tuple, usage)
     if not is_tuple(tuple) then
         error('Usage: ' .. usage)
@@ -266,11 +276,6 @@ end
 
 msgpackffi.on_encode(const_tuple_ref_t, tuple_to_msgpack)
 
-local function tuple_field_by_path(tuple, path)
-    tuple_check(tuple, "tuple['field_name']");
-    return internal.tuple.tuple_field_by_path(tuple, path)
-end
-
 local methods = {
     ["next"]        = tuple_next;
     ["ipairs"]      = tuple_ipairs;
@@ -285,6 +290,7 @@ local methods = {
     ["upsert"]      = tuple_upsert;
     ["bsize"]       = tuple_bsize;
     ["tomap"]       = internal.tuple.tuple_to_map;
+    ["tojson"]      = internal.tuple.tuple_to_json;
 }
 
 -- Aliases for tuple:methods().
@@ -303,6 +309,14 @@ local tuple_field = function(tuple, field_n)
     return (msgpackffi.decode_unchecked(field))
 end
 
+local tuple_field_by_path = function(tuple, path)
+    local field = builtin.box_tuple_field_by_path(tuple, path, #path)
+    if field == nil then
+        return nil
+    end
+    return (msgpackffi.decode_unchecked(field))
+end
+
 ffi.metatype(tuple_t, {
     __len = function(tuple)
         return builtin.box_tuple_field_count(tuple)
@@ -344,10 +358,12 @@ ffi.metatype(tuple_iterator_t, {
 internal.tuple.slice = nil
 internal.tuple.transform = nil
 internal.tuple.tuple_to_map = nil
+internal.tuple.tuple_to_json = nil
 internal.tuple.tostring = nil
 
 -- internal api for box.select and iterators
 internal.tuple.bless = tuple_bless
+internal.tuple.adopt = tuple_adopt
 internal.tuple.encode = tuple_encode
 
 -- Public API, additional to implemented in C.
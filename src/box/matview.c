@@ -0,0 +1,800 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "matview.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <msgpuck/msgpuck.h>
+#include <small/region.h>
+
+#include "box.h"
+#include "coll_id.h"
+#include "diag.h"
+#include "errcode.h"
+#include "fiber.h"
+#include "index.h"
+#include "iproto_constants.h"
+#include "key_def.h"
+#include "schema.h"
+#include "session.h"
+#include "space.h"
+#include "sql.h"
+#include "sql/sqlInt.h"
+#include "tt_static.h"
+#include "tuple.h"
+#include "txn.h"
+#include "xrow.h"
+
+/** Views maintained at the moment. */
+static RLIST_HEAD(matviews);
+
+/** Set an error about a SELECT unfit for a materialized view. */
+static void
+matview_error(const char *name, const char *reason)
+{
+	diag_set(ClientError, ER_CREATE_SPACE, name,
+		 tt_sprintf("materialized view %s", reason));
+}
+
+/**
+ * Find the source field referred by a column of the SELECT.
+ * Only plain column names are allowed.
+ */
+static int
+matview_resolve_field(struct space_def *source, struct Expr *expr,
+		      const char *name, uint32_t *fieldno)
+{
+	if (expr->op != TK_ID) {
+		matview_error(name, "may only refer to plain columns");
+		return -1;
+	}
+	for (uint32_t i = 0; i < source->field_count; ++i) {
+		if (strcmp(source->fields[i].name, expr->u.zToken) == 0) {
+			*fieldno = i;
+			return 0;
+		}
+	}
+	diag_set(ClientError, ER_NO_SUCH_FIELD_NAME_IN_SPACE, expr->u.zToken,
+		 source->name);
+	return -1;
+}
+
+/** Fill a column of the view by an aggregate function call. */
+static int
+matview_column_by_func(struct matview_column *col, struct space_def *source,
+		       struct Expr *expr, const char *name)
+{
+	const char *func = expr->u.zToken;
+	struct ExprList *args = expr->x.pList;
+	if (ExprHasProperty(expr, EP_Distinct | EP_xIsSelect))
+		goto unsupported;
+	if (args == NULL) {
+		if (strcmp(func, "COUNT") != 0)
+			goto unsupported;
+		col->agg = MATVIEW_AGG_COUNT_ALL;
+		col->fieldno = 0;
+		col->type = FIELD_TYPE_INTEGER;
+		return 0;
+	}
+	if (args->nExpr != 1)
+		goto unsupported;
+	if (strcmp(func, "COUNT") == 0)
+		col->agg = MATVIEW_AGG_COUNT;
+	else if (strcmp(func, "SUM") == 0)
+		col->agg = MATVIEW_AGG_SUM;
+	else if (strcmp(func, "MIN") == 0)
+		col->agg = MATVIEW_AGG_MIN;
+	else if (strcmp(func, "MAX") == 0)
+		col->agg = MATVIEW_AGG_MAX;
+	else
+		goto unsupported;
+	if (matview_resolve_field(source, args->a[0].pExpr, name,
+				  &col->fieldno) != 0)
+		return -1;
+	struct field_def *field = &source->fields[col->fieldno];
+	if (col->agg == MATVIEW_AGG_COUNT) {
+		col->type = FIELD_TYPE_INTEGER;
+		return 0;
+	}
+	if (field->is_nullable) {
+		matview_error(name, tt_sprintf("%s() argument must be NOT NULL",
+					       func));
+		return -1;
+	}
+	if (col->agg != MATVIEW_AGG_SUM) {
+		col->type = field->type;
+		col->coll_id = field->coll_id;
+		return 0;
+	}
+	switch (field->type) {
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+		col->type = FIELD_TYPE_INTEGER;
+		return 0;
+	case FIELD_TYPE_DOUBLE:
+	case FIELD_TYPE_NUMBER:
+		col->type = field->type;
+		return 0;
+	default:
+		matview_error(name, "SUM() argument must be numeric");
+		return -1;
+	}
+unsupported:
+	matview_error(name, "supports only COUNT(*), COUNT, SUM, MIN and "
+		      "MAX of a column");
+	return -1;
+}
+
+struct matview_def *
+matview_def_new(struct Select *select, const char *name)
+{
+	if (select->pPrior != NULL || select->pWith != NULL ||
+	    select->pWhere != NULL || select->pHaving != NULL ||
+	    select->pOrderBy != NULL || select->pLimit != NULL ||
+	    (select->selFlags & SF_Distinct) != 0) {
+		matview_error(name, "can't have WHERE, HAVING, ORDER BY, "
+			      "LIMIT, DISTINCT, WITH or compound SELECT");
+		return NULL;
+	}
+	struct SrcList *src = select->pSrc;
+	if (src == NULL || src->nSrc != 1 || src->a[0].zName == NULL) {
+		matview_error(name, "must select from a single table");
+		return NULL;
+	}
+	struct space *source = space_by_name(src->a[0].zName);
+	if (source == NULL) {
+		diag_set(ClientError, ER_NO_SUCH_SPACE, src->a[0].zName);
+		return NULL;
+	}
+	if (!space_is_memtx(source) || space_is_temporary(source) ||
+	    source->def->opts.is_view) {
+		matview_error(name, "source must be a persistent memtx space");
+		return NULL;
+	}
+	struct ExprList *group_by = select->pGroupBy;
+	if (group_by == NULL) {
+		matview_error(name, "requires GROUP BY");
+		return NULL;
+	}
+	struct ExprList *list = select->pEList;
+	size_t size = sizeof(struct matview_def) +
+		      list->nExpr * sizeof(struct matview_column);
+	struct matview_def *def = (struct matview_def *)calloc(1, size);
+	if (def == NULL) {
+		diag_set(OutOfMemory, size, "calloc", "def");
+		return NULL;
+	}
+	def->source_id = source->def->id;
+	def->column_count = list->nExpr;
+	def->count_column = UINT32_MAX;
+	struct space_def *source_def = source->def;
+	for (int i = 0; i < list->nExpr; ++i) {
+		struct Expr *expr = list->a[i].pExpr;
+		struct matview_column *col = &def->columns[i];
+		col->coll_id = COLL_NONE;
+		if (expr->op == TK_FUNCTION) {
+			if (matview_column_by_func(col, source_def, expr,
+						   name) != 0)
+				goto error;
+			if (col->agg == MATVIEW_AGG_COUNT_ALL &&
+			    def->count_column == UINT32_MAX)
+				def->count_column = i;
+			continue;
+		}
+		if (matview_resolve_field(source_def, expr, name,
+					  &col->fieldno) != 0)
+			goto error;
+		struct field_def *field = &source_def->fields[col->fieldno];
+		if (field->is_nullable) {
+			matview_error(name, "GROUP BY columns must be NOT NULL");
+			goto error;
+		}
+		col->agg = MATVIEW_AGG_GROUP;
+		col->type = field->type;
+		col->coll_id = field->coll_id;
+		def->group_count++;
+	}
+	if (def->count_column == UINT32_MAX) {
+		matview_error(name, "requires COUNT(*)");
+		goto error;
+	}
+	/*
+	 * The GROUP BY columns make the primary key of the view,
+	 * so each of them must be selected exactly once.
+	 */
+	if ((int)def->group_count != group_by->nExpr) {
+		matview_error(name, "must select each GROUP BY column "
+			      "exactly once");
+		goto error;
+	}
+	for (int i = 0; i < group_by->nExpr; ++i) {
+		uint32_t fieldno;
+		if (matview_resolve_field(source_def, group_by->a[i].pExpr,
+					  name, &fieldno) != 0)
+			goto error;
+		uint32_t count = 0;
+		for (uint32_t j = 0; j < def->column_count; ++j) {
+			if (def->columns[j].agg == MATVIEW_AGG_GROUP &&
+			    def->columns[j].fieldno == fieldno)
+				count++;
+		}
+		if (count != 1) {
+			matview_error(name, "must select each GROUP BY column "
+				      "exactly once");
+			goto error;
+		}
+	}
+	return def;
+error:
+	free(def);
+	return NULL;
+}
+
+void
+matview_def_delete(struct matview_def *def)
+{
+	free(def);
+}
+
+/**
+ * Create a definition of a key made of a single field or of
+ * the GROUP BY fields of a source tuple.
+ */
+static struct key_def *
+matview_key_def_new(struct matview_def *def, int column)
+{
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size_t size;
+	struct key_part_def *parts =
+		region_alloc_array(region, typeof(parts[0]), def->group_count,
+				   &size);
+	if (parts == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "parts");
+		return NULL;
+	}
+	uint32_t part_count = 0;
+	for (uint32_t i = 0; i < def->column_count; ++i) {
+		struct matview_column *col = &def->columns[i];
+		if (column >= 0 ? (int)i != column :
+		    col->agg != MATVIEW_AGG_GROUP)
+			continue;
+		struct key_part_def *part = &parts[part_count++];
+		*part = key_part_def_default;
+		part->fieldno = col->fieldno;
+		part->type = col->type;
+		part->coll_id = col->coll_id;
+		part->is_nullable = false;
+		part->nullable_action = ON_CONFLICT_ACTION_ABORT;
+	}
+	struct key_def *key_def = key_def_new(parts, part_count, false);
+	region_truncate(region, region_svp);
+	return key_def;
+}
+
+/** Value of a view column computed for a group. */
+struct matview_value {
+	/** MsgPack of GROUP BY, MIN and MAX columns. */
+	const char *raw;
+	union {
+		/** COUNT and integer SUM. */
+		int64_t ival;
+		/** Floating point SUM. */
+		double dval;
+	};
+};
+
+/**
+ * Find the source index which can look up all tuples of a
+ * group: a tree index starting with the GROUP BY fields.
+ */
+static struct index *
+matview_group_index(struct matview *matview, struct space *source)
+{
+	struct key_def *group_def = matview->group_key_def;
+	for (uint32_t i = 0; i < source->index_count; ++i) {
+		struct index *index = source->index[i];
+		struct key_def *key_def = index->def->key_def;
+		if (index->def->type != TREE || key_def->has_json_paths ||
+		    key_def->for_func_index ||
+		    key_def->part_count < group_def->part_count)
+			continue;
+		uint32_t matched = 0;
+		for (uint32_t j = 0; j < group_def->part_count; ++j) {
+			struct key_part *part = &key_def->parts[j];
+			for (uint32_t k = 0; k < group_def->part_count; ++k) {
+				struct key_part *group_part =
+					&group_def->parts[k];
+				if (part->fieldno == group_part->fieldno &&
+				    part->coll_id == group_part->coll_id) {
+					matched++;
+					break;
+				}
+			}
+		}
+		if (matched == group_def->part_count)
+			return index;
+	}
+	return NULL;
+}
+
+/**
+ * Find the least (or the greatest, for MAX) argument of a MIN
+ * or MAX column among the source tuples of the same group as
+ * @a tuple. A full scan is used if no index fits the group.
+ */
+static int
+matview_find_extremum(struct matview *matview, struct space *source,
+		      struct tuple *tuple, uint32_t column, const char **raw)
+{
+	struct matview_column *col = &matview->def->columns[column];
+	struct key_def *cmp_def = matview->cmp_defs[column];
+	struct index *index = matview_group_index(matview, source);
+	enum iterator_type type = ITER_ALL;
+	const char *key = NULL;
+	uint32_t part_count = 0;
+	if (index != NULL) {
+		uint32_t key_size;
+		key = tuple_extract_key(tuple, index->def->key_def,
+					MULTIKEY_NONE, &key_size);
+		if (key == NULL)
+			return -1;
+		mp_decode_array(&key);
+		part_count = matview->def->group_count;
+		type = ITER_EQ;
+	} else {
+		index = space_index(source, 0);
+	}
+	struct iterator *it = index_create_iterator(index, type, key,
+						    part_count);
+	if (it == NULL)
+		return -1;
+	struct tuple *found = NULL;
+	struct tuple *next;
+	int rc;
+	while ((rc = iterator_next(it, &next)) == 0 && next != NULL) {
+		if (type == ITER_ALL &&
+		    tuple_compare(next, HINT_NONE, tuple, HINT_NONE,
+				  matview->group_key_def) != 0)
+			continue;
+		if (found != NULL) {
+			int cmp = tuple_compare(next, HINT_NONE, found,
+						HINT_NONE, cmp_def);
+			if (col->agg == MATVIEW_AGG_MAX)
+				cmp = -cmp;
+			if (cmp >= 0)
+				continue;
+		}
+		found = next;
+	}
+	iterator_delete(it);
+	if (rc != 0)
+		return -1;
+	*raw = found != NULL ? tuple_field(found, col->fieldno) : NULL;
+	return 0;
+}
+
+/**
+ * Compute a new value of a view column after a source tuple
+ * is added to (@a delta is 1) or removed from (@a delta is -1)
+ * the group.
+ * @param row The current row of the group or NULL.
+ */
+static int
+matview_column_update(struct matview *matview, struct space *source,
+		      struct tuple *tuple, struct tuple *row, int delta,
+		      uint32_t column, struct matview_value *value)
+{
+	struct matview_column *col = &matview->def->columns[column];
+	const char *field = NULL;
+	if (col->agg != MATVIEW_AGG_COUNT_ALL)
+		field = tuple_field(tuple, col->fieldno);
+	const char *cur = row != NULL ? tuple_field(row, column) : NULL;
+	switch (col->agg) {
+	case MATVIEW_AGG_GROUP:
+		value->raw = field;
+		return 0;
+	case MATVIEW_AGG_COUNT_ALL:
+	case MATVIEW_AGG_COUNT:
+		value->ival = 0;
+		if (cur != NULL && mp_read_int64(&cur, &value->ival) != 0)
+			goto mismatch;
+		if (col->agg == MATVIEW_AGG_COUNT_ALL ||
+		    (field != NULL && mp_typeof(*field) != MP_NIL))
+			value->ival += delta;
+		return 0;
+	case MATVIEW_AGG_SUM:
+		if (col->type == FIELD_TYPE_INTEGER) {
+			int64_t sum = 0, arg;
+			if (cur != NULL && mp_read_int64(&cur, &sum) != 0)
+				goto mismatch;
+			if (mp_read_int64(&field, &arg) != 0 ||
+			    (delta > 0 ?
+			     __builtin_add_overflow(sum, arg, &value->ival) :
+			     __builtin_sub_overflow(sum, arg, &value->ival))) {
+				diag_set(ClientError, ER_SQL_EXECUTE,
+					 "integer is overflowed");
+				return -1;
+			}
+		} else {
+			double sum = 0, arg;
+			if (cur != NULL && mp_read_double(&cur, &sum) != 0)
+				goto mismatch;
+			if (mp_read_double(&field, &arg) != 0)
+				goto mismatch;
+			value->dval = delta > 0 ? sum + arg : sum - arg;
+		}
+		return 0;
+	case MATVIEW_AGG_MIN:
+	case MATVIEW_AGG_MAX:
+		value->raw = field;
+		if (cur == NULL)
+			return 0;
+		int cmp = tuple_compare_with_key(tuple, HINT_NONE, cur, 1,
+						 HINT_NONE,
+						 matview->cmp_defs[column]);
+		if (col->agg == MATVIEW_AGG_MAX)
+			cmp = -cmp;
+		if (cmp > 0 || (cmp == 0 && delta > 0)) {
+			value->raw = cur;
+			return 0;
+		}
+		if (delta > 0)
+			return 0;
+		/* The extremum is deleted, look for a new one. */
+		return matview_find_extremum(matview, source, tuple, column,
+					     &value->raw);
+	default:
+		unreachable();
+	}
+mismatch:
+	diag_set(ClientError, ER_FIELD_TYPE, tt_sprintf("%u", column + 1),
+		 field_type_strs[col->type]);
+	return -1;
+}
+
+/** Write a row to the view or delete it by key. */
+static int
+matview_write(struct space *view, enum iproto_type type, const char *data,
+	      const char *data_end)
+{
+	struct request request;
+	memset(&request, 0, sizeof(request));
+	request.type = type;
+	request.space_id = view->def->id;
+	if (type == IPROTO_DELETE) {
+		request.key = data;
+		request.key_end = data_end;
+	} else {
+		request.tuple = data;
+		request.tuple_end = data_end;
+	}
+	/*
+	 * The view is maintained on behalf of the system: the
+	 * user changing the source may have no access to it.
+	 */
+	struct credentials *orig_credentials = effective_user();
+	fiber_set_user(fiber(), &admin_credentials);
+	int rc = box_process_rw(&request, view, NULL);
+	fiber_set_user(fiber(), orig_credentials);
+	return rc;
+}
+
+/**
+ * Account a source tuple added to (@a delta is 1) or removed
+ * from (@a delta is -1) the source space in the row of its
+ * group.
+ */
+static int
+matview_apply(struct matview *matview, struct tuple *tuple, int delta)
+{
+	struct matview_def *def = matview->def;
+	struct space *view = space_by_id(matview->space_id);
+	struct space *source = space_by_id(def->source_id);
+	assert(view != NULL && source != NULL);
+	struct index *pk = space_index(view, 0);
+	assert(pk != NULL);
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	int rc = -1;
+	uint32_t key_size;
+	const char *key = tuple_extract_key(tuple, matview->group_key_def,
+					    MULTIKEY_NONE, &key_size);
+	if (key == NULL)
+		goto out;
+	const char *key_end = key + key_size;
+	const char *key_parts = key;
+	uint32_t part_count = mp_decode_array(&key_parts);
+	struct tuple *row;
+	if (index_get(pk, key_parts, part_count, &row) != 0)
+		goto out;
+	if (row == NULL && delta < 0) {
+		/* The row was deleted by the user, nothing to do. */
+		rc = 0;
+		goto out;
+	}
+	if (row != NULL && delta < 0) {
+		const char *count = tuple_field(row, def->count_column);
+		int64_t value;
+		if (count != NULL && mp_read_int64(&count, &value) == 0 &&
+		    value <= 1) {
+			/* The last tuple of the group is gone. */
+			rc = matview_write(view, IPROTO_DELETE, key, key_end);
+			goto out;
+		}
+	}
+	size_t size;
+	struct matview_value *values =
+		region_alloc_array(region, typeof(values[0]),
+				   def->column_count, &size);
+	if (values == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "values");
+		goto out;
+	}
+	size = mp_sizeof_array(def->column_count);
+	for (uint32_t i = 0; i < def->column_count; ++i) {
+		if (matview_column_update(matview, source, tuple, row, delta,
+					  i, &values[i]) != 0)
+			goto out;
+		const char *raw = values[i].raw;
+		switch (def->columns[i].agg) {
+		case MATVIEW_AGG_GROUP:
+		case MATVIEW_AGG_MIN:
+		case MATVIEW_AGG_MAX:
+			if (raw == NULL) {
+				size += mp_sizeof_nil();
+			} else {
+				mp_next(&raw);
+				size += raw - values[i].raw;
+			}
+			break;
+		default:
+			size += 9;
+			break;
+		}
+	}
+	char *data = (char *)region_alloc(region, size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "data");
+		goto out;
+	}
+	char *data_end = mp_encode_array(data, def->column_count);
+	for (uint32_t i = 0; i < def->column_count; ++i) {
+		struct matview_column *col = &def->columns[i];
+		struct matview_value *value = &values[i];
+		const char *raw = value->raw;
+		switch (col->agg) {
+		case MATVIEW_AGG_GROUP:
+		case MATVIEW_AGG_MIN:
+		case MATVIEW_AGG_MAX:
+			if (raw == NULL) {
+				data_end = mp_encode_nil(data_end);
+				break;
+			}
+			mp_next(&raw);
+			memcpy(data_end, value->raw, raw - value->raw);
+			data_end += raw - value->raw;
+			break;
+		case MATVIEW_AGG_SUM:
+			if (col->type != FIELD_TYPE_INTEGER) {
+				data_end = mp_encode_double(data_end,
+							    value->dval);
+				break;
+			}
+			FALLTHROUGH;
+		default:
+			data_end = value->ival < 0 ?
+				   mp_encode_int(data_end, value->ival) :
+				   mp_encode_uint(data_end, value->ival);
+			break;
+		}
+	}
+	assert(data_end <= data + size);
+	rc = matview_write(view, IPROTO_REPLACE, data, data_end);
+out:
+	region_truncate(region, region_svp);
+	return rc;
+}
+
+/**
+ * Check if a statement is made by this instance. Statements
+ * of recovery and replication carry the changes of the views
+ * made on the origin, so the views must not be updated twice.
+ */
+static bool
+matview_stmt_is_local(struct txn_stmt *stmt)
+{
+	return box_is_configured() && stmt->row != NULL &&
+	       stmt->row->replica_id == 0;
+}
+
+/** on_replace trigger of the source space. */
+static int
+matview_on_replace(struct trigger *trigger, void *event)
+{
+	struct matview *matview = (struct matview *)trigger->data;
+	struct txn *txn = (struct txn *)event;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	assert(stmt != NULL);
+	if (!matview_stmt_is_local(stmt))
+		return 0;
+	/*
+	 * An update is a delete of the old tuple followed by an
+	 * insert of the new one: they may belong to different
+	 * groups.
+	 */
+	struct tuple *old_tuple = stmt->old_tuple;
+	struct tuple *new_tuple = stmt->new_tuple;
+	if (old_tuple != NULL && matview_apply(matview, old_tuple, -1) != 0)
+		return -1;
+	if (new_tuple != NULL && matview_apply(matview, new_tuple, 1) != 0)
+		return -1;
+	return 0;
+}
+
+int
+matview_populate(struct matview *matview, struct txn_stmt *stmt)
+{
+	if (!matview_stmt_is_local(stmt))
+		return 0;
+	struct space *source = space_by_id(matview->def->source_id);
+	assert(source != NULL);
+	struct index *pk = space_index(source, 0);
+	if (pk == NULL)
+		return 0;
+	struct iterator *it = index_create_iterator(pk, ITER_ALL, NULL, 0);
+	if (it == NULL)
+		return -1;
+	struct tuple *tuple;
+	int rc;
+	while ((rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
+		rc = matview_apply(matview, tuple, 1);
+		if (rc != 0)
+			break;
+	}
+	iterator_delete(it);
+	return rc;
+}
+
+struct matview *
+matview_new(struct space_def *space_def, struct key_def *pk_def)
+{
+	if (strcmp(space_def->engine_name, "memtx") != 0) {
+		matview_error(space_def->name, "must be a memtx space");
+		return NULL;
+	}
+	struct Select *select = sql_view_compile(sql_get(),
+						 space_def->opts.sql);
+	if (select == NULL)
+		return NULL;
+	struct matview_def *def = matview_def_new(select, space_def->name);
+	sql_select_delete(sql_get(), select);
+	if (def == NULL)
+		return NULL;
+	bool is_valid = space_def->field_count == def->column_count &&
+			pk_def->part_count == def->group_count;
+	for (uint32_t i = 0, j = 0; is_valid && i < def->column_count; ++i) {
+		if (def->columns[i].agg == MATVIEW_AGG_GROUP &&
+		    pk_def->parts[j++].fieldno != i)
+			is_valid = false;
+	}
+	if (!is_valid) {
+		matview_error(space_def->name, "format and primary key must "
+			      "match the SELECT");
+		matview_def_delete(def);
+		return NULL;
+	}
+	struct matview *matview = (struct matview *)calloc(1, sizeof(*matview));
+	struct key_def **cmp_defs = (struct key_def **)
+		calloc(def->column_count, sizeof(cmp_defs[0]));
+	if (matview == NULL || cmp_defs == NULL) {
+		diag_set(OutOfMemory, sizeof(*matview), "calloc", "matview");
+		free(cmp_defs);
+		free(matview);
+		matview_def_delete(def);
+		return NULL;
+	}
+	matview->space_id = space_def->id;
+	matview->def = def;
+	matview->cmp_defs = cmp_defs;
+	trigger_create(&matview->on_replace, matview_on_replace, matview,
+		       NULL);
+	rlist_create(&matview->link);
+	matview->group_key_def = matview_key_def_new(def, -1);
+	if (matview->group_key_def == NULL)
+		goto error;
+	for (uint32_t i = 0; i < def->column_count; ++i) {
+		enum matview_agg agg = def->columns[i].agg;
+		if (agg != MATVIEW_AGG_MIN && agg != MATVIEW_AGG_MAX)
+			continue;
+		cmp_defs[i] = matview_key_def_new(def, i);
+		if (cmp_defs[i] == NULL)
+			goto error;
+	}
+	return matview;
+error:
+	matview_delete(matview);
+	return NULL;
+}
+
+void
+matview_delete(struct matview *matview)
+{
+	assert(rlist_empty(&matview->link));
+	for (uint32_t i = 0; i < matview->def->column_count; ++i) {
+		if (matview->cmp_defs[i] != NULL)
+			key_def_delete(matview->cmp_defs[i]);
+	}
+	if (matview->group_key_def != NULL)
+		key_def_delete(matview->group_key_def);
+	free(matview->cmp_defs);
+	matview_def_delete(matview->def);
+	TRASH(matview);
+	free(matview);
+}
+
+void
+matview_attach(struct matview *matview)
+{
+	struct space *source = space_by_id(matview->def->source_id);
+	assert(source != NULL);
+	trigger_add(&source->on_replace, &matview->on_replace);
+	rlist_add_entry(&matviews, matview, link);
+}
+
+void
+matview_detach(struct matview *matview)
+{
+	trigger_clear(&matview->on_replace);
+	rlist_del_entry(matview, link);
+}
+
+struct matview *
+matview_by_id(uint32_t space_id)
+{
+	struct matview *matview;
+	rlist_foreach_entry(matview, &matviews, link) {
+		if (matview->space_id == space_id)
+			return matview;
+	}
+	return NULL;
+}
+
+bool
+space_is_matview_source(uint32_t space_id)
+{
+	struct matview *matview;
+	rlist_foreach_entry(matview, &matviews, link) {
+		if (matview->def->source_id == space_id)
+			return true;
+	}
+	return false;
+}
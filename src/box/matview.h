@@ -0,0 +1,174 @@
+#ifndef TARANTOOL_BOX_MATVIEW_H_INCLUDED
+#define TARANTOOL_BOX_MATVIEW_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "trigger.h"
+#include "field_def.h"
+#include "small/rlist.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct key_def;
+struct space_def;
+struct txn_stmt;
+struct Select;
+
+/**
+ * A materialized view is a memtx space which stores the result
+ * of an aggregate query over another (source) space:
+ *
+ *   SELECT a, b, COUNT(*), SUM(x), MIN(y) FROM t GROUP BY a, b
+ *
+ * There is one row per group, the GROUP BY columns make its
+ * primary key. The rows are updated incrementally by an
+ * on_replace trigger of the source space, in the transaction
+ * which changes the source, so reading a group costs a single
+ * primary key lookup instead of a scan.
+ *
+ * COUNT(*) is mandatory: it tells when the last row of a group
+ * is gone. SUM, MIN and MAX take NOT NULL columns only. MIN
+ * and MAX are recomputed from the group rows of the source
+ * when the current extremum is deleted.
+ */
+enum matview_agg {
+	/** A GROUP BY column. */
+	MATVIEW_AGG_GROUP,
+	/** COUNT(*). */
+	MATVIEW_AGG_COUNT_ALL,
+	/** COUNT(x), the number of not NULL values. */
+	MATVIEW_AGG_COUNT,
+	MATVIEW_AGG_SUM,
+	MATVIEW_AGG_MIN,
+	MATVIEW_AGG_MAX,
+};
+
+/** A column of a materialized view. */
+struct matview_column {
+	enum matview_agg agg;
+	/** Source field, unused for COUNT(*). */
+	uint32_t fieldno;
+	/** Type of the column in the view. */
+	enum field_type type;
+	/** Collation of GROUP BY, MIN and MAX columns. */
+	uint32_t coll_id;
+};
+
+/** Definition of a materialized view built from its SELECT. */
+struct matview_def {
+	/** Id of the source space. */
+	uint32_t source_id;
+	/** Number of GROUP BY columns. */
+	uint32_t group_count;
+	/** Position of the COUNT(*) column. */
+	uint32_t count_column;
+	uint32_t column_count;
+	struct matview_column columns[0];
+};
+
+/**
+ * Check that a SELECT can be maintained incrementally and
+ * build the view definition from it. The SELECT must not be
+ * resolved yet.
+ * @param select SELECT of the view.
+ * @param name Name of the view, for error messages.
+ * @retval NULL on error, the diag is set.
+ */
+struct matview_def *
+matview_def_new(struct Select *select, const char *name);
+
+void
+matview_def_delete(struct matview_def *def);
+
+/** A materialized view maintained on changes of its source. */
+struct matview {
+	/** Id of the view space. */
+	uint32_t space_id;
+	struct matview_def *def;
+	/** GROUP BY fields of a source tuple, in primary key order. */
+	struct key_def *group_key_def;
+	/**
+	 * Definitions comparing source tuples by the argument
+	 * of MIN and MAX columns, NULL for other columns.
+	 */
+	struct key_def **cmp_defs;
+	/** Trigger in the on_replace list of the source space. */
+	struct trigger on_replace;
+	/** Link in the list of maintained views. */
+	struct rlist link;
+};
+
+/**
+ * Create a materialized view object for a view space with
+ * the given primary key, which must consist of the GROUP BY
+ * columns.
+ * @retval NULL on error, the diag is set.
+ */
+struct matview *
+matview_new(struct space_def *space_def, struct key_def *pk_def);
+
+void
+matview_delete(struct matview *matview);
+
+/** Start maintaining the view on changes of the source space. */
+void
+matview_attach(struct matview *matview);
+
+/** Stop maintaining the view. */
+void
+matview_detach(struct matview *matview);
+
+/** Find a maintained view by the view space id. */
+struct matview *
+matview_by_id(uint32_t space_id);
+
+/** Check if a space is the source of a maintained view. */
+bool
+space_is_matview_source(uint32_t space_id);
+
+/**
+ * Fill a just created view with the aggregates of the tuples
+ * already stored in the source space. Nothing is done if
+ * @a stmt comes from recovery or replication, since the rows
+ * of the view are recovered or replicated along with it.
+ */
+int
+matview_populate(struct matview *matview, struct txn_stmt *stmt);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MATVIEW_H_INCLUDED */
@@ -0,0 +1,802 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_art.h"
+#include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "space.h"
+#include "schema.h" /* space_cache_find() */
+#include "fiber.h"
+#include "index.h"
+#include "tuple.h"
+#include "salad/art.h"
+
+#include <small/mempool.h>
+#include <small/small.h>
+
+struct memtx_art_index {
+	struct index base;
+	struct art tree;
+	struct memtx_gc_task gc_task;
+	/** Next leaf to unreference by the gc task. */
+	struct art_leaf *gc_leaf;
+};
+
+/* {{{ Key encoding ***********************************************/
+
+/*
+ * Keys are stored in the tree in a binary comparable form, so
+ * that memcmp() of two encoded keys gives the same result as
+ * tuple_compare() of the original ones. Each key part is encoded
+ * depending on its MsgPack type, which keeps the encoding intact
+ * when a field type is changed from 'unsigned' to 'integer':
+ * - an integer is encoded as a byte which is 0 for negative
+ *   numbers and 1 for others followed by 8 bytes of the value in
+ *   big endian;
+ * - a boolean is encoded as a single byte;
+ * - a string is encoded with zero bytes escaped as 0x00 0xFF and
+ *   terminated with 0x00 0x00.
+ * The encoding is prefix-free, an encoded partial key is a prefix
+ * of the encoded key of every tuple matching it.
+ */
+
+/** Return the maximal size of an encoded key part. */
+static inline uint32_t
+memtx_art_part_size_max(const char *field)
+{
+	switch (mp_typeof(*field)) {
+	case MP_UINT:
+	case MP_INT:
+		return 9;
+	case MP_BOOL:
+		return 1;
+	case MP_STR:
+		return 2 * mp_decode_strl(&field) + 2;
+	default:
+		unreachable();
+		return 0;
+	}
+}
+
+/** Encode a key part, return the end of the written data. */
+static inline unsigned char *
+memtx_art_encode_part(const char *field, unsigned char *out)
+{
+	switch (mp_typeof(*field)) {
+	case MP_UINT:
+		*out++ = 1;
+		return (unsigned char *)mp_store_u64((char *)out,
+						    mp_decode_uint(&field));
+	case MP_INT: {
+		int64_t value = mp_decode_int(&field);
+		*out++ = value < 0 ? 0 : 1;
+		return (unsigned char *)mp_store_u64((char *)out,
+						    (uint64_t)value);
+	}
+	case MP_BOOL:
+		*out++ = mp_decode_bool(&field) ? 1 : 0;
+		return out;
+	case MP_STR: {
+		uint32_t len;
+		const char *str = mp_decode_str(&field, &len);
+		for (uint32_t i = 0; i < len; i++) {
+			*out++ = str[i];
+			if (str[i] == '\0')
+				*out++ = 0xff;
+		}
+		*out++ = 0;
+		*out++ = 0;
+		return out;
+	}
+	default:
+		unreachable();
+		return out;
+	}
+}
+
+/**
+ * Encode a search key on the fiber region.
+ * @retval NULL memory error.
+ */
+static unsigned char *
+memtx_art_encode_key(const char *key, uint32_t part_count, uint32_t *len)
+{
+	uint32_t size = 0;
+	const char *field = key;
+	for (uint32_t i = 0; i < part_count; i++) {
+		size += memtx_art_part_size_max(field);
+		mp_next(&field);
+	}
+	unsigned char *buf = region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "key");
+		return NULL;
+	}
+	unsigned char *end = buf;
+	field = key;
+	for (uint32_t i = 0; i < part_count; i++) {
+		end = memtx_art_encode_part(field, end);
+		mp_next(&field);
+	}
+	*len = end - buf;
+	return buf;
+}
+
+/**
+ * Encode the key of a tuple on the fiber region.
+ * @retval NULL memory error.
+ */
+static unsigned char *
+memtx_art_encode_tuple(struct tuple *tuple, struct key_def *cmp_def,
+		       uint32_t *len)
+{
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < cmp_def->part_count; i++) {
+		const char *field = tuple_field_by_part(tuple,
+				&cmp_def->parts[i], MULTIKEY_NONE);
+		assert(field != NULL);
+		size += memtx_art_part_size_max(field);
+	}
+	unsigned char *buf = region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "key");
+		return NULL;
+	}
+	unsigned char *end = buf;
+	for (uint32_t i = 0; i < cmp_def->part_count; i++) {
+		const char *field = tuple_field_by_part(tuple,
+				&cmp_def->parts[i], MULTIKEY_NONE);
+		end = memtx_art_encode_part(field, end);
+	}
+	*len = end - buf;
+	return buf;
+}
+
+/* }}} */
+
+/* {{{ MemtxArt Iterators *****************************************/
+
+struct art_iterator {
+	struct iterator base;
+	enum iterator_type type;
+	/** Search key, owned by the caller. */
+	const char *key;
+	uint32_t part_count;
+	/** Leaf of the last returned tuple. */
+	struct art_leaf *leaf;
+	/** Tree version the leaf pointer is valid for. */
+	uint32_t version;
+	/** The last returned tuple, referenced by the iterator. */
+	struct tuple *current;
+	/** Memory pool the iterator was allocated from. */
+	struct mempool *pool;
+};
+
+static_assert(sizeof(struct art_iterator) <= MEMTX_ITERATOR_SIZE,
+	      "sizeof(struct art_iterator) must be less than or equal "
+	      "to MEMTX_ITERATOR_SIZE");
+
+static inline struct key_def *
+memtx_art_cmp_def(struct memtx_art_index *index)
+{
+	struct index_def *def = index->base.def;
+	return def->opts.is_unique ? def->key_def : def->cmp_def;
+}
+
+static void
+art_iterator_free(struct iterator *iterator);
+
+static inline struct art_iterator *
+art_iterator(struct iterator *it)
+{
+	assert(it->free == art_iterator_free);
+	return (struct art_iterator *) it;
+}
+
+static void
+art_iterator_free(struct iterator *iterator)
+{
+	struct art_iterator *it = art_iterator(iterator);
+	if (it->current != NULL)
+		tuple_unref(it->current);
+	mempool_free(it->pool, it);
+}
+
+static int
+art_iterator_dummie(struct iterator *iterator, struct tuple **ret)
+{
+	(void)iterator;
+	*ret = NULL;
+	return 0;
+}
+
+/**
+ * Find the leaf next to or previous to the leaf of the last
+ * returned tuple. If the tree has been modified since, the leaf
+ * pointer may be dangling, so look the tuple key up again.
+ */
+static int
+art_iterator_step(struct art_iterator *it, bool reverse,
+		  struct art_leaf **result)
+{
+	struct memtx_art_index *index =
+		(struct memtx_art_index *)it->base.index;
+	struct art *tree = &index->tree;
+	assert(it->current != NULL);
+	if (it->version == tree->version) {
+		*result = reverse ? it->leaf->prev : it->leaf->next;
+		return 0;
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t len;
+	unsigned char *key = memtx_art_encode_tuple(it->current,
+						    memtx_art_cmp_def(index),
+						    &len);
+	if (key == NULL)
+		return -1;
+	if (reverse) {
+		struct art_leaf *leaf = art_lower_bound(tree, key, len);
+		*result = leaf != NULL ? leaf->prev : tree->last;
+	} else {
+		*result = art_upper_bound(tree, key, len);
+	}
+	region_truncate(region, region_svp);
+	return 0;
+}
+
+static void
+art_iterator_set_current(struct art_iterator *it, struct art_leaf *leaf)
+{
+	struct memtx_art_index *index =
+		(struct memtx_art_index *)it->base.index;
+	it->leaf = leaf;
+	it->version = index->tree.version;
+	it->current = leaf->value;
+	tuple_ref(it->current);
+}
+
+static int
+art_iterator_advance(struct iterator *iterator, bool reverse, bool equal,
+		     struct tuple **ret)
+{
+	struct art_iterator *it = art_iterator(iterator);
+	struct art_leaf *leaf;
+	if (art_iterator_step(it, reverse, &leaf) != 0)
+		return -1;
+	tuple_unref(it->current);
+	it->current = NULL;
+	/* Use user key def to save a few loops. */
+	if (leaf != NULL && equal &&
+	    tuple_compare_with_key(leaf->value, HINT_NONE, it->key,
+				   it->part_count, HINT_NONE,
+				   iterator->index->def->key_def) != 0)
+		leaf = NULL;
+	if (leaf == NULL) {
+		iterator->next = art_iterator_dummie;
+		*ret = NULL;
+		return 0;
+	}
+	art_iterator_set_current(it, leaf);
+	*ret = it->current;
+	return 0;
+}
+
+static int
+art_iterator_next(struct iterator *iterator, struct tuple **ret)
+{
+	return art_iterator_advance(iterator, false, false, ret);
+}
+
+static int
+art_iterator_prev(struct iterator *iterator, struct tuple **ret)
+{
+	return art_iterator_advance(iterator, true, false, ret);
+}
+
+static int
+art_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
+{
+	return art_iterator_advance(iterator, false, true, ret);
+}
+
+static int
+art_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
+{
+	return art_iterator_advance(iterator, true, true, ret);
+}
+
+static void
+art_iterator_set_next_method(struct art_iterator *it)
+{
+	assert(it->current != NULL);
+	switch (it->type) {
+	case ITER_EQ:
+		it->base.next = art_iterator_next_equal;
+		break;
+	case ITER_REQ:
+		it->base.next = art_iterator_prev_equal;
+		break;
+	case ITER_LT:
+	case ITER_LE:
+		it->base.next = art_iterator_prev;
+		break;
+	case ITER_ALL:
+	case ITER_GE:
+	case ITER_GT:
+		it->base.next = art_iterator_next;
+		break;
+	default:
+		/* The type was checked in create_iterator. */
+		assert(false);
+	}
+}
+
+static int
+art_iterator_start(struct iterator *iterator, struct tuple **ret)
+{
+	*ret = NULL;
+	struct memtx_art_index *index =
+		(struct memtx_art_index *)iterator->index;
+	struct art_iterator *it = art_iterator(iterator);
+	it->base.next = art_iterator_dummie;
+	struct art *tree = &index->tree;
+	enum iterator_type type = it->type;
+	assert(it->current == NULL);
+	struct art_leaf *leaf;
+	if (it->part_count == 0) {
+		leaf = iterator_type_is_reverse(type) ? tree->last :
+							tree->first;
+	} else {
+		struct region *region = &fiber()->gc;
+		size_t region_svp = region_used(region);
+		uint32_t len;
+		unsigned char *key = memtx_art_encode_key(it->key,
+							  it->part_count,
+							  &len);
+		if (key == NULL)
+			return -1;
+		/*
+		 * Keys of all tuples matching a partial key start
+		 * with its encoding, so the upper bound skips them.
+		 */
+		if (type == ITER_ALL || type == ITER_EQ ||
+		    type == ITER_GE || type == ITER_LT)
+			leaf = art_lower_bound(tree, key, len);
+		else /* ITER_GT, ITER_REQ, ITER_LE */
+			leaf = art_upper_bound(tree, key, len);
+		if (iterator_type_is_reverse(type))
+			leaf = leaf != NULL ? leaf->prev : tree->last;
+		if ((type == ITER_EQ || type == ITER_REQ) && leaf != NULL &&
+		    !art_leaf_has_prefix(leaf, key, len))
+			leaf = NULL;
+		region_truncate(region, region_svp);
+	}
+	if (leaf == NULL)
+		return 0;
+	art_iterator_set_current(it, leaf);
+	*ret = it->current;
+	art_iterator_set_next_method(it);
+	return 0;
+}
+
+/* }}} */
+
+/* {{{ MemtxArt ***************************************************/
+
+static void *
+memtx_art_alloc(void *ctx, size_t size)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)ctx;
+	return smalloc(&memtx->alloc, size);
+}
+
+static void
+memtx_art_free(void *ctx, void *ptr, size_t size)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)ctx;
+	smfree(&memtx->alloc, ptr, size);
+}
+
+static void
+memtx_art_index_free(struct memtx_art_index *index)
+{
+	art_destroy(&index->tree);
+	free(index);
+}
+
+static void
+memtx_art_index_gc_run(struct memtx_gc_task *task, bool *done)
+{
+	/*
+	 * Yield every 1K tuples to keep latency < 0.1 ms.
+	 * Yield more often in debug mode.
+	 */
+#ifdef NDEBUG
+	enum { YIELD_LOOPS = 1000 };
+#else
+	enum { YIELD_LOOPS = 10 };
+#endif
+
+	struct memtx_art_index *index = container_of(task,
+			struct memtx_art_index, gc_task);
+	unsigned int loops = 0;
+	while (index->gc_leaf != NULL) {
+		struct tuple *tuple = index->gc_leaf->value;
+		index->gc_leaf = index->gc_leaf->next;
+		tuple_unref(tuple);
+		if (++loops >= YIELD_LOOPS) {
+			*done = false;
+			return;
+		}
+	}
+	*done = true;
+}
+
+static void
+memtx_art_index_gc_free(struct memtx_gc_task *task)
+{
+	struct memtx_art_index *index = container_of(task,
+			struct memtx_art_index, gc_task);
+	memtx_art_index_free(index);
+}
+
+static const struct memtx_gc_task_vtab memtx_art_index_gc_vtab = {
+	.run = memtx_art_index_gc_run,
+	.free = memtx_art_index_gc_free,
+};
+
+static void
+memtx_art_index_destroy(struct index *base)
+{
+	struct memtx_art_index *index = (struct memtx_art_index *)base;
+	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+	if (base->def->iid == 0) {
+		/*
+		 * Primary index. We need to free all tuples stored
+		 * in the index, which may take a while. Schedule a
+		 * background task in order not to block tx thread.
+		 */
+		index->gc_task.vtab = &memtx_art_index_gc_vtab;
+		index->gc_leaf = index->tree.first;
+		memtx_engine_schedule_gc(memtx, &index->gc_task);
+	} else {
+		/*
+		 * Secondary index. Destruction is fast, no need to
+		 * hand over to background fiber.
+		 */
+		memtx_art_index_free(index);
+	}
+}
+
+static bool
+memtx_art_index_depends_on_pk(struct index *base)
+{
+	/* Non-unique keys are extended with primary key parts. */
+	return !base->def->opts.is_unique;
+}
+
+static ssize_t
+memtx_art_index_size(struct index *base)
+{
+	struct memtx_art_index *index = (struct memtx_art_index *)base;
+	return index->tree.count;
+}
+
+static ssize_t
+memtx_art_index_bsize(struct index *base)
+{
+	struct memtx_art_index *index = (struct memtx_art_index *)base;
+	return index->tree.mem_used;
+}
+
+static int
+memtx_art_index_random(struct index *base, uint32_t rnd, struct tuple **result)
+{
+	struct memtx_art_index *index = (struct memtx_art_index *)base;
+	struct art_leaf *leaf = art_random(&index->tree, rnd);
+	*result = leaf != NULL ? leaf->value : NULL;
+	return 0;
+}
+
+static ssize_t
+memtx_art_index_count(struct index *base, enum iterator_type type,
+		      const char *key, uint32_t part_count)
+{
+	if (type == ITER_ALL)
+		return memtx_art_index_size(base); /* optimization */
+	return generic_index_count(base, type, key, part_count);
+}
+
+static int
+memtx_art_index_get(struct index *base, const char *key,
+		    uint32_t part_count, struct tuple **result)
+{
+	assert(base->def->opts.is_unique &&
+	       part_count == base->def->key_def->part_count);
+	struct memtx_art_index *index = (struct memtx_art_index *)base;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t len;
+	unsigned char *art_key = memtx_art_encode_key(key, part_count, &len);
+	if (art_key == NULL)
+		return -1;
+	struct art_leaf *leaf = art_find(&index->tree, art_key, len);
+	region_truncate(region, region_svp);
+	*result = leaf != NULL ? leaf->value : NULL;
+	return memtx_tx_tuple_clarify(base, result);
+}
+
+static int
+memtx_art_index_replace(struct index *base, struct tuple *old_tuple,
+			struct tuple *new_tuple, enum dup_replace_mode mode,
+			struct tuple **result)
+{
+	struct memtx_art_index *index = (struct memtx_art_index *)base;
+	struct art *tree = &index->tree;
+	struct key_def *cmp_def = memtx_art_cmp_def(index);
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	unsigned char *key;
+	uint32_t len;
+	if (new_tuple != NULL) {
+		key = memtx_art_encode_tuple(new_tuple, cmp_def, &len);
+		if (key == NULL)
+			return -1;
+		void *dup_tuple = NULL;
+		/* Try to optimistically replace the new_tuple. */
+		if (art_insert(tree, key, len, new_tuple, &dup_tuple) != 0) {
+			region_truncate(region, region_svp);
+			diag_set(OutOfMemory, sizeof(struct art_leaf) + len,
+				 "memtx_art_index", "replace");
+			return -1;
+		}
+		uint32_t errcode = replace_check_dup(old_tuple, dup_tuple,
+						     mode);
+		if (errcode) {
+			/* Restoring a replaced value doesn't allocate. */
+			if (dup_tuple != NULL)
+				art_insert(tree, key, len, dup_tuple, NULL);
+			else
+				art_delete(tree, key, len);
+			region_truncate(region, region_svp);
+			struct space *sp = space_cache_find(base->def->space_id);
+			if (sp != NULL)
+				diag_set(ClientError, errcode, base->def->name,
+					 space_name(sp));
+			return -1;
+		}
+		region_truncate(region, region_svp);
+		if (dup_tuple != NULL) {
+			*result = dup_tuple;
+			return 0;
+		}
+	}
+	if (old_tuple != NULL) {
+		key = memtx_art_encode_tuple(old_tuple, cmp_def, &len);
+		if (key == NULL)
+			return -1;
+		art_delete(tree, key, len);
+		region_truncate(region, region_svp);
+	}
+	*result = old_tuple;
+	return 0;
+}
+
+static struct iterator *
+memtx_art_index_create_iterator(struct index *base, enum iterator_type type,
+				const char *key, uint32_t part_count)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+
+	assert(part_count == 0 || key != NULL);
+	if (type > ITER_GT) {
+		diag_set(UnsupportedIndexFeature, base->def,
+			 "requested iterator type");
+		return NULL;
+	}
+
+	if (part_count == 0) {
+		/*
+		 * If no key is specified, downgrade equality
+		 * iterators to a full range.
+		 */
+		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
+		key = NULL;
+	}
+
+	struct art_iterator *it = mempool_alloc(&memtx->iterator_pool);
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(struct art_iterator),
+			 "memtx_art_index", "iterator");
+		return NULL;
+	}
+	iterator_create(&it->base, base);
+	it->pool = &memtx->iterator_pool;
+	it->base.next = art_iterator_start;
+	it->base.free = art_iterator_free;
+	it->type = type;
+	it->key = key;
+	it->part_count = part_count;
+	it->leaf = NULL;
+	it->version = 0;
+	it->current = NULL;
+	return (struct iterator *)it;
+}
+
+struct art_snapshot_iterator {
+	struct snapshot_iterator base;
+	struct memtx_art_index *index;
+	/** Tuples of the index at the time of the iterator creation. */
+	struct tuple **tuples;
+	size_t count;
+	size_t pos;
+	struct memtx_tx_snapshot_cleaner cleaner;
+	/** Format returned by memtx_enter_delayed_free_mode(). */
+	struct tuple_format *format;
+};
+
+static void
+art_snapshot_iterator_free(struct snapshot_iterator *iterator)
+{
+	assert(iterator->free == art_snapshot_iterator_free);
+	struct art_snapshot_iterator *it =
+		(struct art_snapshot_iterator *)iterator;
+	memtx_leave_delayed_free_mode((struct memtx_engine *)
+				      it->index->base.engine, it->format);
+	index_unref(&it->index->base);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
+	free(it->tuples);
+	free(iterator);
+}
+
+static int
+art_snapshot_iterator_next(struct snapshot_iterator *iterator,
+			   const char **data, uint32_t *size)
+{
+	assert(iterator->free == art_snapshot_iterator_free);
+	struct art_snapshot_iterator *it =
+		(struct art_snapshot_iterator *)iterator;
+	while (it->pos < it->count) {
+		struct tuple *tuple =
+			memtx_tx_snapshot_clarify(&it->cleaner,
+						  it->tuples[it->pos++]);
+		if (tuple != NULL) {
+			*data = tuple_data_range(tuple, size);
+			return 0;
+		}
+	}
+	*data = NULL;
+	return 0;
+}
+
+/**
+ * Create an ALL iterator with personal read view so further
+ * index modifications will not affect the iteration results.
+ * Must be destroyed by iterator->free after usage.
+ *
+ * The tree has no copy-on-write read views, so the iterator
+ * copies tuple pointers in key order. The tuples themselves are
+ * kept alive by the delayed free mode.
+ */
+static struct snapshot_iterator *
+memtx_art_index_create_snapshot_iterator(struct index *base)
+{
+	struct memtx_art_index *index = (struct memtx_art_index *)base;
+	struct art_snapshot_iterator *it = (struct art_snapshot_iterator *)
+		calloc(1, sizeof(*it));
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(struct art_snapshot_iterator),
+			 "memtx_art_index", "create_snapshot_iterator");
+		return NULL;
+	}
+	size_t size = MAX(index->tree.count, 1) * sizeof(struct tuple *);
+	it->tuples = (struct tuple **)malloc(size);
+	if (it->tuples == NULL) {
+		diag_set(OutOfMemory, size, "memtx_art_index",
+			 "create_snapshot_iterator");
+		free(it);
+		return NULL;
+	}
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, base) != 0) {
+		free(it->tuples);
+		free(it);
+		return NULL;
+	}
+	for (struct art_leaf *leaf = index->tree.first; leaf != NULL;
+	     leaf = leaf->next)
+		it->tuples[it->count++] = leaf->value;
+	assert(it->count == index->tree.count);
+
+	it->base.free = art_snapshot_iterator_free;
+	it->base.next = art_snapshot_iterator_next;
+	it->index = index;
+	index_ref(base);
+	it->format = memtx_enter_delayed_free_mode(
+		(struct memtx_engine *)base->engine, base);
+	return (struct snapshot_iterator *) it;
+}
+
+static const struct index_vtab memtx_art_index_vtab = {
+	/* .destroy = */ memtx_art_index_destroy,
+	/* .commit_create = */ generic_index_commit_create,
+	/* .abort_create = */ generic_index_abort_create,
+	/* .commit_modify = */ generic_index_commit_modify,
+	/* .commit_drop = */ generic_index_commit_drop,
+	/* .update_def = */ generic_index_update_def,
+	/* .depends_on_pk = */ memtx_art_index_depends_on_pk,
+	/* .def_change_requires_rebuild = */
+		memtx_index_def_change_requires_rebuild,
+	/* .size = */ memtx_art_index_size,
+	/* .bsize = */ memtx_art_index_bsize,
+	/* .min = */ generic_index_min,
+	/* .max = */ generic_index_max,
+	/* .random = */ memtx_art_index_random,
+	/* .count = */ memtx_art_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
+	/* .get = */ memtx_art_index_get,
+	/* .get_batch = */ generic_index_get_batch,
+	/* .replace = */ memtx_art_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
+	/* .create_iterator = */ memtx_art_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
+	/* .create_snapshot_iterator = */
+		memtx_art_index_create_snapshot_iterator,
+	/* .stat = */ generic_index_stat,
+	/* .compact = */ generic_index_compact,
+	/* .reset_stat = */ generic_index_reset_stat,
+	/* .begin_build = */ generic_index_begin_build,
+	/* .reserve = */ generic_index_reserve,
+	/* .build_next = */ generic_index_build_next,
+	/* .end_build = */ generic_index_end_build,
+};
+
+struct index *
+memtx_art_index_new(struct memtx_engine *memtx, struct index_def *def)
+{
+	struct memtx_art_index *index =
+		(struct memtx_art_index *)calloc(1, sizeof(*index));
+	if (index == NULL) {
+		diag_set(OutOfMemory, sizeof(*index),
+			 "malloc", "struct memtx_art_index");
+		return NULL;
+	}
+	if (index_create(&index->base, (struct engine *)memtx,
+			 &memtx_art_index_vtab, def) != 0) {
+		free(index);
+		return NULL;
+	}
+	art_create(&index->tree, memtx_art_alloc, memtx_art_free, memtx);
+	return &index->base;
+}
+
+/* }}} */
@@ -323,6 +323,41 @@ memtx_bitset_index_replace(struct index *base, struct tuple *old_tuple,
 	return 0;
 }
 
+/**
+ * The key is the same, so the bitset value identifying the old
+ * tuple is reassigned to the new one, and the bitset itself is
+ * not touched.
+ */
+static int
+memtx_bitset_index_replace_unchanged(struct index *base,
+				     struct tuple *old_tuple,
+				     struct tuple *new_tuple)
+{
+#ifndef OLD_GOOD_BITSET
+	struct memtx_bitset_index *index = (struct memtx_bitset_index *)base;
+	uint32_t k = mh_bitset_index_find(index->tuple_to_id, old_tuple, 0);
+	if (k == mh_end(index->tuple_to_id))
+		return generic_index_replace_unchanged(base, old_tuple,
+						       new_tuple);
+	struct bitset_hash_entry entry;
+	entry.id = mh_bitset_index_node(index->tuple_to_id, k)->id;
+	entry.tuple = new_tuple;
+	uint32_t pos = mh_bitset_index_put(index->tuple_to_id, &entry, 0, 0);
+	if (pos == mh_end(index->tuple_to_id)) {
+		diag_set(OutOfMemory, (ssize_t) pos, "hash", "key");
+		return -1;
+	}
+	/* The hash could be resized, look the old tuple up again. */
+	k = mh_bitset_index_find(index->tuple_to_id, old_tuple, 0);
+	mh_bitset_index_del(index->tuple_to_id, k, 0);
+	void *mem = matras_get(index->id_to_tuple, entry.id);
+	*(struct tuple **)mem = new_tuple;
+	return 0;
+#else /* #ifndef OLD_GOOD_BITSET */
+	return generic_index_replace_unchanged(base, old_tuple, new_tuple);
+#endif /* #ifndef OLD_GOOD_BITSET */
+}
+
 static struct iterator *
 memtx_bitset_index_create_iterator(struct index *base, enum iterator_type type,
 				   const char *key, uint32_t part_count)
@@ -486,9 +521,15 @@ static const struct index_vtab memtx_bitset_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ memtx_bitset_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ generic_index_get,
+	/* .get_batch = */ generic_index_get_batch,
 	/* .replace = */ memtx_bitset_index_replace,
+	/* .replace_unchanged = */ memtx_bitset_index_replace_unchanged,
 	/* .create_iterator = */ memtx_bitset_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		generic_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -30,17 +30,22 @@
  */
 #include "memtx_engine.h"
 #include "memtx_space.h"
+#include "memtx_expire.h"
 
 #include <small/quota.h>
 #include <small/small.h>
 #include <small/mempool.h>
+#include <pmatomic.h>
 
 #include "fiber.h"
+#include "clock.h"
 #include "errinj.h"
 #include "coio_file.h"
 #include "tuple.h"
+#include "tuple_compression.h"
 #include "txn.h"
 #include "memtx_tree.h"
+#include "coio_task.h"
 #include "iproto_constants.h"
 #include "xrow.h"
 #include "xstream.h"
@@ -48,6 +53,8 @@
 #include "replication.h"
 #include "schema.h"
 #include "gc.h"
+#include "tt_pthread.h"
+#include "msgpuck.h"
 
 /* sync snapshot every 16MB */
 #define SNAP_SYNC_INTERVAL	(1 << 24)
@@ -55,8 +62,10 @@
 static void
 checkpoint_cancel(struct checkpoint *ckpt);
 
+struct memtx_join_ctx;
+
 static void
-replica_join_cancel(struct cord *replica_join_cord);
+replica_join_cancel(struct memtx_join_ctx *ctx);
 
 struct PACKED memtx_tuple {
 	/*
@@ -74,8 +83,19 @@ enum {
 	OBJSIZE_MIN = 16,
 	SLAB_SIZE = 16 * 1024 * 1024,
 	MAX_TUPLE_SIZE = 1 * 1024 * 1024,
+	/**
+	 * Secondary keys of a space with fewer tuples are
+	 * not worth building in parallel.
+	 */
+	MEMTX_PARALLEL_BUILD_THRESHOLD = 10000,
 };
 
+/**
+ * How often snapshot iterators of the spaces written by the
+ * checkpoint threads are freed, in seconds.
+ */
+static const double CHECKPOINT_RELEASE_PERIOD = 0.1;
+
 static int
 memtx_end_build_primary_key(struct space *space, void *param)
 {
@@ -95,6 +115,109 @@ memtx_end_build_primary_key(struct space *space, void *param)
  * Data dictionary spaces are an exception, they are fully
  * built right from the start.
  */
+static ssize_t
+memtx_prepare_build_cb(va_list ap)
+{
+	struct index *index = va_arg(ap, struct index *);
+	struct tuple **tuples = va_arg(ap, struct tuple **);
+	size_t count = va_arg(ap, size_t);
+	return memtx_tree_index_prepare_build(index, tuples, count);
+}
+
+static int
+memtx_prepare_build_f(va_list ap)
+{
+	struct index *index = va_arg(ap, struct index *);
+	struct tuple **tuples = va_arg(ap, struct tuple **);
+	size_t count = va_arg(ap, size_t);
+	return coio_call(memtx_prepare_build_cb, index, tuples, count) == 0 ?
+	       0 : -1;
+}
+
+/**
+ * Build secondary tree indexes of a space in parallel.
+ * Collecting and sorting keys, which is the most expensive
+ * part of the build, is done by coio threads, one task per
+ * index, while indexes of other kinds are built by the tx
+ * thread meanwhile. Trees themselves are assembled in tx,
+ * because they are allocated from the engine arena.
+ */
+static int
+memtx_build_secondary_keys_parallel(struct space *space, ssize_t n_tuples)
+{
+	struct index *pk = space->index[0];
+	size_t size = n_tuples * sizeof(struct tuple *);
+	struct tuple **tuples = malloc(size);
+	if (tuples == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "tuples");
+		return -1;
+	}
+	struct iterator *it = index_create_iterator(pk, ITER_ALL, NULL, 0);
+	if (it == NULL) {
+		free(tuples);
+		return -1;
+	}
+	ssize_t count = 0;
+	struct tuple *tuple;
+	int rc;
+	while ((rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
+		assert(count < n_tuples);
+		tuples[count++] = tuple;
+	}
+	iterator_delete(it);
+	if (rc != 0) {
+		free(tuples);
+		return -1;
+	}
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size = space->index_count * sizeof(struct fiber *);
+	struct fiber **builders = region_alloc(region, size);
+	if (builders == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "builders");
+		free(tuples);
+		return -1;
+	}
+	for (uint32_t j = 1; j < space->index_count; j++) {
+		struct index *index = space->index[j];
+		builders[j] = NULL;
+		if (!memtx_tree_index_can_prepare_build(index))
+			continue;
+		say_info("Adding %zd keys to %s index '%s' ...", count,
+			 index_type_strs[index->def->type], index->def->name);
+		index_begin_build(index);
+		builders[j] = fiber_new("index_build", memtx_prepare_build_f);
+		if (builders[j] == NULL) {
+			/* Build the index in tx then. */
+			diag_log();
+			if (memtx_tree_index_prepare_build(index, tuples,
+							   count) != 0)
+				rc = -1;
+			continue;
+		}
+		fiber_set_joinable(builders[j], true);
+		fiber_start(builders[j], index, tuples, (size_t)count);
+	}
+	for (uint32_t j = 1; j < space->index_count; j++) {
+		if (rc == 0 && !memtx_tree_index_can_prepare_build(
+						space->index[j]))
+			rc = index_build(space->index[j], pk);
+	}
+	/* Builders must be joined even on error, they use the tuples. */
+	for (uint32_t j = 1; j < space->index_count; j++) {
+		if (builders[j] != NULL && fiber_join(builders[j]) != 0)
+			rc = -1;
+	}
+	for (uint32_t j = 1; j < space->index_count && rc == 0; j++) {
+		if (memtx_tree_index_can_prepare_build(space->index[j]))
+			memtx_tree_index_finish_build(space->index[j]);
+	}
+	region_truncate(region, region_svp);
+	free(tuples);
+	return rc;
+}
+
 static int
 memtx_build_secondary_keys(struct space *space, void *param)
 {
@@ -113,9 +236,16 @@ memtx_build_secondary_keys(struct space *space, void *param)
 				 space_name(space));
 		}
 
-		for (uint32_t j = 1; j < space->index_count; j++) {
-			if (index_build(space->index[j], pk) < 0)
+		if (n_tuples >= MEMTX_PARALLEL_BUILD_THRESHOLD &&
+		    space->index_count > 2) {
+			if (memtx_build_secondary_keys_parallel(space,
+							n_tuples) != 0)
 				return -1;
+		} else {
+			for (uint32_t j = 1; j < space->index_count; j++) {
+				if (index_build(space->index[j], pk) < 0)
+					return -1;
+			}
 		}
 
 		if (n_tuples > 0) {
@@ -132,13 +262,16 @@ memtx_engine_shutdown(struct engine *engine)
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
 	if (memtx->checkpoint != NULL)
 		checkpoint_cancel(memtx->checkpoint);
-	if (memtx->replica_join_cord != NULL)
-		replica_join_cancel(memtx->replica_join_cord);
+	if (memtx->replica_join_ctx != NULL)
+		replica_join_cancel(memtx->replica_join_ctx);
 	mempool_destroy(&memtx->iterator_pool);
 	if (mempool_is_initialized(&memtx->rtree_iterator_pool))
 		mempool_destroy(&memtx->rtree_iterator_pool);
 	mempool_destroy(&memtx->index_extent_pool);
 	slab_cache_destroy(&memtx->index_slab_cache);
+	memtx_expire_delete(memtx->expire);
+	memtx_tx_manager_free();
+	tuple_compression_free();
 	small_alloc_destroy(&memtx->alloc);
 	slab_cache_destroy(&memtx->slab_cache);
 	tuple_arena_destroy(&memtx->arena);
@@ -150,13 +283,98 @@ static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
 				  struct xrow_header *row);
 
-int
-memtx_engine_recover_snapshot(struct memtx_engine *memtx,
-			      const struct vclock *vclock)
+/**
+ * Spaces of a delta snapshot stored in the full snapshot it
+ * is based on.
+ */
+struct memtx_snap_base {
+	/** Vclock of the base snapshot, not set for a full one. */
+	struct vclock vclock;
+	/** Sorted ids of the spaces stored in the base snapshot. */
+	uint32_t *space_ids;
+	/** Number of elements in @a space_ids. */
+	uint32_t space_count;
+	/** Number of allocated elements of @a space_ids. */
+	uint32_t space_capacity;
+};
+
+static int
+memtx_space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *)a;
+	uint32_t id_b = *(const uint32_t *)b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+/** Check if a space is stored in the base snapshot. */
+static bool
+memtx_snap_base_has_space(const struct memtx_snap_base *base,
+			  uint32_t space_id)
+{
+	return bsearch(&space_id, base->space_ids, base->space_count,
+		       sizeof(space_id), memtx_space_id_cmp) != NULL;
+}
+
+static int
+memtx_snap_base_add_space(struct memtx_snap_base *base, uint32_t space_id)
+{
+	if (base->space_count == base->space_capacity) {
+		uint32_t capacity = MAX(base->space_capacity * 2, 16);
+		size_t size = capacity * sizeof(*base->space_ids);
+		uint32_t *ids = realloc(base->space_ids, size);
+		if (ids == NULL) {
+			diag_set(OutOfMemory, size, "realloc", "space_ids");
+			return -1;
+		}
+		base->space_ids = ids;
+		base->space_capacity = capacity;
+	}
+	base->space_ids[base->space_count++] = space_id;
+	return 0;
+}
+
+/**
+ * Decode the id of the space a snapshot row belongs to. Rows
+ * of the spaces stored in the base snapshot are IPROTO_NOP
+ * with only the space id in the body, see checkpoint_f().
+ */
+static int
+memtx_snapshot_row_space_id(struct xrow_header *row, uint32_t *space_id)
+{
+	if (row->bodycnt != 1)
+		goto error;
+	const char *data = (const char *)row->body[0].iov_base;
+	if (mp_typeof(*data) != MP_MAP)
+		goto error;
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*data) != MP_UINT ||
+		    mp_decode_uint(&data) != IPROTO_SPACE_ID) {
+			mp_next(&data);
+			continue;
+		}
+		if (mp_typeof(*data) != MP_UINT)
+			goto error;
+		*space_id = mp_decode_uint(&data);
+		return 0;
+	}
+error:
+	diag_set(ClientError, ER_INVALID_MSGPACK, "snapshot row space id");
+	return -1;
+}
+
+/**
+ * Load a snapshot file. If @a is_base is false, the file is the
+ * snapshot being recovered: if it's a delta one, its base vclock
+ * and the spaces stored in the base are collected to @a base.
+ * Otherwise, the file is the base snapshot and only the spaces
+ * listed in @a base are loaded from it.
+ */
+static int
+memtx_engine_recover_snapshot_file(struct memtx_engine *memtx,
+				   int64_t signature, int64_t lsn,
+				   struct memtx_snap_base *base, bool is_base)
 {
-	/* Process existing snapshot */
-	say_info("recovery start");
-	int64_t signature = vclock_sum(vclock);
 	const char *filename = xdir_format_filename(&memtx->snap_dir,
 						    signature, NONE);
 
@@ -164,14 +382,33 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 	struct xlog_cursor cursor;
 	if (xlog_cursor_open(&cursor, filename) < 0)
 		return -1;
+	if (is_base && vclock_is_set(&cursor.meta.base_vclock)) {
+		diag_set(XlogError, "base snapshot `%s' is a delta one",
+			 filename);
+		xlog_cursor_close(&cursor, false);
+		return -1;
+	}
+	if (!is_base)
+		vclock_copy(&base->vclock, &cursor.meta.base_vclock);
 
 	int rc;
 	struct xrow_header row;
 	uint64_t row_count = 0;
 	while ((rc = xlog_cursor_next(&cursor, &row,
 				      memtx->force_recovery)) == 0) {
-		row.lsn = signature;
-		rc = memtx_engine_recover_snapshot_row(memtx, &row);
+		row.lsn = lsn;
+		uint32_t space_id;
+		if (!is_base && row.type != IPROTO_NOP) {
+			rc = memtx_engine_recover_snapshot_row(memtx, &row);
+		} else if (memtx_snapshot_row_space_id(&row, &space_id) != 0) {
+			rc = -1;
+		} else if (!is_base) {
+			/* A space stored in the base snapshot. */
+			rc = memtx_snap_base_add_space(base, space_id);
+		} else if (space_id >= BOX_SYSTEM_ID_MAX &&
+			   memtx_snap_base_has_space(base, space_id)) {
+			rc = memtx_engine_recover_snapshot_row(memtx, &row);
+		}
 		if (rc < 0) {
 			if (!memtx->force_recovery)
 				break;
@@ -200,6 +437,70 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 	return 0;
 }
 
+/**
+ * Mark the spaces loaded from a delta snapshot as changed since
+ * the last full snapshot.
+ */
+static int
+memtx_mark_delta_space(struct space *space, void *arg)
+{
+	struct memtx_snap_base *base = arg;
+	if (!space_is_memtx(space) ||
+	    memtx_snap_base_has_space(base, space_id(space)))
+		return 0;
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	memtx_space->checkpoint_gen = memtx->checkpoint_gen;
+	return 0;
+}
+
+int
+memtx_engine_recover_snapshot(struct memtx_engine *memtx,
+			      const struct vclock *vclock)
+{
+	/* Process existing snapshot */
+	say_info("recovery start");
+	int64_t signature = vclock_sum(vclock);
+	struct memtx_snap_base base;
+	memset(&base, 0, sizeof(base));
+	vclock_clear(&base.vclock);
+	/* Loaded spaces must not look changed, see checkpoint_gen. */
+	memtx->checkpoint_gen = 0;
+	int rc = memtx_engine_recover_snapshot_file(memtx, signature,
+						    signature, &base, false);
+	bool is_delta = vclock_is_set(&base.vclock);
+	if (rc == 0 && is_delta) {
+		/*
+		 * The rest of the spaces are stored in the full
+		 * snapshot the delta is based on. The rows get the
+		 * LSN of the delta, because the spaces haven't been
+		 * changed in between.
+		 */
+		qsort(base.space_ids, base.space_count,
+		      sizeof(*base.space_ids), memtx_space_id_cmp);
+		rc = memtx_engine_recover_snapshot_file(
+			memtx, vclock_sum(&base.vclock), signature,
+			&base, true);
+	}
+	memtx->checkpoint_gen = 1;
+	if (rc == 0) {
+		/*
+		 * The next delta snapshot is based on the same full
+		 * snapshot, so it must store all the spaces which
+		 * aren't stored in the base.
+		 */
+		memtx->full_checkpoint_gen = 0;
+		if (is_delta) {
+			vclock_copy(&memtx->snap_base_vclock, &base.vclock);
+			space_foreach(memtx_mark_delta_space, &base);
+		} else {
+			vclock_copy(&memtx->snap_base_vclock, vclock);
+		}
+	}
+	free(base.space_ids);
+	return rc;
+}
+
 static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
 				  struct xrow_header *row)
@@ -320,6 +621,7 @@ memtx_engine_end_recovery(struct engine *engine)
 		if (space_foreach(memtx_build_secondary_keys, memtx) != 0)
 			return -1;
 	}
+	memtx_expire_start(memtx->expire);
 	return 0;
 }
 
@@ -335,7 +637,13 @@ static int
 memtx_engine_begin(struct engine *engine, struct txn *txn)
 {
 	(void)engine;
-	txn_can_yield(txn, false);
+	/*
+	 * With the transaction manager enabled, yields are
+	 * disabled only when a change is applied in place,
+	 * see memtx_space_replace_tuple().
+	 */
+	if (!memtx_tx_manager_use_mvcc_engine)
+		txn_can_yield(txn, false);
 	return 0;
 }
 
@@ -355,6 +663,23 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 	if (stmt->engine_savepoint == NULL)
 		return;
 
+	if (stmt->add_story != NULL || stmt->del_story != NULL) {
+		memtx_tx_history_rollback_stmt(stmt);
+		goto done;
+	}
+	/*
+	 * Statements in progress may be built on top of
+	 * a prepared change, abort them first.
+	 */
+	if (memtx_tx_manager_use_mvcc_engine)
+		memtx_tx_abort_writers_for_space(space);
+	/*
+	 * An update done in place doesn't touch indexes, its
+	 * rollback trigger restores the tuple data.
+	 */
+	if (stmt->old_tuple == stmt->new_tuple)
+		goto done;
+
 	if (memtx_space->replace == memtx_space_replace_all_keys)
 		index_count = space->index_count;
 	else if (memtx_space->replace == memtx_space_replace_primary_key)
@@ -373,7 +698,7 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 			panic("failed to rollback change");
 		}
 	}
-
+done:
 	memtx_space_update_bsize(space, stmt->new_tuple, stmt->old_tuple);
 	if (stmt->old_tuple != NULL)
 		tuple_ref(stmt->old_tuple);
@@ -404,19 +729,125 @@ memtx_engine_bootstrap(struct engine *engine)
 			break;
 	}
 	xlog_cursor_close(&cursor, false);
-	return rc < 0 ? -1 : 0;
+	if (rc < 0)
+		return -1;
+	memtx_expire_start(memtx->expire);
+	return 0;
+}
+
+struct checkpoint_entry {
+	uint32_t space_id;
+	uint32_t group_id;
+	/** Memory used by the space tuples. */
+	size_t bsize;
+	/**
+	 * Set if the space has been changed since the last full
+	 * snapshot. System spaces are always considered changed.
+	 */
+	bool is_changed;
+	struct snapshot_iterator *iterator;
+	struct rlist link;
+};
+
+struct checkpoint {
+	/**
+	 * List of MemTX spaces to snapshot, with consistent
+	 * read view iterators.
+	 */
+	struct rlist entries;
+	struct cord cord;
+	bool waiting_for_snap_thread;
+	/** The vclock of the snapshot file. */
+	struct vclock vclock;
+	struct xdir dir;
+	/**
+	 * Do nothing, just touch the snapshot file - the
+	 * checkpoint already exists.
+	 */
+	bool touch;
+	/** The snapshot file, shared by all writer threads. */
+	struct xlog snap;
+	/**
+	 * Number of threads writing the snapshot, including
+	 * the snapshot thread itself.
+	 */
+	int threads;
+	/** Auxiliary writer threads, threads - 1 of them. */
+	struct cord *workers;
+	/** Number of started auxiliary threads. */
+	int workers_started;
+	/** Number of auxiliary threads joined by the snapshot thread. */
+	int workers_joined;
+	/** Protects next_entry and writes to the snapshot file. */
+	pthread_mutex_t mutex;
+	/** The next entry in the list to be picked by a writer. */
+	struct rlist *next_entry;
+	/**
+	 * Entries of the spaces which have been written. Moved
+	 * here from the entries list by writers, protected by
+	 * the mutex. Their iterators are freed in the tx thread
+	 * by the release timer, see checkpoint_release_entries().
+	 */
+	struct rlist written_entries;
+	/** Timer freeing the written entries while writing. */
+	struct ev_timer release_timer;
+	/** Number of rows written so far, used to number rows. */
+	int64_t rows;
+	/** Set if any of the writers failed. */
+	bool is_failed;
+	/** Timestamp of all rows of the snapshot. */
+	ev_tstamp tm;
+	/** Checkpoint generation, see memtx_engine::checkpoint_gen. */
+	int64_t gen;
+	/**
+	 * Generation of the last full snapshot. Spaces changed
+	 * after it are written to a delta snapshot.
+	 */
+	int64_t full_gen;
+	/**
+	 * Vclock of the full snapshot this one is based on if
+	 * it's a delta snapshot, not set otherwise.
+	 */
+	struct vclock base_vclock;
+	/** Ids of the spaces stored in the base snapshot. */
+	uint32_t *base_space_ids;
+	/** Number of elements in @a base_space_ids. */
+	uint32_t base_space_count;
+};
+
+static void
+checkpoint_unlock(void *mutex)
+{
+	tt_pthread_mutex_unlock((pthread_mutex_t *)mutex);
 }
 
+/**
+ * Encode the rows accumulated by a writer and append them to
+ * the snapshot file. Compression is done without the lock, so
+ * that only the writes themselves are serialized.
+ */
 static int
-checkpoint_write_row(struct xlog *l, struct xrow_header *row)
+checkpoint_write_buf(struct checkpoint *ckpt, struct xlog_tx_buf *buf)
 {
-	static ev_tstamp last = 0;
-	if (last == 0) {
-		ev_now_update(loop());
-		last = ev_now(loop());
-	}
+	if (xlog_tx_buf_encode(buf) != 0)
+		return -1;
+	ssize_t written;
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	/*
+	 * The write may be a cancellation point, make sure
+	 * the mutex is not left locked by a cancelled thread.
+	 */
+	pthread_cleanup_push(checkpoint_unlock, &ckpt->mutex);
+	written = xlog_write_tx_buf(&ckpt->snap, buf);
+	pthread_cleanup_pop(1);
+	return written < 0 ? -1 : 0;
+}
 
-	row->tm = last;
+static int
+checkpoint_write_row(struct checkpoint *ckpt, struct xlog_tx_buf *buf,
+		     struct xrow_header *row)
+{
+	row->tm = ckpt->tm;
 	row->replica_id = 0;
 	/**
 	 * Rows in snapshot are numbered from 1 to %rows.
@@ -425,22 +856,26 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 	 * WAL. @sa the place which skips old rows in
 	 * recovery_apply_row().
 	 */
-	row->lsn = l->rows + l->tx_rows;
+	int64_t lsn = pm_atomic_fetch_add(&ckpt->rows, 1);
+	row->lsn = lsn;
 	row->sync = 0; /* don't write sync to wal */
 
-	ssize_t written = xlog_write_row(l, row);
+	ssize_t written = xlog_tx_buf_write_row(buf, row);
 	fiber_gc();
 	if (written < 0)
 		return -1;
 
-	if ((l->rows + l->tx_rows) % 100000 == 0)
-		say_crit("%.1fM rows written", (l->rows + l->tx_rows) / 1000000.0);
-	return 0;
+	if ((lsn + 1) % 100000 == 0)
+		say_crit("%.1fM rows written", (lsn + 1) / 1000000.0);
 
+	if (xlog_tx_buf_is_full(buf))
+		return checkpoint_write_buf(ckpt, buf);
+	return 0;
 }
 
 static int
-checkpoint_write_tuple(struct xlog *l, uint32_t space_id, uint32_t group_id,
+checkpoint_write_tuple(struct checkpoint *ckpt, struct xlog_tx_buf *buf,
+		       uint32_t space_id, uint32_t group_id,
 		       const char *data, uint32_t size)
 {
 	struct request_replace_body body;
@@ -456,64 +891,171 @@ checkpoint_write_tuple(struct xlog *l, uint32_t space_id, uint32_t group_id,
 	row.body[0].iov_len = sizeof(body);
 	row.body[1].iov_base = (char *)data;
 	row.body[1].iov_len = size;
-	return checkpoint_write_row(l, &row);
+	return checkpoint_write_row(ckpt, buf, &row);
 }
 
-struct checkpoint_entry {
-	uint32_t space_id;
-	uint32_t group_id;
-	struct snapshot_iterator *iterator;
-	struct rlist link;
-};
+/**
+ * Pick the next space to be written by a writer thread.
+ * If @a system_only is set, only system spaces are returned.
+ */
+static struct checkpoint_entry *
+checkpoint_next_entry(struct checkpoint *ckpt, bool system_only)
+{
+	struct checkpoint_entry *entry = NULL;
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	if (!ckpt->is_failed && ckpt->next_entry != &ckpt->entries) {
+		entry = rlist_entry(ckpt->next_entry,
+				    struct checkpoint_entry, link);
+		if (system_only && entry->space_id >= BOX_SYSTEM_ID_MAX)
+			entry = NULL;
+		else
+			ckpt->next_entry = ckpt->next_entry->next;
+	}
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	return entry;
+}
 
-struct checkpoint {
-	/**
-	 * List of MemTX spaces to snapshot, with consistent
-	 * read view iterators.
-	 */
-	struct rlist entries;
-	struct cord cord;
-	bool waiting_for_snap_thread;
-	/** The vclock of the snapshot file. */
-	struct vclock vclock;
-	struct xdir dir;
-	/**
-	 * Do nothing, just touch the snapshot file - the
-	 * checkpoint already exists.
-	 */
-	bool touch;
-};
+/**
+ * Write spaces picked from the checkpoint list one by one
+ * until the list is exhausted. Run by every writer thread.
+ */
+static int
+checkpoint_write_entries(struct checkpoint *ckpt, bool system_only)
+{
+	struct xlog_tx_buf buf;
+	if (xlog_tx_buf_create(&buf, &ckpt->snap.opts) != 0)
+		goto fail;
+	struct checkpoint_entry *entry;
+	while ((entry = checkpoint_next_entry(ckpt, system_only)) != NULL) {
+		int rc;
+		uint32_t size;
+		const char *data;
+		struct snapshot_iterator *it = entry->iterator;
+		while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
+			if (checkpoint_write_tuple(ckpt, &buf, entry->space_id,
+					entry->group_id, data, size) != 0)
+				goto fail_buf;
+		}
+		if (rc != 0)
+			goto fail_buf;
+		/*
+		 * The rows are copied to the buffer, so the space
+		 * read view isn't needed anymore.
+		 */
+		tt_pthread_mutex_lock(&ckpt->mutex);
+		rlist_move_tail_entry(&ckpt->written_entries, entry, link);
+		tt_pthread_mutex_unlock(&ckpt->mutex);
+	}
+	if (checkpoint_write_buf(ckpt, &buf) != 0)
+		goto fail_buf;
+	xlog_tx_buf_destroy(&buf);
+	return 0;
+fail_buf:
+	xlog_tx_buf_destroy(&buf);
+fail:
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	ckpt->is_failed = true;
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	return -1;
+}
+
+/**
+ * Free the snapshot iterators of the spaces which have been
+ * written so far. Tuples deleted from such a space are freed
+ * immediately after that even though the checkpoint is still
+ * in progress, see memtx_tuple_delete().
+ */
+static void
+checkpoint_release_entries(struct checkpoint *ckpt)
+{
+	RLIST_HEAD(entries);
+	struct checkpoint_entry *entry, *tmp;
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	rlist_foreach_entry_safe(entry, &ckpt->written_entries, link, tmp)
+		rlist_move_tail_entry(&entries, entry, link);
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	rlist_foreach_entry_safe(entry, &entries, link, tmp) {
+		entry->iterator->free(entry->iterator);
+		free(entry);
+	}
+}
+
+static void
+checkpoint_release_timer_cb(ev_loop *loop, ev_timer *timer, int events)
+{
+	(void)loop;
+	(void)events;
+	checkpoint_release_entries(timer->data);
+}
 
 static struct checkpoint *
-checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit)
+checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit,
+	       int threads, struct xlog_dict *dict)
 {
+	assert(threads > 0);
 	struct checkpoint *ckpt = malloc(sizeof(*ckpt));
 	if (ckpt == NULL) {
 		diag_set(OutOfMemory, sizeof(*ckpt), "malloc",
 			 "struct checkpoint");
 		return NULL;
 	}
+	ckpt->workers = NULL;
+	if (threads > 1) {
+		size_t size = sizeof(*ckpt->workers) * (threads - 1);
+		ckpt->workers = malloc(size);
+		if (ckpt->workers == NULL) {
+			diag_set(OutOfMemory, size, "malloc",
+				 "struct cord");
+			free(ckpt);
+			return NULL;
+		}
+	}
+	ckpt->threads = threads;
+	ckpt->workers_started = 0;
+	ckpt->workers_joined = 0;
+	tt_pthread_mutex_init(&ckpt->mutex, NULL);
+	ckpt->rows = 0;
+	ckpt->is_failed = false;
 	rlist_create(&ckpt->entries);
+	ckpt->next_entry = &ckpt->entries;
+	rlist_create(&ckpt->written_entries);
+	ev_timer_init(&ckpt->release_timer, checkpoint_release_timer_cb,
+		      CHECKPOINT_RELEASE_PERIOD, CHECKPOINT_RELEASE_PERIOD);
+	ckpt->release_timer.data = ckpt;
 	ckpt->waiting_for_snap_thread = false;
 	struct xlog_opts opts = xlog_opts_default;
 	opts.rate_limit = snap_io_rate_limit;
 	opts.sync_interval = SNAP_SYNC_INTERVAL;
 	opts.free_cache = true;
+	opts.dict = dict;
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &INSTANCE_UUID, &opts);
 	vclock_create(&ckpt->vclock);
 	ckpt->touch = false;
+	ckpt->gen = 0;
+	ckpt->full_gen = 0;
+	vclock_clear(&ckpt->base_vclock);
+	ckpt->base_space_ids = NULL;
+	ckpt->base_space_count = 0;
 	return ckpt;
 }
 
 static void
 checkpoint_delete(struct checkpoint *ckpt)
 {
+	ev_timer_stop(loop(), &ckpt->release_timer);
 	struct checkpoint_entry *entry, *tmp;
 	rlist_foreach_entry_safe(entry, &ckpt->entries, link, tmp) {
 		entry->iterator->free(entry->iterator);
 		free(entry);
 	}
+	rlist_foreach_entry_safe(entry, &ckpt->written_entries, link, tmp) {
+		entry->iterator->free(entry->iterator);
+		free(entry);
+	}
 	xdir_destroy(&ckpt->dir);
+	tt_pthread_mutex_destroy(&ckpt->mutex);
+	free(ckpt->base_space_ids);
+	free(ckpt->workers);
 	free(ckpt);
 }
 
@@ -528,21 +1070,19 @@ checkpoint_cancel(struct checkpoint *ckpt)
 	if (ckpt->waiting_for_snap_thread) {
 		tt_pthread_cancel(ckpt->cord.id);
 		tt_pthread_join(ckpt->cord.id, NULL);
+		/*
+		 * Auxiliary writers which haven't been joined by
+		 * the checkpoint thread must be stopped as well.
+		 */
+		for (int i = ckpt->workers_joined;
+		     i < ckpt->workers_started; i++) {
+			tt_pthread_cancel(ckpt->workers[i].id);
+			tt_pthread_join(ckpt->workers[i].id, NULL);
+		}
 	}
 	checkpoint_delete(ckpt);
 }
 
-static void
-replica_join_cancel(struct cord *replica_join_cord)
-{
-	/*
-	 * Cancel the thread being used to join replica if it's
-	 * running and wait for it to terminate so as to
-	 * eliminate the possibility of use-after-free.
-	 */
-	tt_pthread_cancel(replica_join_cord->id);
-	tt_pthread_join(replica_join_cord->id, NULL);
-}
 
 static int
 checkpoint_add_space(struct space *sp, void *data)
@@ -565,6 +1105,10 @@ checkpoint_add_space(struct space *sp, void *data)
 
 	entry->space_id = space_id(sp);
 	entry->group_id = space_group_id(sp);
+	struct memtx_space *memtx_space = (struct memtx_space *)sp;
+	entry->bsize = memtx_space->bsize;
+	entry->is_changed = space_is_system(sp) ||
+			    memtx_space->checkpoint_gen > ckpt->full_gen;
 	entry->iterator = index_create_snapshot_iterator(pk);
 	if (entry->iterator == NULL)
 		return -1;
@@ -572,6 +1116,94 @@ checkpoint_add_space(struct space *sp, void *data)
 	return 0;
 };
 
+/**
+ * Make a checkpoint a delta one if the spaces changed since the
+ * last full snapshot are small enough, see checkpoint_delta_ratio.
+ * The unchanged spaces are not written then, the snapshot refers
+ * to the full one for them instead.
+ */
+static int
+checkpoint_make_delta(struct checkpoint *ckpt, struct memtx_engine *memtx)
+{
+	if (memtx->checkpoint_delta_ratio == 0 ||
+	    !vclock_is_set(&memtx->snap_base_vclock))
+		return 0;
+	size_t total_size = 0;
+	size_t changed_size = 0;
+	uint32_t unchanged_count = 0;
+	struct checkpoint_entry *entry, *tmp;
+	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		total_size += entry->bsize;
+		if (entry->is_changed)
+			changed_size += entry->bsize;
+		else
+			unchanged_count++;
+	}
+	if (unchanged_count == 0 ||
+	    changed_size > total_size * memtx->checkpoint_delta_ratio)
+		return 0;
+	size_t size = unchanged_count * sizeof(*ckpt->base_space_ids);
+	ckpt->base_space_ids = malloc(size);
+	if (ckpt->base_space_ids == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "base_space_ids");
+		return -1;
+	}
+	rlist_foreach_entry_safe(entry, &ckpt->entries, link, tmp) {
+		if (entry->is_changed)
+			continue;
+		ckpt->base_space_ids[ckpt->base_space_count++] =
+			entry->space_id;
+		rlist_del_entry(entry, link);
+		entry->iterator->free(entry->iterator);
+		free(entry);
+	}
+	vclock_copy(&ckpt->base_vclock, &memtx->snap_base_vclock);
+	return 0;
+}
+
+/**
+ * Write references to the spaces stored in the base snapshot
+ * to a delta snapshot. A reference is an IPROTO_NOP row with
+ * the space id in the body.
+ */
+static int
+checkpoint_write_base_spaces(struct checkpoint *ckpt)
+{
+	struct xlog_tx_buf buf;
+	if (xlog_tx_buf_create(&buf, &ckpt->snap.opts) != 0)
+		return -1;
+	for (uint32_t i = 0; i < ckpt->base_space_count; i++) {
+		char body[16];
+		char *pos = mp_encode_map(body, 1);
+		pos = mp_encode_uint(pos, IPROTO_SPACE_ID);
+		pos = mp_encode_uint(pos, ckpt->base_space_ids[i]);
+		assert(pos <= body + sizeof(body));
+
+		struct xrow_header row;
+		memset(&row, 0, sizeof(struct xrow_header));
+		row.type = IPROTO_NOP;
+		row.bodycnt = 1;
+		row.body[0].iov_base = body;
+		row.body[0].iov_len = pos - body;
+		if (checkpoint_write_row(ckpt, &buf, &row) != 0)
+			goto fail;
+	}
+	if (checkpoint_write_buf(ckpt, &buf) != 0)
+		goto fail;
+	xlog_tx_buf_destroy(&buf);
+	return 0;
+fail:
+	xlog_tx_buf_destroy(&buf);
+	return -1;
+}
+
+static int
+checkpoint_worker_f(va_list ap)
+{
+	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
+	return checkpoint_write_entries(ckpt, false);
+}
+
 static int
 checkpoint_f(va_list ap)
 {
@@ -587,34 +1219,68 @@ checkpoint_f(va_list ap)
 		ckpt->touch = false;
 	}
 
-	struct xlog snap;
-	if (xdir_create_xlog(&ckpt->dir, &snap, &ckpt->vclock) != 0)
-		return -1;
-
-	say_info("saving snapshot `%s'", snap.filename);
+	struct xlog *snap = &ckpt->snap;
+	bool is_delta = vclock_is_set(&ckpt->base_vclock);
+	if (is_delta) {
+		if (xdir_create_delta_xlog(&ckpt->dir, snap, &ckpt->vclock,
+					   &ckpt->base_vclock) != 0)
+			return -1;
+		say_info("saving delta snapshot `%s', %u spaces are stored "
+			 "in the base snapshot", snap->filename,
+			 (unsigned)ckpt->base_space_count);
+	} else {
+		if (xdir_create_xlog(&ckpt->dir, snap, &ckpt->vclock) != 0)
+			return -1;
+		say_info("saving snapshot `%s'", snap->filename);
+	}
 	ERROR_INJECT_SLEEP(ERRINJ_SNAP_WRITE_DELAY);
-	struct checkpoint_entry *entry;
-	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		int rc;
-		uint32_t size;
-		const char *data;
-		struct snapshot_iterator *it = entry->iterator;
-		while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
-			if (checkpoint_write_tuple(&snap, entry->space_id,
-					entry->group_id, data, size) != 0)
-				goto fail;
+	ev_now_update(loop());
+	ckpt->tm = ev_now(loop());
+	ckpt->next_entry = rlist_first(&ckpt->entries);
+	/*
+	 * System spaces must be recovered before user spaces,
+	 * so write them first in the snapshot thread alone.
+	 */
+	if (checkpoint_write_entries(ckpt, true) != 0)
+		goto fail;
+	if (is_delta && checkpoint_write_base_spaces(ckpt) != 0)
+		goto fail;
+	/*
+	 * The rest of spaces are distributed among the writer
+	 * threads, one space at a time. Do not let the thread
+	 * be cancelled while a writer is started and not yet
+	 * accounted, otherwise the writer would be left running.
+	 */
+	int cancel_state;
+	tt_pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel_state);
+	for (int i = 0; i < ckpt->threads - 1; i++) {
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "snapshot%d", i + 1);
+		if (cord_costart(&ckpt->workers[i], name,
+				 checkpoint_worker_f, ckpt) != 0) {
+			/* Proceed with fewer threads. */
+			diag_log();
+			break;
 		}
-		if (rc != 0)
-			goto fail;
+		ckpt->workers_started++;
 	}
-	if (xlog_flush(&snap) < 0)
+	tt_pthread_setcancelstate(cancel_state, NULL);
+	int rc = checkpoint_write_entries(ckpt, false);
+	while (ckpt->workers_joined < ckpt->workers_started) {
+		if (cord_join(&ckpt->workers[ckpt->workers_joined]) != 0)
+			rc = -1;
+		ckpt->workers_joined++;
+	}
+	if (rc != 0)
+		goto fail;
+	if (xlog_flush(snap) < 0)
 		goto fail;
 
-	xlog_close(&snap, false);
+	xlog_close(snap, false);
 	say_info("done");
 	return 0;
 fail:
-	xlog_close(&snap, false);
+	xlog_close(snap, false);
 	return -1;
 }
 
@@ -626,11 +1292,20 @@ memtx_engine_begin_checkpoint(struct engine *engine, bool is_scheduled)
 
 	assert(memtx->checkpoint == NULL);
 	memtx->checkpoint = checkpoint_new(memtx->snap_dir.dirname,
-					   memtx->snap_io_rate_limit);
+					   memtx->snap_io_rate_limit,
+					   memtx->snapshot_threads,
+					   memtx->snap_dict);
 	if (memtx->checkpoint == NULL)
 		return -1;
 
-	if (space_foreach(checkpoint_add_space, memtx->checkpoint) != 0) {
+	/*
+	 * Changes made after this point aren't in the read view
+	 * of the checkpoint, so they get the next generation.
+	 */
+	memtx->checkpoint->gen = memtx->checkpoint_gen++;
+	memtx->checkpoint->full_gen = memtx->full_checkpoint_gen;
+	if (space_foreach(checkpoint_add_space, memtx->checkpoint) != 0 ||
+	    checkpoint_make_delta(memtx->checkpoint, memtx) != 0) {
 		checkpoint_delete(memtx->checkpoint);
 		memtx->checkpoint = NULL;
 		return -1;
@@ -660,6 +1335,7 @@ memtx_engine_wait_checkpoint(struct engine *engine,
 		return -1;
 	}
 	memtx->checkpoint->waiting_for_snap_thread = true;
+	ev_timer_start(loop(), &memtx->checkpoint->release_timer);
 
 	/* wait for memtx-part snapshot completion */
 	int result = cord_cojoin(&memtx->checkpoint->cord);
@@ -667,6 +1343,8 @@ memtx_engine_wait_checkpoint(struct engine *engine,
 		diag_log();
 
 	memtx->checkpoint->waiting_for_snap_thread = false;
+	ev_timer_stop(loop(), &memtx->checkpoint->release_timer);
+	checkpoint_release_entries(memtx->checkpoint);
 	return result;
 }
 
@@ -694,6 +1372,12 @@ memtx_engine_commit_checkpoint(struct engine *engine,
 		int rc = coio_rename(from, to);
 		if (rc != 0)
 			panic("can't rename .snap.inprogress");
+		if (!vclock_is_set(&memtx->checkpoint->base_vclock)) {
+			/* Next delta snapshots are based on this one. */
+			memtx->full_checkpoint_gen = memtx->checkpoint->gen;
+			vclock_copy(&memtx->snap_base_vclock,
+				    &memtx->checkpoint->vclock);
+		}
 	}
 
 	struct vclock last;
@@ -733,12 +1417,47 @@ memtx_engine_abort_checkpoint(struct engine *engine)
 	memtx->checkpoint = NULL;
 }
 
+/**
+ * Get the vclock of the full snapshot the snapshot with the given
+ * signature is based on. The vclock isn't set if the snapshot is
+ * a full one.
+ */
+static int
+memtx_engine_snap_base_vclock(struct memtx_engine *memtx, int64_t signature,
+			      struct vclock *base_vclock)
+{
+	const char *filename = xdir_format_filename(&memtx->snap_dir,
+						    signature, NONE);
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, filename) < 0)
+		return -1;
+	vclock_copy(base_vclock, &cursor.meta.base_vclock);
+	xlog_cursor_close(&cursor, false);
+	return 0;
+}
+
 static void
 memtx_engine_collect_garbage(struct engine *engine, const struct vclock *vclock)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	xdir_collect_garbage(&memtx->snap_dir, vclock_sum(vclock),
-			     XDIR_GC_ASYNC);
+	int64_t signature = vclock_sum(vclock);
+	/*
+	 * If the oldest snapshot to keep is a delta one, keep
+	 * the full snapshot it is based on as well. Newer delta
+	 * snapshots are based on the same or newer full ones.
+	 */
+	struct vclock *oldest = vclockset_first(&memtx->snap_dir.index);
+	if (oldest != NULL && vclock_sum(oldest) < signature) {
+		struct vclock base_vclock;
+		if (memtx_engine_snap_base_vclock(memtx, signature,
+						  &base_vclock) != 0) {
+			diag_log();
+			return;
+		}
+		if (vclock_is_set(&base_vclock))
+			signature = vclock_sum(&base_vclock);
+	}
+	xdir_collect_garbage(&memtx->snap_dir, signature, XDIR_GC_ASYNC);
 	xdir_collect_inprogress(&memtx->snap_dir);
 }
 
@@ -747,6 +1466,17 @@ memtx_engine_backup(struct engine *engine, const struct vclock *vclock,
 		    engine_backup_cb cb, void *cb_arg)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	struct vclock base_vclock;
+	if (memtx_engine_snap_base_vclock(memtx, vclock_sum(vclock),
+					  &base_vclock) != 0)
+		return -1;
+	if (vclock_is_set(&base_vclock)) {
+		/* A delta snapshot is useless without its base. */
+		const char *filename = xdir_format_filename(&memtx->snap_dir,
+					vclock_sum(&base_vclock), NONE);
+		if (cb(filename, cb_arg) != 0)
+			return -1;
+	}
 	const char *filename = xdir_format_filename(&memtx->snap_dir,
 						    vclock_sum(vclock), NONE);
 	return cb(filename, cb_arg);
@@ -758,9 +1488,58 @@ struct memtx_join_entry {
 	struct snapshot_iterator *iterator;
 };
 
+/**
+ * A batch of rows read by a join worker thread, see
+ * memtx_join_worker_f(). Each row is stored as a 32-bit size
+ * followed by tuple data.
+ */
+struct memtx_join_batch {
+	/** Link in memtx_join_ctx::queue. */
+	struct stailq_entry in_queue;
+	/** Space the rows belong to. */
+	uint32_t space_id;
+	/** Number of used bytes of @a data. */
+	size_t size;
+	/** Number of allocated bytes of @a data. */
+	size_t capacity;
+	/** Rows. */
+	char data[0];
+};
+
+enum {
+	/** Size of a batch of rows read by a join worker. */
+	MEMTX_JOIN_BATCH_SIZE = 1024 * 1024,
+	/** Max number of batches queued per join worker. */
+	MEMTX_JOIN_QUEUE_DEPTH = 2,
+};
+
 struct memtx_join_ctx {
 	struct rlist entries;
 	struct xstream *stream;
+	/** Thread sending the read view to the replica. */
+	struct cord cord;
+	/** Number of threads reading spaces, see snapshot_threads. */
+	int threads;
+	/** Threads reading user spaces if there are several. */
+	struct cord *workers;
+	/** Number of started worker threads. */
+	int workers_started;
+	/** Number of worker threads joined by the join thread. */
+	int workers_joined;
+	/** Number of worker threads that haven't finished yet. */
+	int workers_active;
+	/** Protects the fields below. */
+	pthread_mutex_t mutex;
+	/** Signaled when a batch is queued or consumed. */
+	pthread_cond_t cond;
+	/** The next entry in the list to be read by a worker. */
+	struct rlist *next_entry;
+	/** Batches read by the workers, to be sent. */
+	struct stailq queue;
+	/** Length of @a queue. */
+	int queue_len;
+	/** Set if the join failed and the workers must stop. */
+	bool is_failed;
 };
 
 static int
@@ -792,61 +1571,332 @@ memtx_join_add_space(struct space *space, void *arg)
 	return 0;
 }
 
+static void
+memtx_join_ctx_delete(struct memtx_join_ctx *ctx)
+{
+	struct memtx_join_entry *entry, *next;
+	rlist_foreach_entry_safe(entry, &ctx->entries, in_ctx, next) {
+		entry->iterator->free(entry->iterator);
+		free(entry);
+	}
+	struct memtx_join_batch *batch, *next_batch;
+	stailq_foreach_entry_safe(batch, next_batch, &ctx->queue, in_queue)
+		free(batch);
+	tt_pthread_cond_destroy(&ctx->cond);
+	tt_pthread_mutex_destroy(&ctx->mutex);
+	free(ctx->workers);
+	free(ctx);
+}
+
 static int
 memtx_engine_prepare_join(struct engine *engine, void **arg)
 {
-	(void)engine;
-	struct memtx_join_ctx *ctx = malloc(sizeof(*ctx));
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	struct memtx_join_ctx *ctx = calloc(1, sizeof(*ctx));
 	if (ctx == NULL) {
 		diag_set(OutOfMemory, sizeof(*ctx),
-			 "malloc", "struct memtx_join_ctx");
+			 "calloc", "struct memtx_join_ctx");
 		return -1;
 	}
 	rlist_create(&ctx->entries);
+	stailq_create(&ctx->queue);
+	tt_pthread_mutex_init(&ctx->mutex, NULL);
+	tt_pthread_cond_init(&ctx->cond, NULL);
+	ctx->threads = memtx->snapshot_threads;
+	if (ctx->threads > 1) {
+		size_t size = sizeof(*ctx->workers) * ctx->threads;
+		ctx->workers = malloc(size);
+		if (ctx->workers == NULL) {
+			diag_set(OutOfMemory, size, "malloc", "struct cord");
+			memtx_join_ctx_delete(ctx);
+			return -1;
+		}
+	}
 	if (space_foreach(memtx_join_add_space, ctx) != 0) {
-		free(ctx);
+		memtx_join_ctx_delete(ctx);
+		return -1;
+	}
+	*arg = ctx;
+	return 0;
+}
+
+static int
+memtx_join_send_tuple(struct xstream *stream, uint32_t space_id,
+		      const char *data, size_t size)
+{
+	struct request_replace_body body;
+	request_replace_body_create(&body, space_id);
+
+	struct xrow_header row;
+	memset(&row, 0, sizeof(row));
+	row.type = IPROTO_INSERT;
+
+	row.bodycnt = 2;
+	row.body[0].iov_base = &body;
+	row.body[0].iov_len = sizeof(body);
+	row.body[1].iov_base = (char *)data;
+	row.body[1].iov_len = size;
+
+	return xstream_write(stream, &row);
+}
+
+/** Send a space to the replica, row by row. */
+static int
+memtx_join_send_entry(struct memtx_join_ctx *ctx,
+		      struct memtx_join_entry *entry)
+{
+	struct snapshot_iterator *it = entry->iterator;
+	int rc;
+	uint32_t size;
+	const char *data;
+	while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
+		if (memtx_join_send_tuple(ctx->stream, entry->space_id,
+					  data, size) != 0)
+			return -1;
+	}
+	return rc;
+}
+
+/**
+ * Pick the next space to be read by a worker thread. Returns
+ * NULL if there are no more spaces or the join failed.
+ */
+static struct memtx_join_entry *
+memtx_join_next_entry(struct memtx_join_ctx *ctx)
+{
+	struct memtx_join_entry *entry = NULL;
+	tt_pthread_mutex_lock(&ctx->mutex);
+	if (!ctx->is_failed && ctx->next_entry != &ctx->entries) {
+		entry = rlist_entry(ctx->next_entry,
+				    struct memtx_join_entry, in_ctx);
+		ctx->next_entry = ctx->next_entry->next;
+	}
+	tt_pthread_mutex_unlock(&ctx->mutex);
+	return entry;
+}
+
+/**
+ * Queue a batch to be sent by the join thread, waiting if the
+ * queue is full. Returns -1 and frees the batch if the join
+ * failed.
+ */
+static int
+memtx_join_push_batch(struct memtx_join_ctx *ctx,
+		      struct memtx_join_batch *batch)
+{
+	tt_pthread_mutex_lock(&ctx->mutex);
+	while (!ctx->is_failed &&
+	       ctx->queue_len >= ctx->threads * MEMTX_JOIN_QUEUE_DEPTH)
+		tt_pthread_cond_wait(&ctx->cond, &ctx->mutex);
+	bool is_failed = ctx->is_failed;
+	if (!is_failed) {
+		stailq_add_tail_entry(&ctx->queue, batch, in_queue);
+		ctx->queue_len++;
+		tt_pthread_cond_broadcast(&ctx->cond);
+	}
+	tt_pthread_mutex_unlock(&ctx->mutex);
+	if (is_failed)
+		free(batch);
+	return is_failed ? -1 : 0;
+}
+
+static struct memtx_join_batch *
+memtx_join_batch_new(uint32_t space_id, size_t capacity)
+{
+	struct memtx_join_batch *batch = malloc(sizeof(*batch) + capacity);
+	if (batch == NULL) {
+		diag_set(OutOfMemory, sizeof(*batch) + capacity,
+			 "malloc", "struct memtx_join_batch");
+		return NULL;
+	}
+	batch->space_id = space_id;
+	batch->size = 0;
+	batch->capacity = capacity;
+	return batch;
+}
+
+/**
+ * Read a space into batches and queue them. The rows are copied
+ * so that the join thread doesn't depend on the lifetime of
+ * the data returned by the snapshot iterator.
+ */
+static int
+memtx_join_read_entry(struct memtx_join_ctx *ctx,
+		      struct memtx_join_entry *entry)
+{
+	struct snapshot_iterator *it = entry->iterator;
+	struct memtx_join_batch *batch = NULL;
+	int rc;
+	uint32_t size;
+	const char *data;
+	while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
+		size_t row_size = sizeof(size) + size;
+		if (batch != NULL && batch->size + row_size > batch->capacity) {
+			if (memtx_join_push_batch(ctx, batch) != 0)
+				return -1;
+			batch = NULL;
+		}
+		if (batch == NULL) {
+			batch = memtx_join_batch_new(entry->space_id,
+					MAX(row_size,
+					    (size_t)MEMTX_JOIN_BATCH_SIZE));
+			if (batch == NULL)
+				return -1;
+		}
+		memcpy(batch->data + batch->size, &size, sizeof(size));
+		memcpy(batch->data + batch->size + sizeof(size), data, size);
+		batch->size += row_size;
+	}
+	if (rc != 0) {
+		free(batch);
 		return -1;
 	}
-	*arg = ctx;
-	return 0;
+	if (batch != NULL)
+		return memtx_join_push_batch(ctx, batch);
+	return 0;
+}
+
+/** Fail the join, stopping the workers and the join thread. */
+static void
+memtx_join_fail(struct memtx_join_ctx *ctx)
+{
+	tt_pthread_mutex_lock(&ctx->mutex);
+	ctx->is_failed = true;
+	tt_pthread_cond_broadcast(&ctx->cond);
+	tt_pthread_mutex_unlock(&ctx->mutex);
+}
+
+/**
+ * Read spaces picked from the join list one by one until the
+ * list is exhausted. Run by every worker thread.
+ */
+static int
+memtx_join_worker_f(va_list ap)
+{
+	struct memtx_join_ctx *ctx = va_arg(ap, struct memtx_join_ctx *);
+	int rc = 0;
+	struct memtx_join_entry *entry;
+	while ((entry = memtx_join_next_entry(ctx)) != NULL) {
+		if (memtx_join_read_entry(ctx, entry) != 0) {
+			rc = -1;
+			break;
+		}
+	}
+	tt_pthread_mutex_lock(&ctx->mutex);
+	/* A failure of the join thread is reported by itself. */
+	if (rc != 0 && ctx->is_failed)
+		rc = 0;
+	else if (rc != 0)
+		ctx->is_failed = true;
+	ctx->workers_active--;
+	tt_pthread_cond_broadcast(&ctx->cond);
+	tt_pthread_mutex_unlock(&ctx->mutex);
+	return rc;
+}
+
+/**
+ * Take the next batch read by the workers. Returns NULL when
+ * all workers have finished or the join failed.
+ */
+static struct memtx_join_batch *
+memtx_join_pop_batch(struct memtx_join_ctx *ctx)
+{
+	struct memtx_join_batch *batch = NULL;
+	tt_pthread_mutex_lock(&ctx->mutex);
+	while (!ctx->is_failed && ctx->queue_len == 0 &&
+	       ctx->workers_active > 0)
+		tt_pthread_cond_wait(&ctx->cond, &ctx->mutex);
+	if (!ctx->is_failed && ctx->queue_len > 0) {
+		batch = stailq_shift_entry(&ctx->queue,
+					   struct memtx_join_batch, in_queue);
+		ctx->queue_len--;
+		tt_pthread_cond_broadcast(&ctx->cond);
+	}
+	tt_pthread_mutex_unlock(&ctx->mutex);
+	return batch;
 }
 
+/**
+ * Send user spaces read by the worker threads. Rows of different
+ * spaces are interleaved in the stream, which is fine, because
+ * the replica builds the primary keys after receiving all data.
+ */
 static int
-memtx_join_send_tuple(struct xstream *stream, uint32_t space_id,
-		      const char *data, size_t size)
+memtx_join_send_parallel(struct memtx_join_ctx *ctx)
 {
-	struct request_replace_body body;
-	request_replace_body_create(&body, space_id);
-
-	struct xrow_header row;
-	memset(&row, 0, sizeof(row));
-	row.type = IPROTO_INSERT;
-
-	row.bodycnt = 2;
-	row.body[0].iov_base = &body;
-	row.body[0].iov_len = sizeof(body);
-	row.body[1].iov_base = (char *)data;
-	row.body[1].iov_len = size;
-
-	return xstream_write(stream, &row);
+	/*
+	 * Do not let the thread be cancelled while a worker is
+	 * started and not yet accounted, otherwise the worker
+	 * would be left running.
+	 */
+	int cancel_state;
+	tt_pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel_state);
+	for (int i = 0; i < ctx->threads; i++) {
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "join%d", i + 1);
+		tt_pthread_mutex_lock(&ctx->mutex);
+		ctx->workers_active++;
+		tt_pthread_mutex_unlock(&ctx->mutex);
+		if (cord_costart(&ctx->workers[i], name,
+				 memtx_join_worker_f, ctx) != 0) {
+			tt_pthread_mutex_lock(&ctx->mutex);
+			ctx->workers_active--;
+			tt_pthread_mutex_unlock(&ctx->mutex);
+			/* Proceed with fewer threads. */
+			diag_log();
+			break;
+		}
+		ctx->workers_started++;
+	}
+	tt_pthread_setcancelstate(cancel_state, NULL);
+	int rc = 0;
+	if (ctx->workers_started == 0) {
+		/* Send the spaces from this thread then. */
+		struct memtx_join_entry *entry;
+		while (rc == 0 && (entry = memtx_join_next_entry(ctx)) != NULL)
+			rc = memtx_join_send_entry(ctx, entry);
+	}
+	struct memtx_join_batch *batch;
+	while (rc == 0 && (batch = memtx_join_pop_batch(ctx)) != NULL) {
+		const char *data = batch->data;
+		const char *data_end = batch->data + batch->size;
+		while (rc == 0 && data < data_end) {
+			uint32_t size;
+			memcpy(&size, data, sizeof(size));
+			data += sizeof(size);
+			rc = memtx_join_send_tuple(ctx->stream, batch->space_id,
+						   data, size);
+			data += size;
+		}
+		free(batch);
+	}
+	if (rc != 0)
+		memtx_join_fail(ctx);
+	while (ctx->workers_joined < ctx->workers_started) {
+		if (cord_join(&ctx->workers[ctx->workers_joined]) != 0)
+			rc = -1;
+		ctx->workers_joined++;
+	}
+	return rc;
 }
 
 static int
 memtx_join_f(va_list ap)
 {
 	struct memtx_join_ctx *ctx = va_arg(ap, struct memtx_join_ctx *);
-	struct memtx_join_entry *entry;
-	rlist_foreach_entry(entry, &ctx->entries, in_ctx) {
-		struct snapshot_iterator *it = entry->iterator;
-		int rc;
-		uint32_t size;
-		const char *data;
-		while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
-			if (memtx_join_send_tuple(ctx->stream, entry->space_id,
-						  data, size) != 0)
-				return -1;
-		}
-		if (rc != 0)
+	/*
+	 * System spaces must be applied by the replica before
+	 * user spaces, so they are sent first in this thread
+	 * alone. Spaces are sorted by id, see space_foreach().
+	 */
+	ctx->next_entry = rlist_first(&ctx->entries);
+	while (ctx->next_entry != &ctx->entries) {
+		struct memtx_join_entry *entry = rlist_entry(ctx->next_entry,
+				struct memtx_join_entry, in_ctx);
+		if (ctx->threads > 1 && entry->space_id >= BOX_SYSTEM_ID_MAX)
+			return memtx_join_send_parallel(ctx);
+		ctx->next_entry = ctx->next_entry->next;
+		if (memtx_join_send_entry(ctx, entry) != 0)
 			return -1;
 	}
 	return 0;
@@ -855,7 +1905,6 @@ memtx_join_f(va_list ap)
 static int
 memtx_engine_join(struct engine *engine, void *arg, struct xstream *stream)
 {
-	(void)engine;
 	struct memtx_join_ctx *ctx = arg;
 	ctx->stream = stream;
 	/*
@@ -863,13 +1912,12 @@ memtx_engine_join(struct engine *engine, void *arg, struct xstream *stream)
 	 * thread and so we do so as not to consume too much of
 	 * precious tx cpu time while a new replica is joining.
 	 */
-	struct cord cord;
-	if (cord_costart(&cord, "initial_join", memtx_join_f, ctx) != 0)
+	if (cord_costart(&ctx->cord, "initial_join", memtx_join_f, ctx) != 0)
 		return -1;
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	memtx->replica_join_cord = &cord;
-	int res = cord_cojoin(&cord);
-	memtx->replica_join_cord = NULL;
+	memtx->replica_join_ctx = ctx;
+	int res = cord_cojoin(&ctx->cord);
+	memtx->replica_join_ctx = NULL;
 	return res;
 }
 
@@ -877,13 +1925,27 @@ static void
 memtx_engine_complete_join(struct engine *engine, void *arg)
 {
 	(void)engine;
-	struct memtx_join_ctx *ctx = arg;
-	struct memtx_join_entry *entry, *next;
-	rlist_foreach_entry_safe(entry, &ctx->entries, in_ctx, next) {
-		entry->iterator->free(entry->iterator);
-		free(entry);
+	memtx_join_ctx_delete(arg);
+}
+
+static void
+replica_join_cancel(struct memtx_join_ctx *ctx)
+{
+	/*
+	 * Cancel the thread being used to join replica if it's
+	 * running and wait for it to terminate so as to
+	 * eliminate the possibility of use-after-free.
+	 */
+	tt_pthread_cancel(ctx->cord.id);
+	tt_pthread_join(ctx->cord.id, NULL);
+	/*
+	 * Worker threads which haven't been joined by the join
+	 * thread must be stopped as well.
+	 */
+	for (int i = ctx->workers_joined; i < ctx->workers_started; i++) {
+		tt_pthread_cancel(ctx->workers[i].id);
+		tt_pthread_join(ctx->workers[i].id, NULL);
 	}
-	free(ctx);
 }
 
 static int
@@ -955,6 +2017,20 @@ memtx_engine_run_gc(struct memtx_engine *memtx, bool *stop)
 	}
 }
 
+/**
+ * Max time the garbage collector may run without yielding, in
+ * seconds. It's only used up if there are no other fibers ready
+ * to run in the tx thread.
+ */
+static const double MEMTX_GC_STEP_TIME = 1e-3;
+
+/** Check if there's nothing but the current fiber to run in tx. */
+static inline bool
+memtx_engine_tx_is_idle(void)
+{
+	return rlist_empty(&cord()->ready) && ev_pending_count(loop()) == 0;
+}
+
 static int
 memtx_engine_gc_f(va_list va)
 {
@@ -962,24 +2038,322 @@ memtx_engine_gc_f(va_list va)
 	while (!fiber_is_cancelled()) {
 		bool stop;
 		ERROR_INJECT_YIELD(ERRINJ_MEMTX_DELAY_GC);
-		memtx_engine_run_gc(memtx, &stop);
+		/*
+		 * Each iteration frees about a thousand tuples.
+		 * Yield after each iteration if there's other work
+		 * in tx so as not to block it for too long. When tx
+		 * is idle, keep freeing for up to a step, so that a
+		 * huge dropped space is freed at full speed rather
+		 * than at the pace of event loop iterations.
+		 */
+		double deadline = ev_monotonic_time() + MEMTX_GC_STEP_TIME;
+		do {
+			memtx_engine_run_gc(memtx, &stop);
+		} while (!stop && memtx_engine_tx_is_idle() &&
+			 ev_monotonic_time() < deadline);
 		if (stop) {
 			fiber_yield_timeout(TIMEOUT_INFINITY);
 			continue;
 		}
-		/*
-		 * Yield after each iteration so as not to block
-		 * tx thread for too long.
-		 */
 		fiber_sleep(0);
 	}
 	return 0;
 }
 
+enum {
+	/** Max number of tuples moved without yielding. */
+	MEMTX_DEFRAG_BATCH_SIZE = 128,
+};
+
+/**
+ * Defragmentation starts when less than this fraction of the
+ * memory of tuple slabs is used.
+ */
+static const double MEMTX_DEFRAG_USED_RATIO = 0.9;
+
+/** How often to check if defragmentation is needed, seconds. */
+static const double MEMTX_DEFRAG_CHECK_INTERVAL = 1;
+
+/** Position of the defragmentation fiber. */
+struct memtx_defrag {
+	/** Id of the space being processed, 0 if none. */
+	uint32_t space_id;
+	/**
+	 * Primary key of the last processed tuple of the space,
+	 * the scan starts from the beginning if the size is 0.
+	 */
+	char *key;
+	uint32_t key_size;
+	uint32_t key_capacity;
+};
+
+/** Check if tuples of a space may be moved to another place. */
+static bool
+memtx_defrag_space_is_eligible(struct memtx_engine *memtx,
+			       struct space *space)
+{
+	if (space->engine != &memtx->base || space_is_system(space) ||
+	    space->format == NULL || space->format->is_compressed)
+		return false;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (space->index[i]->def->key_def->for_func_index)
+			return false;
+	}
+	return space_index(space, 0) != NULL;
+}
+
+struct memtx_defrag_next_space_arg {
+	struct memtx_engine *memtx;
+	uint32_t prev_id;
+	uint32_t next_id;
+};
+
+static int
+memtx_defrag_next_space_cb(struct space *space, void *udata)
+{
+	struct memtx_defrag_next_space_arg *arg = udata;
+	uint32_t id = space_id(space);
+	if (id > arg->prev_id && (arg->next_id == 0 || id < arg->next_id) &&
+	    memtx_defrag_space_is_eligible(arg->memtx, space))
+		arg->next_id = id;
+	return 0;
+}
+
+/**
+ * Return the id of the eligible space following the one with
+ * the given id or 0 if there's no such space.
+ */
+static uint32_t
+memtx_defrag_next_space(struct memtx_engine *memtx, uint32_t prev_id)
+{
+	struct memtx_defrag_next_space_arg arg = {memtx, prev_id, 0};
+	if (space_foreach(memtx_defrag_next_space_cb, &arg) != 0) {
+		diag_log();
+		return 0;
+	}
+	return arg.next_id;
+}
+
+/**
+ * Check if the tuple allocator is fragmented enough to move
+ * tuples around.
+ */
+static bool
+memtx_defrag_is_needed(struct memtx_engine *memtx)
+{
+	if (memtx->defrag_budget == 0 || memtx->state != MEMTX_OK ||
+	    memtx_tx_manager_use_mvcc_engine)
+		return false;
+	struct small_stats stats;
+	small_stats(&memtx->alloc, &stats, small_stats_noop_cb, NULL);
+	return stats.used < stats.total * MEMTX_DEFRAG_USED_RATIO;
+}
+
+/**
+ * Move a tuple referenced only by the space to a new place if
+ * the allocator gives a lower address for it. Objects of a slab
+ * class are allocated from the lowest hot slab, so this drains
+ * sparse slabs at the end of the class, which are returned to
+ * the arena once empty.
+ */
+static void
+memtx_defrag_relocate(struct memtx_engine *memtx, struct space *space,
+		      struct tuple *old_tuple)
+{
+	struct tuple_format *format = space->format;
+	if (old_tuple->refs != 1 || tuple_format(old_tuple) != format ||
+	    memtx_tuple_is_in_snapshot(memtx, format, old_tuple))
+		return;
+	if (memtx_index_extent_reserve(memtx,
+				       RESERVE_EXTENTS_BEFORE_REPLACE) != 0) {
+		diag_clear(diag_get());
+		return;
+	}
+	struct memtx_tuple *old_memtx_tuple =
+		container_of(old_tuple, struct memtx_tuple, base);
+	size_t total = memtx_tuple_alloc_size(old_tuple);
+	struct memtx_tuple *memtx_tuple = smalloc(&memtx->alloc, total);
+	if (memtx_tuple == NULL)
+		return;
+	if (memtx_tuple > old_memtx_tuple) {
+		smfree(&memtx->alloc, memtx_tuple, total);
+		return;
+	}
+	memcpy(memtx_tuple, old_memtx_tuple, total);
+	struct tuple *new_tuple = &memtx_tuple->base;
+	new_tuple->refs = 0;
+	memtx_tuple->version = memtx->snapshot_version;
+	tuple_format_ref(format);
+
+	uint32_t i;
+	for (i = 0; i < space->index_count; i++) {
+		if (index_replace_unchanged(space->index[i], old_tuple,
+					    new_tuple) != 0)
+			goto rollback;
+	}
+	tuple_ref(new_tuple);
+	tuple_unref(old_tuple);
+	memtx->defrag_relocated++;
+	return;
+rollback:
+	diag_log();
+	for (; i > 0; i--) {
+		/* Rollback must not fail. */
+		if (index_replace_unchanged(space->index[i - 1], new_tuple,
+					    old_tuple) != 0) {
+			diag_log();
+			unreachable();
+			panic("failed to rollback change");
+		}
+	}
+	tuple_delete(new_tuple);
+}
+
+/**
+ * Move the next batch of tuples of a space. Return true if
+ * the end of the space is reached.
+ */
+static bool
+memtx_defrag_space(struct memtx_engine *memtx, struct memtx_defrag *defrag,
+		   struct space *space)
+{
+	struct index *pk = space_index(space, 0);
+	struct key_def *key_def = pk->def->key_def;
+	/*
+	 * The saved key is an array of key parts as extracted
+	 * from a tuple. The primary key could have been altered
+	 * while the fiber was sleeping, so restart the scan if
+	 * the key doesn't fit it anymore.
+	 */
+	const char *key = defrag->key;
+	if (defrag->key_size > 0 &&
+	    (mp_decode_array(&key) != key_def->part_count ||
+	     key_validate(pk->def, ITER_GT, key, key_def->part_count) != 0)) {
+		diag_clear(diag_get());
+		defrag->key_size = 0;
+	}
+	struct iterator *it;
+	if (defrag->key_size == 0) {
+		it = index_create_iterator(pk, ITER_ALL, NULL, 0);
+	} else {
+		it = index_create_iterator(pk, ITER_GT, key,
+					   key_def->part_count);
+	}
+	if (it == NULL) {
+		diag_log();
+		return true;
+	}
+	/*
+	 * The scan doesn't yield, so the tuples of the batch
+	 * stay in the space until they are moved.
+	 */
+	struct tuple *batch[MEMTX_DEFRAG_BATCH_SIZE];
+	int count = 0;
+	struct tuple *tuple;
+	while (count < MEMTX_DEFRAG_BATCH_SIZE) {
+		if (iterator_next(it, &tuple) != 0) {
+			diag_log();
+			break;
+		}
+		if (tuple == NULL)
+			break;
+		batch[count++] = tuple;
+	}
+	iterator_delete(it);
+	if (count == 0)
+		return true;
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t key_size;
+	const char *last_key = tuple_extract_key(batch[count - 1], key_def,
+						 MULTIKEY_NONE, &key_size);
+	if (last_key == NULL) {
+		diag_log();
+		region_truncate(region, region_svp);
+		return true;
+	}
+	if (key_size > defrag->key_capacity) {
+		char *buf = realloc(defrag->key, key_size);
+		if (buf == NULL) {
+			region_truncate(region, region_svp);
+			return true;
+		}
+		defrag->key = buf;
+		defrag->key_capacity = key_size;
+	}
+	memcpy(defrag->key, last_key, key_size);
+	defrag->key_size = key_size;
+	region_truncate(region, region_svp);
+
+	for (int i = 0; i < count; i++)
+		memtx_defrag_relocate(memtx, space, batch[i]);
+	return count < MEMTX_DEFRAG_BATCH_SIZE;
+}
+
+/**
+ * Run one step of defragmentation. Return true when all spaces
+ * have been processed.
+ */
+static bool
+memtx_defrag_step(struct memtx_engine *memtx, struct memtx_defrag *defrag)
+{
+	struct space *space = space_by_id(defrag->space_id);
+	if (space != NULL && memtx_defrag_space_is_eligible(memtx, space) &&
+	    !memtx_defrag_space(memtx, defrag, space))
+		return false;
+	defrag->space_id = memtx_defrag_next_space(memtx, defrag->space_id);
+	defrag->key_size = 0;
+	return defrag->space_id == 0;
+}
+
+static int
+memtx_engine_defrag_f(va_list va)
+{
+	struct memtx_engine *memtx = va_arg(va, struct memtx_engine *);
+	struct memtx_defrag defrag;
+	memset(&defrag, 0, sizeof(defrag));
+	while (!fiber_is_cancelled()) {
+		if (!memtx_defrag_is_needed(memtx)) {
+			fiber_sleep(MEMTX_DEFRAG_CHECK_INTERVAL);
+			continue;
+		}
+		uint64_t relocated = memtx->defrag_relocated;
+		while (memtx->defrag_budget > 0 && !fiber_is_cancelled() &&
+		       memtx->state == MEMTX_OK &&
+		       !memtx_tx_manager_use_mvcc_engine) {
+			double start = clock_monotonic();
+			bool done = memtx_defrag_step(memtx, &defrag);
+			/*
+			 * Sleep so that the fiber takes no more
+			 * than the budget of the tx thread time.
+			 */
+			double budget = memtx->defrag_budget;
+			double elapsed = clock_monotonic() - start;
+			fiber_sleep(budget > 0 ?
+				    elapsed * (1 - budget) / budget : 0);
+			if (done)
+				break;
+		}
+		defrag.space_id = 0;
+		defrag.key_size = 0;
+		if (memtx->defrag_relocated != relocated) {
+			say_verbose("memtx defragmentation moved %llu tuples",
+				    (unsigned long long)
+				    (memtx->defrag_relocated - relocated));
+		}
+		fiber_sleep(MEMTX_DEFRAG_CHECK_INTERVAL);
+	}
+	free(defrag.key);
+	return 0;
+}
+
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 bool dontdump, float alloc_factor)
+		 bool dontdump, float alloc_factor,
+		 enum numa_policy numa_policy, bool use_hugepages,
+		 const char *heap_dir)
 {
 	struct memtx_engine *memtx = calloc(1, sizeof(*memtx));
 	if (memtx == NULL) {
@@ -1022,10 +2396,21 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		gc_add_checkpoint(vclock);
 	}
 
+	if (memtx_tx_manager_init() != 0)
+		goto fail;
+	if (tuple_compression_init() != 0)
+		goto fail;
+
 	stailq_create(&memtx->gc_queue);
 	memtx->gc_fiber = fiber_new("memtx.gc", memtx_engine_gc_f);
 	if (memtx->gc_fiber == NULL)
 		goto fail;
+	memtx->defrag_fiber = fiber_new("memtx.defrag", memtx_engine_defrag_f);
+	if (memtx->defrag_fiber == NULL)
+		goto fail;
+	memtx->expire = memtx_expire_new();
+	if (memtx->expire == NULL)
+		goto fail;
 
 	/* Apply lowest allowed objsize bound. */
 	if (objsize_min < OBJSIZE_MIN)
@@ -1035,6 +2420,58 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 	quota_init(&memtx->quota, tuple_arena_max_size);
 	tuple_arena_create(&memtx->arena, &memtx->quota, tuple_arena_max_size,
 			   SLAB_SIZE, dontdump, "memtx");
+	/*
+	 * Huge pages cut TLB misses of tuple and index lookups
+	 * in big arenas. Explicit huge pages replace the arena
+	 * mapping, so this must be done before the NUMA policy
+	 * is set and anything is allocated.
+	 */
+	/*
+	 * A heap file lets the kernel move tuples and index
+	 * extents that haven't been accessed for a while out of
+	 * RAM, so the arena may be larger than the memory. Pages
+	 * of a file mapping can't be huge.
+	 */
+	if (heap_dir != NULL) {
+		if (heap_file_back(memtx->arena.arena, memtx->arena.prealloc,
+				   heap_dir, dontdump) != 0) {
+			tuple_arena_destroy(&memtx->arena);
+			goto fail;
+		}
+		say_info("memtx arena is backed by a heap file in '%s'",
+			 heap_dir);
+		if (use_hugepages)
+			say_warn("huge pages are not used with a heap file");
+		use_hugepages = false;
+	}
+	memtx->hugepages = HUGEPAGES_NONE;
+	if (use_hugepages) {
+		memtx->hugepages = hugepages_back(memtx->arena.arena,
+						  memtx->arena.prealloc,
+						  dontdump);
+		if (memtx->hugepages == HUGEPAGES_NONE) {
+			diag_log();
+			say_warn("huge pages are not used for memtx arena");
+		} else {
+			say_info("memtx arena is backed by %s huge pages",
+				 hugepages_mode_strs[memtx->hugepages]);
+		}
+	}
+	/*
+	 * Memory is placed when it's touched for the first time,
+	 * so the policy must be set before anything is allocated.
+	 * Slabs mapped beyond the preallocated area, after
+	 * memtx_memory is increased, use the default policy.
+	 */
+	memtx->numa_policy = numa_policy;
+	memtx->numa_node = numa_current_node();
+	if (numa_set_memory_policy(memtx->arena.arena, memtx->arena.prealloc,
+				   numa_policy) != 0) {
+		diag_log();
+		say_warn("NUMA policy '%s' is not applied to memtx arena",
+			 numa_policy_strs[numa_policy]);
+		memtx->numa_policy = NUMA_POLICY_DEFAULT;
+	}
 	slab_cache_create(&memtx->slab_cache, &memtx->arena);
 	small_alloc_create(&memtx->alloc, &memtx->slab_cache,
 			   objsize_min, alloc_factor);
@@ -1051,15 +2488,25 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 	memtx->state = MEMTX_INITIALIZED;
 	memtx->max_tuple_size = MAX_TUPLE_SIZE;
 	memtx->force_recovery = force_recovery;
+	memtx->snapshot_threads = 1;
+	vclock_clear(&memtx->snap_base_vclock);
+	memtx->checkpoint_gen = 1;
+	memtx->full_checkpoint_gen = 0;
+	memtx->update_in_place = false;
 
-	memtx->replica_join_cord = NULL;
+	memtx->replica_join_ctx = NULL;
 
 	memtx->base.vtab = &memtx_engine_vtab;
 	memtx->base.name = "memtx";
 
 	fiber_start(memtx->gc_fiber, memtx);
+	fiber_start(memtx->defrag_fiber, memtx);
 	return memtx;
 fail:
+	if (memtx->expire != NULL)
+		memtx_expire_delete(memtx->expire);
+	memtx_tx_manager_free();
+	tuple_compression_free();
 	xdir_destroy(&memtx->snap_dir);
 	free(memtx);
 	return NULL;
@@ -1079,6 +2526,49 @@ memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit)
 	memtx->snap_io_rate_limit = limit * 1024 * 1024;
 }
 
+void
+memtx_engine_set_snap_dict(struct memtx_engine *memtx, struct xlog_dict *dict)
+{
+	memtx->snap_dict = dict;
+}
+
+void
+memtx_engine_set_snapshot_threads(struct memtx_engine *memtx, int threads)
+{
+	assert(threads > 0);
+	memtx->snapshot_threads = threads;
+}
+
+void
+memtx_engine_set_checkpoint_delta_ratio(struct memtx_engine *memtx,
+					double ratio)
+{
+	assert(ratio >= 0 && ratio <= 1);
+	memtx->checkpoint_delta_ratio = ratio;
+}
+
+void
+memtx_engine_set_defrag_budget(struct memtx_engine *memtx, double budget)
+{
+	assert(budget >= 0 && budget <= 1);
+	memtx->defrag_budget = budget;
+	if (budget > 0)
+		fiber_wakeup(memtx->defrag_fiber);
+}
+
+void
+memtx_engine_set_update_in_place(struct memtx_engine *memtx, bool value)
+{
+	memtx->update_in_place = value;
+}
+
+void
+memtx_engine_set_expire_rate(struct memtx_engine *memtx, double rate)
+{
+	assert(rate >= 0);
+	memtx_expire_set_rate(memtx->expire, rate);
+}
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size)
 {
@@ -1097,22 +2587,72 @@ memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size)
 	memtx->max_tuple_size = max_size;
 }
 
-void
-memtx_enter_delayed_free_mode(struct memtx_engine *memtx)
+struct tuple_format *
+memtx_enter_delayed_free_mode(struct memtx_engine *memtx,
+			      struct index *index)
 {
 	memtx->snapshot_version++;
 	if (memtx->delayed_free_mode++ == 0)
 		small_alloc_setopt(&memtx->alloc, SMALL_DELAYED_FREE_MODE, true);
+	/*
+	 * The index may be not in the space cache yet or already
+	 * moved to a new space by alter, in which case it may
+	 * store tuples of any format.
+	 */
+	struct space *space = space_by_id(index->def->space_id);
+	if (space == NULL || space_index(space, index->def->iid) != index ||
+	    !space->format->is_snapshot_tracked) {
+		memtx->untracked_snapshot_iterators++;
+		return NULL;
+	}
+	struct tuple_format *format = space->format;
+	tuple_format_ref(format);
+	format->snapshot_iterator_count++;
+	return format;
 }
 
 void
-memtx_leave_delayed_free_mode(struct memtx_engine *memtx)
+memtx_leave_delayed_free_mode(struct memtx_engine *memtx,
+			      struct tuple_format *format)
 {
+	if (format != NULL) {
+		assert(format->snapshot_iterator_count > 0);
+		format->snapshot_iterator_count--;
+		tuple_format_unref(format);
+	} else {
+		assert(memtx->untracked_snapshot_iterators > 0);
+		memtx->untracked_snapshot_iterators--;
+	}
 	assert(memtx->delayed_free_mode > 0);
 	if (--memtx->delayed_free_mode == 0)
 		small_alloc_setopt(&memtx->alloc, SMALL_DELAYED_FREE_MODE, false);
 }
 
+/**
+ * Check if a tuple of the given format allocated before the last
+ * snapshot may be seen by an open snapshot iterator.
+ */
+static inline bool
+memtx_tuple_format_is_in_snapshot(struct memtx_engine *memtx,
+				  struct tuple_format *format)
+{
+	return !format->is_snapshot_tracked ||
+	       memtx->untracked_snapshot_iterators > 0 ||
+	       format->snapshot_iterator_count > 0;
+}
+
+bool
+memtx_tuple_is_in_snapshot(struct memtx_engine *memtx,
+			   struct tuple_format *format, struct tuple *tuple)
+{
+	struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	return memtx->alloc.free_mode == SMALL_DELAYED_FREE &&
+	       memtx_tuple->version != memtx->snapshot_version &&
+	       !format->is_temporary &&
+	       memtx_tuple_format_is_in_snapshot(memtx, format);
+}
+
 struct tuple *
 memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 {
@@ -1121,6 +2661,9 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	struct tuple *tuple = NULL;
 	struct region *region = &fiber()->gc;
 	size_t region_svp = region_used(region);
+	if (format->is_compressed &&
+	    tuple_compress(format, &data, &end) != 0)
+		goto end;
 	struct field_map_builder builder;
 	if (tuple_field_map_create(format, data, true, &builder) != 0)
 		goto end;
@@ -1180,6 +2723,12 @@ end:
 	return tuple;
 }
 
+size_t
+memtx_tuple_alloc_size(struct tuple *tuple)
+{
+	return tuple_size(tuple) + offsetof(struct memtx_tuple, base);
+}
+
 void
 memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 {
@@ -1188,10 +2737,8 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 	assert(tuple->refs == 0);
 	struct memtx_tuple *memtx_tuple =
 		container_of(tuple, struct memtx_tuple, base);
-	size_t total = tuple_size(tuple) + offsetof(struct memtx_tuple, base);
-	if (memtx->alloc.free_mode != SMALL_DELAYED_FREE ||
-	    memtx_tuple->version == memtx->snapshot_version ||
-	    format->is_temporary)
+	size_t total = memtx_tuple_alloc_size(tuple);
+	if (!memtx_tuple_is_in_snapshot(memtx, format, tuple))
 		smfree(&memtx->alloc, memtx_tuple, total);
 	else
 		smfree_delayed(&memtx->alloc, memtx_tuple, total);
@@ -1325,6 +2872,10 @@ memtx_index_def_change_requires_rebuild(struct index *index,
 		return true;
 	if (old_def->opts.func_id != new_def->opts.func_id)
 		return true;
+	if (old_def->opts.hash_type != new_def->opts.hash_type)
+		return true;
+	if (old_def->opts.count_keys != new_def->opts.count_keys)
+		return true;
 
 	const struct key_def *old_cmp_def, *new_cmp_def;
 	if (index_depends_on_pk(index)) {
@@ -1342,6 +2893,9 @@ memtx_index_def_change_requires_rebuild(struct index *index,
 	 */
 	if (old_cmp_def->part_count != new_cmp_def->part_count)
 		return true;
+	/* Hints are built differently, see key_def::hint_part_count. */
+	if (old_cmp_def->hint_part_count != new_cmp_def->hint_part_count)
+		return true;
 
 	for (uint32_t i = 0; i < new_cmp_def->part_count; i++) {
 		const struct key_part *old_part = &old_cmp_def->parts[i];
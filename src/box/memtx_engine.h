@@ -40,6 +40,9 @@
 #include "engine.h"
 #include "xlog.h"
 #include "salad/stailq.h"
+#include "numa.h"
+#include "hugepages.h"
+#include "heap_file.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -49,6 +52,8 @@ struct index;
 struct fiber;
 struct tuple;
 struct tuple_format;
+struct memtx_join_ctx;
+struct memtx_expire;
 
 /**
  * The state of memtx recovery process.
@@ -117,13 +122,60 @@ struct memtx_engine {
 	struct xdir snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t snap_io_rate_limit;
+	/**
+	 * Number of threads used to write a snapshot or to read
+	 * spaces sent to a joining replica. Takes effect on the
+	 * next checkpoint or join.
+	 */
+	int snapshot_threads;
+	/**
+	 * Dictionary used for compression of snapshots or NULL.
+	 * Takes effect on the next checkpoint.
+	 */
+	struct xlog_dict *snap_dict;
+	/**
+	 * A delta snapshot, which stores only the spaces changed
+	 * since the last full snapshot, is written instead of
+	 * a full one if the changed spaces take no more than this
+	 * fraction of the memory used by all spaces. Set to 0 if
+	 * only full snapshots are written.
+	 */
+	double checkpoint_delta_ratio;
+	/**
+	 * Vclock of the last full snapshot, which delta snapshots
+	 * are based on. Not set if unknown, e.g. before the first
+	 * snapshot is written by a bootstrapped instance.
+	 */
+	struct vclock snap_base_vclock;
+	/**
+	 * Checkpoint generation. Incremented with each checkpoint
+	 * and stored in a space on each change, see
+	 * memtx_space::checkpoint_gen. Zero while a snapshot is
+	 * being loaded, so that loaded spaces don't look changed.
+	 */
+	int64_t checkpoint_gen;
+	/** Generation of the last full snapshot. */
+	int64_t full_checkpoint_gen;
+	/**
+	 * Fraction of the tx thread time the defragmentation
+	 * fiber may take, 0 if defragmentation is disabled.
+	 */
+	double defrag_budget;
+	/** Number of tuples moved by the defragmentation fiber. */
+	uint64_t defrag_relocated;
+	/**
+	 * Apply updates which don't change the tuple size and
+	 * indexed fields right in the old tuple, see
+	 * memtx_space_execute_update().
+	 */
+	bool update_in_place;
 	/** Skip invalid snapshot records if this flag is set. */
 	bool force_recovery;
 	/**
-	 * Cord being currently used to join replica. It is only
-	 * needed to be able to cancel it on shutdown.
+	 * Replica join in progress. It is only needed to be
+	 * able to cancel the threads sending it on shutdown.
 	 */
-	struct cord *replica_join_cord;
+	struct memtx_join_ctx *replica_join_ctx;
 	/** Common quota for tuples and indexes. */
 	struct quota quota;
 	/**
@@ -133,6 +185,19 @@ struct memtx_engine {
 	 * is reflected in box.slab.info(), @sa lua/slab.c.
 	 */
 	struct slab_arena arena;
+	/**
+	 * NUMA placement policy of the preallocated part of
+	 * the arena, NUMA_POLICY_DEFAULT if the configured
+	 * policy could not be applied.
+	 */
+	enum numa_policy numa_policy;
+	/** NUMA node preferred by NUMA_POLICY_LOCAL. */
+	int numa_node;
+	/**
+	 * Kind of huge pages backing the preallocated part of
+	 * the arena, tuples and index extents alike.
+	 */
+	enum hugepages_mode hugepages;
 	/** Slab cache for allocating tuples. */
 	struct slab_cache slab_cache;
 	/** Tuple allocator. */
@@ -160,6 +225,14 @@ struct memtx_engine {
 	 * memtx_leave_delayed_free_mode() is called.
 	 */
 	uint32_t delayed_free_mode;
+	/**
+	 * Number of open snapshot iterators which may see tuples
+	 * of any format, because the format of the space they were
+	 * created for is not tracked. While it's positive, tuples
+	 * allocated before the last snapshot are never freed in
+	 * the delayed free mode, see tuple_format::is_snapshot_tracked.
+	 */
+	uint32_t untracked_snapshot_iterators;
 	/** Memory pool for rtree index iterator. */
 	struct mempool rtree_iterator_pool;
 	/**
@@ -178,6 +251,17 @@ struct memtx_engine {
 	 * memtx_gc_task::link.
 	 */
 	struct stailq gc_queue;
+	/**
+	 * Defragmentation fiber. Moves tuples out of sparsely
+	 * used slabs so that they can be returned to the arena,
+	 * see memtx_defrag_budget.
+	 */
+	struct fiber *defrag_fiber;
+	/**
+	 * Expiration of tuples of spaces with expire_field set,
+	 * see memtx_expire_rate.
+	 */
+	struct memtx_expire *expire;
 };
 
 struct memtx_gc_task;
@@ -213,7 +297,8 @@ struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size,
 		 uint32_t objsize_min, bool dontdump,
-		 float alloc_factor);
+		 float alloc_factor, enum numa_policy numa_policy,
+		 bool use_hugepages, const char *heap_dir);
 
 int
 memtx_engine_recover_snapshot(struct memtx_engine *memtx,
@@ -222,6 +307,25 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 void
 memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit);
 
+void
+memtx_engine_set_snapshot_threads(struct memtx_engine *memtx, int threads);
+
+void
+memtx_engine_set_checkpoint_delta_ratio(struct memtx_engine *memtx,
+					double ratio);
+
+void
+memtx_engine_set_defrag_budget(struct memtx_engine *memtx, double budget);
+
+void
+memtx_engine_set_update_in_place(struct memtx_engine *memtx, bool value);
+
+void
+memtx_engine_set_expire_rate(struct memtx_engine *memtx, double rate);
+
+void
+memtx_engine_set_snap_dict(struct memtx_engine *memtx, struct xlog_dict *dict);
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size);
 
@@ -229,21 +333,37 @@ void
 memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size);
 
 /**
- * Enter tuple delayed free mode: tuple allocated before the call
- * won't be freed until memtx_leave_delayed_free_mode() is called.
+ * Enter tuple delayed free mode on behalf of a snapshot iterator
+ * over the given index: tuple allocated before the call won't be
+ * freed until memtx_leave_delayed_free_mode() is called, unless
+ * it belongs to a space no snapshot iterator is open for.
  * This function is reentrant, meaning it's okay to call it multiple
  * times from the same or different fibers - one just has to leave
  * the delayed free mode the same amount of times then.
+ *
+ * Returns the referenced format of the index space or NULL if
+ * the tuples of the index may be of another format. The return
+ * value must be passed to memtx_leave_delayed_free_mode().
  */
-void
-memtx_enter_delayed_free_mode(struct memtx_engine *memtx);
+struct tuple_format *
+memtx_enter_delayed_free_mode(struct memtx_engine *memtx,
+			      struct index *index);
 
 /**
  * Leave tuple delayed free mode. This function undoes the effect
  * of memtx_enter_delayed_free_mode().
  */
 void
-memtx_leave_delayed_free_mode(struct memtx_engine *memtx);
+memtx_leave_delayed_free_mode(struct memtx_engine *memtx,
+			      struct tuple_format *format);
+
+/**
+ * Check if a tuple may be seen by an open snapshot iterator, i.e.
+ * the tuple data must stay intact until the iterator is closed.
+ */
+bool
+memtx_tuple_is_in_snapshot(struct memtx_engine *memtx,
+			   struct tuple_format *format, struct tuple *tuple);
 
 /** Allocate a memtx tuple. @sa tuple_new(). */
 struct tuple *
@@ -253,6 +373,10 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end);
 void
 memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple);
 
+/** Return the size of memory allocated for a memtx tuple. */
+size_t
+memtx_tuple_alloc_size(struct tuple *tuple);
+
 /** Tuple format vtab for memtx engine. */
 extern struct tuple_format_vtab memtx_tuple_format_vtab;
 
@@ -299,13 +423,15 @@ static inline struct memtx_engine *
 memtx_engine_new_xc(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
 		    uint32_t objsize_min, bool dontdump,
-		    float alloc_factor)
+		    float alloc_factor, enum numa_policy numa_policy,
+		    bool use_hugepages, const char *heap_dir)
 {
 	struct memtx_engine *memtx;
 	memtx = memtx_engine_new(snap_dirname, force_recovery,
 				 tuple_arena_max_size,
 				 objsize_min, dontdump,
-				 alloc_factor);
+				 alloc_factor, numa_policy, use_hugepages,
+				 heap_dir);
 	if (memtx == NULL)
 		diag_raise();
 	return memtx;
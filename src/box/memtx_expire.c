@@ -0,0 +1,383 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_expire.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <small/stailq.h>
+
+#include "diag.h"
+#include "fiber.h"
+#include "fiber_cond.h"
+#include "say.h"
+#include "trivia/util.h"
+#include "box.h"
+#include "index.h"
+#include "msgpuck.h"
+#include "schema.h"
+#include "session.h"
+#include "space.h"
+#include "tuple.h"
+#include "txn.h"
+
+enum {
+	/** Max number of tuples deleted in one transaction. */
+	MEMTX_EXPIRE_BATCH_MAX = 100,
+	/** Max number of keys popped from the heap in one batch. */
+	MEMTX_EXPIRE_SCAN_MAX = 1000,
+};
+
+/**
+ * How often to check if the instance became writable or if
+ * expiration was enabled, in seconds.
+ */
+static const double MEMTX_EXPIRE_CHECK_INTERVAL = 1;
+
+/** A key of a tuple to delete when its expiration time comes. */
+struct memtx_expire_node {
+	/** Expiration time of the tuple when it was inserted. */
+	double time;
+	/** Id of the space the tuple belongs to. */
+	uint32_t space_id;
+	/** Link in the expiration heap. */
+	struct heap_node in_heap;
+	/** Link in memtx_expire::deferred. */
+	struct stailq_entry in_deferred;
+	/** Primary key of the tuple, a MsgPack array. */
+	char key[0];
+};
+
+#define HEAP_NAME memtx_expire_heap
+#define HEAP_LESS(h, l, r) ((l)->time < (r)->time)
+#define heap_value_t struct memtx_expire_node
+#define heap_value_attr in_heap
+
+#include "salad/heap.h"
+
+struct memtx_expire {
+	/** Keys of tracked tuples ordered by expiration time. */
+	heap_t heap;
+	/**
+	 * Keys of expired tuples popped from the heap while the
+	 * instance is read only. Returned to the heap when the
+	 * instance becomes writable, unless the master deletes
+	 * the tuples first.
+	 */
+	struct stailq deferred;
+	/** Fiber deleting expired tuples. */
+	struct fiber *fiber;
+	/** Signaled when the earliest expiration time changes. */
+	struct fiber_cond cond;
+	/** Max number of tuples deleted per second. */
+	double rate;
+};
+
+struct memtx_expire *
+memtx_expire_new(void)
+{
+	struct memtx_expire *expire = calloc(1, sizeof(*expire));
+	if (expire == NULL) {
+		diag_set(OutOfMemory, sizeof(*expire), "malloc",
+			 "struct memtx_expire");
+		return NULL;
+	}
+	memtx_expire_heap_create(&expire->heap);
+	stailq_create(&expire->deferred);
+	fiber_cond_create(&expire->cond);
+	return expire;
+}
+
+void
+memtx_expire_delete(struct memtx_expire *expire)
+{
+	/*
+	 * Sic: the fiber isn't stopped, it is freed along with
+	 * the tx cord and may still wait on the condition.
+	 */
+	struct memtx_expire_node *node, *next;
+	while ((node = memtx_expire_heap_pop(&expire->heap)) != NULL)
+		free(node);
+	stailq_foreach_entry_safe(node, next, &expire->deferred, in_deferred)
+		free(node);
+	memtx_expire_heap_destroy(&expire->heap);
+	free(expire);
+}
+
+void
+memtx_expire_set_rate(struct memtx_expire *expire, double rate)
+{
+	expire->rate = rate;
+	fiber_cond_signal(&expire->cond);
+}
+
+/**
+ * Get the expiration time of a tuple. Returns false if the
+ * tuple never expires.
+ */
+static bool
+memtx_expire_tuple_time(struct space *space, struct tuple *tuple,
+			double *time)
+{
+	const char *field = tuple_field(tuple, space->def->opts.expire_field);
+	return field != NULL && mp_read_double(&field, time) == 0;
+}
+
+int
+memtx_expire_track(struct memtx_expire *expire, struct space *space,
+		   struct tuple *tuple)
+{
+	double time;
+	if (!memtx_expire_tuple_time(space, tuple, &time))
+		return 0;
+	struct index *pk = space_index(space, 0);
+	if (pk == NULL)
+		return 0;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t key_size;
+	const char *key = tuple_extract_key(tuple, pk->def->key_def,
+					    MULTIKEY_NONE, &key_size);
+	if (key == NULL)
+		return -1;
+	struct memtx_expire_node *node = malloc(sizeof(*node) + key_size);
+	if (node == NULL) {
+		region_truncate(region, region_svp);
+		diag_set(OutOfMemory, sizeof(*node) + key_size, "malloc",
+			 "struct memtx_expire_node");
+		return -1;
+	}
+	node->time = time;
+	node->space_id = space_id(space);
+	memcpy(node->key, key, key_size);
+	region_truncate(region, region_svp);
+	if (memtx_expire_heap_insert(&expire->heap, node) != 0) {
+		free(node);
+		diag_set(OutOfMemory, sizeof(struct heap_node *), "realloc",
+			 "expiration heap");
+		return -1;
+	}
+	if (memtx_expire_heap_top(&expire->heap) == node)
+		fiber_cond_signal(&expire->cond);
+	return 0;
+}
+
+/**
+ * Look up the tuple of a key popped from the heap. @a result
+ * is set to NULL if the tuple was deleted or its expiration
+ * time was changed, in which case the key is stale: a new key
+ * was added to the heap on update.
+ */
+static int
+memtx_expire_lookup(struct memtx_expire_node *node, double now,
+		    struct tuple **result)
+{
+	*result = NULL;
+	struct space *space = space_by_id(node->space_id);
+	if (space == NULL || space->def->opts.expire_field == UINT32_MAX)
+		return 0;
+	struct index *pk = space_index(space, 0);
+	if (pk == NULL)
+		return 0;
+	const char *key = node->key;
+	uint32_t part_count = mp_decode_array(&key);
+	if (exact_key_validate(pk->def->key_def, key, part_count) != 0) {
+		/* The primary key was altered. */
+		diag_clear(diag_get());
+		return 0;
+	}
+	struct tuple *tuple;
+	if (index_get(pk, key, part_count, &tuple) != 0)
+		return -1;
+	double time;
+	if (tuple != NULL && memtx_expire_tuple_time(space, tuple, &time) &&
+	    time <= now)
+		*result = tuple;
+	return 0;
+}
+
+/** Return keys popped from the heap to it, freeing them on error. */
+static void
+memtx_expire_restore(struct memtx_expire *expire,
+		     struct memtx_expire_node **nodes, int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (memtx_expire_heap_insert(&expire->heap, nodes[i]) != 0) {
+			say_warn("failed to allocate memory for "
+				 "the expiration heap, tuple won't expire");
+			free(nodes[i]);
+		}
+	}
+}
+
+/**
+ * Delete up to @a limit expired tuples in one transaction.
+ * Returns the number of deleted tuples or -1 on error.
+ */
+static int
+memtx_expire_batch(struct memtx_expire *expire, int limit)
+{
+	assert(limit <= MEMTX_EXPIRE_BATCH_MAX);
+	struct memtx_expire_node *batch[MEMTX_EXPIRE_BATCH_MAX];
+	int count = 0;
+	double now = fiber_time();
+	if (box_txn_begin() != 0)
+		return -1;
+	for (int i = 0; i < MEMTX_EXPIRE_SCAN_MAX && count < limit; i++) {
+		struct memtx_expire_node *node =
+			memtx_expire_heap_top(&expire->heap);
+		if (node == NULL || node->time > now)
+			break;
+		memtx_expire_heap_delete(&expire->heap, node);
+		batch[count] = node;
+		struct tuple *tuple;
+		if (memtx_expire_lookup(node, now, &tuple) != 0)
+			goto fail;
+		if (tuple == NULL) {
+			free(node);
+			continue;
+		}
+		const char *key_end = node->key;
+		mp_next(&key_end);
+		if (box_delete(node->space_id, 0, node->key, key_end,
+			       NULL) != 0)
+			goto fail;
+		count++;
+	}
+	if (box_txn_commit() != 0) {
+		memtx_expire_restore(expire, batch, count);
+		return -1;
+	}
+	for (int i = 0; i < count; i++)
+		free(batch[i]);
+	return count;
+fail:
+	box_txn_rollback();
+	memtx_expire_restore(expire, batch, count + 1);
+	return -1;
+}
+
+/**
+ * Move keys of expired tuples from the heap to the deferred
+ * list while the instance is read only and drop the stale ones.
+ * Tuples are deleted by the master then.
+ */
+static void
+memtx_expire_defer(struct memtx_expire *expire)
+{
+	double now = fiber_time();
+	struct stailq deferred;
+	stailq_create(&deferred);
+	stailq_concat(&deferred, &expire->deferred);
+	struct memtx_expire_node *node, *next;
+	while ((node = memtx_expire_heap_top(&expire->heap)) != NULL &&
+	       node->time <= now) {
+		memtx_expire_heap_delete(&expire->heap, node);
+		stailq_add_tail_entry(&deferred, node, in_deferred);
+	}
+	stailq_foreach_entry_safe(node, next, &deferred, in_deferred) {
+		struct tuple *tuple = NULL;
+		if (memtx_expire_lookup(node, now, &tuple) == 0 &&
+		    tuple == NULL) {
+			free(node);
+			continue;
+		}
+		stailq_add_tail_entry(&expire->deferred, node, in_deferred);
+	}
+}
+
+/** Return deferred keys to the heap. */
+static void
+memtx_expire_undefer(struct memtx_expire *expire)
+{
+	struct memtx_expire_node *node, *next;
+	stailq_foreach_entry_safe(node, next, &expire->deferred,
+				  in_deferred) {
+		memtx_expire_restore(expire, &node, 1);
+	}
+	stailq_create(&expire->deferred);
+}
+
+static int
+memtx_expire_f(va_list ap)
+{
+	struct memtx_expire *expire = va_arg(ap, struct memtx_expire *);
+	/* Expired tuples are deleted on behalf of the system. */
+	fiber_set_user(fiber(), &admin_credentials);
+	while (!fiber_is_cancelled()) {
+		if (expire->rate == 0) {
+			fiber_cond_wait_timeout(&expire->cond,
+						MEMTX_EXPIRE_CHECK_INTERVAL);
+			continue;
+		}
+		if (box_is_ro()) {
+			memtx_expire_defer(expire);
+			fiber_cond_wait_timeout(&expire->cond,
+						MEMTX_EXPIRE_CHECK_INTERVAL);
+			continue;
+		}
+		memtx_expire_undefer(expire);
+		struct memtx_expire_node *node =
+			memtx_expire_heap_top(&expire->heap);
+		double now = fiber_time();
+		if (node == NULL || node->time > now) {
+			double timeout = MEMTX_EXPIRE_CHECK_INTERVAL;
+			if (node != NULL)
+				timeout = MIN(timeout, node->time - now);
+			fiber_cond_wait_timeout(&expire->cond, timeout);
+			continue;
+		}
+		int limit = MAX(1, MIN(MEMTX_EXPIRE_BATCH_MAX,
+				       (int)expire->rate));
+		int count = memtx_expire_batch(expire, limit);
+		if (count < 0) {
+			diag_log();
+			fiber_sleep(MEMTX_EXPIRE_CHECK_INTERVAL);
+			continue;
+		}
+		/* Don't delete more than the rate allows. */
+		fiber_sleep(count / expire->rate);
+	}
+	return 0;
+}
+
+void
+memtx_expire_start(struct memtx_expire *expire)
+{
+	if (expire->fiber != NULL)
+		return;
+	expire->fiber = fiber_new("memtx.expire", memtx_expire_f);
+	if (expire->fiber == NULL) {
+		diag_log();
+		say_error("failed to start tuple expiration");
+		return;
+	}
+	fiber_start(expire->fiber, expire);
+}
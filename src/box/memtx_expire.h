@@ -0,0 +1,96 @@
+#ifndef TARANTOOL_BOX_MEMTX_EXPIRE_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_EXPIRE_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct space;
+struct tuple;
+struct memtx_expire;
+
+/**
+ * Expiration of tuples of memtx spaces with the expire_field
+ * option set.
+ *
+ * The expire field of a tuple stores the time, in seconds since
+ * the Epoch, after which the tuple is deleted. Tuples without
+ * a numeric value in the field never expire.
+ *
+ * Every tuple inserted in such a space is added to a heap ordered
+ * by the expiration time. The heap stores primary keys rather
+ * than tuples and isn't updated when tuples are deleted, so when
+ * a key pops up, the tuple is looked up and deleted only if it is
+ * still there and its expiration time has come. This keeps the
+ * heap out of the replace path and makes it survive space alter,
+ * at the cost of keeping a key per update until the update time
+ * passes.
+ *
+ * Expired tuples are deleted by a background fiber in batches,
+ * each in a transaction of its own, with a configurable rate.
+ * Deletions are ordinary DELETE requests, so they are written
+ * to WAL, replicated and fire triggers. Replicas don't expire
+ * tuples: they receive the deletions from the master.
+ */
+struct memtx_expire *
+memtx_expire_new(void);
+
+void
+memtx_expire_delete(struct memtx_expire *expire);
+
+/** Start the expiration fiber. Called after recovery. */
+void
+memtx_expire_start(struct memtx_expire *expire);
+
+/**
+ * Set the max number of tuples deleted per second.
+ * 0 disables expiration.
+ */
+void
+memtx_expire_set_rate(struct memtx_expire *expire, double rate);
+
+/**
+ * Track a tuple inserted into a space with expiration enabled.
+ * Must be called before the tuple is inserted into the space.
+ * Returns -1 and sets diag on memory allocation error.
+ */
+int
+memtx_expire_track(struct memtx_expire *expire, struct space *space,
+		   struct tuple *tuple);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_EXPIRE_H_INCLUDED */
@@ -34,6 +34,7 @@
 #include "index.h"
 #include "tuple.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
@@ -284,6 +285,56 @@ memtx_hash_index_get(struct index *base, const char *key,
 	uint32_t k = light_index_find_key(&index->hash_table, h, key);
 	if (k != light_index_end)
 		*result = light_index_get(&index->hash_table, k);
+	return memtx_tx_tuple_clarify(base, result);
+}
+
+static int
+memtx_hash_index_get_batch(struct index *base, const char *keys,
+			   uint32_t key_count, struct tuple **result)
+{
+	struct memtx_hash_index *index = (struct memtx_hash_index *)base;
+	struct light_index_core *hash_table = &index->hash_table;
+	struct key_def *key_def = base->def->key_def;
+	assert(base->def->opts.is_unique);
+	/*
+	 * Calculate hashes of a few keys and prefetch the table
+	 * memory their lookups start with before doing the lookups
+	 * so that cache misses of different keys overlap.
+	 */
+	enum { BATCH_SIZE = 16 };
+	const char *batch_keys[BATCH_SIZE];
+	uint32_t hashes[BATCH_SIZE];
+	const char *key = keys;
+	for (uint32_t start = 0; start < key_count; start += BATCH_SIZE) {
+		uint32_t count = MIN(key_count - start, (uint32_t)BATCH_SIZE);
+		for (uint32_t i = 0; i < count; i++) {
+			const char *next_key = key;
+			mp_next(&next_key);
+			uint32_t part_count = mp_decode_array(&key);
+			assert(part_count == key_def->part_count);
+			(void)part_count;
+			batch_keys[i] = key;
+			hashes[i] = key_hash(key, key_def);
+			light_index_prefetch(hash_table, hashes[i]);
+			key = next_key;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			struct tuple **tuple = &result[start + i];
+			uint32_t k = light_index_find_key(hash_table, hashes[i],
+							  batch_keys[i]);
+			*tuple = k != light_index_end ?
+				 light_index_get(hash_table, k) : NULL;
+			if (memtx_tx_tuple_clarify(base, tuple) != 0) {
+				for (uint32_t j = 0; j < start + i; j++) {
+					if (result[j] != NULL)
+						tuple_unref(result[j]);
+				}
+				return -1;
+			}
+			if (*tuple != NULL)
+				tuple_ref(*tuple);
+		}
+	}
 	return 0;
 }
 
@@ -401,6 +452,9 @@ struct hash_snapshot_iterator {
 	struct snapshot_iterator base;
 	struct memtx_hash_index *index;
 	struct light_index_iterator iterator;
+	struct memtx_tx_snapshot_cleaner cleaner;
+	/** Format returned by memtx_enter_delayed_free_mode(). */
+	struct tuple_format *format;
 };
 
 /**
@@ -415,9 +469,10 @@ hash_snapshot_iterator_free(struct snapshot_iterator *iterator)
 	struct hash_snapshot_iterator *it =
 		(struct hash_snapshot_iterator *) iterator;
 	memtx_leave_delayed_free_mode((struct memtx_engine *)
-				      it->index->base.engine);
+				      it->index->base.engine, it->format);
 	light_index_iterator_destroy(&it->index->hash_table, &it->iterator);
 	index_unref(&it->index->base);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
 	free(iterator);
 }
 
@@ -434,14 +489,21 @@ hash_snapshot_iterator_next(struct snapshot_iterator *iterator,
 	struct hash_snapshot_iterator *it =
 		(struct hash_snapshot_iterator *) iterator;
 	struct light_index_core *hash_table = &it->index->hash_table;
-	struct tuple **res = light_index_iterator_get_and_next(hash_table,
-							       &it->iterator);
-	if (res == NULL) {
-		*data = NULL;
-		return 0;
+	while (true) {
+		struct tuple **res =
+			light_index_iterator_get_and_next(hash_table,
+							  &it->iterator);
+		if (res == NULL) {
+			*data = NULL;
+			return 0;
+		}
+		struct tuple *tuple =
+			memtx_tx_snapshot_clarify(&it->cleaner, *res);
+		if (tuple != NULL) {
+			*data = tuple_data_range(tuple, size);
+			return 0;
+		}
 	}
-	*data = tuple_data_range(*res, size);
-	return 0;
 }
 
 /**
@@ -460,6 +522,10 @@ memtx_hash_index_create_snapshot_iterator(struct index *base)
 			 "memtx_hash_index", "iterator");
 		return NULL;
 	}
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, base) != 0) {
+		free(it);
+		return NULL;
+	}
 
 	it->base.next = hash_snapshot_iterator_next;
 	it->base.free = hash_snapshot_iterator_free;
@@ -467,7 +533,8 @@ memtx_hash_index_create_snapshot_iterator(struct index *base)
 	index_ref(base);
 	light_index_iterator_begin(&index->hash_table, &it->iterator);
 	light_index_iterator_freeze(&index->hash_table, &it->iterator);
-	memtx_enter_delayed_free_mode((struct memtx_engine *)base->engine);
+	it->format = memtx_enter_delayed_free_mode(
+		(struct memtx_engine *)base->engine, base);
 	return (struct snapshot_iterator *) it;
 }
 
@@ -487,9 +554,15 @@ static const struct index_vtab memtx_hash_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_hash_index_random,
 	/* .count = */ memtx_hash_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_hash_index_get,
+	/* .get_batch = */ memtx_hash_index_get_batch,
 	/* .replace = */ memtx_hash_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
 	/* .create_iterator = */ memtx_hash_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		memtx_hash_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -36,12 +36,18 @@
 #include "xrow_update.h"
 #include "xrow.h"
 #include "memtx_hash.h"
+#include "memtx_swiss.h"
 #include "memtx_tree.h"
 #include "memtx_rtree.h"
+#include "memtx_art.h"
 #include "memtx_bitset.h"
+#include "memtx_text.h"
 #include "memtx_engine.h"
+#include "memtx_expire.h"
 #include "column_mask.h"
 #include "sequence.h"
+#include "schema.h"
+#include "coio_task.h"
 
 /*
  * Yield every 1K tuples while building a new index or checking
@@ -58,6 +64,12 @@ enum { MEMTX_DDL_YIELD_LOOPS = 1000 };
 enum { MEMTX_DDL_YIELD_LOOPS = 10 };
 #endif
 
+/**
+ * Secondary tree indexes of spaces with fewer tuples are built
+ * in the tx thread, see memtx_space_build_index_online().
+ */
+enum { MEMTX_ONLINE_BUILD_THRESHOLD = 10000 };
+
 static void
 memtx_space_destroy(struct space *space)
 {
@@ -71,6 +83,13 @@ memtx_space_bsize(struct space *space)
 	return memtx_space->bsize;
 }
 
+static size_t
+memtx_space_tuple_mem(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	return memtx_space->tuple_mem;
+}
+
 /* {{{ DML */
 
 void
@@ -82,6 +101,12 @@ memtx_space_update_bsize(struct space *space, struct tuple *old_tuple,
 	ssize_t new_bsize = new_tuple ? box_tuple_bsize(new_tuple) : 0;
 	assert((ssize_t)memtx_space->bsize + new_bsize - old_bsize >= 0);
 	memtx_space->bsize += new_bsize - old_bsize;
+	if (old_tuple != NULL)
+		memtx_space->tuple_mem -= memtx_tuple_alloc_size(old_tuple);
+	if (new_tuple != NULL)
+		memtx_space->tuple_mem += memtx_tuple_alloc_size(new_tuple);
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	memtx_space->checkpoint_gen = memtx->checkpoint_gen;
 }
 
 /**
@@ -236,12 +261,15 @@ memtx_space_replace_primary_key(struct space *space, struct tuple *old_tuple,
  * old_tuple is given, dup_replace_mode is ignored.
  * Otherwise, it's taken into account only for the
  * primary key.
+ *
+ * Secondary keys which don't intersect with @a column_mask, i.e.
+ * are not changed by an update, are replaced with
+ * index_replace_unchanged().
  */
-int
-memtx_space_replace_all_keys(struct space *space, struct tuple *old_tuple,
-			     struct tuple *new_tuple,
-			     enum dup_replace_mode mode,
-			     struct tuple **result)
+static int
+memtx_space_replace_keys(struct space *space, struct tuple *old_tuple,
+			 struct tuple *new_tuple, enum dup_replace_mode mode,
+			 uint64_t column_mask, struct tuple **result)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
 	/*
@@ -272,8 +300,19 @@ memtx_space_replace_all_keys(struct space *space, struct tuple *old_tuple,
 	for (i++; i < space->index_count; i++) {
 		struct tuple *unused;
 		struct index *index = space->index[i];
-		if (index_replace(index, old_tuple, new_tuple,
-				  DUP_INSERT, &unused) != 0)
+		struct key_def *key_def = index->def->key_def;
+		int rc;
+		if (old_tuple != NULL && new_tuple != NULL &&
+		    !key_def->for_func_index &&
+		    key_update_can_be_skipped(key_def->column_mask,
+					      column_mask)) {
+			rc = index_replace_unchanged(index, old_tuple,
+						     new_tuple);
+		} else {
+			rc = index_replace(index, old_tuple, new_tuple,
+					   DUP_INSERT, &unused);
+		}
+		if (rc != 0)
 			goto rollback;
 	}
 
@@ -298,17 +337,64 @@ rollback:
 	return -1;
 }
 
+int
+memtx_space_replace_all_keys(struct space *space, struct tuple *old_tuple,
+			     struct tuple *new_tuple,
+			     enum dup_replace_mode mode,
+			     struct tuple **result)
+{
+	return memtx_space_replace_keys(space, old_tuple, new_tuple, mode,
+					COLUMN_MASK_FULL, result);
+}
+
 static inline enum dup_replace_mode
 dup_replace_mode(uint32_t op)
 {
 	return op == IPROTO_INSERT ? DUP_INSERT : DUP_REPLACE_OR_INSERT;
 }
 
+/**
+ * Apply a change of a space done by a statement, either with
+ * the transaction manager or in place. In the latter case the
+ * transaction can't yield any longer.
+ */
+static int
+memtx_space_replace_tuple(struct space *space, struct txn_stmt *stmt,
+			  struct tuple *old_tuple, struct tuple *new_tuple,
+			  enum dup_replace_mode mode, uint64_t column_mask,
+			  struct tuple **result)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct txn *txn = stmt->txn;
+	if (txn->memtx_tx != NULL && txn->memtx_tx->is_aborted) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+	if (new_tuple != NULL &&
+	    space->def->opts.expire_field != UINT32_MAX) {
+		/* A stale key is harmless if the replace fails. */
+		struct memtx_engine *memtx =
+			(struct memtx_engine *)space->engine;
+		if (memtx_expire_track(memtx->expire, space, new_tuple) != 0)
+			return -1;
+	}
+	if (memtx_space_is_mvcc(space))
+		return memtx_tx_history_add_stmt(stmt, old_tuple, new_tuple,
+						 mode, result);
+	if (memtx_tx_manager_use_mvcc_engine &&
+	    txn_has_flag(txn, TXN_CAN_YIELD))
+		txn_can_yield(txn, false);
+	if (column_mask != COLUMN_MASK_FULL &&
+	    memtx_space->replace == memtx_space_replace_all_keys)
+		return memtx_space_replace_keys(space, old_tuple, new_tuple,
+						mode, column_mask, result);
+	return memtx_space->replace(space, old_tuple, new_tuple, mode, result);
+}
+
 static int
 memtx_space_execute_replace(struct space *space, struct txn *txn,
 			    struct request *request, struct tuple **result)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	enum dup_replace_mode mode = dup_replace_mode(request->type);
 	stmt->new_tuple = memtx_tuple_new(space->format, request->tuple,
@@ -316,8 +402,9 @@ memtx_space_execute_replace(struct space *space, struct txn *txn,
 	if (stmt->new_tuple == NULL)
 		return -1;
 	tuple_ref(stmt->new_tuple);
-	if (memtx_space->replace(space, NULL, stmt->new_tuple,
-				 mode, &stmt->old_tuple) != 0)
+	if (memtx_space_replace_tuple(space, stmt, NULL, stmt->new_tuple,
+				      mode, COLUMN_MASK_FULL,
+				      &stmt->old_tuple) != 0)
 		return -1;
 	stmt->engine_savepoint = stmt;
 	/** The new tuple is referenced by the primary key. */
@@ -329,7 +416,6 @@ static int
 memtx_space_execute_delete(struct space *space, struct txn *txn,
 			   struct request *request, struct tuple **result)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	/* Try to find the tuple by unique key. */
 	struct index *pk = index_find_unique(space, request->index_id);
@@ -343,19 +429,140 @@ memtx_space_execute_delete(struct space *space, struct txn *txn,
 	if (index_get(pk, key, part_count, &old_tuple) != 0)
 		return -1;
 	if (old_tuple != NULL &&
-	    memtx_space->replace(space, old_tuple, NULL,
-				 DUP_REPLACE_OR_INSERT, &stmt->old_tuple) != 0)
+	    memtx_space_replace_tuple(space, stmt, old_tuple, NULL,
+				      DUP_REPLACE_OR_INSERT, COLUMN_MASK_FULL,
+				      &stmt->old_tuple) != 0)
 		return -1;
 	stmt->engine_savepoint = stmt;
 	*result = stmt->old_tuple;
 	return 0;
 }
 
+/** Undo record of an update done in place. */
+struct memtx_update_undo {
+	/** Statement rollback trigger. */
+	struct trigger base;
+	/** The updated tuple. */
+	struct tuple *tuple;
+	/** Size of the data. */
+	uint32_t size;
+	/** Tuple data before the update. */
+	char data[0];
+};
+
+/** Restore the tuple data changed by an update done in place. */
+static int
+memtx_update_undo_run(struct trigger *trigger, void *event)
+{
+	(void)event;
+	struct memtx_update_undo *undo = (struct memtx_update_undo *)trigger;
+	assert(undo->tuple->bsize == undo->size);
+	memcpy((char *)tuple_data(undo->tuple), undo->data, undo->size);
+	return 0;
+}
+
+/**
+ * Check if an update of @a old_tuple can be applied in place.
+ * This is the case when nobody but the space can see the tuple:
+ * it isn't referenced from outside, isn't read by a snapshot or
+ * a read view, and there are no triggers or transaction manager
+ * stories which need the old tuple contents.
+ */
+static bool
+memtx_space_can_update_in_place(struct space *space, struct tuple *old_tuple)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	struct tuple_format *format = space->format;
+	if (!memtx->update_in_place || memtx_tx_manager_use_mvcc_engine ||
+	    old_tuple->refs != 1 || tuple_format(old_tuple) != format ||
+	    format->is_compressed ||
+	    !rlist_empty(&space->before_replace) ||
+	    !rlist_empty(&space->on_replace) || space->sql_triggers != NULL)
+		return false;
+	return !memtx_tuple_is_in_snapshot(memtx, format, old_tuple);
+}
+
+/**
+ * Try to write the result of an update into the old tuple. The
+ * new data must have the same size and field map, and no indexed
+ * field may be changed, so the indexes don't need to be touched.
+ * The old data is saved on the transaction region to be restored
+ * on rollback. Both the old and the new tuple of the statement
+ * are the updated tuple.
+ *
+ * @retval true The tuple is updated, the statement is filled.
+ * @retval false The update must be done by a tuple replacement.
+ */
+static bool
+memtx_space_update_in_place(struct space *space, struct txn_stmt *stmt,
+			    struct tuple *old_tuple, const char *new_data,
+			    uint32_t new_size, uint64_t column_mask)
+{
+	if (new_size != old_tuple->bsize)
+		return false;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index_def *def = space->index[i]->def;
+		if (def->key_def->for_func_index ||
+		    !key_update_can_be_skipped(def->key_def->column_mask,
+					       column_mask))
+			return false;
+	}
+	/*
+	 * Offsets of indexed fields must be the same, besides,
+	 * building the field map validates the new data.
+	 */
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	struct field_map_builder builder;
+	bool is_same = false;
+	if (tuple_field_map_create(space->format, new_data, true,
+				   &builder) != 0) {
+		diag_clear(diag_get());
+		goto out;
+	}
+	uint32_t field_map_size = field_map_build_size(&builder);
+	if (old_tuple->data_offset != sizeof(struct tuple) + field_map_size)
+		goto out;
+	char *field_map = (char *)region_alloc(region, field_map_size);
+	if (field_map == NULL && field_map_size > 0)
+		goto out;
+	field_map_build(&builder, field_map);
+	const char *old_data = tuple_data(old_tuple);
+	if (memcmp(field_map, old_data - field_map_size, field_map_size) != 0)
+		goto out;
+	struct memtx_update_undo *undo = (struct memtx_update_undo *)
+		region_aligned_alloc(&stmt->txn->region,
+				     sizeof(*undo) + new_size,
+				     alignof(struct memtx_update_undo));
+	if (undo == NULL)
+		goto out;
+	trigger_create(&undo->base, memtx_update_undo_run, NULL, NULL);
+	undo->tuple = old_tuple;
+	undo->size = new_size;
+	memcpy(undo->data, old_data, new_size);
+	txn_stmt_on_rollback(stmt, &undo->base);
+	memcpy((char *)old_data, new_data, new_size);
+	/*
+	 * References: one of the statement new tuple, one of the
+	 * space, while the former reference of the space is
+	 * passed to the statement old tuple.
+	 */
+	stmt->new_tuple = old_tuple;
+	tuple_ref(old_tuple);
+	tuple_ref(old_tuple);
+	stmt->old_tuple = old_tuple;
+	memtx_space_update_bsize(space, old_tuple, old_tuple);
+	stmt->engine_savepoint = stmt;
+	is_same = true;
+out:
+	region_truncate(region, region_svp);
+	return is_same;
+}
+
 static int
 memtx_space_execute_update(struct space *space, struct txn *txn,
 			   struct request *request, struct tuple **result)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	/* Try to find the tuple by unique key. */
 	struct index *pk = index_find_unique(space, request->index_id);
@@ -378,20 +585,29 @@ memtx_space_execute_update(struct space *space, struct txn *txn,
 	uint32_t new_size = 0, bsize;
 	struct tuple_format *format = space->format;
 	const char *old_data = tuple_data_range(old_tuple, &bsize);
+	uint64_t column_mask = COLUMN_MASK_FULL;
 	const char *new_data =
 		xrow_update_execute(request->tuple, request->tuple_end,
 				    old_data, old_data + bsize, format,
-				    &new_size, request->index_base, NULL);
+				    &new_size, request->index_base,
+				    &column_mask);
 	if (new_data == NULL)
 		return -1;
+	if (memtx_space_can_update_in_place(space, old_tuple) &&
+	    memtx_space_update_in_place(space, stmt, old_tuple, new_data,
+					new_size, column_mask)) {
+		*result = stmt->new_tuple;
+		return 0;
+	}
 
 	stmt->new_tuple = memtx_tuple_new(format, new_data,
 					  new_data + new_size);
 	if (stmt->new_tuple == NULL)
 		return -1;
 	tuple_ref(stmt->new_tuple);
-	if (memtx_space->replace(space, old_tuple, stmt->new_tuple,
-				 DUP_REPLACE, &stmt->old_tuple) != 0)
+	if (memtx_space_replace_tuple(space, stmt, old_tuple, stmt->new_tuple,
+				      DUP_REPLACE, column_mask,
+				      &stmt->old_tuple) != 0)
 		return -1;
 	stmt->engine_savepoint = stmt;
 	*result = stmt->new_tuple;
@@ -402,7 +618,6 @@ static int
 memtx_space_execute_upsert(struct space *space, struct txn *txn,
 			   struct request *request)
 {
-	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	/*
 	 * Check all tuple fields: we should produce an error on
@@ -432,6 +647,7 @@ memtx_space_execute_upsert(struct space *space, struct txn *txn,
 		return -1;
 
 	struct tuple_format *format = space->format;
+	uint64_t column_mask = COLUMN_MASK_FULL;
 	if (old_tuple == NULL) {
 		/**
 		 * Old tuple was not found. A write optimized
@@ -467,7 +683,6 @@ memtx_space_execute_upsert(struct space *space, struct txn *txn,
 		 * tuple ops, but ignores ops that not suitable
 		 * for the tuple.
 		 */
-		uint64_t column_mask = COLUMN_MASK_FULL;
 		const char *new_data =
 			xrow_upsert_execute(request->ops, request->ops_end,
 					    old_data, old_data + bsize,
@@ -503,8 +718,9 @@ memtx_space_execute_upsert(struct space *space, struct txn *txn,
 	 * above.
 	 */
 	if (stmt->new_tuple != NULL &&
-	    memtx_space->replace(space, old_tuple, stmt->new_tuple,
-				 DUP_REPLACE_OR_INSERT, &stmt->old_tuple) != 0)
+	    memtx_space_replace_tuple(space, stmt, old_tuple, stmt->new_tuple,
+				      DUP_REPLACE_OR_INSERT, column_mask,
+				      &stmt->old_tuple) != 0)
 		return -1;
 	stmt->engine_savepoint = stmt;
 	/* Return nothing: UPSERT does not return data. */
@@ -586,6 +802,37 @@ memtx_space_ephemeral_rowid_next(struct space *space, uint64_t *rowid)
 
 /* {{{ DDL */
 
+/**
+ * Check that key parts can be encoded in an ART index key:
+ * only integer, string and boolean parts without collations
+ * are supported.
+ */
+static int
+memtx_art_check_parts(struct space *space, struct index_def *index_def,
+		      struct key_def *key_def)
+{
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		struct key_part *part = &key_def->parts[i];
+		if (part->type != FIELD_TYPE_UNSIGNED &&
+		    part->type != FIELD_TYPE_INTEGER &&
+		    part->type != FIELD_TYPE_STRING &&
+		    part->type != FIELD_TYPE_BOOLEAN) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 tt_sprintf("field type '%s' is not supported",
+					    field_type_strs[part->type]));
+			return -1;
+		}
+		if (part->coll != NULL) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "ART index can not use collations");
+			return -1;
+		}
+	}
+	return 0;
+}
+
 static int
 memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 {
@@ -612,6 +859,12 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 			 "nullable root field");
 		return -1;
 	}
+	if (index_def->opts.count_keys && index_def->type != TREE) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "count_keys is supported only by TREE index");
+		return -1;
+	}
 	switch (index_def->type) {
 	case HASH:
 		if (! index_def->opts.is_unique) {
@@ -634,7 +887,16 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 		}
 		break;
 	case TREE:
-		/* TREE index has no limitations. */
+		if (index_def->opts.count_keys &&
+		    (index_def->opts.is_unique || key_def->is_multikey ||
+		     key_def->for_func_index)) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "count_keys is supported only by non-unique "
+				 "TREE indexes without multikey or function "
+				 "parts");
+			return -1;
+		}
 		break;
 	case RTREE:
 		if (key_def->part_count != 1) {
@@ -703,12 +965,70 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 		}
 		/* no furter checks of parts needed */
 		return 0;
+	case TEXT:
+		if (key_def->part_count != 1) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "TEXT index key can not be multipart");
+			return -1;
+		}
+		if (index_def->opts.is_unique) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "TEXT index can not be unique");
+			return -1;
+		}
+		if (key_def->parts[0].type != FIELD_TYPE_STRING) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "TEXT index field type must be STR");
+			return -1;
+		}
+		if (key_def->parts[0].coll != NULL) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "TEXT index can not use collations");
+			return -1;
+		}
+		if (key_def->is_multikey) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "TEXT index cannot be multikey");
+			return -1;
+		}
+		if (key_def->for_func_index) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "TEXT index can not use a function");
+			return -1;
+		}
+		/* no furter checks of parts needed */
+		return 0;
+	case ART:
+		if (key_def->is_multikey) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "ART index cannot be multikey");
+			return -1;
+		}
+		if (key_def->for_func_index) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name(space),
+				 "ART index can not use a function");
+			return -1;
+		}
+		/* Non-unique keys are extended with primary key parts. */
+		if (memtx_art_check_parts(space, index_def,
+					  index_def->opts.is_unique ?
+					  key_def : index_def->cmp_def) != 0)
+			return -1;
+		break;
 	default:
 		diag_set(ClientError, ER_INDEX_TYPE,
 			 index_def->name, space_name(space));
 		return -1;
 	}
-	/* Only HASH and TREE indexes checks parts there */
+	/* Only HASH, TREE and ART indexes checks parts there */
 	/* Check that there are no ANY, ARRAY, MAP parts */
 	for (uint32_t i = 0; i < key_def->part_count; i++) {
 		struct key_part *part = &key_def->parts[i];
@@ -721,6 +1041,19 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 			return -1;
 		}
 	}
+	/*
+	 * Primary key parts are appended to keys of non-unique
+	 * ART indexes, so they must be supported by ART too.
+	 */
+	if (index_def->iid == 0) {
+		for (uint32_t i = 0; i < space->index_count; i++) {
+			struct index_def *def = space->index[i]->def;
+			if (def->iid != 0 && def->type == ART &&
+			    !def->opts.is_unique &&
+			    memtx_art_check_parts(space, def, key_def) != 0)
+				return -1;
+		}
+	}
 	return 0;
 }
 
@@ -769,6 +1102,8 @@ memtx_space_create_index(struct space *space, struct index_def *index_def)
 
 	switch (index_def->type) {
 	case HASH:
+		if (index_def->opts.hash_type == INDEX_HASH_SWISS)
+			return memtx_swiss_index_new(memtx, index_def);
 		return memtx_hash_index_new(memtx, index_def);
 	case TREE:
 		return memtx_tree_index_new(memtx, index_def);
@@ -776,6 +1111,10 @@ memtx_space_create_index(struct space *space, struct index_def *index_def)
 		return memtx_rtree_index_new(memtx, index_def);
 	case BITSET:
 		return memtx_bitset_index_new(memtx, index_def);
+	case TEXT:
+		return memtx_text_index_new(memtx, index_def);
+	case ART:
+		return memtx_art_index_new(memtx, index_def);
 	default:
 		unreachable();
 		return NULL;
@@ -940,6 +1279,7 @@ memtx_space_drop_primary_key(struct space *space)
 	 */
 	memtx_space->replace = memtx_space_replace_no_keys;
 	memtx_space->bsize = 0;
+	memtx_space->tuple_mem = 0;
 }
 
 static void
@@ -998,6 +1338,305 @@ memtx_build_on_replace(struct trigger *trigger, void *event)
 	return 0;
 }
 
+/** A change of a space made while an index is built online. */
+struct memtx_build_change {
+	struct tuple *old_tuple;
+	struct tuple *new_tuple;
+};
+
+/**
+ * State of an online index build used by the corresponding
+ * on_replace trigger.
+ */
+struct memtx_online_build_state {
+	/* New format to be enforced. */
+	struct tuple_format *format;
+	/* Primary key key_def to compare new tuples with cursor. */
+	struct key_def *cmp_def;
+	/*
+	 * The last collected tuple, NULL if nothing has been
+	 * collected yet. Tuples past the cursor will be collected
+	 * later, so their changes are ignored.
+	 */
+	struct tuple *cursor;
+	/* Set when all tuples of the space are collected. */
+	bool is_collected;
+	/* Collected tuples, referenced. */
+	struct tuple **tuples;
+	size_t tuple_count;
+	size_t tuple_capacity;
+	/* Changes of collected tuples, referenced. */
+	struct memtx_build_change *changes;
+	size_t change_count;
+	size_t change_capacity;
+	struct diag diag;
+	int rc;
+};
+
+static int
+memtx_online_build_add_tuple(struct memtx_online_build_state *state,
+			     struct tuple *tuple)
+{
+	if (state->tuple_count == state->tuple_capacity) {
+		size_t capacity = MAX(state->tuple_capacity * 2, 1024);
+		size_t size = capacity * sizeof(state->tuples[0]);
+		struct tuple **tuples = realloc(state->tuples, size);
+		if (tuples == NULL) {
+			diag_set(OutOfMemory, size, "realloc", "tuples");
+			return -1;
+		}
+		state->tuples = tuples;
+		state->tuple_capacity = capacity;
+	}
+	tuple_ref(tuple);
+	state->tuples[state->tuple_count++] = tuple;
+	return 0;
+}
+
+static int
+memtx_online_build_add_change(struct memtx_online_build_state *state,
+			      struct tuple *old_tuple, struct tuple *new_tuple)
+{
+	if (state->change_count == state->change_capacity) {
+		size_t capacity = MAX(state->change_capacity * 2, 64);
+		size_t size = capacity * sizeof(state->changes[0]);
+		struct memtx_build_change *changes =
+			realloc(state->changes, size);
+		if (changes == NULL) {
+			diag_set(OutOfMemory, size, "realloc", "changes");
+			return -1;
+		}
+		state->changes = changes;
+		state->change_capacity = capacity;
+	}
+	struct memtx_build_change *change =
+		&state->changes[state->change_count++];
+	change->old_tuple = old_tuple;
+	change->new_tuple = new_tuple;
+	if (old_tuple != NULL)
+		tuple_ref(old_tuple);
+	if (new_tuple != NULL)
+		tuple_ref(new_tuple);
+	return 0;
+}
+
+static void
+memtx_online_build_clear_changes(struct memtx_online_build_state *state)
+{
+	for (size_t i = 0; i < state->change_count; i++) {
+		struct memtx_build_change *change = &state->changes[i];
+		if (change->old_tuple != NULL)
+			tuple_unref(change->old_tuple);
+		if (change->new_tuple != NULL)
+			tuple_unref(change->new_tuple);
+	}
+	state->change_count = 0;
+}
+
+static int
+memtx_online_build_on_replace(struct trigger *trigger, void *event)
+{
+	struct txn *txn = event;
+	struct memtx_online_build_state *state = trigger->data;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+
+	/* We have already failed. */
+	if (state->rc != 0)
+		return 0;
+
+	struct tuple *cmp_tuple = stmt->new_tuple != NULL ? stmt->new_tuple :
+							    stmt->old_tuple;
+	if (!state->is_collected &&
+	    (state->cursor == NULL ||
+	     tuple_compare(state->cursor, HINT_NONE, cmp_tuple, HINT_NONE,
+			   state->cmp_def) < 0))
+		return 0;
+
+	if (stmt->new_tuple != NULL &&
+	    tuple_validate(state->format, stmt->new_tuple) != 0) {
+		state->rc = -1;
+		diag_move(diag_get(), &state->diag);
+		return 0;
+	}
+	if (memtx_online_build_add_change(state, stmt->old_tuple,
+					  stmt->new_tuple) != 0) {
+		state->rc = -1;
+		diag_move(diag_get(), &state->diag);
+	}
+	return 0;
+}
+
+static int
+memtx_tuple_ptr_cmp(const void *a, const void *b)
+{
+	uintptr_t p1 = (uintptr_t)*(struct tuple **)a;
+	uintptr_t p2 = (uintptr_t)*(struct tuple **)b;
+	return p1 < p2 ? -1 : p1 > p2;
+}
+
+/**
+ * Apply changes logged while tuples were being collected to
+ * the collected tuples. A tuple object is inserted into a space
+ * only once, so it's enough to add all new tuples and remove all
+ * old ones.
+ */
+static int
+memtx_online_build_fold_changes(struct memtx_online_build_state *state)
+{
+	size_t size = MAX(state->change_count, 1) * sizeof(struct tuple *);
+	struct tuple **removed = malloc(size);
+	if (removed == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "removed");
+		return -1;
+	}
+	size_t removed_count = 0;
+	for (size_t i = 0; i < state->change_count; i++) {
+		struct memtx_build_change *change = &state->changes[i];
+		if (change->old_tuple != NULL)
+			removed[removed_count++] = change->old_tuple;
+		if (change->new_tuple != NULL &&
+		    memtx_online_build_add_tuple(state,
+						 change->new_tuple) != 0) {
+			free(removed);
+			return -1;
+		}
+	}
+	qsort(removed, removed_count, sizeof(removed[0]), memtx_tuple_ptr_cmp);
+	size_t count = 0;
+	for (size_t i = 0; i < state->tuple_count; i++) {
+		struct tuple *tuple = state->tuples[i];
+		if (bsearch(&tuple, removed, removed_count, sizeof(removed[0]),
+			    memtx_tuple_ptr_cmp) != NULL) {
+			tuple_unref(tuple);
+			continue;
+		}
+		state->tuples[count++] = tuple;
+	}
+	state->tuple_count = count;
+	free(removed);
+	memtx_online_build_clear_changes(state);
+	return 0;
+}
+
+static ssize_t
+memtx_online_build_sort_cb(va_list ap)
+{
+	struct index *index = va_arg(ap, struct index *);
+	struct tuple **tuples = va_arg(ap, struct tuple **);
+	size_t count = va_arg(ap, size_t);
+	bool *has_dup = va_arg(ap, bool *);
+	if (memtx_tree_index_prepare_build(index, tuples, count) != 0)
+		return -1;
+	*has_dup = index->def->opts.is_unique &&
+		   memtx_tree_index_build_has_dup(index);
+	return 0;
+}
+
+/**
+ * Build a secondary tree index without blocking the tx thread
+ * for long. Tuples are collected from the primary index with
+ * periodic yields, then their keys are sorted by a coio thread,
+ * and the tree is assembled in tx. Changes of the space made
+ * meanwhile are logged by an on_replace trigger and applied to
+ * the index before it is returned.
+ */
+static int
+memtx_space_build_index_online(struct space *src_space, struct index *pk,
+			       struct index *new_index,
+			       struct tuple_format *new_format)
+{
+	struct iterator *it = index_create_iterator(pk, ITER_ALL, NULL, 0);
+	if (it == NULL)
+		return -1;
+
+	struct memtx_online_build_state state;
+	memset(&state, 0, sizeof(state));
+	state.format = new_format;
+	state.cmp_def = pk->def->key_def;
+	diag_create(&state.diag);
+
+	struct trigger on_replace;
+	trigger_create(&on_replace, memtx_online_build_on_replace,
+		       &state, NULL);
+	trigger_add(&src_space->on_replace, &on_replace);
+
+	int rc;
+	struct tuple *tuple;
+	while ((rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
+		/*
+		 * Check that the tuple is OK according to the
+		 * new format.
+		 */
+		rc = tuple_validate(new_format, tuple);
+		if (rc != 0)
+			break;
+		rc = memtx_online_build_add_tuple(&state, tuple);
+		if (rc != 0)
+			break;
+		state.cursor = tuple;
+		if (state.tuple_count % MEMTX_DDL_YIELD_LOOPS == 0)
+			fiber_sleep(0);
+		ERROR_INJECT_YIELD(ERRINJ_BUILD_INDEX_DELAY);
+		/*
+		 * The on_replace trigger may have failed
+		 * during the yield.
+		 */
+		if (state.rc != 0) {
+			rc = -1;
+			diag_move(&state.diag, diag_get());
+			break;
+		}
+	}
+	iterator_delete(it);
+	if (rc != 0)
+		goto out;
+
+	/* From now on all changes are logged. */
+	state.is_collected = true;
+	if (memtx_online_build_fold_changes(&state) != 0)
+		goto fail;
+
+	bool has_dup = false;
+	index_begin_build(new_index);
+	if (coio_call(memtx_online_build_sort_cb, new_index, state.tuples,
+		      state.tuple_count, &has_dup) != 0)
+		goto fail;
+	if (state.rc != 0) {
+		diag_move(&state.diag, diag_get());
+		goto fail;
+	}
+	if (has_dup) {
+		diag_set(ClientError, ER_TUPLE_FOUND, new_index->def->name,
+			 space_name(src_space));
+		goto fail;
+	}
+	memtx_tree_index_finish_build(new_index);
+
+	/* Apply changes made while the keys were being sorted. */
+	enum dup_replace_mode mode =
+		new_index->def->opts.is_unique ? DUP_INSERT :
+						 DUP_REPLACE_OR_INSERT;
+	for (size_t i = 0; i < state.change_count; i++) {
+		struct memtx_build_change *change = &state.changes[i];
+		struct tuple *unused;
+		if (index_replace(new_index, change->old_tuple,
+				  change->new_tuple, mode, &unused) != 0)
+			goto fail;
+	}
+	goto out;
+fail:
+	rc = -1;
+out:
+	trigger_clear(&on_replace);
+	memtx_online_build_clear_changes(&state);
+	for (size_t i = 0; i < state.tuple_count; i++)
+		tuple_unref(state.tuples[i]);
+	free(state.tuples);
+	free(state.changes);
+	diag_destroy(&state.diag);
+	return rc;
+}
+
 static int
 memtx_space_build_index(struct space *src_space, struct index *new_index,
 			struct tuple_format *new_format,
@@ -1029,6 +1668,20 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 		return -1;
 	}
 
+	struct memtx_engine *memtx = (struct memtx_engine *)src_space->engine;
+	if (new_index->def->iid != 0 && pk->def->type == TREE &&
+	    memtx_tree_index_can_prepare_build(new_index) &&
+	    memtx->state == MEMTX_OK &&
+	    index_size(pk) >= MEMTX_ONLINE_BUILD_THRESHOLD) {
+		if (txn_check_singlestatement(txn, "index build") != 0)
+			return -1;
+		txn_can_yield(txn, true);
+		int rc = memtx_space_build_index_online(src_space, pk,
+							new_index, new_format);
+		txn_can_yield(txn, false);
+		return rc;
+	}
+
 	/* Now deal with any kind of add index during normal operation. */
 	struct iterator *it = index_create_iterator(pk, ITER_ALL, NULL, 0);
 	if (it == NULL)
@@ -1039,7 +1692,6 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 
 	txn_can_yield(txn, true);
 
-	struct memtx_engine *memtx = (struct memtx_engine *)src_space->engine;
 	struct memtx_ddl_state state;
 	state.index = new_index;
 	state.format = new_format;
@@ -1119,6 +1771,144 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 	return rc;
 }
 
+/**
+ * Let the transaction manager handle changes of a space again
+ * when the transaction that altered it ends.
+ */
+static int
+memtx_space_end_alter(struct trigger *trigger, void *event)
+{
+	(void)event;
+	uint32_t space_id = (uintptr_t)trigger->data;
+	struct space *space = space_by_id(space_id);
+	if (space != NULL && space_is_memtx(space))
+		((struct memtx_space *)space)->is_altered = false;
+	return 0;
+}
+
+/**
+ * Abort all transactions in progress that changed a space
+ * being altered and make further changes of the space in
+ * place until the altering transaction ends: their history
+ * refers to the indexes of the old space.
+ */
+static int
+memtx_space_begin_alter(struct space *old_space, struct space *new_space)
+{
+	struct txn *txn = in_txn();
+	if (txn == NULL)
+		return 0;
+	size_t size;
+	struct trigger *triggers = region_alloc_array(&txn->region,
+						      struct trigger, 2,
+						      &size);
+	if (triggers == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array",
+			 "triggers");
+		return -1;
+	}
+	void *data = (void *)(uintptr_t)old_space->def->id;
+	trigger_create(&triggers[0], memtx_space_end_alter, data, NULL);
+	trigger_create(&triggers[1], memtx_space_end_alter, data, NULL);
+	txn_on_commit(txn, &triggers[0]);
+	txn_on_rollback(txn, &triggers[1]);
+	memtx_tx_abort_writers_for_space(old_space);
+	((struct memtx_space *)old_space)->is_altered = true;
+	((struct memtx_space *)new_space)->is_altered = true;
+	return 0;
+}
+
+int
+memtx_space_bulk_load(struct space *space, struct tuple **tuples,
+		      size_t count)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	struct index *pk = space_index(space, 0);
+	if (pk == NULL) {
+		diag_set(ClientError, ER_NO_SUCH_INDEX_ID, 0,
+			 space_name(space));
+		return -1;
+	}
+	if (memtx->state != MEMTX_OK ||
+	    memtx_space->replace != memtx_space_replace_all_keys) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Bulk load",
+			 "spaces being recovered");
+		return -1;
+	}
+	if (memtx->checkpoint != NULL) {
+		diag_set(ClientError, ER_CHECKPOINT_IN_PROGRESS);
+		return -1;
+	}
+	if (memtx_space_is_mvcc(space)) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Bulk load",
+			 "the transaction manager");
+		return -1;
+	}
+	if (index_size(pk) != 0) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Bulk load",
+			 "non-empty spaces");
+		return -1;
+	}
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (!memtx_tree_index_can_prepare_build(space->index[i])) {
+			diag_set(ClientError, ER_UNSUPPORTED, "Bulk load",
+				 "indexes other than TREE");
+			return -1;
+		}
+	}
+	if (space->def->opts.expire_field != UINT32_MAX) {
+		for (size_t i = 0; i < count; i++) {
+			if (memtx_expire_track(memtx->expire, space,
+					       tuples[i]) != 0)
+				return -1;
+		}
+	}
+	/*
+	 * Collect and sort keys of the secondary indexes first:
+	 * it is the only stage which may fail, so nothing is
+	 * visible in the space until all indexes are ready.
+	 */
+	uint32_t prepared = 1;
+	for (; prepared < space->index_count; prepared++) {
+		struct index *index = space->index[prepared];
+		index_begin_build(index);
+		if (memtx_tree_index_prepare_build(index, tuples, count) != 0)
+			goto fail;
+		if (index->def->opts.is_unique &&
+		    memtx_tree_index_build_has_dup(index)) {
+			diag_set(ClientError, ER_TUPLE_FOUND, index->def->name,
+				 space_name(space));
+			prepared++;
+			goto fail;
+		}
+	}
+	/*
+	 * The tuples are already sorted by the primary key, so
+	 * sorting them again in end_build() takes linear time.
+	 * Reserved build array makes build_next() infallible.
+	 */
+	index_begin_build(pk);
+	if (index_reserve(pk, count) != 0)
+		goto fail;
+	for (size_t i = 0; i < count; i++) {
+		if (index_build_next(pk, tuples[i]) != 0)
+			unreachable();
+	}
+	index_end_build(pk);
+	for (uint32_t i = 1; i < space->index_count; i++)
+		memtx_tree_index_finish_build(space->index[i]);
+	for (size_t i = 0; i < count; i++) {
+		memtx_space_update_bsize(space, NULL, tuples[i]);
+		tuple_ref(tuples[i]);
+	}
+	return 0;
+fail:
+	for (uint32_t i = 1; i < prepared; i++)
+		memtx_tree_index_discard_build(space->index[i]);
+	return -1;
+}
+
 static int
 memtx_space_prepare_alter(struct space *old_space, struct space *new_space)
 {
@@ -1131,9 +1921,27 @@ memtx_space_prepare_alter(struct space *old_space, struct space *new_space)
 			 "can not switch temporary flag on a non-empty space");
 		return -1;
 	}
+	if (old_memtx_space->bsize != 0 &&
+	    old_space->def->opts.expire_field !=
+	    new_space->def->opts.expire_field) {
+		diag_set(ClientError, ER_ALTER_SPACE, old_space->def->name,
+			 "can not change expire_field of a non-empty space");
+		return -1;
+	}
 
 	new_memtx_space->replace = old_memtx_space->replace;
 	new_memtx_space->bsize = old_memtx_space->bsize;
+	new_memtx_space->tuple_mem = old_memtx_space->tuple_mem;
+	/*
+	 * Tuples of the old format may end up in the indexes of
+	 * the new space, so snapshot iterators over the new space
+	 * may see them. Never reset even if alter is rolled back,
+	 * to err on the side of keeping tuples alive.
+	 */
+	old_space->format->is_snapshot_tracked = false;
+	if (memtx_tx_manager_use_mvcc_engine &&
+	    memtx_space_begin_alter(old_space, new_space) != 0)
+		return -1;
 	return 0;
 }
 
@@ -1142,10 +1950,12 @@ memtx_space_prepare_alter(struct space *old_space, struct space *new_space)
 static const struct space_vtab memtx_space_vtab = {
 	/* .destroy = */ memtx_space_destroy,
 	/* .bsize = */ memtx_space_bsize,
+	/* .tuple_mem = */ memtx_space_tuple_mem,
 	/* .execute_replace = */ memtx_space_execute_replace,
 	/* .execute_delete = */ memtx_space_execute_delete,
 	/* .execute_update = */ memtx_space_execute_update,
 	/* .execute_upsert = */ memtx_space_execute_upsert,
+	/* .execute_delete_range = */ generic_space_execute_delete_range,
 	/* .ephemeral_replace = */ memtx_space_ephemeral_replace,
 	/* .ephemeral_delete = */ memtx_space_ephemeral_delete,
 	/* .ephemeral_rowid_next = */ memtx_space_ephemeral_rowid_next,
@@ -1184,7 +1994,8 @@ memtx_space_new(struct memtx_engine *memtx,
 		tuple_format_new(&memtx_tuple_format_vtab, memtx, keys, key_count,
 				 def->fields, def->field_count,
 				 def->exact_field_count, def->dict,
-				 def->opts.is_temporary, def->opts.is_ephemeral);
+				 def->opts.is_temporary, def->opts.is_ephemeral,
+				 true);
 	if (format == NULL) {
 		free(memtx_space);
 		return NULL;
@@ -1200,9 +2011,27 @@ memtx_space_new(struct memtx_engine *memtx,
 
 	/* Format is now referenced by the space. */
 	tuple_format_unref(format);
+	/* Ephemeral formats may be shared by a few spaces. */
+	format->is_snapshot_tracked = !def->opts.is_ephemeral;
 
 	memtx_space->bsize = 0;
+	memtx_space->tuple_mem = 0;
 	memtx_space->rowid = 0;
 	memtx_space->replace = memtx_space_replace_no_keys;
+	struct space *space = (struct space *)memtx_space;
+	memtx_space->is_mvcc = !def->opts.is_ephemeral &&
+			       !space_is_system(space);
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct key_def *key_def = space->index[i]->def->key_def;
+		if (key_def->is_multikey || key_def->for_func_index)
+			memtx_space->is_mvcc = false;
+	}
+	memtx_space->is_altered = false;
+	/*
+	 * A new space object is created on any change of the
+	 * definition, including truncation, so consider it
+	 * changed.
+	 */
+	memtx_space->checkpoint_gen = memtx->checkpoint_gen;
 	return (struct space *)memtx_space;
 }
@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 #include "space.h"
+#include "memtx_tx.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -42,6 +43,11 @@ struct memtx_space {
 	struct space base;
 	/* Number of bytes used in memory by tuples in the space. */
 	size_t bsize;
+	/**
+	 * Memory allocated for tuples of the space, including
+	 * tuple headers and field maps.
+	 */
+	size_t tuple_mem;
 	/**
 	 * This counter is used to generate unique ids for
 	 * ephemeral spaces. Mostly used by SQL: values of this
@@ -55,6 +61,24 @@ struct memtx_space {
 	 */
 	int (*replace)(struct space *, struct tuple *, struct tuple *,
 		       enum dup_replace_mode, struct tuple **);
+	/**
+	 * Set if changes of the space may be handled by the
+	 * transaction manager: the space isn't a system one
+	 * and has no multikey or functional indexes.
+	 */
+	bool is_mvcc;
+	/**
+	 * Set while the space is being altered. Changes are
+	 * applied in place then, see memtx_space_is_mvcc().
+	 */
+	bool is_altered;
+	/**
+	 * Checkpoint generation of the last change of the space,
+	 * see memtx_engine::checkpoint_gen. The space is written
+	 * to a delta snapshot if it has been changed after the
+	 * last full snapshot.
+	 */
+	int64_t checkpoint_gen;
 };
 
 /**
@@ -83,6 +107,31 @@ int
 memtx_space_replace_all_keys(struct space *, struct tuple *, struct tuple *,
 			     enum dup_replace_mode, struct tuple **);
 
+/**
+ * Return true if changes of the space are handled by the
+ * transaction manager, see memtx_tx.h.
+ */
+static inline bool
+memtx_space_is_mvcc(struct space *space)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	return memtx_tx_manager_use_mvcc_engine && memtx_space->is_mvcc &&
+	       !memtx_space->is_altered &&
+	       memtx_space->replace == memtx_space_replace_all_keys;
+}
+
+/**
+ * Fill an empty space with tuples sorted by the primary key
+ * without duplicates, building all its indexes in bulk. The
+ * changes bypass transactions and WAL. All indexes must be
+ * trees, see memtx_tree_index_can_prepare_build(). Either all
+ * tuples are inserted or, on error, none. The space references
+ * the tuples on success.
+ */
+int
+memtx_space_bulk_load(struct space *space, struct tuple **tuples,
+		      size_t count);
+
 struct space *
 memtx_space_new(struct memtx_engine *memtx,
 		struct space_def *def, struct rlist *key_list);
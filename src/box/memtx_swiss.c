@@ -0,0 +1,610 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_swiss.h"
+#include "say.h"
+#include "fiber.h"
+#include "index.h"
+#include "tuple.h"
+#include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "space.h"
+#include "schema.h" /* space_cache_find() */
+#include "errinj.h"
+
+#include <small/mempool.h>
+
+static inline bool
+memtx_hash_equal(struct tuple *tuple_a, struct tuple *tuple_b,
+		 struct key_def *key_def)
+{
+	return tuple_compare(tuple_a, HINT_NONE,
+			     tuple_b, HINT_NONE, key_def) == 0;
+}
+
+static inline bool
+memtx_hash_equal_key(struct tuple *tuple, const char *key,
+		     struct key_def *key_def)
+{
+	return tuple_compare_with_key(tuple, HINT_NONE, key,
+				      key_def->part_count, HINT_NONE,
+				      key_def) == 0;
+}
+
+#define SWISS_NAME _index
+#define SWISS_DATA_TYPE struct tuple *
+#define SWISS_KEY_TYPE const char *
+#define SWISS_CMP_ARG_TYPE struct key_def *
+#define SWISS_EQUAL(a, b, c) memtx_hash_equal(a, b, c)
+#define SWISS_EQUAL_KEY(a, b, c) memtx_hash_equal_key(a, b, c)
+#define SWISS_HASH(a, c) tuple_hash(a, c)
+
+#include "salad/swiss.h"
+
+#undef SWISS_NAME
+#undef SWISS_DATA_TYPE
+#undef SWISS_KEY_TYPE
+#undef SWISS_CMP_ARG_TYPE
+#undef SWISS_EQUAL
+#undef SWISS_EQUAL_KEY
+#undef SWISS_HASH
+
+struct memtx_swiss_index {
+	struct index base;
+	struct swiss_index_core hash_table;
+	struct memtx_gc_task gc_task;
+	struct swiss_index_iterator gc_iterator;
+};
+
+/* {{{ MemtxSwiss Iterators ****************************************/
+
+struct hash_iterator {
+	struct iterator base; /* Must be the first member. */
+	struct swiss_index_iterator iterator;
+	/** Memory pool the iterator was allocated from. */
+	struct mempool *pool;
+};
+
+static_assert(sizeof(struct hash_iterator) <= MEMTX_ITERATOR_SIZE,
+	      "sizeof(struct hash_iterator) must be less than or equal "
+	      "to MEMTX_ITERATOR_SIZE");
+
+static void
+hash_iterator_free(struct iterator *iterator)
+{
+	assert(iterator->free == hash_iterator_free);
+	struct hash_iterator *it = (struct hash_iterator *) iterator;
+	mempool_free(it->pool, it);
+}
+
+static int
+hash_iterator_ge(struct iterator *ptr, struct tuple **ret)
+{
+	assert(ptr->free == hash_iterator_free);
+	struct hash_iterator *it = (struct hash_iterator *) ptr;
+	struct memtx_swiss_index *index =
+		(struct memtx_swiss_index *)ptr->index;
+	struct swiss_index_core *hash_table = &index->hash_table;
+	struct tuple **res = swiss_index_iterator_get_and_next(hash_table,
+							       &it->iterator);
+	*ret = res != NULL ? *res : NULL;
+	return 0;
+}
+
+static int
+hash_iterator_gt(struct iterator *ptr, struct tuple **ret)
+{
+	assert(ptr->free == hash_iterator_free);
+	ptr->next = hash_iterator_ge;
+	struct hash_iterator *it = (struct hash_iterator *) ptr;
+	struct memtx_swiss_index *index =
+		(struct memtx_swiss_index *)ptr->index;
+	struct swiss_index_core *hash_table = &index->hash_table;
+	struct tuple **res = swiss_index_iterator_get_and_next(hash_table,
+							       &it->iterator);
+	if (res != NULL)
+		res = swiss_index_iterator_get_and_next(hash_table,
+							&it->iterator);
+	*ret = res != NULL ? *res : NULL;
+	return 0;
+}
+
+static int
+hash_iterator_eq_next(MAYBE_UNUSED struct iterator *it, struct tuple **ret)
+{
+	*ret = NULL;
+	return 0;
+}
+
+static int
+hash_iterator_eq(struct iterator *it, struct tuple **ret)
+{
+	it->next = hash_iterator_eq_next;
+	return hash_iterator_ge(it, ret);
+}
+
+/* }}} */
+
+/* {{{ MemtxSwiss -- HASH index on top of salad/swiss.h. *************/
+
+static void
+memtx_swiss_index_free(struct memtx_swiss_index *index)
+{
+	swiss_index_destroy(&index->hash_table);
+	free(index);
+}
+
+static void
+memtx_swiss_index_gc_run(struct memtx_gc_task *task, bool *done)
+{
+	/*
+	 * Yield every 1K tuples to keep latency < 0.1 ms.
+	 * Yield more often in debug mode.
+	 */
+#ifdef NDEBUG
+	enum { YIELD_LOOPS = 1000 };
+#else
+	enum { YIELD_LOOPS = 10 };
+#endif
+
+	struct memtx_swiss_index *index = container_of(task,
+			struct memtx_swiss_index, gc_task);
+	struct swiss_index_core *hash = &index->hash_table;
+	struct swiss_index_iterator *itr = &index->gc_iterator;
+
+	struct tuple **res;
+	unsigned int loops = 0;
+	while ((res = swiss_index_iterator_get_and_next(hash, itr)) != NULL) {
+		tuple_unref(*res);
+		if (++loops >= YIELD_LOOPS) {
+			*done = false;
+			return;
+		}
+	}
+	*done = true;
+}
+
+static void
+memtx_swiss_index_gc_free(struct memtx_gc_task *task)
+{
+	struct memtx_swiss_index *index = container_of(task,
+			struct memtx_swiss_index, gc_task);
+	memtx_swiss_index_free(index);
+}
+
+static const struct memtx_gc_task_vtab memtx_swiss_index_gc_vtab = {
+	.run = memtx_swiss_index_gc_run,
+	.free = memtx_swiss_index_gc_free,
+};
+
+static void
+memtx_swiss_index_destroy(struct index *base)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+	if (base->def->iid == 0) {
+		/*
+		 * Primary index. We need to free all tuples stored
+		 * in the index, which may take a while. Schedule a
+		 * background task in order not to block tx thread.
+		 */
+		index->gc_task.vtab = &memtx_swiss_index_gc_vtab;
+		swiss_index_iterator_begin(&index->hash_table,
+					   &index->gc_iterator);
+		memtx_engine_schedule_gc(memtx, &index->gc_task);
+	} else {
+		/*
+		 * Secondary index. Destruction is fast, no need to
+		 * hand over to background fiber.
+		 */
+		memtx_swiss_index_free(index);
+	}
+}
+
+static void
+memtx_swiss_index_update_def(struct index *base)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	index->hash_table.arg = index->base.def->key_def;
+}
+
+static ssize_t
+memtx_swiss_index_size(struct index *base)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	return index->hash_table.count;
+}
+
+static ssize_t
+memtx_swiss_index_bsize(struct index *base)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	return matras_extent_count(&index->hash_table.mtable) *
+					MEMTX_EXTENT_SIZE;
+}
+
+static int
+memtx_swiss_index_random(struct index *base, uint32_t rnd,
+			 struct tuple **result)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	struct swiss_index_core *hash_table = &index->hash_table;
+
+	*result = NULL;
+	if (hash_table->count == 0)
+		return 0;
+	rnd %= (hash_table->table_size);
+	while (!swiss_index_pos_valid(hash_table, rnd)) {
+		rnd++;
+		rnd %= (hash_table->table_size);
+	}
+	*result = swiss_index_get(hash_table, rnd);
+	return 0;
+}
+
+static ssize_t
+memtx_swiss_index_count(struct index *base, enum iterator_type type,
+			const char *key, uint32_t part_count)
+{
+	if (type == ITER_ALL)
+		return memtx_swiss_index_size(base); /* optimization */
+	return generic_index_count(base, type, key, part_count);
+}
+
+static int
+memtx_swiss_index_get(struct index *base, const char *key,
+		      uint32_t part_count, struct tuple **result)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+
+	assert(base->def->opts.is_unique &&
+	       part_count == base->def->key_def->part_count);
+	(void) part_count;
+
+	*result = NULL;
+	uint32_t h = key_hash(key, base->def->key_def);
+	uint32_t k = swiss_index_find_key(&index->hash_table, h, key);
+	if (k != swiss_index_end)
+		*result = swiss_index_get(&index->hash_table, k);
+	return memtx_tx_tuple_clarify(base, result);
+}
+
+static int
+memtx_swiss_index_get_batch(struct index *base, const char *keys,
+			    uint32_t key_count, struct tuple **result)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	struct swiss_index_core *hash_table = &index->hash_table;
+	struct key_def *key_def = base->def->key_def;
+	assert(base->def->opts.is_unique);
+	/*
+	 * Calculate hashes of a few keys and prefetch the table
+	 * memory their lookups start with before doing the lookups
+	 * so that cache misses of different keys overlap.
+	 */
+	enum { BATCH_SIZE = 16 };
+	const char *batch_keys[BATCH_SIZE];
+	uint32_t hashes[BATCH_SIZE];
+	const char *key = keys;
+	for (uint32_t start = 0; start < key_count; start += BATCH_SIZE) {
+		uint32_t count = MIN(key_count - start, (uint32_t)BATCH_SIZE);
+		for (uint32_t i = 0; i < count; i++) {
+			const char *next_key = key;
+			mp_next(&next_key);
+			uint32_t part_count = mp_decode_array(&key);
+			assert(part_count == key_def->part_count);
+			(void)part_count;
+			batch_keys[i] = key;
+			hashes[i] = key_hash(key, key_def);
+			swiss_index_prefetch(hash_table, hashes[i]);
+			key = next_key;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			struct tuple **tuple = &result[start + i];
+			uint32_t k = swiss_index_find_key(hash_table, hashes[i],
+							  batch_keys[i]);
+			*tuple = k != swiss_index_end ?
+				 swiss_index_get(hash_table, k) : NULL;
+			if (memtx_tx_tuple_clarify(base, tuple) != 0) {
+				for (uint32_t j = 0; j < start + i; j++) {
+					if (result[j] != NULL)
+						tuple_unref(result[j]);
+				}
+				return -1;
+			}
+			if (*tuple != NULL)
+				tuple_ref(*tuple);
+		}
+	}
+	return 0;
+}
+
+static int
+memtx_swiss_index_replace(struct index *base, struct tuple *old_tuple,
+			  struct tuple *new_tuple, enum dup_replace_mode mode,
+			  struct tuple **result)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	struct swiss_index_core *hash_table = &index->hash_table;
+
+	if (new_tuple) {
+		uint32_t h = tuple_hash(new_tuple, base->def->key_def);
+		struct tuple *dup_tuple = NULL;
+		uint32_t pos = swiss_index_replace(hash_table, h, new_tuple,
+						   &dup_tuple);
+		if (pos == swiss_index_end)
+			pos = swiss_index_insert(hash_table, h, new_tuple);
+
+		ERROR_INJECT(ERRINJ_INDEX_ALLOC,
+		{
+			swiss_index_delete(hash_table, h, pos);
+			pos = swiss_index_end;
+		});
+
+		if (pos == swiss_index_end) {
+			diag_set(OutOfMemory, (ssize_t)hash_table->count,
+				 "hash_table", "key");
+			return -1;
+		}
+		uint32_t errcode = replace_check_dup(old_tuple,
+						     dup_tuple, mode);
+		if (errcode) {
+			swiss_index_delete(hash_table, h, pos);
+			if (dup_tuple) {
+				uint32_t pos = swiss_index_insert(hash_table,
+								  h, dup_tuple);
+				if (pos == swiss_index_end) {
+					panic("Failed to allocate memory in "
+					      "recover of int hash_table");
+				}
+			}
+			struct space *sp =
+				space_cache_find(base->def->space_id);
+			if (sp != NULL)
+				diag_set(ClientError, errcode, base->def->name,
+					 space_name(sp));
+			return -1;
+		}
+
+		if (dup_tuple) {
+			*result = dup_tuple;
+			return 0;
+		}
+	}
+
+	if (old_tuple) {
+		uint32_t h = tuple_hash(old_tuple, base->def->key_def);
+		int res = swiss_index_delete_value(hash_table, h, old_tuple);
+		assert(res == 0); (void) res;
+	}
+	*result = old_tuple;
+	return 0;
+}
+
+static struct iterator *
+memtx_swiss_index_create_iterator(struct index *base, enum iterator_type type,
+				  const char *key, uint32_t part_count)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+	struct swiss_index_core *hash_table = &index->hash_table;
+
+	assert(part_count == 0 || key != NULL);
+
+	struct hash_iterator *it = mempool_alloc(&memtx->iterator_pool);
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(struct hash_iterator),
+			 "memtx_swiss_index", "iterator");
+		return NULL;
+	}
+	iterator_create(&it->base, base);
+	it->pool = &memtx->iterator_pool;
+	it->base.free = hash_iterator_free;
+	swiss_index_iterator_begin(hash_table, &it->iterator);
+
+	switch (type) {
+	case ITER_GT:
+		if (part_count != 0) {
+			swiss_index_iterator_key(hash_table, &it->iterator,
+					key_hash(key, base->def->key_def), key);
+			it->base.next = hash_iterator_gt;
+		} else {
+			swiss_index_iterator_begin(hash_table, &it->iterator);
+			it->base.next = hash_iterator_ge;
+		}
+		break;
+	case ITER_ALL:
+		swiss_index_iterator_begin(hash_table, &it->iterator);
+		it->base.next = hash_iterator_ge;
+		break;
+	case ITER_EQ:
+		assert(part_count > 0);
+		swiss_index_iterator_key(hash_table, &it->iterator,
+				key_hash(key, base->def->key_def), key);
+		it->base.next = hash_iterator_eq;
+		break;
+	default:
+		diag_set(UnsupportedIndexFeature, base->def,
+			 "requested iterator type");
+		mempool_free(&memtx->iterator_pool, it);
+		return NULL;
+	}
+	return (struct iterator *)it;
+}
+
+struct hash_snapshot_iterator {
+	struct snapshot_iterator base;
+	struct memtx_swiss_index *index;
+	struct swiss_index_iterator iterator;
+	struct memtx_tx_snapshot_cleaner cleaner;
+	/** Format returned by memtx_enter_delayed_free_mode(). */
+	struct tuple_format *format;
+};
+
+/**
+ * Destroy read view and free snapshot iterator.
+ * Virtual method of snapshot iterator.
+ * @sa index_vtab::create_snapshot_iterator.
+ */
+static void
+hash_snapshot_iterator_free(struct snapshot_iterator *iterator)
+{
+	assert(iterator->free == hash_snapshot_iterator_free);
+	struct hash_snapshot_iterator *it =
+		(struct hash_snapshot_iterator *) iterator;
+	memtx_leave_delayed_free_mode((struct memtx_engine *)
+				      it->index->base.engine, it->format);
+	swiss_index_iterator_destroy(&it->index->hash_table, &it->iterator);
+	index_unref(&it->index->base);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
+	free(iterator);
+}
+
+/**
+ * Get next tuple from snapshot iterator.
+ * Virtual method of snapshot iterator.
+ * @sa index_vtab::create_snapshot_iterator.
+ */
+static int
+hash_snapshot_iterator_next(struct snapshot_iterator *iterator,
+			    const char **data, uint32_t *size)
+{
+	assert(iterator->free == hash_snapshot_iterator_free);
+	struct hash_snapshot_iterator *it =
+		(struct hash_snapshot_iterator *) iterator;
+	struct swiss_index_core *hash_table = &it->index->hash_table;
+	while (true) {
+		struct tuple **res =
+			swiss_index_iterator_get_and_next(hash_table,
+							  &it->iterator);
+		if (res == NULL) {
+			*data = NULL;
+			return 0;
+		}
+		struct tuple *tuple =
+			memtx_tx_snapshot_clarify(&it->cleaner, *res);
+		if (tuple != NULL) {
+			*data = tuple_data_range(tuple, size);
+			return 0;
+		}
+	}
+}
+
+/**
+ * Create an ALL iterator with personal read view so further
+ * index modifications will not affect the iteration results.
+ * Must be destroyed by iterator->free after usage.
+ */
+static struct snapshot_iterator *
+memtx_swiss_index_create_snapshot_iterator(struct index *base)
+{
+	struct memtx_swiss_index *index = (struct memtx_swiss_index *)base;
+	struct hash_snapshot_iterator *it = (struct hash_snapshot_iterator *)
+		calloc(1, sizeof(*it));
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(struct hash_snapshot_iterator),
+			 "memtx_swiss_index", "iterator");
+		return NULL;
+	}
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, base) != 0) {
+		free(it);
+		return NULL;
+	}
+
+	it->base.next = hash_snapshot_iterator_next;
+	it->base.free = hash_snapshot_iterator_free;
+	it->index = index;
+	index_ref(base);
+	swiss_index_iterator_begin(&index->hash_table, &it->iterator);
+	swiss_index_iterator_freeze(&index->hash_table, &it->iterator);
+	it->format = memtx_enter_delayed_free_mode(
+		(struct memtx_engine *)base->engine, base);
+	return (struct snapshot_iterator *) it;
+}
+
+static const struct index_vtab memtx_swiss_index_vtab = {
+	/* .destroy = */ memtx_swiss_index_destroy,
+	/* .commit_create = */ generic_index_commit_create,
+	/* .abort_create = */ generic_index_abort_create,
+	/* .commit_modify = */ generic_index_commit_modify,
+	/* .commit_drop = */ generic_index_commit_drop,
+	/* .update_def = */ memtx_swiss_index_update_def,
+	/* .depends_on_pk = */ generic_index_depends_on_pk,
+	/* .def_change_requires_rebuild = */
+		memtx_index_def_change_requires_rebuild,
+	/* .size = */ memtx_swiss_index_size,
+	/* .bsize = */ memtx_swiss_index_bsize,
+	/* .min = */ generic_index_min,
+	/* .max = */ generic_index_max,
+	/* .random = */ memtx_swiss_index_random,
+	/* .count = */ memtx_swiss_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
+	/* .get = */ memtx_swiss_index_get,
+	/* .get_batch = */ memtx_swiss_index_get_batch,
+	/* .replace = */ memtx_swiss_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
+	/* .create_iterator = */ memtx_swiss_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
+	/* .create_snapshot_iterator = */
+		memtx_swiss_index_create_snapshot_iterator,
+	/* .stat = */ generic_index_stat,
+	/* .compact = */ generic_index_compact,
+	/* .reset_stat = */ generic_index_reset_stat,
+	/* .begin_build = */ generic_index_begin_build,
+	/* .reserve = */ generic_index_reserve,
+	/* .build_next = */ generic_index_build_next,
+	/* .end_build = */ generic_index_end_build,
+};
+
+struct index *
+memtx_swiss_index_new(struct memtx_engine *memtx, struct index_def *def)
+{
+	struct memtx_swiss_index *index =
+		(struct memtx_swiss_index *)calloc(1, sizeof(*index));
+	if (index == NULL) {
+		diag_set(OutOfMemory, sizeof(*index),
+			 "malloc", "struct memtx_swiss_index");
+		return NULL;
+	}
+	if (index_create(&index->base, (struct engine *)memtx,
+			 &memtx_swiss_index_vtab, def) != 0) {
+		free(index);
+		return NULL;
+	}
+
+	swiss_index_create(&index->hash_table, MEMTX_EXTENT_SIZE,
+			   memtx_index_extent_alloc, memtx_index_extent_free,
+			   memtx, index->base.def->key_def);
+	return &index->base;
+}
+
+/* }}} */
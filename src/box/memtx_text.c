@@ -0,0 +1,1095 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_text.h"
+#include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "fiber.h"
+#include "index.h"
+#include "tuple.h"
+#include "assoc.h"
+#include "coll/text_tokenizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <small/mempool.h>
+
+/*
+ * Every indexed tuple is assigned a document id, a small integer
+ * reused after the tuple is deleted. For every word found in the
+ * indexed field of tuples, the index keeps a posting list, ids of
+ * documents containing the word in ascending order. Posting lists
+ * are split in blocks of up to TEXT_BLOCK_MAX ids. The first id
+ * of a block is stored as is and the rest as varint encoded
+ * deltas from the previous id, so that a posting list of a
+ * frequent word takes about a byte per document.
+ */
+
+enum {
+	/** Max number of document ids in a posting list block. */
+	TEXT_BLOCK_MAX = 128,
+	/** Max size of a varint encoded delta. */
+	TEXT_VARINT_MAX = 5,
+};
+
+/** A block of a posting list. */
+struct text_block {
+	/** Smallest document id in the block. */
+	uint32_t first;
+	/** Number of document ids in the block. */
+	uint32_t count;
+	/** Size of encoded deltas. */
+	uint32_t size;
+	/** Size of memory allocated for @a data. */
+	uint32_t capacity;
+	/** Varint encoded deltas of ids following the first one. */
+	char *data;
+};
+
+/** Posting list of a word. */
+struct text_posting {
+	/** Number of documents containing the word. */
+	uint32_t count;
+	/** Blocks sorted by the first document id. */
+	struct text_block *blocks;
+	uint32_t block_count;
+	uint32_t block_capacity;
+	/** Length of the word. */
+	uint32_t len;
+	/** The word, case folded, not zero terminated. */
+	char term[0];
+};
+
+struct text_doc_entry {
+	struct tuple *tuple;
+	uint32_t id;
+};
+
+#define mh_int_t uint32_t
+#define mh_arg_t int
+
+#if UINTPTR_MAX == 0xffffffff
+#define mh_hash_key(a, arg) ((uintptr_t)(a))
+#else
+#define mh_hash_key(a, arg) ((uint32_t)(((uintptr_t)(a)) >> 33 ^ ((uintptr_t)(a)) ^ ((uintptr_t)(a)) << 11))
+#endif
+#define mh_hash(a, arg) mh_hash_key((a)->tuple, arg)
+#define mh_cmp(a, b, arg) ((a)->tuple != (b)->tuple)
+#define mh_cmp_key(a, b, arg) ((a) != (b)->tuple)
+
+#define mh_node_t struct text_doc_entry
+#define mh_key_t struct tuple *
+#define mh_name _text_doc
+#define MH_SOURCE 1
+#include <salad/mhash.h>
+
+struct memtx_text_index {
+	struct index base;
+	/** Splits indexed strings and queries into words. */
+	struct text_tokenizer tokenizer;
+	/** Word => struct text_posting. */
+	struct mh_strnptr_t *terms;
+	/** Tuple => document id. */
+	struct mh_text_doc_t *doc_ids;
+	/** Document id => tuple, NULL for unused ids. */
+	struct tuple **docs;
+	/** Unused document ids less than @a doc_end. */
+	uint32_t *free_ids;
+	uint32_t free_count;
+	/** Number of document ids ever assigned. */
+	uint32_t doc_end;
+	/** Size of @a docs and @a free_ids. */
+	uint32_t doc_capacity;
+	/** Memory used by posting lists. */
+	size_t posting_bsize;
+	/**
+	 * Incremented on every change of the index, so that an
+	 * iterator can tell if its result may be stale.
+	 */
+	uint32_t version;
+};
+
+/* {{{ Posting lists **********************************************/
+
+static inline char *
+text_varint_encode(char *data, uint32_t value)
+{
+	while (value >= 0x80) {
+		*data++ = (char)((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	*data++ = (char)value;
+	return data;
+}
+
+static inline uint32_t
+text_varint_decode(const char **data)
+{
+	const unsigned char *p = (const unsigned char *)*data;
+	uint32_t value = 0;
+	int shift = 0;
+	while (*p & 0x80) {
+		value |= (uint32_t)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	value |= (uint32_t)*p++ << shift;
+	*data = (const char *)p;
+	return value;
+}
+
+/** Decode ids of a block, return their number. */
+static uint32_t
+text_block_decode(const struct text_block *block, uint32_t *ids)
+{
+	const char *data = block->data;
+	ids[0] = block->first;
+	for (uint32_t i = 1; i < block->count; i++)
+		ids[i] = ids[i - 1] + text_varint_decode(&data);
+	return block->count;
+}
+
+/**
+ * Encode ids to a block. Never fails if the encoded ids take
+ * no more memory than the block has.
+ */
+static int
+text_block_encode(struct memtx_text_index *index, struct text_block *block,
+		  const uint32_t *ids, uint32_t count)
+{
+	assert(count > 0 && count <= TEXT_BLOCK_MAX);
+	char buf[TEXT_BLOCK_MAX * TEXT_VARINT_MAX];
+	char *end = buf;
+	for (uint32_t i = 1; i < count; i++)
+		end = text_varint_encode(end, ids[i] - ids[i - 1]);
+	uint32_t size = end - buf;
+	if (size > block->capacity) {
+		char *data = realloc(block->data, size);
+		if (data == NULL) {
+			diag_set(OutOfMemory, size, "realloc",
+				 "posting list block");
+			return -1;
+		}
+		index->posting_bsize += size - block->capacity;
+		block->data = data;
+		block->capacity = size;
+	}
+	memcpy(block->data, buf, size);
+	block->first = ids[0];
+	block->count = count;
+	block->size = size;
+	return 0;
+}
+
+/** Return the position of the first id not less than @a id. */
+static uint32_t
+text_ids_lower_bound(const uint32_t *ids, uint32_t count, uint32_t id)
+{
+	uint32_t begin = 0, end = count;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (ids[mid] < id)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
+}
+
+/**
+ * Find the last block starting at or after @a from that may
+ * contain @a id, i.e. the last one with the first id not greater
+ * than @a id. Returns @a from if there's no such block.
+ */
+static uint32_t
+text_posting_find_block(const struct text_posting *posting, uint32_t from,
+			uint32_t id)
+{
+	uint32_t begin = from, end = posting->block_count;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (posting->blocks[mid].first <= id)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin > from ? begin - 1 : from;
+}
+
+/** Make room for @a count blocks in a posting list. */
+static int
+text_posting_reserve(struct memtx_text_index *index,
+		     struct text_posting *posting, uint32_t count)
+{
+	if (count <= posting->block_capacity)
+		return 0;
+	uint32_t capacity = MAX(posting->block_capacity * 2, 1);
+	struct text_block *blocks = realloc(posting->blocks,
+					    capacity * sizeof(*blocks));
+	if (blocks == NULL) {
+		diag_set(OutOfMemory, capacity * sizeof(*blocks), "realloc",
+			 "posting list");
+		return -1;
+	}
+	index->posting_bsize += (capacity - posting->block_capacity) *
+				sizeof(*blocks);
+	posting->blocks = blocks;
+	posting->block_capacity = capacity;
+	return 0;
+}
+
+/** Add a document id to a posting list unless it's there. */
+static int
+text_posting_insert(struct memtx_text_index *index,
+		    struct text_posting *posting, uint32_t id)
+{
+	if (posting->block_count == 0) {
+		if (text_posting_reserve(index, posting, 1) != 0)
+			return -1;
+		memset(&posting->blocks[0], 0, sizeof(posting->blocks[0]));
+		posting->blocks[0].first = id;
+		posting->blocks[0].count = 1;
+		posting->block_count = 1;
+		posting->count = 1;
+		return 0;
+	}
+	uint32_t i = text_posting_find_block(posting, 0, id);
+	uint32_t ids[TEXT_BLOCK_MAX + 1];
+	uint32_t count = text_block_decode(&posting->blocks[i], ids);
+	uint32_t pos = text_ids_lower_bound(ids, count, id);
+	if (pos < count && ids[pos] == id)
+		return 0;
+	memmove(ids + pos + 1, ids + pos, (count - pos) * sizeof(*ids));
+	ids[pos] = id;
+	count++;
+	if (count <= TEXT_BLOCK_MAX) {
+		if (text_block_encode(index, &posting->blocks[i],
+				      ids, count) != 0)
+			return -1;
+		posting->count++;
+		return 0;
+	}
+	/* Split the block in halves. */
+	if (text_posting_reserve(index, posting,
+				 posting->block_count + 1) != 0)
+		return -1;
+	struct text_block *block = &posting->blocks[i];
+	memmove(block + 2, block + 1,
+		(posting->block_count - i - 1) * sizeof(*block));
+	memset(block + 1, 0, sizeof(*block));
+	uint32_t half = count / 2;
+	if (text_block_encode(index, block + 1, ids + half,
+			      count - half) != 0) {
+		memmove(block + 1, block + 2,
+			(posting->block_count - i - 1) * sizeof(*block));
+		return -1;
+	}
+	posting->block_count++;
+	/* The first half takes less memory than the whole block. */
+	int rc = text_block_encode(index, block, ids, half);
+	assert(rc == 0);
+	(void)rc;
+	posting->count++;
+	return 0;
+}
+
+/** Remove a document id from a posting list if it's there. */
+static void
+text_posting_remove(struct memtx_text_index *index,
+		    struct text_posting *posting, uint32_t id)
+{
+	if (posting->block_count == 0)
+		return;
+	uint32_t i = text_posting_find_block(posting, 0, id);
+	struct text_block *block = &posting->blocks[i];
+	uint32_t ids[TEXT_BLOCK_MAX];
+	uint32_t count = text_block_decode(block, ids);
+	uint32_t pos = text_ids_lower_bound(ids, count, id);
+	if (pos == count || ids[pos] != id)
+		return;
+	posting->count--;
+	if (count == 1) {
+		index->posting_bsize -= block->capacity;
+		free(block->data);
+		memmove(block, block + 1,
+			(posting->block_count - i - 1) * sizeof(*block));
+		posting->block_count--;
+		return;
+	}
+	memmove(ids + pos, ids + pos + 1, (count - pos - 1) * sizeof(*ids));
+	/* Merged deltas never take more memory than separate ones. */
+	int rc = text_block_encode(index, block, ids, count - 1);
+	assert(rc == 0);
+	(void)rc;
+}
+
+/** Append all ids of a posting list to an array. */
+static uint32_t *
+text_posting_decode(const struct text_posting *posting, uint32_t *ids)
+{
+	for (uint32_t i = 0; i < posting->block_count; i++)
+		ids += text_block_decode(&posting->blocks[i], ids);
+	return ids;
+}
+
+/**
+ * Leave only ids contained in a posting list in a sorted array,
+ * return the number of ids left.
+ */
+static uint32_t
+text_posting_intersect(const struct text_posting *posting, uint32_t *ids,
+		       uint32_t count)
+{
+	uint32_t block_ids[TEXT_BLOCK_MAX];
+	uint32_t kept = 0, i = 0, b = 0;
+	while (i < count && b < posting->block_count) {
+		b = text_posting_find_block(posting, b, ids[i]);
+		uint32_t n = text_block_decode(&posting->blocks[b], block_ids);
+		uint64_t end = b + 1 < posting->block_count ?
+			       posting->blocks[b + 1].first : UINT64_MAX;
+		uint32_t j = 0;
+		for (; i < count && ids[i] < end; i++) {
+			while (j < n && block_ids[j] < ids[i])
+				j++;
+			if (j < n && block_ids[j] == ids[i])
+				ids[kept++] = ids[i];
+		}
+		b++;
+	}
+	return kept;
+}
+
+/** Check if a posting list contains a document id. */
+static bool
+text_posting_contains(const struct text_posting *posting, uint32_t id)
+{
+	uint32_t ids = id;
+	return text_posting_intersect(posting, &ids, 1) == 1;
+}
+
+static struct text_posting *
+memtx_text_index_find_posting(struct memtx_text_index *index,
+			      const char *term, uint32_t len)
+{
+	mh_int_t k = mh_strnptr_find_inp(index->terms, term, len);
+	if (k == mh_end(index->terms))
+		return NULL;
+	return mh_strnptr_node(index->terms, k)->val;
+}
+
+static void
+memtx_text_index_delete_posting(struct memtx_text_index *index,
+				struct text_posting *posting)
+{
+	mh_int_t k = mh_strnptr_find_inp(index->terms, posting->term,
+					 posting->len);
+	assert(k != mh_end(index->terms));
+	mh_strnptr_del(index->terms, k, NULL);
+	for (uint32_t i = 0; i < posting->block_count; i++) {
+		index->posting_bsize -= posting->blocks[i].capacity;
+		free(posting->blocks[i].data);
+	}
+	index->posting_bsize -= sizeof(*posting) + posting->len +
+				posting->block_capacity *
+				sizeof(*posting->blocks);
+	free(posting->blocks);
+	free(posting);
+}
+
+static struct text_posting *
+memtx_text_index_add_posting(struct memtx_text_index *index,
+			     const char *term, uint32_t len)
+{
+	size_t size = sizeof(struct text_posting) + len;
+	struct text_posting *posting = malloc(size);
+	if (posting == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "struct text_posting");
+		return NULL;
+	}
+	memset(posting, 0, sizeof(*posting));
+	posting->len = len;
+	memcpy(posting->term, term, len);
+	struct mh_strnptr_node_t node = {
+		posting->term, len, mh_strn_hash(term, len), posting
+	};
+	if (mh_strnptr_put(index->terms, &node, NULL, NULL) ==
+	    mh_end(index->terms)) {
+		free(posting);
+		diag_set(OutOfMemory, sizeof(node), "malloc", "text index");
+		return NULL;
+	}
+	index->posting_bsize += size;
+	return posting;
+}
+
+/* }}} */
+
+/* {{{ Documents **************************************************/
+
+static int
+memtx_text_index_register_doc(struct memtx_text_index *index,
+			      struct tuple *tuple, uint32_t *id)
+{
+	if (index->free_count == 0 && index->doc_end == index->doc_capacity) {
+		if (index->doc_capacity == UINT32_MAX) {
+			diag_set(OutOfMemory, 0, "text index", "document id");
+			return -1;
+		}
+		uint32_t capacity = index->doc_capacity < UINT32_MAX / 2 ?
+				    MAX(index->doc_capacity * 2, 64) :
+				    UINT32_MAX;
+		struct tuple **docs = realloc(index->docs,
+					      capacity * sizeof(*docs));
+		if (docs == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*docs),
+				 "realloc", "text index documents");
+			return -1;
+		}
+		index->docs = docs;
+		uint32_t *free_ids = realloc(index->free_ids,
+					     capacity * sizeof(*free_ids));
+		if (free_ids == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*free_ids),
+				 "realloc", "text index documents");
+			return -1;
+		}
+		index->free_ids = free_ids;
+		index->doc_capacity = capacity;
+	}
+	struct text_doc_entry entry;
+	entry.tuple = tuple;
+	entry.id = index->free_count > 0 ?
+		   index->free_ids[index->free_count - 1] : index->doc_end;
+	if (mh_text_doc_put(index->doc_ids, &entry, NULL, 0) ==
+	    mh_end(index->doc_ids)) {
+		diag_set(OutOfMemory, sizeof(entry), "malloc", "text index");
+		return -1;
+	}
+	if (index->free_count > 0)
+		index->free_count--;
+	else
+		index->doc_end++;
+	index->docs[entry.id] = tuple;
+	*id = entry.id;
+	return 0;
+}
+
+static void
+memtx_text_index_unregister_doc(struct memtx_text_index *index,
+				struct tuple *tuple, uint32_t id)
+{
+	mh_int_t k = mh_text_doc_find(index->doc_ids, tuple, 0);
+	assert(k != mh_end(index->doc_ids));
+	mh_text_doc_del(index->doc_ids, k, 0);
+	index->docs[id] = NULL;
+	index->free_ids[index->free_count++] = id;
+}
+
+/** Start splitting the indexed field of a tuple into words. */
+static int
+memtx_text_index_tokenize(struct memtx_text_index *index, struct tuple *tuple)
+{
+	const char *field = tuple_field_by_part(
+		tuple, index->base.def->key_def->parts, MULTIKEY_NONE);
+	const char *str = "";
+	uint32_t len = 0;
+	if (field != NULL && mp_typeof(*field) == MP_STR)
+		str = mp_decode_str(&field, &len);
+	return text_tokenizer_start(&index->tokenizer, str, len);
+}
+
+/**
+ * Remove a document id from posting lists of all words of
+ * a tuple. Can't fail, because the tokenizer was started on
+ * the tuple before, so it has enough memory.
+ */
+static void
+memtx_text_index_remove_doc(struct memtx_text_index *index,
+			    struct tuple *tuple, uint32_t id)
+{
+	if (memtx_text_index_tokenize(index, tuple) != 0) {
+		diag_log();
+		panic("failed to split text of a tuple removed from "
+		      "a text index");
+	}
+	const char *term;
+	uint32_t len;
+	while ((term = text_tokenizer_next(&index->tokenizer,
+					   &len)) != NULL) {
+		struct text_posting *posting =
+			memtx_text_index_find_posting(index, term, len);
+		if (posting == NULL)
+			continue;
+		text_posting_remove(index, posting, id);
+		if (posting->count == 0)
+			memtx_text_index_delete_posting(index, posting);
+	}
+}
+
+/** Add a document id to posting lists of all words of a tuple. */
+static int
+memtx_text_index_insert_doc(struct memtx_text_index *index,
+			    struct tuple *tuple, uint32_t id)
+{
+	if (memtx_text_index_tokenize(index, tuple) != 0)
+		return -1;
+	const char *term;
+	uint32_t len;
+	while ((term = text_tokenizer_next(&index->tokenizer,
+					   &len)) != NULL) {
+		struct text_posting *posting =
+			memtx_text_index_find_posting(index, term, len);
+		if (posting == NULL)
+			posting = memtx_text_index_add_posting(index, term,
+							       len);
+		if (posting == NULL ||
+		    text_posting_insert(index, posting, id) != 0) {
+			memtx_text_index_remove_doc(index, tuple, id);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static uint32_t
+memtx_text_index_doc_id(struct memtx_text_index *index, struct tuple *tuple)
+{
+	mh_int_t k = mh_text_doc_find(index->doc_ids, tuple, 0);
+	if (k == mh_end(index->doc_ids))
+		return UINT32_MAX;
+	return mh_text_doc_node(index->doc_ids, k)->id;
+}
+
+/* }}} */
+
+/* {{{ Search *****************************************************/
+
+static int
+text_id_cmp(const void *a, const void *b)
+{
+	uint32_t l = *(const uint32_t *)a;
+	uint32_t r = *(const uint32_t *)b;
+	return l < r ? -1 : l > r;
+}
+
+static int
+text_posting_cmp(const void *a, const void *b)
+{
+	const struct text_posting *l = *(const struct text_posting **)a;
+	const struct text_posting *r = *(const struct text_posting **)b;
+	return l->count < r->count ? -1 : l->count > r->count;
+}
+
+/**
+ * Find posting lists of all words of a query. A missing word is
+ * returned as NULL. The array is allocated on the fiber region.
+ */
+static struct text_posting **
+memtx_text_index_query_postings(struct memtx_text_index *index,
+				const char *query, uint32_t query_len,
+				uint32_t *count)
+{
+	struct text_tokenizer *tokenizer = &index->tokenizer;
+	if (text_tokenizer_start(tokenizer, query, query_len) != 0)
+		return NULL;
+	uint32_t len, n = 0;
+	while (text_tokenizer_next(tokenizer, &len) != NULL)
+		n++;
+	size_t size;
+	struct text_posting **postings = region_alloc_array(
+		&fiber()->gc, struct text_posting *, n + 1, &size);
+	if (postings == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array",
+			 "text index query");
+		return NULL;
+	}
+	*count = n;
+	if (text_tokenizer_start(tokenizer, query, query_len) != 0)
+		return NULL;
+	const char *term;
+	for (uint32_t i = 0; i < n; i++) {
+		term = text_tokenizer_next(tokenizer, &len);
+		assert(term != NULL);
+		postings[i] = memtx_text_index_find_posting(index, term, len);
+	}
+	return postings;
+}
+
+/**
+ * Find ids of documents matching a query. The result is sorted
+ * and allocated with malloc().
+ */
+static int
+memtx_text_index_search(struct memtx_text_index *index,
+			enum iterator_type type, const char *query,
+			uint32_t query_len, uint32_t **result,
+			uint32_t *result_count)
+{
+	*result = NULL;
+	*result_count = 0;
+	uint32_t *ids;
+	if (type == ITER_ALL) {
+		uint32_t count = index->doc_end - index->free_count;
+		ids = malloc(MAX(count, 1) * sizeof(*ids));
+		if (ids == NULL)
+			goto oom;
+		uint32_t n = 0;
+		for (uint32_t id = 0; id < index->doc_end; id++) {
+			if (index->docs[id] != NULL)
+				ids[n++] = id;
+		}
+		assert(n == count);
+		*result = ids;
+		*result_count = n;
+		return 0;
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t term_count;
+	struct text_posting **postings = memtx_text_index_query_postings(
+		index, query, query_len, &term_count);
+	if (postings == NULL)
+		return -1;
+	if (type == ITER_BITS_ANY_SET) {
+		/* Merge posting lists of all words. */
+		size_t total = 0;
+		for (uint32_t i = 0; i < term_count; i++) {
+			if (postings[i] != NULL)
+				total += postings[i]->count;
+		}
+		ids = malloc(MAX(total, 1) * sizeof(*ids));
+		if (ids == NULL)
+			goto oom_region;
+		uint32_t *end = ids;
+		for (uint32_t i = 0; i < term_count; i++) {
+			if (postings[i] != NULL)
+				end = text_posting_decode(postings[i], end);
+		}
+		uint32_t count = end - ids;
+		qsort(ids, count, sizeof(*ids), text_id_cmp);
+		uint32_t n = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			if (n == 0 || ids[n - 1] != ids[i])
+				ids[n++] = ids[i];
+		}
+		*result = ids;
+		*result_count = n;
+		region_truncate(region, region_svp);
+		return 0;
+	}
+	/* Intersect posting lists starting from the shortest one. */
+	assert(type == ITER_EQ || type == ITER_BITS_ALL_SET);
+	for (uint32_t i = 0; i < term_count; i++) {
+		if (postings[i] == NULL) {
+			region_truncate(region, region_svp);
+			return 0;
+		}
+	}
+	if (term_count == 0) {
+		region_truncate(region, region_svp);
+		return 0;
+	}
+	qsort(postings, term_count, sizeof(*postings), text_posting_cmp);
+	ids = malloc(postings[0]->count * sizeof(*ids));
+	if (ids == NULL)
+		goto oom_region;
+	uint32_t count = text_posting_decode(postings[0], ids) - ids;
+	for (uint32_t i = 1; i < term_count && count > 0; i++)
+		count = text_posting_intersect(postings[i], ids, count);
+	*result = ids;
+	*result_count = count;
+	region_truncate(region, region_svp);
+	return 0;
+oom_region:
+	region_truncate(region, region_svp);
+oom:
+	diag_set(OutOfMemory, index->doc_end * sizeof(*ids), "malloc",
+		 "text index search result");
+	return -1;
+}
+
+/**
+ * Check if a document still matches a query. Used by iterators
+ * after the index is changed.
+ */
+static int
+memtx_text_index_match(struct memtx_text_index *index,
+		       enum iterator_type type, const char *query,
+		       uint32_t query_len, uint32_t id, bool *match)
+{
+	*match = index->docs[id] != NULL;
+	if (!*match || type == ITER_ALL)
+		return 0;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t term_count;
+	struct text_posting **postings = memtx_text_index_query_postings(
+		index, query, query_len, &term_count);
+	if (postings == NULL)
+		return -1;
+	bool any = type == ITER_BITS_ANY_SET;
+	*match = !any;
+	for (uint32_t i = 0; i < term_count; i++) {
+		bool found = postings[i] != NULL &&
+			     text_posting_contains(postings[i], id);
+		if (found == any) {
+			*match = any;
+			break;
+		}
+	}
+	region_truncate(region, region_svp);
+	return 0;
+}
+
+/* }}} */
+
+/* {{{ Iterator ***************************************************/
+
+struct memtx_text_iterator {
+	struct iterator base;
+	/** Memory pool the iterator was allocated from. */
+	struct mempool *pool;
+	/** Ids of documents matching the query in ascending order. */
+	uint32_t *ids;
+	uint32_t count;
+	/** Position of the next id to return. */
+	uint32_t pos;
+	/** Version of the index the result was found at. */
+	uint32_t version;
+	enum iterator_type type;
+	/** Copy of the query, NULL for ITER_ALL. */
+	char *query;
+	uint32_t query_len;
+};
+
+static_assert(sizeof(struct memtx_text_iterator) <= MEMTX_ITERATOR_SIZE,
+	      "sizeof(struct memtx_text_iterator) must be less than or equal "
+	      "to MEMTX_ITERATOR_SIZE");
+
+static void
+memtx_text_iterator_free(struct iterator *iterator)
+{
+	struct memtx_text_iterator *it =
+		(struct memtx_text_iterator *)iterator;
+	free(it->ids);
+	free(it->query);
+	mempool_free(it->pool, it);
+}
+
+static int
+memtx_text_iterator_next(struct iterator *iterator, struct tuple **ret)
+{
+	struct memtx_text_iterator *it =
+		(struct memtx_text_iterator *)iterator;
+	struct memtx_text_index *index =
+		(struct memtx_text_index *)iterator->index;
+	*ret = NULL;
+	while (*ret == NULL && it->pos < it->count) {
+		uint32_t id = it->ids[it->pos++];
+		/*
+		 * A document may have been deleted or changed
+		 * since the result was found.
+		 */
+		if (it->version != index->version) {
+			bool match;
+			if (memtx_text_index_match(index, it->type, it->query,
+						   it->query_len, id,
+						   &match) != 0)
+				return -1;
+			if (!match)
+				continue;
+		}
+		*ret = index->docs[id];
+		if (memtx_tx_tuple_clarify(iterator->index, ret) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* }}} */
+
+/* {{{ Index API **************************************************/
+
+static void
+memtx_text_index_destroy(struct index *base)
+{
+	struct memtx_text_index *index = (struct memtx_text_index *)base;
+	mh_int_t k;
+	while ((k = mh_first(index->terms)) != mh_end(index->terms)) {
+		memtx_text_index_delete_posting(
+			index, mh_strnptr_node(index->terms, k)->val);
+	}
+	mh_strnptr_delete(index->terms);
+	mh_text_doc_delete(index->doc_ids);
+	free(index->docs);
+	free(index->free_ids);
+	text_tokenizer_destroy(&index->tokenizer);
+	free(index);
+}
+
+static ssize_t
+memtx_text_index_size(struct index *base)
+{
+	struct memtx_text_index *index = (struct memtx_text_index *)base;
+	return index->doc_end - index->free_count;
+}
+
+static ssize_t
+memtx_text_index_bsize(struct index *base)
+{
+	struct memtx_text_index *index = (struct memtx_text_index *)base;
+	return index->posting_bsize +
+	       mh_strnptr_memsize(index->terms) +
+	       mh_text_doc_memsize(index->doc_ids) +
+	       (size_t)index->doc_capacity *
+	       (sizeof(*index->docs) + sizeof(*index->free_ids));
+}
+
+static int
+memtx_text_index_replace(struct index *base, struct tuple *old_tuple,
+			 struct tuple *new_tuple, enum dup_replace_mode mode,
+			 struct tuple **result)
+{
+	struct memtx_text_index *index = (struct memtx_text_index *)base;
+	assert(!base->def->opts.is_unique);
+	assert(old_tuple != NULL || new_tuple != NULL);
+	(void)mode;
+	*result = NULL;
+	uint32_t old_id = UINT32_MAX;
+	if (old_tuple != NULL) {
+		old_id = memtx_text_index_doc_id(index, old_tuple);
+		/*
+		 * Reserve tokenizer memory for the old tuple, so
+		 * that removing it can't fail.
+		 */
+		if (old_id != UINT32_MAX &&
+		    memtx_text_index_tokenize(index, old_tuple) != 0)
+			return -1;
+	}
+	if (new_tuple != NULL) {
+		uint32_t new_id;
+		if (memtx_text_index_register_doc(index, new_tuple,
+						  &new_id) != 0)
+			return -1;
+		if (memtx_text_index_insert_doc(index, new_tuple,
+						new_id) != 0) {
+			memtx_text_index_unregister_doc(index, new_tuple,
+							new_id);
+			return -1;
+		}
+	}
+	if (old_id != UINT32_MAX) {
+		memtx_text_index_remove_doc(index, old_tuple, old_id);
+		memtx_text_index_unregister_doc(index, old_tuple, old_id);
+		*result = old_tuple;
+	}
+	index->version++;
+	return 0;
+}
+
+/**
+ * The indexed field is the same, so the document id of the old
+ * tuple is reassigned to the new one, and posting lists are not
+ * touched.
+ */
+static int
+memtx_text_index_replace_unchanged(struct index *base,
+				   struct tuple *old_tuple,
+				   struct tuple *new_tuple)
+{
+	struct memtx_text_index *index = (struct memtx_text_index *)base;
+	uint32_t id = memtx_text_index_doc_id(index, old_tuple);
+	if (id == UINT32_MAX)
+		return generic_index_replace_unchanged(base, old_tuple,
+						       new_tuple);
+	struct text_doc_entry entry;
+	entry.id = id;
+	entry.tuple = new_tuple;
+	if (mh_text_doc_put(index->doc_ids, &entry, NULL, 0) ==
+	    mh_end(index->doc_ids)) {
+		diag_set(OutOfMemory, sizeof(entry), "malloc", "text index");
+		return -1;
+	}
+	/* The hash could be resized, look the old tuple up again. */
+	mh_int_t k = mh_text_doc_find(index->doc_ids, old_tuple, 0);
+	mh_text_doc_del(index->doc_ids, k, 0);
+	index->docs[id] = new_tuple;
+	return 0;
+}
+
+static struct iterator *
+memtx_text_index_create_iterator(struct index *base, enum iterator_type type,
+				 const char *key, uint32_t part_count)
+{
+	struct memtx_text_index *index = (struct memtx_text_index *)base;
+	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+	switch (type) {
+	case ITER_ALL:
+	case ITER_EQ:
+	case ITER_BITS_ALL_SET:
+	case ITER_BITS_ANY_SET:
+		break;
+	default:
+		diag_set(UnsupportedIndexFeature, base->def,
+			 "requested iterator type");
+		return NULL;
+	}
+	const char *query = NULL;
+	uint32_t query_len = 0;
+	if (type != ITER_ALL) {
+		assert(part_count == 1); /* checked by key_validate() */
+		(void)part_count;
+		query = mp_decode_str(&key, &query_len);
+	}
+	struct memtx_text_iterator *it = mempool_alloc(&memtx->iterator_pool);
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(*it),
+			 "memtx_text_index", "iterator");
+		return NULL;
+	}
+	iterator_create(&it->base, base);
+	it->pool = &memtx->iterator_pool;
+	it->base.next = memtx_text_iterator_next;
+	it->base.free = memtx_text_iterator_free;
+	it->type = type;
+	it->pos = 0;
+	it->version = index->version;
+	it->query = NULL;
+	it->query_len = query_len;
+	if (query != NULL) {
+		it->query = malloc(MAX(query_len, 1));
+		if (it->query == NULL) {
+			diag_set(OutOfMemory, query_len, "malloc",
+				 "text index query");
+			mempool_free(it->pool, it);
+			return NULL;
+		}
+		memcpy(it->query, query, query_len);
+	}
+	if (memtx_text_index_search(index, type, query, query_len,
+				    &it->ids, &it->count) != 0) {
+		free(it->query);
+		mempool_free(it->pool, it);
+		return NULL;
+	}
+	return &it->base;
+}
+
+static ssize_t
+memtx_text_index_count(struct index *base, enum iterator_type type,
+		       const char *key, uint32_t part_count)
+{
+	struct memtx_text_index *index = (struct memtx_text_index *)base;
+	if (type == ITER_ALL)
+		return memtx_text_index_size(base);
+	if (memtx_tx_manager_use_mvcc_engine)
+		return generic_index_count(base, type, key, part_count);
+	if (type != ITER_EQ && type != ITER_BITS_ALL_SET &&
+	    type != ITER_BITS_ANY_SET) {
+		diag_set(UnsupportedIndexFeature, base->def,
+			 "requested iterator type");
+		return -1;
+	}
+	assert(part_count == 1); /* checked by key_validate() */
+	uint32_t query_len;
+	const char *query = mp_decode_str(&key, &query_len);
+	uint32_t *ids, count;
+	if (memtx_text_index_search(index, type, query, query_len,
+				    &ids, &count) != 0)
+		return -1;
+	free(ids);
+	return count;
+}
+
+static const struct index_vtab memtx_text_index_vtab = {
+	/* .destroy = */ memtx_text_index_destroy,
+	/* .commit_create = */ generic_index_commit_create,
+	/* .abort_create = */ generic_index_abort_create,
+	/* .commit_modify = */ generic_index_commit_modify,
+	/* .commit_drop = */ generic_index_commit_drop,
+	/* .update_def = */ generic_index_update_def,
+	/* .depends_on_pk = */ generic_index_depends_on_pk,
+	/* .def_change_requires_rebuild = */
+		memtx_index_def_change_requires_rebuild,
+	/* .size = */ memtx_text_index_size,
+	/* .bsize = */ memtx_text_index_bsize,
+	/* .min = */ generic_index_min,
+	/* .max = */ generic_index_max,
+	/* .random = */ generic_index_random,
+	/* .count = */ memtx_text_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
+	/* .get = */ generic_index_get,
+	/* .get_batch = */ generic_index_get_batch,
+	/* .replace = */ memtx_text_index_replace,
+	/* .replace_unchanged = */ memtx_text_index_replace_unchanged,
+	/* .create_iterator = */ memtx_text_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
+	/* .create_snapshot_iterator = */
+		generic_index_create_snapshot_iterator,
+	/* .stat = */ generic_index_stat,
+	/* .compact = */ generic_index_compact,
+	/* .reset_stat = */ generic_index_reset_stat,
+	/* .begin_build = */ generic_index_begin_build,
+	/* .reserve = */ generic_index_reserve,
+	/* .build_next = */ generic_index_build_next,
+	/* .end_build = */ generic_index_end_build,
+};
+
+struct index *
+memtx_text_index_new(struct memtx_engine *memtx, struct index_def *def)
+{
+	assert(def->iid > 0);
+	assert(!def->opts.is_unique);
+
+	struct memtx_text_index *index = calloc(1, sizeof(*index));
+	if (index == NULL) {
+		diag_set(OutOfMemory, sizeof(*index),
+			 "malloc", "struct memtx_text_index");
+		return NULL;
+	}
+	if (text_tokenizer_create(&index->tokenizer) != 0) {
+		free(index);
+		return NULL;
+	}
+	if (index_create(&index->base, (struct engine *)memtx,
+			 &memtx_text_index_vtab, def) != 0) {
+		text_tokenizer_destroy(&index->tokenizer);
+		free(index);
+		return NULL;
+	}
+	index->terms = mh_strnptr_new();
+	index->doc_ids = mh_text_doc_new();
+	if (index->terms == NULL || index->doc_ids == NULL)
+		panic("failed to allocate memtx text index");
+	return &index->base;
+}
+
+/* }}} */
@@ -30,6 +30,7 @@
  */
 #include "memtx_tree.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
@@ -87,6 +88,7 @@ memtx_tree_data_is_equal(const struct memtx_tree_data *a,
 			       (b)->part_count, (b)->hint, arg)
 #define BPS_TREE_IS_IDENTICAL(a, b) memtx_tree_data_is_equal(&a, &b)
 #define BPS_TREE_NO_DEBUG 1
+#define BPS_INNER_CARD
 #define bps_tree_elem_t struct memtx_tree_data
 #define bps_tree_key_t struct memtx_tree_key_data *
 #define bps_tree_arg_t struct key_def *
@@ -100,10 +102,60 @@ memtx_tree_data_is_equal(const struct memtx_tree_data *a,
 #undef BPS_TREE_COMPARE_KEY
 #undef BPS_TREE_IS_IDENTICAL
 #undef BPS_TREE_NO_DEBUG
+#undef BPS_INNER_CARD
 #undef bps_tree_elem_t
 #undef bps_tree_key_t
 #undef bps_tree_arg_t
 
+/** Number of tuples with the same key, see index_opts::count_keys. */
+struct memtx_tree_key_count {
+	/** Key parts with MessagePack array header. */
+	char *key;
+	/** Number of tuples in the index with this key. */
+	size_t count;
+	/** Hash of the key, see key_hash(). */
+	uint32_t hash;
+};
+
+/** Lookup key of a key count: either a tuple or a key. */
+struct memtx_tree_key_count_key {
+	/** Tuple to look up the key of or NULL. */
+	struct tuple *tuple;
+	/** Key parts with MessagePack array header if tuple is NULL. */
+	const char *key;
+	/** Hash of the key, see tuple_hash(), key_hash(). */
+	uint32_t hash;
+};
+
+static inline int
+memtx_tree_key_count_cmp_key(const struct memtx_tree_key_count_key *a,
+			     const struct memtx_tree_key_count *b,
+			     struct key_def *key_def)
+{
+	if (a->hash != b->hash)
+		return 1;
+	if (a->tuple == NULL)
+		return key_compare(a->key, HINT_NONE, b->key, HINT_NONE,
+				   key_def) != 0;
+	const char *key = b->key;
+	uint32_t part_count = mp_decode_array(&key);
+	return tuple_compare_with_key(a->tuple, HINT_NONE, key, part_count,
+				      HINT_NONE, key_def) != 0;
+}
+
+#define mh_int_t uint32_t
+#define mh_arg_t struct key_def *
+#define mh_hash(a, arg) ((a)->hash)
+#define mh_hash_key(a, arg) ((a)->hash)
+#define mh_cmp(a, b, arg) \
+	(key_compare((a)->key, HINT_NONE, (b)->key, HINT_NONE, arg) != 0)
+#define mh_cmp_key(a, b, arg) memtx_tree_key_count_cmp_key(a, b, arg)
+#define mh_node_t struct memtx_tree_key_count
+#define mh_key_t const struct memtx_tree_key_count_key *
+#define mh_name _tree_key_count
+#define MH_SOURCE 1
+#include <salad/mhash.h>
+
 struct memtx_tree_index {
 	struct index base;
 	struct memtx_tree tree;
@@ -111,6 +163,11 @@ struct memtx_tree_index {
 	size_t build_array_size, build_array_alloc_size;
 	struct memtx_gc_task gc_task;
 	struct memtx_tree_iterator gc_iterator;
+	/**
+	 * Number of tuples per full key if the count_keys
+	 * option is set, NULL otherwise.
+	 */
+	struct mh_tree_key_count_t *key_counts;
 };
 
 /* {{{ Utilities. *************************************************/
@@ -131,6 +188,101 @@ memtx_tree_qcompare(const void* a, const void *b, void *c)
 			     data_b->hint, key_def);
 }
 
+/** Count a tuple inserted into the index by its key. */
+static int
+memtx_tree_index_count_key_add(struct memtx_tree_index *index,
+			       struct tuple *tuple)
+{
+	struct mh_tree_key_count_t *h = index->key_counts;
+	struct key_def *key_def = index->base.def->key_def;
+	struct memtx_tree_key_count_key key;
+	key.tuple = tuple;
+	key.key = NULL;
+	key.hash = tuple_hash(tuple, key_def);
+	mh_int_t k = mh_tree_key_count_find(h, &key, key_def);
+	if (k != mh_end(h)) {
+		mh_tree_key_count_node(h, k)->count++;
+		return 0;
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t size;
+	const char *data = tuple_extract_key(tuple, key_def, MULTIKEY_NONE,
+					     &size);
+	if (data == NULL)
+		return -1;
+	struct memtx_tree_key_count node;
+	node.key = malloc(size);
+	if (node.key == NULL) {
+		region_truncate(region, region_svp);
+		diag_set(OutOfMemory, size, "malloc", "key");
+		return -1;
+	}
+	memcpy(node.key, data, size);
+	region_truncate(region, region_svp);
+	node.count = 1;
+	node.hash = key.hash;
+	if (mh_tree_key_count_put(h, &node, NULL, key_def) == mh_end(h)) {
+		free(node.key);
+		diag_set(OutOfMemory, sizeof(node), "mhash", "key_counts");
+		return -1;
+	}
+	return 0;
+}
+
+/** Uncount a tuple deleted from the index. Never fails. */
+static void
+memtx_tree_index_count_key_remove(struct memtx_tree_index *index,
+				  struct tuple *tuple)
+{
+	struct mh_tree_key_count_t *h = index->key_counts;
+	struct key_def *key_def = index->base.def->key_def;
+	struct memtx_tree_key_count_key key;
+	key.tuple = tuple;
+	key.key = NULL;
+	key.hash = tuple_hash(tuple, key_def);
+	mh_int_t k = mh_tree_key_count_find(h, &key, key_def);
+	assert(k != mh_end(h));
+	struct memtx_tree_key_count *node = mh_tree_key_count_node(h, k);
+	assert(node->count > 0);
+	if (--node->count == 0) {
+		free(node->key);
+		mh_tree_key_count_del(h, k, key_def);
+	}
+}
+
+/**
+ * Look up the number of tuples with the given full key.
+ * The key is given without MessagePack array header.
+ */
+static ssize_t
+memtx_tree_index_count_key_find(struct memtx_tree_index *index,
+				const char *key, uint32_t part_count)
+{
+	struct mh_tree_key_count_t *h = index->key_counts;
+	struct key_def *key_def = index->base.def->key_def;
+	const char *key_end = key;
+	for (uint32_t i = 0; i < part_count; i++)
+		mp_next(&key_end);
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size_t size = mp_sizeof_array(part_count) + (key_end - key);
+	char *data = region_alloc(region, size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "key");
+		return -1;
+	}
+	memcpy(mp_encode_array(data, part_count), key, key_end - key);
+	struct memtx_tree_key_count_key lookup;
+	lookup.tuple = NULL;
+	lookup.key = data;
+	lookup.hash = key_hash(key, key_def);
+	mh_int_t k = mh_tree_key_count_find(h, &lookup, key_def);
+	region_truncate(region, region_svp);
+	return k != mh_end(h) ? (ssize_t)mh_tree_key_count_node(h, k)->count :
+				0;
+}
+
 /* {{{ MemtxTree Iterators ****************************************/
 struct tree_iterator {
 	struct iterator base;
@@ -391,6 +543,84 @@ tree_iterator_start(struct iterator *iterator, struct tuple **ret)
 	return 0;
 }
 
+/**
+ * Skip tuples of a not started iterator by positioning it with
+ * help of subtree cardinalities instead of stepping over them.
+ * A started iterator may have been invalidated by a concurrent
+ * change of the tree, so it is stepped as usual.
+ */
+static int
+tree_iterator_skip(struct iterator *iterator, uint32_t count)
+{
+	struct memtx_tree_index *index =
+		(struct memtx_tree_index *)iterator->index;
+	struct tree_iterator *it = tree_iterator(iterator);
+	struct memtx_tree *tree = &index->tree;
+	if (iterator->next != tree_iterator_start) {
+		struct tuple *tuple;
+		for (; count > 0; count--) {
+			if (iterator->next(iterator, &tuple) != 0)
+				return -1;
+			if (tuple == NULL)
+				break;
+		}
+		return 0;
+	}
+	if (count == 0)
+		return 0;
+	/* Range [begin, end) of offsets of matching tuples. */
+	size_t begin = 0;
+	size_t end = memtx_tree_size(tree);
+	if (it->key_data.key != NULL) {
+		switch (it->type) {
+		case ITER_EQ:
+		case ITER_REQ:
+			begin = memtx_tree_lower_bound_offset(tree,
+						&it->key_data, NULL);
+			end = memtx_tree_upper_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_ALL:
+		case ITER_GE:
+			begin = memtx_tree_lower_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_GT:
+			begin = memtx_tree_upper_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_LT:
+			end = memtx_tree_lower_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_LE:
+			end = memtx_tree_upper_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		default:
+			unreachable();
+		}
+	}
+	if (end - begin <= count) {
+		iterator->next = tree_iterator_dummie;
+		return 0;
+	}
+	/*
+	 * Position the iterator at the last skipped tuple, as if
+	 * it was just returned, so that next() continues from it.
+	 */
+	size_t offset = iterator_type_is_reverse(it->type) ?
+			end - count : begin + count - 1;
+	it->tree_iterator = memtx_tree_iterator_at(tree, offset);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(tree, &it->tree_iterator);
+	assert(res != NULL);
+	tuple_ref(res->tuple);
+	it->current = *res;
+	tree_iterator_set_next_method(it);
+	return 0;
+}
+
 /* }}} */
 
 /* {{{ MemtxTree  **********************************************************/
@@ -400,6 +630,13 @@ memtx_tree_index_free(struct memtx_tree_index *index)
 {
 	memtx_tree_destroy(&index->tree);
 	free(index->build_array);
+	if (index->key_counts != NULL) {
+		struct mh_tree_key_count_t *h = index->key_counts;
+		mh_int_t k;
+		mh_foreach(h, k)
+			free(mh_tree_key_count_node(h, k)->key);
+		mh_tree_key_count_delete(h);
+	}
 	free(index);
 }
 
@@ -505,7 +742,10 @@ static ssize_t
 memtx_tree_index_bsize(struct index *base)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	return memtx_tree_mem_used(&index->tree);
+	ssize_t bsize = memtx_tree_mem_used(&index->tree);
+	if (index->key_counts != NULL)
+		bsize += mh_tree_key_count_memsize(index->key_counts);
+	return bsize;
 }
 
 static int
@@ -521,9 +761,105 @@ static ssize_t
 memtx_tree_index_count(struct index *base, enum iterator_type type,
 		       const char *key, uint32_t part_count)
 {
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
 	if (type == ITER_ALL)
 		return memtx_tree_index_size(base); /* optimization */
-	return generic_index_count(base, type, key, part_count);
+	/*
+	 * Subtree cardinalities reflect the latest versions of all
+	 * tuples, so they can't be used if a transaction may see
+	 * a different set of tuples. Multikey and functional
+	 * indexes store a tuple more than once.
+	 */
+	if (memtx_tx_manager_use_mvcc_engine || type > ITER_GT ||
+	    cmp_def->is_multikey || cmp_def->for_func_index)
+		return generic_index_count(base, type, key, part_count);
+	if (part_count == 0)
+		return memtx_tree_index_size(base);
+	if (index->key_counts != NULL &&
+	    (type == ITER_EQ || type == ITER_REQ) &&
+	    part_count == base->def->key_def->part_count)
+		return memtx_tree_index_count_key_find(index, key, part_count);
+	struct memtx_tree_key_data key_data;
+	key_data.key = key;
+	key_data.part_count = part_count;
+	key_data.hint = key_hint(key, part_count, cmp_def);
+	size_t size = memtx_tree_size(&index->tree);
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		return memtx_tree_upper_bound_offset(&index->tree, &key_data,
+						     NULL) -
+		       memtx_tree_lower_bound_offset(&index->tree, &key_data,
+						     NULL);
+	case ITER_GE:
+		return size - memtx_tree_lower_bound_offset(&index->tree,
+							    &key_data, NULL);
+	case ITER_GT:
+		return size - memtx_tree_upper_bound_offset(&index->tree,
+							    &key_data, NULL);
+	case ITER_LE:
+		return memtx_tree_upper_bound_offset(&index->tree, &key_data,
+						     NULL);
+	case ITER_LT:
+		return memtx_tree_lower_bound_offset(&index->tree, &key_data,
+						     NULL);
+	default:
+		unreachable();
+	}
+	return 0;
+}
+
+static int
+memtx_tree_index_estimate_eq(struct index *base, uint64_t *eq)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *key_def = base->def->key_def;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	uint32_t part_count = key_def->part_count;
+	if (memtx_tree_size(&index->tree) == 0)
+		return -1;
+	/*
+	 * Take a few tuples spread over the tree and look up
+	 * approximate counts of their key prefixes. Those are
+	 * computed from block occupancy at no cost of a scan.
+	 * The sum of inverted counts is used rather than the
+	 * average of counts so that an estimate isn't spoiled
+	 * by a few heavy keys.
+	 */
+	enum { SAMPLE_COUNT = 32 };
+	double inv_sum[part_count];
+	memset(inv_sum, 0, sizeof(inv_sum));
+	struct region *region = &fiber()->gc;
+	for (uint32_t s = 0; s < SAMPLE_COUNT; s++) {
+		uint32_t rnd = (uint32_t)((s + 1) * 0x9E3779B97F4A7C15ULL >> 32);
+		struct memtx_tree_data *res =
+			memtx_tree_random(&index->tree, rnd);
+		if (res == NULL)
+			return -1;
+		size_t region_svp = region_used(region);
+		const char *key = tuple_extract_key(res->tuple, key_def,
+						    MULTIKEY_NONE, NULL);
+		if (key == NULL) {
+			diag_clear(diag_get());
+			region_truncate(region, region_svp);
+			return -1;
+		}
+		mp_decode_array(&key);
+		for (uint32_t i = 0; i < part_count; i++) {
+			struct memtx_tree_key_data key_data;
+			key_data.key = key;
+			key_data.part_count = i + 1;
+			key_data.hint = key_hint(key, i + 1, cmp_def);
+			size_t count = memtx_tree_approximate_count(
+				&index->tree, &key_data);
+			inv_sum[i] += 1.0 / MAX(count, 1);
+		}
+		region_truncate(region, region_svp);
+	}
+	for (uint32_t i = 0; i < part_count; i++)
+		eq[i] = MAX((uint64_t)(SAMPLE_COUNT / inv_sum[i]), 1);
+	return 0;
 }
 
 static int
@@ -540,6 +876,53 @@ memtx_tree_index_get(struct index *base, const char *key,
 	key_data.hint = key_hint(key, part_count, cmp_def);
 	struct memtx_tree_data *res = memtx_tree_find(&index->tree, &key_data);
 	*result = res != NULL ? res->tuple : NULL;
+	return memtx_tx_tuple_clarify(base, result);
+}
+
+static int
+memtx_tree_index_get_batch(struct index *base, const char *keys,
+			   uint32_t key_count, struct tuple **result)
+{
+	assert(base->def->opts.is_unique);
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	/*
+	 * Descend the tree for a few keys at once, see
+	 * memtx_tree_find_batch().
+	 */
+	enum { BATCH_SIZE = 16 };
+	struct memtx_tree_key_data key_data[BATCH_SIZE];
+	struct memtx_tree_key_data *batch_keys[BATCH_SIZE];
+	struct memtx_tree_data *found[BATCH_SIZE];
+	const char *key = keys;
+	for (uint32_t start = 0; start < key_count; start += BATCH_SIZE) {
+		uint32_t count = MIN(key_count - start, (uint32_t)BATCH_SIZE);
+		for (uint32_t i = 0; i < count; i++) {
+			const char *next_key = key;
+			mp_next(&next_key);
+			uint32_t part_count = mp_decode_array(&key);
+			assert(part_count == base->def->key_def->part_count);
+			key_data[i].key = key;
+			key_data[i].part_count = part_count;
+			key_data[i].hint = key_hint(key, part_count, cmp_def);
+			batch_keys[i] = &key_data[i];
+			key = next_key;
+		}
+		memtx_tree_find_batch(&index->tree, batch_keys, count, found);
+		for (uint32_t i = 0; i < count; i++) {
+			struct tuple **tuple = &result[start + i];
+			*tuple = found[i] != NULL ? found[i]->tuple : NULL;
+			if (memtx_tx_tuple_clarify(base, tuple) != 0) {
+				for (uint32_t j = 0; j < start + i; j++) {
+					if (result[j] != NULL)
+						tuple_unref(result[j]);
+				}
+				return -1;
+			}
+			if (*tuple != NULL)
+				tuple_ref(*tuple);
+		}
+	}
 	return 0;
 }
 
@@ -550,6 +933,7 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	bool count_keys = index->key_counts != NULL;
 	if (new_tuple) {
 		struct memtx_tree_data new_data;
 		new_data.tuple = new_tuple;
@@ -557,10 +941,18 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 		struct memtx_tree_data dup_data;
 		dup_data.tuple = NULL;
 
+		/* Count the key first, it's the only step that may fail. */
+		if (count_keys &&
+		    memtx_tree_index_count_key_add(index, new_tuple) != 0)
+			return -1;
+
 		/* Try to optimistically replace the new_tuple. */
 		int tree_res = memtx_tree_insert(&index->tree, new_data,
 						 &dup_data);
 		if (tree_res) {
+			if (count_keys)
+				memtx_tree_index_count_key_remove(index,
+								  new_tuple);
 			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
 				 "memtx_tree_index", "replace");
 			return -1;
@@ -572,6 +964,9 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 			memtx_tree_delete(&index->tree, new_data);
 			if (dup_data.tuple != NULL)
 				memtx_tree_insert(&index->tree, dup_data, NULL);
+			if (count_keys)
+				memtx_tree_index_count_key_remove(index,
+								  new_tuple);
 			struct space *sp = space_cache_find(base->def->space_id);
 			if (sp != NULL)
 				diag_set(ClientError, errcode, base->def->name,
@@ -579,6 +974,9 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 			return -1;
 		}
 		if (dup_data.tuple != NULL) {
+			if (count_keys)
+				memtx_tree_index_count_key_remove(
+					index, dup_data.tuple);
 			*result = dup_data.tuple;
 			return 0;
 		}
@@ -587,7 +985,9 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 		struct memtx_tree_data old_data;
 		old_data.tuple = old_tuple;
 		old_data.hint = tuple_hint(old_tuple, cmp_def);
-		memtx_tree_delete(&index->tree, old_data);
+		if (memtx_tree_delete(&index->tree, old_data) == 0 &&
+		    count_keys)
+			memtx_tree_index_count_key_remove(index, old_tuple);
 	}
 	*result = old_tuple;
 	return 0;
@@ -777,6 +1177,41 @@ memtx_tree_index_replace_multikey(struct index *base, struct tuple *old_tuple,
 	return 0;
 }
 
+/**
+ * The multikey array of the tuple is the same, so each entry of
+ * the new tuple replaces the equal entry of the old one, and
+ * there is nothing to delete afterwards.
+ */
+static int
+memtx_tree_index_replace_unchanged_multikey(struct index *base,
+					    struct tuple *old_tuple,
+					    struct tuple *new_tuple)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	uint32_t multikey_count = tuple_multikey_count(new_tuple, cmp_def);
+	struct memtx_tree_data data, dup_data;
+	data.tuple = new_tuple;
+	for (uint32_t i = 0; i < multikey_count; i++) {
+		data.hint = i;
+		dup_data.tuple = NULL;
+		if (memtx_tree_insert(&index->tree, data, &dup_data) != 0) {
+			/* Put the replaced entries back. */
+			data.tuple = old_tuple;
+			for (uint32_t j = 0; j < i; j++) {
+				data.hint = j;
+				memtx_tree_insert(&index->tree, data, NULL);
+			}
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_tree_index", "replace");
+			return -1;
+		}
+		assert(dup_data.tuple == old_tuple ||
+		       dup_data.tuple == new_tuple);
+	}
+	return 0;
+}
+
 /** A dummy key allocator used when removing tuples from an index. */
 static const char *
 func_index_key_dummy_alloc(struct tuple *tuple, const char *key,
@@ -834,6 +1269,227 @@ memtx_tree_func_index_replace_rollback(struct memtx_tree_index *index,
 		memtx_tree_insert(&index->tree, entry->key, NULL);
 }
 
+enum {
+	/**
+	 * Max number of keys of an old tuple for which a
+	 * functional index replace compares the old and the
+	 * new key lists.
+	 */
+	MEMTX_FUNC_INDEX_DIFF_MAX = 64,
+};
+
+/** A key returned by the functional index function. */
+struct func_key_entry {
+	/** Key data, a copy in engine memory for new tuple keys. */
+	const char *key;
+	/** Size of the key data. */
+	uint32_t size;
+	/**
+	 * For a new tuple key, the index of the equal old tuple
+	 * key, or -1. For an old tuple key, whether it has a pair.
+	 */
+	int pair;
+	/** The entry replaced or deleted by this key. */
+	struct memtx_tree_data replaced;
+	/** Set if the key was inserted in or deleted from the tree. */
+	bool is_applied;
+};
+
+/**
+ * Roll back memtx_tree_func_index_replace_diff(): restore the
+ * old tuple entries and release the new tuple keys.
+ */
+static void
+memtx_tree_func_index_diff_rollback(struct memtx_tree_index *index,
+				    struct tuple *new_tuple,
+				    struct func_key_entry *old_keys,
+				    uint32_t old_count,
+				    struct func_key_entry *new_keys,
+				    uint32_t new_count)
+{
+	struct memtx_tree_data data;
+	data.tuple = new_tuple;
+	for (uint32_t i = 0; i < new_count; i++) {
+		struct func_key_entry *entry = &new_keys[i];
+		if (entry->is_applied) {
+			data.hint = (hint_t)entry->key;
+			memtx_tree_delete_value(&index->tree, data, NULL);
+			if (entry->replaced.tuple != NULL &&
+			    entry->replaced.tuple != new_tuple)
+				memtx_tree_insert(&index->tree,
+						  entry->replaced, NULL);
+		}
+	}
+	for (uint32_t i = 0; i < old_count; i++) {
+		struct func_key_entry *entry = &old_keys[i];
+		if (entry->is_applied)
+			memtx_tree_insert(&index->tree, entry->replaced, NULL);
+	}
+	for (uint32_t i = 0; i < new_count; i++)
+		tuple_chunk_delete(new_tuple, new_keys[i].key);
+}
+
+/**
+ * Replace @a old_tuple with @a new_tuple in a functional index
+ * touching only the keys that changed. Keys returned by the
+ * function for both tuples are compared: entries with equal keys
+ * are replaced in place, and only added and removed keys go
+ * through insertion and deletion, with their rebalancing and
+ * uniqueness checks.
+ *
+ * Return 0 on success, -1 on error, 1 if the key lists can't
+ * be matched cheaply and the caller should fall back to the
+ * generic replace.
+ */
+static int
+memtx_tree_func_index_replace_diff(struct memtx_tree_index *index,
+				   struct tuple *old_tuple,
+				   struct tuple *new_tuple)
+{
+	struct index_def *index_def = index->base.def;
+	struct region *region = &fiber()->gc;
+	if (old_tuple == new_tuple)
+		return 1;
+
+	/* Collect the old tuple keys. */
+	struct key_list_iterator it;
+	if (key_list_iterator_create(&it, old_tuple, index_def, false,
+				     func_index_key_dummy_alloc) != 0)
+		return -1;
+	size_t size;
+	struct func_key_entry *old_keys =
+		region_alloc_array(region, typeof(old_keys[0]),
+				   MEMTX_FUNC_INDEX_DIFF_MAX, &size);
+	if (old_keys == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "old_keys");
+		return -1;
+	}
+	uint32_t old_count = 0;
+	const char *key;
+	while (key_list_iterator_next(&it, &key) == 0 && key != NULL) {
+		if (old_count == MEMTX_FUNC_INDEX_DIFF_MAX)
+			return 1;
+		struct func_key_entry *entry = &old_keys[old_count++];
+		entry->key = key;
+		mp_next(&key);
+		entry->size = key - entry->key;
+		entry->pair = -1;
+		entry->is_applied = false;
+	}
+
+	/* Collect the new tuple keys and pair them. */
+	if (key_list_iterator_create(&it, new_tuple, index_def, true,
+				     tuple_chunk_new) != 0)
+		return -1;
+	struct func_key_entry *new_keys =
+		region_alloc_array(region, typeof(new_keys[0]),
+				   MEMTX_FUNC_INDEX_DIFF_MAX, &size);
+	if (new_keys == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "new_keys");
+		return -1;
+	}
+	uint32_t new_count = 0;
+	int rc;
+	while ((rc = key_list_iterator_next(&it, &key)) == 0 && key != NULL) {
+		if (new_count == MEMTX_FUNC_INDEX_DIFF_MAX) {
+			tuple_chunk_delete(new_tuple, key);
+			rc = 1;
+			break;
+		}
+		struct func_key_entry *entry = &new_keys[new_count++];
+		entry->key = key;
+		mp_next(&key);
+		entry->size = key - entry->key;
+		entry->pair = -1;
+		entry->replaced.tuple = NULL;
+		entry->is_applied = false;
+		for (uint32_t i = 0; i < old_count; i++) {
+			struct func_key_entry *old = &old_keys[i];
+			if (old->pair < 0 && old->size == entry->size &&
+			    memcmp(old->key, entry->key, entry->size) == 0) {
+				old->pair = new_count - 1;
+				entry->pair = i;
+				break;
+			}
+		}
+	}
+	if (rc != 0)
+		goto fail;
+
+	/* Delete the keys the new tuple doesn't have. */
+	struct memtx_tree_data data;
+	data.tuple = old_tuple;
+	for (uint32_t i = 0; i < old_count; i++) {
+		struct func_key_entry *entry = &old_keys[i];
+		if (entry->pair >= 0)
+			continue;
+		data.hint = (hint_t)entry->key;
+		entry->replaced.tuple = NULL;
+		memtx_tree_delete_value(&index->tree, data, &entry->replaced);
+		entry->is_applied = entry->replaced.tuple != NULL;
+	}
+	/* Insert the keys the old tuple doesn't have. */
+	for (uint32_t i = 0; i < new_count; i++) {
+		struct func_key_entry *entry = &new_keys[i];
+		if (entry->pair >= 0)
+			continue;
+		bool is_multikey_conflict;
+		if (memtx_tree_index_replace_multikey_one(index, old_tuple,
+				new_tuple, DUP_INSERT, (hint_t)entry->key,
+				&entry->replaced, &is_multikey_conflict) != 0) {
+			rc = -1;
+			goto fail;
+		}
+		entry->is_applied = true;
+		if (entry->replaced.tuple != NULL) {
+			/*
+			 * The key is equal to another key of
+			 * one of the tuples, leave this case
+			 * to the generic replace.
+			 */
+			rc = 1;
+			goto fail;
+		}
+	}
+	/* Replace the entries with unchanged keys in place. */
+	data.tuple = new_tuple;
+	for (uint32_t i = 0; i < new_count; i++) {
+		struct func_key_entry *entry = &new_keys[i];
+		if (entry->pair < 0)
+			continue;
+		data.hint = (hint_t)entry->key;
+		if (memtx_tree_insert(&index->tree, data,
+				      &entry->replaced) != 0) {
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_tree_index", "replace");
+			rc = -1;
+			goto fail;
+		}
+		entry->is_applied = true;
+		assert(entry->replaced.tuple == old_tuple);
+	}
+	/* Commit: release the keys of the replaced entries. */
+	for (uint32_t i = 0; i < old_count; i++) {
+		struct func_key_entry *entry = &old_keys[i];
+		if (entry->is_applied) {
+			tuple_chunk_delete(old_tuple,
+					   (const char *)entry->replaced.hint);
+		}
+	}
+	for (uint32_t i = 0; i < new_count; i++) {
+		struct func_key_entry *entry = &new_keys[i];
+		if (entry->pair >= 0) {
+			tuple_chunk_delete(old_tuple,
+					   (const char *)entry->replaced.hint);
+		}
+	}
+	return 0;
+fail:
+	memtx_tree_func_index_diff_rollback(index, new_tuple, old_keys,
+					    old_count, new_keys, new_count);
+	return rc;
+}
+
 /**
  * @sa memtx_tree_index_replace_multikey().
  * Use the functional index function from the key definition
@@ -860,6 +1516,17 @@ memtx_tree_func_index_replace(struct index *base, struct tuple *old_tuple,
 	size_t region_svp = region_used(region);
 
 	*result = NULL;
+	if (old_tuple != NULL && new_tuple != NULL) {
+		rc = memtx_tree_func_index_replace_diff(index, old_tuple,
+							new_tuple);
+		region_truncate(region, region_svp);
+		if (rc <= 0) {
+			if (rc == 0)
+				*result = old_tuple;
+			return rc;
+		}
+		rc = -1;
+	}
 	struct key_list_iterator it;
 	if (new_tuple != NULL) {
 		struct rlist old_keys, new_keys;
@@ -1005,6 +1672,7 @@ memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
 	iterator_create(&it->base, base);
 	it->pool = &memtx->iterator_pool;
 	it->base.next = tree_iterator_start;
+	it->base.skip = tree_iterator_skip;
 	it->base.free = tree_iterator_free;
 	it->type = type;
 	it->key_data.key = key;
@@ -1082,6 +1750,9 @@ memtx_tree_index_build_next(struct index *base, struct tuple *tuple)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	if (index->key_counts != NULL &&
+	    memtx_tree_index_count_key_add(index, tuple) != 0)
+		return -1;
 	return memtx_tree_index_build_array_append(index, tuple,
 						   tuple_hint(tuple, cmp_def));
 }
@@ -1175,10 +1846,14 @@ memtx_tree_index_build_array_deduplicate(struct memtx_tree_index *index,
 	index->build_array_size = w_idx + 1;
 }
 
+/**
+ * Sort the build array and remove duplicates from it, so that
+ * it is ready to be turned into a tree. Doesn't allocate from
+ * the engine arena and so may be called from any thread.
+ */
 static void
-memtx_tree_index_end_build(struct index *base)
+memtx_tree_index_sort_build_array(struct memtx_tree_index *index)
 {
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
 	qsort_arg(index->build_array, index->build_array_size,
 		  sizeof(index->build_array[0]), memtx_tree_qcompare, cmp_def);
@@ -1195,6 +1870,12 @@ memtx_tree_index_end_build(struct index *base)
 		memtx_tree_index_build_array_deduplicate(index,
 							 tuple_chunk_delete);
 	}
+}
+
+/** Turn the sorted build array into the tree. */
+static void
+memtx_tree_index_build_tree(struct memtx_tree_index *index)
+{
 	memtx_tree_build(&index->tree, index->build_array,
 			 index->build_array_size);
 
@@ -1204,10 +1885,90 @@ memtx_tree_index_end_build(struct index *base)
 	index->build_array_alloc_size = 0;
 }
 
+static void
+memtx_tree_index_end_build(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	memtx_tree_index_sort_build_array(index);
+	memtx_tree_index_build_tree(index);
+}
+
+bool
+memtx_tree_index_can_prepare_build(struct index *base)
+{
+	/* Key counts are maintained in tx thread only. */
+	return base->def->type == TREE &&
+	       !base->def->key_def->for_func_index &&
+	       !base->def->opts.count_keys;
+}
+
+int
+memtx_tree_index_prepare_build(struct index *base, struct tuple **tuples,
+			       size_t count)
+{
+	assert(memtx_tree_index_can_prepare_build(base));
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	if (memtx_tree_index_reserve(base, count) != 0)
+		return -1;
+	for (size_t i = 0; i < count; i++) {
+		int rc = cmp_def->is_multikey ?
+			 memtx_tree_index_build_next_multikey(base, tuples[i]) :
+			 memtx_tree_index_build_next(base, tuples[i]);
+		if (rc != 0)
+			return -1;
+	}
+	memtx_tree_index_sort_build_array(index);
+	return 0;
+}
+
+bool
+memtx_tree_index_build_has_dup(struct index *base)
+{
+	assert(memtx_tree_index_can_prepare_build(base));
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	/*
+	 * The array is sorted and keys of the same multikey
+	 * tuple are deduplicated, so it's enough to compare
+	 * neighbours. Keys with nulls never match, because
+	 * cmp_def is extended with primary key parts.
+	 */
+	for (size_t i = 1; i < index->build_array_size; i++) {
+		if (tuple_compare(index->build_array[i - 1].tuple,
+				  index->build_array[i - 1].hint,
+				  index->build_array[i].tuple,
+				  index->build_array[i].hint, cmp_def) == 0)
+			return true;
+	}
+	return false;
+}
+
+void
+memtx_tree_index_finish_build(struct index *base)
+{
+	assert(memtx_tree_index_can_prepare_build(base));
+	memtx_tree_index_build_tree((struct memtx_tree_index *)base);
+}
+
+void
+memtx_tree_index_discard_build(struct index *base)
+{
+	assert(memtx_tree_index_can_prepare_build(base));
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	free(index->build_array);
+	index->build_array = NULL;
+	index->build_array_size = 0;
+	index->build_array_alloc_size = 0;
+}
+
 struct tree_snapshot_iterator {
 	struct snapshot_iterator base;
 	struct memtx_tree_index *index;
 	struct memtx_tree_iterator tree_iterator;
+	struct memtx_tx_snapshot_cleaner cleaner;
+	/** Format returned by memtx_enter_delayed_free_mode(). */
+	struct tuple_format *format;
 };
 
 static void
@@ -1217,9 +1978,10 @@ tree_snapshot_iterator_free(struct snapshot_iterator *iterator)
 	struct tree_snapshot_iterator *it =
 		(struct tree_snapshot_iterator *)iterator;
 	memtx_leave_delayed_free_mode((struct memtx_engine *)
-				      it->index->base.engine);
+				      it->index->base.engine, it->format);
 	memtx_tree_iterator_destroy(&it->index->tree, &it->tree_iterator);
 	index_unref(&it->index->base);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
 	free(iterator);
 }
 
@@ -1231,15 +1993,21 @@ tree_snapshot_iterator_next(struct snapshot_iterator *iterator,
 	struct tree_snapshot_iterator *it =
 		(struct tree_snapshot_iterator *)iterator;
 	struct memtx_tree *tree = &it->index->tree;
-	struct memtx_tree_data *res = memtx_tree_iterator_get_elem(tree,
-							&it->tree_iterator);
-	if (res == NULL) {
-		*data = NULL;
-		return 0;
+	while (true) {
+		struct memtx_tree_data *res =
+			memtx_tree_iterator_get_elem(tree, &it->tree_iterator);
+		if (res == NULL) {
+			*data = NULL;
+			return 0;
+		}
+		memtx_tree_iterator_next(tree, &it->tree_iterator);
+		struct tuple *tuple =
+			memtx_tx_snapshot_clarify(&it->cleaner, res->tuple);
+		if (tuple != NULL) {
+			*data = tuple_data_range(tuple, size);
+			return 0;
+		}
 	}
-	memtx_tree_iterator_next(tree, &it->tree_iterator);
-	*data = tuple_data_range(res->tuple, size);
-	return 0;
 }
 
 /**
@@ -1258,6 +2026,10 @@ memtx_tree_index_create_snapshot_iterator(struct index *base)
 			 "memtx_tree_index", "create_snapshot_iterator");
 		return NULL;
 	}
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, base) != 0) {
+		free(it);
+		return NULL;
+	}
 
 	it->base.free = tree_snapshot_iterator_free;
 	it->base.next = tree_snapshot_iterator_next;
@@ -1265,7 +2037,8 @@ memtx_tree_index_create_snapshot_iterator(struct index *base)
 	index_ref(base);
 	it->tree_iterator = memtx_tree_iterator_first(&index->tree);
 	memtx_tree_iterator_freeze(&index->tree, &it->tree_iterator);
-	memtx_enter_delayed_free_mode((struct memtx_engine *)base->engine);
+	it->format = memtx_enter_delayed_free_mode(
+		(struct memtx_engine *)base->engine, base);
 	return (struct snapshot_iterator *) it;
 }
 
@@ -1285,9 +2058,15 @@ static const struct index_vtab memtx_tree_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
+	/* .estimate_eq = */ memtx_tree_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_batch = */ memtx_tree_index_get_batch,
 	/* .replace = */ memtx_tree_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		memtx_tree_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -1315,9 +2094,15 @@ static const struct index_vtab memtx_tree_index_multikey_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_batch = */ memtx_tree_index_get_batch,
 	/* .replace = */ memtx_tree_index_replace_multikey,
+	/* .replace_unchanged = */ memtx_tree_index_replace_unchanged_multikey,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		memtx_tree_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -1345,9 +2130,15 @@ static const struct index_vtab memtx_tree_func_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_batch = */ memtx_tree_index_get_batch,
 	/* .replace = */ memtx_tree_func_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		memtx_tree_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -1381,9 +2172,15 @@ static const struct index_vtab memtx_tree_disabled_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ generic_index_get,
+	/* .get_batch = */ generic_index_get_batch,
 	/* .replace = */ disabled_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
 	/* .create_iterator = */ generic_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		generic_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -1416,8 +2213,19 @@ memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def)
 	} else {
 		vtab = &memtx_tree_index_vtab;
 	}
+	if (def->opts.count_keys) {
+		index->key_counts = mh_tree_key_count_new();
+		if (index->key_counts == NULL) {
+			free(index);
+			diag_set(OutOfMemory, sizeof(*index->key_counts),
+				 "malloc", "key_counts");
+			return NULL;
+		}
+	}
 	if (index_create(&index->base, (struct engine *)memtx,
 			 vtab, def) != 0) {
+		if (index->key_counts != NULL)
+			mh_tree_key_count_delete(index->key_counts);
 		free(index);
 		return NULL;
 	}
@@ -31,6 +31,9 @@
  * SUCH DAMAGE.
  */
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
@@ -38,10 +41,59 @@ extern "C" {
 struct index;
 struct index_def;
 struct memtx_engine;
+struct tuple;
 
 struct index *
 memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def);
 
+/**
+ * Return true if the index is a tree index which can be
+ * bulk-built with memtx_tree_index_prepare_build().
+ * Functional indexes can't, because extracting their keys
+ * calls a Lua function.
+ */
+bool
+memtx_tree_index_can_prepare_build(struct index *index);
+
+/**
+ * First stage of a bulk index build: collect the keys of
+ * the given tuples and sort them. Neither the engine arena
+ * nor any other index is touched, so this function may be
+ * called from a thread other than tx, concurrently for
+ * different indexes. index_begin_build() must have been
+ * called before.
+ *
+ * @retval 0 success
+ * @retval -1 out of memory
+ */
+int
+memtx_tree_index_prepare_build(struct index *index, struct tuple **tuples,
+			       size_t count);
+
+/**
+ * Check if the keys collected by memtx_tree_index_prepare_build()
+ * violate the unique constraint of the index. Like preparation,
+ * may be called from any thread.
+ */
+bool
+memtx_tree_index_build_has_dup(struct index *index);
+
+/**
+ * Second stage of a bulk index build: turn the keys collected
+ * by memtx_tree_index_prepare_build() into the tree. Must be
+ * called from the tx thread. Replaces index_end_build().
+ */
+void
+memtx_tree_index_finish_build(struct index *index);
+
+/**
+ * Drop the keys collected by memtx_tree_index_prepare_build()
+ * without building the tree, e.g. if another index of the same
+ * bulk build failed.
+ */
+void
+memtx_tree_index_discard_build(struct index *index);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -0,0 +1,663 @@
+/*
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_tx.h"
+
+#include <stdlib.h>
+
+#include "assoc.h"
+#include "diag.h"
+#include "say.h"
+#include "memtx_engine.h"
+#include "memtx_space.h"
+#include "schema.h"
+#include "space.h"
+#include "tuple.h"
+#include "txn.h"
+
+bool memtx_tx_manager_use_mvcc_engine = false;
+
+static struct {
+	/** Tuple => story. */
+	struct mh_i64ptr_t *history;
+	/** Transactions having stories, linked by in_writers. */
+	struct rlist writers;
+	/** Transactions having a read set, linked by in_readers. */
+	struct rlist readers;
+} txm;
+
+int
+memtx_tx_manager_init(void)
+{
+	txm.history = mh_i64ptr_new();
+	if (txm.history == NULL) {
+		diag_set(OutOfMemory, 0, "mh_i64ptr_new", "history");
+		return -1;
+	}
+	rlist_create(&txm.writers);
+	rlist_create(&txm.readers);
+	return 0;
+}
+
+void
+memtx_tx_manager_free(void)
+{
+	if (txm.history != NULL) {
+		mh_i64ptr_delete(txm.history);
+		txm.history = NULL;
+	}
+}
+
+/* {{{ Stories */
+
+static inline uint64_t
+memtx_tx_tuple_key(struct tuple *tuple)
+{
+	return (uint64_t)(uintptr_t)tuple;
+}
+
+/** Find the story of a tuple, NULL if the tuple is clean. */
+static struct memtx_story *
+memtx_story_find(struct tuple *tuple)
+{
+	if (!tuple->is_dirty)
+		return NULL;
+	mh_int_t k = mh_i64ptr_find(txm.history,
+				    memtx_tx_tuple_key(tuple), NULL);
+	assert(k != mh_end(txm.history));
+	return mh_i64ptr_node(txm.history, k)->val;
+}
+
+static struct memtx_story *
+memtx_story_new(struct space *space, struct tuple *tuple)
+{
+	assert(!tuple->is_dirty);
+	size_t size = sizeof(struct memtx_story) +
+		      space->index_count * sizeof(struct memtx_story_link);
+	struct memtx_story *story = calloc(1, size);
+	if (story == NULL) {
+		diag_set(OutOfMemory, size, "calloc", "struct memtx_story");
+		return NULL;
+	}
+	struct mh_i64ptr_node_t node = { memtx_tx_tuple_key(tuple), story };
+	if (mh_i64ptr_put(txm.history, &node, NULL, NULL) ==
+	    mh_end(txm.history)) {
+		diag_set(OutOfMemory, 0, "mh_i64ptr_put", "mh_i64ptr_node_t");
+		free(story);
+		return NULL;
+	}
+	story->tuple = tuple;
+	story->space = space;
+	story->index_count = space->index_count;
+	tuple->is_dirty = true;
+	return story;
+}
+
+/** Find the story of a tuple or create it. */
+static struct memtx_story *
+memtx_story_get(struct space *space, struct tuple *tuple)
+{
+	struct memtx_story *story = memtx_story_find(tuple);
+	return story != NULL ? story : memtx_story_new(space, tuple);
+}
+
+/** Delete a story if it doesn't keep any history. */
+static void
+memtx_story_try_delete(struct memtx_story *story)
+{
+	if (story->add_stmt != NULL || story->del_stmt != NULL)
+		return;
+	for (uint32_t i = 0; i < story->index_count; i++) {
+		if (story->link[i].older != NULL ||
+		    story->link[i].newer != NULL)
+			return;
+	}
+	mh_int_t k = mh_i64ptr_find(txm.history,
+				    memtx_tx_tuple_key(story->tuple), NULL);
+	assert(k != mh_end(txm.history));
+	mh_i64ptr_del(txm.history, k, NULL);
+	story->tuple->is_dirty = false;
+	free(story);
+}
+
+/** Link a story to the story of the tuple it displaced. */
+static inline void
+memtx_story_link(struct memtx_story *story, struct memtx_story *older,
+		 uint32_t iid)
+{
+	assert(story->link[iid].older == NULL);
+	assert(older->link[iid].newer == NULL);
+	story->link[iid].older = older;
+	older->link[iid].newer = story;
+}
+
+/** Break the link of a story to an older one. */
+static inline void
+memtx_story_unlink(struct memtx_story *story, uint32_t iid)
+{
+	struct memtx_story *older = story->link[iid].older;
+	if (older == NULL)
+		return;
+	assert(older->link[iid].newer == story);
+	older->link[iid].newer = NULL;
+	story->link[iid].older = NULL;
+	memtx_story_try_delete(older);
+}
+
+/**
+ * Return true if a tuple is inserted or deleted by a statement
+ * of another transaction in progress.
+ */
+static inline bool
+memtx_story_is_changed_by_other(struct memtx_story *story, struct txn *txn)
+{
+	return (story->add_stmt != NULL && story->add_stmt->txn != txn) ||
+	       (story->del_stmt != NULL && story->del_stmt->txn != txn);
+}
+
+/**
+ * Walk the version chain of a dirty tuple in an index and
+ * return the version visible to a transaction, NULL if there
+ * is none. The transaction may be NULL.
+ */
+static struct tuple *
+memtx_story_visible(struct memtx_story *story, struct txn *txn, uint32_t iid)
+{
+	while (story != NULL) {
+		if (story->add_stmt != NULL && story->add_stmt->txn != txn) {
+			story = story->link[iid].older;
+			continue;
+		}
+		if (story->del_stmt != NULL && story->del_stmt->txn == txn)
+			return NULL;
+		return story->tuple;
+	}
+	return NULL;
+}
+
+/* }}} */
+
+/* {{{ Transactions */
+
+/** Get the transaction manager state of a transaction. */
+static struct memtx_tx *
+memtx_tx_get(struct txn *txn)
+{
+	if (txn->memtx_tx != NULL)
+		return txn->memtx_tx;
+	size_t size;
+	struct memtx_tx *tx = region_alloc_object(&txn->region,
+						  struct memtx_tx, &size);
+	if (tx == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_object", "tx");
+		return NULL;
+	}
+	tx->txn = txn;
+	rlist_create(&tx->in_writers);
+	rlist_create(&tx->in_readers);
+	tx->read_set = NULL;
+	tx->is_aborted = false;
+	tx->is_conflicted = false;
+	txn->memtx_tx = tx;
+	return tx;
+}
+
+static void
+memtx_tx_clear_read_set(struct memtx_tx *tx)
+{
+	if (tx->read_set == NULL)
+		return;
+	rlist_del_entry(tx, in_readers);
+	mh_i64ptr_delete(tx->read_set);
+	tx->read_set = NULL;
+}
+
+void
+memtx_tx_delete(struct txn *txn)
+{
+	struct memtx_tx *tx = txn->memtx_tx;
+	assert(tx != NULL);
+	rlist_del_entry(tx, in_writers);
+	memtx_tx_clear_read_set(tx);
+	txn->memtx_tx = NULL;
+}
+
+/** Add a tuple to the read set of a transaction. */
+static int
+memtx_tx_track_read(struct txn *txn, struct tuple *tuple)
+{
+	struct memtx_tx *tx = memtx_tx_get(txn);
+	if (tx == NULL)
+		return -1;
+	if (tx->read_set == NULL) {
+		tx->read_set = mh_i64ptr_new();
+		if (tx->read_set == NULL) {
+			diag_set(OutOfMemory, 0, "mh_i64ptr_new", "read_set");
+			return -1;
+		}
+		rlist_add_entry(&txm.readers, tx, in_readers);
+	}
+	struct mh_i64ptr_node_t node = { memtx_tx_tuple_key(tuple), NULL };
+	if (mh_i64ptr_put(tx->read_set, &node, NULL, NULL) ==
+	    mh_end(tx->read_set)) {
+		diag_set(OutOfMemory, 0, "mh_i64ptr_put", "mh_i64ptr_node_t");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Mark conflicted all transactions except the given one that
+ * read a tuple.
+ */
+static void
+memtx_tx_mark_readers(struct memtx_tx *tx, struct tuple *tuple)
+{
+	uint64_t key = memtx_tx_tuple_key(tuple);
+	struct memtx_tx *reader;
+	rlist_foreach_entry(reader, &txm.readers, in_readers) {
+		if (reader == tx || reader->is_conflicted)
+			continue;
+		if (mh_i64ptr_find(reader->read_set, key, NULL) !=
+		    mh_end(reader->read_set))
+			reader->is_conflicted = true;
+	}
+}
+
+int
+memtx_tx_tuple_clarify_slow(struct index *index, struct tuple **tuple)
+{
+	struct txn *txn = in_txn();
+	if ((*tuple)->is_dirty) {
+		*tuple = memtx_story_visible(memtx_story_find(*tuple), txn,
+					     index->def->iid);
+		if (*tuple == NULL)
+			return 0;
+	}
+	/*
+	 * Tuples looked up by a statement are protected by
+	 * the history of the statement itself.
+	 */
+	if (txn == NULL || txn->in_sub_stmt > 0)
+		return 0;
+	struct space *space = space_by_id(index->def->space_id);
+	if (space == NULL || !space_is_memtx(space) ||
+	    !memtx_space_is_mvcc(space))
+		return 0;
+	return memtx_tx_track_read(txn, *tuple);
+}
+
+/* }}} */
+
+/* {{{ Statements */
+
+/**
+ * Undo the insertion of the new tuple of a statement in the
+ * first index_count indexes of the space.
+ */
+static void
+memtx_tx_history_undo_add(struct txn_stmt *stmt, uint32_t index_count)
+{
+	struct memtx_story *story = stmt->add_story;
+	struct space *space = stmt->space;
+	for (uint32_t i = index_count; i > 0; i--) {
+		struct memtx_story *older = story->link[i - 1].older;
+		struct tuple *unused;
+		/* Rollback must not fail. */
+		if (index_replace(space->index[i - 1], story->tuple,
+				  older != NULL ? older->tuple : NULL,
+				  DUP_INSERT, &unused) != 0) {
+			diag_log();
+			unreachable();
+			panic("failed to rollback change");
+		}
+		memtx_story_unlink(story, i - 1);
+	}
+	story->add_stmt = NULL;
+	stmt->add_story = NULL;
+	memtx_story_try_delete(story);
+}
+
+/** Mark the old tuple of a statement deleted. */
+static void
+memtx_tx_history_add_del(struct txn_stmt *stmt, struct memtx_story *story)
+{
+	assert(story->del_stmt == NULL);
+	story->del_stmt = stmt;
+	stmt->del_story = story;
+}
+
+int
+memtx_tx_history_add_stmt(struct txn_stmt *stmt, struct tuple *old_tuple,
+			  struct tuple *new_tuple, enum dup_replace_mode mode,
+			  struct tuple **result)
+{
+	struct txn *txn = stmt->txn;
+	struct space *space = stmt->space;
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	struct memtx_tx *tx = memtx_tx_get(txn);
+	if (tx == NULL)
+		return -1;
+	/*
+	 * Ensure we have enough slack memory to guarantee
+	 * successful statement-level rollback.
+	 */
+	if (memtx_index_extent_reserve(memtx, new_tuple != NULL ?
+				       RESERVE_EXTENTS_BEFORE_REPLACE :
+				       RESERVE_EXTENTS_BEFORE_DELETE) != 0)
+		return -1;
+
+	if (new_tuple == NULL) {
+		/*
+		 * Deletion doesn't touch indexes: the tuple is
+		 * only marked deleted until the transaction is
+		 * prepared.
+		 */
+		assert(old_tuple != NULL);
+		struct memtx_story *story = memtx_story_get(space, old_tuple);
+		if (story == NULL)
+			return -1;
+		if (memtx_story_is_changed_by_other(story, txn)) {
+			memtx_story_try_delete(story);
+			diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+			return -1;
+		}
+		memtx_tx_history_add_del(stmt, story);
+		*result = old_tuple;
+		goto done;
+	}
+
+	struct memtx_story *add_story = memtx_story_new(space, new_tuple);
+	if (add_story == NULL)
+		return -1;
+	add_story->add_stmt = stmt;
+	stmt->add_story = add_story;
+
+	/*
+	 * Insert the new tuple in all indexes, linking it to
+	 * the tuples it displaces, and check for duplicates
+	 * among the versions visible to the transaction.
+	 */
+	struct tuple *old_pk = NULL;
+	uint32_t i;
+	for (i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		struct tuple *dup;
+		if (index_replace(index, NULL, new_tuple,
+				  DUP_REPLACE_OR_INSERT, &dup) != 0)
+			goto rollback;
+		struct tuple *visible = NULL;
+		if (dup != NULL) {
+			struct memtx_story *older = memtx_story_get(space, dup);
+			if (older == NULL) {
+				struct tuple *unused;
+				/* Rollback must not fail. */
+				if (index_replace(index, new_tuple, dup,
+						  DUP_INSERT, &unused) != 0) {
+					diag_log();
+					unreachable();
+					panic("failed to rollback change");
+				}
+				goto rollback;
+			}
+			memtx_story_link(add_story, older, i);
+			if (memtx_story_is_changed_by_other(older, txn)) {
+				diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+				i++;
+				goto rollback;
+			}
+			if (older->del_stmt == NULL)
+				visible = dup;
+		}
+		uint32_t errcode;
+		if (i == 0) {
+			errcode = replace_check_dup(old_tuple, visible, mode);
+			old_pk = visible;
+		} else {
+			errcode = replace_check_dup(old_pk, visible,
+						    DUP_INSERT);
+		}
+		if (errcode != 0) {
+			diag_set(ClientError, errcode, index->def->name,
+				 space_name(space));
+			i++;
+			goto rollback;
+		}
+	}
+	if (old_pk != NULL)
+		memtx_tx_history_add_del(stmt, add_story->link[0].older);
+	tuple_ref(new_tuple);
+	*result = old_pk;
+done:
+	memtx_space_update_bsize(space, *result, new_tuple);
+	if (rlist_empty(&tx->in_writers))
+		rlist_add_tail_entry(&txm.writers, tx, in_writers);
+	return 0;
+rollback:
+	memtx_tx_history_undo_add(stmt, i);
+	return -1;
+}
+
+void
+memtx_tx_history_rollback_stmt(struct txn_stmt *stmt)
+{
+	if (stmt->add_story != NULL)
+		memtx_tx_history_undo_add(stmt, stmt->add_story->index_count);
+	struct memtx_story *story = stmt->del_story;
+	if (story != NULL) {
+		assert(story->del_stmt == stmt);
+		story->del_stmt = NULL;
+		stmt->del_story = NULL;
+		memtx_story_try_delete(story);
+	}
+}
+
+/**
+ * Apply a statement to indexes for real and drop the stories
+ * of its tuples.
+ */
+static int
+memtx_tx_prepare_stmt(struct txn_stmt *stmt)
+{
+	struct space *space = stmt->space;
+	struct memtx_story *story = stmt->del_story;
+	if (story != NULL) {
+		struct memtx_engine *memtx =
+			(struct memtx_engine *)space->engine;
+		if (memtx_index_extent_reserve(memtx,
+				RESERVE_EXTENTS_BEFORE_DELETE) != 0)
+			return -1;
+		/*
+		 * Remove the old tuple from the indexes where
+		 * it hasn't been displaced by a new one.
+		 */
+		for (uint32_t i = 0; i < story->index_count; i++) {
+			if (story->link[i].newer != NULL)
+				continue;
+			struct tuple *unused;
+			if (index_replace(space->index[i], story->tuple, NULL,
+					  DUP_INSERT, &unused) != 0) {
+				diag_log();
+				unreachable();
+				panic("failed to prepare change");
+			}
+		}
+		story->del_stmt = NULL;
+		stmt->del_story = NULL;
+		memtx_story_try_delete(story);
+	}
+	story = stmt->add_story;
+	if (story != NULL) {
+		for (uint32_t i = 0; i < story->index_count; i++)
+			memtx_story_unlink(story, i);
+		story->add_stmt = NULL;
+		stmt->add_story = NULL;
+		memtx_story_try_delete(story);
+	}
+	return 0;
+}
+
+int
+memtx_tx_prepare(struct txn *txn)
+{
+	struct memtx_tx *tx = txn->memtx_tx;
+	assert(tx != NULL);
+	if (tx->is_aborted || tx->is_conflicted) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->space != NULL && memtx_tx_prepare_stmt(stmt) != 0)
+			return -1;
+	}
+	rlist_del_entry(tx, in_writers);
+	memtx_tx_clear_read_set(tx);
+	if (rlist_empty(&txm.readers))
+		return 0;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->old_tuple != NULL)
+			memtx_tx_mark_readers(tx, stmt->old_tuple);
+	}
+	return 0;
+}
+
+/**
+ * Roll back statements of a transaction done to a space.
+ * The rollback done by the transaction later skips them.
+ * Return true if any statement was rolled back.
+ */
+static bool
+memtx_tx_rollback_space(struct txn *txn, struct space *space)
+{
+	bool found = false;
+	struct txn_stmt *stmt;
+	stailq_reverse(&txn->stmts);
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->space != space ||
+		    (stmt->add_story == NULL && stmt->del_story == NULL))
+			continue;
+		memtx_tx_history_rollback_stmt(stmt);
+		memtx_space_update_bsize(space, stmt->new_tuple,
+					 stmt->old_tuple);
+		if (stmt->old_tuple != NULL)
+			tuple_ref(stmt->old_tuple);
+		if (stmt->new_tuple != NULL)
+			tuple_unref(stmt->new_tuple);
+		stmt->engine_savepoint = NULL;
+		found = true;
+	}
+	stailq_reverse(&txn->stmts);
+	return found;
+}
+
+void
+memtx_tx_abort_writers_for_space(struct space *space)
+{
+	struct txn *current = in_txn();
+	struct memtx_tx *tx;
+	rlist_foreach_entry(tx, &txm.writers, in_writers) {
+		if (tx->txn != current &&
+		    memtx_tx_rollback_space(tx->txn, space))
+			tx->is_aborted = true;
+	}
+}
+
+/* }}} */
+
+/* {{{ Snapshot cleaner */
+
+int
+memtx_tx_snapshot_cleaner_create(struct memtx_tx_snapshot_cleaner *cleaner,
+				 struct index *index)
+{
+	cleaner->ht = NULL;
+	if (!memtx_tx_manager_use_mvcc_engine ||
+	    mh_size(txm.history) == 0)
+		return 0;
+	struct space *space = space_by_id(index->def->space_id);
+	if (space == NULL)
+		return 0;
+	uint32_t iid = index->def->iid;
+	struct mh_i64ptr_t *ht = NULL;
+	mh_int_t k;
+	mh_foreach(txm.history, k) {
+		struct memtx_story *story = mh_i64ptr_node(txm.history, k)->val;
+		/* Only tuples present in the index matter. */
+		if (story->space != space || story->link[iid].newer != NULL)
+			continue;
+		struct memtx_story *visible = story;
+		while (visible != NULL && visible->add_stmt != NULL)
+			visible = visible->link[iid].older;
+		if (visible == story)
+			continue;
+		if (ht == NULL) {
+			ht = mh_i64ptr_new();
+			if (ht == NULL) {
+				diag_set(OutOfMemory, 0, "mh_i64ptr_new",
+					 "snapshot cleaner");
+				return -1;
+			}
+		}
+		struct mh_i64ptr_node_t node = {
+			memtx_tx_tuple_key(story->tuple),
+			visible != NULL ? visible->tuple : NULL
+		};
+		if (mh_i64ptr_put(ht, &node, NULL, NULL) == mh_end(ht)) {
+			diag_set(OutOfMemory, 0, "mh_i64ptr_put",
+				 "mh_i64ptr_node_t");
+			mh_i64ptr_delete(ht);
+			return -1;
+		}
+	}
+	cleaner->ht = ht;
+	return 0;
+}
+
+struct tuple *
+memtx_tx_snapshot_clarify_slow(struct memtx_tx_snapshot_cleaner *cleaner,
+			       struct tuple *tuple)
+{
+	mh_int_t k = mh_i64ptr_find(cleaner->ht, memtx_tx_tuple_key(tuple),
+				    NULL);
+	if (k == mh_end(cleaner->ht))
+		return tuple;
+	return mh_i64ptr_node(cleaner->ht, k)->val;
+}
+
+void
+memtx_tx_snapshot_cleaner_destroy(struct memtx_tx_snapshot_cleaner *cleaner)
+{
+	if (cleaner->ht != NULL)
+		mh_i64ptr_delete(cleaner->ht);
+}
+
+/* }}} */
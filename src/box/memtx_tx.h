@@ -0,0 +1,237 @@
+#ifndef TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "small/rlist.h"
+#include "index.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Memtx transaction manager.
+ *
+ * Without the manager a memtx transaction can't yield: changes
+ * are applied to indexes in place, so a concurrent transaction
+ * would see them before they are committed. The manager keeps
+ * uncommitted changes aside of the committed data:
+ *
+ * - A statement still inserts its new tuple in the indexes,
+ *   but the replaced tuple is linked to the new one rather
+ *   than freed, and the deleted tuple is only marked deleted.
+ *   Such tuples have a story (struct memtx_story) and the
+ *   is_dirty flag set.
+ * - Readers clarify every dirty tuple they find: a tuple
+ *   inserted by another transaction is replaced with the
+ *   version it displaced, a tuple deleted by the reader
+ *   itself is skipped.
+ * - A statement fails with ER_TRANSACTION_CONFLICT if it
+ *   touches a tuple changed by another transaction which
+ *   hasn't been prepared yet.
+ * - Tuples read by a transaction make up its read set. When
+ *   a transaction is prepared, the changes are applied to
+ *   the indexes for real, stories are dropped and all other
+ *   transactions that read the replaced tuples are marked
+ *   conflicted, so they fail to commit.
+ *
+ * The manager doesn't track gaps, so phantom reads aren't
+ * detected. Index size, count, min, max and random aren't
+ * clarified and may account uncommitted changes. Spaces
+ * having a multikey or a functional index, system spaces and
+ * spaces under ALTER are changed in place as before and
+ * make the transaction non-yielding.
+ */
+
+struct space;
+struct tuple;
+struct txn;
+struct txn_stmt;
+struct mh_i64ptr_t;
+
+/** Set if box.cfg.memtx_use_mvcc_engine is enabled. */
+extern bool memtx_tx_manager_use_mvcc_engine;
+
+/** Link of a story in a version chain of an index. */
+struct memtx_story_link {
+	/** Story of the tuple displaced by this one. */
+	struct memtx_story *older;
+	/** Story of the tuple that displaced this one. */
+	struct memtx_story *newer;
+};
+
+/**
+ * History of a tuple changed by a transaction that hasn't been
+ * prepared yet.
+ */
+struct memtx_story {
+	/** The tuple. */
+	struct tuple *tuple;
+	/** Space the tuple belongs to. */
+	struct space *space;
+	/** Statement that inserted the tuple, if in progress. */
+	struct txn_stmt *add_stmt;
+	/** Statement that deleted the tuple, if in progress. */
+	struct txn_stmt *del_stmt;
+	/** Number of entries in the link array. */
+	uint32_t index_count;
+	/** Version chain links, one per index. */
+	struct memtx_story_link link[0];
+};
+
+/** Transaction manager state of a transaction. */
+struct memtx_tx {
+	/** The transaction. */
+	struct txn *txn;
+	/** Link in the list of transactions with stories. */
+	struct rlist in_writers;
+	/** Link in the list of transactions with a read set. */
+	struct rlist in_readers;
+	/** Tuples read by the transaction, may be NULL. */
+	struct mh_i64ptr_t *read_set;
+	/** Set if the transaction was aborted by DDL. */
+	bool is_aborted;
+	/**
+	 * Set if a tuple read by the transaction was changed
+	 * by another transaction.
+	 */
+	bool is_conflicted;
+};
+
+/** Initialize the transaction manager. */
+int
+memtx_tx_manager_init(void);
+
+/** Free the transaction manager. */
+void
+memtx_tx_manager_free(void);
+
+/**
+ * Execute a change of a space statement using the transaction
+ * manager. Arguments and the result are the same as of
+ * memtx_space::replace. On success the statement references
+ * the stories of its tuples.
+ */
+int
+memtx_tx_history_add_stmt(struct txn_stmt *stmt, struct tuple *old_tuple,
+			  struct tuple *new_tuple, enum dup_replace_mode mode,
+			  struct tuple **result);
+
+/**
+ * Undo a statement executed by memtx_tx_history_add_stmt()
+ * and not prepared yet. Tuple references and the space size
+ * are left for the caller to update.
+ */
+void
+memtx_tx_history_rollback_stmt(struct txn_stmt *stmt);
+
+/**
+ * Prepare a transaction: fail if it is conflicted, otherwise
+ * apply all its changes to indexes and mark conflicted all
+ * transactions that read tuples replaced by it.
+ */
+int
+memtx_tx_prepare(struct txn *txn);
+
+/** Destroy the transaction manager state of a transaction. */
+void
+memtx_tx_delete(struct txn *txn);
+
+/**
+ * Roll back changes of all transactions in progress done to
+ * the given space except the current one, and abort them.
+ * Called when the space is altered and when a prepared change
+ * of the space is rolled back, because statements in progress
+ * may be built on top of it.
+ */
+void
+memtx_tx_abort_writers_for_space(struct space *space);
+
+int
+memtx_tx_tuple_clarify_slow(struct index *index, struct tuple **tuple);
+
+/**
+ * Replace a tuple found in a memtx index with its version
+ * visible to the current transaction, possibly NULL, and add
+ * the result to the read set of the transaction.
+ */
+static inline int
+memtx_tx_tuple_clarify(struct index *index, struct tuple **tuple)
+{
+	if (!memtx_tx_manager_use_mvcc_engine || *tuple == NULL)
+		return 0;
+	return memtx_tx_tuple_clarify_slow(index, tuple);
+}
+
+/**
+ * Snapshot iterators read the committed version of a space:
+ * the cleaner maps tuples of transactions in progress found
+ * in an index to the versions they displaced.
+ */
+struct memtx_tx_snapshot_cleaner {
+	/** Dirty tuple => committed version, may be NULL. */
+	struct mh_i64ptr_t *ht;
+};
+
+/** Create a snapshot cleaner for an index. */
+int
+memtx_tx_snapshot_cleaner_create(struct memtx_tx_snapshot_cleaner *cleaner,
+				 struct index *index);
+
+struct tuple *
+memtx_tx_snapshot_clarify_slow(struct memtx_tx_snapshot_cleaner *cleaner,
+			       struct tuple *tuple);
+
+/**
+ * Return the committed version of a tuple found by a snapshot
+ * iterator, NULL if the tuple must be skipped. Thread safe.
+ */
+static inline struct tuple *
+memtx_tx_snapshot_clarify(struct memtx_tx_snapshot_cleaner *cleaner,
+			  struct tuple *tuple)
+{
+	if (cleaner->ht == NULL)
+		return tuple;
+	return memtx_tx_snapshot_clarify_slow(cleaner, tuple);
+}
+
+/** Destroy a snapshot cleaner. */
+void
+memtx_tx_snapshot_cleaner_destroy(struct memtx_tx_snapshot_cleaner *cleaner);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_TX_H_INCLUDED */
@@ -62,14 +62,15 @@ port_c_destroy_entry(struct port_c_entry *pe)
 		free(pe->mp);
 }
 
-static void
-port_c_destroy(struct port *base)
+static inline void
+port_c_destroy_impl(struct port *base, bool unref_tuples)
 {
 	struct port_c *port = (struct port_c *)base;
 	struct port_c_entry *pe = port->first;
 	if (pe == NULL)
 		return;
-	port_c_destroy_entry(pe);
+	if (pe->mp_size != 0 || unref_tuples)
+		port_c_destroy_entry(pe);
 	/*
 	 * Port->first is skipped, it is pointing at
 	 * port_c.first_entry, and is freed together with the
@@ -79,11 +80,25 @@ port_c_destroy(struct port *base)
 	while (pe != NULL) {
 		struct port_c_entry *cur = pe;
 		pe = pe->next;
-		port_c_destroy_entry(cur);
+		if (cur->mp_size != 0 || unref_tuples)
+			port_c_destroy_entry(cur);
 		mempool_free(&port_entry_pool, cur);
 	}
 }
 
+static void
+port_c_destroy(struct port *base)
+{
+	port_c_destroy_impl(base, true);
+}
+
+void
+port_c_destroy_keep_refs(struct port *base)
+{
+	assert(base->vtab == &port_c_vtab);
+	port_c_destroy_impl(base, false);
+}
+
 static inline struct port_c_entry *
 port_c_new_entry(struct port_c *port)
 {
@@ -120,13 +135,12 @@ port_c_add_tuple(struct port *base, struct tuple *tuple)
 	return 0;
 }
 
-int
-port_c_add_mp(struct port *base, const char *mp, const char *mp_end)
+char *
+port_c_alloc_mp(struct port *base, uint32_t size)
 {
 	struct port_c *port = (struct port_c *)base;
 	struct port_c_entry *pe;
-	assert(mp_end > mp);
-	uint32_t size = mp_end - mp;
+	assert(size > 0);
 	char *dst;
 	if (size <= PORT_ENTRY_SIZE) {
 		/*
@@ -137,27 +151,38 @@ port_c_add_mp(struct port *base, const char *mp, const char *mp_end)
 		dst = mempool_alloc(&port_entry_pool);
 		if (dst == NULL) {
 			diag_set(OutOfMemory, size, "mempool_alloc", "dst");
-			return -1;
+			return NULL;
 		}
 	} else {
 		dst = malloc(size);
 		if (dst == NULL) {
 			diag_set(OutOfMemory, size, "malloc", "dst");
-			return -1;
+			return NULL;
 		}
 	}
 	pe = port_c_new_entry(port);
 	if (pe != NULL) {
-		memcpy(dst, mp, size);
 		pe->mp = dst;
 		pe->mp_size = size;
-		return 0;
+		return dst;
 	}
 	if (size <= PORT_ENTRY_SIZE)
 		mempool_free(&port_entry_pool, dst);
 	else
 		free(dst);
-	return -1;
+	return NULL;
+}
+
+int
+port_c_add_mp(struct port *base, const char *mp, const char *mp_end)
+{
+	assert(mp_end > mp);
+	uint32_t size = mp_end - mp;
+	char *dst = port_c_alloc_mp(base, size);
+	if (dst == NULL)
+		return -1;
+	memcpy(dst, mp, size);
+	return 0;
 }
 
 static int
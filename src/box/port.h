@@ -148,6 +148,23 @@ port_c_add_tuple(struct port *port, struct tuple *tuple);
 int
 port_c_add_mp(struct port *port, const char *mp, const char *mp_end);
 
+/**
+ * Append an entry of @a size bytes to the port and return a
+ * pointer to its data, to be filled with MessagePack by the
+ * caller. Return NULL on memory error.
+ */
+char *
+port_c_alloc_mp(struct port *port, uint32_t size);
+
+/**
+ * Destroy a C port without unreferencing its tuples, because
+ * their references have been handed over to the caller, e.g.
+ * to Lua tuple objects. Saves touching every tuple twice when
+ * a select result is converted to Lua.
+ */
+void
+port_c_destroy_keep_refs(struct port *port);
+
 void
 port_init(void);
 
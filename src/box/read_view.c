@@ -0,0 +1,305 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "read_view.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cbus.h"
+#include "diag.h"
+#include "fiber.h"
+#include "tt_pthread.h"
+#include "index.h"
+#include "schema.h"
+#include "space.h"
+
+struct read_view *
+read_view_open(const uint32_t *space_ids, uint32_t space_count)
+{
+	struct read_view *rv = malloc(sizeof(*rv));
+	if (rv == NULL) {
+		diag_set(OutOfMemory, sizeof(*rv), "malloc",
+			 "struct read_view");
+		return NULL;
+	}
+	rv->space_count = 0;
+	rv->is_busy = false;
+	rv->spaces = calloc(space_count, sizeof(*rv->spaces));
+	if (rv->spaces == NULL && space_count > 0) {
+		diag_set(OutOfMemory, space_count * sizeof(*rv->spaces),
+			 "calloc", "struct read_view_space");
+		free(rv);
+		return NULL;
+	}
+	for (uint32_t i = 0; i < space_count; i++) {
+		if (read_view_find_space(rv, space_ids[i]) != NULL)
+			continue;
+		struct space *space = space_cache_find(space_ids[i]);
+		if (space == NULL)
+			goto fail;
+		if (!space_is_memtx(space)) {
+			diag_set(ClientError, ER_UNSUPPORTED,
+				 space->engine->name, "read view");
+			goto fail;
+		}
+		/*
+		 * Tuples of temporary spaces are freed immediately
+		 * even in the delayed free mode.
+		 */
+		if (space_is_temporary(space)) {
+			diag_set(ClientError, ER_UNSUPPORTED,
+				 "Temporary space", "read view");
+			goto fail;
+		}
+		struct index *pk = index_find(space, 0);
+		if (pk == NULL)
+			goto fail;
+		struct read_view_space *rv_space =
+			&rv->spaces[rv->space_count];
+		rv_space->space_id = space_id(space);
+		rv_space->iterator = index_create_snapshot_iterator(pk);
+		if (rv_space->iterator == NULL)
+			goto fail;
+		rv->space_count++;
+	}
+	return rv;
+fail:
+	read_view_close(rv);
+	return NULL;
+}
+
+void
+read_view_close(struct read_view *rv)
+{
+	assert(!rv->is_busy);
+	for (uint32_t i = 0; i < rv->space_count; i++) {
+		struct snapshot_iterator *it = rv->spaces[i].iterator;
+		it->free(it);
+	}
+	free(rv->spaces);
+	free(rv);
+}
+
+struct read_view_space *
+read_view_find_space(struct read_view *rv, uint32_t space_id)
+{
+	for (uint32_t i = 0; i < rv->space_count; i++) {
+		if (rv->spaces[i].space_id == space_id)
+			return &rv->spaces[i];
+	}
+	return NULL;
+}
+
+int
+read_view_space_next(struct read_view_space *space,
+		     const char **data, uint32_t *size)
+{
+	struct snapshot_iterator *it = space->iterator;
+	return it->next(it, data, size);
+}
+
+/**
+ * Read views are scanned in background threads so as not to
+ * stall tx. This structure represents such a thread.
+ */
+struct read_view_reader {
+	/** Thread that scans read views. */
+	struct cord cord;
+	/** Pipe from tx to the reader thread. */
+	struct cpipe reader_pipe;
+	/** Pipe from the reader thread to tx. */
+	struct cpipe tx_pipe;
+};
+
+/** Pool of read view reader threads, started on demand. */
+static struct {
+	/** Reader threads. */
+	struct read_view_reader *pool;
+	/** Number of threads in the pool. */
+	int pool_size;
+	/** Number of started threads. */
+	int started;
+	/** Next thread to use, round-robin. */
+	int next;
+} readers;
+
+/** Cbus message for a read view scan. */
+struct read_view_scan_msg {
+	/** Parent. */
+	struct cbus_call_msg base;
+	/** Read view to scan. */
+	struct read_view *rv;
+	/** Space to scan or NULL to scan all spaces. */
+	struct read_view_space *space;
+	/** Callback invoked for each tuple. */
+	read_view_scan_cb cb;
+	/** Argument passed to the callback. */
+	void *arg;
+};
+
+void
+read_view_init(int threads)
+{
+	assert(threads > 0);
+	readers.pool_size = threads;
+}
+
+void
+read_view_free(void)
+{
+	for (int i = 0; i < readers.started; i++) {
+		struct read_view_reader *reader = &readers.pool[i];
+		tt_pthread_cancel(reader->cord.id);
+		tt_pthread_join(reader->cord.id, NULL);
+	}
+	free(readers.pool);
+	memset(&readers, 0, sizeof(readers));
+}
+
+/** Reader thread function. */
+static int
+read_view_reader_f(va_list ap)
+{
+	struct read_view_reader *reader =
+		va_arg(ap, struct read_view_reader *);
+	struct cbus_endpoint endpoint;
+
+	cpipe_create(&reader->tx_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&reader->tx_pipe);
+	return 0;
+}
+
+/**
+ * Pick a reader thread to scan a read view, starting it if
+ * necessary. Returns NULL and sets diag on failure.
+ */
+static struct read_view_reader *
+read_view_reader_get(void)
+{
+	assert(readers.pool_size > 0);
+	if (readers.pool == NULL) {
+		readers.pool = calloc(readers.pool_size,
+				      sizeof(*readers.pool));
+		if (readers.pool == NULL) {
+			diag_set(OutOfMemory,
+				 readers.pool_size * sizeof(*readers.pool),
+				 "calloc", "struct read_view_reader");
+			return NULL;
+		}
+	}
+	int i = readers.next++;
+	readers.next %= readers.pool_size;
+	if (i < readers.started)
+		return &readers.pool[i];
+	/* Threads are started in order of use. */
+	assert(i == readers.started);
+	struct read_view_reader *reader = &readers.pool[i];
+	char name[FIBER_NAME_MAX];
+	snprintf(name, sizeof(name), "read_view.%d", i);
+	if (cord_costart(&reader->cord, name,
+			 read_view_reader_f, reader) != 0) {
+		readers.next = i;
+		return NULL;
+	}
+	cpipe_create(&reader->reader_pipe, name);
+	readers.started++;
+	return reader;
+}
+
+/** Scan a read view space, invoking a callback for each tuple. */
+static int
+read_view_scan_space(struct read_view_space *space,
+		     read_view_scan_cb cb, void *arg)
+{
+	const char *data;
+	uint32_t size;
+	int rc;
+	while ((rc = read_view_space_next(space, &data, &size)) == 0 &&
+	       data != NULL) {
+		if (cb(space->space_id, data, size, arg) != 0)
+			return -1;
+	}
+	return rc;
+}
+
+/** Scan a read view on behalf of a reader thread. */
+static int
+read_view_scan_f(struct cbus_call_msg *base)
+{
+	struct read_view_scan_msg *msg = (struct read_view_scan_msg *)base;
+	if (msg->space != NULL)
+		return read_view_scan_space(msg->space, msg->cb, msg->arg);
+	struct read_view *rv = msg->rv;
+	for (uint32_t i = 0; i < rv->space_count; i++) {
+		if (read_view_scan_space(&rv->spaces[i],
+					 msg->cb, msg->arg) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+int
+read_view_scan(struct read_view *rv, struct read_view_space *space,
+	       read_view_scan_cb cb, void *arg)
+{
+	assert(!rv->is_busy);
+	struct read_view_reader *reader = read_view_reader_get();
+	if (reader == NULL)
+		return -1;
+	struct read_view_scan_msg msg;
+	msg.rv = rv;
+	msg.space = space;
+	msg.cb = cb;
+	msg.arg = arg;
+	rv->is_busy = true;
+	/*
+	 * The message lives on the stack so the fiber can't
+	 * leave until the reader thread is done with it.
+	 */
+	bool cancellable = fiber_set_cancellable(false);
+	int rc = cbus_call(&reader->reader_pipe, &reader->tx_pipe,
+			   &msg.base, read_view_scan_f, NULL,
+			   TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+	rv->is_busy = false;
+	if (rc != 0)
+		return -1;
+	if (fiber_is_cancelled()) {
+		diag_set(FiberIsCancelled);
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,142 @@
+#ifndef TARANTOOL_BOX_READ_VIEW_H_INCLUDED
+#define TARANTOOL_BOX_READ_VIEW_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct snapshot_iterator;
+
+/** A space of a read view. */
+struct read_view_space {
+	/** Space id. */
+	uint32_t space_id;
+	/** Iterator over the primary index of the space. */
+	struct snapshot_iterator *iterator;
+};
+
+/**
+ * A consistent read view of several memtx spaces.
+ *
+ * A read view is built on top of snapshot iterators, the
+ * same way as checkpoints and initial join are: the primary
+ * index of each space is frozen and memtx delays freeing of
+ * tuples until the read view is closed. Writes are neither
+ * blocked by a read view nor visible through it.
+ *
+ * A read view must be opened and closed in the tx thread,
+ * but its spaces may be scanned from any thread. Heavy scans
+ * are offloaded to a pool of reader threads, see
+ * read_view_scan(). Each space can be scanned only once.
+ *
+ * Note, memory of tuples deleted or replaced after a read
+ * view was opened is not reclaimed until it is closed, so
+ * long living read views increase memtx memory usage.
+ */
+struct read_view {
+	/** Spaces included in the read view. */
+	struct read_view_space *spaces;
+	/** Number of spaces in the read view. */
+	uint32_t space_count;
+	/** Set while the read view is scanned in a reader thread. */
+	bool is_busy;
+};
+
+/**
+ * Callback invoked by read_view_scan() for each tuple.
+ * Returns 0 to continue the scan, -1 to abort it.
+ */
+typedef int
+(*read_view_scan_cb)(uint32_t space_id, const char *data,
+		     uint32_t size, void *arg);
+
+/**
+ * Open a read view of the given spaces. All spaces must be
+ * memtx and not temporary. Returns NULL and sets diag on
+ * error.
+ */
+struct read_view *
+read_view_open(const uint32_t *space_ids, uint32_t space_count);
+
+/**
+ * Close a read view and release the memory pinned by it.
+ */
+void
+read_view_close(struct read_view *rv);
+
+/**
+ * Look up a space in a read view. Returns NULL if there's
+ * no such space in the read view.
+ */
+struct read_view_space *
+read_view_find_space(struct read_view *rv, uint32_t space_id);
+
+/**
+ * Fetch the next tuple of a read view space. Sets @data to
+ * NULL on EOF. Thread-safe, as long as the space isn't scanned
+ * from different threads concurrently.
+ */
+int
+read_view_space_next(struct read_view_space *space,
+		     const char **data, uint32_t *size);
+
+/**
+ * Scan a space of a read view or all its spaces if @space is
+ * NULL in a reader thread, calling @cb for each tuple. The calling
+ * fiber yields until the scan is complete while other tx fibers
+ * keep running. @cb is invoked in the reader thread and so must
+ * not access tx thread data. Returns -1 and sets diag if the scan
+ * failed or was aborted by @cb.
+ */
+int
+read_view_scan(struct read_view *rv, struct read_view_space *space,
+	       read_view_scan_cb cb, void *arg);
+
+/**
+ * Initialize the pool of read view reader threads. Threads
+ * are started on the first scan.
+ */
+void
+read_view_init(int threads);
+
+/** Stop read view reader threads. */
+void
+read_view_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_READ_VIEW_H_INCLUDED */
@@ -30,6 +30,8 @@
  */
 #include "recovery.h"
 
+#include "cbus.h"
+
 #include "small/rlist.h"
 #include "scoped_guard.h"
 #include "trigger.h"
@@ -98,6 +100,11 @@ recovery_new(const char *wal_dirname, bool force_recovery,
 	xdir_create(&r->wal_dir, wal_dirname, XLOG, &INSTANCE_UUID,
 		    &xlog_opts_default);
 	r->wal_dir.force_recovery = force_recovery;
+	/*
+	 * Both local recovery and relays read WALs from start
+	 * to end, parse complete ones right from the page cache.
+	 */
+	r->wal_dir.use_mmap = true;
 
 	vclock_copy(&r->vclock, vclock);
 
@@ -112,6 +119,7 @@ recovery_new(const char *wal_dirname, bool force_recovery,
 
 	r->watcher = NULL;
 	rlist_create(&r->on_close_log);
+	r->read_ahead = false;
 
 	guard.is_active = false;
 	return r;
@@ -230,6 +238,46 @@ recovery_delete(struct recovery *r)
 	free(r);
 }
 
+/**
+ * Apply a row read from the current WAL unless it has been
+ * applied already.
+ */
+static void
+recover_row(struct recovery *r, struct xstream *stream,
+	    struct xrow_header *row, uint64_t *row_count)
+{
+	int64_t current_lsn = vclock_get(&r->vclock, row->replica_id);
+	if (row->lsn <= current_lsn)
+		return; /* already applied, skip */
+
+	/*
+	 * All rows in xlog files have an assigned replica
+	 * id. The only exception are local rows, which
+	 * are signed with a zero replica id.
+	 */
+	assert(row->replica_id != 0 || row->group_id == GROUP_LOCAL);
+	/*
+	 * We can promote the vclock either before or
+	 * after xstream_write(): it only makes any impact
+	 * in case of forced recovery, when we skip the
+	 * failed row anyway.
+	 */
+	vclock_follow_xrow(&r->vclock, row);
+	if (xstream_write(stream, row) == 0) {
+		++*row_count;
+		if (*row_count % 100000 == 0)
+			say_info("%.1fM rows processed",
+				 *row_count / 1000000.);
+	} else {
+		if (!r->wal_dir.force_recovery)
+			diag_raise();
+
+		say_error("skipping row {%u: %lld}",
+			  (unsigned)row->replica_id, (long long)row->lsn);
+		diag_log();
+	}
+}
+
 /**
  * Read all rows in a file starting from the last position.
  * Advance the position. If end of file is reached,
@@ -256,37 +304,260 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 		if (stop_vclock != NULL &&
 		    r->vclock.signature >= stop_vclock->signature)
 			return;
-		int64_t current_lsn = vclock_get(&r->vclock, row.replica_id);
-		if (row.lsn <= current_lsn)
-			continue; /* already applied, skip */
+		recover_row(r, stream, &row, &row_count);
+	}
+}
 
-		/*
-		 * All rows in xlog files have an assigned replica
-		 * id. The only exception are local rows, which
-		 * are signed with a zero replica id.
-		 */
-		assert(row.replica_id != 0 || row.group_id == GROUP_LOCAL);
-		/*
-		 * We can promote the vclock either before or
-		 * after xstream_write(): it only makes any impact
-		 * in case of forced recovery, when we skip the
-		 * failed row anyway.
-		 */
-		vclock_follow_xrow(&r->vclock, &row);
-		if (xstream_write(stream, &row) == 0) {
-			++row_count;
-			if (row_count % 100000 == 0)
-				say_info("%.1fM rows processed",
-					 row_count / 1000000.);
-		} else {
-			if (!r->wal_dir.force_recovery)
-				diag_raise();
+enum {
+	/** Max number of rows in a batch read ahead. */
+	RECOVERY_BATCH_ROWS_MAX = 1024,
+};
+
+struct recovery_reader;
+
+/**
+ * A batch of rows read ahead by a WAL reader thread. Row
+ * bodies are copied to the batch buffer, because the xlog
+ * cursor reuses its buffers.
+ */
+struct recovery_batch {
+	struct cmsg base;
+	/** The reader the batch belongs to. */
+	struct recovery_reader *reader;
+	/** Decoded rows. */
+	struct xrow_header rows[RECOVERY_BATCH_ROWS_MAX];
+	/** Number of rows in the batch. */
+	int row_count;
+	/** Row bodies, used by the reader thread only. */
+	struct ibuf data;
+	/** Set if the batch was read and returned to tx. */
+	bool is_ready;
+	/** Set if there are no more rows to read. */
+	bool is_last;
+	/** Set if the EOF marker of the file was read. */
+	bool is_eof;
+	/** Error which stopped reading, if any. */
+	struct diag diag;
+};
+
+/**
+ * A thread reading a WAL file ahead of the tx thread. Two
+ * batches are in flight, so that the reader decompresses and
+ * decodes rows of one batch while tx applies the other one.
+ */
+struct recovery_reader {
+	/** The reader thread. */
+	struct cord cord;
+	/** Pipe from tx to the reader thread. */
+	struct cpipe reader_pipe;
+	/** Pipe from the reader thread to tx. */
+	struct cpipe tx_pipe;
+	/** Route of a batch: read in the reader, return to tx. */
+	struct cmsg_hop batch_route[2];
+	/** Cursor of the file, used by the reader thread only. */
+	struct xlog_cursor cursor;
+	/** Path to the file. */
+	const char *filename;
+	/** Skip corrupted rows, see xlog_cursor_next(). */
+	bool force_recovery;
+	/** Set if there are no more rows to read. */
+	bool is_done;
+	/** Signalled when a batch is returned to tx. */
+	struct fiber_cond cond;
+	/** Batches sent to the reader and not returned yet. */
+	int batches_in_flight;
+	struct recovery_batch batches[2];
+};
+
+/** Read a batch of rows in the reader thread. */
+static void
+recovery_batch_read(struct cmsg *m)
+{
+	struct recovery_batch *batch = (struct recovery_batch *)m;
+	struct recovery_reader *reader = batch->reader;
+	struct ibuf *data = &batch->data;
+	ibuf_reset(data);
+	batch->row_count = 0;
+	if (reader->is_done) {
+		batch->is_last = true;
+		return;
+	}
+	int rc = 0;
+	while (batch->row_count < RECOVERY_BATCH_ROWS_MAX) {
+		struct xrow_header *row = &batch->rows[batch->row_count];
+		rc = xlog_cursor_next(&reader->cursor, row,
+				      reader->force_recovery);
+		if (rc != 0)
+			break;
+		for (int i = 0; i < row->bodycnt; i++) {
+			size_t len = row->body[i].iov_len;
+			char *buf = (char *)ibuf_alloc(data, len);
+			if (buf == NULL) {
+				diag_set(OutOfMemory, len, "ibuf_alloc",
+					 "row body");
+				rc = -1;
+				break;
+			}
+			memcpy(buf, row->body[i].iov_base, len);
+			/* The buffer may move, store the offset. */
+			row->body[i].iov_base = (void *)(buf - data->rpos);
+		}
+		if (rc != 0)
+			break;
+		batch->row_count++;
+	}
+	for (int i = 0; i < batch->row_count; i++) {
+		struct xrow_header *row = &batch->rows[i];
+		for (int j = 0; j < row->bodycnt; j++) {
+			row->body[j].iov_base = data->rpos +
+				(uintptr_t)row->body[j].iov_base;
+		}
+	}
+	if (rc != 0) {
+		if (rc < 0)
+			diag_move(diag_get(), &batch->diag);
+		batch->is_last = true;
+		batch->is_eof = xlog_cursor_is_eof(&reader->cursor);
+		reader->is_done = true;
+	}
+}
 
-			say_error("skipping row {%u: %lld}",
-				  (unsigned)row.replica_id, (long long)row.lsn);
-			diag_log();
+/** Return a batch to tx. */
+static void
+recovery_batch_ready(struct cmsg *m)
+{
+	struct recovery_batch *batch = (struct recovery_batch *)m;
+	struct recovery_reader *reader = batch->reader;
+	batch->is_ready = true;
+	reader->batches_in_flight--;
+	fiber_cond_signal(&reader->cond);
+}
+
+/** Send a batch to the reader thread. */
+static void
+recovery_batch_send(struct recovery_batch *batch)
+{
+	struct recovery_reader *reader = batch->reader;
+	cmsg_init(&batch->base, reader->batch_route);
+	batch->is_ready = false;
+	reader->batches_in_flight++;
+	cpipe_push(&reader->reader_pipe, &batch->base);
+}
+
+static int
+recovery_reader_f(va_list ap)
+{
+	struct recovery_reader *reader = va_arg(ap, struct recovery_reader *);
+	for (int i = 0; i < (int)lengthof(reader->batches); i++)
+		ibuf_create(&reader->batches[i].data, &cord()->slabc, 16384);
+	struct recovery_batch *batch = &reader->batches[0];
+	if (xlog_cursor_open_mmap(&reader->cursor, reader->filename) != 0) {
+		diag_move(diag_get(), &batch->diag);
+		reader->is_done = true;
+	}
+
+	struct cbus_endpoint endpoint;
+	cpipe_create(&reader->tx_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&reader->tx_pipe);
+
+	if (xlog_cursor_is_open(&reader->cursor))
+		xlog_cursor_close(&reader->cursor, false);
+	for (int i = 0; i < (int)lengthof(reader->batches); i++)
+		ibuf_destroy(&reader->batches[i].data);
+	return 0;
+}
+
+/** Start a thread reading the given WAL file. */
+static struct recovery_reader *
+recovery_reader_new(const char *filename, bool force_recovery)
+{
+	struct recovery_reader *reader =
+		(struct recovery_reader *)calloc(1, sizeof(*reader));
+	if (reader == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*reader), "calloc",
+			  "struct recovery_reader");
+	}
+	reader->filename = filename;
+	reader->force_recovery = force_recovery;
+	fiber_cond_create(&reader->cond);
+	for (int i = 0; i < (int)lengthof(reader->batches); i++) {
+		reader->batches[i].reader = reader;
+		diag_create(&reader->batches[i].diag);
+	}
+	reader->batch_route[0].f = recovery_batch_read;
+	reader->batch_route[0].pipe = &reader->tx_pipe;
+	reader->batch_route[1].f = recovery_batch_ready;
+	reader->batch_route[1].pipe = NULL;
+	if (cord_costart(&reader->cord, "wal_reader",
+			 recovery_reader_f, reader) != 0) {
+		free(reader);
+		diag_raise();
+	}
+	cpipe_create(&reader->reader_pipe, "wal_reader");
+	return reader;
+}
+
+/** Stop a reader thread once all batches have returned. */
+static void
+recovery_reader_delete(struct recovery_reader *reader)
+{
+	while (reader->batches_in_flight > 0)
+		fiber_cond_wait(&reader->cond);
+	cbus_stop_loop(&reader->reader_pipe);
+	cpipe_destroy(&reader->reader_pipe);
+	if (cord_join(&reader->cord) != 0)
+		panic_syserror("WAL reader: thread join failed");
+	for (int i = 0; i < (int)lengthof(reader->batches); i++)
+		diag_destroy(&reader->batches[i].diag);
+	fiber_cond_destroy(&reader->cond);
+	free(reader);
+}
+
+/**
+ * Read all rows of the current WAL in a reader thread and
+ * close the WAL. Unlike recover_xlog(), it doesn't leave the
+ * WAL open, so it must not be used for the last one, which
+ * may be appended.
+ */
+static void
+recover_xlog_ahead(struct recovery *r, struct xstream *stream)
+{
+	struct recovery_reader *reader =
+		recovery_reader_new(r->cursor.name, r->wal_dir.force_recovery);
+	auto guard = make_scoped_guard([=] {
+		recovery_reader_delete(reader);
+	});
+	for (int i = 0; i < (int)lengthof(reader->batches); i++)
+		recovery_batch_send(&reader->batches[i]);
+
+	uint64_t row_count = 0;
+	for (int i = 0; ; i = (i + 1) % lengthof(reader->batches)) {
+		struct recovery_batch *batch = &reader->batches[i];
+		while (!batch->is_ready)
+			fiber_cond_wait(&reader->cond);
+		for (int j = 0; j < batch->row_count; j++)
+			recover_row(r, stream, &batch->rows[j], &row_count);
+		if (batch->is_last) {
+			if (!diag_is_empty(&batch->diag)) {
+				diag_move(&batch->diag, diag_get());
+				diag_raise();
+			}
+			if (batch->is_eof) {
+				say_info("done `%s'", r->cursor.name);
+			} else {
+				say_warn("file `%s` wasn't correctly closed",
+					 r->cursor.name);
+			}
+			break;
 		}
+		recovery_batch_send(batch);
 	}
+	xlog_cursor_close(&r->cursor, false);
+	trigger_run_xc(&r->on_close_log, NULL);
 }
 
 /**
@@ -345,6 +616,12 @@ recover_remaining_wals(struct recovery *r, struct xstream *stream,
 
 		say_info("recover from `%s'", r->cursor.name);
 
+		if (r->read_ahead && stop_vclock == NULL &&
+		    vclockset_next(&r->wal_dir.index, clock) != NULL) {
+			recover_xlog_ahead(r, stream);
+			continue;
+		}
+
 recover_current_wal:
 		recover_xlog(r, stream, stop_vclock);
 	}
@@ -364,11 +641,32 @@ recovery_finalize(struct recovery *r)
 	recovery_close_log(r);
 }
 
+void
+recovery_release_log(struct recovery *r)
+{
+	if (xlog_cursor_is_open(&r->cursor))
+		xlog_cursor_close(&r->cursor, false);
+	/*
+	 * The next WAL to read may not follow the released one
+	 * so don't let recovery_open_log() check them for a gap.
+	 */
+	r->cursor.state = XLOG_CURSOR_NEW;
+}
+
 
 /* }}} */
 
 /* {{{ Local recovery: support of hot standby and replication relay */
 
+/**
+ * How often to stat the WAL directory and the current xlog
+ * file if the file system doesn't support inotify, e.g. if
+ * the directory is shared over the network. The libev default
+ * is about 5 seconds, which is how much a hot standby would
+ * lag behind the master. libev doesn't allow less than 0.1.
+ */
+static const ev_tstamp WAL_STAT_INTERVAL = 0.1;
+
 /**
  * Implements a subscription to WAL updates via fs events.
  * Any change to the WAL dir itself or a change in the XLOG
@@ -416,7 +714,7 @@ public:
 		dir_stat.data = this;
 		file_stat.data = this;
 
-		ev_stat_set(&dir_stat, dir_path, 0.0);
+		ev_stat_set(&dir_stat, dir_path, WAL_STAT_INTERVAL);
 		ev_stat_start(loop(), &dir_stat);
 	}
 
@@ -448,7 +746,7 @@ public:
 
 			panic("path too long: %s", path);
 		}
-		ev_stat_set(&file_stat, file_path, 0.0);
+		ev_stat_set(&file_stat, file_path, WAL_STAT_INTERVAL);
 		ev_stat_start(loop(), &file_stat);
 	}
 };
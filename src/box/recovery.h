@@ -58,6 +58,11 @@ struct recovery {
 	struct fiber *watcher;
 	/** List of triggers invoked when the current WAL is closed. */
 	struct rlist on_close_log;
+	/**
+	 * If set, WALs except the last one are read and decoded
+	 * ahead in a reader thread. Used by local recovery.
+	 */
+	bool read_ahead;
 };
 
 struct recovery *
@@ -88,6 +93,15 @@ recovery_stop_local(struct recovery *r);
 void
 recovery_finalize(struct recovery *r);
 
+/**
+ * Close the current WAL without invoking on_close_log triggers
+ * and forget about it, so that recover_remaining_wals() looks
+ * up the WAL containing the recovery vclock anew. Used when
+ * the rows are read from elsewhere for a while.
+ */
+void
+recovery_release_log(struct recovery *r);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -46,6 +46,7 @@
 #include "iproto_constants.h"
 #include "recovery.h"
 #include "replication.h"
+#include "schema_def.h"
 #include "trigger.h"
 #include "vclock.h"
 #include "version.h"
@@ -55,6 +56,8 @@
 #include "wal.h"
 #include "txn_limbo.h"
 
+#include <zstd.h>
+
 /**
  * Cbus message to send status updates from relay to tx thread.
  */
@@ -84,6 +87,21 @@ struct relay_gc_msg {
 	struct vclock vclock;
 };
 
+enum {
+	/**
+	 * zstd level used for the replication stream. The
+	 * fastest one is used, because the relay compresses
+	 * rows on the fly.
+	 */
+	RELAY_ZSTD_LEVEL = 1,
+	/**
+	 * Size of the rows buffered by a subscribed relay after
+	 * which they are written to the replica without waiting
+	 * for the end of a WAL event.
+	 */
+	RELAY_SEND_BUF_MAX = 256 * 1024,
+};
+
 /** State of a replication relay. */
 struct relay {
 	/** The thread in which we relay data to the replica. */
@@ -117,6 +135,15 @@ struct relay {
 	 * is passed by the replica on subscribe.
 	 */
 	uint32_t id_filter;
+	/**
+	 * Sorted ids of user spaces to relay, passed by the
+	 * replica on subscribe. Rows of the other user spaces are
+	 * relayed as NOPs to promote the replica vclock. NULL if
+	 * all spaces are relayed.
+	 */
+	uint32_t *space_filter;
+	/** Number of ids in space_filter. */
+	uint32_t space_filter_size;
 	/**
 	 * Local vclock at the moment of subscribe, used to check
 	 * dataset on the other side and send missing data rows if any.
@@ -140,6 +167,43 @@ struct relay {
 	double last_row_time;
 	/** Relay sync state. */
 	enum relay_state state;
+	/**
+	 * Position in the in-memory WAL tail, see wal_tail_read(),
+	 * or -1 if rows are read from xlog files.
+	 */
+	int64_t wal_tail_pos;
+	/** Buffer for rows copied from the in-memory WAL tail. */
+	struct ibuf wal_tail_buf;
+	/** Number of WAL events handled with rows sent from memory. */
+	int64_t wal_tail_hits;
+	/** Number of WAL events handled by reading xlog files. */
+	int64_t wal_tail_misses;
+	/**
+	 * Compression of the stream negotiated on subscribe,
+	 * see replication_compression.
+	 */
+	enum compression_type compression;
+	/**
+	 * Compression context, lives as long as the subscription
+	 * so that rows are compressed with the history of all
+	 * the rows sent before them.
+	 */
+	ZSTD_CStream *zstd;
+	/**
+	 * Set if rows are accumulated in send_buf rather than
+	 * written to the replica one by one. Only SUBSCRIBE
+	 * batches rows, so that all the rows of a WAL event are
+	 * sent with a single write, see relay_flush().
+	 */
+	bool is_batching;
+	/** Rows (compressed, if the stream is) yet to be sent. */
+	struct ibuf send_buf;
+	/** Number of bytes of rows passed to the compressor. */
+	int64_t compression_raw;
+	/** Value of compression_raw at the last compressor flush. */
+	int64_t compression_flushed;
+	/** Number of compressed bytes sent to the replica. */
+	int64_t compression_sent;
 
 	struct {
 		/* Align to prevent false-sharing with tx thread */
@@ -167,6 +231,23 @@ relay_vclock(const struct relay *relay)
 	return &relay->tx.vclock;
 }
 
+void
+relay_wal_tail_stat(const struct relay *relay, int64_t *hits,
+		    int64_t *misses)
+{
+	*hits = relay->wal_tail_hits;
+	*misses = relay->wal_tail_misses;
+}
+
+enum compression_type
+relay_compression_stat(const struct relay *relay, int64_t *raw,
+		       int64_t *compressed)
+{
+	*raw = relay->compression_raw;
+	*compressed = relay->compression_sent;
+	return relay->compression;
+}
+
 double
 relay_last_row_time(const struct relay *relay)
 {
@@ -176,6 +257,8 @@ relay_last_row_time(const struct relay *relay)
 static void
 relay_send(struct relay *relay, struct xrow_header *packet);
 static void
+relay_flush(struct relay *relay);
+static void
 relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row);
 static void
 relay_send_row(struct xstream *stream, struct xrow_header *row);
@@ -258,6 +341,11 @@ relay_stop(struct relay *relay)
 	if (relay->r != NULL)
 		recovery_delete(relay->r);
 	relay->r = NULL;
+	ZSTD_freeCStream(relay->zstd);
+	relay->zstd = NULL;
+	free(relay->space_filter);
+	relay->space_filter = NULL;
+	relay->space_filter_size = 0;
 	relay->state = RELAY_STOPPED;
 	/*
 	 * Needed to track whether relay thread is running or not
@@ -501,6 +589,53 @@ relay_set_error(struct relay *relay, struct error *e)
 		diag_set_error(&relay->diag, e);
 }
 
+/**
+ * Send the rows written to WAL since the last call, copying
+ * them from the in-memory WAL tail. Return false if the rows
+ * aren't in memory and must be read from xlog files.
+ */
+static bool
+relay_send_wal_tail(struct relay *relay)
+{
+	struct recovery *r = relay->r;
+	struct ibuf *buf = &relay->wal_tail_buf;
+	ibuf_reset(buf);
+	if (wal_tail_read(&relay->wal_tail_pos, &r->vclock, buf) != 0) {
+		relay->wal_tail_pos = -1;
+		relay->wal_tail_misses++;
+		return false;
+	}
+	relay->wal_tail_hits++;
+	/*
+	 * The position in the current xlog gets stale as soon
+	 * as the rows are sent from memory.
+	 */
+	recovery_release_log(r);
+	const char *data = buf->rpos;
+	const char *data_end = buf->wpos;
+	while (data < data_end) {
+		struct xrow_header row;
+		int rc = wal_tail_next(&data, data_end, &row);
+		if (rc < 0)
+			diag_raise();
+		if (rc > 0) {
+			/*
+			 * A new WAL was created, so everything
+			 * sent so far is stored in older files,
+			 * see relay_on_close_log_f().
+			 */
+			trigger_run_xc(&r->on_close_log, NULL);
+			continue;
+		}
+		/* See recover_xlog(). */
+		if (row.lsn <= vclock_get(&r->vclock, row.replica_id))
+			continue;
+		vclock_follow_xrow(&r->vclock, &row);
+		relay_send_row(&relay->stream, &row);
+	}
+	return true;
+}
+
 static void
 relay_process_wal_event(struct wal_watcher *watcher, unsigned events)
 {
@@ -518,8 +653,18 @@ relay_process_wal_event(struct wal_watcher *watcher, unsigned events)
 		return;
 	}
 	try {
-		recover_remaining_wals(relay->r, &relay->stream, NULL,
-				       (events & WAL_EVENT_ROTATE) != 0);
+		if (!relay_send_wal_tail(relay)) {
+			/*
+			 * Rescan the WAL directory if the rows were
+			 * sent from memory before, the files might
+			 * have been created in the meantime.
+			 */
+			bool scan_dir = (events & WAL_EVENT_ROTATE) != 0 ||
+					!xlog_cursor_is_open(&relay->r->cursor);
+			recover_remaining_wals(relay->r, &relay->stream, NULL,
+					       scan_dir);
+		}
+		relay_flush(relay);
 	} catch (Exception *e) {
 		relay_set_error(relay, e);
 		fiber_cancel(fiber());
@@ -568,6 +713,7 @@ relay_send_heartbeat(struct relay *relay)
 	xrow_encode_timestamp(&row, instance_id, ev_now(loop()));
 	try {
 		relay_send(relay, &row);
+		relay_flush(relay);
 	} catch (Exception *e) {
 		relay_set_error(relay, e);
 		fiber_cancel(fiber());
@@ -587,6 +733,15 @@ relay_subscribe_f(va_list ap)
 
 	coio_enable();
 	relay_set_cord_name(relay->io.fd);
+	relay->wal_tail_pos = -1;
+	relay->wal_tail_hits = 0;
+	relay->wal_tail_misses = 0;
+	ibuf_create(&relay->wal_tail_buf, &cord()->slabc, 1024);
+	relay->compression_raw = 0;
+	relay->compression_sent = 0;
+	relay->compression_flushed = 0;
+	ibuf_create(&relay->send_buf, &cord()->slabc, 1024);
+	relay->is_batching = true;
 
 	/* Create cpipe to tx for propagating vclock. */
 	cbus_endpoint_create(&relay->endpoint, tt_sprintf("relay_%p", relay),
@@ -699,15 +854,47 @@ relay_subscribe_f(va_list ap)
 		    NULL, NULL, cbus_process);
 	cbus_endpoint_destroy(&relay->endpoint, cbus_process);
 
+	relay->is_batching = false;
+	ibuf_destroy(&relay->send_buf);
+	ibuf_destroy(&relay->wal_tail_buf);
 	relay_exit(relay);
 	return -1;
 }
 
+/** Create the compression context of a relay. */
+static int
+relay_zstd_create(struct relay *relay)
+{
+	assert(relay->zstd == NULL);
+	relay->zstd = ZSTD_createCStream();
+	if (relay->zstd == NULL) {
+		diag_set(OutOfMemory, 0, "ZSTD_createCStream", "zstd");
+		return -1;
+	}
+	size_t rc = ZSTD_initCStream(relay->zstd, RELAY_ZSTD_LEVEL);
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_COMPRESSION, ZSTD_getErrorName(rc));
+		ZSTD_freeCStream(relay->zstd);
+		relay->zstd = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+static int
+relay_space_id_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = *(const uint32_t *)a;
+	uint32_t id_b = *(const uint32_t *)b;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
 /** Replication acceptor fiber handler. */
 void
 relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 		struct vclock *replica_clock, uint32_t replica_version_id,
-		uint32_t replica_id_filter)
+		uint32_t replica_id_filter, enum compression_type compression,
+		const uint32_t *space_filter, uint32_t space_filter_size)
 {
 	assert(replica->anon || replica->id != REPLICA_ID_NIL);
 	struct relay *relay = replica->relay;
@@ -737,6 +924,21 @@ relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 	relay->version_id = replica_version_id;
 
 	relay->id_filter = replica_id_filter;
+	relay->compression = compression;
+	if (compression == COMPRESSION_TYPE_ZSTD && relay_zstd_create(relay) != 0)
+		diag_raise();
+	if (space_filter_size > 0) {
+		size_t size = space_filter_size * sizeof(*space_filter);
+		relay->space_filter = (uint32_t *)malloc(size);
+		if (relay->space_filter == NULL) {
+			diag_set(OutOfMemory, size, "malloc", "space_filter");
+			diag_raise();
+		}
+		memcpy(relay->space_filter, space_filter, size);
+		qsort(relay->space_filter, space_filter_size,
+		      sizeof(*space_filter), relay_space_id_cmp);
+		relay->space_filter_size = space_filter_size;
+	}
 
 	int rc = cord_costart(&relay->cord, "subscribe",
 			      relay_subscribe_f, relay);
@@ -746,6 +948,79 @@ relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 		diag_raise();
 }
 
+/**
+ * Append a row to the send buffer, compressing it if the stream
+ * is compressed. The compressor isn't flushed, so that the rows
+ * of a batch are compressed together, see relay_flush().
+ */
+static void
+relay_buffer_row(struct relay *relay, const struct xrow_header *packet)
+{
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_to_iovec_xc(packet, iov);
+	struct ibuf *buf = &relay->send_buf;
+	if (relay->zstd == NULL) {
+		for (int i = 0; i < iovcnt; i++) {
+			void *dst = ibuf_alloc_xc(buf, iov[i].iov_len);
+			memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+		}
+		return;
+	}
+	size_t out_size = ZSTD_CStreamOutSize();
+	for (int i = 0; i < iovcnt; i++) {
+		ZSTD_inBuffer src = { iov[i].iov_base, iov[i].iov_len, 0 };
+		while (src.pos < src.size) {
+			ibuf_reserve_xc(buf, out_size);
+			ZSTD_outBuffer dst = { buf->wpos, ibuf_unused(buf), 0 };
+			size_t rc = ZSTD_compressStream(relay->zstd, &dst, &src);
+			if (ZSTD_isError(rc)) {
+				tnt_raise(ClientError, ER_COMPRESSION,
+					  ZSTD_getErrorName(rc));
+			}
+			buf->wpos += dst.pos;
+		}
+		relay->compression_raw += iov[i].iov_len;
+	}
+}
+
+/**
+ * Write the rows accumulated in the send buffer to the replica.
+ * The compressor is flushed, so the replica can decode the rows
+ * as soon as it gets them, but its context isn't reset, so rows
+ * are compressed against the data sent before them.
+ */
+static void
+relay_flush(struct relay *relay)
+{
+	struct ibuf *buf = &relay->send_buf;
+	if (relay->compression_raw > relay->compression_flushed) {
+		assert(relay->zstd != NULL);
+		size_t out_size = ZSTD_CStreamOutSize();
+		size_t rc;
+		do {
+			ibuf_reserve_xc(buf, out_size);
+			ZSTD_outBuffer dst = { buf->wpos, ibuf_unused(buf), 0 };
+			rc = ZSTD_flushStream(relay->zstd, &dst);
+			if (ZSTD_isError(rc)) {
+				tnt_raise(ClientError, ER_COMPRESSION,
+					  ZSTD_getErrorName(rc));
+			}
+			buf->wpos += dst.pos;
+		} while (rc != 0);
+		relay->compression_flushed = relay->compression_raw;
+		relay->compression_sent += ibuf_used(buf);
+	}
+	if (ibuf_used(buf) == 0)
+		return;
+	/*
+	 * The buffer is reset even if the write fails: the relay
+	 * exits then, and the batch must not be resent anyway.
+	 */
+	size_t size = ibuf_used(buf);
+	ibuf_reset(buf);
+	coio_write(&relay->io, buf->rpos, size);
+}
+
 static void
 relay_send(struct relay *relay, struct xrow_header *packet)
 {
@@ -753,12 +1028,22 @@ relay_send(struct relay *relay, struct xrow_header *packet)
 
 	packet->sync = relay->sync;
 	relay->last_row_time = ev_monotonic_now(loop());
-	coio_write_xrow(&relay->io, packet);
+	if (relay->is_batching) {
+		relay_buffer_row(relay, packet);
+		if (ibuf_used(&relay->send_buf) >= RELAY_SEND_BUF_MAX)
+			relay_flush(relay);
+	} else {
+		coio_write_xrow(&relay->io, packet);
+	}
 	fiber_gc();
 
 	struct errinj *inj = errinj(ERRINJ_RELAY_TIMEOUT, ERRINJ_DOUBLE);
-	if (inj != NULL && inj->dparam > 0)
+	if (inj != NULL && inj->dparam > 0) {
+		/* Let the replica see the row before sleeping. */
+		if (relay->is_batching)
+			relay_flush(relay);
 		fiber_sleep(inj->dparam);
+	}
 }
 
 static void
@@ -773,6 +1058,39 @@ relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row)
 		relay_send(relay, row);
 }
 
+/**
+ * Check if a row changes a user space which the replica didn't
+ * ask for. System spaces are always relayed, so the replica
+ * gets all the schema changes.
+ */
+static bool
+relay_row_is_filtered(struct relay *relay, struct xrow_header *packet)
+{
+	if (relay->space_filter == NULL || !iproto_type_is_dml(packet->type))
+		return false;
+	assert(packet->bodycnt == 1);
+	const char *data = (const char *)packet->body[0].iov_base;
+	if (mp_typeof(*data) != MP_MAP)
+		return false;
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*data) != MP_UINT ||
+		    mp_decode_uint(&data) != IPROTO_SPACE_ID) {
+			mp_next(&data);
+			continue;
+		}
+		if (mp_typeof(*data) != MP_UINT)
+			return false;
+		uint32_t space_id = mp_decode_uint(&data);
+		if (space_id < BOX_SYSTEM_ID_MAX)
+			return false;
+		return bsearch(&space_id, relay->space_filter,
+			       relay->space_filter_size,
+			       sizeof(space_id), relay_space_id_cmp) == NULL;
+	}
+	return false;
+}
+
 /** Send a single row to the client. */
 static void
 relay_send_row(struct xstream *stream, struct xrow_header *packet)
@@ -799,6 +1117,15 @@ relay_send_row(struct xstream *stream, struct xrow_header *packet)
 	/* Check if the rows from the instance are filtered. */
 	if ((1 << packet->replica_id & relay->id_filter) != 0)
 		return;
+	/*
+	 * Rows of the spaces the replica isn't interested in are
+	 * replaced with NOPs, which keep its vclock in sync with
+	 * ours and transaction boundaries intact.
+	 */
+	if (relay_row_is_filtered(relay, packet)) {
+		packet->type = IPROTO_NOP;
+		packet->bodycnt = 0;
+	}
 	/*
 	 * We're feeding a WAL, thus responding to FINAL JOIN or SUBSCRIBE
 	 * request. If this is FINAL JOIN (i.e. relay->replica is NULL),
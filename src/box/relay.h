@@ -32,6 +32,7 @@
  */
 
 #include <stdint.h>
+#include "field_def.h" /* enum compression_type */
 
 #if defined(__cplusplus)
 extern "C" {
@@ -93,6 +94,24 @@ relay_vclock(const struct relay *relay);
 double
 relay_last_row_time(const struct relay *relay);
 
+/**
+ * Returns the number of WAL events the relay handled by sending
+ * rows from memory (@a hits) and by reading xlog files
+ * (@a misses).
+ */
+void
+relay_wal_tail_stat(const struct relay *relay, int64_t *hits,
+		    int64_t *misses);
+
+/**
+ * Returns compression of the replication stream sent by the
+ * relay and the number of bytes of rows the relay has sent
+ * before (@a raw) and after (@a compressed) compression.
+ */
+enum compression_type
+relay_compression_stat(const struct relay *relay, int64_t *raw,
+		       int64_t *compressed);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -120,11 +139,19 @@ relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
 /**
  * Subscribe a replica to updates.
  *
+ * @param compression compression of the stream negotiated
+ *                    with the replica.
+ * @param space_filter ids of user spaces requested by the
+ *                     replica, rows of the others are sent
+ *                     as NOPs.
+ * @param space_filter_size number of ids in space_filter,
+ *                          0 to relay all spaces.
  * @return none.
  */
 void
 relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 		struct vclock *replica_vclock, uint32_t replica_version_id,
-		uint32_t replica_id_filter);
+		uint32_t replica_id_filter, enum compression_type compression,
+		const uint32_t *space_filter, uint32_t space_filter_size);
 
 #endif /* TARANTOOL_REPLICATION_RELAY_H_INCLUDED */
@@ -55,6 +55,11 @@ int replication_synchro_quorum = 1;
 double replication_synchro_timeout = 5.0; /* seconds */
 double replication_sync_timeout = 300.0; /* seconds */
 bool replication_skip_conflict = false;
+int replication_apply_fibers = 1;
+double replication_ack_interval = 0; /* seconds */
+uint32_t *replication_spaces = NULL;
+uint32_t replication_space_count = 0;
+enum compression_type replication_compression = COMPRESSION_TYPE_NONE;
 bool replication_anon = false;
 
 struct replicaset replicaset;
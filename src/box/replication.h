@@ -40,6 +40,7 @@
 #include "fiber_cond.h"
 #include "vclock.h"
 #include "latch.h"
+#include "field_def.h" /* enum compression_type */
 
 /**
  * @module replication - global state of multi-master
@@ -149,6 +150,38 @@ extern double replication_sync_timeout;
  */
 extern bool replication_skip_conflict;
 
+/**
+ * Number of fibers applying transactions received by an
+ * applier. If greater than 1, transactions which don't change
+ * the same keys are applied concurrently.
+ */
+extern int replication_apply_fibers;
+
+/**
+ * Min interval between two vclock ACKs sent by an applier to
+ * its master. ACKs for the WAL writes done in between are sent
+ * together. The interval is ignored while there are synchronous
+ * transactions waiting for a quorum in the limbo, so as not to
+ * delay their confirmation.
+ */
+extern double replication_ack_interval;
+
+/**
+ * Ids of user spaces this instance subscribes to. Rows of the
+ * other user spaces are replaced by masters with NOPs. If the
+ * count is 0, all spaces are replicated. Applies to new
+ * subscriptions only.
+ */
+extern uint32_t *replication_spaces;
+extern uint32_t replication_space_count;
+
+/**
+ * Compression of the replication stream requested by this
+ * instance from its masters on subscribe. Applies to new
+ * subscriptions only.
+ */
+extern enum compression_type replication_compression;
+
 /**
  * Whether this replica will be anonymous or not, e.g. be preset
  * in _cluster table and have a non-zero id.
@@ -69,6 +69,7 @@ uint32_t schema_version = 0;
  * non-existent space objects on space:truncate() operation.
  */
 uint32_t space_cache_version = 0;
+uint32_t func_cache_version = 0;
 
 struct rlist on_schema_init = RLIST_HEAD_INITIALIZER(on_schema_init);
 struct rlist on_alter_space = RLIST_HEAD_INITIALIZER(on_alter_space);
@@ -248,6 +249,7 @@ space_cache_replace(struct space *old_space, struct space *new_space)
 		mh_strnptr_del(spaces_by_name, k, NULL);
 	}
 	space_cache_version++;
+	access_version++;
 
 	if (trigger_run(&on_alter_space, new_space != NULL ?
 					 new_space : old_space) != 0) {
@@ -563,6 +565,8 @@ error:
 		mh_i32ptr_del(funcs, k1, NULL);
 		goto error;
 	}
+	func_cache_version++;
+	access_version++;
 }
 
 void
@@ -578,6 +582,8 @@ func_cache_delete(uint32_t fid)
 				strlen(func->def->name));
 	if (k != mh_end(funcs))
 		mh_strnptr_del(funcs_by_name, k, NULL);
+	func_cache_version++;
+	access_version++;
 }
 
 struct func *
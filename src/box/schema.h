@@ -44,6 +44,8 @@ struct func;
 
 extern uint32_t schema_version;
 extern uint32_t space_cache_version;
+/** Incremented on every change of the function cache. */
+extern uint32_t func_cache_version;
 
 /** Triggers invoked after schema initialization. */
 extern struct rlist on_schema_init;
@@ -61,8 +61,31 @@ struct sequence_data {
 	uint32_t id;
 	/** Sequence value. */
 	int64_t value;
+	/**
+	 * Last value of the block reserved by sequence_reserve(),
+	 * valid if @a is_reserved is set. This is what is written
+	 * to _sequence_data and to snapshots, so that values given
+	 * out of the block are never reused after restart.
+	 */
+	int64_t reserved;
+	/** Set if @a value belongs to a reserved block. */
+	bool is_reserved;
 };
 
+/**
+ * Return true if @a value doesn't go past the last reserved
+ * value of a sequence.
+ */
+static inline bool
+sequence_data_covers(const struct sequence_def *def,
+		     const struct sequence_data *data, int64_t value)
+{
+	if (!data->is_reserved || def->cycle)
+		return false;
+	return def->step > 0 ? value <= data->reserved :
+			       value >= data->reserved;
+}
+
 static inline bool
 sequence_data_equal(struct sequence_data data1, struct sequence_data data2)
 {
@@ -166,6 +189,7 @@ sequence_set(struct sequence *seq, int64_t value)
 	struct sequence_data new_data, old_data;
 	new_data.id = key;
 	new_data.value = value;
+	new_data.is_reserved = false;
 	if (light_sequence_replace(&sequence_data_index, hash,
 				   new_data, &old_data) != light_sequence_end)
 		return 0;
@@ -184,10 +208,15 @@ sequence_update(struct sequence *seq, int64_t value)
 	struct sequence_data new_data, data;
 	new_data.id = key;
 	new_data.value = value;
+	new_data.is_reserved = false;
 	if (pos != light_sequence_end) {
 		data = light_sequence_get(&sequence_data_index, pos);
 		if ((seq->def->step > 0 && value > data.value) ||
 		    (seq->def->step < 0 && value < data.value)) {
+			if (sequence_data_covers(seq->def, &data, value)) {
+				new_data.reserved = data.reserved;
+				new_data.is_reserved = true;
+			}
 			if (light_sequence_replace(&sequence_data_index, hash,
 					new_data, &data) == light_sequence_end)
 				unreachable();
@@ -212,6 +241,7 @@ sequence_next(struct sequence *seq, int64_t *result)
 	if (pos == light_sequence_end) {
 		new_data.id = key;
 		new_data.value = def->start;
+		new_data.is_reserved = false;
 		if (light_sequence_insert(&sequence_data_index, hash,
 					  new_data) == light_sequence_end)
 			return -1;
@@ -244,8 +274,10 @@ sequence_next(struct sequence *seq, int64_t *result)
 	}
 done:
 	assert(value >= def->min && value <= def->max);
-	new_data.id = key;
+	new_data = old_data;
 	new_data.value = value;
+	if (!sequence_data_covers(def, &old_data, value))
+		new_data.is_reserved = false;
 	if (light_sequence_replace(&sequence_data_index, hash,
 				   new_data, &old_data) == light_sequence_end)
 		unreachable();
@@ -260,6 +292,58 @@ overflow:
 	goto done;
 }
 
+bool
+sequence_reserve(struct sequence *seq, int64_t value, int64_t *reserved)
+{
+	struct sequence_def *def = seq->def;
+	uint32_t key = def->id;
+	uint32_t hash = sequence_hash(key);
+	uint32_t pos = light_sequence_find_key(&sequence_data_index, hash, key);
+	assert(pos != light_sequence_end);
+	struct sequence_data data = light_sequence_get(&sequence_data_index,
+						       pos);
+	assert(data.value == value);
+	if (data.is_reserved)
+		return false;
+	*reserved = value;
+	if (def->cache <= 1 || def->cycle)
+		return true;
+	/* Reserve def->cache values, but not past the limit. */
+	uint64_t room, step;
+	if (def->step > 0) {
+		room = (uint64_t)def->max - (uint64_t)value;
+		step = def->step;
+	} else {
+		room = (uint64_t)value - (uint64_t)def->min;
+		step = -(uint64_t)def->step;
+	}
+	uint64_t count = MIN(room / step, (uint64_t)def->cache - 1);
+	*reserved = (int64_t)((uint64_t)value + count * (uint64_t)def->step);
+	struct sequence_data old_data;
+	data.reserved = *reserved;
+	data.is_reserved = true;
+	if (light_sequence_replace(&sequence_data_index, hash,
+				   data, &old_data) == light_sequence_end)
+		unreachable();
+	return true;
+}
+
+void
+sequence_unreserve(struct sequence *seq)
+{
+	uint32_t key = seq->def->id;
+	uint32_t hash = sequence_hash(key);
+	uint32_t pos = light_sequence_find_key(&sequence_data_index, hash, key);
+	if (pos == light_sequence_end)
+		return;
+	struct sequence_data data, old_data;
+	data = light_sequence_get(&sequence_data_index, pos);
+	data.is_reserved = false;
+	if (light_sequence_replace(&sequence_data_index, hash,
+				   data, &old_data) == light_sequence_end)
+		unreachable();
+}
+
 int
 access_check_sequence(struct sequence *seq)
 {
@@ -326,12 +410,13 @@ sequence_data_iterator_next(struct snapshot_iterator *base,
 		return 0;
 	}
 
+	int64_t value = sd->is_reserved ? sd->reserved : sd->value;
 	char *buf_end = iter->tuple;
 	buf_end = mp_encode_array(buf_end, 2);
 	buf_end = mp_encode_uint(buf_end, sd->id);
-	buf_end = (sd->value >= 0 ?
-		   mp_encode_uint(buf_end, sd->value) :
-		   mp_encode_int(buf_end, sd->value));
+	buf_end = (value >= 0 ?
+		   mp_encode_uint(buf_end, value) :
+		   mp_encode_int(buf_end, value));
 	assert(buf_end <= iter->tuple + SEQUENCE_TUPLE_BUF_SIZE);
 	*data = iter->tuple;
 	*size = buf_end - iter->tuple;
@@ -64,7 +64,11 @@ struct sequence_def {
 	int64_t max;
 	/** Initial sequence value. */
 	int64_t start;
-	/** Number of values to preallocate. Not implemented yet. */
+	/**
+	 * Number of values to reserve in _sequence_data at once
+	 * by box_sequence_next(). 0 and 1 mean that every value
+	 * is written. Ignored for cyclic sequences.
+	 */
 	int64_t cache;
 	/**
 	 * If this flag is set, the sequence will wrap
@@ -82,6 +86,12 @@ struct sequence {
 	struct sequence_def *def;
 	/** Set if the sequence is automatically generated. */
 	bool is_generated;
+	/**
+	 * Set while box_sequence_next() writes a reserved block
+	 * to _sequence_data, so that the on_replace trigger
+	 * doesn't move the sequence to the end of the block.
+	 */
+	bool is_reserving;
 	/** Cached runtime access information. */
 	struct access access[BOX_USER_MAX];
 };
@@ -150,6 +160,26 @@ sequence_update(struct sequence *seq, int64_t value);
 int
 sequence_next(struct sequence *seq, int64_t *result);
 
+/**
+ * Reserve a block of sequence values starting at @a value
+ * that has just been returned by sequence_next().
+ *
+ * Return false if @a value belongs to a block reserved before,
+ * so nothing needs to be persisted. Otherwise, reserve a new
+ * block of up to def->cache values, assign its last value to
+ * @a reserved and return true: the caller must write it to
+ * _sequence_data.
+ */
+bool
+sequence_reserve(struct sequence *seq, int64_t value, int64_t *reserved);
+
+/**
+ * Forget the block reserved by sequence_reserve(), e.g. if
+ * it failed to be written to _sequence_data.
+ */
+void
+sequence_unreserve(struct sequence *seq);
+
 /**
  * Check whether or not the current user can be granted
  * access to the sequence.
@@ -37,6 +37,8 @@
 #include "error.h"
 #include "tt_static.h"
 #include "sql_stmt_cache.h"
+#include "execute.h"
+#include "box.h"
 
 const char *session_type_strs[] = {
 	"background",
@@ -47,10 +49,17 @@ const char *session_type_strs[] = {
 	"unknown",
 };
 
+const char *session_priority_strs[] = {
+	"high",
+	"normal",
+	"low",
+};
+
 static struct session_vtab generic_session_vtab = {
 	/* .push = */ generic_session_push,
 	/* .fd = */ generic_session_fd,
 	/* .sync = */ generic_session_sync,
+	/* .set_priority = */ generic_session_set_priority,
 };
 
 struct session_vtab session_vtab_registry[] = {
@@ -108,6 +117,7 @@ static struct session_vtab closed_session_vtab = {
 	/* .push = */ closed_session_push,
 	/* .fd = */ generic_session_fd,
 	/* .sync = */ generic_session_sync,
+	/* .set_priority = */ generic_session_set_priority,
 };
 
 void
@@ -142,6 +152,9 @@ session_create(enum session_type type)
 	session->sql_flags = default_flags;
 	session->sql_default_engine = SQL_STORAGE_ENGINE_MEMTX;
 	session->sql_stmts = NULL;
+	session->sql_cursors = NULL;
+	session->select_cursors = NULL;
+	session->priority = SESSION_PRIORITY_NORMAL;
 
 	/* For on_connect triggers. */
 	credentials_create(&session->credentials, guest_user);
@@ -261,6 +274,8 @@ session_destroy(struct session *session)
 	mh_i64ptr_remove(session_registry, &node, NULL);
 	credentials_destroy(&session->credentials);
 	sql_session_stmt_hash_erase(session->sql_stmts);
+	sql_session_cursor_hash_erase(session->sql_cursors);
+	box_select_cursor_hash_erase(session->select_cursors);
 	mempool_free(&session_pool, session);
 }
 
@@ -375,3 +390,14 @@ generic_session_sync(struct session *session)
 	(void) session;
 	return 0;
 }
+
+int
+generic_session_set_priority(struct session *session,
+			     enum session_priority priority)
+{
+	(void) priority;
+	const char *name =
+		tt_sprintf("Session '%s'", session_type_strs[session->type]);
+	diag_set(ClientError, ER_UNSUPPORTED, name, "priority");
+	return -1;
+}
@@ -68,6 +68,20 @@ enum output_format {
 
 extern const char *session_type_strs[];
 
+/**
+ * Priority class of a session. Requests of sessions of a higher
+ * class are admitted to the tx thread first when it is
+ * overloaded, see iproto.
+ */
+enum session_priority {
+	SESSION_PRIORITY_HIGH = 0,
+	SESSION_PRIORITY_NORMAL,
+	SESSION_PRIORITY_LOW,
+	session_priority_MAX,
+};
+
+extern const char *session_priority_strs[];
+
 /**
  * default_flags accumulates flags value from SQL submodules.
  * It is assigned during sql_init(). Lately it is used in each session
@@ -110,6 +124,8 @@ struct session {
 	/** SQL Connection flag for current user session */
 	uint32_t sql_flags;
 	enum session_type type;
+	/** Priority class of the session requests. */
+	enum session_priority priority;
 	/** Session virtual methods. */
 	const struct session_vtab *vtab;
 	/** Session metadata. */
@@ -119,6 +135,16 @@ struct session {
 	 * This map is allocated on demand.
 	 */
 	struct mh_i32ptr_t *sql_stmts;
+	/**
+	 * SQL cursors opened in current session, by cursor id.
+	 * This map is allocated on demand.
+	 */
+	struct mh_i32ptr_t *sql_cursors;
+	/**
+	 * Iterators opened by SELECT_OPEN in current session, by
+	 * iterator id. This map is allocated on demand.
+	 */
+	struct mh_i32ptr_t *select_cursors;
 	/** Session user id and global grants */
 	struct credentials credentials;
 	/** Trigger for fiber on_stop to cleanup created on-demand session */
@@ -154,6 +180,15 @@ struct session_vtab {
 	 */
 	int64_t
 	(*sync)(struct session *session);
+	/**
+	 * Make the transport schedule the session requests
+	 * according to a new priority class.
+	 * @retval  0 Success.
+	 * @retval -1 Error.
+	 */
+	int
+	(*set_priority)(struct session *session,
+			enum session_priority priority);
 };
 
 extern struct session_vtab session_vtab_registry[];
@@ -360,6 +395,16 @@ session_sync(struct session *session)
 	return session->vtab->sync(session);
 }
 
+static inline int
+session_set_priority(struct session *session, enum session_priority priority)
+{
+	assert(priority < session_priority_MAX);
+	if (session->vtab->set_priority(session, priority) != 0)
+		return -1;
+	session->priority = priority;
+	return 0;
+}
+
 /**
  * In a common case, a session does not support push. This
  * function always returns -1 and sets ER_UNSUPPORTED error.
@@ -375,6 +420,14 @@ generic_session_fd(struct session *session);
 int64_t
 generic_session_sync(struct session *session);
 
+/**
+ * Priorities are supported by iproto sessions only. This
+ * function always returns -1 and sets ER_UNSUPPORTED error.
+ */
+int
+generic_session_set_priority(struct session *session,
+			     enum session_priority priority);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 
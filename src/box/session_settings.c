@@ -272,9 +272,15 @@ static const struct index_vtab session_settings_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ session_settings_index_get,
+	/* .get_batch = */ generic_index_get_batch,
 	/* .replace = */ generic_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
 	/* .create_iterator = */ session_settings_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		generic_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -422,10 +428,12 @@ session_settings_space_create_index(struct space *space, struct index_def *def)
 const struct space_vtab session_settings_space_vtab = {
 	/* .destroy = */ session_settings_space_destroy,
 	/* .bsize = */ generic_space_bsize,
+	/* .tuple_mem = */ generic_space_tuple_mem,
 	/* .execute_replace = */ session_settings_space_execute_replace,
 	/* .execute_delete = */ session_settings_space_execute_delete,
 	/* .execute_update = */ session_settings_space_execute_update,
 	/* .execute_upsert = */ session_settings_space_execute_upsert,
+	/* .execute_delete_range = */ generic_space_execute_delete_range,
 	/* .ephemeral_replace = */ generic_space_ephemeral_replace,
 	/* .ephemeral_delete = */ generic_space_ephemeral_delete,
 	/* .ephemeral_rowid_next = */ generic_space_ephemeral_rowid_next,
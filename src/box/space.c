@@ -47,6 +47,8 @@
 #include "ck_constraint.h"
 #include "assoc.h"
 #include "constraint_id.h"
+#include "clock.h"
+#include "info/info.h"
 
 int
 access_check_space(struct space *space, user_access_t access)
@@ -54,6 +56,8 @@ access_check_space(struct space *space, user_access_t access)
 	struct credentials *cr = effective_user();
 	/* Any space access also requires global USAGE privilege. */
 	access |= PRIV_U;
+	if (credentials_access_is_cached(cr, space, access))
+		return 0;
 	/*
 	 * If a user has a global permission, clear the respective
 	 * privilege from the list of privileges required
@@ -96,6 +100,7 @@ access_check_space(struct space *space, user_access_t access)
 		}
 		return -1;
 	}
+	credentials_access_cache_put(cr, space, access);
 	return 0;
 }
 
@@ -317,6 +322,12 @@ space_bsize(struct space *space)
 	return space->vtab->bsize(space);
 }
 
+size_t
+space_tuple_mem(struct space *space)
+{
+	return space->vtab->tuple_mem(space);
+}
+
 struct index_def *
 space_index_def(struct space *space, int n)
 {
@@ -559,17 +570,28 @@ space_execute_dml(struct space *space, struct txn *txn,
 			return -1;
 	}
 
+	uint64_t start = clock_monotonic64();
+	struct space_stat *stat = &space->stat;
 	switch (request->type) {
 	case IPROTO_INSERT:
 	case IPROTO_REPLACE:
 		if (space->vtab->execute_replace(space, txn,
 						 request, result) != 0)
 			return -1;
+		if (request->type == IPROTO_INSERT)
+			stat->insert++;
+		else
+			stat->replace++;
+		if (*result != NULL)
+			stat->bytes += tuple_bsize(*result);
 		break;
 	case IPROTO_UPDATE:
 		if (space->vtab->execute_update(space, txn,
 						request, result) != 0)
 			return -1;
+		stat->update++;
+		if (*result != NULL)
+			stat->bytes += tuple_bsize(*result);
 		if (*result != NULL && request->index_id != 0) {
 			/*
 			 * XXX: this is going to break with sync replication
@@ -583,6 +605,7 @@ space_execute_dml(struct space *space, struct txn *txn,
 		if (space->vtab->execute_delete(space, txn,
 						request, result) != 0)
 			return -1;
+		stat->delete_++;
 		if (*result != NULL && request->index_id != 0)
 			request_rebind_to_primary_key(request, space, *result);
 		break;
@@ -590,13 +613,69 @@ space_execute_dml(struct space *space, struct txn *txn,
 		*result = NULL;
 		if (space->vtab->execute_upsert(space, txn, request) != 0)
 			return -1;
+		stat->upsert++;
+		stat->bytes += request->tuple_end - request->tuple;
+		break;
+	case IPROTO_DELETE_RANGE:
+		*result = NULL;
+		if (space->vtab->execute_delete_range(space, txn,
+						      request) != 0)
+			return -1;
+		stat->delete_range++;
 		break;
 	default:
 		*result = NULL;
 	}
+	stat->time += clock_monotonic64() - start;
 	return 0;
 }
 
+void
+space_stat_reset(struct space *space)
+{
+	memset(&space->stat, 0, sizeof(space->stat));
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		memset(&index->op_stat, 0, sizeof(index->op_stat));
+	}
+}
+
+void
+space_stat_info(struct space *space, struct info_handler *h)
+{
+	struct space_stat *stat = &space->stat;
+	info_begin(h);
+	info_append_int(h, "insert", stat->insert);
+	info_append_int(h, "replace", stat->replace);
+	info_append_int(h, "update", stat->update);
+	info_append_int(h, "upsert", stat->upsert);
+	info_append_int(h, "delete", stat->delete_);
+	info_append_int(h, "delete_range", stat->delete_range);
+	info_append_int(h, "bytes", stat->bytes);
+	info_append_double(h, "time", stat->time / 1e9);
+	size_t index_mem = 0;
+	info_table_begin(h, "index");
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		struct index_op_stat *op_stat = &index->op_stat;
+		size_t mem = index_bsize(index);
+		index_mem += mem;
+		info_table_begin(h, index->def->name);
+		info_append_int(h, "lookup", op_stat->lookup);
+		info_append_int(h, "scan", op_stat->scan);
+		info_append_int(h, "rows", op_stat->rows);
+		info_append_double(h, "time", op_stat->time / 1e9);
+		info_append_int(h, "memory", mem);
+		info_table_end(h);
+	}
+	info_table_end(h);
+	info_table_begin(h, "memory");
+	info_append_int(h, "tuple", space_tuple_mem(space));
+	info_append_int(h, "index", index_mem);
+	info_table_end(h);
+	info_end(h);
+}
+
 int
 space_add_ck_constraint(struct space *space, struct ck_constraint *ck)
 {
@@ -677,6 +756,24 @@ generic_space_bsize(struct space *space)
 	return 0;
 }
 
+size_t
+generic_space_tuple_mem(struct space *space)
+{
+	(void)space;
+	return 0;
+}
+
+int
+generic_space_execute_delete_range(struct space *space, struct txn *txn,
+				   struct request *request)
+{
+	(void)txn;
+	(void)request;
+	diag_set(ClientError, ER_UNSUPPORTED, space->engine->name,
+		 "delete_range()");
+	return -1;
+}
+
 int
 generic_space_ephemeral_replace(struct space *space, const char *tuple,
 				const char *tuple_end)
@@ -53,12 +53,15 @@ struct tuple;
 struct tuple_format;
 struct ck_constraint;
 struct constraint_id;
+struct info_handler;
 
 struct space_vtab {
 	/** Free a space instance. */
 	void (*destroy)(struct space *);
 	/** Return binary size of a space. */
 	size_t (*bsize)(struct space *);
+	/** Return memory allocated for tuples of a space. */
+	size_t (*tuple_mem)(struct space *);
 
 	int (*execute_replace)(struct space *, struct txn *,
 			       struct request *, struct tuple **result);
@@ -67,6 +70,8 @@ struct space_vtab {
 	int (*execute_update)(struct space *, struct txn *,
 			      struct request *, struct tuple **result);
 	int (*execute_upsert)(struct space *, struct txn *, struct request *);
+	int (*execute_delete_range)(struct space *, struct txn *,
+				    struct request *);
 
 	int (*ephemeral_replace)(struct space *, const char *, const char *);
 
@@ -152,6 +157,23 @@ struct space_vtab {
 	void (*invalidate)(struct space *space);
 };
 
+/**
+ * Counters of write requests executed on a space.
+ * Exported by space:stat().
+ */
+struct space_stat {
+	uint64_t insert;
+	uint64_t replace;
+	uint64_t update;
+	uint64_t upsert;
+	uint64_t delete_;
+	uint64_t delete_range;
+	/** Total size of inserted and updated tuples, in bytes. */
+	uint64_t bytes;
+	/** Time spent executing requests, in nanoseconds. */
+	uint64_t time;
+};
+
 struct space {
 	/** Virtual function table. */
 	const struct space_vtab *vtab;
@@ -239,6 +261,8 @@ struct space {
 	 * Hash table with constraint identifiers hashed by name.
 	 */
 	struct mh_strnptr_t *constraint_ids;
+	/** Write request counters. */
+	struct space_stat stat;
 };
 
 /** Initialize a base space instance. */
@@ -360,6 +384,14 @@ index_find_unique(struct space *space, uint32_t index_id)
 size_t
 space_bsize(struct space *space);
 
+/**
+ * Returns memory allocated for tuples of the space, including
+ * tuple headers. Is 0 for engines that don't keep tuples in
+ * memory.
+ */
+size_t
+space_tuple_mem(struct space *space);
+
 /** Get definition of the n-th index of the space. */
 struct index_def *
 space_index_def(struct space *space, int n);
@@ -390,6 +422,17 @@ int
 space_execute_dml(struct space *space, struct txn *txn,
 		  struct request *request, struct tuple **result);
 
+/** Reset request counters of the space and its indexes. */
+void
+space_stat_reset(struct space *space);
+
+/**
+ * Dump request counters of the space and its indexes,
+ * see space:stat().
+ */
+void
+space_stat_info(struct space *space, struct info_handler *h);
+
 static inline int
 space_ephemeral_replace(struct space *space, const char *tuple,
 			const char *tuple_end)
@@ -563,6 +606,9 @@ space_pop_constraint_id(struct space *space, const char *name);
  * Virtual method stubs.
  */
 size_t generic_space_bsize(struct space *);
+size_t generic_space_tuple_mem(struct space *);
+int generic_space_execute_delete_range(struct space *, struct txn *,
+				       struct request *);
 int generic_space_ephemeral_replace(struct space *, const char *, const char *);
 int generic_space_ephemeral_delete(struct space *, const char *);
 int generic_space_ephemeral_rowid_next(struct space *, uint64_t *);
@@ -41,7 +41,10 @@ const struct space_opts space_opts_default = {
 	/* .is_temporary = */ false,
 	/* .is_ephemeral = */ false,
 	/* .view = */ false,
+	/* .is_materialized = */ false,
 	/* .is_sync = */ false,
+	/* .defer_deletes = */ true,
+	/* .expire_field = */ UINT32_MAX,
 	/* .sql        = */ NULL,
 };
 
@@ -49,7 +52,10 @@ const struct opt_def space_opts_reg[] = {
 	OPT_DEF("group_id", OPT_UINT32, struct space_opts, group_id),
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, is_temporary),
 	OPT_DEF("view", OPT_BOOL, struct space_opts, is_view),
+	OPT_DEF("materialized", OPT_BOOL, struct space_opts, is_materialized),
 	OPT_DEF("is_sync", OPT_BOOL, struct space_opts, is_sync),
+	OPT_DEF("defer_deletes", OPT_BOOL, struct space_opts, defer_deletes),
+	OPT_DEF("expire_field", OPT_UINT32, struct space_opts, expire_field),
 	OPT_DEF("sql", OPT_STRPTR, struct space_opts, sql),
 	OPT_DEF_LEGACY("checks"),
 	OPT_END,
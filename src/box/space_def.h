@@ -67,12 +67,37 @@ struct space_opts {
 	 * this flag can't be changed after space creation.
 	 */
 	bool is_view;
+	/**
+	 * The space stores the result of an aggregate SELECT
+	 * over another space, which is given by the SQL
+	 * statement and kept up to date on every change of the
+	 * source space, see matview.h. Can't be changed after
+	 * space creation.
+	 */
+	bool is_materialized;
 	/**
 	 * Synchronous space makes all transactions, affecting its
 	 * data, synchronous. That means they are not applied
 	 * until replicated to a quorum of replicas.
 	 */
 	bool is_sync;
+	/**
+	 * Vinyl only. If set, REPLACE and DELETE don't look up
+	 * the overwritten tuple, and the statements deleting it
+	 * from secondary indexes are generated later, when the
+	 * primary index is compacted. Until then secondary
+	 * indexes may contain stale keys, so reading them always
+	 * takes a primary index lookup. Can only be changed while
+	 * the space has no secondary indexes.
+	 */
+	bool defer_deletes;
+	/**
+	 * Memtx only. Number of the field storing the time, in
+	 * seconds since the Epoch, after which a tuple is deleted,
+	 * see memtx_expire.h. UINT32_MAX if tuples never expire.
+	 * Can only be changed while the space is empty.
+	 */
+	uint32_t expire_field;
 	/** SQL statement that produced this space. */
 	char *sql;
 };
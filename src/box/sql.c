@@ -760,6 +760,9 @@ tarantoolsqlIdxKeyCompare(struct BtCursor *cursor,
 		 *      tuple with an incomplete offset map.
 		 */
 		uint32_t fieldno = key_def->parts[i].fieldno;
+		/* Extended keys start with the index parts. */
+		if ((cursor->hints & OPFLAG_KEY_ONLY) != 0)
+			fieldno = i;
 
 		if (fieldno != next_fieldno) {
 			struct tuple_field *field =
@@ -773,10 +776,12 @@ tarantoolsqlIdxKeyCompare(struct BtCursor *cursor,
 				while (j++ != fieldno)
 					mp_next(&p);
 			} else {
+				bool is_compact = format->is_field_map_compact;
 				uint32_t field_offset =
 					field_map_get_offset(field_map,
 							     field->offset_slot,
-							     MULTIKEY_NONE);
+							     MULTIKEY_NONE,
+							     is_compact);
 				p = base + field_offset;
 			}
 		}
@@ -794,7 +799,8 @@ out:
 #ifndef NDEBUG
 	/* Sanity check. */
 	original_size = region_used(&fiber()->gc);
-	key = tuple_extract_key(tuple, key_def, MULTIKEY_NONE, &key_size);
+	key = (cursor->hints & OPFLAG_KEY_ONLY) != 0 ? NULL :
+	      tuple_extract_key(tuple, key_def, MULTIKEY_NONE, &key_size);
 	if (key != NULL) {
 		int new_rc = sqlVdbeRecordCompareMsgpack(key, unpacked);
 		region_truncate(&fiber()->gc, original_size);
@@ -903,7 +909,9 @@ cursor_seek(BtCursor *pCur, int *pRes)
 	struct txn *txn = NULL;
 	if (space->def->id != 0 && txn_begin_ro_stmt(space, &txn) != 0)
 		return -1;
-	struct iterator *it =
+	struct iterator *it = (pCur->hints & OPFLAG_KEY_ONLY) != 0 ?
+		index_create_key_iterator(pCur->index, pCur->iter_type, key,
+					  part_count) :
 		index_create_iterator(pCur->index, pCur->iter_type, key,
 				      part_count);
 	if (it == NULL) {
@@ -916,6 +924,9 @@ cursor_seek(BtCursor *pCur, int *pRes)
 		txn_commit_ro_stmt(txn);
 	pCur->iter = it;
 	pCur->eState = CURSOR_VALID;
+	/* The filter is set by OP_CursorFilter for one seek only. */
+	pCur->is_filtered = pCur->is_filter_pending;
+	pCur->is_filter_pending = false;
 
 	return cursor_advance(pCur, pRes);
 }
@@ -936,8 +947,11 @@ cursor_advance(BtCursor *pCur, int *pRes)
 	assert(pCur->iter != NULL);
 
 	struct tuple *tuple;
-	if (iterator_next(pCur->iter, &tuple) != 0)
-		return -1;
+	do {
+		if (iterator_next(pCur->iter, &tuple) != 0)
+			return -1;
+	} while (tuple != NULL && pCur->is_filtered &&
+		 !sql_cursor_filter_match(pCur->filter, tuple));
 	if (pCur->last_tuple)
 		box_tuple_unref(pCur->last_tuple);
 	if (tuple) {
@@ -1029,13 +1043,14 @@ sql_encode_table_opts(struct region *region, struct space_def *def,
 	mpstream_init(&stream, region, region_reserve_cb, region_alloc_cb,
 		      set_encode_error, &is_error);
 	bool is_view = def->opts.is_view;
-	mpstream_encode_map(&stream, 2 * is_view);
+	bool is_materialized = def->opts.is_materialized;
+	mpstream_encode_map(&stream, 2 * (is_view || is_materialized));
 
-	if (is_view) {
+	if (is_view || is_materialized) {
 		assert(def->opts.sql != NULL);
 		mpstream_encode_str(&stream, "sql");
 		mpstream_encode_str(&stream, def->opts.sql);
-		mpstream_encode_str(&stream, "view");
+		mpstream_encode_str(&stream, is_view ? "view" : "materialized");
 		mpstream_encode_bool(&stream, true);
 	}
 	mpstream_flush(&stream);
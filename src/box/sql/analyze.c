@@ -1597,7 +1597,31 @@ index_field_tuple_est(const struct index_def *idx_def, uint32_t field)
 		if (field == idx_def->key_def->part_count &&
 		    idx_def->opts.is_unique)
 			return 0;
-		return default_tuple_est[field + 1 >= 6 ? 6 : field];
+		log_est_t est = default_tuple_est[field + 1 >= 6 ? 6 : field];
+		/*
+		 * Defaults are poor for big spaces, so ask the
+		 * engine for estimates there. They don't need
+		 * ANALYZE and follow the data as it changes.
+		 */
+		ssize_t size = index_size(tnt_idx);
+		if (size < SQL_ENGINE_STAT_MIN_ROWS)
+			return est;
+		if (field == 0)
+			return sqlLogEst(size);
+		const uint64_t *eq = index_estimate_eq(tnt_idx);
+		if (eq == NULL)
+			return est;
+		if (eq[field - 1] != 0)
+			return sqlLogEst(eq[field - 1]);
+		/*
+		 * A longer prefix can't match more tuples than
+		 * the shorter one does.
+		 */
+		for (uint32_t i = field - 1; i > 0; i--) {
+			if (eq[i - 1] != 0)
+				return MIN(est, sqlLogEst(eq[i - 1]));
+		}
+		return MIN(est, sqlLogEst(size));
 	}
 	return tnt_idx->def->opts.stat->tuple_log_est[field];
 }
@@ -49,6 +49,7 @@
 #include "tarantoolInt.h"
 #include "box/ck_constraint.h"
 #include "box/fk_constraint.h"
+#include "box/matview.h"
 #include "box/sequence.h"
 #include "box/session.h"
 #include "box/identifier.h"
@@ -795,7 +796,8 @@ vdbe_emit_create_index(struct Parse *parse, struct space_def *def,
 	memcpy(raw, index_parts, index_parts_sz);
 	index_parts = raw;
 
-	if (parse->create_table_def.new_space != NULL) {
+	if (parse->create_table_def.new_space != NULL ||
+	    def->opts.is_materialized) {
 		sqlVdbeAddOp2(v, OP_SCopy, space_id_reg, entry_reg);
 		sqlVdbeAddOp2(v, OP_Integer, idx_def->iid, entry_reg + 1);
 	} else {
@@ -1282,6 +1284,82 @@ sqlEndTable(struct Parse *pParse)
 	}
 }
 
+/**
+ * Set up the format of a materialized view: types and
+ * collations of the columns come from the source space, all
+ * the columns are NOT NULL. The view is always a memtx space.
+ */
+static void
+sql_matview_fill_def(struct space_def *def,
+		     const struct matview_def *matview_def)
+{
+	assert(def->field_count == matview_def->column_count);
+	for (uint32_t i = 0; i < def->field_count; ++i) {
+		const struct matview_column *col = &matview_def->columns[i];
+		struct field_def *field = &def->fields[i];
+		field->type = col->type;
+		field->coll_id = col->coll_id;
+		field->is_nullable = false;
+		field->nullable_action = ON_CONFLICT_ACTION_ABORT;
+	}
+	def->opts.is_materialized = true;
+	strcpy(def->engine_name, "memtx");
+}
+
+/**
+ * Generate code to create the primary key of a materialized
+ * view, made of its GROUP BY columns in the order they are
+ * selected.
+ */
+static void
+vdbe_emit_matview_pk_create(struct Parse *parse, struct space_def *def,
+			    const struct matview_def *matview_def,
+			    int space_id_reg)
+{
+	struct region *region = &parse->region;
+	size_t size;
+	struct key_part_def *parts =
+		region_alloc_array(region, typeof(parts[0]), def->field_count,
+				   &size);
+	if (parts == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "parts");
+		parse->is_aborted = true;
+		return;
+	}
+	uint32_t part_count = 0;
+	for (uint32_t i = 0; i < def->field_count; ++i) {
+		if (matview_def->columns[i].agg != MATVIEW_AGG_GROUP)
+			continue;
+		struct key_part_def *part = &parts[part_count++];
+		*part = key_part_def_default;
+		part->fieldno = i;
+		part->type = def->fields[i].type;
+		part->coll_id = def->fields[i].coll_id;
+		part->is_nullable = false;
+		part->nullable_action = ON_CONFLICT_ACTION_ABORT;
+	}
+	struct key_def *key_def = key_def_new(parts, part_count, false);
+	if (key_def == NULL) {
+		parse->is_aborted = true;
+		return;
+	}
+	struct index_opts opts;
+	index_opts_create(&opts);
+	opts.is_unique = true;
+	const char *name = tt_sprintf("pk_unnamed_%s_%d", def->name,
+				      ++parse->autoname_i);
+	struct index_def *index_def =
+		index_def_new(def->id, 0, name, strlen(name), TREE, &opts,
+			      key_def, NULL);
+	key_def_delete(key_def);
+	if (index_def == NULL) {
+		parse->is_aborted = true;
+		return;
+	}
+	vdbe_emit_create_index(parse, def, index_def, space_id_reg, 0);
+	index_def_delete(index_def);
+}
+
 void
 sql_create_view(struct Parse *parse_context)
 {
@@ -1292,6 +1370,7 @@ sql_create_view(struct Parse *parse_context)
 	assert(alter_entity_def->alter_action == ALTER_ACTION_CREATE);
 	(void) alter_entity_def;
 	struct sql *db = parse_context->db;
+	struct matview_def *matview_def = NULL;
 	if (parse_context->nVar > 0) {
 		diag_set(ClientError, ER_CREATE_SPACE,
 			 sql_name_from_token(db, &create_entity_def->name),
@@ -1303,6 +1382,15 @@ sql_create_view(struct Parse *parse_context)
 					    &create_entity_def->name);
 	if (space == NULL || parse_context->is_aborted)
 		goto create_view_fail;
+	/* The SELECT is checked before it gets resolved. */
+	if (view_def->is_materialized) {
+		matview_def = matview_def_new(view_def->select,
+					      space->def->name);
+		if (matview_def == NULL) {
+			parse_context->is_aborted = true;
+			goto create_view_fail;
+		}
+	}
 	struct space *select_res_space =
 		sqlResultSetOfSelect(parse_context, view_def->select);
 	if (select_res_space == NULL)
@@ -1326,7 +1414,10 @@ sql_create_view(struct Parse *parse_context)
 		select_res_space->def->fields = NULL;
 		select_res_space->def->field_count = 0;
 	}
-	space->def->opts.is_view = true;
+	if (matview_def != NULL)
+		sql_matview_fill_def(space->def, matview_def);
+	else
+		space->def->opts.is_view = true;
 	/*
 	 * Locate the end of the CREATE VIEW statement.
 	 * Make sEnd point to the end.
@@ -1367,10 +1458,14 @@ sql_create_view(struct Parse *parse_context)
 					      OP_NoConflict) != 0)
 		goto create_view_fail;
 
-	vdbe_emit_space_create(parse_context, getNewSpaceId(parse_context),
-			       name_reg, space);
+	int space_id_reg = getNewSpaceId(parse_context);
+	vdbe_emit_space_create(parse_context, space_id_reg, name_reg, space);
+	if (matview_def != NULL)
+		vdbe_emit_matview_pk_create(parse_context, space->def,
+					    matview_def, space_id_reg);
 
  create_view_fail:
+	matview_def_delete(matview_def);
 	sql_expr_list_delete(db, view_def->aliases);
 	sql_select_delete(db, view_def->select);
 	return;
@@ -1762,13 +1857,15 @@ sql_drop_table(struct Parse *parse_context)
 	 * Ensure DROP TABLE is not used on a view,
 	 * and DROP VIEW is not used on a table.
 	 */
-	if (is_view && !space->def->opts.is_view) {
+	bool is_space_view = space->def->opts.is_view ||
+			     space->def->opts.is_materialized;
+	if (is_view && !is_space_view) {
 		diag_set(ClientError, ER_DROP_SPACE, space_name,
 			 "use DROP TABLE");
 		parse_context->is_aborted = true;
 		goto exit_drop_table;
 	}
-	if (!is_view && space->def->opts.is_view) {
+	if (!is_view && is_space_view) {
 		diag_set(ClientError, ER_DROP_SPACE, space_name,
 			 "use DROP VIEW");
 		parse_context->is_aborted = true;
@@ -1798,7 +1895,8 @@ sql_drop_table(struct Parse *parse_context)
 			goto exit_drop_table;
 		}
 	}
-	sql_code_drop_table(parse_context, space, is_view);
+	/* A materialized view has indexes to drop, like a table. */
+	sql_code_drop_table(parse_context, space, space->def->opts.is_view);
 
  exit_drop_table:
 	sqlSrcListDelete(db, table_name_list);
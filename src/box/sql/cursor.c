@@ -41,7 +41,11 @@ sql_cursor_cleanup(struct BtCursor *cursor)
 	if (cursor->last_tuple)
 		tuple_unref(cursor->last_tuple);
 	free(cursor->key);
+	free(cursor->filter);
 	cursor->key = NULL;
+	cursor->filter = NULL;
+	cursor->is_filter_pending = false;
+	cursor->is_filtered = false;
 	cursor->iter = NULL;
 	cursor->last_tuple = NULL;
 	cursor->eState = CURSOR_INVALID;
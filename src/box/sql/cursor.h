@@ -34,6 +34,9 @@
 
 typedef struct BtCursor BtCursor;
 
+struct sql_hash_join;
+struct sql_cursor_filter;
+
 /*
  * A cursor contains a particular entry either from Tarantrool or
  * Sorter. Tarantool cursor is able to point to ordinary table or
@@ -50,6 +53,13 @@ struct BtCursor {
 	enum iterator_type iter_type;
 	struct tuple *last_tuple;
 	char *key;		/* Saved key that was cursor last known position */
+	struct sql_hash_join *hash;	/* Hash table built by OP_HashBuild */
+	/** Conditions set by OP_CursorFilter, owned by the cursor. */
+	struct sql_cursor_filter *filter;
+	/** True if the next seek is to apply @a filter. */
+	bool is_filter_pending;
+	/** True if the iterator skips tuples not matching @a filter. */
+	bool is_filtered;
 };
 
 void sqlCursorZero(BtCursor *);
@@ -4688,6 +4688,79 @@ exprCodeBetween(Parse * pParse,	/* Parsing and code generating context */
 	testcase(xJump == 0);
 }
 
+/**
+ * Check if comparison of column @a expr with another expression
+ * can be coded as OP_ColumnCompare: the column belongs to a real
+ * space, has integer or unsigned type and is not cached in a
+ * register yet.
+ */
+static bool
+expr_column_is_compare_fusible(struct Parse *parse, struct Expr *expr)
+{
+	if (expr->op != TK_COLUMN || expr->iTable < 0 || expr->op2 != 0 ||
+	    expr->space_def == NULL)
+		return false;
+	struct space_def *def = expr->space_def;
+	if (def->opts.is_ephemeral || def->opts.is_view ||
+	    expr->iColumn < 0 || (uint32_t)expr->iColumn >= def->field_count)
+		return false;
+	enum field_type type = def->fields[expr->iColumn].type;
+	if (type != FIELD_TYPE_INTEGER && type != FIELD_TYPE_UNSIGNED)
+		return false;
+	struct yColCache *p = parse->aColCache;
+	for (int i = 0; i < parse->nColCache; i++, p++) {
+		if (p->iTable == expr->iTable && p->iColumn == expr->iColumn)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Generate code for a jump to @a dest if comparison @a op of the
+ * operands of @a expr is true. An integer column compared with
+ * another expression is extracted by OP_ColumnCompare, which
+ * evaluates the comparison of two integers without decoding the
+ * column into a register.
+ *
+ * @param parse Parsing context.
+ * @param expr Comparison expression.
+ * @param op Comparison opcode: OP_Eq, OP_Ne, OP_Lt, etc.
+ * @param dest Jump destination.
+ * @param jump_if_null SQL_JUMPIFNULL or 0.
+ * @param[out] reg_free1 Temporary register to free.
+ * @param[out] reg_free2 Temporary register to free.
+ */
+static void
+expr_code_compare_jump(struct Parse *parse, struct Expr *expr, int op,
+		       int dest, int jump_if_null, int *reg_free1,
+		       int *reg_free2)
+{
+	struct Expr *lhs = expr->pLeft;
+	struct Expr *rhs = expr->pRight;
+	int r1, r2;
+	if (!expr_column_is_compare_fusible(parse, lhs)) {
+		r1 = sqlExprCodeTemp(parse, lhs, reg_free1);
+		r2 = sqlExprCodeTemp(parse, rhs, reg_free2);
+		codeCompare(parse, lhs, rhs, op, r1, r2, dest, jump_if_null);
+		return;
+	}
+	/*
+	 * The comparison must immediately follow
+	 * OP_ColumnCompare, so the right operand goes first.
+	 * It may also load the same column, then the cached
+	 * register is used.
+	 */
+	r2 = sqlExprCodeTemp(parse, rhs, reg_free2);
+	if (!expr_column_is_compare_fusible(parse, lhs)) {
+		r1 = sqlExprCodeTemp(parse, lhs, reg_free1);
+	} else {
+		r1 = *reg_free1 = sqlGetTempReg(parse);
+		sqlVdbeAddOp3(parse->pVdbe, OP_ColumnCompare, lhs->iTable,
+			      lhs->iColumn, r1);
+	}
+	codeCompare(parse, lhs, rhs, op, r1, r2, dest, jump_if_null);
+}
+
 /*
  * Generate code for a boolean expression such that a jump is made
  * to the label "dest" if the expression is true but execution
@@ -4709,7 +4782,7 @@ sqlExprIfTrue(Parse * pParse, Expr * pExpr, int dest, int jumpIfNull)
 	int op = 0;
 	int regFree1 = 0;
 	int regFree2 = 0;
-	int r1, r2;
+	int r1;
 
 	assert(jumpIfNull == SQL_JUMPIFNULL || jumpIfNull == 0);
 	if (NEVER(v == 0))
@@ -4755,12 +4828,9 @@ sqlExprIfTrue(Parse * pParse, Expr * pExpr, int dest, int jumpIfNull)
 			if (sqlExprIsVector(pExpr->pLeft))
 				goto default_expr;
 			testcase(jumpIfNull == 0);
-			r1 = sqlExprCodeTemp(pParse, pExpr->pLeft,
-						 &regFree1);
-			r2 = sqlExprCodeTemp(pParse, pExpr->pRight,
-						 &regFree2);
-			codeCompare(pParse, pExpr->pLeft, pExpr->pRight, op, r1,
-				    r2, dest, jumpIfNull);
+			expr_code_compare_jump(pParse, pExpr, op, dest,
+					       jumpIfNull, &regFree1,
+					       &regFree2);
 			assert(TK_LT == OP_Lt);
 			testcase(op == OP_Lt);
 			VdbeCoverageIf(v, op == OP_Lt);
@@ -4856,7 +4926,7 @@ sqlExprIfFalse(Parse * pParse, Expr * pExpr, int dest, int jumpIfNull)
 	int op = 0;
 	int regFree1 = 0;
 	int regFree2 = 0;
-	int r1, r2;
+	int r1;
 
 	assert(jumpIfNull == SQL_JUMPIFNULL || jumpIfNull == 0);
 	if (NEVER(v == 0))
@@ -4948,12 +5018,9 @@ sqlExprIfFalse(Parse * pParse, Expr * pExpr, int dest, int jumpIfNull)
 			if (sqlExprIsVector(pExpr->pLeft))
 				goto default_expr;
 			testcase(jumpIfNull == 0);
-			r1 = sqlExprCodeTemp(pParse, pExpr->pLeft,
-						 &regFree1);
-			r2 = sqlExprCodeTemp(pParse, pExpr->pRight,
-						 &regFree2);
-			codeCompare(pParse, pExpr->pLeft, pExpr->pRight, op, r1,
-				    r2, dest, jumpIfNull);
+			expr_code_compare_jump(pParse, pExpr, op, dest,
+					       jumpIfNull, &regFree1,
+					       &regFree2);
 			assert(TK_LT == OP_Lt);
 			testcase(op == OP_Lt);
 			VdbeCoverageIf(v, op == OP_Lt);
@@ -259,7 +259,7 @@ columnname(A) ::= nm(A) typedef(Y). {sqlAddColumn(pParse,&A,&Y);}
 %fallback ID
   ABORT ACTION ADD AFTER AUTOINCREMENT BEFORE CASCADE
   CONFLICT DEFERRED END ENGINE FAIL
-  IGNORE INITIALLY INSTEAD NO MATCH PLAN
+  IGNORE INITIALLY INSTEAD NO MATCH MATERIALIZED PLAN
   QUERY KEY OFFSET RAISE RELEASE REPLACE RESTRICT
   RENAME CTIME_KW IF ENABLE DISABLE
   .
@@ -449,6 +449,18 @@ cmd ::= createkw(X) VIEW ifnotexists(E) nm(Y) eidlist_opt(C)
   }
 }
 
+cmd ::= createkw(X) MATERIALIZED VIEW ifnotexists(E) nm(Y) eidlist_opt(C)
+          AS select(S). {
+  if (!pParse->parse_only) {
+    create_view_def_init(&pParse->create_view_def, &Y, &X, C, S, E);
+    pParse->create_view_def.is_materialized = true;
+    pParse->initiateTTrans = true;
+    sql_create_view(pParse);
+  } else {
+    sql_store_select(pParse, S);
+  }
+}
+
 //////////////////////// The SELECT statement /////////////////////////////////
 //
 cmd ::= select(X).  {
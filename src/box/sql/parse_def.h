@@ -238,6 +238,12 @@ struct create_view_def {
 	/** List of column aliases (SELECT x AS y ...). */
 	struct ExprList *aliases;
 	struct Select *select;
+	/**
+	 * CREATE MATERIALIZED VIEW: the result of the SELECT
+	 * is stored in a space and maintained on changes of
+	 * the source table.
+	 */
+	bool is_materialized;
 };
 
 struct drop_entity_def {
@@ -497,6 +503,7 @@ create_view_def_init(struct create_view_def *view_def, struct Token *name,
 	view_def->create_start = create;
 	view_def->select = select;
 	view_def->aliases = aliases;
+	view_def->is_materialized = false;
 }
 
 static inline void
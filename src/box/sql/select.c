@@ -4466,6 +4466,205 @@ is_simple_count(struct Select *select, struct AggInfo *agg_info)
 	return space;
 }
 
+/** Maximal number of WHERE conditions checked by OP_AggScan. */
+enum { AGG_SCAN_COND_MAX = 8 };
+
+/** Check if a field type may be processed by OP_AggScan. */
+static inline bool
+agg_scan_field_type_is_supported(enum field_type type)
+{
+	return type == FIELD_TYPE_UNSIGNED || type == FIELD_TYPE_INTEGER ||
+	       type == FIELD_TYPE_DOUBLE;
+}
+
+/**
+ * Check if a term of the WHERE clause can be checked by
+ * OP_AggScan exactly: IS [NOT] NULL or a comparison of a numeric
+ * column with a numeric literal. Terms on the first part of an
+ * index are left to the generic loop, which may use the index
+ * instead of a full scan.
+ */
+static bool
+agg_scan_cond_is_supported(struct Expr *expr, struct SrcList_item *src)
+{
+	switch (expr->op) {
+	case TK_ISNULL:
+	case TK_NOTNULL:
+		break;
+	case TK_EQ:
+	case TK_NE:
+	case TK_LT:
+	case TK_LE:
+	case TK_GT:
+	case TK_GE: {
+		struct Expr *rhs = expr->pRight;
+		if (rhs->op == TK_UMINUS)
+			rhs = rhs->pLeft;
+		if (rhs->op != TK_INTEGER && rhs->op != TK_FLOAT)
+			return false;
+		break;
+	}
+	default:
+		return false;
+	}
+	struct Expr *lhs = expr->pLeft;
+	struct space *space = src->space;
+	if (lhs->op != TK_COLUMN || lhs->iTable != src->iCursor ||
+	    lhs->iColumn < 0 ||
+	    (uint32_t)lhs->iColumn >= space->def->field_count ||
+	    !agg_scan_field_type_is_supported(
+			space->def->fields[lhs->iColumn].type))
+		return false;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct key_def *key_def = space->index[i]->def->key_def;
+		if (key_def->parts[0].fieldno == (uint32_t)lhs->iColumn)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Split the WHERE clause into conditions checked by OP_AggScan.
+ * Return false if it isn't a conjunction of at most
+ * AGG_SCAN_COND_MAX supported conditions.
+ */
+static bool
+agg_scan_conds_collect(struct Expr *expr, struct SrcList_item *src,
+		       struct Expr **conds, uint32_t *count)
+{
+	if (expr->op == TK_AND) {
+		return agg_scan_conds_collect(expr->pLeft, src, conds,
+					      count) &&
+		       agg_scan_conds_collect(expr->pRight, src, conds,
+					      count);
+	}
+	if (*count == AGG_SCAN_COND_MAX ||
+	    !agg_scan_cond_is_supported(expr, src))
+		return false;
+	conds[(*count)++] = expr;
+	return true;
+}
+
+/**
+ * Return the index of a field in the decoded columns of
+ * OP_AggScan, adding it if necessary.
+ */
+static uint32_t
+agg_scan_column(struct sql_agg_scan *scan, uint32_t fieldno)
+{
+	uint32_t column = 0;
+	while (column < scan->column_count &&
+	       scan->fieldno[column] != fieldno)
+		column++;
+	if (column == scan->column_count)
+		scan->fieldno[scan->column_count++] = fieldno;
+	return column;
+}
+
+/**
+ * Test if the SELECT is of the form:
+ *
+ *   SELECT agg(a), agg(b), ... FROM <tbl> [WHERE <conds>]
+ *
+ * where table is not a sub-select or view, each agg is one of
+ * count, sum, total, avg, min and max without DISTINCT, and
+ * each argument is a column of unsigned, integer or double type
+ * (or nothing for count(*)). The WHERE clause, if any, must be
+ * an AND of conditions accepted by agg_scan_cond_is_supported().
+ * Such a query is evaluated by OP_AggScan in one batched pass
+ * over the space.
+ *
+ * @param parse Parsing context.
+ * @param select The select statement in form of aggregate query.
+ * @param agg_info The associated aggregate-info object.
+ * @retval Program for OP_AggScan, if the query matches this
+ *         pattern. NULL otherwise.
+ */
+static struct sql_agg_scan *
+sql_agg_scan_new(struct Parse *parse, struct Select *select,
+		 struct AggInfo *agg_info)
+{
+	assert(select->pGroupBy == NULL);
+	if (select->pHaving != NULL ||
+	    select->pSrc->nSrc != 1 || select->pSrc->a[0].pSelect != NULL ||
+	    agg_info->nAccumulator != 0 || agg_info->nFunc == 0)
+		return NULL;
+	/* A single min() or max() may be served by an index. */
+	struct ExprList *unused;
+	if (minMaxQuery(agg_info, &unused) != WHERE_ORDERBY_NORMAL)
+		return NULL;
+	struct SrcList_item *src = &select->pSrc->a[0];
+	struct space_def *def = src->space->def;
+	struct Expr *conds[AGG_SCAN_COND_MAX];
+	uint32_t cond_count = 0;
+	if (select->pWhere != NULL &&
+	    !agg_scan_conds_collect(select->pWhere, src, conds, &cond_count))
+		return NULL;
+	uint32_t item_count = agg_info->nFunc;
+	size_t size = sizeof(struct sql_agg_scan) +
+		      item_count * sizeof(struct sql_agg_scan_item) +
+		      cond_count * sizeof(struct sql_agg_scan_cond) +
+		      (item_count + cond_count) * sizeof(uint32_t);
+	struct sql_agg_scan *scan = sqlDbMallocRawNN(parse->db, size);
+	if (scan == NULL)
+		return NULL;
+	scan->item_count = item_count;
+	scan->cond_count = cond_count;
+	scan->column_count = 0;
+	scan->conds = (struct sql_agg_scan_cond *)&scan->items[item_count];
+	scan->fieldno = (uint32_t *)&scan->conds[cond_count];
+	for (uint32_t i = 0; i < item_count; i++) {
+		struct AggInfo_func *func = &agg_info->aFunc[i];
+		struct sql_agg_scan_item *item = &scan->items[i];
+		if (func->func->def->language != FUNC_LANGUAGE_SQL_BUILTIN ||
+		    (func->pExpr->flags & EP_Distinct) != 0)
+			goto fail;
+		const char *name = func->func->def->name;
+		if (strcmp(name, "COUNT") == 0)
+			item->op = SQL_AGG_SCAN_COUNT;
+		else if (strcmp(name, "SUM") == 0)
+			item->op = SQL_AGG_SCAN_SUM;
+		else if (strcmp(name, "TOTAL") == 0)
+			item->op = SQL_AGG_SCAN_TOTAL;
+		else if (strcmp(name, "AVG") == 0)
+			item->op = SQL_AGG_SCAN_AVG;
+		else if (strcmp(name, "MIN") == 0)
+			item->op = SQL_AGG_SCAN_MIN;
+		else if (strcmp(name, "MAX") == 0)
+			item->op = SQL_AGG_SCAN_MAX;
+		else
+			goto fail;
+		item->reg = func->iMem;
+		item->column = -1;
+		item->type = field_type_MAX;
+		struct ExprList *args = func->pExpr->x.pList;
+		if (args == NULL || args->nExpr == 0) {
+			if (item->op != SQL_AGG_SCAN_COUNT)
+				goto fail;
+			continue;
+		}
+		struct Expr *arg = args->a[0].pExpr;
+		if (args->nExpr != 1 || arg->op != TK_AGG_COLUMN ||
+		    arg->iTable != src->iCursor || arg->iColumn < 0 ||
+		    (uint32_t)arg->iColumn >= def->field_count)
+			goto fail;
+		uint32_t fieldno = arg->iColumn;
+		item->type = def->fields[fieldno].type;
+		if (!agg_scan_field_type_is_supported(item->type))
+			goto fail;
+		item->column = agg_scan_column(scan, fieldno);
+	}
+	for (uint32_t i = 0; i < cond_count; i++) {
+		struct sql_agg_scan_cond *cond = &scan->conds[i];
+		cond->op = conds[i]->op;
+		cond->column = agg_scan_column(scan, conds[i]->pLeft->iColumn);
+	}
+	return scan;
+fail:
+	sqlDbFree(parse->db, scan);
+	return NULL;
+}
+
 /*
  * If the source-list item passed as an argument was augmented with an
  * INDEXED BY clause, then try to locate the specified index. If there
@@ -5495,6 +5694,26 @@ explain_simple_count(struct Parse *parse_context, const char *table_name)
 	}
 }
 
+/**
+ * Add a single OP_Explain instruction to the VDBE to explain
+ * a scan performed by OP_AggScan. It is the same full scan as
+ * the one of the generic aggregate loop.
+ *
+ * @param parse_context Current parsing context.
+ * @param table_name Name of table being queried.
+ */
+static void
+explain_agg_scan(struct Parse *parse_context, const char *table_name)
+{
+	if (parse_context->explain == 2) {
+		char *zEqp = sqlMPrintf(parse_context->db, "SCAN TABLE %s",
+					table_name);
+		sqlVdbeAddOp4(parse_context->pVdbe, OP_Explain,
+			      parse_context->iSelectId, 0, 0, zEqp,
+			      P4_DYNAMIC);
+	}
+}
+
 /**
  * Generate VDBE code that HALT program when subselect returned
  * more than one row (determined as LIMIT 1 overflow).
@@ -6342,6 +6561,10 @@ sqlSelect(Parse * pParse,		/* The parser context */
 		} /* endif pGroupBy.  Begin aggregate queries without GROUP BY: */
 		else {
 			struct space *space = is_simple_count(p, &sAggInfo);
+			struct sql_agg_scan *agg_scan = NULL;
+			if (space == NULL)
+				agg_scan = sql_agg_scan_new(pParse, p,
+							    &sAggInfo);
 			if (space != NULL) {
 				/*
 				 * If is_simple_count() returns a pointer to
@@ -6365,6 +6588,47 @@ sqlSelect(Parse * pParse,		/* The parser context */
 						  sAggInfo.aFunc[0].iMem);
 				sqlVdbeAddOp1(v, OP_Close, cursor);
 				explain_simple_count(pParse, space->def->name);
+			} else if (agg_scan != NULL) {
+				/*
+				 * All the aggregates are evaluated
+				 * in one batched pass over the
+				 * space, see sql_agg_scan_new().
+				 * The results are stored right to
+				 * the accumulators, so there is
+				 * nothing to finalize.
+				 */
+				struct SrcList_item *src = &p->pSrc->a[0];
+				space = src->space;
+				const int cursor = pParse->nTab++;
+				vdbe_emit_open_cursor(pParse, cursor, 0, space);
+				/*
+				 * Values compared with the fields by
+				 * the conditions, in the same order.
+				 */
+				struct Expr *conds[AGG_SCAN_COND_MAX];
+				uint32_t cond_count = 0;
+				if (p->pWhere != NULL) {
+					agg_scan_conds_collect(p->pWhere, src,
+							       conds,
+							       &cond_count);
+				}
+				assert(cond_count == agg_scan->cond_count);
+				int reg = pParse->nMem + 1;
+				pParse->nMem += cond_count;
+				for (uint32_t i = 0; i < cond_count; i++) {
+					struct Expr *rhs = conds[i]->pRight;
+					if (rhs != NULL)
+						sqlExprCode(pParse, rhs,
+							    reg + i);
+					else
+						sqlVdbeAddOp2(v, OP_Null, 0,
+							      reg + i);
+				}
+				sqlVdbeAddOp4(v, OP_AggScan, cursor, reg,
+					      cond_count, (char *)agg_scan,
+					      P4_AGGSCAN);
+				sqlVdbeAddOp1(v, OP_Close, cursor);
+				explain_agg_scan(pParse, space->def->name);
 			} else
 			{
 				/* Check if the query is of one of the following forms:
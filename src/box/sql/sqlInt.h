@@ -662,6 +662,14 @@ sql_vfs_register(sql_vfs *, int makeDflt);
 void
 sql_unbind(struct sql_stmt *stmt);
 
+/**
+ * Copy bound strings and blobs, which reference memory of the
+ * request, into memory owned by the statement. Is used for
+ * statements that are executed longer than the request lives.
+ */
+int
+sql_bind_copy_static(struct sql_stmt *stmt);
+
 int
 sql_bind_blob(sql_stmt *, int, const void *,
 		  int n, void (*)(void *));
@@ -1435,6 +1443,13 @@ index_field_tuple_est(const struct index_def *idx, uint32_t field);
 /** [10*log_{2}(1048576)] == 200 */
 #define DEFAULT_TUPLE_LOG_COUNT 200
 
+/**
+ * Minimal number of tuples in an index without ANALYZE
+ * statistics at which the planner relies on estimates
+ * provided by the engine rather than on default_tuple_est.
+ */
+#define SQL_ENGINE_STAT_MIN_ROWS 1000
+
 /*
  * An instance of this structure contains information needed to generate
  * code for a SELECT that contains aggregate functions.
@@ -1488,6 +1503,110 @@ struct AggInfo {
 	int nFunc;		/* Number of entries in aFunc[] */
 };
 
+/** Aggregate functions computed by OP_AggScan. */
+enum sql_agg_scan_op {
+	SQL_AGG_SCAN_COUNT,
+	SQL_AGG_SCAN_SUM,
+	SQL_AGG_SCAN_TOTAL,
+	SQL_AGG_SCAN_AVG,
+	SQL_AGG_SCAN_MIN,
+	SQL_AGG_SCAN_MAX,
+};
+
+/** One aggregate function evaluated by OP_AggScan. */
+struct sql_agg_scan_item {
+	enum sql_agg_scan_op op;
+	/**
+	 * Index of the argument in sql_agg_scan.fieldno,
+	 * -1 for count(*).
+	 */
+	int column;
+	/** Type of the argument field. */
+	enum field_type type;
+	/** Register to store the result in. */
+	int reg;
+};
+
+/** Condition of the WHERE clause checked by OP_AggScan. */
+struct sql_agg_scan_cond {
+	/**
+	 * TK_EQ, TK_NE, TK_LT, TK_LE, TK_GT, TK_GE compare the
+	 * field with a number, TK_ISNULL and TK_NOTNULL test it.
+	 */
+	int op;
+	/** Index of the field in sql_agg_scan.fieldno. */
+	uint32_t column;
+};
+
+/**
+ * Program of OP_AggScan: the aggregate functions of a query
+ * like
+ *
+ *   SELECT sum(a), count(*), max(b) FROM <tbl> WHERE c > 10
+ *
+ * All the functions are evaluated in one pass over the space.
+ * Tuples are fetched in batches, their arguments and the fields
+ * of the conditions are decoded into columns. The conditions
+ * narrow down the rows of a batch column by column, then the
+ * columns of the matching rows are folded by a tight loop per
+ * function. The object is allocated as a single chunk, so it
+ * can be passed as P4_DYNAMIC.
+ */
+struct sql_agg_scan {
+	/** Number of distinct decoded fields. */
+	uint32_t column_count;
+	/** Field numbers of the arguments and the conditions. */
+	uint32_t *fieldno;
+	/** Number of conditions, all of them must be true. */
+	uint32_t cond_count;
+	/** Conditions of the WHERE clause. */
+	struct sql_agg_scan_cond *conds;
+	/** Number of aggregate functions. */
+	uint32_t item_count;
+	struct sql_agg_scan_item items[0];
+};
+
+/** Condition on a tuple field checked by OP_CursorFilter. */
+struct sql_cursor_filter_item {
+	/** Number of the field. */
+	uint32_t fieldno;
+	/**
+	 * TK_EQ, TK_LT, TK_LE, TK_GT, TK_GE compare the field
+	 * with the value, TK_ISNULL and TK_NOTNULL test it.
+	 */
+	int op;
+	/** True if the field is compared without a collation. */
+	bool is_binary;
+	/**
+	 * Type of the value, set when the filter is installed:
+	 * MP_UINT, MP_INT (negative only), MP_DOUBLE or MP_STR.
+	 * Values of other types are not compared.
+	 */
+	enum mp_type type;
+	union {
+		uint64_t u;
+		int64_t i;
+		double d;
+		const char *s;
+	} value;
+	/** Length of the string value. */
+	uint32_t len;
+};
+
+/**
+ * Program of OP_CursorFilter: conditions of the WHERE clause
+ * a tuple must satisfy to get out of a cursor. The filter is
+ * only an early cut: the conditions are checked by the VDBE
+ * anyway, so a condition the filter can't evaluate just lets
+ * the tuple through. The object is allocated as a single
+ * chunk, so it can be passed as P4_DYNAMIC.
+ */
+struct sql_cursor_filter {
+	/** Number of conditions. */
+	uint32_t item_count;
+	struct sql_cursor_filter_item items[0];
+};
+
 typedef int ynVar;
 
 /*
@@ -2294,6 +2413,7 @@ struct Parse {
 #define OPFLAG_LENGTHARG     0x40	/* OP_Column only used for length() */
 #define OPFLAG_TYPEOFARG     0x80	/* OP_Column only used for typeof() */
 #define OPFLAG_SEEKEQ        0x02	/* OP_Open** cursor uses EQ seek only */
+#define OPFLAG_KEY_ONLY      0x04	/* OP_IteratorOpen: read index keys */
 #define OPFLAG_FORDELETE     0x08	/* OP_Open should use BTREE_FORDELETE */
 #define OPFLAG_P2ISREG       0x10	/* P2 to OP_Open** is a register number */
 #define OPFLAG_PERMUTE       0x01	/* OP_Compare: use the permutation */
@@ -4051,6 +4171,34 @@ sql_alter_ck_constraint_enable(struct Parse *parse);
 int
 sql_token(const char *z, int *type, bool *is_reserved);
 
+struct sql_bind;
+
+/**
+ * Replace literals of a DML statement with parameter markers so
+ * that statements differing only in literal values have the
+ * same text and can share a compiled plan. Spaces and comments
+ * are collapsed too. Literals which affect the plan or the
+ * result metadata (result columns, ORDER BY and GROUP BY column
+ * numbers, LIKE patterns) are kept.
+ *
+ * @param sql Statement text, not necessarily nul-terminated.
+ * @param len Length of @a sql.
+ * @param region Region to allocate the result on.
+ * @param[out] out_sql Normalized nul-terminated text, or NULL
+ *             if the statement can't be normalized: it is not
+ *             DML, or it already has parameters.
+ * @param[out] out_len Length of @a out_sql.
+ * @param[out] out_bind Values of the replaced literals.
+ * @param[out] out_bind_count Number of @a out_bind.
+ *
+ * @retval 0 Success.
+ * @retval -1 Memory error.
+ */
+int
+sql_normalize(const char *sql, int len, struct region *region,
+	      char **out_sql, int *out_len, struct sql_bind **out_bind,
+	      uint32_t *out_bind_count);
+
 void sqlExpirePreparedStatements(sql *);
 int sqlCodeSubselect(Parse *, Expr *, int);
 void sqlSelectPrep(Parse *, Select *, NameContext *);
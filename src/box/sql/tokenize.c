@@ -39,6 +39,7 @@
 #include <unicode/utf8.h>
 #include <unicode/uchar.h>
 
+#include "box/bind.h"
 #include "box/session.h"
 #include "say.h"
 #include "sqlInt.h"
@@ -547,6 +548,242 @@ sqlRunParser(Parse * pParse, const char *zSql)
 	return pParse->is_aborted ? -1 : 0;
 }
 
+/** Clause of a statement tracked by sql_normalize_pass(). */
+enum normalize_clause {
+	NORMALIZE_CLAUSE_OTHER,
+	/** Result columns: literals define types of the result. */
+	NORMALIZE_CLAUSE_RESULT,
+	/** ORDER BY or GROUP BY: integers are column numbers. */
+	NORMALIZE_CLAUSE_ORDER,
+};
+
+/** Maximal depth of parentheses in a normalized statement. */
+enum { NORMALIZE_DEPTH_MAX = 32 };
+
+/**
+ * Return true if a string literal following a token of type
+ * @a prev can be replaced with a parameter. A string after an
+ * identifier or an expression is an alias, and patterns of LIKE
+ * must be known to the planner to use an index.
+ */
+static bool
+sql_normalize_string_is_param(int prev)
+{
+	switch (prev) {
+	case TK_ID:
+	case TK_RP:
+	case TK_STRING:
+	case TK_INTEGER:
+	case TK_FLOAT:
+	case TK_BLOB:
+	case TK_NULL:
+	case TK_TRUE:
+	case TK_FALSE:
+	case TK_END:
+	case TK_LIKE_KW:
+	case TK_MATCH:
+	case TK_ESCAPE:
+		return false;
+	default:
+		return true;
+	}
+}
+
+/**
+ * Tokenize nul-terminated statement @a sql and find literals to
+ * be replaced with parameters. If @a out is NULL, only count
+ * them. Otherwise, write the normalized text to @a out and
+ * values of the literals to @a bind; strings are unescaped in
+ * place, so @a bind refers to @a sql.
+ *
+ * @retval 0 Success.
+ * @retval -1 The statement can't be normalized.
+ */
+static int
+sql_normalize_pass(char *sql, char *out, int *out_len, struct sql_bind *bind,
+		   uint32_t *bind_count)
+{
+	enum normalize_clause clause[NORMALIZE_DEPTH_MAX];
+	int depth = 0;
+	clause[0] = NORMALIZE_CLAUSE_OTHER;
+	int prev = TK_SEMI;
+	bool is_first = true;
+	bool is_insert = false;
+	uint32_t count = 0;
+	int len = 0;
+	for (int pos = 0; sql[pos] != 0;) {
+		char *z = &sql[pos];
+		int type;
+		bool unused;
+		int n = sql_token(z, &type, &unused);
+		pos += n;
+		if (type == TK_SPACE || type == TK_LINEFEED) {
+			/* Spaces and comments turn into one space. */
+			if (out != NULL && len > 0 && out[len - 1] != ' ')
+				out[len++] = ' ';
+			continue;
+		}
+		if (is_first) {
+			/* Only plain DML is worth caching. */
+			switch (type) {
+			case TK_INSERT:
+			case TK_REPLACE:
+				is_insert = true;
+				break;
+			case TK_SELECT:
+			case TK_VALUES:
+			case TK_UPDATE:
+			case TK_DELETE:
+			case TK_WITH:
+				break;
+			default:
+				return -1;
+			}
+			is_first = false;
+		}
+		bool is_param = false;
+		switch (type) {
+		case TK_ILLEGAL:
+		case TK_VARIABLE:
+			return -1;
+		case TK_SELECT:
+			clause[depth] = NORMALIZE_CLAUSE_RESULT;
+			break;
+		case TK_VALUES:
+			if (!is_insert)
+				clause[depth] = NORMALIZE_CLAUSE_RESULT;
+			break;
+		case TK_BY:
+			clause[depth] = NORMALIZE_CLAUSE_ORDER;
+			break;
+		case TK_FROM:
+		case TK_WHERE:
+		case TK_HAVING:
+		case TK_LIMIT:
+		case TK_OFFSET:
+		case TK_UNION:
+		case TK_EXCEPT:
+		case TK_INTERSECT:
+			clause[depth] = NORMALIZE_CLAUSE_OTHER;
+			break;
+		case TK_LP:
+			if (++depth == NORMALIZE_DEPTH_MAX)
+				return -1;
+			clause[depth] = clause[depth - 1];
+			break;
+		case TK_RP:
+			if (--depth < 0)
+				return -1;
+			break;
+		case TK_INTEGER: {
+			if (clause[depth] != NORMALIZE_CLAUSE_OTHER)
+				break;
+			/*
+			 * Hexadecimal and too big integers are
+			 * left to the parser.
+			 */
+			uint64_t value = 0;
+			int i;
+			for (i = 0; i < n && sqlIsdigit(z[i]); i++) {
+				if (value > (INT64_MAX - (z[i] - '0')) / 10)
+					break;
+				value = value * 10 + z[i] - '0';
+			}
+			if (i < n)
+				break;
+			is_param = true;
+			if (out != NULL) {
+				bind[count].type = MP_UINT;
+				bind[count].u64 = value;
+			}
+			break;
+		}
+		case TK_STRING: {
+			if (clause[depth] != NORMALIZE_CLAUSE_OTHER ||
+			    !sql_normalize_string_is_param(prev))
+				break;
+			is_param = true;
+			if (out == NULL)
+				break;
+			/* Drop the quotes and unescape doubled ones. */
+			char *s = z + 1;
+			uint32_t size = 0;
+			for (int i = 1; i < n - 1; i++) {
+				s[size++] = z[i];
+				if (z[i] == '\'')
+					i++;
+			}
+			bind[count].type = MP_STR;
+			bind[count].s = s;
+			bind[count].bytes = size;
+			break;
+		}
+		default:
+			break;
+		}
+		prev = type;
+		if (is_param) {
+			if (out != NULL) {
+				bind[count].name = NULL;
+				bind[count].name_len = 0;
+				bind[count].pos = count + 1;
+				out[len++] = '?';
+			}
+			count++;
+		} else if (out != NULL) {
+			memcpy(&out[len], z, n);
+			len += n;
+		}
+	}
+	if (is_first || depth != 0 || count > SQL_BIND_PARAMETER_MAX)
+		return -1;
+	if (out != NULL) {
+		if (len > 0 && out[len - 1] == ' ')
+			len--;
+		out[len] = '\0';
+		*out_len = len;
+	}
+	*bind_count = count;
+	return 0;
+}
+
+int
+sql_normalize(const char *sql, int len, struct region *region,
+	      char **out_sql, int *out_len, struct sql_bind **out_bind,
+	      uint32_t *out_bind_count)
+{
+	*out_sql = NULL;
+	size_t size;
+	char *copy = region_alloc(region, len + 1);
+	char *out = region_alloc(region, len + 1);
+	if (copy == NULL || out == NULL) {
+		diag_set(OutOfMemory, 2 * (len + 1), "region_alloc", "sql");
+		return -1;
+	}
+	memcpy(copy, sql, len);
+	copy[len] = '\0';
+	uint32_t bind_count;
+	if (sql_normalize_pass(copy, NULL, NULL, NULL, &bind_count) != 0)
+		return 0;
+	struct sql_bind *bind = NULL;
+	if (bind_count > 0) {
+		bind = region_alloc_array(region, typeof(bind[0]), bind_count,
+					  &size);
+		if (bind == NULL) {
+			diag_set(OutOfMemory, size, "region_alloc_array",
+				 "bind");
+			return -1;
+		}
+	}
+	int rc = sql_normalize_pass(copy, out, out_len, bind, &bind_count);
+	assert(rc == 0);
+	(void) rc;
+	*out_sql = out;
+	*out_bind = bind;
+	*out_bind_count = bind_count;
+	return 0;
+}
+
 struct Expr *
 sql_expr_compile(sql *db, const char *expr, int expr_len)
 {
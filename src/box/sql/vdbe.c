@@ -2765,6 +2765,79 @@ case OP_NotNull: {            /* same as TK_NOTNULL, jump, in1 */
  * or typeof() function, respectively.  The loading of large blobs can be
  * skipped for length() and all content loading can be skipped for typeof().
  */
+/* Opcode: ColumnCompare P1 P2 P3 * *
+ * Synopsis: r[P3]=PX and compare
+ *
+ * This works just like the Column opcode, but must be immediately
+ * followed by a jumping comparison (Eq, Ne, Lt, Le, Gt or Ge) of
+ * register P3 with another register. If the column is an integer
+ * and the other operand is an integer too, the comparison is
+ * evaluated right away: register P3 is left intact, and the next
+ * instruction is either skipped or its jump is taken. In all
+ * other cases the column is extracted into P3 and the comparison
+ * is executed as usual.
+ */
+case OP_ColumnCompare: {
+	const VdbeOp *cmp_op = pOp + 1;
+	assert(cmp_op->opcode == OP_Eq || cmp_op->opcode == OP_Ne ||
+	       cmp_op->opcode == OP_Lt || cmp_op->opcode == OP_Le ||
+	       cmp_op->opcode == OP_Gt || cmp_op->opcode == OP_Ge);
+	assert(cmp_op->p3 == pOp->p3);
+	VdbeCursor *pC = p->apCsr[pOp->p1];
+	struct Mem *rhs = &aMem[cmp_op->p1];
+	if (pC->eCurType != CURTYPE_TARANTOOL || pC->nullRow ||
+	    (cmp_op->p5 & (SQL_STOREP2 | SQL_NULLEQ)) != 0 ||
+	    (rhs->flags & (MEM_Int | MEM_UInt)) == 0)
+		goto op_column;
+	if (pC->cacheStatus != p->cacheCtr) {
+		vdbe_field_ref_prepare_tuple(&pC->field_ref,
+					     pC->uc.pCursor->last_tuple);
+		pC->cacheStatus = p->cacheCtr;
+	}
+	if ((uint32_t)pOp->p2 >= pC->field_ref.field_count)
+		goto op_column;
+	const char *data = vdbe_field_ref_fetch_data(&pC->field_ref,
+						     pOp->p2);
+	int res;
+	switch (mp_typeof(*data)) {
+	case MP_UINT: {
+		uint64_t u = mp_decode_uint(&data);
+		if ((rhs->flags & MEM_Int) != 0)
+			res = 1;
+		else
+			res = u > rhs->u.u ? 1 : u < rhs->u.u ? -1 : 0;
+		break;
+	}
+	case MP_INT: {
+		int64_t i = mp_decode_int(&data);
+		if (i >= 0)
+			goto op_column;
+		if ((rhs->flags & MEM_UInt) != 0)
+			res = -1;
+		else
+			res = i > rhs->u.i ? 1 : i < rhs->u.i ? -1 : 0;
+		break;
+	}
+	default:
+		goto op_column;
+	}
+	bool is_true;
+	switch (cmp_op->opcode) {
+	case OP_Eq: is_true = res == 0; break;
+	case OP_Ne: is_true = res != 0; break;
+	case OP_Lt: is_true = res < 0;  break;
+	case OP_Le: is_true = res <= 0; break;
+	case OP_Gt: is_true = res > 0;  break;
+	default:    is_true = res >= 0; break;
+	}
+	if (is_true) {
+		pOp = &aOp[cmp_op->p2 - 1];
+	} else {
+		/* Skip the comparison. */
+		pOp++;
+	}
+	break;
+}
 case OP_Column: {
 	int p2;            /* column number to retrieve */
 	VdbeCursor *pC;    /* The VDBE cursor */
@@ -2772,6 +2845,8 @@ case OP_Column: {
 	Mem *pDest;        /* Where to write the extracted value */
 	Mem *pReg;         /* PseudoTable input register */
 
+	/* OP_ColumnCompare falls back here. */
+op_column:
 	pC = p->apCsr[pOp->p1];
 	p2 = pOp->p2;
 
@@ -2808,9 +2883,14 @@ case OP_Column: {
 		pC->cacheStatus = p->cacheCtr;
 	}
 	enum field_type field_type = field_type_MAX;
-	if (pC->eCurType == CURTYPE_TARANTOOL)
-		field_type = pC->uc.pCursor->space->def->fields[p2].type;
-	else if (pC->eCurType == CURTYPE_SORTER)
+	if (pC->eCurType == CURTYPE_TARANTOOL) {
+		struct BtCursor *cursor = pC->uc.pCursor;
+		uint32_t fieldno = p2;
+		/* Keys are numbered by parts, see OPFLAG_KEY_ONLY. */
+		if ((cursor->hints & OPFLAG_KEY_ONLY) != 0)
+			fieldno = cursor->index->def->cmp_def->parts[p2].fieldno;
+		field_type = cursor->space->def->fields[fieldno].type;
+	} else if (pC->eCurType == CURTYPE_SORTER)
 		field_type = vdbe_sorter_get_field_type(pC->uc.pSorter, p2);
 	struct Mem *default_val_mem =
 		pOp->p4type == P4_MEM ? pOp->p4.pMem : NULL;
@@ -3016,6 +3096,47 @@ case OP_Count: {         /* out2 */
 	break;
 }
 
+/* Opcode: AggScan P1 P2 P3 P4 *
+ * Synopsis: aggregate scan of P1 where r[P2@P3]
+ *
+ * Scan the whole space opened by cursor P1 and evaluate
+ * aggregate functions described by P4 (struct sql_agg_scan)
+ * over the tuples matching its P3 conditions. The values the
+ * conditions compare fields with are taken from registers
+ * starting at P2. Results are stored in the registers specified
+ * by P4.
+ */
+case OP_AggScan: {
+	assert(p->apCsr[pOp->p1]->eCurType == CURTYPE_TARANTOOL);
+	BtCursor *pCrsr = p->apCsr[pOp->p1]->uc.pCursor;
+	assert(pCrsr != NULL && (pCrsr->curFlags & BTCF_TaCursor) != 0);
+	const struct sql_agg_scan *scan = pOp->p4.agg_scan;
+	assert(scan->cond_count == (uint32_t) pOp->p3);
+	for (uint32_t i = 0; i < scan->item_count; i++)
+		vdbe_prepare_null_out(p, scan->items[i].reg);
+	if (sql_agg_scan_run(pCrsr, scan, &aMem[pOp->p2], aMem) != 0)
+		goto abort_due_to_error;
+	break;
+}
+
+/* Opcode: CursorFilter P1 P2 P3 P4 *
+ * Synopsis: filter P1 by r[P2@P3]
+ *
+ * Make the next seek of cursor P1 skip tuples which don't match
+ * conditions P4 (struct sql_cursor_filter). The P3 values of the
+ * conditions are taken from registers starting at P2.
+ */
+case OP_CursorFilter: {
+	assert(p->apCsr[pOp->p1]->eCurType == CURTYPE_TARANTOOL);
+	BtCursor *pCrsr = p->apCsr[pOp->p1]->uc.pCursor;
+	assert(pCrsr != NULL);
+	assert(pOp->p4.cursor_filter->item_count == (uint32_t) pOp->p3);
+	if (sql_cursor_set_filter(pCrsr, pOp->p4.cursor_filter,
+				  &aMem[pOp->p2]) != 0)
+		goto abort_due_to_error;
+	break;
+}
+
 /* Opcode: Savepoint P1 * * P4 *
  *
  * Open, release or rollback the savepoint named by parameter P4, depending
@@ -3190,6 +3311,10 @@ case OP_TTransaction: {
  * small integers. It is an error for P1 to be negative.
  * If P4 was not set, then P3 supposed to be the register
  * containing space pointer.
+ *
+ * If OPFLAG_KEY_ONLY is set in P5, the cursor reads extended
+ * keys of the index instead of full tuples, and the columns
+ * read by OP_Column are numbered by key parts.
  */
 case OP_IteratorReopen: {
 	assert(pOp->p5 == 0);
@@ -3237,7 +3362,7 @@ case OP_IteratorOpen:
 	cur->key_def = index->def->key_def;
 	cur->nullRow = 1;
 open_cursor_set_hints:
-	cur->uc.pCursor->hints = pOp->p5 & OPFLAG_SEEKEQ;
+	cur->uc.pCursor->hints = pOp->p5 & (OPFLAG_SEEKEQ | OPFLAG_KEY_ONLY);
 	break;
 }
 
@@ -4345,6 +4470,71 @@ case OP_Next:          /* jump */
 	break;
 }
 
+/* Opcode: HashBuild P1 P2 * * *
+ *
+ * Load all tuples of the space cursor P1 is opened on into
+ * a hash table keyed by the field P2. The table is used by
+ * HashSeek and HashNext on the same cursor.
+ */
+case OP_HashBuild: {
+	VdbeCursor *pC;
+
+	assert(pOp->p1>=0 && pOp->p1<p->nCursor);
+	pC = p->apCsr[pOp->p1];
+	assert(pC!=0);
+	assert(pC->eCurType==CURTYPE_TARANTOOL);
+	if (sql_hash_join_build(pC->uc.pCursor, pOp->p2) != 0)
+		goto abort_due_to_error;
+	pC->cacheStatus = CACHE_STALE;
+	pC->nullRow = 1;
+	break;
+}
+
+/* Opcode: HashSeek P1 P2 P3 * *
+ * Synopsis: key=r[P3]
+ *
+ * Position cursor P1 at the first tuple of its hash table
+ * which key is equal to the value in register P3. If there
+ * is no such tuple, jump to P2.
+ */
+case OP_HashSeek: {       /* jump, in3 */
+	VdbeCursor *pC;
+	int res;
+
+	assert(pOp->p1>=0 && pOp->p1<p->nCursor);
+	pC = p->apCsr[pOp->p1];
+	assert(pC!=0);
+	assert(pC->eCurType==CURTYPE_TARANTOOL);
+	pIn3 = &aMem[pOp->p3];
+	sql_hash_join_seek(pC->uc.pCursor, pIn3, &res);
+	pC->cacheStatus = CACHE_STALE;
+	pC->nullRow = (u8)res;
+	VdbeBranchTaken(res!=0,2);
+	if (res) goto jump_to_p2;
+	break;
+}
+
+/* Opcode: HashNext P1 P2 * * *
+ *
+ * Advance cursor P1 to the next tuple found by HashSeek and
+ * jump to P2. If there are no more tuples, fall through.
+ */
+case OP_HashNext: {       /* jump */
+	VdbeCursor *pC;
+	int res;
+
+	assert(pOp->p1>=0 && pOp->p1<p->nCursor);
+	pC = p->apCsr[pOp->p1];
+	assert(pC!=0);
+	assert(pC->eCurType==CURTYPE_TARANTOOL);
+	sql_hash_join_next(pC->uc.pCursor, &res);
+	pC->cacheStatus = CACHE_STALE;
+	pC->nullRow = (u8)res;
+	VdbeBranchTaken(res==0,2);
+	if (res==0) goto jump_to_p2;
+	break;
+}
+
 /* Opcode: SorterInsert P1 P2 * * *
  * Synopsis: key=r[P2]
  *
@@ -93,6 +93,10 @@ struct VdbeOp {
 		 * doing a cast.
 		 */
 		enum field_type *types;
+		/** Used when p4type is P4_AGGSCAN. */
+		struct sql_agg_scan *agg_scan;
+		/** Used when p4type is P4_CURSOR_FILTER. */
+		struct sql_cursor_filter *cursor_filter;
 	} p4;
 #ifdef SQL_ENABLE_EXPLAIN_COMMENTS
 	char *zComment;		/* Comment to improve readability */
@@ -142,6 +146,10 @@ struct SubProgram {
 #define P4_PTR      (-18)	/* P4 is a generic pointer */
 #define P4_KEYINFO  (-19)       /* P4 is a pointer to sql_key_info structure. */
 #define P4_SPACEPTR (-20)       /* P4 is a space pointer */
+/** P4 is a pointer to sql_agg_scan structure. */
+#define P4_AGGSCAN  (-21)
+/** P4 is a pointer to sql_cursor_filter structure. */
+#define P4_CURSOR_FILTER (-22)
 
 /* Error message codes for OP_Halt */
 #define P5_ConstraintNotNull 1
@@ -652,6 +652,84 @@ int sqlVdbeRecordCompareMsgpack(const void *key1,
 int
 vdbe_decode_msgpack_into_mem(const char *buf, struct Mem *mem, uint32_t *len);
 
+/**
+ * Evaluate aggregate functions over the tuples of the space
+ * the cursor is opened on which match the conditions.
+ *
+ * @param cursor Cursor opened on the primary index.
+ * @param scan Functions and conditions to evaluate.
+ * @param values Values compared with the fields by
+ *        scan->conds, one per condition.
+ * @param regs VDBE registers, result of scan->items[i] is
+ *        stored to regs[scan->items[i].reg].
+ * @retval 0 on success.
+ * @retval -1 on error, diag is set.
+ */
+int
+sql_agg_scan_run(struct BtCursor *cursor, const struct sql_agg_scan *scan,
+		 const struct Mem *values, struct Mem *regs);
+
+/**
+ * Load all tuples of the space the cursor is opened on into a
+ * hash table keyed by the field @a fieldno. A table built by
+ * a previous call is dropped. The field must be of type
+ * integer, unsigned or string.
+ *
+ * @param cursor Cursor opened on the primary index.
+ * @param fieldno Key field number.
+ * @retval 0 on success.
+ * @retval -1 on error, diag is set.
+ */
+int
+sql_hash_join_build(struct BtCursor *cursor, uint32_t fieldno);
+
+/**
+ * Position the cursor at the first tuple of the hash table
+ * having the key equal to @a key. If the key type differs
+ * from the type of the table keys, all the tuples are
+ * visited: the join term must be checked for each of them.
+ *
+ * @param cursor Cursor with a hash table.
+ * @param key Value to look up.
+ * @param[out] res 0 if the cursor is positioned at a tuple,
+ *        1 if there is no tuple to visit.
+ */
+void
+sql_hash_join_seek(struct BtCursor *cursor, const struct Mem *key, int *res);
+
+/**
+ * Move the cursor to the next tuple found by
+ * sql_hash_join_seek(). @a res is set to 1 when there is none.
+ */
+void
+sql_hash_join_next(struct BtCursor *cursor, int *res);
+
+/** Release tuples of the hash table and free it. */
+void
+sql_hash_join_delete(struct sql_hash_join *hash);
+
+/**
+ * Install filter @a filter to be applied by the next seek of
+ * the cursor. The filter is copied together with the values of
+ * its conditions, @a values[i] being the value of the i-th one.
+ *
+ * @retval 0 on success.
+ * @retval -1 on memory error, diag is set.
+ */
+int
+sql_cursor_set_filter(struct BtCursor *cursor,
+		      const struct sql_cursor_filter *filter,
+		      const struct Mem *values);
+
+/**
+ * Return false if the tuple doesn't match the filter for sure.
+ * Conditions which can't be evaluated on the raw tuple are
+ * considered satisfied.
+ */
+bool
+sql_cursor_filter_match(const struct sql_cursor_filter *filter,
+			struct tuple *tuple);
+
 struct mpstream;
 struct region;
 
@@ -0,0 +1,506 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of OP_AggScan: a batched
+ * evaluation of aggregate functions over a whole space. Unlike
+ * the generic aggregate loop, it doesn't dispatch opcodes and
+ * doesn't fill VDBE memory cells per row. Tuples are fetched
+ * from the iterator in batches, each argument and condition
+ * field is decoded once per batch into a column of plain values.
+ * The conditions build a selection vector of the matching rows,
+ * the columns are compacted by it, and every function folds its
+ * column in a tight loop.
+ */
+#include <math.h>
+
+#include "sqlInt.h"
+#include "vdbeInt.h"
+#include "box/index.h"
+#include "box/space.h"
+#include "box/tuple.h"
+#include "box/txn.h"
+#include "fiber.h"
+#include "msgpuck/msgpuck.h"
+
+enum {
+	/** Number of tuples processed at once. */
+	AGG_SCAN_BATCH_SIZE = 256,
+};
+
+/** Decoded value of an aggregate function argument. */
+struct agg_scan_value {
+	/** MP_NIL, MP_UINT, MP_INT (negative only) or MP_DOUBLE. */
+	enum mp_type type;
+	union {
+		uint64_t u;
+		int64_t i;
+		double d;
+	} u;
+};
+
+/** State of an aggregate function. */
+struct agg_scan_acc {
+	/** Number of processed non-NULL arguments. */
+	uint64_t count;
+	/**
+	 * SUM, TOTAL and AVG. The same as SumCtx used by the
+	 * generic implementation, see sum_step().
+	 */
+	double rsum;
+	int64_t isum;
+	bool is_neg;
+	bool is_approx;
+	bool is_overflow;
+	/** MIN and MAX: the best value so far. */
+	struct agg_scan_value best;
+};
+
+/**
+ * Decode field @a fieldno of @a count tuples into @a column.
+ * A missing field is decoded as NULL.
+ */
+static int
+agg_scan_decode(struct tuple **tuples, uint32_t count, uint32_t fieldno,
+		struct agg_scan_value *column)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		struct agg_scan_value *value = &column[i];
+		const char *data = tuple_field(tuples[i], fieldno);
+		if (data == NULL) {
+			value->type = MP_NIL;
+			continue;
+		}
+		value->type = mp_typeof(*data);
+		switch (value->type) {
+		case MP_NIL:
+			break;
+		case MP_UINT:
+			value->u.u = mp_decode_uint(&data);
+			break;
+		case MP_INT:
+			value->u.i = mp_decode_int(&data);
+			if (value->u.i >= 0)
+				value->type = MP_UINT;
+			break;
+		case MP_FLOAT:
+			value->u.d = mp_decode_float(&data);
+			value->type = MP_DOUBLE;
+			break;
+		case MP_DOUBLE:
+			value->u.d = mp_decode_double(&data);
+			break;
+		default:
+			diag_set(ClientError, ER_SQL_TYPE_MISMATCH,
+				 mp_type_strs[value->type], "number");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static inline void
+agg_scan_count(struct agg_scan_acc *acc, const struct agg_scan_value *column,
+	       uint32_t count)
+{
+	uint64_t n = 0;
+	for (uint32_t i = 0; i < count; i++)
+		n += column[i].type != MP_NIL;
+	acc->count += n;
+}
+
+static inline void
+agg_scan_sum(struct agg_scan_acc *acc, const struct agg_scan_value *column,
+	     uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		const struct agg_scan_value *value = &column[i];
+		if (value->type == MP_NIL)
+			continue;
+		acc->count++;
+		if (value->type == MP_DOUBLE) {
+			acc->rsum += value->u.d;
+			acc->is_approx = true;
+			continue;
+		}
+		bool is_neg = value->type == MP_INT;
+		if (is_neg)
+			acc->rsum += value->u.i;
+		else
+			acc->rsum += value->u.u;
+		if (!acc->is_approx && !acc->is_overflow &&
+		    sql_add_int(acc->isum, acc->is_neg, value->u.i, is_neg,
+				&acc->isum, &acc->is_neg) != 0)
+			acc->is_overflow = true;
+	}
+}
+
+/**
+ * Compare two non-NULL values. Values of one field are either
+ * all integers or all doubles: fields of other types are not
+ * processed by OP_AggScan.
+ */
+static inline int
+agg_scan_value_cmp(const struct agg_scan_value *a,
+		   const struct agg_scan_value *b)
+{
+	if (a->type == MP_DOUBLE) {
+		assert(b->type == MP_DOUBLE);
+		return a->u.d < b->u.d ? -1 : a->u.d > b->u.d;
+	}
+	assert(b->type == MP_UINT || b->type == MP_INT);
+	if (a->type != b->type)
+		return a->type == MP_INT ? -1 : 1;
+	if (a->type == MP_INT)
+		return a->u.i < b->u.i ? -1 : a->u.i > b->u.i;
+	return a->u.u < b->u.u ? -1 : a->u.u > b->u.u;
+}
+
+/**
+ * Compare a non-NULL field value with a non-NULL condition
+ * value. Unlike the values of one field, they may be an integer
+ * and a double, which are compared exactly.
+ */
+static inline int
+agg_scan_value_cmp_mixed(const struct agg_scan_value *a,
+			 const struct agg_scan_value *b)
+{
+	if ((a->type == MP_DOUBLE) == (b->type == MP_DOUBLE))
+		return agg_scan_value_cmp(a, b);
+	if (a->type == MP_DOUBLE) {
+		return b->type == MP_UINT ?
+		       double_compare_uint64(a->u.d, b->u.u, 1) :
+		       double_compare_nint64(a->u.d, b->u.i, 1);
+	}
+	return a->type == MP_UINT ?
+	       double_compare_uint64(b->u.d, a->u.u, -1) :
+	       double_compare_nint64(b->u.d, a->u.i, -1);
+}
+
+/** Check if a field value matches a condition. */
+static inline bool
+agg_scan_cond_match(int op, const struct agg_scan_value *value,
+		    const struct agg_scan_value *cond_value)
+{
+	if (op == TK_ISNULL)
+		return value->type == MP_NIL;
+	if (op == TK_NOTNULL)
+		return value->type != MP_NIL;
+	/* Comparison with NULL is never true. */
+	if (value->type == MP_NIL || cond_value->type == MP_NIL)
+		return false;
+	int cmp = agg_scan_value_cmp_mixed(value, cond_value);
+	switch (op) {
+	case TK_EQ:
+		return cmp == 0;
+	case TK_NE:
+		return cmp != 0;
+	case TK_LT:
+		return cmp < 0;
+	case TK_LE:
+		return cmp <= 0;
+	case TK_GT:
+		return cmp > 0;
+	default:
+		assert(op == TK_GE);
+		return cmp >= 0;
+	}
+}
+
+/**
+ * Leave only the rows of a batch matching all the conditions in
+ * the columns. Return the number of rows left.
+ */
+static uint32_t
+agg_scan_filter(const struct sql_agg_scan *scan,
+		const struct agg_scan_value *cond_values,
+		struct agg_scan_value *columns, uint32_t count)
+{
+	uint16_t sel[AGG_SCAN_BATCH_SIZE];
+	for (uint32_t i = 0; i < count; i++)
+		sel[i] = i;
+	for (uint32_t i = 0; i < scan->cond_count && count > 0; i++) {
+		const struct sql_agg_scan_cond *cond = &scan->conds[i];
+		const struct agg_scan_value *column =
+			&columns[cond->column * AGG_SCAN_BATCH_SIZE];
+		uint32_t selected = 0;
+		for (uint32_t j = 0; j < count; j++) {
+			sel[selected] = sel[j];
+			selected += agg_scan_cond_match(cond->op,
+							&column[sel[j]],
+							&cond_values[i]);
+		}
+		count = selected;
+	}
+	/* sel[j] >= j, so the columns are compacted in place. */
+	for (uint32_t i = 0; i < scan->column_count; i++) {
+		struct agg_scan_value *column =
+			&columns[i * AGG_SCAN_BATCH_SIZE];
+		for (uint32_t j = 0; j < count; j++)
+			column[j] = column[sel[j]];
+	}
+	return count;
+}
+
+static inline void
+agg_scan_minmax(struct agg_scan_acc *acc, const struct agg_scan_value *column,
+		uint32_t count, bool is_max)
+{
+	int sign = is_max ? 1 : -1;
+	for (uint32_t i = 0; i < count; i++) {
+		const struct agg_scan_value *value = &column[i];
+		if (value->type == MP_NIL)
+			continue;
+		if (acc->best.type == MP_NIL ||
+		    agg_scan_value_cmp(value, &acc->best) * sign > 0)
+			acc->best = *value;
+	}
+}
+
+/**
+ * Fold the tuples of a batch matching the conditions into the
+ * function states.
+ */
+static int
+agg_scan_batch(const struct sql_agg_scan *scan,
+	       const struct agg_scan_value *cond_values,
+	       struct tuple **tuples, uint32_t count,
+	       struct agg_scan_value *columns, struct agg_scan_acc *accs)
+{
+	for (uint32_t i = 0; i < scan->column_count; i++) {
+		if (agg_scan_decode(tuples, count, scan->fieldno[i],
+				    &columns[i * AGG_SCAN_BATCH_SIZE]) != 0)
+			return -1;
+	}
+	if (scan->cond_count > 0)
+		count = agg_scan_filter(scan, cond_values, columns, count);
+	for (uint32_t i = 0; i < scan->item_count; i++) {
+		const struct sql_agg_scan_item *item = &scan->items[i];
+		struct agg_scan_acc *acc = &accs[i];
+		const struct agg_scan_value *column = NULL;
+		if (item->column >= 0)
+			column = &columns[item->column * AGG_SCAN_BATCH_SIZE];
+		switch (item->op) {
+		case SQL_AGG_SCAN_COUNT:
+			if (column == NULL)
+				acc->count += count;
+			else
+				agg_scan_count(acc, column, count);
+			break;
+		case SQL_AGG_SCAN_SUM:
+		case SQL_AGG_SCAN_TOTAL:
+		case SQL_AGG_SCAN_AVG:
+			agg_scan_sum(acc, column, count);
+			break;
+		case SQL_AGG_SCAN_MIN:
+			agg_scan_minmax(acc, column, count, false);
+			break;
+		case SQL_AGG_SCAN_MAX:
+			agg_scan_minmax(acc, column, count, true);
+			break;
+		default:
+			unreachable();
+		}
+	}
+	return 0;
+}
+
+/**
+ * Store the result of a function. The results are the same as
+ * the ones of the generic finalizers, see func.c.
+ */
+static int
+agg_scan_finish(const struct sql_agg_scan_item *item,
+		const struct agg_scan_acc *acc, struct Mem *mem)
+{
+	switch (item->op) {
+	case SQL_AGG_SCAN_COUNT:
+		mem_set_u64(mem, acc->count);
+		break;
+	case SQL_AGG_SCAN_SUM:
+		if (acc->count == 0)
+			break;
+		if (acc->is_overflow) {
+			diag_set(ClientError, ER_SQL_EXECUTE,
+				 "integer overflow");
+			return -1;
+		}
+		if (acc->is_approx)
+			mem_set_double(mem, acc->rsum);
+		else
+			mem_set_int(mem, acc->isum, acc->is_neg);
+		break;
+	case SQL_AGG_SCAN_TOTAL:
+		mem_set_double(mem, acc->rsum);
+		break;
+	case SQL_AGG_SCAN_AVG:
+		if (acc->count > 0)
+			mem_set_double(mem, acc->rsum / (double)acc->count);
+		break;
+	case SQL_AGG_SCAN_MIN:
+	case SQL_AGG_SCAN_MAX:
+		switch (acc->best.type) {
+		case MP_NIL:
+			return 0;
+		case MP_UINT:
+			mem_set_u64(mem, acc->best.u.u);
+			break;
+		case MP_INT:
+			mem_set_int(mem, acc->best.u.i, true);
+			break;
+		case MP_DOUBLE:
+			mem_set_double(mem, acc->best.u.d);
+			break;
+		default:
+			unreachable();
+		}
+		/* The same type as OP_Column would set. */
+		mem->field_type = item->type;
+		break;
+	default:
+		unreachable();
+	}
+	return 0;
+}
+
+/** Convert the value a condition compares a field with. */
+static void
+agg_scan_cond_value(const struct Mem *mem, struct agg_scan_value *value)
+{
+	if ((mem->flags & MEM_UInt) != 0) {
+		value->type = MP_UINT;
+		value->u.u = mem->u.u;
+	} else if ((mem->flags & MEM_Int) != 0) {
+		value->type = MP_INT;
+		value->u.i = mem->u.i;
+	} else if ((mem->flags & MEM_Real) != 0 && !isnan(mem->u.r)) {
+		value->type = MP_DOUBLE;
+		value->u.d = mem->u.r;
+	} else {
+		value->type = MP_NIL;
+	}
+}
+
+int
+sql_agg_scan_run(struct BtCursor *cursor, const struct sql_agg_scan *scan,
+		 const struct Mem *values, struct Mem *regs)
+{
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size_t tuples_size = AGG_SCAN_BATCH_SIZE * sizeof(struct tuple *);
+	struct tuple **tuples =
+		region_aligned_alloc(region, tuples_size, alignof(*tuples));
+	if (tuples == NULL) {
+		diag_set(OutOfMemory, tuples_size, "region_aligned_alloc",
+			 "tuples");
+		return -1;
+	}
+	size_t columns_size = scan->column_count * AGG_SCAN_BATCH_SIZE *
+			      sizeof(struct agg_scan_value);
+	struct agg_scan_value *columns =
+		region_aligned_alloc(region, columns_size, alignof(*columns));
+	if (columns == NULL) {
+		diag_set(OutOfMemory, columns_size, "region_aligned_alloc",
+			 "columns");
+		goto fail;
+	}
+	size_t accs_size = scan->item_count * sizeof(struct agg_scan_acc);
+	struct agg_scan_acc *accs =
+		region_aligned_alloc(region, accs_size, alignof(*accs));
+	if (accs == NULL) {
+		diag_set(OutOfMemory, accs_size, "region_aligned_alloc",
+			 "accs");
+		goto fail;
+	}
+	memset(accs, 0, accs_size);
+	for (uint32_t i = 0; i < scan->item_count; i++)
+		accs[i].best.type = MP_NIL;
+	size_t cond_values_size =
+		scan->cond_count * sizeof(struct agg_scan_value);
+	struct agg_scan_value *cond_values =
+		region_aligned_alloc(region, cond_values_size,
+				     alignof(*cond_values));
+	if (cond_values == NULL && cond_values_size > 0) {
+		diag_set(OutOfMemory, cond_values_size,
+			 "region_aligned_alloc", "cond_values");
+		goto fail;
+	}
+	for (uint32_t i = 0; i < scan->cond_count; i++)
+		agg_scan_cond_value(&values[i], &cond_values[i]);
+
+	struct space *space = cursor->space;
+	struct txn *txn = NULL;
+	if (space->def->id != 0 && txn_begin_ro_stmt(space, &txn) != 0)
+		goto fail;
+	struct iterator *it = index_create_iterator(cursor->index, ITER_ALL,
+						    NULL, 0);
+	if (it == NULL) {
+		if (txn != NULL)
+			txn_rollback_stmt(txn);
+		goto fail;
+	}
+	if (txn != NULL)
+		txn_commit_ro_stmt(txn);
+
+	int rc = 0;
+	uint32_t count;
+	do {
+		count = 0;
+		struct tuple *tuple;
+		while (count < AGG_SCAN_BATCH_SIZE) {
+			if (iterator_next(it, &tuple) != 0) {
+				rc = -1;
+				break;
+			}
+			if (tuple == NULL)
+				break;
+			/* Vinyl iterators may yield. */
+			tuple_ref(tuple);
+			tuples[count++] = tuple;
+		}
+		if (rc == 0)
+			rc = agg_scan_batch(scan, cond_values, tuples, count,
+					    columns, accs);
+		for (uint32_t i = 0; i < count; i++)
+			tuple_unref(tuples[i]);
+	} while (rc == 0 && count == AGG_SCAN_BATCH_SIZE);
+	iterator_delete(it);
+
+	for (uint32_t i = 0; i < scan->item_count && rc == 0; i++) {
+		const struct sql_agg_scan_item *item = &scan->items[i];
+		rc = agg_scan_finish(item, &accs[i], &regs[item->reg]);
+	}
+	region_truncate(region, region_svp);
+	return rc;
+fail:
+	region_truncate(region, region_svp);
+	return -1;
+}
@@ -437,6 +437,11 @@ sqlStep(Vdbe * p)
 
 		db->nVdbeActive++;
 		p->pc = 0;
+		/*
+		 * A cached statement may keep ids of its previous
+		 * execution, allocated on a region long freed.
+		 */
+		stailq_create(&p->autoinc_id_list);
 	}
 	if (p->explain) {
 		rc = sqlVdbeList(p);
@@ -943,6 +948,18 @@ sql_unbind(struct sql_stmt *stmt)
 	}
 }
 
+int
+sql_bind_copy_static(struct sql_stmt *stmt)
+{
+	struct Vdbe *v = (struct Vdbe *) stmt;
+	for (int i = 0; i < v->nVar; ++i) {
+		if ((v->aVar[i].flags & MEM_Static) != 0 &&
+		    sqlVdbeMemMakeWriteable(&v->aVar[i]) != 0)
+			return -1;
+	}
+	return 0;
+}
+
 /*
  * Bind a text or BLOB value.
  */
@@ -608,7 +608,9 @@ freeP4(sql * db, int p4type, void *p4)
 	case P4_INT64:
 	case P4_UINT64:
 	case P4_DYNAMIC:
-	case P4_INTARRAY:{
+	case P4_INTARRAY:
+	case P4_AGGSCAN:
+	case P4_CURSOR_FILTER:{
 			sqlDbFree(db, p4);
 			break;
 		}
@@ -1149,6 +1151,17 @@ displayP4(Op * pOp, char *zTemp, int nTemp)
 		sqlXPrintf(&x, "space<name=%s>", space_name(pOp->p4.space));
 		break;
 	}
+	case P4_AGGSCAN: {
+		sqlXPrintf(&x, "agg_scan<functions=%u,conditions=%u>",
+			   pOp->p4.agg_scan->item_count,
+			   pOp->p4.agg_scan->cond_count);
+		break;
+	}
+	case P4_CURSOR_FILTER: {
+		sqlXPrintf(&x, "cursor_filter<conditions=%u>",
+			   pOp->p4.cursor_filter->item_count);
+		break;
+	}
 	default:{
 			zP4 = pOp->p4.z;
 			if (zP4 == 0) {
@@ -1683,6 +1696,10 @@ sqlVdbeFreeCursor(Vdbe * p, VdbeCursor * pCx)
 		}
 	case CURTYPE_TARANTOOL:{
 		assert(pCx->uc.pCursor != 0);
+		if (pCx->uc.pCursor->hash != NULL) {
+			sql_hash_join_delete(pCx->uc.pCursor->hash);
+			pCx->uc.pCursor->hash = NULL;
+		}
 		sql_cursor_close(pCx->uc.pCursor);
 			break;
 		}
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of OP_CursorFilter:
+ * simple conditions of the WHERE clause are checked by the
+ * cursor right on the tuples returned by the index iterator, so
+ * the tuples which don't match them never get into VDBE memory
+ * cells and don't cost a round of the loop opcodes.
+ */
+#include <math.h>
+
+#include "sqlInt.h"
+#include "vdbeInt.h"
+#include "box/tuple.h"
+#include "msgpuck/msgpuck.h"
+
+/**
+ * Integers of a greater absolute value are not always exactly
+ * representable as a double.
+ */
+#define FILTER_EXACT_DOUBLE_MAX (1ULL << 53)
+
+int
+sql_cursor_set_filter(struct BtCursor *cursor,
+		      const struct sql_cursor_filter *filter,
+		      const struct Mem *values)
+{
+	uint32_t count = filter->item_count;
+	size_t size = sizeof(*filter) + count * sizeof(filter->items[0]);
+	size_t str_offset = size;
+	for (uint32_t i = 0; i < count; i++) {
+		if ((values[i].flags & MEM_Str) != 0)
+			size += values[i].n;
+	}
+	struct sql_cursor_filter *copy = malloc(size);
+	if (copy == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "copy");
+		return -1;
+	}
+	memcpy(copy, filter, str_offset);
+	char *str = (char *)copy + str_offset;
+	for (uint32_t i = 0; i < count; i++) {
+		struct sql_cursor_filter_item *item = &copy->items[i];
+		const struct Mem *value = &values[i];
+		if ((value->flags & MEM_UInt) != 0) {
+			item->type = MP_UINT;
+			item->value.u = value->u.u;
+		} else if ((value->flags & MEM_Int) != 0) {
+			item->type = MP_INT;
+			item->value.i = value->u.i;
+		} else if ((value->flags & MEM_Real) != 0 &&
+			   !isnan(value->u.r)) {
+			item->type = MP_DOUBLE;
+			item->value.d = value->u.r;
+		} else if ((value->flags & MEM_Str) != 0) {
+			item->type = MP_STR;
+			memcpy(str, value->z, value->n);
+			item->value.s = str;
+			item->len = value->n;
+			str += value->n;
+		} else {
+			item->type = MP_NIL;
+		}
+	}
+	free(cursor->filter);
+	cursor->filter = copy;
+	cursor->is_filter_pending = true;
+	return 0;
+}
+
+/**
+ * Compare two numbers given as msgpack types and values.
+ * Return -1 if the result can't be computed exactly.
+ */
+static int
+filter_compare_numbers(enum mp_type a_type, uint64_t a_u, int64_t a_i,
+		       double a_d, const struct sql_cursor_filter_item *b,
+		       int *cmp)
+{
+	if (a_type != MP_DOUBLE && b->type != MP_DOUBLE) {
+		if (a_type != b->type) {
+			/* A negative integer is less than any unsigned. */
+			*cmp = a_type == MP_INT ? -1 : 1;
+		} else if (a_type == MP_UINT) {
+			*cmp = a_u < b->value.u ? -1 : a_u > b->value.u;
+		} else {
+			*cmp = a_i < b->value.i ? -1 : a_i > b->value.i;
+		}
+		return 0;
+	}
+	double a, b_d;
+	switch (a_type) {
+	case MP_UINT:
+		if (a_u > FILTER_EXACT_DOUBLE_MAX)
+			return -1;
+		a = a_u;
+		break;
+	case MP_INT:
+		if (a_i < -(int64_t)FILTER_EXACT_DOUBLE_MAX)
+			return -1;
+		a = a_i;
+		break;
+	default:
+		a = a_d;
+		break;
+	}
+	switch (b->type) {
+	case MP_UINT:
+		if (b->value.u > FILTER_EXACT_DOUBLE_MAX)
+			return -1;
+		b_d = b->value.u;
+		break;
+	case MP_INT:
+		if (b->value.i < -(int64_t)FILTER_EXACT_DOUBLE_MAX)
+			return -1;
+		b_d = b->value.i;
+		break;
+	default:
+		b_d = b->value.d;
+		break;
+	}
+	if (isnan(a))
+		return -1;
+	*cmp = a < b_d ? -1 : a > b_d;
+	return 0;
+}
+
+/**
+ * Compare a field with the value of the condition. Return -1 if
+ * they can't be compared by the filter: the field and the value
+ * are of different classes, or the field has a collation.
+ */
+static int
+filter_compare(const char *field, const struct sql_cursor_filter_item *item,
+	       int *cmp)
+{
+	uint64_t u = 0;
+	int64_t i = 0;
+	double d = 0;
+	enum mp_type type = mp_typeof(*field);
+	switch (type) {
+	case MP_UINT:
+		u = mp_decode_uint(&field);
+		break;
+	case MP_INT:
+		i = mp_decode_int(&field);
+		if (i >= 0) {
+			u = i;
+			type = MP_UINT;
+		}
+		break;
+	case MP_FLOAT:
+		d = mp_decode_float(&field);
+		type = MP_DOUBLE;
+		break;
+	case MP_DOUBLE:
+		d = mp_decode_double(&field);
+		break;
+	case MP_STR: {
+		if (item->type != MP_STR || !item->is_binary)
+			return -1;
+		uint32_t len;
+		const char *str = mp_decode_str(&field, &len);
+		int rc = memcmp(str, item->value.s, MIN(len, item->len));
+		*cmp = rc != 0 ? rc : (int)len - (int)item->len;
+		return 0;
+	}
+	default:
+		return -1;
+	}
+	if (item->type == MP_STR)
+		return -1;
+	return filter_compare_numbers(type, u, i, d, item, cmp);
+}
+
+bool
+sql_cursor_filter_match(const struct sql_cursor_filter *filter,
+			struct tuple *tuple)
+{
+	for (uint32_t i = 0; i < filter->item_count; i++) {
+		const struct sql_cursor_filter_item *item = &filter->items[i];
+		const char *field = tuple_field(tuple, item->fieldno);
+		bool is_null = field == NULL || mp_typeof(*field) == MP_NIL;
+		if (item->op == TK_ISNULL) {
+			if (!is_null)
+				return false;
+			continue;
+		}
+		if (item->op == TK_NOTNULL) {
+			if (is_null)
+				return false;
+			continue;
+		}
+		if (item->type == MP_NIL)
+			continue;
+		/* Comparison with NULL is never true. */
+		if (is_null)
+			return false;
+		int cmp;
+		if (filter_compare(field, item, &cmp) != 0)
+			continue;
+		bool is_match;
+		switch (item->op) {
+		case TK_EQ:
+			is_match = cmp == 0;
+			break;
+		case TK_LT:
+			is_match = cmp < 0;
+			break;
+		case TK_LE:
+			is_match = cmp <= 0;
+			break;
+		case TK_GT:
+			is_match = cmp > 0;
+			break;
+		default:
+			assert(item->op == TK_GE);
+			is_match = cmp >= 0;
+			break;
+		}
+		if (!is_match)
+			return false;
+	}
+	return true;
+}
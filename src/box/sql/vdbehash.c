@@ -0,0 +1,378 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the hash table used by the hash join loops
+ * (OP_HashBuild, OP_HashSeek, OP_HashNext). The whole space is
+ * loaded into the table once, and then every row of the outer
+ * loops probes it instead of scanning the space again.
+ */
+#include "sqlInt.h"
+#include "vdbeInt.h"
+#include "box/index.h"
+#include "box/space.h"
+#include "box/tuple.h"
+#include "box/txn.h"
+#include "fiber.h"
+#include "msgpuck/msgpuck.h"
+#include "third_party/PMurHash.h"
+
+enum {
+	HASH_JOIN_SEED = 13U,
+};
+
+/** Key of a hash join table. */
+struct hash_join_key {
+	/** MP_UINT, MP_INT (negative only) or MP_STR. */
+	enum mp_type type;
+	union {
+		uint64_t u;
+		int64_t i;
+		struct {
+			const char *s;
+			uint32_t len;
+		} str;
+	};
+};
+
+/** A tuple stored in a hash join table. */
+struct hash_join_entry {
+	/** Next entry of the same bucket. */
+	struct hash_join_entry *next;
+	/** Hash of the key. */
+	uint32_t hash;
+	/** Key, strings point to the tuple data. */
+	struct hash_join_key key;
+	/** Referenced tuple. */
+	struct tuple *tuple;
+};
+
+struct sql_hash_join {
+	/** Memory of entries and buckets. */
+	struct region region;
+	/** True if the key field is a string, integer otherwise. */
+	bool is_str;
+	/** Number of buckets, a power of 2. */
+	uint32_t bucket_count;
+	/** Chains of entries. */
+	struct hash_join_entry **buckets;
+	/** Entry the cursor is positioned at. */
+	struct hash_join_entry *current;
+	/**
+	 * True if the probe key couldn't be hashed, so all the
+	 * entries are visited. It is correct since the join term
+	 * is checked for each of them anyway.
+	 */
+	bool scan_all;
+	/** Bucket of the current entry when scan_all is set. */
+	uint32_t current_bucket;
+};
+
+static uint32_t
+hash_join_key_hash(const struct hash_join_key *key)
+{
+	if (key->type == MP_STR)
+		return PMurHash32(HASH_JOIN_SEED, key->str.s, key->str.len);
+	return PMurHash32(HASH_JOIN_SEED, &key->u, sizeof(key->u));
+}
+
+static bool
+hash_join_key_equal(const struct hash_join_key *a,
+		    const struct hash_join_key *b)
+{
+	if (a->type != b->type)
+		return false;
+	if (a->type == MP_STR) {
+		return a->str.len == b->str.len &&
+		       memcmp(a->str.s, b->str.s, a->str.len) == 0;
+	}
+	return a->u == b->u;
+}
+
+/**
+ * Decode a key from a tuple field.
+ * @retval true Success.
+ * @retval false The field is NULL.
+ */
+static bool
+hash_join_key_decode(const char *field, struct hash_join_key *key)
+{
+	switch (mp_typeof(*field)) {
+	case MP_UINT:
+		key->type = MP_UINT;
+		key->u = mp_decode_uint(&field);
+		return true;
+	case MP_INT:
+		key->i = mp_decode_int(&field);
+		key->type = key->i < 0 ? MP_INT : MP_UINT;
+		return true;
+	case MP_STR:
+		key->type = MP_STR;
+		key->str.s = mp_decode_str(&field, &key->str.len);
+		return true;
+	default:
+		assert(mp_typeof(*field) == MP_NIL);
+		return false;
+	}
+}
+
+/**
+ * Make a key from a VDBE memory cell.
+ * @retval true Success.
+ * @retval false The value type doesn't match the type of the
+ *         table keys, so it can't be looked up by hash.
+ */
+static bool
+hash_join_key_from_mem(const struct sql_hash_join *hash,
+		       const struct Mem *mem, struct hash_join_key *key)
+{
+	if (hash->is_str) {
+		if ((mem->flags & MEM_Str) == 0)
+			return false;
+		key->type = MP_STR;
+		key->str.s = mem->z;
+		key->str.len = mem->n;
+		return true;
+	}
+	if ((mem->flags & MEM_UInt) != 0) {
+		key->type = MP_UINT;
+		key->u = mem->u.u;
+		return true;
+	}
+	if ((mem->flags & MEM_Int) != 0) {
+		key->i = mem->u.i;
+		key->type = key->i < 0 ? MP_INT : MP_UINT;
+		return true;
+	}
+	return false;
+}
+
+static void
+hash_join_entries_unref(struct hash_join_entry *entry)
+{
+	for (; entry != NULL; entry = entry->next)
+		tuple_unref(entry->tuple);
+}
+
+void
+sql_hash_join_delete(struct sql_hash_join *hash)
+{
+	for (uint32_t i = 0; i < hash->bucket_count; i++)
+		hash_join_entries_unref(hash->buckets[i]);
+	region_destroy(&hash->region);
+	free(hash);
+}
+
+int
+sql_hash_join_build(struct BtCursor *cursor, uint32_t fieldno)
+{
+	assert((cursor->curFlags & BTCF_TaCursor) != 0);
+	if (cursor->hash != NULL) {
+		sql_hash_join_delete(cursor->hash);
+		cursor->hash = NULL;
+	}
+	struct sql_hash_join *hash = malloc(sizeof(*hash));
+	if (hash == NULL) {
+		diag_set(OutOfMemory, sizeof(*hash), "malloc", "hash");
+		return -1;
+	}
+	memset(hash, 0, sizeof(*hash));
+	region_create(&hash->region, &cord()->slabc);
+	struct space *space = cursor->space;
+	assert(fieldno < space->def->field_count);
+	hash->is_str = space->def->fields[fieldno].type == FIELD_TYPE_STRING;
+
+	struct txn *txn = NULL;
+	if (txn_begin_ro_stmt(space, &txn) != 0)
+		goto fail;
+	struct iterator *it = index_create_iterator(cursor->index, ITER_ALL,
+						    NULL, 0);
+	if (it == NULL) {
+		txn_rollback_stmt(txn);
+		goto fail;
+	}
+	txn_commit_ro_stmt(txn);
+
+	/*
+	 * Collect the entries into a list first: the number of
+	 * tuples is not known until the end of the scan.
+	 */
+	struct hash_join_entry *list = NULL;
+	uint32_t count = 0;
+	struct tuple *tuple;
+	int rc;
+	while ((rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
+		const char *field = tuple_field(tuple, fieldno);
+		struct hash_join_key key;
+		/* NULL is not equal to anything. */
+		if (field == NULL || !hash_join_key_decode(field, &key))
+			continue;
+		struct hash_join_entry *entry =
+			region_aligned_alloc(&hash->region, sizeof(*entry),
+					     alignof(*entry));
+		if (entry == NULL) {
+			diag_set(OutOfMemory, sizeof(*entry),
+				 "region_aligned_alloc", "entry");
+			rc = -1;
+			break;
+		}
+		tuple_ref(tuple);
+		entry->tuple = tuple;
+		entry->key = key;
+		entry->hash = hash_join_key_hash(&key);
+		entry->next = list;
+		list = entry;
+		count++;
+	}
+	iterator_delete(it);
+	if (rc != 0)
+		goto fail_unref;
+
+	uint32_t bucket_count = 1;
+	while (bucket_count < count)
+		bucket_count *= 2;
+	size_t size = bucket_count * sizeof(*hash->buckets);
+	hash->buckets = region_aligned_alloc(&hash->region, size,
+					     alignof(*hash->buckets));
+	if (hash->buckets == NULL) {
+		diag_set(OutOfMemory, size, "region_aligned_alloc",
+			 "buckets");
+		goto fail_unref;
+	}
+	memset(hash->buckets, 0, size);
+	hash->bucket_count = bucket_count;
+	while (list != NULL) {
+		struct hash_join_entry *entry = list;
+		list = entry->next;
+		uint32_t i = entry->hash & (bucket_count - 1);
+		entry->next = hash->buckets[i];
+		hash->buckets[i] = entry;
+	}
+	cursor->hash = hash;
+	return 0;
+fail_unref:
+	hash_join_entries_unref(list);
+fail:
+	region_destroy(&hash->region);
+	free(hash);
+	return -1;
+}
+
+/**
+ * Find the first entry starting from @a entry, which should be
+ * visited by the cursor: having the key @a key with hash
+ * @a key_hash or any entry in case of a full scan.
+ */
+static struct hash_join_entry *
+hash_join_find(struct sql_hash_join *hash, struct hash_join_entry *entry,
+	       const struct hash_join_key *key, uint32_t key_hash)
+{
+	if (hash->scan_all) {
+		while (entry == NULL &&
+		       ++hash->current_bucket < hash->bucket_count)
+			entry = hash->buckets[hash->current_bucket];
+		return entry;
+	}
+	for (; entry != NULL; entry = entry->next) {
+		if (entry->hash == key_hash &&
+		    hash_join_key_equal(&entry->key, key))
+			return entry;
+	}
+	return NULL;
+}
+
+/** Position the cursor at the tuple of @a entry. */
+static void
+hash_join_set_current(struct BtCursor *cursor, struct hash_join_entry *entry,
+		      int *res)
+{
+	cursor->hash->current = entry;
+	if (cursor->last_tuple != NULL)
+		tuple_unref(cursor->last_tuple);
+	if (entry == NULL) {
+		cursor->last_tuple = NULL;
+		cursor->eState = CURSOR_INVALID;
+		*res = 1;
+		return;
+	}
+	tuple_ref(entry->tuple);
+	cursor->last_tuple = entry->tuple;
+	cursor->eState = CURSOR_VALID;
+	*res = 0;
+}
+
+void
+sql_hash_join_seek(struct BtCursor *cursor, const struct Mem *key, int *res)
+{
+	struct sql_hash_join *hash = cursor->hash;
+	assert(hash != NULL);
+	hash->scan_all = false;
+	if ((key->flags & MEM_Null) != 0) {
+		hash_join_set_current(cursor, NULL, res);
+		return;
+	}
+	struct hash_join_key probe;
+	if (!hash_join_key_from_mem(hash, key, &probe)) {
+		hash->scan_all = true;
+		hash->current_bucket = 0;
+		struct hash_join_entry *first = hash->buckets[0];
+		hash_join_set_current(cursor,
+				      hash_join_find(hash, first, NULL, 0),
+				      res);
+		return;
+	}
+	uint32_t probe_hash = hash_join_key_hash(&probe);
+	struct hash_join_entry *first =
+		hash->buckets[probe_hash & (hash->bucket_count - 1)];
+	hash_join_set_current(cursor,
+			      hash_join_find(hash, first, &probe, probe_hash),
+			      res);
+}
+
+void
+sql_hash_join_next(struct BtCursor *cursor, int *res)
+{
+	struct sql_hash_join *hash = cursor->hash;
+	assert(hash != NULL);
+	struct hash_join_entry *current = hash->current;
+	if (cursor->eState != CURSOR_VALID || current == NULL) {
+		*res = 1;
+		return;
+	}
+	/*
+	 * The probe key is not saved: its register may be reused
+	 * by the loop body. The current entry has the same key.
+	 */
+	hash_join_set_current(cursor,
+			      hash_join_find(hash, current->next,
+					     &current->key, current->hash),
+			      res);
+}
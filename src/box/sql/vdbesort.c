@@ -153,6 +153,9 @@
  */
 #include "sqlInt.h"
 #include "vdbeInt.h"
+#include "box/txn.h"
+#include "coio_task.h"
+#include "fiber.h"
 
 /*
  * Hard-coded maximum amount of data to accumulate in memory before flushing
@@ -1116,6 +1119,174 @@ vdbeSorterGetCompare(VdbeSorter * p)
 	return vdbeSorterCompare;
 }
 
+/*
+ * Sort a list of records connected with SorterRecord.u.pNext
+ * and return its new head. The list may be sorted by a coio
+ * thread, so this function must not allocate memory or touch
+ * anything but pTask and the list.
+ */
+static SorterRecord *
+vdbeSorterSortList(SortSubtask * pTask, SorterRecord * p)
+{
+	int i;
+	SorterRecord *aSlot[64];
+
+	memset(aSlot, 0, sizeof(aSlot));
+	while (p) {
+		SorterRecord *pNext = p->u.pNext;
+		p->u.pNext = 0;
+		for (i = 0; aSlot[i]; i++) {
+			p = vdbeSorterMerge(pTask, p, aSlot[i]);
+			aSlot[i] = 0;
+		}
+		aSlot[i] = p;
+		p = pNext;
+	}
+
+	p = 0;
+	for (i = 0; i < 64; i++) {
+		if (aSlot[i] == 0)
+			continue;
+		p = p ? vdbeSorterMerge(pTask, p, aSlot[i]) : aSlot[i];
+	}
+	return p;
+}
+
+/*
+ * Lists of at least this many records are split into chunks
+ * sorted by coio threads, see vdbeSorterSortOffload().
+ */
+#define SORTER_OFFLOAD_MIN_RECORDS 10000
+
+/* Maximal number of chunks sorted at the same time. */
+#define SORTER_OFFLOAD_MAX_CHUNKS 4
+
+/* A chunk of the list sorted by a coio thread. */
+struct sorter_chunk {
+	/* Compare context, owned by the chunk. */
+	SortSubtask task;
+	/* The chunk records, sorted when the worker is done. */
+	SorterRecord *pList;
+	/* Fiber waiting for the coio thread or NULL. */
+	struct fiber *worker;
+};
+
+static ssize_t
+vdbeSorterSortChunkCb(va_list ap)
+{
+	struct sorter_chunk *chunk = va_arg(ap, struct sorter_chunk *);
+	chunk->pList = vdbeSorterSortList(&chunk->task, chunk->pList);
+	return 0;
+}
+
+static int
+vdbeSorterSortChunkF(va_list ap)
+{
+	struct sorter_chunk *chunk = va_arg(ap, struct sorter_chunk *);
+	if (coio_call(vdbeSorterSortChunkCb, chunk) != 0) {
+		/* The callback never fails, so only the task allocation can. */
+		diag_set(OutOfMemory, sizeof(struct coio_task), "calloc",
+			 "coio_task");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Split the list of nRecord records into chunks, sort them
+ * by coio threads in parallel and merge them in the calling
+ * thread. The current fiber yields meanwhile, so that a big
+ * sort doesn't stall the tx thread.
+ */
+static int
+vdbeSorterSortOffload(SortSubtask * pTask, SorterList * pList, int nRecord)
+{
+	VdbeSorter *pSorter = pTask->pSorter;
+	struct sorter_chunk aChunk[SORTER_OFFLOAD_MAX_CHUNKS];
+	int nChunk = MIN(nRecord / SORTER_OFFLOAD_MIN_RECORDS,
+			 SORTER_OFFLOAD_MAX_CHUNKS);
+	int nPerChunk = (nRecord + nChunk - 1) / nChunk;
+	int rc = 0;
+	int i;
+
+	memset(aChunk, 0, sizeof(aChunk));
+	SorterRecord *p = pList->pList;
+	for (i = 0; i < nChunk; i++) {
+		struct sorter_chunk *chunk = &aChunk[i];
+		chunk->task.pSorter = pSorter;
+		chunk->task.xCompare = pTask->xCompare;
+		if (vdbeSortAllocUnpacked(&chunk->task) != 0)
+			rc = -1;
+		/* Cut the next nPerChunk records off the list. */
+		chunk->pList = p;
+		for (int j = 1; j < nPerChunk && p->u.pNext != 0; j++)
+			p = p->u.pNext;
+		SorterRecord *pNext = p->u.pNext;
+		p->u.pNext = 0;
+		p = pNext;
+	}
+	assert(p == 0);
+	if (rc != 0)
+		goto out;
+
+	for (i = 0; i < nChunk; i++) {
+		struct sorter_chunk *chunk = &aChunk[i];
+		chunk->worker = fiber_new("sorter", vdbeSorterSortChunkF);
+		if (chunk->worker == NULL) {
+			/* Sort the chunk in tx then. */
+			diag_clear(diag_get());
+			chunk->pList = vdbeSorterSortList(&chunk->task,
+							  chunk->pList);
+			continue;
+		}
+		fiber_set_joinable(chunk->worker, true);
+		fiber_start(chunk->worker, chunk);
+	}
+	/* Workers must be joined even on error, they use the lists. */
+	for (i = 0; i < nChunk; i++) {
+		if (aChunk[i].worker != NULL &&
+		    fiber_join(aChunk[i].worker) != 0)
+			rc = -1;
+	}
+out:
+	/*
+	 * Records of later chunks precede records of earlier
+	 * ones on ties, as vdbeSorterSortList() does.
+	 */
+	p = 0;
+	for (i = 0; i < nChunk; i++) {
+		struct sorter_chunk *chunk = &aChunk[i];
+		if (rc == 0)
+			p = p ? vdbeSorterMerge(pTask, chunk->pList, p) :
+			    chunk->pList;
+		sqlDbFree(pSorter->db, chunk->task.pUnpacked);
+	}
+	if (rc != 0) {
+		/* Keep the records to have them freed with the list. */
+		for (i = 0; i < nChunk; i++) {
+			SorterRecord *pLast = aChunk[i].pList;
+			while (pLast->u.pNext != 0)
+				pLast = pLast->u.pNext;
+			pLast->u.pNext = p;
+			p = aChunk[i].pList;
+		}
+	}
+	pList->pList = p;
+	return rc;
+}
+
+/*
+ * Return true if the current fiber may yield while sorting,
+ * i.e. it doesn't run a transaction that would be aborted by
+ * a yield.
+ */
+static bool
+vdbeSorterCanYield(void)
+{
+	struct txn *txn = in_txn();
+	return txn == NULL || txn_has_flag(txn, TXN_CAN_YIELD);
+}
+
 /*
  * Sort the linked list of records headed at pTask->pList. Return
  * 0 if successful, or an sql error code (i.e. -1) if
@@ -1124,26 +1295,19 @@ vdbeSorterGetCompare(VdbeSorter * p)
 static int
 vdbeSorterSort(SortSubtask * pTask, SorterList * pList)
 {
-	int i;
-	SorterRecord **aSlot;
 	SorterRecord *p;
+	SorterRecord *pNext;
+	int nRecord = 0;
 	int rc;
 
 	rc = vdbeSortAllocUnpacked(pTask);
 	if (rc != 0)
 		return rc;
 
-	p = pList->pList;
 	pTask->xCompare = vdbeSorterGetCompare(pTask->pSorter);
 
-	aSlot =
-	    (SorterRecord **) sqlMallocZero(64 * sizeof(SorterRecord *));
-	if (!aSlot) {
-		return -1;
-	}
-
-	while (p) {
-		SorterRecord *pNext;
+	/* Connect records in the bulk memory with pointers. */
+	for (p = pList->pList; p; p = pNext) {
 		if (pList->aMemory) {
 			if ((u8 *) p == pList->aMemory) {
 				pNext = 0;
@@ -1154,28 +1318,18 @@ vdbeSorterSort(SortSubtask * pTask, SorterList * pList)
 				    (SorterRecord *) & pList->aMemory[p->u.
 								      iNext];
 			}
+			p->u.pNext = pNext;
 		} else {
 			pNext = p->u.pNext;
 		}
-
-		p->u.pNext = 0;
-		for (i = 0; aSlot[i]; i++) {
-			p = vdbeSorterMerge(pTask, p, aSlot[i]);
-			aSlot[i] = 0;
-		}
-		aSlot[i] = p;
-		p = pNext;
+		nRecord++;
 	}
 
-	p = 0;
-	for (i = 0; i < 64; i++) {
-		if (aSlot[i] == 0)
-			continue;
-		p = p ? vdbeSorterMerge(pTask, p, aSlot[i]) : aSlot[i];
-	}
-	pList->pList = p;
+	if (nRecord >= 2 * SORTER_OFFLOAD_MIN_RECORDS &&
+	    vdbeSorterCanYield())
+		return vdbeSorterSortOffload(pTask, pList, nRecord);
 
-	sql_free(aSlot);
+	pList->pList = vdbeSorterSortList(pTask, pList->pList);
 	return 0;
 }
 
@@ -660,7 +660,7 @@ estLog(LogEst N)
  * Convert OP_Column opcodes to OP_Copy in previously generated code.
  *
  * This routine runs over generated VDBE code and translates OP_Column
- * opcodes into OP_Copy when the table is being accessed via co-routine
+ * and OP_ColumnCompare opcodes into OP_Copy when the table is being accessed via co-routine
  * instead of via table lookup.
  */
 static void
@@ -674,7 +674,8 @@ translateColumnToCopy(Vdbe * v,		/* The VDBE containing code to translate */
 	for (; iStart < iEnd; iStart++, pOp++) {
 		if (pOp->p1 != iTabCur)
 			continue;
-		if (pOp->opcode == OP_Column) {
+		if (pOp->opcode == OP_Column ||
+		    pOp->opcode == OP_ColumnCompare) {
 			pOp->opcode = OP_Copy;
 			pOp->p1 = pOp->p2 + iRegister;
 			pOp->p2 = pOp->p3;
@@ -711,6 +712,50 @@ termCanDriveIndex(WhereTerm * pTerm,	/* WHERE clause term to check */
 }
 #endif
 
+/**
+ * TUNING: Hash joins are considered for tables of 1000 rows
+ * and more (LogEst).
+ */
+#define HASH_JOIN_MIN_ROWS 99
+
+/**
+ * Check if the WHERE clause term @a term can be used to probe
+ * a hash table built over the table @a src: it is an equality
+ * between a column of the table and an expression of the same
+ * type computed by outer loops. Only integer and not collated
+ * string columns are hashed since equal values of these types
+ * always have equal representations.
+ */
+static bool
+term_can_drive_hash_join(struct Parse *parse, struct WhereTerm *term,
+			 struct SrcList_item *src)
+{
+	if (term->leftCursor != src->iCursor ||
+	    (term->eOperator & WO_EQ) == 0 || term->u.leftColumn < 0 ||
+	    term->prereqRight == 0)
+		return false;
+	struct Expr *expr = term->pExpr;
+	enum field_type type = src->space->def->fields[term->u.leftColumn].type;
+	enum field_type rhs_type = sql_expr_type(expr->pRight);
+	switch (type) {
+	case FIELD_TYPE_INTEGER:
+	case FIELD_TYPE_UNSIGNED:
+		return rhs_type == FIELD_TYPE_INTEGER ||
+		       rhs_type == FIELD_TYPE_UNSIGNED;
+	case FIELD_TYPE_STRING: {
+		if (rhs_type != FIELD_TYPE_STRING)
+			return false;
+		uint32_t coll_id;
+		if (sql_binary_compare_coll_seq(parse, expr->pLeft,
+						expr->pRight, &coll_id) != 0)
+			return false;
+		return coll_id == COLL_NONE;
+	}
+	default:
+		return false;
+	}
+}
+
 #ifndef SQL_OMIT_AUTOMATIC_INDEX
 /*
  * Generate code to construct the Index object for an automatic index
@@ -1875,12 +1920,14 @@ whereLoopCheaperProperSubset(const WhereLoop * pX,	/* First WhereLoop to compare
 static void
 whereLoopAdjustCost(const WhereLoop * p, WhereLoop * pTemplate)
 {
-	if ((pTemplate->wsFlags & WHERE_INDEXED) == 0)
+	if ((pTemplate->wsFlags & WHERE_INDEXED) == 0 ||
+	    (pTemplate->wsFlags & WHERE_HASH_JOIN) != 0)
 		return;
 	for (; p; p = p->pNextLoop) {
 		if (p->iTab != pTemplate->iTab)
 			continue;
-		if ((p->wsFlags & WHERE_INDEXED) == 0)
+		if ((p->wsFlags & WHERE_INDEXED) == 0 ||
+		    (p->wsFlags & WHERE_HASH_JOIN) != 0)
 			continue;
 		if (whereLoopCheaperProperSubset(p, pTemplate)) {
 			/* Adjust pTemplate cost downward so that it is cheaper than its
@@ -1933,23 +1980,24 @@ whereLoopFindLesser(WhereLoop ** ppPrev, const WhereLoop * pTemplate)
 			continue;
 		}
 		/* In the current implementation, the rSetup value is either zero
-		 * or the cost of building an automatic index (NlogN) and the NlogN
-		 * is the same for compatible WhereLoops.
+		 * or the cost of building an automatic index (NlogN) or a hash
+		 * table and the cost is the same for compatible WhereLoops.
 		 */
 		assert(p->rSetup == 0 || pTemplate->rSetup == 0
 		       || p->rSetup == pTemplate->rSetup);
 
 		/* whereLoopAddBtree() always generates and inserts the automatic index
-		 * case first.  Hence compatible candidate WhereLoops never have a larger
-		 * rSetup. Call this SETUP-INVARIANT
+		 * and hash join cases first.  Hence compatible candidate WhereLoops
+		 * never have a larger rSetup. Call this SETUP-INVARIANT
 		 */
 		assert(p->rSetup >= pTemplate->rSetup);
 
 		/* Any loop using an appliation-defined index (or PRIMARY KEY or
 		 * UNIQUE constraint) with one or more == constraints is better
-		 * than an automatic index. Unless it is a skip-scan.
+		 * than an automatic index or a hash join. Unless it is a
+		 * skip-scan.
 		 */
-		if ((p->wsFlags & WHERE_AUTO_INDEX) != 0
+		if ((p->wsFlags & (WHERE_AUTO_INDEX | WHERE_HASH_JOIN)) != 0
 		    && (pTemplate->nSkip) == 0
 		    && (pTemplate->wsFlags & WHERE_INDEXED) != 0
 		    && (pTemplate->wsFlags & WHERE_COLUMN_EQ) != 0
@@ -2690,6 +2738,41 @@ indexMightHelpWithOrderBy(WhereLoopBuilder * pBuilder,
 	return 0;
 }
 
+/**
+ * Check if a scan of the index @a idx_def of the source table
+ * @a src can read keys of the index only, without fetching full
+ * tuples from the primary index: the engine supports it, and all
+ * the columns of the table used by the query are parts of the
+ * index or of the primary key.
+ */
+static bool
+where_index_is_key_only(struct WhereInfo *winfo, struct SrcList_item *src,
+			struct index_def *idx_def)
+{
+	struct space *space = src->space;
+	if (idx_def->iid == 0 || idx_def->iid == UINT32_MAX ||
+	    (space->engine->flags & ENGINE_KEY_ITERATOR) == 0 ||
+	    space->def->opts.defer_deletes)
+		return false;
+	/* DML needs full tuples to delete or update them. */
+	if ((winfo->wctrlFlags & (WHERE_ONEPASS_DESIRED |
+				  WHERE_OR_SUBCLAUSE)) != 0)
+		return false;
+	struct key_def *cmp_def = idx_def->cmp_def;
+	if (cmp_def->is_multikey || cmp_def->for_func_index ||
+	    cmp_def->has_json_paths)
+		return false;
+	Bitmask used = src->colUsed;
+	if ((used & MASKBIT(BMS - 1)) != 0)
+		return false;
+	for (uint32_t i = 0; i < cmp_def->part_count; i++) {
+		uint32_t fieldno = cmp_def->parts[i].fieldno;
+		if (fieldno < BMS - 1)
+			used &= ~MASKBIT(fieldno);
+	}
+	return used == 0;
+}
+
 /*
  * Add all WhereLoop objects for a single table of the join where the table
  * is identified by pBuilder->pNew->iTab.
@@ -2863,6 +2946,56 @@ tnt_error:
 		}
 	}
 #endif				/* SQL_OMIT_AUTOMATIC_INDEX */
+	/*
+	 * Hash join loops. The table is loaded into a hash table
+	 * keyed by the column of an equality join term, then each
+	 * row of the outer loops probes it. It pays off only for
+	 * tables large enough for a repeated scan to be costly.
+	 */
+	rSize = sql_space_tuple_log_count(space);
+	if (pBuilder->pOrSet == NULL &&
+	    (pWInfo->wctrlFlags & (WHERE_OR_SUBCLAUSE |
+				   WHERE_ONEPASS_DESIRED)) == 0 &&
+	    pSrc->pIBIndex == NULL && !pSrc->fg.notIndexed &&
+	    !pSrc->fg.isCorrelated && !pSrc->fg.isRecursive &&
+	    space->def->id != 0 && !space->def->opts.is_view &&
+	    space->index_count > 0 && rSize >= HASH_JOIN_MIN_ROWS) {
+		WhereTerm *pTerm;
+		WhereTerm *pWCEnd = pWC->a + pWC->nTerm;
+		for (pTerm = pWC->a; rc == 0 && pTerm < pWCEnd; pTerm++) {
+			if (pTerm->prereqRight & pNew->maskSelf)
+				continue;
+			if (!term_can_drive_hash_join(pWInfo->pParse, pTerm,
+						      pSrc))
+				continue;
+			pNew->nEq = 1;
+			pNew->nBtm = 0;
+			pNew->nTop = 0;
+			pNew->nSkip = 0;
+			pNew->nLTerm = 1;
+			pNew->aLTerm[0] = pTerm;
+			pNew->iSortIdx = 0;
+			pNew->index_def = space->index[0]->def;
+			/* TUNING: Building the hash table costs a full
+			 * scan plus an insertion per row (N*4.0). It is
+			 * rebuilt each time the WHERE loop is run.
+			 */
+			pNew->rSetup = rSize + 20 + pWInfo->pParse->nQueryLoop;
+			/* TUNING: Each probe yields 10 rows and costs
+			 * twice the number of rows it visits.
+			 */
+			pNew->nOut = 33;
+			assert(33 == sqlLogEst(10));
+			pNew->rRun = pNew->nOut + 10;
+			pNew->wsFlags = WHERE_HASH_JOIN | WHERE_IDX_ONLY |
+					WHERE_INDEXED;
+			pNew->prereq = mPrereq | pTerm->prereqRight;
+			rc = whereLoopInsert(pBuilder, pNew);
+		}
+		assert(fake_index == NULL);
+		if (rc != 0)
+			return rc;
+	}
 	/*
 	 * If there was an INDEXED BY clause, then only that one
 	 * index is considered.
@@ -2911,8 +3044,15 @@ tnt_error:
 			 * In Tarantool we prefer perform full scan over pk instead
 			 * of secondary indexes, because secondary indexes
 			 * are not really store any data (only pointers to tuples).
+			 * The only exception is a scan of index keys
+			 * which doesn't look up tuples in pk: it reads
+			 * less data than a pk scan.
 			 */
 			int notPkPenalty = probe->iid == 0 ? 0 : 4;
+			if (where_index_is_key_only(pWInfo, pSrc, probe)) {
+				pNew->wsFlags |= WHERE_KEY_ONLY;
+				notPkPenalty = -1;
+			}
 			pNew->rRun = rSize + 16 + notPkPenalty;
 			whereLoopOutputAdjust(pWC, pNew, rSize);
 			rc = whereLoopInsert(pBuilder, pNew);
@@ -3261,6 +3401,7 @@ wherePathSatisfiesOrderBy(WhereInfo * pWInfo,	/* The WHERE clause */
 				idx_def = NULL;
 				nColumn = 1;
 			} else if ((idx_def = pLoop->index_def) == NULL ||
+				   (pLoop->wsFlags & WHERE_HASH_JOIN) != 0 ||
 				   (idx_def->opts.stat != NULL &&
 				    idx_def->opts.stat->is_unordered)) {
 				return 0;
@@ -3668,10 +3809,11 @@ wherePathSolver(WhereInfo * pWInfo, LogEst nRowEst)
 					continue;
 				if ((pWLoop->maskSelf & pFrom->maskLoop) != 0)
 					continue;
-				if ((pWLoop->wsFlags & WHERE_AUTO_INDEX) != 0
+				if ((pWLoop->wsFlags &
+				     (WHERE_AUTO_INDEX | WHERE_HASH_JOIN)) != 0
 				    && pFrom->nRow < 10) {
-					/* Do not use an automatic index if the this loop is expected
-					 * to run less than 2 times.
+					/* Do not use an automatic index or a hash join if
+					 * the this loop is expected to run less than 2 times.
 					 */
 					assert(10 == sqlLogEst(2));
 					continue;
@@ -4607,16 +4749,26 @@ sqlWhereBegin(Parse * pParse,	/* The parser context */
 				struct space *space = space_by_id(space_id);
 				vdbe_emit_open_cursor(pParse, iIndexCur,
 						      idx_def->iid, space);
+				uint16_t p5 = 0;
 				if ((pLoop->wsFlags & WHERE_CONSTRAINT) != 0
 				    && (pLoop->
 					wsFlags & (WHERE_COLUMN_RANGE |
 						   WHERE_SKIPSCAN)) == 0
 				    && (pWInfo->
 					wctrlFlags & WHERE_ORDERBY_MIN) == 0) {
-					sqlVdbeChangeP5(v, OPFLAG_SEEKEQ);	/* Hint to COMDB2 */
+					p5 |= OPFLAG_SEEKEQ;	/* Hint to COMDB2 */
 				}
+				if ((pLoop->wsFlags & WHERE_KEY_ONLY) != 0)
+					p5 |= OPFLAG_KEY_ONLY;
+				if (p5 != 0)
+					sqlVdbeChangeP5(v, p5);
 				VdbeComment((v, "%s", idx_def->name));
 			}
+			if ((pLoop->wsFlags & WHERE_HASH_JOIN) != 0) {
+				int fieldno = pLoop->aLTerm[0]->u.leftColumn;
+				sqlVdbeAddOp2(v, OP_HashBuild, iIndexCur,
+					      fieldno);
+			}
 		}
 	}
 	pWInfo->iTop = sqlVdbeCurrentAddr(v);
@@ -4794,11 +4946,27 @@ sqlWhereEnd(WhereInfo * pWInfo)
 			for (; k < last; k++, pOp++) {
 				if (pOp->p1 != pLevel->iTabCur)
 					continue;
-				if (pOp->opcode == OP_Column) {
+				if (pOp->opcode == OP_Column ||
+				    pOp->opcode == OP_ColumnCompare) {
 					int x = pOp->p2;
 					assert(def == NULL ||
 					       def->space_id ==
 					       pTabItem->space->def->id);
+					/*
+					 * Keys are read instead of
+					 * tuples, so columns are
+					 * numbered by key parts.
+					 */
+					if ((pLoop->wsFlags &
+					     WHERE_KEY_ONLY) != 0) {
+						struct key_def *cmp_def =
+							def->cmp_def;
+						const struct key_part *part =
+							key_def_find_by_fieldno(
+								cmp_def, x);
+						assert(part != NULL);
+						x = part - cmp_def->parts;
+					}
 					if (x >= 0) {
 						pOp->p2 = x;
 						pOp->p1 = pLevel->iIdxCur;
@@ -521,3 +521,5 @@ void sqlWhereTabFuncArgs(Parse *, struct SrcList_item *, WhereClause *);
 #define WHERE_AUTO_INDEX   0x00004000	/* Uses an ephemeral index */
 #define WHERE_SKIPSCAN     0x00008000	/* Uses the skip-scan algorithm */
 #define WHERE_UNQ_WANTED   0x00010000	/* WHERE_ONEROW would have been helpful */
+#define WHERE_HASH_JOIN    0x00020000	/* Probes a hash table of the table */
+#define WHERE_KEY_ONLY     0x00040000	/* Reads index keys, not tuples */
@@ -211,7 +211,11 @@ sqlWhereExplainOneScan(Parse * pParse,	/* Parse context */
 		if (pItem->zAlias) {
 			sqlXPrintf(&str, " AS %s", pItem->zAlias);
 		}
-		if ((flags & WHERE_IPK) == 0) {
+		if ((flags & WHERE_HASH_JOIN) != 0) {
+			int fieldno = pLoop->aLTerm[0]->u.leftColumn;
+			sqlXPrintf(&str, " USING HASH JOIN (%s=?)",
+				   pItem->space->def->fields[fieldno].name);
+		} else if ((flags & WHERE_IPK) == 0) {
 			const char *zFmt = 0;
 			struct index_def *idx_def = pLoop->index_def;
 			if (idx_def == NULL)
@@ -225,6 +229,8 @@ sqlWhereExplainOneScan(Parse * pParse,	/* Parse context */
 				}
 			} else if (flags & WHERE_AUTO_INDEX) {
 				zFmt = "AUTOMATIC COVERING INDEX";
+			} else if (flags & WHERE_KEY_ONLY) {
+				zFmt = "COVERING INDEX KEYS %s";
 			} else if (flags & WHERE_IDX_ONLY) {
 				zFmt = "COVERING INDEX %s";
 			} else {
@@ -685,8 +691,10 @@ codeAllEqualityTerms(Parse * pParse,	/* Parsing context */
 		VdbeCoverageIf(v, bRev == 0);
 		VdbeCoverageIf(v, bRev != 0);
 		sqlVdbeJumpHere(v, j);
+		bool is_key_only = (pLoop->wsFlags & WHERE_KEY_ONLY) != 0;
 		for (j = 0; j < nSkip; j++) {
 			sqlVdbeAddOp3(v, OP_Column, iIdxCur,
+					  is_key_only ? j :
 					  idx_def->key_def->parts[j].fieldno,
 					  regBase + j);
 			VdbeComment((v, "%s", explainIndexColumnName(idx_def, j)));
@@ -770,6 +778,128 @@ codeExprOrVector(Parse * pParse, Expr * p, int iReg, int nReg)
 	}
 }
 
+/** Maximal number of conditions checked by a cursor filter. */
+enum { CURSOR_FILTER_ITEM_MAX = 8 };
+
+/**
+ * Return true if the term is a condition on a column of the
+ * table opened by @a cursor which can be checked by
+ * OP_CursorFilter: a comparison of the column with a literal or
+ * a parameter, or IS [NOT] NULL.
+ */
+static bool
+term_is_cursor_filter(struct WhereInfo *winfo, struct WhereTerm *term,
+		      int cursor)
+{
+	if ((term->wtFlags & (TERM_CODED | TERM_VNULL | TERM_LIKEOPT |
+			      TERM_LIKECOND | TERM_LIKE)) != 0)
+		return false;
+	if ((term->prereqAll &
+	     ~sqlWhereGetMask(&winfo->sMaskSet, cursor)) != 0)
+		return false;
+	struct Expr *expr = term->pExpr;
+	/* ON terms of a LEFT JOIN don't filter the left table. */
+	if (ExprHasProperty(expr, EP_FromJoin))
+		return false;
+	switch (expr->op) {
+	case TK_ISNULL:
+	case TK_NOTNULL:
+		break;
+	case TK_EQ:
+	case TK_LT:
+	case TK_LE:
+	case TK_GT:
+	case TK_GE: {
+		struct Expr *rhs = expr->pRight;
+		if (rhs->op == TK_UMINUS &&
+		    (rhs->pLeft->op == TK_INTEGER ||
+		     rhs->pLeft->op == TK_FLOAT))
+			break;
+		if (rhs->op != TK_INTEGER && rhs->op != TK_FLOAT &&
+		    rhs->op != TK_STRING && rhs->op != TK_VARIABLE)
+			return false;
+		break;
+	}
+	default:
+		return false;
+	}
+	struct Expr *lhs = expr->pLeft;
+	return lhs->op == TK_COLUMN && lhs->iTable == cursor &&
+	       lhs->iColumn >= 0;
+}
+
+/**
+ * Generate OP_CursorFilter to make the following seek of
+ * @a cursor skip tuples which don't match simple conditions of
+ * the WHERE clause on the columns of the loop table, so that
+ * they never get into registers. The terms are not disabled and
+ * are checked by the loop as usual.
+ *
+ * The caller must make sure that the loop is terminated by the
+ * end of the iterator only: otherwise the cursor could skip
+ * tuples past the end of the range looking for a matching one.
+ */
+static void
+code_cursor_filter(struct WhereInfo *winfo, struct WhereLevel *level,
+		   int cursor)
+{
+	struct Parse *parse = winfo->pParse;
+	struct Vdbe *v = parse->pVdbe;
+	struct WhereClause *wc = &winfo->sWC;
+	struct SrcList_item *src = &winfo->pTabList->a[level->iFrom];
+	/*
+	 * Rows of the right table of a LEFT JOIN not matching
+	 * WHERE must produce a row of NULLs first.
+	 */
+	if (level->iLeftJoin != 0 || src->pSelect != NULL ||
+	    (winfo->wctrlFlags & WHERE_OR_SUBCLAUSE) != 0)
+		return;
+	struct WhereTerm *terms[CURSOR_FILTER_ITEM_MAX];
+	uint32_t count = 0;
+	struct WhereTerm *term = wc->a;
+	for (int i = 0; i < wc->nTerm && count < CURSOR_FILTER_ITEM_MAX;
+	     i++, term++) {
+		if (term_is_cursor_filter(winfo, term, src->iCursor))
+			terms[count++] = term;
+	}
+	if (count == 0)
+		return;
+	struct sql_cursor_filter *filter =
+		sqlDbMallocZero(parse->db, sizeof(*filter) +
+				count * sizeof(filter->items[0]));
+	if (filter == NULL)
+		return;
+	filter->item_count = count;
+	/* A cursor reading index keys numbers fields by key parts. */
+	struct key_def *cmp_def = NULL;
+	if ((level->pWLoop->wsFlags & WHERE_KEY_ONLY) != 0)
+		cmp_def = level->pWLoop->index_def->cmp_def;
+	int reg = parse->nMem + 1;
+	parse->nMem += count;
+	for (uint32_t i = 0; i < count; i++) {
+		struct Expr *expr = terms[i]->pExpr;
+		struct Expr *column = expr->pLeft;
+		struct sql_cursor_filter_item *item = &filter->items[i];
+		item->fieldno = column->iColumn;
+		if (cmp_def != NULL) {
+			const struct key_part *part =
+				key_def_find_by_fieldno(cmp_def, item->fieldno);
+			assert(part != NULL);
+			item->fieldno = part - cmp_def->parts;
+		}
+		item->op = expr->op;
+		item->is_binary =
+			column->space_def->fields[column->iColumn].coll_id ==
+			COLL_NONE;
+		if (expr->pRight != NULL)
+			sqlExprCode(parse, expr->pRight, reg + i);
+		else
+			sqlVdbeAddOp2(v, OP_Null, 0, reg + i);
+	}
+	sqlVdbeAddOp4(v, OP_CursorFilter, cursor, reg, count, (char *)filter,
+		      P4_CURSOR_FILTER);
+}
+
 /*
  * Generate code for the start of the iLevel-th loop in the WHERE clause
  * implementation described by pWInfo.
@@ -843,6 +973,28 @@ sqlWhereCodeOneLoopStart(WhereInfo * pWInfo,	/* Complete information about the W
 		VdbeCoverage(v);
 		VdbeComment((v, "next row of \"%s\"", pTabItem->space->def->name));
 		pLevel->op = OP_Goto;
+	} else if (pLoop->wsFlags & WHERE_HASH_JOIN) {
+		/* Case 3: A hash join.
+		 *
+		 *         sqlWhereBegin() has loaded the table into a
+		 *         hash table keyed by the column of an equality
+		 *         term. Evaluate the other side of the term and
+		 *         visit the tuples having the same key. The term
+		 *         is not disabled, so it is checked for each of
+		 *         them as any other term.
+		 */
+		int iIdxCur = pLevel->iIdxCur;
+		int reg_free;
+		pTerm = pLoop->aLTerm[0];
+		assert((pTerm->eOperator & WO_EQ) != 0);
+		int reg_key = sqlExprCodeTemp(pParse, pTerm->pExpr->pRight,
+					      &reg_free);
+		sqlVdbeAddOp3(v, OP_HashSeek, iIdxCur, addrBrk, reg_key);
+		VdbeCoverage(v);
+		sqlReleaseTempReg(pParse, reg_free);
+		pLevel->op = OP_HashNext;
+		pLevel->p1 = iIdxCur;
+		pLevel->p2 = sqlVdbeCurrentAddr(v);
 	} else if (pLoop->wsFlags & WHERE_INDEXED) {
 		/* Case 4: A scan using an index.
 		 *
@@ -1150,6 +1302,8 @@ sqlWhereCodeOneLoopStart(WhereInfo * pWInfo,	/* Complete information about the W
 				if (seek_addrs[i] != 0)
 					sqlVdbeJumpHere(v, seek_addrs[i]);
 			}
+			if (nEq == 0 && pRangeEnd == NULL && !bStopAtNull)
+				code_cursor_filter(pWInfo, pLevel, iIdxCur);
 			sqlVdbeAddOp4Int(v, op, iIdxCur, addrNxt, regBase,
 					     nConstraint);
 			/* If this is Seek* opcode, and IPK is detected in the
@@ -1573,6 +1727,7 @@ sqlWhereCodeOneLoopStart(WhereInfo * pWInfo,	/* Complete information about the W
 			 */
 			pLevel->op = OP_Noop;
 		} else {
+			code_cursor_filter(pWInfo, pLevel, iCur);
 			pLevel->op = aStep[bRev];
 			pLevel->p1 = iCur;
 			pLevel->p2 =
@@ -47,6 +47,13 @@ sql_stmt_cache_init(void)
 	sql_stmt_cache.mem_quota = 0;
 	sql_stmt_cache.mem_used = 0;
 	rlist_create(&sql_stmt_cache.gc_queue);
+	sql_stmt_cache.plan_hash = mh_i32ptr_new();
+	if (sql_stmt_cache.plan_hash == NULL)
+		panic("out of memory");
+	sql_stmt_cache.plan_mem_used = 0;
+	rlist_create(&sql_stmt_cache.plan_lru);
+	sql_stmt_cache.plan_hits = 0;
+	sql_stmt_cache.plan_misses = 0;
 }
 
 void
@@ -61,6 +68,12 @@ sql_stmt_cache_stat(struct info_handler *h)
 		entry_count++;
 	info_append_int(h, "stmt_count", entry_count);
 	info_table_end(h);
+	info_table_begin(h, "plan_cache");
+	info_append_int(h, "size", sql_stmt_cache.plan_mem_used);
+	info_append_int(h, "plan_count", mh_size(sql_stmt_cache.plan_hash));
+	info_append_int(h, "hits", sql_stmt_cache.plan_hits);
+	info_append_int(h, "misses", sql_stmt_cache.plan_misses);
+	info_table_end(h);
 	info_end(h);
 }
 
@@ -153,7 +166,51 @@ sql_cache_entry_new(struct sql_stmt *stmt)
 static bool
 sql_cache_check_new_entry_size(size_t size)
 {
-	return (sql_stmt_cache.mem_used + size <= sql_stmt_cache.mem_quota);
+	return (sql_stmt_cache.mem_used + sql_stmt_cache.plan_mem_used +
+		size <= sql_stmt_cache.mem_quota);
+}
+
+static size_t
+sql_plan_entry_sizeof(struct sql_stmt *stmt)
+{
+	return sql_stmt_est_size(stmt) + sizeof(struct plan_cache_entry);
+}
+
+/**
+ * Remove plan entry from hash and LRU list, account cache size
+ * changes, then release occupied memory.
+ */
+static void
+sql_plan_cache_delete(struct plan_cache_entry *entry)
+{
+	struct sql_stmt_cache *cache = &sql_stmt_cache;
+	assert(! sql_stmt_busy(entry->stmt));
+	mh_int_t i = mh_i32ptr_find(cache->plan_hash, entry->key, NULL);
+	assert(i != mh_end(cache->plan_hash));
+	mh_i32ptr_del(cache->plan_hash, i, NULL);
+	rlist_del(&entry->in_lru);
+	cache->plan_mem_used -= sql_plan_entry_sizeof(entry->stmt);
+	sql_stmt_finalize(entry->stmt);
+	TRASH(entry);
+	free(entry);
+}
+
+/**
+ * Evict the least recently used plans, which are not being
+ * executed right now, until an entry of @a size fits into the
+ * memory limit.
+ */
+static void
+sql_plan_cache_evict(size_t size)
+{
+	struct plan_cache_entry *entry, *next;
+	rlist_foreach_entry_safe(entry, &sql_stmt_cache.plan_lru, in_lru,
+				 next) {
+		if (sql_cache_check_new_entry_size(size))
+			break;
+		if (! sql_stmt_busy(entry->stmt))
+			sql_plan_cache_delete(entry);
+	}
 }
 
 static void
@@ -245,6 +302,8 @@ sql_stmt_cache_insert(struct sql_stmt *stmt)
 
 	if (! sql_cache_check_new_entry_size(new_entry_size))
 		sql_stmt_cache_gc();
+	if (! sql_cache_check_new_entry_size(new_entry_size))
+		sql_plan_cache_evict(new_entry_size);
 	/*
 	 * Test memory limit again. Raise an error if it is
 	 * still overcrowded.
@@ -296,5 +355,73 @@ sql_stmt_cache_set_size(size_t size)
 		return -1;
 	}
 	sql_stmt_cache.mem_quota = size;
+	sql_plan_cache_evict(0);
 	return 0;
 }
+
+/** Plan hash key of normalized text @a sql. */
+static uint32_t
+sql_plan_cache_key(const char *sql, uint32_t len, uint32_t sql_flags)
+{
+	return mh_strn_hash(sql, len) ^ sql_flags;
+}
+
+struct sql_stmt *
+sql_plan_cache_find(const char *sql, uint32_t len, uint32_t sql_flags)
+{
+	struct sql_stmt_cache *cache = &sql_stmt_cache;
+	uint32_t key = sql_plan_cache_key(sql, len, sql_flags);
+	mh_int_t i = mh_i32ptr_find(cache->plan_hash, key, NULL);
+	if (i != mh_end(cache->plan_hash)) {
+		struct plan_cache_entry *entry =
+			mh_i32ptr_node(cache->plan_hash, i)->val;
+		const char *entry_sql = sql_stmt_query_str(entry->stmt);
+		if (entry->sql_flags == sql_flags &&
+		    strncmp(entry_sql, sql, len) == 0 &&
+		    entry_sql[len] == '\0') {
+			cache->plan_hits++;
+			rlist_move_tail_entry(&cache->plan_lru, entry, in_lru);
+			return entry->stmt;
+		}
+	}
+	cache->plan_misses++;
+	return NULL;
+}
+
+bool
+sql_plan_cache_insert(struct sql_stmt *stmt, uint32_t sql_flags)
+{
+	assert(stmt != NULL);
+	struct sql_stmt_cache *cache = &sql_stmt_cache;
+	const char *sql_str = sql_stmt_query_str(stmt);
+	uint32_t key = sql_plan_cache_key(sql_str, strlen(sql_str),
+					  sql_flags);
+	mh_int_t i = mh_i32ptr_find(cache->plan_hash, key, NULL);
+	if (i != mh_end(cache->plan_hash)) {
+		struct plan_cache_entry *old =
+			mh_i32ptr_node(cache->plan_hash, i)->val;
+		if (sql_stmt_busy(old->stmt))
+			return false;
+		sql_plan_cache_delete(old);
+	}
+	size_t new_entry_size = sql_plan_entry_sizeof(stmt);
+	if (! sql_cache_check_new_entry_size(new_entry_size))
+		sql_plan_cache_evict(new_entry_size);
+	if (! sql_cache_check_new_entry_size(new_entry_size))
+		return false;
+	struct plan_cache_entry *entry = malloc(sizeof(*entry));
+	if (entry == NULL)
+		return false;
+	entry->stmt = stmt;
+	entry->sql_flags = sql_flags;
+	entry->key = key;
+	const struct mh_i32ptr_node_t node = { key, entry };
+	if (mh_i32ptr_put(cache->plan_hash, &node, NULL, NULL) ==
+	    mh_end(cache->plan_hash)) {
+		free(entry);
+		return false;
+	}
+	rlist_add_tail_entry(&cache->plan_lru, entry, in_lru);
+	cache->plan_mem_used += new_entry_size;
+	return true;
+}
@@ -30,6 +30,7 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -58,6 +59,21 @@ struct stmt_cache_entry {
 	uint32_t refs;
 };
 
+/**
+ * Plan compiled from the text of a statement with literals
+ * replaced by parameters, see sql_normalize().
+ */
+struct plan_cache_entry {
+	/** Statement compiled from the normalized text. */
+	struct sql_stmt *stmt;
+	/** Session SQL flags the statement was compiled with. */
+	uint32_t sql_flags;
+	/** Key of the entry in the plan hash. */
+	uint32_t key;
+	/** Link in the LRU list of plans. */
+	struct rlist in_lru;
+};
+
 /**
  * Global prepared statements holder.
  */
@@ -82,6 +98,20 @@ struct sql_stmt_cache {
 	 * times.
 	 */
 	struct stmt_cache_entry *last_found;
+	/**
+	 * Size of memory occupied by cached plans. Plans share
+	 * the memory limit with prepared statements, but are
+	 * evicted when the memory is needed.
+	 */
+	size_t plan_mem_used;
+	/** Normalized text hash -> struct plan_cache_entry. */
+	struct mh_i32ptr_t *plan_hash;
+	/** Cached plans, the least recently used first. */
+	struct rlist plan_lru;
+	/** Number of plan lookups which found a plan. */
+	uint64_t plan_hits;
+	/** Number of plan lookups which didn't find a plan. */
+	uint64_t plan_misses;
 };
 
 /**
@@ -93,7 +123,8 @@ sql_stmt_cache_init(void);
 
 /**
  * Store statistics concerning cache (current size and number
- * of statements in it) into info handler @h.
+ * of statements in it) and plan cache (the same and its hit
+ * and miss counters) into info handler @h.
  */
 void
 sql_stmt_cache_stat(struct info_handler *h);
@@ -142,6 +173,26 @@ struct sql_stmt *
 sql_stmt_cache_find(uint32_t stmt_id);
 
 
+/**
+ * Find a plan compiled from normalized text @a sql with session
+ * SQL flags @a sql_flags and mark it as the most recently used.
+ * In case of search fails it returns NULL.
+ */
+struct sql_stmt *
+sql_plan_cache_find(const char *sql, uint32_t len, uint32_t sql_flags);
+
+/**
+ * Save a plan compiled from normalized text with session SQL
+ * flags @a sql_flags to the plan cache, replacing a plan with
+ * the same key unless it is being executed. The least recently
+ * used plans are evicted if the memory limit is reached.
+ *
+ * @retval true The plan is cached and owned by the cache.
+ * @retval false The plan can't be cached.
+ */
+bool
+sql_plan_cache_insert(struct sql_stmt *stmt, uint32_t sql_flags);
+
 /** Set prepared cache size limit. */
 int
 sql_stmt_cache_set_size(size_t size);
@@ -192,9 +192,15 @@ static const struct index_vtab sysview_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .estimate_eq = */ generic_index_estimate_eq,
+	/* .split = */ generic_index_split,
 	/* .get = */ sysview_index_get,
+	/* .get_batch = */ generic_index_get_batch,
 	/* .replace = */ generic_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
 	/* .create_iterator = */ sysview_index_create_iterator,
+	/* .create_key_iterator = */
+		generic_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		generic_index_create_snapshot_iterator,
 	/* .stat = */ generic_index_stat,
@@ -490,10 +496,12 @@ sysview_space_create_index(struct space *space, struct index_def *def)
 static const struct space_vtab sysview_space_vtab = {
 	/* .destroy = */ sysview_space_destroy,
 	/* .bsize = */ generic_space_bsize,
+	/* .tuple_mem = */ generic_space_tuple_mem,
 	/* .execute_replace = */ sysview_space_execute_replace,
 	/* .execute_delete = */ sysview_space_execute_delete,
 	/* .execute_update = */ sysview_space_execute_update,
 	/* .execute_upsert = */ sysview_space_execute_upsert,
+	/* .execute_delete_range = */ generic_space_execute_delete_range,
 	/* .ephemeral_replace = */ generic_space_ephemeral_replace,
 	/* .ephemeral_delete = */ generic_space_ephemeral_delete,
 	/* .ephemeral_rowid_next = */ generic_space_ephemeral_rowid_next,
@@ -546,7 +554,7 @@ sysview_engine_create_space(struct engine *engine, struct space_def *def,
 		tuple_format_new(NULL, NULL, keys, key_count, def->fields,
 				 def->field_count, def->exact_field_count,
 				 def->dict, def->opts.is_temporary,
-				 def->opts.is_ephemeral);
+				 def->opts.is_ephemeral, true);
 	if (format == NULL) {
 		free(space);
 		return NULL;
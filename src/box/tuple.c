@@ -115,6 +115,22 @@ end:
 	return tuple;
 }
 
+static int
+runtime_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	(void)stats;
+	(void)cb_ctx;
+	return 0;
+}
+
+size_t
+tuple_runtime_mem_used(void)
+{
+	struct small_stats totals;
+	small_stats(&runtime_alloc, &totals, runtime_stats_noop_cb, NULL);
+	return totals.used;
+}
+
 static void
 runtime_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 {
@@ -187,7 +203,15 @@ enum {
 	 * Only 15 bits are available for bigref list index in
 	 * struct tuple.
 	 */
-	BIGREF_MAX_CAPACITY = UINT16_MAX >> 1
+	BIGREF_MAX_CAPACITY = UINT16_MAX >> 1,
+	/**
+	 * A big reference counter is released only when it drops
+	 * to this value, not to TUPLE_REF_MAX, so that a tuple
+	 * whose counter hovers around TUPLE_REF_MAX doesn't take
+	 * and release a big reference counter on every other
+	 * reference.
+	 */
+	BIGREF_RELEASE_THRESHOLD = TUPLE_REF_MAX / 2,
 };
 
 /**
@@ -197,9 +221,8 @@ enum {
  * more than 32767, field refs of this tuple becomes index of big
  * reference counter in big reference counter array and field
  * is_bigref is set true. The moment big reference becomes equal
- * 32767 it is set to 0, refs of the tuple becomes 32767 and
- * is_bigref becomes false. Big reference counter can be equal to
- * 0 or be more than 32767.
+ * to BIGREF_RELEASE_THRESHOLD it is released, refs of the tuple
+ * becomes BIGREF_RELEASE_THRESHOLD and is_bigref becomes false.
  */
 static struct bigref_list {
 	/** Free-list of big reference counters. */
@@ -283,11 +306,12 @@ void
 tuple_unref_slow(struct tuple *tuple)
 {
 	assert(tuple->is_bigref &&
-	       bigref_list.refs[tuple->ref_index] > TUPLE_REF_MAX);
-	if(--bigref_list.refs[tuple->ref_index] == TUPLE_REF_MAX) {
+	       bigref_list.refs[tuple->ref_index] > BIGREF_RELEASE_THRESHOLD);
+	if (--bigref_list.refs[tuple->ref_index] ==
+	    BIGREF_RELEASE_THRESHOLD) {
 		bigref_list.refs[tuple->ref_index] = bigref_list.vacant_index;
 		bigref_list.vacant_index = tuple->ref_index;
-		tuple->ref_index = TUPLE_REF_MAX;
+		tuple->ref_index = BIGREF_RELEASE_THRESHOLD;
 		tuple->is_bigref = false;
 	}
 }
@@ -306,7 +330,7 @@ tuple_init(field_name_hash_f hash)
 	 */
 	tuple_format_runtime = tuple_format_new(&tuple_format_runtime_vtab, NULL,
 						NULL, 0, NULL, 0, 0, NULL, false,
-						false);
+						false, true);
 	if (tuple_format_runtime == NULL)
 		return -1;
 
@@ -574,7 +598,7 @@ box_tuple_format_new(struct key_def **keys, uint16_t key_count)
 	box_tuple_format_t *format =
 		tuple_format_new(&tuple_format_runtime_vtab, NULL,
 				 keys, key_count, NULL, 0, 0, NULL, false,
-				 false);
+				 false, true);
 	if (format != NULL)
 		tuple_format_ref(format);
 	return format;
@@ -641,6 +665,20 @@ box_tuple_field(box_tuple_t *tuple, uint32_t fieldno)
 	return tuple_field(tuple, fieldno);
 }
 
+const char *
+box_tuple_field_by_path(box_tuple_t *tuple, const char *path,
+			uint32_t path_len)
+{
+	assert(tuple != NULL);
+	if (path_len == 0)
+		return NULL;
+	return tuple_field_raw_by_full_path(tuple_format(tuple),
+					    tuple_data(tuple),
+					    tuple_field_map(tuple),
+					    path, path_len,
+					    field_name_hash(path, path_len));
+}
+
 typedef struct tuple_iterator box_tuple_iterator_t;
 
 box_tuple_iterator_t *
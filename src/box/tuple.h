@@ -60,6 +60,14 @@ tuple_init(field_name_hash_f hash);
 void
 tuple_free(void);
 
+/**
+ * Return the memory used by runtime tuples, i.e. tuples that
+ * don't belong to any engine, like ones created by
+ * box.tuple.new().
+ */
+size_t
+tuple_runtime_mem_used(void);
+
 /**
  * Initialize tuples arena.
  * @param arena[out] Arena to initialize.
@@ -631,7 +639,8 @@ tuple_field_raw_by_path(struct tuple_format *format, const char *tuple,
 offset_slot_access:
 		/* Indexed field */
 		offset = field_map_get_offset(field_map, offset_slot,
-					      multikey_idx);
+					      multikey_idx,
+					      format->is_field_map_compact);
 		if (offset == 0)
 			return NULL;
 		tuple += offset;
@@ -706,6 +715,20 @@ tuple_field_raw_by_full_path(struct tuple_format *format, const char *tuple,
 			     const uint32_t *field_map, const char *path,
 			     uint32_t path_len, uint32_t path_hash);
 
+/**
+ * Get a tuple field by a field name or a full JSON path.
+ * This is what tuple['path'] does in Lua; it is called via
+ * FFI so that field access doesn't abort JIT traces.
+ * @param tuple Tuple to get the field from.
+ * @param path Field name or full JSON path to the field.
+ * @param path_len Length of @a path.
+ *
+ * @retval field data if field exists or NULL
+ */
+const char *
+box_tuple_field_by_path(box_tuple_t *tuple, const char *path,
+			uint32_t path_len);
+
 /**
  * Get a tuple field pointed to by an index part and multikey
  * index hint.
@@ -42,11 +42,14 @@
 #include "key_def.h"
 #include "tuple.h"
 #include "salad/bloom.h"
+#include "salad/xor_filter.h"
 #include "trivia/util.h"
 #include "third_party/PMurHash.h"
 
 enum { HASH_SEED = 13U };
 
+const char *tuple_bloom_type_strs[] = { "bloom", "xor" };
+
 struct tuple_bloom_builder *
 tuple_bloom_builder_new(uint32_t part_count)
 {
@@ -70,6 +73,13 @@ tuple_bloom_builder_delete(struct tuple_bloom_builder *builder)
 	free(builder);
 }
 
+void
+tuple_bloom_builder_reset(struct tuple_bloom_builder *builder)
+{
+	for (uint32_t i = 0; i < builder->part_count; i++)
+		builder->parts[i].count = 0;
+}
+
 /**
  * Add a tuple hash to a hash array unless it's already there.
  * Reallocate the array if necessary.
@@ -103,19 +113,49 @@ tuple_hash_array_add(struct tuple_hash_array *hash_arr, uint32_t hash)
 	return 0;
 }
 
+int
+tuple_bloom_builder_merge(struct tuple_bloom_builder *builder,
+			  const struct tuple_bloom_builder *src)
+{
+	assert(builder->part_count == src->part_count);
+	for (uint32_t i = 0; i < builder->part_count; i++) {
+		struct tuple_hash_array *hash_arr = &builder->parts[i];
+		const struct tuple_hash_array *src_arr = &src->parts[i];
+		uint32_t count = hash_arr->count + src_arr->count;
+		if (count > hash_arr->capacity) {
+			uint32_t *values = realloc(hash_arr->values,
+						   count * sizeof(*values));
+			if (values == NULL) {
+				diag_set(OutOfMemory, count * sizeof(*values),
+					 "malloc", "tuple hash array");
+				return -1;
+			}
+			hash_arr->capacity = count;
+			hash_arr->values = values;
+		}
+		if (src_arr->count > 0) {
+			memcpy(hash_arr->values + hash_arr->count,
+			       src_arr->values,
+			       src_arr->count * sizeof(*src_arr->values));
+		}
+		hash_arr->count = count;
+	}
+	return 0;
+}
+
 int
 tuple_bloom_builder_add(struct tuple_bloom_builder *builder,
 			struct tuple *tuple, struct key_def *key_def,
 			int multikey_idx)
 {
-	assert(builder->part_count == key_def->part_count);
+	assert(builder->part_count <= key_def->part_count);
 	assert(!key_def->is_multikey || multikey_idx != MULTIKEY_NONE);
 
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
 
-	for (uint32_t i = 0; i < key_def->part_count; i++) {
+	for (uint32_t i = 0; i < builder->part_count; i++) {
 		total_size += tuple_hash_key_part(&h, &carry, tuple,
 						  &key_def->parts[i],
 						  multikey_idx);
@@ -133,13 +173,13 @@ tuple_bloom_builder_add_key(struct tuple_bloom_builder *builder,
 {
 	(void)part_count;
 	assert(part_count >= key_def->part_count);
-	assert(builder->part_count == key_def->part_count);
+	assert(builder->part_count <= key_def->part_count);
 
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
 
-	for (uint32_t i = 0; i < key_def->part_count; i++) {
+	for (uint32_t i = 0; i < builder->part_count; i++) {
 		total_size += tuple_hash_field(&h, &carry, &key,
 					       key_def->parts[i].coll);
 		uint32_t hash = PMurHash32_Result(h, carry, total_size);
@@ -149,12 +189,84 @@ tuple_bloom_builder_add_key(struct tuple_bloom_builder *builder,
 	return 0;
 }
 
+/** Return the false positive rate of a partial key filter. */
+static double
+tuple_bloom_part_fpr(const struct tuple_bloom *bloom,
+		     const union tuple_bloom_part *part, uint32_t count)
+{
+	switch (bloom->type) {
+	case TUPLE_BLOOM_BLOOM:
+		return bloom_fpr(&part->bloom, count);
+	case TUPLE_BLOOM_XOR:
+		return xor_filter_fpr(&part->xor_filter);
+	default:
+		unreachable();
+	}
+	return 1;
+}
+
+/** Build a partial key filter from an array of hashes. */
+static int
+tuple_bloom_part_create(const struct tuple_bloom *bloom,
+			union tuple_bloom_part *part,
+			const struct tuple_hash_array *hash_arr, double fpr)
+{
+	switch (bloom->type) {
+	case TUPLE_BLOOM_BLOOM:
+		if (bloom_create(&part->bloom, hash_arr->count, fpr) != 0) {
+			diag_set(OutOfMemory, 0, "bloom_create",
+				 "tuple bloom part");
+			return -1;
+		}
+		for (uint32_t k = 0; k < hash_arr->count; k++)
+			bloom_add(&part->bloom, hash_arr->values[k]);
+		return 0;
+	case TUPLE_BLOOM_XOR:
+		if (xor_filter_create(&part->xor_filter, hash_arr->values,
+				      hash_arr->count, fpr) != 0) {
+			diag_set(OutOfMemory, 0, "xor_filter_create",
+				 "tuple bloom part");
+			return -1;
+		}
+		return 0;
+	default:
+		unreachable();
+	}
+	return -1;
+}
+
+static void
+tuple_bloom_part_destroy(const struct tuple_bloom *bloom,
+			 union tuple_bloom_part *part)
+{
+	switch (bloom->type) {
+	case TUPLE_BLOOM_BLOOM:
+		bloom_destroy(&part->bloom);
+		break;
+	case TUPLE_BLOOM_XOR:
+		xor_filter_destroy(&part->xor_filter);
+		break;
+	default:
+		unreachable();
+	}
+}
+
+static inline bool
+tuple_bloom_part_maybe_has(const struct tuple_bloom *bloom,
+			   const union tuple_bloom_part *part, uint32_t hash)
+{
+	if (bloom->type == TUPLE_BLOOM_XOR)
+		return xor_filter_maybe_has(&part->xor_filter, hash);
+	return bloom_maybe_has(&part->bloom, hash);
+}
+
 struct tuple_bloom *
-tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr)
+tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr,
+		enum tuple_bloom_type type)
 {
 	uint32_t part_count = builder->part_count;
 	size_t size = sizeof(struct tuple_bloom) +
-			part_count * sizeof(struct bloom);
+			part_count * sizeof(union tuple_bloom_part);
 	struct tuple_bloom *bloom = malloc(size);
 	if (bloom == NULL) {
 		diag_set(OutOfMemory, size, "malloc", "tuple bloom");
@@ -162,6 +274,7 @@ tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr)
 	}
 
 	bloom->is_legacy = false;
+	bloom->type = type;
 	bloom->part_count = 0;
 
 	for (uint32_t i = 0; i < part_count; i++) {
@@ -177,17 +290,16 @@ tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr)
 		 */
 		double part_fpr = fpr;
 		for (uint32_t j = 0; j < i; j++)
-			part_fpr /= bloom_fpr(&bloom->parts[j], count);
+			part_fpr /= tuple_bloom_part_fpr(bloom,
+							 &bloom->parts[j],
+							 count);
 		part_fpr = MIN(part_fpr, 0.5);
-		if (bloom_create(&bloom->parts[i], count, part_fpr) != 0) {
-			diag_set(OutOfMemory, 0, "bloom_create",
-				 "tuple bloom part");
+		if (tuple_bloom_part_create(bloom, &bloom->parts[i],
+					    hash_arr, part_fpr) != 0) {
 			tuple_bloom_delete(bloom);
 			return NULL;
 		}
 		bloom->part_count++;
-		for (uint32_t k = 0; k < count; k++)
-			bloom_add(&bloom->parts[i], hash_arr->values[k]);
 	}
 	return bloom;
 }
@@ -196,7 +308,7 @@ void
 tuple_bloom_delete(struct tuple_bloom *bloom)
 {
 	for (uint32_t i = 0; i < bloom->part_count; i++)
-		bloom_destroy(&bloom->parts[i]);
+		tuple_bloom_part_destroy(bloom, &bloom->parts[i]);
 	free(bloom);
 }
 
@@ -207,22 +319,23 @@ tuple_bloom_maybe_has(const struct tuple_bloom *bloom, struct tuple *tuple,
 	assert(!key_def->is_multikey || multikey_idx != MULTIKEY_NONE);
 
 	if (bloom->is_legacy) {
-		return bloom_maybe_has(&bloom->parts[0],
+		return bloom_maybe_has(&bloom->parts[0].bloom,
 				       tuple_hash(tuple, key_def));
 	}
 
-	assert(bloom->part_count == key_def->part_count);
+	assert(bloom->part_count <= key_def->part_count);
 
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
 
-	for (uint32_t i = 0; i < key_def->part_count; i++) {
+	for (uint32_t i = 0; i < bloom->part_count; i++) {
 		total_size += tuple_hash_key_part(&h, &carry, tuple,
 						  &key_def->parts[i],
 						  multikey_idx);
 		uint32_t hash = PMurHash32_Result(h, carry, total_size);
-		if (!bloom_maybe_has(&bloom->parts[i], hash))
+		if (!tuple_bloom_part_maybe_has(bloom, &bloom->parts[i],
+						hash))
 			return false;
 	}
 	return true;
@@ -236,12 +349,13 @@ tuple_bloom_maybe_has_key(const struct tuple_bloom *bloom,
 	if (bloom->is_legacy) {
 		if (part_count < key_def->part_count)
 			return true;
-		return bloom_maybe_has(&bloom->parts[0],
+		return bloom_maybe_has(&bloom->parts[0].bloom,
 				       key_hash(key, key_def));
 	}
 
 	assert(part_count <= key_def->part_count);
-	assert(bloom->part_count == key_def->part_count);
+	assert(bloom->part_count <= key_def->part_count);
+	part_count = MIN(part_count, bloom->part_count);
 
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
@@ -251,45 +365,102 @@ tuple_bloom_maybe_has_key(const struct tuple_bloom *bloom,
 		total_size += tuple_hash_field(&h, &carry, &key,
 					       key_def->parts[i].coll);
 		uint32_t hash = PMurHash32_Result(h, carry, total_size);
-		if (!bloom_maybe_has(&bloom->parts[i], hash))
+		if (!tuple_bloom_part_maybe_has(bloom, &bloom->parts[i],
+						hash))
 			return false;
 	}
 	return true;
 }
 
+/*
+ * A bloom filter part is encoded as [table_size, hash_count,
+ * table] while a xor filter part is encoded as [seed,
+ * block_length, fingerprint_bits, table], so the filter type
+ * is determined by the array length on decoding.
+ */
+enum {
+	TUPLE_BLOOM_PART_BLOOM_FIELD_COUNT = 3,
+	TUPLE_BLOOM_PART_XOR_FIELD_COUNT = 4,
+};
+
 static size_t
-tuple_bloom_sizeof_part(const struct bloom *part)
+tuple_bloom_sizeof_part(const struct tuple_bloom *bloom,
+			const union tuple_bloom_part *part)
 {
 	size_t size = 0;
-	size += mp_sizeof_array(3);
-	size += mp_sizeof_uint(part->table_size);
-	size += mp_sizeof_uint(part->hash_count);
-	size += mp_sizeof_bin(bloom_store_size(part));
+	if (bloom->type == TUPLE_BLOOM_XOR) {
+		const struct xor_filter *filter = &part->xor_filter;
+		size += mp_sizeof_array(TUPLE_BLOOM_PART_XOR_FIELD_COUNT);
+		size += mp_sizeof_uint(filter->seed);
+		size += mp_sizeof_uint(filter->block_length);
+		size += mp_sizeof_uint(filter->fingerprint_bits);
+		size += mp_sizeof_bin(xor_filter_store_size(filter));
+		return size;
+	}
+	size += mp_sizeof_array(TUPLE_BLOOM_PART_BLOOM_FIELD_COUNT);
+	size += mp_sizeof_uint(part->bloom.table_size);
+	size += mp_sizeof_uint(part->bloom.hash_count);
+	size += mp_sizeof_bin(bloom_store_size(&part->bloom));
 	return size;
 }
 
 static char *
-tuple_bloom_encode_part(const struct bloom *part, char *buf)
+tuple_bloom_encode_part(const struct tuple_bloom *bloom,
+			const union tuple_bloom_part *part, char *buf)
 {
-	buf = mp_encode_array(buf, 3);
-	buf = mp_encode_uint(buf, part->table_size);
-	buf = mp_encode_uint(buf, part->hash_count);
-	buf = mp_encode_binl(buf, bloom_store_size(part));
-	buf = bloom_store(part, buf);
+	if (bloom->type == TUPLE_BLOOM_XOR) {
+		const struct xor_filter *filter = &part->xor_filter;
+		buf = mp_encode_array(buf, TUPLE_BLOOM_PART_XOR_FIELD_COUNT);
+		buf = mp_encode_uint(buf, filter->seed);
+		buf = mp_encode_uint(buf, filter->block_length);
+		buf = mp_encode_uint(buf, filter->fingerprint_bits);
+		buf = mp_encode_binl(buf, xor_filter_store_size(filter));
+		buf = xor_filter_store(filter, buf);
+		return buf;
+	}
+	buf = mp_encode_array(buf, TUPLE_BLOOM_PART_BLOOM_FIELD_COUNT);
+	buf = mp_encode_uint(buf, part->bloom.table_size);
+	buf = mp_encode_uint(buf, part->bloom.hash_count);
+	buf = mp_encode_binl(buf, bloom_store_size(&part->bloom));
+	buf = bloom_store(&part->bloom, buf);
 	return buf;
 }
 
 static int
-tuple_bloom_decode_part(struct bloom *part, const char **data)
+tuple_bloom_decode_part(struct tuple_bloom *bloom,
+			union tuple_bloom_part *part, const char **data)
 {
 	memset(part, 0, sizeof(*part));
-	if (mp_decode_array(data) != 3)
+	uint32_t field_count = mp_decode_array(data);
+	if (bloom->part_count == 0) {
+		bloom->type = field_count == TUPLE_BLOOM_PART_XOR_FIELD_COUNT ?
+			      TUPLE_BLOOM_XOR : TUPLE_BLOOM_BLOOM;
+	}
+	size_t store_size;
+	if (bloom->type == TUPLE_BLOOM_XOR) {
+		struct xor_filter *filter = &part->xor_filter;
+		if (field_count != TUPLE_BLOOM_PART_XOR_FIELD_COUNT)
+			unreachable();
+		filter->seed = mp_decode_uint(data);
+		filter->block_length = mp_decode_uint(data);
+		filter->fingerprint_bits = mp_decode_uint(data);
+		store_size = mp_decode_binl(data);
+		assert(store_size == xor_filter_store_size(filter));
+		if (xor_filter_load_table(filter, *data) != 0) {
+			diag_set(OutOfMemory, store_size,
+				 "xor_filter_load_table", "tuple bloom part");
+			return -1;
+		}
+		*data += store_size;
+		return 0;
+	}
+	if (field_count != TUPLE_BLOOM_PART_BLOOM_FIELD_COUNT)
 		unreachable();
-	part->table_size = mp_decode_uint(data);
-	part->hash_count = mp_decode_uint(data);
-	size_t store_size = mp_decode_binl(data);
-	assert(store_size == bloom_store_size(part));
-	if (bloom_load_table(part, *data) != 0) {
+	part->bloom.table_size = mp_decode_uint(data);
+	part->bloom.hash_count = mp_decode_uint(data);
+	store_size = mp_decode_binl(data);
+	assert(store_size == bloom_store_size(&part->bloom));
+	if (bloom_load_table(&part->bloom, *data) != 0) {
 		diag_set(OutOfMemory, store_size, "bloom_load_table",
 			 "tuple bloom part");
 		return -1;
@@ -304,7 +475,7 @@ tuple_bloom_size(const struct tuple_bloom *bloom)
 	size_t size = 0;
 	size += mp_sizeof_array(bloom->part_count);
 	for (uint32_t i = 0; i < bloom->part_count; i++)
-		size += tuple_bloom_sizeof_part(&bloom->parts[i]);
+		size += tuple_bloom_sizeof_part(bloom, &bloom->parts[i]);
 	return size;
 }
 
@@ -313,7 +484,7 @@ tuple_bloom_encode(const struct tuple_bloom *bloom, char *buf)
 {
 	buf = mp_encode_array(buf, bloom->part_count);
 	for (uint32_t i = 0; i < bloom->part_count; i++)
-		buf = tuple_bloom_encode_part(&bloom->parts[i], buf);
+		buf = tuple_bloom_encode_part(bloom, &bloom->parts[i], buf);
 	return buf;
 }
 
@@ -331,10 +502,12 @@ tuple_bloom_decode(const char **data)
 	}
 
 	bloom->is_legacy = false;
+	bloom->type = TUPLE_BLOOM_BLOOM;
 	bloom->part_count = 0;
 
 	for (uint32_t i = 0; i < part_count; i++) {
-		if (tuple_bloom_decode_part(&bloom->parts[i], data) != 0) {
+		if (tuple_bloom_decode_part(bloom, &bloom->parts[i],
+					    data) != 0) {
 			tuple_bloom_delete(bloom);
 			return NULL;
 		}
@@ -355,6 +528,7 @@ tuple_bloom_decode_legacy(const char **data)
 	}
 
 	bloom->is_legacy = true;
+	bloom->type = TUPLE_BLOOM_BLOOM;
 	bloom->part_count = 1;
 
 	if (mp_decode_array(data) != 4)
@@ -362,12 +536,12 @@ tuple_bloom_decode_legacy(const char **data)
 	if (mp_decode_uint(data) != 0) /* version */
 		unreachable();
 
-	bloom->parts[0].table_size = mp_decode_uint(data);
-	bloom->parts[0].hash_count = mp_decode_uint(data);
+	bloom->parts[0].bloom.table_size = mp_decode_uint(data);
+	bloom->parts[0].bloom.hash_count = mp_decode_uint(data);
 
 	size_t store_size = mp_decode_binl(data);
-	assert(store_size == bloom_store_size(&bloom->parts[0]));
-	if (bloom_load_table(&bloom->parts[0], *data) != 0) {
+	assert(store_size == bloom_store_size(&bloom->parts[0].bloom));
+	if (bloom_load_table(&bloom->parts[0].bloom, *data) != 0) {
 		diag_set(OutOfMemory, store_size, "bloom_load_table",
 			 "tuple bloom part");
 		free(bloom);
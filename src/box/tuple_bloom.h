@@ -35,6 +35,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "salad/bloom.h"
+#include "salad/xor_filter.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -43,6 +44,29 @@ extern "C" {
 struct tuple;
 struct key_def;
 
+/** Type of filters a tuple bloom filter consists of. */
+enum tuple_bloom_type {
+	/** Classic blocked bloom filter, see salad/bloom.h. */
+	TUPLE_BLOOM_BLOOM = 0,
+	/**
+	 * Xor filter, see salad/xor_filter.h. Takes less space
+	 * for the same false positive rate, but has to hash all
+	 * keys once more on construction.
+	 */
+	TUPLE_BLOOM_XOR = 1,
+	tuple_bloom_type_MAX,
+};
+
+extern const char *tuple_bloom_type_strs[];
+
+/** Filter of a partial key. */
+union tuple_bloom_part {
+	/** Set if the tuple bloom type is TUPLE_BLOOM_BLOOM. */
+	struct bloom bloom;
+	/** Set if the tuple bloom type is TUPLE_BLOOM_XOR. */
+	struct xor_filter xor_filter;
+};
+
 /**
  * Tuple bloom filter.
  *
@@ -58,10 +82,12 @@ struct tuple_bloom {
 	 * (see tuple_bloom_decode_legacy).
 	 */
 	bool is_legacy;
+	/** Type of the partial key filters. */
+	enum tuple_bloom_type type;
 	/** Number of key parts. */
 	uint32_t part_count;
-	/** Array of bloom filters, one per each partial key. */
-	struct bloom parts[0];
+	/** Array of filters, one per each partial key. */
+	union tuple_bloom_part parts[0];
 };
 
 /**
@@ -124,6 +150,26 @@ tuple_bloom_builder_new(uint32_t part_count);
 void
 tuple_bloom_builder_delete(struct tuple_bloom_builder *builder);
 
+/**
+ * Remove all hashes from a tuple bloom filter builder so that
+ * it can be reused for building another bloom filter.
+ * @param builder - bloom filter builder to reset
+ */
+void
+tuple_bloom_builder_reset(struct tuple_bloom_builder *builder);
+
+/**
+ * Add all hashes stored in a tuple bloom filter builder to
+ * another builder. Both builders must have the same number
+ * of key parts.
+ * @param builder - bloom filter builder to add hashes to
+ * @param src - bloom filter builder to take hashes from
+ * @return 0 on success, -1 on OOM
+ */
+int
+tuple_bloom_builder_merge(struct tuple_bloom_builder *builder,
+			  const struct tuple_bloom_builder *src);
+
 /**
  * Add a tuple hash to a tuple bloom filter builder.
  * @param builder - bloom filter builder
@@ -154,10 +200,12 @@ tuple_bloom_builder_add_key(struct tuple_bloom_builder *builder,
  * Create a new tuple bloom filter.
  * @param builder - bloom filter builder
  * @param fpr - desired false positive rate
+ * @param type - type of filters to build
  * @return bloom filter on success or NULL on OOM
  */
 struct tuple_bloom *
-tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr);
+tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr,
+		enum tuple_bloom_type type);
 
 /**
  * Delete a tuple bloom filter.
@@ -59,6 +59,15 @@ hint_cmp(hint_t hint_a, hint_t hint_b)
 	return 0;
 }
 
+/**
+ * Return true if the given hints of the first key part of
+ * type unsigned or integer are equal and hold the whole part
+ * values, i.e. the values are equal and the first part doesn't
+ * need to be compared.
+ */
+static inline bool
+hint_is_exact_integer(hint_t hint_a, hint_t hint_b);
+
 /*
  * Compare two tuple fields.
  * Separate version exists since compare is a very
@@ -347,6 +356,20 @@ mp_compare_number(const char *lhs, const char *rhs)
 					   rhs, mp_typeof(*rhs));
 }
 
+/**
+ * Compare two values of an integer field. Non-negative values
+ * are usually stored as MP_UINT so check this case first.
+ */
+static inline int
+mp_compare_integer(const char *field_a, const char *field_b)
+{
+	enum mp_type a_type = mp_typeof(*field_a);
+	enum mp_type b_type = mp_typeof(*field_b);
+	if (likely(a_type == MP_UINT && b_type == MP_UINT))
+		return mp_compare_uint(field_a, field_b);
+	return mp_compare_integer_with_type(field_a, a_type, field_b, b_type);
+}
+
 static inline int
 mp_compare_str(const char *field_a, const char *field_b)
 {
@@ -989,6 +1012,13 @@ field_compare<FIELD_TYPE_UNSIGNED>(const char **field_a, const char **field_b)
 	return mp_compare_uint(*field_a, *field_b);
 }
 
+template <>
+inline int
+field_compare<FIELD_TYPE_INTEGER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_integer(*field_a, *field_b);
+}
+
 template <>
 inline int
 field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
@@ -1017,6 +1047,17 @@ field_compare_and_next<FIELD_TYPE_UNSIGNED>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_INTEGER>(const char **field_a,
+					   const char **field_b)
+{
+	int r = mp_compare_integer(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 template <>
 inline int
 field_compare_and_next<FIELD_TYPE_STRING>(const char **field_a,
@@ -1087,6 +1128,38 @@ struct FieldCompare<IDX, TYPE>
 	}
 };
 
+/**
+ * Compare all parts but the first one, which is known to be
+ * equal from the hints.
+ */
+template <int IDX, int TYPE, int ...MORE_TYPES>
+struct FieldCompareSkipFirst
+{
+	inline static int compare(struct tuple *, struct tuple *)
+	{
+		return 0;
+	}
+};
+
+template <int IDX, int TYPE, int IDX2, int TYPE2, int ...MORE_TYPES>
+struct FieldCompareSkipFirst<IDX, TYPE, IDX2, TYPE2, MORE_TYPES...>
+{
+	inline static int compare(struct tuple *tuple_a,
+				  struct tuple *tuple_b)
+	{
+		struct tuple_format *format_a = tuple_format(tuple_a);
+		struct tuple_format *format_b = tuple_format(tuple_b);
+		const char *field_a, *field_b;
+		field_a = tuple_field_raw(format_a, tuple_data(tuple_a),
+					  tuple_field_map(tuple_a), IDX2);
+		field_b = tuple_field_raw(format_b, tuple_data(tuple_b),
+					  tuple_field_map(tuple_b), IDX2);
+		return FieldCompare<IDX2, TYPE2, MORE_TYPES...>::
+			compare(tuple_a, tuple_b, format_a,
+				format_b, field_a, field_b);
+	}
+};
+
 /**
  * header
  */
@@ -1100,6 +1173,13 @@ struct TupleCompare
 		int rc = hint_cmp(tuple_a_hint, tuple_b_hint);
 		if (rc != 0)
 			return rc;
+		/* static if */
+		if ((TYPE == FIELD_TYPE_UNSIGNED ||
+		     TYPE == FIELD_TYPE_INTEGER) &&
+		    hint_is_exact_integer(tuple_a_hint, tuple_b_hint)) {
+			return FieldCompareSkipFirst<IDX, TYPE, MORE_TYPES...>::
+				compare(tuple_a, tuple_b);
+		}
 		struct tuple_format *format_a = tuple_format(tuple_a);
 		struct tuple_format *format_b = tuple_format(tuple_b);
 		const char *field_a, *field_b;
@@ -1122,6 +1202,13 @@ struct TupleCompare<0, TYPE, MORE_TYPES...> {
 		int rc = hint_cmp(tuple_a_hint, tuple_b_hint);
 		if (rc != 0)
 			return rc;
+		/* static if */
+		if ((TYPE == FIELD_TYPE_UNSIGNED ||
+		     TYPE == FIELD_TYPE_INTEGER) &&
+		    hint_is_exact_integer(tuple_a_hint, tuple_b_hint)) {
+			return FieldCompareSkipFirst<0, TYPE, MORE_TYPES...>::
+				compare(tuple_a, tuple_b);
+		}
 		struct tuple_format *format_a = tuple_format(tuple_a);
 		struct tuple_format *format_b = tuple_format(tuple_b);
 		const char *field_a = tuple_data(tuple_a);
@@ -1147,18 +1234,59 @@ struct comparator_signature {
 static const comparator_signature cmp_arr[] = {
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
 };
 
 #undef COMPARATOR
@@ -1177,6 +1305,13 @@ field_compare_with_key<FIELD_TYPE_UNSIGNED>(const char **field, const char **key
 	return mp_compare_uint(*field, *key);
 }
 
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_INTEGER>(const char **field, const char **key)
+{
+	return mp_compare_integer(*field, *key);
+}
+
 template <>
 inline int
 field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
@@ -1205,6 +1340,17 @@ field_compare_with_key_and_next<FIELD_TYPE_UNSIGNED>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_INTEGER>(const char **field_a,
+						    const char **field_b)
+{
+	int r = mp_compare_integer(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 template <>
 inline int
 field_compare_with_key_and_next<FIELD_TYPE_STRING>(const char **field_a,
@@ -1270,6 +1416,40 @@ struct FieldCompareWithKey<FLD_ID, IDX, TYPE> {
 	}
 };
 
+/**
+ * Compare all key parts but the first one, which is known to
+ * be equal from the hints.
+ */
+template <int FLD_ID, int IDX, int TYPE, int ...MORE_TYPES>
+struct FieldCompareWithKeySkipFirst
+{
+	inline static int
+	compare(struct tuple *, const char *, uint32_t, struct key_def *)
+	{
+		return 0;
+	}
+};
+
+template <int FLD_ID, int IDX, int TYPE, int IDX2, int TYPE2, int ...MORE_TYPES>
+struct FieldCompareWithKeySkipFirst<FLD_ID, IDX, TYPE, IDX2, TYPE2, MORE_TYPES...>
+{
+	inline static int
+	compare(struct tuple *tuple, const char *key, uint32_t part_count,
+		struct key_def *key_def)
+	{
+		if (part_count == FLD_ID + 1)
+			return 0;
+		mp_next(&key);
+		struct tuple_format *format = tuple_format(tuple);
+		const char *field = tuple_field_raw(format, tuple_data(tuple),
+						    tuple_field_map(tuple),
+						    IDX2);
+		return FieldCompareWithKey<FLD_ID + 1, IDX2, TYPE2, MORE_TYPES...>::
+				compare(tuple, key, part_count,
+					key_def, format, field);
+	}
+};
+
 /**
  * header
  */
@@ -1287,6 +1467,14 @@ struct TupleCompareWithKey
 		int rc = hint_cmp(tuple_hint, key_hint);
 		if (rc != 0)
 			return rc;
+		/* static if */
+		if ((TYPE == FIELD_TYPE_UNSIGNED ||
+		     TYPE == FIELD_TYPE_INTEGER) &&
+		    hint_is_exact_integer(tuple_hint, key_hint)) {
+			return FieldCompareWithKeySkipFirst<FLD_ID, IDX, TYPE,
+							    MORE_TYPES...>::
+				compare(tuple, key, part_count, key_def);
+		}
 		struct tuple_format *format = tuple_format(tuple);
 		const char *field = tuple_field_raw(format, tuple_data(tuple),
 						    tuple_field_map(tuple),
@@ -1310,6 +1498,13 @@ struct TupleCompareWithKey<0, 0, TYPE, MORE_TYPES...>
 		int rc = hint_cmp(tuple_hint, key_hint);
 		if (rc != 0)
 			return rc;
+		/* static if */
+		if ((TYPE == FIELD_TYPE_UNSIGNED ||
+		     TYPE == FIELD_TYPE_INTEGER) &&
+		    hint_is_exact_integer(tuple_hint, key_hint)) {
+			return FieldCompareWithKeySkipFirst<0, 0, TYPE, MORE_TYPES...>::
+				compare(tuple, key, part_count, key_def);
+		}
 		struct tuple_format *format = tuple_format(tuple);
 		const char *field = tuple_data(tuple);
 		mp_decode_array(&field);
@@ -1333,17 +1528,57 @@ struct comparator_with_key_signature
 static const comparator_with_key_signature cmp_wk_arr[] = {
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
 
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(1, FIELD_TYPE_INTEGER , 2, FIELD_TYPE_INTEGER)
 };
 
 /**
@@ -1437,6 +1672,242 @@ func_index_compare_with_key(struct tuple *tuple, hint_t tuple_hint,
 
 /* }}} tuple_compare_with_key */
 
+/* {{{ Typed comparators */
+
+/*
+ * The pre-compiled comparators from cmp_arr and cmp_wk_arr fix
+ * both field numbers and field types, so they only fit primary
+ * keys. Secondary keys, which are merged with the primary key
+ * and may be nullable or collated, ended up in the generic loop
+ * doing a switch per part. Typed comparators fix only the types
+ * of key parts, while field numbers, collations and the unique
+ * part boundary are taken from the key definition at run time.
+ */
+namespace /* local symbols */ {
+
+enum {
+	/** Max number of key parts having a typed comparator. */
+	TYPED_COMPARATOR_PART_COUNT_MAX = 3,
+};
+
+/**
+ * Compare two fields of the given type. If the key definition
+ * is nullable, either field may be NULL.
+ */
+template <int TYPE, bool is_nullable>
+static inline int
+typed_field_compare(const char *field_a, const char *field_b,
+		    struct coll *coll, bool *was_null_met)
+{
+	if (is_nullable) {
+		bool a_is_nil = mp_typeof(*field_a) == MP_NIL;
+		bool b_is_nil = mp_typeof(*field_b) == MP_NIL;
+		if (a_is_nil && b_is_nil) {
+			*was_null_met = true;
+			return 0;
+		}
+		if (a_is_nil)
+			return -1;
+		if (b_is_nil)
+			return 1;
+	}
+	/* static if */
+	if (TYPE == FIELD_TYPE_STRING && coll != NULL)
+		return mp_compare_str_coll(field_a, field_b, coll);
+	return field_compare<TYPE>(&field_a, &field_b);
+}
+
+template <bool is_nullable, int ...TYPES>
+struct TypedFieldCompare
+{
+	inline static int compare(struct tuple *, struct tuple *,
+				  struct key_part *, struct key_part *,
+				  bool *)
+	{
+		return 0;
+	}
+};
+
+template <bool is_nullable, int TYPE, int ...MORE_TYPES>
+struct TypedFieldCompare<is_nullable, TYPE, MORE_TYPES...>
+{
+	inline static int compare(struct tuple *tuple_a,
+				  struct tuple *tuple_b,
+				  struct key_part *part,
+				  struct key_part *unique_end,
+				  bool *was_null_met)
+	{
+		/*
+		 * Extended parts are only compared if a NULL
+		 * has been met, see tuple_compare_slowpath().
+		 */
+		if (is_nullable && part == unique_end && !*was_null_met)
+			return 0;
+		const char *field_a, *field_b;
+		field_a = tuple_field_raw(tuple_format(tuple_a),
+					  tuple_data(tuple_a),
+					  tuple_field_map(tuple_a),
+					  part->fieldno);
+		field_b = tuple_field_raw(tuple_format(tuple_b),
+					  tuple_data(tuple_b),
+					  tuple_field_map(tuple_b),
+					  part->fieldno);
+		assert(field_a != NULL && field_b != NULL);
+		int rc = typed_field_compare<TYPE, is_nullable>(
+				field_a, field_b, part->coll, was_null_met);
+		if (rc != 0)
+			return rc;
+		return TypedFieldCompare<is_nullable, MORE_TYPES...>::
+			compare(tuple_a, tuple_b, part + 1, unique_end,
+				was_null_met);
+	}
+};
+
+template <bool is_nullable, int ...TYPES>
+struct TypedFieldCompareWithKey
+{
+	inline static int compare(struct tuple *, const char *,
+				  struct key_part *, uint32_t)
+	{
+		return 0;
+	}
+};
+
+template <bool is_nullable, int TYPE, int ...MORE_TYPES>
+struct TypedFieldCompareWithKey<is_nullable, TYPE, MORE_TYPES...>
+{
+	inline static int compare(struct tuple *tuple, const char *key,
+				  struct key_part *part, uint32_t part_count)
+	{
+		const char *field = tuple_field_raw(tuple_format(tuple),
+						    tuple_data(tuple),
+						    tuple_field_map(tuple),
+						    part->fieldno);
+		assert(field != NULL);
+		bool was_null_met;
+		int rc = typed_field_compare<TYPE, is_nullable>(
+				field, key, part->coll, &was_null_met);
+		if (rc != 0 || part_count == 1)
+			return rc;
+		mp_next(&key);
+		return TypedFieldCompareWithKey<is_nullable, MORE_TYPES...>::
+			compare(tuple, key, part + 1, part_count - 1);
+	}
+};
+
+template <bool is_nullable, int ...TYPES>
+struct TupleCompareTyped
+{
+	static int compare(struct tuple *tuple_a, hint_t tuple_a_hint,
+			   struct tuple *tuple_b, hint_t tuple_b_hint,
+			   struct key_def *key_def)
+	{
+		assert(key_def->part_count == sizeof...(TYPES));
+		assert(is_nullable == key_def->is_nullable);
+		int rc = hint_cmp(tuple_a_hint, tuple_b_hint);
+		if (rc != 0)
+			return rc;
+		bool was_null_met = false;
+		struct key_part *part = key_def->parts;
+		return TypedFieldCompare<is_nullable, TYPES...>::
+			compare(tuple_a, tuple_b, part,
+				part + key_def->unique_part_count,
+				&was_null_met);
+	}
+
+	static int compare_with_key(struct tuple *tuple, hint_t tuple_hint,
+				    const char *key, uint32_t part_count,
+				    hint_t key_hint, struct key_def *key_def)
+	{
+		assert(part_count <= key_def->part_count);
+		assert(is_nullable == key_def->is_nullable);
+		/* Part count can be 0 in wildcard searches. */
+		if (part_count == 0)
+			return 0;
+		int rc = hint_cmp(tuple_hint, key_hint);
+		if (rc != 0)
+			return rc;
+		return TypedFieldCompareWithKey<is_nullable, TYPES...>::
+			compare(tuple, key, key_def->parts, part_count);
+	}
+};
+
+/**
+ * Look up a typed comparator matching the types of the key
+ * parts. DEPTH is the number of parts yet to be matched.
+ */
+template <int DEPTH, bool is_nullable, int ...TYPES>
+struct TypedComparatorLookup
+{
+	static bool lookup(struct key_def *def, tuple_compare_t *cmp,
+			   tuple_compare_with_key_t *cmp_wk)
+	{
+		uint32_t i = sizeof...(TYPES);
+		if (i == def->part_count) {
+			*cmp = TupleCompareTyped<is_nullable, TYPES...>::
+				compare;
+			*cmp_wk = TupleCompareTyped<is_nullable, TYPES...>::
+				compare_with_key;
+			return true;
+		}
+		switch (def->parts[i].type) {
+		case FIELD_TYPE_UNSIGNED:
+			return TypedComparatorLookup<DEPTH - 1, is_nullable,
+				TYPES..., FIELD_TYPE_UNSIGNED>::
+				lookup(def, cmp, cmp_wk);
+		case FIELD_TYPE_STRING:
+			return TypedComparatorLookup<DEPTH - 1, is_nullable,
+				TYPES..., FIELD_TYPE_STRING>::
+				lookup(def, cmp, cmp_wk);
+		case FIELD_TYPE_INTEGER:
+			return TypedComparatorLookup<DEPTH - 1, is_nullable,
+				TYPES..., FIELD_TYPE_INTEGER>::
+				lookup(def, cmp, cmp_wk);
+		default:
+			return false;
+		}
+	}
+};
+
+template <bool is_nullable, int ...TYPES>
+struct TypedComparatorLookup<0, is_nullable, TYPES...>
+{
+	static bool lookup(struct key_def *def, tuple_compare_t *cmp,
+			   tuple_compare_with_key_t *cmp_wk)
+	{
+		if (sizeof...(TYPES) != def->part_count)
+			return false;
+		*cmp = TupleCompareTyped<is_nullable, TYPES...>::compare;
+		*cmp_wk = TupleCompareTyped<is_nullable, TYPES...>::
+			compare_with_key;
+		return true;
+	}
+};
+
+} /* end of anonymous namespace */
+
+/**
+ * Find typed comparators for the given key definition.
+ * Return false if there are none.
+ */
+template <bool is_nullable>
+static bool
+key_def_find_typed_compare_func(struct key_def *def, tuple_compare_t *cmp,
+				tuple_compare_with_key_t *cmp_wk)
+{
+	assert(is_nullable == def->is_nullable);
+	assert(!def->has_optional_parts);
+	assert(!def->has_json_paths);
+	assert(!def->for_func_index);
+	if (def->part_count == 0 ||
+	    def->part_count > TYPED_COMPARATOR_PART_COUNT_MAX)
+		return false;
+	return TypedComparatorLookup<TYPED_COMPARATOR_PART_COUNT_MAX,
+				     is_nullable>::lookup(def, cmp, cmp_wk);
+}
+
+/* }}} Typed comparators */
+
 /* {{{ tuple_hint */
 
 /**
@@ -1447,10 +1918,11 @@ func_index_compare_with_key(struct tuple *tuple, hint_t tuple_hint,
  *      <-- HINT_CLASS_BITS --> <-- HINT_VALUE_BITS -->
  *      <----------------- HINT_BITS ----------------->
  *
- * For simplicity we construct it using the first key part only;
- * other key parts don't participate in hint construction. As a
- * consequence, tuple hints are useless if the first key part
- * doesn't differ among indexed tuples.
+ * Usually we construct it using the first key part only; other
+ * key parts don't participate in hint construction. As a
+ * consequence, such hints are useless if the first key part
+ * doesn't differ among indexed tuples. Compound keys starting
+ * with integer parts use composite hints, see below.
  *
  * Hint class stores one of mp_class enum values corresponding
  * to the field type. We store it in upper bits of a hint so
@@ -1532,6 +2004,19 @@ hint_create(enum mp_class c, uint64_t val)
 	return (hint_t)(((uint64_t)c << HINT_VALUE_BITS) | val);
 }
 
+static inline bool
+hint_is_exact_integer(hint_t hint_a, hint_t hint_b)
+{
+	if (hint_a != hint_b || hint_a == HINT_NONE)
+		return false;
+	/*
+	 * Values that don't fit in a hint are mapped to the min
+	 * and max hint values, see hint_uint() and hint_int().
+	 */
+	uint64_t val = hint_a & HINT_VALUE_MAX;
+	return val != 0 && val != HINT_VALUE_MAX;
+}
+
 static inline hint_t
 hint_nil(void)
 {
@@ -1833,6 +2318,171 @@ field_hint(const char *field, struct coll *coll)
 	return HINT_NONE;
 }
 
+/*
+ * Composite hints.
+ *
+ * Compound keys often start with a low cardinality integer part
+ * (tenant id, status), so a hint of the first part rarely settles
+ * a comparison. If the first parts of a key are integers, the
+ * hint value is split evenly among key_def::hint_part_count
+ * leading parts:
+ *
+ *     [ class | part 1 | ... | part N-1 | part N ]
+ *
+ * Integer parts but the last one are stored exactly, so that
+ * equal bits mean equal values and the bits of the next part
+ * may be compared. An integer that doesn't fit in its share is
+ * stored as all zero (too small) or all one (too large) bits and
+ * so is the rest of the hint, which makes such hints equal to
+ * each other so that a full comparison is needed. The last part
+ * stores the upper bits of its regular hint.
+ *
+ * The value of a composite hint with the exact first part is
+ * never 0 or HINT_VALUE_MAX, so hint_is_exact_integer() works
+ * for composite hints as is.
+ *
+ * A key with less than hint_part_count parts gets no hint.
+ */
+
+/** Max number of key parts packed in a composite hint. */
+#define HINT_COMPOSITE_PART_COUNT_MAX	3
+
+/**
+ * Append an integer part to a composite hint value.
+ * @param val hint value
+ * @param field msgpack integer
+ * @param bits number of bits of the part
+ * @param rest_bits number of bits left after the part
+ * @retval false the integer doesn't fit, the rest of
+ *         the value is filled
+ */
+static inline bool
+hint_composite_append_integer(uint64_t *val, const char *field,
+			      uint32_t bits, uint32_t rest_bits)
+{
+	uint64_t half = 1ULL << (bits - 1);
+	uint64_t code;
+	switch (mp_typeof(*field)) {
+	case MP_UINT: {
+		uint64_t u = mp_decode_uint(&field);
+		code = u < half - 1 ? half + u : (1ULL << bits) - 1;
+		break;
+	}
+	case MP_INT: {
+		int64_t i = mp_decode_int(&field);
+		code = i > -(int64_t)half ? half + i : 0;
+		break;
+	}
+	default:
+		unreachable();
+		code = 0;
+	}
+	*val = (*val << bits) | code;
+	if (code != 0 && code != (1ULL << bits) - 1)
+		return true;
+	*val <<= rest_bits;
+	if (code != 0)
+		*val |= (1ULL << rest_bits) - 1;
+	return false;
+}
+
+/** Append the hint of the last part to a composite hint value. */
+static inline hint_t
+hint_composite_append_last(uint64_t val, uint32_t rest_bits, hint_t hint)
+{
+	if (hint == HINT_NONE)
+		return HINT_NONE;
+	val = (val << rest_bits) | (hint >> (HINT_BITS - rest_bits));
+	return hint_create(MP_CLASS_NUMBER, val);
+}
+
+template <int part_count, enum field_type type, bool is_nullable>
+static hint_t
+key_hint_composite(const char *key, uint32_t key_part_count,
+		   struct key_def *key_def)
+{
+	assert(!key_def->is_multikey);
+	if (key_part_count < (uint32_t)part_count)
+		return HINT_NONE;
+	const uint32_t bits = HINT_VALUE_BITS / part_count;
+	uint64_t val = 0;
+	for (int i = 1; i < part_count; i++) {
+		if (!hint_composite_append_integer(&val, key, bits,
+				HINT_VALUE_BITS - bits * i))
+			return hint_create(MP_CLASS_NUMBER, val);
+		mp_next(&key);
+	}
+	const uint32_t rest_bits = HINT_VALUE_BITS - bits * (part_count - 1);
+	struct key_part *part = &key_def->parts[part_count - 1];
+	return hint_composite_append_last(val, rest_bits,
+			field_hint<type, is_nullable>(key, part->coll));
+}
+
+template <int part_count, enum field_type type, bool is_nullable>
+static hint_t
+tuple_hint_composite(struct tuple *tuple, struct key_def *key_def)
+{
+	assert(!key_def->is_multikey);
+	const uint32_t bits = HINT_VALUE_BITS / part_count;
+	uint64_t val = 0;
+	for (int i = 1; i < part_count; i++) {
+		const char *field = tuple_field_by_part(tuple,
+				&key_def->parts[i - 1], MULTIKEY_NONE);
+		if (!hint_composite_append_integer(&val, field, bits,
+				HINT_VALUE_BITS - bits * i))
+			return hint_create(MP_CLASS_NUMBER, val);
+	}
+	const uint32_t rest_bits = HINT_VALUE_BITS - bits * (part_count - 1);
+	struct key_part *part = &key_def->parts[part_count - 1];
+	const char *field = tuple_field_by_part(tuple, part, MULTIKEY_NONE);
+	hint_t hint = is_nullable && field == NULL ? hint_nil() :
+		      field_hint<type, is_nullable>(field, part->coll);
+	return hint_composite_append_last(val, rest_bits, hint);
+}
+
+/** Return true if field_hint() supports the field type. */
+static bool
+field_type_has_hint(enum field_type type)
+{
+	switch (type) {
+	case FIELD_TYPE_BOOLEAN:
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+	case FIELD_TYPE_NUMBER:
+	case FIELD_TYPE_DOUBLE:
+	case FIELD_TYPE_STRING:
+	case FIELD_TYPE_VARBINARY:
+	case FIELD_TYPE_SCALAR:
+	case FIELD_TYPE_DECIMAL:
+	case FIELD_TYPE_UUID:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Return the number of leading key parts to pack in a hint:
+ * all integer parts that can't store NULL, up to
+ * HINT_COMPOSITE_PART_COUNT_MAX - 1, plus the next part.
+ */
+static uint32_t
+key_def_hint_part_count(const struct key_def *def)
+{
+	uint32_t count = 1;
+	while (count < def->part_count &&
+	       count < HINT_COMPOSITE_PART_COUNT_MAX) {
+		const struct key_part *part = &def->parts[count - 1];
+		if ((part->type != FIELD_TYPE_UNSIGNED &&
+		     part->type != FIELD_TYPE_INTEGER) ||
+		    key_part_is_nullable(part) ||
+		    !field_type_has_hint(def->parts[count].type))
+			break;
+		count++;
+	}
+	return count;
+}
+
 template <enum field_type type, bool is_nullable>
 static hint_t
 key_hint(const char *key, uint32_t part_count, struct key_def *key_def)
@@ -1884,62 +2534,65 @@ key_hint_stub(struct tuple *tuple, struct key_def *key_def)
 	return HINT_NONE;
 }
 
-template<enum field_type type, bool is_nullable>
+template<int part_count, enum field_type type, bool is_nullable>
 static void
 key_def_set_hint_func(struct key_def *def)
 {
-	def->key_hint = key_hint<type, is_nullable>;
-	def->tuple_hint = tuple_hint<type, is_nullable>;
+	if (part_count == 1) {
+		def->key_hint = key_hint<type, is_nullable>;
+		def->tuple_hint = tuple_hint<type, is_nullable>;
+	} else {
+		def->key_hint = key_hint_composite<part_count, type,
+						   is_nullable>;
+		def->tuple_hint = tuple_hint_composite<part_count, type,
+						       is_nullable>;
+	}
 }
 
-template<enum field_type type>
+template<int part_count, enum field_type type>
 static void
 key_def_set_hint_func(struct key_def *def)
 {
-	if (key_part_is_nullable(def->parts))
-		key_def_set_hint_func<type, true>(def);
+	if (key_part_is_nullable(&def->parts[part_count - 1]))
+		key_def_set_hint_func<part_count, type, true>(def);
 	else
-		key_def_set_hint_func<type, false>(def);
+		key_def_set_hint_func<part_count, type, false>(def);
 }
 
+template<int part_count>
 static void
 key_def_set_hint_func(struct key_def *def)
 {
-	if (def->is_multikey || def->for_func_index) {
-		def->key_hint = key_hint_stub;
-		def->tuple_hint = key_hint_stub;
-		return;
-	}
-	switch (def->parts->type) {
+	switch (def->parts[part_count - 1].type) {
 	case FIELD_TYPE_BOOLEAN:
-		key_def_set_hint_func<FIELD_TYPE_BOOLEAN>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_BOOLEAN>(def);
 		break;
 	case FIELD_TYPE_UNSIGNED:
-		key_def_set_hint_func<FIELD_TYPE_UNSIGNED>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_UNSIGNED>(def);
 		break;
 	case FIELD_TYPE_INTEGER:
-		key_def_set_hint_func<FIELD_TYPE_INTEGER>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_INTEGER>(def);
 		break;
 	case FIELD_TYPE_NUMBER:
-		key_def_set_hint_func<FIELD_TYPE_NUMBER>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_NUMBER>(def);
 		break;
 	case FIELD_TYPE_DOUBLE:
-		key_def_set_hint_func<FIELD_TYPE_DOUBLE>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_DOUBLE>(def);
 		break;
 	case FIELD_TYPE_STRING:
-		key_def_set_hint_func<FIELD_TYPE_STRING>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_STRING>(def);
 		break;
 	case FIELD_TYPE_VARBINARY:
-		key_def_set_hint_func<FIELD_TYPE_VARBINARY>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_VARBINARY>(def);
 		break;
 	case FIELD_TYPE_SCALAR:
-		key_def_set_hint_func<FIELD_TYPE_SCALAR>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_SCALAR>(def);
 		break;
 	case FIELD_TYPE_DECIMAL:
-		key_def_set_hint_func<FIELD_TYPE_DECIMAL>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_DECIMAL>(def);
 		break;
 	case FIELD_TYPE_UUID:
-		key_def_set_hint_func<FIELD_TYPE_UUID>(def);
+		key_def_set_hint_func<part_count, FIELD_TYPE_UUID>(def);
 		break;
 	default:
 		/* Invalid key definition. */
@@ -1949,6 +2602,31 @@ key_def_set_hint_func(struct key_def *def)
 	}
 }
 
+static void
+key_def_set_hint_func(struct key_def *def)
+{
+	if (def->is_multikey || def->for_func_index) {
+		def->hint_part_count = 1;
+		def->key_hint = key_hint_stub;
+		def->tuple_hint = key_hint_stub;
+		return;
+	}
+	def->hint_part_count = key_def_hint_part_count(def);
+	switch (def->hint_part_count) {
+	case 1:
+		key_def_set_hint_func<1>(def);
+		break;
+	case 2:
+		key_def_set_hint_func<2>(def);
+		break;
+	case 3:
+		key_def_set_hint_func<3>(def);
+		break;
+	default:
+		unreachable();
+	}
+}
+
 /* }}} tuple_hint */
 
 static void
@@ -1990,6 +2668,17 @@ key_def_set_compare_func_fast(struct key_def *def)
 			break;
 		}
 	}
+	if (cmp == NULL || cmp_wk == NULL) {
+		tuple_compare_t typed_cmp;
+		tuple_compare_with_key_t typed_cmp_wk;
+		if (key_def_find_typed_compare_func<false>(def, &typed_cmp,
+							   &typed_cmp_wk)) {
+			if (cmp == NULL)
+				cmp = typed_cmp;
+			if (cmp_wk == NULL)
+				cmp_wk = typed_cmp_wk;
+		}
+	}
 	if (cmp == NULL) {
 		cmp = is_sequential ?
 			tuple_compare_sequential<false, false> :
@@ -2011,6 +2700,11 @@ static void
 key_def_set_compare_func_plain(struct key_def *def)
 {
 	assert(!def->has_json_paths);
+	if (!has_optional_parts &&
+	    key_def_find_typed_compare_func<is_nullable>(def,
+					&def->tuple_compare,
+					&def->tuple_compare_with_key))
+		return;
 	if (key_def_is_sequential(def)) {
 		def->tuple_compare = tuple_compare_sequential
 					<is_nullable, has_optional_parts>;
@@ -0,0 +1,303 @@
+#define TARANTOOL_BOX_READ_VIEW_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "tuple_compression.h"
+
+#include <string.h>
+
+#include "zstd.h"
+
+#include "diag.h"
+#include "error.h"
+#include "errcode.h"
+#include "fiber.h"
+#include "small/region.h"
+#include "tuple.h"
+#include "tuple_format.h"
+#include "trivia/util.h"
+
+/** Compression level, the same as used for xlogs. */
+enum { TUPLE_COMPRESSION_LEVEL = 3 };
+
+/** Contexts reused by all compressions, tx thread only. */
+static ZSTD_CCtx *tuple_zctx;
+static ZSTD_DCtx *tuple_zdctx;
+
+int
+tuple_compression_init(void)
+{
+	tuple_zctx = ZSTD_createCCtx();
+	tuple_zdctx = ZSTD_createDCtx();
+	if (tuple_zctx == NULL || tuple_zdctx == NULL) {
+		tuple_compression_free();
+		diag_set(OutOfMemory, 0, "ZSTD_createCCtx",
+			 "tuple compression context");
+		return -1;
+	}
+	return 0;
+}
+
+void
+tuple_compression_free(void)
+{
+	ZSTD_freeCCtx(tuple_zctx);
+	ZSTD_freeDCtx(tuple_zdctx);
+	tuple_zctx = NULL;
+	tuple_zdctx = NULL;
+}
+
+/**
+ * Decode the header of a compressed value. Return a pointer
+ * to the zstd frame, its size and the size of the original
+ * value or NULL if the value is malformed.
+ */
+static const char *
+mp_decode_compressed(const char **data, uint32_t *frame_size,
+		     uint32_t *size)
+{
+	int8_t type;
+	uint32_t len = mp_decode_extl(data, &type);
+	assert(type == MP_COMPRESSION);
+	const char *ext = *data;
+	const char *ext_end = ext + len;
+	*data = ext_end;
+	if (len == 0 || mp_typeof(*ext) != MP_UINT ||
+	    mp_check_uint(ext, ext_end) > 0)
+		return NULL;
+	uint64_t original_size = mp_decode_uint(&ext);
+	if (original_size > UINT32_MAX)
+		return NULL;
+	*size = original_size;
+	*frame_size = ext_end - ext;
+	return ext;
+}
+
+/**
+ * Try to compress @a len bytes of @a value to @a out, which
+ * has @a len bytes of space. Return the size of the result or
+ * 0 if the value doesn't shrink.
+ */
+static uint32_t
+tuple_compress_value(const char *value, uint32_t len, char *out)
+{
+	uint32_t header_size = mp_sizeof_ext(len) + mp_sizeof_uint(len);
+	if (header_size >= len)
+		return 0;
+	/* Compress right after the longest possible header. */
+	char *frame = out + header_size;
+	size_t frame_size = ZSTD_compressCCtx(tuple_zctx, frame,
+					      len - header_size, value, len,
+					      TUPLE_COMPRESSION_LEVEL);
+	/* The output buffer is too small, i.e. no gain. */
+	if (ZSTD_isError(frame_size))
+		return 0;
+	uint32_t ext_len = mp_sizeof_uint(len) + frame_size;
+	char *pos = mp_encode_extl(out, MP_COMPRESSION, ext_len);
+	pos = mp_encode_uint(pos, len);
+	memmove(pos, frame, frame_size);
+	return pos + frame_size - out;
+}
+
+int
+tuple_compress(struct tuple_format *format, const char **data,
+	       const char **data_end)
+{
+	assert(format->is_compressed);
+	assert(mp_typeof(**data) == MP_ARRAY);
+	struct region *region = &fiber()->gc;
+	size_t size = *data_end - *data;
+	/* Compressed values are never longer than originals. */
+	char *buf = (char *)region_alloc(region, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "buf");
+		return -1;
+	}
+	const char *pos = *data;
+	uint32_t field_count = mp_decode_array(&pos);
+	uint32_t format_field_count = tuple_format_field_count(format);
+	char *buf_pos = mp_encode_array(buf, field_count);
+	for (uint32_t i = 0; i < field_count; i++) {
+		const char *value = pos;
+		mp_next(&pos);
+		uint32_t len = pos - value;
+		struct tuple_field *field = i < format_field_count ?
+					    tuple_format_field(format, i) :
+					    NULL;
+		if (field == NULL ||
+		    field->compression_type == COMPRESSION_TYPE_NONE) {
+			memcpy(buf_pos, value, len);
+			buf_pos += len;
+			continue;
+		}
+		if (mp_is_compressed(value)) {
+			/* Recovered from a snapshot or replicated. */
+			const char *ext = value;
+			uint32_t frame_size, original_size;
+			const char *frame = mp_decode_compressed(
+				&ext, &frame_size, &original_size);
+			if (frame == NULL ||
+			    ZSTD_getFrameContentSize(frame, frame_size) !=
+			    original_size) {
+				diag_set(ClientError, ER_FIELD_TYPE,
+					 int2str(i + TUPLE_INDEX_BASE),
+					 field_type_strs[field->type]);
+				return -1;
+			}
+			memcpy(buf_pos, value, len);
+			buf_pos += len;
+			continue;
+		}
+		uint32_t compressed_len = 0;
+		if (len >= TUPLE_COMPRESSION_MIN_SIZE) {
+			if (!field_mp_type_is_compatible(
+					field->type, value,
+					tuple_field_is_nullable(field))) {
+				diag_set(ClientError, ER_FIELD_TYPE,
+					 int2str(i + TUPLE_INDEX_BASE),
+					 field_type_strs[field->type]);
+				return -1;
+			}
+			compressed_len = tuple_compress_value(value, len,
+							      buf_pos);
+		}
+		if (compressed_len == 0) {
+			memcpy(buf_pos, value, len);
+			compressed_len = len;
+		}
+		buf_pos += compressed_len;
+	}
+	assert(buf_pos <= buf + size);
+	*data = buf;
+	*data_end = buf_pos;
+	return 0;
+}
+
+int
+tuple_data_decompress(const char **data, const char **data_end)
+{
+	assert(mp_typeof(**data) == MP_ARRAY);
+	const char *pos = *data;
+	uint32_t field_count = mp_decode_array(&pos);
+	/* Calculate the size of the result first. */
+	size_t size = pos - *data;
+	bool is_compressed = false;
+	for (uint32_t i = 0; i < field_count; i++) {
+		const char *value = pos;
+		if (!mp_is_compressed(value)) {
+			mp_next(&pos);
+			size += pos - value;
+			continue;
+		}
+		uint32_t frame_size, original_size;
+		if (mp_decode_compressed(&pos, &frame_size,
+					 &original_size) == NULL) {
+			diag_set(ClientError, ER_DECOMPRESSION,
+				 "malformed field value");
+			return -1;
+		}
+		size += original_size;
+		is_compressed = true;
+	}
+	if (!is_compressed)
+		return 0;
+	struct region *region = &fiber()->gc;
+	char *buf = (char *)region_alloc(region, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "buf");
+		return -1;
+	}
+	pos = *data;
+	mp_decode_array(&pos);
+	char *buf_pos = mp_encode_array(buf, field_count);
+	for (uint32_t i = 0; i < field_count; i++) {
+		const char *value = pos;
+		if (!mp_is_compressed(value)) {
+			mp_next(&pos);
+			memcpy(buf_pos, value, pos - value);
+			buf_pos += pos - value;
+			continue;
+		}
+		uint32_t frame_size, original_size;
+		const char *frame = mp_decode_compressed(&pos, &frame_size,
+							 &original_size);
+		size_t rc = ZSTD_decompressDCtx(tuple_zdctx, buf_pos,
+						original_size, frame,
+						frame_size);
+		if (ZSTD_isError(rc)) {
+			diag_set(ClientError, ER_DECOMPRESSION,
+				 ZSTD_getErrorName(rc));
+			return -1;
+		}
+		if (rc != original_size) {
+			diag_set(ClientError, ER_DECOMPRESSION,
+				 "unexpected size of field value");
+			return -1;
+		}
+		buf_pos += original_size;
+	}
+	assert(buf_pos == buf + size);
+	*data = buf;
+	*data_end = buf_pos;
+	return 0;
+}
+
+struct tuple *
+tuple_decompress(struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	if (!format->is_compressed)
+		return tuple;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	const char *data = tuple_data(tuple);
+	const char *data_end = data + tuple->bsize;
+	const char *plain = data;
+	struct tuple *result = NULL;
+	if (tuple_data_decompress(&plain, &data_end) != 0)
+		goto out;
+	if (plain == data) {
+		result = tuple;
+		goto out;
+	}
+	if (format->plain_format == NULL) {
+		format->plain_format =
+			tuple_format_new(&tuple_format_runtime->vtab, NULL,
+					 NULL, 0, NULL, 0, 0, format->dict,
+					 false, false, true);
+		if (format->plain_format == NULL)
+			goto out;
+		tuple_format_ref(format->plain_format);
+	}
+	result = tuple_new(format->plain_format, plain, data_end);
+out:
+	region_truncate(region, region_svp);
+	return result;
+}
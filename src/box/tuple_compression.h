@@ -0,0 +1,113 @@
+#ifndef TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED
+#define TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED
+#define TARANTOOL_BOX_READ_VIEW_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "msgpuck.h"
+#include "mp_extension_types.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct tuple;
+struct tuple_format;
+
+/**
+ * A value of a field with compression enabled is stored as
+ * MP_EXT of type MP_COMPRESSION:
+ *
+ *   [original size: MP_UINT][zstd frame]
+ *
+ * Values shorter than this and values that don't shrink are
+ * stored as is.
+ */
+enum { TUPLE_COMPRESSION_MIN_SIZE = 64 };
+
+/** Return true if @a data points to a compressed value. */
+static inline bool
+mp_is_compressed(const char *data)
+{
+	if (mp_typeof(*data) != MP_EXT)
+		return false;
+	int8_t type;
+	mp_decode_extl(&data, &type);
+	return type == MP_COMPRESSION;
+}
+
+/** Initialize compression contexts. */
+int
+tuple_compression_init(void);
+
+/** Free compression contexts. */
+void
+tuple_compression_free(void);
+
+/**
+ * Compress values of fields with compression enabled in
+ * @a format. Types of compressed values are checked here,
+ * since they can't be checked by the tuple format afterwards.
+ * Already compressed values are kept as is. On success @a data
+ * and @a data_end are updated to point to the result, which is
+ * allocated on the fiber region.
+ */
+int
+tuple_compress(struct tuple_format *format, const char **data,
+	       const char **data_end);
+
+/**
+ * Decompress all compressed values of MessagePack array
+ * @a data. If there is no compressed field, @a data and
+ * @a data_end are left unchanged, otherwise they are updated
+ * to point to the result, which is allocated on the fiber
+ * region.
+ */
+int
+tuple_data_decompress(const char **data, const char **data_end);
+
+/**
+ * Return a copy of @a tuple with all values decompressed or
+ * the tuple itself if it has no compressed fields. The copy
+ * is not referenced and has a runtime format sharing the
+ * dictionary with the original format so that fields can be
+ * accessed by name. Returns NULL on error.
+ */
+struct tuple *
+tuple_decompress(struct tuple *tuple);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED */
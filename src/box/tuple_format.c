@@ -33,7 +33,9 @@
 #include "json/json.h"
 #include "tuple_format.h"
 #include "coll_id_cache.h"
+#include "tuple_compression.h"
 #include "tt_static.h"
+#include "uuid/mp_uuid.h"
 
 #include "third_party/PMurHash.h"
 
@@ -81,6 +83,8 @@ tuple_format_cmp(const struct tuple_format *format1,
 		return a->exact_field_count - b->exact_field_count;
 	if (a->total_field_count != b->total_field_count)
 		return a->total_field_count - b->total_field_count;
+	if (a->is_field_map_compact != b->is_field_map_compact)
+		return a->is_field_map_compact - b->is_field_map_compact;
 
 	struct tuple_field *field_a;
 	json_tree_foreach_entry_preorder(field_a, &a->fields.root,
@@ -97,6 +101,9 @@ tuple_format_cmp(const struct tuple_format *format1,
 		if (field_a->is_key_part != field_b->is_key_part)
 			return (int)field_a->is_key_part -
 				(int)field_b->is_key_part;
+		if (field_a->compression_type != field_b->compression_type)
+			return (int)field_a->compression_type -
+				(int)field_b->compression_type;
 	}
 
 	return 0;
@@ -120,6 +127,7 @@ tuple_format_hash(struct tuple_format *format)
 		TUPLE_FIELD_MEMBER_HASH(f, coll_id, h, carry, size)
 		TUPLE_FIELD_MEMBER_HASH(f, nullable_action, h, carry, size)
 		TUPLE_FIELD_MEMBER_HASH(f, is_key_part, h, carry, size)
+		TUPLE_FIELD_MEMBER_HASH(f, compression_type, h, carry, size)
 	}
 #undef TUPLE_FIELD_MEMBER_HASH
 	return PMurHash32_Result(h, carry, size);
@@ -153,6 +161,7 @@ tuple_field_new(void)
 	field->offset_slot = TUPLE_OFFSET_SLOT_NIL;
 	field->coll_id = COLL_NONE;
 	field->nullable_action = ON_CONFLICT_ACTION_NONE;
+	field->compression_type = COMPRESSION_TYPE_NONE;
 	field->multikey_required_fields = NULL;
 	return field;
 }
@@ -375,8 +384,14 @@ tuple_format_use_key_part(struct tuple_format *format, uint32_t field_count,
 			  int *current_slot, char **path_pool)
 {
 	assert(part->fieldno < tuple_format_field_count(format));
-	struct tuple_field *field =
-		tuple_format_add_field(format, part->fieldno, part->path,
+	struct tuple_field *field = tuple_format_field(format, part->fieldno);
+	if (field->compression_type != COMPRESSION_TYPE_NONE) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Index",
+			 tt_sprintf("compressed field %s",
+				    tuple_field_path(field)));
+		return -1;
+	}
+	field = tuple_format_add_field(format, part->fieldno, part->path,
 				       part->path_len, is_sequential,
 				       current_slot, path_pool);
 	if (field == NULL)
@@ -441,10 +456,57 @@ tuple_format_use_key_part(struct tuple_format *format, uint32_t field_count,
  * Extract all available type info from keys and field
  * definitions.
  */
+/**
+ * Return the maximal size of a value of a field or UINT32_MAX
+ * if the size is not bounded.
+ */
+static uint32_t
+tuple_field_max_size(struct tuple_field *field)
+{
+	if (field->compression_type != COMPRESSION_TYPE_NONE)
+		return UINT32_MAX;
+	switch (field->type) {
+	case FIELD_TYPE_UNSIGNED:
+		return mp_sizeof_uint(UINT64_MAX);
+	case FIELD_TYPE_INTEGER:
+		return MAX(mp_sizeof_uint(UINT64_MAX),
+			   mp_sizeof_int(INT64_MIN));
+	case FIELD_TYPE_DOUBLE:
+		return mp_sizeof_double(0);
+	case FIELD_TYPE_BOOLEAN:
+		return mp_sizeof_bool(false);
+	case FIELD_TYPE_UUID:
+		return mp_sizeof_uuid();
+	default:
+		return UINT32_MAX;
+	}
+}
+
+/**
+ * Check if offsets of indexed fields of any tuple conforming
+ * to the format fit in 16 bits.
+ */
+static bool
+tuple_format_field_map_fits_compact(struct tuple_format *format)
+{
+	/* JSON path fields may be anywhere. */
+	if (format->fields_depth > 1)
+		return false;
+	uint64_t max_offset = mp_sizeof_array(UINT32_MAX);
+	for (uint32_t i = 0; i < tuple_format_field_count(format); i++) {
+		struct tuple_field *field = tuple_format_field(format, i);
+		if (field->offset_slot != TUPLE_OFFSET_SLOT_NIL &&
+		    max_offset > UINT16_MAX)
+			return false;
+		max_offset += tuple_field_max_size(field);
+	}
+	return true;
+}
+
 static int
 tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 		    uint16_t key_count, const struct field_def *fields,
-		    uint32_t field_count)
+		    uint32_t field_count, bool allow_compact)
 {
 	format->min_field_count =
 		tuple_format_min_field_count(keys, key_count, fields,
@@ -458,6 +520,9 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 		struct tuple_field *field = tuple_format_field(format, i);
 		field->type = fields[i].type;
 		field->nullable_action = fields[i].nullable_action;
+		field->compression_type = fields[i].compression_type;
+		if (field->compression_type != COMPRESSION_TYPE_NONE)
+			format->is_compressed = true;
 		struct coll *coll = NULL;
 		uint32_t cid = fields[i].coll_id;
 		if (cid != COLL_NONE) {
@@ -500,7 +565,11 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 
 	assert(tuple_format_field(format, 0)->offset_slot == TUPLE_OFFSET_SLOT_NIL
 	       || json_token_is_multikey(&tuple_format_field(format, 0)->token));
-	size_t field_map_size = -current_slot * sizeof(uint32_t);
+	format->is_field_map_compact = allow_compact &&
+		tuple_format_field_map_fits_compact(format);
+	size_t slot_size = format->is_field_map_compact ?
+			   sizeof(uint16_t) : sizeof(uint32_t);
+	size_t field_map_size = -current_slot * slot_size;
 	if (field_map_size > INT16_MAX) {
 		/** tuple->data_offset is 15 bits */
 		diag_set(ClientError, ER_INDEX_FIELD_COUNT_LIMIT,
@@ -520,6 +589,12 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 	uint32_t *required_fields = format->required_fields;
 	json_tree_foreach_entry_preorder(field, &format->fields.root,
 					 struct tuple_field, token) {
+		if (field->token.parent != &format->fields.root) {
+			struct tuple_field *parent =
+				json_tree_entry(field->token.parent,
+						struct tuple_field, token);
+			parent->child_count++;
+		}
 		/*
 		 * In the case of the multikey index,
 		 * required_fields is overridden with local for
@@ -689,6 +764,9 @@ tuple_format_alloc(struct key_def * const *keys, uint16_t key_count,
 	}
 	format->total_field_count = field_count;
 	format->required_fields = NULL;
+	format->is_compressed = false;
+	format->is_field_map_compact = false;
+	format->plain_format = NULL;
 	format->fields_depth = 1;
 	format->refs = 0;
 	format->id = FORMAT_ID_NIL;
@@ -710,6 +788,8 @@ tuple_format_destroy(struct tuple_format *format)
 	free(format->required_fields);
 	tuple_format_destroy_fields(format);
 	tuple_dictionary_unref(format->dict);
+	if (format->plain_format != NULL)
+		tuple_format_unref(format->plain_format);
 }
 
 /**
@@ -795,7 +875,7 @@ tuple_format_new(struct tuple_format_vtab *vtab, void *engine,
 		 const struct field_def *space_fields,
 		 uint32_t space_field_count, uint32_t exact_field_count,
 		 struct tuple_dictionary *dict, bool is_temporary,
-		 bool is_ephemeral)
+		 bool is_ephemeral, bool allow_compact)
 {
 	struct tuple_format *format =
 		tuple_format_alloc(keys, key_count, space_field_count, dict);
@@ -807,11 +887,13 @@ tuple_format_new(struct tuple_format_vtab *vtab, void *engine,
 		memset(&format->vtab, 0, sizeof(format->vtab));
 	format->engine = engine;
 	format->is_temporary = is_temporary;
+	format->is_snapshot_tracked = false;
+	format->snapshot_iterator_count = 0;
 	format->is_ephemeral = is_ephemeral;
 	format->exact_field_count = exact_field_count;
 	format->epoch = ++formats_epoch;
 	if (tuple_format_create(format, keys, key_count, space_fields,
-				space_field_count) < 0)
+				space_field_count, allow_compact) < 0)
 		goto err;
 	if (is_ephemeral && tuple_format_reuse(&format))
 		return format;
@@ -828,11 +910,34 @@ err:
 	return NULL;
 }
 
+/**
+ * Return true if tuples of @a format can't have the top level
+ * field @a field belongs to, because the format fixes the number
+ * of fields in a tuple and the field is past the end.
+ */
+static bool
+tuple_format_field_is_absent(struct tuple_format *format,
+			     struct tuple_field *field)
+{
+	if (format->exact_field_count == 0)
+		return false;
+	struct json_token *token = &field->token;
+	while (token->parent->parent != NULL)
+		token = token->parent;
+	assert(token->type == JSON_TOKEN_NUM);
+	return (uint32_t)token->num >= format->exact_field_count;
+}
+
 bool
 tuple_format1_can_store_format2_tuples(struct tuple_format *format1,
 				       struct tuple_format *format2)
 {
-	if (format1->exact_field_count != format2->exact_field_count)
+	/*
+	 * Dropping the field count restriction doesn't require
+	 * a data check, while setting or changing it does.
+	 */
+	if (format1->exact_field_count != 0 &&
+	    format1->exact_field_count != format2->exact_field_count)
 		return false;
 	struct tuple_field *field1;
 	json_tree_foreach_entry_preorder(field1, &format1->fields.root,
@@ -856,6 +961,13 @@ tuple_format1_can_store_format2_tuples(struct tuple_format *format1,
 			if (field1->type == FIELD_TYPE_ANY &&
 			    tuple_field_is_nullable(field1))
 				continue;
+			/*
+			 * Neither is it needed if old tuples
+			 * are known to end before the field.
+			 */
+			if (tuple_field_is_nullable(field1) &&
+			    tuple_format_field_is_absent(format2, field1))
+				continue;
 			else
 				return false;
 		}
@@ -868,6 +980,13 @@ tuple_format1_can_store_format2_tuples(struct tuple_format *format1,
 		if (tuple_field_is_nullable(field2) &&
 		    !tuple_field_is_nullable(field1))
 			return false;
+		/*
+		 * Old data may store compressed values, which
+		 * are not allowed in an uncompressed field.
+		 */
+		if (field2->compression_type != COMPRESSION_TYPE_NONE &&
+		    field1->compression_type == COMPRESSION_TYPE_NONE)
+			return false;
 	}
 	return true;
 }
@@ -879,6 +998,7 @@ tuple_field_map_create(struct tuple_format *format, const char *tuple,
 {
 	struct region *region = &fiber()->gc;
 	if (field_map_builder_create(builder, format->field_map_size,
+				     format->is_field_map_compact,
 				     region) != 0)
 		return -1;
 	if (tuple_format_field_count(format) == 0)
@@ -886,7 +1006,15 @@ tuple_field_map_create(struct tuple_format *format, const char *tuple,
 
 	uint32_t field_count;
 	struct tuple_format_iterator it;
-	uint8_t flags = validate ? TUPLE_FORMAT_ITERATOR_VALIDATE : 0;
+	/*
+	 * Data not described in the format gets neither an
+	 * offset slot nor validation, so there is no need to
+	 * decode the tail of a document once all its indexed
+	 * paths have been found.
+	 */
+	uint8_t flags = TUPLE_FORMAT_ITERATOR_SKIP_UNKNOWN;
+	if (validate)
+		flags |= TUPLE_FORMAT_ITERATOR_VALIDATE;
 	if (tuple_format_iterator_create(&it, format, tuple, flags,
 					 &field_count, region) != 0)
 		return -1;
@@ -996,11 +1124,21 @@ tuple_format_iterator_create(struct tuple_format_iterator *it,
 	it->required_fields = NULL;
 	it->multikey_required_fields = NULL;
 	it->required_fields_sz = 0;
+	it->unseen_children = NULL;
+	it->seen_fields = NULL;
 
+	bool skip_unknown = flags & TUPLE_FORMAT_ITERATOR_SKIP_UNKNOWN;
 	uint32_t frames_sz = format->fields_depth * sizeof(struct mp_frame);
+	uint32_t unseen_children_sz = 0;
+	uint32_t seen_fields_sz = 0;
+	if (skip_unknown) {
+		unseen_children_sz = format->fields_depth * sizeof(uint32_t);
+		seen_fields_sz = bitmap_size(format->total_field_count);
+	}
 	if (validate)
 		it->required_fields_sz = bitmap_size(format->total_field_count);
-	uint32_t total_sz = frames_sz + 2 * it->required_fields_sz;
+	uint32_t total_sz = frames_sz + unseen_children_sz + seen_fields_sz +
+			    2 * it->required_fields_sz;
 	struct mp_frame *frames = region_aligned_alloc(region, total_sz,
 						       alignof(frames[0]));
 	if (frames == NULL) {
@@ -1016,12 +1154,20 @@ tuple_format_iterator_create(struct tuple_format_iterator *it,
 				   tuple_format_field_count(format));
 	mp_stack_push(&it->stack, MP_ARRAY, *defined_field_count);
 
+	char *pos = (char *)frames + frames_sz;
+	if (skip_unknown) {
+		it->unseen_children = (uint32_t *)pos;
+		it->unseen_children[0] = tuple_format_field_count(format);
+		pos += unseen_children_sz;
+		it->seen_fields = pos;
+		memset(it->seen_fields, 0, seen_fields_sz);
+		pos += seen_fields_sz;
+	}
 	if (validate) {
-		it->required_fields = (char *)frames + frames_sz;
+		it->required_fields = pos;
 		memcpy(it->required_fields, format->required_fields,
 		       it->required_fields_sz);
-		it->multikey_required_fields =
-			(char *)frames + frames_sz + it->required_fields_sz;
+		it->multikey_required_fields = pos + it->required_fields_sz;
 	}
 	return 0;
 }
@@ -1052,12 +1198,33 @@ tuple_format_required_fields_validate(struct tuple_format *format,
 	return 0;
 }
 
+/**
+ * If all format::fields children of the container represented
+ * by the given stack frame have been met, move the read
+ * position past the rest of the container.
+ */
+static inline void
+tuple_format_iterator_skip_unknown(struct tuple_format_iterator *it,
+				   struct mp_frame *frame)
+{
+	if ((it->flags & TUPLE_FORMAT_ITERATOR_SKIP_UNKNOWN) == 0 ||
+	    it->unseen_children[frame - it->stack.frames] > 0)
+		return;
+	int rest = frame->count - frame->idx - 1;
+	if (frame->type == MP_MAP)
+		rest *= 2;
+	for (; rest > 0; rest--)
+		mp_next(&it->pos);
+	frame->idx = frame->count - 1;
+}
+
 int
 tuple_format_iterator_next(struct tuple_format_iterator *it,
 			   struct tuple_format_iterator_entry *entry)
 {
-	entry->data = it->pos;
 	struct mp_frame *frame = mp_stack_top(&it->stack);
+	tuple_format_iterator_skip_unknown(it, frame);
+	entry->data = it->pos;
 	while (!mp_frame_advance(frame)) {
 		/*
 		 * If the elements of the current frame
@@ -1070,6 +1237,7 @@ tuple_format_iterator_next(struct tuple_format_iterator *it,
 		if (mp_stack_is_empty(&it->stack))
 			goto eof;
 		frame = mp_stack_top(&it->stack);
+		tuple_format_iterator_skip_unknown(it, frame);
 		if (json_token_is_multikey(it->parent)) {
 			/*
 			 * All multikey index entries have been
@@ -1125,6 +1293,17 @@ tuple_format_iterator_next(struct tuple_format_iterator *it,
 	struct tuple_field *field =
 		json_tree_lookup_entry(&it->format->fields, it->parent, &token,
 				       struct tuple_field, token);
+	/*
+	 * Fields of a multikey subtree are met once per array
+	 * item, so they are not counted.
+	 */
+	if (it->flags & TUPLE_FORMAT_ITERATOR_SKIP_UNKNOWN &&
+	    field != NULL && it->multikey_frame == NULL &&
+	    field->token.type != JSON_TOKEN_ANY &&
+	    !bit_test(it->seen_fields, field->id)) {
+		bit_set(it->seen_fields, field->id);
+		it->unseen_children[frame - it->stack.frames]--;
+	}
 	if (it->flags & TUPLE_FORMAT_ITERATOR_KEY_PARTS_ONLY &&
 	    field != NULL && !field->is_key_part)
 		field = NULL;
@@ -1152,6 +1331,11 @@ tuple_format_iterator_next(struct tuple_format_iterator *it,
 				mp_decode_map(&it->pos);
 		entry->count = size;
 		mp_stack_push(&it->stack, type, size);
+		if (it->flags & TUPLE_FORMAT_ITERATOR_SKIP_UNKNOWN) {
+			frame = mp_stack_top(&it->stack);
+			it->unseen_children[frame - it->stack.frames] =
+				field->child_count;
+		}
 		if (json_token_is_multikey(&field->token)) {
 			/**
 			 * Keep a pointer to the frame that
@@ -1189,7 +1373,14 @@ tuple_format_iterator_next(struct tuple_format_iterator *it,
 	 * defined in format.
 	 */
 	bool is_nullable = tuple_field_is_nullable(field);
-	if (!field_mp_type_is_compatible(field->type, entry->data, is_nullable) != 0) {
+	/*
+	 * The type of a compressed value is checked before
+	 * compression, see tuple_compress().
+	 */
+	bool is_compressed = field->compression_type != COMPRESSION_TYPE_NONE &&
+			     mp_is_compressed(entry->data);
+	if (!is_compressed &&
+	    !field_mp_type_is_compatible(field->type, entry->data, is_nullable)) {
 		diag_set(ClientError, ER_FIELD_TYPE,
 			 tuple_field_path(field),
 			 field_type_strs[field->type]);
@@ -134,6 +134,8 @@ struct tuple_field {
 	struct coll *coll;
 	/** Collation identifier. */
 	uint32_t coll_id;
+	/** Compression of the field value. */
+	enum compression_type compression_type;
 	/**
 	 * Bitmap of fields that must be present in a tuple
 	 * conforming to the multikey subtree. Not NULL only
@@ -141,6 +143,13 @@ struct tuple_field {
 	 * Indexed by tuple_field::id.
 	 */
 	void *multikey_required_fields;
+	/**
+	 * Number of children of this field in the format::fields
+	 * tree. Once the tuple format iterator has met all of
+	 * them, the rest of the map or array is skipped without
+	 * looking up its keys.
+	 */
+	uint32_t child_count;
 	/** Link in tuple_format::fields. */
 	struct json_token token;
 };
@@ -188,11 +197,41 @@ struct tuple_format {
 	 * in progress.
 	 */
 	bool is_temporary;
+	/**
+	 * Set while tuples of this format may only be stored in
+	 * the indexes of the memtx space the format belongs to.
+	 * Cleared on alter, because the indexes of the space are
+	 * moved to the new space along with the tuples.
+	 */
+	bool is_snapshot_tracked;
+	/**
+	 * Number of open memtx snapshot iterators over the space
+	 * this format belongs to. Tuples of a tracked format may
+	 * be freed immediately while it is zero even if tuple
+	 * delayed free mode is on, see memtx_tuple_delete().
+	 */
+	int snapshot_iterator_count;
 	/**
 	 * This format belongs to ephemeral space and thus might
 	 * be shared with other ephemeral spaces.
 	 */
 	bool is_ephemeral;
+	/** True if at least one field of the format is compressed. */
+	bool is_compressed;
+	/**
+	 * Format of decompressed copies of tuples, created on
+	 * demand, see tuple_decompress().
+	 */
+	struct tuple_format *plain_format;
+	/**
+	 * True if the field map of a tuple stores 16-bit offsets.
+	 * This is possible if only top-level fields are indexed
+	 * and all fields preceding them have types of bounded
+	 * size so that indexed fields are always located in the
+	 * first 64 KB of a tuple. Tuples of tiny spaces keyed by
+	 * numbers save 2 bytes per offset slot.
+	 */
+	bool is_field_map_compact;
 	/**
 	 * Size of minimal field map of tuple where each indexed
 	 * field has own offset slot (in bytes). The real tuple
@@ -332,6 +371,9 @@ tuple_format_unref(struct tuple_format *format)
  * @param exact_field_count Exact field count for format.
  * @param is_temporary Set if format belongs to temporary space.
  * @param is_ephemeral Set if format belongs to ephemeral space.
+ * @param allow_compact Set if all tuples of the format are
+ *        validated on creation, so the format may use a compact
+ *        field map if possible.
  *
  * @retval not NULL Tuple format.
  * @retval     NULL Memory error.
@@ -342,14 +384,15 @@ tuple_format_new(struct tuple_format_vtab *vtab, void *engine,
 		 const struct field_def *space_fields,
 		 uint32_t space_field_count, uint32_t exact_field_count,
 		 struct tuple_dictionary *dict, bool is_temporary,
-		 bool is_ephemeral);
+		 bool is_ephemeral, bool allow_compact);
 
 /**
  * Check, if @a format1 can store any tuples of @a format2. For
  * example, if a field is not nullable in format1 and the same
  * field is nullable in format2, or the field type is integer
  * in format1 and unsigned in format2, then format1 can not store
- * format2 tuples.
+ * format2 tuples. A nullable field added past the end of tuples
+ * of a format with a fixed field count doesn't need a check.
  * @param format1 tuple format to check for compatibility of
  * @param format2 tuple format to check compatibility with
  *
@@ -450,6 +493,13 @@ enum {
 	 * format::fields tree.
 	 */
 	TUPLE_FORMAT_ITERATOR_KEY_PARTS_ONLY 	= 1 << 1,
+	/**
+	 * This flag is set for iterator that should skip the
+	 * rest of a map or an array once all its children
+	 * present in format::fields tree have been met. No
+	 * entries are returned for the skipped data.
+	 */
+	TUPLE_FORMAT_ITERATOR_SKIP_UNKNOWN	= 1 << 2,
 };
 
 /**
@@ -477,6 +527,19 @@ struct tuple_format_iterator {
 	 * (format::fields_depth).
 	 */
 	struct mp_stack stack;
+	/**
+	 * Number of format::fields children of the container
+	 * represented by the stack frame with the same index
+	 * which haven't been met in the tuple yet.
+	 * Not NULL iff skip_unknown == true.
+	 */
+	uint32_t *unseen_children;
+	/**
+	 * Bitmap of fields that have already been met in the
+	 * tuple. Is used to not count a duplicate map key twice.
+	 * Not NULL iff skip_unknown == true.
+	 */
+	void *seen_fields;
 	/**
 	 * The pointer to the stack frame representing an array
 	 * filed that has JSON_TOKEN_ANY child, i.e. the root
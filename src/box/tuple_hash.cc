@@ -224,6 +224,76 @@ tuple_hash_slowpath(struct tuple *tuple, struct key_def *key_def);
 uint32_t
 key_hash_slowpath(const char *key, struct key_def *key_def);
 
+/**
+ * Return true if tuple_hash_field() hashes a field of the given
+ * type as is, including the MsgPack header.
+ */
+static inline bool
+field_type_is_hashed_raw(enum field_type type)
+{
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+	case FIELD_TYPE_BOOLEAN:
+	case FIELD_TYPE_VARBINARY:
+	case FIELD_TYPE_DECIMAL:
+	case FIELD_TYPE_UUID:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Hash key_def->part_count sequential fields starting at @a field.
+ * Adjacent fields hashed as is are fed to the hasher in one call:
+ * it is incremental, so the result is the same as if the fields
+ * were hashed one by one with tuple_hash_field().
+ */
+static inline uint32_t
+field_seq_hash(const char *field, struct key_def *key_def)
+{
+	uint32_t h = HASH_SEED;
+	uint32_t carry = 0;
+	uint32_t total_size = 0;
+	const char *raw = field;
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		if (key_def->parts[i].type != FIELD_TYPE_STRING) {
+			mp_next(&field);
+			continue;
+		}
+		if (field > raw) {
+			PMurHash32_Process(&h, &carry, raw, field - raw);
+			total_size += field - raw;
+		}
+		uint32_t size;
+		const char *str = mp_decode_str(&field, &size);
+		PMurHash32_Process(&h, &carry, str, size);
+		total_size += size;
+		raw = field;
+	}
+	if (field > raw) {
+		PMurHash32_Process(&h, &carry, raw, field - raw);
+		total_size += field - raw;
+	}
+	return PMurHash32_Result(h, carry, total_size);
+}
+
+static uint32_t
+tuple_hash_sequential(struct tuple *tuple, struct key_def *key_def)
+{
+	assert(!key_def->is_multikey);
+	const char *field = tuple_field_by_part(tuple, key_def->parts,
+						MULTIKEY_NONE);
+	return field_seq_hash(field, key_def);
+}
+
+static uint32_t
+key_hash_sequential(const char *key, struct key_def *key_def)
+{
+	return field_seq_hash(key, key_def);
+}
+
 void
 key_def_set_hash_func(struct key_def *key_def) {
 	if (key_def->is_nullable || key_def->has_json_paths)
@@ -258,6 +328,20 @@ key_def_set_hash_func(struct key_def *key_def) {
 			return;
 		}
 	}
+	/*
+	 * No pre-generated hasher for this combination of types,
+	 * but the key is still hashed without parsing field types
+	 * if all of them are strings or are hashed as is.
+	 */
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		enum field_type type = key_def->parts[i].type;
+		if (type != FIELD_TYPE_STRING &&
+		    !field_type_is_hashed_raw(type))
+			goto slowpath;
+	}
+	key_def->tuple_hash = tuple_hash_sequential;
+	key_def->key_hash = key_hash_sequential;
+	return;
 
 slowpath:
 	if (key_def->has_optional_parts) {
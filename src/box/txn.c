@@ -33,6 +33,7 @@
 #include "engine.h"
 #include "tuple.h"
 #include "journal.h"
+#include "memtx_tx.h"
 #include <fiber.h>
 #include "xrow.h"
 #include "errinj.h"
@@ -72,6 +73,7 @@ txn_add_redo(struct txn *txn, struct txn_stmt *stmt, struct request *request)
 		row->lsn = 0;
 		row->sync = 0;
 		row->tm = 0;
+		row->is_body_checked = false;
 	}
 	/*
 	 * Group ID should be set both for requests not having a
@@ -114,6 +116,8 @@ txn_stmt_new(struct region *region)
 	stmt->old_tuple = NULL;
 	stmt->new_tuple = NULL;
 	stmt->engine_savepoint = NULL;
+	stmt->add_story = NULL;
+	stmt->del_story = NULL;
 	stmt->row = NULL;
 	stmt->has_triggers = false;
 	return stmt;
@@ -205,6 +209,9 @@ txn_new(void)
 inline static void
 txn_free(struct txn *txn)
 {
+	if (txn->memtx_tx != NULL)
+		memtx_tx_delete(txn);
+
 	struct txn_stmt *stmt;
 	stailq_foreach_entry(stmt, &txn->stmts, next)
 		txn_stmt_destroy(stmt);
@@ -234,6 +241,7 @@ txn_begin(void)
 	txn->signature = TXN_SIGNATURE_ROLLBACK;
 	txn->engine = NULL;
 	txn->engine_tx = NULL;
+	txn->memtx_tx = NULL;
 	txn->fk_deferred_count = 0;
 	rlist_create(&txn->savepoints);
 	txn->fiber = NULL;
@@ -650,6 +658,12 @@ txn_prepare(struct txn *txn)
 		diag_set(ClientError, ER_FOREIGN_KEY_CONSTRAINT);
 		return -1;
 	}
+	/*
+	 * Check for conflicts of a transaction tracked by the
+	 * memtx transaction manager, even if it's read only.
+	 */
+	if (txn->memtx_tx != NULL && memtx_tx_prepare(txn) != 0)
+		return -1;
 	/*
 	 * Perform transaction conflict resolution. Engine == NULL when
 	 * we have a bunch of IPROTO_NOP statements.
@@ -824,7 +838,10 @@ txn_commit(struct txn *txn)
 	}
 
 	fiber_set_txn(fiber(), NULL);
-	if (journal_write(req) != 0 || req->res < 0) {
+	double wal_start = ev_monotonic_time();
+	int rc = journal_write(req);
+	fiber()->storage.net.wal_wait += ev_monotonic_time() - wal_start;
+	if (rc != 0 || req->res < 0) {
 		if (is_sync)
 			txn_limbo_abort(&txn_limbo, limbo_entry);
 		diag_set(ClientError, ER_WAL_IO);
@@ -844,7 +861,11 @@ txn_commit(struct txn *txn)
 			/* Local WAL write is a first 'ACK'. */
 			txn_limbo_ack(&txn_limbo, txn_limbo.instance_id, lsn);
 		}
-		if (txn_limbo_wait_complete(&txn_limbo, limbo_entry) < 0)
+		double limbo_start = ev_monotonic_time();
+		rc = txn_limbo_wait_complete(&txn_limbo, limbo_entry);
+		fiber()->storage.net.limbo_wait +=
+			ev_monotonic_time() - limbo_start;
+		if (rc < 0)
 			goto rollback;
 	}
 	assert(txn_has_flag(txn, TXN_IS_DONE));
@@ -866,6 +887,122 @@ rollback:
 	return -1;
 }
 
+static struct txn_future *
+txn_future_new(enum txn_future_state state)
+{
+	struct txn_future *future = malloc(sizeof(*future));
+	if (future == NULL) {
+		diag_set(OutOfMemory, sizeof(*future), "malloc", "future");
+		return NULL;
+	}
+	future->refs = 1;
+	future->state = state;
+	future->error = NULL;
+	fiber_cond_create(&future->cond);
+	return future;
+}
+
+void
+txn_future_unref(struct txn_future *future)
+{
+	assert(future->refs > 0);
+	if (--future->refs > 0)
+		return;
+	if (future->error != NULL)
+		error_unref(future->error);
+	fiber_cond_destroy(&future->cond);
+	free(future);
+}
+
+static void
+txn_future_set_state(struct txn_future *future, enum txn_future_state state)
+{
+	if (future->state >= state)
+		return;
+	future->state = state;
+	fiber_cond_broadcast(&future->cond);
+}
+
+static int
+txn_future_on_wal_write(struct trigger *trigger, void *event)
+{
+	(void)event;
+	txn_future_set_state(trigger->data, TXN_FUTURE_WAL);
+	return 0;
+}
+
+static int
+txn_future_commit_f(va_list ap)
+{
+	struct txn *txn = va_arg(ap, struct txn *);
+	struct txn_future *future = va_arg(ap, struct txn_future *);
+	fiber_set_txn(fiber(), txn);
+	if (txn_commit(txn) == 0) {
+		txn_future_set_state(future, TXN_FUTURE_COMMITTED);
+	} else {
+		future->error = diag_last_error(diag_get());
+		error_ref(future->error);
+		txn_future_set_state(future, TXN_FUTURE_FAILED);
+	}
+	txn_future_unref(future);
+	return 0;
+}
+
+struct txn_future *
+txn_commit_future(struct txn *txn)
+{
+	if (txn == NULL)
+		return txn_future_new(TXN_FUTURE_COMMITTED);
+	assert(txn == in_txn());
+	struct txn_future *future = txn_future_new(TXN_FUTURE_PENDING);
+	if (future == NULL)
+		goto rollback;
+	struct fiber *f = fiber_new("commit", txn_future_commit_f);
+	if (f == NULL) {
+		txn_future_unref(future);
+		goto rollback;
+	}
+	trigger_create(&future->on_wal_write, txn_future_on_wal_write,
+		       future, NULL);
+	txn_on_wal_write(txn, &future->on_wal_write);
+	/*
+	 * Detach the transaction from the current fiber. It is
+	 * free to yield and to start a new transaction now.
+	 */
+	trigger_clear(&txn->fiber_on_stop);
+	if (!txn_has_flag(txn, TXN_CAN_YIELD))
+		trigger_clear(&txn->fiber_on_yield);
+	fiber_set_txn(fiber(), NULL);
+	future->refs++;
+	/* Run until the WAL write is submitted. */
+	fiber_start(f, txn, future);
+	return future;
+rollback:
+	txn_rollback(txn);
+	txn_free(txn);
+	return NULL;
+}
+
+int
+txn_future_wait(struct txn_future *future, enum txn_future_state state,
+		double timeout)
+{
+	assert(state != TXN_FUTURE_FAILED);
+	double deadline = ev_monotonic_now(loop()) + timeout;
+	while (future->state < state) {
+		if (fiber_cond_wait_deadline(&future->cond, deadline) != 0) {
+			if (future->state >= state)
+				break;
+			return -1;
+		}
+	}
+	if (future->state == TXN_FUTURE_FAILED) {
+		diag_set_error(diag_get(), future->error);
+		return -1;
+	}
+	return 0;
+}
+
 void
 txn_rollback_stmt(struct txn *txn)
 {
@@ -35,6 +35,7 @@
 #include "salad/stailq.h"
 #include "trigger.h"
 #include "fiber.h"
+#include "fiber_cond.h"
 #include "space.h"
 
 #if defined(__cplusplus)
@@ -46,6 +47,8 @@ extern struct rmean *rmean_box;
 
 struct journal_entry;
 struct engine;
+struct memtx_story;
+struct memtx_tx;
 struct space;
 struct tuple;
 struct xrow_header;
@@ -137,6 +140,12 @@ struct txn_stmt {
 	struct tuple *new_tuple;
 	/** Engine savepoint for the start of this statement. */
 	void *engine_savepoint;
+	/**
+	 * Stories of the new and the old tuple kept by the memtx
+	 * transaction manager until the statement is prepared.
+	 */
+	struct memtx_story *add_story;
+	struct memtx_story *del_story;
 	/** Redo info: the binary log row */
 	struct xrow_header *row;
 	/** on_commit and/or on_rollback list is not empty. */
@@ -246,6 +255,8 @@ struct txn {
 	struct engine *engine;
 	/** Engine-specific transaction data */
 	void *engine_tx;
+	/** Memtx transaction manager state, see memtx_tx.h. */
+	struct memtx_tx *memtx_tx;
 	/* A fiber to wake up when transaction is finished. */
 	struct fiber *fiber;
 	/** Timestampt of entry write start. */
@@ -361,6 +372,70 @@ txn_complete_async(struct journal_entry *entry);
 int
 txn_commit_async(struct txn *txn);
 
+/** Progress of a transaction committed by txn_commit_future(). */
+enum txn_future_state {
+	/** The transaction is being written to WAL. */
+	TXN_FUTURE_PENDING,
+	/**
+	 * The transaction is written to WAL, but may still wait
+	 * for a quorum of replicas.
+	 */
+	TXN_FUTURE_WAL,
+	/** The transaction is committed. */
+	TXN_FUTURE_COMMITTED,
+	/** The transaction is rolled back. */
+	TXN_FUTURE_FAILED,
+};
+
+/**
+ * A handle to wait for a transaction, which commit is carried
+ * on in a background fiber.
+ */
+struct txn_future {
+	/** Reference counter. The commit fiber holds one. */
+	int refs;
+	enum txn_future_state state;
+	/** The reason of the rollback, if the state is FAILED. */
+	struct error *error;
+	/** Broadcast on each state change. */
+	struct fiber_cond cond;
+	/** Moves the future to the WAL state. */
+	struct trigger on_wal_write;
+};
+
+/**
+ * Commit a transaction without blocking the current fiber.
+ * @pre txn == in_txn()
+ *
+ * The transaction is detached from the current fiber and
+ * committed by a new one, exactly as txn_commit() does, including
+ * waiting for a quorum for synchronous spaces. The WAL write is
+ * submitted before the function returns, so transactions
+ * committed one after another from the same fiber go to WAL in
+ * the same order. Since the limbo confirms them in WAL order too,
+ * waiting for the last one is enough to wait for all of them.
+ *
+ * If @a txn is NULL, a completed future is returned.
+ *
+ * Return a future referenced once by the caller. On error the
+ * transaction is rolled back and NULL is returned.
+ */
+struct txn_future *
+txn_commit_future(struct txn *txn);
+
+/**
+ * Wait until the future reaches @a state or a later one.
+ * Return 0 on success, -1 with diag set if the transaction was
+ * rolled back or the timeout expired.
+ */
+int
+txn_future_wait(struct txn_future *future, enum txn_future_state state,
+		double timeout);
+
+/** Drop a reference to a future. */
+void
+txn_future_unref(struct txn_future *future);
+
 /**
  * Most txns don't have triggers, and txn objects
  * are created on every access to data, so txns
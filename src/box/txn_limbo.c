@@ -42,6 +42,7 @@ txn_limbo_create(struct txn_limbo *limbo)
 	fiber_cond_create(&limbo->wait_cond);
 	vclock_create(&limbo->vclock);
 	limbo->confirmed_lsn = 0;
+	limbo->is_in_confirm = false;
 	limbo->rollback_count = 0;
 	limbo->is_in_rollback = false;
 }
@@ -341,6 +342,31 @@ txn_limbo_write_confirm(struct txn_limbo *limbo, int64_t lsn)
 	txn_limbo_write_confirm_rollback(limbo, lsn, true);
 }
 
+/**
+ * Confirm all the entries up to the given LSN, which has just
+ * gathered a quorum. If another CONFIRM is being written now,
+ * only remember the LSN - the writer will confirm it with the
+ * next CONFIRM after its own one is finished. Thus ACKs arriving
+ * during a WAL write are coalesced into one CONFIRM, and all the
+ * transactions it covers are woken up at once.
+ */
+static void
+txn_limbo_confirm(struct txn_limbo *limbo, int64_t lsn)
+{
+	assert(lsn > limbo->confirmed_lsn);
+	assert(!limbo->is_in_rollback);
+	limbo->confirmed_lsn = lsn;
+	if (limbo->is_in_confirm)
+		return;
+	limbo->is_in_confirm = true;
+	do {
+		lsn = limbo->confirmed_lsn;
+		txn_limbo_write_confirm_rollback(limbo, lsn, true);
+		txn_limbo_read_confirm(limbo, lsn);
+	} while (lsn < limbo->confirmed_lsn);
+	limbo->is_in_confirm = false;
+}
+
 void
 txn_limbo_read_confirm(struct txn_limbo *limbo, int64_t lsn)
 {
@@ -488,8 +514,7 @@ txn_limbo_ack(struct txn_limbo *limbo, uint32_t replica_id, int64_t lsn)
 	}
 	if (confirm_lsn == -1 || confirm_lsn <= limbo->confirmed_lsn)
 		return;
-	txn_limbo_write_confirm(limbo, confirm_lsn);
-	txn_limbo_read_confirm(limbo, confirm_lsn);
+	txn_limbo_confirm(limbo, confirm_lsn);
 }
 
 /**
@@ -623,10 +648,8 @@ txn_limbo_on_parameters_change(struct txn_limbo *limbo)
 			assert(confirm_lsn > 0);
 		}
 	}
-	if (confirm_lsn > limbo->confirmed_lsn && !limbo->is_in_rollback) {
-		txn_limbo_write_confirm(limbo, confirm_lsn);
-		txn_limbo_read_confirm(limbo, confirm_lsn);
-	}
+	if (confirm_lsn > limbo->confirmed_lsn && !limbo->is_in_rollback)
+		txn_limbo_confirm(limbo, confirm_lsn);
 	/*
 	 * Wakeup all the others - timed out will rollback. Also
 	 * there can be non-transactional waiters, such as CONFIRM
@@ -132,6 +132,16 @@ struct txn_limbo {
 	 * illegal.
 	 */
 	int64_t confirmed_lsn;
+	/**
+	 * Whether some fiber is writing CONFIRM to WAL right now.
+	 * Quorums gathered during the write only bump
+	 * confirmed_lsn. The writer covers them with a single
+	 * CONFIRM once the current one is written, so under a
+	 * load of concurrent synchronous transactions there is
+	 * at most one CONFIRM in flight and each of them
+	 * completes a whole group of transactions.
+	 */
+	bool is_in_confirm;
 	/**
 	 * Total number of performed rollbacks. It used as a guard
 	 * to do some actions assuming all limbo transactions will
@@ -49,6 +49,8 @@ static struct user_map user_map_nil;
 
 struct mh_i32ptr_t *user_registry;
 
+uint32_t access_version;
+
 enum {
 	USER_ACCESS_FULL = (user_access_t)~0,
 };
@@ -389,6 +391,7 @@ user_reload_privs(struct user *user)
 	}
 	user_set_effective_access(user);
 	user->is_dirty = false;
+	access_version++;
 	struct credentials *creds;
 	user_access_t new_access = universe.access[user->auth_token].effective;
 	rlist_foreach_entry(creds, &user->credentials_list, in_user)
@@ -473,6 +476,7 @@ user_cache_replace(struct user_def *def)
 		free(user->def);
 	}
 	user->def = def;
+	access_version++;
 	return user;
 }
 
@@ -495,6 +499,7 @@ user_cache_delete(uint32_t uid)
 		 * all privileges from them first.
 		 */
 		mh_i32ptr_del(user_registry, k, NULL);
+		access_version++;
 	}
 }
 
@@ -794,6 +799,7 @@ credentials_create(struct credentials *cr, struct user *user)
 	cr->auth_token = user->auth_token;
 	cr->universal_access = universe.access[user->auth_token].effective;
 	cr->uid = user->def->uid;
+	memset(cr->access_cache, 0, sizeof(cr->access_cache));
 	rlist_add_entry(&user->credentials_list, cr, in_user);
 }
 
@@ -803,6 +809,7 @@ credentials_create_empty(struct credentials *cr)
 	cr->auth_token = BOX_USER_MAX;
 	cr->universal_access = 0;
 	cr->uid = BOX_USER_MAX;
+	memset(cr->access_cache, 0, sizeof(cr->access_cache));
 	rlist_create(&cr->in_user);
 }
 
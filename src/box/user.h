@@ -98,6 +98,13 @@ struct user
 	struct access access[BOX_USER_MAX];
 };
 
+/**
+ * Incremented on every change that may affect results of
+ * access checks: grants, users, spaces and functions.
+ * Invalidates access check caches of all credentials.
+ */
+extern uint32_t access_version;
+
 struct access *
 access_find(enum schema_object_type object_type, uint32_t object_id);
 
@@ -135,6 +142,43 @@ credentials_is_empty(const struct credentials *cr)
 void
 credentials_destroy(struct credentials *cr);
 
+/** Get the access check cache entry of @a object. */
+static inline struct credentials_access_cache *
+credentials_access_cache_get(struct credentials *cr, const void *object)
+{
+	uintptr_t i = ((uintptr_t)object >> 6) % CREDENTIALS_ACCESS_CACHE_SIZE;
+	return &cr->access_cache[i];
+}
+
+/**
+ * Check if @a access to @a object is known to be granted by
+ * a previous access check.
+ */
+static inline bool
+credentials_access_is_cached(struct credentials *cr, const void *object,
+			     user_access_t access)
+{
+	struct credentials_access_cache *entry =
+		credentials_access_cache_get(cr, object);
+	return entry->object == object && entry->version == access_version &&
+	       (access & ~entry->access) == 0;
+}
+
+/** Remember that @a access to @a object is granted. */
+static inline void
+credentials_access_cache_put(struct credentials *cr, const void *object,
+			     user_access_t access)
+{
+	struct credentials_access_cache *entry =
+		credentials_access_cache_get(cr, object);
+	if (entry->object != object || entry->version != access_version) {
+		entry->object = object;
+		entry->version = access_version;
+		entry->access = 0;
+	}
+	entry->access |= access;
+}
+
 /** Change source user of the credentials cache. */
 static inline void
 credentials_reset(struct credentials *cr, struct user *new_user)
@@ -46,6 +46,22 @@ extern "C" {
 extern const char *CHAP_SHA1_EMPTY_PASSWORD;
 
 typedef uint16_t user_access_t;
+
+enum {
+	/** Number of entries in the access check cache. */
+	CREDENTIALS_ACCESS_CACHE_SIZE = 4,
+};
+
+/** An entry of the access check cache of credentials. */
+struct credentials_access_cache {
+	/** Checked object: a struct space or a struct func. */
+	const void *object;
+	/** Value of access_version at the time of the check. */
+	uint32_t version;
+	/** Access known to be granted on the object. */
+	user_access_t access;
+};
+
 /**
  * Effective session user. A cache of user data
  * and access stored in session and fiber local storage.
@@ -62,6 +78,13 @@ struct credentials {
 	user_access_t universal_access;
 	/** User id of the authenticated user. */
 	uint32_t uid;
+	/**
+	 * Results of recent successful access checks, to make
+	 * checks for the same objects a single load and compare.
+	 * Indexed by the object address.
+	 */
+	struct credentials_access_cache
+		access_cache[CREDENTIALS_ACCESS_CACHE_SIZE];
 	/**
 	 * Member of credentials list of the source user. The list
 	 * is used to collect privilege updates to keep the
@@ -37,20 +37,6 @@
 #include "diag.h"
 #include "tt_static.h"
 
-int64_t
-vclock_follow(struct vclock *vclock, uint32_t replica_id, int64_t lsn)
-{
-	assert(lsn >= 0);
-	assert(replica_id < VCLOCK_MAX);
-	int64_t prev_lsn = vclock_get(vclock, replica_id);
-	assert(lsn > prev_lsn);
-	/* Easier add each time than check. */
-	vclock->map |= 1 << replica_id;
-	vclock->lsn[replica_id] = lsn;
-	vclock->signature += lsn - prev_lsn;
-	return prev_lsn;
-}
-
 static int
 vclock_snprint(char *buf, int size, const struct vclock *vclock)
 {
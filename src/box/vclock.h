@@ -98,9 +98,26 @@ struct vclock_c {
 	int64_t lsn;
 };
 
+/**
+ * Pop the lowest component id set in @a map. Return VCLOCK_MAX
+ * if the map is empty. Vclock maps fit in a word, so this is
+ * cheaper than a generic bit_iterator, which matters because
+ * vclocks are compared and iterated for every replicated row.
+ */
+static inline uint32_t
+vclock_map_next(vclock_map_t *map)
+{
+	if (*map == 0)
+		return VCLOCK_MAX;
+	uint32_t id = bit_ctz_u32(*map);
+	*map &= *map - 1;
+	return id;
+}
+
 struct vclock_iterator
 {
-	struct bit_iterator it;
+	/** Components not visited yet. */
+	vclock_map_t map;
 	const struct vclock *vclock;
 };
 
@@ -108,15 +125,14 @@ static inline void
 vclock_iterator_init(struct vclock_iterator *it, const struct vclock *vclock)
 {
 	it->vclock = vclock;
-	bit_iterator_init(&it->it, &vclock->map, sizeof(vclock->map), true);
+	it->map = vclock->map;
 }
 
 static inline struct vclock_c
 vclock_iterator_next(struct vclock_iterator *it)
 {
 	struct vclock_c c = { 0, 0 };
-	size_t id = bit_iterator_next(&it->it);
-	c.id = id == SIZE_MAX ? (int) VCLOCK_MAX : id;
+	c.id = vclock_map_next(&it->map);
 	if (c.id < VCLOCK_MAX)
 		c.lsn = it->vclock->lsn[c.id];
 	return c;
@@ -256,8 +272,19 @@ vclock_sum(const struct vclock *vclock)
  * @param lsn Next lsn.
  * @return previous lsn value.
  */
-int64_t
-vclock_follow(struct vclock *vclock, uint32_t replica_id, int64_t lsn);
+static inline int64_t
+vclock_follow(struct vclock *vclock, uint32_t replica_id, int64_t lsn)
+{
+	assert(lsn >= 0);
+	assert(replica_id < VCLOCK_MAX);
+	int64_t prev_lsn = vclock_get(vclock, replica_id);
+	assert(lsn > prev_lsn);
+	/* Easier add each time than check. */
+	vclock->map |= 1 << replica_id;
+	vclock->lsn[replica_id] = lsn;
+	vclock->signature += lsn - prev_lsn;
+	return prev_lsn;
+}
 
 /**
  * Merge all diff changes into the destination
@@ -315,14 +342,10 @@ vclock_compare_generic(const struct vclock *a, const struct vclock *b,
 {
 	bool le = true, ge = true;
 	vclock_map_t map = a->map | b->map;
-	struct bit_iterator it;
-	bit_iterator_init(&it, &map, sizeof(map), true);
-
-	size_t replica_id = bit_iterator_next(&it);
-	if (replica_id == 0 && ignore_zero)
-		replica_id = bit_iterator_next(&it);
-
-	for (; replica_id < VCLOCK_MAX; replica_id = bit_iterator_next(&it)) {
+	if (ignore_zero)
+		map &= ~1;
+	for (uint32_t replica_id = vclock_map_next(&map);
+	     replica_id < VCLOCK_MAX; replica_id = vclock_map_next(&map)) {
 		int64_t lsn_a = vclock_get(a, replica_id);
 		int64_t lsn_b = vclock_get(b, replica_id);
 		le = le && lsn_a <= lsn_b;
@@ -375,10 +398,8 @@ static inline int
 vclock_lex_compare(const struct vclock *a, const struct vclock *b)
 {
 	vclock_map_t map = a->map | b->map;
-	struct bit_iterator it;
-	bit_iterator_init(&it, &map, sizeof(map), true);
-	for(size_t replica_id = bit_iterator_next(&it); replica_id < VCLOCK_MAX;
-	    replica_id = bit_iterator_next(&it)) {
+	for (uint32_t replica_id = vclock_map_next(&map);
+	     replica_id < VCLOCK_MAX; replica_id = vclock_map_next(&map)) {
 		int64_t lsn_a = vclock_get(a, replica_id);
 		int64_t lsn_b = vclock_get(b, replica_id);
 		if (lsn_a < lsn_b)
@@ -399,14 +420,9 @@ vclock_lex_compare(const struct vclock *a, const struct vclock *b)
 static inline void
 vclock_min_ignore0(struct vclock *a, const struct vclock *b)
 {
-	vclock_map_t map = a->map | b->map;
-	struct bit_iterator it;
-	bit_iterator_init(&it, &map, sizeof(map), true);
-	size_t replica_id = bit_iterator_next(&it);
-	if (replica_id == 0)
-		replica_id = bit_iterator_next(&it);
-
-	for( ; replica_id < VCLOCK_MAX; replica_id = bit_iterator_next(&it)) {
+	vclock_map_t map = (a->map | b->map) & ~1;
+	for (uint32_t replica_id = vclock_map_next(&map);
+	     replica_id < VCLOCK_MAX; replica_id = vclock_map_next(&map)) {
 		int64_t lsn_a = vclock_get(a, replica_id);
 		int64_t lsn_b = vclock_get(b, replica_id);
 		if (lsn_a <= lsn_b)
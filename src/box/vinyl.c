@@ -65,11 +65,13 @@
 #include "engine.h"
 #include "space.h"
 #include "index.h"
+#include "port.h"
 #include "schema.h"
 #include "xstream.h"
 #include "info/info.h"
 #include "column_mask.h"
 #include "trigger.h"
+#include "latch.h"
 #include "wal.h" /* wal_mode() */
 
 /**
@@ -257,8 +259,12 @@ vy_info_append_regulator(struct vy_env *env, struct info_handler *h)
 
 	info_table_begin(h, "regulator");
 	info_append_int(h, "write_rate", r->write_rate);
+	info_append_int(h, "write_rate_forecast", r->write_rate_forecast);
+	info_append_int(h, "bursts", r->burst_count);
 	info_append_int(h, "dump_bandwidth", r->dump_bandwidth);
 	info_append_int(h, "dump_watermark", r->dump_watermark);
+	info_append_int(h, "dumps_by_watermark", r->dump_count_watermark);
+	info_append_int(h, "dumps_by_quota", r->dump_count_quota);
 	info_append_int(h, "rate_limit", vy_quota_get_rate_limit(r->quota,
 							VY_QUOTA_CONSUMER_TX));
 	info_table_end(h); /* regulator */
@@ -274,6 +280,11 @@ vy_info_append_tx(struct vy_env *env, struct info_handler *h)
 	info_append_int(h, "commit", xm->stat.commit);
 	info_append_int(h, "rollback", xm->stat.rollback);
 	info_append_int(h, "conflict", xm->stat.conflict);
+	info_append_int(h, "conflict_check", xm->stat.conflict_check);
+	info_append_int(h, "conflict_check_skip",
+			xm->stat.conflict_check_skip);
+	info_append_int(h, "conflict_check_visit",
+			xm->stat.conflict_check_visit);
 
 	struct mempool_stats mstats;
 	mempool_stats(&xm->tx_mempool, &mstats);
@@ -296,10 +307,22 @@ vy_info_append_memory(struct vy_env *env, struct info_handler *h)
 	info_append_int(h, "level0", lsregion_used(&env->mem_env.allocator));
 	info_append_int(h, "tuple_cache", env->cache_env.mem_used);
 	info_append_int(h, "page_index", env->lsm_env.page_index_size);
-	info_append_int(h, "bloom_filter", env->lsm_env.bloom_size);
+	info_append_int(h, "bloom_filter", env->lsm_env.bloom_size -
+			env->lsm_env.xor_filter_size);
+	info_append_int(h, "xor_filter", env->lsm_env.xor_filter_size);
 	info_table_end(h); /* memory */
 }
 
+static void
+vy_info_append_upsert(struct vy_env *env, struct info_handler *h)
+{
+	info_table_begin(h, "upsert");
+	info_append_int(h, "squashed", env->lsm_env.upsert_stat.squashed);
+	info_append_int(h, "applied_on_read",
+			env->lsm_env.upsert_stat.applied_on_read);
+	info_table_end(h); /* upsert */
+}
+
 static void
 vy_info_append_disk(struct vy_env *env, struct info_handler *h)
 {
@@ -321,6 +344,7 @@ vinyl_engine_stat(struct engine *engine, struct info_handler *h)
 	vy_info_append_disk(env, h);
 	vy_info_append_scheduler(env, h);
 	vy_info_append_regulator(env, h);
+	vy_info_append_upsert(env, h);
 	info_end(h);
 }
 
@@ -430,8 +454,10 @@ vinyl_index_stat(struct index *index, struct info_handler *h)
 	info_table_begin(h, "cache");
 	vy_info_append_stmt_counter(h, NULL, &cache_stat->count);
 	info_append_int(h, "lookup", cache_stat->lookup);
+	info_append_int(h, "miss", cache_stat->miss);
 	vy_info_append_stmt_counter(h, "get", &cache_stat->get);
 	vy_info_append_stmt_counter(h, "put", &cache_stat->put);
+	vy_info_append_stmt_counter(h, "promote", &cache_stat->promote);
 	vy_info_append_stmt_counter(h, "invalidate", &cache_stat->invalidate);
 	vy_info_append_stmt_counter(h, "evict", &cache_stat->evict);
 	info_append_int(h, "index_size",
@@ -492,8 +518,10 @@ vinyl_index_reset_stat(struct index *index)
 
 	/* Cache */
 	cache_stat->lookup = 0;
+	cache_stat->miss = 0;
 	vy_stmt_counter_reset(&cache_stat->get);
 	vy_stmt_counter_reset(&cache_stat->put);
+	vy_stmt_counter_reset(&cache_stat->promote);
 	vy_stmt_counter_reset(&cache_stat->invalidate);
 	vy_stmt_counter_reset(&cache_stat->evict);
 }
@@ -522,6 +550,7 @@ vinyl_engine_reset_stat(struct engine *engine)
 
 	vy_scheduler_reset_stat(&env->scheduler);
 	vy_regulator_reset_stat(&env->regulator);
+	memset(&env->lsm_env.upsert_stat, 0, sizeof(env->lsm_env.upsert_stat));
 }
 
 /** }}} Introspection */
@@ -582,6 +611,18 @@ vinyl_engine_check_space_def(struct space_def *def)
 			 def->name, "engine does not support temporary flag");
 		return -1;
 	}
+	if (def->opts.expire_field != UINT32_MAX) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "tuple expiration");
+		return -1;
+	}
+	for (uint32_t i = 0; i < def->field_count; i++) {
+		if (def->fields[i].compression_type != COMPRESSION_TYPE_NONE) {
+			diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+				 "field compression");
+			return -1;
+		}
+	}
 	return 0;
 }
 
@@ -683,6 +724,22 @@ vinyl_space_check_index_def(struct space *space, struct index_def *index_def)
 			 "functional index");
 		return -1;
 	}
+	if (index_def->opts.count_keys) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl", "count_keys");
+		return -1;
+	}
+	/*
+	 * Secondary index statements don't store non-indexed
+	 * fields so expiration can't be checked without them.
+	 */
+	if (index_def->opts.ttl > 0 && index_def->iid > 0 &&
+	    key_def_find_by_fieldno(index_def->cmp_def,
+				    index_def->opts.ttl_field) == NULL) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "ttl_field must be indexed");
+		return -1;
+	}
 	return 0;
 }
 
@@ -955,6 +1012,9 @@ vinyl_index_def_change_requires_rebuild(struct index *index,
 	 */
 	if (old_cmp_def->part_count != new_cmp_def->part_count)
 		return true;
+	/* Hints are built differently, see key_def::hint_part_count. */
+	if (old_cmp_def->hint_part_count != new_cmp_def->hint_part_count)
+		return true;
 
 	for (uint32_t i = 0; i < new_cmp_def->part_count; i++) {
 		const struct key_part *old_part = &old_cmp_def->parts[i];
@@ -1216,6 +1276,138 @@ vinyl_index_bsize(struct index *index)
 	return bsize;
 }
 
+static int
+vinyl_index_estimate_eq(struct index *index, uint64_t *eq)
+{
+	/*
+	 * Use the page index of the biggest run, which is kept
+	 * in memory: if a key prefix changes only at a few page
+	 * boundaries, tuples sharing it span several pages and
+	 * its average count can be derived from page row counts.
+	 * Otherwise the prefix is too selective to tell anything
+	 * and the estimate is left unknown.
+	 */
+	struct vy_lsm *lsm = vy_lsm(index);
+	struct vy_run *run, *biggest = NULL;
+	rlist_foreach_entry(run, &lsm->runs, in_lsm) {
+		if (biggest == NULL ||
+		    run->info.page_count > biggest->info.page_count)
+			biggest = run;
+	}
+	if (biggest == NULL || biggest->info.page_count < 2)
+		return -1;
+	uint32_t part_count = index->def->key_def->part_count;
+	uint64_t distinct[part_count];
+	for (uint32_t i = 0; i < part_count; i++)
+		distinct[i] = 1;
+	uint64_t row_count = 0;
+	const char *prev = NULL;
+	for (uint32_t pos = 0; pos < biggest->info.page_count; pos++) {
+		struct vy_page_info *page = vy_run_page_info(biggest, pos);
+		row_count += page->row_count;
+		const char *key = page->min_key;
+		uint32_t key_part_count = mp_decode_array(&key);
+		if (prev == NULL) {
+			prev = key;
+			continue;
+		}
+		const char *cur = key;
+		const char *prev_key = prev;
+		uint32_t i = 0;
+		for (; i < MIN(part_count, key_part_count); i++) {
+			const char *cur_end = cur;
+			const char *prev_end = prev_key;
+			mp_next(&cur_end);
+			mp_next(&prev_end);
+			if (cur_end - cur != prev_end - prev_key ||
+			    memcmp(cur, prev_key, cur_end - cur) != 0)
+				break;
+			cur = cur_end;
+			prev_key = prev_end;
+		}
+		/* Prefixes starting from the first differing part. */
+		for (; i < part_count; i++)
+			distinct[i]++;
+		prev = key;
+	}
+	uint32_t page_count = biggest->info.page_count;
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (distinct[i] * 2 <= page_count)
+			eq[i] = MAX(row_count / distinct[i], 1);
+		else
+			eq[i] = 0;
+	}
+	return 0;
+}
+
+static int
+vinyl_index_split(struct index *index, uint32_t count, struct port *port)
+{
+	/*
+	 * Compaction splits and coalesces ranges so as to keep
+	 * them of about the same size, so just group adjacent
+	 * ranges until each group gets its share of disk data.
+	 * Boundaries of a secondary index range include primary
+	 * key parts: cut them off so that the keys returned can
+	 * be compared with the index key definition.
+	 */
+	struct vy_lsm *lsm = vy_lsm(index);
+	count = MIN(count, (uint32_t)lsm->range_count);
+	if (count < 2)
+		return 0;
+	int64_t total = 0;
+	struct vy_range *range;
+	for (range = vy_range_tree_first(&lsm->range_tree); range != NULL;
+	     range = vy_range_tree_next(&lsm->range_tree, range))
+		total += range->count.bytes;
+	int64_t share = total / count;
+	if (share == 0)
+		return 0;
+	uint32_t part_count = index->def->key_def->part_count;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	const char *prev = NULL, *prev_end = NULL;
+	int64_t bytes = 0;
+	uint32_t split_count = 0;
+	for (range = vy_range_tree_first(&lsm->range_tree);
+	     range != NULL && split_count < count - 1;
+	     bytes += range->count.bytes,
+	     range = vy_range_tree_next(&lsm->range_tree, range)) {
+		if (range->begin.stmt == NULL ||
+		    bytes < share * (split_count + 1))
+			continue;
+		const char *key = tuple_data(range->begin.stmt);
+		uint32_t key_part_count = mp_decode_array(&key);
+		key_part_count = MIN(key_part_count, part_count);
+		const char *key_end = key;
+		for (uint32_t i = 0; i < key_part_count; i++)
+			mp_next(&key_end);
+		/* Equal boundaries would make an empty range. */
+		if (key_part_count == 0 || (prev != NULL &&
+		    key_end - key == prev_end - prev &&
+		    memcmp(key, prev, key_end - key) == 0))
+			continue;
+		size_t size = mp_sizeof_array(key_part_count) + (key_end - key);
+		char *buf = region_alloc(region, size);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, size, "region_alloc", "key");
+			region_truncate(region, region_svp);
+			return -1;
+		}
+		char *data = mp_encode_array(buf, key_part_count);
+		memcpy(data, key, key_end - key);
+		if (port_c_add_mp(port, buf, buf + size) != 0) {
+			region_truncate(region, region_svp);
+			return -1;
+		}
+		prev = key;
+		prev_end = key_end;
+		split_count++;
+	}
+	region_truncate(region, region_svp);
+	return 0;
+}
+
 static void
 vinyl_index_compact(struct index *index)
 {
@@ -1741,13 +1933,15 @@ vy_delete(struct vy_env *env, struct vy_tx *tx, struct txn_stmt *stmt,
 	if (vy_unique_key_validate(lsm, key, part_count))
 		return -1;
 	/*
-	 * There are two cases when need to get the full tuple
+	 * There are three cases when need to get the full tuple
 	 * before deletion.
 	 * - if the space has on_replace triggers and need to pass
 	 *   to them the old tuple.
 	 * - if deletion is done by a secondary index.
+	 * - if deletion from secondary indexes can't be deferred.
 	 */
-	if (lsm->index_id > 0 || !rlist_empty(&space->on_replace)) {
+	if (lsm->index_id > 0 || !rlist_empty(&space->on_replace) ||
+	    (space->index_count > 1 && !space->def->opts.defer_deletes)) {
 		if (vy_get_by_raw_key(lsm, tx, vy_tx_read_view(tx),
 				      key, part_count, &stmt->old_tuple) != 0)
 			return -1;
@@ -2268,9 +2462,12 @@ vy_replace(struct vy_env *env, struct vy_tx *tx, struct txn_stmt *stmt,
 	/*
 	 * Get the overwritten tuple from the primary index if
 	 * the space has on_replace triggers, in which case we
-	 * need to pass the old tuple to trigger callbacks.
+	 * need to pass the old tuple to trigger callbacks, or
+	 * if it must be deleted from secondary indexes right
+	 * away.
 	 */
-	if (!rlist_empty(&space->on_replace)) {
+	if (!rlist_empty(&space->on_replace) ||
+	    (space->index_count > 1 && !space->def->opts.defer_deletes)) {
 		if (vy_get(pk, tx, vy_tx_read_view(tx),
 			   stmt->new_tuple, &stmt->old_tuple) != 0)
 			return -1;
@@ -2381,6 +2578,63 @@ vinyl_space_execute_upsert(struct space *space, struct txn *txn,
 	return vy_upsert(env, tx, stmt, space, request);
 }
 
+/**
+ * Return true if the range tombstone created by the WAL row being
+ * replayed has already been recovered from the metadata log.
+ */
+static bool
+vy_range_delete_is_recovered(struct vy_env *env, struct vy_lsm *pk)
+{
+	if (vy_is_committed(env, pk))
+		return true;
+	if (env->status != VINYL_FINAL_RECOVERY_LOCAL)
+		return false;
+	int64_t lsn = vclock_sum(env->recovery_vclock);
+	struct vy_range_tombstone *tombstone;
+	rlist_foreach_entry(tombstone, &pk->range_tombstones, in_lsm) {
+		if (tombstone->lsn == lsn)
+			return true;
+	}
+	return false;
+}
+
+static int
+vinyl_space_execute_delete_range(struct space *space, struct txn *txn,
+				 struct request *request)
+{
+	struct vy_env *env = vy_env(space->engine);
+	struct vy_tx *tx = txn->engine_tx;
+	struct vy_lsm *pk = vy_lsm_find(space, 0);
+	if (pk == NULL)
+		return -1;
+	/*
+	 * Range tombstones are only applied to the primary index
+	 * so secondary indexes would return deleted tuples.
+	 */
+	if (request->index_id != 0 || space->index_count > 1) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "delete_range() in a space with secondary indexes");
+		return -1;
+	}
+	if (tx->range_delete != NULL || !write_set_empty(&tx->write_set)) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "delete_range() mixed with other statements "
+			 "in a transaction");
+		return -1;
+	}
+	const char *begin = request->key;
+	const char *end = request->tuple;
+	uint32_t begin_part_count = mp_decode_array(&begin);
+	uint32_t end_part_count = mp_decode_array(&end);
+	if (key_validate(pk->base.def, ITER_GE, begin,
+			 begin_part_count) != 0 ||
+	    key_validate(pk->base.def, ITER_LT, end, end_part_count) != 0)
+		return -1;
+	if (vy_range_delete_is_recovered(env, pk))
+		return 0;
+	return vy_tx_delete_range(tx, pk, request->key, request->tuple);
+}
+
 static int
 vinyl_engine_begin(struct engine *engine, struct txn *txn)
 {
@@ -2392,6 +2646,26 @@ vinyl_engine_begin(struct engine *engine, struct txn *txn)
 	return 0;
 }
 
+/**
+ * Return the quota share of the space modified by a transaction
+ * or NULL if the transaction modifies more than one space.
+ */
+static struct vy_quota_share *
+vy_tx_quota_share(struct vy_tx *tx)
+{
+	struct vy_lsm *pk = NULL;
+	struct txv *v;
+	for (v = write_set_first(&tx->write_set); v != NULL;
+	     v = write_set_next(&tx->write_set, v)) {
+		struct vy_lsm *lsm = v->lsm->pk != NULL ? v->lsm->pk : v->lsm;
+		if (pk == NULL)
+			pk = lsm;
+		else if (pk != lsm)
+			return NULL;
+	}
+	return pk != NULL ? &pk->quota_share : NULL;
+}
+
 static int
 vinyl_engine_prepare(struct engine *engine, struct txn *txn)
 {
@@ -2417,7 +2691,8 @@ vinyl_engine_prepare(struct engine *engine, struct txn *txn)
 	 * the transaction to be sent to read view or aborted, we call
 	 * it before checking for conflicts.
 	 */
-	if (vy_quota_use(&env->quota, VY_QUOTA_CONSUMER_TX,
+	struct vy_quota_share *share = vy_tx_quota_share(tx);
+	if (vy_quota_use(&env->quota, VY_QUOTA_CONSUMER_TX, share,
 			 tx->write_size, timeout) != 0)
 		return -1;
 
@@ -2427,7 +2702,7 @@ vinyl_engine_prepare(struct engine *engine, struct txn *txn)
 
 	size_t mem_used_after = lsregion_used(&env->mem_env.allocator);
 	assert(mem_used_after >= mem_used_before);
-	vy_quota_adjust(&env->quota, VY_QUOTA_CONSUMER_TX,
+	vy_quota_adjust(&env->quota, VY_QUOTA_CONSUMER_TX, share,
 			tx->write_size, mem_used_after - mem_used_before);
 	vy_regulator_check_dump_watermark(&env->regulator);
 	return rc;
@@ -2565,8 +2840,8 @@ vy_squash_schedule(struct vy_lsm *lsm, struct vy_entry entry,
 		   void /* struct vy_env */ *arg);
 
 static struct vy_env *
-vy_env_new(const char *path, size_t memory,
-	   int read_threads, int write_threads, bool force_recovery)
+vy_env_new(const char *path, size_t memory, int read_threads,
+	   int write_threads, int dump_threads, bool force_recovery)
 {
 	struct vy_env *e = malloc(sizeof(*e));
 	if (unlikely(e == NULL)) {
@@ -2593,7 +2868,7 @@ vy_env_new(const char *path, size_t memory,
 
 	vy_stmt_env_create(&e->stmt_env);
 	vy_mem_env_create(&e->mem_env, memory);
-	vy_scheduler_create(&e->scheduler, write_threads,
+	vy_scheduler_create(&e->scheduler, write_threads, dump_threads,
 			    vy_env_dump_complete_cb,
 			    &e->run_env, &e->xm->read_views);
 
@@ -2663,16 +2938,18 @@ vy_env_complete_recovery(struct vy_env *env)
 }
 
 struct engine *
-vinyl_engine_new(const char *dir, size_t memory,
-		 int read_threads, int write_threads, bool force_recovery)
+vinyl_engine_new(const char *dir, size_t memory, int read_threads,
+		 int write_threads, int dump_threads, bool force_recovery)
 {
 	struct vy_env *env = vy_env_new(dir, memory, read_threads,
-					write_threads, force_recovery);
+					write_threads, dump_threads,
+					force_recovery);
 	if (env == NULL)
 		return NULL;
 
 	env->base.vtab = &vinyl_engine_vtab;
 	env->base.name = "vinyl";
+	env->base.flags = ENGINE_KEY_ITERATOR;
 	return &env->base;
 }
 
@@ -2690,6 +2967,42 @@ vinyl_engine_set_cache(struct engine *engine, size_t quota)
 	vy_cache_env_set_quota(&env->cache_env, quota);
 }
 
+void
+vinyl_engine_set_page_cache(struct engine *engine, size_t quota)
+{
+	struct vy_env *env = vy_env(engine);
+	vy_run_env_set_page_cache(&env->run_env, quota);
+}
+
+void
+vinyl_engine_set_max_subcompactions(struct engine *engine,
+				    int max_subcompactions)
+{
+	struct vy_env *env = vy_env(engine);
+	env->scheduler.max_subcompactions = max_subcompactions;
+}
+
+void
+vinyl_engine_set_compaction_direct_io(struct engine *engine, bool value)
+{
+	struct vy_env *env = vy_env(engine);
+	env->run_env.compaction_direct_io = value;
+}
+
+void
+vinyl_engine_set_compaction_readahead(struct engine *engine, size_t size)
+{
+	struct vy_env *env = vy_env(engine);
+	env->run_env.compaction_readahead = size;
+}
+
+void
+vinyl_engine_set_blob_threshold(struct engine *engine, size_t size)
+{
+	struct vy_env *env = vy_env(engine);
+	env->run_env.blob_threshold = size;
+}
+
 int
 vinyl_engine_set_memory(struct engine *engine, size_t size)
 {
@@ -2717,6 +3030,16 @@ vinyl_engine_set_timeout(struct engine *engine, double timeout)
 	env->timeout = timeout;
 }
 
+void
+vinyl_engine_set_upsert_squash_threshold(struct engine *engine,
+					 int threshold)
+{
+	static_assert(VINYL_UPSERT_SQUASH_THRESHOLD_MAX == VY_UPSERT_THRESHOLD,
+		      "upsert squash threshold doesn't fit n_upserts");
+	struct vy_env *env = vy_env(engine);
+	env->lsm_env.upsert_squash_threshold = threshold;
+}
+
 void
 vinyl_engine_set_too_long_threshold(struct engine *engine,
 				    double too_long_threshold)
@@ -2917,6 +3240,11 @@ vinyl_engine_end_recovery(struct engine *engine)
 	 */
 	if (e->lsm_env.lsm_count > 0)
 		vy_run_env_enable_coio(&e->run_env);
+	/*
+	 * Bloom filters of runs recovered from disk are loaded
+	 * in the background so as not to delay startup.
+	 */
+	vy_lsm_env_start_bloom_loader(&e->lsm_env);
 
 	e->status = VINYL_ONLINE;
 	return 0;
@@ -2934,6 +3262,14 @@ struct vy_join_entry {
 
 struct vy_join_ctx {
 	struct rlist entries;
+	/** The next entry in the list to be sent by a fiber. */
+	struct rlist *next_entry;
+	/** Stream the spaces are sent to. */
+	struct xstream *stream;
+	/** Serializes writes of the fibers to the stream. */
+	struct latch latch;
+	/** Set if any of the fibers failed. */
+	bool is_failed;
 };
 
 static int
@@ -3002,31 +3338,97 @@ vy_join_send_tuple(struct xstream *stream, uint32_t space_id,
 	return xstream_write(stream, &row);
 }
 
+/**
+ * Send spaces picked from the join list one by one until the
+ * list is exhausted. Run by every join fiber.
+ */
 static int
-vinyl_engine_join(struct engine *engine, void *arg, struct xstream *stream)
+vy_join_send_entries(struct vy_join_ctx *ctx)
 {
-	(void)engine;
 	int loops = 0;
-	struct vy_join_ctx *ctx = arg;
-	struct vy_join_entry *entry;
-	rlist_foreach_entry(entry, &ctx->entries, in_ctx) {
+	while (!ctx->is_failed && ctx->next_entry != &ctx->entries) {
+		struct vy_join_entry *entry = rlist_entry(ctx->next_entry,
+				struct vy_join_entry, in_ctx);
+		ctx->next_entry = ctx->next_entry->next;
 		struct snapshot_iterator *it = entry->iterator;
 		int rc;
 		uint32_t size;
 		const char *data;
 		while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
-			if (vy_join_send_tuple(stream, entry->space_id,
-					       data, size) != 0)
-				return -1;
+			latch_lock(&ctx->latch);
+			rc = vy_join_send_tuple(ctx->stream, entry->space_id,
+						data, size);
+			latch_unlock(&ctx->latch);
+			if (rc != 0 || ctx->is_failed)
+				break;
 		}
-		if (rc != 0)
+		if (rc != 0) {
+			ctx->is_failed = true;
 			return -1;
+		}
 		if (++loops % VY_YIELD_LOOPS == 0)
 			fiber_sleep(0);
 	}
 	return 0;
 }
 
+static int
+vy_join_f(va_list ap)
+{
+	struct vy_join_ctx *ctx = va_arg(ap, struct vy_join_ctx *);
+	return vy_join_send_entries(ctx);
+}
+
+static int
+vinyl_engine_join(struct engine *engine, void *arg, struct xstream *stream)
+{
+	struct vy_env *env = vy_env(engine);
+	struct vy_join_ctx *ctx = arg;
+	ctx->next_entry = rlist_first(&ctx->entries);
+	ctx->stream = stream;
+	ctx->is_failed = false;
+	latch_create(&ctx->latch);
+	/*
+	 * Spaces are read by as many fibers as there are reader
+	 * threads so that disk reads of different spaces overlap.
+	 * Rows of different spaces are interleaved in the stream,
+	 * which is fine, because all vinyl spaces are created by
+	 * the memtx part of the join, which is sent before.
+	 */
+	int fiber_count = env->run_env.reader_pool_size - 1;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size_t size = sizeof(struct fiber *) * MAX(fiber_count, 1);
+	struct fiber **fibers = region_alloc(region, size);
+	if (fibers == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "fibers");
+		latch_destroy(&ctx->latch);
+		return -1;
+	}
+	int started = 0;
+	for (; started < fiber_count; started++) {
+		fibers[started] = fiber_new("vinyl.join", vy_join_f);
+		if (fibers[started] == NULL) {
+			/* Proceed with fewer fibers. */
+			diag_log();
+			break;
+		}
+		fiber_set_joinable(fibers[started], true);
+		fiber_start(fibers[started], ctx);
+	}
+	int rc = vy_join_send_entries(ctx);
+	/* Preserve the first error, the fibers are joined anyway. */
+	for (int i = 0; i < started; i++) {
+		if (rc == 0)
+			rc = fiber_join(fibers[i]);
+		else if (fiber_join(fibers[i]) != 0)
+			diag_log();
+	}
+	region_truncate(region, region_svp);
+	latch_destroy(&ctx->latch);
+	return rc;
+}
+
 static void
 vinyl_engine_complete_join(struct engine *engine, void *arg)
 {
@@ -3215,6 +3617,11 @@ vinyl_engine_backup(struct engine *engine, const struct vclock *vclock,
 				if (rc != 0)
 					goto out;
 			}
+			rc = vy_run_foreach_blob(env->path, lsm_info->space_id,
+						 lsm_info->index_id,
+						 run_info->id, cb, cb_arg);
+			if (rc != 0)
+				goto out;
 			if (loops % VY_YIELD_LOOPS == 0)
 				fiber_sleep(0);
 		}
@@ -3339,6 +3746,7 @@ vy_squash_process(struct vy_squash *squash)
 	}
 
 	lsm->stat.upsert.squashed++;
+	lsm->env->upsert_stat.squashed++;
 
 	/*
 	 * Insert the resulting REPLACE statement to the mem
@@ -3624,6 +4032,65 @@ fail:
 	return -1;
 }
 
+/**
+ * Iterate over a secondary index returning extended keys
+ * without looking up full tuples in the primary index. Used
+ * only for spaces that don't defer deletes, because otherwise
+ * a secondary index may contain stale keys, which can only be
+ * filtered out by a primary index lookup. The tuple cache is
+ * not populated as it stores full tuples.
+ */
+static int
+vinyl_iterator_key_next(struct iterator *base, struct tuple **ret)
+{
+	double start_time = ev_monotonic_now(loop());
+
+	assert(base->next == vinyl_iterator_key_next);
+	struct vinyl_iterator *it = (struct vinyl_iterator *)base;
+	struct vy_lsm *lsm = it->iterator.lsm;
+	assert(lsm->index_id > 0);
+	vy_lsm_ref(lsm);
+
+	if (vinyl_iterator_check_tx(it) != 0)
+		goto fail;
+
+	struct vy_entry partial;
+	if (vy_read_iterator_next(&it->iterator, &partial) != 0)
+		goto fail;
+	if (partial.stmt == NULL) {
+		/* EOF. Close the iterator immediately. */
+		vinyl_iterator_account_read(it, start_time, NULL);
+		vinyl_iterator_close(it);
+		*ret = NULL;
+		goto out;
+	}
+	/*
+	 * Statements read from disk are keys already, while
+	 * those read from memory are full tuples.
+	 */
+	struct tuple *key;
+	if (vy_stmt_is_key(partial.stmt)) {
+		key = partial.stmt;
+		tuple_ref(key);
+	} else {
+		key = vy_stmt_extract_key(partial.stmt, lsm->cmp_def,
+					  lsm->env->key_format, MULTIKEY_NONE);
+		if (key == NULL)
+			goto fail;
+	}
+	vinyl_iterator_account_read(it, start_time, key);
+	*ret = key;
+	tuple_bless(key);
+	tuple_unref(key);
+out:
+	vy_lsm_unref(lsm);
+	return 0;
+fail:
+	vinyl_iterator_close(it);
+	vy_lsm_unref(lsm);
+	return -1;
+}
+
 static void
 vinyl_iterator_free(struct iterator *base)
 {
@@ -3694,6 +4161,25 @@ vinyl_index_create_iterator(struct index *base, enum iterator_type type,
 	return (struct iterator *)it;
 }
 
+static struct iterator *
+vinyl_index_create_key_iterator(struct index *base, enum iterator_type type,
+				const char *key, uint32_t part_count)
+{
+	struct vy_lsm *lsm = vy_lsm(base);
+	struct space *space = space_by_id(base->def->space_id);
+	if (lsm->index_id == 0 || lsm->cmp_def->is_multikey ||
+	    lsm->cmp_def->for_func_index || space == NULL ||
+	    space->def->opts.defer_deletes) {
+		return generic_index_create_key_iterator(base, type, key,
+							 part_count);
+	}
+	struct iterator *it = vinyl_index_create_iterator(base, type, key,
+							  part_count);
+	if (it != NULL)
+		it->next = vinyl_iterator_key_next;
+	return it;
+}
+
 static int
 vinyl_snapshot_iterator_next(struct snapshot_iterator *base,
 			     const char **data, uint32_t *size)
@@ -3788,6 +4274,126 @@ vinyl_index_get(struct index *index, const char *key,
 	return 0;
 }
 
+/**
+ * Max number of fibers used for looking up a batch of keys,
+ * including the caller.
+ */
+enum { VY_GET_BATCH_MAX_FIBERS = 16 };
+
+/** Batch of keys looked up by vinyl_index_get_batch(). */
+struct vy_get_batch {
+	/** LSM tree to look up the keys in. */
+	struct vy_lsm *lsm;
+	/** Transaction or NULL. */
+	struct vy_tx *tx;
+	/** Read view to use. */
+	const struct vy_read_view **rv;
+	/** Next key to look up. */
+	const char *key;
+	/** Index of the next key to look up. */
+	uint32_t key_i;
+	/** Number of keys in the batch. */
+	uint32_t key_count;
+	/** Tuples found for the keys. */
+	struct tuple **result;
+	/** Set if a lookup failed. */
+	bool is_failed;
+};
+
+/**
+ * Look up keys of a batch one by one until there are no more
+ * keys left. Called concurrently by several fibers so that if
+ * a lookup yields waiting for a disk read, others proceed.
+ */
+static int
+vy_get_batch_process(struct vy_get_batch *batch)
+{
+	while (!batch->is_failed && batch->key_i < batch->key_count) {
+		uint32_t i = batch->key_i++;
+		const char *key = batch->key;
+		mp_next(&batch->key);
+		uint32_t part_count = mp_decode_array(&key);
+		if (vy_get_by_raw_key(batch->lsm, batch->tx, batch->rv,
+				      key, part_count, &batch->result[i]) != 0) {
+			batch->is_failed = true;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+vy_get_batch_f(va_list ap)
+{
+	struct vy_get_batch *batch = va_arg(ap, struct vy_get_batch *);
+	return vy_get_batch_process(batch);
+}
+
+static int
+vinyl_index_get_batch(struct index *index, const char *keys,
+		      uint32_t key_count, struct tuple **result)
+{
+	assert(index->def->opts.is_unique);
+
+	struct vy_lsm *lsm = vy_lsm(index);
+	struct vy_env *env = vy_env(index->engine);
+	struct vy_tx *tx = in_txn() ? in_txn()->engine_tx : NULL;
+	const struct vy_read_view **rv = (tx != NULL ? vy_tx_read_view(tx) :
+					  &env->xm->p_global_read_view);
+
+	if (tx != NULL && tx->state == VINYL_TX_ABORT) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+
+	struct vy_get_batch batch;
+	batch.lsm = lsm;
+	batch.tx = tx;
+	batch.rv = rv;
+	batch.key = keys;
+	batch.key_i = 0;
+	batch.key_count = key_count;
+	batch.result = result;
+	batch.is_failed = false;
+	for (uint32_t i = 0; i < key_count; i++)
+		result[i] = NULL;
+
+	vy_lsm_ref(lsm);
+	/*
+	 * Each lookup that misses the cache may have to wait for
+	 * page reads, which are done by reader threads. Look up
+	 * the keys in several fibers so that the reads are issued
+	 * in parallel. If we fail to start a fiber, just go on
+	 * with those we have.
+	 */
+	struct fiber *fibers[VY_GET_BATCH_MAX_FIBERS - 1];
+	int fiber_count = MIN(key_count, VY_GET_BATCH_MAX_FIBERS) - 1;
+	for (int i = 0; i < fiber_count; i++) {
+		fibers[i] = fiber_new("vinyl.get_batch", vy_get_batch_f);
+		if (fibers[i] == NULL) {
+			diag_clear(diag_get());
+			fiber_count = i;
+			break;
+		}
+		fiber_set_joinable(fibers[i], true);
+		fiber_start(fibers[i], &batch);
+	}
+	int rc = vy_get_batch_process(&batch);
+	for (int i = 0; i < fiber_count; i++) {
+		if (fiber_join(fibers[i]) != 0)
+			rc = -1;
+	}
+	vy_lsm_unref(lsm);
+	if (rc != 0) {
+		for (uint32_t i = 0; i < key_count; i++) {
+			if (result[i] != NULL)
+				tuple_unref(result[i]);
+		}
+		return -1;
+	}
+	return 0;
+}
+
 /*** }}} Cursor */
 
 /* {{{ Index build */
@@ -4531,10 +5137,12 @@ static const struct engine_vtab vinyl_engine_vtab = {
 static const struct space_vtab vinyl_space_vtab = {
 	/* .destroy = */ vinyl_space_destroy,
 	/* .bsize = */ vinyl_space_bsize,
+	/* .tuple_mem = */ generic_space_tuple_mem,
 	/* .execute_replace = */ vinyl_space_execute_replace,
 	/* .execute_delete = */ vinyl_space_execute_delete,
 	/* .execute_update = */ vinyl_space_execute_update,
 	/* .execute_upsert = */ vinyl_space_execute_upsert,
+	/* .execute_delete_range = */ vinyl_space_execute_delete_range,
 	/* .ephemeral_replace = */ generic_space_ephemeral_replace,
 	/* .ephemeral_delete = */ generic_space_ephemeral_delete,
 	/* .ephemeral_rowid_next = */ generic_space_ephemeral_rowid_next,
@@ -4567,9 +5175,14 @@ static const struct index_vtab vinyl_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .estimate_eq = */ vinyl_index_estimate_eq,
+	/* .split = */ vinyl_index_split,
 	/* .get = */ vinyl_index_get,
+	/* .get_batch = */ vinyl_index_get_batch,
 	/* .replace = */ generic_index_replace,
+	/* .replace_unchanged = */ generic_index_replace_unchanged,
 	/* .create_iterator = */ vinyl_index_create_iterator,
+	/* .create_key_iterator = */ vinyl_index_create_key_iterator,
 	/* .create_snapshot_iterator = */
 		vinyl_index_create_snapshot_iterator,
 	/* .stat = */ vinyl_index_stat,
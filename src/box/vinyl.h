@@ -42,8 +42,8 @@ struct info_handler;
 struct engine;
 
 struct engine *
-vinyl_engine_new(const char *dir, size_t memory,
-		 int read_threads, int write_threads, bool force_recovery);
+vinyl_engine_new(const char *dir, size_t memory, int read_threads,
+		 int write_threads, int dump_threads, bool force_recovery);
 
 /**
  * Vinyl engine statistics (box.stat.vinyl()).
@@ -57,6 +57,37 @@ vinyl_engine_stat(struct engine *engine, struct info_handler *handler);
 void
 vinyl_engine_set_cache(struct engine *engine, size_t quota);
 
+/**
+ * Update vinyl page cache size.
+ */
+void
+vinyl_engine_set_page_cache(struct engine *engine, size_t quota);
+
+/**
+ * Update the max number of threads a compaction task may use.
+ */
+void
+vinyl_engine_set_max_subcompactions(struct engine *engine,
+				    int max_subcompactions);
+
+/**
+ * Enable or disable direct I/O for reading compaction input.
+ */
+void
+vinyl_engine_set_compaction_direct_io(struct engine *engine, bool value);
+
+/**
+ * Update the size of read-ahead done by compaction.
+ */
+void
+vinyl_engine_set_compaction_readahead(struct engine *engine, size_t size);
+
+/**
+ * Update the min size of a statement stored in a blob file.
+ */
+void
+vinyl_engine_set_blob_threshold(struct engine *engine, size_t size);
+
 /**
  * Update vinyl memory size.
  */
@@ -75,6 +106,22 @@ vinyl_engine_set_max_tuple_size(struct engine *engine, size_t max_size);
 void
 vinyl_engine_set_timeout(struct engine *engine, double timeout);
 
+enum {
+	/**
+	 * Max number of upserts for the same key that may
+	 * precede background squashing.
+	 */
+	VINYL_UPSERT_SQUASH_THRESHOLD_MAX = 128,
+};
+
+/**
+ * Update the number of upserts for the same key that
+ * triggers background squashing.
+ */
+void
+vinyl_engine_set_upsert_squash_threshold(struct engine *engine,
+					 int threshold);
+
 /**
  * Update too_long_threshold.
  */
@@ -94,12 +141,12 @@ vinyl_engine_set_snap_io_rate_limit(struct engine *engine, double limit);
 #include "diag.h"
 
 static inline struct engine *
-vinyl_engine_new_xc(const char *dir, size_t memory,
-		    int read_threads, int write_threads, bool force_recovery)
+vinyl_engine_new_xc(const char *dir, size_t memory, int read_threads,
+		    int write_threads, int dump_threads, bool force_recovery)
 {
 	struct engine *vinyl;
-	vinyl = vinyl_engine_new(dir, memory, read_threads,
-				 write_threads, force_recovery);
+	vinyl = vinyl_engine_new(dir, memory, read_threads, write_threads,
+				 dump_threads, force_recovery);
 	if (vinyl == NULL)
 		diag_raise();
 	return vinyl;
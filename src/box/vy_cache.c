@@ -50,13 +50,18 @@ enum {
 	/* Max number of deletes that are made by cleanup action per one
 	 * cache operation */
 	VY_CACHE_CLEANUP_MAX_STEPS = 10,
+	/* Max share of the quota that can be occupied by protected
+	 * nodes, in percent */
+	VY_CACHE_PROTECTED_PCT = 80,
 };
 
 void
 vy_cache_env_create(struct vy_cache_env *e, struct slab_cache *slab_cache)
 {
 	rlist_create(&e->cache_lru);
+	rlist_create(&e->cache_lru_protected);
 	e->mem_used = 0;
+	e->mem_protected = 0;
 	e->mem_quota = 0;
 	mempool_create(&e->cache_node_mempool, slab_cache,
 		       sizeof(struct vy_cache_node));
@@ -93,6 +98,7 @@ vy_cache_node_new(struct vy_cache_env *env, struct vy_cache *cache,
 	node->cache = cache;
 	node->entry = entry;
 	node->flags = 0;
+	node->is_protected = false;
 	node->left_boundary_level = cache->cmp_def->part_count;
 	node->right_boundary_level = cache->cmp_def->part_count;
 	rlist_add(&env->cache_lru, &node->in_lru);
@@ -108,12 +114,49 @@ vy_cache_node_delete(struct vy_cache_env *env, struct vy_cache_node *node)
 				     node->entry.stmt);
 	assert(env->mem_used >= vy_cache_node_size(node));
 	env->mem_used -= vy_cache_node_size(node);
+	if (node->is_protected) {
+		assert(env->mem_protected >= vy_cache_node_size(node));
+		env->mem_protected -= vy_cache_node_size(node);
+	}
 	tuple_unref(node->entry.stmt);
 	rlist_del(&node->in_lru);
 	TRASH(node);
 	mempool_free(&env->cache_node_mempool, node);
 }
 
+/**
+ * Move the least recently used protected nodes to the probationary
+ * LRU list until the protected list fits in its share of the quota.
+ */
+static void
+vy_cache_env_demote(struct vy_cache_env *env)
+{
+	size_t limit = env->mem_quota / 100 * VY_CACHE_PROTECTED_PCT;
+	while (env->mem_protected > limit) {
+		struct vy_cache_node *node =
+			rlist_last_entry(&env->cache_lru_protected,
+					 struct vy_cache_node, in_lru);
+		assert(node->is_protected);
+		node->is_protected = false;
+		env->mem_protected -= vy_cache_node_size(node);
+		rlist_move(&env->cache_lru, &node->in_lru);
+	}
+}
+
+/**
+ * Move a cache node to the head of the protected LRU list.
+ */
+static void
+vy_cache_node_protect(struct vy_cache_env *env, struct vy_cache_node *node)
+{
+	if (!node->is_protected) {
+		node->is_protected = true;
+		env->mem_protected += vy_cache_node_size(node);
+	}
+	rlist_move(&env->cache_lru_protected, &node->in_lru);
+	vy_cache_env_demote(env);
+}
+
 static void *
 vy_cache_tree_page_alloc(void *ctx)
 {
@@ -166,7 +209,10 @@ vy_cache_destroy(struct vy_cache *cache)
 static void
 vy_cache_gc_step(struct vy_cache_env *env)
 {
+	/* Evict probationary nodes first. */
 	struct rlist *lru = &env->cache_lru;
+	if (rlist_empty(lru))
+		lru = &env->cache_lru_protected;
 	struct vy_cache_node *node =
 		rlist_last_entry(lru, struct vy_cache_node, in_lru);
 	struct vy_cache *cache = node->cache;
@@ -245,6 +291,13 @@ vy_cache_add(struct vy_cache *cache, struct vy_entry curr,
 	/* The case of the first or the last result in key+order query */
 	bool is_boundary = (curr.stmt != NULL) != (prev.stmt != NULL);
 
+	/*
+	 * Set if the reader actually read curr rather than just
+	 * marks the end of the result. Only a read may promote
+	 * a cached statement to the protected LRU list.
+	 */
+	bool is_read = curr.stmt != NULL;
+
 	if (prev.stmt != NULL && vy_stmt_lsn(prev.stmt) == INT64_MAX) {
 		/* Previous statement is from tx write set, can't store it */
 		prev = vy_entry_none();
@@ -320,7 +373,18 @@ vy_cache_add(struct vy_cache *cache, struct vy_entry curr,
 		node->flags = replaced->flags;
 		node->left_boundary_level = replaced->left_boundary_level;
 		node->right_boundary_level = replaced->right_boundary_level;
+		/*
+		 * If the statement was read again while cached,
+		 * protect it from being flushed by scans.
+		 */
+		bool is_protected = replaced->is_protected;
+		if (is_read && !is_protected) {
+			vy_stmt_counter_acct_tuple(&cache->stat.promote,
+						   curr.stmt);
+		}
 		vy_cache_node_delete(cache->env, replaced);
+		if (is_read || is_protected)
+			vy_cache_node_protect(cache->env, node);
 	}
 	if (direction > 0 && boundary_level < node->left_boundary_level)
 		node->left_boundary_level = boundary_level;
@@ -406,7 +470,14 @@ vy_cache_add(struct vy_cache *cache, struct vy_entry curr,
 		prev_node->flags = replaced->flags;
 		prev_node->left_boundary_level = replaced->left_boundary_level;
 		prev_node->right_boundary_level = replaced->right_boundary_level;
+		/*
+		 * Linking a chain isn't a read of the previous
+		 * statement so just preserve its LRU list.
+		 */
+		bool is_protected = replaced->is_protected;
 		vy_cache_node_delete(cache->env, replaced);
+		if (is_protected)
+			vy_cache_node_protect(cache->env, prev_node);
 	}
 
 	/* Set proper flags */
@@ -503,6 +574,57 @@ vy_cache_on_write(struct vy_cache *cache, struct vy_entry entry,
 	}
 }
 
+void
+vy_cache_on_range_delete(struct vy_cache *cache, struct vy_entry begin,
+			 struct vy_entry end)
+{
+	struct vy_cache_tree *tree = &cache->cache_tree;
+	struct key_def *cmp_def = cache->cmp_def;
+	bool has_begin = !vy_stmt_is_empty_key(begin.stmt);
+	bool has_end = !vy_stmt_is_empty_key(end.stmt);
+	bool is_first = true;
+	cache->version++;
+	while (true) {
+		/*
+		 * Deletion invalidates tree iterators so look up
+		 * the first node in the range on each iteration.
+		 */
+		bool exact;
+		struct vy_cache_tree_iterator itr = has_begin ?
+			vy_cache_tree_lower_bound(tree, begin, &exact) :
+			vy_cache_tree_iterator_first(tree);
+		if (is_first) {
+			/* Break the chain entering the range. */
+			struct vy_cache_tree_iterator prev = itr;
+			vy_cache_tree_iterator_prev(tree, &prev);
+			struct vy_cache_node **prev_node =
+				vy_cache_tree_iterator_get_elem(tree, &prev);
+			if (prev_node != NULL) {
+				(*prev_node)->flags &= ~VY_CACHE_RIGHT_LINKED;
+				(*prev_node)->right_boundary_level =
+							cmp_def->part_count;
+			}
+			is_first = false;
+		}
+		struct vy_cache_node **node =
+			vy_cache_tree_iterator_get_elem(tree, &itr);
+		if (node == NULL)
+			break;
+		if (has_end &&
+		    vy_entry_compare((*node)->entry, end, cmp_def) >= 0) {
+			/* Break the chain leaving the range. */
+			(*node)->flags &= ~VY_CACHE_LEFT_LINKED;
+			(*node)->left_boundary_level = cmp_def->part_count;
+			break;
+		}
+		struct vy_cache_node *to_delete = *node;
+		vy_stmt_counter_acct_tuple(&cache->stat.invalidate,
+					   to_delete->entry.stmt);
+		vy_cache_tree_delete(tree, to_delete);
+		vy_cache_node_delete(cache->env, to_delete);
+	}
+}
+
 /**
  * Get a stmt by current position
  */
@@ -705,14 +827,17 @@ vy_cache_iterator_next(struct vy_cache_iterator *itr,
 		itr->search_started = true;
 		itr->version = itr->cache->version;
 		*stop = vy_cache_iterator_seek(itr, vy_entry_none());
+		vy_cache_iterator_skip_to_read_view(itr, stop);
+		if (itr->curr.stmt == NULL)
+			itr->cache->stat.miss++;
 	} else {
 		assert(itr->version == itr->cache->version);
 		if (itr->curr.stmt == NULL)
 			return 0;
 		*stop = vy_cache_iterator_step(itr);
+		vy_cache_iterator_skip_to_read_view(itr, stop);
 	}
 
-	vy_cache_iterator_skip_to_read_view(itr, stop);
 	if (itr->curr.stmt != NULL) {
 		vy_stmt_counter_acct_tuple(&itr->cache->stat.get,
 					   itr->curr.stmt);
@@ -749,6 +874,7 @@ vy_cache_iterator_skip(struct vy_cache_iterator *itr, struct vy_entry last,
 					   itr->curr.stmt);
 		return vy_history_append_stmt(history, itr->curr);
 	}
+	itr->cache->stat.miss++;
 	return 0;
 }
 
@@ -771,6 +897,8 @@ vy_cache_iterator_restore(struct vy_cache_iterator *itr, struct vy_entry last,
 		 */
 		*stop = vy_cache_iterator_seek(itr, last);
 		vy_cache_iterator_skip_to_read_view(itr, stop);
+		if (itr->curr.stmt == NULL)
+			itr->cache->stat.miss++;
 		pos_changed = true;
 	} else {
 		/*
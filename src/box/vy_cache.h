@@ -56,11 +56,13 @@ struct vy_cache_node {
 	struct vy_cache *cache;
 	/* Statement in cache */
 	struct vy_entry entry;
-	/* Link in LRU list */
+	/* Link in probationary or protected LRU list */
 	struct rlist in_lru;
 	/* VY_CACHE_LEFT_LINKED and/or VY_CACHE_RIGHT_LINKED, see
 	 * description of them for more information */
 	uint32_t flags;
+	/* Set if the node is in the protected LRU list */
+	bool is_protected;
 	/* Number of parts in key when the value was the first in EQ search */
 	uint8_t left_boundary_level;
 	/* Number of parts in key when the value was the last in EQ search */
@@ -113,14 +115,32 @@ vy_cache_tree_key_cmp(struct vy_cache_node *a, struct vy_entry b,
 
 /**
  * Environment of the cache
+ *
+ * The cache uses segmented LRU eviction policy so that a single
+ * scan can't flush the hot set. A statement is added to the
+ * probationary LRU list. If it is read again while cached, it is
+ * moved to the protected LRU list. Nodes are evicted from the
+ * probationary list first. When the protected list exceeds its
+ * share of the quota, its least recently used nodes are moved
+ * back to the probationary list.
  */
 struct vy_cache_env {
-	/** Common LRU list of read cache. The first element is the newest */
+	/**
+	 * Common probationary LRU list of read cache.
+	 * The first element is the newest.
+	 */
 	struct rlist cache_lru;
+	/**
+	 * Common protected LRU list of read cache.
+	 * The first element is the newest.
+	 */
+	struct rlist cache_lru_protected;
 	/** Common mempool for vy_cache_node struct */
 	struct mempool cache_node_mempool;
 	/** Size of memory occupied by cached tuples */
 	size_t mem_used;
+	/** Size of memory occupied by protected cached tuples */
+	size_t mem_protected;
 	/** Max memory size that can be used for cache */
 	size_t mem_quota;
 };
@@ -223,6 +243,16 @@ void
 vy_cache_on_write(struct vy_cache *cache, struct vy_entry entry,
 		  struct vy_entry *deleted);
 
+/**
+ * Invalidate all cached values in the key range [begin, end)
+ * deleted by a range tombstone. An empty key stands for infinity.
+ * @param cache - pointer to tuple cache.
+ * @param begin - start of the deleted range.
+ * @param end - end of the deleted range.
+ */
+void
+vy_cache_on_range_delete(struct vy_cache *cache, struct vy_entry begin,
+			 struct vy_entry end);
 
 /**
  * Cache iterator
@@ -72,6 +72,25 @@ vy_history_cleanup(struct vy_history *history)
 	rlist_create(&history->stmts);
 }
 
+bool
+vy_history_cut(struct vy_history *history, int64_t lsn)
+{
+	bool is_cut = false;
+	while (!rlist_empty(&history->stmts)) {
+		/* Oldest statement is at the tail of the list. */
+		struct vy_history_node *node = rlist_last_entry(
+			&history->stmts, struct vy_history_node, link);
+		if (vy_stmt_lsn(node->entry.stmt) >= lsn)
+			break;
+		rlist_del_entry(node, link);
+		if (node->is_refable)
+			tuple_unref(node->entry.stmt);
+		mempool_free(history->pool, node);
+		is_cut = true;
+	}
+	return is_cut;
+}
+
 int
 vy_history_apply(struct vy_history *history, struct key_def *cmp_def,
 		 bool keep_delete, int *upserts_applied, struct vy_entry *ret)
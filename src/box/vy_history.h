@@ -145,6 +145,14 @@ vy_history_append_stmt(struct vy_history *history, struct vy_entry entry);
 void
 vy_history_cleanup(struct vy_history *history);
 
+/**
+ * Remove all statements older than @lsn from the given history.
+ * Used to apply a range tombstone with LSN @lsn to the history.
+ * Returns true if any statement was removed.
+ */
+bool
+vy_history_cut(struct vy_history *history, int64_t lsn);
+
 /**
  * Get a resultant statement from collected history.
  * If the resultant statement is a DELETE, the function
@@ -86,6 +86,7 @@ enum vy_log_key {
 	VY_LOG_KEY_DROP_LSN		= 14,
 	VY_LOG_KEY_GROUP_ID		= 15,
 	VY_LOG_KEY_DUMP_COUNT		= 16,
+	VY_LOG_KEY_TOMBSTONE_LSN	= 17,
 };
 
 /** vy_log_key -> human readable name. */
@@ -107,6 +108,7 @@ static const char *vy_log_key_name[] = {
 	[VY_LOG_KEY_DROP_LSN]		= "drop_lsn",
 	[VY_LOG_KEY_GROUP_ID]		= "group_id",
 	[VY_LOG_KEY_DUMP_COUNT]		= "dump_count",
+	[VY_LOG_KEY_TOMBSTONE_LSN]	= "tombstone_lsn",
 };
 
 /** vy_log_type -> human readable name. */
@@ -129,6 +131,8 @@ static const char *vy_log_type_name[] = {
 	[VY_LOG_PREPARE_LSM]		= "prepare_lsm",
 	[VY_LOG_REBOOTSTRAP]		= "rebootstrap",
 	[VY_LOG_ABORT_REBOOTSTRAP]	= "abort_rebootstrap",
+	[VY_LOG_INSERT_RANGE_TOMBSTONE]	= "insert_range_tombstone",
+	[VY_LOG_DELETE_RANGE_TOMBSTONE]	= "delete_range_tombstone",
 };
 
 /** Batch of vylog records that must be written in one go. */
@@ -198,9 +202,27 @@ struct vy_log {
 	 * only relevant if @tx_failed is set.
 	 */
 	struct diag tx_diag;
+	/**
+	 * Number of records appended to the current log file
+	 * since it was created or compacted.
+	 */
+	int64_t appended_record_count;
+	/**
+	 * Number of records written to the current log file
+	 * when it was created or compacted, i.e. the size of
+	 * the metadata snapshot stored in it.
+	 */
+	int64_t snapshot_record_count;
 };
 static struct vy_log vy_log;
 
+/**
+ * Compact the current log file if the number of records appended
+ * to it exceeds both this value and the number of records in the
+ * snapshot stored in the file.
+ */
+static const int64_t VY_LOG_COMPACT_MIN_RECORDS = 10000;
+
 static int
 vy_log_flusher_f(va_list va);
 
@@ -212,11 +234,15 @@ vy_recovery_process_record(struct vy_recovery *recovery,
 			   const struct vy_log_record *record);
 
 static int
-vy_log_create(const struct vclock *vclock, struct vy_recovery *recovery);
+vy_log_create(const struct vclock *vclock, struct vy_recovery *recovery,
+	      int64_t *record_count);
 
 int
 vy_log_rotate(const struct vclock *vclock);
 
+static int
+vy_log_compact(void);
+
 /**
  * Return the name of the vylog file that has the given signature.
  */
@@ -314,6 +340,10 @@ vy_log_record_snprint(char *buf, int size, const struct vy_log_record *record)
 		SNPRINT(total, snprintf, buf, size, "%s=%"PRIu32", ",
 			vy_log_key_name[VY_LOG_KEY_DUMP_COUNT],
 			record->dump_count);
+	if (record->tombstone_lsn > 0)
+		SNPRINT(total, snprintf, buf, size, "%s=%"PRIi64", ",
+			vy_log_key_name[VY_LOG_KEY_TOMBSTONE_LSN],
+			record->tombstone_lsn);
 	SNPRINT(total, snprintf, buf, size, "}");
 	return total;
 }
@@ -445,6 +475,11 @@ vy_log_record_encode(const struct vy_log_record *record,
 		size += mp_sizeof_uint(record->dump_count);
 		n_keys++;
 	}
+	if (record->tombstone_lsn > 0) {
+		size += mp_sizeof_uint(VY_LOG_KEY_TOMBSTONE_LSN);
+		size += mp_sizeof_uint(record->tombstone_lsn);
+		n_keys++;
+	}
 	size += mp_sizeof_map(n_keys);
 
 	/*
@@ -531,6 +566,10 @@ vy_log_record_encode(const struct vy_log_record *record,
 		pos = mp_encode_uint(pos, VY_LOG_KEY_DUMP_COUNT);
 		pos = mp_encode_uint(pos, record->dump_count);
 	}
+	if (record->tombstone_lsn > 0) {
+		pos = mp_encode_uint(pos, VY_LOG_KEY_TOMBSTONE_LSN);
+		pos = mp_encode_uint(pos, record->tombstone_lsn);
+	}
 	assert(pos == tuple + size);
 
 	/*
@@ -663,6 +702,9 @@ vy_log_record_decode(struct vy_log_record *record,
 		case VY_LOG_KEY_DUMP_COUNT:
 			record->dump_count = mp_decode_uint(&pos);
 			break;
+		case VY_LOG_KEY_TOMBSTONE_LSN:
+			record->tombstone_lsn = mp_decode_uint(&pos);
+			break;
 		default:
 			mp_next(&pos); /* unknown key, ignore */
 			break;
@@ -852,6 +894,7 @@ vy_log_tx_flush(struct vy_log_tx *tx)
 	if (wal_write_vy_log(entry) != 0)
 		goto err;
 
+	vy_log.appended_record_count += tx_size;
 	region_truncate(&fiber()->gc, used);
 	return 0;
 err:
@@ -891,6 +934,17 @@ vy_log_flush(void)
 	return rc;
 }
 
+/**
+ * Return true if the current log file should be compacted,
+ * see vy_log_compact().
+ */
+static inline bool
+vy_log_needs_compaction(void)
+{
+	return vy_log.appended_record_count >
+	       MAX(VY_LOG_COMPACT_MIN_RECORDS, vy_log.snapshot_record_count);
+}
+
 static int
 vy_log_flusher_f(va_list va)
 {
@@ -901,16 +955,22 @@ vy_log_flusher_f(va_list va)
 		 * See vy_log_tx_commit().
 		 */
 		if (vy_log.recovery != NULL ||
-		    stailq_empty(&vy_log.pending_tx)) {
+		    (stailq_empty(&vy_log.pending_tx) &&
+		     !vy_log_needs_compaction())) {
 			fiber_cond_wait(&vy_log.flusher_cond);
 			continue;
 		}
 		latch_lock(&vy_log.latch);
 		int rc = vy_log_flush();
 		latch_unlock(&vy_log.latch);
+		const char *what = "flush";
+		if (rc == 0 && vy_log_needs_compaction()) {
+			what = "compact";
+			rc = vy_log_compact();
+		}
 		if (rc != 0) {
 			diag_log();
-			say_error("failed to flush vylog");
+			say_error("failed to %s vylog", what);
 			/*
 			 * Don't retry immediately after a failure
 			 * since the next write is likely to fail
@@ -1134,7 +1194,8 @@ vy_log_rotate_f(va_list ap)
 {
 	struct vy_recovery *recovery = va_arg(ap, struct vy_recovery *);
 	const struct vclock *vclock = va_arg(ap, const struct vclock *);
-	return vy_log_create(vclock, recovery);
+	int64_t *record_count = va_arg(ap, int64_t *);
+	return vy_log_create(vclock, recovery, record_count);
 }
 
 int
@@ -1174,7 +1235,8 @@ vy_log_rotate(const struct vclock *vclock)
 		goto fail;
 
 	/* Do actual work from coio so as not to stall tx thread. */
-	int rc = coio_call(vy_log_rotate_f, recovery, vclock);
+	int64_t record_count = 0;
+	int rc = coio_call(vy_log_rotate_f, recovery, vclock, &record_count);
 	vy_recovery_delete(recovery);
 	if (rc < 0) {
 		diag_log();
@@ -1188,6 +1250,8 @@ vy_log_rotate(const struct vclock *vclock)
 	 */
 	wal_rotate_vy_log();
 	vclock_copy(&vy_log.last_checkpoint, vclock);
+	vy_log.snapshot_record_count = record_count;
+	vy_log.appended_record_count = 0;
 
 	/* Add the new vclock to the xdir so that we can track it. */
 	xdir_add_vclock(&vy_log.dir, vclock);
@@ -1200,6 +1264,73 @@ fail:
 	return -1;
 }
 
+/**
+ * Replace the current log file with a file containing only the
+ * snapshot of the current metadata state, just like the one
+ * created by vy_log_rotate(), but without changing the signature.
+ * Called in the background when too many records have been
+ * appended to the log since the last checkpoint, so that recovery
+ * time depends on the number of live objects rather than on the
+ * length of the history.
+ */
+static int
+vy_log_compact(void)
+{
+	assert(vy_log.recovery == NULL);
+	int64_t signature = vclock_sum(&vy_log.last_checkpoint);
+	say_verbose("compacting vylog %lld", (long long)signature);
+
+	latch_lock(&vy_log.latch);
+
+	struct vy_recovery *recovery;
+	recovery = vy_recovery_new_locked(signature, 0);
+	if (recovery == NULL)
+		goto fail;
+	/*
+	 * An unfinished rebootstrap section must be preserved
+	 * as is, see vy_log_begin_recovery(). If there are no
+	 * LSM trees, vy_log_create() won't write anything, and
+	 * we can't delete the current log file. In either case
+	 * postpone compaction until the log doubles in size.
+	 */
+	if (recovery->in_rebootstrap || rlist_empty(&recovery->lsms)) {
+		vy_recovery_delete(recovery);
+		vy_log.snapshot_record_count += vy_log.appended_record_count;
+		vy_log.appended_record_count = 0;
+		latch_unlock(&vy_log.latch);
+		return 0;
+	}
+
+	/*
+	 * The compacted log is written to a temporary file that
+	 * is then atomically renamed to the current log file so
+	 * the log stays consistent in case of a crash.
+	 */
+	int64_t record_count = 0;
+	int rc = coio_call(vy_log_rotate_f, recovery,
+			   &vy_log.last_checkpoint, &record_count);
+	vy_recovery_delete(recovery);
+	if (rc < 0)
+		goto fail;
+
+	say_info("compacted vylog %lld: %lld records appended, "
+		 "%lld records left", (long long)signature,
+		 (long long)(vy_log.snapshot_record_count +
+			     vy_log.appended_record_count),
+		 (long long)record_count);
+
+	/* Reopen the log file on the next write. */
+	wal_rotate_vy_log();
+	vy_log.snapshot_record_count = record_count;
+	vy_log.appended_record_count = 0;
+
+	latch_unlock(&vy_log.latch);
+	return 0;
+fail:
+	latch_unlock(&vy_log.latch);
+	return -1;
+}
+
 void
 vy_log_collect_garbage(const struct vclock *vclock)
 {
@@ -1288,6 +1419,10 @@ vy_log_tx_commit(void)
 	if (rc != 0)
 		goto err;
 
+	/* Let the flusher compact the log in the background. */
+	if (vy_log_needs_compaction())
+		fiber_cond_signal(&vy_log.flusher_cond);
+
 	say_verbose("commit vylog transaction");
 	return 0;
 err:
@@ -1488,6 +1623,7 @@ vy_recovery_do_create_lsm(struct vy_recovery *recovery, int64_t id,
 	lsm->prepared = NULL;
 	rlist_create(&lsm->ranges);
 	rlist_create(&lsm->runs);
+	rlist_create(&lsm->range_tombstones);
 	/*
 	 * Keep newer LSM trees closer to the tail of the list
 	 * so that on log rotation we create/drop past incarnations
@@ -2075,6 +2211,91 @@ vy_recovery_delete_slice(struct vy_recovery *recovery, int64_t slice_id)
 	return 0;
 }
 
+/**
+ * Handle a VY_LOG_INSERT_RANGE_TOMBSTONE log record.
+ * This function allocates a new range tombstone and adds it to
+ * the list of range tombstones of the LSM tree with ID @lsm_id.
+ * Return 0 on success, -1 on failure (unknown LSM tree or OOM).
+ */
+static int
+vy_recovery_insert_range_tombstone(struct vy_recovery *recovery,
+				   int64_t lsm_id, int64_t lsn,
+				   const char *begin, const char *end)
+{
+	struct vy_lsm_recovery_info *lsm;
+	lsm = vy_recovery_lookup_lsm(recovery, lsm_id);
+	if (lsm == NULL) {
+		diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+			 tt_sprintf("Range tombstone %lld created for "
+				    "unregistered LSM tree %lld",
+				    (long long)lsn, (long long)lsm_id));
+		return -1;
+	}
+	size_t size = sizeof(struct vy_range_tombstone_recovery_info);
+	const char *data;
+	data = begin;
+	if (data != NULL)
+		mp_next(&data);
+	size_t begin_size = data - begin;
+	size += begin_size;
+	data = end;
+	if (data != NULL)
+		mp_next(&data);
+	size_t end_size = data - end;
+	size += end_size;
+
+	struct vy_range_tombstone_recovery_info *tombstone = malloc(size);
+	if (tombstone == NULL) {
+		diag_set(OutOfMemory, size, "malloc",
+			 "struct vy_range_tombstone_recovery_info");
+		return -1;
+	}
+	tombstone->lsn = lsn;
+	char *buf = (void *)tombstone + sizeof(*tombstone);
+	if (begin != NULL) {
+		tombstone->begin = buf;
+		memcpy(tombstone->begin, begin, begin_size);
+	} else
+		tombstone->begin = NULL;
+	if (end != NULL) {
+		tombstone->end = buf + begin_size;
+		memcpy(tombstone->end, end, end_size);
+	} else
+		tombstone->end = NULL;
+	rlist_add_tail_entry(&lsm->range_tombstones, tombstone, in_lsm);
+	return 0;
+}
+
+/**
+ * Handle a VY_LOG_DELETE_RANGE_TOMBSTONE log record.
+ * This function frees the range tombstone with LSN @lsn
+ * of the LSM tree with ID @lsm_id.
+ * Return 0 on success, -1 if the tombstone not found.
+ */
+static int
+vy_recovery_delete_range_tombstone(struct vy_recovery *recovery,
+				   int64_t lsm_id, int64_t lsn)
+{
+	struct vy_lsm_recovery_info *lsm;
+	lsm = vy_recovery_lookup_lsm(recovery, lsm_id);
+	if (lsm != NULL) {
+		struct vy_range_tombstone_recovery_info *tombstone;
+		rlist_foreach_entry(tombstone, &lsm->range_tombstones,
+				    in_lsm) {
+			if (tombstone->lsn != lsn)
+				continue;
+			rlist_del_entry(tombstone, in_lsm);
+			free(tombstone);
+			return 0;
+		}
+	}
+	diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+		 tt_sprintf("Range tombstone %lld of LSM tree %lld "
+			    "deleted but not registered",
+			    (long long)lsn, (long long)lsm_id));
+	return -1;
+}
+
 /**
  * Mark all LSM trees created during rebootstrap as dropped so
  * that they will be purged on the next garbage collection.
@@ -2194,6 +2415,15 @@ vy_recovery_process_record(struct vy_recovery *recovery,
 	case VY_LOG_ABORT_REBOOTSTRAP:
 		vy_recovery_abort_rebootstrap(recovery);
 		break;
+	case VY_LOG_INSERT_RANGE_TOMBSTONE:
+		rc = vy_recovery_insert_range_tombstone(recovery,
+				record->lsm_id, record->tombstone_lsn,
+				record->begin, record->end);
+		break;
+	case VY_LOG_DELETE_RANGE_TOMBSTONE:
+		rc = vy_recovery_delete_range_tombstone(recovery,
+				record->lsm_id, record->tombstone_lsn);
+		break;
 	default:
 		unreachable();
 	}
@@ -2441,6 +2671,7 @@ vy_recovery_delete(struct vy_recovery *recovery)
 	struct vy_range_recovery_info *range, *next_range;
 	struct vy_slice_recovery_info *slice, *next_slice;
 	struct vy_run_recovery_info *run, *next_run;
+	struct vy_range_tombstone_recovery_info *tombstone, *next_tombstone;
 
 	rlist_foreach_entry_safe(lsm, &recovery->lsms, in_recovery, next_lsm) {
 		rlist_foreach_entry_safe(range, &lsm->ranges,
@@ -2452,6 +2683,9 @@ vy_recovery_delete(struct vy_recovery *recovery)
 		}
 		rlist_foreach_entry_safe(run, &lsm->runs, in_lsm, next_run)
 			free(run);
+		rlist_foreach_entry_safe(tombstone, &lsm->range_tombstones,
+					 in_lsm, next_tombstone)
+			free(tombstone);
 		free(lsm->key_parts);
 		free(lsm);
 	}
@@ -2490,6 +2724,7 @@ vy_log_append_lsm(struct xlog *xlog, struct vy_lsm_recovery_info *lsm)
 	struct vy_range_recovery_info *range;
 	struct vy_slice_recovery_info *slice;
 	struct vy_run_recovery_info *run;
+	struct vy_range_tombstone_recovery_info *tombstone;
 	struct vy_log_record record;
 
 	vy_log_record_init(&record);
@@ -2559,6 +2794,17 @@ vy_log_append_lsm(struct xlog *xlog, struct vy_lsm_recovery_info *lsm)
 		}
 	}
 
+	rlist_foreach_entry(tombstone, &lsm->range_tombstones, in_lsm) {
+		vy_log_record_init(&record);
+		record.type = VY_LOG_INSERT_RANGE_TOMBSTONE;
+		record.lsm_id = lsm->id;
+		record.tombstone_lsn = tombstone->lsn;
+		record.begin = tombstone->begin;
+		record.end = tombstone->end;
+		if (vy_log_append_record(xlog, &record) != 0)
+			return -1;
+	}
+
 	if (lsm->drop_lsn >= 0) {
 		vy_log_record_init(&record);
 		record.type = VY_LOG_DROP_LSM;
@@ -2570,9 +2816,13 @@ vy_log_append_lsm(struct xlog *xlog, struct vy_lsm_recovery_info *lsm)
 	return 0;
 }
 
-/** Create vylog from a recovery context. */
+/**
+ * Create vylog from a recovery context.
+ * The number of written records is returned in @record_count.
+ */
 static int
-vy_log_create(const struct vclock *vclock, struct vy_recovery *recovery)
+vy_log_create(const struct vclock *vclock, struct vy_recovery *recovery,
+	      int64_t *record_count)
 {
 	say_verbose("saving vylog %lld", (long long)vclock_sum(vclock));
 
@@ -2615,6 +2865,7 @@ vy_log_create(const struct vclock *vclock, struct vy_recovery *recovery)
 	    xlog_rename(&xlog) < 0)
 		goto err_write_xlog;
 
+	*record_count = xlog.rows;
 	xlog_close(&xlog, false);
 done:
 	say_verbose("done saving vylog");
@@ -217,6 +217,24 @@ enum vy_log_record_type {
 	 * See also VY_LOG_REBOOTSTRAP.
 	 */
 	VY_LOG_ABORT_REBOOTSTRAP	= 17,
+	/**
+	 * Insert a range tombstone into an LSM tree.
+	 * Requires vy_log_record::lsm_id, tombstone_lsn, begin, end.
+	 *
+	 * A record of this type is written when a range delete
+	 * statement is committed, because after the LSM tree is
+	 * dumped the WAL row it was created by isn't replayed on
+	 * recovery. Begin and end may be omitted (infinity).
+	 */
+	VY_LOG_INSERT_RANGE_TOMBSTONE	= 18,
+	/**
+	 * Delete a range tombstone.
+	 * Requires vy_log_record::lsm_id, tombstone_lsn.
+	 *
+	 * Written after all statements covered by the tombstone
+	 * have been purged from the LSM tree by dump or compaction.
+	 */
+	VY_LOG_DELETE_RANGE_TOMBSTONE	= 19,
 
 	vy_log_record_type_MAX
 };
@@ -283,6 +301,8 @@ struct vy_log_record {
 	int64_t gc_lsn;
 	/** For runs: number of dumps it took to create the run. */
 	uint32_t dump_count;
+	/** For range tombstones: LSN of the range delete statement. */
+	int64_t tombstone_lsn;
 	/** Link in vy_log_tx::records. */
 	struct stailq_entry in_tx;
 };
@@ -360,6 +380,11 @@ struct vy_lsm_recovery_info {
 	 * vy_run_recovery_info::in_lsm.
 	 */
 	struct rlist runs;
+	/**
+	 * List of all range tombstones of the LSM tree, linked by
+	 * vy_range_tombstone_recovery_info::in_lsm.
+	 */
+	struct rlist range_tombstones;
 	/**
 	 * Pointer to an LSM tree that is going to replace
 	 * this one after successful ALTER.
@@ -435,6 +460,21 @@ struct vy_slice_recovery_info {
 	char *end;
 };
 
+/** Range tombstone info stored in a recovery context. */
+struct vy_range_tombstone_recovery_info {
+	/** Link in vy_lsm_recovery_info::range_tombstones. */
+	struct rlist in_lsm;
+	/** LSN of the range delete statement. */
+	int64_t lsn;
+	/** Start of the deleted range, stored in MsgPack array. */
+	char *begin;
+	/**
+	 * End of the deleted range, stored in MsgPack array.
+	 * NULL if the range ends with +inf.
+	 */
+	char *end;
+};
+
 /**
  * Initialize the metadata log.
  * @dir is the directory where log files are stored.
@@ -801,6 +841,33 @@ vy_log_dump_lsm(int64_t id, int64_t dump_lsn)
 	vy_log_write(&record);
 }
 
+/** Helper to log insertion of a range tombstone. */
+static inline void
+vy_log_insert_range_tombstone(int64_t lsm_id, int64_t lsn,
+			      const char *begin, const char *end)
+{
+	struct vy_log_record record;
+	vy_log_record_init(&record);
+	record.type = VY_LOG_INSERT_RANGE_TOMBSTONE;
+	record.lsm_id = lsm_id;
+	record.tombstone_lsn = lsn;
+	record.begin = begin;
+	record.end = end;
+	vy_log_write(&record);
+}
+
+/** Helper to log deletion of a range tombstone. */
+static inline void
+vy_log_delete_range_tombstone(int64_t lsm_id, int64_t lsn)
+{
+	struct vy_log_record record;
+	vy_log_record_init(&record);
+	record.type = VY_LOG_DELETE_RANGE_TOMBSTONE;
+	record.lsm_id = lsm_id;
+	record.tombstone_lsn = lsn;
+	vy_log_write(&record);
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
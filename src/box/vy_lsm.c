@@ -86,16 +86,22 @@ vy_lsm_env_create(struct vy_lsm_env *env, const char *path,
 	tuple_format_ref(key_format);
 	env->upsert_thresh_cb = upsert_thresh_cb;
 	env->upsert_thresh_arg = upsert_thresh_arg;
+	env->upsert_squash_threshold = VY_UPSERT_THRESHOLD;
+	memset(&env->upsert_stat, 0, sizeof(env->upsert_stat));
 	env->too_long_threshold = TIMEOUT_INFINITY;
 	env->lsm_count = 0;
 	mempool_create(&env->history_node_pool, cord_slab_cache(),
 		       sizeof(struct vy_history_node));
+	rlist_create(&env->bloom_queue);
+	env->bloom_loader = NULL;
 	return 0;
 }
 
 void
 vy_lsm_env_destroy(struct vy_lsm_env *env)
 {
+	/* Sic: fiber_cancel() can't be used here. */
+	env->bloom_loader = NULL;
 	tuple_unref(env->empty_key.stmt);
 	tuple_format_unref(env->key_format);
 	mempool_destroy(&env->history_node_pool);
@@ -110,6 +116,90 @@ vy_lsm_name(struct vy_lsm *lsm)
 	return buf;
 }
 
+/**
+ * Load bloom filters of all runs of an LSM tree that were
+ * deferred on recovery. A bloom filter that fails to load is
+ * logged and skipped: lookups in the run proceed without it.
+ */
+static void
+vy_lsm_load_blooms(struct vy_lsm *lsm)
+{
+	struct vy_lsm_env *env = lsm->env;
+	while (!lsm->is_dropped && env->bloom_loader == fiber()) {
+		struct vy_run *run = NULL, *it;
+		rlist_foreach_entry(it, &lsm->runs, in_lsm) {
+			if (it->info.bloom_is_deferred) {
+				run = it;
+				break;
+			}
+		}
+		if (run == NULL)
+			break;
+		/*
+		 * Clear the flag before yielding so that the run
+		 * isn't picked again. The run may be removed from
+		 * the LSM tree by compaction while we are loading
+		 * its bloom filter, in which case the bloom filter
+		 * isn't needed anymore.
+		 */
+		run->info.bloom_is_deferred = false;
+		vy_run_ref(run);
+		struct tuple_bloom *bloom;
+		if (vy_run_load_bloom(run, env->path, lsm->space_id,
+				      lsm->index_id, &bloom) != 0) {
+			diag_log();
+			say_error("%s: failed to load bloom filter of run %lld",
+				  vy_lsm_name(lsm), (long long)run->id);
+		} else if (bloom != NULL && rlist_empty(&run->in_lsm)) {
+			tuple_bloom_delete(bloom);
+		} else if (bloom != NULL) {
+			assert(run->info.bloom == NULL);
+			run->info.bloom = bloom;
+			/* Account as vy_lsm_add_run() would have. */
+			size_t bloom_size = vy_run_bloom_size(run);
+			lsm->bloom_size += bloom_size;
+			env->bloom_size += bloom_size;
+			if (vy_run_bloom_type(run) == TUPLE_BLOOM_XOR)
+				env->xor_filter_size += bloom_size;
+			env->disk_index_size += bloom_size;
+		}
+		vy_run_unref(run);
+	}
+}
+
+static int
+vy_lsm_bloom_loader_f(va_list ap)
+{
+	struct vy_lsm_env *env = va_arg(ap, struct vy_lsm_env *);
+	while (env->bloom_loader == fiber() &&
+	       !rlist_empty(&env->bloom_queue)) {
+		struct vy_lsm *lsm = rlist_shift_entry(&env->bloom_queue,
+						       struct vy_lsm,
+						       in_bloom_queue);
+		vy_lsm_ref(lsm);
+		vy_lsm_load_blooms(lsm);
+		vy_lsm_unref(lsm);
+	}
+	if (env->bloom_loader == fiber())
+		env->bloom_loader = NULL;
+	return 0;
+}
+
+void
+vy_lsm_env_start_bloom_loader(struct vy_lsm_env *env)
+{
+	if (env->bloom_loader != NULL || rlist_empty(&env->bloom_queue))
+		return;
+	env->bloom_loader = fiber_new("vinyl.bloom_loader",
+				      vy_lsm_bloom_loader_f);
+	if (env->bloom_loader == NULL) {
+		diag_log();
+		say_error("failed to start bloom filter loader");
+		return;
+	}
+	fiber_start(env->bloom_loader, env);
+}
+
 size_t
 vy_lsm_mem_tree_size(struct vy_lsm *lsm)
 {
@@ -208,7 +298,11 @@ vy_lsm_new(struct vy_lsm_env *lsm_env, struct vy_cache_env *cache_env,
 	lsm->group_id = group_id;
 	lsm->opts = index_def->opts;
 	vy_lsm_read_set_new(&lsm->read_set);
+	vy_read_set_filter_create(&lsm->read_set_filter);
+	rlist_create(&lsm->in_bloom_queue);
+	rlist_create(&lsm->range_tombstones);
 	rlist_create(&lsm->on_destroy);
+	vy_quota_share_create(&lsm->quota_share);
 
 	lsm_env->lsm_count++;
 	return lsm;
@@ -253,6 +347,7 @@ vy_lsm_delete(struct vy_lsm *lsm)
 	assert(vy_lsm_read_set_empty(&lsm->read_set));
 	assert(lsm->env->lsm_count > 0);
 
+	rlist_del_entry(lsm, in_bloom_queue);
 	lsm->env->lsm_count--;
 	lsm->env->compaction_queue_size -=
 			lsm->stat.disk.compaction.queue.bytes;
@@ -271,6 +366,11 @@ vy_lsm_delete(struct vy_lsm *lsm)
 	rlist_foreach_entry_safe(run, &lsm->runs, in_lsm, next_run)
 		vy_lsm_remove_run(lsm, run);
 
+	struct vy_range_tombstone *tombstone, *next_tombstone;
+	rlist_foreach_entry_safe(tombstone, &lsm->range_tombstones,
+				 in_lsm, next_tombstone)
+		vy_range_tombstone_delete(tombstone);
+
 	vy_range_tree_iter(&lsm->range_tree, NULL, vy_range_tree_free_cb, NULL);
 	vy_range_heap_destroy(&lsm->range_heap);
 	tuple_format_unref(lsm->disk_format);
@@ -280,6 +380,7 @@ vy_lsm_delete(struct vy_lsm *lsm)
 		key_def_delete(lsm->pk_in_cmp_def);
 	histogram_delete(lsm->run_hist);
 	vy_lsm_stat_destroy(&lsm->stat);
+	vy_quota_share_destroy(&lsm->quota_share);
 	vy_cache_destroy(&lsm->cache);
 	tuple_format_unref(lsm->mem_format);
 	TRASH(lsm);
@@ -368,7 +469,7 @@ vy_lsm_recover_run(struct vy_lsm *lsm, struct vy_run_recovery_info *run_info,
 	run->dump_lsn = run_info->dump_lsn;
 	run->dump_count = run_info->dump_count;
 	if (vy_run_recover(run, lsm->env->path, lsm->space_id, lsm->index_id,
-			   lsm->cmp_def) != 0 &&
+			   lsm->cmp_def, true) != 0 &&
 	    (!force_recovery ||
 	     vy_run_rebuild_index(run, lsm->env->path,
 				  lsm->space_id, lsm->index_id,
@@ -378,6 +479,14 @@ vy_lsm_recover_run(struct vy_lsm *lsm, struct vy_run_recovery_info *run_info,
 		return NULL;
 	}
 	vy_lsm_add_run(lsm, run);
+	/*
+	 * Bloom filters are loaded in the background once recovery
+	 * is complete, see vy_lsm_env_start_bloom_loader().
+	 */
+	if (run->info.bloom_is_deferred &&
+	    rlist_empty(&lsm->in_bloom_queue))
+		rlist_add_tail_entry(&lsm->env->bloom_queue, lsm,
+				     in_bloom_queue);
 
 	/*
 	 * The same run can be referenced by more than one slice
@@ -607,6 +716,20 @@ vy_lsm_recover(struct vy_lsm *lsm, struct vy_recovery *recovery,
 	 */
 	lsm->dump_lsn = lsm_info->dump_lsn;
 
+	struct vy_range_tombstone_recovery_info *tombstone_info;
+	rlist_foreach_entry(tombstone_info, &lsm_info->range_tombstones,
+			    in_lsm) {
+		struct vy_range_tombstone *tombstone;
+		tombstone = vy_range_tombstone_new(lsm->env, lsm->cmp_def,
+						   tombstone_info->begin,
+						   tombstone_info->end,
+						   tombstone_info->lsn);
+		if (tombstone == NULL)
+			return -1;
+		rlist_add_tail_entry(&lsm->range_tombstones, tombstone,
+				     in_lsm);
+	}
+
 	int rc = 0;
 	struct vy_range_recovery_info *range_info;
 	rlist_foreach_entry(range_info, &lsm_info->ranges, in_lsm) {
@@ -747,6 +870,8 @@ vy_lsm_add_run(struct vy_lsm *lsm, struct vy_run *run)
 
 	env->bloom_size += bloom_size;
 	env->page_index_size += page_index_size;
+	if (vy_run_bloom_type(run) == TUPLE_BLOOM_XOR)
+		env->xor_filter_size += bloom_size;
 
 	/* Data size is consistent with space.bsize. */
 	if (lsm->index_id == 0)
@@ -776,6 +901,8 @@ vy_lsm_remove_run(struct vy_lsm *lsm, struct vy_run *run)
 
 	env->bloom_size -= bloom_size;
 	env->page_index_size -= page_index_size;
+	if (vy_run_bloom_type(run) == TUPLE_BLOOM_XOR)
+		env->xor_filter_size -= bloom_size;
 
 	/* Data size is consistent with space.bsize. */
 	if (lsm->index_id == 0)
@@ -955,6 +1082,8 @@ vy_lsm_commit_upsert(struct vy_lsm *lsm, struct vy_mem *mem,
 	struct vy_entry older;
 	int64_t lsn = vy_stmt_lsn(entry.stmt);
 	uint8_t n_upserts = vy_stmt_n_upserts(entry.stmt);
+	int threshold = lsm->env->upsert_squash_threshold;
+	assert(threshold >= 1 && threshold <= VY_UPSERT_THRESHOLD);
 	/*
 	 * If there are a lot of successive upserts for the same key,
 	 * select might take too long to squash them all. So once the
@@ -962,18 +1091,17 @@ vy_lsm_commit_upsert(struct vy_lsm *lsm, struct vy_mem *mem,
 	 * a fiber to merge them and insert the resulting statement
 	 * after the latest upsert.
 	 */
-	if (n_upserts == VY_UPSERT_INF) {
+	if (n_upserts > threshold) {
 		/*
-		 * If UPSERT has n_upserts > VY_UPSERT_THRESHOLD,
-		 * it means the mem has older UPSERTs for the same
-		 * key which already are beeing processed in the
-		 * squashing task. At the end, the squashing task
-		 * will merge its result with this UPSERT
-		 * automatically.
+		 * If UPSERT has n_upserts > threshold, it means
+		 * the mem has older UPSERTs for the same key which
+		 * already are beeing processed in the squashing
+		 * task. At the end, the squashing task will merge
+		 * its result with this UPSERT automatically.
 		 */
 		return;
 	}
-	if (n_upserts == VY_UPSERT_THRESHOLD) {
+	if (n_upserts == threshold) {
 		/*
 		 * Start single squashing task per one-mem and
 		 * one-key continous UPSERTs sequence.
@@ -982,7 +1110,7 @@ vy_lsm_commit_upsert(struct vy_lsm *lsm, struct vy_mem *mem,
 		older = vy_mem_older_lsn(mem, entry);
 		assert(older.stmt != NULL &&
 		       vy_stmt_type(older.stmt) == IPROTO_UPSERT &&
-		       vy_stmt_n_upserts(older.stmt) == VY_UPSERT_THRESHOLD - 1);
+		       vy_stmt_n_upserts(older.stmt) == threshold - 1);
 #endif
 		if (lsm->env->upsert_thresh_cb == NULL) {
 			/* Squash callback is not installed. */
@@ -1308,6 +1436,190 @@ fail_range:
 	return false;
 }
 
+struct vy_range_tombstone *
+vy_range_tombstone_new(struct vy_lsm_env *env, struct key_def *cmp_def,
+		       const char *begin, const char *end, int64_t lsn)
+{
+	struct vy_range_tombstone *tombstone = malloc(sizeof(*tombstone));
+	if (tombstone == NULL) {
+		diag_set(OutOfMemory, sizeof(*tombstone),
+			 "malloc", "struct vy_range_tombstone");
+		return NULL;
+	}
+	if (begin != NULL) {
+		tombstone->begin = vy_entry_key_from_msgpack(env->key_format,
+							     cmp_def, begin);
+	} else {
+		tombstone->begin = env->empty_key;
+		tuple_ref(tombstone->begin.stmt);
+	}
+	if (tombstone->begin.stmt == NULL)
+		goto fail_begin;
+	if (end != NULL) {
+		tombstone->end = vy_entry_key_from_msgpack(env->key_format,
+							   cmp_def, end);
+	} else {
+		tombstone->end = env->empty_key;
+		tuple_ref(tombstone->end.stmt);
+	}
+	if (tombstone->end.stmt == NULL)
+		goto fail_end;
+	tombstone->lsn = lsn;
+	rlist_create(&tombstone->in_lsm);
+	return tombstone;
+fail_end:
+	tuple_unref(tombstone->begin.stmt);
+fail_begin:
+	free(tombstone);
+	return NULL;
+}
+
+void
+vy_range_tombstone_delete(struct vy_range_tombstone *tombstone)
+{
+	tuple_unref(tombstone->begin.stmt);
+	tuple_unref(tombstone->end.stmt);
+	TRASH(tombstone);
+	free(tombstone);
+}
+
+bool
+vy_range_tombstone_covers(struct vy_range_tombstone *tombstone,
+			  struct vy_entry entry, struct key_def *cmp_def)
+{
+	if (!vy_stmt_is_empty_key(tombstone->begin.stmt) &&
+	    vy_entry_compare(entry, tombstone->begin, cmp_def) < 0)
+		return false;
+	if (!vy_stmt_is_empty_key(tombstone->end.stmt) &&
+	    vy_entry_compare(entry, tombstone->end, cmp_def) >= 0)
+		return false;
+	return true;
+}
+
+int64_t
+vy_lsm_do_range_tombstone_lsn(struct vy_lsm *lsm, struct vy_entry entry,
+			      int64_t vlsn)
+{
+	int64_t lsn = 0;
+	struct vy_range_tombstone *tombstone;
+	rlist_foreach_entry(tombstone, &lsm->range_tombstones, in_lsm) {
+		if (tombstone->lsn > vlsn || tombstone->lsn <= lsn)
+			continue;
+		if (vy_range_tombstone_covers(tombstone, entry, lsm->cmp_def))
+			lsn = tombstone->lsn;
+	}
+	return lsn;
+}
+
+void
+vy_lsm_add_range_tombstone(struct vy_lsm *lsm,
+			   struct vy_range_tombstone *tombstone)
+{
+	rlist_add_tail_entry(&lsm->range_tombstones, tombstone, in_lsm);
+	vy_cache_on_range_delete(&lsm->cache, tombstone->begin,
+				 tombstone->end);
+	/* Make open iterators apply the tombstone. */
+	lsm->mem_list_version++;
+}
+
+void
+vy_lsm_remove_range_tombstone(struct vy_lsm *lsm,
+			      struct vy_range_tombstone *tombstone)
+{
+	rlist_del_entry(tombstone, in_lsm);
+	lsm->mem_list_version++;
+}
+
+/**
+ * Return true if the given range may contain statements
+ * covered by the given range tombstone.
+ */
+static bool
+vy_range_intersects_tombstone(struct vy_range *range,
+			      struct vy_range_tombstone *tombstone,
+			      struct key_def *cmp_def)
+{
+	if (range->end.stmt != NULL &&
+	    !vy_stmt_is_empty_key(tombstone->begin.stmt) &&
+	    vy_entry_compare(range->end, tombstone->begin, cmp_def) < 0)
+		return false;
+	if (range->begin.stmt != NULL &&
+	    !vy_stmt_is_empty_key(tombstone->end.stmt) &&
+	    vy_entry_compare(range->begin, tombstone->end, cmp_def) > 0)
+		return false;
+	return true;
+}
+
+void
+vy_lsm_commit_range_tombstone(struct vy_lsm *lsm,
+			      struct vy_range_tombstone *tombstone,
+			      int64_t lsn)
+{
+	assert(lsn < MAX_LSN);
+	tombstone->lsn = lsn;
+
+	/*
+	 * The tombstone must be persisted before the LSM tree
+	 * is dumped, because after that the WAL row it was
+	 * created by won't be replayed on recovery.
+	 */
+	vy_log_tx_begin();
+	vy_log_insert_range_tombstone(lsm->id, lsn,
+				      tuple_data(tombstone->begin.stmt),
+				      tuple_data(tombstone->end.stmt));
+	vy_log_tx_try_commit();
+
+	struct vy_range *range;
+	struct vy_range_tree_iterator it;
+	vy_range_tree_ifirst(&lsm->range_tree, &it);
+	while ((range = vy_range_tree_inext(&it)) != NULL) {
+		if (range->slice_count == 0 ||
+		    !vy_range_intersects_tombstone(range, tombstone,
+						   lsm->cmp_def))
+			continue;
+		vy_lsm_unacct_range(lsm, range);
+		range->needs_compaction = true;
+		vy_range_update_compaction_priority(range, &lsm->opts);
+		vy_lsm_acct_range(lsm, range);
+	}
+	vy_range_heap_update_all(&lsm->range_heap);
+}
+
+void
+vy_lsm_gc_range_tombstones(struct vy_lsm *lsm)
+{
+	struct vy_range_tombstone *tombstone, *next_tombstone;
+	rlist_foreach_entry_safe(tombstone, &lsm->range_tombstones,
+				 in_lsm, next_tombstone) {
+		/* Older statements must have been dumped. */
+		if (tombstone->lsn >= MAX_LSN ||
+		    tombstone->lsn > lsm->dump_lsn)
+			continue;
+		/* All runs must have been written with it applied. */
+		bool is_applied = true;
+		struct vy_run *run;
+		rlist_foreach_entry(run, &lsm->runs, in_lsm) {
+			if (run->info.range_tombstone_lsn < tombstone->lsn &&
+			    run->info.min_lsn < tombstone->lsn) {
+				is_applied = false;
+				break;
+			}
+		}
+		if (!is_applied)
+			continue;
+		/*
+		 * No need to wait for the record to be flushed:
+		 * if it's lost, the tombstone will be dropped
+		 * again after restart.
+		 */
+		vy_log_tx_begin();
+		vy_log_delete_range_tombstone(lsm->id, tombstone->lsn);
+		vy_log_tx_try_commit();
+		vy_lsm_remove_range_tombstone(lsm, tombstone);
+		vy_range_tombstone_delete(tombstone);
+	}
+}
+
 void
 vy_lsm_force_compaction(struct vy_lsm *lsm)
 {
@@ -45,12 +45,14 @@
 #include "vy_cache.h"
 #include "vy_range.h"
 #include "vy_stat.h"
+#include "vy_quota.h"
 #include "vy_read_set.h"
 
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+struct fiber;
 struct histogram;
 struct tuple;
 struct tuple_format;
@@ -81,15 +83,29 @@ struct vy_lsm_env {
 	double too_long_threshold;
 	/**
 	 * Callback invoked when the number of upserts for
-	 * the same key exceeds VY_UPSERT_THRESHOLD.
+	 * the same key reaches upsert_squash_threshold.
 	 */
 	vy_upsert_thresh_cb upsert_thresh_cb;
 	/** Argument passed to upsert_thresh_cb. */
 	void *upsert_thresh_arg;
+	/**
+	 * Number of upserts for the same key stored in memory
+	 * that triggers background squashing, 1..VY_UPSERT_THRESHOLD.
+	 */
+	int upsert_squash_threshold;
+	/** Upsert statistics of all LSM trees. */
+	struct {
+		/** How many upsert chains have been squashed. */
+		int64_t squashed;
+		/** How many upserts have been applied on read. */
+		int64_t applied_on_read;
+	} upsert_stat;
 	/** Number of LSM trees in this environment. */
 	int lsm_count;
 	/** Size of memory used for bloom filters. */
 	size_t bloom_size;
+	/** Size of memory used for xor filters, included in bloom_size. */
+	size_t xor_filter_size;
 	/** Size of memory used for page index. */
 	size_t page_index_size;
 	/**
@@ -126,6 +142,16 @@ struct vy_lsm_env {
 	int64_t compaction_queue_size;
 	/** Memory pool for vy_history_node allocations. */
 	struct mempool history_node_pool;
+	/**
+	 * LSM trees that have runs with bloom filters deferred
+	 * on recovery, see vy_run_info::bloom_is_deferred. Linked
+	 * by vy_lsm::in_bloom_queue. LSM trees accessed by readers
+	 * are moved to the head of the queue so that hot LSM trees
+	 * get their bloom filters loaded first.
+	 */
+	struct rlist bloom_queue;
+	/** Fiber loading deferred bloom filters or NULL. */
+	struct fiber *bloom_loader;
 };
 
 /** Create a common LSM tree environment. */
@@ -139,6 +165,54 @@ vy_lsm_env_create(struct vy_lsm_env *env, const char *path,
 void
 vy_lsm_env_destroy(struct vy_lsm_env *env);
 
+/**
+ * Start a background fiber loading bloom filters deferred on
+ * recovery. The fiber exits once the bloom queue is empty.
+ * Called upon recovery completion, when reader threads are up.
+ */
+void
+vy_lsm_env_start_bloom_loader(struct vy_lsm_env *env);
+
+/**
+ * Range tombstone: deletes all statements in the key range
+ * [begin, end) older than the tombstone. The begin key is
+ * inclusive, the end key is exclusive, both are compared by
+ * prefix. An empty key stands for infinity.
+ */
+struct vy_range_tombstone {
+	/** Link in vy_lsm::range_tombstones. */
+	struct rlist in_lsm;
+	/** Start of the deleted range, SELECT statement. */
+	struct vy_entry begin;
+	/** End of the deleted range, SELECT statement. */
+	struct vy_entry end;
+	/**
+	 * LSN of the tombstone. Until the tombstone is committed,
+	 * it is set to the prepared statement LSN (>= MAX_LSN).
+	 */
+	int64_t lsn;
+};
+
+/**
+ * Allocate a range tombstone. @begin and @end are MessagePack
+ * arrays or NULL, which is equivalent to an empty key.
+ */
+struct vy_range_tombstone *
+vy_range_tombstone_new(struct vy_lsm_env *env, struct key_def *cmp_def,
+		       const char *begin, const char *end, int64_t lsn);
+
+/** Free a range tombstone. */
+void
+vy_range_tombstone_delete(struct vy_range_tombstone *tombstone);
+
+/**
+ * Return true if the given statement falls in the key range
+ * deleted by a range tombstone. The statement LSN isn't checked.
+ */
+bool
+vy_range_tombstone_covers(struct vy_range_tombstone *tombstone,
+			  struct vy_entry entry, struct key_def *cmp_def);
+
 /**
  * A struct for primary and secondary Vinyl indexes.
  * Named after the data structure used for organizing
@@ -226,6 +300,11 @@ struct vy_lsm {
 	struct vy_lsm *pk;
 	/** LSM tree statistics. */
 	struct vy_lsm_stat stat;
+	/**
+	 * Share of the memory quota rate limits granted to writers
+	 * to the space. Used by the primary index only.
+	 */
+	struct vy_quota_share quota_share;
 	/**
 	 * Merge cache of this LSM tree. Contains hottest tuples
 	 * with continuation markers.
@@ -312,6 +391,17 @@ struct vy_lsm {
 	 * this LSM tree.
 	 */
 	vy_lsm_read_set_t read_set;
+	/** Filter of intervals stored in @read_set. */
+	struct vy_read_set_filter read_set_filter;
+	/** Link in vy_lsm_env::bloom_queue. */
+	struct rlist in_bloom_queue;
+	/**
+	 * List of range tombstones that may still cover some
+	 * statements of this LSM tree, linked by
+	 * vy_range_tombstone::in_lsm. Used by the primary index
+	 * only.
+	 */
+	struct rlist range_tombstones;
 	/**
 	 * Triggers run when the last reference to this LSM tree
 	 * is dropped and the LSM tree is about to be destroyed.
@@ -350,6 +440,62 @@ vy_lsm_new(struct vy_lsm_env *lsm_env, struct vy_cache_env *cache_env,
 void
 vy_lsm_delete(struct vy_lsm *lsm);
 
+/**
+ * Return the max LSN of range tombstones visible from a read view
+ * with the given LSN that cover the given statement, or 0 if there
+ * are no such tombstones. Statements older than the returned LSN
+ * are deleted.
+ */
+int64_t
+vy_lsm_do_range_tombstone_lsn(struct vy_lsm *lsm, struct vy_entry entry,
+			      int64_t vlsn);
+
+static inline int64_t
+vy_lsm_range_tombstone_lsn(struct vy_lsm *lsm, struct vy_entry entry,
+			   int64_t vlsn)
+{
+	if (likely(rlist_empty(&lsm->range_tombstones)))
+		return 0;
+	return vy_lsm_do_range_tombstone_lsn(lsm, entry, vlsn);
+}
+
+/**
+ * Add a prepared range tombstone to an LSM tree. Invalidates
+ * the cache and iterators opened for the LSM tree.
+ */
+void
+vy_lsm_add_range_tombstone(struct vy_lsm *lsm,
+			   struct vy_range_tombstone *tombstone);
+
+/**
+ * Remove a range tombstone from an LSM tree, e.g. on rollback.
+ * Invalidates iterators opened for the LSM tree.
+ */
+void
+vy_lsm_remove_range_tombstone(struct vy_lsm *lsm,
+			      struct vy_range_tombstone *tombstone);
+
+/**
+ * Commit a range tombstone added to an LSM tree: assign the
+ * final LSN, write it to the metadata log, and schedule
+ * compaction of all ranges the tombstone intersects so as to
+ * reclaim disk space.
+ */
+void
+vy_lsm_commit_range_tombstone(struct vy_lsm *lsm,
+			      struct vy_range_tombstone *tombstone,
+			      int64_t lsn);
+
+/**
+ * Drop range tombstones that don't cover any statements stored
+ * in the LSM tree anymore. A tombstone can be dropped as soon as
+ * all older statements have been dumped and each run has been
+ * written with the tombstone applied. Called on dump and
+ * compaction completion.
+ */
+void
+vy_lsm_gc_range_tombstones(struct vy_lsm *lsm);
+
 /**
  * Return true if the LSM tree has no statements, neither on disk
  * nor in memory.
@@ -393,6 +539,21 @@ vy_lsm_unref(struct vy_lsm *lsm)
 	index_unref(&lsm->base);
 }
 
+/**
+ * Called on each read from an LSM tree. If the LSM tree has
+ * bloom filters that haven't been loaded yet, move it to the
+ * head of the bloom queue so that it's processed next.
+ */
+static inline void
+vy_lsm_prioritize_bloom_load(struct vy_lsm *lsm)
+{
+	if (rlist_empty(&lsm->in_bloom_queue) ||
+	    rlist_first(&lsm->env->bloom_queue) == &lsm->in_bloom_queue)
+		return;
+	rlist_del_entry(lsm, in_bloom_queue);
+	rlist_add_entry(&lsm->env->bloom_queue, lsm, in_bloom_queue);
+}
+
 /**
  * Update pointer to the primary key for an LSM tree.
  * If called for an LSM tree corresponding to a primary
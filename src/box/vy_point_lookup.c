@@ -79,8 +79,10 @@ vy_point_lookup_scan_cache(struct vy_lsm *lsm, const struct vy_read_view **rv,
 	lsm->cache.stat.lookup++;
 	struct vy_entry entry = vy_cache_get(&lsm->cache, key);
 
-	if (entry.stmt == NULL || vy_stmt_lsn(entry.stmt) > (*rv)->vlsn)
+	if (entry.stmt == NULL || vy_stmt_lsn(entry.stmt) > (*rv)->vlsn) {
+		lsm->cache.stat.miss++;
 		return 0;
+	}
 
 	vy_stmt_counter_acct_tuple(&lsm->cache.stat.get, entry.stmt);
 	return vy_history_append_stmt(history, entry);
@@ -192,6 +194,19 @@ vy_point_lookup_scan_slices(struct vy_lsm *lsm, const struct vy_read_view **rv,
 	return rc;
 }
 
+/**
+ * Remove statements deleted by range tombstones from a history.
+ * Returns true if any statement was removed, in which case older
+ * statements are deleted as well and needn't be looked up.
+ */
+static bool
+vy_point_lookup_cut(struct vy_lsm *lsm, const struct vy_read_view **rv,
+		    struct vy_entry key, struct vy_history *history)
+{
+	int64_t lsn = vy_lsm_range_tombstone_lsn(lsm, key, (*rv)->vlsn);
+	return lsn > 0 && vy_history_cut(history, lsn);
+}
+
 int
 vy_point_lookup(struct vy_lsm *lsm, struct vy_tx *tx,
 		const struct vy_read_view **rv,
@@ -204,6 +219,8 @@ vy_point_lookup(struct vy_lsm *lsm, struct vy_tx *tx,
 	*ret = vy_entry_none();
 	int rc = 0;
 
+	vy_lsm_prioritize_bloom_load(lsm);
+
 	/* History list */
 	struct vy_history history, mem_history, disk_history;
 	vy_history_create(&history, &lsm->env->history_node_pool);
@@ -220,7 +237,8 @@ vy_point_lookup(struct vy_lsm *lsm, struct vy_tx *tx,
 
 restart:
 	rc = vy_point_lookup_scan_mems(lsm, rv, key, &mem_history);
-	if (rc != 0 || vy_history_is_terminal(&mem_history))
+	if (rc != 0 || vy_history_is_terminal(&mem_history) ||
+	    vy_point_lookup_cut(lsm, rv, key, &mem_history))
 		goto done;
 
 	/* Save version before yield */
@@ -279,6 +297,8 @@ restart:
 	}
 
 done:
+	vy_point_lookup_cut(lsm, rv, key, &mem_history);
+	vy_point_lookup_cut(lsm, rv, key, &disk_history);
 	vy_history_splice(&history, &mem_history);
 	vy_history_splice(&history, &disk_history);
 
@@ -287,6 +307,7 @@ done:
 		rc = vy_history_apply(&history, lsm->cmp_def,
 				      false, &upserts_applied, ret);
 		lsm->stat.upsert.applied += upserts_applied;
+		lsm->env->upsert_stat.applied_on_read += upserts_applied;
 	}
 	vy_history_cleanup(&history);
 
@@ -311,7 +332,8 @@ vy_point_lookup_mem(struct vy_lsm *lsm, const struct vy_read_view **rv,
 		goto done;
 
 	rc = vy_point_lookup_scan_mems(lsm, rv, key, &history);
-	if (rc != 0 || vy_history_is_terminal(&history))
+	if (rc != 0 || vy_point_lookup_cut(lsm, rv, key, &history) ||
+	    vy_history_is_terminal(&history))
 		goto done;
 
 	*ret = vy_entry_none();
@@ -322,6 +344,7 @@ done:
 		rc = vy_history_apply(&history, lsm->cmp_def,
 				      true, &upserts_applied, ret);
 		lsm->stat.upsert.applied += upserts_applied;
+		lsm->env->upsert_stat.applied_on_read += upserts_applied;
 	}
 out:
 	vy_history_cleanup(&history);
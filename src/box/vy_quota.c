@@ -51,6 +51,12 @@
  */
 static const double VY_QUOTA_TIMER_PERIOD = 0.1;
 
+/**
+ * A quota share that hasn't consumed quota for this long, in
+ * seconds, stops taking part in splitting the rate limits.
+ */
+static const double VY_QUOTA_SHARE_IDLE_TIME = 1;
+
 /**
  * Bit mask of resources used by a particular consumer type.
  */
@@ -103,6 +109,60 @@ vy_rate_limit_is_applicable(enum vy_quota_consumer_type consumer_type,
 					(1 << resource_type)) != 0;
 }
 
+void
+vy_quota_share_create(struct vy_quota_share *share)
+{
+	for (int i = 0; i < vy_quota_resource_type_MAX; i++)
+		vy_rate_limit_create(&share->rate_limit[i]);
+	rlist_create(&share->in_shares);
+	share->last_use_time = 0;
+}
+
+void
+vy_quota_share_destroy(struct vy_quota_share *share)
+{
+	rlist_del_entry(share, in_shares);
+}
+
+/**
+ * Return true if the rate limits applicable to a consumer of
+ * the given type allow it to proceed, either because there's
+ * quota left or because the consumer's share isn't exhausted.
+ */
+static inline bool
+vy_quota_rate_limit_may_use(struct vy_quota *q,
+			    enum vy_quota_consumer_type type,
+			    struct vy_quota_share *share)
+{
+	for (int i = 0; i < vy_quota_resource_type_MAX; i++) {
+		if (!vy_rate_limit_is_applicable(type, i) ||
+		    vy_rate_limit_may_use(&q->rate_limit[i]))
+			continue;
+		if (share == NULL ||
+		    !vy_rate_limit_may_use(&share->rate_limit[i]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Return true if the share of a consumer allows it to proceed
+ * regardless of the common rate limits.
+ */
+static inline bool
+vy_quota_share_may_use(enum vy_quota_consumer_type type,
+		       struct vy_quota_share *share)
+{
+	if (share == NULL)
+		return false;
+	for (int i = 0; i < vy_quota_resource_type_MAX; i++) {
+		if (vy_rate_limit_is_applicable(type, i) &&
+		    !vy_rate_limit_may_use(&share->rate_limit[i]))
+			return false;
+	}
+	return true;
+}
+
 /**
  * Return true if the requested amount of memory may be consumed
  * right now, false if consumers have to wait.
@@ -113,7 +173,7 @@ vy_rate_limit_is_applicable(enum vy_quota_consumer_type consumer_type,
  */
 static inline bool
 vy_quota_may_use(struct vy_quota *q, enum vy_quota_consumer_type type,
-		 size_t size)
+		 struct vy_quota_share *share, size_t size)
 {
 	if (!q->is_enabled)
 		return true;
@@ -121,13 +181,7 @@ vy_quota_may_use(struct vy_quota *q, enum vy_quota_consumer_type type,
 		q->quota_exceeded_cb(q);
 		return false;
 	}
-	for (int i = 0; i < vy_quota_resource_type_MAX; i++) {
-		struct vy_rate_limit *rl = &q->rate_limit[i];
-		if (vy_rate_limit_is_applicable(type, i) &&
-		    !vy_rate_limit_may_use(rl))
-			return false;
-	}
-	return true;
+	return vy_quota_rate_limit_may_use(q, type, share);
 }
 
 /**
@@ -135,13 +189,26 @@ vy_quota_may_use(struct vy_quota *q, enum vy_quota_consumer_type type,
  */
 static inline void
 vy_quota_do_use(struct vy_quota *q, enum vy_quota_consumer_type type,
-		size_t size)
+		struct vy_quota_share *share, size_t size)
 {
 	q->used += size;
 	for (int i = 0; i < vy_quota_resource_type_MAX; i++) {
-		struct vy_rate_limit *rl = &q->rate_limit[i];
-		if (vy_rate_limit_is_applicable(type, i))
-			vy_rate_limit_use(rl, size);
+		if (!vy_rate_limit_is_applicable(type, i))
+			continue;
+		vy_rate_limit_use(&q->rate_limit[i], size);
+		if (share != NULL)
+			vy_rate_limit_use(&share->rate_limit[i], size);
+	}
+	if (share != NULL) {
+		/*
+		 * A share that has just become active keeps its
+		 * state until the next refill caps it, so a new
+		 * share may proceed right away while a share that
+		 * was idle for a while still owes its debt.
+		 */
+		share->last_use_time = ev_monotonic_now(loop());
+		if (rlist_empty(&share->in_shares))
+			rlist_add_tail_entry(&q->shares, share, in_shares);
 	}
 }
 
@@ -151,14 +218,44 @@ vy_quota_do_use(struct vy_quota *q, enum vy_quota_consumer_type type,
  */
 static inline void
 vy_quota_do_unuse(struct vy_quota *q, enum vy_quota_consumer_type type,
-		  size_t size)
+		  struct vy_quota_share *share, size_t size)
 {
 	assert(q->used >= size);
 	q->used -= size;
 	for (int i = 0; i < vy_quota_resource_type_MAX; i++) {
-		struct vy_rate_limit *rl = &q->rate_limit[i];
-		if (vy_rate_limit_is_applicable(type, i))
-			vy_rate_limit_unuse(rl, size);
+		if (!vy_rate_limit_is_applicable(type, i))
+			continue;
+		vy_rate_limit_unuse(&q->rate_limit[i], size);
+		if (share != NULL)
+			vy_rate_limit_unuse(&share->rate_limit[i], size);
+	}
+}
+
+/**
+ * Split the rate limits among the shares that consumed quota
+ * recently and replenish them. Forget idle shares.
+ */
+static void
+vy_quota_refill_shares(struct vy_quota *q)
+{
+	double now = ev_monotonic_now(loop());
+	int count = 0;
+	struct vy_quota_share *share, *tmp;
+	rlist_foreach_entry_safe(share, &q->shares, in_shares, tmp) {
+		if (now - share->last_use_time > VY_QUOTA_SHARE_IDLE_TIME) {
+			rlist_del_entry(share, in_shares);
+			continue;
+		}
+		count++;
+	}
+	if (count == 0)
+		return;
+	rlist_foreach_entry(share, &q->shares, in_shares) {
+		for (int i = 0; i < vy_quota_resource_type_MAX; i++) {
+			struct vy_rate_limit *rl = &share->rate_limit[i];
+			vy_rate_limit_set(rl, q->rate_limit[i].rate / count);
+			vy_rate_limit_refill(rl, VY_QUOTA_TIMER_PERIOD);
+		}
 	}
 }
 
@@ -196,7 +293,7 @@ vy_quota_signal(struct vy_quota *q)
 		 * No need in waking up a consumer if it will have
 		 * to go back to sleep immediately.
 		 */
-		if (!vy_quota_may_use(q, i, n->size))
+		if (!vy_quota_may_use(q, i, n->share, n->size))
 			continue;
 
 		if (oldest == NULL || oldest->ticket > n->ticket)
@@ -216,6 +313,7 @@ vy_quota_timer_cb(ev_loop *loop, ev_timer *timer, int events)
 
 	for (int i = 0; i < vy_quota_resource_type_MAX; i++)
 		vy_rate_limit_refill(&q->rate_limit[i], VY_QUOTA_TIMER_PERIOD);
+	vy_quota_refill_shares(q);
 	vy_quota_signal(q);
 }
 
@@ -233,6 +331,7 @@ vy_quota_create(struct vy_quota *q, size_t limit,
 		rlist_create(&q->wait_queue[i]);
 	for (int i = 0; i < vy_quota_resource_type_MAX; i++)
 		vy_rate_limit_create(&q->rate_limit[i]);
+	rlist_create(&q->shares);
 	ev_timer_init(&q->timer, vy_quota_timer_cb, 0, VY_QUOTA_TIMER_PERIOD);
 	q->timer.data = q;
 }
@@ -250,6 +349,9 @@ void
 vy_quota_destroy(struct vy_quota *q)
 {
 	ev_timer_stop(loop(), &q->timer);
+	struct vy_quota_share *share, *tmp;
+	rlist_foreach_entry_safe(share, &q->shares, in_shares, tmp)
+		rlist_del_entry(share, in_shares);
 }
 
 void
@@ -283,7 +385,7 @@ void
 vy_quota_force_use(struct vy_quota *q, enum vy_quota_consumer_type type,
 		   size_t size)
 {
-	vy_quota_do_use(q, type, size);
+	vy_quota_do_use(q, type, NULL, size);
 	vy_quota_check_limit(q);
 }
 
@@ -301,7 +403,7 @@ vy_quota_release(struct vy_quota *q, size_t size)
 
 int
 vy_quota_use(struct vy_quota *q, enum vy_quota_consumer_type type,
-	     size_t size, double timeout)
+	     struct vy_quota_share *share, size_t size, double timeout)
 {
 	/*
 	 * Fail early if the configured memory limit never allows
@@ -316,10 +418,13 @@ vy_quota_use(struct vy_quota *q, enum vy_quota_consumer_type type,
 	 * Proceed only if there is enough quota available *and*
 	 * the wait queue is empty. The latter is necessary to ensure
 	 * fairness and avoid starvation among fibers queued earlier.
+	 * A consumer within its fair share may bypass the queue,
+	 * because the queued ones are behind their shares.
 	 */
-	if (rlist_empty(&q->wait_queue[type]) &&
-	    vy_quota_may_use(q, type, size)) {
-		vy_quota_do_use(q, type, size);
+	if ((rlist_empty(&q->wait_queue[type]) ||
+	     vy_quota_share_may_use(type, share)) &&
+	    vy_quota_may_use(q, type, share, size)) {
+		vy_quota_do_use(q, type, share, size);
 		return 0;
 	}
 
@@ -327,6 +432,7 @@ vy_quota_use(struct vy_quota *q, enum vy_quota_consumer_type type,
 	double wait_start = ev_monotonic_now(loop());
 	struct vy_quota_wait_node wait_node = {
 		.fiber = fiber(),
+		.share = share,
 		.size = size,
 		.ticket = ++q->wait_ticket,
 	};
@@ -346,7 +452,7 @@ vy_quota_use(struct vy_quota *q, enum vy_quota_consumer_type type,
 				     wait_time);
 	}
 
-	vy_quota_do_use(q, type, size);
+	vy_quota_do_use(q, type, share, size);
 	/*
 	 * Blocked consumers are awaken one by one to preserve
 	 * the order they were put to sleep. It's a responsibility
@@ -359,14 +465,14 @@ vy_quota_use(struct vy_quota *q, enum vy_quota_consumer_type type,
 
 void
 vy_quota_adjust(struct vy_quota *q, enum vy_quota_consumer_type type,
-		size_t reserved, size_t used)
+		struct vy_quota_share *share, size_t reserved, size_t used)
 {
 	if (reserved > used) {
-		vy_quota_do_unuse(q, type, reserved - used);
+		vy_quota_do_unuse(q, type, share, reserved - used);
 		vy_quota_signal(q);
 	}
 	if (reserved < used) {
-		vy_quota_do_use(q, type, used - reserved);
+		vy_quota_do_use(q, type, share, used - reserved);
 		vy_quota_check_limit(q);
 	}
 }
@@ -156,11 +156,45 @@ enum vy_quota_consumer_type {
 	vy_quota_consumer_type_MAX,
 };
 
+/**
+ * Fair share of the rate limits granted to a group of consumers,
+ * e.g. writers to a particular space.
+ *
+ * Every share that consumed quota recently gets an equal part of
+ * each rate limit. When a rate limit is exhausted, a consumer may
+ * still proceed as long as its share isn't exhausted, i.e. if it
+ * has consumed less than its fair part. This way a runaway writer
+ * is throttled while writers to other spaces keep their latency.
+ * Quota consumed within a share is charged to the common rate
+ * limit as well, so the total rate stays within the limit in the
+ * long run: the runaway writer pays for the others.
+ *
+ * The hard memory limit is never shared.
+ */
+struct vy_quota_share {
+	/** Rate limit state, one per each resource type. */
+	struct vy_rate_limit rate_limit[vy_quota_resource_type_MAX];
+	/** Link in vy_quota::shares, empty if the share is idle. */
+	struct rlist in_shares;
+	/** Time when quota was consumed within the share last time. */
+	double last_use_time;
+};
+
+/** Initialize a quota share. */
+void
+vy_quota_share_create(struct vy_quota_share *share);
+
+/** Destroy a quota share. */
+void
+vy_quota_share_destroy(struct vy_quota_share *share);
+
 struct vy_quota_wait_node {
 	/** Link in vy_quota::wait_queue. */
 	struct rlist in_wait_queue;
 	/** Fiber waiting for quota. */
 	struct fiber *fiber;
+	/** Share of the waiting consumer or NULL. */
+	struct vy_quota_share *share;
 	/** Amount of requested memory. */
 	size_t size;
 	/**
@@ -212,6 +246,12 @@ struct vy_quota {
 	struct rlist wait_queue[vy_quota_consumer_type_MAX];
 	/** Rate limit state, one per each resource type. */
 	struct vy_rate_limit rate_limit[vy_quota_resource_type_MAX];
+	/**
+	 * Shares that consumed quota recently, linked by
+	 * vy_quota_share::in_shares. The rate limits are split
+	 * evenly among them.
+	 */
+	struct rlist shares;
 	/**
 	 * Periodic timer that is used for refilling the rate
 	 * limit value.
@@ -281,6 +321,10 @@ vy_quota_release(struct vy_quota *q, size_t size);
  * if the limit is exceeded. @timeout specifies the maximal
  * time to wait. Return 0 on success, -1 on timeout.
  *
+ * If @share is not NULL, the caller may proceed regardless of
+ * an exhausted rate limit as long as the share isn't exhausted,
+ * see struct vy_quota_share.
+ *
  * Usage pattern:
  *
  *   size_t reserved = <estimate>;
@@ -312,7 +356,7 @@ vy_quota_release(struct vy_quota *q, size_t size);
  */
 int
 vy_quota_use(struct vy_quota *q, enum vy_quota_consumer_type type,
-	     size_t size, double timeout);
+	     struct vy_quota_share *share, size_t size, double timeout);
 
 /**
  * Adjust quota after allocating memory.
@@ -324,7 +368,7 @@ vy_quota_use(struct vy_quota *q, enum vy_quota_consumer_type type,
  */
 void
 vy_quota_adjust(struct vy_quota *q, enum vy_quota_consumer_type type,
-		size_t reserved, size_t used);
+		struct vy_quota_share *share, size_t reserved, size_t used);
 
 /**
  * Block the caller until the quota is not exceeded.
@@ -332,7 +376,7 @@ vy_quota_adjust(struct vy_quota *q, enum vy_quota_consumer_type type,
 static inline void
 vy_quota_wait(struct vy_quota *q, enum vy_quota_consumer_type type)
 {
-	vy_quota_use(q, type, 0, TIMEOUT_INFINITY);
+	vy_quota_use(q, type, NULL, 0, TIMEOUT_INFINITY);
 }
 
 #if defined(__cplusplus)
@@ -261,6 +261,82 @@ vy_range_remove_slice(struct vy_range *range, struct vy_slice *slice)
 	range->version++;
 }
 
+/**
+ * Size-tiered compaction strategy. Runs of similar size, i.e.
+ * which differ no more than run_size_ratio times from the newest
+ * (smallest) run of a group, are grouped into tiers:
+ *
+ *   tier 1: runs 1 .. T_1
+ *   tier 2: runs T_1 + 1 .. T_2
+ *   ...
+ *
+ * When the number of runs in a tier exceeds run_count_per_level,
+ * we compact them along with all runs from the upper tiers. The
+ * resulting run moves to the next tier, which is compacted only
+ * when it collects enough runs too. Unlike the leveled strategy,
+ * the number of runs in the last tier isn't limited by one, so
+ * statements are rewritten much less often, at the cost of more
+ * runs to read and higher space amplification.
+ */
+static void
+vy_range_update_compaction_priority_tiered(struct vy_range *range,
+					   const struct index_opts *opts)
+{
+	/* Total number of statements in checked runs. */
+	struct vy_disk_stmt_counter total_stmt_count;
+	vy_disk_stmt_counter_reset(&total_stmt_count);
+	/* Total number of checked runs. */
+	uint32_t total_run_count = 0;
+	/* Estimated size of a compacted run, if compaction is scheduled. */
+	uint64_t est_new_run_size = 0;
+	/* The number of runs in the current tier. */
+	uint32_t tier_run_count = 0;
+	/* The size of the smallest run in the current tier. */
+	uint64_t tier_run_size = 0;
+
+	struct vy_slice *slice;
+	rlist_foreach_entry(slice, &range->slices, in_range) {
+		uint64_t size = MAX(slice->count.bytes, 1);
+		total_run_count++;
+		vy_disk_stmt_counter_add(&total_stmt_count, &slice->count);
+		if (tier_run_count == 0 ||
+		    size > tier_run_size * opts->run_size_ratio) {
+			/*
+			 * The run is too big for the current tier.
+			 * Start a new one.
+			 */
+			tier_run_count = 1;
+			tier_run_size = size;
+			/*
+			 * If we have already scheduled compaction of
+			 * upper tiers and the compacted run will end
+			 * up in this tier, include it right away to
+			 * avoid a cascading compaction.
+			 */
+			if (est_new_run_size > 0 &&
+			    size <= est_new_run_size * opts->run_size_ratio) {
+				tier_run_count++;
+				tier_run_size = MIN(tier_run_size,
+						    est_new_run_size);
+			}
+		} else {
+			tier_run_count++;
+		}
+		/*
+		 * Randomize compaction pace among ranges,
+		 * see vy_range_update_compaction_priority().
+		 */
+		uint32_t max_run_count = opts->run_count_per_level;
+		if (slice->seed < RAND_MAX / 10)
+			max_run_count++;
+		if (tier_run_count > max_run_count) {
+			range->compaction_priority = total_run_count;
+			range->compaction_queue = total_stmt_count;
+			est_new_run_size = total_stmt_count.bytes;
+		}
+	}
+}
+
 /**
  * To reduce write amplification caused by compaction, we follow
  * the LSM tree design. Runs in each range are divided into groups
@@ -283,6 +359,11 @@ vy_range_remove_slice(struct vy_range *range, struct vy_slice *slice)
  * Given a range, this function computes the maximal level that needs
  * to be compacted and sets @compaction_priority to the number of runs
  * in this level and all preceding levels.
+ *
+ * This is the default, leveled compaction strategy. An index may
+ * also use size-tiered compaction, which trades read and space
+ * amplification for lower write amplification, see
+ * vy_range_update_compaction_priority_tiered().
  */
 void
 vy_range_update_compaction_priority(struct vy_range *range,
@@ -306,6 +387,11 @@ vy_range_update_compaction_priority(struct vy_range *range,
 		return;
 	}
 
+	if (opts->compaction_strategy == INDEX_COMPACTION_TIERED) {
+		vy_range_update_compaction_priority_tiered(range, opts);
+		return;
+	}
+
 	/* Total number of statements in checked runs. */
 	struct vy_disk_stmt_counter total_stmt_count;
 	vy_disk_stmt_counter_reset(&total_stmt_count);
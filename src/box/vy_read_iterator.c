@@ -639,6 +639,8 @@ vy_read_iterator_open(struct vy_read_iterator *itr, struct vy_lsm *lsm,
 	itr->last = vy_entry_none();
 	itr->last_cached = vy_entry_none();
 
+	vy_lsm_prioritize_bloom_load(lsm);
+
 	if (vy_stmt_is_empty_key(key.stmt)) {
 		/*
 		 * Strictly speaking, a GT/LT iterator should return
@@ -746,33 +748,110 @@ vy_read_iterator_next_range(struct vy_read_iterator *itr)
 	vy_read_iterator_add_disk(itr);
 }
 
+/**
+ * Remove statements deleted by a range tombstone with the given
+ * LSN from the history of a memory or disk source. If the newest
+ * statement of the source is removed and @covered is unset, it is
+ * returned in @covered so that the iterator can be positioned at
+ * the deleted key. @is_cut is set if any statement was removed.
+ * Returns 0 on success, -1 on memory error.
+ */
+static NODISCARD int
+vy_read_iterator_cut_history(struct vy_history *history, int64_t lsn,
+			     struct vy_entry *covered, bool *is_cut)
+{
+	*is_cut = false;
+	if (rlist_empty(&history->stmts))
+		return 0;
+	struct vy_history_node *node = rlist_first_entry(&history->stmts,
+					struct vy_history_node, link);
+	if (covered->stmt == NULL && vy_stmt_lsn(node->entry.stmt) < lsn) {
+		if (node->is_refable) {
+			*covered = node->entry;
+			tuple_ref(covered->stmt);
+		} else {
+			covered->hint = node->entry.hint;
+			covered->stmt = vy_stmt_dup(node->entry.stmt);
+			if (covered->stmt == NULL)
+				return -1;
+		}
+	}
+	*is_cut = vy_history_cut(history, lsn);
+	return 0;
+}
+
 /**
  * Get a resultant statement for the current key.
+ * If the key was deleted by a range tombstone, @is_covered is set
+ * and a deleted statement is returned so that the caller can skip
+ * to the next key.
  * Returns 0 on success, -1 on error.
  */
 static NODISCARD int
 vy_read_iterator_apply_history(struct vy_read_iterator *itr,
-			       struct vy_entry *ret)
+			       struct vy_entry *ret, bool *is_covered)
 {
 	struct vy_lsm *lsm = itr->lsm;
 	struct vy_history history;
 	vy_history_create(&history, &lsm->env->history_node_pool);
 
+	*is_covered = false;
+	int rc = 0;
+	int64_t tombstone_lsn = -1;
+	struct vy_entry covered = vy_entry_none();
 	for (uint32_t i = 0; i < itr->src_count; i++) {
 		struct vy_read_src *src = &itr->src[i];
 		if (src->front_id == itr->front_id) {
+			bool is_cut = false;
+			if (i >= itr->mem_src &&
+			    !rlist_empty(&src->history.stmts) &&
+			    !rlist_empty(&lsm->range_tombstones)) {
+				/*
+				 * Statements of the transaction write
+				 * set and the cache can't be covered by
+				 * a range tombstone.
+				 */
+				if (tombstone_lsn < 0) {
+					struct vy_history_node *node =
+						rlist_first_entry(
+							&src->history.stmts,
+							struct vy_history_node,
+							link);
+					tombstone_lsn =
+						vy_lsm_range_tombstone_lsn(
+							lsm, node->entry,
+							(**itr->read_view).vlsn);
+				}
+				if (tombstone_lsn > 0)
+					rc = vy_read_iterator_cut_history(
+							&src->history,
+							tombstone_lsn,
+							&covered, &is_cut);
+				if (rc != 0)
+					break;
+			}
 			vy_history_splice(&history, &src->history);
-			if (vy_history_is_terminal(&history))
+			/* Older statements are deleted, too. */
+			if (is_cut || vy_history_is_terminal(&history))
 				break;
 		}
 	}
 
 	int upserts_applied = 0;
-	int rc = vy_history_apply(&history, lsm->cmp_def,
-				  true, &upserts_applied, ret);
+	if (rc == 0)
+		rc = vy_history_apply(&history, lsm->cmp_def,
+				      true, &upserts_applied, ret);
 
 	lsm->stat.upsert.applied += upserts_applied;
+	lsm->env->upsert_stat.applied_on_read += upserts_applied;
 	vy_history_cleanup(&history);
+
+	if (rc == 0 && ret->stmt == NULL && covered.stmt != NULL) {
+		*ret = covered;
+		*is_covered = true;
+	} else if (covered.stmt != NULL) {
+		tuple_unref(covered.stmt);
+	}
 	return rc;
 }
 
@@ -809,10 +888,11 @@ vy_read_iterator_next(struct vy_read_iterator *itr, struct vy_entry *result)
 	assert(itr->tx == NULL || itr->tx->state == VINYL_TX_READY);
 
 	struct vy_entry entry;
+	bool is_covered;
 next_key:
 	if (vy_read_iterator_advance(itr) != 0)
 		return -1;
-	if (vy_read_iterator_apply_history(itr, &entry) != 0)
+	if (vy_read_iterator_apply_history(itr, &entry, &is_covered) != 0)
 		return -1;
 	if (vy_read_iterator_track_read(itr, entry) != 0)
 		return -1;
@@ -821,6 +901,10 @@ next_key:
 		tuple_unref(itr->last.stmt);
 	itr->last = entry;
 
+	if (is_covered) {
+		/* Skip keys deleted by a range tombstone. */
+		goto next_key;
+	}
 	if (entry.stmt != NULL && vy_stmt_type(entry.stmt) == IPROTO_DELETE) {
 		/*
 		 * We don't return DELETEs so skip to the next key.
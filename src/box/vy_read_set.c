@@ -31,10 +31,16 @@
 #include "vy_read_set.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <msgpuck/msgpuck.h>
 
+#include "coll/coll.h"
+#include "mp_extension_types.h"
+#include "third_party/PMurHash.h"
 #include "trivia/util.h"
 #include "tuple.h"
 #include "vy_lsm.h"
@@ -106,12 +112,225 @@ vy_read_interval_should_merge(const struct vy_read_interval *l,
 		return l_parts >= r_parts;
 }
 
+enum {
+	VY_READ_SET_HASH_SEED = 13U,
+};
+
+/**
+ * Hash a key field so that fields that are equal according to
+ * tuple_compare_field() have equal hashes regardless of their
+ * MsgPack encoding. Returns false if the field can't be hashed
+ * this way (e.g. a decimal, which may be equal to an integer).
+ */
+static bool
+vy_read_set_field_hash(uint32_t *ph, uint32_t *pcarry, uint32_t *ptotal,
+		       const char *field, struct coll *coll)
+{
+	char buf[16];
+	const char *data = buf;
+	uint32_t size;
+	if (field == NULL) {
+		buf[0] = (char)0xc0;
+		size = 1;
+		goto process;
+	}
+	switch (mp_typeof(*field)) {
+	case MP_NIL:
+	case MP_BOOL:
+		data = field;
+		mp_next(&field);
+		size = field - data;
+		break;
+	case MP_UINT:
+		size = mp_encode_uint(buf, mp_decode_uint(&field)) - buf;
+		break;
+	case MP_INT: {
+		int64_t val = mp_decode_int(&field);
+		size = (val >= 0 ? mp_encode_uint(buf, val) :
+				   mp_encode_int(buf, val)) - buf;
+		break;
+	}
+	case MP_FLOAT:
+	case MP_DOUBLE: {
+		/* Hash integral values as integers, see tuple_hash. */
+		double iptr;
+		double val = mp_typeof(*field) == MP_FLOAT ?
+			     mp_decode_float(&field) :
+			     mp_decode_double(&field);
+		if (!isfinite(val) || modf(val, &iptr) != 0 ||
+		    val < -exp2(63) || val >= exp2(64)) {
+			memcpy(buf, &val, sizeof(val));
+			size = sizeof(val);
+		} else if (val >= 0) {
+			size = mp_encode_uint(buf, (uint64_t)val) - buf;
+		} else {
+			size = mp_encode_int(buf, (int64_t)val) - buf;
+		}
+		break;
+	}
+	case MP_STR:
+		data = mp_decode_str(&field, &size);
+		if (coll != NULL) {
+			*ptotal += coll->hash(data, size, ph, pcarry, coll);
+			return true;
+		}
+		break;
+	case MP_BIN:
+		data = mp_decode_bin(&field, &size);
+		break;
+	case MP_EXT: {
+		const char *ext = field;
+		int8_t type;
+		mp_decode_extl(&ext, &type);
+		if (type != MP_UUID)
+			return false;
+		data = field;
+		mp_next(&field);
+		size = field - data;
+		break;
+	}
+	default:
+		return false;
+	}
+process:
+	PMurHash32_Process(ph, pcarry, data, size);
+	*ptotal += size;
+	return true;
+}
+
+/**
+ * Hash a full key of a statement, see vy_read_set_field_hash().
+ * Returns false if the key can't be hashed.
+ */
+static bool
+vy_read_set_key_hash(struct key_def *cmp_def, struct vy_entry entry,
+		     uint32_t *hash)
+{
+	if (cmp_def->is_multikey || cmp_def->for_func_index)
+		return false;
+	if (!vy_stmt_is_full_key(entry.stmt, cmp_def))
+		return false;
+	const char *key = NULL;
+	if (vy_stmt_is_key(entry.stmt)) {
+		key = tuple_data(entry.stmt);
+		mp_decode_array(&key);
+	}
+	uint32_t h = VY_READ_SET_HASH_SEED;
+	uint32_t carry = 0;
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < cmp_def->part_count; i++) {
+		struct key_part *part = &cmp_def->parts[i];
+		const char *field;
+		if (key != NULL) {
+			field = key;
+			mp_next(&key);
+		} else {
+			field = tuple_field_by_part(entry.stmt, part,
+						    MULTIKEY_NONE);
+		}
+		if (!vy_read_set_field_hash(&h, &carry, &total,
+					    field, part->coll))
+			return false;
+	}
+	*hash = PMurHash32_Result(h, carry, total);
+	return true;
+}
+
+/**
+ * If the interval is a point that can be hashed, return true
+ * and store the point hash in @hash.
+ */
+static bool
+vy_read_interval_point_hash(const struct vy_read_interval *interval,
+			    uint32_t *hash)
+{
+	if (!vy_entry_is_equal(interval->left, interval->right) ||
+	    !interval->left_belongs || !interval->right_belongs)
+		return false;
+	return vy_read_set_key_hash(interval->lsm->cmp_def,
+				    interval->left, hash);
+}
+
+/** Return indexes of the filter counters for the given hash. */
+static inline void
+vy_read_set_filter_slots(uint32_t hash, uint32_t *slot1, uint32_t *slot2)
+{
+	*slot1 = hash % VY_READ_SET_FILTER_SIZE;
+	*slot2 = (hash >> 16) % VY_READ_SET_FILTER_SIZE;
+}
+
+void
+vy_read_set_filter_create(struct vy_read_set_filter *filter)
+{
+	memset(filter, 0, sizeof(*filter));
+}
+
+void
+vy_read_set_filter_add(struct vy_read_set_filter *filter,
+		       struct vy_read_interval *interval)
+{
+	interval->is_hashed = vy_read_interval_point_hash(interval,
+							  &interval->hash);
+	if (!interval->is_hashed) {
+		filter->range_count++;
+		return;
+	}
+	uint32_t slots[2];
+	vy_read_set_filter_slots(interval->hash, &slots[0], &slots[1]);
+	for (int i = 0; i < 2; i++) {
+		if (filter->counters[slots[i]] < UINT8_MAX)
+			filter->counters[slots[i]]++;
+	}
+	filter->point_count++;
+}
+
+void
+vy_read_set_filter_remove(struct vy_read_set_filter *filter,
+			  const struct vy_read_interval *interval)
+{
+	if (!interval->is_hashed) {
+		assert(filter->range_count > 0);
+		filter->range_count--;
+		return;
+	}
+	assert(filter->point_count > 0);
+	if (--filter->point_count == 0) {
+		/* Clear saturated counters. */
+		memset(filter->counters, 0, sizeof(filter->counters));
+		return;
+	}
+	uint32_t slots[2];
+	vy_read_set_filter_slots(interval->hash, &slots[0], &slots[1]);
+	for (int i = 0; i < 2; i++) {
+		assert(filter->counters[slots[i]] > 0);
+		if (filter->counters[slots[i]] < UINT8_MAX)
+			filter->counters[slots[i]]--;
+	}
+}
+
+bool
+vy_read_set_filter_may_conflict(const struct vy_read_set_filter *filter,
+				struct vy_lsm *lsm, struct vy_entry key)
+{
+	if (filter->range_count > 0)
+		return true;
+	if (filter->point_count == 0)
+		return false;
+	uint32_t hash;
+	if (!vy_read_set_key_hash(lsm->cmp_def, key, &hash))
+		return true;
+	uint32_t slot1, slot2;
+	vy_read_set_filter_slots(hash, &slot1, &slot2);
+	return filter->counters[slot1] > 0 && filter->counters[slot2] > 0;
+}
+
 struct vy_tx *
 vy_tx_conflict_iterator_next(struct vy_tx_conflict_iterator *it)
 {
 	struct vy_read_interval *curr, *left, *right;
 	while ((curr = vy_lsm_read_set_walk_next(&it->tree_walk, it->tree_dir,
 						 &left, &right)) != NULL) {
+		it->visited++;
 		struct key_def *cmp_def = curr->lsm->cmp_def;
 		const struct vy_read_interval *last = curr->subtree_last;
 
@@ -66,6 +66,13 @@ struct vy_read_interval {
 	bool left_belongs;
 	/** Set if the right boundary belongs to the interval. */
 	bool right_belongs;
+	/**
+	 * Set if the interval is a point hashed into the LSM
+	 * tree read set filter, see vy_read_set_filter_add().
+	 */
+	bool is_hashed;
+	/** Hash of the point if @is_hashed is set. */
+	uint32_t hash;
 	/**
 	 * The interval with the max right boundary over
 	 * all nodes in the subtree rooted at this node.
@@ -182,6 +189,62 @@ rb_gen_aug(MAYBE_UNUSED static inline, vy_lsm_read_set_, vy_lsm_read_set_t,
 	   struct vy_read_interval, in_lsm, vy_lsm_read_set_cmp,
 	   vy_lsm_read_set_aug);
 
+enum {
+	/** Number of counters in a read set filter. */
+	VY_READ_SET_FILTER_SIZE = 1024,
+};
+
+/**
+ * Counting Bloom filter over point intervals stored in an LSM tree
+ * read set. Used for skipping the interval tree walk on write if
+ * no transaction could have read the written key.
+ *
+ * An interval is a point if both its boundaries are equal to the
+ * same full key. Point intervals are hashed into the filter while
+ * all other intervals are just counted: the filter can't exclude
+ * conflicts if there are such intervals.
+ */
+struct vy_read_set_filter {
+	/** Number of intervals that aren't hashed into the filter. */
+	int64_t range_count;
+	/** Number of intervals that are hashed into the filter. */
+	int64_t point_count;
+	/**
+	 * Filter counters. A counter that reaches UINT8_MAX
+	 * sticks until the filter becomes empty.
+	 */
+	uint8_t counters[VY_READ_SET_FILTER_SIZE];
+};
+
+/** Initialize an empty read set filter. */
+void
+vy_read_set_filter_create(struct vy_read_set_filter *filter);
+
+/**
+ * Account an interval that is about to be inserted into an LSM
+ * tree read set.
+ */
+void
+vy_read_set_filter_add(struct vy_read_set_filter *filter,
+		       struct vy_read_interval *interval);
+
+/**
+ * Unaccount an interval that is about to be removed from an LSM
+ * tree read set.
+ */
+void
+vy_read_set_filter_remove(struct vy_read_set_filter *filter,
+			  const struct vy_read_interval *interval);
+
+/**
+ * Return false if a write of the given statement to an LSM tree
+ * can't conflict with any interval accounted in the filter, true
+ * if it may conflict.
+ */
+bool
+vy_read_set_filter_may_conflict(const struct vy_read_set_filter *filter,
+				struct vy_lsm *lsm, struct vy_entry key);
+
 /**
  * Iterator over transactions that conflict with a statement.
  */
@@ -198,6 +261,8 @@ struct vy_tx_conflict_iterator {
 	 * next iteration.
 	 */
 	int tree_dir;
+	/** Number of intervals visited by the iterator. */
+	int64_t visited;
 };
 
 static inline void
@@ -207,6 +272,7 @@ vy_tx_conflict_iterator_init(struct vy_tx_conflict_iterator *it,
 	vy_lsm_read_set_walk_init(&it->tree_walk, read_set);
 	it->tree_dir = 0;
 	it->key = key;
+	it->visited = 0;
 }
 
 /**
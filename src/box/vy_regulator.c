@@ -56,6 +56,12 @@ static const double VY_REGULATOR_TIMER_PERIOD = 1;
  */
 static const double VY_WRITE_RATE_AVG_WIN = 5;
 
+/**
+ * Number of average deviations added to the average write rate
+ * when forecasting the write rate.
+ */
+static const int VY_WRITE_RATE_DEV_FACTOR = 2;
+
 /**
  * Histogram percentile used for estimating dump bandwidth.
  * For details see the comment to vy_regulator::dump_bandwidth_hist.
@@ -84,7 +90,7 @@ static const size_t VY_DUMP_SIZE_ACCT_MIN = 1024 * 1024;
 static const int VY_RECENT_DUMP_COUNT = 100;
 
 static void
-vy_regulator_trigger_dump(struct vy_regulator *regulator)
+vy_regulator_trigger_dump(struct vy_regulator *regulator, bool quota_exceeded)
 {
 	if (regulator->dump_in_progress)
 		return;
@@ -93,6 +99,10 @@ vy_regulator_trigger_dump(struct vy_regulator *regulator)
 		return;
 
 	regulator->dump_in_progress = true;
+	if (quota_exceeded)
+		regulator->dump_count_quota++;
+	else
+		regulator->dump_count_watermark++;
 
 	/*
 	 * To avoid unpredictably long stalls, we must limit
@@ -115,11 +125,12 @@ vy_regulator_trigger_dump(struct vy_regulator *regulator)
 				max_write_rate);
 
 	say_info("dumping %zu bytes, expected rate %.1f MB/s, "
-		 "ETA %.1f s, write rate (avg/max) %.1f/%.1f MB/s",
+		 "ETA %.1f s, write rate (avg/max/forecast) %.1f/%.1f/%.1f MB/s",
 		 quota->used, (double)regulator->dump_bandwidth / 1024 / 1024,
 		 (double)quota->used / (regulator->dump_bandwidth + 1),
 		 (double)regulator->write_rate / 1024 / 1024,
-		 (double)regulator->write_rate_max / 1024 / 1024);
+		 (double)regulator->write_rate_max / 1024 / 1024,
+		 (double)regulator->write_rate_forecast / 1024 / 1024);
 
 	regulator->write_rate_max = regulator->write_rate;
 }
@@ -142,13 +153,34 @@ vy_regulator_update_write_rate(struct vy_regulator *regulator)
 	}
 
 	size_t rate_avg = regulator->write_rate;
+	size_t rate_dev = regulator->write_rate_dev;
 	size_t rate_curr = (used_curr - used_last) / VY_REGULATOR_TIMER_PERIOD;
 
 	double weight = 1 - exp(-VY_REGULATOR_TIMER_PERIOD /
 				VY_WRITE_RATE_AVG_WIN);
+	rate_dev = (1 - weight) * rate_dev + weight *
+		(rate_curr > rate_avg ? rate_curr - rate_avg :
+					rate_avg - rate_curr);
 	rate_avg = (1 - weight) * rate_avg + weight * rate_curr;
 
+	/*
+	 * Forecast the write rate as the average plus a few
+	 * average deviations so that the forecast covers normal
+	 * fluctuations of the workload. If the current rate is
+	 * still above the forecast, we are observing a burst.
+	 * Expect it to continue and grow, because it's better
+	 * to start memory dump early than to hit the limit and
+	 * stall transactions.
+	 */
+	size_t rate_forecast = rate_avg + VY_WRITE_RATE_DEV_FACTOR * rate_dev;
+	if (rate_curr > rate_forecast) {
+		rate_forecast = rate_curr * 3 / 2;
+		regulator->burst_count++;
+	}
+
 	regulator->write_rate = rate_avg;
+	regulator->write_rate_dev = rate_dev;
+	regulator->write_rate_forecast = rate_forecast;
 	if (regulator->write_rate_max < rate_curr)
 		regulator->write_rate_max = rate_curr;
 	regulator->quota_used_last = used_curr;
@@ -170,13 +202,11 @@ vy_regulator_update_dump_watermark(struct vy_regulator *regulator)
 	 *   ----------------- = --------------
 	 *       write_rate      dump_bandwidth
 	 *
-	 * Be pessimistic when predicting the write rate - use the
-	 * max observed write rate multiplied by 1.5 - because it's
-	 * better to start memory dump early than delay it as long
-	 * as possible at the risk of experiencing unpredictably
-	 * long stalls.
+	 * Use the forecast write rate, see vy_regulator_update_write_rate().
+	 * It lets us start memory dump later under a steady workload
+	 * and earlier if the write rate is volatile or bursting.
 	 */
-	size_t write_rate = regulator->write_rate_max * 3 / 2;
+	size_t write_rate = regulator->write_rate_forecast;
 	regulator->dump_watermark =
 			(double)quota->limit * regulator->dump_bandwidth /
 			(regulator->dump_bandwidth + write_rate + 1);
@@ -251,14 +281,14 @@ vy_regulator_destroy(struct vy_regulator *regulator)
 void
 vy_regulator_quota_exceeded(struct vy_regulator *regulator)
 {
-	vy_regulator_trigger_dump(regulator);
+	vy_regulator_trigger_dump(regulator, true);
 }
 
 void
 vy_regulator_check_dump_watermark(struct vy_regulator *regulator)
 {
 	if (regulator->quota->used >= regulator->dump_watermark)
-		vy_regulator_trigger_dump(regulator);
+		vy_regulator_trigger_dump(regulator, false);
 }
 
 void
@@ -321,6 +351,9 @@ vy_regulator_reset_stat(struct vy_regulator *regulator)
 {
 	memset(&regulator->sched_stat_last, 0,
 	       sizeof(regulator->sched_stat_last));
+	regulator->burst_count = 0;
+	regulator->dump_count_watermark = 0;
+	regulator->dump_count_quota = 0;
 }
 
 /*
@@ -80,6 +80,17 @@ struct vy_regulator {
 	 * memory dump was triggered, in bytes per second.
 	 */
 	size_t write_rate_max;
+	/**
+	 * Average deviation of the observed write rate from
+	 * @write_rate, in bytes per second. Averaged over the
+	 * same time window as @write_rate.
+	 */
+	size_t write_rate_dev;
+	/**
+	 * Write rate we expect to see in the near future, in bytes
+	 * per second. Used for calculating @dump_watermark.
+	 */
+	size_t write_rate_forecast;
 	/**
 	 * Amount of memory that was used when the timer was
 	 * executed last time. Needed to update @write_rate.
@@ -114,6 +125,18 @@ struct vy_regulator {
 	 * but vy_regulator_dump_complete() hasn't been called yet.
 	 */
 	bool dump_in_progress;
+	/**
+	 * Number of times the observed write rate exceeded
+	 * the forecast, i.e. a write burst was detected.
+	 */
+	int64_t burst_count;
+	/** Number of dumps triggered by exceeding the watermark. */
+	int64_t dump_count_watermark;
+	/**
+	 * Number of dumps triggered by hitting the memory limit,
+	 * i.e. when the watermark was set too high.
+	 */
+	int64_t dump_count_quota;
 	/**
 	 * Snapshot of scheduler statistics taken at the time of
 	 * the last rate limit update.
@@ -30,6 +30,9 @@
  */
 #include "vy_run.h"
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <zstd.h>
 
 #include "fiber.h"
@@ -58,6 +61,12 @@ static const uint64_t vy_run_info_key_map = (1 << VY_RUN_INFO_MIN_KEY) |
 					    (1 << VY_RUN_INFO_MAX_LSN) |
 					    (1 << VY_RUN_INFO_PAGE_COUNT);
 
+/**
+ * Distance between restart points of a prefix-compressed page,
+ * see vy_run_writer_dump_prefix_row().
+ */
+#define VY_RUN_RESTART_INTERVAL 16
+
 /** xlog meta type for .run files */
 #define XLOG_META_TYPE_RUN "RUN"
 
@@ -183,8 +192,12 @@ vy_run_env_create(struct vy_run_env *env, int read_threads)
 	tt_pthread_key_create(&env->zdctx_key, vy_free_zdctx);
 	mempool_create(&env->read_task_pool, cord_slab_cache(),
 		       sizeof(struct vy_page_read_task));
+	rlist_create(&env->page_cache);
 }
 
+static void
+vy_page_cache_evict(struct vy_run_env *env, struct vy_page *page);
+
 /**
  * Destroy vinyl run environment
  */
@@ -193,6 +206,10 @@ vy_run_env_destroy(struct vy_run_env *env)
 {
 	if (env->reader_pool != NULL)
 		vy_run_env_stop_readers(env);
+	while (!rlist_empty(&env->page_cache)) {
+		vy_page_cache_evict(env, rlist_first_entry(&env->page_cache,
+						struct vy_page, in_cache));
+	}
 	mempool_destroy(&env->read_task_pool);
 	tt_pthread_key_delete(env->zdctx_key);
 }
@@ -268,6 +285,8 @@ vy_page_info_destroy(struct vy_page_info *page_info)
 {
 	if (page_info->min_key != NULL)
 		free(page_info->min_key);
+	if (page_info->bloom != NULL)
+		tuple_bloom_delete(page_info->bloom);
 }
 
 struct vy_run *
@@ -289,9 +308,32 @@ vy_run_new(struct vy_run_env *env, int64_t id)
 	return run;
 }
 
+/** Close blob files opened by vy_run_open_blobs(). */
+static void
+vy_run_close_blobs(struct vy_run *run)
+{
+	if (run->blob_fds == NULL)
+		return;
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		if (run->blob_fds[i] >= 0 && close(run->blob_fds[i]) < 0)
+			say_syserror("close failed");
+	}
+	free(run->blob_fds);
+	run->blob_fds = NULL;
+}
+
 static void
 vy_run_clear(struct vy_run *run)
 {
+	if (run->page_cache != NULL) {
+		for (uint32_t i = 0; i < run->info.page_count; i++) {
+			if (run->page_cache[i] != NULL)
+				vy_page_cache_evict(run->env,
+						    run->page_cache[i]);
+		}
+		free(run->page_cache);
+		run->page_cache = NULL;
+	}
 	if (run->page_info != NULL) {
 		uint32_t page_no;
 		for (page_no = 0; page_no < run->info.page_count; ++page_no)
@@ -309,6 +351,157 @@ vy_run_clear(struct vy_run *run)
 	run->info.min_key = NULL;
 	free(run->info.max_key);
 	run->info.max_key = NULL;
+	vy_run_close_blobs(run);
+	free(run->info.blobs);
+	run->info.blobs = NULL;
+	run->info.blob_count = 0;
+}
+
+/** Return true if the run references a blob file. */
+static bool
+vy_run_has_blob(struct vy_run *run, int64_t blob_id)
+{
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		if (run->info.blobs[i] == blob_id)
+			return true;
+	}
+	return false;
+}
+
+/** Add a blob file to the list of blob files referenced by a run. */
+static int
+vy_run_add_blob(struct vy_run *run, int64_t blob_id)
+{
+	assert(run->blob_fds == NULL);
+	if (vy_run_has_blob(run, blob_id))
+		return 0;
+	size_t size = (run->info.blob_count + 1) * sizeof(*run->info.blobs);
+	int64_t *blobs = realloc(run->info.blobs, size);
+	if (blobs == NULL) {
+		diag_set(OutOfMemory, size, "realloc", "run blobs");
+		return -1;
+	}
+	blobs[run->info.blob_count++] = blob_id;
+	run->info.blobs = blobs;
+	return 0;
+}
+
+/**
+ * Open blob files referenced by a run for reading.
+ * On failure the files opened so far are closed by
+ * vy_run_clear().
+ */
+static int
+vy_run_open_blobs(struct vy_run *run, const char *dir,
+		  uint32_t space_id, uint32_t iid)
+{
+	assert(run->blob_fds == NULL);
+	if (run->info.blob_count == 0)
+		return 0;
+	size_t size = run->info.blob_count * sizeof(*run->blob_fds);
+	run->blob_fds = malloc(size);
+	if (run->blob_fds == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "run blob fds");
+		return -1;
+	}
+	for (uint32_t i = 0; i < run->info.blob_count; i++)
+		run->blob_fds[i] = -1;
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		char path[PATH_MAX];
+		vy_blob_snprint_path(path, sizeof(path), dir, space_id, iid,
+				     run->id, run->info.blobs[i]);
+		run->blob_fds[i] = open(path, O_RDONLY);
+		if (run->blob_fds[i] < 0) {
+			diag_set(SystemError, "failed to open '%s' file",
+				 path);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/** Return the descriptor of a blob file referenced by a run. */
+static int
+vy_run_blob_fd(struct vy_run *run, int64_t blob_id)
+{
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		if (run->info.blobs[i] == blob_id)
+			return run->blob_fds != NULL ? run->blob_fds[i] : -1;
+	}
+	return -1;
+}
+
+void
+vy_blob_map_create(struct vy_blob_map *map)
+{
+	memset(map, 0, sizeof(*map));
+}
+
+void
+vy_blob_map_destroy(struct vy_blob_map *map)
+{
+	for (int i = 0; i < map->count; i++)
+		tuple_unref(map->entries[i].stmt);
+	free(map->entries);
+	memset(map, 0, sizeof(*map));
+}
+
+/**
+ * Drop entries of statements that are referenced only
+ * by the map and so can't be looked up any more.
+ */
+static void
+vy_blob_map_gc(struct vy_blob_map *map)
+{
+	int count = 0;
+	for (int i = 0; i < map->count; i++) {
+		struct vy_blob_map_entry *entry = &map->entries[i];
+		if (entry->stmt->refs == 1) {
+			tuple_unref(entry->stmt);
+			continue;
+		}
+		map->entries[count++] = *entry;
+	}
+	map->count = count;
+}
+
+/** Remember that a statement was read from a blob file. */
+static int
+vy_blob_map_add(struct vy_blob_map *map, struct tuple *stmt,
+		int64_t run_id, const struct vy_blob_ref *ref)
+{
+	vy_blob_map_gc(map);
+	if (map->count == map->capacity) {
+		int capacity = MAX(map->capacity * 2, 16);
+		size_t size = capacity * sizeof(*map->entries);
+		struct vy_blob_map_entry *entries = realloc(map->entries,
+							    size);
+		if (entries == NULL) {
+			diag_set(OutOfMemory, size, "realloc", "blob map");
+			return -1;
+		}
+		map->entries = entries;
+		map->capacity = capacity;
+	}
+	struct vy_blob_map_entry *entry = &map->entries[map->count++];
+	entry->stmt = stmt;
+	entry->type = vy_stmt_type(stmt);
+	entry->flags = vy_stmt_flags(stmt);
+	entry->run_id = run_id;
+	entry->ref = *ref;
+	tuple_ref(stmt);
+	return 0;
+}
+
+/** Look up a statement read from a blob file. */
+static struct vy_blob_map_entry *
+vy_blob_map_find(struct vy_blob_map *map, struct tuple *stmt)
+{
+	for (int i = 0; i < map->count; i++) {
+		if (map->entries[i].stmt == stmt)
+			return &map->entries[i];
+	}
+	return NULL;
 }
 
 void
@@ -325,7 +518,26 @@ vy_run_delete(struct vy_run *run)
 size_t
 vy_run_bloom_size(struct vy_run *run)
 {
-	return run->info.bloom == NULL ? 0 : tuple_bloom_size(run->info.bloom);
+	if (run->info.bloom != NULL)
+		return tuple_bloom_size(run->info.bloom);
+	size_t size = 0;
+	for (uint32_t i = 0; i < run->info.page_count; i++) {
+		struct vy_page_info *page_info = vy_run_page_info(run, i);
+		if (page_info->bloom != NULL)
+			size += tuple_bloom_size(page_info->bloom);
+	}
+	return size;
+}
+
+enum tuple_bloom_type
+vy_run_bloom_type(struct vy_run *run)
+{
+	if (run->info.bloom != NULL)
+		return run->info.bloom->type;
+	if (run->info.page_count > 0 &&
+	    vy_run_page_info(run, 0)->bloom != NULL)
+		return vy_run_page_info(run, 0)->bloom->type;
+	return TUPLE_BLOOM_BLOOM;
 }
 
 /**
@@ -578,6 +790,11 @@ vy_page_info_decode(struct vy_page_info *page, const struct xrow_header *xrow,
 		case VY_PAGE_INFO_ROW_INDEX_OFFSET:
 			page->row_index_offset = mp_decode_uint(&pos);
 			break;
+		case VY_PAGE_INFO_BLOOM:
+			page->bloom = tuple_bloom_decode(&pos);
+			if (page->bloom == NULL)
+				return -1;
+			break;
 		default:
 			mp_next(&pos); /* unknown key, ignore */
 			break;
@@ -628,14 +845,45 @@ vy_stmt_stat_decode(struct vy_stmt_stat *stat, const char **data)
  * @param xrow xrow to decode
  * @param[out] run_info the run information
  * @param filename File name for error reporting.
+ * @param defer_bloom Skip the bloom filter and set
+ *                    run_info->bloom_is_deferred instead.
  *
  * @retval  0 success
  * @retval -1 error (check diag)
  */
+/** Decode the array of blob file IDs referenced by a run. */
+static int
+vy_run_info_decode_blobs(struct vy_run_info *run_info, const char **pos,
+			 const char *filename)
+{
+	if (mp_typeof(**pos) != MP_ARRAY)
+		goto error;
+	uint32_t count = mp_decode_array(pos);
+	if (count == 0)
+		return 0;
+	run_info->blobs = malloc(count * sizeof(*run_info->blobs));
+	if (run_info->blobs == NULL) {
+		diag_set(OutOfMemory, count * sizeof(*run_info->blobs),
+			 "malloc", "run blobs");
+		return -1;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (mp_typeof(**pos) != MP_UINT)
+			goto error;
+		run_info->blobs[i] = mp_decode_uint(pos);
+		run_info->blob_count++;
+	}
+	return 0;
+error:
+	diag_set(ClientError, ER_INVALID_INDEX_FILE, filename,
+		 "Can't decode run info: invalid blobs");
+	return -1;
+}
+
 int
 vy_run_info_decode(struct vy_run_info *run_info,
 		   const struct xrow_header *xrow,
-		   const char *filename)
+		   const char *filename, bool defer_bloom)
 {
 	assert(xrow->type == VY_INDEX_RUN_INFO);
 	/* decode run */
@@ -674,11 +922,21 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			run_info->page_count = mp_decode_uint(&pos);
 			break;
 		case VY_RUN_INFO_BLOOM_LEGACY:
+			if (defer_bloom) {
+				mp_next(&pos);
+				run_info->bloom_is_deferred = true;
+				break;
+			}
 			run_info->bloom = tuple_bloom_decode_legacy(&pos);
 			if (run_info->bloom == NULL)
 				return -1;
 			break;
 		case VY_RUN_INFO_BLOOM:
+			if (defer_bloom) {
+				mp_next(&pos);
+				run_info->bloom_is_deferred = true;
+				break;
+			}
 			run_info->bloom = tuple_bloom_decode(&pos);
 			if (run_info->bloom == NULL)
 				return -1;
@@ -686,6 +944,14 @@ vy_run_info_decode(struct vy_run_info *run_info,
 		case VY_RUN_INFO_STMT_STAT:
 			vy_stmt_stat_decode(&run_info->stmt_stat, &pos);
 			break;
+		case VY_RUN_INFO_BLOBS:
+			if (vy_run_info_decode_blobs(run_info, &pos,
+						     filename) != 0)
+				return -1;
+			break;
+		case VY_RUN_INFO_RANGE_TOMBSTONE_LSN:
+			run_info->range_tombstone_lsn = mp_decode_uint(&pos);
+			break;
 		default:
 			mp_next(&pos); /* unknown key, ignore */
 			break;
@@ -713,6 +979,7 @@ vy_page_new(const struct vy_page_info *page_info)
 	}
 	page->unpacked_size = page_info->unpacked_size;
 	page->row_count = page_info->row_count;
+	page->restart_interval = 0;
 	page->row_index = calloc(page_info->row_count, sizeof(uint32_t));
 	if (page->row_index == NULL) {
 		diag_set(OutOfMemory, page_info->row_count * sizeof(uint32_t),
@@ -729,34 +996,235 @@ vy_page_new(const struct vy_page_info *page_info)
 		free(page);
 		return NULL;
 	}
+	page->blob_refs = NULL;
+	page->refs = 1;
+	page->run = NULL;
+	rlist_create(&page->in_cache);
 	return page;
 }
 
 static void
 vy_page_delete(struct vy_page *page)
 {
+	assert(page->run == NULL);
 	uint32_t *row_index = page->row_index;
 	char *data = page->data;
+	struct vy_blob_ref *blob_refs = page->blob_refs;
 #if !defined(NDEBUG)
 	memset(row_index, '#', sizeof(uint32_t) * page->row_count);
 	memset(data, '#', page->unpacked_size);
 	memset(page, '#', sizeof(*page));
 #endif /* !defined(NDEBUG) */
+	free(blob_refs);
 	free(row_index);
 	free(data);
 	free(page);
 }
 
+static inline void
+vy_page_ref(struct vy_page *page)
+{
+	assert(page->refs > 0);
+	page->refs++;
+}
+
+static inline void
+vy_page_unref(struct vy_page *page)
+{
+	assert(page->refs > 0);
+	if (--page->refs == 0)
+		vy_page_delete(page);
+}
+
+/** Size of memory used by a page. */
+static inline size_t
+vy_page_mem_used(struct vy_page *page)
+{
+	size_t size = sizeof(*page) + page->unpacked_size +
+		      page->row_count * sizeof(uint32_t);
+	if (page->blob_refs != NULL)
+		size += page->row_count * sizeof(*page->blob_refs);
+	return size;
+}
+
+/** Remove a page from the environment page cache. */
+static void
+vy_page_cache_evict(struct vy_run_env *env, struct vy_page *page)
+{
+	struct vy_run *run = page->run;
+	assert(run != NULL);
+	assert(run->page_cache[page->page_no] == page);
+	run->page_cache[page->page_no] = NULL;
+	page->run = NULL;
+	rlist_del_entry(page, in_cache);
+	assert(env->page_cache_used >= vy_page_mem_used(page));
+	env->page_cache_used -= vy_page_mem_used(page);
+	vy_page_unref(page);
+}
+
+/** Evict the least recently used pages to fit in the quota. */
+static void
+vy_page_cache_truncate(struct vy_run_env *env)
+{
+	while (env->page_cache_used > env->page_cache_quota) {
+		assert(!rlist_empty(&env->page_cache));
+		vy_page_cache_evict(env, rlist_last_entry(&env->page_cache,
+						struct vy_page, in_cache));
+	}
+}
+
+/**
+ * Look up a page of a run in the environment page cache.
+ * Returns NULL if the page isn't cached.
+ */
+static struct vy_page *
+vy_page_cache_get(struct vy_run_env *env, struct vy_run *run,
+		  uint32_t page_no)
+{
+	if (run->page_cache == NULL)
+		return NULL;
+	struct vy_page *page = run->page_cache[page_no];
+	if (page != NULL)
+		rlist_move_entry(&env->page_cache, page, in_cache);
+	return page;
+}
+
+/**
+ * Store a page read from disk in the environment page cache.
+ * The page is silently not cached on memory allocation error.
+ */
+static void
+vy_page_cache_put(struct vy_run_env *env, struct vy_run *run,
+		  struct vy_page *page)
+{
+	assert(page->run == NULL);
+	size_t size = vy_page_mem_used(page);
+	if (size > env->page_cache_quota)
+		return;
+	if (run->page_cache == NULL) {
+		run->page_cache = calloc(run->info.page_count,
+					 sizeof(*run->page_cache));
+		if (run->page_cache == NULL)
+			return;
+	}
+	assert(run->page_cache[page->page_no] == NULL);
+	run->page_cache[page->page_no] = page;
+	page->run = run;
+	vy_page_ref(page);
+	rlist_add_entry(&env->page_cache, page, in_cache);
+	env->page_cache_used += size;
+	vy_page_cache_truncate(env);
+}
+
+void
+vy_run_env_set_page_cache(struct vy_run_env *env, size_t quota)
+{
+	env->page_cache_quota = quota;
+	vy_page_cache_truncate(env);
+}
+
+/**
+ * Restore a statement stored as a VY_RUN_PREFIX_ROW row.
+ * The statement body is allocated on the fiber region.
+ * @param xrow Prefix row, replaced with the statement.
+ * @param prev Body of the previous statement in the page.
+ * @param prev_size Size of the previous statement body.
+ *
+ * @retval 0 on success
+ * @retval -1 on error, check diag
+ */
+static int
+vy_prefix_row_decode(struct xrow_header *xrow, const char *prev,
+		     uint32_t prev_size)
+{
+	assert(xrow->type == VY_RUN_PREFIX_ROW);
+	if (xrow->bodycnt == 0)
+		goto error;
+	const char *pos = xrow->body->iov_base;
+	if (mp_typeof(*pos) != MP_MAP)
+		goto error;
+	uint64_t type = 0;
+	uint64_t shared = 0;
+	const char *suffix = NULL;
+	uint32_t suffix_size = 0;
+	uint32_t map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*pos) != MP_UINT)
+			goto error;
+		uint64_t key = mp_decode_uint(&pos);
+		switch (key) {
+		case VY_PREFIX_ROW_TYPE:
+			if (mp_typeof(*pos) != MP_UINT)
+				goto error;
+			type = mp_decode_uint(&pos);
+			break;
+		case VY_PREFIX_ROW_SHARED:
+			if (mp_typeof(*pos) != MP_UINT)
+				goto error;
+			shared = mp_decode_uint(&pos);
+			break;
+		case VY_PREFIX_ROW_SUFFIX:
+			if (mp_typeof(*pos) != MP_BIN)
+				goto error;
+			suffix = mp_decode_bin(&pos, &suffix_size);
+			break;
+		default:
+			mp_next(&pos); /* unknown key, ignore */
+			break;
+		}
+	}
+	if (type == 0 || suffix == NULL || shared > prev_size)
+		goto error;
+	size_t size = shared + suffix_size;
+	char *body = region_alloc(&fiber()->gc, size);
+	if (body == NULL) {
+		diag_set(OutOfMemory, size, "region", "statement body");
+		return -1;
+	}
+	memcpy(body, prev, shared);
+	memcpy(body + shared, suffix, suffix_size);
+	xrow->type = type;
+	xrow->body->iov_base = body;
+	xrow->body->iov_len = size;
+	return 0;
+error:
+	diag_set(ClientError, ER_INVALID_RUN_FILE,
+		 "Can't decode prefix-compressed statement");
+	return -1;
+}
+
+/**
+ * Decode a statement stored in a page. If the statement is
+ * prefix-compressed, it is restored starting from the closest
+ * restart point, in which case the statement body is allocated
+ * on the fiber region.
+ */
 static int
 vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
 	     struct xrow_header *xrow)
 {
 	assert(stmt_no < page->row_count);
-	const char *data = page->data + page->row_index[stmt_no];
-	const char *data_end = stmt_no + 1 < page->row_count ?
-			       page->data + page->row_index[stmt_no + 1] :
-			       page->data + page->unpacked_size;
-	return xrow_header_decode(xrow, &data, data_end, false);
+	uint32_t row_no = stmt_no;
+	if (page->restart_interval > 0)
+		row_no -= stmt_no % page->restart_interval;
+	const char *prev = NULL;
+	uint32_t prev_size = 0;
+	for (; row_no <= stmt_no; row_no++) {
+		const char *data = page->data + page->row_index[row_no];
+		const char *data_end = row_no + 1 < page->row_count ?
+				       page->data + page->row_index[row_no + 1] :
+				       page->data + page->unpacked_size;
+		if (xrow_header_decode(xrow, &data, data_end, false) != 0)
+			return -1;
+		if (xrow->type == VY_RUN_PREFIX_ROW &&
+		    vy_prefix_row_decode(xrow, prev, prev_size) != 0)
+			return -1;
+		if (xrow->bodycnt > 0) {
+			prev = xrow->body->iov_base;
+			prev_size = xrow->body->iov_len;
+		}
+	}
+	return 0;
 }
 
 /* {{{ vy_run_iterator vy_run_iterator support functions */
@@ -776,10 +1244,15 @@ vy_page_stmt(struct vy_page *page, uint32_t stmt_no,
 	     struct key_def *cmp_def, struct tuple_format *format)
 {
 	struct xrow_header xrow;
-	if (vy_page_xrow(page, stmt_no, &xrow) != 0)
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	if (vy_page_xrow(page, stmt_no, &xrow) != 0) {
+		region_truncate(region, region_svp);
 		return vy_entry_none();
+	}
 	struct vy_entry entry;
 	entry.stmt = vy_stmt_decode(&xrow, format);
+	region_truncate(region, region_svp);
 	if (entry.stmt == NULL)
 		return vy_entry_none();
 	entry.hint = vy_stmt_hint(entry.stmt, cmp_def);
@@ -833,27 +1306,37 @@ vy_run_iterator_stop(struct vy_run_iterator *itr)
 		itr->curr = vy_entry_none();
 	}
 	if (itr->curr_page != NULL) {
-		vy_page_delete(itr->curr_page);
+		vy_page_unref(itr->curr_page);
 		if (itr->prev_page != NULL)
-			vy_page_delete(itr->prev_page);
+			vy_page_unref(itr->prev_page);
 		itr->curr_page = itr->prev_page = NULL;
 	}
 }
 
 static int
 vy_row_index_decode(uint32_t *row_index, uint32_t row_count,
-		    struct xrow_header *xrow)
+		    uint32_t *restart_interval, struct xrow_header *xrow)
 {
 	assert(xrow->type == VY_RUN_ROW_INDEX);
 	const char *pos = xrow->body->iov_base;
+	const char *data = NULL;
 	uint32_t map_size = mp_decode_map(&pos);
 	uint32_t map_item;
 	uint32_t size = 0;
+	*restart_interval = 0;
 	for (map_item = 0; map_item < map_size; ++map_item) {
 		uint32_t key = mp_decode_uint(&pos);
 		switch (key) {
 		case VY_ROW_INDEX_DATA:
 			size = mp_decode_binl(&pos);
+			data = pos;
+			pos += size;
+			break;
+		case VY_ROW_INDEX_RESTART_INTERVAL:
+			*restart_interval = mp_decode_uint(&pos);
+			break;
+		default:
+			mp_next(&pos);
 			break;
 		}
 	}
@@ -866,7 +1349,7 @@ vy_row_index_decode(uint32_t *row_index, uint32_t row_count,
 		return -1;
 	}
 	for (uint32_t i = 0; i < row_count; ++i) {
-		row_index[i] = mp_load_u32(&pos);
+		row_index[i] = mp_load_u32(&data);
 	}
 	assert(pos == xrow->body->iov_base + xrow->body->iov_len);
 	return 0;
@@ -882,96 +1365,282 @@ vy_run_filename(struct vy_run *run)
 }
 
 /**
- * Read a page requests from vinyl xlog data file.
+ * Decode a page read from a vinyl xlog data file.
  *
  * @retval 0 on success
  * @retval -1 on error, check diag
  */
 static int
-vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
-	     struct vy_run *run, ZSTD_DStream *zdctx)
+vy_page_decode(struct vy_page *page, const struct vy_page_info *page_info,
+	       const char *data, ZSTD_DStream *zdctx)
 {
-	/* read xlog tx from xlog file */
-	size_t region_svp = region_used(&fiber()->gc);
-	char *data = (char *)region_alloc(&fiber()->gc, page_info->size);
-	if (data == NULL) {
-		diag_set(OutOfMemory, page_info->size, "region gc", "page");
-		return -1;
-	}
-	ssize_t readen = fio_pread(run->fd, data, page_info->size,
-				   page_info->offset);
-	ERROR_INJECT(ERRINJ_VYRUN_DATA_READ, {
-		readen = -1;
-		errno = EIO;});
-	if (readen < 0) {
-		diag_set(SystemError, "failed to read from file");
-		goto error;
-	}
-	if (readen != (ssize_t)page_info->size) {
-		diag_set(ClientError, ER_INVALID_RUN_FILE,
-			 "Unexpected end of file");
-		goto error;
-	}
-
-	struct errinj *inj = errinj(ERRINJ_VY_READ_PAGE_TIMEOUT, ERRINJ_DOUBLE);
-	if (inj != NULL && inj->dparam > 0)
-		thread_sleep(inj->dparam);
-
-	ERROR_INJECT_SLEEP(ERRINJ_VY_READ_PAGE_DELAY);
-
 	/* decode xlog tx */
 	const char *data_pos = data;
-	const char *data_end = data + readen;
+	const char *data_end = data + page_info->size;
 	char *rows = page->data;
 	char *rows_end = rows + page_info->unpacked_size;
-	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx) != 0)
-		goto error;
+	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx, NULL) != 0)
+		return -1;
 
 	struct xrow_header xrow;
 	data_pos = page->data + page_info->row_index_offset;
 	data_end = page->data + page_info->unpacked_size;
 	if (xrow_header_decode(&xrow, &data_pos, data_end, true) == -1)
-		goto error;
+		return -1;
 	if (xrow.type != VY_RUN_ROW_INDEX) {
 		diag_set(ClientError, ER_INVALID_RUN_FILE,
 			 tt_sprintf("Wrong row index type "
 				    "(expected %d, got %u)",
 				    VY_RUN_ROW_INDEX, (unsigned)xrow.type));
-		goto error;
+		return -1;
 	}
-	if (vy_row_index_decode(page->row_index, page->row_count, &xrow) != 0)
-		goto error;
-	region_truncate(&fiber()->gc, region_svp);
-	ERROR_INJECT(ERRINJ_VY_READ_PAGE, {
-		diag_set(ClientError, ER_INJECTION, "vinyl page read");
-		return -1;});
+	if (vy_row_index_decode(page->row_index, page->row_count,
+				&page->restart_interval, &xrow) != 0)
+		return -1;
 	return 0;
-error:
-	region_truncate(&fiber()->gc, region_svp);
-	diag_log();
-	say_error("error reading %s@%llu:%u", vy_run_filename(run),
-		  (unsigned long long)page_info->offset,
-		  (unsigned)page_info->size);
-	return -1;
 }
 
 /**
- * Get thread local zstd decompression context
+ * Decode a reference to a statement stored in a blob file.
+ * @retval 0 on success
+ * @retval -1 on error, check diag
  */
-static ZSTD_DStream *
-vy_env_get_zdctx(struct vy_run_env *env)
+static int
+vy_blob_ref_decode(struct vy_blob_ref *ref, const struct xrow_header *xrow)
 {
-	ZSTD_DStream *zdctx = tt_pthread_getspecific(env->zdctx_key);
-	if (zdctx == NULL) {
-		zdctx = ZSTD_createDStream();
-		if (zdctx == NULL) {
-			diag_set(OutOfMemory, sizeof(zdctx), "malloc",
-				 "zstd context");
-			return NULL;
+	assert(xrow->type == VY_RUN_BLOB_REF);
+	memset(ref, 0, sizeof(*ref));
+	if (xrow->bodycnt == 0)
+		goto error;
+	const char *pos = xrow->body->iov_base;
+	if (mp_typeof(*pos) != MP_MAP)
+		goto error;
+	uint32_t map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*pos) != MP_UINT)
+			goto error;
+		uint64_t key = mp_decode_uint(&pos);
+		if (key >= VY_BLOB_REF_KEY_MAX) {
+			mp_next(&pos); /* unknown key, ignore */
+			continue;
+		}
+		if (mp_typeof(*pos) != MP_UINT)
+			goto error;
+		uint64_t value = mp_decode_uint(&pos);
+		switch (key) {
+		case VY_BLOB_REF_ID:
+			ref->blob_id = value;
+			break;
+		case VY_BLOB_REF_OFFSET:
+			ref->offset = value;
+			break;
+		case VY_BLOB_REF_SIZE:
+			ref->size = value;
+			break;
 		}
-		tt_pthread_setspecific(env->zdctx_key, zdctx);
 	}
-	return zdctx;
+	if (ref->size == 0)
+		goto error;
+	return 0;
+error:
+	diag_set(ClientError, ER_INVALID_RUN_FILE,
+		 "Can't decode blob reference");
+	return -1;
+}
+
+/**
+ * Get the boundaries of a row stored in a page just read
+ * from disk. The last row ends where the row index begins.
+ */
+static void
+vy_page_row(struct vy_page *page, const struct vy_page_info *page_info,
+	    uint32_t row_no, const char **row, const char **row_end)
+{
+	assert(row_no < page->row_count);
+	*row = page->data + page->row_index[row_no];
+	*row_end = page->data + (row_no + 1 < page->row_count ?
+				 page->row_index[row_no + 1] :
+				 page_info->row_index_offset);
+}
+
+/**
+ * Replace blob references stored in a page just read from disk
+ * with the statements they point to, see struct vy_blob_ref.
+ * Locations of the statements are saved in vy_page::blob_refs.
+ * @retval 0 on success
+ * @retval -1 on error, check diag
+ */
+static int
+vy_page_read_blobs(struct vy_page *page, const struct vy_page_info *page_info,
+		   struct vy_run *run)
+{
+	if (run->info.blob_count == 0)
+		return 0;
+
+	/* Find out the size of the page with statements inlined. */
+	struct xrow_header xrow;
+	struct vy_blob_ref ref;
+	const char *row, *row_end;
+	bool has_refs = false;
+	size_t size = 0;
+	for (uint32_t i = 0; i < page->row_count; i++) {
+		vy_page_row(page, page_info, i, &row, &row_end);
+		const char *pos = row;
+		if (xrow_header_decode(&xrow, &pos, row_end, false) != 0)
+			return -1;
+		if (xrow.type != VY_RUN_BLOB_REF) {
+			size += row_end - row;
+			continue;
+		}
+		if (vy_blob_ref_decode(&ref, &xrow) != 0)
+			return -1;
+		size += ref.size;
+		has_refs = true;
+	}
+	if (!has_refs)
+		return 0;
+
+	char *data = malloc(size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "page->data");
+		return -1;
+	}
+	struct vy_blob_ref *blob_refs = calloc(page->row_count,
+					       sizeof(*blob_refs));
+	if (blob_refs == NULL) {
+		diag_set(OutOfMemory, page->row_count * sizeof(*blob_refs),
+			 "calloc", "page->blob_refs");
+		free(data);
+		return -1;
+	}
+	char *data_pos = data;
+	for (uint32_t i = 0; i < page->row_count; i++) {
+		vy_page_row(page, page_info, i, &row, &row_end);
+		/* The next row offset is still needed, see vy_page_row(). */
+		page->row_index[i] = data_pos - data;
+		const char *pos = row;
+		if (xrow_header_decode(&xrow, &pos, row_end, false) != 0)
+			goto error;
+		if (xrow.type != VY_RUN_BLOB_REF) {
+			memcpy(data_pos, row, row_end - row);
+			data_pos += row_end - row;
+			continue;
+		}
+		if (vy_blob_ref_decode(&ref, &xrow) != 0)
+			goto error;
+		int fd = vy_run_blob_fd(run, ref.blob_id);
+		if (fd < 0) {
+			diag_set(ClientError, ER_INVALID_RUN_FILE,
+				 tt_sprintf("Blob file %lld is not referenced "
+					    "by the run",
+					    (long long)ref.blob_id));
+			goto error;
+		}
+		ssize_t readen = fio_pread(fd, data_pos, ref.size, ref.offset);
+		if (readen < 0) {
+			diag_set(SystemError, "failed to read from blob file");
+			goto error;
+		}
+		if (readen != (ssize_t)ref.size) {
+			diag_set(ClientError, ER_INVALID_RUN_FILE,
+				 "Unexpected end of blob file");
+			goto error;
+		}
+		blob_refs[i] = ref;
+		data_pos += ref.size;
+	}
+	assert(data_pos == data + size);
+	free(page->data);
+	page->data = data;
+	page->unpacked_size = size;
+	page->blob_refs = blob_refs;
+	return 0;
+error:
+	/* The row index is partially rewritten and so is invalid. */
+	free(blob_refs);
+	free(data);
+	return -1;
+}
+
+/** Log a page read error. */
+static void
+vy_page_read_error(const struct vy_page_info *page_info, struct vy_run *run)
+{
+	diag_log();
+	say_error("error reading %s@%llu:%u", vy_run_filename(run),
+		  (unsigned long long)page_info->offset,
+		  (unsigned)page_info->size);
+}
+
+/**
+ * Read a page requests from vinyl xlog data file.
+ *
+ * @retval 0 on success
+ * @retval -1 on error, check diag
+ */
+static int
+vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
+	     struct vy_run *run, ZSTD_DStream *zdctx)
+{
+	/* read xlog tx from xlog file */
+	size_t region_svp = region_used(&fiber()->gc);
+	char *data = (char *)region_alloc(&fiber()->gc, page_info->size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, page_info->size, "region gc", "page");
+		return -1;
+	}
+	ssize_t readen = fio_pread(run->fd, data, page_info->size,
+				   page_info->offset);
+	ERROR_INJECT(ERRINJ_VYRUN_DATA_READ, {
+		readen = -1;
+		errno = EIO;});
+	if (readen < 0) {
+		diag_set(SystemError, "failed to read from file");
+		goto error;
+	}
+	if (readen != (ssize_t)page_info->size) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 "Unexpected end of file");
+		goto error;
+	}
+
+	struct errinj *inj = errinj(ERRINJ_VY_READ_PAGE_TIMEOUT, ERRINJ_DOUBLE);
+	if (inj != NULL && inj->dparam > 0)
+		thread_sleep(inj->dparam);
+
+	ERROR_INJECT_SLEEP(ERRINJ_VY_READ_PAGE_DELAY);
+
+	if (vy_page_decode(page, page_info, data, zdctx) != 0 ||
+	    vy_page_read_blobs(page, page_info, run) != 0)
+		goto error;
+	region_truncate(&fiber()->gc, region_svp);
+	ERROR_INJECT(ERRINJ_VY_READ_PAGE, {
+		diag_set(ClientError, ER_INJECTION, "vinyl page read");
+		return -1;});
+	return 0;
+error:
+	region_truncate(&fiber()->gc, region_svp);
+	vy_page_read_error(page_info, run);
+	return -1;
+}
+
+/**
+ * Get thread local zstd decompression context
+ */
+static ZSTD_DStream *
+vy_env_get_zdctx(struct vy_run_env *env)
+{
+	ZSTD_DStream *zdctx = tt_pthread_getspecific(env->zdctx_key);
+	if (zdctx == NULL) {
+		zdctx = ZSTD_createDStream();
+		if (zdctx == NULL) {
+			diag_set(OutOfMemory, sizeof(zdctx), "malloc",
+				 "zstd context");
+			return NULL;
+		}
+		tt_pthread_setspecific(env->zdctx_key, zdctx);
+	}
+	return zdctx;
 }
 
 /**
@@ -997,7 +1666,8 @@ vy_page_read_cb(struct cbus_call_msg *base)
 
 /**
  * Read a page from disk given its number.
- * The function caches two most recently read pages.
+ * The function caches two most recently read pages and stores
+ * pages read from disk in the page cache shared by all iterators.
  *
  * @retval 0 success
  * @retval -1 critical error
@@ -1030,6 +1700,22 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 		return 0;
 	}
 
+	/* Check the page cache shared by all iterators */
+	page = vy_page_cache_get(env, slice->run, page_no);
+	if (page != NULL) {
+		vy_page_ref(page);
+		if (key.stmt != NULL)
+			*pos_in_page = vy_page_find_key(page, key, itr->cmp_def,
+							itr->format, iterator_type,
+							equal_found);
+		if (itr->prev_page != NULL)
+			vy_page_unref(itr->prev_page);
+		itr->prev_page = itr->curr_page;
+		itr->curr_page = page;
+		*result = page;
+		return 0;
+	}
+
 	/* Allocate buffers */
 	struct vy_page_info *page_info = vy_run_page_info(slice->run, page_no);
 	page = vy_page_new(page_info);
@@ -1067,10 +1753,11 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 
 	/* Update cache */
 	if (itr->prev_page != NULL)
-		vy_page_delete(itr->prev_page);
+		vy_page_unref(itr->prev_page);
 	itr->prev_page = itr->curr_page;
 	itr->curr_page = page;
 	page->page_no = page_no;
+	vy_page_cache_put(env, slice->run, page);
 
 	/* Update read statistics. */
 	itr->stat->read.rows += page_info->row_count;
@@ -1356,6 +2043,27 @@ vy_run_iterator_seek(struct vy_run_iterator *itr, struct vy_entry last,
 		itr->stat->bloom_hit++;
 		return 0;
 	}
+	/*
+	 * If there's a bloom filter per each page, check the filter
+	 * of the page the key may be stored in. If there's a page
+	 * starting with the key, the key is definitely in the run
+	 * and it may span the following pages so don't check.
+	 */
+	if (itr->iterator_type == ITER_EQ && itr->curr.stmt == NULL &&
+	    bloom == NULL && slice->run->info.page_count > 0) {
+		bool equal_key;
+		uint32_t page_no = vy_page_index_find_page(slice->run,
+							   itr->key, cmp_def,
+							   ITER_EQ, &equal_key);
+		bloom = vy_run_page_info(slice->run, page_no)->bloom;
+		check_bloom = !equal_key && bloom != NULL;
+		if (check_bloom &&
+		    !vy_bloom_maybe_has(bloom, itr->key, itr->key_def)) {
+			vy_run_iterator_stop(itr);
+			itr->stat->bloom_hit++;
+			return 0;
+		}
+	}
 
 	/*
 	 * vy_run_iterator_do_seek() implements its own EQ check.
@@ -1657,7 +2365,8 @@ vy_run_acct_page(struct vy_run *run, struct vy_page_info *page)
 
 int
 vy_run_recover(struct vy_run *run, const char *dir,
-	       uint32_t space_id, uint32_t iid, struct key_def *cmp_def)
+	       uint32_t space_id, uint32_t iid, struct key_def *cmp_def,
+	       bool defer_bloom)
 {
 	char path[PATH_MAX];
 	vy_run_snprint_path(path, sizeof(path), dir,
@@ -1704,7 +2413,7 @@ vy_run_recover(struct vy_run *run, const char *dir,
 		goto fail_close;
 	}
 
-	if (vy_run_info_decode(&run->info, &xrow, path) != 0)
+	if (vy_run_info_decode(&run->info, &xrow, path, defer_bloom) != 0)
 		goto fail_close;
 
 	/* Allocate buffer for page info. */
@@ -1768,6 +2477,8 @@ vy_run_recover(struct vy_run *run, const char *dir,
 	}
 	run->fd = cursor.fd;
 	xlog_cursor_close(&cursor, true);
+	if (vy_run_open_blobs(run, dir, space_id, iid) != 0)
+		goto fail;
 	return 0;
 
 fail_close:
@@ -1779,6 +2490,106 @@ fail:
 	return -1;
 }
 
+/** Argument passed to vy_run_load_bloom_cb(). */
+struct vy_run_load_bloom_task {
+	/** Parent. */
+	struct cbus_call_msg base;
+	/** Path to the run index file. */
+	const char *path;
+	/** [out] Loaded bloom filter. */
+	struct tuple_bloom *bloom;
+};
+
+/**
+ * Read the run info row from an index file and decode the bloom
+ * filter stored in it. Executed by a reader thread.
+ */
+static int
+vy_run_load_bloom_cb(struct cbus_call_msg *base)
+{
+	struct vy_run_load_bloom_task *task =
+		(struct vy_run_load_bloom_task *)base;
+	const char *path = task->path;
+
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, path) != 0)
+		return -1;
+	struct xrow_header xrow;
+	int rc = xlog_cursor_next_tx(&cursor);
+	if (rc == 0)
+		rc = xlog_cursor_next_row(&cursor, &xrow);
+	if (rc != 0) {
+		if (rc > 0)
+			diag_set(ClientError, ER_INVALID_INDEX_FILE,
+				 path, "Unexpected end of file");
+		goto fail;
+	}
+	if (xrow.type != VY_INDEX_RUN_INFO) {
+		diag_set(ClientError, ER_INVALID_INDEX_FILE, path,
+			 tt_sprintf("Wrong xrow type (expected %d, got %u)",
+				    VY_INDEX_RUN_INFO, (unsigned)xrow.type));
+		goto fail;
+	}
+	const char *pos = xrow.body->iov_base;
+	uint32_t map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; i++) {
+		uint32_t key = mp_decode_uint(&pos);
+		switch (key) {
+		case VY_RUN_INFO_BLOOM_LEGACY:
+			task->bloom = tuple_bloom_decode_legacy(&pos);
+			break;
+		case VY_RUN_INFO_BLOOM:
+			task->bloom = tuple_bloom_decode(&pos);
+			break;
+		default:
+			mp_next(&pos);
+			continue;
+		}
+		if (task->bloom == NULL)
+			goto fail;
+		break;
+	}
+	xlog_cursor_close(&cursor, false);
+	return 0;
+fail:
+	xlog_cursor_close(&cursor, false);
+	return -1;
+}
+
+int
+vy_run_load_bloom(struct vy_run *run, const char *dir,
+		  uint32_t space_id, uint32_t iid,
+		  struct tuple_bloom **bloom)
+{
+	char path[PATH_MAX];
+	vy_run_snprint_path(path, sizeof(path), dir,
+			    space_id, iid, run->id, VY_FILE_INDEX);
+
+	struct vy_run_load_bloom_task task;
+	task.path = path;
+	task.bloom = NULL;
+	if (vy_run_env_coio_call(run->env, &task.base,
+				 vy_run_load_bloom_cb) != 0) {
+		if (task.bloom != NULL)
+			tuple_bloom_delete(task.bloom);
+		return -1;
+	}
+	*bloom = task.bloom;
+	return 0;
+}
+
+/* encode statement as it is stored in a run page */
+static int
+vy_run_encode_stmt(struct vy_entry entry, struct key_def *key_def,
+		   bool is_primary, struct xrow_header *xrow)
+{
+	return is_primary ?
+	       vy_stmt_encode_primary(entry.stmt, key_def, 0, xrow) :
+	       vy_stmt_encode_secondary(entry.stmt, key_def,
+					vy_entry_multikey_idx(entry, key_def),
+					xrow);
+}
+
 /* dump statement to the run page buffers (stmt header and data) */
 static int
 vy_run_dump_stmt(struct vy_entry entry, struct xlog *data_xlog,
@@ -1786,12 +2597,7 @@ vy_run_dump_stmt(struct vy_entry entry, struct xlog *data_xlog,
 		 bool is_primary)
 {
 	struct xrow_header xrow;
-	int rc = (is_primary ?
-		  vy_stmt_encode_primary(entry.stmt, key_def, 0, &xrow) :
-		  vy_stmt_encode_secondary(entry.stmt, key_def,
-					   vy_entry_multikey_idx(entry, key_def),
-					   &xrow));
-	if (rc != 0)
+	if (vy_run_encode_stmt(entry, key_def, is_primary, &xrow) != 0)
 		return -1;
 
 	ssize_t row_size;
@@ -1808,31 +2614,42 @@ vy_run_dump_stmt(struct vy_entry entry, struct xlog *data_xlog,
  *
  * @param row_index row index
  * @param row_count size of row index
+ * @param restart_interval distance between restart points of
+ *        prefix-compressed rows or 0
  * @param[out] xrow xrow to fill.
  * @retval 0 for success
  * @retval -1 for error
  */
 static int
 vy_row_index_encode(const uint32_t *row_index, uint32_t row_count,
-		    struct xrow_header *xrow)
+		    uint32_t restart_interval, struct xrow_header *xrow)
 {
 	memset(xrow, 0, sizeof(*xrow));
 	xrow->type = VY_RUN_ROW_INDEX;
 
-	size_t size = mp_sizeof_map(1) +
+	uint32_t map_size = restart_interval > 0 ? 2 : 1;
+	size_t size = mp_sizeof_map(map_size) +
 		      mp_sizeof_uint(VY_ROW_INDEX_DATA) +
 		      mp_sizeof_bin(sizeof(uint32_t) * row_count);
+	if (restart_interval > 0) {
+		size += mp_sizeof_uint(VY_ROW_INDEX_RESTART_INTERVAL) +
+			mp_sizeof_uint(restart_interval);
+	}
 	char *pos = region_alloc(&fiber()->gc, size);
 	if (pos == NULL) {
 		diag_set(OutOfMemory, size, "region", "row index");
 		return -1;
 	}
 	xrow->body->iov_base = pos;
-	pos = mp_encode_map(pos, 1);
+	pos = mp_encode_map(pos, map_size);
 	pos = mp_encode_uint(pos, VY_ROW_INDEX_DATA);
 	pos = mp_encode_binl(pos, sizeof(uint32_t) * row_count);
 	for (uint32_t i = 0; i < row_count; ++i)
 		pos = mp_store_u32(pos, row_index[i]);
+	if (restart_interval > 0) {
+		pos = mp_encode_uint(pos, VY_ROW_INDEX_RESTART_INTERVAL);
+		pos = mp_encode_uint(pos, restart_interval);
+	}
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
 	assert(xrow->body->iov_len == size);
 	xrow->bodycnt = 1;
@@ -1885,8 +2702,9 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 
 	/* calc tuple size */
 	uint32_t size;
+	uint32_t map_size = page_info->bloom != NULL ? 7 : 6;
 	/* 3 items: page offset, size, and map */
-	size = mp_sizeof_map(6) +
+	size = mp_sizeof_map(map_size) +
 	       mp_sizeof_uint(VY_PAGE_INFO_OFFSET) +
 	       mp_sizeof_uint(page_info->offset) +
 	       mp_sizeof_uint(VY_PAGE_INFO_SIZE) +
@@ -1899,6 +2717,10 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	       mp_sizeof_uint(page_info->unpacked_size) +
 	       mp_sizeof_uint(VY_PAGE_INFO_ROW_INDEX_OFFSET) +
 	       mp_sizeof_uint(page_info->row_index_offset);
+	if (page_info->bloom != NULL) {
+		size += mp_sizeof_uint(VY_PAGE_INFO_BLOOM) +
+			tuple_bloom_size(page_info->bloom);
+	}
 
 	char *pos = region_alloc(region, size);
 	if (pos == NULL) {
@@ -1909,7 +2731,7 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	memset(xrow, 0, sizeof(*xrow));
 	/* encode page */
 	xrow->body->iov_base = pos;
-	pos = mp_encode_map(pos, 6);
+	pos = mp_encode_map(pos, map_size);
 	pos = mp_encode_uint(pos, VY_PAGE_INFO_OFFSET);
 	pos = mp_encode_uint(pos, page_info->offset);
 	pos = mp_encode_uint(pos, VY_PAGE_INFO_SIZE);
@@ -1923,6 +2745,10 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	pos = mp_encode_uint(pos, page_info->unpacked_size);
 	pos = mp_encode_uint(pos, VY_PAGE_INFO_ROW_INDEX_OFFSET);
 	pos = mp_encode_uint(pos, page_info->row_index_offset);
+	if (page_info->bloom != NULL) {
+		pos = mp_encode_uint(pos, VY_PAGE_INFO_BLOOM);
+		pos = tuple_bloom_encode(page_info->bloom, pos);
+	}
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
 	xrow->bodycnt = 1;
 
@@ -1990,6 +2816,10 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	uint32_t key_count = 6;
 	if (run_info->bloom != NULL)
 		key_count++;
+	if (run_info->blob_count > 0)
+		key_count++;
+	if (run_info->range_tombstone_lsn > 0)
+		key_count++;
 
 	size_t size = mp_sizeof_map(key_count);
 	size += mp_sizeof_uint(VY_RUN_INFO_MIN_KEY) + min_key_size;
@@ -2005,6 +2835,15 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 			tuple_bloom_size(run_info->bloom);
 	size += mp_sizeof_uint(VY_RUN_INFO_STMT_STAT) +
 		vy_stmt_stat_sizeof(&run_info->stmt_stat);
+	if (run_info->blob_count > 0) {
+		size += mp_sizeof_uint(VY_RUN_INFO_BLOBS) +
+			mp_sizeof_array(run_info->blob_count);
+		for (uint32_t i = 0; i < run_info->blob_count; i++)
+			size += mp_sizeof_uint(run_info->blobs[i]);
+	}
+	if (run_info->range_tombstone_lsn > 0)
+		size += mp_sizeof_uint(VY_RUN_INFO_RANGE_TOMBSTONE_LSN) +
+			mp_sizeof_uint(run_info->range_tombstone_lsn);
 
 	char *pos = region_alloc(&fiber()->gc, size);
 	if (pos == NULL) {
@@ -2033,6 +2872,16 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	}
 	pos = mp_encode_uint(pos, VY_RUN_INFO_STMT_STAT);
 	pos = vy_stmt_stat_encode(&run_info->stmt_stat, pos);
+	if (run_info->blob_count > 0) {
+		pos = mp_encode_uint(pos, VY_RUN_INFO_BLOBS);
+		pos = mp_encode_array(pos, run_info->blob_count);
+		for (uint32_t i = 0; i < run_info->blob_count; i++)
+			pos = mp_encode_uint(pos, run_info->blobs[i]);
+	}
+	if (run_info->range_tombstone_lsn > 0) {
+		pos = mp_encode_uint(pos, VY_RUN_INFO_RANGE_TOMBSTONE_LSN);
+		pos = mp_encode_uint(pos, run_info->range_tombstone_lsn);
+	}
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
 	xrow->bodycnt = 1;
 	xrow->type = VY_INDEX_RUN_INFO;
@@ -2108,11 +2957,26 @@ fail:
 	return -1;
 }
 
+/**
+ * Return the number of leading key parts to build a bloom
+ * filter for, given the bloom_part_count index option.
+ */
+static inline uint32_t
+vy_run_bloom_part_count(struct key_def *key_def, uint32_t bloom_part_count)
+{
+	if (bloom_part_count == 0 || bloom_part_count > key_def->part_count)
+		return key_def->part_count;
+	return bloom_part_count;
+}
+
 int
 vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 		     const char *dirpath, uint32_t space_id, uint32_t iid,
 		     struct key_def *cmp_def, struct key_def *key_def,
-		     uint64_t page_size, double bloom_fpr, bool no_compression)
+		     uint64_t page_size, double bloom_fpr,
+		     enum tuple_bloom_type bloom_type, bool bloom_per_page,
+		     uint32_t bloom_part_count, bool prefix_compression,
+		     bool no_compression)
 {
 	memset(writer, 0, sizeof(*writer));
 	writer->run = run;
@@ -2123,9 +2987,15 @@ vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 	writer->key_def = key_def;
 	writer->page_size = page_size;
 	writer->bloom_fpr = bloom_fpr;
+	writer->bloom_type = bloom_type;
+	writer->bloom_per_page = bloom_per_page;
+	writer->prefix_compression = prefix_compression;
 	writer->no_compression = no_compression;
+	writer->blob_run_id = run->id;
+	writer->blob_fd = -1;
 	if (bloom_fpr < 1) {
-		writer->bloom = tuple_bloom_builder_new(key_def->part_count);
+		writer->bloom = tuple_bloom_builder_new(
+			vy_run_bloom_part_count(key_def, bloom_part_count));
 		if (writer->bloom == NULL)
 			return -1;
 	}
@@ -2203,6 +3073,282 @@ vy_run_writer_start_page(struct vy_run_writer *writer,
 	return 0;
 }
 
+/**
+ * Encode a reference to a statement stored in a blob file.
+ * @retval 0 for success
+ * @retval -1 for error
+ */
+static int
+vy_blob_ref_encode(const struct vy_blob_ref *ref, int64_t lsn,
+		   struct xrow_header *xrow)
+{
+	memset(xrow, 0, sizeof(*xrow));
+	xrow->type = VY_RUN_BLOB_REF;
+	xrow->lsn = lsn;
+
+	size_t size = mp_sizeof_map(3) +
+		      mp_sizeof_uint(VY_BLOB_REF_ID) +
+		      mp_sizeof_uint(ref->blob_id) +
+		      mp_sizeof_uint(VY_BLOB_REF_OFFSET) +
+		      mp_sizeof_uint(ref->offset) +
+		      mp_sizeof_uint(VY_BLOB_REF_SIZE) +
+		      mp_sizeof_uint(ref->size);
+	char *pos = region_alloc(&fiber()->gc, size);
+	if (pos == NULL) {
+		diag_set(OutOfMemory, size, "region", "blob ref");
+		return -1;
+	}
+	xrow->body->iov_base = pos;
+	pos = mp_encode_map(pos, 3);
+	pos = mp_encode_uint(pos, VY_BLOB_REF_ID);
+	pos = mp_encode_uint(pos, ref->blob_id);
+	pos = mp_encode_uint(pos, VY_BLOB_REF_OFFSET);
+	pos = mp_encode_uint(pos, ref->offset);
+	pos = mp_encode_uint(pos, VY_BLOB_REF_SIZE);
+	pos = mp_encode_uint(pos, ref->size);
+	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
+	xrow->bodycnt = 1;
+	return 0;
+}
+
+/**
+ * Append a statement to the blob file written by a run writer,
+ * creating the file on the first call.
+ * @param writer Run writer.
+ * @param xrow Encoded statement.
+ * @param[out] ref Location of the statement in the blob file.
+ *
+ * @retval -1 Memory or IO error.
+ * @retval  0 Success.
+ */
+static int
+vy_run_writer_write_blob(struct vy_run_writer *writer,
+			 const struct xrow_header *xrow,
+			 struct vy_blob_ref *ref)
+{
+	struct vy_run *run = writer->run;
+	if (writer->blob_fd < 0) {
+		char path[PATH_MAX];
+		vy_blob_snprint_path(path, sizeof(path), writer->dirpath,
+				     writer->space_id, writer->iid,
+				     writer->blob_run_id, run->id);
+		say_info("writing `%s'", path);
+		writer->blob_fd = open(path, O_WRONLY | O_CREAT | O_EXCL,
+				       0644);
+		if (writer->blob_fd < 0) {
+			diag_set(SystemError, "failed to create file '%s'",
+				 path);
+			return -1;
+		}
+		if (vy_run_add_blob(run, run->id) != 0)
+			return -1;
+	}
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(xrow, 0, iov, 0);
+	if (iovcnt < 0)
+		return -1;
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+	if (fio_writevn(writer->blob_fd, iov, iovcnt) < 0) {
+		diag_set(SystemError, "failed to write to blob file");
+		return -1;
+	}
+	ref->blob_id = run->id;
+	ref->offset = writer->blob_offset;
+	ref->size = size;
+	writer->blob_offset += size;
+	return 0;
+}
+
+/**
+ * Make the run being written reference a blob file written
+ * for another run by linking the file.
+ * @param writer Run writer.
+ * @param run_id ID of a run referencing the blob file.
+ * @param blob_id ID of the blob file.
+ *
+ * @retval -1 Memory or IO error.
+ * @retval  0 Success.
+ */
+static int
+vy_run_writer_link_blob(struct vy_run_writer *writer, int64_t run_id,
+			int64_t blob_id)
+{
+	struct vy_run *run = writer->run;
+	if (vy_run_has_blob(run, blob_id))
+		return 0;
+	char src_path[PATH_MAX];
+	char path[PATH_MAX];
+	vy_blob_snprint_path(src_path, sizeof(src_path), writer->dirpath,
+			     writer->space_id, writer->iid, run_id, blob_id);
+	vy_blob_snprint_path(path, sizeof(path), writer->dirpath,
+			     writer->space_id, writer->iid,
+			     writer->blob_run_id, blob_id);
+	if (link(src_path, path) != 0 && errno != EEXIST) {
+		diag_set(SystemError, "failed to link file '%s' to '%s'",
+			 src_path, path);
+		return -1;
+	}
+	return vy_run_add_blob(run, blob_id);
+}
+
+/**
+ * Write a statement into a current page as a VY_RUN_PREFIX_ROW
+ * row that stores only the part of the statement body following
+ * the prefix it shares with the body of the previous statement.
+ * Every VY_RUN_RESTART_INTERVAL-th row of a page is a restart
+ * point stored as is so that reading a statement never takes
+ * decoding more than VY_RUN_RESTART_INTERVAL rows. A statement
+ * sharing too short a prefix is stored as is, too.
+ * @param writer Run writer.
+ * @param entry Statement to write.
+ * @param page Current page.
+ *
+ * @retval -1 Memory or IO error.
+ * @retval  0 Success.
+ */
+static int
+vy_run_writer_dump_prefix_row(struct vy_run_writer *writer,
+			      struct vy_entry entry,
+			      struct vy_page_info *page)
+{
+	struct xrow_header xrow;
+	if (vy_run_encode_stmt(entry, writer->cmp_def, writer->iid == 0,
+			       &xrow) != 0)
+		return -1;
+
+	/* Flatten the body to compare it with the previous one. */
+	size_t size = 0;
+	for (int i = 0; i < xrow.bodycnt; i++)
+		size += xrow.body[i].iov_len;
+	char *body = region_alloc(&fiber()->gc, size);
+	if (body == NULL) {
+		diag_set(OutOfMemory, size, "region", "statement body");
+		return -1;
+	}
+	char *pos = body;
+	for (int i = 0; i < xrow.bodycnt; i++) {
+		memcpy(pos, xrow.body[i].iov_base, xrow.body[i].iov_len);
+		pos += xrow.body[i].iov_len;
+	}
+
+	uint32_t shared = 0;
+	if (page->row_count % VY_RUN_RESTART_INTERVAL != 0) {
+		uint32_t max_shared = MIN(size, writer->prefix_size);
+		while (shared < max_shared &&
+		       body[shared] == writer->prefix[shared])
+			shared++;
+	}
+	uint32_t suffix_size = size - shared;
+	size_t prefix_row_size = mp_sizeof_map(3) +
+		mp_sizeof_uint(VY_PREFIX_ROW_TYPE) +
+		mp_sizeof_uint(xrow.type) +
+		mp_sizeof_uint(VY_PREFIX_ROW_SHARED) +
+		mp_sizeof_uint(shared) +
+		mp_sizeof_uint(VY_PREFIX_ROW_SUFFIX) +
+		mp_sizeof_bin(suffix_size);
+
+	if (size > writer->prefix_capacity) {
+		char *prefix = realloc(writer->prefix, size);
+		if (prefix == NULL) {
+			diag_set(OutOfMemory, size, "realloc",
+				 "prefix buffer");
+			return -1;
+		}
+		writer->prefix = prefix;
+		writer->prefix_capacity = size;
+	}
+	memcpy(writer->prefix, body, size);
+	writer->prefix_size = size;
+
+	if (prefix_row_size < size) {
+		pos = region_alloc(&fiber()->gc, prefix_row_size);
+		if (pos == NULL) {
+			diag_set(OutOfMemory, prefix_row_size,
+				 "region", "prefix row");
+			return -1;
+		}
+		xrow.body->iov_base = pos;
+		pos = mp_encode_map(pos, 3);
+		pos = mp_encode_uint(pos, VY_PREFIX_ROW_TYPE);
+		pos = mp_encode_uint(pos, xrow.type);
+		pos = mp_encode_uint(pos, VY_PREFIX_ROW_SHARED);
+		pos = mp_encode_uint(pos, shared);
+		pos = mp_encode_uint(pos, VY_PREFIX_ROW_SUFFIX);
+		pos = mp_encode_bin(pos, body + shared, suffix_size);
+		xrow.body->iov_len = pos - (char *)xrow.body->iov_base;
+		xrow.bodycnt = 1;
+		xrow.type = VY_RUN_PREFIX_ROW;
+	}
+
+	ssize_t row_size = xlog_write_row(&writer->data_xlog, &xrow);
+	if (row_size < 0)
+		return -1;
+	page->unpacked_size += row_size;
+	page->row_count++;
+	return 0;
+}
+
+/**
+ * Write a statement into a current page or, if it's a large
+ * primary index statement, into a blob file, leaving only a
+ * reference to it in the page, see struct vy_blob_ref.
+ * @param writer Run writer.
+ * @param entry Statement to write.
+ * @param page Current page.
+ *
+ * @retval -1 Memory or IO error.
+ * @retval  0 Success.
+ */
+static int
+vy_run_writer_dump_stmt(struct vy_run_writer *writer, struct vy_entry entry,
+			struct vy_page_info *page)
+{
+	struct tuple *stmt = entry.stmt;
+	enum iproto_type type = vy_stmt_type(stmt);
+	size_t blob_threshold = writer->run->env->blob_threshold;
+	if (writer->iid != 0 || blob_threshold == 0 ||
+	    (type != IPROTO_REPLACE && type != IPROTO_INSERT) ||
+	    tuple_bsize(stmt) < blob_threshold) {
+		if (writer->prefix_compression)
+			return vy_run_writer_dump_prefix_row(writer, entry,
+							     page);
+		return vy_run_dump_stmt(entry, &writer->data_xlog, page,
+					writer->cmp_def, writer->iid == 0);
+	}
+
+	struct xrow_header xrow;
+	struct vy_blob_ref ref;
+	struct vy_blob_map_entry *blob = NULL;
+	if (writer->blob_map != NULL)
+		blob = vy_blob_map_find(writer->blob_map, stmt);
+	if (blob != NULL && blob->type == type &&
+	    blob->flags == vy_stmt_flags(stmt)) {
+		/* The statement was read from a blob, reuse it. */
+		if (vy_run_writer_link_blob(writer, blob->run_id,
+					    blob->ref.blob_id) != 0)
+			return -1;
+		ref = blob->ref;
+	} else {
+		if (vy_stmt_encode_primary(stmt, writer->cmp_def, 0,
+					   &xrow) != 0 ||
+		    vy_run_writer_write_blob(writer, &xrow, &ref) != 0)
+			return -1;
+	}
+	if (vy_blob_ref_encode(&ref, vy_stmt_lsn(stmt), &xrow) != 0)
+		return -1;
+	ssize_t row_size = xlog_write_row(&writer->data_xlog, &xrow);
+	if (row_size < 0)
+		return -1;
+	page->unpacked_size += row_size;
+	page->row_count++;
+	writer->page_blob_size += ref.size;
+	/* Blob references are replaced on read, don't refer to it. */
+	writer->prefix_size = 0;
+	return 0;
+}
+
 /**
  * Write @a stmt into a current page.
  * @param writer Run writer.
@@ -2230,8 +3376,7 @@ vy_run_writer_write_to_page(struct vy_run_writer *writer, struct vy_entry entry)
 		return -1;
 	}
 	*offset = page->unpacked_size;
-	if (vy_run_dump_stmt(entry, &writer->data_xlog, page,
-			     writer->cmp_def, writer->iid == 0) != 0)
+	if (vy_run_writer_dump_stmt(writer, entry, page) != 0)
 		return -1;
 	int64_t lsn = vy_stmt_lsn(entry.stmt);
 	run->info.min_lsn = MIN(run->info.min_lsn, lsn);
@@ -2258,7 +3403,10 @@ vy_run_writer_end_page(struct vy_run_writer *writer)
 
 	struct xrow_header xrow;
 	uint32_t *row_index = (uint32_t *)writer->row_index_buf.rpos;
-	if (vy_row_index_encode(row_index, page->row_count, &xrow) < 0)
+	uint32_t restart_interval = writer->prefix_compression ?
+				    VY_RUN_RESTART_INTERVAL : 0;
+	if (vy_row_index_encode(row_index, page->row_count,
+				restart_interval, &xrow) < 0)
 		return -1;
 	ssize_t written = xlog_write_row(&writer->data_xlog, &xrow);
 	if (written < 0)
@@ -2272,9 +3420,19 @@ vy_run_writer_end_page(struct vy_run_writer *writer)
 	if (written < 0)
 		return -1;
 	page->size = written;
+	if (writer->bloom != NULL && writer->bloom_per_page) {
+		page->bloom = tuple_bloom_new(writer->bloom,
+					      writer->bloom_fpr,
+					      writer->bloom_type);
+		if (page->bloom == NULL)
+			return -1;
+		tuple_bloom_builder_reset(writer->bloom);
+	}
 	run->info.page_count++;
 	vy_run_acct_page(run, page);
 	ibuf_reset(&writer->row_index_buf);
+	writer->page_blob_size = 0;
+	writer->prefix_size = 0;
 	return 0;
 }
 
@@ -2291,7 +3449,8 @@ vy_run_writer_append_stmt(struct vy_run_writer *writer, struct vy_entry entry)
 		goto out;
 	if (vy_run_writer_write_to_page(writer, entry) != 0)
 		goto out;
-	if (obuf_size(&writer->data_xlog.obuf) >= writer->page_size &&
+	if (obuf_size(&writer->data_xlog.obuf) +
+	    writer->page_blob_size >= writer->page_size &&
 	    vy_run_writer_end_page(writer) != 0)
 		goto out;
 	rc = 0;
@@ -2313,9 +3472,27 @@ vy_run_writer_destroy(struct vy_run_writer *writer, bool reuse_fd)
 		vy_stmt_unref_if_possible(writer->last.stmt);
 	if (xlog_is_open(&writer->data_xlog))
 		xlog_close(&writer->data_xlog, reuse_fd);
+	if (writer->blob_fd >= 0) {
+		close(writer->blob_fd);
+		writer->blob_fd = -1;
+	}
 	if (writer->bloom != NULL)
 		tuple_bloom_builder_delete(writer->bloom);
 	ibuf_destroy(&writer->row_index_buf);
+	free(writer->prefix);
+}
+
+/** Sync the blob file written by a run writer to disk. */
+static int
+vy_run_writer_sync_blob(struct vy_run_writer *writer)
+{
+	if (writer->blob_fd < 0)
+		return 0;
+	if (fsync(writer->blob_fd) < 0) {
+		diag_set(SystemError, "failed to sync blob file");
+		return -1;
+	}
+	return 0;
 }
 
 int
@@ -2359,16 +3536,22 @@ vy_run_writer_commit(struct vy_run_writer *writer)
 	if (xlog_sync(&writer->data_xlog) < 0 ||
 	    xlog_rename(&writer->data_xlog) < 0)
 		goto out;
+	if (vy_run_writer_sync_blob(writer) != 0)
+		goto out;
 
-	if (writer->bloom != NULL) {
+	if (writer->bloom != NULL && !writer->bloom_per_page) {
 		run->info.bloom = tuple_bloom_new(writer->bloom,
-						  writer->bloom_fpr);
+						  writer->bloom_fpr,
+						  writer->bloom_type);
 		if (run->info.bloom == NULL)
 			goto out;
 	}
 	if (vy_run_write_index(run, writer->dirpath,
 			       writer->space_id, writer->iid) != 0)
 		goto out;
+	if (vy_run_open_blobs(run, writer->dirpath,
+			      writer->space_id, writer->iid) != 0)
+		goto out;
 
 	run->fd = writer->data_xlog.fd;
 	vy_run_writer_destroy(writer, true);
@@ -2384,6 +3567,158 @@ vy_run_writer_abort(struct vy_run_writer *writer)
 	vy_run_writer_destroy(writer, false);
 }
 
+int
+vy_run_writer_finish(struct vy_run_writer *writer)
+{
+	int rc = -1;
+	size_t region_svp = region_used(&fiber()->gc);
+
+	if (ibuf_used(&writer->row_index_buf) != 0 &&
+	    vy_run_writer_end_page(writer) != 0)
+		goto out;
+
+	if (xlog_is_open(&writer->data_xlog)) {
+		/*
+		 * The pages are only read back by the writer they
+		 * are merged into, so unlink the file right away
+		 * lest it should be left behind.
+		 */
+		if (unlink(writer->data_xlog.filename) < 0) {
+			diag_set(SystemError, "failed to unlink file '%s'",
+				 writer->data_xlog.filename);
+			goto out;
+		}
+		writer->run->fd = writer->data_xlog.fd;
+		xlog_close(&writer->data_xlog, true);
+	}
+	/*
+	 * The blob file is created for the run the pages are
+	 * merged into, see vy_run_writer::blob_run_id, and so
+	 * it needs to be synced only.
+	 */
+	if (vy_run_writer_sync_blob(writer) != 0)
+		goto out;
+	/*
+	 * The buffer is allocated from the slab cache of the
+	 * current thread so free it here and re-create it empty
+	 * so that the writer can be destroyed from another thread.
+	 */
+	ibuf_destroy(&writer->row_index_buf);
+	ibuf_create(&writer->row_index_buf, &cord()->slabc,
+		    4096 * sizeof(uint32_t));
+	rc = 0;
+out:
+	region_truncate(&fiber()->gc, region_svp);
+	return rc;
+}
+
+int
+vy_run_writer_merge(struct vy_run_writer *writer, struct vy_run_writer *src)
+{
+	struct vy_run *run = writer->run;
+	struct vy_run *src_run = src->run;
+	if (vy_run_is_empty(src_run))
+		return 0;
+
+	assert(!xlog_is_open(&src->data_xlog));
+	assert(src_run->fd >= 0);
+	assert(src->bloom_per_page == writer->bloom_per_page);
+	assert((src->bloom == NULL) == (writer->bloom == NULL));
+
+	int rc = -1;
+	size_t region_svp = region_used(&fiber()->gc);
+
+	if (!xlog_is_open(&writer->data_xlog) &&
+	    vy_run_writer_create_xlog(writer) != 0)
+		goto out;
+	if (ibuf_used(&writer->row_index_buf) != 0 &&
+	    vy_run_writer_end_page(writer) != 0)
+		goto out;
+
+	/* Reserve page info so that moving it below can't fail. */
+	uint32_t page_count = run->info.page_count +
+			      src_run->info.page_count;
+	while (writer->page_info_capacity < page_count) {
+		if (vy_run_alloc_page_info(run,
+					   &writer->page_info_capacity) != 0)
+			goto out;
+	}
+
+	/* Pages are written back to back so copy them one by one. */
+	uint64_t delta = writer->data_xlog.offset -
+			 src_run->page_info[0].offset;
+	for (uint32_t i = 0; i < src_run->info.page_count; i++) {
+		struct vy_page_info *page_info = &src_run->page_info[i];
+		char *data = region_alloc(&fiber()->gc, page_info->size);
+		if (data == NULL) {
+			diag_set(OutOfMemory, page_info->size,
+				 "region", "page");
+			goto out;
+		}
+		ssize_t readen = fio_pread(src_run->fd, data, page_info->size,
+					   page_info->offset);
+		if (readen < 0) {
+			diag_set(SystemError, "failed to read from file");
+			goto out;
+		}
+		if (readen != (ssize_t)page_info->size) {
+			diag_set(ClientError, ER_INVALID_RUN_FILE,
+				 "Unexpected end of file");
+			goto out;
+		}
+		if (xlog_write_raw(&writer->data_xlog, data,
+				   page_info->size) < 0)
+			goto out;
+		region_truncate(&fiber()->gc, region_svp);
+	}
+
+	if (writer->bloom != NULL && !writer->bloom_per_page &&
+	    tuple_bloom_builder_merge(writer->bloom, src->bloom) != 0)
+		goto out;
+
+	/*
+	 * Links to blob files referenced by the source run have
+	 * been created for the destination run by the source run
+	 * writer, see vy_run_writer::blob_run_id.
+	 */
+	assert(src->blob_run_id == run->id);
+	for (uint32_t i = 0; i < src_run->info.blob_count; i++) {
+		if (vy_run_add_blob(run, src_run->info.blobs[i]) != 0)
+			goto out;
+	}
+
+	/*
+	 * Move the page index. Page min keys and bloom filters
+	 * are owned by the destination run from now on.
+	 */
+	for (uint32_t i = 0; i < src_run->info.page_count; i++) {
+		struct vy_page_info *page = run->page_info +
+					    run->info.page_count;
+		*page = src_run->page_info[i];
+		page->offset += delta;
+		run->info.page_count++;
+		vy_run_acct_page(run, page);
+	}
+	src_run->info.page_count = 0;
+	if (run->info.min_key == NULL) {
+		run->info.min_key = src_run->info.min_key;
+		src_run->info.min_key = NULL;
+	}
+	run->info.min_lsn = MIN(run->info.min_lsn, src_run->info.min_lsn);
+	run->info.max_lsn = MAX(run->info.max_lsn, src_run->info.max_lsn);
+	vy_stmt_stat_add(&run->info.stmt_stat, &src_run->info.stmt_stat);
+
+	assert(src->last.stmt != NULL);
+	if (writer->last.stmt != NULL)
+		vy_stmt_unref_if_possible(writer->last.stmt);
+	writer->last = src->last;
+	src->last = vy_entry_none();
+	rc = 0;
+out:
+	region_truncate(&fiber()->gc, region_svp);
+	return rc;
+}
+
 int
 vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		     uint32_t space_id, uint32_t iid,
@@ -2415,7 +3750,9 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 
 	struct tuple_bloom_builder *bloom_builder = NULL;
 	if (opts->bloom_fpr < 1) {
-		bloom_builder = tuple_bloom_builder_new(key_def->part_count);
+		bloom_builder = tuple_bloom_builder_new(
+			vy_run_bloom_part_count(key_def,
+						opts->bloom_part_count));
 		if (bloom_builder == NULL)
 			goto close_err;
 	}
@@ -2432,6 +3769,9 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		uint32_t page_row_count = 0;
 		uint64_t page_row_index_offset = 0;
 		uint64_t row_offset = xlog_cursor_tx_pos(&cursor);
+		/* Body of the previous statement, see vy_page_xrow(). */
+		const char *prev_body = NULL;
+		uint32_t prev_body_size = 0;
 
 		struct xrow_header xrow;
 		while ((rc = xlog_cursor_next_row(&cursor, &xrow)) == 0) {
@@ -2441,6 +3781,14 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 				continue;
 			}
 			++page_row_count;
+			if (xrow.type == VY_RUN_PREFIX_ROW &&
+			    vy_prefix_row_decode(&xrow, prev_body,
+						 prev_body_size) != 0)
+				goto close_err;
+			if (xrow.bodycnt > 0) {
+				prev_body = xrow.body->iov_base;
+				prev_body_size = xrow.body->iov_len;
+			}
 			struct tuple *tuple = vy_stmt_decode(&xrow, format);
 			if (tuple == NULL)
 				goto close_err;
@@ -2485,6 +3833,16 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		info->size = next_page_offset - page_offset;
 		info->unpacked_size = xlog_cursor_tx_pos(&cursor);
 		info->row_index_offset = page_row_index_offset;
+		if (bloom_builder != NULL && opts->bloom_per_page) {
+			info->bloom = tuple_bloom_new(bloom_builder,
+						      opts->bloom_fpr,
+						      opts->bloom_type);
+			if (info->bloom == NULL) {
+				vy_page_info_destroy(info);
+				goto close_err;
+			}
+			tuple_bloom_builder_reset(bloom_builder);
+		}
 		++run->info.page_count;
 		vy_run_acct_page(run, info);
 
@@ -2508,11 +3866,14 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 	run->fd = cursor.fd;
 	xlog_cursor_close(&cursor, true);
 
-	if (bloom_builder != NULL) {
+	if (bloom_builder != NULL && !opts->bloom_per_page) {
 		run->info.bloom = tuple_bloom_new(bloom_builder,
-						  opts->bloom_fpr);
+						  opts->bloom_fpr,
+						  opts->bloom_type);
 		if (run->info.bloom == NULL)
 			goto close_err;
+	}
+	if (bloom_builder != NULL) {
 		tuple_bloom_builder_delete(bloom_builder);
 		bloom_builder = NULL;
 	}
@@ -2542,6 +3903,63 @@ close_err:
 	return -1;
 }
 
+int
+vy_run_foreach_blob(const char *dir, uint32_t space_id, uint32_t iid,
+		    int64_t run_id, int (*cb)(const char *path, void *arg),
+		    void *arg)
+{
+	char path[PATH_MAX];
+	vy_lsm_snprint_path(path, sizeof(path), dir, space_id, iid);
+	DIR *dh = opendir(path);
+	if (dh == NULL) {
+		if (errno == ENOENT)
+			return 0;
+		diag_set(SystemError, "failed to open directory '%s'", path);
+		return -1;
+	}
+	char prefix[32];
+	snprintf(prefix, sizeof(prefix), "%020lld.", (long long)run_id);
+	size_t prefix_len = strlen(prefix);
+	const char *suffix = ".blob";
+	size_t suffix_len = strlen(suffix);
+	int rc = 0;
+	struct dirent *de;
+	while ((de = readdir(dh)) != NULL) {
+		size_t len = strlen(de->d_name);
+		if (len <= prefix_len + suffix_len ||
+		    strncmp(de->d_name, prefix, prefix_len) != 0 ||
+		    strcmp(de->d_name + len - suffix_len, suffix) != 0)
+			continue;
+		char blob_path[PATH_MAX];
+		snprintf(blob_path, sizeof(blob_path), "%s/%s",
+			 path, de->d_name);
+		rc = cb(blob_path, arg);
+		if (rc != 0)
+			break;
+	}
+	closedir(dh);
+	return rc;
+}
+
+/**
+ * vy_run_foreach_blob() callback that removes a blob file link.
+ * On failure, sets the int pointed to by @arg to -1, but goes
+ * on removing other links.
+ */
+static int
+vy_run_remove_blob_cb(const char *path, void *arg)
+{
+	if (coio_unlink(path) < 0) {
+		if (errno != ENOENT) {
+			say_syserror("error while removing %s", path);
+			*(int *)arg = -1;
+		}
+	} else {
+		say_info("removed %s", path);
+	}
+	return 0;
+}
+
 int
 vy_run_remove_files(const char *dir, uint32_t space_id,
 		    uint32_t iid, int64_t run_id)
@@ -2562,9 +3980,138 @@ vy_run_remove_files(const char *dir, uint32_t space_id,
 		} else
 			say_info("removed %s", path);
 	}
+	if (vy_run_foreach_blob(dir, space_id, iid, run_id,
+				vy_run_remove_blob_cb, &ret) != 0) {
+		diag_log();
+		ret = -1;
+	}
 	return ret;
 }
 
+/** Alignment of offsets, sizes, and buffers used for direct I/O. */
+enum { VY_DIRECT_IO_ALIGN = 4096 };
+
+/**
+ * Open the run file of a slice stream with O_DIRECT if direct
+ * I/O is enabled. On failure, e.g. if the file system doesn't
+ * support direct I/O, fall back on reading through the OS page
+ * cache.
+ */
+static void
+vy_slice_stream_open_direct(struct vy_slice_stream *stream)
+{
+	struct vy_run *run = stream->slice->run;
+	assert(stream->direct_fd < 0);
+	if (!run->env->compaction_direct_io)
+		return;
+#if defined(O_DIRECT) && defined(TARGET_OS_LINUX)
+	/*
+	 * Reopen the file via procfs, because the run doesn't
+	 * know the path to its file. We can't just set O_DIRECT
+	 * on a duplicate of run->fd, because it would affect all
+	 * other readers of the run.
+	 */
+	int fd = open(tt_sprintf("/proc/self/fd/%d", run->fd),
+		      O_RDONLY | O_DIRECT);
+	if (fd < 0) {
+		say_syserror("failed to open %s for direct I/O",
+			     vy_run_filename(run));
+		return;
+	}
+	stream->direct_fd = fd;
+#endif
+}
+
+/**
+ * Read a page with direct I/O to the stream buffer unless
+ * it's already there. The buffer is filled with at least
+ * vy_run_env::compaction_readahead bytes so that following
+ * pages can be served without reading the file.
+ * @param stream - the stream.
+ * @param page_info - the page to read.
+ * @param[out] data - set to the page data in the buffer.
+ * @return 0 on success, -1 on memory or read error (diag is set).
+ */
+static int
+vy_slice_stream_read_direct(struct vy_slice_stream *stream,
+			    const struct vy_page_info *page_info,
+			    const char **data)
+{
+	struct vy_run *run = stream->slice->run;
+	off_t begin = page_info->offset;
+	off_t end = begin + page_info->size;
+	if (begin >= stream->buf_offset &&
+	    end <= stream->buf_offset + (off_t)stream->buf_len)
+		goto out;
+
+	off_t offset = begin & ~(off_t)(VY_DIRECT_IO_ALIGN - 1);
+	size_t size = MAX((size_t)(end - offset),
+			  run->env->compaction_readahead);
+	size = (size + VY_DIRECT_IO_ALIGN - 1) &
+	       ~(size_t)(VY_DIRECT_IO_ALIGN - 1);
+	if (size > stream->buf_size) {
+		void *buf;
+		if (posix_memalign(&buf, VY_DIRECT_IO_ALIGN, size) != 0) {
+			diag_set(OutOfMemory, size, "posix_memalign",
+				 "direct I/O buffer");
+			return -1;
+		}
+		free(stream->buf);
+		stream->buf = buf;
+		stream->buf_size = size;
+	}
+	stream->buf_len = 0;
+	ssize_t n;
+	do {
+		/*
+		 * Don't use fio_pread(), because on a short read
+		 * it retries at an unaligned offset.
+		 */
+		n = pread(stream->direct_fd, stream->buf, size, offset);
+	} while (n < 0 && errno == EINTR);
+	ERROR_INJECT(ERRINJ_VYRUN_DATA_READ, {
+		n = -1;
+		errno = EIO;});
+	if (n < 0) {
+		diag_set(SystemError, "failed to read from file");
+		return -1;
+	}
+	stream->buf_offset = offset;
+	stream->buf_len = n;
+	if (end > offset + n) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 "Unexpected end of file");
+		return -1;
+	}
+out:
+	*data = stream->buf + (begin - stream->buf_offset);
+	return 0;
+}
+
+/**
+ * Advise the OS to read ahead the run file of a slice stream
+ * starting from the given page if read-ahead is enabled.
+ */
+static void
+vy_slice_stream_readahead(struct vy_slice_stream *stream,
+			  const struct vy_page_info *page_info)
+{
+#ifdef HAVE_POSIX_FADVISE
+	struct vy_run *run = stream->slice->run;
+	size_t readahead = run->env->compaction_readahead;
+	off_t end = page_info->offset + page_info->size;
+	if (readahead == 0 || end <= stream->readahead_end)
+		return;
+	if (posix_fadvise(run->fd, page_info->offset, readahead,
+			  POSIX_FADV_WILLNEED) != 0)
+		say_syserror("posix_fadvise, fd=%i", run->fd);
+	stream->readahead_end = page_info->offset + readahead;
+#else
+	(void)stream;
+	(void)page_info;
+#endif
+}
+
 /**
  * Read a page with stream->page_no from the run and save it in stream->page.
  * Support function of slice stream.
@@ -2586,7 +4133,22 @@ vy_slice_stream_read_page(struct vy_slice_stream *stream)
 	if (stream->page == NULL)
 		return -1;
 
-	if (vy_page_read(stream->page, page_info, run, zdctx) != 0) {
+	int rc;
+	if (stream->direct_fd >= 0) {
+		const char *data;
+		rc = vy_slice_stream_read_direct(stream, page_info, &data);
+		if (rc == 0)
+			rc = vy_page_decode(stream->page, page_info,
+					    data, zdctx);
+		if (rc == 0)
+			rc = vy_page_read_blobs(stream->page, page_info, run);
+		if (rc != 0)
+			vy_page_read_error(page_info, run);
+	} else {
+		vy_slice_stream_readahead(stream, page_info);
+		rc = vy_page_read(stream->page, page_info, run, zdctx);
+	}
+	if (rc != 0) {
 		vy_page_delete(stream->page);
 		stream->page = NULL;
 		return -1;
@@ -2606,6 +4168,7 @@ vy_slice_stream_search(struct vy_stmt_stream *virt_stream)
 	assert(virt_stream->iface->start == vy_slice_stream_search);
 	struct vy_slice_stream *stream = (struct vy_slice_stream *)virt_stream;
 	assert(stream->page == NULL);
+	vy_slice_stream_open_direct(stream);
 	if (stream->slice->begin.stmt == NULL) {
 		/* Already at the beginning */
 		assert(stream->page_no == 0);
@@ -2669,6 +4232,17 @@ vy_slice_stream_next(struct vy_stmt_stream *virt_stream, struct vy_entry *ret)
 		return 0;
 	}
 
+	/* Let the writer reference the blob the tuple was read from. */
+	struct vy_page *page = stream->page;
+	if (stream->blob_map != NULL && page->blob_refs != NULL &&
+	    page->blob_refs[stream->pos_in_page].size > 0 &&
+	    vy_blob_map_add(stream->blob_map, entry.stmt,
+			    stream->slice->run->id,
+			    &page->blob_refs[stream->pos_in_page]) != 0) {
+		tuple_unref(entry.stmt);
+		return -1;
+	}
+
 	/* We definitely has the next non-null tuple. Save it in stream */
 	if (stream->entry.stmt != NULL)
 		tuple_unref(stream->entry.stmt);
@@ -2711,6 +4285,16 @@ vy_slice_stream_stop(struct vy_stmt_stream *virt_stream)
 		tuple_unref(stream->entry.stmt);
 		stream->entry = vy_entry_none();
 	}
+	if (stream->direct_fd >= 0) {
+		close(stream->direct_fd);
+		stream->direct_fd = -1;
+	}
+	free(stream->buf);
+	stream->buf = NULL;
+	stream->buf_size = 0;
+	stream->buf_offset = 0;
+	stream->buf_len = 0;
+	stream->readahead_end = 0;
 }
 
 static void
@@ -2743,4 +4327,12 @@ vy_slice_stream_open(struct vy_slice_stream *stream, struct vy_slice *slice,
 	stream->cmp_def = cmp_def;
 	stream->format = format;
 	tuple_format_ref(format);
+
+	stream->direct_fd = -1;
+	stream->buf = NULL;
+	stream->buf_size = 0;
+	stream->buf_offset = 0;
+	stream->buf_len = 0;
+	stream->readahead_end = 0;
+	stream->blob_map = NULL;
 }
@@ -69,6 +69,32 @@ struct vy_run_env {
 	 * processing the next read request.
 	 */
 	int next_reader;
+	/**
+	 * LRU list of decompressed pages shared by all run
+	 * iterators, most recently used first. Linked by
+	 * vy_page::in_cache.
+	 */
+	struct rlist page_cache;
+	/** Max size of memory used for caching pages. */
+	size_t page_cache_quota;
+	/** Size of memory used for caching pages. */
+	size_t page_cache_used;
+	/**
+	 * Read compaction input with direct I/O, bypassing
+	 * the OS page cache.
+	 */
+	bool compaction_direct_io;
+	/**
+	 * Size of read-ahead done by compaction, in bytes.
+	 * 0 disables read-ahead.
+	 */
+	size_t compaction_readahead;
+	/**
+	 * Primary index statements of this size or larger are
+	 * stored in blob files, while the run only references
+	 * them. 0 disables blob files.
+	 */
+	size_t blob_threshold;
 };
 
 /**
@@ -87,8 +113,25 @@ struct vy_run_info {
 	uint32_t page_count;
 	/** Bloom filter of all tuples in run */
 	struct tuple_bloom *bloom;
+	/**
+	 * Set if the run has a bloom filter that was skipped
+	 * on recovery and hasn't been loaded yet. Until it is
+	 * loaded, lookups in the run proceed as if there were
+	 * no bloom filter. See vy_run_load_bloom().
+	 */
+	bool bloom_is_deferred;
 	/** Statement statistics. */
 	struct vy_stmt_stat stmt_stat;
+	/** IDs of blob files referenced by the run. */
+	int64_t *blobs;
+	/** Number of entries in the blobs array. */
+	uint32_t blob_count;
+	/**
+	 * Range tombstones with LSN less than or equal to this
+	 * one were applied when the run was written, i.e. the run
+	 * doesn't store any statements they cover.
+	 */
+	int64_t range_tombstone_lsn;
 };
 
 /**
@@ -109,6 +152,11 @@ struct vy_page_info {
 	hint_t min_key_hint;
 	/** Offset of the row index in the page. */
 	uint32_t row_index_offset;
+	/**
+	 * Bloom filter of keys stored in the page or NULL if
+	 * the run has a bloom filter for all its keys or none.
+	 */
+	struct tuple_bloom *bloom;
 };
 
 /**
@@ -123,6 +171,12 @@ struct vy_run {
 	struct vy_page_info *page_info;
 	/** Run data file. */
 	int fd;
+	/**
+	 * Blob files referenced by the run, in the same order as
+	 * vy_run_info::blobs, or NULL if the run doesn't reference
+	 * any blob files.
+	 */
+	int *blob_fds;
 	/** Unique ID of this run. */
 	int64_t id;
 	/** Number of statements in this run. */
@@ -168,8 +222,75 @@ struct vy_run {
 	struct rlist in_unused;
 	/** Link in vy_lsm::runs list. */
 	struct rlist in_lsm;
+	/**
+	 * Pages of this run stored in the environment page cache,
+	 * indexed by page number. Allocated on first use.
+	 */
+	struct vy_page **page_cache;
+};
+
+/**
+ * Location of a statement stored in a blob file.
+ *
+ * Large primary index statements may be written to blob files
+ * instead of pages (see vy_run_env::blob_threshold). A page then
+ * stores a VY_RUN_BLOB_REF row instead of such a statement. Blob
+ * files are append-only and never rewritten: compaction writes
+ * references to the blob files the statements were read from
+ * instead of copying them to the new run. Each run has a hard
+ * link to every blob file it references so blob files are
+ * deleted when the last run referencing them is deleted.
+ */
+struct vy_blob_ref {
+	/** ID of the blob file. */
+	int64_t blob_id;
+	/** Offset of the statement in the blob file. */
+	uint64_t offset;
+	/** Size of the statement, 0 if it isn't stored in a blob. */
+	uint32_t size;
+};
+
+/** A statement read from a blob file, see struct vy_blob_map. */
+struct vy_blob_map_entry {
+	/** The statement (increments tuple::refs). */
+	struct tuple *stmt;
+	/** Type and flags of the statement stored in the blob. */
+	uint8_t type;
+	uint8_t flags;
+	/** ID of the run the statement was read from. */
+	int64_t run_id;
+	/** Location of the statement. */
+	struct vy_blob_ref ref;
 };
 
+/**
+ * Statements read from blob files by slice streams of a write
+ * iterator. The run writer looks up a statement here to write
+ * a reference to the blob file the statement was read from
+ * rather than writing the statement anew.
+ *
+ * The map refers to the statements so that they can't be freed
+ * and reallocated while they are looked up by address. Entries
+ * of statements that aren't used by anyone else are dropped when
+ * a new entry is added, so the map stays small.
+ */
+struct vy_blob_map {
+	/** Array of entries. */
+	struct vy_blob_map_entry *entries;
+	/** Number of entries in the array. */
+	int count;
+	/** Number of entries the array can hold. */
+	int capacity;
+};
+
+/** Initialize a blob map. */
+void
+vy_blob_map_create(struct vy_blob_map *map);
+
+/** Destroy a blob map, dropping all references it holds. */
+void
+vy_blob_map_destroy(struct vy_blob_map *map);
+
 /**
  * Slice of a run, used to organize runs in ranges.
  */
@@ -295,8 +416,30 @@ struct vy_page {
 	uint32_t row_count;
 	/** Array of row offsets. */
 	uint32_t *row_index;
+	/**
+	 * Distance between restart points of prefix-compressed
+	 * rows or 0 if the page doesn't store such rows.
+	 */
+	uint32_t restart_interval;
 	/** Pointer to the page data. */
 	char *data;
+	/**
+	 * Locations of statements read from blob files, indexed
+	 * by statement position in the page, or NULL if the page
+	 * doesn't reference blob files. A statement stored in
+	 * the page itself has zero size here.
+	 */
+	struct vy_blob_ref *blob_refs;
+	/**
+	 * Page reference counter, the page is deleted once it
+	 * hits 0. A page is referenced by each run iterator that
+	 * keeps it and by the page cache.
+	 */
+	int refs;
+	/** Run the page is cached for or NULL if it isn't cached. */
+	struct vy_run *run;
+	/** Link in vy_run_env::page_cache. */
+	struct rlist in_cache;
 };
 
 /**
@@ -315,6 +458,13 @@ vy_run_env_create(struct vy_run_env *env, int read_threads);
 void
 vy_run_env_destroy(struct vy_run_env *env);
 
+/**
+ * Set the max size of memory used for caching decompressed
+ * run pages. Zero disables the cache.
+ */
+void
+vy_run_env_set_page_cache(struct vy_run_env *env, size_t quota);
+
 /**
  * Enable coio reads for a vinyl run environment.
  *
@@ -336,6 +486,12 @@ vy_run_env_enable_coio(struct vy_run_env *env);
 size_t
 vy_run_bloom_size(struct vy_run *run);
 
+/**
+ * Return the type of a run bloom filter.
+ */
+enum tuple_bloom_type
+vy_run_bloom_type(struct vy_run *run);
+
 static inline struct vy_page_info *
 vy_run_page_info(struct vy_run *run, uint32_t pos)
 {
@@ -377,11 +533,37 @@ vy_run_unref(struct vy_run *run)
  * @param space_id - space id
  * @param iid - index id
  * @param cmp_def - definition of keys stored in the run
+ * @param defer_bloom - don't load the bloom filter, leave it
+ *                      to vy_run_load_bloom()
  * @return - 0 on sucess, -1 on fail
  */
 int
 vy_run_recover(struct vy_run *run, const char *dir,
-	       uint32_t space_id, uint32_t iid, struct key_def *cmp_def);
+	       uint32_t space_id, uint32_t iid, struct key_def *cmp_def,
+	       bool defer_bloom);
+
+/**
+ * Load the bloom filter of a run recovered with the bloom filter
+ * deferred (see vy_run_recover()) from the run index file. The
+ * file is read by a reader thread so this function yields.
+ *
+ * The loaded bloom filter is returned in @a bloom rather than
+ * attached to the run, because the caller needs to account it
+ * and the run may be removed from its LSM tree while the bloom
+ * filter is being loaded. @a bloom is set to NULL if the index
+ * file turns out to have no bloom filter.
+ *
+ * @param run - run to load the bloom filter for
+ * @param dir - path to the vinyl directory
+ * @param space_id - space id
+ * @param iid - index id
+ * @param[out] bloom - loaded bloom filter
+ * @return - 0 on sucess, -1 on fail
+ */
+int
+vy_run_load_bloom(struct vy_run *run, const char *dir,
+		  uint32_t space_id, uint32_t iid,
+		  struct tuple_bloom **bloom);
 
 /**
  * Rebuild run index
@@ -442,8 +624,48 @@ vy_run_snprint_path(char *buf, int size, const char *dir,
 }
 
 /**
- * Remove all files (data, index) corresponding to a run
- * with the given id. Return 0 on success, -1 if unlink()
+ * Print the name of the link to a blob file kept for the run
+ * with the given id. The blob file itself is created as a link
+ * kept for the run that wrote it.
+ */
+static inline int
+vy_blob_snprint_filename(char *buf, int size, int64_t run_id,
+			 int64_t blob_id)
+{
+	return snprintf(buf, size, "%020lld.%020lld.blob",
+			(long long)run_id, (long long)blob_id);
+}
+
+static inline int
+vy_blob_snprint_path(char *buf, int size, const char *dir,
+		     uint32_t space_id, uint32_t iid,
+		     int64_t run_id, int64_t blob_id)
+{
+	int total = 0;
+	SNPRINT(total, vy_lsm_snprint_path, buf, size,
+		dir, (unsigned)space_id, (unsigned)iid);
+	SNPRINT(total, snprintf, buf, size, "/");
+	SNPRINT(total, vy_blob_snprint_filename, buf, size, run_id, blob_id);
+	return total;
+}
+
+/**
+ * Call @cb for each blob file link kept for a run with the
+ * given id. Links are found by listing the LSM tree directory,
+ * because the list of blob files referenced by a run is stored
+ * in its index file, which may be missing.
+ *
+ * Returns 0 on success, -1 if the directory can't be listed
+ * (diag is set) or @cb returned non-zero.
+ */
+int
+vy_run_foreach_blob(const char *dir, uint32_t space_id, uint32_t iid,
+		    int64_t run_id, int (*cb)(const char *path, void *arg),
+		    void *arg);
+
+/**
+ * Remove all files (data, index, blob links) corresponding
+ * to a run with the given id. Return 0 on success, -1 if unlink()
  * failed.
  */
 int
@@ -573,10 +795,34 @@ struct vy_slice_stream {
 	struct key_def *cmp_def;
 	/** Format for allocating REPLACE and DELETE tuples read from pages. */
 	struct tuple_format *format;
+	/**
+	 * Run file descriptor opened with O_DIRECT or -1 if
+	 * the run is read through the OS page cache.
+	 */
+	int direct_fd;
+	/** Aligned buffer for direct reads. */
+	char *buf;
+	/** Size of the buffer. */
+	size_t buf_size;
+	/** Run file offset and length of the data in the buffer. */
+	off_t buf_offset;
+	size_t buf_len;
+	/** Run file offset up to which read-ahead was requested. */
+	off_t readahead_end;
+	/**
+	 * If set, statements read from blob files are added
+	 * to this map, see struct vy_blob_map.
+	 */
+	struct vy_blob_map *blob_map;
 };
 
 /**
  * Open a run stream. Use vy_stmt_stream api for further work.
+ *
+ * The stream is used for reading compaction input so it
+ * reads the run with direct I/O or with read-ahead if
+ * configured, see vy_run_env::compaction_direct_io and
+ * vy_run_env::compaction_readahead.
  */
 void
 vy_slice_stream_open(struct vy_slice_stream *stream, struct vy_slice *slice,
@@ -618,15 +864,56 @@ struct vy_run_writer {
 	struct xlog data_xlog;
 	/** Bloom filter false positive rate. */
 	double bloom_fpr;
+	/** Type of filters to build. */
+	enum tuple_bloom_type bloom_type;
+	/** Build a bloom filter per each page, not per run. */
+	bool bloom_per_page;
 	/** Bloom filter. */
 	struct tuple_bloom_builder *bloom;
 	/** Buffer of a current page row offsets. */
 	struct ibuf row_index_buf;
+	/** Write statements as VY_RUN_PREFIX_ROW rows. */
+	bool prefix_compression;
+	/**
+	 * Body of the last statement written to the current page,
+	 * the next statement body is prefix-compressed against it.
+	 * Empty if the next statement is a restart point. Allocated
+	 * with malloc() because the writer may be destroyed from
+	 * another thread.
+	 */
+	char *prefix;
+	/** Size of the prefix buffer data. */
+	uint32_t prefix_size;
+	/** Size of the memory allocated for the prefix buffer. */
+	uint32_t prefix_capacity;
 	/**
 	 * Remember a last written statement to use it as a source
 	 * of max key of a finished run.
 	 */
 	struct vy_entry last;
+	/**
+	 * Statements read from blob files by the write iterator
+	 * feeding the writer or NULL. If a statement is found
+	 * here, the writer references the blob it was read from
+	 * instead of writing it anew.
+	 */
+	struct vy_blob_map *blob_map;
+	/**
+	 * ID of the run blob file links are created for. It is
+	 * the ID of the run being written unless the run is going
+	 * to be merged into another run, see vy_run_writer_merge().
+	 */
+	int64_t blob_run_id;
+	/** File to write large statements to or -1 if not open. */
+	int blob_fd;
+	/** Size of the data written to the blob file. */
+	uint64_t blob_offset;
+	/**
+	 * Size of blobs referenced by the current page. Counts
+	 * towards the page size, because the blobs are read
+	 * along with the page.
+	 */
+	uint64_t page_blob_size;
 };
 
 /** Create a run writer to fill a run with statements. */
@@ -634,7 +921,10 @@ int
 vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 		     const char *dirpath, uint32_t space_id, uint32_t iid,
 		     struct key_def *cmp_def, struct key_def *key_def,
-		     uint64_t page_size, double bloom_fpr, bool no_compression);
+		     uint64_t page_size, double bloom_fpr,
+		     enum tuple_bloom_type bloom_type, bool bloom_per_page,
+		     uint32_t bloom_part_count, bool prefix_compression,
+		     bool no_compression);
 
 /**
  * Write a specified statement into a run.
@@ -666,6 +956,34 @@ vy_run_writer_commit(struct vy_run_writer *writer);
 void
 vy_run_writer_abort(struct vy_run_writer *writer);
 
+/**
+ * Finish writing a run that is going to be merged into another
+ * run with vy_run_writer_merge() rather than committed. Frees
+ * the memory allocated from the slab cache of the current thread
+ * so that the work can be continued in another thread. The run
+ * file is unlinked, but stays open until the run is deleted.
+ * The writer must be deleted with vy_run_writer_abort() after
+ * it has been merged.
+ * @param writer Run writer.
+ * @retval -1 Memory or IO error.
+ * @retval  0 Success.
+ */
+int
+vy_run_writer_finish(struct vy_run_writer *writer);
+
+/**
+ * Append pages written by a writer finished with
+ * vy_run_writer_finish() to another run writer. All keys
+ * of the appended run must be greater than keys already
+ * written.
+ * @param writer Run writer to append pages to.
+ * @param src Finished run writer to take pages from.
+ * @retval -1 Memory or IO error.
+ * @retval  0 Success.
+ */
+int
+vy_run_writer_merge(struct vy_run_writer *writer, struct vy_run_writer *src);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -39,6 +39,7 @@
 #include <small/rlist.h>
 #include <tarantool_ev.h>
 
+#include "clock.h"
 #include "diag.h"
 #include "errcode.h"
 #include "errinj.h"
@@ -152,6 +153,43 @@ struct vy_task_ops {
 	void (*abort)(struct vy_task *task);
 };
 
+/**
+ * Part of a compaction task that compacts a key sub-range of
+ * the range in a separate thread, see vy_scheduler::max_subcompactions.
+ * Pages written by subtasks are appended to the run written by
+ * the task so that compaction still produces a single run.
+ */
+struct vy_subtask {
+	/** Task this subtask is a part of. */
+	struct vy_task *task;
+	/**
+	 * Beginning of the key sub-range compacted by this subtask.
+	 * The sub-range ends where the next one begins.
+	 */
+	struct vy_entry begin;
+	/**
+	 * Slices of compacted runs cut to the key sub-range,
+	 * linked by vy_slice::in_range.
+	 */
+	struct rlist slices;
+	/**
+	 * Run written by this subtask. NULL for the first subtask,
+	 * which is executed by the task itself and so writes to
+	 * vy_task::new_run with vy_task::wi.
+	 */
+	struct vy_run *run;
+	/** Write iterator producing statements for the run. */
+	struct vy_stmt_stream *wi;
+	/** Run writer, valid if @is_finished is set. */
+	struct vy_run_writer writer;
+	/** Thread executing the subtask. */
+	struct cord cord;
+	/** Set if the subtask was started in @cord. */
+	bool is_started;
+	/** Set if the run was successfully written. */
+	bool is_finished;
+};
+
 struct vy_task {
 	/**
 	 * CBus message used for sending the task to/from
@@ -197,12 +235,24 @@ struct vy_task {
 	 * need to remember the slices we are compacting.
 	 */
 	struct vy_slice *first_slice, *last_slice;
+	/**
+	 * Subtasks compacting adjacent key sub-ranges of the range
+	 * in parallel, ordered by key. NULL if the task compacts
+	 * the whole range in one thread.
+	 */
+	struct vy_subtask *subtasks;
+	/** Number of entries in @subtasks. */
+	int subtask_count;
 	/**
 	 * Index options may be modified while a task is in
 	 * progress so we save them here to safely access them
 	 * from another thread.
 	 */
 	double bloom_fpr;
+	enum tuple_bloom_type bloom_type;
+	bool bloom_per_page;
+	uint32_t bloom_part_count;
+	bool prefix_compression;
 	int64_t page_size;
 	/**
 	 * Deferred DELETE handler passed to the write iterator.
@@ -212,6 +262,19 @@ struct vy_task {
 	struct vy_deferred_delete_handler deferred_delete_handler;
 	/** Batch of deferred deletes generated by this task. */
 	struct vy_deferred_delete_batch *deferred_delete_batch;
+	/**
+	 * Committed range tombstones of the LSM tree at the time
+	 * of the task creation, applied by the write iterator.
+	 */
+	struct vy_write_range_tombstone *range_tombstones;
+	/** Number of entries in @range_tombstones. */
+	int range_tombstone_count;
+	/**
+	 * Range tombstones with LSN less than or equal to this one
+	 * are fully applied to the new run, see
+	 * vy_run_info::range_tombstone_lsn.
+	 */
+	int64_t range_tombstone_lsn;
 	/**
 	 * Number of batches of deferred DELETEs sent to tx
 	 * and not yet processed.
@@ -224,6 +287,56 @@ struct vy_task {
 static const struct vy_deferred_delete_handler_iface
 vy_task_deferred_delete_iface;
 
+/**
+ * Take a snapshot of committed range tombstones of the LSM tree
+ * a task is for so that they can be safely accessed from a worker
+ * thread.
+ */
+static int
+vy_task_create_range_tombstones(struct vy_task *task)
+{
+	struct vy_lsm *lsm = task->lsm;
+	struct vy_range_tombstone *tombstone;
+	int count = 0;
+	rlist_foreach_entry(tombstone, &lsm->range_tombstones, in_lsm) {
+		if (tombstone->lsn < MAX_LSN)
+			count++;
+	}
+	if (count == 0)
+		return 0;
+	size_t size = count * sizeof(*task->range_tombstones);
+	task->range_tombstones = malloc(size);
+	if (task->range_tombstones == NULL) {
+		diag_set(OutOfMemory, size, "malloc",
+			 "struct vy_write_range_tombstone");
+		return -1;
+	}
+	int64_t max_lsn = 0;
+	rlist_foreach_entry(tombstone, &lsm->range_tombstones, in_lsm) {
+		if (tombstone->lsn >= MAX_LSN)
+			continue;
+		struct vy_write_range_tombstone *t =
+			&task->range_tombstones[task->range_tombstone_count++];
+		t->begin = tombstone->begin;
+		t->end = tombstone->end;
+		t->lsn = tombstone->lsn;
+		tuple_ref(t->begin.stmt);
+		tuple_ref(t->end.stmt);
+		max_lsn = MAX(max_lsn, t->lsn);
+	}
+	/*
+	 * Statements covered by a tombstone must be preserved
+	 * as long as there's a read view that doesn't see it.
+	 * Uncommitted tombstones will get greater LSNs.
+	 */
+	task->range_tombstone_lsn = max_lsn;
+	struct vy_read_view *rv;
+	rlist_foreach_entry(rv, task->scheduler->read_views, in_read_views)
+		task->range_tombstone_lsn = MIN(task->range_tombstone_lsn,
+						rv->vlsn);
+	return 0;
+}
+
 /**
  * Allocate a new task to be executed by a worker thread.
  * When preparing an asynchronous task, this function must
@@ -258,6 +371,12 @@ vy_task_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 		free(task);
 		return NULL;
 	}
+	if (vy_task_create_range_tombstones(task) != 0) {
+		key_def_delete(task->key_def);
+		key_def_delete(task->cmp_def);
+		free(task);
+		return NULL;
+	}
 	vy_lsm_ref(lsm);
 	diag_create(&task->diag);
 	task->deferred_delete_handler.iface = &vy_task_deferred_delete_iface;
@@ -270,6 +389,11 @@ vy_task_delete(struct vy_task *task)
 {
 	assert(task->deferred_delete_batch == NULL);
 	assert(task->deferred_delete_in_progress == 0);
+	for (int i = 0; i < task->range_tombstone_count; i++) {
+		tuple_unref(task->range_tombstones[i].begin.stmt);
+		tuple_unref(task->range_tombstones[i].end.stmt);
+	}
+	free(task->range_tombstones);
 	key_def_delete(task->cmp_def);
 	key_def_delete(task->key_def);
 	vy_lsm_unref(task->lsm);
@@ -423,6 +547,7 @@ vy_worker_pool_put(struct vy_worker *worker)
 
 void
 vy_scheduler_create(struct vy_scheduler *scheduler, int write_threads,
+		    int dump_threads,
 		    vy_scheduler_dump_complete_f dump_complete_cb,
 		    struct vy_run_env *run_env, struct rlist *read_views)
 {
@@ -431,6 +556,7 @@ vy_scheduler_create(struct vy_scheduler *scheduler, int write_threads,
 	scheduler->dump_complete_cb = dump_complete_cb;
 	scheduler->read_views = read_views;
 	scheduler->run_env = run_env;
+	scheduler->max_subcompactions = 1;
 
 	scheduler->scheduler_fiber = fiber_new("vinyl.scheduler",
 					       vy_scheduler_f);
@@ -448,13 +574,19 @@ vy_scheduler_create(struct vy_scheduler *scheduler, int write_threads,
 	 * pools for dump and compaction tasks.
 	 *
 	 * Since a design based on LSM trees typically implies
-	 * high write amplification, we allocate only 1/4th of
-	 * all available threads to dump tasks while the rest
-	 * is used exclusively for compaction.
+	 * high write amplification, by default we allocate only
+	 * 1/4th of all available threads to dump tasks while the
+	 * rest is used exclusively for compaction. If the dump
+	 * pool size is configured explicitly, all write threads
+	 * are used for compaction.
 	 */
 	assert(write_threads > 1);
-	int dump_threads = MAX(1, write_threads / 4);
-	int compaction_threads = write_threads - dump_threads;
+	assert(dump_threads >= 0);
+	int compaction_threads = write_threads;
+	if (dump_threads == 0) {
+		dump_threads = MAX(1, write_threads / 4);
+		compaction_threads = write_threads - dump_threads;
+	}
 	vy_worker_pool_create(&scheduler->dump_pool,
 			      "dump", dump_threads);
 	vy_worker_pool_create(&scheduler->compaction_pool,
@@ -1050,28 +1182,70 @@ vy_task_deferred_delete_iface = {
 };
 
 static int
-vy_task_write_run(struct vy_task *task, bool no_compression)
+vy_task_create_writer(struct vy_task *task, struct vy_run *run,
+		      bool no_compression, struct vy_run_writer *writer)
 {
-	enum { YIELD_LOOPS = 32 };
-
 	struct vy_lsm *lsm = task->lsm;
-	struct vy_stmt_stream *wi = task->wi;
+	return vy_run_writer_create(writer, run, lsm->env->path,
+				    lsm->space_id, lsm->index_id,
+				    task->cmp_def, task->key_def,
+				    task->page_size, task->bloom_fpr,
+				    task->bloom_type, task->bloom_per_page,
+				    task->bloom_part_count,
+				    task->prefix_compression, no_compression);
+}
 
-	ERROR_INJECT(ERRINJ_VY_RUN_WRITE,
-		     {diag_set(ClientError, ER_INJECTION,
-			       "vinyl dump"); return -1;});
-	ERROR_INJECT_SLEEP(ERRINJ_VY_RUN_WRITE_DELAY);
+/**
+ * Make a write iterator discard statements deleted by range
+ * tombstones of the LSM tree, if any.
+ */
+static void
+vy_task_set_range_tombstones(struct vy_task *task, struct vy_stmt_stream *wi)
+{
+	if (task->range_tombstone_count > 0)
+		vy_write_iterator_set_range_tombstones(wi,
+				task->range_tombstones,
+				task->range_tombstone_count);
+}
 
-	struct vy_run_writer writer;
-	if (vy_run_writer_create(&writer, task->new_run, lsm->env->path,
-				 lsm->space_id, lsm->index_id,
-				 task->cmp_def, task->key_def,
-				 task->page_size, task->bloom_fpr,
-				 no_compression) != 0)
-		goto fail;
+/**
+ * Make a write iterator discard tuples whose TTL has expired
+ * if the LSM tree has a TTL set.
+ */
+static void
+vy_task_set_ttl(struct vy_task *task, struct vy_stmt_stream *wi)
+{
+	struct vy_lsm *lsm = task->lsm;
+	if (lsm->opts.ttl <= 0)
+		return;
+	uint32_t field_no = lsm->opts.ttl_field;
+	if (lsm->index_id > 0) {
+		/*
+		 * Secondary index statements only store key parts
+		 * so we need the number of the TTL field among them.
+		 * The field must be indexed, see
+		 * vinyl_space_check_index_def().
+		 */
+		const struct key_part *part =
+			key_def_find_by_fieldno(task->cmp_def, field_no);
+		if (part == NULL)
+			return;
+		field_no = part - task->cmp_def->parts;
+	}
+	vy_write_iterator_set_ttl(wi, field_no,
+				  clock_realtime() - lsm->opts.ttl);
+}
+
+/** Write statements produced by a write iterator to a run. */
+static int
+vy_task_write_stream(struct vy_stmt_stream *wi, struct vy_run_writer *writer)
+{
+	enum { YIELD_LOOPS = 32 };
 
 	if (wi->iface->start(wi) != 0)
-		goto fail_abort_writer;
+		return -1;
+	/* Reference blobs of compacted statements, don't copy them. */
+	writer->blob_map = vy_write_iterator_blob_map(wi);
 	int rc;
 	int loops = 0;
 	struct vy_entry entry = vy_entry_none();
@@ -1081,7 +1255,7 @@ vy_task_write_run(struct vy_task *task, bool no_compression)
 		if (inj != NULL && inj->dparam > 0)
 			thread_sleep(inj->dparam);
 
-		rc = vy_run_writer_append_stmt(&writer, entry);
+		rc = vy_run_writer_append_stmt(writer, entry);
 		if (rc != 0)
 			break;
 
@@ -1094,18 +1268,114 @@ vy_task_write_run(struct vy_task *task, bool no_compression)
 		}
 	}
 	wi->iface->stop(wi);
+	writer->blob_map = NULL;
+	return rc;
+}
+
+/**
+ * Write the run of a subtask. On success the run writer is
+ * finished so that it can be merged into the task run writer
+ * from another thread.
+ */
+static int
+vy_subtask_execute(struct vy_subtask *subtask)
+{
+	struct vy_run_writer *writer = &subtask->writer;
+	/* Subtasks are only used by compaction, which compresses runs. */
+	if (vy_task_create_writer(subtask->task, subtask->run,
+				  false, writer) != 0)
+		return -1;
+	/* Blob files must be linked for the run the pages go to. */
+	writer->blob_run_id = subtask->task->new_run->id;
+	if (vy_task_write_stream(subtask->wi, writer) != 0 ||
+	    vy_run_writer_finish(writer) != 0) {
+		vy_run_writer_abort(writer);
+		return -1;
+	}
+	subtask->is_finished = true;
+	return 0;
+}
+
+static int
+vy_subtask_f(va_list va)
+{
+	struct vy_subtask *subtask = va_arg(va, struct vy_subtask *);
+	return vy_subtask_execute(subtask);
+}
+
+/**
+ * Execute a task split into subtasks. The first subtask is
+ * executed by the current fiber while the rest are started
+ * in separate threads. Runs written by the subtasks are then
+ * appended one by one, in key order, to the task run.
+ */
+static int
+vy_task_write_subtasks(struct vy_task *task, bool no_compression)
+{
+	assert(task->subtask_count > 1);
+	for (int i = 1; i < task->subtask_count; i++) {
+		struct vy_subtask *subtask = &task->subtasks[i];
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "%s.%d", cord_name(cord()), i);
+		if (cord_costart(&subtask->cord, name,
+				 vy_subtask_f, subtask) != 0) {
+			/* Execute the subtask in this thread then. */
+			diag_log();
+			continue;
+		}
+		subtask->is_started = true;
+	}
+
+	struct vy_run_writer writer;
+	int rc = vy_task_create_writer(task, task->new_run,
+				       no_compression, &writer);
+	bool writer_created = (rc == 0);
+	if (rc == 0)
+		rc = vy_task_write_stream(task->wi, &writer);
+
+	/* Wait for all started threads even if we failed. */
+	for (int i = 1; i < task->subtask_count; i++) {
+		struct vy_subtask *subtask = &task->subtasks[i];
+		if (subtask->is_started) {
+			if (cord_cojoin(&subtask->cord) != 0)
+				rc = -1;
+		} else if (rc == 0) {
+			rc = vy_subtask_execute(subtask);
+		}
+		if (rc == 0)
+			rc = vy_run_writer_merge(&writer, &subtask->writer);
+		if (subtask->is_finished)
+			vy_run_writer_abort(&subtask->writer);
+	}
 
 	if (rc == 0)
 		rc = vy_run_writer_commit(&writer);
-	if (rc != 0)
-		goto fail_abort_writer;
+	if (rc != 0 && writer_created)
+		vy_run_writer_abort(&writer);
+	return rc;
+}
 
-	return 0;
+static int
+vy_task_write_run(struct vy_task *task, bool no_compression)
+{
+	ERROR_INJECT(ERRINJ_VY_RUN_WRITE,
+		     {diag_set(ClientError, ER_INJECTION,
+			       "vinyl dump"); return -1;});
+	ERROR_INJECT_SLEEP(ERRINJ_VY_RUN_WRITE_DELAY);
 
-fail_abort_writer:
-	vy_run_writer_abort(&writer);
-fail:
-	return -1;
+	if (task->subtask_count > 0)
+		return vy_task_write_subtasks(task, no_compression);
+
+	struct vy_run_writer writer;
+	if (vy_task_create_writer(task, task->new_run,
+				  no_compression, &writer) != 0)
+		return -1;
+	if (vy_task_write_stream(task->wi, &writer) != 0 ||
+	    vy_run_writer_commit(&writer) != 0) {
+		vy_run_writer_abort(&writer);
+		return -1;
+	}
+	return 0;
 }
 
 static int
@@ -1239,6 +1509,7 @@ delete_mems:
 	}
 	lsm->dump_lsn = MAX(lsm->dump_lsn, dump_lsn);
 	vy_lsm_acct_dump(lsm, dump_time, &dump_input, &dump_output);
+	vy_lsm_gc_range_tombstones(lsm);
 	/*
 	 * Indexes of the same space share a memory level so we
 	 * account dump input only when the primary index is dumped.
@@ -1373,6 +1644,7 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 
 	new_run->dump_count = 1;
 	new_run->dump_lsn = dump_lsn;
+	new_run->info.range_tombstone_lsn = task->range_tombstone_lsn;
 
 	/*
 	 * Note, since deferred DELETE are generated on tx commit
@@ -1386,6 +1658,8 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 				   is_last_level, scheduler->read_views, NULL);
 	if (wi == NULL)
 		goto err_wi;
+	vy_task_set_ttl(task, wi);
+	vy_task_set_range_tombstones(task, wi);
 	rlist_foreach_entry(mem, &lsm->sealed, in_sealed) {
 		if (mem->generation > scheduler->dump_generation)
 			continue;
@@ -1396,6 +1670,10 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 	task->new_run = new_run;
 	task->wi = wi;
 	task->bloom_fpr = lsm->opts.bloom_fpr;
+	task->bloom_type = lsm->opts.bloom_type;
+	task->bloom_per_page = lsm->opts.bloom_per_page;
+	task->bloom_part_count = lsm->opts.bloom_part_count;
+	task->prefix_compression = lsm->opts.prefix_compression;
 	task->page_size = lsm->opts.page_size;
 
 	lsm->is_dumping = true;
@@ -1431,6 +1709,166 @@ err:
 	return -1;
 }
 
+/**
+ * Free subtasks of a compaction task. Must be called after
+ * the write iterators of the task are stopped.
+ */
+static void
+vy_task_compaction_delete_subtasks(struct vy_task *task)
+{
+	for (int i = 0; i < task->subtask_count; i++) {
+		struct vy_subtask *subtask = &task->subtasks[i];
+		if (subtask->wi != NULL)
+			subtask->wi->iface->close(subtask->wi);
+		if (subtask->run != NULL)
+			vy_run_discard(subtask->run);
+		struct vy_slice *slice, *next_slice;
+		rlist_foreach_entry_safe(slice, &subtask->slices,
+					 in_range, next_slice)
+			vy_slice_delete(slice);
+		if (subtask->begin.stmt != NULL)
+			tuple_unref(subtask->begin.stmt);
+	}
+	free(task->subtasks);
+	task->subtasks = NULL;
+	task->subtask_count = 0;
+}
+
+/**
+ * Split a compaction task into subtasks compacting adjacent
+ * key sub-ranges of the range in parallel threads. Split keys
+ * are taken from page min keys of the oldest run of the range
+ * so that the sub-ranges are of about the same size. If the
+ * range can't be split, the task is left as is.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+vy_task_compaction_split(struct vy_task *task, struct vy_range *range,
+			 bool is_last_level)
+{
+	struct vy_scheduler *scheduler = task->scheduler;
+	struct vy_lsm *lsm = task->lsm;
+
+	if (scheduler->max_subcompactions <= 1)
+		return 0;
+	/*
+	 * Deferred DELETE statements generated by primary index
+	 * compaction are sent to tx via the worker thread pipe
+	 * so we can't write such an index in other threads.
+	 */
+	if (lsm->index_id == 0) {
+		struct space *space = space_by_id(lsm->space_id);
+		if (space == NULL || space->index_count > 1)
+			return 0;
+	}
+
+	struct vy_slice *slice = rlist_last_entry(&range->slices,
+						  struct vy_slice, in_range);
+	uint32_t page_count = slice->last_page_no - slice->first_page_no + 1;
+	int count = MIN((uint32_t)scheduler->max_subcompactions, page_count);
+	if (count <= 1)
+		return 0;
+
+	size_t size = count * sizeof(*task->subtasks);
+	struct vy_subtask *subtasks = calloc(1, size);
+	if (subtasks == NULL) {
+		diag_set(OutOfMemory, size, "calloc", "struct vy_subtask");
+		return -1;
+	}
+	task->subtasks = subtasks;
+	task->subtask_count = 1;
+	subtasks[0].task = task;
+	subtasks[0].begin = vy_entry_none();
+	rlist_create(&subtasks[0].slices);
+
+	const char *prev_key = NULL;
+	hint_t prev_key_hint = HINT_NONE;
+	for (int i = 1; i < count; i++) {
+		struct vy_page_info *page = vy_run_page_info(slice->run,
+				slice->first_page_no + page_count * i / count);
+		/*
+		 * Split keys must be strictly increasing and lie
+		 * strictly within the range, otherwise a sub-range
+		 * would be empty.
+		 */
+		if (slice->begin.stmt != NULL &&
+		    vy_entry_compare_with_raw_key(slice->begin, page->min_key,
+						  page->min_key_hint,
+						  lsm->cmp_def) >= 0)
+			continue;
+		if (slice->end.stmt != NULL &&
+		    vy_entry_compare_with_raw_key(slice->end, page->min_key,
+						  page->min_key_hint,
+						  lsm->cmp_def) <= 0)
+			continue;
+		if (prev_key != NULL &&
+		    key_compare(prev_key, prev_key_hint, page->min_key,
+				page->min_key_hint, lsm->cmp_def) >= 0)
+			continue;
+		prev_key = page->min_key;
+		prev_key_hint = page->min_key_hint;
+
+		struct vy_subtask *subtask = &subtasks[task->subtask_count];
+		subtask->task = task;
+		rlist_create(&subtask->slices);
+		subtask->begin = vy_entry_key_from_msgpack(lsm->env->key_format,
+							   lsm->cmp_def,
+							   page->min_key);
+		if (subtask->begin.stmt == NULL)
+			return -1;
+		task->subtask_count++;
+		subtask->run = vy_run_prepare(scheduler->run_env, lsm);
+		if (subtask->run == NULL)
+			return -1;
+		subtask->wi = vy_write_iterator_new(task->cmp_def,
+						    lsm->index_id == 0,
+						    is_last_level,
+						    scheduler->read_views,
+						    NULL);
+		if (subtask->wi == NULL)
+			return -1;
+		vy_task_set_ttl(task, subtask->wi);
+		vy_task_set_range_tombstones(task, subtask->wi);
+	}
+	if (task->subtask_count == 1) {
+		/* Failed to find a split key. */
+		vy_task_compaction_delete_subtasks(task);
+	}
+	return 0;
+}
+
+/**
+ * Add a slice to a compaction task. If the task is split into
+ * subtasks, the slice is cut to the key sub-range of each of them.
+ */
+static int
+vy_task_compaction_add_slice(struct vy_task *task, struct vy_slice *slice)
+{
+	struct vy_lsm *lsm = task->lsm;
+	if (task->subtask_count == 0)
+		return vy_write_iterator_new_slice(task->wi, slice,
+						   lsm->disk_format);
+	for (int i = 0; i < task->subtask_count; i++) {
+		struct vy_subtask *subtask = &task->subtasks[i];
+		struct vy_entry end = vy_entry_none();
+		if (i + 1 < task->subtask_count)
+			end = task->subtasks[i + 1].begin;
+		struct vy_slice *cut;
+		if (vy_slice_cut(slice, vy_log_next_id(), subtask->begin, end,
+				 lsm->cmp_def, &cut) != 0)
+			return -1;
+		if (cut == NULL)
+			continue;
+		rlist_add_tail_entry(&subtask->slices, cut, in_range);
+		struct vy_stmt_stream *wi = i == 0 ? task->wi : subtask->wi;
+		if (vy_write_iterator_new_slice(wi, cut,
+						lsm->disk_format) != 0)
+			return -1;
+	}
+	return 0;
+}
+
 static int
 vy_task_compaction_execute(struct vy_task *task)
 {
@@ -1453,6 +1891,17 @@ vy_task_compaction_complete(struct vy_task *task)
 	struct vy_slice *slice, *next_slice, *new_slice = NULL;
 	struct vy_run *run;
 
+	/*
+	 * The iterators have been cleaned up in worker. Slices cut
+	 * for subtasks must be deleted before looking for unused
+	 * runs, because they are accounted in vy_run::slice_count.
+	 */
+	if (task->wi != NULL) {
+		task->wi->iface->close(task->wi);
+		task->wi = NULL;
+	}
+	vy_task_compaction_delete_subtasks(task);
+
 	/*
 	 * Allocate a slice of the new run.
 	 *
@@ -1581,8 +2030,7 @@ vy_task_compaction_complete(struct vy_task *task)
 		vy_slice_delete(slice);
 	}
 
-	/* The iterator has been cleaned up in worker. */
-	task->wi->iface->close(task->wi);
+	vy_lsm_gc_range_tombstones(lsm);
 
 	assert(heap_node_is_stray(&range->heap_node));
 	vy_range_heap_insert(&lsm->range_heap, range);
@@ -1600,8 +2048,10 @@ vy_task_compaction_abort(struct vy_task *task)
 	struct vy_lsm *lsm = task->lsm;
 	struct vy_range *range = task->range;
 
-	/* The iterator has been cleaned up in worker. */
-	task->wi->iface->close(task->wi);
+	/* The iterators have been cleaned up in worker. */
+	if (task->wi != NULL)
+		task->wi->iface->close(task->wi);
+	vy_task_compaction_delete_subtasks(task);
 
 	struct error *e = diag_last_error(&task->diag);
 	error_log(e);
@@ -1643,6 +2093,7 @@ vy_task_compaction_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 	struct vy_run *new_run = vy_run_prepare(scheduler->run_env, lsm);
 	if (new_run == NULL)
 		goto err_run;
+	new_run->info.range_tombstone_lsn = task->range_tombstone_lsn;
 
 	struct vy_stmt_stream *wi;
 	bool is_last_level = (range->compaction_priority == range->slice_count);
@@ -1652,13 +2103,18 @@ vy_task_compaction_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 				   &task->deferred_delete_handler);
 	if (wi == NULL)
 		goto err_wi;
+	task->wi = wi;
+	vy_task_set_ttl(task, wi);
+	vy_task_set_range_tombstones(task, wi);
+
+	if (vy_task_compaction_split(task, range, is_last_level) != 0)
+		goto err_wi_sub;
 
 	struct vy_slice *slice;
 	int32_t dump_count = 0;
 	int n = range->compaction_priority;
 	rlist_foreach_entry(slice, &range->slices, in_range) {
-		if (vy_write_iterator_new_slice(wi, slice,
-						lsm->disk_format) != 0)
+		if (vy_task_compaction_add_slice(task, slice) != 0)
 			goto err_wi_sub;
 		new_run->dump_lsn = MAX(new_run->dump_lsn,
 					slice->run->dump_lsn);
@@ -1689,8 +2145,11 @@ vy_task_compaction_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 
 	task->range = range;
 	task->new_run = new_run;
-	task->wi = wi;
 	task->bloom_fpr = lsm->opts.bloom_fpr;
+	task->bloom_type = lsm->opts.bloom_type;
+	task->bloom_per_page = lsm->opts.bloom_per_page;
+	task->bloom_part_count = lsm->opts.bloom_part_count;
+	task->prefix_compression = lsm->opts.prefix_compression;
 	task->page_size = lsm->opts.page_size;
 
 	/*
@@ -1700,14 +2159,16 @@ vy_task_compaction_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 	vy_range_heap_delete(&lsm->range_heap, range);
 	vy_scheduler_update_lsm(scheduler, lsm);
 
-	say_info("%s: started compacting range %s, runs %d/%d",
+	say_info("%s: started compacting range %s, runs %d/%d, threads %d",
 		 vy_lsm_name(lsm), vy_range_str(range),
-                 range->compaction_priority, range->slice_count);
+                 range->compaction_priority, range->slice_count,
+		 MAX(task->subtask_count, 1));
 	*p_task = task;
 	return 0;
 
 err_wi_sub:
-	task->wi->iface->close(wi);
+	wi->iface->close(wi);
+	vy_task_compaction_delete_subtasks(task);
 err_wi:
 	vy_run_discard(new_run);
 err_run:
@@ -1834,6 +2295,17 @@ retry:
 		 */
 		if (worker == NULL) {
 			worker = vy_worker_pool_get(&scheduler->dump_pool);
+			/*
+			 * Dump has priority over compaction, because
+			 * transactions may be waiting for memory to be
+			 * released, so if all dump workers are busy,
+			 * borrow an idle compaction worker. It will be
+			 * returned to the compaction pool once the dump
+			 * task is complete.
+			 */
+			if (worker == NULL)
+				worker = vy_worker_pool_get(
+					&scheduler->compaction_pool);
 			if (worker == NULL)
 				return 0; /* all workers are busy */
 		}
@@ -152,6 +152,12 @@ struct vy_scheduler {
 	struct rlist *read_views;
 	/** Context needed for writing runs. */
 	struct vy_run_env *run_env;
+	/**
+	 * Max number of threads a range compaction task may use.
+	 * A task is split into subtasks compacting adjacent key
+	 * sub-ranges of the range in parallel.
+	 */
+	int max_subcompactions;
 };
 
 /**
@@ -168,9 +174,14 @@ vy_scheduler_dump_in_progress(struct vy_scheduler *scheduler)
 
 /**
  * Create a scheduler instance.
+ *
+ * If @dump_threads is 0, @write_threads are split between dump
+ * and compaction automatically. Otherwise @dump_threads are used
+ * for dumps while all @write_threads are used for compaction.
  */
 void
 vy_scheduler_create(struct vy_scheduler *scheduler, int write_threads,
+		    int dump_threads,
 		    vy_scheduler_dump_complete_f dump_complete_cb,
 		    struct vy_run_env *run_env, struct rlist *read_views);
 
@@ -187,6 +187,8 @@ struct vy_cache_stat {
 	struct vy_stmt_counter count;
 	/** Number of lookups in the cache. */
 	int64_t lookup;
+	/** Number of lookups that found nothing in the cache. */
+	int64_t miss;
 	/** Number of reads from the cache. */
 	struct vy_stmt_counter get;
 	/** Number of writes to the cache. */
@@ -201,6 +203,11 @@ struct vy_cache_stat {
 	 * due to memory shortage.
 	 */
 	struct vy_stmt_counter evict;
+	/**
+	 * Number of statements moved to the protected LRU
+	 * list, because they were read again while cached.
+	 */
+	struct vy_stmt_counter promote;
 };
 
 /** Transaction statistics. */
@@ -211,6 +218,15 @@ struct vy_tx_stat {
 	int64_t rollback;
 	/** Number of transactions aborted on conflict. */
 	int64_t conflict;
+	/** Number of written statements checked for conflicts. */
+	int64_t conflict_check;
+	/**
+	 * Number of conflict checks that were resolved by
+	 * the read set filter without walking the read set.
+	 */
+	int64_t conflict_check_skip;
+	/** Number of read intervals visited by conflict checks. */
+	int64_t conflict_check_visit;
 };
 
 /**
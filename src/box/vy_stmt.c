@@ -139,9 +139,14 @@ vy_stmt_format_new(struct vy_stmt_env *env, struct key_def *const *keys,
 		   uint32_t field_count, uint32_t exact_field_count,
 		   struct tuple_dictionary *dict)
 {
+	/*
+	 * Statements read from disk may not conform to the format
+	 * (see vy_stmt_new_with_ops()) so field maps can't be
+	 * compact.
+	 */
 	return tuple_format_new(&env->tuple_format_vtab, env, keys, key_count,
 				fields, field_count, exact_field_count, dict,
-				false, false);
+				false, false, false);
 }
 
 /**
@@ -443,6 +448,7 @@ vy_stmt_new_surrogate_delete_raw(struct tuple_format *format,
 	}
 	struct field_map_builder builder;
 	if (field_map_builder_create(&builder, format->field_map_size,
+				     format->is_field_map_compact,
 				     region) != 0)
 		goto out;
 	/*
@@ -311,6 +311,7 @@ vy_tx_read_set_free_cb(vy_tx_read_set_t *read_set,
 	(void)arg;
 	(void)read_set;
 	vy_lsm_read_set_remove(&interval->lsm->read_set, interval);
+	vy_read_set_filter_remove(&interval->lsm->read_set_filter, interval);
 	vy_read_interval_delete(interval);
 	return NULL;
 }
@@ -329,6 +330,8 @@ vy_tx_create(struct tx_manager *xm, struct vy_tx *tx)
 	tx->read_view = (struct vy_read_view *)xm->p_global_read_view;
 	vy_tx_read_set_new(&tx->read_set);
 	tx->psn = 0;
+	tx->range_delete = NULL;
+	tx->range_delete_lsm = NULL;
 	rlist_create(&tx->on_destroy);
 	rlist_create(&tx->in_writers);
 }
@@ -347,6 +350,11 @@ vy_tx_destroy(struct vy_tx *tx)
 
 	vy_tx_read_set_iter(&tx->read_set, NULL, vy_tx_read_set_free_cb, NULL);
 	rlist_del_entry(tx, in_writers);
+
+	if (tx->range_delete != NULL)
+		vy_range_tombstone_delete(tx->range_delete);
+	if (tx->range_delete_lsm != NULL)
+		vy_lsm_unref(tx->range_delete_lsm);
 }
 
 /** Mark a transaction as aborted and account it in stats. */
@@ -362,7 +370,7 @@ vy_tx_abort(struct vy_tx *tx)
 static bool
 vy_tx_is_ro(struct vy_tx *tx)
 {
-	return write_set_empty(&tx->write_set);
+	return write_set_empty(&tx->write_set) && tx->range_delete == NULL;
 }
 
 /** Return true if the transaction is in read view. */
@@ -372,6 +380,23 @@ vy_tx_is_in_read_view(struct vy_tx *tx)
 	return tx->read_view->vlsn != INT64_MAX;
 }
 
+/**
+ * Check if a write of statement @v may conflict with any reader.
+ * Updates conflict check statistics.
+ */
+static bool
+vy_tx_may_conflict(struct vy_tx *tx, struct txv *v)
+{
+	struct vy_tx_stat *stat = &tx->xm->stat;
+	stat->conflict_check++;
+	if (!vy_read_set_filter_may_conflict(&v->lsm->read_set_filter,
+					     v->lsm, v->entry)) {
+		stat->conflict_check_skip++;
+		return false;
+	}
+	return true;
+}
+
 /**
  * Send to read view all transactions that are reading key @v
  * modified by transaction @tx.
@@ -379,9 +404,12 @@ vy_tx_is_in_read_view(struct vy_tx *tx)
 static int
 vy_tx_send_to_read_view(struct vy_tx *tx, struct txv *v)
 {
+	if (!vy_tx_may_conflict(tx, v))
+		return 0;
 	struct vy_tx_conflict_iterator it;
 	vy_tx_conflict_iterator_init(&it, &v->lsm->read_set, v->entry);
 	struct vy_tx *abort;
+	int rc = 0;
 	while ((abort = vy_tx_conflict_iterator_next(&it)) != NULL) {
 		/* Don't abort self. */
 		if (abort == tx)
@@ -393,11 +421,14 @@ vy_tx_send_to_read_view(struct vy_tx *tx, struct txv *v)
 		if (vy_tx_is_in_read_view(abort))
 			continue;
 		struct vy_read_view *rv = tx_manager_read_view(tx->xm);
-		if (rv == NULL)
-			return -1;
+		if (rv == NULL) {
+			rc = -1;
+			break;
+		}
 		abort->read_view = rv;
 	}
-	return 0;
+	tx->xm->stat.conflict_check_visit += it.visited;
+	return rc;
 }
 
 /**
@@ -407,6 +438,8 @@ vy_tx_send_to_read_view(struct vy_tx *tx, struct txv *v)
 static void
 vy_tx_abort_readers(struct vy_tx *tx, struct txv *v)
 {
+	if (!vy_tx_may_conflict(tx, v))
+		return;
 	struct vy_tx_conflict_iterator it;
 	vy_tx_conflict_iterator_init(&it, &v->lsm->read_set, v->entry);
 	struct vy_tx *abort;
@@ -419,6 +452,58 @@ vy_tx_abort_readers(struct vy_tx *tx, struct txv *v)
 			continue;
 		vy_tx_abort(abort);
 	}
+	tx->xm->stat.conflict_check_visit += it.visited;
+}
+
+/**
+ * Return true if the given read interval may intersect the key
+ * range deleted by a range tombstone. Partial keys are compared
+ * by prefix so the check is conservative.
+ */
+static bool
+vy_read_interval_intersects_range(struct vy_read_interval *interval,
+				  struct vy_range_tombstone *tombstone,
+				  struct key_def *cmp_def)
+{
+	if (vy_entry_compare(interval->right, tombstone->begin, cmp_def) < 0)
+		return false;
+	if (!vy_stmt_is_empty_key(tombstone->end.stmt) &&
+	    vy_entry_compare(interval->left, tombstone->end, cmp_def) > 0)
+		return false;
+	return true;
+}
+
+/**
+ * Send to read view or abort all transactions that are reading
+ * keys deleted by the range tombstone written by @tx.
+ */
+static int
+vy_tx_handle_range_delete_readers(struct vy_tx *tx, bool abort)
+{
+	struct vy_lsm *lsm = tx->range_delete_lsm;
+	struct vy_read_interval *interval;
+	for (interval = vy_lsm_read_set_first(&lsm->read_set);
+	     interval != NULL;
+	     interval = vy_lsm_read_set_next(&lsm->read_set, interval)) {
+		struct vy_tx *reader = interval->tx;
+		if (reader == tx || reader->state != VINYL_TX_READY)
+			continue;
+		if (!vy_read_interval_intersects_range(interval,
+						       tx->range_delete,
+						       lsm->cmp_def))
+			continue;
+		if (abort) {
+			vy_tx_abort(reader);
+			continue;
+		}
+		if (vy_tx_is_in_read_view(reader))
+			continue;
+		struct vy_read_view *rv = tx_manager_read_view(tx->xm);
+		if (rv == NULL)
+			return -1;
+		reader->read_view = rv;
+	}
+	return 0;
 }
 
 struct vy_tx *
@@ -695,6 +780,13 @@ vy_tx_prepare(struct vy_tx *tx)
 		if (vy_tx_send_to_read_view(tx, v))
 			return -1;
 	}
+	if (tx->range_delete != NULL) {
+		if (vy_tx_handle_range_delete_readers(tx, false) != 0)
+			return -1;
+		tx->range_delete->lsn = MAX_LSN + tx->psn;
+		vy_lsm_add_range_tombstone(tx->range_delete_lsm,
+					   tx->range_delete);
+	}
 
 	/*
 	 * Flush transactional changes to the LSM tree.
@@ -820,6 +912,13 @@ vy_tx_commit(struct vy_tx *tx, int64_t lsn)
 			vy_mem_unpin(v->mem);
 	}
 
+	if (tx->range_delete != NULL) {
+		/* The tombstone is owned by the LSM tree from now on. */
+		vy_lsm_commit_range_tombstone(tx->range_delete_lsm,
+					      tx->range_delete, lsn);
+		tx->range_delete = NULL;
+	}
+
 	/* Update read views of dependant transactions. */
 	if (tx->read_view != &xm->global_read_view)
 		tx->read_view->vlsn = lsn;
@@ -873,6 +972,13 @@ vy_tx_rollback_after_prepare(struct vy_tx *tx)
 	while ((v = write_set_inext(&it)) != NULL) {
 		vy_tx_abort_readers(tx, v);
 	}
+
+	if (tx->range_delete != NULL &&
+	    !rlist_empty(&tx->range_delete->in_lsm)) {
+		vy_lsm_remove_range_tombstone(tx->range_delete_lsm,
+					      tx->range_delete);
+		vy_tx_handle_range_delete_readers(tx, true);
+	}
 }
 
 void
@@ -897,6 +1003,12 @@ vy_tx_begin_statement(struct vy_tx *tx, struct space *space, void **savepoint)
 		return -1;
 	}
 	assert(tx->state == VINYL_TX_READY);
+	if (tx->range_delete != NULL) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "delete_range() mixed with other statements "
+			 "in a transaction");
+		return -1;
+	}
 	tx->last_stmt_space = space;
 	if (stailq_empty(&tx->log))
 		rlist_add_entry(&tx->xm->writers, tx, in_writers);
@@ -912,6 +1024,13 @@ vy_tx_rollback_statement(struct vy_tx *tx, void *svp)
 		return;
 
 	assert(tx->state == VINYL_TX_READY);
+	if (tx->range_delete != NULL) {
+		/* A range delete is always the only statement. */
+		vy_range_tombstone_delete(tx->range_delete);
+		vy_lsm_unref(tx->range_delete_lsm);
+		tx->range_delete = NULL;
+		tx->range_delete_lsm = NULL;
+	}
 	struct stailq_entry *last = svp;
 	struct stailq tail;
 	stailq_cut_tail(&tx->log, last, &tail);
@@ -1008,6 +1127,8 @@ vy_tx_track(struct vy_tx *tx, struct vy_lsm *lsm,
 					  in_merge) {
 			vy_tx_read_set_remove(&tx->read_set, interval);
 			vy_lsm_read_set_remove(&lsm->read_set, interval);
+			vy_read_set_filter_remove(&lsm->read_set_filter,
+						  interval);
 			vy_read_interval_delete(interval);
 		}
 		vy_read_interval_acct(new_interval);
@@ -1015,6 +1136,7 @@ vy_tx_track(struct vy_tx *tx, struct vy_lsm *lsm,
 
 	vy_tx_read_set_insert(&tx->read_set, new_interval);
 	vy_lsm_read_set_insert(&lsm->read_set, new_interval);
+	vy_read_set_filter_add(&lsm->read_set_filter, new_interval);
 	return 0;
 }
 
@@ -1128,6 +1250,24 @@ vy_tx_set_entry(struct vy_tx *tx, struct vy_lsm *lsm, struct vy_entry entry)
 	return 0;
 }
 
+int
+vy_tx_delete_range(struct vy_tx *tx, struct vy_lsm *lsm,
+		   const char *begin, const char *end)
+{
+	assert(tx->state == VINYL_TX_READY);
+	assert(tx->range_delete == NULL);
+	assert(write_set_empty(&tx->write_set));
+	struct vy_range_tombstone *tombstone;
+	tombstone = vy_range_tombstone_new(lsm->env, lsm->cmp_def,
+					   begin, end, 0);
+	if (tombstone == NULL)
+		return -1;
+	vy_lsm_ref(lsm);
+	tx->range_delete = tombstone;
+	tx->range_delete_lsm = lsm;
+	return 0;
+}
+
 int
 vy_tx_set(struct vy_tx *tx, struct vy_lsm *lsm, struct tuple *stmt)
 {
@@ -1159,6 +1299,7 @@ tx_manager_abort_writers_for_ddl(struct tx_manager *xm, struct space *space,
 		if (tx->state != VINYL_TX_READY)
 			continue;
 		if (tx->last_stmt_space == space ||
+		    tx->range_delete_lsm == lsm ||
 		    write_set_search_key(&tx->write_set, lsm,
 					 lsm->env->empty_key) != NULL)
 			vy_tx_abort(tx);
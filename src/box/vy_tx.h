@@ -198,6 +198,13 @@ struct vy_tx {
 	 * is not prepared.
 	 */
 	int64_t psn;
+	/**
+	 * Range tombstone written by the transaction or NULL.
+	 * Owned by the transaction until it's committed.
+	 */
+	struct vy_range_tombstone *range_delete;
+	/** LSM tree @range_delete is for, referenced. */
+	struct vy_lsm *range_delete_lsm;
 	/* List of triggers invoked when this transaction ends. */
 	struct rlist on_destroy;
 };
@@ -408,6 +415,23 @@ vy_tx_track(struct vy_tx *tx, struct vy_lsm *lsm,
 int
 vy_tx_track_point(struct vy_tx *tx, struct vy_lsm *lsm, struct vy_entry entry);
 
+/**
+ * Delete all statements in the key range [begin, end) of an LSM
+ * tree by a range tombstone. The tombstone is added to the LSM
+ * tree on prepare. A transaction may write at most one tombstone
+ * and nothing else.
+ * @param tx           Transaction.
+ * @param lsm          LSM tree to delete from.
+ * @param begin        Start of the range, MessagePack array.
+ * @param end          End of the range, MessagePack array.
+ *
+ * @retval  0 Success
+ * @retval -1 Memory allocation error.
+ */
+int
+vy_tx_delete_range(struct vy_tx *tx, struct vy_lsm *lsm,
+		   const char *begin, const char *end);
+
 /**
  * Insert a statement into a transaction write set.
  * @param tx           Transaction.
@@ -181,6 +181,18 @@ struct vy_write_iterator {
 	 * key and its tuple format is different.
 	 */
 	bool is_primary;
+	/** Set if statements with an expired TTL are discarded. */
+	bool has_ttl;
+	/** Number of the field storing the statement time. */
+	uint32_t ttl_field_no;
+	/** Statements with an older time are expired. */
+	double expire_before;
+	/** Range tombstones applied by the iterator. */
+	const struct vy_write_range_tombstone *range_tombstones;
+	/** Number of entries in @range_tombstones. */
+	int range_tombstone_count;
+	/** Statements read from blob files by run sources. */
+	struct vy_blob_map blob_map;
 	/** Deferred DELETE handler. */
 	struct vy_deferred_delete_handler *deferred_delete_handler;
 	/**
@@ -368,6 +380,7 @@ vy_write_iterator_new(struct key_def *cmp_def, bool is_primary,
 		return NULL;
 	}
 	stream->stmt_i = -1;
+	vy_blob_map_create(&stream->blob_map);
 	stream->rv_count = count;
 	stream->read_views[0].vlsn = INT64_MAX;
 	stream->read_views[0].entry = vy_entry_none();
@@ -394,6 +407,82 @@ vy_write_iterator_new(struct key_def *cmp_def, bool is_primary,
 	return &stream->base;
 }
 
+void
+vy_write_iterator_set_ttl(struct vy_stmt_stream *vstream, uint32_t field_no,
+			  double expire_before)
+{
+	assert(vstream->iface == &vy_slice_stream_iface);
+	struct vy_write_iterator *stream = (struct vy_write_iterator *)vstream;
+	stream->has_ttl = true;
+	stream->ttl_field_no = field_no;
+	stream->expire_before = expire_before;
+}
+
+void
+vy_write_iterator_set_range_tombstones(struct vy_stmt_stream *vstream,
+			const struct vy_write_range_tombstone *tombstones,
+			int count)
+{
+	assert(vstream->iface == &vy_slice_stream_iface);
+	struct vy_write_iterator *stream = (struct vy_write_iterator *)vstream;
+	stream->range_tombstones = tombstones;
+	stream->range_tombstone_count = count;
+}
+
+struct vy_blob_map *
+vy_write_iterator_blob_map(struct vy_stmt_stream *vstream)
+{
+	assert(vstream->iface == &vy_slice_stream_iface);
+	struct vy_write_iterator *stream = (struct vy_write_iterator *)vstream;
+	return &stream->blob_map;
+}
+
+/**
+ * Return true if the given statement is a REPLACE or INSERT
+ * with an expired TTL. A statement without the TTL field or
+ * with a non-numeric value in it never expires.
+ */
+static bool
+vy_write_iterator_stmt_is_expired(struct vy_write_iterator *stream,
+				  struct tuple *stmt)
+{
+	if (!stream->has_ttl)
+		return false;
+	enum iproto_type type = vy_stmt_type(stmt);
+	if (type != IPROTO_REPLACE && type != IPROTO_INSERT)
+		return false;
+	const char *field = tuple_field(stmt, stream->ttl_field_no);
+	double time;
+	if (field == NULL || mp_read_double(&field, &time) != 0)
+		return false;
+	return time < stream->expire_before;
+}
+
+/**
+ * Return true if the given statement is deleted by a range
+ * tombstone visible to the read view with the given LSN.
+ */
+static bool
+vy_write_iterator_stmt_is_covered(struct vy_write_iterator *stream,
+				  struct vy_entry entry, int64_t vlsn)
+{
+	int64_t lsn = vy_stmt_lsn(entry.stmt);
+	for (int i = 0; i < stream->range_tombstone_count; i++) {
+		const struct vy_write_range_tombstone *t =
+					&stream->range_tombstones[i];
+		if (t->lsn <= lsn || t->lsn > vlsn)
+			continue;
+		if (!vy_stmt_is_empty_key(t->begin.stmt) &&
+		    vy_entry_compare(entry, t->begin, stream->cmp_def) < 0)
+			continue;
+		if (!vy_stmt_is_empty_key(t->end.stmt) &&
+		    vy_entry_compare(entry, t->end, stream->cmp_def) >= 0)
+			continue;
+		return true;
+	}
+	return false;
+}
+
 /**
  * Start the search. Must be called after *new* methods and
  * before *next* method.
@@ -452,6 +541,7 @@ vy_write_iterator_stop(struct vy_stmt_stream *vstream)
 		handler->iface->destroy(handler);
 		stream->deferred_delete_handler = NULL;
 	}
+	vy_blob_map_destroy(&stream->blob_map);
 }
 
 /**
@@ -499,6 +589,7 @@ vy_write_iterator_new_slice(struct vy_stmt_stream *vstream,
 		return -1;
 	vy_slice_stream_open(&src->slice_stream, slice, stream->cmp_def,
 			     disk_format);
+	src->slice_stream.blob_map = &stream->blob_map;
 	return 0;
 }
 
@@ -652,7 +743,7 @@ vy_write_iterator_deferred_delete(struct vy_write_iterator *stream,
 
 /**
  * Build the history of the current key.
- * Apply optimizations 1 and 2 (@sa vy_write_iterator.h).
+ * Apply optimizations 1, 2, 6 and 7 (@sa vy_write_iterator.h).
  * When building a history, some statements can be
  * skipped (e.g. multiple REPLACE statements on the same key),
  * but nothing can be merged yet, since we don't know the first
@@ -763,15 +854,31 @@ vy_write_iterator_build_history(struct vy_write_iterator *stream,
 
 		/*
 		 * Optimization 1: skip last level delete.
+		 * Optimization 6: skip last level expired tuple.
 		 * @sa vy_write_iterator for details about this
 		 * and other optimizations.
 		 */
-		if (vy_stmt_type(src->entry.stmt) == IPROTO_DELETE &&
-		    stream->is_last_level && merge_until_lsn < 0) {
+		if (stream->is_last_level && merge_until_lsn < 0 &&
+		    (vy_stmt_type(src->entry.stmt) == IPROTO_DELETE ||
+		     vy_write_iterator_stmt_is_expired(stream,
+						       src->entry.stmt))) {
 			current_rv_lsn = -1; /* Force skip */
 			goto next_lsn;
 		}
 
+		/*
+		 * Optimization 7: skip statements deleted by
+		 * a range tombstone. Since older statements are
+		 * deleted as well, the oldest statement for the key
+		 * can't be treated as an INSERT anymore.
+		 */
+		if (stream->range_tombstone_count > 0 &&
+		    vy_write_iterator_stmt_is_covered(stream, src->entry,
+						      current_rv_lsn)) {
+			*is_first_insert = false;
+			goto next_lsn;
+		}
+
 		rc = vy_write_iterator_push_rv(stream, src->entry,
 					       current_rv_i);
 		if (rc != 0)
@@ -190,6 +190,32 @@
  * also turn the first INSERT in the resulting key's history to a
  * REPLACE in case the oldest statement among all sources is not
  * an INSERT.
+ *
+ * ---------------------------------------------------------------
+ * Optimization #6: if the LSM tree has a TTL, treat an expired
+ * REPLACE or INSERT on the last level as a DELETE and skip it
+ * along with all older statements as long as it is older than
+ * the oldest read view (see optimization #1). A statement is
+ * expired if its TTL field is a number less than the expiration
+ * time passed to vy_write_iterator_set_ttl(). This way expired
+ * tuples are purged by dump and compaction without writing
+ * DELETE statements.
+ *
+ * ---------------------------------------------------------------
+ * Optimization #7: skip statements deleted by a range tombstone,
+ * i.e. statements older than a tombstone covering their key, as
+ * long as the tombstone is visible to the read view the statement
+ * belongs to (see vy_write_iterator_set_range_tombstones()):
+ *
+ *                         --------
+ *                         SAME KEY
+ *                         --------
+ *
+ * 0           VLSN1           RANGE TOMBSTONE      INT64_MAX
+ * |             |                     |                |
+ * | LSN1 ... LSNi | LSNi+1 ... LSNj   |  LSNj+1 ... LSN_N |
+ * \______________/ \__________________/ \_________________/
+ *       keep               skip                merge
  */
 
 struct vy_write_iterator;
@@ -199,6 +225,7 @@ struct tuple_format;
 struct tuple;
 struct vy_mem;
 struct vy_slice;
+struct vy_blob_map;
 
 /**
  * Callback invoked by the write iterator for tuples that were
@@ -252,6 +279,50 @@ vy_write_iterator_new(struct key_def *cmp_def, bool is_primary,
 		      bool is_last_level, struct rlist *read_views,
 		      struct vy_deferred_delete_handler *handler);
 
+/**
+ * Make the write iterator discard expired statements.
+ * @param stream - the write iterator.
+ * @param field_no - number of the statement field storing the time.
+ * @param expire_before - statements with the field value less than
+ * this are considered expired.
+ * @sa optimization #6.
+ */
+void
+vy_write_iterator_set_ttl(struct vy_stmt_stream *stream, uint32_t field_no,
+			  double expire_before);
+
+/** Range tombstone applied by the write iterator. */
+struct vy_write_range_tombstone {
+	/** Start of the deleted range, SELECT statement. */
+	struct vy_entry begin;
+	/** End of the deleted range, SELECT statement. */
+	struct vy_entry end;
+	/** LSN of the tombstone. */
+	int64_t lsn;
+};
+
+/**
+ * Make the write iterator discard statements deleted by range
+ * tombstones. The array must stay valid while the iterator is
+ * in use, the iterator doesn't take ownership of it.
+ * @param stream - the write iterator.
+ * @param tombstones - array of committed range tombstones.
+ * @param count - number of entries in the array.
+ * @sa optimization #7.
+ */
+void
+vy_write_iterator_set_range_tombstones(struct vy_stmt_stream *stream,
+			const struct vy_write_range_tombstone *tombstones,
+			int count);
+
+/**
+ * Return the map of statements read from blob files by run
+ * sources of the write iterator, see struct vy_blob_map.
+ * The map is emptied when the iterator is stopped.
+ */
+struct vy_blob_map *
+vy_write_iterator_blob_map(struct vy_stmt_stream *stream);
+
 /**
  * Add a mem as a source to the iterator.
  * @return 0 on success, -1 on error (diag is set).
@@ -30,10 +30,16 @@
  */
 #include "wal.h"
 
+#include <dirent.h>
+
 #include "vclock.h"
 #include "fiber.h"
+#include "fiber_cond.h"
 #include "fio.h"
 #include "errinj.h"
+#include "clock.h"
+#include "histogram.h"
+#include "latency.h"
 #include "error.h"
 #include "exception.h"
 
@@ -43,6 +49,8 @@
 #include "cbus.h"
 #include "coio_task.h"
 #include "replication.h"
+#include "tt_pthread.h"
+#include "small/ibuf.h"
 
 enum {
 	/**
@@ -72,6 +80,96 @@ wal_write_none_async(struct journal *, struct journal_entry *);
 static int
 wal_write_none(struct journal *, struct journal_entry *);
 
+enum {
+	/** Size of a chunk of the in-memory WAL tail. */
+	WAL_TAIL_CHUNK_SIZE = 1024 * 1024,
+	/** Replica id of a WAL tail entry marking WAL rotation. */
+	WAL_TAIL_ROTATE = UINT32_MAX,
+};
+
+/** Header of an entry of the in-memory WAL tail. */
+struct wal_tail_row {
+	/** Size of the encoded row following the header. */
+	uint32_t size;
+	/** Replica id of the row or WAL_TAIL_ROTATE. */
+	uint32_t replica_id;
+	/** LSN of the row. */
+	int64_t lsn;
+};
+
+/** Size of a WAL tail entry, padded to keep headers aligned. */
+static inline size_t
+wal_tail_row_size(uint32_t size)
+{
+	return (sizeof(struct wal_tail_row) + size + 7) & ~(size_t)7;
+}
+
+/** A chunk of memory storing WAL tail entries. */
+struct wal_tail_chunk {
+	/** Link in wal_tail::chunks. */
+	struct stailq_entry in_tail;
+	/** Offset of the first entry of the chunk in the tail. */
+	int64_t pos;
+	/** Size of the entries stored in the chunk. */
+	size_t used;
+	/** Size of the data array. */
+	size_t size;
+	/** Entries. */
+	char data[0];
+};
+
+/**
+ * In-memory WAL tail: the rows recently written to WAL, encoded
+ * the same way they are stored in xlog files. Relays reading
+ * WAL near its end copy rows from here instead of re-reading
+ * and decoding the xlog files, see wal_tail_read().
+ *
+ * The tail is appended by the WAL thread and read by relay
+ * threads, hence the mutex.
+ */
+struct wal_tail {
+	pthread_mutex_t mutex;
+	/** List of chunks, the oldest goes first. */
+	struct stailq chunks;
+	/** Offset of the first stored entry. */
+	int64_t begin;
+	/** Offset following the last stored entry. */
+	int64_t end;
+	/** Vclock of WAL preceding the first stored row. */
+	struct vclock vclock;
+	/** Total size of all chunks. */
+	size_t size;
+	/**
+	 * The oldest chunks are freed as the size exceeds this.
+	 * Zero disables the tail. Set by box.cfg.wal_tail_size.
+	 */
+	size_t max_size;
+};
+
+/** A fiber waiting in wal_wait_vclock(). */
+struct wal_vclock_waiter {
+	/** Vclock to wait for. */
+	const struct vclock *vclock;
+	/**
+	 * Sum of the vclock components except the 0th one.
+	 * The vclock can't be reached before the same sum of
+	 * the replica set vclock is, so the waiters are kept
+	 * in a heap ordered by it.
+	 */
+	int64_t signature;
+	/** The waiting fiber. */
+	struct fiber *fiber;
+	/** Link in wal_writer::vclock_waiters. */
+	struct heap_node in_heap;
+};
+
+#define HEAP_NAME wal_vclock_waiter_heap
+#define HEAP_LESS(h, l, r) ((l)->signature < (r)->signature)
+#define heap_value_t struct wal_vclock_waiter
+#define heap_value_attr in_heap
+
+#include "salad/heap.h"
+
 /*
  * WAL writer - maintain a Write Ahead Log for every change
  * in the data state.
@@ -104,6 +202,8 @@ struct wal_writer
 	 * rolled back too.
 	 */
 	struct journal_entry *last_entry;
+	/** Fibers waiting in wal_wait_vclock(), see wal_vclock_waiter. */
+	heap_t vclock_waiters;
 	/* ----------------- wal ------------------- */
 	/** A setting from instance configuration - wal_max_size */
 	int64_t wal_max_size;
@@ -167,6 +267,91 @@ struct wal_writer
 	 * Used for replication relays.
 	 */
 	struct rlist watchers;
+	/**
+	 * Group commit window: for how long a batch may be held
+	 * in the WAL thread before it's flushed, so that batches
+	 * arriving in the meantime are written and synced
+	 * together with it, in seconds. 0 disables group commit.
+	 */
+	double group_commit_delay;
+	/**
+	 * A held batch is flushed as soon as the approximate
+	 * size of its rows reaches this limit, in bytes.
+	 */
+	int64_t group_commit_max_size;
+	/**
+	 * The batch whose rows are written to the xlog buffer
+	 * but not flushed yet, or NULL. Rows of batches arriving
+	 * while it is held are appended to it.
+	 */
+	struct wal_msg *pending_batch;
+	/** Approximate size of the rows of the pending batch. */
+	size_t pending_len;
+	/** Number of rows of the pending batch. */
+	int64_t pending_rows;
+	/**
+	 * Number of bytes of the pending batch written to the
+	 * file before the final flush, because the xlog buffer
+	 * got full.
+	 */
+	int64_t pending_bytes;
+	/** Time when the pending batch must be flushed. */
+	double pending_deadline;
+	/**
+	 * Set if the last group commit window managed to merge
+	 * several batches. Otherwise there are no concurrent
+	 * writers to wait for and a batch with a single entry
+	 * is flushed right away.
+	 */
+	bool group_commit_is_useful;
+	/** Fiber flushing the pending batch on timeout. */
+	struct fiber *group_commit_fiber;
+	/**
+	 * vclock changes made by the rows written since the
+	 * last flush. Applied to the writer vclock once the
+	 * rows reach the disk.
+	 */
+	struct vclock vclock_diff;
+	/** The last entry of the current batch written to disk. */
+	struct stailq_entry *last_committed;
+	/**
+	 * In wal_mode = fsync, batches written to the current
+	 * WAL, but not synced yet. They are sent back to tx by
+	 * the sync fiber once the file is synced, so that the
+	 * WAL thread can go on writing the next batches while
+	 * the previous ones are being persisted.
+	 */
+	struct stailq sync_queue;
+	/** Fiber syncing the current WAL in wal_mode = fsync. */
+	struct fiber *sync_fiber;
+	/** Set while the sync fiber is syncing the file. */
+	bool sync_in_progress;
+	/** Signaled when the sync queue gets empty. */
+	struct fiber_cond sync_cond;
+	/**
+	 * Max number of spare WAL files, see wal_set_recycle_count().
+	 * Zero disables recycling.
+	 */
+	int recycle_count;
+	/** Spare WAL files ready for reuse, see struct wal_spare. */
+	struct rlist spares;
+	/** Number of files in the spares list. */
+	int spare_count;
+	/** Number of spare files being prepared by coio threads. */
+	int spare_pending;
+	/** Id used for the name of the next spare file. */
+	int64_t next_spare_id;
+	/** WAL statistics, see box.stat.wal(). */
+	struct wal_stat stat;
+	/** Histograms of rows and bytes written by a flush. */
+	struct histogram *batch_rows_hist;
+	struct histogram *batch_bytes_hist;
+	/** Latencies of writes, syncs and commits. */
+	struct latency write_latency;
+	struct latency sync_latency;
+	struct latency commit_latency;
+	/** Rows recently written to WAL, for relays. */
+	struct wal_tail tail;
 };
 
 struct wal_msg {
@@ -182,6 +367,8 @@ struct wal_msg {
 	struct stailq rollback;
 	/** vclock after the batch processed. */
 	struct vclock vclock;
+	/** Time when the batch was created in tx. */
+	double start;
 };
 
 /**
@@ -204,11 +391,22 @@ wal_mode(void)
 static void
 wal_write_to_disk(struct cmsg *msg);
 
+static void
+wal_flush_pending(struct wal_writer *writer);
+
+static void
+wal_sync_queue_wait(struct wal_writer *writer);
+
 static void
 tx_complete_batch(struct cmsg *msg);
 
+/**
+ * Sic: wal_write_to_disk() forwards a batch to tx itself,
+ * see wal_msg_complete(), because a batch may be held in
+ * the WAL thread for group commit.
+ */
 static struct cmsg_hop wal_request_route[] = {
-	{wal_write_to_disk, &wal_writer_singleton.tx_prio_pipe},
+	{wal_write_to_disk, NULL},
 	{tx_complete_batch, NULL},
 };
 
@@ -220,6 +418,7 @@ wal_msg_create(struct wal_msg *batch)
 	stailq_create(&batch->commit);
 	stailq_create(&batch->rollback);
 	vclock_create(&batch->vclock);
+	batch->start = clock_monotonic();
 }
 
 static struct wal_msg *
@@ -228,6 +427,33 @@ wal_msg(struct cmsg *msg)
 	return msg->route == wal_request_route ? (struct wal_msg *) msg : NULL;
 }
 
+/**
+ * Send a processed batch back to tx. In wal_mode = fsync the
+ * batch is queued until the file is synced, see wal_sync_queue_f().
+ * Batches are always sent to tx in the order they are processed.
+ */
+static void
+wal_msg_complete(struct wal_writer *writer, struct wal_msg *batch)
+{
+	assert(batch->base.hop == &wal_request_route[0]);
+	struct stailq_entry *item;
+	stailq_foreach(item, &batch->rollback)
+		writer->stat.rollbacks++;
+	if (writer->wal_mode == WAL_FSYNC && writer->sync_fiber != NULL &&
+	    (!stailq_empty(&batch->commit) ||
+	     !stailq_empty(&writer->sync_queue))) {
+		stailq_add_tail_entry(&writer->sync_queue, &batch->base, fifo);
+		fiber_wakeup(writer->sync_fiber);
+		return;
+	}
+	if (!stailq_empty(&batch->commit)) {
+		latency_collect(&writer->commit_latency,
+				clock_monotonic() - batch->start);
+	}
+	batch->base.hop++;
+	cpipe_push(&writer->tx_prio_pipe, &batch->base);
+}
+
 /** Write a request to a log in a single transaction. */
 static ssize_t
 xlog_write_entry(struct xlog *l, struct journal_entry *entry)
@@ -245,13 +471,13 @@ xlog_write_entry(struct xlog *l, struct journal_entry *entry)
 			say_warn("injected broken lsn: %lld",
 				 (long long) (*row)->lsn);
 		}
-		if (xlog_write_row(l, *row) < 0) {
-			/*
-			 * Rollback all un-written rows
-			 */
-			xlog_tx_rollback(l);
-			return -1;
-		}
+	}
+	if (xlog_write_rows(l, entry->rows, entry->n_rows) < 0) {
+		/*
+		 * Rollback all un-written rows
+		 */
+		xlog_tx_rollback(l);
+		return -1;
 	}
 	return xlog_tx_commit(l);
 }
@@ -339,6 +565,31 @@ tx_complete_rollback(void)
 	cpipe_push(&writer->wal_pipe, &msg);
 }
 
+/** Sum of all components of a vclock except the 0th one. */
+static inline int64_t
+vclock_sum_ignore0(const struct vclock *vclock)
+{
+	return vclock_sum(vclock) - vclock_get(vclock, 0);
+}
+
+/**
+ * Wake up fibers waiting in wal_wait_vclock() for a vclock which
+ * may have been reached after replicaset.vclock was advanced.
+ */
+static void
+tx_wake_vclock_waiters(struct wal_writer *writer)
+{
+	int64_t signature = vclock_sum_ignore0(&replicaset.vclock);
+	struct wal_vclock_waiter *waiter;
+	while ((waiter = wal_vclock_waiter_heap_top(
+			&writer->vclock_waiters)) != NULL &&
+	       waiter->signature <= signature) {
+		wal_vclock_waiter_heap_delete(&writer->vclock_waiters,
+					      waiter);
+		fiber_wakeup(waiter->fiber);
+	}
+}
+
 /**
  * Complete execution of a batch of WAL write requests:
  * schedule all committed requests, and, should there
@@ -363,6 +614,7 @@ tx_complete_batch(struct cmsg *msg)
 	}
 	/* Update the tx vclock to the latest written by wal. */
 	vclock_copy(&replicaset.vclock, &batch->vclock);
+	tx_wake_vclock_waiters(writer);
 	tx_schedule_queue(&batch->commit);
 	mempool_free(&writer->msg_pool, container_of(msg, struct wal_msg, base));
 }
@@ -396,6 +648,153 @@ tx_notify_checkpoint(struct cmsg *msg)
 	free(msg);
 }
 
+static void
+wal_tail_create(struct wal_tail *tail)
+{
+	tt_pthread_mutex_init(&tail->mutex, NULL);
+	stailq_create(&tail->chunks);
+	tail->begin = tail->end = 0;
+	vclock_create(&tail->vclock);
+	tail->size = 0;
+	tail->max_size = 0;
+}
+
+/**
+ * Free the oldest chunk of the tail, advancing the tail vclock
+ * past the rows stored in it. Must be called under the mutex.
+ */
+static void
+wal_tail_drop_chunk(struct wal_tail *tail)
+{
+	struct wal_tail_chunk *chunk =
+		stailq_shift_entry(&tail->chunks, struct wal_tail_chunk,
+				   in_tail);
+	const char *data = chunk->data;
+	const char *data_end = chunk->data + chunk->used;
+	while (data < data_end) {
+		const struct wal_tail_row *row =
+			(const struct wal_tail_row *)data;
+		if (row->replica_id != WAL_TAIL_ROTATE &&
+		    row->lsn > vclock_get(&tail->vclock, row->replica_id))
+			vclock_reset(&tail->vclock, row->replica_id, row->lsn);
+		data += wal_tail_row_size(row->size);
+	}
+	tail->begin = chunk->pos + chunk->used;
+	tail->size -= chunk->size;
+	free(chunk);
+}
+
+static void
+wal_tail_destroy(struct wal_tail *tail)
+{
+	while (!stailq_empty(&tail->chunks))
+		wal_tail_drop_chunk(tail);
+	tt_pthread_mutex_destroy(&tail->mutex);
+}
+
+/**
+ * Reserve space for an entry at the end of the tail, freeing
+ * the oldest chunks if the tail is too big. Must be called
+ * under the mutex. Returns NULL on memory allocation error.
+ */
+static char *
+wal_tail_reserve(struct wal_tail *tail, size_t size)
+{
+	struct wal_tail_chunk *chunk = NULL;
+	if (!stailq_empty(&tail->chunks)) {
+		chunk = stailq_last_entry(&tail->chunks,
+					  struct wal_tail_chunk, in_tail);
+	}
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		size_t chunk_size = MAX((size_t)WAL_TAIL_CHUNK_SIZE, size);
+		chunk = (struct wal_tail_chunk *)
+			malloc(sizeof(*chunk) + chunk_size);
+		if (chunk == NULL)
+			return NULL;
+		chunk->pos = tail->end;
+		chunk->used = 0;
+		chunk->size = chunk_size;
+		stailq_add_tail_entry(&tail->chunks, chunk, in_tail);
+		tail->size += chunk_size;
+		while (tail->size > tail->max_size &&
+		       stailq_first(&tail->chunks) != &chunk->in_tail)
+			wal_tail_drop_chunk(tail);
+	}
+	char *data = chunk->data + chunk->used;
+	chunk->used += size;
+	tail->end += size;
+	return data;
+}
+
+/**
+ * Forget all rows stored in the tail. Used when a row can't be
+ * appended, so that readers don't miss it.
+ */
+static void
+wal_tail_reset(struct wal_tail *tail, uint32_t replica_id, int64_t lsn)
+{
+	while (!stailq_empty(&tail->chunks))
+		wal_tail_drop_chunk(tail);
+	if (replica_id != WAL_TAIL_ROTATE &&
+	    lsn > vclock_get(&tail->vclock, replica_id))
+		vclock_reset(&tail->vclock, replica_id, lsn);
+	/* Make readers positioned at the end notice the gap. */
+	tail->begin = ++tail->end;
+}
+
+/** Append rows of a journal entry to the tail. */
+static void
+wal_tail_append_entry(struct wal_tail *tail, struct journal_entry *entry)
+{
+	tt_pthread_mutex_lock(&tail->mutex);
+	for (struct xrow_header **row = entry->rows;
+	     row < entry->rows + entry->n_rows; row++) {
+		struct iovec iov[XROW_IOVMAX];
+		int iovcnt = xrow_header_encode(*row, 0, iov, 0);
+		uint32_t size = 0;
+		for (int i = 0; i < iovcnt; i++)
+			size += iov[i].iov_len;
+		char *data = iovcnt < 0 || tail->max_size == 0 ? NULL :
+			     wal_tail_reserve(tail, wal_tail_row_size(size));
+		if (data == NULL) {
+			diag_clear(diag_get());
+			wal_tail_reset(tail, (*row)->replica_id, (*row)->lsn);
+			continue;
+		}
+		struct wal_tail_row *hdr = (struct wal_tail_row *)data;
+		hdr->size = size;
+		hdr->replica_id = (*row)->replica_id;
+		hdr->lsn = (*row)->lsn;
+		data += sizeof(*hdr);
+		for (int i = 0; i < iovcnt; i++) {
+			memcpy(data, iov[i].iov_base, iov[i].iov_len);
+			data += iov[i].iov_len;
+		}
+	}
+	tt_pthread_mutex_unlock(&tail->mutex);
+}
+
+/**
+ * Mark creation of a new WAL file in the tail so that readers
+ * can account the previous file as fully read.
+ */
+static void
+wal_tail_append_rotate(struct wal_tail *tail)
+{
+	tt_pthread_mutex_lock(&tail->mutex);
+	char *data = tail->max_size == 0 ? NULL :
+		     wal_tail_reserve(tail, wal_tail_row_size(0));
+	if (data != NULL) {
+		struct wal_tail_row *hdr = (struct wal_tail_row *)data;
+		hdr->size = 0;
+		hdr->replica_id = WAL_TAIL_ROTATE;
+		hdr->lsn = 0;
+	} else {
+		wal_tail_reset(tail, WAL_TAIL_ROTATE, 0);
+	}
+	tt_pthread_mutex_unlock(&tail->mutex);
+}
+
 /**
  * Initialize WAL writer context. Even though it's a singleton,
  * encapsulate the details just in case we may use
@@ -404,8 +803,9 @@ tx_notify_checkpoint(struct cmsg *msg)
 static void
 wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 		  void (*wall_async_cb)(struct journal_entry *entry),
-		  const char *wal_dirname,
-		  int64_t wal_max_size, const struct tt_uuid *instance_uuid,
+		  const char *wal_dirname, int64_t wal_max_size,
+		  int compression_level, size_t compression_threshold,
+		  const struct tt_uuid *instance_uuid,
 		  wal_on_garbage_collection_f on_garbage_collection,
 		  wal_on_checkpoint_threshold_f on_checkpoint_threshold)
 {
@@ -421,13 +821,15 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	struct xlog_opts opts = xlog_opts_default;
 	opts.sync_is_async = true;
+	opts.compression_level = compression_level;
+	opts.compression_threshold = compression_threshold;
+	opts.parallel_compression = true;
 	xdir_create(&writer->wal_dir, wal_dirname, XLOG, instance_uuid, &opts);
 	xlog_clear(&writer->current_wal);
-	if (wal_mode == WAL_FSYNC)
-		writer->wal_dir.open_wflags |= O_SYNC;
 
 	stailq_create(&writer->rollback);
 	writer->is_in_rollback = false;
+	wal_vclock_waiter_heap_create(&writer->vclock_waiters);
 
 	writer->checkpoint_wal_size = 0;
 	writer->checkpoint_threshold = INT64_MAX;
@@ -440,6 +842,48 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 	writer->on_garbage_collection = on_garbage_collection;
 	writer->on_checkpoint_threshold = on_checkpoint_threshold;
 
+	writer->group_commit_delay = 0;
+	writer->group_commit_max_size = 0;
+	writer->pending_batch = NULL;
+	writer->pending_len = 0;
+	writer->pending_deadline = 0;
+	writer->group_commit_is_useful = false;
+	writer->group_commit_fiber = NULL;
+	vclock_create(&writer->vclock_diff);
+	writer->last_committed = NULL;
+	stailq_create(&writer->sync_queue);
+	writer->sync_fiber = NULL;
+	writer->sync_in_progress = false;
+	fiber_cond_create(&writer->sync_cond);
+	writer->recycle_count = 0;
+	rlist_create(&writer->spares);
+	writer->spare_count = 0;
+	writer->spare_pending = 0;
+	writer->next_spare_id = 0;
+	writer->pending_rows = 0;
+	writer->pending_bytes = 0;
+	memset(&writer->stat, 0, sizeof(writer->stat));
+	static const int64_t batch_rows_buckets[] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048,
+		4096, 8192, 16384, 32768, 65536,
+	};
+	static const int64_t batch_bytes_buckets[] = {
+		128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768,
+		65536, 131072, 262144, 524288, 1048576, 2097152,
+		4194304, 8388608, 16777216,
+	};
+	writer->batch_rows_hist = histogram_new(batch_rows_buckets,
+						lengthof(batch_rows_buckets));
+	writer->batch_bytes_hist = histogram_new(batch_bytes_buckets,
+						 lengthof(batch_bytes_buckets));
+	if (writer->batch_rows_hist == NULL ||
+	    writer->batch_bytes_hist == NULL ||
+	    latency_create(&writer->write_latency) != 0 ||
+	    latency_create(&writer->sync_latency) != 0 ||
+	    latency_create(&writer->commit_latency) != 0)
+		panic("failed to allocate WAL statistics");
+	wal_tail_create(&writer->tail);
+
 	mempool_create(&writer->msg_pool, &cord()->slabc,
 		       sizeof(struct wal_msg));
 }
@@ -449,12 +893,22 @@ static void
 wal_writer_destroy(struct wal_writer *writer)
 {
 	xdir_destroy(&writer->wal_dir);
+	wal_tail_destroy(&writer->tail);
+	wal_vclock_waiter_heap_destroy(&writer->vclock_waiters);
+	histogram_delete(writer->batch_rows_hist);
+	histogram_delete(writer->batch_bytes_hist);
+	latency_destroy(&writer->write_latency);
+	latency_destroy(&writer->sync_latency);
+	latency_destroy(&writer->commit_latency);
 }
 
 /** WAL writer thread routine. */
 static int
 wal_writer_f(va_list ap);
 
+static void
+wal_spare_remove_leftovers(struct wal_writer *writer);
+
 static int
 wal_open_f(struct cbus_call_msg *msg)
 {
@@ -526,15 +980,18 @@ wal_open(struct wal_writer *writer)
 
 int
 wal_init(enum wal_mode wal_mode, void (*wall_async_cb)(struct journal_entry *entry),
-	 const char *wal_dirname, int64_t wal_max_size, const struct tt_uuid *instance_uuid,
+	 const char *wal_dirname, int64_t wal_max_size,
+	 int compression_level, size_t compression_threshold,
+	 const struct tt_uuid *instance_uuid,
 	 wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold)
 {
 	/* Initialize the state. */
 	struct wal_writer *writer = &wal_writer_singleton;
 	wal_writer_create(writer, wal_mode, wall_async_cb, wal_dirname,
-			  wal_max_size, instance_uuid, on_garbage_collection,
-			  on_checkpoint_threshold);
+			  wal_max_size, compression_level,
+			  compression_threshold, instance_uuid,
+			  on_garbage_collection, on_checkpoint_threshold);
 
 	/* Start WAL thread. */
 	if (cord_costart(&writer->cord, "wal", wal_writer_f, NULL) != 0)
@@ -553,6 +1010,7 @@ wal_enable(void)
 
 	/* Initialize the writer vclock from the recovery state. */
 	vclock_copy(&writer->vclock, &replicaset.vclock);
+	vclock_copy(&writer->tail.vclock, &writer->vclock);
 
 	/*
 	 * Scan the WAL directory to build an index of all
@@ -561,6 +1019,7 @@ wal_enable(void)
 	 */
 	if (xdir_scan(&writer->wal_dir))
 		return -1;
+	wal_spare_remove_leftovers(writer);
 
 	/* Open the most recent WAL file. */
 	if (wal_open(writer) != 0)
@@ -586,6 +1045,102 @@ wal_free(void)
 	wal_writer_destroy(writer);
 }
 
+struct wal_set_group_commit_msg {
+	struct cbus_call_msg base;
+	double delay;
+	int64_t max_size;
+};
+
+static int
+wal_set_group_commit_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_set_group_commit_msg *msg;
+	msg = (struct wal_set_group_commit_msg *)data;
+	writer->group_commit_delay = msg->delay;
+	writer->group_commit_max_size = msg->max_size;
+	/* Don't hold a batch longer than the new window. */
+	if (writer->pending_batch != NULL) {
+		if (msg->delay <= 0)
+			wal_flush_pending(writer);
+		else
+			fiber_wakeup(writer->group_commit_fiber);
+	}
+	return 0;
+}
+
+void
+wal_set_group_commit(double delay, int64_t max_size)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE)
+		return;
+	struct wal_set_group_commit_msg msg;
+	msg.delay = delay;
+	msg.max_size = max_size;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+		  &msg.base, wal_set_group_commit_f, NULL,
+		  TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
+static void
+wal_stat_dist_hist(struct wal_stat_dist *dist, struct histogram *hist)
+{
+	if (hist->total == 0) {
+		memset(dist, 0, sizeof(*dist));
+		return;
+	}
+	dist->p50 = histogram_percentile(hist, 50);
+	dist->p90 = histogram_percentile(hist, 90);
+	dist->p99 = histogram_percentile(hist, 99);
+}
+
+static void
+wal_stat_dist_latency(struct wal_stat_dist *dist, struct latency *latency)
+{
+	dist->p50 = latency_get(latency, 50);
+	dist->p90 = latency_get(latency, 90);
+	dist->p99 = latency_get(latency, 99);
+}
+
+struct wal_stat_msg {
+	struct cbus_call_msg base;
+	struct wal_stat stat;
+};
+
+static int
+wal_get_stat_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_stat_msg *msg = (struct wal_stat_msg *)data;
+	msg->stat = writer->stat;
+	wal_stat_dist_hist(&msg->stat.batch_rows, writer->batch_rows_hist);
+	wal_stat_dist_hist(&msg->stat.batch_bytes, writer->batch_bytes_hist);
+	wal_stat_dist_latency(&msg->stat.write_time, &writer->write_latency);
+	wal_stat_dist_latency(&msg->stat.sync_time, &writer->sync_latency);
+	wal_stat_dist_latency(&msg->stat.commit_time,
+			      &writer->commit_latency);
+	return 0;
+}
+
+void
+wal_get_stat(struct wal_stat *stat)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE) {
+		*stat = writer->stat;
+		return;
+	}
+	struct wal_stat_msg msg;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+		  &msg.base, wal_get_stat_f, NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+	*stat = msg.stat;
+}
+
 struct wal_vclock_msg {
     struct cbus_call_msg base;
     struct vclock vclock;
@@ -596,6 +1151,8 @@ wal_sync_f(struct cbus_call_msg *data)
 {
 	struct wal_vclock_msg *msg = (struct wal_vclock_msg *) data;
 	struct wal_writer *writer = &wal_writer_singleton;
+	wal_flush_pending(writer);
+	wal_sync_queue_wait(writer);
 	if (writer->is_in_rollback) {
 		/* We're rolling back a failed write. */
 		diag_set(ClientError, ER_WAL_IO);
@@ -605,6 +1162,49 @@ wal_sync_f(struct cbus_call_msg *data)
 	return 0;
 }
 
+/** Check if replicaset.vclock has reached the given vclock. */
+static bool
+wal_vclock_is_reached(const struct vclock *vclock)
+{
+	int cmp = vclock_compare_ignore0(vclock, &replicaset.vclock);
+	return cmp == 0 || cmp == -1;
+}
+
+int
+wal_wait_vclock(const struct vclock *vclock, double timeout)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	double deadline = ev_monotonic_now(loop()) + timeout;
+	struct wal_vclock_waiter waiter;
+	waiter.vclock = vclock;
+	waiter.signature = vclock_sum_ignore0(vclock);
+	waiter.fiber = fiber();
+	heap_node_create(&waiter.in_heap);
+	while (!wal_vclock_is_reached(vclock)) {
+		double now = ev_monotonic_now(loop());
+		if (now >= deadline) {
+			diag_set(TimedOut);
+			return -1;
+		}
+		if (wal_vclock_waiter_heap_insert(&writer->vclock_waiters,
+						  &waiter) != 0) {
+			diag_set(OutOfMemory, sizeof(struct heap_node *),
+				 "realloc", "vclock waiters");
+			return -1;
+		}
+		fiber_yield_timeout(deadline - now);
+		if (!heap_node_is_stray(&waiter.in_heap)) {
+			wal_vclock_waiter_heap_delete(&writer->vclock_waiters,
+						      &waiter);
+		}
+		if (fiber_is_cancelled()) {
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+	}
+	return 0;
+}
+
 int
 wal_sync(struct vclock *vclock)
 {
@@ -639,6 +1239,7 @@ wal_begin_checkpoint_f(struct cbus_call_msg *data)
 {
 	struct wal_checkpoint *msg = (struct wal_checkpoint *) data;
 	struct wal_writer *writer = &wal_writer_singleton;
+	wal_flush_pending(writer);
 	if (writer->is_in_rollback) {
 		/*
 		 * We're rolling back a failed write and so
@@ -655,6 +1256,7 @@ wal_begin_checkpoint_f(struct cbus_call_msg *data)
 	    vclock_sum(&writer->current_wal.meta.vclock) !=
 	    vclock_sum(&writer->vclock)) {
 
+		wal_sync_queue_wait(writer);
 		xlog_close(&writer->current_wal, false);
 		/*
 		 * The next WAL will be created on the first write.
@@ -762,6 +1364,230 @@ wal_set_checkpoint_threshold(int64_t threshold)
 	fiber_set_cancellable(cancellable);
 }
 
+struct wal_set_dict_msg {
+	struct cbus_call_msg base;
+	struct xlog_dict *dict;
+};
+
+static int
+wal_set_dict_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_set_dict_msg *msg = (struct wal_set_dict_msg *)data;
+	writer->wal_dir.opts.dict = msg->dict;
+	return 0;
+}
+
+void
+wal_set_dict(struct xlog_dict *dict)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE)
+		return;
+	struct wal_set_dict_msg msg;
+	msg.dict = dict;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+		  &msg.base, wal_set_dict_f, NULL, TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
+/**
+ * A spare WAL file. Instead of creating a new file on rotation
+ * and extending it step by step, which makes the file system
+ * journal metadata and allocate blocks while transactions wait,
+ * a file with disk space preallocated in a coio thread is renamed
+ * into place. Spare files are made of WAL files removed by garbage
+ * collection. If there are none, a new one is created for the next
+ * rotation.
+ */
+struct wal_spare {
+	/** Link in wal_writer::spares. */
+	struct rlist link;
+	/** Path of the spare file. */
+	char path[PATH_MAX];
+	/** Path of the WAL file to recycle or an empty string. */
+	char old_path[PATH_MAX];
+	/** Size of the disk space preallocated for the file. */
+	ssize_t size;
+	/** errno if the file couldn't be prepared. */
+	int error;
+};
+
+/** Suffix of spare WAL files, ignored by xdir_scan(). */
+static const char wal_spare_suffix[] = ".spare";
+
+static void
+wal_spare_prepare_f(eio_req *req)
+{
+	struct wal_spare *spare = (struct wal_spare *)req->data;
+	spare->size = xlog_make_spare(spare->old_path[0] != '\0' ?
+				      spare->old_path : NULL,
+				      spare->path, spare->size);
+	spare->error = errno;
+	req->result = spare->size < 0 ? -1 : 0;
+}
+
+static int
+wal_spare_complete(eio_req *req)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_spare *spare = (struct wal_spare *)req->data;
+	writer->spare_pending--;
+	if (req->result != 0) {
+		errno = spare->error;
+		say_syserror("failed to prepare spare WAL file %s",
+			     spare->path);
+		/* Don't leave garbage behind, see xlog_make_spare(). */
+		if (spare->old_path[0] != '\0')
+			unlink(spare->old_path);
+		free(spare);
+		return 0;
+	}
+	if (spare->old_path[0] != '\0')
+		say_info("recycled %s", spare->old_path);
+	if (writer->spare_count >= writer->recycle_count) {
+		/* The pool was shrunk while the file was prepared. */
+		unlink(spare->path);
+		free(spare);
+		return 0;
+	}
+	rlist_add_tail_entry(&writer->spares, spare, link);
+	writer->spare_count++;
+	return 0;
+}
+
+/**
+ * Start preparing a spare WAL file in a coio thread. If
+ * @a old_path isn't NULL, the WAL file at this path is recycled,
+ * otherwise a new file is created.
+ */
+static void
+wal_spare_prepare(struct wal_writer *writer, const char *old_path)
+{
+	struct wal_spare *spare = malloc(sizeof(*spare));
+	if (spare == NULL) {
+		say_error("failed to allocate spare WAL file");
+		if (old_path != NULL)
+			eio_unlink(old_path, 0, NULL, NULL);
+		return;
+	}
+	snprintf(spare->path, sizeof(spare->path), "%s/%lld%s",
+		 writer->wal_dir.dirname,
+		 (long long)writer->next_spare_id++, wal_spare_suffix);
+	snprintf(spare->old_path, sizeof(spare->old_path), "%s",
+		 old_path != NULL ? old_path : "");
+	spare->size = writer->wal_max_size;
+	spare->error = 0;
+	writer->spare_pending++;
+	eio_custom(wal_spare_prepare_f, EIO_PRI_DEFAULT,
+		   wal_spare_complete, spare);
+}
+
+/** Return true if there's room for another spare WAL file. */
+static inline bool
+wal_spare_is_needed(struct wal_writer *writer)
+{
+	return writer->spare_count + writer->spare_pending <
+	       writer->recycle_count;
+}
+
+/**
+ * Make sure there's a spare WAL file for the next rotation. The
+ * rest of the pool is filled by recycling WAL files removed by
+ * garbage collection, see wal_collect_garbage_f().
+ */
+static void
+wal_spare_keep_one(struct wal_writer *writer)
+{
+	if (writer->spare_count + writer->spare_pending == 0 &&
+	    wal_spare_is_needed(writer))
+		wal_spare_prepare(writer, NULL);
+}
+
+/**
+ * Take a ready spare WAL file. Returns NULL if there's none.
+ * The caller must free the returned object.
+ */
+static struct wal_spare *
+wal_spare_take(struct wal_writer *writer)
+{
+	if (rlist_empty(&writer->spares))
+		return NULL;
+	writer->spare_count--;
+	return rlist_shift_entry(&writer->spares, struct wal_spare, link);
+}
+
+/** Remove a ready spare WAL file. Returns false if there's none. */
+static bool
+wal_spare_drop(struct wal_writer *writer)
+{
+	struct wal_spare *spare = wal_spare_take(writer);
+	if (spare == NULL)
+		return false;
+	if (unlink(spare->path) != 0)
+		say_syserror("failed to remove %s", spare->path);
+	free(spare);
+	return true;
+}
+
+/**
+ * Remove spare WAL files left from the previous run: they may be
+ * half-prepared and their ids may clash with new ones.
+ */
+static void
+wal_spare_remove_leftovers(struct wal_writer *writer)
+{
+	const char *dirname = writer->wal_dir.dirname;
+	DIR *dh = opendir(dirname);
+	if (dh == NULL)
+		return;
+	struct dirent *dent;
+	while ((dent = readdir(dh)) != NULL) {
+		char *ext = strrchr(dent->d_name, '.');
+		if (ext == NULL || strcmp(ext, wal_spare_suffix) != 0)
+			continue;
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s", dirname, dent->d_name);
+		if (unlink(path) < 0)
+			say_syserror("error while removing %s", path);
+	}
+	closedir(dh);
+}
+
+struct wal_set_recycle_count_msg {
+	struct cbus_call_msg base;
+	int count;
+};
+
+static int
+wal_set_recycle_count_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_set_recycle_count_msg *msg;
+	msg = (struct wal_set_recycle_count_msg *)data;
+	writer->recycle_count = msg->count;
+	while (writer->spare_count > writer->recycle_count)
+		wal_spare_drop(writer);
+	wal_spare_keep_one(writer);
+	return 0;
+}
+
+void
+wal_set_recycle_count(int count)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE)
+		return;
+	struct wal_set_recycle_count_msg msg;
+	msg.count = count;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+		  &msg.base, wal_set_recycle_count_f, NULL,
+		  TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
 struct wal_gc_msg
 {
 	struct cbus_call_msg base;
@@ -789,10 +1615,24 @@ wal_collect_garbage_f(struct cbus_call_msg *data)
 		 */
 		vclock = vclockset_psearch(&writer->wal_dir.index, vclock);
 	}
-	if (vclock != NULL)
-		xdir_collect_garbage(&writer->wal_dir, vclock_sum(vclock),
-				     XDIR_GC_ASYNC);
-
+	if (vclock == NULL)
+		return 0;
+	/*
+	 * Turn the oldest files into spare ones while the pool
+	 * has room, remove the rest.
+	 */
+	int64_t signature = vclock_sum(vclock);
+	struct xdir *dir = &writer->wal_dir;
+	struct vclock *old;
+	while (wal_spare_is_needed(writer) &&
+	       (old = vclockset_first(&dir->index)) != NULL &&
+	       vclock_sum(old) < signature) {
+		wal_spare_prepare(writer, xdir_format_filename(
+				dir, vclock_sum(old), NONE));
+		vclockset_remove(&dir->index, old);
+		free(old);
+	}
+	xdir_collect_garbage(dir, signature, XDIR_GC_ASYNC);
 	return 0;
 }
 
@@ -823,6 +1663,70 @@ wal_notify_watchers(struct wal_writer *writer, unsigned events);
  * @post r->current_wal is in a good shape for writes or is NULL.
  * @return 0 in case of success, -1 on error.
  */
+/**
+ * A fiber of the WAL thread syncing the current WAL file in
+ * wal_mode = fsync. All the batches queued by the time a sync
+ * starts are sent back to tx when it completes, so a single
+ * sync covers all the batches written while the previous sync
+ * was in progress.
+ */
+static int
+wal_sync_queue_f(va_list ap)
+{
+	(void) ap;
+	struct wal_writer *writer = &wal_writer_singleton;
+	while (!fiber_is_cancelled()) {
+		if (stailq_empty(&writer->sync_queue)) {
+			fiber_cond_broadcast(&writer->sync_cond);
+			fiber_yield();
+			continue;
+		}
+		struct stailq batches;
+		stailq_create(&batches);
+		stailq_concat(&batches, &writer->sync_queue);
+		writer->sync_in_progress = true;
+		if (xlog_is_open(&writer->current_wal)) {
+			/*
+			 * The data is already in the file, so there's
+			 * no way to roll it back. Refuse to go on
+			 * without knowing what has been persisted.
+			 */
+			double start = clock_monotonic();
+			if (coio_fdatasync(writer->current_wal.fd) != 0)
+				panic_syserror("failed to sync WAL");
+			latency_collect(&writer->sync_latency,
+					clock_monotonic() - start);
+			writer->stat.syncs++;
+		}
+		writer->sync_in_progress = false;
+		double now = clock_monotonic();
+		struct cmsg *msg, *next;
+		stailq_foreach_entry_safe(msg, next, &batches, fifo) {
+			struct wal_msg *batch = (struct wal_msg *)msg;
+			if (!stailq_empty(&batch->commit)) {
+				latency_collect(&writer->commit_latency,
+						now - batch->start);
+			}
+			msg->hop++;
+			cpipe_push(&writer->tx_prio_pipe, msg);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Wait until all the batches written to the current WAL are
+ * synced and sent back to tx. Must be called before the file
+ * is closed and before reporting the WAL vclock as durable.
+ */
+static void
+wal_sync_queue_wait(struct wal_writer *writer)
+{
+	while (!stailq_empty(&writer->sync_queue) ||
+	       writer->sync_in_progress)
+		fiber_cond_wait(&writer->sync_cond);
+}
+
 static int
 wal_opt_rotate(struct wal_writer *writer)
 {
@@ -841,23 +1745,42 @@ wal_opt_rotate(struct wal_writer *writer)
 		 * failure in any reasonable way.
 		 * A warning is written to the error log.
 		 */
+		wal_sync_queue_wait(writer);
 		xlog_close(&writer->current_wal, false);
 	}
 
 	if (xlog_is_open(&writer->current_wal))
 		return 0;
 
-	if (xdir_create_xlog(&writer->wal_dir, &writer->current_wal,
-			     &writer->vclock) != 0) {
+	struct xlog *l = &writer->current_wal;
+	struct wal_spare *spare = wal_spare_take(writer);
+	int rc = -1;
+	if (spare != NULL) {
+		rc = xdir_recycle_xlog(&writer->wal_dir, l, &writer->vclock,
+				       spare->path);
+		if (rc == 0) {
+			/* Don't fallocate() what's preallocated. */
+			l->allocated = spare->size > l->offset ?
+				       spare->size - l->offset : 0;
+		} else {
+			diag_log();
+			unlink(spare->path);
+		}
+		free(spare);
+	}
+	if (rc != 0 &&
+	    xdir_create_xlog(&writer->wal_dir, l, &writer->vclock) != 0) {
 		diag_log();
 		return -1;
 	}
+	wal_spare_keep_one(writer);
 	/*
 	 * Keep track of the new WAL vclock. Required for garbage
 	 * collection, see wal_collect_garbage().
 	 */
 	xdir_add_vclock(&writer->wal_dir, &writer->vclock);
 
+	wal_tail_append_rotate(&writer->tail);
 	wal_notify_watchers(writer, WAL_EVENT_ROTATE);
 	return 0;
 }
@@ -903,6 +1826,9 @@ retry:
 	}
 	if (errno != ENOSPC)
 		goto error;
+	/* Spare files are the first to go. */
+	if (wal_spare_drop(writer))
+		goto retry;
 	if (!xdir_has_garbage(&writer->wal_dir, gc_lsn))
 		goto error;
 
@@ -1013,20 +1939,178 @@ wal_assign_lsn(struct vclock *vclock_diff, struct vclock *base,
 		(*row)->tsn = tsn;
 }
 
+/**
+ * Complete the current batch: apply the vclock changes of the
+ * rows which reached the disk, schedule rollback of the rest
+ * and send the batch back to tx.
+ */
 static void
-wal_write_to_disk(struct cmsg *msg)
+wal_batch_done(struct wal_writer *writer, struct wal_msg *batch)
 {
-	struct wal_writer *writer = &wal_writer_singleton;
-	struct wal_msg *wal_msg = (struct wal_msg *) msg;
-	struct error *error;
+	struct error *error = diag_last_error(diag_get());
+	if (error) {
+		/* Until we can pass the error to tx, log it and clear. */
+		error_log(error);
+		diag_clear(diag_get());
+	}
+	/*
+	 * Remember the vclock of the last successfully written row so
+	 * that we can update replicaset.vclock once this message gets
+	 * back to tx.
+	 */
+	vclock_copy(&batch->vclock, &writer->vclock);
+	/*
+	 * We need to start rollback from the first request
+	 * following the last committed request. If
+	 * last_commit_req is NULL, it means we have committed
+	 * nothing, and need to start rollback from the first
+	 * request. Otherwise we rollback from the first request.
+	 */
+	struct stailq rollback;
+	stailq_cut_tail(&batch->commit, writer->last_committed, &rollback);
+
+	if (!stailq_empty(&rollback)) {
+		struct journal_entry *entry;
+		/* Update status of the successfully committed requests. */
+		stailq_foreach_entry(entry, &rollback, fifo)
+			entry->res = -1;
+		/* Rollback unprocessed requests */
+		stailq_concat(&batch->rollback, &rollback);
+		wal_begin_rollback();
+	}
+	/* Make the written rows available to relays. */
+	struct journal_entry *entry;
+	stailq_foreach_entry(entry, &batch->commit, fifo)
+		wal_tail_append_entry(&writer->tail, entry);
+	if (writer->pending_batch == batch) {
+		writer->pending_batch = NULL;
+		fiber_wakeup(writer->group_commit_fiber);
+	}
+	writer->pending_len = 0;
+	writer->pending_rows = 0;
+	writer->pending_bytes = 0;
+	writer->last_committed = NULL;
+	vclock_create(&writer->vclock_diff);
+	wal_msg_complete(writer, batch);
+	fiber_gc();
+	wal_notify_watchers(writer, WAL_EVENT_WRITE);
+	ERROR_INJECT_SLEEP(ERRINJ_RELAY_FASTER_THAN_TX);
+}
+
+/**
+ * Flush the rows of the current batch buffered in the xlog
+ * and complete the batch.
+ */
+static void
+wal_batch_flush(struct wal_writer *writer, struct wal_msg *batch)
+{
+	struct xlog *l = &writer->current_wal;
+	double start = clock_monotonic();
+	ssize_t rc = xlog_flush(l);
+	if (rc < 0)
+		goto done;
+	latency_collect(&writer->write_latency, clock_monotonic() - start);
+
+	writer->checkpoint_wal_size += rc;
+	writer->last_committed = stailq_last(&batch->commit);
+	vclock_merge(&writer->vclock, &writer->vclock_diff);
+	writer->stat.writes++;
+	writer->stat.rows += writer->pending_rows;
+	writer->stat.bytes += rc;
+	histogram_collect(writer->batch_rows_hist, writer->pending_rows);
+	histogram_collect(writer->batch_bytes_hist,
+			  writer->pending_bytes + rc);
 
 	/*
-	 * Track all vclock changes made by this batch into
-	 * vclock_diff variable and then apply it into writers'
-	 * vclock after each xlog flush.
+	 * Notify TX if the checkpoint threshold has been exceeded.
+	 * Use malloc() for allocating the notification message and
+	 * don't panic on error, because if we fail to send the
+	 * message now, we will retry next time we process a request.
 	 */
-	struct vclock vclock_diff;
-	vclock_create(&vclock_diff);
+	if (!writer->checkpoint_triggered &&
+	    writer->checkpoint_wal_size > writer->checkpoint_threshold) {
+		static struct cmsg_hop route[] = {
+			{ tx_notify_checkpoint, NULL },
+		};
+		struct cmsg *msg = malloc(sizeof(*msg));
+		if (msg != NULL) {
+			cmsg_init(msg, route);
+			cpipe_push(&writer->tx_prio_pipe, msg);
+			writer->checkpoint_triggered = true;
+		} else {
+			say_warn("failed to allocate checkpoint "
+				 "notification message");
+		}
+	}
+done:
+	wal_batch_done(writer, batch);
+}
+
+/**
+ * Flush the batch held for group commit, if any. Must be
+ * called before anything which relies on all the rows sent
+ * to WAL being on disk.
+ */
+static void
+wal_flush_pending(struct wal_writer *writer)
+{
+	if (writer->pending_batch != NULL)
+		wal_batch_flush(writer, writer->pending_batch);
+}
+
+/**
+ * Return true if the current batch should be held in the WAL
+ * thread for a while to be flushed together with the batches
+ * following it.
+ */
+static bool
+wal_batch_should_wait(struct wal_writer *writer, struct wal_msg *batch)
+{
+	if (writer->group_commit_delay <= 0)
+		return false;
+	if ((int64_t)writer->pending_len >= writer->group_commit_max_size)
+		return false;
+	if (writer->pending_batch != NULL)
+		return true;
+	/*
+	 * Only open the window if there are concurrent writers,
+	 * otherwise a lone writer would pay the delay for nothing.
+	 */
+	return writer->group_commit_is_useful ||
+	       stailq_first(&batch->commit) != stailq_last(&batch->commit);
+}
+
+/**
+ * A fiber of the WAL thread flushing the batch held for group
+ * commit when its window expires.
+ */
+static int
+wal_group_commit_f(va_list ap)
+{
+	(void) ap;
+	struct wal_writer *writer = &wal_writer_singleton;
+	while (!fiber_is_cancelled()) {
+		if (writer->pending_batch == NULL) {
+			fiber_yield();
+			continue;
+		}
+		double timeout = writer->pending_deadline -
+				 ev_monotonic_now(loop());
+		if (timeout > 0) {
+			fiber_sleep(timeout);
+			continue;
+		}
+		writer->stat.timeouts++;
+		wal_batch_flush(writer, writer->pending_batch);
+	}
+	return 0;
+}
+
+static void
+wal_write_to_disk(struct cmsg *msg)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_msg *wal_msg = (struct wal_msg *) msg;
 
 	ERROR_INJECT_SLEEP(ERRINJ_WAL_DELAY);
 
@@ -1038,22 +2122,34 @@ wal_write_to_disk(struct cmsg *msg)
 
 	if (writer->is_in_rollback) {
 		/* We're rolling back a failed write. */
+		assert(writer->pending_batch == NULL);
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
 		vclock_copy(&wal_msg->vclock, &writer->vclock);
+		wal_msg_complete(writer, wal_msg);
 		return;
 	}
 
+	/* The held batch must be flushed before rotation. */
+	if (writer->pending_batch != NULL &&
+	    writer->current_wal.offset >= writer->wal_max_size)
+		wal_flush_pending(writer);
+
 	/* Xlog is only rotated between queue processing  */
 	if (wal_opt_rotate(writer) != 0) {
+		assert(writer->pending_batch == NULL);
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
 		vclock_copy(&wal_msg->vclock, &writer->vclock);
+		wal_msg_complete(writer, wal_msg);
 		return wal_begin_rollback();
 	}
 
 	/* Ensure there's enough disk space before writing anything. */
-	if (wal_fallocate(writer, wal_msg->approx_len) != 0) {
+	if (wal_fallocate(writer, writer->pending_len +
+				  wal_msg->approx_len) != 0) {
+		wal_flush_pending(writer);
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
 		vclock_copy(&wal_msg->vclock, &writer->vclock);
+		wal_msg_complete(writer, wal_msg);
 		return wal_begin_rollback();
 	}
 
@@ -1076,95 +2172,63 @@ wal_write_to_disk(struct cmsg *msg)
 	 * to file or isn't written at all, ftruncate(2) is used to shrink
 	 * the file to the last fully written request. The absolute position
 	 * of request in xlog file is stored inside `struct journal_entry`.
+	 *
+	 * With group commit enabled, the rows of a batch may be left in
+	 * the xlog buffer for a while, and the requests of the batches
+	 * arriving in the meantime are moved to the held batch, so that
+	 * all of them get to the disk with a single write and sync.
 	 */
+	struct wal_msg *batch = wal_msg;
+	struct stailq_entry *item = stailq_first(&wal_msg->commit);
+	writer->pending_len += wal_msg->approx_len;
+	if (writer->pending_batch != NULL) {
+		batch = writer->pending_batch;
+		stailq_concat(&batch->commit, &wal_msg->commit);
+		vclock_copy(&wal_msg->vclock, &writer->vclock);
+		wal_msg_complete(writer, wal_msg);
+		writer->group_commit_is_useful = true;
+		writer->stat.merged++;
+	}
 
 	struct xlog *l = &writer->current_wal;
 
 	/*
 	 * Iterate over requests (transactions)
 	 */
-	int rc;
-	struct journal_entry *entry;
-	struct stailq_entry *last_committed = NULL;
-	stailq_foreach_entry(entry, &wal_msg->commit, fifo) {
-		wal_assign_lsn(&vclock_diff, &writer->vclock,
+	for (; item != NULL; item = stailq_next(item)) {
+		struct journal_entry *entry =
+			stailq_entry(item, struct journal_entry, fifo);
+		wal_assign_lsn(&writer->vclock_diff, &writer->vclock,
 			       entry->rows, entry->rows + entry->n_rows);
-		entry->res = vclock_sum(&vclock_diff) +
+		entry->res = vclock_sum(&writer->vclock_diff) +
 			     vclock_sum(&writer->vclock);
-		rc = xlog_write_entry(l, entry);
+		ssize_t rc = xlog_write_entry(l, entry);
 		if (rc < 0)
-			goto done;
+			return wal_batch_done(writer, batch);
 		if (rc > 0) {
 			writer->checkpoint_wal_size += rc;
-			last_committed = &entry->fifo;
-			vclock_merge(&writer->vclock, &vclock_diff);
+			writer->last_committed = &entry->fifo;
+			vclock_merge(&writer->vclock, &writer->vclock_diff);
+			writer->stat.bytes += rc;
+			writer->pending_bytes += rc;
 		}
 		/* rc == 0: the write is buffered in xlog_tx */
+		writer->stat.entries++;
+		writer->pending_rows += entry->n_rows;
 	}
-	rc = xlog_flush(l);
-	if (rc < 0)
-		goto done;
-
-	writer->checkpoint_wal_size += rc;
-	last_committed = stailq_last(&wal_msg->commit);
-	vclock_merge(&writer->vclock, &vclock_diff);
 
-	/*
-	 * Notify TX if the checkpoint threshold has been exceeded.
-	 * Use malloc() for allocating the notification message and
-	 * don't panic on error, because if we fail to send the
-	 * message now, we will retry next time we process a request.
-	 */
-	if (!writer->checkpoint_triggered &&
-	    writer->checkpoint_wal_size > writer->checkpoint_threshold) {
-		static struct cmsg_hop route[] = {
-			{ tx_notify_checkpoint, NULL },
-		};
-		struct cmsg *msg = malloc(sizeof(*msg));
-		if (msg != NULL) {
-			cmsg_init(msg, route);
-			cpipe_push(&writer->tx_prio_pipe, msg);
-			writer->checkpoint_triggered = true;
-		} else {
-			say_warn("failed to allocate checkpoint "
-				 "notification message");
+	if (wal_batch_should_wait(writer, batch)) {
+		if (writer->pending_batch == NULL) {
+			writer->pending_batch = batch;
+			writer->pending_deadline = ev_monotonic_now(loop()) +
+						   writer->group_commit_delay;
+			writer->group_commit_is_useful = false;
+			writer->stat.delayed++;
+			fiber_wakeup(writer->group_commit_fiber);
 		}
+		return;
 	}
-
-done:
-	error = diag_last_error(diag_get());
-	if (error) {
-		/* Until we can pass the error to tx, log it and clear. */
-		error_log(error);
-		diag_clear(diag_get());
-	}
-	/*
-	 * Remember the vclock of the last successfully written row so
-	 * that we can update replicaset.vclock once this message gets
-	 * back to tx.
-	 */
-	vclock_copy(&wal_msg->vclock, &writer->vclock);
-	/*
-	 * We need to start rollback from the first request
-	 * following the last committed request. If
-	 * last_commit_req is NULL, it means we have committed
-	 * nothing, and need to start rollback from the first
-	 * request. Otherwise we rollback from the first request.
-	 */
-	struct stailq rollback;
-	stailq_cut_tail(&wal_msg->commit, last_committed, &rollback);
-
-	if (!stailq_empty(&rollback)) {
-		/* Update status of the successfully committed requests. */
-		stailq_foreach_entry(entry, &rollback, fifo)
-			entry->res = -1;
-		/* Rollback unprocessed requests */
-		stailq_concat(&wal_msg->rollback, &rollback);
-		wal_begin_rollback();
-	}
-	fiber_gc();
-	wal_notify_watchers(writer, WAL_EVENT_WRITE);
-	ERROR_INJECT_SLEEP(ERRINJ_RELAY_FASTER_THAN_TX);
+	wal_batch_flush(writer, batch);
 }
 
 /** WAL writer main loop.  */
@@ -1186,8 +2250,34 @@ wal_writer_f(va_list ap)
 	 */
 	cpipe_create(&writer->tx_prio_pipe, "tx_prio");
 
+	writer->group_commit_fiber = fiber_new("group_commit",
+					       wal_group_commit_f);
+	if (writer->group_commit_fiber == NULL)
+		panic("failed to start group commit fiber");
+	fiber_set_joinable(writer->group_commit_fiber, true);
+	fiber_start(writer->group_commit_fiber);
+
+	if (writer->wal_mode == WAL_FSYNC) {
+		writer->sync_fiber = fiber_new("wal_sync", wal_sync_queue_f);
+		if (writer->sync_fiber == NULL)
+			panic("failed to start WAL sync fiber");
+		fiber_set_joinable(writer->sync_fiber, true);
+		fiber_start(writer->sync_fiber);
+	}
+
 	cbus_loop(&endpoint);
 
+	wal_flush_pending(writer);
+	fiber_cancel(writer->group_commit_fiber);
+	fiber_join(writer->group_commit_fiber);
+	writer->group_commit_fiber = NULL;
+	if (writer->sync_fiber != NULL) {
+		wal_sync_queue_wait(writer);
+		fiber_cancel(writer->sync_fiber);
+		fiber_join(writer->sync_fiber);
+		writer->sync_fiber = NULL;
+	}
+
 	/*
 	 * Create a new empty WAL on shutdown so that we don't
 	 * have to rescan the last WAL to find the instance vclock.
@@ -1208,6 +2298,10 @@ wal_writer_f(va_list ap)
 	if (xlog_is_open(&writer->current_wal))
 		xlog_close(&writer->current_wal, false);
 
+	/* Don't keep the disk space until the next start. */
+	while (wal_spare_drop(writer))
+		;
+
 	if (xlog_is_open(&vy_log_writer.xlog))
 		xlog_close(&vy_log_writer.xlog, false);
 
@@ -1309,6 +2403,7 @@ wal_write_none_async(struct journal *journal,
 		       entry->rows + entry->n_rows);
 	vclock_merge(&writer->vclock, &vclock_diff);
 	vclock_copy(&replicaset.vclock, &writer->vclock);
+	tx_wake_vclock_waiters(writer);
 	entry->res = vclock_sum(&writer->vclock);
 	journal_async_complete(journal, entry);
 	return 0;
@@ -1508,6 +2603,80 @@ wal_notify_watchers(struct wal_writer *writer, unsigned events)
 		wal_watcher_notify(watcher, events);
 }
 
+void
+wal_set_tail_size(int64_t size)
+{
+	struct wal_tail *tail = &wal_writer_singleton.tail;
+	tt_pthread_mutex_lock(&tail->mutex);
+	tail->max_size = size;
+	/* Keep the last chunk, it's freed once a new one is needed. */
+	while (tail->size > tail->max_size &&
+	       stailq_first(&tail->chunks) != stailq_last(&tail->chunks))
+		wal_tail_drop_chunk(tail);
+	tt_pthread_mutex_unlock(&tail->mutex);
+}
+
+int
+wal_tail_read(int64_t *pos, const struct vclock *vclock, struct ibuf *buf)
+{
+	struct wal_tail *tail = &wal_writer_singleton.tail;
+	int rc = -1;
+	tt_pthread_mutex_lock(&tail->mutex);
+	int64_t begin = *pos;
+	if (begin < 0) {
+		/*
+		 * The reader must have got all the rows preceding
+		 * the tail. Local rows are never relayed so the
+		 * zero vclock component doesn't matter.
+		 */
+		if (vclock_compare_ignore0(&tail->vclock, vclock) > 0)
+			goto out;
+		begin = tail->begin;
+	} else if (begin < tail->begin) {
+		/* The rows have been dropped from memory. */
+		goto out;
+	}
+	assert(begin <= tail->end);
+	if (begin < tail->end) {
+		char *data = (char *)ibuf_alloc(buf, tail->end - begin);
+		if (data == NULL) {
+			diag_set(OutOfMemory, tail->end - begin, "ibuf_alloc",
+				 "WAL tail");
+			goto out;
+		}
+		struct wal_tail_chunk *chunk;
+		stailq_foreach_entry(chunk, &tail->chunks, in_tail) {
+			if (chunk->pos + (int64_t)chunk->used <= begin)
+				continue;
+			size_t offset = begin - chunk->pos;
+			size_t size = chunk->used - offset;
+			memcpy(data, chunk->data + offset, size);
+			data += size;
+			begin += size;
+		}
+		assert(begin == tail->end);
+	}
+	*pos = begin;
+	rc = 0;
+out:
+	tt_pthread_mutex_unlock(&tail->mutex);
+	return rc;
+}
+
+int
+wal_tail_next(const char **data, const char *data_end,
+	      struct xrow_header *row)
+{
+	assert(*data + sizeof(struct wal_tail_row) <= data_end);
+	(void)data_end;
+	const struct wal_tail_row *hdr = (const struct wal_tail_row *)*data;
+	const char *pos = *data + sizeof(*hdr);
+	*data += wal_tail_row_size(hdr->size);
+	if (hdr->replica_id == WAL_TAIL_ROTATE)
+		return 1;
+	return xrow_header_decode(row, &pos, pos + hdr->size, true);
+}
+
 
 /**
  * After fork, the WAL writer thread disappears.
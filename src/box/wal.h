@@ -40,6 +40,8 @@
 struct fiber;
 struct wal_writer;
 struct tt_uuid;
+struct ibuf;
+struct xrow_header;
 
 enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_MODE_MAX };
 
@@ -50,6 +52,11 @@ enum {
 	 * loop for the whole recovery stage.
 	 */
 	WAL_ROWS_PER_YIELD = 32000,
+	/**
+	 * Minimal size of WALs replayed on local recovery for
+	 * the replay rate to be measured.
+	 */
+	WAL_REPLAY_RATE_MIN_BYTES = 16 * 1024 * 1024,
 };
 
 /** String constants for the supported modes. */
@@ -82,7 +89,9 @@ typedef void (*wal_on_checkpoint_threshold_f)(void);
  */
 int
 wal_init(enum wal_mode wal_mode, void (*wall_async_cb)(struct journal_entry *entry),
-	 const char *wal_dirname, int64_t wal_max_size, const struct tt_uuid *instance_uuid,
+	 const char *wal_dirname, int64_t wal_max_size,
+	 int compression_level, size_t compression_threshold,
+	 const struct tt_uuid *instance_uuid,
 	 wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold);
 
@@ -173,12 +182,71 @@ void
 wal_clear_watcher(struct wal_watcher *watcher,
 		  void (*process_cb)(struct cbus_endpoint *));
 
+/**
+ * Set the max size of memory used for keeping the rows recently
+ * written to WAL for relays, see wal_tail_read(). Zero disables
+ * keeping the rows in memory.
+ */
+void
+wal_set_tail_size(int64_t size);
+
+/**
+ * Copy the rows recently written to WAL from memory.
+ *
+ * WAL keeps the most recently written rows in memory so that
+ * relays following WAL don't need to re-read them from disk.
+ * The function can be called from any thread.
+ *
+ * @param pos     Position of the reader in the in-memory WAL.
+ *                Must be set to -1 before the first call, in
+ *                which case the reader is positioned by
+ *                @a vclock. Advanced past the copied rows.
+ * @param vclock  Vclock of the rows received by the reader.
+ *                All rows stored in memory are copied to
+ *                a reader positioned by vclock, rows with LSN
+ *                less than or equal to the vclock must be
+ *                skipped by the reader.
+ * @param buf     Buffer to copy rows to. Use wal_tail_next()
+ *                to decode them.
+ *
+ * @retval  0 success, nothing is copied if there are no new rows.
+ * @retval -1 the rows following the reader position are not
+ *            in memory any more and must be read from disk.
+ */
+int
+wal_tail_read(int64_t *pos, const struct vclock *vclock, struct ibuf *buf);
+
+/**
+ * Decode a row copied with wal_tail_read() and advance
+ * @a data past it.
+ *
+ * @retval  0 success, the row is stored in @a row.
+ * @retval  1 the entry marks creation of a new WAL file.
+ * @retval -1 decode error.
+ */
+int
+wal_tail_next(const char **data, const char *data_end,
+	      struct xrow_header *row);
+
 void
 wal_atfork(void);
 
 enum wal_mode
 wal_mode(void);
 
+/**
+ * Wait until the replica set vclock reaches @a vclock, i.e.
+ * until all rows up to it, either received from other instances
+ * or written by this one, are written to the local WAL. The 0th
+ * (local) component is ignored. Allows a client to read its own
+ * writes made on the master from a replica.
+ *
+ * Returns 0 on success, -1 on timeout or if the fiber was
+ * cancelled.
+ */
+int
+wal_wait_vclock(const struct vclock *vclock, double timeout);
+
 /**
  * Wait until all submitted writes are successfully flushed
  * to disk. Returns 0 on success, -1 if write failed.
@@ -230,6 +298,83 @@ wal_commit_checkpoint(struct wal_checkpoint *checkpoint);
 void
 wal_set_checkpoint_threshold(int64_t threshold);
 
+/**
+ * Configure group commit: a batch of WAL requests may be held
+ * in the WAL thread for up to @a delay seconds, as long as its
+ * size is less than @a max_size bytes, so that the batches
+ * arriving in the meantime are written and synced together
+ * with it. Zero @a delay disables group commit.
+ */
+void
+wal_set_group_commit(double delay, int64_t max_size);
+
+/**
+ * Keep up to @a count spare WAL files with disk space
+ * preallocated for wal_max_size bytes, which are renamed into
+ * place on WAL rotation instead of creating new files. Spare
+ * files are made of WAL files removed by garbage collection.
+ * If there are none, a new spare file is created in the
+ * background. Zero disables recycling.
+ */
+void
+wal_set_recycle_count(int count);
+
+struct xlog_dict;
+
+/**
+ * Set the dictionary used for compression of WAL files or NULL.
+ * Takes effect on the next WAL file.
+ */
+void
+wal_set_dict(struct xlog_dict *dict);
+
+/** Distribution of a WAL writer statistic. */
+struct wal_stat_dist {
+	double p50;
+	double p90;
+	double p99;
+};
+
+/** WAL writer statistics. */
+struct wal_stat {
+	/** Number of writes (flushes) to the WAL. */
+	int64_t writes;
+	/** Number of written journal entries (transactions). */
+	int64_t entries;
+	/** Number of batches held to wait for more requests. */
+	int64_t delayed;
+	/** Number of batches merged into a held batch. */
+	int64_t merged;
+	/** Number of held batches flushed on window expiration. */
+	int64_t timeouts;
+	/** Number of WAL file syncs in wal_mode = fsync. */
+	int64_t syncs;
+	/** Number of rows written to the WAL. */
+	int64_t rows;
+	/** Number of bytes written to the WAL. */
+	int64_t bytes;
+	/** Number of journal entries rolled back. */
+	int64_t rollbacks;
+	/** Number of rows written by a single flush. */
+	struct wal_stat_dist batch_rows;
+	/** Number of bytes written by a single flush. */
+	struct wal_stat_dist batch_bytes;
+	/** Time of flushing a batch to the file, in seconds. */
+	struct wal_stat_dist write_time;
+	/** Time of syncing the file in wal_mode = fsync, in seconds. */
+	struct wal_stat_dist sync_time;
+	/**
+	 * Time since a batch is submitted to the WAL until it's
+	 * on disk (written, and synced in wal_mode = fsync) and
+	 * is about to be sent back to tx, in seconds.
+	 */
+	struct wal_stat_dist commit_time;
+};
+
+/** Get WAL writer statistics. */
+void
+wal_get_stat(struct wal_stat *stat);
+
 /**
  * Remove WAL files that are not needed by consumers reading
  * rows at @vclock or newer.
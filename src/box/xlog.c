@@ -32,6 +32,8 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "fiber.h"
 #include "exception.h"
@@ -47,6 +49,9 @@
 #include "iproto_constants.h"
 #include "errinj.h"
 #include "trivia/util.h"
+#include "tt_pthread.h"
+#include "salad/stailq.h"
+#include "zdict.h"
 
 /*
  * FALLOC_FL_KEEP_SIZE flag has existed since fallocate() was
@@ -81,13 +86,21 @@ enum {
 	 */
 	XLOG_TX_AUTOCOMMIT_THRESHOLD = 128 * 1024,
 	/**
+	 * Default for xlog_opts::compression_threshold.
 	 * Compress output buffer before dumping it to
 	 * disk if it is at least this big. On smaller
 	 * sizes compression takes up CPU but doesn't
 	 * yield seizable gains.
-	 * Maybe this should be a configuration option.
 	 */
 	XLOG_TX_COMPRESS_THRESHOLD = 2 * 1024,
+	/** Default for xlog_opts::compression_level. */
+	XLOG_TX_COMPRESS_LEVEL = 3,
+	/**
+	 * Min size of a part of a transaction block compressed
+	 * by a compression thread. Smaller parts would degrade
+	 * the compression ratio without speeding it up.
+	 */
+	XLOG_TX_COMPRESS_PART_MIN = 32 * 1024,
 };
 
 const struct xlog_opts xlog_opts_default = {
@@ -96,6 +109,9 @@ const struct xlog_opts xlog_opts_default = {
 	.free_cache = false,
 	.sync_is_async = false,
 	.no_compression = false,
+	.compression_level = XLOG_TX_COMPRESS_LEVEL,
+	.compression_threshold = XLOG_TX_COMPRESS_THRESHOLD,
+	.parallel_compression = false,
 };
 
 /* {{{ struct xlog_meta */
@@ -114,6 +130,8 @@ enum {
 #define VCLOCK_KEY "VClock"
 #define VERSION_KEY "Version"
 #define PREV_VCLOCK_KEY "PrevVClock"
+#define DICT_KEY "Dictionary"
+#define BASE_VCLOCK_KEY "BaseVClock"
 
 static const char v13[] = "0.13";
 static const char v12[] = "0.12";
@@ -134,6 +152,8 @@ xlog_meta_create(struct xlog_meta *meta, const char *filetype,
 		vclock_copy(&meta->prev_vclock, prev_vclock);
 	else
 		vclock_clear(&meta->prev_vclock);
+	vclock_clear(&meta->base_vclock);
+	meta->dict_id = 0;
 }
 
 /**
@@ -167,6 +187,14 @@ xlog_meta_format(const struct xlog_meta *meta, char *buf, int size)
 		SNPRINT(total, snprintf, buf, size, PREV_VCLOCK_KEY ": %s\n",
 			vclock_to_string(&meta->prev_vclock));
 	}
+	if (vclock_is_set(&meta->base_vclock)) {
+		SNPRINT(total, snprintf, buf, size, BASE_VCLOCK_KEY ": %s\n",
+			vclock_to_string(&meta->base_vclock));
+	}
+	if (meta->dict_id != 0) {
+		SNPRINT(total, snprintf, buf, size, DICT_KEY ": %u\n",
+			(unsigned)meta->dict_id);
+	}
 	SNPRINT(total, snprintf, buf, size, "\n");
 	assert(total > 0);
 	return total;
@@ -258,6 +286,7 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 
 	vclock_clear(&meta->vclock);
 	vclock_clear(&meta->prev_vclock);
+	vclock_clear(&meta->base_vclock);
 
 	/*
 	 * Parse "key: value" pairs
@@ -308,6 +337,23 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 			 */
 			if (parse_vclock(val, val_end, &meta->prev_vclock) != 0)
 				return -1;
+		} else if (xlog_meta_key_equal(key, key_end, BASE_VCLOCK_KEY)) {
+			/*
+			 * BaseVClock: <vclock>
+			 */
+			if (parse_vclock(val, val_end, &meta->base_vclock) != 0)
+				return -1;
+		} else if (xlog_meta_key_equal(key, key_end, DICT_KEY)) {
+			/*
+			 * Dictionary: <id>
+			 */
+			char *id_end;
+			unsigned long long id = strtoull(val, &id_end, 10);
+			if (id_end != val_end || id == 0 || id > UINT32_MAX) {
+				diag_set(XlogError, "can't parse dictionary id");
+				return -1;
+			}
+			meta->dict_id = id;
 		} else if (xlog_meta_key_equal(key, key_end, VERSION_KEY)) {
 			/* Ignore Version: for now */
 		} else {
@@ -324,6 +370,272 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 
 /* struct xlog }}} */
 
+/* {{{ Compression dictionaries */
+
+#define XLOG_DICT_SUFFIX ".zdict"
+
+/** Loaded dictionaries, linked by in_cache. */
+static RLIST_HEAD(xlog_dict_cache);
+/** Protects the dictionary cache. */
+static pthread_mutex_t xlog_dict_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Copy the directory part of @a path to @a buf. */
+static void
+xlog_dirname(const char *path, char *buf, size_t size)
+{
+	const char *sep = strrchr(path, '/');
+	if (sep == NULL)
+		snprintf(buf, size, ".");
+	else if (sep == path)
+		snprintf(buf, size, "/");
+	else
+		snprintf(buf, size, "%.*s", (int)(sep - path), path);
+}
+
+/** Look up a dictionary in the cache, the mutex must be held. */
+static struct xlog_dict *
+xlog_dict_find(uint32_t id)
+{
+	struct xlog_dict *dict;
+	rlist_foreach_entry(dict, &xlog_dict_cache, in_cache) {
+		if (dict->id == id)
+			return dict;
+	}
+	return NULL;
+}
+
+/** Read a dictionary file. */
+static struct xlog_dict *
+xlog_dict_read(const char *path, uint32_t id)
+{
+	struct xlog_dict *dict = NULL;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open '%s' file", path);
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		diag_set(SystemError, "failed to stat '%s' file", path);
+		goto out;
+	}
+	dict = (struct xlog_dict *)calloc(1, sizeof(*dict));
+	if (dict == NULL) {
+		diag_set(OutOfMemory, sizeof(*dict), "calloc",
+			 "struct xlog_dict");
+		goto out;
+	}
+	dict->id = id;
+	dict->size = st.st_size;
+	dict->data = malloc(dict->size);
+	if (dict->data == NULL) {
+		diag_set(OutOfMemory, dict->size, "malloc", "dictionary");
+		goto fail;
+	}
+	if (fio_read(fd, dict->data, dict->size) != (ssize_t)dict->size) {
+		diag_set(SystemError, "failed to read '%s' file", path);
+		goto fail;
+	}
+	if (ZSTD_getDictID_fromDict(dict->data, dict->size) != id) {
+		diag_set(XlogError, "%s: invalid dictionary", path);
+		goto fail;
+	}
+	dict->ddict = ZSTD_createDDict(dict->data, dict->size);
+	if (dict->ddict == NULL) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 "failed to create dictionary");
+		goto fail;
+	}
+out:
+	close(fd);
+	return dict;
+fail:
+	free(dict->data);
+	free(dict);
+	dict = NULL;
+	goto out;
+}
+
+struct xlog_dict *
+xlog_dict_load(const char *dirname, uint32_t id)
+{
+	tt_pthread_mutex_lock(&xlog_dict_mutex);
+	struct xlog_dict *dict = xlog_dict_find(id);
+	tt_pthread_mutex_unlock(&xlog_dict_mutex);
+	if (dict != NULL)
+		return dict;
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%u" XLOG_DICT_SUFFIX,
+		 dirname, (unsigned)id);
+	struct xlog_dict *new_dict = xlog_dict_read(path, id);
+	if (new_dict == NULL)
+		return NULL;
+
+	tt_pthread_mutex_lock(&xlog_dict_mutex);
+	/* The dictionary may have been loaded by another thread. */
+	dict = xlog_dict_find(id);
+	if (dict == NULL) {
+		dict = new_dict;
+		rlist_add_entry(&xlog_dict_cache, dict, in_cache);
+		new_dict = NULL;
+	}
+	tt_pthread_mutex_unlock(&xlog_dict_mutex);
+	if (new_dict != NULL) {
+		ZSTD_freeDDict(new_dict->ddict);
+		free(new_dict->data);
+		free(new_dict);
+	}
+	return dict;
+}
+
+/**
+ * Return the dictionary digested for compression at the given
+ * level, creating it on the first use.
+ *
+ * @retval NULL error, check diag
+ */
+static ZSTD_CDict *
+xlog_dict_cdict(struct xlog_dict *dict, int level)
+{
+	assert(level > 0 && level <= XLOG_DICT_LEVEL_MAX);
+	tt_pthread_mutex_lock(&xlog_dict_mutex);
+	ZSTD_CDict *cdict = dict->cdict[level];
+	if (cdict == NULL) {
+		cdict = ZSTD_createCDict(dict->data, dict->size, level);
+		dict->cdict[level] = cdict;
+	}
+	tt_pthread_mutex_unlock(&xlog_dict_mutex);
+	if (cdict == NULL) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 "failed to create dictionary");
+	}
+	return cdict;
+}
+
+/** Write a dictionary file to a directory. */
+static int
+xlog_dict_save(const char *dirname, uint32_t id,
+	       const void *data, size_t size)
+{
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%u" XLOG_DICT_SUFFIX,
+		 dirname, (unsigned)id);
+	snprintf(tmp_path, sizeof(tmp_path), "%s%s", path, inprogress_suffix);
+	int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to create file '%s'", tmp_path);
+		return -1;
+	}
+	if (fio_writen(fd, data, size) < 0 || fsync(fd) != 0) {
+		diag_set(SystemError, "failed to write file '%s'", tmp_path);
+		close(fd);
+		unlink(tmp_path);
+		return -1;
+	}
+	close(fd);
+	if (rename(tmp_path, path) != 0) {
+		diag_set(SystemError, "failed to rename file '%s'", tmp_path);
+		unlink(tmp_path);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Append encoded rows of a file to the training samples
+ * until their total size reaches @a samples_max.
+ */
+static int
+xlog_dict_read_samples(const char *path, struct ibuf *samples,
+		       struct ibuf *sizes, size_t samples_max)
+{
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, path) != 0)
+		return -1;
+	int rc = 0;
+	struct xrow_header row;
+	while (ibuf_used(samples) < samples_max &&
+	       (rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
+		struct iovec iov[XROW_IOVMAX];
+		int iovcnt = xrow_header_encode(&row, 0, iov, 0);
+		if (iovcnt < 0) {
+			rc = -1;
+			break;
+		}
+		size_t size = 0;
+		for (int i = 0; i < iovcnt; i++)
+			size += iov[i].iov_len;
+		char *buf = (char *)ibuf_alloc(samples, size);
+		size_t *size_ptr = (size_t *)ibuf_alloc(sizes, sizeof(size));
+		if (buf == NULL || size_ptr == NULL) {
+			diag_set(OutOfMemory, size, "ibuf_alloc", "samples");
+			rc = -1;
+			break;
+		}
+		for (int i = 0; i < iovcnt; i++)
+			buf = (char *)memcpy(buf, iov[i].iov_base,
+					     iov[i].iov_len) + iov[i].iov_len;
+		*size_ptr = size;
+		fiber_gc();
+	}
+	fiber_gc();
+	xlog_cursor_close(&cursor, false);
+	/* 1 means the end of the file. */
+	return rc < 0 ? -1 : 0;
+}
+
+int
+xlog_dict_train(const char **paths, int path_count, size_t size,
+		const char **dirnames, int dirname_count, uint32_t *id)
+{
+	int rc = -1;
+	size_t samples_max = 100 * size;
+	struct ibuf samples, sizes;
+	ibuf_create(&samples, &cord()->slabc, 1024 * 1024);
+	ibuf_create(&sizes, &cord()->slabc, 16 * 1024);
+	void *dict = malloc(size);
+	if (dict == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "dictionary");
+		goto out;
+	}
+	for (int i = 0; i < path_count; i++) {
+		if (ibuf_used(&samples) >= samples_max)
+			break;
+		if (xlog_dict_read_samples(paths[i], &samples, &sizes,
+					   samples_max) != 0)
+			goto out;
+	}
+	unsigned sample_count = ibuf_used(&sizes) / sizeof(size_t);
+	if (sample_count == 0) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 "no rows to train a dictionary on");
+		goto out;
+	}
+	size_t dict_size = ZDICT_trainFromBuffer(dict, size, samples.rpos,
+						 (const size_t *)sizes.rpos,
+						 sample_count);
+	if (ZDICT_isError(dict_size)) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 ZDICT_getErrorName(dict_size));
+		goto out;
+	}
+	*id = ZDICT_getDictID(dict, dict_size);
+	for (int i = 0; i < dirname_count; i++) {
+		if (xlog_dict_save(dirnames[i], *id, dict, dict_size) != 0)
+			goto out;
+	}
+	rc = 0;
+out:
+	free(dict);
+	ibuf_destroy(&sizes);
+	ibuf_destroy(&samples);
+	return rc;
+}
+
+/* }}} */
+
 /* {{{ struct xdir */
 
 void
@@ -386,23 +698,50 @@ xdir_destroy(struct xdir *dir)
 	vclockset_reset(&dir->index);
 }
 
-/**
- * Add a single log file to the index of all log files
- * in a given log directory.
- */
-static inline int
-xdir_index_file(struct xdir *dir, int64_t signature)
+int
+xdir_open_cursor(struct xdir *dir, int64_t signature,
+		 struct xlog_cursor *cursor)
 {
+	const char *filename = xdir_format_filename(dir, signature, NONE);
+	int rc = dir->use_mmap ? xlog_cursor_open_mmap(cursor, filename) :
+				 xlog_cursor_open(cursor, filename);
+	if (rc != 0)
+		return -1;
+	struct xlog_meta *meta = &cursor->meta;
+	if (strcmp(meta->filetype, dir->filetype) != 0) {
+		xlog_cursor_close(cursor, false);
+		diag_set(ClientError, ER_INVALID_XLOG_TYPE,
+			 dir->filetype, meta->filetype);
+		return -1;
+	}
+	if (!tt_uuid_is_nil(dir->instance_uuid) &&
+	    !tt_uuid_is_equal(dir->instance_uuid, &meta->instance_uuid)) {
+		xlog_cursor_close(cursor, false);
+		diag_set(XlogError, "%s: invalid instance UUID", filename);
+		return -1;
+	}
 	/*
-	 * Open xlog and parse vclock in its text header.
-	 * The vclock stores the state of the log at the
-	 * time it is created.
+	 * Check the match between log file name and contents:
+	 * the sum of vector clock coordinates must be the same
+	 * as the name of the file.
 	 */
-	struct xlog_cursor cursor;
-	if (xdir_open_cursor(dir, signature, &cursor) < 0)
+	int64_t signature_check = vclock_sum(&meta->vclock);
+	if (signature_check != signature) {
+		xlog_cursor_close(cursor, false);
+		diag_set(XlogError, "%s: signature check failed", filename);
 		return -1;
-	struct xlog_meta *meta = &cursor.meta;
+	}
+	return 0;
+}
 
+/**
+ * Append a vclock read from the header of log file @a filename
+ * to the index of all log files in a given log directory.
+ */
+static int
+xdir_index_vclock(struct xdir *dir, const struct vclock *file_vclock,
+		  const char *filename)
+{
 	/*
 	 * All log files in a directory must satisfy Lamport's
 	 * eventual order: events in each log file must be
@@ -411,10 +750,10 @@ xdir_index_file(struct xdir *dir, int64_t signature)
 	 * log1: {1, 1, 0, 1}, log2: {1, 2, 0, 2} -- good
 	 * log2: {1, 1, 0, 1}, log2: {2, 0, 2, 0} -- bad
 	 */
-	struct vclock *dup = vclockset_search(&dir->index, &meta->vclock);
+	struct vclock *dup = vclockset_search(&dir->index,
+					      (struct vclock *)file_vclock);
 	if (dup != NULL) {
-		diag_set(XlogError, "%s: invalid xlog order", cursor.name);
-		xlog_cursor_close(&cursor, false);
+		diag_set(XlogError, "%s: invalid xlog order", filename);
 		return -1;
 	}
 
@@ -425,57 +764,377 @@ xdir_index_file(struct xdir *dir, int64_t signature)
 	struct vclock *vclock = (struct vclock *) malloc(sizeof(*vclock));
 	if (vclock == NULL) {
 		diag_set(OutOfMemory, sizeof(*vclock), "malloc", "vclock");
-		xlog_cursor_close(&cursor, false);
 		return -1;
 	}
-
-	vclock_copy(vclock, &meta->vclock);
-	xlog_cursor_close(&cursor, false);
+	vclock_copy(vclock, file_vclock);
 	vclockset_insert(&dir->index, vclock);
 	return 0;
 }
 
-int
-xdir_open_cursor(struct xdir *dir, int64_t signature,
-		 struct xlog_cursor *cursor)
+/**
+ * Header of a log file stored in the directory cache, see
+ * xdir_scan().
+ */
+struct xdir_cache_entry {
+	/** Signature of the file, i.e. the sum of its vclock. */
+	int64_t signature;
+	/** Inode of the file, used to detect replaced files. */
+	uint64_t inode;
+	/** UUID of the instance which wrote the file. */
+	struct tt_uuid instance_uuid;
+	/** Vclock stored in the file header. */
+	struct vclock vclock;
+};
+
+/** Headers of all log files of a directory. */
+struct xdir_cache {
+	struct xdir_cache_entry *entries;
+	size_t count;
+	size_t capacity;
+};
+
+static void
+xdir_cache_create(struct xdir_cache *cache)
 {
-	const char *filename = xdir_format_filename(dir, signature, NONE);
-	int fd = open(filename, O_RDONLY);
-	if (fd < 0) {
-		diag_set(SystemError, "failed to open '%s' file", filename);
-		return -1;
+	memset(cache, 0, sizeof(*cache));
+}
+
+static void
+xdir_cache_destroy(struct xdir_cache *cache)
+{
+	free(cache->entries);
+}
+
+static int
+xdir_cache_add(struct xdir_cache *cache, const struct xdir_cache_entry *entry)
+{
+	if (cache->count == cache->capacity) {
+		size_t capacity = cache->capacity > 0 ?
+				  2 * cache->capacity : 16;
+		size_t size = capacity * sizeof(*cache->entries);
+		struct xdir_cache_entry *entries =
+			(struct xdir_cache_entry *)realloc(cache->entries,
+							   size);
+		if (entries == NULL) {
+			diag_set(OutOfMemory, size, "realloc",
+				 "xdir cache entries");
+			return -1;
+		}
+		cache->entries = entries;
+		cache->capacity = capacity;
 	}
-	if (xlog_cursor_openfd(cursor, fd, filename) < 0) {
-		close(fd);
-		return -1;
+	cache->entries[cache->count++] = *entry;
+	return 0;
+}
+
+static int
+xdir_cache_entry_cmp(const void *a, const void *b)
+{
+	int64_t sa = ((const struct xdir_cache_entry *)a)->signature;
+	int64_t sb = ((const struct xdir_cache_entry *)b)->signature;
+	return sa < sb ? -1 : sa > sb;
+}
+
+/** Path to the file storing the directory cache. */
+static const char *
+xdir_cache_filename(struct xdir *dir)
+{
+	/* E.g. "xlog.index", skip the dot of the extension. */
+	return tt_snprintf(PATH_MAX, "%s/%s.index", dir->dirname,
+			   dir->filename_ext + 1);
+}
+
+/**
+ * Load the directory cache written by xdir_cache_save().
+ * The cache is only a hint so a missing or malformed file
+ * yields an empty cache.
+ */
+static void
+xdir_cache_load(struct xdir *dir, struct xdir_cache *cache)
+{
+	const char *filename = xdir_cache_filename(dir);
+	FILE *f = fopen(filename, "r");
+	if (f == NULL)
+		return;
+	char line[2 * TT_STATIC_BUF_LEN];
+	if (fgets(line, sizeof(line), f) == NULL ||
+	    strcmp(line, tt_sprintf("%s INDEX\n", dir->filetype)) != 0)
+		goto invalid;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char *eol = strchr(line, '\n');
+		if (eol == NULL)
+			goto invalid;
+		*eol = '\0';
+		struct xdir_cache_entry entry;
+		long long signature;
+		unsigned long long inode;
+		char uuid[UUID_STR_LEN + 1];
+		int offset = 0;
+		if (sscanf(line, "%lld %llu %36s %n", &signature, &inode,
+			   uuid, &offset) != 3 || offset == 0)
+			goto invalid;
+		entry.signature = signature;
+		entry.inode = inode;
+		if (tt_uuid_from_string(uuid, &entry.instance_uuid) != 0 ||
+		    vclock_from_string(&entry.vclock, line + offset) != 0 ||
+		    vclock_sum(&entry.vclock) != entry.signature)
+			goto invalid;
+		if (xdir_cache_add(cache, &entry) != 0) {
+			diag_log();
+			goto invalid;
+		}
 	}
-	struct xlog_meta *meta = &cursor->meta;
-	if (strcmp(meta->filetype, dir->filetype) != 0) {
-		xlog_cursor_close(cursor, false);
-		diag_set(ClientError, ER_INVALID_XLOG_TYPE,
-			 dir->filetype, meta->filetype);
-		return -1;
+	fclose(f);
+	if (cache->count > 0)
+		qsort(cache->entries, cache->count, sizeof(*cache->entries),
+		      xdir_cache_entry_cmp);
+	return;
+invalid:
+	say_warn("ignoring malformed log directory cache `%s'", filename);
+	cache->count = 0;
+	fclose(f);
+}
+
+/**
+ * Atomically replace the directory cache. A failure to write
+ * the cache, e.g. because the directory is read-only, isn't an
+ * error: the next start will just read file headers again.
+ */
+static void
+xdir_cache_save(struct xdir *dir, const struct xdir_cache *cache)
+{
+	char filename[PATH_MAX];
+	char tmp_filename[PATH_MAX];
+	snprintf(filename, sizeof(filename), "%s", xdir_cache_filename(dir));
+	snprintf(tmp_filename, sizeof(tmp_filename), "%s.XXXXXX", filename);
+	int fd = mkstemp(tmp_filename);
+	if (fd < 0) {
+		say_verbose("failed to create `%s': %s", tmp_filename,
+			    strerror(errno));
+		return;
 	}
+	FILE *f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		goto fail;
+	}
+	fprintf(f, "%s INDEX\n", dir->filetype);
+	for (size_t i = 0; i < cache->count; i++) {
+		const struct xdir_cache_entry *entry = &cache->entries[i];
+		fprintf(f, "%lld %llu %s %s\n", (long long)entry->signature,
+			(unsigned long long)entry->inode,
+			tt_uuid_str(&entry->instance_uuid),
+			vclock_to_string(&entry->vclock));
+	}
+	if (fclose(f) != 0 || rename(tmp_filename, filename) != 0)
+		goto fail;
+	return;
+fail:
+	say_verbose("failed to write `%s': %s", filename, strerror(errno));
+	unlink(tmp_filename);
+}
+
+/**
+ * Look up the header of the log file with the given signature
+ * in the directory cache. The cached header is used only if the
+ * file wasn't replaced since it was cached and it passes the
+ * same checks as the header read by xdir_open_cursor().
+ */
+static const struct xdir_cache_entry *
+xdir_cache_lookup(struct xdir *dir, const struct xdir_cache *cache,
+		  int64_t signature)
+{
+	struct xdir_cache_entry key;
+	key.signature = signature;
+	const struct xdir_cache_entry *entry =
+		(const struct xdir_cache_entry *)bsearch(
+			&key, cache->entries, cache->count,
+			sizeof(*cache->entries), xdir_cache_entry_cmp);
+	if (entry == NULL)
+		return NULL;
+	struct stat st;
+	const char *filename = xdir_format_filename(dir, signature, NONE);
+	if (stat(filename, &st) != 0 || (uint64_t)st.st_ino != entry->inode)
+		return NULL;
 	if (!tt_uuid_is_nil(dir->instance_uuid) &&
-	    !tt_uuid_is_equal(dir->instance_uuid, &meta->instance_uuid)) {
-		xlog_cursor_close(cursor, false);
-		diag_set(XlogError, "%s: invalid instance UUID", filename);
-		return -1;
-	}
+	    !tt_uuid_is_equal(dir->instance_uuid, &entry->instance_uuid))
+		return NULL;
+	return entry;
+}
+
+/**
+ * Add a single log file to the index of all log files
+ * in a given log directory. The header of the file is
+ * returned in @a entry so that it can be cached.
+ */
+static inline int
+xdir_index_file(struct xdir *dir, int64_t signature,
+		struct xdir_cache_entry *entry)
+{
 	/*
-	 * Check the match between log file name and contents:
-	 * the sum of vector clock coordinates must be the same
-	 * as the name of the file.
+	 * Open xlog and parse vclock in its text header.
+	 * The vclock stores the state of the log at the
+	 * time it is created.
 	 */
-	int64_t signature_check = vclock_sum(&meta->vclock);
-	if (signature_check != signature) {
-		xlog_cursor_close(cursor, false);
-		diag_set(XlogError, "%s: signature check failed", filename);
+	struct xlog_cursor cursor;
+	if (xdir_open_cursor(dir, signature, &cursor) < 0)
+		return -1;
+	struct xlog_meta *meta = &cursor.meta;
+	if (xdir_index_vclock(dir, &meta->vclock, cursor.name) != 0) {
+		xlog_cursor_close(&cursor, false);
 		return -1;
 	}
+	struct stat st;
+	entry->signature = signature;
+	entry->inode = stat(cursor.name, &st) == 0 ? st.st_ino : 0;
+	entry->instance_uuid = meta->instance_uuid;
+	vclock_copy(&entry->vclock, &meta->vclock);
+	xlog_cursor_close(&cursor, false);
 	return 0;
 }
 
+enum {
+	/**
+	 * Min number of log file headers that have to be read
+	 * by xdir_scan() to read them in parallel.
+	 */
+	XDIR_PREFETCH_MIN = 32,
+	/** Max number of threads reading headers in parallel. */
+	XDIR_PREFETCH_THREADS = 8,
+	/** Size of the file head read in advance. */
+	XDIR_PREFETCH_SIZE = 4096,
+};
+
+/** A thread reading heads of every step-th file in advance. */
+struct xdir_prefetch {
+	struct cord cord;
+	struct xdir *dir;
+	const int64_t *signatures;
+	size_t first;
+	size_t count;
+	size_t step;
+};
+
+static void *
+xdir_prefetch_f(void *arg)
+{
+	struct xdir_prefetch *prefetch = (struct xdir_prefetch *)arg;
+	char buf[XDIR_PREFETCH_SIZE];
+	for (size_t i = prefetch->first; i < prefetch->count;
+	     i += prefetch->step) {
+		const char *filename = xdir_format_filename(
+			prefetch->dir, prefetch->signatures[i], NONE);
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			continue;
+		/* Errors are reported when the file is indexed. */
+		if (pread(fd, buf, sizeof(buf), 0) < 0)
+			say_syserror("failed to read `%s'", filename);
+		close(fd);
+	}
+	return NULL;
+}
+
+/**
+ * Load heads of the given log files to the page cache using
+ * several threads. Opening a log file is dominated by the disk
+ * latency so when there are many of them, reading them one by
+ * one is much slower than keeping several requests in flight.
+ * The headers are parsed by the caller afterwards.
+ */
+static void
+xdir_prefetch(struct xdir *dir, const int64_t *signatures, size_t count)
+{
+	struct xdir_prefetch threads[XDIR_PREFETCH_THREADS];
+	size_t thread_count = MIN(count / (XDIR_PREFETCH_MIN / 4),
+				  (size_t)XDIR_PREFETCH_THREADS);
+	size_t started = 0;
+	for (size_t i = 0; i < thread_count; i++) {
+		struct xdir_prefetch *prefetch = &threads[started];
+		prefetch->dir = dir;
+		prefetch->signatures = signatures;
+		prefetch->first = i;
+		prefetch->count = count;
+		prefetch->step = thread_count;
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "xdir.prefetch.%zu", i);
+		if (cord_start(&prefetch->cord, name, xdir_prefetch_f,
+			       prefetch) != 0) {
+			/* Not critical, the headers are read anyway. */
+			diag_log();
+			break;
+		}
+		started++;
+	}
+	for (size_t i = 0; i < started; i++) {
+		if (cord_join(&threads[i].cord) != 0)
+			panic_syserror("xdir prefetch thread join failed");
+	}
+}
+
+/**
+ * Add new log files to the directory index. If @a use_cache is
+ * set, headers found in the directory cache aren't read and the
+ * cache is updated afterwards. Headers of other files are read
+ * in parallel if there are many of them.
+ *
+ * The signatures array is used as scratch space.
+ */
+static int
+xdir_index_files(struct xdir *dir, int64_t *signatures, size_t count,
+		 bool use_cache)
+{
+	int rc = -1;
+	struct xdir_cache old_cache, new_cache;
+	xdir_cache_create(&old_cache);
+	xdir_cache_create(&new_cache);
+	if (use_cache)
+		xdir_cache_load(dir, &old_cache);
+	size_t miss_count = 0;
+	for (size_t i = 0; i < count; i++) {
+		const struct xdir_cache_entry *entry = NULL;
+		if (use_cache)
+			entry = xdir_cache_lookup(dir, &old_cache,
+						  signatures[i]);
+		if (entry == NULL) {
+			signatures[miss_count++] = signatures[i];
+			continue;
+		}
+		const char *filename = xdir_format_filename(
+			dir, entry->signature, NONE);
+		if (xdir_index_vclock(dir, &entry->vclock, filename) != 0 ||
+		    xdir_cache_add(&new_cache, entry) != 0)
+			goto out;
+	}
+	if (miss_count >= XDIR_PREFETCH_MIN)
+		xdir_prefetch(dir, signatures, miss_count);
+	for (size_t i = 0; i < miss_count; i++) {
+		struct xdir_cache_entry entry;
+		if (xdir_index_file(dir, signatures[i], &entry) != 0) {
+			/*
+			 * force_recovery must not affect OOM
+			 */
+			struct error *e = diag_last_error(&fiber()->diag);
+			if (!dir->force_recovery ||
+			    type_assignable(&type_OutOfMemory, e->type))
+				goto out;
+			/** Skip a corrupted file */
+			error_log(e);
+			continue;
+		}
+		if (use_cache && xdir_cache_add(&new_cache, &entry) != 0)
+			goto out;
+	}
+	if (use_cache && (miss_count > 0 ||
+			  new_cache.count != old_cache.count))
+		xdir_cache_save(dir, &new_cache);
+	rc = 0;
+out:
+	xdir_cache_destroy(&new_cache);
+	xdir_cache_destroy(&old_cache);
+	return rc;
+}
+
 /**
  * Scan (or rescan) a directory with snapshot or write ahead logs.
  * Read all files matching a pattern from the directory -
@@ -493,6 +1152,11 @@ xdir_open_cursor(struct xdir *dir, int64_t signature,
  * recovery_follow_local(), which periodically rescan the
  * directory to discover newly created logs.
  *
+ * To speed up startup with many log files, the initial scan
+ * takes headers of files which weren't replaced since the last
+ * scan from the directory cache file (e.g. xlog.index) and
+ * reads the rest of them in parallel, see xdir_index_files().
+ *
  * On error, this function throws an exception. If
  * dir->force_recovery is true, *some* errors are not
  * propagated up but only logged in the error log file.
@@ -586,6 +1250,13 @@ xdir_scan(struct xdir *dir)
 	 * appeared since the last scan.
 	 */
 	vclock = vclockset_first(&dir->index);
+	/*
+	 * The directory cache is only consulted on the initial
+	 * scan, which is done on startup. Rescans done by hot
+	 * standby and relays only add a few new files.
+	 */
+	bool use_cache = vclock == NULL;
+	size_t new_count = 0;
 	for (unsigned i = 0; i < s_count || vclock != NULL;) {
 		int64_t s_old = vclock ? vclock_sum(vclock) : LLONG_MAX;
 		int64_t s_new = i < s_count ? signatures[i] : LLONG_MAX;
@@ -597,18 +1268,12 @@ xdir_scan(struct xdir *dir)
 			free(vclock);
 			vclock = next;
 		} else if (s_old > s_new) {
-			/** Add a new file. */
-			if (xdir_index_file(dir, s_new) != 0) {
-				/*
-				 * force_recovery must not affect OOM
-				 */
-				struct error *e = diag_last_error(&fiber()->diag);
-				if (!dir->force_recovery ||
-				    type_assignable(&type_OutOfMemory, e->type))
-					goto exit;
-				/** Skip a corrupted file */
-				error_log(e);
-			}
+			/*
+			 * Remember a new file, it is indexed below.
+			 * It's safe to reuse the signatures array,
+			 * because new_count <= i.
+			 */
+			signatures[new_count++] = s_new;
 			i++;
 		} else {
 			assert(s_old == s_new && i < s_count &&
@@ -617,6 +1282,8 @@ xdir_scan(struct xdir *dir)
 			i++;
 		}
 	}
+	if (xdir_index_files(dir, signatures, new_count, use_cache) != 0)
+		goto exit;
 	rc = 0;
 
 exit:
@@ -792,9 +1459,15 @@ xlog_destroy(struct xlog *xlog)
 	xlog->fd = -1;
 }
 
-int
-xlog_create(struct xlog *xlog, const char *name, int flags,
-	    const struct xlog_meta *meta, const struct xlog_opts *opts)
+/**
+ * Create a new xlog file, see xlog_create(). If @a spare isn't
+ * NULL, the file at this path is renamed into place instead of
+ * creating a new one, see xlog_make_spare().
+ */
+static int
+xlog_create_impl(struct xlog *xlog, const char *name, int flags,
+		 const struct xlog_meta *meta, const struct xlog_opts *opts,
+		 const char *spare)
 {
 	char meta_buf[XLOG_META_LEN_MAX];
 	int meta_len;
@@ -813,6 +1486,8 @@ xlog_create(struct xlog *xlog, const char *name, int flags,
 		goto err;
 
 	xlog->meta = *meta;
+	if (opts->dict != NULL)
+		xlog->meta.dict_id = opts->dict->id;
 	xlog->is_inprogress = true;
 	snprintf(xlog->filename, sizeof(xlog->filename), "%s%s", name, inprogress_suffix);
 
@@ -823,7 +1498,15 @@ xlog_create(struct xlog *xlog, const char *name, int flags,
 		goto err;
 	}
 
-	flags |= O_RDWR | O_CREAT | O_EXCL;
+	if (spare != NULL) {
+		if (rename(spare, xlog->filename) != 0) {
+			diag_set(SystemError, "failed to rename '%s'", spare);
+			goto err_open;
+		}
+		flags |= O_RDWR;
+	} else {
+		flags |= O_RDWR | O_CREAT | O_EXCL;
+	}
 
 	/*
 	 * Open the <lsn>.<suffix>.inprogress file.
@@ -868,6 +1551,50 @@ err:
 	return -1;
 }
 
+int
+xlog_create(struct xlog *xlog, const char *name, int flags,
+	    const struct xlog_meta *meta, const struct xlog_opts *opts)
+{
+	return xlog_create_impl(xlog, name, flags, meta, opts, NULL);
+}
+
+ssize_t
+xlog_make_spare(const char *old_path, const char *path, size_t size)
+{
+	if (old_path != NULL && rename(old_path, path) != 0)
+		return -1;
+	int fd = open(path, O_WRONLY | O_CREAT, 0644);
+	if (fd < 0)
+		return -1;
+	/*
+	 * Drop the old content, but keep the file size zero
+	 * rather than fill the file with zeros: xlog_cursor
+	 * assumes that everything written before EOF is valid
+	 * data, see xlog_fallocate().
+	 */
+	if (ftruncate(fd, 0) != 0)
+		goto error;
+#ifdef HAVE_FALLOCATE
+	if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) != 0) {
+		if (errno != ENOSYS && errno != EOPNOTSUPP)
+			goto error;
+		size = 0;
+	}
+#else
+	size = 0;
+#endif /* HAVE_FALLOCATE */
+	if (fsync(fd) != 0)
+		goto error;
+	close(fd);
+	return size;
+error:
+	close(fd);
+	int save_errno = errno;
+	unlink(path);
+	errno = save_errno;
+	return -1;
+}
+
 int
 xlog_open(struct xlog *xlog, const char *name, const struct xlog_opts *opts)
 {
@@ -905,6 +1632,16 @@ xlog_open(struct xlog *xlog, const char *name, const struct xlog_opts *opts)
 		goto err_read;
 	}
 
+	/* Appended blocks must use the dictionary of the file. */
+	xlog->opts.dict = NULL;
+	if (xlog->meta.dict_id != 0) {
+		char dirname[PATH_MAX];
+		xlog_dirname(xlog->filename, dirname, sizeof(dirname));
+		xlog->opts.dict = xlog_dict_load(dirname, xlog->meta.dict_id);
+		if (xlog->opts.dict == NULL)
+			goto err_read;
+	}
+
 	/* Check if the file has EOF marker. */
 	xlog->offset = fio_lseek(xlog->fd, -(off_t)sizeof(magic), SEEK_END);
 	if (xlog->offset < 0)
@@ -964,9 +1701,14 @@ xdir_touch_xlog(struct xdir *dir, const struct vclock *vclock)
  * In case of error, writes a message to the error log
  * and sets errno.
  */
-int
-xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
-		 const struct vclock *vclock)
+/**
+ * Create a new file in a directory, see xdir_create_xlog().
+ * If @a base_vclock isn't NULL, the file is a delta snapshot.
+ */
+static int
+xdir_create_xlog_impl(struct xdir *dir, struct xlog *xlog,
+		      const struct vclock *vclock,
+		      const struct vclock *base_vclock, const char *spare)
 {
 	int64_t signature = vclock_sum(vclock);
 	assert(signature >= 0);
@@ -983,10 +1725,14 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	struct xlog_meta meta;
 	xlog_meta_create(&meta, dir->filetype, dir->instance_uuid,
 			 vclock, prev_vclock);
+	if (base_vclock != NULL) {
+		assert(dir->type == SNAP);
+		vclock_copy(&meta.base_vclock, base_vclock);
+	}
 
 	const char *filename = xdir_format_filename(dir, signature, NONE);
-	if (xlog_create(xlog, filename, dir->open_wflags, &meta,
-			&dir->opts) != 0)
+	if (xlog_create_impl(xlog, filename, dir->open_wflags, &meta,
+			     &dir->opts, spare) != 0)
 		return -1;
 
 	/* Rename xlog file */
@@ -1000,6 +1746,28 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	return 0;
 }
 
+int
+xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
+		 const struct vclock *vclock)
+{
+	return xdir_create_xlog_impl(dir, xlog, vclock, NULL, NULL);
+}
+
+int
+xdir_recycle_xlog(struct xdir *dir, struct xlog *xlog,
+		  const struct vclock *vclock, const char *spare)
+{
+	return xdir_create_xlog_impl(dir, xlog, vclock, NULL, spare);
+}
+
+int
+xdir_create_delta_xlog(struct xdir *dir, struct xlog *xlog,
+		       const struct vclock *vclock,
+		       const struct vclock *base_vclock)
+{
+	return xdir_create_xlog_impl(dir, xlog, vclock, base_vclock, NULL);
+}
+
 ssize_t
 xlog_fallocate(struct xlog *log, size_t len)
 {
@@ -1036,31 +1804,29 @@ xlog_fallocate(struct xlog *log, size_t len)
 }
 
 /**
- * Write a sequence of uncompressed xrow objects.
- *
- * @retval -1 error
- * @retval >= 0 the number of bytes written
+ * Fill in the fixheader of a sequence of uncompressed xrow
+ * objects accumulated in @a obuf.
  */
-static off_t
-xlog_tx_write_plain(struct xlog *log)
+static void
+xlog_tx_encode_plain(struct obuf *obuf)
 {
 	/**
 	 * We created an obuf savepoint at start of xlog_tx,
 	 * now populate it with data.
 	 */
-	char *fixheader = (char *)log->obuf.iov[0].iov_base;
+	char *fixheader = (char *)obuf->iov[0].iov_base;
 	*(log_magic_t *)fixheader = row_marker;
 	char *data = fixheader + sizeof(log_magic_t);
 
 	data = mp_encode_uint(data,
-			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE);
+			      obuf_size(obuf) - XLOG_FIXHEADER_SIZE);
 	/* Encode crc32 for previous row */
 	data = mp_encode_uint(data, 0);
 	/* Encode crc32 for current row */
 	uint32_t crc32c = 0;
 	struct iovec *iov;
 	size_t offset = XLOG_FIXHEADER_SIZE;
-	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
+	for (iov = obuf->iov; iov->iov_len; ++iov) {
 		crc32c = crc32_calc(crc32c,
 				    (char *)iov->iov_base + offset,
 				    iov->iov_len - offset);
@@ -1079,46 +1845,353 @@ xlog_tx_write_plain(struct xlog *log)
 			data += padding - 1;
 		}
 	}
+}
 
-	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
-		diag_set(ClientError, ER_INJECTION, "xlog write injection");
+/**
+ * Fill in the fixheader of a compressed block of the given
+ * length and checksum.
+ */
+static void
+xlog_tx_encode_zfixheader(char *fixheader, size_t len, uint32_t crc32c)
+{
+	*(log_magic_t *)fixheader = zrow_marker;
+	char *data;
+	data = fixheader + sizeof(log_magic_t);
+	data = mp_encode_uint(data, len);
+	/* Encode crc32 for previous row */
+	data = mp_encode_uint(data, 0);
+	/* Encode crc32 for current row */
+	data = mp_encode_uint(data, crc32c);
+	/* Encode padding */
+	ssize_t padding;
+	padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
+	if (padding > 0) {
+		data = mp_encode_strl(data, padding - 1);
+		if (padding > 1) {
+			memset(data, 0, padding - 1);
+			data += padding - 1;
+		}
+	}
+}
+
+/* {{{ Compression threads */
+
+struct xlog_zbatch;
+
+/**
+ * A part of a transaction block compressed into a separate
+ * zstd frame. A reader decompresses concatenated frames as
+ * a single stream, so the parts of a block can be compressed
+ * independently of each other.
+ */
+struct xlog_zjob {
+	/** Link in xlog_zpool::queue. */
+	struct stailq_entry in_queue;
+	/** The block this part belongs to. */
+	struct xlog_zbatch *batch;
+	/** Data to compress. */
+	struct iovec src[SMALL_OBUF_IOV_MAX + 1];
+	/** Number of entries in src. */
+	int src_count;
+	/** Compressed data, malloc'ed. */
+	char *dst;
+	/** Size of compressed data. */
+	size_t dst_size;
+	/** Error message or NULL on success. */
+	const char *error;
+};
+
+/** A transaction block split into parts. */
+struct xlog_zbatch {
+	/** Compression level. */
+	int level;
+	/** Compression dictionary or NULL. */
+	const ZSTD_CDict *cdict;
+	/** Number of parts not compressed yet. */
+	int pending;
+};
+
+/**
+ * Threads compressing parts of big transaction blocks of
+ * xlogs with xlog_opts::parallel_compression set. The thread
+ * writing a block compresses one of its parts itself and
+ * waits for the rest.
+ */
+static struct xlog_zpool {
+	/** Protects the queue and the pending part counters. */
+	pthread_mutex_t mutex;
+	/** Signalled when a part is queued or on stop. */
+	pthread_cond_t queue_cond;
+	/** Signalled when a part is compressed. */
+	pthread_cond_t done_cond;
+	/** Parts waiting for a thread, linked by in_queue. */
+	struct stailq queue;
+	/** Compression threads. */
+	struct cord *threads;
+	/** Number of started threads. */
+	int thread_count;
+	/** Set when the threads are told to exit. */
+	bool is_stopping;
+} xlog_zpool;
+
+/**
+ * Compress a part of a transaction block into a separate
+ * zstd frame using the given compression context.
+ */
+static void
+xlog_zjob_run(struct xlog_zjob *job, ZSTD_CCtx *zctx)
+{
+	if (zctx == NULL) {
+		job->error = "failed to create context";
+		return;
+	}
+	size_t size = 0;
+	for (int i = 0; i < job->src_count; i++)
+		size += job->src[i].iov_len;
+	size_t capacity = ZSTD_compressBound(size);
+	job->dst = (char *)malloc(capacity);
+	if (job->dst == NULL) {
+		job->error = "failed to allocate compression buffer";
+		return;
+	}
+	job->dst_size = 0;
+	size_t zsize;
+	if (job->batch->cdict != NULL)
+		zsize = ZSTD_compressBegin_usingCDict(zctx, job->batch->cdict);
+	else
+		zsize = ZSTD_compressBegin(zctx, job->batch->level);
+	for (int i = 0; i < job->src_count && !ZSTD_isError(zsize); i++) {
+		struct iovec *iov = &job->src[i];
+		if (i == job->src_count - 1) {
+			zsize = ZSTD_compressEnd(zctx, job->dst + job->dst_size,
+						 capacity - job->dst_size,
+						 iov->iov_base, iov->iov_len);
+		} else {
+			zsize = ZSTD_compressContinue(zctx,
+						job->dst + job->dst_size,
+						capacity - job->dst_size,
+						iov->iov_base, iov->iov_len);
+		}
+		if (!ZSTD_isError(zsize))
+			job->dst_size += zsize;
+	}
+	if (ZSTD_isError(zsize))
+		job->error = ZSTD_getErrorName(zsize);
+}
+
+static void *
+xlog_zpool_f(void *arg)
+{
+	(void)arg;
+	struct xlog_zpool *pool = &xlog_zpool;
+	ZSTD_CCtx *zctx = ZSTD_createCCtx();
+	tt_pthread_mutex_lock(&pool->mutex);
+	while (true) {
+		while (stailq_empty(&pool->queue) && !pool->is_stopping)
+			tt_pthread_cond_wait(&pool->queue_cond, &pool->mutex);
+		if (stailq_empty(&pool->queue))
+			break;
+		struct xlog_zjob *job = stailq_shift_entry(&pool->queue,
+							   struct xlog_zjob,
+							   in_queue);
+		tt_pthread_mutex_unlock(&pool->mutex);
+		xlog_zjob_run(job, zctx);
+		tt_pthread_mutex_lock(&pool->mutex);
+		job->batch->pending--;
+		tt_pthread_cond_broadcast(&pool->done_cond);
+	}
+	tt_pthread_mutex_unlock(&pool->mutex);
+	ZSTD_freeCCtx(zctx);
+	return NULL;
+}
+
+int
+xlog_zpool_start(int threads)
+{
+	struct xlog_zpool *pool = &xlog_zpool;
+	assert(pool->thread_count == 0);
+	if (threads == 0)
+		return 0;
+	pool->threads = (struct cord *)calloc(threads, sizeof(struct cord));
+	if (pool->threads == NULL) {
+		diag_set(OutOfMemory, threads * sizeof(struct cord),
+			 "calloc", "compression threads");
 		return -1;
-	});
+	}
+	tt_pthread_mutex_init(&pool->mutex, NULL);
+	tt_pthread_cond_init(&pool->queue_cond, NULL);
+	tt_pthread_cond_init(&pool->done_cond, NULL);
+	stailq_create(&pool->queue);
+	pool->is_stopping = false;
+	for (int i = 0; i < threads; i++) {
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "zstd.%d", i);
+		if (cord_start(&pool->threads[i], name,
+			       xlog_zpool_f, NULL) != 0) {
+			xlog_zpool_stop();
+			return -1;
+		}
+		pool->thread_count++;
+	}
+	return 0;
+}
 
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
-	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
+void
+xlog_zpool_stop(void)
+{
+	struct xlog_zpool *pool = &xlog_zpool;
+	if (pool->threads == NULL)
+		return;
+	tt_pthread_mutex_lock(&pool->mutex);
+	pool->is_stopping = true;
+	tt_pthread_cond_broadcast(&pool->queue_cond);
+	tt_pthread_mutex_unlock(&pool->mutex);
+	for (int i = 0; i < pool->thread_count; i++) {
+		if (cord_join(&pool->threads[i]) != 0)
+			panic_syserror("compression thread join failed");
+	}
+	assert(stailq_empty(&pool->queue));
+	tt_pthread_cond_destroy(&pool->done_cond);
+	tt_pthread_cond_destroy(&pool->queue_cond);
+	tt_pthread_mutex_destroy(&pool->mutex);
+	free(pool->threads);
+	pool->threads = NULL;
+	pool->thread_count = 0;
+}
+
+/**
+ * Compress a sequence of xrow objects accumulated in @a obuf
+ * into @a zbuf splitting it into @a job_count parts compressed
+ * in parallel by the compression threads and the current one,
+ * and fill in the fixheader of the compressed block.
+ * @retval -1  error
+ * @retval  0  success
+ */
+static int
+xlog_tx_encode_zstd_parallel(struct obuf *obuf, struct obuf *zbuf,
+			     ZSTD_CCtx *zctx, int level,
+			     const ZSTD_CDict *cdict, int job_count)
+{
+	struct xlog_zpool *pool = &xlog_zpool;
+	size_t job_size = (obuf_size(obuf) - XLOG_FIXHEADER_SIZE) / job_count;
+	struct xlog_zjob *jobs = (struct xlog_zjob *)
+		calloc(job_count, sizeof(*jobs));
+	if (jobs == NULL) {
+		diag_set(OutOfMemory, job_count * sizeof(*jobs), "calloc",
+			 "compression jobs");
 		return -1;
 	}
-	return obuf_size(&log->obuf);
+	struct xlog_zbatch batch;
+	batch.level = level;
+	batch.cdict = cdict;
+	batch.pending = job_count - 1;
+	/* Split the block into parts of about job_size bytes. */
+	struct xlog_zjob *job = jobs;
+	job->batch = &batch;
+	size_t job_used = 0;
+	size_t offset = XLOG_FIXHEADER_SIZE;
+	for (struct iovec *iov = obuf->iov; iov->iov_len; ++iov) {
+		while (offset < iov->iov_len) {
+			size_t len = iov->iov_len - offset;
+			if (job < jobs + job_count - 1)
+				len = MIN(len, job_size - job_used);
+			struct iovec *src = &job->src[job->src_count++];
+			assert(job->src_count <= (int)lengthof(job->src));
+			src->iov_base = (char *)iov->iov_base + offset;
+			src->iov_len = len;
+			offset += len;
+			job_used += len;
+			if (job_used == job_size && job < jobs + job_count - 1) {
+				job++;
+				job->batch = &batch;
+				job_used = 0;
+			}
+		}
+		offset = 0;
+	}
+	assert(job == jobs + job_count - 1);
+
+	tt_pthread_mutex_lock(&pool->mutex);
+	for (int i = 1; i < job_count; i++)
+		stailq_add_tail_entry(&pool->queue, &jobs[i], in_queue);
+	tt_pthread_cond_broadcast(&pool->queue_cond);
+	tt_pthread_mutex_unlock(&pool->mutex);
+
+	xlog_zjob_run(&jobs[0], zctx);
+
+	tt_pthread_mutex_lock(&pool->mutex);
+	while (batch.pending > 0)
+		tt_pthread_cond_wait(&pool->done_cond, &pool->mutex);
+	tt_pthread_mutex_unlock(&pool->mutex);
+
+	int rc = -1;
+	uint32_t crc32c = 0;
+	char *fixheader = (char *)obuf_alloc(zbuf, XLOG_FIXHEADER_SIZE);
+	if (fixheader == NULL) {
+		diag_set(OutOfMemory, XLOG_FIXHEADER_SIZE, "runtime arena",
+			 "compression buffer");
+		goto out;
+	}
+	for (int i = 0; i < job_count; i++) {
+		job = &jobs[i];
+		if (job->error != NULL) {
+			diag_set(ClientError, ER_COMPRESSION, job->error);
+			goto out;
+		}
+		if (obuf_dup(zbuf, job->dst, job->dst_size) != job->dst_size) {
+			diag_set(OutOfMemory, job->dst_size, "runtime arena",
+				 "compression buffer");
+			goto out;
+		}
+		crc32c = crc32_calc(crc32c, job->dst, job->dst_size);
+	}
+	xlog_tx_encode_zfixheader(fixheader,
+				  obuf_size(zbuf) - XLOG_FIXHEADER_SIZE,
+				  crc32c);
+	rc = 0;
+out:
+	for (int i = 0; i < job_count; i++)
+		free(jobs[i].dst);
+	free(jobs);
+	return rc;
 }
 
+/* }}} */
+
 /**
- * Write a compressed block of xrow objects.
+ * Compress a sequence of xrow objects accumulated in @a obuf
+ * into @a zbuf and fill in the fixheader of the compressed
+ * block.
  * @retval -1  error
- * @retval >= 0 the number of bytes written
+ * @retval  0  success
  */
-static off_t
-xlog_tx_write_zstd(struct xlog *log)
+static int
+xlog_tx_encode_zstd(struct obuf *obuf, struct obuf *zbuf, ZSTD_CCtx *zctx,
+		    int level, const ZSTD_CDict *cdict)
 {
-	char *fixheader = (char *)obuf_alloc(&log->zbuf,
-					     XLOG_FIXHEADER_SIZE);
+	char *fixheader = (char *)obuf_alloc(zbuf, XLOG_FIXHEADER_SIZE);
+	if (fixheader == NULL) {
+		diag_set(OutOfMemory, XLOG_FIXHEADER_SIZE, "runtime arena",
+			 "compression buffer");
+		return -1;
+	}
 
 	uint32_t crc32c = 0;
 	struct iovec *iov;
-	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
+	if (cdict != NULL)
+		ZSTD_compressBegin_usingCDict(zctx, cdict);
+	else
+		ZSTD_compressBegin(zctx, level);
 	size_t offset = XLOG_FIXHEADER_SIZE;
-	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
+	for (iov = obuf->iov; iov->iov_len; ++iov) {
 		/* Estimate max output buffer size. */
 		size_t zmax_size = ZSTD_compressBound(iov->iov_len - offset);
 		/* Allocate a destination buffer. */
-		void *zdst = obuf_reserve(&log->zbuf, zmax_size);
+		void *zdst = obuf_reserve(zbuf, zmax_size);
 		if (!zdst) {
 			diag_set(OutOfMemory, zmax_size, "runtime arena",
 				  "compression buffer");
-			goto error;
+			return -1;
 		}
 		size_t (*fcompress)(ZSTD_CCtx *, void *, size_t,
 				    const void *, size_t);
@@ -1126,67 +2199,76 @@ xlog_tx_write_zstd(struct xlog *log)
 		 * If it's the last iov or the last
 		 * log has 0 bytes, end the stream.
 		 */
-		if (iov == log->obuf.iov + log->obuf.pos ||
+		if (iov == obuf->iov + obuf->pos ||
 		    !(iov + 1)->iov_len) {
 			fcompress = ZSTD_compressEnd;
 		} else {
 			fcompress = ZSTD_compressContinue;
 		}
-		size_t zsize = fcompress(log->zctx, zdst, zmax_size,
+		size_t zsize = fcompress(zctx, zdst, zmax_size,
 					 (char *)iov->iov_base + offset,
 					 iov->iov_len - offset);
 		if (ZSTD_isError(zsize)) {
-			diag_set(ClientError, ER_COMPRESSION,
-				 ZSTD_getErrorName(zsize));
-			goto error;
-		}
-		/* Advance output buffer to the end of compressed data. */
-		obuf_alloc(&log->zbuf, zsize);
-		/* Update crc32c */
-		crc32c = crc32_calc(crc32c, (char *)zdst, zsize);
-		/* Discount fixheader size for all iovs after first. */
-		offset = 0;
-	}
-
-	*(log_magic_t *)fixheader = zrow_marker;
-	char *data;
-	data = fixheader + sizeof(log_magic_t);
-	data = mp_encode_uint(data,
-			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
-	data = mp_encode_uint(data, crc32c);
-	/* Encode padding */
-	ssize_t padding;
-	padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
+			diag_set(ClientError, ER_COMPRESSION,
+				 ZSTD_getErrorName(zsize));
+			return -1;
 		}
+		/* Advance output buffer to the end of compressed data. */
+		obuf_alloc(zbuf, zsize);
+		/* Update crc32c */
+		crc32c = crc32_calc(crc32c, (char *)zdst, zsize);
+		/* Discount fixheader size for all iovs after first. */
+		offset = 0;
 	}
 
-	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
-		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		obuf_reset(&log->zbuf);
-		goto error;
-	});
+	xlog_tx_encode_zfixheader(fixheader,
+				  obuf_size(zbuf) - XLOG_FIXHEADER_SIZE,
+				  crc32c);
+	return 0;
+}
 
-	ssize_t written;
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
-	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
-		goto error;
+/**
+ * Turn a sequence of xrow objects accumulated in @a obuf into
+ * an xlog transaction block, compressing it if needed.
+ *
+ * @retval NULL error
+ * @retval the buffer that holds the block, either @a obuf or
+ *         @a zbuf
+ */
+static struct obuf *
+xlog_tx_encode(struct obuf *obuf, struct obuf *zbuf, ZSTD_CCtx *zctx,
+	       const struct xlog_opts *opts)
+{
+	size_t size = obuf_size(obuf);
+	if (!opts->no_compression && size >= opts->compression_threshold) {
+		const ZSTD_CDict *cdict = NULL;
+		if (opts->dict != NULL) {
+			cdict = xlog_dict_cdict(opts->dict,
+						opts->compression_level);
+			if (cdict == NULL)
+				return NULL;
+		}
+		int job_count = 1;
+		if (opts->parallel_compression) {
+			job_count = MIN(xlog_zpool.thread_count + 1,
+					(int)(size / XLOG_TX_COMPRESS_PART_MIN));
+		}
+		int rc;
+		if (job_count > 1) {
+			rc = xlog_tx_encode_zstd_parallel(obuf, zbuf, zctx,
+						opts->compression_level,
+						cdict, job_count);
+		} else {
+			rc = xlog_tx_encode_zstd(obuf, zbuf, zctx,
+						 opts->compression_level,
+						 cdict);
+		}
+		if (rc != 0)
+			return NULL;
+		return zbuf;
 	}
-	obuf_reset(&log->zbuf);
-	return written;
-error:
-	obuf_reset(&log->zbuf);
-	return -1;
+	xlog_tx_encode_plain(obuf);
+	return obuf;
 }
 
 /* file syncing and posix_fadvise() should be rounded by a page boundary */
@@ -1195,46 +2277,37 @@ error:
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
 /**
- * Writes xlog batch to file
+ * Write data to an xlog file, honoring the sync interval and
+ * the rate limit of the xlog.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of bytes written
  */
 static ssize_t
-xlog_tx_write(struct xlog *log)
+xlog_write_iov(struct xlog *log, struct iovec *iov, int iovcnt)
 {
-	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
-		return 0;
 	ssize_t written;
-
-	if (!log->opts.no_compression &&
-	    obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
-		written = xlog_tx_write_zstd(log);
-	} else {
-		written = xlog_tx_write_plain(log);
-	}
-	ERROR_INJECT(ERRINJ_WAL_WRITE, {
+	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
 		written = -1;
+		goto truncate;
 	});
-
-	obuf_reset(&log->obuf);
-	/*
-	 * Simplify recovery after a temporary write failure:
-	 * truncate the file to the best known good write
-	 * position.
-	 */
+	written = fio_writevn(log->fd, iov, iovcnt);
 	if (written < 0) {
-		if (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
-		    ftruncate(log->fd, log->offset) != 0)
-			panic_syserror("failed to truncate xlog after write error");
-		log->allocated = 0;
-		return -1;
+		diag_set(SystemError, "failed to write to '%s' file",
+			 log->filename);
+		goto truncate;
 	}
+	ERROR_INJECT(ERRINJ_WAL_WRITE, {
+		diag_set(ClientError, ER_INJECTION, "xlog write injection");
+		written = -1;
+		goto truncate;
+	});
 	if (log->allocated > (size_t)written)
 		log->allocated -= written;
 	else
 		log->allocated = 0;
 	log->offset += written;
-	log->rows += log->tx_rows;
-	log->tx_rows = 0;
 	if ((log->opts.sync_interval && log->offset >=
 	    (off_t)(log->synced_size + log->opts.sync_interval)) ||
 	    (log->opts.rate_limit && log->offset >=
@@ -1274,62 +2347,175 @@ xlog_tx_write(struct xlog *log)
 		log->synced_size = log->offset;
 	}
 	return written;
+truncate:
+	/*
+	 * Simplify recovery after a temporary write failure:
+	 * truncate the file to the best known good write
+	 * position.
+	 */
+	if (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
+	    ftruncate(log->fd, log->offset) != 0)
+		panic_syserror("failed to truncate xlog after write error");
+	log->allocated = 0;
+	return -1;
+}
+
+/**
+ * Write an encoded xlog transaction block to file.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of bytes written
+ */
+static ssize_t
+xlog_tx_write_block(struct xlog *log, struct obuf *block)
+{
+	return xlog_write_iov(log, block->iov, block->pos + 1);
+}
+
+/**
+ * Writes xlog batch to file
+ */
+static ssize_t
+xlog_tx_write(struct xlog *log)
+{
+	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
+		return 0;
+	ssize_t written = -1;
+	struct obuf *block = xlog_tx_encode(&log->obuf, &log->zbuf,
+					    log->zctx, &log->opts);
+	if (block != NULL)
+		written = xlog_tx_write_block(log, block);
+	obuf_reset(&log->obuf);
+	obuf_reset(&log->zbuf);
+	if (written < 0)
+		return -1;
+	log->rows += log->tx_rows;
+	log->tx_rows = 0;
+	return written;
 }
 
-/*
- * Add a row to a log and possibly flush the log.
+/**
+ * Encode a row and append it to a row accumulator.
  *
  * @retval  -1 error, check diag.
- * @retval >=0 the number of bytes written to buffer.
+ * @retval >=0 the number of bytes appended to the buffer.
  */
-ssize_t
-xlog_write_row(struct xlog *log, const struct xrow_header *packet)
+static ssize_t
+xlog_encode_row(struct obuf *obuf, const struct xrow_header *packet)
 {
 	/*
 	 * Automatically reserve space for a fixheader when adding
 	 * the first row in * a log. The fixheader is populated
 	 * at write. @sa xlog_tx_write().
 	 */
-	if (obuf_size(&log->obuf) == 0) {
-		if (!obuf_alloc(&log->obuf, XLOG_FIXHEADER_SIZE)) {
+	if (obuf_size(obuf) == 0) {
+		if (!obuf_alloc(obuf, XLOG_FIXHEADER_SIZE)) {
 			diag_set(OutOfMemory, XLOG_FIXHEADER_SIZE,
 				  "runtime arena", "xlog tx output buffer");
 			return -1;
 		}
 	}
 
-	struct obuf_svp svp = obuf_create_svp(&log->obuf);
-	size_t page_offset = obuf_size(&log->obuf);
+	struct obuf_svp svp = obuf_create_svp(obuf);
+	size_t page_offset = obuf_size(obuf);
 	/** encode row into iovec */
 	struct iovec iov[XROW_IOVMAX];
 	/** don't write sync to the disk */
 	int iovcnt = xrow_header_encode(packet, 0, iov, 0);
 	if (iovcnt < 0) {
-		obuf_rollback_to_svp(&log->obuf, &svp);
+		obuf_rollback_to_svp(obuf, &svp);
 		return -1;
 	}
 	for (int i = 0; i < iovcnt; ++i) {
 		struct errinj *inj = errinj(ERRINJ_WAL_WRITE_PARTIAL,
 					    ERRINJ_INT);
 		if (inj != NULL && inj->iparam >= 0 &&
-		    obuf_size(&log->obuf) > (size_t)inj->iparam) {
+		    obuf_size(obuf) > (size_t)inj->iparam) {
 			diag_set(ClientError, ER_INJECTION,
 				 "xlog write injection");
-			obuf_rollback_to_svp(&log->obuf, &svp);
+			obuf_rollback_to_svp(obuf, &svp);
 			return -1;
 		};
-		if (obuf_dup(&log->obuf, iov[i].iov_base, iov[i].iov_len) <
+		if (obuf_dup(obuf, iov[i].iov_base, iov[i].iov_len) <
 		    iov[i].iov_len) {
 			diag_set(OutOfMemory, XLOG_FIXHEADER_SIZE,
 				  "runtime arena", "xlog tx output buffer");
-			obuf_rollback_to_svp(&log->obuf, &svp);
+			obuf_rollback_to_svp(obuf, &svp);
 			return -1;
 		}
 	}
 	assert(iovcnt <= XROW_IOVMAX);
+	return obuf_size(obuf) - page_offset;
+}
+
+/**
+ * Encode rows and append them to a row accumulator. Space for
+ * all rows is reserved at once, then headers are encoded and
+ * bodies are copied right to the buffer, without intermediate
+ * iovecs.
+ *
+ * @retval  -1 error, check diag.
+ * @retval >=0 the number of bytes appended to the buffer.
+ */
+static ssize_t
+xlog_encode_rows(struct obuf *obuf, struct xrow_header **rows,
+		 int row_count, size_t size_max)
+{
+	/* @sa xlog_encode_row(). */
+	if (obuf_size(obuf) == 0) {
+		if (!obuf_alloc(obuf, XLOG_FIXHEADER_SIZE)) {
+			diag_set(OutOfMemory, XLOG_FIXHEADER_SIZE,
+				  "runtime arena", "xlog tx output buffer");
+			return -1;
+		}
+	}
+	char *data = obuf_reserve(obuf, size_max);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size_max,
+			 "runtime arena", "xlog tx output buffer");
+		return -1;
+	}
+	char *pos = data;
+	for (int i = 0; i < row_count; i++) {
+		struct errinj *inj = errinj(ERRINJ_WAL_WRITE_PARTIAL,
+					    ERRINJ_INT);
+		if (inj != NULL && inj->iparam >= 0 &&
+		    obuf_size(obuf) + (pos - data) > (size_t)inj->iparam) {
+			diag_set(ClientError, ER_INJECTION,
+				 "xlog write injection");
+			return -1;
+		};
+		const struct xrow_header *row = rows[i];
+		/* don't write sync to the disk */
+		pos = xrow_header_encode_buf(row, 0, pos);
+		for (int j = 0; j < row->bodycnt; j++) {
+			memcpy(pos, row->body[j].iov_base,
+			       row->body[j].iov_len);
+			pos += row->body[j].iov_len;
+		}
+	}
+	size_t size = pos - data;
+	assert(size <= size_max);
+	char *ptr = obuf_alloc(obuf, size);
+	(void)ptr;
+	assert(ptr == data);
+	return size;
+}
+
+/*
+ * Add a row to a log and possibly flush the log.
+ *
+ * @retval  -1 error, check diag.
+ * @retval >=0 the number of bytes written to buffer.
+ */
+ssize_t
+xlog_write_row(struct xlog *log, const struct xrow_header *packet)
+{
+	ssize_t row_size = xlog_encode_row(&log->obuf, packet);
+	if (row_size < 0)
+		return -1;
 	log->tx_rows++;
 
-	size_t row_size = obuf_size(&log->obuf) - page_offset;
 	if (log->is_autocommit &&
 	    obuf_size(&log->obuf) >= XLOG_TX_AUTOCOMMIT_THRESHOLD &&
 	    xlog_tx_write(log) < 0)
@@ -1338,6 +2524,135 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 	return row_size;
 }
 
+ssize_t
+xlog_write_rows(struct xlog *log, struct xrow_header **rows, int row_count)
+{
+	size_t size_max = 0;
+	for (int i = 0; i < row_count; i++)
+		size_max += xrow_approx_len(rows[i]);
+	/*
+	 * Big rows are written one by one, so as not to reserve
+	 * a huge contiguous chunk of memory in the buffer.
+	 */
+	if (size_max > XLOG_TX_AUTOCOMMIT_THRESHOLD) {
+		ssize_t total = 0;
+		for (int i = 0; i < row_count; i++) {
+			ssize_t row_size = xlog_write_row(log, rows[i]);
+			if (row_size < 0)
+				return -1;
+			total += row_size;
+		}
+		return total;
+	}
+	ssize_t size = xlog_encode_rows(&log->obuf, rows, row_count,
+					size_max);
+	if (size < 0)
+		return -1;
+	log->tx_rows += row_count;
+
+	if (log->is_autocommit &&
+	    obuf_size(&log->obuf) >= XLOG_TX_AUTOCOMMIT_THRESHOLD &&
+	    xlog_tx_write(log) < 0)
+		return -1;
+
+	return size;
+}
+
+int
+xlog_tx_buf_create(struct xlog_tx_buf *buf, const struct xlog_opts *opts)
+{
+	obuf_create(&buf->obuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	obuf_create(&buf->zbuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	buf->opts = *opts;
+	buf->rows = 0;
+	buf->block = NULL;
+	buf->zctx = NULL;
+	if (!opts->no_compression) {
+		buf->zctx = ZSTD_createCCtx();
+		if (buf->zctx == NULL) {
+			obuf_destroy(&buf->obuf);
+			obuf_destroy(&buf->zbuf);
+			diag_set(ClientError, ER_COMPRESSION,
+				 "failed to create context");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void
+xlog_tx_buf_destroy(struct xlog_tx_buf *buf)
+{
+	obuf_destroy(&buf->obuf);
+	obuf_destroy(&buf->zbuf);
+	ZSTD_freeCCtx(buf->zctx);
+	TRASH(buf);
+}
+
+ssize_t
+xlog_tx_buf_write_row(struct xlog_tx_buf *buf,
+		      const struct xrow_header *packet)
+{
+	assert(buf->block == NULL);
+	ssize_t row_size = xlog_encode_row(&buf->obuf, packet);
+	if (row_size < 0)
+		return -1;
+	buf->rows++;
+	return row_size;
+}
+
+bool
+xlog_tx_buf_is_full(struct xlog_tx_buf *buf)
+{
+	return obuf_size(&buf->obuf) >= XLOG_TX_AUTOCOMMIT_THRESHOLD;
+}
+
+int
+xlog_tx_buf_encode(struct xlog_tx_buf *buf)
+{
+	assert(buf->block == NULL);
+	if (buf->rows == 0)
+		return 0;
+	buf->block = xlog_tx_encode(&buf->obuf, &buf->zbuf, buf->zctx,
+				    &buf->opts);
+	if (buf->block == NULL) {
+		obuf_reset(&buf->obuf);
+		obuf_reset(&buf->zbuf);
+		buf->rows = 0;
+		return -1;
+	}
+	return 0;
+}
+
+ssize_t
+xlog_write_tx_buf(struct xlog *log, struct xlog_tx_buf *buf)
+{
+	/* Rows buffered in the xlog itself must be flushed first. */
+	assert(log->tx_rows == 0);
+	assert(buf->block != NULL || buf->rows == 0);
+	ssize_t written = 0;
+	if (buf->block != NULL)
+		written = xlog_tx_write_block(log, buf->block);
+	if (written >= 0)
+		log->rows += buf->rows;
+	obuf_reset(&buf->obuf);
+	obuf_reset(&buf->zbuf);
+	buf->block = NULL;
+	buf->rows = 0;
+	return written;
+}
+
+ssize_t
+xlog_write_raw(struct xlog *log, const void *data, size_t size)
+{
+	/* Rows buffered in the xlog itself must be flushed first. */
+	assert(obuf_size(&log->obuf) == 0);
+	struct iovec iov;
+	iov.iov_base = (void *)data;
+	iov.iov_len = size;
+	return xlog_write_iov(log, &iov, 1);
+}
+
 /**
  * Begin a multi-statement xlog transaction. All xrow objects
  * of a single transaction share the same header and checksum
@@ -1507,8 +2822,8 @@ xlog_cursor_ensure(struct xlog_cursor *cursor, size_t count)
 {
 	if (ibuf_used(&cursor->rbuf) >= count)
 		return 0;
-	/* in-memory mode */
-	if (cursor->fd < 0)
+	/* in-memory or mmap mode */
+	if (cursor->fd < 0 || cursor->map != NULL)
 		return 1;
 
 	size_t to_load = count - ibuf_used(&cursor->rbuf);
@@ -1541,6 +2856,19 @@ xlog_cursor_ensure(struct xlog_cursor *cursor, size_t count)
 	return ibuf_used(&cursor->rbuf) >= count ? 0: 1;
 }
 
+/**
+ * Prepare a decompression context for a new transaction block
+ * compressed with dictionary @a ddict, which may be NULL.
+ */
+static void
+xlog_zdctx_init(ZSTD_DStream *zdctx, const ZSTD_DDict *ddict)
+{
+	if (ddict != NULL)
+		ZSTD_initDStream_usingDDict(zdctx, ddict);
+	else
+		ZSTD_initDStream(zdctx);
+}
+
 /**
  * Decompress zstd-compressed buf into cursor row block
  *
@@ -1662,7 +2990,8 @@ xlog_fixheader_decode(struct xlog_fixheader *fixheader,
 
 int
 xlog_tx_decode(const char *data, const char *data_end,
-	       char *rows, char *rows_end, ZSTD_DStream *zdctx)
+	       char *rows, char *rows_end, ZSTD_DStream *zdctx,
+	       const ZSTD_DDict *ddict)
 {
 	/* Decode fixheader */
 	struct xlog_fixheader fixheader;
@@ -1701,7 +3030,7 @@ xlog_tx_decode(const char *data, const char *data_end,
 
 	/* Decompress zstd rows */
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	xlog_zdctx_init(zdctx, ddict);
 	int rc = xlog_cursor_decompress(&rows, rows_end, &data, data_end,
 					zdctx);
 	if (rc < 0) {
@@ -1725,7 +3054,8 @@ xlog_tx_decode(const char *data, const char *data_end,
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx)
+		      ZSTD_DStream *zdctx, const ZSTD_DDict *ddict,
+		      bool copy)
 {
 	const char *rpos = *data;
 	struct xlog_fixheader fixheader;
@@ -1751,6 +3081,18 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 
 	ibuf_create(&tx_cursor->rows, &cord()->slabc,
 		    XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	if (fixheader.magic == row_marker && !copy) {
+		/*
+		 * Point the buffer to the data. It owns no memory
+		 * then so ibuf_destroy() is a no-op.
+		 */
+		tx_cursor->rows.rpos = (char *)rpos;
+		tx_cursor->rows.wpos = (char *)rpos + fixheader.len;
+		tx_cursor->rows.end = tx_cursor->rows.wpos;
+		*data = (char *)rpos + fixheader.len;
+		tx_cursor->size = fixheader.len;
+		return 0;
+	}
 	if (fixheader.magic == row_marker) {
 		void *dst = ibuf_alloc(&tx_cursor->rows, fixheader.len);
 		if (dst == NULL) {
@@ -1767,7 +3109,7 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	};
 
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	xlog_zdctx_init(zdctx, ddict);
 	int rc;
 	do {
 		if (ibuf_reserve(&tx_cursor->rows,
@@ -1864,7 +3206,10 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 	ssize_t to_load;
 	while ((to_load = xlog_tx_cursor_create(&i->tx_cursor,
 						(const char **)&i->rbuf.rpos,
-						i->rbuf.wpos, i->zdctx)) > 0) {
+						i->rbuf.wpos, i->zdctx,
+						i->dict != NULL ?
+						i->dict->ddict : NULL,
+						i->map == NULL)) > 0) {
 		/* not enough data in read buffer */
 		int rc = xlog_cursor_ensure(i, ibuf_used(&i->rbuf) + to_load);
 		if (rc < 0)
@@ -1944,15 +3289,77 @@ xlog_cursor_next(struct xlog_cursor *cursor,
 	return 0;
 }
 
-int
-xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
+/**
+ * Map a complete xlog file opened by a cursor to memory and point
+ * the cursor read buffer to the mapping. An incomplete file is
+ * left to be read with pread(), as well as a file that failed to
+ * be mapped.
+ * @retval 0 success
+ * @retval -1 error, check diag
+ */
+static int
+xlog_cursor_map(struct xlog_cursor *i)
+{
+	struct stat st;
+	if (fstat(i->fd, &st) != 0) {
+		diag_set(SystemError, "failed to stat '%s' file", i->name);
+		return -1;
+	}
+	if (st.st_size < (off_t)sizeof(log_magic_t))
+		return 0;
+	log_magic_t magic;
+	ssize_t rc = fio_pread(i->fd, &magic, sizeof(magic),
+			       st.st_size - sizeof(magic));
+	if (rc < 0) {
+		diag_set(SystemError, "failed to read '%s' file", i->name);
+		return -1;
+	}
+	if (rc != sizeof(magic) || magic != eof_marker)
+		return 0;
+	/*
+	 * The mapping is private and writable so that the
+	 * garbage error injection can corrupt the data.
+	 */
+	void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE, i->fd, 0);
+	if (map == MAP_FAILED) {
+		say_syserror("failed to map '%s' file", i->name);
+		return 0;
+	}
+	if (madvise(map, st.st_size, MADV_SEQUENTIAL) != 0)
+		say_syserror("madvise");
+	i->map = map;
+	i->map_size = st.st_size;
+	i->rbuf.rpos = i->map;
+	i->rbuf.wpos = i->rbuf.end = i->map + i->map_size;
+	i->read_offset = i->map_size;
+	return 0;
+}
+
+/** Unmap a file mapped by xlog_cursor_map(). */
+static void
+xlog_cursor_unmap(struct xlog_cursor *i)
+{
+	if (i->map == NULL)
+		return;
+	munmap(i->map, i->map_size);
+	i->map = NULL;
+	i->map_size = 0;
+}
+
+static int
+xlog_cursor_openfd_impl(struct xlog_cursor *i, int fd, const char *name,
+			bool use_mmap)
 {
 	memset(i, 0, sizeof(*i));
 	i->fd = fd;
 	ibuf_create(&i->rbuf, &cord()->slabc,
 		    XLOG_TX_AUTOCOMMIT_THRESHOLD << 1);
+	snprintf(i->name, sizeof(i->name), "%s", name);
 
 	ssize_t rc;
+	if (use_mmap && xlog_cursor_map(i) != 0)
+		goto error;
 	/*
 	 * we can have eof here, but this is no error,
 	 * because we don't know exact meta size
@@ -1969,7 +3376,13 @@ xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 		diag_set(XlogError, "Unexpected end of file, run with 'force_recovery = true'");
 		goto error;
 	}
-	snprintf(i->name, sizeof(i->name), "%s", name);
+	if (i->meta.dict_id != 0) {
+		char dirname[PATH_MAX];
+		xlog_dirname(name, dirname, sizeof(dirname));
+		i->dict = xlog_dict_load(dirname, i->meta.dict_id);
+		if (i->dict == NULL)
+			goto error;
+	}
 	i->zdctx = ZSTD_createDStream();
 	if (i->zdctx == NULL) {
 		diag_set(ClientError, ER_DECOMPRESSION,
@@ -1980,18 +3393,26 @@ xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 	return 0;
 error:
 	ibuf_destroy(&i->rbuf);
+	xlog_cursor_unmap(i);
 	return -1;
 }
 
 int
-xlog_cursor_open(struct xlog_cursor *i, const char *name)
+xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
+{
+	return xlog_cursor_openfd_impl(i, fd, name, false);
+}
+
+static int
+xlog_cursor_open_impl(struct xlog_cursor *i, const char *name,
+		      bool use_mmap)
 {
 	int fd = open(name, O_RDONLY);
 	if (fd < 0) {
 		diag_set(SystemError, "failed to open '%s' file", name);
 		return -1;
 	}
-	int rc = xlog_cursor_openfd(i, fd, name);
+	int rc = xlog_cursor_openfd_impl(i, fd, name, use_mmap);
 	if (rc < 0) {
 		close(fd);
 		return -1;
@@ -1999,6 +3420,18 @@ xlog_cursor_open(struct xlog_cursor *i, const char *name)
 	return 0;
 }
 
+int
+xlog_cursor_open(struct xlog_cursor *i, const char *name)
+{
+	return xlog_cursor_open_impl(i, name, false);
+}
+
+int
+xlog_cursor_open_mmap(struct xlog_cursor *i, const char *name)
+{
+	return xlog_cursor_open_impl(i, name, true);
+}
+
 int
 xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 		    const char *name)
@@ -2027,6 +3460,13 @@ xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 		goto error;
 	}
 	snprintf(i->name, sizeof(i->name), "%s", name);
+	if (i->meta.dict_id != 0) {
+		char dirname[PATH_MAX];
+		xlog_dirname(name, dirname, sizeof(dirname));
+		i->dict = xlog_dict_load(dirname, i->meta.dict_id);
+		if (i->dict == NULL)
+			goto error;
+	}
 	i->zdctx = ZSTD_createDStream();
 	if (i->zdctx == NULL) {
 		diag_set(ClientError, ER_DECOMPRESSION,
@@ -2050,6 +3490,7 @@ xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 	ibuf_destroy(&i->rbuf);
 	if (i->state == XLOG_CURSOR_TX)
 		xlog_tx_cursor_destroy(&i->tx_cursor);
+	xlog_cursor_unmap(i);
 	ZSTD_freeDStream(i->zdctx);
 	i->state = (i->state == XLOG_CURSOR_EOF ?
 		    XLOG_CURSOR_EOF_CLOSED : XLOG_CURSOR_CLOSED);
@@ -41,9 +41,11 @@
 
 #include "small/ibuf.h"
 #include "small/obuf.h"
+#include "small/rlist.h"
 
 struct iovec;
 struct xrow_header;
+struct xlog_dict;
 
 #if defined(__cplusplus)
 extern "C" {
@@ -82,10 +84,110 @@ struct xlog_opts {
 	 * to be read frequently, e.g. L1 run files in Vinyl.
 	 */
 	bool no_compression;
+	/** Zstd compression level. */
+	int compression_level;
+	/**
+	 * Transaction blocks smaller than this are written
+	 * uncompressed: compressing them takes up CPU but
+	 * doesn't yield sizeable gains.
+	 */
+	size_t compression_threshold;
+	/**
+	 * If this flag is set, big transaction blocks are split
+	 * into parts compressed in parallel by the compression
+	 * threads, see xlog_zpool_start().
+	 *
+	 * This option is useful for WAL files, which are written
+	 * by a single thread.
+	 */
+	bool parallel_compression;
+	/**
+	 * Dictionary used for compression of transaction blocks
+	 * or NULL. Its id is stored in the meta of the created
+	 * files, see xlog_dict_load().
+	 */
+	struct xlog_dict *dict;
 };
 
 extern const struct xlog_opts xlog_opts_default;
 
+enum {
+	/** Max number of compression threads. */
+	XLOG_ZPOOL_THREADS_MAX = 64,
+};
+
+/**
+ * Start threads compressing transaction blocks of xlogs
+ * with xlog_opts::parallel_compression set. If @a threads
+ * is 0, blocks are compressed by the writing thread.
+ *
+ * @retval 0 success
+ * @retval -1 error
+ */
+int
+xlog_zpool_start(int threads);
+
+/** Stop the compression threads. */
+void
+xlog_zpool_stop(void);
+
+/* {{{ Compression dictionaries */
+
+enum {
+	/** Default max size of a trained dictionary. */
+	XLOG_DICT_SIZE_DEFAULT = 110 * 1024,
+	/** Max zstd compression level, see ZSTD_maxCLevel(). */
+	XLOG_DICT_LEVEL_MAX = 22,
+};
+
+/**
+ * A zstd dictionary trained on rows of existing files, which
+ * improves the compression ratio of small transaction blocks.
+ * A dictionary is stored in file <id>.zdict in the directory
+ * of the files compressed with it and its id is referenced in
+ * their meta. Loaded dictionaries are cached until exit and
+ * may be shared by threads.
+ */
+struct xlog_dict {
+	/** Dictionary id, unique for the dictionary content. */
+	uint32_t id;
+	/** Dictionary content. */
+	void *data;
+	/** Size of the content. */
+	size_t size;
+	/** Digested dictionary for decompression. */
+	ZSTD_DDict *ddict;
+	/** Digested dictionaries for compression, by level. */
+	ZSTD_CDict *cdict[XLOG_DICT_LEVEL_MAX + 1];
+	/** Link in the dictionary cache. */
+	struct rlist in_cache;
+};
+
+/**
+ * Return a dictionary with the given id, loading it from
+ * directory @a dirname unless it is cached already.
+ *
+ * @retval NULL error, check diag
+ */
+struct xlog_dict *
+xlog_dict_load(const char *dirname, uint32_t id);
+
+/**
+ * Train a dictionary of at most @a size bytes on rows of the
+ * files at @a paths, read until the total size of samples is
+ * a hundred times the dictionary size, and save it to each
+ * of directories @a dirnames. Must be called from a cord,
+ * blocks it until the dictionary is trained.
+ *
+ * @retval 0 success, the dictionary id is returned in @a id
+ * @retval -1 error, check diag
+ */
+int
+xlog_dict_train(const char **paths, int path_count, size_t size,
+		const char **dirnames, int dirname_count, uint32_t *id);
+
+/* }}} */
+
 /* {{{ log dir */
 
 /**
@@ -165,6 +267,11 @@ struct xdir {
 	char dirname[PATH_MAX];
 	/** Snapshots or xlogs */
 	enum xdir_type type;
+	/**
+	 * Read complete files of the directory through a memory
+	 * mapping, see xlog_cursor_open_mmap().
+	 */
+	bool use_mmap;
 };
 
 /**
@@ -311,6 +418,17 @@ struct xlog_meta {
 	 * directory for missing WALs.
 	 */
 	struct vclock prev_vclock;
+	/**
+	 * Text file header: vector clock of the full snapshot
+	 * a delta snapshot is based on. Not set for full
+	 * snapshots and other files.
+	 */
+	struct vclock base_vclock;
+	/**
+	 * Text file header: id of the compression dictionary
+	 * or 0 if the file is compressed without one.
+	 */
+	uint32_t dict_id;
 };
 
 /**
@@ -426,6 +544,40 @@ int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock);
 
+/**
+ * Create a delta snapshot file, which stores only the spaces
+ * changed since the full snapshot with @a base_vclock. Otherwise
+ * works as xdir_create_xlog().
+ */
+int
+xdir_create_delta_xlog(struct xdir *dir, struct xlog *xlog,
+		       const struct vclock *vclock,
+		       const struct vclock *base_vclock);
+
+/**
+ * Same as xdir_create_xlog(), but rename the spare file at
+ * @a spare into place instead of creating a new one, so that
+ * the disk space preallocated for it is reused.
+ * See xlog_make_spare().
+ */
+int
+xdir_recycle_xlog(struct xdir *dir, struct xlog *xlog,
+		  const struct vclock *vclock, const char *spare);
+
+/**
+ * Prepare a spare xlog file at @a path for xdir_recycle_xlog():
+ * rename the file at @a old_path there, unless it's NULL, or
+ * create a new one, drop its content and preallocate @a size
+ * bytes of disk space for it without changing the file size.
+ * Doesn't use the diagnostics area, so it may be called from
+ * a coio thread.
+ *
+ * @retval >=0 the size of preallocated disk space
+ * @retval -1 error, errno is set
+ */
+ssize_t
+xlog_make_spare(const char *old_path, const char *path, size_t size);
+
 /**
  * Create new xlog writer based on fd.
  * @param fd            file descriptor
@@ -501,6 +653,17 @@ xlog_fallocate(struct xlog *log, size_t size);
 ssize_t
 xlog_write_row(struct xlog *log, const struct xrow_header *packet);
 
+/**
+ * Write rows to xlog. Equivalent to calling xlog_write_row()
+ * for each row, but small rows are encoded right to the xlog
+ * buffer in one pass after reserving space for all of them.
+ *
+ * @retval count of written bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_write_rows(struct xlog *log, struct xrow_header **rows, int row_count);
+
 /**
  * Prevent xlog row buffer offloading, should be use
  * at transaction start to write transaction in one xlog tx
@@ -530,6 +693,97 @@ xlog_tx_rollback(struct xlog *log);
 ssize_t
 xlog_flush(struct xlog *log);
 
+/**
+ * A standalone accumulator of rows which are encoded into an
+ * xlog transaction block independently of any xlog file. The
+ * block is then appended to an xlog with xlog_write_tx_buf().
+ * This allows several threads to encode and compress data for
+ * the same file concurrently, so that only writes themselves
+ * are serialized.
+ */
+struct xlog_tx_buf {
+	/** Row accumulator, starts with a reserved fixheader. */
+	struct obuf obuf;
+	/** Compressed output buffer. */
+	struct obuf zbuf;
+	/** The context of zstd compression. */
+	ZSTD_CCtx *zctx;
+	/** Compression options. */
+	struct xlog_opts opts;
+	/** Number of rows in the buffer. */
+	int64_t rows;
+	/**
+	 * Encoded block, points either to obuf or to zbuf.
+	 * Set by xlog_tx_buf_encode().
+	 */
+	struct obuf *block;
+};
+
+/**
+ * Create a row accumulator. Its memory is allocated from the
+ * slab cache of the current cord.
+ *
+ * @retval 0 success
+ * @retval -1 error
+ */
+int
+xlog_tx_buf_create(struct xlog_tx_buf *buf, const struct xlog_opts *opts);
+
+/** Free memory allocated by a row accumulator. */
+void
+xlog_tx_buf_destroy(struct xlog_tx_buf *buf);
+
+/**
+ * Append a row to an accumulator.
+ *
+ * @retval count of buffered bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_tx_buf_write_row(struct xlog_tx_buf *buf,
+		      const struct xrow_header *packet);
+
+/**
+ * Return true if an accumulator has grown big enough to be
+ * written as a separate transaction block.
+ */
+bool
+xlog_tx_buf_is_full(struct xlog_tx_buf *buf);
+
+/**
+ * Encode (and compress) the rows accumulated in @a buf into
+ * a transaction block. Does not touch any xlog and so can be
+ * called concurrently for different accumulators.
+ *
+ * @retval 0 success
+ * @retval -1 error, the accumulated rows are discarded
+ */
+int
+xlog_tx_buf_encode(struct xlog_tx_buf *buf);
+
+/**
+ * Write a block encoded with xlog_tx_buf_encode() to an xlog
+ * file and reset the accumulator. Rows buffered in the xlog
+ * itself must be flushed beforehand with xlog_flush().
+ *
+ * @retval count of written bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_write_tx_buf(struct xlog *log, struct xlog_tx_buf *buf);
+
+/**
+ * Append raw data, e.g. transaction blocks copied from another
+ * xlog file, to an xlog file. The data is written as is, rows
+ * it contains aren't accounted. Rows buffered in the xlog itself
+ * must be flushed beforehand with xlog_flush().
+ *
+ * @retval count of written bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_write_raw(struct xlog *log, const void *data, size_t size);
+
 
 /**
  * Sync a log file. The exact action is defined
@@ -573,6 +827,8 @@ struct xlog_tx_cursor
 /**
  * Create xlog tx iterator from memory data.
  * *data will be adjusted to end of tx
+ * If @a copy is false, rows of an uncompressed tx are read
+ * right from @a data, which then must outlive the iterator.
  *
  * @retval 0 for Ok
  * @retval -1 for error
@@ -581,7 +837,8 @@ struct xlog_tx_cursor
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx);
+		      ZSTD_DStream *zdctx, const ZSTD_DDict *ddict,
+		      bool copy);
 
 /**
  * Destroy xlog tx cursor and free all associated memory
@@ -619,13 +876,15 @@ xlog_tx_cursor_pos(struct xlog_tx_cursor *tx_cursor)
  * @param data_end the end of @a data buffer
  * @param[out] rows a buffer to store decoded rows
  * @param[out] rows_end the end of @a rows buffer
+ * @param zdctx decompression context
+ * @param ddict compression dictionary or NULL
  * @retval  0 success
  * @retval -1 error, check diag
  */
 int
 xlog_tx_decode(const char *data, const char *data_end,
 	       char *rows, char *rows_end,
-	       ZSTD_DStream *zdctx);
+	       ZSTD_DStream *zdctx, const ZSTD_DDict *ddict);
 
 /* }}} */
 
@@ -658,14 +917,23 @@ struct xlog_cursor {
 	struct xlog_meta meta;
 	/** associated file name */
 	char name[PATH_MAX];
-	/** file read buffer */
+	/**
+	 * file read buffer; if the file is mapped, the buffer
+	 * points to the mapping and owns no memory
+	 */
 	struct ibuf rbuf;
+	/** memory mapping of the file or NULL */
+	char *map;
+	/** size of the memory mapping */
+	size_t map_size;
 	/** file read position */
 	off_t read_offset;
 	/** cursor for current tx */
 	struct xlog_tx_cursor tx_cursor;
 	/** ZSTD context for decompression */
 	ZSTD_DStream *zdctx;
+	/** Compression dictionary of the file or NULL. */
+	struct xlog_dict *dict;
 };
 
 /**
@@ -712,6 +980,21 @@ xlog_cursor_openfd(struct xlog_cursor *cursor, int fd, const char *name);
 int
 xlog_cursor_open(struct xlog_cursor *cursor, const char *name);
 
+/**
+ * Open cursor from file and read it through a memory mapping
+ * advised for sequential access, parsing rows of uncompressed
+ * transactions right from the page cache. Only a complete file,
+ * i.e. one ending with an eof marker, is mapped: a file which
+ * is still being written may grow or be truncated. Other files
+ * are read as with xlog_cursor_open().
+ * @param cursor cursor
+ * @param name file name
+ * @retval 0 succes
+ * @retval -1 error, check diag
+ */
+int
+xlog_cursor_open_mmap(struct xlog_cursor *cursor, const char *name);
+
 /**
  * Open cursor from memory
  * @param cursor cursor
@@ -146,6 +146,7 @@ error:
 	if (mp_typeof(**pos) != MP_MAP)
 		goto error;
 	bool has_tsn = false;
+	bool has_wait_vclock_timeout = false;
 	uint32_t flags = 0;
 
 	uint32_t size = mp_decode_map(pos);
@@ -186,6 +187,17 @@ error:
 			flags = mp_decode_uint(pos);
 			header->is_commit = flags & IPROTO_FLAG_COMMIT;
 			break;
+		case IPROTO_TRACE_ID:
+			header->trace_id = mp_decode_uint(pos);
+			break;
+		case IPROTO_WAIT_VCLOCK:
+			header->wait_vclock = *pos;
+			mp_next(pos);
+			break;
+		case IPROTO_WAIT_VCLOCK_TIMEOUT:
+			has_wait_vclock_timeout = true;
+			header->wait_vclock_timeout = mp_decode_double(pos);
+			break;
 		default:
 			/* unknown header */
 			mp_next(pos);
@@ -201,6 +213,8 @@ error:
 	}
 	/* Restore transaction id from lsn and transaction serial number. */
 	header->tsn = header->lsn - header->tsn;
+	if (!has_wait_vclock_timeout)
+		header->wait_vclock_timeout = TIMEOUT_INFINITY;
 
 	/* Nop requests aren't supposed to have a body. */
 	if (*pos < end && header->type != IPROTO_NOP) {
@@ -212,6 +226,7 @@ error:
 		header->bodycnt = 1;
 		header->body[0].iov_base = (void *) body;
 		header->body[0].iov_len = *pos - body;
+		header->is_body_checked = true;
 	}
 	if (end_is_exact && *pos < end) {
 		xrow_on_decode_err(start,end, ER_INVALID_MSGPACK, "packet body");
@@ -250,20 +265,10 @@ xrow_decode_uuid(const char **pos, struct tt_uuid *out)
 	return 0;
 }
 
-int
-xrow_header_encode(const struct xrow_header *header, uint64_t sync,
-		   struct iovec *out, size_t fixheader_len)
+char *
+xrow_header_encode_buf(const struct xrow_header *header, uint64_t sync,
+		       char *data)
 {
-	/* allocate memory for sign + header */
-	out->iov_base = region_alloc(&fiber()->gc, XROW_HEADER_LEN_MAX +
-				     fixheader_len);
-	if (out->iov_base == NULL) {
-		diag_set(OutOfMemory, XROW_HEADER_LEN_MAX + fixheader_len,
-			 "gc arena", "xrow header encode");
-		return -1;
-	}
-	char *data = (char *) out->iov_base + fixheader_len;
-
 	/* Header */
 	char *d = data + 1; /* Skip 1 byte for MP_MAP */
 	int map_size = 0;
@@ -338,6 +343,23 @@ xrow_header_encode(const struct xrow_header *header, uint64_t sync,
 	}
 	assert(d <= data + XROW_HEADER_LEN_MAX);
 	mp_encode_map(data, map_size);
+	return d;
+}
+
+int
+xrow_header_encode(const struct xrow_header *header, uint64_t sync,
+		   struct iovec *out, size_t fixheader_len)
+{
+	/* allocate memory for sign + header */
+	out->iov_base = region_alloc(&fiber()->gc, XROW_HEADER_LEN_MAX +
+				     fixheader_len);
+	if (out->iov_base == NULL) {
+		diag_set(OutOfMemory, XROW_HEADER_LEN_MAX + fixheader_len,
+			 "gc arena", "xrow header encode");
+		return -1;
+	}
+	char *data = (char *) out->iov_base + fixheader_len;
+	char *d = xrow_header_encode_buf(header, sync, data);
 	out->iov_len = d - (char *) out->iov_base;
 	out++;
 
@@ -598,11 +620,19 @@ iproto_prepare_header(struct obuf *buf, struct obuf_svp *svp, size_t size)
 void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count)
+{
+	iproto_reply_select_ext(buf, svp, sync, schema_version, count, 0);
+}
+
+void
+iproto_reply_select_ext(struct obuf *buf, struct obuf_svp *svp,
+			uint64_t sync, uint32_t schema_version,
+			uint32_t count, uint32_t ext_size)
 {
 	char *pos = (char *) obuf_svp_to_ptr(buf, svp);
 	iproto_header_encode(pos, IPROTO_OK, sync, schema_version,
 			        obuf_size(buf) - svp->used -
-				IPROTO_HEADER_LEN);
+				IPROTO_HEADER_LEN + ext_size);
 
 	struct iproto_body_bin body = iproto_body_bin;
 	body.v_data_len = mp_bswap_u32(count);
@@ -610,6 +640,34 @@ iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 	memcpy(pos + IPROTO_HEADER_LEN, &body, sizeof(body));
 }
 
+int
+iproto_reply_select_iterator(struct obuf *buf, struct obuf_svp *svp,
+			     uint64_t sync, uint32_t schema_version,
+			     uint32_t count, uint32_t ext_size,
+			     uint32_t iterator_id)
+{
+	if (iterator_id == 0) {
+		iproto_reply_select_ext(buf, svp, sync, schema_version,
+					count, ext_size);
+		return 0;
+	}
+	size_t size = mp_sizeof_uint(IPROTO_ITERATOR_ID) +
+		      mp_sizeof_uint(iterator_id);
+	char *pos = (char *) obuf_alloc(buf, size);
+	if (pos == NULL) {
+		diag_set(OutOfMemory, size, "obuf_alloc", "pos");
+		return -1;
+	}
+	pos = mp_encode_uint(pos, IPROTO_ITERATOR_ID);
+	mp_encode_uint(pos, iterator_id);
+	iproto_reply_select_ext(buf, svp, sync, schema_version, count,
+				ext_size);
+	/* The body map has two keys: IPROTO_DATA and the id. */
+	pos = (char *) obuf_svp_to_ptr(buf, svp) + IPROTO_HEADER_LEN;
+	mp_encode_map(pos, 2);
+	return 0;
+}
+
 int
 xrow_decode_sql(const struct xrow_header *row, struct sql_request *request)
 {
@@ -633,8 +691,27 @@ error:
 	request->sql_text = NULL;
 	request->bind = NULL;
 	request->stmt_id = NULL;
+	request->fetch_size = 0;
+	request->cursor_id = 0;
+	bool has_cursor_id = false;
 	for (uint32_t i = 0; i < map_size; ++i) {
 		uint8_t key = *data;
+		if (key == IPROTO_SQL_FETCH_SIZE ||
+		    key == IPROTO_SQL_CURSOR_ID) {
+			data++;                 /* skip the key */
+			if (mp_typeof(*data) != MP_UINT)
+				goto error;
+			uint64_t value = mp_decode_uint(&data);
+			if (value > UINT32_MAX)
+				goto error;
+			if (key == IPROTO_SQL_FETCH_SIZE) {
+				request->fetch_size = value;
+			} else {
+				request->cursor_id = value;
+				has_cursor_id = true;
+			}
+			continue;
+		}
 		if (key != IPROTO_SQL_BIND && key != IPROTO_SQL_TEXT &&
 		    key != IPROTO_STMT_ID) {
 			mp_check(&data, end);   /* skip the key */
@@ -651,6 +728,23 @@ error:
 		else
 			request->stmt_id = value;
 	}
+	if (row->type == IPROTO_FETCH) {
+		if (!has_cursor_id) {
+			xrow_on_decode_err(row->body[0].iov_base, end,
+					   ER_MISSING_REQUEST_FIELD,
+					   iproto_key_name(IPROTO_SQL_CURSOR_ID));
+			return -1;
+		}
+		if (request->fetch_size == 0) {
+			xrow_on_decode_err(row->body[0].iov_base, end,
+					   ER_MISSING_REQUEST_FIELD,
+					   iproto_key_name(IPROTO_SQL_FETCH_SIZE));
+			return -1;
+		}
+		if (data != end)
+			goto error;
+		return 0;
+	}
 	if (request->sql_text != NULL && request->stmt_id != NULL) {
 		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
 				   "SQL text and statement id are incompatible "\
@@ -691,6 +785,23 @@ iproto_reply_chunk(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 	memcpy(pos + IPROTO_HEADER_LEN, &body, sizeof(body));
 }
 
+/**
+ * Skip a MsgPack value of a row body. The value is validated
+ * unless the whole body has already been validated on decoding
+ * of the row header. Tuples are the largest part of a DML body,
+ * so this saves a full pass over every incoming tuple.
+ */
+static inline int
+xrow_body_skip(const struct xrow_header *row, const char **data,
+	       const char *end)
+{
+	if (row->is_body_checked) {
+		mp_next(data);
+		return 0;
+	}
+	return mp_check(data, end);
+}
+
 int
 xrow_decode_dml(struct xrow_header *row, struct request *request,
 		uint64_t key_map)
@@ -720,14 +831,14 @@ error:
 	uint32_t size = mp_decode_map(&data);
 	for (uint32_t i = 0; i < size; i++) {
 		if (! iproto_dml_body_has_key(data, end)) {
-			if (mp_check(&data, end) != 0 ||
-			    mp_check(&data, end) != 0)
+			if (xrow_body_skip(row, &data, end) != 0 ||
+			    xrow_body_skip(row, &data, end) != 0)
 				goto error;
 			continue;
 		}
 		uint64_t key = mp_decode_uint(&data);
 		const char *value = data;
-		if (mp_check(&data, end) ||
+		if (xrow_body_skip(row, &data, end) ||
 		    key >= IPROTO_KEY_MAX ||
 		    iproto_key_type[key] != mp_typeof(*value))
 			goto error;
@@ -751,6 +862,9 @@ error:
 		case IPROTO_ITERATOR:
 			request->iterator = mp_decode_uint(&value);
 			break;
+		case IPROTO_ITERATOR_ID:
+			request->iterator_id = mp_decode_uint(&value);
+			break;
 		case IPROTO_TUPLE:
 			request->tuple = value;
 			request->tuple_end = data;
@@ -1102,6 +1216,116 @@ error:
 	return 0;
 }
 
+int
+xrow_decode_batch(const struct xrow_header *row,
+		  struct batch_request *request)
+{
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "missing request body");
+		return -1;
+	}
+
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	assert((end - data) > 0);
+
+	if (mp_typeof(*data) != MP_MAP || mp_check_map(data, end) > 0) {
+error:
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet body");
+		return -1;
+	}
+
+	memset(request, 0, sizeof(*request));
+	request->header = row;
+
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if ((end - data) < 1 || mp_typeof(*data) != MP_UINT)
+			goto error;
+
+		uint64_t key = mp_decode_uint(&data);
+		const char *value = data;
+		if (mp_check(&data, end) != 0)
+			goto error;
+
+		if (key != IPROTO_REQUESTS)
+			continue; /* unknown key */
+		if (mp_typeof(*value) != MP_ARRAY)
+			goto error;
+		request->requests = value;
+		request->requests_end = data;
+	}
+	if (data != end) {
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet end");
+		return -1;
+	}
+	if (request->requests == NULL) {
+		xrow_on_decode_err(row->body[0].iov_base, end,
+				   ER_MISSING_REQUEST_FIELD,
+				   iproto_key_name(IPROTO_REQUESTS));
+		return -1;
+	}
+	return 0;
+}
+
+int
+xrow_decode_batch_next(const char **pos, struct xrow_header *row,
+		       struct request *request)
+{
+	/* The whole array is checked by xrow_decode_batch(). */
+	const char *data = *pos;
+	const char *end = data;
+	mp_next(&end);
+	if (mp_typeof(*data) != MP_MAP) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "batch request");
+		return -1;
+	}
+	uint32_t type = 0;
+	const char *it = data;
+	uint32_t map_size = mp_decode_map(&it);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if (mp_typeof(*it) != MP_UINT) {
+			mp_next(&it);
+			mp_next(&it);
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&it);
+		if (key == IPROTO_REQUEST_TYPE && mp_typeof(*it) == MP_UINT)
+			type = mp_decode_uint(&it);
+		else
+			mp_next(&it);
+	}
+	switch (type) {
+	case IPROTO_INSERT:
+	case IPROTO_REPLACE:
+	case IPROTO_UPDATE:
+	case IPROTO_DELETE:
+	case IPROTO_UPSERT:
+		break;
+	default:
+		diag_set(ClientError, ER_UNKNOWN_REQUEST_TYPE, type);
+		return -1;
+	}
+	memset(row, 0, sizeof(*row));
+	row->type = type;
+	row->bodycnt = 1;
+	row->body[0].iov_base = (void *)data;
+	row->body[0].iov_len = end - data;
+	if (xrow_decode_dml(row, request, dml_request_key_map(type)) != 0)
+		return -1;
+	/*
+	 * The row isn't a real request header, let the redo
+	 * record be encoded from the request.
+	 */
+	request->header = NULL;
+	*pos = end;
+	return 0;
+}
+
 int
 xrow_decode_auth(const struct xrow_header *row, struct auth_request *request)
 {
@@ -1168,6 +1392,64 @@ error:
 	return 0;
 }
 
+int
+xrow_decode_compress(const struct xrow_header *row,
+		     enum compression_type *type)
+{
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "missing request body");
+		return -1;
+	}
+
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	assert((end - data) > 0);
+
+	if (mp_typeof(*data) != MP_MAP || mp_check_map(data, end) > 0) {
+error:
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet body");
+		return -1;
+	}
+
+	const char *name = NULL;
+	uint32_t name_len = 0;
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if ((end - data) < 1 || mp_typeof(*data) != MP_UINT)
+			goto error;
+
+		uint64_t key = mp_decode_uint(&data);
+		const char *value = data;
+		if (mp_check(&data, end) != 0)
+			goto error;
+		if (key != IPROTO_COMPRESSION)
+			continue; /* unknown key */
+		if (mp_typeof(*value) != MP_STR)
+			goto error;
+		name = mp_decode_str(&value, &name_len);
+	}
+	if (data != end) {
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet end");
+		return -1;
+	}
+	if (name == NULL) {
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_MISSING_REQUEST_FIELD,
+				   iproto_key_name(IPROTO_COMPRESSION));
+		return -1;
+	}
+	*type = STRN2ENUM(compression_type, name, name_len);
+	if (*type == compression_type_MAX) {
+		diag_set(ClientError, ER_UNSUPPORTED, "IPROTO",
+			 tt_sprintf("compression '%.*s'", name_len, name));
+		return -1;
+	}
+	return 0;
+}
+
 int
 xrow_encode_auth(struct xrow_header *packet, const char *salt, size_t salt_len,
 		 const char *login, size_t login_len,
@@ -1378,11 +1660,14 @@ xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
 		      const struct vclock *vclock, bool anon,
-		      uint32_t id_filter)
+		      uint32_t id_filter, enum compression_type compression,
+		      const uint32_t *space_filter,
+		      uint32_t space_filter_size)
 {
 	memset(row, 0, sizeof(*row));
 	size_t size = XROW_BODY_LEN_MAX +
-		      mp_sizeof_vclock_ignore0(vclock);
+		      mp_sizeof_vclock_ignore0(vclock) +
+		      space_filter_size * mp_sizeof_uint(UINT32_MAX);
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
 		diag_set(OutOfMemory, size, "region_alloc", "buf");
@@ -1390,7 +1675,14 @@ xrow_encode_subscribe(struct xrow_header *row,
 	}
 	char *data = buf;
 	int filter_size = bit_count_u32(id_filter);
-	data = mp_encode_map(data, filter_size != 0 ? 6 : 5);
+	uint32_t map_size = 5;
+	if (filter_size != 0)
+		map_size++;
+	if (compression != COMPRESSION_TYPE_NONE)
+		map_size++;
+	if (space_filter_size != 0)
+		map_size++;
+	data = mp_encode_map(data, map_size);
 	data = mp_encode_uint(data, IPROTO_CLUSTER_UUID);
 	data = xrow_encode_uuid(data, replicaset_uuid);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
@@ -1412,6 +1704,17 @@ xrow_encode_subscribe(struct xrow_header *row,
 			data = mp_encode_uint(data, id);
 		}
 	}
+	if (compression != COMPRESSION_TYPE_NONE) {
+		data = mp_encode_uint(data, IPROTO_COMPRESSION);
+		const char *name = compression_type_strs[compression];
+		data = mp_encode_str(data, name, strlen(name));
+	}
+	if (space_filter_size != 0) {
+		data = mp_encode_uint(data, IPROTO_SPACE_FILTER);
+		data = mp_encode_array(data, space_filter_size);
+		for (uint32_t i = 0; i < space_filter_size; i++)
+			data = mp_encode_uint(data, space_filter[i]);
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
@@ -1424,7 +1727,7 @@ int
 xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
 		      struct tt_uuid *instance_uuid, struct vclock *vclock,
 		      uint32_t *version_id, bool *anon,
-		      uint32_t *id_filter)
+		      uint32_t *id_filter, enum compression_type *compression)
 {
 	if (row->bodycnt == 0) {
 		diag_set(ClientError, ER_INVALID_MSGPACK, "request body");
@@ -1444,6 +1747,8 @@ xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
 		*anon = false;
 	if (id_filter)
 		*id_filter = 0;
+	if (compression)
+		*compression = COMPRESSION_TYPE_NONE;
 	d = data;
 	uint32_t map_size = mp_decode_map(&d);
 	for (uint32_t i = 0; i < map_size; i++) {
@@ -1519,6 +1824,21 @@ id_filter_decode_err:		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
 				*id_filter |= 1 << val;
 			}
 			break;
+		case IPROTO_COMPRESSION: {
+			if (compression == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_STR) {
+				xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+						   "invalid COMPRESSION");
+				return -1;
+			}
+			uint32_t len;
+			const char *name = mp_decode_str(&d, &len);
+			*compression = STRN2ENUM(compression_type, name, len);
+			if (*compression == compression_type_MAX)
+				*compression = COMPRESSION_TYPE_NONE;
+			break;
+		}
 		default: skip:
 			mp_next(&d); /* value */
 		}
@@ -1526,6 +1846,90 @@ id_filter_decode_err:		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
 	return 0;
 }
 
+int
+xrow_decode_subscribe_space_filter(struct xrow_header *row,
+				   uint32_t **space_filter,
+				   uint32_t *space_filter_size)
+{
+	*space_filter = NULL;
+	*space_filter_size = 0;
+	if (row->bodycnt == 0)
+		return 0;
+	assert(row->bodycnt == 1);
+	const char * const data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP) {
+		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+				   "request body");
+		return -1;
+	}
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		if (mp_decode_uint(&d) != IPROTO_SPACE_FILTER) {
+			mp_next(&d); /* value */
+			continue;
+		}
+		if (mp_typeof(*d) != MP_ARRAY) {
+space_filter_decode_err:
+			xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+					   "invalid SPACE_FILTER");
+			return -1;
+		}
+		uint32_t len = mp_decode_array(&d);
+		size_t size;
+		uint32_t *ids = region_alloc_array(&fiber()->gc, typeof(*ids),
+						   len, &size);
+		if (ids == NULL) {
+			diag_set(OutOfMemory, size, "region_alloc_array",
+				 "ids");
+			return -1;
+		}
+		for (uint32_t j = 0; j < len; j++) {
+			if (mp_typeof(*d) != MP_UINT)
+				goto space_filter_decode_err;
+			uint64_t id = mp_decode_uint(&d);
+			if (id > UINT32_MAX)
+				goto space_filter_decode_err;
+			ids[j] = id;
+		}
+		*space_filter = ids;
+		*space_filter_size = len;
+		break;
+	}
+	return 0;
+}
+
+int
+xrow_decode_wait_vclock(const struct xrow_header *row, struct vclock *vclock)
+{
+	assert(row->wait_vclock != NULL);
+	/* The header is checked by xrow_header_decode(). */
+	const char *d = row->wait_vclock;
+	vclock_create(vclock);
+	uint32_t size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < size; i++) {
+		if (mp_typeof(*d) != MP_UINT)
+			goto error;
+		uint64_t id = mp_decode_uint(&d);
+		if (mp_typeof(*d) != MP_UINT || id >= VCLOCK_MAX)
+			goto error;
+		int64_t lsn = mp_decode_uint(&d);
+		if (id != 0 && lsn > vclock_get(vclock, id))
+			vclock_reset(vclock, id, lsn);
+	}
+	return 0;
+error:
+	diag_set(ClientError, ER_INVALID_MSGPACK, "invalid WAIT_VCLOCK");
+	return -1;
+}
+
 int
 xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
 {
@@ -1578,25 +1982,35 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 int
 xrow_encode_subscribe_response(struct xrow_header *row,
 			       const struct tt_uuid *replicaset_uuid,
-			       const struct vclock *vclock)
+			       const struct vclock *vclock,
+			       enum compression_type compression)
 {
 	memset(row, 0, sizeof(*row));
-	size_t size = mp_sizeof_map(2) +
+	const char *compression_name = compression_type_strs[compression];
+	size_t size = mp_sizeof_map(3) +
 		      mp_sizeof_uint(IPROTO_VCLOCK) +
 		      mp_sizeof_vclock_ignore0(vclock) +
 		      mp_sizeof_uint(IPROTO_CLUSTER_UUID) +
-		      mp_sizeof_str(UUID_STR_LEN);
+		      mp_sizeof_str(UUID_STR_LEN) +
+		      mp_sizeof_uint(IPROTO_COMPRESSION) +
+		      mp_sizeof_str(strlen(compression_name));
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
 		diag_set(OutOfMemory, size, "region_alloc", "buf");
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 2);
+	bool compressed = compression != COMPRESSION_TYPE_NONE;
+	data = mp_encode_map(data, compressed ? 3 : 2);
 	data = mp_encode_uint(data, IPROTO_VCLOCK);
 	data = mp_encode_vclock_ignore0(data, vclock);
 	data = mp_encode_uint(data, IPROTO_CLUSTER_UUID);
 	data = xrow_encode_uuid(data, replicaset_uuid);
+	if (compressed) {
+		data = mp_encode_uint(data, IPROTO_COMPRESSION);
+		data = mp_encode_str(data, compression_name,
+				     strlen(compression_name));
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
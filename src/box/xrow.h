@@ -38,6 +38,7 @@
 #include "uuid/tt_uuid.h"
 #include "diag.h"
 #include "vclock.h"
+#include "field_def.h" /* enum compression_type */
 
 #if defined(__cplusplus)
 extern "C" {
@@ -88,6 +89,25 @@ struct xrow_header {
 	 * tsn and is_commit flag to save space.
 	 */
 	bool is_commit;
+	/**
+	 * True if the body has been validated by
+	 * xrow_header_decode() so that decoders may skip its
+	 * values without checking them once again.
+	 */
+	bool is_body_checked;
+	/**
+	 * Trace id set by the client to have the request
+	 * traced. Isn't written to the write ahead log.
+	 */
+	uint64_t trace_id;
+	/**
+	 * MsgPack map with the vclock to wait for before executing
+	 * the request, see IPROTO_WAIT_VCLOCK, or NULL. Points to
+	 * the request buffer. Isn't written to the write ahead log.
+	 */
+	const char *wait_vclock;
+	/** Timeout of waiting for wait_vclock, in seconds. */
+	double wait_vclock_timeout;
 
 	int bodycnt;
 	uint32_t schema_version;
@@ -124,6 +144,20 @@ int
 xrow_header_encode(const struct xrow_header *header, uint64_t sync,
 		   struct iovec *out, size_t fixheader_len);
 
+/**
+ * Encode the header of an xrow, without the body, to a buffer
+ * of at least XROW_HEADER_LEN_MAX bytes.
+ *
+ * @param header xrow
+ * @param sync sync to encode, not encoded if 0
+ * @param data buffer to encode the header to
+ *
+ * @return the end of the encoded header
+ */
+char *
+xrow_header_encode_buf(const struct xrow_header *header, uint64_t sync,
+		       char *data);
+
 /**
  * Decode xrow from a binary packet
  *
@@ -168,6 +202,8 @@ struct request {
 	uint32_t offset;
 	uint32_t limit;
 	uint32_t iterator;
+	/** Server-side iterator, SELECT_FETCH and SELECT_CLOSE. */
+	uint32_t iterator_id;
 	/** Search key. */
 	const char *key;
 	const char *key_end;
@@ -291,6 +327,55 @@ struct call_request {
 int
 xrow_decode_call(const struct xrow_header *row, struct call_request *request);
 
+/**
+ * BATCH request.
+ */
+struct batch_request {
+	/** Request header */
+	const struct xrow_header *header;
+	/** DML requests. MessagePack Array of Maps. */
+	const char *requests;
+	const char *requests_end;
+};
+
+/**
+ * Decode BATCH request from a given MessagePack map.
+ * @param row request header.
+ * @param[out] request Request to decode to.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_batch(const struct xrow_header *row,
+		  struct batch_request *request);
+
+/**
+ * Decode the next DML request of a BATCH request. Each request
+ * is a map of DML body keys plus IPROTO_REQUEST_TYPE, which may
+ * be INSERT, REPLACE, UPDATE, DELETE or UPSERT.
+ * @param[in/out] pos Position in the array of requests, advanced
+ *        past the decoded one.
+ * @param[out] row Header the request is decoded from. Must stay
+ *        alive as long as the request is used.
+ * @param[out] request DML request to decode to.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_batch_next(const char **pos, struct xrow_header *row,
+		       struct request *request);
+
+/**
+ * Decode COMPRESS request from MessagePack.
+ * @param row request header.
+ * @param[out] type Compression algorithm requested.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_compress(const struct xrow_header *row,
+		     enum compression_type *type);
+
 /**
  * AUTH request
  */
@@ -382,6 +467,12 @@ xrow_encode_register(struct xrow_header *row,
  * @param anon Whether it is an anonymous subscribe request or not.
  * @param id_filter A List of replica ids to skip rows from
  *		    when feeding a replica.
+ * @param compression Compression of the replication stream
+ *		      requested from the master.
+ * @param space_filter Ids of user spaces to relay. Rows of the
+ *		       other user spaces are relayed as NOPs.
+ * @param space_filter_size Number of ids in @a space_filter,
+ *			    0 to relay all spaces.
  *
  * @retval  0 Success.
  * @retval -1 Memory error.
@@ -391,7 +482,9 @@ xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
 		      const struct vclock *vclock, bool anon,
-		      uint32_t id_filter);
+		      uint32_t id_filter, enum compression_type compression,
+		      const uint32_t *space_filter,
+		      uint32_t space_filter_size);
 
 /**
  * Decode SUBSCRIBE command.
@@ -403,6 +496,9 @@ xrow_encode_subscribe(struct xrow_header *row,
  * @param[out] anon Whether it is an anonymous subscribe.
  * @param[out] id_filter A list of ids to skip rows from when
  *			 feeding a replica.
+ * @param[out] compression Compression of the replication
+ *			   stream. An unknown one is decoded as
+ *			   COMPRESSION_TYPE_NONE.
  *
  * @retval  0 Success.
  * @retval -1 Memory or format error.
@@ -411,7 +507,35 @@ int
 xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
 		      struct tt_uuid *instance_uuid, struct vclock *vclock,
 		      uint32_t *version_id, bool *anon,
-		      uint32_t *id_filter);
+		      uint32_t *id_filter, enum compression_type *compression);
+
+/**
+ * Decode the space filter of SUBSCRIBE command.
+ * @param row Row to decode.
+ * @param[out] space_filter Ids of user spaces to relay, allocated
+ *			    on the fiber region.
+ * @param[out] space_filter_size Number of ids, 0 if the request
+ *				 has no filter.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+int
+xrow_decode_subscribe_space_filter(struct xrow_header *row,
+				   uint32_t **space_filter,
+				   uint32_t *space_filter_size);
+
+/**
+ * Decode the vclock passed in IPROTO_WAIT_VCLOCK of a request
+ * header. The 0th component is ignored.
+ * @param row Row to decode.
+ * @param[out] vclock.
+ *
+ * @retval  0 Success.
+ * @retval -1 Format error.
+ */
+int
+xrow_decode_wait_vclock(const struct xrow_header *row, struct vclock *vclock);
 
 /**
  * Encode JOIN command.
@@ -436,7 +560,7 @@ static inline int
 xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid)
 {
 	return xrow_decode_subscribe(row, NULL, instance_uuid, NULL, NULL, NULL,
-				     NULL);
+				     NULL, NULL);
 }
 
 /**
@@ -452,7 +576,7 @@ xrow_decode_register(struct xrow_header *row, struct tt_uuid *instance_uuid,
 		     struct vclock *vclock)
 {
 	return xrow_decode_subscribe(row, NULL, instance_uuid, vclock, NULL,
-				     NULL, NULL);
+				     NULL, NULL, NULL);
 }
 
 /**
@@ -477,7 +601,8 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock);
 static inline int
 xrow_decode_vclock(struct xrow_header *row, struct vclock *vclock)
 {
-	return xrow_decode_subscribe(row, NULL, NULL, vclock, NULL, NULL, NULL);
+	return xrow_decode_subscribe(row, NULL, NULL, vclock, NULL, NULL, NULL,
+				     NULL);
 }
 
 /**
@@ -485,6 +610,8 @@ xrow_decode_vclock(struct xrow_header *row, struct vclock *vclock)
  * @param row[out] Row to encode into.
  * @param replicaset_uuid.
  * @param vclock.
+ * @param compression Compression of the replication stream
+ *		      the master agreed to.
  *
  * @retval 0 Success.
  * @retval -1 Memory error.
@@ -492,13 +619,15 @@ xrow_decode_vclock(struct xrow_header *row, struct vclock *vclock)
 int
 xrow_encode_subscribe_response(struct xrow_header *row,
 			      const struct tt_uuid *replicaset_uuid,
-			      const struct vclock *vclock);
+			      const struct vclock *vclock,
+			      enum compression_type compression);
 
 /**
  * Decode a response to subscribe request.
  * @param row Row to decode.
  * @param[out] replicaset_uuid.
  * @param[out] vclock.
+ * @param[out] compression.
  *
  * @retval 0 Success.
  * @retval -1 Memory or format error.
@@ -506,10 +635,11 @@ xrow_encode_subscribe_response(struct xrow_header *row,
 static inline int
 xrow_decode_subscribe_response(struct xrow_header *row,
 			       struct tt_uuid *replicaset_uuid,
-			       struct vclock *vclock)
+			       struct vclock *vclock,
+			       enum compression_type *compression)
 {
 	return xrow_decode_subscribe(row, replicaset_uuid, NULL, vclock, NULL,
-				     NULL, NULL);
+				     NULL, NULL, compression);
 }
 
 /**
@@ -575,6 +705,28 @@ void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count);
 
+/**
+ * Same as iproto_reply_select(), but @a ext_size bytes of the
+ * body are sent from outside the buffer, right from tuples.
+ */
+void
+iproto_reply_select_ext(struct obuf *buf, struct obuf_svp *svp,
+			uint64_t sync, uint32_t schema_version,
+			uint32_t count, uint32_t ext_size);
+
+/**
+ * Same as iproto_reply_select_ext(), but append IPROTO_ITERATOR_ID
+ * to the body unless @a iterator_id is 0.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+iproto_reply_select_iterator(struct obuf *buf, struct obuf_svp *svp,
+			     uint64_t sync, uint32_t schema_version,
+			     uint32_t count, uint32_t ext_size,
+			     uint32_t iterator_id);
+
 /**
  * Encode iproto header with IPROTO_OK response code.
  * @param out Encode to.
@@ -632,10 +784,17 @@ struct sql_request {
 	const char *bind;
 	/** ID of prepared statement. In this case @sql_text == NULL. */
 	const char *stmt_id;
+	/**
+	 * Maximal number of rows to return at once, or 0 to
+	 * return all rows.
+	 */
+	uint32_t fetch_size;
+	/** ID of SQL cursor to fetch rows from, FETCH only. */
+	uint32_t cursor_id;
 };
 
 /**
- * Parse the EXECUTE request.
+ * Parse the EXECUTE, PREPARE or FETCH request.
  * @param row Encoded data.
  * @param[out] request Request to decode to.
  *
@@ -841,6 +1000,15 @@ xrow_decode_call_xc(const struct xrow_header *row,
 		diag_raise();
 }
 
+/** @copydoc xrow_decode_batch. */
+static inline void
+xrow_decode_batch_xc(const struct xrow_header *row,
+		     struct batch_request *request)
+{
+	if (xrow_decode_batch(row, request) != 0)
+		diag_raise();
+}
+
 /** @copydoc xrow_decode_auth. */
 static inline void
 xrow_decode_auth_xc(const struct xrow_header *row,
@@ -885,10 +1053,13 @@ xrow_encode_subscribe_xc(struct xrow_header *row,
 			 const struct tt_uuid *replicaset_uuid,
 			 const struct tt_uuid *instance_uuid,
 			 const struct vclock *vclock, bool anon,
-			 uint32_t id_filter)
+			 uint32_t id_filter, enum compression_type compression,
+			 const uint32_t *space_filter,
+			 uint32_t space_filter_size)
 {
 	if (xrow_encode_subscribe(row, replicaset_uuid, instance_uuid,
-				  vclock, anon, id_filter) != 0)
+				  vclock, anon, id_filter, compression,
+				  space_filter, space_filter_size) != 0)
 		diag_raise();
 }
 
@@ -898,11 +1069,23 @@ xrow_decode_subscribe_xc(struct xrow_header *row,
 			 struct tt_uuid *replicaset_uuid,
 			 struct tt_uuid *instance_uuid, struct vclock *vclock,
 			 uint32_t *replica_version_id, bool *anon,
-			 uint32_t *id_filter)
+			 uint32_t *id_filter,
+			 enum compression_type *compression)
 {
 	if (xrow_decode_subscribe(row, replicaset_uuid, instance_uuid,
 				  vclock, replica_version_id, anon,
-				  id_filter) != 0)
+				  id_filter, compression) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_decode_subscribe_space_filter. */
+static inline void
+xrow_decode_subscribe_space_filter_xc(struct xrow_header *row,
+				      uint32_t **space_filter,
+				      uint32_t *space_filter_size)
+{
+	if (xrow_decode_subscribe_space_filter(row, space_filter,
+					       space_filter_size) != 0)
 		diag_raise();
 }
 
@@ -952,9 +1135,11 @@ xrow_decode_vclock_xc(struct xrow_header *row, struct vclock *vclock)
 static inline void
 xrow_encode_subscribe_response_xc(struct xrow_header *row,
 				  const struct tt_uuid *replicaset_uuid,
-				  const struct vclock *vclock)
+				  const struct vclock *vclock,
+				  enum compression_type compression)
 {
-	if (xrow_encode_subscribe_response(row, replicaset_uuid, vclock) != 0)
+	if (xrow_encode_subscribe_response(row, replicaset_uuid, vclock,
+					   compression) != 0)
 		diag_raise();
 }
 
@@ -962,9 +1147,11 @@ xrow_encode_subscribe_response_xc(struct xrow_header *row,
 static inline void
 xrow_decode_subscribe_response_xc(struct xrow_header *row,
 				  struct tt_uuid *replicaset_uuid,
-				  struct vclock *vclock)
+				  struct vclock *vclock,
+				  enum compression_type *compression)
 {
-	if (xrow_decode_subscribe_response(row, replicaset_uuid, vclock) != 0)
+	if (xrow_decode_subscribe_response(row, replicaset_uuid, vclock,
+					   compression) != 0)
 		diag_raise();
 }
 
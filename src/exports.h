@@ -29,6 +29,7 @@ EXPORT(box_index_random)
 EXPORT(box_insert)
 EXPORT(box_iterator_free)
 EXPORT(box_iterator_next)
+EXPORT(box_iterator_next_batch)
 EXPORT(box_key_def_delete)
 EXPORT(box_key_def_new)
 EXPORT(box_latch_delete)
@@ -38,6 +39,7 @@ EXPORT(box_latch_trylock)
 EXPORT(box_latch_unlock)
 EXPORT(box_replace)
 EXPORT(box_return_mp)
+EXPORT(box_return_mp_alloc)
 EXPORT(box_return_tuple)
 EXPORT(box_schema_version)
 EXPORT(box_select)
@@ -53,6 +55,7 @@ EXPORT(box_tuple_compare)
 EXPORT(box_tuple_compare_with_key)
 EXPORT(box_tuple_extract_key)
 EXPORT(box_tuple_field)
+EXPORT(box_tuple_field_by_path)
 EXPORT(box_tuple_field_count)
 EXPORT(box_tuple_format)
 EXPORT(box_tuple_format_default)
@@ -69,6 +72,7 @@ EXPORT(box_tuple_rewind)
 EXPORT(box_tuple_seek)
 EXPORT(box_tuple_to_buf)
 EXPORT(box_tuple_unref)
+EXPORT(box_tuple_unref_batch)
 EXPORT(box_tuple_update)
 EXPORT(box_tuple_upsert)
 EXPORT(box_txn)
@@ -347,11 +351,14 @@ EXPORT(password_prepare)
 EXPORT(PMurHash32)
 EXPORT(PMurHash32_Process)
 EXPORT(PMurHash32_Result)
+EXPORT(port_c_destroy_keep_refs)
 EXPORT(port_destroy)
 EXPORT(random_bytes)
 EXPORT(_say)
+EXPORT(say_logger_dropped)
 EXPORT(say_logger_init)
 EXPORT(say_logger_initialized)
+EXPORT(say_logger_set_async)
 EXPORT(say_logrotate)
 EXPORT(say_set_log_format)
 EXPORT(say_set_log_level)
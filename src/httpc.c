@@ -84,14 +84,40 @@ curl_easy_header_cb(char *buffer, size_t size, size_t nitems, void *ctx)
 	return bytes;
 }
 
+/** Check if libcurl is built with HTTP/2 support. */
+static bool
+httpc_http2_is_supported(void)
+{
+#if LIBCURL_VERSION_NUM >= 0x072f00
+	curl_version_info_data *info = curl_version_info(CURLVERSION_NOW);
+	return (info->features & CURL_VERSION_HTTP2) != 0;
+#else
+	return false;
+#endif
+}
+
 int
-httpc_env_create(struct httpc_env *env, int max_conns, int max_total_conns)
+httpc_env_create(struct httpc_env *env, int max_conns, int max_total_conns,
+		 bool http2)
 {
 	memset(env, 0, sizeof(*env));
+	if (http2 && !httpc_http2_is_supported()) {
+		diag_set(IllegalParams, "HTTP/2 is not supported by libcurl");
+		return -1;
+	}
+	env->http2 = http2;
 	mempool_create(&env->req_pool, &cord()->slabc,
 			sizeof(struct httpc_request));
 
-	return curl_env_create(&env->curl_env, max_conns, max_total_conns);
+	if (curl_env_create(&env->curl_env, max_conns, max_total_conns) != 0)
+		return -1;
+#if LIBCURL_VERSION_NUM >= 0x072f00
+	if (http2) {
+		curl_multi_setopt(env->curl_env.multi, CURLMOPT_PIPELINING,
+				  CURLPIPE_MULTIPLEX);
+	}
+#endif
+	return 0;
 }
 
 void
@@ -155,8 +181,20 @@ httpc_request_new(struct httpc_env *env, const char *method,
 	curl_easy_setopt(req->curl_request.easy, CURLOPT_HEADERFUNCTION,
 			 curl_easy_header_cb);
 	curl_easy_setopt(req->curl_request.easy, CURLOPT_NOPROGRESS, 1L);
+	long http_version = CURL_HTTP_VERSION_1_1;
+#if LIBCURL_VERSION_NUM >= 0x072f00
+	if (env->http2) {
+		/*
+		 * Negotiate HTTP/2 over TLS, plain HTTP stays
+		 * 1.1. Wait for a connection which can be
+		 * multiplexed rather than open a new one.
+		 */
+		http_version = CURL_HTTP_VERSION_2TLS;
+		curl_easy_setopt(req->curl_request.easy, CURLOPT_PIPEWAIT, 1L);
+	}
+#endif
 	curl_easy_setopt(req->curl_request.easy, CURLOPT_HTTP_VERSION,
-			 CURL_HTTP_VERSION_1_1);
+			 http_version);
 
 	ibuf_create(&req->body, &cord()->slabc, 1);
 
@@ -407,6 +445,13 @@ httpc_execute(struct httpc_request *req, double timeout)
 	long longval = 0;
 	switch (req->curl_request.code) {
 	case CURLE_OK:
+		curl_easy_getinfo(req->curl_request.easy, CURLINFO_NUM_CONNECTS,
+				  &longval);
+		if (longval > 0)
+			env->stat.connections_created += longval;
+		else
+			++env->stat.connections_reused;
+
 		curl_easy_getinfo(req->curl_request.easy, CURLINFO_RESPONSE_CODE, &longval);
 		req->status = (int) longval;
 
@@ -54,6 +54,10 @@ struct httpc_stat {
 	uint64_t http_other_responses;
 	uint64_t failed_requests;
 	uint64_t active_requests;
+	/** Connections established to serve requests. */
+	uint64_t connections_created;
+	/** Requests served over an already open connection. */
+	uint64_t connections_reused;
 };
 
 /**
@@ -66,17 +70,24 @@ struct httpc_env {
 	struct mempool req_pool;
 	/** Statistics */
 	struct httpc_stat stat;
+	/**
+	 * Use HTTP/2 where the server supports it and multiplex
+	 * requests to the same host over one connection.
+	 */
+	bool http2;
 };
 
 /**
  * @brief Creates  new HTTP client environment
  * @param env pointer to a structure to initialize
  * @param max_conn The maximum number of entries in connection cache
+ * @param http2 Use HTTP/2 multiplexing, see httpc_env::http2
  * @retval 0 on success
  * @retval -1 on error, check diag
  */
 int
-httpc_env_create(struct httpc_env *ctx, int max_conns, int max_total_conns);
+httpc_env_create(struct httpc_env *ctx, int max_conns, int max_total_conns,
+		 bool http2);
 
 /**
  * Destroy HTTP client environment
@@ -86,11 +86,6 @@ tt_bitset_iterator_destroy(struct tt_bitset_iterator *it)
 		it->realloc(it->page, 0);
 	}
 
-	if (it->page_tmp != NULL) {
-		tt_bitset_page_destroy(it->page_tmp);
-		it->realloc(it->page_tmp, 0);
-	}
-
 	memset(it, 0, sizeof(*it));
 }
 
@@ -190,19 +185,11 @@ tt_bitset_iterator_init(struct tt_bitset_iterator *it,
 		tt_bitset_page_destroy(it->page);
 	} else {
 		it->page = it->realloc(NULL, page_alloc_size);
-	}
-
-	tt_bitset_page_create(it->page);
-
-	if (it->page_tmp != NULL) {
-		tt_bitset_page_destroy(it->page_tmp);
-	} else {
-		it->page_tmp = it->realloc(NULL, page_alloc_size);
-		if (it->page_tmp == NULL)
+		if (it->page == NULL)
 			return -1;
 	}
 
-	tt_bitset_page_create(it->page_tmp);
+	tt_bitset_page_create(it->page);
 
 	if (tt_bitset_iterator_reserve(it, expr->size) != 0)
 		return -1;
@@ -302,39 +289,6 @@ tt_bitset_iterator_conj_cmp(const void *p1, const void *p2)
 	}
 }
 
-static void
-tt_bitset_iterator_conj_prepare_page(struct tt_bitset_iterator_conj *conj,
-				     struct tt_bitset_page *dst)
-{
-	assert(conj != NULL);
-	assert(dst != NULL);
-	assert(conj->size > 0);
-	assert(conj->page_first_pos != SIZE_MAX);
-
-	tt_bitset_page_set_ones(dst);
-	for (size_t b = 0; b < conj->size; b++) {
-		if (!conj->pre_nots[b]) {
-			/* conj->pages[b] is rewinded to conj->page_first_pos */
-			assert(conj->pages[b]->first_pos == conj->page_first_pos);
-			tt_bitset_page_and(dst, conj->pages[b]);
-		} else {
-			/*
-			 * If page is NULL or its position is not equal
-			 * to conj->page_first_pos then conj->bitset[b]
-			 * does not have page with the required position and
-			 * all bits in this page are considered to be zeros.
-			 * Since NAND(a, zeros) => a, we can simple skip this
-			 * bitset here.
-			 */
-			if (conj->pages[b] == NULL ||
-			    conj->pages[b]->first_pos != conj->page_first_pos)
-				continue;
-
-			tt_bitset_page_nand(dst, conj->pages[b]);
-		}
-	}
-}
-
 static void
 tt_bitset_iterator_prepare_page(struct tt_bitset_iterator *it)
 {
@@ -357,11 +311,15 @@ tt_bitset_iterator_prepare_page(struct tt_bitset_iterator *it)
 		if (it->conjs[c].page_first_pos > it->page->first_pos)
 			break;
 
-		/* Get result from conj */
-		tt_bitset_iterator_conj_prepare_page(&it->conjs[c],
-						     it->page_tmp);
-		/* OR page from conjunction with it->page */
-		tt_bitset_page_or(it->page, it->page_tmp);
+		struct tt_bitset_iterator_conj *conj = &it->conjs[c];
+		assert(conj->size > 0);
+		/*
+		 * Evaluate the conjunction and OR it with it->page in
+		 * one pass. conj->pages are rewound to conj->page_first_pos
+		 * which is equal to it->page->first_pos here.
+		 */
+		tt_bitset_page_or_conj(it->page, conj->pages, conj->pre_nots,
+				       conj->size);
 	}
 
 	/* Init the bit iterator on it->page */
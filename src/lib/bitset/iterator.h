@@ -68,7 +68,6 @@ struct tt_bitset_iterator {
 	size_t capacity;
 	struct tt_bitset_iterator_conj *conjs;
 	struct tt_bitset_page *page;
-	struct tt_bitset_page *page_tmp;
 	void *(*realloc)(void *ptr, size_t size);
 	struct bit_iterator page_it;
 	/** @endcond **/
@@ -62,6 +62,145 @@ tt_bitset_page_nand(struct tt_bitset_page *dst, struct tt_bitset_page *src);
 extern inline void
 tt_bitset_page_or(struct tt_bitset_page *dst, struct tt_bitset_page *src);
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BITSET_PAGE_HAVE_AVX2 1
+#endif
+
+/**
+ * Returns true if @a page takes part in the conjunction being
+ * evaluated at @a pos. Negated bitsets may lack the page, which
+ * means all zeros and NAND(a, zeros) => a.
+ */
+static inline bool
+tt_bitset_page_in_conj(struct tt_bitset_page *page, bool is_not, size_t pos)
+{
+	(void) is_not;
+	if (page == NULL || page->first_pos != pos) {
+		assert(is_not);
+		return false;
+	}
+	return true;
+}
+
+static void
+tt_bitset_page_or_conj_generic(struct tt_bitset_page *dst,
+			       struct tt_bitset_page **pages,
+			       const bool *nots, size_t count)
+{
+	enum { WORD_COUNT = BITSET_PAGE_DATA_SIZE / sizeof(uint64_t) };
+	uint64_t acc[WORD_COUNT];
+	memset(acc, -1, sizeof(acc));
+	for (size_t b = 0; b < count; b++) {
+		if (!tt_bitset_page_in_conj(pages[b], nots[b], dst->first_pos))
+			continue;
+		const uint64_t *s = tt_bitset_page_data(pages[b]);
+		uint64_t any = 0;
+		if (nots[b]) {
+			for (int i = 0; i < WORD_COUNT; i++)
+				any |= (acc[i] &= ~s[i]);
+		} else {
+			for (int i = 0; i < WORD_COUNT; i++)
+				any |= (acc[i] &= s[i]);
+		}
+		/* AND with anything else won't bring the bits back */
+		if (any == 0)
+			return;
+	}
+	uint64_t *d = tt_bitset_page_data(dst);
+	for (int i = 0; i < WORD_COUNT; i++)
+		d[i] |= acc[i];
+}
+
+#if defined(BITSET_PAGE_HAVE_AVX2)
+
+/**
+ * Same as tt_bitset_page_or_conj_generic(), but keeps the whole
+ * intermediate page in AVX2 registers. Page data is not guaranteed
+ * to be 32-byte aligned, hence unaligned loads and stores.
+ */
+__attribute__((target("avx2"))) static void
+tt_bitset_page_or_conj_avx2(struct tt_bitset_page *dst,
+			    struct tt_bitset_page **pages,
+			    const bool *nots, size_t count)
+{
+	enum { VEC_COUNT = BITSET_PAGE_DATA_SIZE / sizeof(__m256i) };
+	static_assert(BITSET_PAGE_DATA_SIZE % sizeof(__m256i) == 0,
+		      "page size must be a multiple of AVX2 register size");
+	__m256i acc[VEC_COUNT];
+	for (int i = 0; i < VEC_COUNT; i++)
+		acc[i] = _mm256_set1_epi8(-1);
+	for (size_t b = 0; b < count; b++) {
+		if (!tt_bitset_page_in_conj(pages[b], nots[b], dst->first_pos))
+			continue;
+		const __m256i *s = tt_bitset_page_data(pages[b]);
+		__m256i any = _mm256_setzero_si256();
+		if (nots[b]) {
+			for (int i = 0; i < VEC_COUNT; i++) {
+				acc[i] = _mm256_andnot_si256(
+					_mm256_loadu_si256(s + i), acc[i]);
+				any = _mm256_or_si256(any, acc[i]);
+			}
+		} else {
+			for (int i = 0; i < VEC_COUNT; i++) {
+				acc[i] = _mm256_and_si256(
+					_mm256_loadu_si256(s + i), acc[i]);
+				any = _mm256_or_si256(any, acc[i]);
+			}
+		}
+		if (_mm256_testz_si256(any, any))
+			return;
+	}
+	__m256i *d = tt_bitset_page_data(dst);
+	for (int i = 0; i < VEC_COUNT; i++) {
+		_mm256_storeu_si256(d + i, _mm256_or_si256(
+				_mm256_loadu_si256(d + i), acc[i]));
+	}
+}
+
+#endif /* defined(BITSET_PAGE_HAVE_AVX2) */
+
+typedef void
+(*tt_bitset_page_or_conj_f)(struct tt_bitset_page *dst,
+			    struct tt_bitset_page **pages,
+			    const bool *nots, size_t count);
+
+static void
+tt_bitset_page_or_conj_resolve(struct tt_bitset_page *dst,
+			       struct tt_bitset_page **pages,
+			       const bool *nots, size_t count);
+
+/**
+ * Implementation picked on the first call. The library doesn't
+ * link with cpu_feature.c, so the CPU is probed with the compiler
+ * builtin. Concurrent resolution is harmless: every thread stores
+ * the same value.
+ */
+static tt_bitset_page_or_conj_f tt_bitset_page_or_conj_impl =
+	tt_bitset_page_or_conj_resolve;
+
+static void
+tt_bitset_page_or_conj_resolve(struct tt_bitset_page *dst,
+			       struct tt_bitset_page **pages,
+			       const bool *nots, size_t count)
+{
+	tt_bitset_page_or_conj_impl = tt_bitset_page_or_conj_generic;
+#if defined(BITSET_PAGE_HAVE_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		tt_bitset_page_or_conj_impl = tt_bitset_page_or_conj_avx2;
+#endif /* defined(BITSET_PAGE_HAVE_AVX2) */
+	tt_bitset_page_or_conj_impl(dst, pages, nots, count);
+}
+
+void
+tt_bitset_page_or_conj(struct tt_bitset_page *dst,
+		       struct tt_bitset_page **pages, const bool *nots,
+		       size_t count)
+{
+	tt_bitset_page_or_conj_impl(dst, pages, nots, count);
+}
+
 #if defined(DEBUG)
 void
 tt_bitset_page_dump(struct tt_bitset_page *page, FILE *stream)
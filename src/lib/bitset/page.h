@@ -187,6 +187,22 @@ tt_bitset_page_or(struct tt_bitset_page *dst, struct tt_bitset_page *src)
 	}
 }
 
+/**
+ * @brief Evaluate a conjunction of pages and OR the result into \a dst.
+ *
+ * Computes dst |= AND(pages[b] or ~pages[b] if nots[b]) in a single
+ * pass over the sources, without materializing the intermediate page.
+ * Negated pages that are NULL or located at a position other than
+ * dst->first_pos are treated as all zeros and skipped. Evaluation
+ * stops early as soon as the intermediate result becomes zero.
+ *
+ * Uses AVX2 if it is available at runtime.
+ */
+void
+tt_bitset_page_or_conj(struct tt_bitset_page *dst,
+		       struct tt_bitset_page **pages, const bool *nots,
+		       size_t count);
+
 #if defined(DEBUG)
 void
 tt_bitset_page_dump(struct tt_bitset_page *page, FILE *stream);
@@ -80,6 +80,14 @@ coll_icu_cmp(const char *s, size_t slen, const char *t, size_t tlen,
 	     const struct coll *coll)
 {
 	assert(coll->collator != NULL);
+	/*
+	 * Tuple comparison hints resolve most comparisons of
+	 * different strings by the sort key prefix, so those
+	 * that get here are often equal. Don't ask ICU to
+	 * build collation elements for identical strings.
+	 */
+	if (slen == tlen && memcmp(s, t, slen) == 0)
+		return 0;
 
 	UErrorCode status = U_ZERO_ERROR;
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "text_tokenizer.h"
+#include "coll.h"
+#include "diag.h"
+
+#include <stdlib.h>
+#include <unicode/ubrk.h>
+#include <unicode/utext.h>
+#include <unicode/ucasemap.h>
+
+int
+text_tokenizer_create(struct text_tokenizer *tokenizer)
+{
+	UErrorCode status = U_ZERO_ERROR;
+	tokenizer->brk = ubrk_open(UBRK_WORD, "", NULL, 0, &status);
+	if (U_FAILURE(status)) {
+		diag_set(CollationError, "failed to create word break "
+			 "iterator: %s", u_errorName(status));
+		return -1;
+	}
+	tokenizer->text = NULL;
+	tokenizer->buf = NULL;
+	tokenizer->buf_size = 0;
+	tokenizer->pos = 0;
+	return 0;
+}
+
+void
+text_tokenizer_destroy(struct text_tokenizer *tokenizer)
+{
+	ubrk_close(tokenizer->brk);
+	if (tokenizer->text != NULL)
+		utext_close(tokenizer->text);
+	free(tokenizer->buf);
+}
+
+int
+text_tokenizer_start(struct text_tokenizer *tokenizer, const char *str,
+		     uint32_t len)
+{
+	UErrorCode status = U_ZERO_ERROR;
+	int32_t size;
+	while (true) {
+		status = U_ZERO_ERROR;
+		size = ucasemap_utf8FoldCase(icu_ucase_default_map,
+					     tokenizer->buf,
+					     tokenizer->buf_size, str, len,
+					     &status);
+		if (status != U_BUFFER_OVERFLOW_ERROR)
+			break;
+		/* Folding may change the length of a string. */
+		size_t buf_size = (size_t)size + 1;
+		char *buf = realloc(tokenizer->buf, buf_size);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, buf_size, "realloc",
+				 "tokenizer buffer");
+			return -1;
+		}
+		tokenizer->buf = buf;
+		tokenizer->buf_size = buf_size;
+	}
+	if (U_FAILURE(status))
+		goto error;
+	tokenizer->text = utext_openUTF8(tokenizer->text, tokenizer->buf,
+					 size, &status);
+	if (U_FAILURE(status))
+		goto error;
+	ubrk_setUText(tokenizer->brk, tokenizer->text, &status);
+	if (U_FAILURE(status))
+		goto error;
+	tokenizer->pos = ubrk_first(tokenizer->brk);
+	return 0;
+error:
+	diag_set(CollationError, "failed to split text: %s",
+		 u_errorName(status));
+	return -1;
+}
+
+const char *
+text_tokenizer_next(struct text_tokenizer *tokenizer, uint32_t *len)
+{
+	int32_t begin = tokenizer->pos;
+	int32_t end;
+	while ((end = ubrk_next(tokenizer->brk)) != UBRK_DONE) {
+		tokenizer->pos = end;
+		int32_t rule = ubrk_getRuleStatus(tokenizer->brk);
+		/* Skip spaces and punctuation. */
+		if (rule >= UBRK_WORD_NONE_LIMIT) {
+			/* UTF-8 text indexes are byte offsets. */
+			*len = end - begin;
+			return tokenizer->buf + begin;
+		}
+		begin = end;
+	}
+	return NULL;
+}
@@ -0,0 +1,101 @@
+#ifndef TARANTOOL_LIB_COLL_TEXT_TOKENIZER_H_INCLUDED
+#define TARANTOOL_LIB_COLL_TEXT_TOKENIZER_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct UBreakIterator;
+struct UText;
+
+/**
+ * Splits a UTF-8 string into words using the ICU word break
+ * rules of the root locale. Words are case folded, so that
+ * tokens of strings differing only in case are equal. Spaces
+ * and punctuation aren't returned.
+ *
+ * A tokenizer is reusable: it keeps a buffer for the case folded
+ * string and the ICU break iterator between strings.
+ */
+struct text_tokenizer {
+	/** ICU word break iterator. */
+	struct UBreakIterator *brk;
+	/** ICU text over @a buf the break iterator runs on. */
+	struct UText *text;
+	/** Case folded string being split. */
+	char *buf;
+	/** Size of @a buf. */
+	size_t buf_size;
+	/** Offset of the end of the last returned token in @a buf. */
+	int32_t pos;
+};
+
+/**
+ * Initialize a tokenizer.
+ * @retval  0 Success.
+ * @retval -1 ICU error, diag is set.
+ */
+int
+text_tokenizer_create(struct text_tokenizer *tokenizer);
+
+/** Free memory used by a tokenizer. */
+void
+text_tokenizer_destroy(struct text_tokenizer *tokenizer);
+
+/**
+ * Start splitting a string. The string is copied, so it may be
+ * freed while the tokenizer is used.
+ * @retval  0 Success.
+ * @retval -1 Memory or ICU error, diag is set.
+ */
+int
+text_tokenizer_start(struct text_tokenizer *tokenizer, const char *str,
+		     uint32_t len);
+
+/**
+ * Return the next word of the string passed to
+ * text_tokenizer_start() or NULL if there are no more words.
+ * The returned string isn't zero terminated and is valid until
+ * the next call to text_tokenizer_start().
+ */
+const char *
+text_tokenizer_next(struct text_tokenizer *tokenizer, uint32_t *len);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_COLL_TEXT_TOKENIZER_H_INCLUDED */
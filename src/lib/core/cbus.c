@@ -31,9 +31,40 @@
 #include "cbus.h"
 
 #include <limits.h>
+#include <pmatomic.h>
 #include "fiber.h"
+#include "clock.h"
 #include "trigger.h"
 
+enum {
+	/**
+	 * The number of iterations a consumer starts spinning
+	 * for once its ring gets input.
+	 */
+	CBUS_SPIN_MIN = 64,
+	/** The maximal number of spin iterations. */
+	CBUS_SPIN_MAX = 16384,
+	/**
+	 * Busy polling time never drops below the configured
+	 * timeout divided by this.
+	 */
+	CBUS_BUSY_POLL_MIN_FACTOR = 16,
+};
+
+/** Busy polling state of a cord, see cbus_set_busy_poll(). */
+struct cbus_poller {
+	/** Endpoints consumed by the cord. */
+	struct rlist endpoints;
+	/** Polls the endpoints before the cord loop goes to sleep. */
+	struct ev_prepare prepare;
+	/** The configured polling time, 0 if polling is off. */
+	double timeout;
+	/** The time to poll for next time. */
+	double budget;
+};
+
+static __thread struct cbus_poller cbus_poller;
+
 /**
  * Cord interconnect.
  */
@@ -109,21 +140,36 @@ cpipe_create(struct cpipe *pipe, const char *consumer)
 	}
 	pipe->endpoint = endpoint;
 	++pipe->endpoint->n_pipes;
+	pipe->ring = NULL;
+	if (endpoint->ring.owner == NULL) {
+		endpoint->ring.owner = pipe;
+		pipe->ring = &endpoint->ring;
+	}
 	tt_pthread_mutex_unlock(&cbus.mutex);
 }
 
 struct cmsg_poison {
 	struct cmsg msg;
 	struct cbus_endpoint *endpoint;
+	/** The destroyed pipe. */
+	struct cpipe *pipe;
 };
 
 static void
 cbus_endpoint_poison_f(struct cmsg *msg)
 {
-	struct cbus_endpoint *endpoint = ((struct cmsg_poison *)msg)->endpoint;
+	struct cmsg_poison *poison = (struct cmsg_poison *)msg;
+	struct cbus_endpoint *endpoint = poison->endpoint;
 	tt_pthread_mutex_lock(&cbus.mutex);
 	assert(endpoint->n_pipes > 0);
 	--endpoint->n_pipes;
+	/*
+	 * The poison is delivered after all messages the pipe
+	 * pushed to the ring, so the ring is empty and may be
+	 * given to the next pipe.
+	 */
+	if (endpoint->ring.owner == poison->pipe)
+		endpoint->ring.owner = NULL;
 	tt_pthread_mutex_unlock(&cbus.mutex);
 	fiber_cond_signal(&endpoint->cond);
 	free(msg);
@@ -150,10 +196,13 @@ cpipe_destroy(struct cpipe *pipe)
 	struct cmsg_poison *poison = malloc(sizeof(struct cmsg_poison));
 	cmsg_init(&poison->msg, route);
 	poison->endpoint = pipe->endpoint;
+	poison->pipe = pipe;
 	/*
 	 * Avoid the general purpose cpipe_push_input() since
 	 * we want to control the way the poison message is
-	 * delivered.
+	 * delivered. The consumer fetches the ring after the
+	 * output, so the messages pushed to the ring before
+	 * are delivered before the ones flushed here.
 	 */
 	tt_pthread_mutex_lock(&endpoint->mutex);
 	/* Flush input */
@@ -161,6 +210,8 @@ cpipe_destroy(struct cpipe *pipe)
 	pipe->n_input = 0;
 	/* Add the pipe shutdown message as the last one. */
 	stailq_add_tail_entry(&endpoint->output, poison, msg.fifo);
+	pm_atomic_store_explicit(&endpoint->has_output, true,
+				 pm_memory_order_relaxed);
 	/* Count statistics */
 	rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
 	/*
@@ -192,6 +243,227 @@ cbus_create(struct cbus *bus)
 	rlist_create(&bus->endpoints);
 }
 
+static inline void
+cbus_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+static void
+cbus_ring_create(struct cbus_ring *ring)
+{
+	ring->tail = 0;
+	ring->head = 0;
+	ring->is_spinning = false;
+	ring->spin = 0;
+	ring->owner = NULL;
+}
+
+/**
+ * Push the pipe input to the ring as one batch. Wake up the
+ * consumer if it has already fetched everything pushed before
+ * and isn't spinning.
+ *
+ * @retval false the ring is full, nothing was pushed
+ */
+static bool
+cbus_ring_push(struct cbus_ring *ring, struct cbus_endpoint *endpoint,
+	       struct stailq *input)
+{
+	unsigned tail = ring->tail;
+	unsigned head = pm_atomic_load_explicit(&ring->head,
+						pm_memory_order_acquire);
+	if (tail - head == CBUS_RING_SIZE)
+		return false;
+	struct cbus_ring_slot *slot = &ring->slots[tail % CBUS_RING_SIZE];
+	slot->first = input->first;
+	slot->last = input->last;
+	pm_atomic_store_explicit(&ring->tail, tail + 1,
+				 pm_memory_order_release);
+	/*
+	 * Pairs with the fence in cbus_ring_fetch() and
+	 * cbus_endpoint_set_spinning(): either the consumer sees
+	 * the new tail, or we see that it is done with the ring.
+	 */
+	pm_atomic_thread_fence(pm_memory_order_seq_cst);
+	head = pm_atomic_load_explicit(&ring->head, pm_memory_order_relaxed);
+	bool is_spinning = pm_atomic_load_explicit(&ring->is_spinning,
+						   pm_memory_order_relaxed);
+	if (head == tail && !is_spinning) {
+		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
+		ev_async_send(endpoint->consumer, &endpoint->async);
+	}
+	stailq_create(input);
+	return true;
+}
+
+/** Move all batches from the ring to the output list. */
+static void
+cbus_ring_fetch(struct cbus_ring *ring, struct stailq *output)
+{
+	unsigned head = ring->head;
+	unsigned tail = pm_atomic_load_explicit(&ring->tail,
+						pm_memory_order_acquire);
+	if (head == tail)
+		return;
+	do {
+		for (; head != tail; head++) {
+			struct cbus_ring_slot *slot =
+				&ring->slots[head % CBUS_RING_SIZE];
+			*output->last = slot->first;
+			output->last = slot->last;
+		}
+		pm_atomic_store_explicit(&ring->head, head,
+					 pm_memory_order_release);
+		pm_atomic_thread_fence(pm_memory_order_seq_cst);
+		tail = pm_atomic_load_explicit(&ring->tail,
+					       pm_memory_order_acquire);
+	} while (head != tail);
+	/* The ring is in use, it's worth spinning for it. */
+	if (ring->spin == 0)
+		ring->spin = CBUS_SPIN_MIN;
+}
+
+/**
+ * Check if there are messages in the ring or the output of
+ * the endpoint which haven't been fetched yet.
+ */
+static inline bool
+cbus_endpoint_has_input(struct cbus_endpoint *endpoint)
+{
+	return pm_atomic_load_explicit(&endpoint->ring.tail,
+				       pm_memory_order_relaxed) !=
+	       endpoint->ring.head ||
+	       pm_atomic_load_explicit(&endpoint->has_output,
+				       pm_memory_order_relaxed);
+}
+
+/**
+ * Tell producers that the consumer is spinning and will notice
+ * new messages without being woken up.
+ */
+static inline void
+cbus_endpoint_set_spinning(struct cbus_endpoint *endpoint, bool value)
+{
+	pm_atomic_store_explicit(&endpoint->ring.is_spinning, value,
+				 pm_memory_order_relaxed);
+	/*
+	 * Pairs with the fence in cbus_ring_push() and
+	 * cpipe_flush_cb(): once the flag is cleared, either
+	 * we see the new messages, or the producer sees that
+	 * it must wake us up.
+	 */
+	pm_atomic_thread_fence(pm_memory_order_seq_cst);
+}
+
+/**
+ * Spin for input before the consumer loop goes to sleep, so
+ * that a producer doesn't need to wake it up with a syscall.
+ * Adapts the number of iterations to how often spinning pays
+ * off. Busy polling, if enabled, supersedes this.
+ */
+static void
+cbus_endpoint_prepare_cb(ev_loop *loop, struct ev_prepare *watcher,
+			 int events)
+{
+	(void) events;
+	struct cbus_endpoint *endpoint = (struct cbus_endpoint *) watcher->data;
+	struct cbus_ring *ring = &endpoint->ring;
+	if (ring->spin == 0 || cbus_poller.timeout > 0 ||
+	    ev_pending_count(loop) > 0)
+		return;
+	bool has_input = false;
+	cbus_endpoint_set_spinning(endpoint, true);
+	for (int i = 0; i < ring->spin && !has_input; i++) {
+		cbus_cpu_relax();
+		has_input = cbus_endpoint_has_input(endpoint);
+	}
+	cbus_endpoint_set_spinning(endpoint, false);
+	if (!has_input)
+		has_input = cbus_endpoint_has_input(endpoint);
+	if (has_input) {
+		ring->spin = MIN(ring->spin * 2, CBUS_SPIN_MAX);
+		ev_feed_event(loop, &endpoint->async, EV_CUSTOM);
+	} else {
+		ring->spin /= 2;
+	}
+}
+
+static void
+cbus_poller_prepare_cb(ev_loop *loop, struct ev_prepare *watcher,
+		       int events);
+
+/** Get the busy polling state of the current cord. */
+static struct cbus_poller *
+cbus_poller_get(void)
+{
+	struct cbus_poller *poller = &cbus_poller;
+	if (poller->endpoints.next == NULL) {
+		rlist_create(&poller->endpoints);
+		ev_prepare_init(&poller->prepare, cbus_poller_prepare_cb);
+		poller->prepare.data = poller;
+		poller->timeout = 0;
+		poller->budget = 0;
+	}
+	return poller;
+}
+
+/**
+ * Poll all endpoints of the cord until one of them gets input
+ * or the polling time is over, then adapt the polling time:
+ * restore it if polling paid off, halve it otherwise.
+ */
+static void
+cbus_poller_prepare_cb(ev_loop *loop, struct ev_prepare *watcher,
+		       int events)
+{
+	(void) events;
+	struct cbus_poller *poller = (struct cbus_poller *) watcher->data;
+	if (ev_pending_count(loop) > 0 || rlist_empty(&poller->endpoints))
+		return;
+	struct cbus_endpoint *endpoint;
+	rlist_foreach_entry(endpoint, &poller->endpoints, in_cord)
+		cbus_endpoint_set_spinning(endpoint, true);
+	bool has_input = false;
+	double deadline = clock_monotonic() + poller->budget;
+	do {
+		cbus_cpu_relax();
+		rlist_foreach_entry(endpoint, &poller->endpoints, in_cord)
+			has_input = has_input ||
+				    cbus_endpoint_has_input(endpoint);
+	} while (!has_input && clock_monotonic() < deadline);
+	rlist_foreach_entry(endpoint, &poller->endpoints, in_cord) {
+		cbus_endpoint_set_spinning(endpoint, false);
+		if (cbus_endpoint_has_input(endpoint)) {
+			has_input = true;
+			ev_feed_event(loop, &endpoint->async, EV_CUSTOM);
+		}
+	}
+	if (has_input) {
+		poller->budget = poller->timeout;
+	} else {
+		poller->budget = MAX(poller->budget / 2, poller->timeout /
+				     CBUS_BUSY_POLL_MIN_FACTOR);
+	}
+}
+
+void
+cbus_set_busy_poll(double timeout)
+{
+	assert(timeout >= 0);
+	struct cbus_poller *poller = cbus_poller_get();
+	poller->timeout = timeout;
+	poller->budget = timeout;
+	if (timeout > 0)
+		ev_prepare_start(loop(), &poller->prepare);
+	else
+		ev_prepare_stop(loop(), &poller->prepare);
+}
+
 static void
 cbus_destroy(struct cbus *bus)
 {
@@ -228,10 +500,16 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 	fiber_cond_create(&endpoint->cond);
 	tt_pthread_mutex_init(&endpoint->mutex, NULL);
 	stailq_create(&endpoint->output);
+	endpoint->has_output = false;
+	cbus_ring_create(&endpoint->ring);
 	ev_async_init(&endpoint->async,
 		      (void (*)(ev_loop *, struct ev_async *, int)) fetch_cb);
 	endpoint->async.data = fetch_data;
 	ev_async_start(endpoint->consumer, &endpoint->async);
+	ev_prepare_init(&endpoint->prepare, cbus_endpoint_prepare_cb);
+	endpoint->prepare.data = endpoint;
+	ev_prepare_start(endpoint->consumer, &endpoint->prepare);
+	rlist_add_tail_entry(&cbus_poller_get()->endpoints, endpoint, in_cord);
 
 	rlist_add_tail(&cbus.endpoints, &endpoint->in_cbus);
 	/*
@@ -273,6 +551,9 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 	tt_pthread_mutex_lock(&endpoint->mutex);
 	tt_pthread_mutex_unlock(&endpoint->mutex);
 	tt_pthread_mutex_destroy(&endpoint->mutex);
+	assert(endpoint->ring.head == endpoint->ring.tail);
+	ev_prepare_stop(endpoint->consumer, &endpoint->prepare);
+	rlist_del_entry(endpoint, in_cord);
 	ev_async_stop(endpoint->consumer, &endpoint->async);
 	fiber_cond_destroy(&endpoint->cond);
 	TRASH(endpoint);
@@ -304,14 +585,37 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 	int old_cancel_state;
 	tt_pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancel_state);
 
+	if (pipe->ring != NULL) {
+		if (cbus_ring_push(pipe->ring, endpoint, &pipe->input)) {
+			pipe->n_input = 0;
+			tt_pthread_setcancelstate(old_cancel_state, NULL);
+			return;
+		}
+		/*
+		 * The consumer lags behind. Switch to the output
+		 * for good: were the pipe to return to the ring,
+		 * its messages could be delivered out of order.
+		 */
+		pipe->ring = NULL;
+	}
+
 	tt_pthread_mutex_lock(&endpoint->mutex);
 	output_was_empty = stailq_empty(&endpoint->output);
 	/** Flush input */
 	stailq_concat(&endpoint->output, &pipe->input);
+	pm_atomic_store_explicit(&endpoint->has_output, true,
+				 pm_memory_order_relaxed);
 	tt_pthread_mutex_unlock(&endpoint->mutex);
 
 	pipe->n_input = 0;
+	/* A spinning consumer will notice the output itself. */
 	if (output_was_empty) {
+		/* Pairs with cbus_endpoint_set_spinning(). */
+		pm_atomic_thread_fence(pm_memory_order_seq_cst);
+	}
+	if (output_was_empty &&
+	    !pm_atomic_load_explicit(&endpoint->ring.is_spinning,
+				     pm_memory_order_relaxed)) {
 		/* Count statistics */
 		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
 
@@ -646,6 +950,28 @@ cbus_unpair(struct cpipe *dest_pipe, struct cpipe *src_pipe,
 	cpipe_destroy(dest_pipe);
 }
 
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
+{
+	/*
+	 * The output must be taken before the ring: a pipe
+	 * which has switched from the ring to the output could
+	 * have its messages delivered out of order otherwise.
+	 */
+	struct stailq locked;
+	stailq_create(&locked);
+	if (pm_atomic_load_explicit(&endpoint->has_output,
+				    pm_memory_order_acquire)) {
+		tt_pthread_mutex_lock(&endpoint->mutex);
+		stailq_concat(&locked, &endpoint->output);
+		pm_atomic_store_explicit(&endpoint->has_output, false,
+					 pm_memory_order_relaxed);
+		tt_pthread_mutex_unlock(&endpoint->mutex);
+	}
+	cbus_ring_fetch(&endpoint->ring, output);
+	stailq_concat(output, &locked);
+}
+
 void
 cbus_process(struct cbus_endpoint *endpoint)
 {
@@ -30,6 +30,7 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include "trivia/config.h"
 #include "fiber.h"
 #include "fiber_cond.h"
 #include "rmean.h"
@@ -135,6 +136,12 @@ struct cpipe {
 	 * flushed messages.
 	 */
 	struct cbus_endpoint *endpoint;
+	/**
+	 * The single producer ring of the endpoint if this pipe
+	 * owns it, NULL if the pipe flushes input into the
+	 * mutex-protected endpoint output.
+	 */
+	struct cbus_ring *ring;
 	/**
 	 * Triggers to call on flush event, if the input queue
 	 * is not empty.
@@ -244,6 +251,47 @@ cpipe_push(struct cpipe *pipe, struct cmsg *msg)
 		ev_feed_event(pipe->producer, &pipe->flush_input, EV_CUSTOM);
 }
 
+enum {
+	/** Number of message batches a cbus ring can hold. */
+	CBUS_RING_SIZE = 256,
+};
+
+/** A batch of messages flushed from a pipe at once. */
+struct cbus_ring_slot {
+	/** The first message of the batch. */
+	struct stailq_entry *first;
+	/** The link field of the last message of the batch. */
+	struct stailq_entry **last;
+};
+
+/**
+ * A lock-free single producer single consumer ring of message
+ * batches. Each endpoint has one, it is owned by the first pipe
+ * connected to the endpoint. Messages pushed to this pipe are
+ * delivered without taking the endpoint mutex, and the consumer
+ * isn't woken up with ev_async_send() if it is known to be busy
+ * or spinning for input. Other pipes use the mutex-protected
+ * endpoint output, as does the owner once the ring gets full.
+ */
+struct cbus_ring {
+	/** Index of the next slot to write, advanced by producer. */
+	alignas(CACHELINE_SIZE) unsigned tail;
+	/** Index of the next slot to read, advanced by consumer. */
+	alignas(CACHELINE_SIZE) unsigned head;
+	/** Set while the consumer is spinning waiting for input. */
+	bool is_spinning;
+	/**
+	 * The number of iterations the consumer spins for before
+	 * going to sleep. Grows when spinning pays off, shrinks
+	 * otherwise.
+	 */
+	int spin;
+	/** The pipe which owns the ring, protected by cbus mutex. */
+	struct cpipe *owner;
+	/** Message batches. */
+	struct cbus_ring_slot slots[CBUS_RING_SIZE];
+};
+
 /**
  * cbus endpoint
  */
@@ -259,10 +307,21 @@ struct cbus_endpoint {
 	pthread_mutex_t mutex;
 	/** A queue with incoming messages. */
 	struct stailq output;
+	/**
+	 * Set if the output is not empty. Lets the consumer skip
+	 * taking the mutex if all messages come via the ring.
+	 */
+	bool has_output;
 	/** Consumer cord loop */
 	ev_loop *consumer;
 	/** Async to notify the consumer */
 	ev_async async;
+	/** Spins for ring input before the consumer goes to sleep. */
+	ev_prepare prepare;
+	/** Link in the list of endpoints of the consumer cord. */
+	struct rlist in_cord;
+	/** Single producer ring, see struct cbus_ring. */
+	struct cbus_ring ring;
 	/** Count of connected pipes */
 	uint32_t n_pipes;
 	/** Condition for endpoint destroy */
@@ -272,13 +331,8 @@ struct cbus_endpoint {
 /**
  * Fetch incomming messages to output
  */
-static inline void
-cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
-{
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	stailq_concat(output, &endpoint->output);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-}
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output);
 
 /** Initialize the global singleton bus. */
 void
@@ -304,6 +358,17 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 void
 cbus_process(struct cbus_endpoint *endpoint);
 
+/**
+ * Make the current cord poll the endpoints it consumes from for
+ * up to @a timeout seconds before its event loop goes to sleep,
+ * so that producers don't need to wake it up with a syscall.
+ * The actual polling time shrinks while polling brings no
+ * messages and is restored once it does. Zero turns busy polling
+ * off, which is the default.
+ */
+void
+cbus_set_busy_poll(double timeout);
+
 /**
  * Run the message delivery loop until the current fiber is
  * cancelled.
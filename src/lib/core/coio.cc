@@ -200,14 +200,15 @@ coio_connect_timeout(struct ev_io *coio, struct uri *uri, struct sockaddr *addr,
 	    hints.ai_socktype = SOCK_STREAM;
 	    hints.ai_flags = AI_ADDRCONFIG|AI_NUMERICSERV|AI_PASSIVE;
 	    hints.ai_protocol = 0;
-	    int rc = coio_getaddrinfo(host, service, &hints, &ai, delay);
+	    int rc = coio_getaddrinfo_cached(host, service, &hints, &ai,
+					     delay);
 	    if (rc != 0) {
 		    diag_raise();
 		    panic("unspecified getaddrinfo error");
 	    }
 	}
 	auto addrinfo_guard = make_scoped_guard([=] {
-		if (!uri->host_hint) freeaddrinfo(ai);
+		if (!uri->host_hint) coio_freeaddrinfo(ai);
 		else free(ai_local.ai_addr);
 	});
 	evio_timeout_update(loop(), &start, &delay);
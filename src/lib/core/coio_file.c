@@ -30,6 +30,7 @@
  */
 #include "coio_file.h"
 #include "coio_task.h"
+#include "coio_uring.h"
 #include "fiber.h"
 #include "say.h"
 #include "fio.h"
@@ -147,6 +148,8 @@ coio_wait_done(eio_req *req, struct coio_file_task *eio)
 int
 coio_file_open(const char *path, int flags, mode_t mode)
 {
+	if (coio_uring_is_available(COIO_URING_OPEN))
+		return coio_uring_open(path, flags, mode);
 	INIT_COEIO_FILE(eio);
 	eio_req *req = eio_open(path, flags, mode, 0,
 				coio_complete, &eio);
@@ -156,6 +159,8 @@ coio_file_open(const char *path, int flags, mode_t mode)
 int
 coio_file_close(int fd)
 {
+	if (coio_uring_is_available(COIO_URING_CLOSE))
+		return coio_uring_close(fd);
 	INIT_COEIO_FILE(eio);
 	eio_req *req = eio_close(fd, 0, coio_complete, &eio);
 	return coio_wait_done(req, &eio);
@@ -175,10 +180,15 @@ coio_pwrite(int fd, const void *buf, size_t count, off_t offset)
 			chunk = 1;
 		});
 
-		req = eio_write(fd, (char *)buf + pos, chunk,
-				offset + pos, EIO_PRI_DEFAULT,
-				coio_complete, &eio);
-		res = coio_wait_done(req, &eio);
+		if (coio_uring_is_available(COIO_URING_PWRITE)) {
+			res = coio_uring_write(fd, (char *)buf + pos, chunk,
+					       offset + pos);
+		} else {
+			req = eio_write(fd, (char *)buf + pos, chunk,
+					offset + pos, EIO_PRI_DEFAULT,
+					coio_complete, &eio);
+			res = coio_wait_done(req, &eio);
+		}
 		if (res < 0) {
 			pos = -1;
 			break;
@@ -193,6 +203,8 @@ coio_pwrite(int fd, const void *buf, size_t count, off_t offset)
 ssize_t
 coio_pread(int fd, void *buf, size_t count, off_t offset)
 {
+	if (coio_uring_is_available(COIO_URING_PREAD))
+		return coio_uring_read(fd, buf, count, offset);
 	INIT_COEIO_FILE(eio);
 	eio_req *req = eio_read(fd, buf, count,
 				offset, 0, coio_complete, &eio);
@@ -221,11 +233,6 @@ static void
 coio_do_write(eio_req *req)
 {
 	struct coio_file_task *eio = (struct coio_file_task *)req->data;
-
-	ERROR_INJECT(ERRINJ_COIO_WRITE_CHUNK, {
-		eio->write.count = 1;
-	});
-
 	req->result = write(eio->write.fd, eio->write.buf, eio->write.count);
 	eio->errorno = errno;
 }
@@ -233,19 +240,28 @@ coio_do_write(eio_req *req)
 ssize_t
 coio_write(int fd, const void *buf, size_t count)
 {
-	ssize_t left = count, pos = 0, res;
+	ssize_t left = count, pos = 0, res, chunk;
 	eio_req *req;
 
 	while (left > 0) {
 		INIT_COEIO_FILE(eio);
+		chunk = left;
 
-		eio.write.buf	= (char *)buf + pos;
-		eio.write.count	= left;
-		eio.write.fd	= fd;
+		ERROR_INJECT(ERRINJ_COIO_WRITE_CHUNK, {
+			chunk = 1;
+		});
 
-		req = eio_custom(coio_do_write, EIO_PRI_DEFAULT,
-				 coio_complete, &eio);
-		res = coio_wait_done(req, &eio);
+		if (coio_uring_is_available(COIO_URING_WRITE)) {
+			res = coio_uring_write(fd, (char *)buf + pos, chunk, -1);
+		} else {
+			eio.write.buf	= (char *)buf + pos;
+			eio.write.count	= chunk;
+			eio.write.fd	= fd;
+
+			req = eio_custom(coio_do_write, EIO_PRI_DEFAULT,
+					 coio_complete, &eio);
+			res = coio_wait_done(req, &eio);
+		}
 		if (res < 0) {
 			pos = -1;
 			break;
@@ -268,6 +284,8 @@ coio_do_read(eio_req *req)
 ssize_t
 coio_read(int fd, void *buf, size_t count)
 {
+	if (coio_uring_is_available(COIO_URING_READ))
+		return coio_uring_read(fd, buf, count, -1);
 	INIT_COEIO_FILE(eio);
 	eio.read.buf = buf;
 	eio.read.count = count;
@@ -533,6 +551,8 @@ coio_sync(void)
 int
 coio_fsync(int fd)
 {
+	if (coio_uring_is_available(COIO_URING_FSYNC))
+		return coio_uring_fsync(fd, false);
 	INIT_COEIO_FILE(eio);
 	eio_req *req = eio_fsync(fd, 0, coio_complete, &eio);
 	return coio_wait_done(req, &eio);
@@ -541,6 +561,8 @@ coio_fsync(int fd)
 int
 coio_fdatasync(int fd)
 {
+	if (coio_uring_is_available(COIO_URING_FSYNC))
+		return coio_uring_fsync(fd, true);
 	INIT_COEIO_FILE(eio);
 	eio_req *req = eio_fdatasync(fd, 0, coio_complete, &eio);
 	return coio_wait_done(req, &eio);
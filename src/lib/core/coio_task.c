@@ -39,6 +39,9 @@
 #include <sys/socket.h>
 
 #include "fiber.h"
+#include "fiber_cond.h"
+#include "assoc.h"
+#include "tt_static.h"
 #include "third_party/tarantool_ev.h"
 
 /*
@@ -153,7 +156,35 @@ coio_enable(void)
 void
 coio_shutdown(void)
 {
-	eio_set_max_parallel(0);
+	for (int i = 0; i < coio_pool_MAX; i++)
+		eio_set_pool_max_parallel(i, 0);
+}
+
+const char *coio_pool_strs[] = { "file", "resolve", "call" };
+
+static_assert(coio_pool_MAX <= EIO_NUM_POOLS,
+	      "every coio pool must have an eio pool");
+static_assert(lengthof(coio_pool_strs) == coio_pool_MAX,
+	      "every coio pool must have a name");
+
+void
+coio_pool_set_size(enum coio_pool pool, int threads)
+{
+	assert(pool < coio_pool_MAX);
+	assert(threads > 0);
+	eio_set_pool_min_parallel(pool, threads);
+	eio_set_pool_max_parallel(pool, threads);
+}
+
+void
+coio_pool_stat(enum coio_pool pool, struct coio_pool_stat *stat)
+{
+	assert(pool < coio_pool_MAX);
+	unsigned threads, running, queued;
+	eio_pool_stat(pool, &threads, &running, &queued);
+	stat->threads = threads;
+	stat->running = running;
+	stat->queued = queued;
 }
 
 static void
@@ -213,6 +244,7 @@ coio_task_create(struct coio_task *task,
 	task->base.finish = coio_on_finish;
 	task->base.destroy = coio_on_destroy;
 	/* task->base.pri = 0; */
+	task->base.pool = COIO_POOL_FILE;
 
 	task->fiber = fiber();
 	task->task_cb = func;
@@ -277,6 +309,7 @@ coio_call(ssize_t (*func)(va_list ap), ...)
 	task->base.finish = coio_on_finish;
 	/* task->base.destroy = NULL; */
 	/* task->base.pri = 0; */
+	task->base.pool = COIO_POOL_CALL;
 
 	task->fiber = fiber();
 	task->call_cb = func;
@@ -358,11 +391,16 @@ getaddrinfo_free_cb(struct coio_task *ptr)
 	return 0;
 }
 
-int
-coio_getaddrinfo(const char *host, const char *port,
-		 const struct addrinfo *hints, struct addrinfo **res,
-		 double timeout)
+/**
+ * coio_getaddrinfo() that also returns the error code of
+ * getaddrinfo() in @a gai_rc, 0 if it failed for another reason.
+ */
+static int
+coio_getaddrinfo_rc(const char *host, const char *port,
+		    const struct addrinfo *hints, struct addrinfo **res,
+		    double timeout, int *gai_rc)
 {
+	*gai_rc = 0;
 	struct async_getaddrinfo_task *task =
 		(struct async_getaddrinfo_task *) calloc(1, sizeof(*task));
 	if (task == NULL) {
@@ -371,6 +409,7 @@ coio_getaddrinfo(const char *host, const char *port,
 	}
 
 	coio_task_create(&task->base, getaddrinfo_cb, getaddrinfo_free_cb);
+	task->base.base.pool = COIO_POOL_RESOLVE;
 
 	/*
 	 * getaddrinfo() on osx upto osx 10.8 crashes when AI_NUMERICSERV is
@@ -415,6 +454,7 @@ coio_getaddrinfo(const char *host, const char *port,
 	/* Task finished */
 	if (task->rc != 0) {
 		/* getaddrinfo() failed */
+		*gai_rc = task->rc;
 		errno = EIO;
 		diag_set(SystemError, "getaddrinfo: %s",
 			 gai_strerror(task->rc));
@@ -428,3 +468,293 @@ coio_getaddrinfo(const char *host, const char *port,
 	getaddrinfo_free_cb(&task->base);
 	return 0;
 }
+
+int
+coio_getaddrinfo(const char *host, const char *port,
+		 const struct addrinfo *hints, struct addrinfo **res,
+		 double timeout)
+{
+	int gai_rc;
+	return coio_getaddrinfo_rc(host, port, hints, res, timeout, &gai_rc);
+}
+
+/*
+ * Cache of name resolution results.
+ * ---------------------------------
+ *
+ * getaddrinfo() doesn't report TTL of DNS records, so results
+ * are kept for a configured time, and failures to find a name
+ * for a shorter one. The cache lives in the main cord only,
+ * other cords resolve every time. Concurrent lookups of the
+ * same name are merged: the first fiber runs getaddrinfo() and
+ * the others wait for its result, so a storm of reconnects
+ * doesn't queue a storm of identical resolver tasks.
+ */
+
+enum {
+	/** Max number of cached names. */
+	DNS_CACHE_SIZE_MAX = 1024,
+};
+
+/** Max time to cache a failure to resolve a name, seconds. */
+static const double DNS_CACHE_NEGATIVE_TTL_MAX = 1;
+
+struct dns_cache_entry {
+	/** Hints, port and host; the hash key. */
+	char *key;
+	size_t key_len;
+	/** Cached result, own copy, see addrinfo_dup(). */
+	struct addrinfo *result;
+	/** getaddrinfo() error code if it failed. */
+	int gai_rc;
+	/** ev_monotonic_now() when the result expires. */
+	double expires;
+	/** Set while a fiber is resolving the name. */
+	bool is_resolving;
+	/** Number of fibers waiting for the resolving one. */
+	int waiters;
+	/** Signaled when the resolving fiber is done. */
+	struct fiber_cond cond;
+};
+
+static struct {
+	/** Key -> struct dns_cache_entry. */
+	struct mh_strnptr_t *hash;
+	/** Time to keep results, seconds, 0 disables caching. */
+	double ttl;
+} dns_cache = {
+	.hash = NULL,
+	.ttl = 10,
+};
+
+static void
+dns_cache_entry_delete(struct dns_cache_entry *entry)
+{
+	assert(!entry->is_resolving && entry->waiters == 0);
+	coio_freeaddrinfo(entry->result);
+	fiber_cond_destroy(&entry->cond);
+	free(entry->key);
+	free(entry);
+}
+
+/**
+ * Delete expired entries nobody waits for, or all such entries
+ * if @a all is set.
+ */
+static void
+dns_cache_purge(bool all)
+{
+	struct mh_strnptr_t *h = dns_cache.hash;
+	if (h == NULL)
+		return;
+	double now = ev_monotonic_now(loop());
+	mh_int_t i;
+	mh_foreach(h, i) {
+		struct dns_cache_entry *entry =
+			(struct dns_cache_entry *)mh_strnptr_node(h, i)->val;
+		if (entry->is_resolving || entry->waiters > 0)
+			continue;
+		if (!all && entry->expires > now)
+			continue;
+		mh_strnptr_del(h, i, NULL);
+		dns_cache_entry_delete(entry);
+	}
+}
+
+void
+coio_dns_cache_set_ttl(double ttl)
+{
+	dns_cache.ttl = ttl;
+	dns_cache_purge(true);
+}
+
+/** Find or create a cache entry, NULL if the cache is full. */
+static struct dns_cache_entry *
+dns_cache_get(const char *key, size_t key_len)
+{
+	if (dns_cache.hash == NULL) {
+		dns_cache.hash = mh_strnptr_new();
+		if (dns_cache.hash == NULL)
+			return NULL;
+	}
+	struct mh_strnptr_t *h = dns_cache.hash;
+	mh_int_t i = mh_strnptr_find_inp(h, key, key_len);
+	if (i != mh_end(h))
+		return (struct dns_cache_entry *)mh_strnptr_node(h, i)->val;
+	if (mh_size(h) >= DNS_CACHE_SIZE_MAX) {
+		dns_cache_purge(false);
+		if (mh_size(h) >= DNS_CACHE_SIZE_MAX)
+			return NULL;
+	}
+	struct dns_cache_entry *entry =
+		(struct dns_cache_entry *)calloc(1, sizeof(*entry));
+	if (entry == NULL)
+		return NULL;
+	entry->key = (char *)malloc(key_len);
+	if (entry->key == NULL) {
+		free(entry);
+		return NULL;
+	}
+	memcpy(entry->key, key, key_len);
+	entry->key_len = key_len;
+	fiber_cond_create(&entry->cond);
+	struct mh_strnptr_node_t node = {
+		entry->key, key_len, mh_strn_hash(key, key_len), entry
+	};
+	if (mh_strnptr_put(h, &node, NULL, NULL) == mh_end(h)) {
+		fiber_cond_destroy(&entry->cond);
+		free(entry->key);
+		free(entry);
+		return NULL;
+	}
+	return entry;
+}
+
+/** Copy a getaddrinfo() result to free it with coio_freeaddrinfo(). */
+static struct addrinfo *
+addrinfo_dup(const struct addrinfo *ai)
+{
+	struct addrinfo *head = NULL;
+	struct addrinfo **tail = &head;
+	for (; ai != NULL; ai = ai->ai_next) {
+		struct addrinfo *copy =
+			(struct addrinfo *)malloc(sizeof(*copy) +
+						  ai->ai_addrlen);
+		if (copy == NULL)
+			goto error;
+		*copy = *ai;
+		copy->ai_next = NULL;
+		copy->ai_canonname = NULL;
+		copy->ai_addr = (struct sockaddr *)(copy + 1);
+		memcpy(copy->ai_addr, ai->ai_addr, ai->ai_addrlen);
+		*tail = copy;
+		tail = &copy->ai_next;
+		if (ai->ai_canonname != NULL) {
+			copy->ai_canonname = strdup(ai->ai_canonname);
+			if (copy->ai_canonname == NULL)
+				goto error;
+		}
+	}
+	return head;
+error:
+	coio_freeaddrinfo(head);
+	return NULL;
+}
+
+void
+coio_freeaddrinfo(struct addrinfo *ai)
+{
+	while (ai != NULL) {
+		struct addrinfo *next = ai->ai_next;
+		free(ai->ai_canonname);
+		free(ai);
+		ai = next;
+	}
+}
+
+/**
+ * Resolve a name bypassing the cache and return a copy of the
+ * result for coio_freeaddrinfo().
+ */
+static int
+coio_getaddrinfo_dup(const char *host, const char *port,
+		     const struct addrinfo *hints, struct addrinfo **res,
+		     double timeout, int *gai_rc)
+{
+	struct addrinfo *result = NULL;
+	if (coio_getaddrinfo_rc(host, port, hints, &result, timeout,
+				gai_rc) != 0)
+		return -1;
+	*res = addrinfo_dup(result);
+	freeaddrinfo(result);
+	if (*res == NULL && result != NULL) {
+		diag_set(OutOfMemory, sizeof(**res), "malloc", "addrinfo");
+		return -1;
+	}
+	return 0;
+}
+
+int
+coio_getaddrinfo_cached(const char *host, const char *port,
+			const struct addrinfo *hints, struct addrinfo **res,
+			double timeout)
+{
+	int gai_rc;
+	if (dns_cache.ttl <= 0 || !cord_is_main()) {
+		return coio_getaddrinfo_dup(host, port, hints, res, timeout,
+					    &gai_rc);
+	}
+	struct addrinfo no_hints;
+	if (hints == NULL) {
+		memset(&no_hints, 0, sizeof(no_hints));
+		no_hints.ai_family = AF_UNSPEC;
+		hints = &no_hints;
+	}
+	const char *key = tt_sprintf("%d:%d:%d:%d:%s:%s", hints->ai_flags,
+				     hints->ai_family, hints->ai_socktype,
+				     hints->ai_protocol,
+				     port != NULL ? port : "",
+				     host != NULL ? host : "");
+	size_t key_len = strlen(key);
+	struct dns_cache_entry *entry = dns_cache_get(key, key_len);
+	if (entry == NULL) {
+		return coio_getaddrinfo_dup(host, port, hints, res, timeout,
+					    &gai_rc);
+	}
+	double deadline = ev_monotonic_now(loop()) + timeout;
+	while (entry->is_resolving) {
+		double delay = deadline - ev_monotonic_now(loop());
+		entry->waiters++;
+		int rc = fiber_cond_wait_timeout(&entry->cond, delay);
+		entry->waiters--;
+		if (rc != 0)
+			return -1; /* timed out */
+		if (fiber_is_cancelled()) {
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+	}
+	if (entry->expires > ev_monotonic_now(loop())) {
+		if (entry->gai_rc != 0) {
+			errno = EIO;
+			diag_set(SystemError, "getaddrinfo: %s",
+				 gai_strerror(entry->gai_rc));
+			return -1;
+		}
+		*res = addrinfo_dup(entry->result);
+		if (*res == NULL && entry->result != NULL) {
+			diag_set(OutOfMemory, sizeof(**res), "malloc",
+				 "addrinfo");
+			return -1;
+		}
+		return 0;
+	}
+	entry->is_resolving = true;
+	struct addrinfo *result = NULL;
+	int rc = coio_getaddrinfo_dup(host, port, hints, &result,
+				      deadline - ev_monotonic_now(loop()),
+				      &gai_rc);
+	entry->is_resolving = false;
+	fiber_cond_broadcast(&entry->cond);
+	/*
+	 * Cache only definite answers. Timeouts and transient
+	 * errors are left for the next attempt.
+	 */
+	if (rc == 0 || (gai_rc != 0 && gai_rc != EAI_AGAIN &&
+			gai_rc != EAI_SYSTEM && gai_rc != EAI_MEMORY)) {
+		double ttl = dns_cache.ttl;
+		if (rc != 0)
+			ttl = MIN(ttl, DNS_CACHE_NEGATIVE_TTL_MAX);
+		coio_freeaddrinfo(entry->result);
+		entry->result = NULL;
+		entry->gai_rc = gai_rc;
+		entry->expires = ev_monotonic_now(loop()) + ttl;
+		if (rc == 0) {
+			entry->result = addrinfo_dup(result);
+			if (entry->result == NULL && result != NULL)
+				entry->expires = 0;
+		}
+	}
+	*res = result;
+	return rc;
+}
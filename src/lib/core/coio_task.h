@@ -53,6 +53,39 @@ void coio_init(void);
 void coio_enable(void);
 void coio_shutdown(void);
 
+/**
+ * Classes of blocking work. Each class is run by a thread pool
+ * of its own, so that a burst of tasks of one class doesn't
+ * delay tasks of another one.
+ */
+enum coio_pool {
+	/** File I/O, coio_file.h. Default for any eio request. */
+	COIO_POOL_FILE,
+	/** Name resolution, coio_getaddrinfo(). */
+	COIO_POOL_RESOLVE,
+	/** Arbitrary work, coio_call(). */
+	COIO_POOL_CALL,
+	coio_pool_MAX,
+};
+
+extern const char *coio_pool_strs[];
+
+/** Set the number of threads of a pool. */
+void
+coio_pool_set_size(enum coio_pool pool, int threads);
+
+struct coio_pool_stat {
+	/** Number of running threads. */
+	int threads;
+	/** Number of tasks being executed. */
+	int running;
+	/** Number of tasks waiting for a thread. */
+	int queued;
+};
+
+void
+coio_pool_stat(enum coio_pool pool, struct coio_pool_stat *stat);
+
 struct coio_task;
 
 typedef ssize_t (*coio_call_cb)(va_list ap);
@@ -87,7 +120,8 @@ struct coio_task {
 };
 
 /**
- * Create coio_task.
+ * Create coio_task. The task is run by the COIO_POOL_FILE pool
+ * unless task->base.pool is set to another enum coio_pool.
  *
  * @param task coio task
  * @param func a callback to execute in EIO thread pool.
@@ -179,6 +213,30 @@ coio_getaddrinfo(const char *host, const char *port,
 		 double timeout);
 /** \endcond public */
 
+/**
+ * Like coio_getaddrinfo(), but the result may be served from a
+ * cache of recent lookups, see coio_dns_cache_set_ttl().
+ * Concurrent lookups of the same name are merged into one.
+ *
+ * @param[out] res result, free it with coio_freeaddrinfo().
+ */
+int
+coio_getaddrinfo_cached(const char *host, const char *port,
+			const struct addrinfo *hints, struct addrinfo **res,
+			double timeout);
+
+/** Free a result of coio_getaddrinfo_cached(). */
+void
+coio_freeaddrinfo(struct addrinfo *ai);
+
+/**
+ * Set the time to cache name resolution results for, seconds.
+ * Failures to find a name are cached for at most a second.
+ * 0 disables the cache. Drops all cached results.
+ */
+void
+coio_dns_cache_set_ttl(double ttl);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
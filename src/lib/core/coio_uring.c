@@ -0,0 +1,519 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "coio_uring.h"
+#include "trivia/config.h"
+#include "trivia/util.h"
+#include "fiber.h"
+#include "say.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(HAVE_IO_URING)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_IO_URING)
+
+enum {
+	/** Submission queue size, the completion queue is twice as big. */
+	COIO_URING_ENTRIES = 256,
+	/** Size of the opcode probe, enough for any kernel. */
+	COIO_URING_PROBE_OPS = 256,
+};
+
+/** An io_uring of a cord. */
+struct coio_uring {
+	/** Ring descriptor. */
+	int fd;
+	/** The process the ring was set up by, see coio_uring_get(). */
+	pid_t pid;
+	/** IORING_FEAT_* reported by the kernel. */
+	uint32_t features;
+	/** Bitmap of enum coio_uring_op supported by the kernel. */
+	uint32_t ops;
+	/** Submitted requests that haven't been reaped yet. */
+	unsigned inflight;
+	/** Completion queue size, the limit for @a inflight. */
+	unsigned cq_entries;
+	/** Submission queue, mapped from the kernel. */
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_entries;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	/** Completion queue, mapped from the kernel. */
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+	/** Mappings, to unmap them on destruction. */
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+	/** Fires when the completion queue isn't empty. */
+	struct ev_io watcher;
+};
+
+/** A request submitted by a fiber. */
+struct coio_uring_task {
+	/** The fiber waiting for the request. */
+	struct fiber *fiber;
+	/** Return value of the operation or -errno. */
+	int res;
+	bool done;
+};
+
+/** The ring of the current cord, NULL until first use. */
+static __thread struct coio_uring *coio_uring;
+/** Set if the ring can't be set up in this cord. */
+static __thread bool coio_uring_is_broken;
+
+static inline unsigned
+load_acquire(const unsigned *p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void
+store_release(unsigned *p, unsigned v)
+{
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+/** io_uring opcodes of enum coio_uring_op. */
+static const uint8_t coio_uring_opcode[] = {
+	[COIO_URING_OPEN]	= IORING_OP_OPENAT,
+	[COIO_URING_CLOSE]	= IORING_OP_CLOSE,
+	[COIO_URING_READ]	= IORING_OP_READ,
+	[COIO_URING_WRITE]	= IORING_OP_WRITE,
+	[COIO_URING_PREAD]	= IORING_OP_READ,
+	[COIO_URING_PWRITE]	= IORING_OP_WRITE,
+	[COIO_URING_FSYNC]	= IORING_OP_FSYNC,
+};
+
+static_assert(lengthof(coio_uring_opcode) == coio_uring_op_MAX,
+	      "every coio_uring_op must have an opcode");
+
+/** Reap completions and wake up the waiting fibers. */
+static void
+coio_uring_cb(ev_loop *loop, struct ev_io *watcher, int events)
+{
+	(void)loop;
+	(void)events;
+	struct coio_uring *ring = (struct coio_uring *)watcher->data;
+	unsigned head = *ring->cq_head;
+	unsigned tail = load_acquire(ring->cq_tail);
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		struct coio_uring_task *task =
+			(struct coio_uring_task *)(uintptr_t)cqe->user_data;
+		task->res = cqe->res;
+		task->done = true;
+		fiber_wakeup(task->fiber);
+		assert(ring->inflight > 0);
+		ring->inflight--;
+	}
+	store_release(ring->cq_head, head);
+}
+
+static void
+coio_uring_delete(struct coio_uring *ring)
+{
+	if (ring->sqes != NULL)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring != NULL)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+	free(ring);
+}
+
+/** Find out which of enum coio_uring_op the kernel supports. */
+static uint32_t
+coio_uring_probe(struct coio_uring *ring)
+{
+	size_t size = sizeof(struct io_uring_probe) +
+		      COIO_URING_PROBE_OPS * sizeof(struct io_uring_probe_op);
+	struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, size);
+	if (probe == NULL)
+		return 0;
+	uint32_t ops = 0;
+	if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE,
+		    probe, COIO_URING_PROBE_OPS) != 0)
+		goto out;
+	for (int op = 0; op < coio_uring_op_MAX; op++) {
+		uint8_t opcode = coio_uring_opcode[op];
+		if (opcode <= probe->last_op &&
+		    (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0)
+			ops |= 1 << op;
+	}
+	/* Reads and writes at the file position need offset -1. */
+	if ((ring->features & IORING_FEAT_RW_CUR_POS) == 0)
+		ops &= ~(1 << COIO_URING_READ | 1 << COIO_URING_WRITE);
+out:
+	free(probe);
+	return ops;
+}
+
+static struct coio_uring *
+coio_uring_new(void)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = syscall(__NR_io_uring_setup, COIO_URING_ENTRIES, &params);
+	if (fd < 0)
+		return NULL;
+	struct coio_uring *ring = (struct coio_uring *)calloc(1, sizeof(*ring));
+	if (ring == NULL) {
+		close(fd);
+		return NULL;
+	}
+	ring->fd = fd;
+	ring->pid = getpid();
+	ring->features = params.features;
+	ring->cq_entries = params.cq_entries;
+
+	ring->sq_ring_size = params.sq_off.array +
+			     params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes +
+			     params.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single_mmap) {
+		ring->sq_ring_size = MAX(ring->sq_ring_size,
+					 ring->cq_ring_size);
+	}
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+			     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		ring->sq_ring = NULL;
+		goto error;
+	}
+	if (single_mmap) {
+		ring->cq_ring = ring->sq_ring;
+	} else {
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size,
+				     PROT_READ | PROT_WRITE,
+				     MAP_SHARED | MAP_POPULATE, fd,
+				     IORING_OFF_CQ_RING);
+		if (ring->cq_ring == MAP_FAILED) {
+			ring->cq_ring = NULL;
+			goto error;
+		}
+	}
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe *)
+		mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		goto error;
+	}
+
+	char *sq = (char *)ring->sq_ring;
+	ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_entries = (unsigned *)(sq + params.sq_off.ring_entries);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	char *cq = (char *)ring->cq_ring;
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	ring->ops = coio_uring_probe(ring);
+	if (ring->ops == 0)
+		goto error;
+	ev_io_init(&ring->watcher, coio_uring_cb, fd, EV_READ);
+	ring->watcher.data = ring;
+	ev_io_start(loop(), &ring->watcher);
+	return ring;
+error:
+	coio_uring_delete(ring);
+	return NULL;
+}
+
+/**
+ * Return the ring of the current cord, set it up if needed.
+ * A ring inherited over fork() is shared with the parent, so
+ * the child drops it and sets up its own.
+ */
+static struct coio_uring *
+coio_uring_get(void)
+{
+	if (coio_uring != NULL && coio_uring->pid != getpid())
+		coio_uring_free();
+	if (coio_uring == NULL && !coio_uring_is_broken) {
+		coio_uring = coio_uring_new();
+		if (coio_uring == NULL) {
+			say_debug("io_uring is unavailable, "
+				  "using the thread pool for file I/O");
+			coio_uring_is_broken = true;
+		}
+	}
+	return coio_uring;
+}
+
+bool
+coio_uring_is_available(enum coio_uring_op op)
+{
+	assert(op < coio_uring_op_MAX);
+	struct coio_uring *ring = coio_uring_get();
+	return ring != NULL && (ring->ops & (1 << op)) != 0 &&
+	       ring->inflight < ring->cq_entries;
+}
+
+void
+coio_uring_free(void)
+{
+	struct coio_uring *ring = coio_uring;
+	if (ring == NULL)
+		return;
+	if (cord()->loop != NULL)
+		ev_io_stop(loop(), &ring->watcher);
+	coio_uring_delete(ring);
+	coio_uring = NULL;
+}
+
+/** Get a zeroed submission queue entry for @a task. */
+static struct io_uring_sqe *
+coio_uring_sqe(struct coio_uring *ring, struct coio_uring_task *task)
+{
+	unsigned tail = *ring->sq_tail;
+	/*
+	 * Every entry is submitted right away, so the queue
+	 * can't be full.
+	 */
+	assert(tail - load_acquire(ring->sq_head) < *ring->sq_entries);
+	unsigned idx = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = (uint64_t)(uintptr_t)task;
+	ring->sq_array[idx] = idx;
+	return sqe;
+}
+
+/**
+ * Submit the entry filled by the caller, wait for its completion
+ * and convert the result to the system call convention.
+ */
+static ssize_t
+coio_uring_submit(struct coio_uring *ring, struct coio_uring_task *task)
+{
+	unsigned tail = *ring->sq_tail;
+	store_release(ring->sq_tail, tail + 1);
+	int rc;
+	do {
+		rc = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+	} while (rc < 0 && errno == EINTR);
+	if (rc != 1) {
+		/*
+		 * The kernel hasn't consumed the entry, take it
+		 * back so it isn't picked up by the next call and
+		 * doesn't outlive the task.
+		 */
+		store_release(ring->sq_tail, tail);
+		if (rc >= 0)
+			errno = EAGAIN;
+		return -1;
+	}
+	ring->inflight++;
+	while (!task->done)
+		fiber_yield();
+	if (task->res < 0) {
+		errno = -task->res;
+		return -1;
+	}
+	return task->res;
+}
+
+#define INIT_COIO_URING_TASK(name)			\
+	struct coio_uring_task name;			\
+	memset(&name, 0, sizeof(name));			\
+	name.fiber = fiber();
+
+int
+coio_uring_open(const char *path, int flags, mode_t mode)
+{
+	struct coio_uring *ring = coio_uring_get();
+	assert(ring != NULL);
+	INIT_COIO_URING_TASK(task);
+	struct io_uring_sqe *sqe = coio_uring_sqe(ring, &task);
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uint64_t)(uintptr_t)path;
+	sqe->len = mode;
+	sqe->open_flags = flags;
+	return coio_uring_submit(ring, &task);
+}
+
+int
+coio_uring_close(int fd)
+{
+	struct coio_uring *ring = coio_uring_get();
+	assert(ring != NULL);
+	INIT_COIO_URING_TASK(task);
+	struct io_uring_sqe *sqe = coio_uring_sqe(ring, &task);
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = fd;
+	return coio_uring_submit(ring, &task);
+}
+
+/** Length of a single read or write, the kernel takes 32 bits. */
+static inline uint32_t
+coio_uring_len(size_t count)
+{
+	return MIN(count, (size_t)INT32_MAX);
+}
+
+ssize_t
+coio_uring_read(int fd, void *buf, size_t count, off_t offset)
+{
+	struct coio_uring *ring = coio_uring_get();
+	assert(ring != NULL);
+	INIT_COIO_URING_TASK(task);
+	struct io_uring_sqe *sqe = coio_uring_sqe(ring, &task);
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = coio_uring_len(count);
+	sqe->off = (uint64_t)offset;
+	return coio_uring_submit(ring, &task);
+}
+
+ssize_t
+coio_uring_write(int fd, const void *buf, size_t count, off_t offset)
+{
+	struct coio_uring *ring = coio_uring_get();
+	assert(ring != NULL);
+	INIT_COIO_URING_TASK(task);
+	struct io_uring_sqe *sqe = coio_uring_sqe(ring, &task);
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = coio_uring_len(count);
+	sqe->off = (uint64_t)offset;
+	return coio_uring_submit(ring, &task);
+}
+
+int
+coio_uring_fsync(int fd, bool datasync)
+{
+	struct coio_uring *ring = coio_uring_get();
+	assert(ring != NULL);
+	INIT_COIO_URING_TASK(task);
+	struct io_uring_sqe *sqe = coio_uring_sqe(ring, &task);
+	sqe->opcode = IORING_OP_FSYNC;
+	sqe->fd = fd;
+	if (datasync)
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+	return coio_uring_submit(ring, &task);
+}
+
+#else /* !defined(HAVE_IO_URING) */
+
+bool
+coio_uring_is_available(enum coio_uring_op op)
+{
+	(void)op;
+	return false;
+}
+
+void
+coio_uring_free(void)
+{
+}
+
+int
+coio_uring_open(const char *path, int flags, mode_t mode)
+{
+	(void)path;
+	(void)flags;
+	(void)mode;
+	unreachable();
+	errno = ENOSYS;
+	return -1;
+}
+
+int
+coio_uring_close(int fd)
+{
+	(void)fd;
+	unreachable();
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t
+coio_uring_read(int fd, void *buf, size_t count, off_t offset)
+{
+	(void)fd;
+	(void)buf;
+	(void)count;
+	(void)offset;
+	unreachable();
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t
+coio_uring_write(int fd, const void *buf, size_t count, off_t offset)
+{
+	(void)fd;
+	(void)buf;
+	(void)count;
+	(void)offset;
+	unreachable();
+	errno = ENOSYS;
+	return -1;
+}
+
+int
+coio_uring_fsync(int fd, bool datasync)
+{
+	(void)fd;
+	(void)datasync;
+	unreachable();
+	errno = ENOSYS;
+	return -1;
+}
+
+#endif /* !defined(HAVE_IO_URING) */
@@ -0,0 +1,100 @@
+#ifndef TARANTOOL_LIB_CORE_COIO_URING_H_INCLUDED
+#define TARANTOOL_LIB_CORE_COIO_URING_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <sys/types.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Cooperative file I/O over Linux io_uring.
+ *
+ * Every cord gets a ring of its own on first use. A request is
+ * submitted right from the calling fiber, and its completion is
+ * reaped by an ev_io watcher on the ring descriptor, so there are
+ * no worker thread hops on the way. Only the operations listed
+ * below go through the ring; coio_file.c falls back to the eio
+ * thread pool for everything else, as well as when the kernel
+ * lacks io_uring or a particular opcode, or when the ring is full.
+ *
+ * The operations follow the error reporting convention of the
+ * respective system calls.
+ */
+
+enum coio_uring_op {
+	COIO_URING_OPEN,
+	COIO_URING_CLOSE,
+	/** read() and write() at the file position. */
+	COIO_URING_READ,
+	COIO_URING_WRITE,
+	/** pread() and pwrite(). */
+	COIO_URING_PREAD,
+	COIO_URING_PWRITE,
+	COIO_URING_FSYNC,
+	coio_uring_op_MAX,
+};
+
+/**
+ * Return true if @a op can be submitted to the io_uring of the
+ * current cord right now. Sets the ring up on first call.
+ */
+bool
+coio_uring_is_available(enum coio_uring_op op);
+
+/** Release the io_uring of the current cord, if any. */
+void
+coio_uring_free(void);
+
+int
+coio_uring_open(const char *path, int flags, mode_t mode);
+
+int
+coio_uring_close(int fd);
+
+/** @a offset -1 stands for the current file position. */
+ssize_t
+coio_uring_read(int fd, void *buf, size_t count, off_t offset);
+
+/** @a offset -1 stands for the current file position. */
+ssize_t
+coio_uring_write(int fd, const void *buf, size_t count, off_t offset);
+
+int
+coio_uring_fsync(int fd, bool datasync);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_COIO_URING_H_INCLUDED */
@@ -93,6 +93,301 @@ decimal_check_status(decimal_t *dec, decContext *context)
 	return status || !decNumberIsFinite(dec) ? NULL : dec;
 }
 
+#if defined(__SIZEOF_INT128__)
+
+/*
+ * Fixed-point fast path.
+ *
+ * A finite decimal is a coefficient of at most DECIMAL_MAX_DIGITS
+ * digits, which always fits in an unsigned 128-bit integer, scaled
+ * by 10^exponent. As long as the result of an operation fits in
+ * DECIMAL_MAX_DIGITS digits and in the exponent limits of
+ * decimal_context, integer arithmetic on coefficients gives
+ * exactly the same number as decNumber, without digit-by-digit
+ * processing. Otherwise the operation falls back to decNumber,
+ * which rounds or reports an error.
+ */
+typedef unsigned __int128 decimal_coef_t;
+
+/** The base of a decNumber unit, 10^DECDPUN. */
+static inline uint32_t
+decimal_unit_base(void)
+{
+	uint32_t base = 1;
+	for (int i = 0; i < DECDPUN; i++)
+		base *= 10;
+	return base;
+}
+
+/** 10^n for n in [0, DECIMAL_MAX_DIGITS]. */
+static inline decimal_coef_t
+decimal_coef_pow10(int n)
+{
+	assert(n >= 0 && n <= DECIMAL_MAX_DIGITS);
+	decimal_coef_t p = 1;
+	for (int i = 0; i < n; i++)
+		p *= 10;
+	return p;
+}
+
+/** Number of decimal digits in a coefficient, at least 1. */
+static inline int
+decimal_coef_digits(decimal_coef_t coef)
+{
+	int digits = 1;
+	for (decimal_coef_t p = 10; digits < 39 && coef >= p; p *= 10)
+		digits++;
+	return digits;
+}
+
+/**
+ * Get the coefficient of a decimal.
+ * @retval false the decimal is not finite.
+ */
+static inline bool
+decimal_get_coef(const decimal_t *dec, decimal_coef_t *coef)
+{
+	if ((dec->bits & DECSPECIAL) != 0)
+		return false;
+	assert(dec->digits <= DECIMAL_MAX_DIGITS);
+	uint32_t base = decimal_unit_base();
+	int i = (dec->digits + DECDPUN - 1) / DECDPUN;
+	decimal_coef_t c = 0;
+	while (i-- > 0)
+		c = c * base + dec->lsu[i];
+	*coef = c;
+	return true;
+}
+
+/**
+ * Store coef * 10^exponent in a decimal. The decimal isn't
+ * touched unless the number fits in the limits of decimal_context
+ * without rounding.
+ * @retval NULL the number doesn't fit.
+ */
+static inline decimal_t *
+decimal_set_coef(decimal_t *dec, decimal_coef_t coef, int32_t exponent,
+		 bool negative)
+{
+	if (exponent < -DECIMAL_MAX_DIGITS)
+		return NULL;
+	int digits = decimal_coef_digits(coef);
+	if (digits > DECIMAL_MAX_DIGITS ||
+	    exponent + digits > DECIMAL_MAX_DIGITS)
+		return NULL;
+	uint32_t base = decimal_unit_base();
+	Unit *u = dec->lsu;
+	for (; coef > UINT64_MAX; coef /= base)
+		*u++ = coef % base;
+	uint64_t c = coef;
+	do {
+		*u++ = c % base;
+		c /= base;
+	} while (c != 0);
+	dec->digits = digits;
+	dec->exponent = exponent;
+	dec->bits = negative ? DECNEG : 0;
+	return dec;
+}
+
+/**
+ * Multiply a coefficient by 10^n.
+ * @retval false the result doesn't fit in DECIMAL_MAX_DIGITS.
+ */
+static inline bool
+decimal_coef_scale(decimal_coef_t *coef, int n)
+{
+	if (n == 0 || *coef == 0)
+		return true;
+	if (n > DECIMAL_MAX_DIGITS)
+		return false;
+	decimal_coef_t res;
+	if (__builtin_mul_overflow(*coef, decimal_coef_pow10(n), &res) ||
+	    res >= decimal_coef_pow10(DECIMAL_MAX_DIGITS))
+		return false;
+	*coef = res;
+	return true;
+}
+
+/**
+ * Get coefficients of two decimals aligned to the smallest of
+ * their exponents.
+ */
+static inline bool
+decimal_get_aligned(const decimal_t *lhs, const decimal_t *rhs,
+		    decimal_coef_t *lcoef, decimal_coef_t *rcoef,
+		    int32_t *exponent)
+{
+	if (!decimal_get_coef(lhs, lcoef) || !decimal_get_coef(rhs, rcoef))
+		return false;
+	if (lhs->exponent > rhs->exponent) {
+		*exponent = rhs->exponent;
+		return decimal_coef_scale(lcoef,
+					  lhs->exponent - rhs->exponent);
+	}
+	*exponent = lhs->exponent;
+	return decimal_coef_scale(rcoef, rhs->exponent - lhs->exponent);
+}
+
+/** Fast path of decimal_add() and decimal_sub(). */
+static inline decimal_t *
+decimal_add_fast(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs,
+		 bool negate_rhs)
+{
+	decimal_coef_t lcoef, rcoef, coef;
+	int32_t exponent;
+	if (!decimal_get_aligned(lhs, rhs, &lcoef, &rcoef, &exponent))
+		return NULL;
+	bool lneg = decNumberIsNegative(lhs);
+	bool rneg = decNumberIsNegative(rhs) != negate_rhs;
+	bool negative;
+	if (lneg == rneg) {
+		coef = lcoef + rcoef;
+		negative = lneg;
+	} else if (lcoef >= rcoef) {
+		coef = lcoef - rcoef;
+		negative = lneg;
+	} else {
+		coef = rcoef - lcoef;
+		negative = rneg;
+	}
+	/* An exact zero is negative only if both operands are. */
+	if (coef == 0)
+		negative = lneg && rneg;
+	return decimal_set_coef(res, coef, exponent, negative);
+}
+
+/** Fast path of decimal_mul(). */
+static inline decimal_t *
+decimal_mul_fast(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
+{
+	decimal_coef_t lcoef, rcoef, coef;
+	if (!decimal_get_coef(lhs, &lcoef) || !decimal_get_coef(rhs, &rcoef) ||
+	    __builtin_mul_overflow(lcoef, rcoef, &coef))
+		return NULL;
+	return decimal_set_coef(res, coef, lhs->exponent + rhs->exponent,
+				decNumberIsNegative(lhs) !=
+				decNumberIsNegative(rhs));
+}
+
+/** Fast path of decimal_compare(). */
+static inline bool
+decimal_compare_fast(const decimal_t *lhs, const decimal_t *rhs, int *cmp)
+{
+	decimal_coef_t lcoef, rcoef;
+	int32_t exponent;
+	if (!decimal_get_aligned(lhs, rhs, &lcoef, &rcoef, &exponent))
+		return false;
+	/* Zeros are equal regardless of the sign. */
+	bool lneg = decNumberIsNegative(lhs) && lcoef != 0;
+	bool rneg = decNumberIsNegative(rhs) && rcoef != 0;
+	if (lneg != rneg) {
+		*cmp = lneg ? -1 : 1;
+		return true;
+	}
+	*cmp = lcoef < rcoef ? -1 : lcoef > rcoef;
+	if (lneg)
+		*cmp = -*cmp;
+	return true;
+}
+
+/**
+ * Fast path of decimal_pack() for coefficients of up to 19
+ * digits. Writes the same packed BCD as decPackedFromNumber().
+ */
+static inline bool
+decimal_pack_fast(char *data, uint32_t len, const decimal_t *dec)
+{
+	decimal_coef_t coef;
+	if (dec->digits > 19 || !decimal_get_coef(dec, &coef))
+		return false;
+	uint64_t c = coef;
+	uint8_t *p = (uint8_t *)data + len;
+	*--p = (c % 10) << 4 | (decNumberIsNegative(dec) ? 0x0D : 0x0C);
+	for (c /= 10; p > (uint8_t *)data; c /= 100)
+		*--p = (c / 10 % 10) << 4 | c % 10;
+	return true;
+}
+
+/**
+ * Fast path of decimal_unpack() for up to 19 digits.
+ * @retval NULL the data is invalid or doesn't fit the fast path,
+ *         the caller must fall back to decPackedToNumber().
+ */
+static inline decimal_t *
+decimal_unpack_fast(const char *data, uint32_t len, int32_t scale,
+		    decimal_t *dec)
+{
+	if (len == 0 || len > 10)
+		return NULL;
+	const uint8_t *p = (const uint8_t *)data;
+	const uint8_t *end = p + len - 1;
+	uint64_t c = 0;
+	for (; p < end; p++) {
+		if ((*p >> 4) > 9 || (*p & 0x0F) > 9)
+			return NULL;
+		c = c * 100 + (*p >> 4) * 10 + (*p & 0x0F);
+	}
+	uint8_t sign = *p & 0x0F;
+	if ((*p >> 4) > 9 || sign < 0x0A)
+		return NULL;
+	c = c * 10 + (*p >> 4);
+	return decimal_set_coef(dec, c, -scale, sign == 0x0B || sign == 0x0D);
+}
+
+#else /* !defined(__SIZEOF_INT128__) */
+
+static inline decimal_t *
+decimal_add_fast(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs,
+		 bool negate_rhs)
+{
+	(void)res;
+	(void)lhs;
+	(void)rhs;
+	(void)negate_rhs;
+	return NULL;
+}
+
+static inline decimal_t *
+decimal_mul_fast(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
+{
+	(void)res;
+	(void)lhs;
+	(void)rhs;
+	return NULL;
+}
+
+static inline bool
+decimal_compare_fast(const decimal_t *lhs, const decimal_t *rhs, int *cmp)
+{
+	(void)lhs;
+	(void)rhs;
+	(void)cmp;
+	return false;
+}
+
+static inline bool
+decimal_pack_fast(char *data, uint32_t len, const decimal_t *dec)
+{
+	(void)data;
+	(void)len;
+	(void)dec;
+	return false;
+}
+
+static inline decimal_t *
+decimal_unpack_fast(const char *data, uint32_t len, int32_t scale,
+		    decimal_t *dec)
+{
+	(void)data;
+	(void)len;
+	(void)scale;
+	(void)dec;
+	return NULL;
+}
+
+#endif /* !defined(__SIZEOF_INT128__) */
+
 int decimal_precision(const decimal_t *dec) {
 	return dec->exponent <= 0 ? MAX(dec->digits, -dec->exponent) :
 				    dec->digits + dec->exponent;
@@ -217,6 +512,9 @@ decimal_to_uint64(const decimal_t *dec, uint64_t *num)
 int
 decimal_compare(const decimal_t *lhs, const decimal_t *rhs)
 {
+	int cmp;
+	if (decimal_compare_fast(lhs, rhs, &cmp))
+		return cmp;
 	decNumber res;
 	decNumberCompare(&res, lhs, rhs, &decimal_context);
 	int r = decNumberToInt32(&res, &decimal_context);
@@ -315,6 +613,8 @@ decimal_minus(decimal_t *res, const decimal_t *dec)
 decimal_t *
 decimal_add(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 {
+	if (decimal_add_fast(res, lhs, rhs, false) != NULL)
+		return res;
 	decNumberAdd(res, lhs, rhs, &decimal_context);
 	return decimal_check_status(res, &decimal_context);
 }
@@ -322,6 +622,8 @@ decimal_add(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 decimal_t *
 decimal_sub(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 {
+	if (decimal_add_fast(res, lhs, rhs, true) != NULL)
+		return res;
 	decNumberSubtract(res, lhs, rhs, &decimal_context);
 
 	return decimal_check_status(res, &decimal_context);
@@ -330,6 +632,8 @@ decimal_sub(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 decimal_t *
 decimal_mul(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 {
+	if (decimal_mul_fast(res, lhs, rhs) != NULL)
+		return res;
 	decNumberMultiply(res, lhs, rhs, &decimal_context);
 
 	return decimal_check_status(res, &decimal_context);
@@ -427,6 +731,8 @@ decimal_pack(char *data, const decimal_t *dec)
 		data = mp_encode_uint(data, -dec->exponent);
 	}
 	len -= data - svp;
+	if (decimal_pack_fast(data, len, dec))
+		return data + len;
 	int32_t scale;
 	char *tmp = (char *)decPackedFromNumber((uint8_t *)data, len, &scale, dec);
 	assert(tmp == data);
@@ -458,6 +764,10 @@ decimal_unpack(const char **data, uint32_t len, decimal_t *dec)
 	}
 
 	len -= *data - svp;
+	if (decimal_unpack_fast(*data, len, scale, dec) != NULL) {
+		*data += len;
+		return dec;
+	}
 	decimal_t *res = decPackedToNumber((uint8_t *)*data, len, &scale, dec);
 	if (res)
 		*data += len;
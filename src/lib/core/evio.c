@@ -420,3 +420,25 @@ evio_service_stop(struct evio_service *service)
 		}
 	}
 }
+
+void
+evio_service_attach(struct evio_service *dst, const struct evio_service *src)
+{
+	assert(!ev_is_active(&dst->ev));
+	memcpy(dst->host, src->host, sizeof(dst->host));
+	memcpy(dst->serv, src->serv, sizeof(dst->serv));
+	dst->addrstorage = src->addrstorage;
+	dst->addr_len = src->addr_len;
+	ev_io_set(&dst->ev, src->ev.fd, EV_READ);
+	ev_io_start(dst->loop, &dst->ev);
+}
+
+void
+evio_service_detach(struct evio_service *service)
+{
+	if (ev_is_active(&service->ev)) {
+		ev_io_stop(service->loop, &service->ev);
+		service->addr_len = 0;
+	}
+	ev_io_set(&service->ev, -1, 0);
+}
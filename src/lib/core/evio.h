@@ -121,6 +121,19 @@ evio_service_listen(struct evio_service *service);
 void
 evio_service_stop(struct evio_service *service);
 
+/**
+ * Start watching the acceptor socket of @a src service, which
+ * may belong to another thread, in the event loop of @a dst.
+ * The socket is still owned by @a src: @a dst must be detached
+ * before @a src is stopped.
+ */
+void
+evio_service_attach(struct evio_service *dst, const struct evio_service *src);
+
+/** Stop watching a socket attached with evio_service_attach(). */
+void
+evio_service_detach(struct evio_service *service);
+
 int
 evio_socket(struct ev_io *coio, int domain, int type, int protocol);
 
@@ -42,6 +42,12 @@
 #include "memory.h"
 #include "trigger.h"
 #include "errinj.h"
+#include "coio_uring.h"
+#include "clock.h"
+#include "say.h"
+#ifdef ENABLE_BACKTRACE
+#include "backtrace.h"
+#endif /* ENABLE_BACKTRACE */
 
 #if ENABLE_FIBER_TOP
 #include <x86intrin.h> /* __rdtscp() */
@@ -213,6 +219,71 @@ fiber_mprotect(void *addr, size_t len, int prot)
 static __thread bool fiber_top_enabled = false;
 #endif /* ENABLE_FIBER_TOP */
 
+/**
+ * Max time, in nanoseconds, a fiber may run without yielding
+ * before a warning is logged. 0 disables the check.
+ */
+static __thread uint64_t fiber_slice_warn_threshold = 0;
+/** Time of the last context switch in this cord. */
+static __thread uint64_t fiber_slice_start = 0;
+
+#ifdef ENABLE_BACKTRACE
+struct fiber_slice_bt_ctx {
+	char *pos;
+	char *end;
+};
+
+static int
+fiber_slice_backtrace_cb(int frameno, void *frameret, const char *func,
+			 size_t offset, void *cb_ctx)
+{
+	struct fiber_slice_bt_ctx *ctx = (struct fiber_slice_bt_ctx *)cb_ctx;
+	int n = snprintf(ctx->pos, ctx->end - ctx->pos, "\n#%-2d %p in %s+%zu",
+			 frameno, frameret, func != NULL ? func : "??",
+			 offset);
+	if (n < 0 || n >= ctx->end - ctx->pos) {
+		/* Drop the truncated frame. */
+		*ctx->pos = '\0';
+		return -1;
+	}
+	ctx->pos += n;
+	return 0;
+}
+#endif /* ENABLE_BACKTRACE */
+
+/**
+ * Warn if @a caller has been running for too long since the
+ * previous context switch. The scheduler isn't checked, because
+ * its slices include the time spent waiting for events.
+ */
+static void
+fiber_check_slice(struct fiber *caller)
+{
+	uint64_t now = clock_monotonic64();
+	uint64_t slice = now - fiber_slice_start;
+	fiber_slice_start = now;
+	if (caller == &cord()->sched || slice < fiber_slice_warn_threshold)
+		return;
+	const char *bt = "";
+#ifdef ENABLE_BACKTRACE
+	char buf[2048];
+	struct fiber_slice_bt_ctx ctx = {buf, buf + sizeof(buf)};
+	buf[0] = '\0';
+	backtrace_foreach(fiber_slice_backtrace_cb, NULL, &ctx);
+	bt = buf;
+#endif /* ENABLE_BACKTRACE */
+	say_warn("fiber %u \"%s\" has been running for %.3f ms "
+		 "without yielding%s", caller->fid, fiber_name(caller),
+		 slice / 1e6, bt);
+}
+
+void
+fiber_set_slice_warn_threshold(double timeout)
+{
+	fiber_slice_warn_threshold = timeout > 0 ? timeout * 1e9 : 0;
+	fiber_slice_start = clock_monotonic64();
+}
+
 /**
  * An action performed each time a context switch happens.
  * Used to count each fiber's processing time.
@@ -222,6 +293,9 @@ clock_set_on_csw(struct fiber *caller)
 {
 	caller->csw++;
 
+	if (unlikely(fiber_slice_warn_threshold > 0))
+		fiber_check_slice(caller);
+
 #if ENABLE_FIBER_TOP
 	if (!fiber_top_enabled)
 		return;
@@ -813,12 +887,19 @@ fiber_self(void)
 void
 fiber_gc(void)
 {
-	if (region_used(&fiber()->gc) < 128 * 1024) {
-		region_reset(&fiber()->gc);
-		return;
-	}
-
-	region_free(&fiber()->gc);
+	struct fiber *f = fiber();
+	size_t used = region_used(&f->gc);
+	if (used > f->gc_peak)
+		f->gc_peak = used;
+	/*
+	 * Return the slabs used after the first cached bytes
+	 * to the slab cache and reuse the rest. Slabs are
+	 * truncated in allocation order, so the kept ones are
+	 * the oldest, most likely hot.
+	 */
+	if (used > FIBER_GC_CACHE_SIZE)
+		region_truncate(&f->gc, FIBER_GC_CACHE_SIZE);
+	region_reset(&f->gc);
 }
 
 /** Common part of fiber_new() and fiber_recycle(). */
@@ -828,6 +909,7 @@ fiber_reset(struct fiber *fiber)
 	rlist_create(&fiber->on_yield);
 	rlist_create(&fiber->on_stop);
 	fiber->flags = FIBER_DEFAULT_FLAGS;
+	fiber->gc_peak = 0;
 #if ENABLE_FIBER_TOP
 	clock_stat_reset(&fiber->clock_stat);
 #endif /* ENABLE_FIBER_TOP */
@@ -842,6 +924,7 @@ fiber_recycle(struct fiber *fiber)
 	/* no pending wakeup */
 	assert(rlist_empty(&fiber->state));
 	bool has_custom_stack = fiber->flags & FIBER_CUSTOM_STACK;
+	bool has_pooled_stack = fiber->flags & FIBER_POOLED_STACK;
 	fiber_stack_recycle(fiber);
 	fiber_reset(fiber);
 	fiber->name[0] = '\0';
@@ -853,6 +936,8 @@ fiber_recycle(struct fiber *fiber)
 	region_free(&fiber->gc);
 	if (!has_custom_stack) {
 		rlist_move_entry(&cord()->dead, fiber, link);
+	} else if (has_pooled_stack) {
+		rlist_move_entry(&cord()->dead_pooled, fiber, link);
 	} else {
 		fiber_destroy(cord(), fiber);
 	}
@@ -1026,8 +1111,11 @@ fiber_stack_watermark_create(struct fiber *fiber)
 {
 	assert(fiber->stack_watermark == NULL);
 
-	/* No tracking on custom stacks for simplicity. */
-	if (fiber->flags & FIBER_CUSTOM_STACK)
+	/*
+	 * No tracking on custom stacks for simplicity, pooled
+	 * stacks are prefaulted instead.
+	 */
+	if (fiber->flags & (FIBER_CUSTOM_STACK | FIBER_POOLED_STACK))
 		return;
 
 	/*
@@ -1111,10 +1199,23 @@ fiber_stack_destroy(struct fiber *fiber, struct slab_cache *slabc)
 	}
 }
 
+/**
+ * Touch every page of the fiber stack, so that it's backed by
+ * memory before the fiber runs.
+ */
+static void
+fiber_stack_prefault(struct fiber *fiber)
+{
+	char *end = (char *)fiber->stack + fiber->stack_size;
+	for (char *p = page_align_up(fiber->stack); p < end; p += page_size)
+		*(volatile char *)p = 0;
+}
+
 static int
 fiber_stack_create(struct fiber *fiber, struct slab_cache *slabc,
 		   size_t stack_size)
 {
+	fiber->stack_size_class = stack_size;
 	stack_size -= slab_sizeof();
 	fiber->stack_slab = slab_get(slabc, stack_size);
 
@@ -1163,6 +1264,8 @@ fiber_stack_create(struct fiber *fiber, struct slab_cache *slabc,
 	}
 
 	fiber_stack_watermark_create(fiber);
+	if (fiber->flags & FIBER_POOLED_STACK)
+		fiber_stack_prefault(fiber);
 	return 0;
 }
 
@@ -1174,12 +1277,26 @@ fiber_new_ex(const char *name, const struct fiber_attr *fiber_attr,
 	struct fiber *fiber = NULL;
 	assert(fiber_attr != NULL);
 
-	/* Now we can not reuse fiber if custom attribute was set */
-	if (!(fiber_attr->flags & FIBER_CUSTOM_STACK) &&
-	    !rlist_empty(&cord->dead)) {
-		fiber = rlist_first_entry(&cord->dead,
-					  struct fiber, link);
+	if (!(fiber_attr->flags & FIBER_CUSTOM_STACK)) {
+		if (!rlist_empty(&cord->dead))
+			fiber = rlist_first_entry(&cord->dead,
+						  struct fiber, link);
+	} else if (fiber_attr->flags & FIBER_POOLED_STACK) {
+		/*
+		 * Pooled stack sizes are few in practice, usually
+		 * a dead fiber of the right size is the first one.
+		 */
+		struct fiber *f;
+		rlist_foreach_entry(f, &cord->dead_pooled, link) {
+			if (f->stack_size_class == fiber_attr->stack_size) {
+				fiber = f;
+				break;
+			}
+		}
+	}
+	if (fiber != NULL) {
 		rlist_move_entry(&cord->alive, fiber, link);
+		fiber->flags = fiber_attr->flags;
 	} else {
 		fiber = (struct fiber *)
 			mempool_alloc(&cord->fiber_mempool);
@@ -1189,6 +1306,7 @@ fiber_new_ex(const char *name, const struct fiber_attr *fiber_attr,
 			return NULL;
 		}
 		memset(fiber, 0, sizeof(struct fiber));
+		fiber->flags = fiber_attr->flags & FIBER_POOLED_STACK;
 
 		if (fiber_stack_create(fiber, &cord()->slabc,
 				       fiber_attr->stack_size)) {
@@ -1275,6 +1393,9 @@ fiber_destroy_all(struct cord *cord)
 	while (!rlist_empty(&cord->dead))
 		fiber_destroy(cord, rlist_first_entry(&cord->dead,
 						      struct fiber, link));
+	while (!rlist_empty(&cord->dead_pooled))
+		fiber_destroy(cord, rlist_first_entry(&cord->dead_pooled,
+						      struct fiber, link));
 }
 
 #if ENABLE_FIBER_TOP
@@ -1372,6 +1493,7 @@ cord_create(struct cord *cord, const char *name)
 	rlist_create(&cord->alive);
 	rlist_create(&cord->ready);
 	rlist_create(&cord->dead);
+	rlist_create(&cord->dead_pooled);
 	cord->fiber_registry = mh_i32ptr_new();
 
 	/* sched fiber is not present in alive/ready/dead list. */
@@ -1419,6 +1541,7 @@ void
 cord_destroy(struct cord *cord)
 {
 	slab_cache_set_thread(&cord->slabc);
+	coio_uring_free();
 	if (cord->loop)
 		ev_loop_destroy(cord->loop);
 	/* Only clean up if initialized. */
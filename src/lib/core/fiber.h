@@ -117,6 +117,11 @@ enum {
 	FIBER_NAME_MAX = 256
 };
 
+enum {
+	/** Size of the fiber region memory kept by fiber_gc(). */
+	FIBER_GC_CACHE_SIZE = 128 * 1024,
+};
+
 /**
  * Fiber ids [0; 100] are reserved.
  */
@@ -162,6 +167,13 @@ enum {
 	 * This flag is set when fiber uses custom stack size.
 	 */
 	FIBER_CUSTOM_STACK	= 1 << 5,
+	/**
+	 * The custom stack is faulted in when it's created and
+	 * the fiber is cached on death to be reused by a fiber
+	 * with the same stack size. Meant for small stacks of
+	 * pool fibers, so they never take page faults.
+	 */
+	FIBER_POOLED_STACK	= 1 << 6,
 	FIBER_DEFAULT_FLAGS = FIBER_IS_CANCELLABLE
 };
 
@@ -247,8 +259,10 @@ fiber_new(const char *name, fiber_func f);
  * the fiber structure or fiber stack.
  *
  * The created fiber automatically returns itself
- * to the fiber cache if has default stack size
- * when its "main" function completes.
+ * to the fiber cache if has default stack size or
+ * FIBER_POOLED_STACK flag when its "main" function completes.
+ * A fiber with a pooled stack is reused only by fibers
+ * created with the same stack size.
  *
  * \param name       string with fiber name
  * \param fiber_attr fiber attributes
@@ -436,10 +450,18 @@ struct fiber {
 #endif
 	/** Coro stack size. */
 	size_t stack_size;
+	/** Stack size the fiber was created with, see fiber_attr. */
+	size_t stack_size_class;
 	/** Valgrind stack id. */
 	unsigned int stack_id;
 	/* A garbage-collected memory pool. */
 	struct region gc;
+	/**
+	 * Max size of memory used in @a gc seen by fiber_gc()
+	 * since it was last zeroed by the fiber owner. Used to
+	 * account memory used by a request.
+	 */
+	size_t gc_peak;
 	/**
 	 * The fiber which should be scheduled when
 	 * this fiber yields.
@@ -510,10 +532,21 @@ struct fiber {
 			int ref;
 		} lua;
 		/**
-		 * Iproto sync.
+		 * Iproto request data.
 		 */
 		struct {
+			/** Iproto sync. */
 			uint64_t sync;
+			/**
+			 * Time spent by the current request
+			 * waiting for WAL writes.
+			 */
+			double wal_wait;
+			/**
+			 * Time spent by the current request
+			 * waiting for synchronous replication.
+			 */
+			double limbo_wait;
 		} net;
 	} storage;
 	/** An object to wait for incoming message or a reader. */
@@ -562,6 +595,11 @@ struct cord {
 	struct rlist ready;
 	/** A cache of dead fibers for reuse */
 	struct rlist dead;
+	/**
+	 * A cache of dead fibers with pooled custom stacks. Such
+	 * a fiber is reused by a fiber with the same stack size.
+	 */
+	struct rlist dead_pooled;
 	/** A watcher to have a single async event for all ready fibers.
 	 * This technique is necessary to be able to suspend
 	 * a single fiber on a few watchers (for example,
@@ -707,6 +745,13 @@ fiber_yield_timeout(ev_tstamp delay);
 void
 fiber_destroy_all(struct cord *cord);
 
+/**
+ * Free memory allocated on the fiber region. Up to
+ * FIBER_GC_CACHE_SIZE bytes of the region slabs are kept for
+ * the next allocations instead of being returned to the slab
+ * cache, so that a fiber serving requests doesn't get slabs
+ * from the cache and return them back on every request.
+ */
 void
 fiber_gc(void);
 
@@ -730,6 +775,14 @@ typedef int (*fiber_stat_cb)(struct fiber *f, void *ctx);
 int
 fiber_stat(fiber_stat_cb cb, void *cb_ctx);
 
+/**
+ * Log a warning with a backtrace whenever a fiber of the current
+ * cord runs longer than @a timeout seconds without yielding.
+ * A non-positive timeout disables the check.
+ */
+void
+fiber_set_slice_warn_threshold(double timeout);
+
 #if ENABLE_FIBER_TOP
 bool
 fiber_top_is_enabled(void);
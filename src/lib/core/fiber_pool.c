@@ -127,7 +127,8 @@ fiber_pool_cb(ev_loop *loop, struct ev_watcher *watcher, int events)
 			f = rlist_shift_entry(&pool->idle, struct fiber, state);
 			fiber_call(f);
 		} else if (pool->size < pool->max_size) {
-			f = fiber_new(cord_name(cord()), fiber_pool_f);
+			f = fiber_new_ex(cord_name(cord()), &pool->fiber_attr,
+					 fiber_pool_f);
 			if (f == NULL) {
 				diag_log();
 				break;
@@ -152,6 +153,19 @@ fiber_pool_set_max_size(struct fiber_pool *pool, int new_max_size)
 	pool->max_size = new_max_size;
 }
 
+int
+fiber_pool_set_stack_size(struct fiber_pool *pool, size_t stack_size)
+{
+	struct fiber_attr *attr = &pool->fiber_attr;
+	if (fiber_attr_setstacksize(attr, stack_size) != 0)
+		return -1;
+	if (attr->flags & FIBER_CUSTOM_STACK)
+		attr->flags |= FIBER_POOLED_STACK;
+	else
+		attr->flags &= ~FIBER_POOLED_STACK;
+	return 0;
+}
+
 void
 fiber_pool_create(struct fiber_pool *pool, const char *name, int max_pool_size,
 		  float idle_timeout)
@@ -167,6 +181,7 @@ fiber_pool_create(struct fiber_pool *pool, const char *name, int max_pool_size,
 	pool->max_size = max_pool_size;
 	stailq_create(&pool->output);
 	fiber_cond_create(&pool->worker_cond);
+	fiber_attr_create(&pool->fiber_attr);
 	/* Join fiber pool to cbus */
 	cbus_endpoint_create(&pool->endpoint, name, fiber_pool_cb, pool);
 }
@@ -67,6 +67,8 @@ struct fiber_pool {
 		struct ev_timer idle_timer;
 		/** Condition for worker exit signaling */
 		struct fiber_cond worker_cond;
+		/** Attributes of new worker fibers. */
+		struct fiber_attr fiber_attr;
 	};
 	struct {
 		/** The consumer thread loop. */
@@ -92,6 +94,19 @@ fiber_pool_create(struct fiber_pool *pool, const char *name, int max_pool_size,
 void
 fiber_pool_set_max_size(struct fiber_pool *pool, int new_max_size);
 
+/**
+ * Set stack size of new worker fibers. Stacks of a size other
+ * than the default one are faulted in on creation and are never
+ * given back to the OS, so that the pool reuses them without any
+ * syscalls.
+ * @param pool Fiber pool to set stack size.
+ * @param stack_size New stack size.
+ * @retval 0 Success.
+ * @retval -1 The stack size is too small.
+ */
+int
+fiber_pool_set_stack_size(struct fiber_pool *pool, size_t stack_size);
+
 /**
  * Destroy a fiber pool
  */
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "heap_file.h"
+#include "trivia/util.h"
+#include "diag.h"
+#include "say.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int
+heap_file_back(void *addr, size_t size, const char *dir, bool dontdump)
+{
+	char path[PATH_MAX];
+	int len = snprintf(path, sizeof(path), "%s/memtx.heap.XXXXXX", dir);
+	if (len < 0 || (size_t)len >= sizeof(path)) {
+		errno = ENAMETOOLONG;
+		diag_set(SystemError, "invalid heap file directory '%s'", dir);
+		return -1;
+	}
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to create heap file in '%s'",
+			 dir);
+		return -1;
+	}
+	unlink(path);
+	int rc = posix_fallocate(fd, 0, size);
+	if (rc != 0) {
+		errno = rc;
+		diag_set(SystemError, "failed to allocate %zu bytes for "
+			 "heap file in '%s'", size, dir);
+		close(fd);
+		return -1;
+	}
+	/*
+	 * Nothing has been written to the range yet, so it can
+	 * be replaced without copying.
+	 */
+	void *res = mmap(addr, size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_FIXED, fd, 0);
+	close(fd);
+	if (res == MAP_FAILED) {
+		diag_set(SystemError, "failed to map heap file");
+		/* A failed MAP_FIXED mmap may unmap the range. */
+		res = mmap(addr, size, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+		rc = -1;
+	}
+	if (res == MAP_FAILED) {
+		panic_syserror("failed to restore the mapping at %p "
+			       "of %zu bytes", addr, size);
+	}
+	assert(res == addr);
+#if defined(MADV_DONTDUMP)
+	if (dontdump)
+		madvise(addr, size, MADV_DONTDUMP);
+#else
+	(void)dontdump;
+#endif
+	return rc;
+}
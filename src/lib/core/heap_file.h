@@ -0,0 +1,67 @@
+#ifndef TARANTOOL_LIB_CORE_HEAP_FILE_H_INCLUDED
+#define TARANTOOL_LIB_CORE_HEAP_FILE_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Back a private anonymous memory range that has not been
+ * touched yet with a temporary file created in the given
+ * directory. The range becomes a shared file mapping, so the
+ * kernel may write its pages that haven't been accessed for a
+ * while to the file and drop them from RAM, loading them back
+ * on the next access. The file is unlinked right away and
+ * disappears when the range is unmapped or the process exits.
+ * Disk space for the whole range is allocated in advance, so
+ * that running out of it doesn't crash the process on a write.
+ *
+ * @param addr start of the range
+ * @param size size of the range
+ * @param dir directory to create the file in
+ * @param dontdump true if the range is excluded from core dumps
+ *
+ * @retval 0 success
+ * @retval -1 error, diag is set, the range is left intact
+ */
+int
+heap_file_back(void *addr, size_t size, const char *dir, bool dontdump);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_HEAP_FILE_H_INCLUDED */
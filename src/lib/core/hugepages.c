@@ -0,0 +1,168 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "hugepages.h"
+#include "trivia/util.h"
+#include "diag.h"
+#include "say.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+const char *hugepages_mode_strs[] = { "none", "hugetlb", "thp" };
+
+#if defined(__linux__) && defined(MAP_HUGETLB) && defined(MADV_HUGEPAGE)
+
+/** Return the default huge page size, 0 if it is unknown. */
+static size_t
+hugepages_size(void)
+{
+	FILE *f = fopen("/proc/meminfo", "r");
+	if (f == NULL)
+		return 0;
+	char line[128];
+	size_t size = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		unsigned long kb;
+		if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+			size = kb * 1024;
+			break;
+		}
+	}
+	fclose(f);
+	return size;
+}
+
+/**
+ * Map a private anonymous range over the given one. Since
+ * nothing has been written to the range yet, no data is lost.
+ */
+static int
+hugepages_remap(void *addr, size_t size, int flags, bool dontdump)
+{
+	void *res = mmap(addr, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | flags,
+			 -1, 0);
+	if (res == MAP_FAILED)
+		return -1;
+	assert(res == addr);
+#if defined(MADV_DONTDUMP)
+	if (dontdump)
+		madvise(addr, size, MADV_DONTDUMP);
+#else
+	(void)dontdump;
+#endif
+	return 0;
+}
+
+enum hugepages_mode
+hugepages_back(void *addr, size_t size, bool dontdump)
+{
+	size_t page_size = hugepages_size();
+	if (page_size != 0 && (uintptr_t)addr % page_size == 0 &&
+	    size % page_size == 0) {
+		/*
+		 * Huge pages are reserved at mmap, so the call
+		 * fails right away if the pool is too small. A
+		 * failed MAP_FIXED mmap may unmap the range, so
+		 * restore it with regular pages then.
+		 */
+		if (hugepages_remap(addr, size, MAP_HUGETLB, dontdump) == 0)
+			return HUGEPAGES_HUGETLB;
+		if (hugepages_remap(addr, size, 0, dontdump) != 0) {
+			panic_syserror("failed to restore the mapping "
+				       "at %p of %zu bytes", addr, size);
+		}
+	}
+	if (madvise(addr, size, MADV_HUGEPAGE) != 0) {
+		diag_set(SystemError, "failed to enable transparent "
+			 "huge pages");
+		return HUGEPAGES_NONE;
+	}
+	return HUGEPAGES_THP;
+}
+
+ssize_t
+hugepages_used(const void *addr, size_t size)
+{
+	FILE *f = fopen("/proc/self/smaps", "r");
+	if (f == NULL) {
+		diag_set(SystemError, "failed to open /proc/self/smaps");
+		return -1;
+	}
+	uintptr_t begin = (uintptr_t)addr;
+	uintptr_t end = begin + size;
+	bool in_range = false;
+	size_t used = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		unsigned long start, stop, kb;
+		char name[32];
+		if (sscanf(line, "%lx-%lx ", &start, &stop) == 2) {
+			in_range = start < end && stop > begin;
+			continue;
+		}
+		if (!in_range ||
+		    sscanf(line, "%31[^:]: %lu kB", name, &kb) != 2)
+			continue;
+		if (strcmp(name, "AnonHugePages") == 0 ||
+		    strcmp(name, "Private_Hugetlb") == 0 ||
+		    strcmp(name, "Shared_Hugetlb") == 0)
+			used += kb * 1024;
+	}
+	fclose(f);
+	return used;
+}
+
+#else /* !defined(__linux__) || !defined(MAP_HUGETLB) */
+
+enum hugepages_mode
+hugepages_back(void *addr, size_t size, bool dontdump)
+{
+	(void)addr;
+	(void)size;
+	(void)dontdump;
+	errno = ENOSYS;
+	diag_set(SystemError, "huge pages are not supported");
+	return HUGEPAGES_NONE;
+}
+
+ssize_t
+hugepages_used(const void *addr, size_t size)
+{
+	(void)addr;
+	(void)size;
+	return 0;
+}
+
+#endif /* !defined(__linux__) || !defined(MAP_HUGETLB) */
@@ -0,0 +1,83 @@
+#ifndef TARANTOOL_LIB_CORE_HUGEPAGES_H_INCLUDED
+#define TARANTOOL_LIB_CORE_HUGEPAGES_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** The kind of huge pages backing a memory range. */
+enum hugepages_mode {
+	/** Regular pages. */
+	HUGEPAGES_NONE,
+	/** Explicit huge pages from the hugetlbfs pool. */
+	HUGEPAGES_HUGETLB,
+	/** Transparent huge pages. */
+	HUGEPAGES_THP,
+	hugepages_mode_MAX,
+};
+
+extern const char *hugepages_mode_strs[];
+
+/**
+ * Back a private anonymous memory range that has not been
+ * touched yet with huge pages. The range is remapped with
+ * explicit huge pages if the hugetlbfs pool has enough of
+ * them and the range is aligned to the huge page size,
+ * otherwise transparent huge pages are requested for it.
+ *
+ * @param addr start of the range
+ * @param size size of the range
+ * @param dontdump true if the range is excluded from core dumps
+ *
+ * @return the kind of huge pages applied, HUGEPAGES_NONE with
+ *         diag set if huge pages aren't supported
+ */
+enum hugepages_mode
+hugepages_back(void *addr, size_t size, bool dontdump);
+
+/**
+ * Return the number of bytes of a memory range backed by
+ * huge pages, -1 with diag set if it is unknown.
+ */
+ssize_t
+hugepages_used(const void *addr, size_t size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_HUGEPAGES_H_INCLUDED */
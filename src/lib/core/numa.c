@@ -0,0 +1,133 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "numa.h"
+#include "trivia/config.h"
+#include "trivia/util.h"
+#include "diag.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(HAVE_LINUX_MEMPOLICY_H)
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+const char *numa_policy_strs[] = { "default", "local", "interleave" };
+
+#if defined(HAVE_LINUX_MEMPOLICY_H)
+
+enum {
+	/** Max number of nodes in a node mask. */
+	NUMA_NODES_MAX = 1024,
+	NUMA_MASK_BITS = CHAR_BIT * sizeof(unsigned long),
+};
+
+int
+numa_current_node(void)
+{
+	unsigned cpu, node;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+		return -1;
+	return node;
+}
+
+int
+numa_set_memory_policy(void *addr, size_t size, enum numa_policy policy)
+{
+	unsigned long mask[NUMA_NODES_MAX / NUMA_MASK_BITS];
+	memset(mask, 0, sizeof(mask));
+	int mode;
+	switch (policy) {
+	case NUMA_POLICY_DEFAULT:
+		mode = MPOL_DEFAULT;
+		break;
+	case NUMA_POLICY_LOCAL: {
+		/*
+		 * Sic: MPOL_BIND would make the allocation fail
+		 * when the node runs out of memory, while the
+		 * preferred node is only tried first.
+		 */
+		mode = MPOL_PREFERRED;
+		int node = numa_current_node();
+		if (node < 0 || node >= NUMA_NODES_MAX) {
+			diag_set(SystemError, "failed to get the NUMA node");
+			return -1;
+		}
+		mask[node / NUMA_MASK_BITS] |= 1UL << (node % NUMA_MASK_BITS);
+		break;
+	}
+	case NUMA_POLICY_INTERLEAVE:
+		mode = MPOL_INTERLEAVE;
+		if (syscall(SYS_get_mempolicy, NULL, mask, NUMA_NODES_MAX,
+			    NULL, MPOL_F_MEMS_ALLOWED) != 0) {
+			diag_set(SystemError, "failed to get NUMA nodes");
+			return -1;
+		}
+		break;
+	default:
+		unreachable();
+		return -1;
+	}
+	if (syscall(SYS_mbind, addr, size, mode,
+		    mode == MPOL_DEFAULT ? NULL : mask,
+		    mode == MPOL_DEFAULT ? 0 : NUMA_NODES_MAX, 0) != 0) {
+		diag_set(SystemError, "failed to set NUMA policy '%s'",
+			 numa_policy_strs[policy]);
+		return -1;
+	}
+	return 0;
+}
+
+#else /* !defined(HAVE_LINUX_MEMPOLICY_H) */
+
+int
+numa_current_node(void)
+{
+	return -1;
+}
+
+int
+numa_set_memory_policy(void *addr, size_t size, enum numa_policy policy)
+{
+	(void)addr;
+	(void)size;
+	if (policy == NUMA_POLICY_DEFAULT)
+		return 0;
+	errno = ENOSYS;
+	diag_set(SystemError, "failed to set NUMA policy '%s'",
+		 numa_policy_strs[policy]);
+	return -1;
+}
+
+#endif /* !defined(HAVE_LINUX_MEMPOLICY_H) */
@@ -0,0 +1,75 @@
+#ifndef TARANTOOL_LIB_CORE_NUMA_H_INCLUDED
+#define TARANTOOL_LIB_CORE_NUMA_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** NUMA memory placement policy. */
+enum numa_policy {
+	/** Use the policy of the thread touching the memory. */
+	NUMA_POLICY_DEFAULT,
+	/** Prefer the node of the thread setting the policy. */
+	NUMA_POLICY_LOCAL,
+	/** Interleave pages over all allowed nodes. */
+	NUMA_POLICY_INTERLEAVE,
+	numa_policy_MAX,
+};
+
+extern const char *numa_policy_strs[];
+
+/**
+ * Return the NUMA node the calling thread runs on,
+ * -1 if it is unknown.
+ */
+int
+numa_current_node(void);
+
+/**
+ * Set a NUMA placement policy for a page aligned memory range.
+ * Affects pages that have not been touched yet only.
+ *
+ * @retval 0 success
+ * @retval -1 the policy is not supported by the system,
+ *            diag is set
+ */
+int
+numa_set_memory_policy(void *addr, size_t size, enum numa_policy policy);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_NUMA_H_INCLUDED */
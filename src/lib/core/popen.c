@@ -466,6 +466,156 @@ popen_read_timeout(struct popen_handle *handle, void *buf,
 					    timeout);
 }
 
+enum {
+	/** Max number of bytes moved by one splice() call. */
+	POPEN_SPLICE_CHUNK_SIZE = 64 * 1024,
+	/** Size of a bounce buffer where splice() is absent. */
+	POPEN_SPLICE_BUF_SIZE = 16 * 1024,
+};
+
+/**
+ * Move data from @a fd_in to @a fd_out until @a count bytes are
+ * moved or EOF is read. One of fds is a child's pipe and the
+ * other one is @a fd passed to popen_splice_timeout().
+ *
+ * Both fds may be non-blocking. When a transfer can't progress
+ * it isn't known which of them isn't ready, so the fds are
+ * waited for in turn: a wasted wakeup costs one syscall.
+ * A blocking fd is never waited for.
+ */
+static ssize_t
+popen_splice_fds(int fd_in, int fd_out, bool wait_in, bool wait_out,
+		 size_t count, ev_tstamp timeout)
+{
+	ev_tstamp start, delay;
+	coio_timeout_init(&start, &delay, timeout);
+	size_t total = 0;
+	bool turn_in = true;
+#ifndef TARGET_OS_LINUX
+	/*
+	 * No splice() here, copy through a buffer. Data once
+	 * read is written out in full, so only fd_in is waited
+	 * for in this loop.
+	 */
+	char buf[POPEN_SPLICE_BUF_SIZE];
+	wait_out = false;
+#endif
+	while (total < count) {
+		size_t len = MIN(count - total,
+				 (size_t)POPEN_SPLICE_CHUNK_SIZE);
+#ifdef TARGET_OS_LINUX
+		ssize_t rc = splice(fd_in, NULL, fd_out, NULL, len,
+				    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+#else
+		ssize_t rc = read(fd_in, buf, MIN(len, sizeof(buf)));
+		if (rc > 0 && coio_write_fd_timeout(fd_out, buf, rc,
+						    delay) != 0)
+			return -1;
+#endif
+		if (rc > 0) {
+			total += rc;
+			coio_timeout_update(&start, &delay);
+			continue;
+		}
+		if (rc == 0)
+			break;
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			diag_set(SystemError, "popen: splice failed");
+			return -1;
+		}
+		if (fiber_is_cancelled()) {
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+		if (delay <= 0) {
+			diag_set(TimedOut);
+			return -1;
+		}
+		assert(wait_in || wait_out);
+		bool in = wait_in && (!wait_out || turn_in);
+		coio_wait(in ? fd_in : fd_out, in ? COIO_READ : COIO_WRITE,
+			  delay);
+		turn_in = !turn_in;
+		coio_timeout_update(&start, &delay);
+	}
+	return total;
+}
+
+/**
+ * Move data between a child's peer and a file descriptor @a fd
+ * without copying it to the user space where the platform
+ * allows (Linux splice(2)).
+ *
+ * When POPEN_FLAG_FD_STDOUT or POPEN_FLAG_FD_STDERR is set in
+ * @a flags, the child's output is written to @a fd. When
+ * POPEN_FLAG_FD_STDIN is set, data read from @a fd is written
+ * to the child's input. @a fd may be a file, a socket or a pipe,
+ * including another child's peer.
+ *
+ * Yield until @a count bytes are moved or EOF is read from the
+ * source. Pass SIZE_MAX to move everything until EOF.
+ *
+ * Returns amount of moved bytes at success, otherwise returns
+ * -1 and set a diag. Like popen_write_timeout() the function
+ * may fail after a partial transfer.
+ *
+ * Possible errors:
+ *
+ * - IllegalParams: a parameter check fails:
+ *   - flags: not exactly one of stdin, stdout, stderr is set.
+ *   - handle: handle does not support the requested IO operation.
+ *   - handle: attempt to operate on a closed fd.
+ * - SystemError: an IO error occurs at splice().
+ * - TimedOut: @a timeout quota is exceeded.
+ * - FiberIsCancelled: cancelled by an outside code.
+ */
+ssize_t
+popen_splice_timeout(struct popen_handle *handle, int fd, size_t count,
+		     unsigned int flags, ev_tstamp timeout)
+{
+	assert(handle != NULL);
+
+	if (count > (size_t)SSIZE_MAX)
+		count = SSIZE_MAX;
+
+	flags &= POPEN_FLAG_FD_STDIN | POPEN_FLAG_FD_STDOUT |
+		 POPEN_FLAG_FD_STDERR;
+	if (flags != POPEN_FLAG_FD_STDIN && flags != POPEN_FLAG_FD_STDOUT &&
+	    flags != POPEN_FLAG_FD_STDERR) {
+		diag_set(IllegalParams, "popen: exactly one of stdin, "
+			 "stdout and stderr must be set");
+		return -1;
+	}
+
+	int idx = flags & POPEN_FLAG_FD_STDIN ? STDIN_FILENO :
+		  flags & POPEN_FLAG_FD_STDOUT ? STDOUT_FILENO :
+		  STDERR_FILENO;
+
+	if (popen_may_io(handle, idx, flags) != 0)
+		return -1;
+
+	int fd_flags = fcntl(fd, F_GETFL);
+	if (fd_flags < 0) {
+		diag_set(SystemError, "popen: bad file descriptor %d", fd);
+		return -1;
+	}
+	bool fd_nonblock = (fd_flags & O_NONBLOCK) != 0;
+
+	say_debug("popen: %d: splice idx [%s:%d] fd %d count %zu "
+		  "fds %d timeout %.9g",
+		  handle->pid, stdX_str(idx), idx, fd, count,
+		  handle->ios[idx].fd, timeout);
+
+	int peer = handle->ios[idx].fd;
+	if (idx == STDIN_FILENO)
+		return popen_splice_fds(fd, peer, fd_nonblock, true,
+					count, timeout);
+	return popen_splice_fds(peer, fd, true, fd_nonblock,
+				count, timeout);
+}
+
 /**
  * Close parent's ends of std* fds.
  *
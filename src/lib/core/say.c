@@ -32,8 +32,10 @@
 #include "fiber.h"
 #include "errinj.h"
 #include "tt_static.h"
+#include "msgpuck.h"
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -82,6 +84,12 @@ static inline int
 log_vsay(struct log *log, int level, const char *filename, int line,
 	 const char *error, const char *format, va_list ap);
 
+static void
+log_async_stop(void);
+
+static void
+say_binary_formats_reset(void);
+
 /** Default logger used before logging subsystem is initialized. */
 static struct log log_boot = {
 	.fd = STDERR_FILENO,
@@ -221,6 +229,9 @@ say_set_log_format(enum say_format format)
 	case SF_PLAIN:
 		format_func = say_format_plain;
 		break;
+	case SF_BINARY:
+		format_func = say_format_binary;
+		break;
 	default:
 		unreachable();
 	}
@@ -232,6 +243,7 @@ say_set_log_format(enum say_format format)
 static const char *say_format_strs[] = {
 	[SF_PLAIN] = "plain",
 	[SF_JSON] = "json",
+	[SF_BINARY] = "binary",
 	[say_format_MAX] = "unknown"
 };
 
@@ -282,6 +294,10 @@ log_rotate(struct log *log)
 
 	log_set_nonblock(log);
 
+	/* Definitions of format strings must be in the new file. */
+	if (log->format_func == say_format_binary)
+		say_binary_formats_reset();
+
 	/* We are in ev signal handler
 	 * so we don't have to be worry about async signal safety
 	 */
@@ -639,6 +655,7 @@ log_create(struct log *log, const char *init_str, int nonblock)
 	log->format_func = NULL;
 	log->level = S_INFO;
 	log->rotating_threads = 0;
+	log->is_async = false;
 	fiber_cond_create(&log->rotate_cond);
 	ev_async_init(&log->log_async, log_rotate_async_cb);
 	setvbuf(stderr, NULL, _IONBF, 0);
@@ -750,8 +767,10 @@ fail:
 void
 say_logger_free(void)
 {
-	if (say_logger_initialized())
+	if (say_logger_initialized()) {
+		log_async_stop();
 		log_destroy(&log_std);
+	}
 }
 
 /** {{{ Formatters */
@@ -977,6 +996,391 @@ say_format_syslog(struct log *log, char *buf, int len, int level, const char *fi
 	return total;
 }
 
+/**
+ * Binary log format.
+ *
+ * Every message is a MessagePack array:
+ *
+ *   [SAY_BINARY_MESSAGE, time, level, pid, cord_name, fiber_id,
+ *    fiber_name, file, line, format_id, [arg, ...], error]
+ *
+ * where absent values are nil. Instead of being formatted, the
+ * arguments are stored as they were passed: integers, doubles and
+ * strings. The format string itself is stored once per log file,
+ * in a definition preceding the first message that uses it:
+ *
+ *   [SAY_BINARY_FORMAT, format_id, format]
+ *
+ * Messages are turned into text offline, see log.decode().
+ */
+enum {
+	SAY_BINARY_FORMAT = 0,
+	SAY_BINARY_MESSAGE = 1,
+	/** Max number of stored arguments of a message. */
+	SAY_BINARY_ARGS_MAX = 32,
+	/** Max length of file, cord and fiber names and error. */
+	SAY_BINARY_NAME_MAX = 256,
+};
+
+enum say_binary_arg_type {
+	SAY_BINARY_ARG_INT,
+	SAY_BINARY_ARG_UINT,
+	SAY_BINARY_ARG_DOUBLE,
+	SAY_BINARY_ARG_STR,
+};
+
+struct say_binary_arg {
+	enum say_binary_arg_type type;
+	union {
+		int64_t ival;
+		uint64_t uval;
+		double dval;
+		struct {
+			const char *data;
+			uint32_t len;
+		} str;
+	};
+};
+
+/** Format string pointer to id map shared by all threads. */
+static struct {
+	pthread_mutex_t mutex;
+	/** Open addressing hash table of format strings. */
+	const char **formats;
+	/** Ids of the format strings, 0 for a free slot. */
+	uint32_t *ids;
+	/** Number of slots, a power of two. */
+	uint32_t capacity;
+	/** Number of used slots. */
+	uint32_t count;
+} say_binary_formats = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static uint32_t
+say_binary_slot(const char **formats, uint32_t capacity, const char *format)
+{
+	uint32_t mask = capacity - 1;
+	uint32_t i = ((uintptr_t)format >> 3) * 2654435761u & mask;
+	while (formats[i] != NULL && formats[i] != format)
+		i = (i + 1) & mask;
+	return i;
+}
+
+static int
+say_binary_formats_grow(void)
+{
+	uint32_t capacity = say_binary_formats.capacity == 0 ? 256 :
+			    say_binary_formats.capacity * 2;
+	const char **formats = calloc(capacity, sizeof(*formats));
+	uint32_t *ids = calloc(capacity, sizeof(*ids));
+	if (formats == NULL || ids == NULL) {
+		free(formats);
+		free(ids);
+		return -1;
+	}
+	for (uint32_t i = 0; i < say_binary_formats.capacity; i++) {
+		const char *format = say_binary_formats.formats[i];
+		if (format == NULL)
+			continue;
+		uint32_t j = say_binary_slot(formats, capacity, format);
+		formats[j] = format;
+		ids[j] = say_binary_formats.ids[i];
+	}
+	free(say_binary_formats.formats);
+	free(say_binary_formats.ids);
+	say_binary_formats.formats = formats;
+	say_binary_formats.ids = ids;
+	say_binary_formats.capacity = capacity;
+	return 0;
+}
+
+/**
+ * Get the id of a format string. Set @a is_new if the id has
+ * just been assigned, so the definition must be written. On
+ * memory error the format is defined with id 0 every time.
+ */
+static uint32_t
+say_binary_format_id(const char *format, bool *is_new)
+{
+	uint32_t id = 0;
+	*is_new = true;
+	tt_pthread_mutex_lock(&say_binary_formats.mutex);
+	if (say_binary_formats.count * 2 >= say_binary_formats.capacity &&
+	    say_binary_formats_grow() != 0)
+		goto out;
+	uint32_t i = say_binary_slot(say_binary_formats.formats,
+				     say_binary_formats.capacity, format);
+	if (say_binary_formats.formats[i] != NULL) {
+		id = say_binary_formats.ids[i];
+		*is_new = false;
+		goto out;
+	}
+	id = ++say_binary_formats.count;
+	say_binary_formats.formats[i] = format;
+	say_binary_formats.ids[i] = id;
+out:
+	tt_pthread_mutex_unlock(&say_binary_formats.mutex);
+	return id;
+}
+
+/**
+ * Forget all format ids so that the definitions are written
+ * again, e.g. to a new log file after rotation.
+ */
+static void
+say_binary_formats_reset(void)
+{
+	tt_pthread_mutex_lock(&say_binary_formats.mutex);
+	if (say_binary_formats.capacity > 0) {
+		memset(say_binary_formats.formats, 0,
+		       say_binary_formats.capacity *
+		       sizeof(*say_binary_formats.formats));
+		memset(say_binary_formats.ids, 0,
+		       say_binary_formats.capacity *
+		       sizeof(*say_binary_formats.ids));
+	}
+	say_binary_formats.count = 0;
+	tt_pthread_mutex_unlock(&say_binary_formats.mutex);
+}
+
+/**
+ * Fetch the arguments of a printf-like format from @a ap. Width
+ * and precision given with '*' are stored as arguments too.
+ * @return the number of stored arguments.
+ */
+static int
+say_binary_parse_args(const char *format, va_list ap,
+		      struct say_binary_arg *args)
+{
+	int count = 0;
+	for (const char *p = format; *p != '\0'; p++) {
+		if (*p != '%')
+			continue;
+		p++;
+		if (*p == '%')
+			continue;
+		if (count + 3 > SAY_BINARY_ARGS_MAX)
+			break;
+		while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+			p++;
+		if (*p == '*') {
+			args[count].type = SAY_BINARY_ARG_INT;
+			args[count++].ival = va_arg(ap, int);
+			p++;
+		}
+		while (*p >= '0' && *p <= '9')
+			p++;
+		int precision = -1;
+		if (*p == '.') {
+			p++;
+			if (*p == '*') {
+				precision = va_arg(ap, int);
+				args[count].type = SAY_BINARY_ARG_INT;
+				args[count++].ival = precision;
+				p++;
+			} else {
+				precision = 0;
+				for (; *p >= '0' && *p <= '9'; p++)
+					precision = precision * 10 + *p - '0';
+			}
+		}
+		int longness = 0;
+		bool is_size = false;
+		bool is_long_double = false;
+		for (; *p != '\0' && strchr("hlqjztL", *p) != NULL; p++) {
+			if (*p == 'l' || *p == 'q')
+				longness++;
+			else if (*p == 'j' || *p == 'z' || *p == 't')
+				is_size = true;
+			else if (*p == 'L')
+				is_long_double = true;
+		}
+		struct say_binary_arg *arg = &args[count];
+		switch (*p) {
+		case 'd':
+		case 'i':
+			arg->type = SAY_BINARY_ARG_INT;
+			if (is_size || longness > 1)
+				arg->ival = va_arg(ap, long long);
+			else if (longness == 1)
+				arg->ival = va_arg(ap, long);
+			else
+				arg->ival = va_arg(ap, int);
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			arg->type = SAY_BINARY_ARG_UINT;
+			if (is_size || longness > 1)
+				arg->uval = va_arg(ap, unsigned long long);
+			else if (longness == 1)
+				arg->uval = va_arg(ap, unsigned long);
+			else
+				arg->uval = va_arg(ap, unsigned);
+			break;
+		case 'c':
+			arg->type = SAY_BINARY_ARG_INT;
+			arg->ival = va_arg(ap, int);
+			break;
+		case 'p':
+			arg->type = SAY_BINARY_ARG_UINT;
+			arg->uval = (uintptr_t)va_arg(ap, void *);
+			break;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			arg->type = SAY_BINARY_ARG_DOUBLE;
+			if (is_long_double)
+				arg->dval = va_arg(ap, long double);
+			else
+				arg->dval = va_arg(ap, double);
+			break;
+		case 's':
+		{
+			const char *s = va_arg(ap, const char *);
+			if (s == NULL)
+				s = "(null)";
+			arg->type = SAY_BINARY_ARG_STR;
+			arg->str.data = s;
+			arg->str.len = precision >= 0 ?
+				       strnlen(s, precision) : strlen(s);
+			break;
+		}
+		case 'n':
+			(void) va_arg(ap, void *);
+			continue;
+		case '\0':
+			return count;
+		default:
+			/* %m and unknown conversions take no argument. */
+			continue;
+		}
+		count++;
+	}
+	return count;
+}
+
+static char *
+say_binary_encode_str(char *pos, const char *str, uint32_t len)
+{
+	if (str == NULL)
+		return mp_encode_nil(pos);
+	return mp_encode_str(pos, str, len);
+}
+
+/**
+ * Format the log message in the binary format, see above.
+ */
+int
+say_format_binary(struct log *log, char *buf, int len, int level,
+		  const char *filename, int line, const char *error,
+		  const char *format, va_list ap)
+{
+	(void) log;
+	struct say_binary_arg args[SAY_BINARY_ARGS_MAX];
+	int arg_count = say_binary_parse_args(format, ap, args);
+
+	const char *cord_name = NULL;
+	const char *fname = NULL;
+	uint32_t fiber_id = 0;
+	struct cord *cord = cord();
+	if (cord != NULL) {
+		cord_name = cord->name;
+		if (fiber() != NULL && fiber()->fid != FIBER_ID_SCHED) {
+			fiber_id = fiber()->fid;
+			fname = fiber_name(fiber());
+		}
+	}
+	uint32_t cord_name_len = cord_name == NULL ? 0 :
+		strnlen(cord_name, SAY_BINARY_NAME_MAX);
+	uint32_t fname_len = fname == NULL ? 0 :
+		strnlen(fname, SAY_BINARY_NAME_MAX);
+	uint32_t filename_len = filename == NULL ? 0 :
+		strnlen(filename, SAY_BINARY_NAME_MAX);
+	uint32_t error_len = error == NULL ? 0 :
+		strnlen(error, SAY_BINARY_NAME_MAX);
+
+	bool is_new;
+	uint32_t format_id = say_binary_format_id(format, &is_new);
+	uint32_t format_len = is_new ? strlen(format) : 0;
+
+	/*
+	 * Everything but string arguments has a bounded size,
+	 * string arguments share what is left of the buffer.
+	 */
+	size_t size = mp_sizeof_array(3) + mp_sizeof_uint(0) +
+		      mp_sizeof_uint(format_id) + mp_sizeof_str(format_len) +
+		      mp_sizeof_array(12) + mp_sizeof_uint(SAY_BINARY_MESSAGE) +
+		      mp_sizeof_double(0) + mp_sizeof_uint(level) +
+		      mp_sizeof_uint(UINT32_MAX) +
+		      mp_sizeof_str(cord_name_len) +
+		      mp_sizeof_uint(fiber_id) + mp_sizeof_str(fname_len) +
+		      mp_sizeof_str(filename_len) + mp_sizeof_uint(UINT32_MAX) +
+		      mp_sizeof_uint(format_id) + mp_sizeof_array(arg_count) +
+		      arg_count * mp_sizeof_uint(UINT64_MAX) +
+		      mp_sizeof_str(error_len);
+	/* Keep a byte for the terminating zero like text formats do. */
+	if (size >= (size_t)len)
+		return -1;
+	size_t left = len - 1 - size;
+	for (int i = 0; i < arg_count; i++) {
+		if (args[i].type != SAY_BINARY_ARG_STR)
+			continue;
+		args[i].str.len = MIN(args[i].str.len, left);
+		left -= args[i].str.len;
+	}
+
+	char *pos = buf;
+	if (is_new) {
+		pos = mp_encode_array(pos, 3);
+		pos = mp_encode_uint(pos, SAY_BINARY_FORMAT);
+		pos = mp_encode_uint(pos, format_id);
+		pos = mp_encode_str(pos, format, format_len);
+	}
+	pos = mp_encode_array(pos, 12);
+	pos = mp_encode_uint(pos, SAY_BINARY_MESSAGE);
+	/* Don't use ev_now() since it requires a working event loop. */
+	pos = mp_encode_double(pos, ev_time());
+	pos = mp_encode_uint(pos, level);
+	pos = mp_encode_uint(pos, getpid());
+	pos = say_binary_encode_str(pos, cord_name, cord_name_len);
+	pos = fname == NULL ? mp_encode_nil(pos) :
+	      mp_encode_uint(pos, fiber_id);
+	pos = say_binary_encode_str(pos, fname, fname_len);
+	pos = say_binary_encode_str(pos, filename, filename_len);
+	pos = mp_encode_uint(pos, line);
+	pos = mp_encode_uint(pos, format_id);
+	pos = mp_encode_array(pos, arg_count);
+	for (int i = 0; i < arg_count; i++) {
+		struct say_binary_arg *arg = &args[i];
+		switch (arg->type) {
+		case SAY_BINARY_ARG_INT:
+			pos = arg->ival < 0 ? mp_encode_int(pos, arg->ival) :
+			      mp_encode_uint(pos, arg->ival);
+			break;
+		case SAY_BINARY_ARG_UINT:
+			pos = mp_encode_uint(pos, arg->uval);
+			break;
+		case SAY_BINARY_ARG_DOUBLE:
+			pos = mp_encode_double(pos, arg->dval);
+			break;
+		case SAY_BINARY_ARG_STR:
+			pos = mp_encode_str(pos, arg->str.data, arg->str.len);
+			break;
+		}
+	}
+	pos = say_binary_encode_str(pos, error, error_len);
+	assert(pos < buf + len);
+	return pos - buf;
+}
+
 /** Formatters }}} */
 
 /** {{{ Loggers */
@@ -1028,13 +1432,13 @@ say_default(int level, const char *filename, int line, const char *error,
  * File and pipe logger
  */
 static void
-write_to_file(struct log *log, int total)
+write_to_file(struct log *log, const char *data, int total)
 {
 	assert(log->type == SAY_LOGGER_FILE ||
 	       log->type == SAY_LOGGER_PIPE ||
 	       log->type == SAY_LOGGER_STDERR);
 	assert(total >= 0);
-	ssize_t r = safe_write(log->fd, buf, total);
+	ssize_t r = safe_write(log->fd, data, total);
 	(void) r;                               /* silence gcc warning */
 }
 
@@ -1042,11 +1446,11 @@ write_to_file(struct log *log, int total)
  * Syslog logger
  */
 static void
-write_to_syslog(struct log *log, int total)
+write_to_syslog(struct log *log, const char *data, int total)
 {
 	assert(log->type == SAY_LOGGER_SYSLOG);
 	assert(total >= 0);
-	if (log->fd < 0 || safe_write(log->fd, buf, total) <= 0) {
+	if (log->fd < 0 || safe_write(log->fd, data, total) <= 0) {
 		/*
 		 * Try to reconnect, if write to syslog has
 		 * failed. Syslog write can fail, if, for example,
@@ -1064,12 +1468,287 @@ write_to_syslog(struct log *log, int total)
 			 * it would block thread. Try to reconnect
 			 * on next vsay().
 			 */
-			ssize_t r = safe_write(log->fd, buf, total);
+			ssize_t r = safe_write(log->fd, data, total);
 			(void) r;               /* silence gcc warning */
 		}
 	}
 }
 
+/**
+ * Asynchronous logger
+ */
+
+enum {
+	/** Size of a per-thread ring of formatted messages. */
+	LOG_RING_SIZE = 1024 * 1024,
+	/** Size of a buffer used to write several messages at once. */
+	LOG_WRITE_BATCH_SIZE = 64 * 1024,
+};
+
+static_assert(LOG_WRITE_BATCH_SIZE >= SAY_BUF_LEN_MAX + sizeof(uint32_t),
+	      "a message must fit into a write batch");
+
+/**
+ * A lock-free single producer single consumer ring of formatted
+ * messages. Each message is stored as its length followed by its
+ * text, possibly wrapping around the end of the ring. A thread
+ * takes a ring on its first message and returns it on exit, so
+ * that the ring can be reused by another thread. Rings are never
+ * freed.
+ */
+struct log_ring {
+	/** Position of the next byte to write, advanced by producer. */
+	alignas(CACHELINE_SIZE) uint64_t tail;
+	/** Number of messages dropped because the ring was full. */
+	uint64_t dropped;
+	/** Position of the next byte to read, advanced by consumer. */
+	alignas(CACHELINE_SIZE) uint64_t head;
+	/** Set while the ring is used by a thread. */
+	bool is_taken;
+	/** Next ring in the list of all rings, never changes. */
+	struct log_ring *next;
+	/** Message data. */
+	char data[LOG_RING_SIZE];
+};
+
+static struct {
+	/** The thread which writes messages from all rings. */
+	struct cord cord;
+	/** Event loop of the logger thread, set once it's ready. */
+	struct ev_loop *loop;
+	/** Wakes up the logger thread. */
+	struct ev_async async;
+	/** Set when the logger thread is asked to stop. */
+	bool is_stopping;
+	/** List of all rings, new rings are pushed to the head. */
+	struct log_ring *rings;
+	/** Returns the ring of a thread on the thread exit. */
+	pthread_key_t ring_key;
+} async_logger;
+
+/** The ring of the current thread. */
+static __thread struct log_ring *log_ring;
+
+static void
+log_ring_release(void *arg)
+{
+	struct log_ring *ring = arg;
+	pm_atomic_store_explicit(&ring->is_taken, false,
+				 pm_memory_order_release);
+}
+
+/** Find a free ring or allocate a new one. */
+static struct log_ring *
+log_ring_take(void)
+{
+	struct log_ring *ring = pm_atomic_load_explicit(&async_logger.rings,
+						pm_memory_order_acquire);
+	for (; ring != NULL; ring = ring->next) {
+		bool is_taken = false;
+		if (pm_atomic_compare_exchange_strong(&ring->is_taken,
+						      &is_taken, true))
+			goto out;
+	}
+	ring = malloc(sizeof(*ring));
+	if (ring == NULL)
+		return NULL;
+	ring->tail = 0;
+	ring->dropped = 0;
+	ring->head = 0;
+	ring->is_taken = true;
+	ring->next = pm_atomic_load(&async_logger.rings);
+	while (!pm_atomic_compare_exchange_weak(&async_logger.rings,
+						&ring->next, ring))
+		;
+out:
+	pthread_setspecific(async_logger.ring_key, ring);
+	return ring;
+}
+
+static void
+log_ring_copy_in(struct log_ring *ring, uint64_t pos, const void *src,
+		 size_t size)
+{
+	size_t offset = pos % LOG_RING_SIZE;
+	size_t n = MIN(size, LOG_RING_SIZE - offset);
+	memcpy(ring->data + offset, src, n);
+	memcpy(ring->data, (const char *)src + n, size - n);
+}
+
+static void
+log_ring_copy_out(struct log_ring *ring, uint64_t pos, void *dst,
+		  size_t size)
+{
+	size_t offset = pos % LOG_RING_SIZE;
+	size_t n = MIN(size, LOG_RING_SIZE - offset);
+	memcpy(dst, ring->data + offset, n);
+	memcpy((char *)dst + n, ring->data, size - n);
+}
+
+/**
+ * Pass a formatted message to the logger thread. Wake it up if
+ * it has already written everything pushed before.
+ *
+ * @retval  0 the message is queued or dropped
+ * @retval -1 the message must be written synchronously
+ */
+static int
+log_async_push(const char *data, int total)
+{
+	struct log_ring *ring = log_ring;
+	if (ring == NULL) {
+		ring = log_ring = log_ring_take();
+		if (ring == NULL)
+			return -1;
+	}
+	total = MIN(total, SAY_BUF_LEN_MAX - 1);
+	uint32_t len = total;
+	uint64_t tail = ring->tail;
+	uint64_t head = pm_atomic_load_explicit(&ring->head,
+						pm_memory_order_acquire);
+	if (LOG_RING_SIZE - (tail - head) < sizeof(len) + len) {
+		pm_atomic_fetch_add_explicit(&ring->dropped, 1,
+					     pm_memory_order_relaxed);
+		return 0;
+	}
+	log_ring_copy_in(ring, tail, &len, sizeof(len));
+	log_ring_copy_in(ring, tail + sizeof(len), data, len);
+	pm_atomic_store_explicit(&ring->tail, tail + sizeof(len) + len,
+				 pm_memory_order_release);
+	/*
+	 * Pairs with the fence in log_ring_flush(): either the
+	 * logger sees the new tail, or we see that it's done with
+	 * the ring and has to be woken up.
+	 */
+	pm_atomic_thread_fence(pm_memory_order_seq_cst);
+	head = pm_atomic_load_explicit(&ring->head, pm_memory_order_relaxed);
+	struct ev_loop *loop = pm_atomic_load_explicit(&async_logger.loop,
+						pm_memory_order_acquire);
+	if (head == tail && loop != NULL)
+		ev_async_send(loop, &async_logger.async);
+	return 0;
+}
+
+/** Write all messages of a ring to the default log. */
+static void
+log_ring_flush(struct log_ring *ring)
+{
+	static char batch[LOG_WRITE_BATCH_SIZE];
+	struct log *log = log_default;
+	uint64_t head = ring->head;
+	uint64_t tail = pm_atomic_load_explicit(&ring->tail,
+						pm_memory_order_acquire);
+	while (head != tail) {
+		int size = 0;
+		while (head != tail) {
+			uint32_t len;
+			log_ring_copy_out(ring, head, &len, sizeof(len));
+			if (size + len > sizeof(batch))
+				break;
+			log_ring_copy_out(ring, head + sizeof(len),
+					  batch + size, len);
+			head += sizeof(len) + len;
+			if (log->type == SAY_LOGGER_SYSLOG) {
+				/* One datagram per message. */
+				write_to_syslog(log, batch, len);
+				continue;
+			}
+			size += len;
+		}
+		pm_atomic_store_explicit(&ring->head, head,
+					 pm_memory_order_release);
+		for (int done = 0; done < size; ) {
+			ssize_t r = write(log->fd, batch + done, size - done);
+			if (r <= 0)
+				break;
+			done += r;
+		}
+		pm_atomic_thread_fence(pm_memory_order_seq_cst);
+		tail = pm_atomic_load_explicit(&ring->tail,
+					       pm_memory_order_acquire);
+	}
+}
+
+static void
+log_async_flush(void)
+{
+	struct log_ring *ring = pm_atomic_load_explicit(&async_logger.rings,
+						pm_memory_order_acquire);
+	for (; ring != NULL; ring = ring->next)
+		log_ring_flush(ring);
+}
+
+static void
+log_async_cb(struct ev_loop *loop, struct ev_async *watcher, int events)
+{
+	(void) watcher;
+	(void) events;
+	log_async_flush();
+	if (pm_atomic_load(&async_logger.is_stopping))
+		ev_break(loop, EVBREAK_ALL);
+}
+
+static void *
+log_async_f(void *arg)
+{
+	(void) arg;
+	ev_async_init(&async_logger.async, log_async_cb);
+	ev_async_start(loop(), &async_logger.async);
+	pm_atomic_store_explicit(&async_logger.loop, loop(),
+				 pm_memory_order_release);
+	/* Write messages pushed before the loop was published. */
+	ev_feed_event(loop(), &async_logger.async, EV_CUSTOM);
+	ev_run(loop(), 0);
+	ev_async_stop(loop(), &async_logger.async);
+	log_async_flush();
+	return NULL;
+}
+
+int
+say_logger_set_async(void)
+{
+	if (log_default->is_async)
+		return 0;
+	if (pthread_key_create(&async_logger.ring_key, log_ring_release) != 0) {
+		diag_set(SystemError, "failed to create a logger thread key");
+		return -1;
+	}
+	if (cord_start(&async_logger.cord, "logger", log_async_f, NULL) != 0) {
+		pthread_key_delete(async_logger.ring_key);
+		return -1;
+	}
+	log_default->is_async = true;
+	return 0;
+}
+
+uint64_t
+say_logger_dropped(void)
+{
+	uint64_t dropped = 0;
+	struct log_ring *ring = pm_atomic_load_explicit(&async_logger.rings,
+						pm_memory_order_acquire);
+	for (; ring != NULL; ring = ring->next)
+		dropped += pm_atomic_load_explicit(&ring->dropped,
+						   pm_memory_order_relaxed);
+	return dropped;
+}
+
+/** Stop the logger thread after writing all queued messages. */
+static void
+log_async_stop(void)
+{
+	if (!log_default->is_async)
+		return;
+	log_default->is_async = false;
+	pm_atomic_store(&async_logger.is_stopping, true);
+	struct ev_loop *loop = pm_atomic_load(&async_logger.loop);
+	if (loop != NULL)
+		ev_async_send(loop, &async_logger.async);
+	cord_join(&async_logger.cord);
+	pm_atomic_store(&async_logger.loop, NULL);
+	pm_atomic_store(&async_logger.is_stopping, false);
+}
+
 /** Loggers }}} */
 
 /*
@@ -1240,14 +1919,19 @@ log_vsay(struct log *log, int level, const char *filename, int line,
 	}
 	int total = log->format_func(log, buf, sizeof(buf), level,
 				     filename, line, error, format, ap);
+	if (log->is_async && level != S_FATAL &&
+	    log_async_push(buf, total) == 0) {
+		errno = errsv;
+		return total;
+	}
 	switch (log->type) {
 	case SAY_LOGGER_FILE:
 	case SAY_LOGGER_PIPE:
 	case SAY_LOGGER_STDERR:
-		write_to_file(log, total);
+		write_to_file(log, buf, total);
 		break;
 	case SAY_LOGGER_SYSLOG:
-		write_to_syslog(log, total);
+		write_to_syslog(log, buf, total);
 		if (level == S_FATAL && log->fd != STDERR_FILENO)
 			(void) safe_write(STDERR_FILENO, buf, total);
 		break;
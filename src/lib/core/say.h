@@ -33,6 +33,7 @@
 #include <trivia/util.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <sys/types.h> /* pid_t */
@@ -65,6 +66,7 @@ enum say_level {
 enum say_format {
 	SF_PLAIN,
 	SF_JSON,
+	SF_BINARY,
 	say_format_MAX
 };
 
@@ -157,6 +159,11 @@ struct log {
 	 */
 	char *path;
 	bool nonblock;
+	/**
+	 * Set if messages are passed to the logger thread
+	 * instead of being written by the calling thread.
+	 */
+	bool is_async;
 	log_format_func_t format_func;
 	/** pid of the process if logging to pipe. */
 	pid_t pid;
@@ -282,6 +289,26 @@ say_logger_initialized(void);
 void
 say_logger_free(void);
 
+/**
+ * Switch the default logger to asynchronous mode: a message is
+ * formatted by the calling thread into a ring buffer of its own
+ * and written by a dedicated logger thread, so the caller never
+ * blocks on the log file, pipe or syslog. A message which doesn't
+ * fit into the ring is dropped and counted, see
+ * say_logger_dropped(). Fatal messages are still written
+ * synchronously. The mode can't be switched off until the logger
+ * is freed.
+ *
+ * @retval  0 success
+ * @retval -1 failed to start the logger thread, diag is set
+ */
+int
+say_logger_set_async(void);
+
+/** Number of messages dropped by the asynchronous logger. */
+uint64_t
+say_logger_dropped(void);
+
 /** \cond public */
 typedef void (*sayfunc_t)(int, const char *, int, const char *,
 		    const char *, ...);
@@ -497,6 +524,10 @@ int
 say_format_plain(struct log *log, char *buf, int len, int level,
 		 const char *filename, int line, const char *error,
 		 const char *format, va_list ap);
+int
+say_format_binary(struct log *log, char *buf, int len, int level,
+		  const char *filename, int line, const char *error,
+		  const char *format, va_list ap);
 
 #if defined(__cplusplus)
 } /* extern "C" */
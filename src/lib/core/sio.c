@@ -33,6 +33,8 @@
 #include <sys/un.h>
 #include <sys/uio.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include <limits.h>
 #include <netinet/in.h> /* TCP_NODELAY */
 #include <netinet/tcp.h> /* TCP_NODELAY */
@@ -269,6 +271,85 @@ sio_writev(int fd, const struct iovec *iov, int iovcnt)
 	return n;
 }
 
+enum {
+	/** Max number of descriptors passed by sio_*_fds(). */
+	SIO_FDS_MAX = 8,
+};
+
+ssize_t
+sio_read_fds(int fd, void *buf, size_t count, int *fds, int *fd_count)
+{
+	char control[CMSG_SPACE(SIO_FDS_MAX * sizeof(int))];
+	struct iovec iov = { buf, count };
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	int max_count = *fd_count;
+	*fd_count = 0;
+	int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+	flags |= MSG_CMSG_CLOEXEC;
+#endif
+	ssize_t n = recvmsg(fd, &msg, flags);
+	if (n < 0) {
+		if (sio_wouldblock(errno))
+			return n;
+		/* See sio_read(). */
+		if (errno == ECONNRESET) {
+			errno = 0;
+			return 0;
+		}
+		diag_set(SocketError, sio_socketname(fd), "recvmsg(%zd)",
+			 count);
+		return n;
+	}
+	struct cmsghdr *cmsg;
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+	     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET ||
+		    cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		int n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		int *received = (int *)CMSG_DATA(cmsg);
+		for (int i = 0; i < n_fds; i++) {
+			if (*fd_count < max_count)
+				fds[(*fd_count)++] = received[i];
+			else
+				close(received[i]);
+		}
+	}
+	return n;
+}
+
+ssize_t
+sio_write_fds(int fd, const void *buf, size_t count,
+	      const int *fds, int fd_count)
+{
+	assert(fd_count > 0 && fd_count <= SIO_FDS_MAX);
+	char control[CMSG_SPACE(SIO_FDS_MAX * sizeof(int))];
+	memset(control, 0, sizeof(control));
+	struct iovec iov = { (void *)buf, count };
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = CMSG_SPACE(fd_count * sizeof(int));
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(fd_count * sizeof(int));
+	memcpy(CMSG_DATA(cmsg), fds, fd_count * sizeof(int));
+	ssize_t n = sendmsg(fd, &msg, 0);
+	if (n < 0 && !sio_wouldblock(errno))
+		diag_set(SocketError, sio_socketname(fd), "sendmsg(%zd)",
+			 count);
+	return n;
+}
+
 ssize_t
 sio_sendto(int fd, const void *buf, size_t len, int flags,
 	   const struct sockaddr *dest_addr, socklen_t addrlen)
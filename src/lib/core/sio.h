@@ -204,6 +204,24 @@ ssize_t sio_write(int fd, const void *buf, size_t count);
  */
 ssize_t sio_writev(int fd, const struct iovec *iov, int iovcnt);
 
+/**
+ * Same as sio_read(), but also receive file descriptors passed
+ * over a unix socket with SCM_RIGHTS. At most @a *fd_count
+ * descriptors are stored in @a fds, their number is returned
+ * in @a *fd_count. Descriptors which don't fit are closed.
+ */
+ssize_t
+sio_read_fds(int fd, void *buf, size_t count, int *fds, int *fd_count);
+
+/**
+ * Same as sio_write(), but also pass @a fd_count descriptors
+ * @a fds over a unix socket with SCM_RIGHTS. They are received
+ * along with the first byte written.
+ */
+ssize_t
+sio_write_fds(int fd, const void *buf, size_t count,
+	      const int *fds, int fd_count);
+
 /**
  * Send a message on a socket.
  * The diagnostics is not set for sio_wouldblock() errors.
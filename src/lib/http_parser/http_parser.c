@@ -435,3 +435,42 @@ header_done:
 	*bufp = p + 1;
 	return HTTP_PARSE_DONE;
 }
+
+int
+http_parse_request_line(struct http_parser *parser, char **bufp,
+			const char *end_buf, char **method, int *method_len,
+			char **target, int *target_len)
+{
+	char *p = *bufp;
+	char *start = p;
+	while (p < end_buf && ((*p >= 'A' && *p <= 'Z') ||
+			       *p == '-' || *p == '_'))
+		p++;
+	if (p == start || p == end_buf || *p != ' ')
+		return HTTP_PARSE_INVALID;
+	*method = start;
+	*method_len = p - start;
+
+	start = ++p;
+	while (p < end_buf && (unsigned char) *p > ' ' && *p != 0x7f)
+		p++;
+	if (p == start || p == end_buf || *p != ' ')
+		return HTTP_PARSE_INVALID;
+	*target = start;
+	*target_len = p - start;
+
+	p++;
+	if (end_buf - p < 8 || strncmp(p, "HTTP/", 5) != 0 ||
+	    p[5] < '0' || p[5] > '9' || p[6] != '.' ||
+	    p[7] < '0' || p[7] > '9')
+		return HTTP_PARSE_INVALID;
+	parser->http_major = p[5] - '0';
+	parser->http_minor = p[7] - '0';
+	p += 8;
+	if (p < end_buf && *p == CR)
+		p++;
+	if (p == end_buf || *p != LF)
+		return HTTP_PARSE_INVALID;
+	*bufp = p + 1;
+	return HTTP_PARSE_OK;
+}
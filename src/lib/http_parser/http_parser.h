@@ -68,4 +68,21 @@ int
 http_parse_header_line(struct http_parser *prsr, char **bufp,
 		       const char *end_buf, int max_hname_len);
 
+/**
+ * @brief Parse an HTTP request line: "METHOD target HTTP/x.y"
+ * @param parser object, http_major and http_minor are set
+ * @param bufp pointer to buffer with data, set past the line
+ * @param end_buf
+ * @param method[out] request method
+ * @param method_len[out] length of @a method
+ * @param target[out] request target, e.g. "/path?query"
+ * @param target_len[out] length of @a target
+ * @return	HTTP_PARSE_OK - line was parsed
+ *		HTTP_PARSE_INVALID - error during parsing
+ */
+int
+http_parse_request_line(struct http_parser *parser, char **bufp,
+			const char *end_buf, char **method, int *method_len,
+			char **target, int *target_len);
+
 #endif /* TARANTOOL_LIB_HTTP_PARSER_HTTP_PARSER_H_INCLUDED */
@@ -0,0 +1,1156 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "art.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+enum art_node_type {
+	ART_NODE4,
+	ART_NODE16,
+	ART_NODE48,
+	ART_NODE256,
+	art_node_type_MAX,
+};
+
+/**
+ * Header of an inner node. Every node is followed by its
+ * compressed path: prefix_len bytes which all keys of the
+ * subtree share at the node depth.
+ */
+struct art_node {
+	/* One of art_node_type */
+	uint8_t type;
+	/* Number of children */
+	uint16_t count;
+	/* Length of the compressed path */
+	uint32_t prefix_len;
+};
+
+/* Node with up to 4 children sorted by key byte */
+struct art_node4 {
+	struct art_node base;
+	unsigned char keys[4];
+	struct art_node *children[4];
+};
+
+/* Node with up to 16 children sorted by key byte */
+struct art_node16 {
+	struct art_node base;
+	unsigned char keys[16];
+	struct art_node *children[16];
+};
+
+/*
+ * Node with up to 48 children, index maps a key byte to a child
+ * slot number plus one, zero means there is no such child.
+ */
+struct art_node48 {
+	struct art_node base;
+	unsigned char index[256];
+	struct art_node *children[48];
+};
+
+/* Node with a child slot for every key byte */
+struct art_node256 {
+	struct art_node base;
+	struct art_node *children[256];
+};
+
+static const size_t art_node_sizes[] = {
+	sizeof(struct art_node4),
+	sizeof(struct art_node16),
+	sizeof(struct art_node48),
+	sizeof(struct art_node256),
+};
+
+static const uint32_t art_node_capacity[] = { 4, 16, 48, 256 };
+
+/*
+ * A node is shrunk to the previous type when the number of its
+ * children drops to this value. The gap between it and the
+ * capacity of the previous type prevents alternating inserts
+ * and deletes from converting a node back and forth.
+ */
+static const uint32_t art_node_shrink_count[] = { 0, 3, 12, 37 };
+
+/* {{{ Node helpers */
+
+/*
+ * Leaves are stored in child slots as tagged pointers: the lowest
+ * bit is set. During destruction a slot may also hold a pointer
+ * back to the parent node, tagged with the second bit.
+ */
+static inline bool
+art_is_leaf(const struct art_node *node)
+{
+	return ((uintptr_t)node & 1) != 0;
+}
+
+static inline struct art_leaf *
+art_to_leaf(const struct art_node *node)
+{
+	return (struct art_leaf *)((uintptr_t)node & ~(uintptr_t)1);
+}
+
+static inline struct art_node *
+art_leaf_ref(const struct art_leaf *leaf)
+{
+	return (struct art_node *)((uintptr_t)leaf | 1);
+}
+
+static inline unsigned char *
+art_node_prefix(const struct art_node *node)
+{
+	return (unsigned char *)node + art_node_sizes[node->type];
+}
+
+static struct art_node *
+art_node_new(struct art *tree, uint8_t type, uint32_t prefix_len)
+{
+	size_t size = art_node_sizes[type] + prefix_len;
+	struct art_node *node = tree->alloc(tree->alloc_ctx, size);
+	if (node == NULL)
+		return NULL;
+	memset(node, 0, art_node_sizes[type]);
+	node->type = type;
+	node->prefix_len = prefix_len;
+	tree->mem_used += size;
+	return node;
+}
+
+static void
+art_node_free(struct art *tree, struct art_node *node)
+{
+	size_t size = art_node_sizes[node->type] + node->prefix_len;
+	tree->mem_used -= size;
+	tree->free(tree->alloc_ctx, node, size);
+}
+
+static struct art_leaf *
+art_leaf_new(struct art *tree, const unsigned char *key, uint32_t key_len,
+	     void *value)
+{
+	size_t size = sizeof(struct art_leaf) + key_len;
+	struct art_leaf *leaf = tree->alloc(tree->alloc_ctx, size);
+	if (leaf == NULL)
+		return NULL;
+	leaf->prev = NULL;
+	leaf->next = NULL;
+	leaf->value = value;
+	leaf->key_len = key_len;
+	memcpy(leaf->key, key, key_len);
+	tree->mem_used += size;
+	return leaf;
+}
+
+static void
+art_leaf_free(struct art *tree, struct art_leaf *leaf)
+{
+	size_t size = sizeof(struct art_leaf) + leaf->key_len;
+	tree->mem_used -= size;
+	tree->free(tree->alloc_ctx, leaf, size);
+}
+
+/*
+ * Node4 and Node16 have the same layout but for the array sizes,
+ * these return their key and child arrays.
+ */
+static inline unsigned char *
+art_node_keys(struct art_node *node)
+{
+	assert(node->type == ART_NODE4 || node->type == ART_NODE16);
+	return node->type == ART_NODE4 ? ((struct art_node4 *)node)->keys :
+					 ((struct art_node16 *)node)->keys;
+}
+
+static inline struct art_node **
+art_node_children(struct art_node *node)
+{
+	assert(node->type == ART_NODE4 || node->type == ART_NODE16);
+	return node->type == ART_NODE4 ?
+	       ((struct art_node4 *)node)->children :
+	       ((struct art_node16 *)node)->children;
+}
+
+/** Find the child slot for the given key byte. */
+static struct art_node **
+art_node_find_child(struct art_node *node, unsigned char c)
+{
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		unsigned char *keys = art_node_keys(node);
+		for (uint32_t i = 0; i < node->count && keys[i] <= c; i++) {
+			if (keys[i] == c)
+				return &art_node_children(node)[i];
+		}
+		return NULL;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		return n->index[c] != 0 ? &n->children[n->index[c] - 1] : NULL;
+	}
+	case ART_NODE256: {
+		struct art_node256 *n = (struct art_node256 *)node;
+		return n->children[c] != NULL ? &n->children[c] : NULL;
+	}
+	default:
+		assert(false);
+		return NULL;
+	}
+}
+
+/**
+ * Return the child with the smallest key byte greater than c,
+ * or NULL if there is no such child. If c is negative, return
+ * the first child.
+ */
+static struct art_node *
+art_node_next_child(struct art_node *node, int c)
+{
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		unsigned char *keys = art_node_keys(node);
+		for (uint32_t i = 0; i < node->count; i++) {
+			if (keys[i] > c)
+				return art_node_children(node)[i];
+		}
+		return NULL;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		for (int k = c + 1; k < 256; k++) {
+			if (n->index[k] != 0)
+				return n->children[n->index[k] - 1];
+		}
+		return NULL;
+	}
+	case ART_NODE256: {
+		struct art_node256 *n = (struct art_node256 *)node;
+		for (int k = c + 1; k < 256; k++) {
+			if (n->children[k] != NULL)
+				return n->children[k];
+		}
+		return NULL;
+	}
+	default:
+		assert(false);
+		return NULL;
+	}
+}
+
+/** Return the child with the greatest key byte. */
+static struct art_node *
+art_node_last_child(struct art_node *node)
+{
+	assert(node->count > 0);
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16:
+		return art_node_children(node)[node->count - 1];
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		for (int k = 255; k >= 0; k--) {
+			if (n->index[k] != 0)
+				return n->children[n->index[k] - 1];
+		}
+		break;
+	}
+	case ART_NODE256: {
+		struct art_node256 *n = (struct art_node256 *)node;
+		for (int k = 255; k >= 0; k--) {
+			if (n->children[k] != NULL)
+				return n->children[k];
+		}
+		break;
+	}
+	}
+	assert(false);
+	return NULL;
+}
+
+static struct art_leaf *
+art_node_min_leaf(const struct art_node *node)
+{
+	while (!art_is_leaf(node))
+		node = art_node_next_child((struct art_node *)node, -1);
+	return art_to_leaf(node);
+}
+
+static struct art_leaf *
+art_node_max_leaf(const struct art_node *node)
+{
+	while (!art_is_leaf(node))
+		node = art_node_last_child((struct art_node *)node);
+	return art_to_leaf(node);
+}
+
+/**
+ * Add a child to a node that has a free slot for it. There must
+ * be no child with the same key byte.
+ */
+static void
+art_node_insert_child(struct art_node *node, unsigned char c,
+		      struct art_node *child)
+{
+	assert(node->count < art_node_capacity[node->type]);
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		unsigned char *keys = art_node_keys(node);
+		struct art_node **children = art_node_children(node);
+		uint32_t i = node->count;
+		while (i > 0 && keys[i - 1] > c)
+			i--;
+		assert(i == 0 || keys[i - 1] != c);
+		memmove(keys + i + 1, keys + i, node->count - i);
+		memmove(children + i + 1, children + i,
+			(node->count - i) * sizeof(*children));
+		keys[i] = c;
+		children[i] = child;
+		break;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		assert(n->index[c] == 0);
+		uint32_t i = 0;
+		while (n->children[i] != NULL)
+			i++;
+		n->index[c] = i + 1;
+		n->children[i] = child;
+		break;
+	}
+	case ART_NODE256: {
+		struct art_node256 *n = (struct art_node256 *)node;
+		assert(n->children[c] == NULL);
+		n->children[c] = child;
+		break;
+	}
+	}
+	node->count++;
+}
+
+/**
+ * Move all children of src to dst, which must be empty and have
+ * enough room for them. The compressed path isn't copied.
+ */
+static void
+art_node_move_children(struct art_node *dst, struct art_node *src)
+{
+	assert(dst->count == 0);
+	assert(art_node_capacity[dst->type] >= src->count);
+	switch (src->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		unsigned char *keys = art_node_keys(src);
+		struct art_node **children = art_node_children(src);
+		for (uint32_t i = 0; i < src->count; i++)
+			art_node_insert_child(dst, keys[i], children[i]);
+		break;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)src;
+		for (int k = 0; k < 256; k++) {
+			if (n->index[k] != 0)
+				art_node_insert_child(dst, k,
+					n->children[n->index[k] - 1]);
+		}
+		break;
+	}
+	case ART_NODE256: {
+		struct art_node256 *n = (struct art_node256 *)src;
+		for (int k = 0; k < 256; k++) {
+			if (n->children[k] != NULL)
+				art_node_insert_child(dst, k, n->children[k]);
+		}
+		break;
+	}
+	}
+	assert(dst->count == src->count);
+}
+
+/**
+ * Replace a node with a node of another type and the same path.
+ * @retval NULL memory error, the node is left intact.
+ */
+static struct art_node *
+art_node_convert(struct art *tree, struct art_node **ref, uint8_t type)
+{
+	struct art_node *node = *ref;
+	struct art_node *new_node = art_node_new(tree, type, node->prefix_len);
+	if (new_node == NULL)
+		return NULL;
+	memcpy(art_node_prefix(new_node), art_node_prefix(node),
+	       node->prefix_len);
+	art_node_move_children(new_node, node);
+	art_node_free(tree, node);
+	*ref = new_node;
+	return new_node;
+}
+
+/**
+ * Add a child to a node, growing the node if it is full.
+ * @retval 0 success.
+ * @retval -1 memory error.
+ */
+static int
+art_node_add_child(struct art *tree, struct art_node **ref, unsigned char c,
+		   struct art_node *child)
+{
+	struct art_node *node = *ref;
+	if (node->count == art_node_capacity[node->type]) {
+		assert(node->type != ART_NODE256);
+		node = art_node_convert(tree, ref, node->type + 1);
+		if (node == NULL)
+			return -1;
+	}
+	art_node_insert_child(node, c, child);
+	return 0;
+}
+
+/**
+ * Merge a node having a single child with the child if it is
+ * an inner node, or replace the node with the child leaf.
+ */
+static void
+art_node_collapse(struct art *tree, struct art_node **ref)
+{
+	struct art_node *node = *ref;
+	assert(node->type == ART_NODE4 && node->count == 1);
+	struct art_node4 *n = (struct art_node4 *)node;
+	struct art_node *child = n->children[0];
+	if (art_is_leaf(child)) {
+		art_node_free(tree, node);
+		*ref = child;
+		return;
+	}
+	uint32_t prefix_len = node->prefix_len + 1 + child->prefix_len;
+	struct art_node *merged = art_node_new(tree, child->type, prefix_len);
+	if (merged == NULL)
+		return;
+	unsigned char *prefix = art_node_prefix(merged);
+	memcpy(prefix, art_node_prefix(node), node->prefix_len);
+	prefix[node->prefix_len] = n->keys[0];
+	memcpy(prefix + node->prefix_len + 1, art_node_prefix(child),
+	       child->prefix_len);
+	art_node_move_children(merged, child);
+	art_node_free(tree, child);
+	art_node_free(tree, node);
+	*ref = merged;
+}
+
+/**
+ * Remove a child from a node having at least two children,
+ * shrinking the node if it becomes too sparse.
+ */
+static void
+art_node_remove_child(struct art *tree, struct art_node **ref,
+		      unsigned char c)
+{
+	struct art_node *node = *ref;
+	assert(node->count > 1);
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		unsigned char *keys = art_node_keys(node);
+		struct art_node **children = art_node_children(node);
+		uint32_t i = 0;
+		while (keys[i] != c)
+			i++;
+		assert(i < node->count);
+		memmove(keys + i, keys + i + 1, node->count - i - 1);
+		memmove(children + i, children + i + 1,
+			(node->count - i - 1) * sizeof(*children));
+		break;
+	}
+	case ART_NODE48: {
+		struct art_node48 *n = (struct art_node48 *)node;
+		assert(n->index[c] != 0);
+		n->children[n->index[c] - 1] = NULL;
+		n->index[c] = 0;
+		break;
+	}
+	case ART_NODE256: {
+		struct art_node256 *n = (struct art_node256 *)node;
+		assert(n->children[c] != NULL);
+		n->children[c] = NULL;
+		break;
+	}
+	}
+	node->count--;
+	/*
+	 * Failing to allocate a smaller node is fine, the tree
+	 * just keeps using the bigger one.
+	 */
+	if (node->type == ART_NODE4) {
+		if (node->count == 1)
+			art_node_collapse(tree, ref);
+	} else if (node->count <= art_node_shrink_count[node->type]) {
+		art_node_convert(tree, ref, node->type - 1);
+	}
+}
+
+/* }}} Node helpers */
+
+/* {{{ API definition */
+
+void
+art_create(struct art *tree, art_alloc_f alloc, art_free_f free,
+	   void *alloc_ctx)
+{
+	memset(tree, 0, sizeof(*tree));
+	tree->alloc = alloc;
+	tree->free = free;
+	tree->alloc_ctx = alloc_ctx;
+}
+
+/**
+ * Return the first slot of a node holding an inner node, skipping
+ * leaves and back pointers left by art_destroy().
+ */
+static struct art_node **
+art_node_first_inner_child(struct art_node *node)
+{
+	struct art_node **children;
+	uint32_t count;
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16:
+		children = art_node_children(node);
+		count = node->count;
+		break;
+	case ART_NODE48:
+		children = ((struct art_node48 *)node)->children;
+		count = 48;
+		break;
+	case ART_NODE256:
+		children = ((struct art_node256 *)node)->children;
+		count = 256;
+		break;
+	default:
+		assert(false);
+		return NULL;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (children[i] != NULL && ((uintptr_t)children[i] & 3) == 0)
+			return &children[i];
+	}
+	return NULL;
+}
+
+/** Find the slot holding a back pointer in a node. */
+static struct art_node **
+art_node_find_back_pointer(struct art_node *node)
+{
+	struct art_node **children;
+	uint32_t count;
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16:
+		children = art_node_children(node);
+		count = node->count;
+		break;
+	case ART_NODE48:
+		children = ((struct art_node48 *)node)->children;
+		count = 48;
+		break;
+	case ART_NODE256:
+		children = ((struct art_node256 *)node)->children;
+		count = 256;
+		break;
+	default:
+		assert(false);
+		return NULL;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (((uintptr_t)children[i] & 2) != 0)
+			return &children[i];
+	}
+	assert(false);
+	return NULL;
+}
+
+void
+art_destroy(struct art *tree)
+{
+	struct art_leaf *leaf = tree->first;
+	while (leaf != NULL) {
+		struct art_leaf *next = leaf->next;
+		art_leaf_free(tree, leaf);
+		leaf = next;
+	}
+	/*
+	 * Free inner nodes depth first without recursion: the slot
+	 * of the child a walk descends to is reused to store a
+	 * pointer back to the parent.
+	 */
+	struct art_node *node = tree->root;
+	if (node != NULL && art_is_leaf(node))
+		node = NULL;
+	struct art_node *parent = NULL;
+	while (node != NULL) {
+		struct art_node **slot = art_node_first_inner_child(node);
+		if (slot != NULL) {
+			struct art_node *child = *slot;
+			*slot = (struct art_node *)((uintptr_t)parent | 2);
+			parent = node;
+			node = child;
+			continue;
+		}
+		art_node_free(tree, node);
+		node = parent;
+		if (node != NULL) {
+			slot = art_node_find_back_pointer(node);
+			parent = (struct art_node *)((uintptr_t)*slot &
+						     ~(uintptr_t)2);
+			*slot = NULL;
+		}
+	}
+	assert(tree->mem_used == 0);
+	tree->root = NULL;
+	tree->first = tree->last = NULL;
+	tree->count = 0;
+}
+
+int
+art_insert(struct art *tree, const unsigned char *key, uint32_t key_len,
+	   void *value, void **replaced)
+{
+	if (replaced != NULL)
+		*replaced = NULL;
+	struct art_node **ref = &tree->root;
+	uint32_t depth = 0;
+	/* Neighbours of the new leaf, only one is found here. */
+	struct art_leaf *prev = NULL, *next = NULL;
+	struct art_leaf *leaf;
+	while (true) {
+		struct art_node *node = *ref;
+		if (node == NULL) {
+			assert(ref == &tree->root);
+			leaf = art_leaf_new(tree, key, key_len, value);
+			if (leaf == NULL)
+				return -1;
+			*ref = art_leaf_ref(leaf);
+			break;
+		}
+		if (art_is_leaf(node)) {
+			struct art_leaf *other = art_to_leaf(node);
+			uint32_t limit = MIN(other->key_len, key_len);
+			uint32_t i = depth;
+			while (i < limit && other->key[i] == key[i])
+				i++;
+			if (i == limit) {
+				/* Keys must not be prefixes of each other. */
+				assert(other->key_len == key_len);
+				if (replaced != NULL)
+					*replaced = other->value;
+				other->value = value;
+				return 0;
+			}
+			leaf = art_leaf_new(tree, key, key_len, value);
+			if (leaf == NULL)
+				return -1;
+			struct art_node *split = art_node_new(tree, ART_NODE4,
+							      i - depth);
+			if (split == NULL) {
+				art_leaf_free(tree, leaf);
+				return -1;
+			}
+			memcpy(art_node_prefix(split), key + depth, i - depth);
+			art_node_insert_child(split, other->key[i], node);
+			art_node_insert_child(split, key[i], art_leaf_ref(leaf));
+			if (key[i] < other->key[i])
+				next = other;
+			else
+				prev = other;
+			*ref = split;
+			break;
+		}
+		uint32_t prefix_len = node->prefix_len;
+		const unsigned char *prefix = art_node_prefix(node);
+		uint32_t p = 0;
+		while (p < prefix_len && depth + p < key_len &&
+		       prefix[p] == key[depth + p])
+			p++;
+		if (p < prefix_len) {
+			/* Split the compressed path. */
+			assert(depth + p < key_len);
+			leaf = art_leaf_new(tree, key, key_len, value);
+			struct art_node *split = art_node_new(tree, ART_NODE4,
+							      p);
+			struct art_node *rest = art_node_new(tree, node->type,
+							     prefix_len - p - 1);
+			if (leaf == NULL || split == NULL || rest == NULL) {
+				if (leaf != NULL)
+					art_leaf_free(tree, leaf);
+				if (split != NULL)
+					art_node_free(tree, split);
+				if (rest != NULL)
+					art_node_free(tree, rest);
+				return -1;
+			}
+			memcpy(art_node_prefix(split), prefix, p);
+			memcpy(art_node_prefix(rest), prefix + p + 1,
+			       prefix_len - p - 1);
+			art_node_move_children(rest, node);
+			art_node_insert_child(split, prefix[p], rest);
+			art_node_insert_child(split, key[depth + p],
+					      art_leaf_ref(leaf));
+			if (key[depth + p] < prefix[p])
+				next = art_node_min_leaf(rest);
+			else
+				prev = art_node_max_leaf(rest);
+			art_node_free(tree, node);
+			*ref = split;
+			break;
+		}
+		depth += prefix_len;
+		assert(depth < key_len);
+		unsigned char c = key[depth];
+		struct art_node **child = art_node_find_child(node, c);
+		if (child != NULL) {
+			ref = child;
+			depth++;
+			continue;
+		}
+		leaf = art_leaf_new(tree, key, key_len, value);
+		if (leaf == NULL)
+			return -1;
+		struct art_node *sibling = art_node_next_child(node, c);
+		if (sibling != NULL)
+			next = art_node_min_leaf(sibling);
+		else
+			prev = art_node_max_leaf(node);
+		if (art_node_add_child(tree, ref, c, art_leaf_ref(leaf)) != 0) {
+			art_leaf_free(tree, leaf);
+			return -1;
+		}
+		break;
+	}
+	if (next != NULL)
+		prev = next->prev;
+	else if (prev != NULL)
+		next = prev->next;
+	leaf->prev = prev;
+	leaf->next = next;
+	if (prev != NULL)
+		prev->next = leaf;
+	else
+		tree->first = leaf;
+	if (next != NULL)
+		next->prev = leaf;
+	else
+		tree->last = leaf;
+	tree->count++;
+	tree->version++;
+	return 0;
+}
+
+static inline bool
+art_leaf_matches(const struct art_leaf *leaf, const unsigned char *key,
+		 uint32_t key_len)
+{
+	return leaf->key_len == key_len &&
+	       memcmp(leaf->key, key, key_len) == 0;
+}
+
+/** Unlink a leaf from the leaf list and free it. */
+static void *
+art_leaf_delete(struct art *tree, struct art_leaf *leaf)
+{
+	if (leaf->prev != NULL)
+		leaf->prev->next = leaf->next;
+	else
+		tree->first = leaf->next;
+	if (leaf->next != NULL)
+		leaf->next->prev = leaf->prev;
+	else
+		tree->last = leaf->prev;
+	void *value = leaf->value;
+	art_leaf_free(tree, leaf);
+	tree->count--;
+	tree->version++;
+	return value;
+}
+
+void *
+art_delete(struct art *tree, const unsigned char *key, uint32_t key_len)
+{
+	struct art_node *root = tree->root;
+	if (root == NULL)
+		return NULL;
+	if (art_is_leaf(root)) {
+		struct art_leaf *leaf = art_to_leaf(root);
+		if (!art_leaf_matches(leaf, key, key_len))
+			return NULL;
+		tree->root = NULL;
+		return art_leaf_delete(tree, leaf);
+	}
+	struct art_node **ref = &tree->root;
+	struct art_node **parent_ref = NULL;
+	unsigned char parent_c = 0;
+	/*
+	 * Nodes having a single child are merged with the child on
+	 * deletion unless memory for the merged node can't be
+	 * allocated. Track the topmost node of a chain of such
+	 * nodes leading to the leaf: the whole chain must be freed
+	 * when the leaf is deleted.
+	 */
+	struct art_node **chain_ref = NULL;
+	struct art_node **chain_parent_ref = NULL;
+	unsigned char chain_parent_c = 0;
+	uint32_t depth = 0;
+	while (true) {
+		struct art_node *node = *ref;
+		if (node->count > 1) {
+			chain_ref = NULL;
+		} else if (chain_ref == NULL) {
+			chain_ref = ref;
+			chain_parent_ref = parent_ref;
+			chain_parent_c = parent_c;
+		}
+		uint32_t prefix_len = node->prefix_len;
+		if (key_len - depth <= prefix_len ||
+		    memcmp(art_node_prefix(node), key + depth, prefix_len) != 0)
+			return NULL;
+		depth += prefix_len;
+		unsigned char c = key[depth];
+		struct art_node **child = art_node_find_child(node, c);
+		if (child == NULL)
+			return NULL;
+		if (!art_is_leaf(*child)) {
+			parent_ref = ref;
+			parent_c = c;
+			ref = child;
+			depth++;
+			continue;
+		}
+		struct art_leaf *leaf = art_to_leaf(*child);
+		if (!art_leaf_matches(leaf, key, key_len))
+			return NULL;
+		if (chain_ref == NULL) {
+			art_node_remove_child(tree, ref, c);
+			return art_leaf_delete(tree, leaf);
+		}
+		node = *chain_ref;
+		while (!art_is_leaf(node)) {
+			struct art_node *next = art_node_next_child(node, -1);
+			art_node_free(tree, node);
+			node = next;
+		}
+		if (chain_parent_ref == NULL)
+			tree->root = NULL;
+		else
+			art_node_remove_child(tree, chain_parent_ref,
+					      chain_parent_c);
+		return art_leaf_delete(tree, leaf);
+	}
+}
+
+struct art_leaf *
+art_find(const struct art *tree, const unsigned char *key, uint32_t key_len)
+{
+	const struct art_node *node = tree->root;
+	uint32_t depth = 0;
+	while (node != NULL) {
+		if (art_is_leaf(node)) {
+			struct art_leaf *leaf = art_to_leaf(node);
+			return art_leaf_matches(leaf, key, key_len) ?
+			       leaf : NULL;
+		}
+		uint32_t prefix_len = node->prefix_len;
+		if (key_len - depth <= prefix_len ||
+		    memcmp(art_node_prefix(node), key + depth, prefix_len) != 0)
+			return NULL;
+		depth += prefix_len;
+		struct art_node **child =
+			art_node_find_child((struct art_node *)node,
+					    key[depth]);
+		if (child == NULL)
+			return NULL;
+		node = *child;
+		depth++;
+	}
+	return NULL;
+}
+
+/**
+ * Find the first leaf not less than the key. If skip_prefix is
+ * set, leaves starting with the key are considered less than it.
+ */
+static struct art_leaf *
+art_seek(const struct art *tree, const unsigned char *key, uint32_t key_len,
+	 bool skip_prefix)
+{
+	const struct art_node *node = tree->root;
+	if (node == NULL)
+		return NULL;
+	uint32_t depth = 0;
+	while (true) {
+		if (art_is_leaf(node)) {
+			struct art_leaf *leaf = art_to_leaf(node);
+			uint32_t len = MIN(leaf->key_len, key_len);
+			assert(len >= depth);
+			int cmp = memcmp(leaf->key + depth, key + depth,
+					 len - depth);
+			if (cmp > 0)
+				return leaf;
+			if (cmp < 0 || leaf->key_len < key_len || skip_prefix)
+				return leaf->next;
+			return leaf;
+		}
+		uint32_t len = MIN(node->prefix_len, key_len - depth);
+		int cmp = memcmp(art_node_prefix(node), key + depth, len);
+		if (cmp > 0)
+			return art_node_min_leaf(node);
+		if (cmp < 0)
+			return art_node_max_leaf(node)->next;
+		depth += len;
+		if (depth == key_len) {
+			/* All keys of the subtree start with the key. */
+			return skip_prefix ? art_node_max_leaf(node)->next :
+					     art_node_min_leaf(node);
+		}
+		unsigned char c = key[depth];
+		struct art_node **child =
+			art_node_find_child((struct art_node *)node, c);
+		if (child == NULL) {
+			struct art_node *sibling =
+				art_node_next_child((struct art_node *)node, c);
+			return sibling != NULL ? art_node_min_leaf(sibling) :
+						 art_node_max_leaf(node)->next;
+		}
+		node = *child;
+		depth++;
+	}
+}
+
+struct art_leaf *
+art_lower_bound(const struct art *tree, const unsigned char *key,
+		uint32_t key_len)
+{
+	return art_seek(tree, key, key_len, false);
+}
+
+struct art_leaf *
+art_upper_bound(const struct art *tree, const unsigned char *key,
+		uint32_t key_len)
+{
+	return art_seek(tree, key, key_len, true);
+}
+
+/** Return the n-th child of a node in key order. */
+static struct art_node *
+art_node_nth_child(struct art_node *node, uint32_t n)
+{
+	assert(n < node->count);
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16:
+		return art_node_children(node)[n];
+	case ART_NODE48: {
+		struct art_node48 *n48 = (struct art_node48 *)node;
+		for (int k = 0; k < 256; k++) {
+			if (n48->index[k] != 0 && n-- == 0)
+				return n48->children[n48->index[k] - 1];
+		}
+		break;
+	}
+	case ART_NODE256: {
+		struct art_node256 *n256 = (struct art_node256 *)node;
+		for (int k = 0; k < 256; k++) {
+			if (n256->children[k] != NULL && n-- == 0)
+				return n256->children[k];
+		}
+		break;
+	}
+	}
+	assert(false);
+	return NULL;
+}
+
+struct art_leaf *
+art_random(const struct art *tree, uint32_t rnd)
+{
+	struct art_node *node = tree->root;
+	if (node == NULL)
+		return NULL;
+	while (!art_is_leaf(node)) {
+		node = art_node_nth_child(node, rnd % node->count);
+		rnd = rnd * 1103515245 + 12345;
+	}
+	return art_to_leaf(node);
+}
+
+/* }}} API definition */
+
+/* {{{ Self check */
+
+/** Part of the path from the root to a node. */
+struct art_check_path {
+	const struct art_check_path *up;
+	uint32_t depth;
+	const unsigned char *bytes;
+	uint32_t len;
+};
+
+struct art_check_state {
+	/* Leaf expected next in in-order traversal */
+	const struct art_leaf *expected;
+	size_t count;
+	size_t mem_used;
+	int error;
+};
+
+static void
+art_check_node(const struct art_node *node, uint32_t depth,
+	       const struct art_check_path *path, struct art_check_state *s)
+{
+	if (art_is_leaf(node)) {
+		const struct art_leaf *leaf = art_to_leaf(node);
+		s->count++;
+		s->mem_used += sizeof(*leaf) + leaf->key_len;
+		if (leaf != s->expected ||
+		    (leaf->next != NULL && leaf->next->prev != leaf))
+			s->error |= 4;
+		else
+			s->expected = leaf->next;
+		for (const struct art_check_path *p = path; p != NULL;
+		     p = p->up) {
+			if (leaf->key_len < p->depth + p->len ||
+			    memcmp(leaf->key + p->depth, p->bytes,
+				   p->len) != 0)
+				s->error |= 8;
+		}
+		return;
+	}
+	if (node->type >= art_node_type_MAX) {
+		s->error |= 32;
+		return;
+	}
+	s->mem_used += art_node_sizes[node->type] + node->prefix_len;
+	if (node->count < 1 || node->count > art_node_capacity[node->type])
+		s->error |= 32;
+	struct art_check_path prefix = {
+		path, depth, art_node_prefix(node), node->prefix_len
+	};
+	depth += node->prefix_len;
+	uint32_t count = 0;
+	unsigned char c;
+	struct art_check_path step = { &prefix, depth, &c, 1 };
+	struct art_node **children;
+	switch (node->type) {
+	case ART_NODE4:
+	case ART_NODE16: {
+		const unsigned char *keys =
+			art_node_keys((struct art_node *)node);
+		children = art_node_children((struct art_node *)node);
+		for (uint32_t i = 0; i < node->count; i++) {
+			if (i > 0 && keys[i - 1] >= keys[i])
+				s->error |= 2;
+			c = keys[i];
+			art_check_node(children[i], depth + 1, &step, s);
+			count++;
+		}
+		break;
+	}
+	case ART_NODE48: {
+		const struct art_node48 *n = (const struct art_node48 *)node;
+		for (int k = 0; k < 256; k++) {
+			if (n->index[k] == 0)
+				continue;
+			if (n->index[k] > 48 ||
+			    n->children[n->index[k] - 1] == NULL) {
+				s->error |= 2;
+				continue;
+			}
+			c = k;
+			art_check_node(n->children[n->index[k] - 1],
+				       depth + 1, &step, s);
+			count++;
+		}
+		uint32_t used = 0;
+		for (int i = 0; i < 48; i++)
+			used += n->children[i] != NULL;
+		if (used != count)
+			s->error |= 2;
+		break;
+	}
+	case ART_NODE256: {
+		const struct art_node256 *n = (const struct art_node256 *)node;
+		for (int k = 0; k < 256; k++) {
+			if (n->children[k] == NULL)
+				continue;
+			c = k;
+			art_check_node(n->children[k], depth + 1, &step, s);
+			count++;
+		}
+		break;
+	}
+	}
+	if (count != node->count)
+		s->error |= 2;
+}
+
+int
+art_selfcheck(const struct art *tree)
+{
+	struct art_check_state s;
+	s.expected = tree->first;
+	s.count = 0;
+	s.mem_used = 0;
+	s.error = 0;
+	if (tree->root != NULL)
+		art_check_node(tree->root, 0, NULL, &s);
+	if (s.expected != NULL)
+		s.error |= 4;
+	if (tree->first != NULL && tree->first->prev != NULL)
+		s.error |= 4;
+	if (tree->last != NULL && tree->last->next != NULL)
+		s.error |= 4;
+	if ((tree->first == NULL) != (tree->root == NULL))
+		s.error |= 4;
+	if (s.count != tree->count)
+		s.error |= 1;
+	if (s.mem_used != tree->mem_used)
+		s.error |= 16;
+	return s.error;
+}
+
+/* }}} Self check */
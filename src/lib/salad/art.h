@@ -0,0 +1,228 @@
+#ifndef TARANTOOL_LIB_SALAD_ART_H_INCLUDED
+#define TARANTOOL_LIB_SALAD_ART_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Adaptive radix tree
+ *  Leis, Viktor; Kemper, Alfons; Neumann, Thomas (2013),
+ *  "The Adaptive Radix Tree: ARTful Indexing for Main-Memory
+ *  Databases"
+ *
+ * Keys are byte strings compared with memcmp(); no key may be
+ * a prefix of another key. Inner nodes have 4, 16, 48 or 256
+ * children depending on their fan-out, and store compressed
+ * paths in full, so a lookup never touches leaves it doesn't
+ * return. Leaves keep a copy of their keys and are linked in
+ * a sorted list, making ordered iteration a pointer chase.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/* Pointers to memory allocation and deallocation functions */
+typedef void *(*art_alloc_f)(void *ctx, size_t size);
+typedef void (*art_free_f)(void *ctx, void *ptr, size_t size);
+
+struct art_node;
+
+/**
+ * Leaf of the tree, one per stored key
+ */
+struct art_leaf {
+	/* Previous leaf in key order, NULL for the first one */
+	struct art_leaf *prev;
+	/* Next leaf in key order, NULL for the last one */
+	struct art_leaf *next;
+	/* Payload */
+	void *value;
+	/* Key length */
+	uint32_t key_len;
+	/* Key */
+	unsigned char key[0];
+};
+
+/**
+ * Main tree struct
+ */
+struct art {
+	/* Root node, may be a leaf, NULL if the tree is empty */
+	struct art_node *root;
+	/* First leaf in key order */
+	struct art_leaf *first;
+	/* Last leaf in key order */
+	struct art_leaf *last;
+	/* Number of stored keys */
+	size_t count;
+	/* Memory used by nodes and leaves */
+	size_t mem_used;
+	/*
+	 * Incremented every time a leaf is added or removed,
+	 * so that users can cache leaf pointers between
+	 * operations.
+	 */
+	uint32_t version;
+	/* Memory allocator and its context */
+	art_alloc_f alloc;
+	art_free_f free;
+	void *alloc_ctx;
+};
+
+/* {{{ API declaration */
+
+/**
+ * Initialize an empty tree
+ *
+ * @param tree - tree to initialize
+ * @param alloc - memory allocation function
+ * @param free - memory deallocation function
+ * @param alloc_ctx - context for the allocator
+ */
+void
+art_create(struct art *tree, art_alloc_f alloc, art_free_f free,
+	   void *alloc_ctx);
+
+/**
+ * Free all memory used by the tree. Values are not touched.
+ *
+ * @param tree - the tree
+ */
+void
+art_destroy(struct art *tree);
+
+/**
+ * Insert a value, or replace the value of an existing key.
+ *
+ * @param tree - the tree
+ * @param key - key of the value
+ * @param key_len - length of the key
+ * @param value - value to insert
+ * @param replaced - set to the value that had the same key, or to
+ *  NULL if there were no such value; may be NULL
+ * @return 0 - OK, -1 - memory error, the tree is not changed
+ */
+int
+art_insert(struct art *tree, const unsigned char *key, uint32_t key_len,
+	   void *value, void **replaced);
+
+/**
+ * Delete a key. Never fails: if memory for a smaller node can't
+ * be allocated, the bigger one is left in place.
+ *
+ * @param tree - the tree
+ * @param key - key to delete
+ * @param key_len - length of the key
+ * @return value of the key, or NULL if the key was not found
+ */
+void *
+art_delete(struct art *tree, const unsigned char *key, uint32_t key_len);
+
+/**
+ * Find a leaf by its key
+ *
+ * @param tree - the tree
+ * @param key - key to look up
+ * @param key_len - length of the key
+ * @return the leaf or NULL if the key was not found
+ */
+struct art_leaf *
+art_find(const struct art *tree, const unsigned char *key, uint32_t key_len);
+
+/**
+ * Find the first leaf which key is not less than the given one.
+ * In particular, it is the first leaf with the given key prefix
+ * if there is one.
+ *
+ * @param tree - the tree
+ * @param key - key or key prefix to look up
+ * @param key_len - length of the key
+ * @return the leaf or NULL if all keys are less than the given one
+ */
+struct art_leaf *
+art_lower_bound(const struct art *tree, const unsigned char *key,
+		uint32_t key_len);
+
+/**
+ * Find the first leaf which key is greater than the given one and
+ * doesn't start with it.
+ *
+ * @param tree - the tree
+ * @param key - key or key prefix to look up
+ * @param key_len - length of the key
+ * @return the leaf or NULL if there is no such leaf
+ */
+struct art_leaf *
+art_upper_bound(const struct art *tree, const unsigned char *key,
+		uint32_t key_len);
+
+/**
+ * Get a pseudo-random leaf. Leaves are not equiprobable.
+ *
+ * @param tree - the tree
+ * @param rnd - random number
+ * @return the leaf or NULL if the tree is empty
+ */
+struct art_leaf *
+art_random(const struct art *tree, uint32_t rnd);
+
+/**
+ * Check if the key of a leaf starts with the given prefix
+ */
+static inline bool
+art_leaf_has_prefix(const struct art_leaf *leaf, const unsigned char *prefix,
+		    uint32_t prefix_len)
+{
+	return leaf->key_len >= prefix_len &&
+	       memcmp(leaf->key, prefix, prefix_len) == 0;
+}
+
+/**
+ * Check the tree for consistency
+ *
+ * @param tree - the tree
+ * @return 0 - OK, other value - the tree is broken
+ */
+int
+art_selfcheck(const struct art *tree);
+
+/* }}} API declaration */
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_SALAD_ART_H_INCLUDED */
@@ -158,6 +158,10 @@
  * struct bps_tree_iterator bps_tree_lower_bound_elem(tree, elem, exact);
  * struct bps_tree_iterator bps_tree_upper_bound_elem(tree, elem, exact);
  * size_t bps_tree_approxiamte_count(tree, key);
+ * // with BPS_INNER_CARD only:
+ * size_t bps_tree_lower_bound_offset(tree, key, exact);
+ * size_t bps_tree_upper_bound_offset(tree, key, exact);
+ * struct bps_tree_iterator bps_tree_iterator_at(tree, offset);
  * bps_tree_elem_t *bps_tree_iterator_get_elem(tree, itr);
  * bool bps_tree_iterator_next(tree, itr);
  * bool bps_tree_iterator_prev(tree, itr);
@@ -291,6 +295,16 @@
  * #define BPS_BLOCK_LINEAR_SEARCH
  */
 
+/**
+ * A switch that turns the tree into an order statistic tree.
+ * Every inner block stores the number of elements in each of its
+ * child subtrees, so that the position of an element in the tree
+ * can be found in logarithmic time, see bps_tree_lower_bound_offset.
+ * It costs a smaller fanout of inner blocks and a few extra writes
+ * per insertion and deletion. To turn it on,
+ * #define BPS_INNER_CARD
+ */
+
 /**
  * A switch that enables collection of executions of different
  * branches of code. Used only for debug purposes, I hope you
@@ -357,6 +371,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_build _api_name(build)
 #define bps_tree_destroy _api_name(destroy)
 #define bps_tree_find _api_name(find)
+#define bps_tree_find_batch _api_name(find_batch)
 #define bps_tree_insert _api_name(insert)
 #define bps_tree_insert_get_iterator _api_name(insert_get_iterator)
 #define bps_tree_delete _api_name(delete)
@@ -374,6 +389,9 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_lower_bound_elem _api_name(lower_bound_elem)
 #define bps_tree_upper_bound_elem _api_name(upper_bound_elem)
 #define bps_tree_approximate_count _api_name(approximate_count)
+#define bps_tree_lower_bound_offset _api_name(lower_bound_offset)
+#define bps_tree_upper_bound_offset _api_name(upper_bound_offset)
+#define bps_tree_iterator_at _api_name(iterator_at)
 #define bps_tree_iterator_get_elem _api_name(iterator_get_elem)
 #define bps_tree_iterator_next _api_name(iterator_next)
 #define bps_tree_iterator_prev _api_name(iterator_prev)
@@ -396,6 +414,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_restore_block _bps_tree(restore_block)
 #define bps_tree_restore_block_ver _bps_tree(restore_block_ver)
 #define bps_tree_root _bps_tree(root)
+#define bps_tree_prefetch_block _bps_tree(prefetch_block)
 #define bps_tree_touch_block _bps_tree(touch_block)
 #define bps_tree_find_ins_point_key _bps_tree(find_ins_point_key)
 #define bps_tree_find_ins_point_elem _bps_tree(find_ins_point_elem)
@@ -416,6 +435,11 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_process_replace _bps_tree(process_replace)
 #define bps_tree_debug_memmove _bps_tree(debug_memmove)
 #define bps_tree_insert_into_leaf _bps_tree(insert_into_leaf)
+#define bps_tree_block_card _bps_tree(block_card)
+#define bps_tree_set_card _bps_tree(set_card)
+#define bps_tree_build_card _bps_tree(build_card)
+#define bps_tree_path_add_card _bps_tree(path_add_card)
+#define bps_tree_update_card _bps_tree(update_card)
 #define bps_tree_insert_into_inner _bps_tree(insert_into_inner)
 #define bps_tree_delete_from_leaf _bps_tree(delete_from_leaf)
 #define bps_tree_delete_from_inner _bps_tree(delete_from_inner)
@@ -608,6 +632,20 @@ bps_tree_destroy(struct bps_tree *tree);
 static inline bps_tree_elem_t *
 bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key);
 
+/**
+ * @brief Find the first elements equal to each of given keys.
+ * The tree is descended for all keys at once, level by level,
+ * so that cache misses of different keys overlap.
+ * @param tree - pointer to a tree
+ * @param keys - array of keys
+ * @param count - number of keys
+ * @param result - array receiving pointers to the first equal
+ *  elements or NULL if not found
+ */
+static inline void
+bps_tree_find_batch(const struct bps_tree *tree, const bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **result);
+
 /**
  * @brief Insert an element to the tree or replace an element in the tree
  * In case of replacing, if 'replaced' argument is not null,
@@ -789,6 +827,52 @@ bps_tree_upper_bound_elem(const struct bps_tree *tree, bps_tree_elem_t key,
 static inline size_t
 bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key);
 
+#ifdef BPS_INNER_CARD
+
+/**
+ * @brief Get the number of elements that are less than the key,
+ * i.e. the offset of the lower bound of the key in the tree.
+ * Has logarithmic complexity.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  the tree contains an element equal to the key, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - number of elements less than the key.
+ */
+static inline size_t
+bps_tree_lower_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact);
+
+/**
+ * @brief Get the number of elements that are less than or equal
+ * to the key, i.e. the offset of the upper bound of the key in the
+ * tree. Has logarithmic complexity.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  the tree contains an element equal to the key, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - number of elements less than or equal to the key.
+ */
+static inline size_t
+bps_tree_upper_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact);
+
+/**
+ * @brief Get an iterator to the element with the given offset,
+ * i.e. to the element that has exactly @a offset elements less than
+ * it. Has logarithmic complexity.
+ * @param tree - pointer to a tree
+ * @param offset - offset of the element
+ * @return - Iterator to the element. Invalid if offset is not less
+ *  than the size of the tree.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset);
+
+#endif /* BPS_INNER_CARD */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -893,6 +977,13 @@ bps_tree_debug_check_internal_functions(bool assertme);
 /* Same as BPS_TREE_MEMMOVE but takes count of values instead of memory size */
 #define BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck) \
 	BPS_TREE_MEMMOVE(dst, src, (num) * sizeof((dst)[0]), dst_bck, src_bck)
+/* Moves subtree cardinalities along with child IDs of inner blocks */
+#ifdef BPS_INNER_CARD
+#define BPS_TREE_CARDMOVE(dst, src, num) \
+	memmove(dst, src, (num) * sizeof(size_t))
+#else
+#define BPS_TREE_CARDMOVE(dst, src, num) ((void)0)
+#endif
 
 /**
  * Types of a block
@@ -923,7 +1014,11 @@ enum bps_tree_max_sizes {
 		/ sizeof(bps_tree_elem_t),
 	BPS_TREE_MAX_COUNT_IN_INNER =
 		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
-		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)),
+		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)
+#ifdef BPS_INNER_CARD
+		   + sizeof(size_t)
+#endif
+		  ),
 	BPS_TREE_MAX_DEPTH = 16
 };
 
@@ -967,6 +1062,10 @@ struct bps_inner {
 	struct bps_block header;
 	/* Ordered array of elements. Note -1 in size. See struct descr. */
 	bps_tree_elem_t elems[BPS_TREE_MAX_COUNT_IN_INNER - 1];
+#ifdef BPS_INNER_CARD
+	/* Number of elements in the corresponding child subtrees */
+	size_t child_cards[BPS_TREE_MAX_COUNT_IN_INNER];
+#endif
 	/* Corresponding child IDs */
 	bps_tree_block_id_t child_ids[BPS_TREE_MAX_COUNT_IN_INNER];
 };
@@ -1090,6 +1189,9 @@ bps_tree_create(struct bps_tree *tree, bps_tree_arg_t arg,
 #endif
 }
 
+static inline void
+bps_tree_build_card(struct bps_tree *tree, bps_tree_block_id_t id);
+
 /**
  * @brief Fills a new (asserted) tree with values from sorted array.
  *  Elements are copied from the array. Array is not checked to be sorted!
@@ -1228,6 +1330,7 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 		tree->root_id = first_leaf_id;
 	} else {
 		tree->root_id = root_if_inner_id;
+		bps_tree_build_card(tree, tree->root_id);
 	}
 	return 0;
 }
@@ -1304,6 +1407,144 @@ bps_tree_touch_block(struct bps_tree *tree, bps_tree_block_id_t id)
 	return (struct bps_block *)matras_touch(&tree->matras, id);
 }
 
+#ifdef BPS_INNER_CARD
+
+/**
+ * @brief Count elements in the subtree of the given block.
+ *  Takes O(fanout) since cardinalities of child subtrees are
+ *  stored in inner blocks.
+ */
+static inline size_t
+bps_tree_block_card(const struct bps_tree *tree, bps_tree_block_id_t id)
+{
+	struct bps_block *block = bps_tree_restore_block(tree, id);
+	if (block->type == BPS_TREE_BT_LEAF)
+		return block->size;
+	assert(block->type == BPS_TREE_BT_INNER);
+	struct bps_inner *inner = (struct bps_inner *)block;
+	size_t card = 0;
+	for (bps_tree_pos_t i = 0; i < inner->header.size; i++)
+		card += inner->child_cards[i];
+	return card;
+}
+
+/**
+ * @brief Set the cardinality of a child subtree of an inner block
+ *  according to the content of the child block.
+ *  Internal functions are checked on a fake tree without blocks
+ *  (root_id is -1), the cardinality is set to zero then.
+ */
+static inline void
+bps_tree_set_card(struct bps_tree *tree, struct bps_inner *inner,
+		  bps_tree_pos_t pos)
+{
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		inner->child_cards[pos] = 0;
+		return;
+	}
+	inner->child_cards[pos] =
+		bps_tree_block_card(tree, inner->child_ids[pos]);
+}
+
+/**
+ * @brief Recursively fill cardinalities of child subtrees of
+ *  the given inner block and all its descendants.
+ *  Used on a freshly built tree, so blocks are not touched.
+ */
+static inline void
+bps_tree_build_card(struct bps_tree *tree, bps_tree_block_id_t id)
+{
+	struct bps_inner *inner = (struct bps_inner *)
+		bps_tree_restore_block(tree, id);
+	assert(inner->header.type == BPS_TREE_BT_INNER);
+	for (bps_tree_pos_t i = 0; i < inner->header.size; i++) {
+		struct bps_block *child =
+			bps_tree_restore_block(tree, inner->child_ids[i]);
+		if (child->type == BPS_TREE_BT_INNER)
+			bps_tree_build_card(tree, inner->child_ids[i]);
+		bps_tree_set_card(tree, inner, i);
+	}
+}
+
+/**
+ * @brief Add delta to cardinalities of all subtrees on the path
+ *  from the root to the given leaf.
+ */
+static inline void
+bps_tree_path_add_card(struct bps_tree *tree,
+		       struct bps_leaf_path_elem *leaf_path_elem, int delta)
+{
+	bps_tree_pos_t pos = leaf_path_elem->pos_in_parent;
+	struct bps_inner_path_elem *path = leaf_path_elem->parent;
+	for (; path != NULL; path = path->parent) {
+		path->block = (struct bps_inner *)
+			bps_tree_touch_block(tree, path->block_id);
+		path->block->child_cards[pos] += delta;
+		pos = path->pos_in_parent;
+	}
+}
+
+/**
+ * @brief Recalculate the cardinality of a block in its parent
+ *  after elements were moved from or to the block.
+ *  Does nothing if the block is the root or is not linked to
+ *  the parent yet (a new block that is being filled on split).
+ */
+static inline void
+bps_tree_update_card(struct bps_tree *tree,
+		     struct bps_inner_path_elem *parent,
+		     bps_tree_pos_t pos, bps_tree_block_id_t id)
+{
+	if (tree->root_id == (bps_tree_block_id_t)(-1) || parent == NULL)
+		return;
+	if (pos >= parent->block->header.size ||
+	    parent->block->child_ids[pos] != id)
+		return;
+	parent->block = (struct bps_inner *)
+		bps_tree_touch_block(tree, parent->block_id);
+	bps_tree_set_card(tree, parent->block, pos);
+}
+
+#else /* BPS_INNER_CARD */
+
+static inline void
+bps_tree_set_card(struct bps_tree *tree, struct bps_inner *inner,
+		  bps_tree_pos_t pos)
+{
+	(void)tree;
+	(void)inner;
+	(void)pos;
+}
+
+static inline void
+bps_tree_build_card(struct bps_tree *tree, bps_tree_block_id_t id)
+{
+	(void)tree;
+	(void)id;
+}
+
+static inline void
+bps_tree_path_add_card(struct bps_tree *tree,
+		       struct bps_leaf_path_elem *leaf_path_elem, int delta)
+{
+	(void)tree;
+	(void)leaf_path_elem;
+	(void)delta;
+}
+
+static inline void
+bps_tree_update_card(struct bps_tree *tree,
+		     struct bps_inner_path_elem *parent,
+		     bps_tree_pos_t pos, bps_tree_block_id_t id)
+{
+	(void)tree;
+	(void)parent;
+	(void)pos;
+	(void)id;
+}
+
+#endif /* BPS_INNER_CARD */
+
 /**
  * @brief Get a random element in a tree.
  * @param tree - pointer to a tree
@@ -1957,6 +2198,124 @@ bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key)
 	return result;
 }
 
+#ifdef BPS_INNER_CARD
+
+/**
+ * @brief Get the number of elements that are less than the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  the tree contains an element equal to the key, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - offset of the lower bound of the key.
+ */
+static inline size_t
+bps_tree_lower_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact)
+{
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return 0;
+	size_t offset = 0;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_ins_point_key(tree, inner->elems,
+						  inner->header.size - 1,
+						  key, exact);
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			offset += inner->child_cards[j];
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	offset += bps_tree_find_ins_point_key(tree, leaf->elems,
+					      leaf->header.size, key, exact);
+	return offset;
+}
+
+/**
+ * @brief Get the number of elements that are less than or equal
+ *  to the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  the tree contains an element equal to the key, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - offset of the upper bound of the key.
+ */
+static inline size_t
+bps_tree_upper_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact)
+{
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	bool exact_test;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return 0;
+	size_t offset = 0;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_after_ins_point_key(tree, inner->elems,
+							inner->header.size - 1,
+							key, &exact_test);
+		if (exact_test)
+			*exact = true;
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			offset += inner->child_cards[j];
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	offset += bps_tree_find_after_ins_point_key(tree, leaf->elems,
+						    leaf->header.size,
+						    key, &exact_test);
+	if (exact_test)
+		*exact = true;
+	return offset;
+}
+
+/**
+ * @brief Get an iterator to the element with the given offset.
+ * @param tree - pointer to a tree
+ * @param offset - offset of the element
+ * @return - Iterator to the element. Invalid if offset is not less
+ *  than the size of the tree.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset)
+{
+	if (offset >= tree->size)
+		return bps_tree_invalid_iterator();
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos = 0;
+		while (offset >= inner->child_cards[pos]) {
+			offset -= inner->child_cards[pos];
+			pos++;
+			assert(pos < inner->header.size);
+		}
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+	assert(offset < (size_t)block->size);
+	res.block_id = block_id;
+	res.pos = offset;
+	return res;
+}
+
+#endif /* BPS_INNER_CARD */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -2095,6 +2454,65 @@ bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key)
 		return 0;
 }
 
+/**
+ * @brief Prefetch all cache lines of a block.
+ */
+static inline void
+bps_tree_prefetch_block(const struct bps_block *block)
+{
+	for (size_t offset = 0; offset < BPS_TREE_BLOCK_SIZE; offset += 64)
+		__builtin_prefetch((const char *)block + offset);
+}
+
+/**
+ * @sa bps_tree_find_batch description
+ */
+static inline void
+bps_tree_find_batch(const struct bps_tree *tree, const bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **result)
+{
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		for (size_t i = 0; i < count; i++)
+			result[i] = 0;
+		return;
+	}
+	/* Number of keys looked up simultaneously. */
+	enum { BATCH_SIZE = 16 };
+	struct bps_block *blocks[BATCH_SIZE];
+	bool exact = false;
+	for (size_t start = 0; start < count; start += BATCH_SIZE) {
+		size_t batch_count = count - start < BATCH_SIZE ?
+				     count - start : BATCH_SIZE;
+		const bps_tree_key_t *batch_keys = keys + start;
+		struct bps_block *root = bps_tree_root(tree);
+		for (size_t j = 0; j < batch_count; j++)
+			blocks[j] = root;
+		for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+			for (size_t j = 0; j < batch_count; j++) {
+				struct bps_inner *inner =
+					(struct bps_inner *)blocks[j];
+				bps_tree_pos_t pos;
+				pos = bps_tree_find_ins_point_key(tree,
+						inner->elems,
+						inner->header.size - 1,
+						batch_keys[j], &exact);
+				blocks[j] = bps_tree_restore_block(tree,
+						inner->child_ids[pos]);
+				bps_tree_prefetch_block(blocks[j]);
+			}
+		}
+		for (size_t j = 0; j < batch_count; j++) {
+			struct bps_leaf *leaf = (struct bps_leaf *)blocks[j];
+			bps_tree_pos_t pos;
+			pos = bps_tree_find_ins_point_key(tree, leaf->elems,
+							  leaf->header.size,
+							  batch_keys[j],
+							  &exact);
+			result[start + j] = exact ? leaf->elems + pos : 0;
+		}
+	}
+}
+
 /**
  * @brief Add a block to the garbage for future reuse
  */
@@ -2513,12 +2931,16 @@ bps_tree_insert_into_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos + 1,
 				  inner->child_ids + pos,
 				  inner->header.size - pos, inner, inner);
+		BPS_TREE_CARDMOVE(inner->child_cards + pos + 1,
+				  inner->child_cards + pos,
+				  inner->header.size - pos);
 	} else {
 		if (pos > 0)
 			inner->elems[pos - 1] = *inner_path_elem->max_elem_copy;
 		*inner_path_elem->max_elem_copy = max_elem;
 	}
 	inner->child_ids[pos] = block_id;
+	bps_tree_set_card(tree, inner, pos);
 
 	inner->header.size++;
 }
@@ -2577,6 +2999,9 @@ bps_tree_delete_from_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos,
 				  inner->child_ids + pos + 1,
 				  inner->header.size - 1 - pos, inner, inner);
+		BPS_TREE_CARDMOVE(inner->child_cards + pos,
+				  inner->child_cards + pos + 1,
+				  inner->header.size - 1 - pos);
 	} else if (pos > 0) {
 		*inner_path_elem->max_elem_copy = inner->elems[pos - 1];
 	}
@@ -2619,6 +3044,12 @@ bps_tree_move_elems_to_right_leaf(struct bps_tree *tree,
 		*a_leaf_path_elem->max_elem_copy =
 			a->elems[a->header.size - 1];
 	*b_leaf_path_elem->max_elem_copy = b->elems[b->header.size - 1];
+	bps_tree_update_card(tree, a_leaf_path_elem->parent,
+			     a_leaf_path_elem->pos_in_parent,
+			     a_leaf_path_elem->block_id);
+	bps_tree_update_card(tree, b_leaf_path_elem->parent,
+			     b_leaf_path_elem->pos_in_parent,
+			     b_leaf_path_elem->block_id);
 }
 
 /**
@@ -2648,8 +3079,11 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 
 	BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
 			  b->header.size, b, b);
+	BPS_TREE_CARDMOVE(b->child_cards + num, b->child_cards, b->header.size);
 	BPS_TREE_DATAMOVE(b->child_ids, a->child_ids + a->header.size - num,
 			  num, b, a);
+	BPS_TREE_CARDMOVE(b->child_cards,
+			  a->child_cards + a->header.size - num, num);
 
 	if (!move_to_empty)
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
@@ -2667,6 +3101,12 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 
 	a->header.size -= num;
 	b->header.size += num;
+	bps_tree_update_card(tree, a_inner_path_elem->parent,
+			     a_inner_path_elem->pos_in_parent,
+			     a_inner_path_elem->block_id);
+	bps_tree_update_card(tree, b_inner_path_elem->parent,
+			     b_inner_path_elem->pos_in_parent,
+			     b_inner_path_elem->block_id);
 }
 
 /**
@@ -2699,6 +3139,12 @@ bps_tree_move_elems_to_left_leaf(struct bps_tree *tree,
 	a->header.size += num;
 	b->header.size -= num;
 	*a_leaf_path_elem->max_elem_copy = a->elems[a->header.size - 1];
+	bps_tree_update_card(tree, a_leaf_path_elem->parent,
+			     a_leaf_path_elem->pos_in_parent,
+			     a_leaf_path_elem->block_id);
+	bps_tree_update_card(tree, b_leaf_path_elem->parent,
+			     b_leaf_path_elem->pos_in_parent,
+			     b_leaf_path_elem->block_id);
 }
 
 /**
@@ -2728,8 +3174,11 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 
 	BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
 			  num, a, b);
+	BPS_TREE_CARDMOVE(a->child_cards + a->header.size, b->child_cards, num);
 	BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
 			  b->header.size - num, b, b);
+	BPS_TREE_CARDMOVE(b->child_cards,
+			  b->child_cards + num, b->header.size - num);
 
 	if (!move_to_empty)
 		a->elems[a->header.size - 1] =
@@ -2746,6 +3195,12 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 
 	a->header.size += num;
 	b->header.size -= num;
+	bps_tree_update_card(tree, a_inner_path_elem->parent,
+			     a_inner_path_elem->pos_in_parent,
+			     a_inner_path_elem->block_id);
+	bps_tree_update_card(tree, b_inner_path_elem->parent,
+			     b_inner_path_elem->pos_in_parent,
+			     b_inner_path_elem->block_id);
 }
 
 /**
@@ -2813,6 +3268,12 @@ bps_tree_insert_and_move_elems_to_right_leaf(struct bps_tree *tree,
 	if (move_to_empty)
 		*b_leaf_path_elem->max_elem_copy =
 			b->elems[b->header.size - 1];
+	bps_tree_update_card(tree, a_leaf_path_elem->parent,
+			     a_leaf_path_elem->pos_in_parent,
+			     a_leaf_path_elem->block_id);
+	bps_tree_update_card(tree, b_leaf_path_elem->parent,
+			     b_leaf_path_elem->pos_in_parent,
+			     b_leaf_path_elem->block_id);
 	tree->size++;
 	return ret;
 }
@@ -2852,6 +3313,8 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 	if (!move_to_empty) {
 		BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
 				  b->header.size, b, b);
+		BPS_TREE_CARDMOVE(b->child_cards + num,
+				  b->child_cards, b->header.size);
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
 				  b->header.size - 1, b, b);
 	}
@@ -2862,9 +3325,14 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num,
 				  num, b, a);
+		BPS_TREE_CARDMOVE(b->child_cards,
+				  a->child_cards + a->header.size - num, num);
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
+		BPS_TREE_CARDMOVE(a->child_cards + pos + 1,
+				  a->child_cards + pos, mid_part_size - num);
 		a->child_ids[pos] = block_id;
+		bps_tree_set_card(tree, a, pos);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + (a->header.size - num),
 				  num - 1, b, a);
@@ -2884,9 +3352,14 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num,
 				  num, b, a);
+		BPS_TREE_CARDMOVE(b->child_cards,
+				  a->child_cards + a->header.size - num, num);
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
+		BPS_TREE_CARDMOVE(a->child_cards + pos + 1,
+				  a->child_cards + pos, mid_part_size - num);
 		a->child_ids[pos] = block_id;
+		bps_tree_set_card(tree, a, pos);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + (a->header.size - num),
 				  num - 1, b, a);
@@ -2903,9 +3376,15 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num + 1,
 				  new_pos, b, a);
+		BPS_TREE_CARDMOVE(b->child_cards,
+				  a->child_cards + a->header.size - num + 1,
+				  new_pos);
 		b->child_ids[new_pos] = block_id;
+		bps_tree_set_card(tree, b, new_pos);
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  a->child_ids + pos, mid_part_size, b, a);
+		BPS_TREE_CARDMOVE(b->child_cards + new_pos + 1,
+				  a->child_cards + pos, mid_part_size);
 
 		if (pos == a->header.size) {
 			/* +1 */
@@ -2950,6 +3429,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 
 	a->header.size -= (num - 1);
 	b->header.size += num;
+	bps_tree_update_card(tree, a_inner_path_elem->parent,
+			     a_inner_path_elem->pos_in_parent,
+			     a_inner_path_elem->block_id);
+	bps_tree_update_card(tree, b_inner_path_elem->parent,
+			     b_inner_path_elem->pos_in_parent,
+			     b_inner_path_elem->block_id);
 }
 
 /**
@@ -3016,6 +3501,12 @@ bps_tree_insert_and_move_elems_to_left_leaf(struct bps_tree *tree,
 	if (!move_all)
 		*b_leaf_path_elem->max_elem_copy =
 			b->elems[b->header.size - 1];
+	bps_tree_update_card(tree, a_leaf_path_elem->parent,
+			     a_leaf_path_elem->pos_in_parent,
+			     a_leaf_path_elem->block_id);
+	bps_tree_update_card(tree, b_leaf_path_elem->parent,
+			     b_leaf_path_elem->pos_in_parent,
+			     b_leaf_path_elem->block_id);
 	tree->size++;
 	return ret;
 }
@@ -3057,12 +3548,19 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		bps_tree_pos_t new_pos = pos - num; /* Can be 0 */
 		BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
 				  num, a, b);
+		BPS_TREE_CARDMOVE(a->child_cards + a->header.size,
+				  b->child_cards, num);
 		BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
 				  new_pos, b, b);
+		BPS_TREE_CARDMOVE(b->child_cards,
+				  b->child_cards + num, new_pos);
 		b->child_ids[new_pos] = block_id;
+		bps_tree_set_card(tree, b, new_pos);
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  b->child_ids + pos,
 				  b->header.size - pos, b, b);
+		BPS_TREE_CARDMOVE(b->child_cards + new_pos + 1,
+				  b->child_cards + pos, b->header.size - pos);
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -3098,12 +3596,21 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		bps_tree_pos_t new_pos = a->header.size + pos; /* Can be 0 */
 		BPS_TREE_DATAMOVE(a->child_ids + a->header.size,
 				  b->child_ids, pos, a, b);
+		BPS_TREE_CARDMOVE(a->child_cards + a->header.size,
+				  b->child_cards, pos);
 		a->child_ids[new_pos] = block_id;
+		bps_tree_set_card(tree, a, new_pos);
 		BPS_TREE_DATAMOVE(a->child_ids + new_pos + 1,
 				  b->child_ids + pos, num - 1 - pos, a, b);
-		if (!move_all)
+		BPS_TREE_CARDMOVE(a->child_cards + new_pos + 1,
+				  b->child_cards + pos, num - 1 - pos);
+		if (!move_all) {
 			BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num - 1,
 					  b->header.size - num + 1, b, b);
+			BPS_TREE_CARDMOVE(b->child_cards,
+					  b->child_cards + num - 1,
+					  b->header.size - num + 1);
+		}
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -3148,6 +3655,12 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 
 	a->header.size += num;
 	b->header.size -= (num - 1);
+	bps_tree_update_card(tree, a_inner_path_elem->parent,
+			     a_inner_path_elem->pos_in_parent,
+			     a_inner_path_elem->block_id);
+	bps_tree_update_card(tree, b_inner_path_elem->parent,
+			     b_inner_path_elem->pos_in_parent,
+			     b_inner_path_elem->block_id);
 }
 
 /**
@@ -3713,6 +4226,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		new_root->header.size = 2;
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
+		bps_tree_set_card(tree, new_root, 0);
+		bps_tree_set_card(tree, new_root, 1);
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -4033,6 +4548,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		new_root->header.size = 2;
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
+		bps_tree_set_card(tree, new_root, 0);
+		bps_tree_set_card(tree, new_root, 1);
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -4450,9 +4967,13 @@ bps_tree_insert(struct bps_tree *tree, bps_tree_elem_t new_elem,
 	} else {
 		bps_tree_block_id_t unused1;
 		bps_tree_pos_t unused2;
-		return bps_tree_process_insert_leaf(tree, &leaf_path_elem,
-						    new_elem, &unused1,
-						    &unused2);
+		bps_tree_path_add_card(tree, &leaf_path_elem, 1);
+		int rc = bps_tree_process_insert_leaf(tree, &leaf_path_elem,
+						      new_elem, &unused1,
+						      &unused2);
+		if (rc != 0)
+			bps_tree_path_add_card(tree, &leaf_path_elem, -1);
+		return rc;
 	}
 }
 
@@ -4485,10 +5006,13 @@ bps_tree_insert_get_iterator(struct bps_tree *tree, bps_tree_elem_t new_elem,
 					 replaced);
 		return 0;
 	} else {
+		bps_tree_path_add_card(tree, &leaf_path_elem, 1);
 		int rc = bps_tree_process_insert_leaf(tree, &leaf_path_elem,
 						      new_elem,
 						      &inserted_iterator->block_id,
 						      &inserted_iterator->pos);
+		if (rc != 0)
+			bps_tree_path_add_card(tree, &leaf_path_elem, -1);
 		matras_head_read_view(&inserted_iterator->view);
 		return rc;
 	}
@@ -4513,6 +5037,7 @@ bps_tree_delete(struct bps_tree *tree, bps_tree_elem_t elem)
 	if (!exact)
 		return -1;
 
+	bps_tree_path_add_card(tree, &leaf_path_elem, -1);
 	bps_tree_process_delete_leaf(tree, &leaf_path_elem);
 	return 0;
 }
@@ -4546,6 +5071,7 @@ bps_tree_delete_value(struct bps_tree *tree, bps_tree_elem_t elem,
 		return -1;
 	if (deleted_elem != NULL)
 		*deleted_elem = leaf->elems[leaf_path_elem.insertion_point];
+	bps_tree_path_add_card(tree, &leaf_path_elem, -1);
 	bps_tree_process_delete_leaf(tree, &leaf_path_elem);
 	return 0;
 }
@@ -4661,13 +5187,22 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 				result |= 0x4000000;
 		}
 
-		for (bps_tree_pos_t i = 0; i < block->size; i++)
+		for (bps_tree_pos_t i = 0; i < block->size; i++) {
+#ifdef BPS_INNER_CARD
+			size_t child_count = *calc_count;
+#endif
 			result |= bps_tree_debug_check_block(tree,
 				bps_tree_restore_block(tree,
 						       inner->child_ids[i]),
 				inner->child_ids[i], level - 1, calc_count,
 				expected_prev_id, expected_this_id,
 				check_fullness_next);
+#ifdef BPS_INNER_CARD
+			child_count = *calc_count - child_count;
+			if (inner->child_cards[i] != child_count)
+				result |= 0x8000000;
+#endif
+		}
 		return result;
 	}
 }
@@ -6059,6 +6594,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 
 #undef BPS_TREE_MEMMOVE
 #undef BPS_TREE_DATAMOVE
+#undef BPS_TREE_CARDMOVE
 #undef BPS_TREE_BRANCH_TRACE
 
 /* {{{ Macros for custom naming of structs and functions */
@@ -6082,6 +6618,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_build
 #undef bps_tree_destroy
 #undef bps_tree_find
+#undef bps_tree_find_batch
 #undef bps_tree_insert
 #undef bps_tree_delete
 #undef bps_tree_delete_value
@@ -6098,6 +6635,9 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_lower_bound_elem
 #undef bps_tree_upper_bound_elem
 #undef bps_tree_approximate_count
+#undef bps_tree_lower_bound_offset
+#undef bps_tree_upper_bound_offset
+#undef bps_tree_iterator_at
 #undef bps_tree_iterator_get_elem
 #undef bps_tree_iterator_next
 #undef bps_tree_iterator_prev
@@ -6119,6 +6659,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_restore_block
 #undef bps_tree_restore_block_ver
 #undef bps_tree_root
+#undef bps_tree_prefetch_block
 #undef bps_tree_touch_block
 #undef bps_tree_find_ins_point_key
 #undef bps_tree_find_ins_point_elem
@@ -6140,6 +6681,11 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_debug_memmove
 #undef bps_tree_insert_into_leaf
 #undef bps_tree_insert_into_inner
+#undef bps_tree_block_card
+#undef bps_tree_set_card
+#undef bps_tree_build_card
+#undef bps_tree_path_add_card
+#undef bps_tree_update_card
 #undef bps_tree_delete_from_leaf
 #undef bps_tree_delete_from_inner
 #undef bps_tree_move_elems_to_right_leaf
@@ -388,6 +388,21 @@ LIGHT(slot)(const struct LIGHT(core) *ht, uint32_t hash)
 
 }
 
+/**
+ * @brief Prefetch the record a lookup of given hash starts with.
+ *  Used to overlap cache misses of several lookups.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be looked up
+ */
+static inline void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash)
+{
+	if (ht->count == 0)
+		return;
+	uint32_t slot = LIGHT(slot)(ht, hash);
+	__builtin_prefetch(matras_get(&ht->mtable, slot));
+}
+
 /**
  * @brief Find a record with given hash and value
  * @param ht - pointer to a hash table struct
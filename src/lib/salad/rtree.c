@@ -34,6 +34,7 @@
 #include <limits.h>
 #include <stddef.h>
 #include <sys/types.h>
+#include <third_party/qsort_arg.h>
 
 /*------------------------------------------------------------------------- */
 /* R-tree internal structures definition */
@@ -1006,6 +1007,153 @@ rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj)
 	tree->n_records++;
 }
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk load (Sort-Tile-Recursive packing) */
+/*------------------------------------------------------------------------- */
+
+/*
+ * Number of branches put into a page by rtree_build(). Some room is
+ * left in the pages so that the first inserts after the build don't
+ * split them all at once. Besides, two pages filled this way hold
+ * enough branches to be rebalanced above page_min_fill.
+ */
+static unsigned
+rtree_build_page_fill(const struct rtree *tree)
+{
+	return tree->page_max_fill * 4 / 5;
+}
+
+static int
+rtree_build_cmp(const void *a, const void *b, void *arg)
+{
+	unsigned axis = *(unsigned *)arg;
+	const struct rtree_page_branch *ba = a, *bb = b;
+	/* Compare doubled centers to avoid division */
+	coord_t ca = ba->rect.coords[axis * 2] + ba->rect.coords[axis * 2 + 1];
+	coord_t cb = bb->rect.coords[axis * 2] + bb->rect.coords[axis * 2 + 1];
+	return ca < cb ? -1 : ca > cb ? 1 : 0;
+}
+
+/*
+ * Order branches so that each run of @fill consecutive branches
+ * forms a compact page: sort by the center along @axis, cut into
+ * ceil(pages^(1/dims_left)) slabs of a whole number of pages and
+ * sort every slab along the next axis recursively.
+ */
+static void
+rtree_build_sort(const struct rtree *tree, char *branches, size_t count,
+		 unsigned fill, unsigned axis)
+{
+	if (count <= fill)
+		return;
+	qsort_arg(branches, count, tree->page_branch_size,
+		  rtree_build_cmp, &axis);
+	unsigned dims_left = tree->dimension - axis;
+	if (dims_left == 1)
+		return;
+	size_t pages = (count + fill - 1) / fill;
+	size_t slabs = 1;
+	while (true) {
+		size_t power = 1;
+		for (unsigned i = 0; i < dims_left && power < pages; i++)
+			power *= slabs;
+		if (power >= pages)
+			break;
+		slabs++;
+	}
+	size_t slab_size = (pages + slabs - 1) / slabs * fill;
+	for (size_t i = 0; i < count; i += slab_size) {
+		size_t n = count - i < slab_size ? count - i : slab_size;
+		rtree_build_sort(tree, branches + i * tree->page_branch_size,
+				 n, fill, axis + 1);
+	}
+}
+
+/*
+ * Pack sorted branches into pages, @fill per page, and replace them
+ * in place with branches pointing to the new pages. Branch i is
+ * written over already consumed input, because every page consumes
+ * at least one branch. The last two pages are rebalanced if the last
+ * one would be underfilled. Returns the number of created pages.
+ */
+static size_t
+rtree_build_level(struct rtree *tree, char *branches, size_t count,
+		  unsigned fill)
+{
+	size_t size = tree->page_branch_size;
+	size_t pages = (count + fill - 1) / fill;
+	size_t pos = 0;
+	for (size_t i = 0; i < pages; i++) {
+		size_t n = count - pos < fill ? count - pos : fill;
+		if (i + 2 == pages && count - pos - fill < tree->page_min_fill)
+			n = (count - pos) - (count - pos) / 2;
+		struct rtree_page *page = rtree_page_alloc(tree);
+		tree->n_pages++;
+		page->n = n;
+		memcpy(page->data, branches + pos * size, n * size);
+		pos += n;
+		struct rtree_page_branch *b =
+			(struct rtree_page_branch *)(branches + i * size);
+		rtree_page_cover(tree, page, &b->rect);
+		b->data.page = page;
+	}
+	assert(pos == count);
+	return pages;
+}
+
+size_t
+rtree_build_entry_size(const struct rtree *tree)
+{
+	return tree->page_branch_size;
+}
+
+void
+rtree_build_entry_set(const struct rtree *tree, void *entries, size_t i,
+		      const struct rtree_rect *rect, record_t obj)
+{
+	struct rtree_page_branch *b = (struct rtree_page_branch *)
+		((char *)entries + i * tree->page_branch_size);
+	b->data.record = obj;
+	rtree_rect_copy(&b->rect, rect, tree->dimension);
+}
+
+size_t
+rtree_build_page_count(const struct rtree *tree, size_t count)
+{
+	unsigned fill = rtree_build_page_fill(tree);
+	size_t total = 0;
+	while (count > 0) {
+		count = (count + fill - 1) / fill;
+		total += count;
+		if (count == 1)
+			break;
+	}
+	return total;
+}
+
+void
+rtree_build(struct rtree *tree, void *entries, size_t count)
+{
+	assert(tree->root == NULL);
+	if (count == 0)
+		return;
+	unsigned fill = rtree_build_page_fill(tree);
+	assert(fill >= tree->page_min_fill && fill >= 2);
+	char *branches = (char *)entries;
+	unsigned height = 0;
+	size_t n = count;
+	do {
+		rtree_build_sort(tree, branches, n, fill, 0);
+		n = rtree_build_level(tree, branches, n, fill);
+		height++;
+	} while (n > 1);
+	assert(height <= RTREE_MAX_HEIGHT);
+	tree->root = ((struct rtree_page_branch *)branches)->data.page;
+	tree->height = height;
+	tree->n_records = count;
+	tree->version++;
+}
+
 bool
 rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj)
 {
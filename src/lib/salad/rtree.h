@@ -275,6 +275,48 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Size of an entry of the array passed to rtree_build()
+ * @param tree - pointer to a tree
+ */
+size_t
+rtree_build_entry_size(const struct rtree *tree);
+
+/**
+ * @brief Set up an entry of the array passed to rtree_build()
+ * @param tree - pointer to a tree
+ * @param entries - array of rtree_build_entry_size() sized entries
+ * @param i - index of the entry to set
+ * @param rect - rectangle of the record
+ * @param obj - record
+ */
+void
+rtree_build_entry_set(const struct rtree *tree, void *entries, size_t i,
+		      const struct rtree_rect *rect, record_t obj);
+
+/**
+ * @brief Maximal number of pages rtree_build() allocates for
+ * the given number of records. Useful to reserve memory in
+ * advance, since there is no error handling in the rtree lib.
+ * @param tree - pointer to a tree
+ * @param count - number of records
+ */
+size_t
+rtree_build_page_count(const struct rtree *tree, size_t count);
+
+/**
+ * @brief Build a tree from an array of records at once, using
+ * Sort-Tile-Recursive packing. Much faster than inserting the
+ * records one by one and produces a tree with less overlap
+ * between pages. The tree must be empty.
+ * @param tree - pointer to a tree
+ * @param entries - array of entries set by rtree_build_entry_set(),
+ *  used as a scratch buffer and left in unspecified state
+ * @param count - number of entries
+ */
+void
+rtree_build(struct rtree *tree, void *entries, size_t count);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
@@ -0,0 +1,827 @@
+/*
+ * *No header guard*: the header is allowed to be included twice
+ * with different sets of defines.
+ */
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "small/matras.h"
+
+/**
+ * An open addressing hash table with in-group probing, similar
+ * to Swiss tables and F14 (https://abseil.io/about/design/swisstables,
+ * https://engineering.fb.com/developer-tools/f14/).
+ *
+ * The table is an array of groups of SWISS_GROUP_SIZE slots.
+ * A group takes exactly one cache line: an 8-byte control word
+ * and 7 values. Each byte of the control word but the last one
+ * holds a tag of the corresponding slot: 0 for an empty slot or
+ * 7 bits of the value hash with the highest bit set for a busy
+ * one. A lookup compares the tag against all tags of a group at
+ * once (see swiss_match_tag()), so usually the only memory
+ * accessed besides the group is the value being searched for.
+ *
+ * The last byte of the control word counts the values that were
+ * placed in later groups of the probe sequence because this
+ * group was full. A lookup stops at the first group with a zero
+ * counter, so deletion doesn't need tombstones and lookups of
+ * missing keys rarely go beyond the first group.
+ *
+ * Groups are stored in a matras, so iterators can be frozen the
+ * same way as in light.h. The table doubles when the load factor
+ * exceeds SWISS_MAX_LOAD / SWISS_GROUP_SIZE, rehashing values in
+ * place. Since hashes are not stored, the table needs a function
+ * calculating the hash of a stored value (SWISS_HASH).
+ */
+
+/**
+ * Additional user defined name that appended to prefix 'swiss'
+ *  for all names of structs and functions in this header file.
+ * All names use pattern: swiss<SWISS_NAME>_<name of func/struct>
+ * May be empty, but still have to be defined (just #define SWISS_NAME)
+ * Example:
+ * #define SWISS_NAME _test
+ * ...
+ * struct swiss_test_core hash_table;
+ * swiss_test_create(&hash_table, ...);
+ */
+#ifndef SWISS_NAME
+#error "SWISS_NAME must be defined"
+#endif
+
+/**
+ * Data type that hash table holds. Must be not greater than
+ * 8 bytes.
+ */
+#ifndef SWISS_DATA_TYPE
+#error "SWISS_DATA_TYPE must be defined"
+#endif
+
+/**
+ * Data type that used to for finding values.
+ */
+#ifndef SWISS_KEY_TYPE
+#error "SWISS_KEY_TYPE must be defined"
+#endif
+
+/**
+ * Type of optional third parameter of comparing function.
+ * If not needed, simply use #define SWISS_CMP_ARG_TYPE int
+ */
+#ifndef SWISS_CMP_ARG_TYPE
+#error "SWISS_CMP_ARG_TYPE must be defined"
+#endif
+
+/**
+ * Data comparing function. Takes 3 parameters - value1, value2 and
+ * optional value that stored in hash table struct.
+ * Third parameter may be simply ignored like that:
+ * #define SWISS_EQUAL(a, b, garb) a == b
+ */
+#ifndef SWISS_EQUAL
+#error "SWISS_EQUAL must be defined"
+#endif
+
+/**
+ * Data comparing function. Takes 3 parameters - value, key and
+ * optional value that stored in hash table struct.
+ */
+#ifndef SWISS_EQUAL_KEY
+#error "SWISS_EQUAL_KEY must be defined"
+#endif
+
+/**
+ * Hash function of a stored value. Takes 2 parameters - value
+ * and optional value that stored in hash table struct. Must
+ * return the same hash that was passed on insertion. Used only
+ * for rehashing on growth.
+ */
+#ifndef SWISS_HASH
+#error "SWISS_HASH must be defined"
+#endif
+
+/**
+ * Tools for name substitution:
+ */
+#ifndef CONCAT4
+#define CONCAT4_R(a, b, c, d) a##b##c##d
+#define CONCAT4(a, b, c, d) CONCAT4_R(a, b, c, d)
+#endif
+
+#ifdef _
+#error '_' must be undefinded!
+#endif
+#define SWISS(name) CONCAT4(swiss, SWISS_NAME, _, name)
+
+/*
+ * Helpers that don't depend on the data type are defined once.
+ */
+#ifndef SWISS_COMMON_DEFINED
+#define SWISS_COMMON_DEFINED
+
+enum {
+	/** Number of slots in a group. */
+	SWISS_GROUP_SIZE = 7,
+	/** Max number of values per group on average. */
+	SWISS_MAX_LOAD = 6,
+	/** Max number of groups, slot IDs must fit in 32 bits. */
+	SWISS_MAX_GROUP_COUNT = 1 << 29,
+	/** Control byte of an empty slot. */
+	SWISS_EMPTY = 0,
+	/** Control byte of a slot waiting for rehash, see swiss_grow. */
+	SWISS_PENDING = 1,
+	/** Overflow counter value that is never decremented. */
+	SWISS_OVERFLOW_MAX = 0xff,
+};
+
+/** Highest bits of slot control bytes. */
+static const uint64_t SWISS_HIGH_BITS = 0x0080808080808080ULL;
+/** Lower 7 bits of slot control bytes. */
+static const uint64_t SWISS_LOW_BITS = 0x007f7f7f7f7f7f7fULL;
+/** Lowest bits of slot control bytes. */
+static const uint64_t SWISS_ONE_BITS = 0x0001010101010101ULL;
+
+/**
+ * Hash functions of integer keys are often the identity, while
+ * the table takes the group number and the tag from different
+ * bits of the hash. Mix it (murmur3 finalizer).
+ */
+static inline uint32_t
+swiss_mix(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/** Tag of a busy slot by a mixed hash. */
+static inline uint8_t
+swiss_tag(uint32_t mixed_hash)
+{
+	return 0x80 | (mixed_hash >> 25);
+}
+
+/** Control byte of the slot @a i. */
+static inline uint8_t
+swiss_ctrl_get(uint64_t ctrl, uint32_t i)
+{
+	return ctrl >> (i * 8);
+}
+
+/** Set control byte of the slot @a i. */
+static inline void
+swiss_ctrl_set(uint64_t *ctrl, uint32_t i, uint8_t byte)
+{
+	*ctrl &= ~(0xffULL << (i * 8));
+	*ctrl |= (uint64_t)byte << (i * 8);
+}
+
+/** Number of values that overflowed the group. */
+static inline uint8_t
+swiss_overflow(uint64_t ctrl)
+{
+	return ctrl >> 56;
+}
+
+/** Add @a delta to the overflow counter unless it saturated. */
+static inline void
+swiss_overflow_add(uint64_t *ctrl, int delta)
+{
+	uint8_t overflow = swiss_overflow(*ctrl);
+	if (overflow == SWISS_OVERFLOW_MAX)
+		return;
+	assert(delta > 0 || overflow > 0);
+	swiss_ctrl_set(ctrl, 7, overflow + delta);
+}
+
+/**
+ * Mask with the highest bit set in every control byte equal to
+ * @a tag. Doesn't give false positives, so all the slots in the
+ * mask are busy.
+ */
+static inline uint64_t
+swiss_match_tag(uint64_t ctrl, uint8_t tag)
+{
+	uint64_t x = ctrl ^ (SWISS_ONE_BITS * tag);
+	/* The highest bit of (x & 0x7f) + 0x7f is set if x != 0. */
+	uint64_t y = (x & SWISS_LOW_BITS) + SWISS_LOW_BITS;
+	return ~(y | x | SWISS_LOW_BITS) & SWISS_HIGH_BITS;
+}
+
+/** Mask of slots that are empty or wait for rehash. */
+static inline uint64_t
+swiss_match_free(uint64_t ctrl)
+{
+	return ~ctrl & SWISS_HIGH_BITS;
+}
+
+/** Number of the first slot in a non-zero mask. */
+static inline uint32_t
+swiss_mask_first(uint64_t mask)
+{
+	return __builtin_ctzll(mask) / 8;
+}
+
+#endif /* SWISS_COMMON_DEFINED */
+
+/**
+ * A group of slots, takes a cache line.
+ */
+struct SWISS(group) {
+	/** Tags of slots and the overflow counter, see above. */
+	uint64_t ctrl;
+	union {
+		SWISS_DATA_TYPE value;
+		uint64_t padding;
+	} slots[SWISS_GROUP_SIZE];
+};
+
+/**
+ * Main struct for holding hash table
+ */
+struct SWISS(core) {
+	/* count of values in hash table */
+	uint32_t count;
+	/* number of groups, zero or a power of two */
+	uint32_t group_count;
+	/* number of slots, group_count * SWISS_GROUP_SIZE */
+	uint32_t table_size;
+	/* additional parameter for data comparison */
+	SWISS_CMP_ARG_TYPE arg;
+	/* dynamic storage for groups */
+	struct matras mtable;
+};
+
+/**
+ * Iterator, for iterating all values in hash_table.
+ * It also may be used for restoring one value by key.
+ */
+struct SWISS(iterator) {
+	/* Current position on table (ID of a current slot) */
+	uint32_t slotpos;
+	/* Version of matras memory for MVCC */
+	struct matras_view view;
+};
+
+/**
+ * Type of functions for memory allocation and deallocation
+ */
+typedef void *(*SWISS(extent_alloc_t))(void *ctx);
+typedef void (*SWISS(extent_free_t))(void *ctx, void *extent);
+
+/**
+ * Special result of swiss_find that means that nothing was found
+ * Must be equal or greater than possible hash table size
+ */
+static const uint32_t SWISS(end) = 0xFFFFFFFF;
+
+/**
+ * @brief Hash table construction. Fills struct swiss members.
+ * @param ht - pointer to a hash table struct
+ * @param extent_size - size of allocating memory blocks
+ * @param extent_alloc_func - memory blocks allocation function
+ * @param extent_free_func - memory blocks allocation function
+ * @param alloc_ctx - argument passed to memory block allocator
+ * @param arg - optional parameter to save for comparing function
+ */
+static inline void
+SWISS(create)(struct SWISS(core) *ht, size_t extent_size,
+	      SWISS(extent_alloc_t) extent_alloc_func,
+	      SWISS(extent_free_t) extent_free_func,
+	      void *alloc_ctx, SWISS_CMP_ARG_TYPE arg)
+{
+	assert(sizeof(struct SWISS(group)) == 64);
+	ht->count = 0;
+	ht->group_count = 0;
+	ht->table_size = 0;
+	ht->arg = arg;
+	matras_create(&ht->mtable,
+		      extent_size, sizeof(struct SWISS(group)),
+		      extent_alloc_func, extent_free_func, alloc_ctx);
+}
+
+/**
+ * @brief Hash table destruction. Frees all allocated memory
+ * @param ht - pointer to a hash table struct
+ */
+static inline void
+SWISS(destroy)(struct SWISS(core) *ht)
+{
+	matras_destroy(&ht->mtable);
+}
+
+/**
+ * Group number following @a gid in the probe sequence,
+ * @a step is the number of groups visited so far. Triangular
+ * numbers cover all groups of a power of two sized table.
+ */
+static inline uint32_t
+SWISS(next_group)(const struct SWISS(core) *ht, uint32_t gid, uint32_t step)
+{
+	return (gid + step) & (ht->group_count - 1);
+}
+
+/**
+ * @brief Prefetch the group a lookup of given hash starts with.
+ *  Used to overlap cache misses of several lookups.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be looked up
+ */
+static inline void
+SWISS(prefetch)(const struct SWISS(core) *ht, uint32_t hash)
+{
+	if (ht->count == 0)
+		return;
+	uint32_t gid = swiss_mix(hash) & (ht->group_count - 1);
+	__builtin_prefetch(matras_get(&ht->mtable, gid));
+}
+
+/**
+ * @brief Find a value with given hash and key
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ * @param key - key to find
+ * @return integer ID of found slot or swiss_end if nothing found
+ */
+static inline uint32_t
+SWISS(find_key)(const struct SWISS(core) *ht, uint32_t hash,
+		SWISS_KEY_TYPE key)
+{
+	if (ht->count == 0)
+		return SWISS(end);
+	hash = swiss_mix(hash);
+	uint8_t tag = swiss_tag(hash);
+	uint32_t gid = hash & (ht->group_count - 1);
+	for (uint32_t step = 1; step <= ht->group_count; step++) {
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_get(&ht->mtable, gid);
+		uint64_t match = swiss_match_tag(group->ctrl, tag);
+		while (match != 0) {
+			uint32_t i = swiss_mask_first(match);
+			if (SWISS_EQUAL_KEY((group->slots[i].value), (key),
+					    (ht->arg)))
+				return gid * SWISS_GROUP_SIZE + i;
+			match &= match - 1;
+		}
+		if (swiss_overflow(group->ctrl) == 0)
+			break;
+		gid = SWISS(next_group)(ht, gid, step);
+	}
+	return SWISS(end);
+}
+
+/**
+ * @brief Find a value with given hash and value
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ * @param value - value to find
+ * @return integer ID of found slot or swiss_end if nothing found
+ */
+static inline uint32_t
+SWISS(find)(const struct SWISS(core) *ht, uint32_t hash,
+	    SWISS_DATA_TYPE value)
+{
+	if (ht->count == 0)
+		return SWISS(end);
+	hash = swiss_mix(hash);
+	uint8_t tag = swiss_tag(hash);
+	uint32_t gid = hash & (ht->group_count - 1);
+	for (uint32_t step = 1; step <= ht->group_count; step++) {
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_get(&ht->mtable, gid);
+		uint64_t match = swiss_match_tag(group->ctrl, tag);
+		while (match != 0) {
+			uint32_t i = swiss_mask_first(match);
+			if (SWISS_EQUAL((group->slots[i].value), (value),
+					(ht->arg)))
+				return gid * SWISS_GROUP_SIZE + i;
+			match &= match - 1;
+		}
+		if (swiss_overflow(group->ctrl) == 0)
+			break;
+		gid = SWISS(next_group)(ht, gid, step);
+	}
+	return SWISS(end);
+}
+
+/**
+ * @brief Replace a value with given hash and value
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ * @param value - value to find and replace
+ * @param replaced - pointer to a value that was stored in table before replace
+ * @return integer ID of found slot or swiss_end if nothing found
+ */
+static inline uint32_t
+SWISS(replace)(struct SWISS(core) *ht, uint32_t hash,
+	       SWISS_DATA_TYPE value, SWISS_DATA_TYPE *replaced)
+{
+	uint32_t slot = SWISS(find)(ht, hash, value);
+	if (slot == SWISS(end))
+		return SWISS(end);
+	struct SWISS(group) *group = (struct SWISS(group) *)
+		matras_touch(&ht->mtable, slot / SWISS_GROUP_SIZE);
+	if (group == NULL)
+		return SWISS(end);
+	uint32_t i = slot % SWISS_GROUP_SIZE;
+	*replaced = group->slots[i].value;
+	group->slots[i].value = value;
+	return slot;
+}
+
+/**
+ * Make writable the first @a len groups of the probe sequence
+ * of @a mixed_hash and add @a delta to the overflow counters of
+ * all of them but the last one. A memory failure leaves the
+ * table intact.
+ * @return the last group or NULL on memory failure
+ */
+static inline struct SWISS(group) *
+SWISS(touch_path)(struct SWISS(core) *ht, uint32_t mixed_hash,
+		  uint32_t len, int delta)
+{
+	assert(len > 0);
+	uint32_t gid = mixed_hash & (ht->group_count - 1);
+	for (uint32_t step = 1; step <= len; step++) {
+		if (matras_touch(&ht->mtable, gid) == NULL)
+			return NULL;
+		gid = SWISS(next_group)(ht, gid, step);
+	}
+	gid = mixed_hash & (ht->group_count - 1);
+	for (uint32_t step = 1; ; step++) {
+		/* Already touched, no allocation here. */
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_get(&ht->mtable, gid);
+		if (step == len)
+			return group;
+		swiss_overflow_add(&group->ctrl, delta);
+		gid = SWISS(next_group)(ht, gid, step);
+	}
+}
+
+/**
+ * Find the first group of the probe sequence of @a mixed_hash
+ * with a free slot.
+ * @param[out] len - number of groups visited
+ * @return mask of free slots in the group
+ */
+static inline uint64_t
+SWISS(probe_free)(struct SWISS(core) *ht, uint32_t mixed_hash,
+		  uint32_t *gid, uint32_t *len)
+{
+	*gid = mixed_hash & (ht->group_count - 1);
+	for (uint32_t step = 1; ; step++) {
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_get(&ht->mtable, *gid);
+		uint64_t mask = swiss_match_free(group->ctrl);
+		if (mask != 0) {
+			*len = step;
+			return mask;
+		}
+		/* The load factor guarantees there is a free slot. */
+		assert(step < ht->group_count);
+		*gid = SWISS(next_group)(ht, *gid, step);
+	}
+}
+
+/**
+ * Place the value from the slot @a i of the group @a gid waiting
+ * for rehash and all values it displaces.
+ */
+static inline void
+SWISS(rehash_slot)(struct SWISS(core) *ht, uint32_t gid, uint32_t i)
+{
+	struct SWISS(group) *group = (struct SWISS(group) *)
+		matras_get(&ht->mtable, gid);
+	while (swiss_ctrl_get(group->ctrl, i) == SWISS_PENDING) {
+		SWISS_DATA_TYPE value = group->slots[i].value;
+		uint32_t mixed_hash = swiss_mix(SWISS_HASH((value), (ht->arg)));
+		uint32_t target_gid, len;
+		uint64_t mask = SWISS(probe_free)(ht, mixed_hash,
+						  &target_gid, &len);
+		struct SWISS(group) *target = SWISS(touch_path)(ht, mixed_hash,
+								len, 1);
+		assert(target != NULL);
+		uint8_t tag = swiss_tag(mixed_hash);
+		if (target_gid == gid) {
+			/* Already in the right group. */
+			swiss_ctrl_set(&group->ctrl, i, tag);
+			return;
+		}
+		uint32_t j = swiss_mask_first(mask);
+		uint8_t byte = swiss_ctrl_get(target->ctrl, j);
+		swiss_ctrl_set(&target->ctrl, j, tag);
+		if (byte == SWISS_EMPTY) {
+			target->slots[j].value = value;
+			swiss_ctrl_set(&group->ctrl, i, SWISS_EMPTY);
+			return;
+		}
+		/* Swap with a pending value and rehash it. */
+		assert(byte == SWISS_PENDING);
+		group->slots[i].value = target->slots[j].value;
+		target->slots[j].value = value;
+	}
+}
+
+/*
+ * Double the number of groups and rehash all values in place.
+ * Unlike light, the table is rebuilt at once, but without memory
+ * allocations besides the new groups, and values are not
+ * compared.
+ */
+static inline int
+SWISS(grow)(struct SWISS(core) *ht)
+{
+	uint32_t old_count = ht->group_count;
+	uint32_t new_count = old_count == 0 ? 1 : old_count * 2;
+	if (new_count > SWISS_MAX_GROUP_COUNT)
+		return -1;
+	for (uint32_t gid = old_count; gid < new_count; gid++) {
+		matras_id_t id;
+		if (matras_alloc(&ht->mtable, &id) == NULL)
+			goto fail;
+		assert(id == gid);
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_touch(&ht->mtable, id);
+		if (group == NULL)
+			goto fail;
+		group->ctrl = 0;
+	}
+	/* Make sure rehash doesn't fail. */
+	for (uint32_t gid = 0; gid < old_count; gid++) {
+		if (matras_touch(&ht->mtable, gid) == NULL)
+			goto fail;
+	}
+	ht->group_count = new_count;
+	ht->table_size = new_count * SWISS_GROUP_SIZE;
+	/* Mark all values pending and reset overflow counters. */
+	for (uint32_t gid = 0; gid < old_count; gid++) {
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_get(&ht->mtable, gid);
+		group->ctrl = (group->ctrl & SWISS_HIGH_BITS) >> 7;
+	}
+	for (uint32_t gid = 0; gid < old_count; gid++) {
+		for (uint32_t i = 0; i < SWISS_GROUP_SIZE; i++)
+			SWISS(rehash_slot)(ht, gid, i);
+	}
+	return 0;
+fail:
+	while (ht->mtable.head.block_count > old_count)
+		matras_dealloc(&ht->mtable);
+	return -1;
+}
+
+/**
+ * @brief Insert a value into a hash table. The value must not be
+ *  in the table.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash of the value
+ * @param value - value to insert
+ * @return integer ID of inserted slot or swiss_end on memory error
+ */
+static inline uint32_t
+SWISS(insert)(struct SWISS(core) *ht, uint32_t hash, SWISS_DATA_TYPE value)
+{
+	if (ht->count >= ht->group_count * SWISS_MAX_LOAD &&
+	    SWISS(grow)(ht) != 0)
+		return SWISS(end);
+	hash = swiss_mix(hash);
+	uint32_t gid, len;
+	uint64_t mask = SWISS(probe_free)(ht, hash, &gid, &len);
+	struct SWISS(group) *group = SWISS(touch_path)(ht, hash, len, 1);
+	if (group == NULL)
+		return SWISS(end);
+	uint32_t i = swiss_mask_first(mask);
+	swiss_ctrl_set(&group->ctrl, i, swiss_tag(hash));
+	group->slots[i].value = value;
+	ht->count++;
+	return gid * SWISS_GROUP_SIZE + i;
+}
+
+/**
+ * @brief Delete a value from a hash table by given slot ID
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash of the value
+ * @param slotpos - ID of a slot. See SWISS(find) for details.
+ * @return 0 if ok, -1 on memory error (only with freezed iterators)
+ */
+static inline int
+SWISS(delete)(struct SWISS(core) *ht, uint32_t hash, uint32_t slotpos)
+{
+	assert(slotpos < ht->table_size);
+	hash = swiss_mix(hash);
+	uint32_t target_gid = slotpos / SWISS_GROUP_SIZE;
+	uint32_t gid = hash & (ht->group_count - 1);
+	uint32_t len = 1;
+	while (gid != target_gid) {
+		gid = SWISS(next_group)(ht, gid, len);
+		len++;
+		assert(len <= ht->group_count);
+	}
+	struct SWISS(group) *group = SWISS(touch_path)(ht, hash, len, -1);
+	if (group == NULL)
+		return -1;
+	uint32_t i = slotpos % SWISS_GROUP_SIZE;
+	assert(swiss_ctrl_get(group->ctrl, i) == swiss_tag(hash));
+	swiss_ctrl_set(&group->ctrl, i, SWISS_EMPTY);
+	ht->count--;
+	return 0;
+}
+
+/**
+ * @brief Delete a value from a hash table by that value and its hash.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash of the value
+ * @param value - value to delete
+ * @return 0 if ok, 1 if not found or -1 on memory error
+ */
+static inline int
+SWISS(delete_value)(struct SWISS(core) *ht, uint32_t hash,
+		    SWISS_DATA_TYPE value)
+{
+	uint32_t slot = SWISS(find)(ht, hash, value);
+	if (slot == SWISS(end))
+		return 1; /* not found */
+	return SWISS(delete)(ht, hash, slot);
+}
+
+/**
+ * @brief Get a value from a desired position
+ * @param ht - pointer to a hash table struct
+ * @param slotpos - ID of a slot
+ *  ID must be vaild, check it by swiss_pos_valid (asserted).
+ */
+static inline SWISS_DATA_TYPE
+SWISS(get)(struct SWISS(core) *ht, uint32_t slotpos)
+{
+	assert(slotpos < ht->table_size);
+	struct SWISS(group) *group = (struct SWISS(group) *)
+		matras_get(&ht->mtable, slotpos / SWISS_GROUP_SIZE);
+	uint32_t i = slotpos % SWISS_GROUP_SIZE;
+	assert(swiss_ctrl_get(group->ctrl, i) != SWISS_EMPTY);
+	return group->slots[i].value;
+}
+
+/**
+ * @brief Determine if posision holds a value
+ * @param ht - pointer to a hash table struct
+ * @param slotpos - ID of a slot
+ *  ID must be in valid range [0, ht->table_size) (asserted).
+ */
+static inline bool
+SWISS(pos_valid)(struct SWISS(core) *ht, uint32_t slotpos)
+{
+	assert(slotpos < ht->table_size);
+	struct SWISS(group) *group = (struct SWISS(group) *)
+		matras_get(&ht->mtable, slotpos / SWISS_GROUP_SIZE);
+	uint32_t i = slotpos % SWISS_GROUP_SIZE;
+	return swiss_ctrl_get(group->ctrl, i) != SWISS_EMPTY;
+}
+
+/**
+ * @brief Set iterator to the beginning of hash table
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to set
+ */
+static inline void
+SWISS(iterator_begin)(const struct SWISS(core) *ht,
+		      struct SWISS(iterator) *itr)
+{
+	(void)ht;
+	itr->slotpos = 0;
+	matras_head_read_view(&itr->view);
+}
+
+/**
+ * @brief Set iterator to position determined by key
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to set
+ * @param hash - hash to find
+ * @param data - key to find
+ */
+static inline void
+SWISS(iterator_key)(const struct SWISS(core) *ht, struct SWISS(iterator) *itr,
+		    uint32_t hash, SWISS_KEY_TYPE data)
+{
+	itr->slotpos = SWISS(find_key)(ht, hash, data);
+	matras_head_read_view(&itr->view);
+}
+
+/**
+ * @brief Get the value that iterator currently points to
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to set
+ * @return poiner to the value or NULL if iteration is complete
+ */
+static inline SWISS_DATA_TYPE *
+SWISS(iterator_get_and_next)(const struct SWISS(core) *ht,
+			     struct SWISS(iterator) *itr)
+{
+	const struct matras_view *view;
+	view = matras_is_read_view_created(&itr->view) ?
+	       &itr->view : &ht->mtable.head;
+	while (itr->slotpos < view->block_count * SWISS_GROUP_SIZE) {
+		uint32_t gid = itr->slotpos / SWISS_GROUP_SIZE;
+		uint32_t i = itr->slotpos % SWISS_GROUP_SIZE;
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_view_get(&ht->mtable, view, gid);
+		itr->slotpos++;
+		if (swiss_ctrl_get(group->ctrl, i) != SWISS_EMPTY)
+			return &group->slots[i].value;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Freezes state for given iterator. All following hash table modification
+ * will not apply to that iterator iteration. That iterator should be destroyed
+ * with a swiss_iterator_destroy call after usage.
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to freeze
+ */
+static inline void
+SWISS(iterator_freeze)(struct SWISS(core) *ht, struct SWISS(iterator) *itr)
+{
+	assert(!matras_is_read_view_created(&itr->view));
+	matras_create_read_view(&ht->mtable, &itr->view);
+}
+
+/**
+ * @brief Destroy an iterator that was frozen before. Useless for not frozen
+ * iterators.
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to destroy
+ */
+static inline void
+SWISS(iterator_destroy)(struct SWISS(core) *ht, struct SWISS(iterator) *itr)
+{
+	matras_destroy_read_view(&ht->mtable, &itr->view);
+}
+
+/*
+ * Selfcheck of the internal state of hash table. Used only for debugging.
+ * That means that you should not use this function.
+ * If return not zero, something went terribly wrong.
+ */
+static inline int
+SWISS(selfcheck)(const struct SWISS(core) *ht)
+{
+	int res = 0;
+	if (ht->group_count != ht->mtable.head.block_count)
+		res |= 1;
+	if (ht->table_size != ht->group_count * SWISS_GROUP_SIZE)
+		res |= 2;
+	if (ht->count > ht->group_count * SWISS_MAX_LOAD)
+		res |= 4;
+	uint32_t count = 0;
+	for (uint32_t gid = 0; gid < ht->group_count; gid++) {
+		struct SWISS(group) *group = (struct SWISS(group) *)
+			matras_get(&ht->mtable, gid);
+		for (uint32_t i = 0; i < SWISS_GROUP_SIZE; i++) {
+			uint8_t byte = swiss_ctrl_get(group->ctrl, i);
+			if (byte == SWISS_EMPTY)
+				continue;
+			count++;
+			SWISS_DATA_TYPE value = group->slots[i].value;
+			uint32_t value_hash = SWISS_HASH((value), (ht->arg));
+			if (byte != swiss_tag(swiss_mix(value_hash)))
+				res |= 8; /* wrong tag */
+			if (SWISS(find)(ht, value_hash, value) !=
+			    gid * SWISS_GROUP_SIZE + i)
+				res |= 16; /* not found */
+		}
+	}
+	if (count != ht->count)
+		res |= 32;
+	return res;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "xor_filter.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include <string.h>
+
+/** Number of padding bytes read by xor_filter_get(). */
+enum { XOR_FILTER_TABLE_PADDING = 2 };
+
+static inline size_t
+xor_filter_table_size(uint32_t block_length, uint16_t fingerprint_bits)
+{
+	uint64_t bits = (uint64_t)block_length * 3 * fingerprint_bits;
+	return (bits + 7) / 8 + XOR_FILTER_TABLE_PADDING;
+}
+
+static inline void
+xor_filter_set(struct xor_filter *filter, uint32_t slot, uint32_t value)
+{
+	uint64_t bit = (uint64_t)slot * filter->fingerprint_bits;
+	unsigned char *p = filter->table + bit / 8;
+	uint32_t shift = bit % 8;
+	uint32_t mask = ((1U << filter->fingerprint_bits) - 1) << shift;
+	uint32_t v = p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+	v = (v & ~mask) | (value << shift);
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+}
+
+static int
+xor_filter_hash_cmp(const void *a, const void *b)
+{
+	xor_filter_hash_t h1 = *(const xor_filter_hash_t *)a;
+	xor_filter_hash_t h2 = *(const xor_filter_hash_t *)b;
+	return h1 < h2 ? -1 : h1 > h2;
+}
+
+static inline uint64_t
+xor_filter_next_seed(uint64_t *state)
+{
+	/* SplitMix64 */
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/** Xor of hashes mapped to a slot and their number. */
+struct xor_filter_bucket {
+	uint64_t mask;
+	uint32_t count;
+};
+
+/** A hash assigned to a slot when peeling the hypergraph. */
+struct xor_filter_assignment {
+	uint64_t hash;
+	uint32_t slot;
+};
+
+int
+xor_filter_create(struct xor_filter *filter, const xor_filter_hash_t *hashes,
+		  uint32_t count, double false_positive_rate)
+{
+	int fingerprint_bits = ceil(-log2(false_positive_rate));
+	if (fingerprint_bits < 1)
+		fingerprint_bits = 1;
+	if (fingerprint_bits > XOR_FILTER_MAX_FINGERPRINT_BITS)
+		fingerprint_bits = XOR_FILTER_MAX_FINGERPRINT_BITS;
+
+	/*
+	 * Construction fails if the same value is added twice
+	 * so sort the hashes and remove duplicates first.
+	 */
+	xor_filter_hash_t *keys = malloc((count + 1) * sizeof(*keys));
+	if (keys == NULL)
+		return -1;
+	if (count > 0) {
+		memcpy(keys, hashes, count * sizeof(*keys));
+		qsort(keys, count, sizeof(*keys), xor_filter_hash_cmp);
+	}
+	uint32_t key_count = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (key_count == 0 || keys[key_count - 1] != keys[i])
+			keys[key_count++] = keys[i];
+	}
+
+	uint32_t capacity = 32 + ceil(1.23 * key_count);
+	uint32_t block_length = capacity / 3;
+	uint32_t slot_count = block_length * 3;
+	size_t table_size = xor_filter_table_size(block_length,
+						  fingerprint_bits);
+
+	filter->block_length = block_length;
+	filter->fingerprint_bits = fingerprint_bits;
+	filter->table = calloc(table_size, 1);
+	struct xor_filter_bucket *sets = malloc(slot_count * sizeof(*sets));
+	uint32_t *queue = malloc(slot_count * sizeof(*queue));
+	struct xor_filter_assignment *stack =
+		malloc((key_count + 1) * sizeof(*stack));
+	if (filter->table == NULL || sets == NULL ||
+	    queue == NULL || stack == NULL)
+		goto fail;
+
+	uint64_t seed_state = 1;
+	uint32_t stack_size;
+	/*
+	 * Peeling succeeds with high probability for a random
+	 * seed, retry with another one until it does.
+	 */
+	do {
+		filter->seed = xor_filter_next_seed(&seed_state);
+		memset(sets, 0, slot_count * sizeof(*sets));
+		for (uint32_t i = 0; i < key_count; i++) {
+			uint64_t h = xor_filter_mix(keys[i], filter->seed);
+			for (int b = 0; b < 3; b++) {
+				uint32_t slot = xor_filter_slot(filter, h, b);
+				sets[slot].mask ^= h;
+				sets[slot].count++;
+			}
+		}
+		uint32_t queue_size = 0;
+		for (uint32_t i = 0; i < slot_count; i++) {
+			if (sets[i].count == 1)
+				queue[queue_size++] = i;
+		}
+		stack_size = 0;
+		while (queue_size > 0) {
+			uint32_t slot = queue[--queue_size];
+			if (sets[slot].count != 1)
+				continue;
+			uint64_t h = sets[slot].mask;
+			stack[stack_size].hash = h;
+			stack[stack_size].slot = slot;
+			stack_size++;
+			for (int b = 0; b < 3; b++) {
+				uint32_t s = xor_filter_slot(filter, h, b);
+				sets[s].mask ^= h;
+				if (--sets[s].count == 1)
+					queue[queue_size++] = s;
+			}
+		}
+	} while (stack_size < key_count);
+
+	/*
+	 * Assign fingerprints in the reverse peeling order so that
+	 * the fingerprints of the three slots of each value xor to
+	 * the value fingerprint.
+	 */
+	for (uint32_t i = stack_size; i-- > 0; ) {
+		uint64_t h = stack[i].hash;
+		uint32_t f = xor_filter_fingerprint(filter, h);
+		f ^= xor_filter_get(filter, xor_filter_slot(filter, h, 0));
+		f ^= xor_filter_get(filter, xor_filter_slot(filter, h, 1));
+		f ^= xor_filter_get(filter, xor_filter_slot(filter, h, 2));
+		xor_filter_set(filter, stack[i].slot, f);
+	}
+	free(stack);
+	free(queue);
+	free(sets);
+	free(keys);
+	return 0;
+fail:
+	free(stack);
+	free(queue);
+	free(sets);
+	free(keys);
+	free(filter->table);
+	filter->table = NULL;
+	return -1;
+}
+
+void
+xor_filter_destroy(struct xor_filter *filter)
+{
+	free(filter->table);
+}
+
+double
+xor_filter_fpr(const struct xor_filter *filter)
+{
+	return ldexp(1, -filter->fingerprint_bits);
+}
+
+size_t
+xor_filter_store_size(const struct xor_filter *filter)
+{
+	return xor_filter_table_size(filter->block_length,
+				     filter->fingerprint_bits);
+}
+
+char *
+xor_filter_store(const struct xor_filter *filter, char *table)
+{
+	size_t store_size = xor_filter_store_size(filter);
+	memcpy(table, filter->table, store_size);
+	return table + store_size;
+}
+
+int
+xor_filter_load_table(struct xor_filter *filter, const char *table)
+{
+	size_t size = xor_filter_store_size(filter);
+	filter->table = malloc(size);
+	if (filter->table == NULL)
+		return -1;
+	memcpy(filter->table, table, size);
+	return 0;
+}
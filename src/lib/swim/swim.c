@@ -186,6 +186,11 @@ enum {
 	 * members.
 	 */
 	INDIRECT_PING_COUNT = 2,
+	/**
+	 * Upper bound of the local health score, see
+	 * struct swim::health.
+	 */
+	HEALTH_MAX = 8,
 };
 
 /**
@@ -498,6 +503,19 @@ struct swim {
 	struct ev_timer wait_ack_tick;
 	/** GC state saying how to remove dead members. */
 	enum swim_gc_mode gc_mode;
+	/**
+	 * Local health score, from 0 to HEALTH_MAX, as described
+	 * by Lifeguard extension of SWIM. The bigger it is, the
+	 * more likely this instance itself is slow or its network
+	 * is in trouble rather than the members it pings. It is
+	 * incremented each time a member suspected by this
+	 * instance turns out to be alive, and on each refutation
+	 * of gossips about this instance. Decremented on each
+	 * other received ack. Ack timeout is multiplied by
+	 * (health + 1), so an overloaded instance does not flood
+	 * the cluster with false suspicions.
+	 */
+	int health;
 	/**
 	 * Generation of that instance is set when the latter is
 	 * created. It is actual only until the instance is
@@ -570,7 +588,8 @@ swim_wait_ack(struct swim *swim, struct swim_member *member,
 	      bool was_ping_indirect)
 {
 	if (heap_node_is_stray(&member->in_wait_ack_heap)) {
-		double timeout = swim->wait_ack_tick.repeat;
+		double timeout = swim->wait_ack_tick.repeat *
+				 (swim->health + 1);
 		/*
 		 * Direct ping is two trips: PING + ACK.
 		 * Indirect ping is four trips: PING,
@@ -664,6 +683,22 @@ swim_has_pending_events(struct swim *swim)
 	return ! stailq_empty(&swim->event_queue);
 }
 
+/** Increment local health score, see struct swim::health. */
+static inline void
+swim_health_worsen(struct swim *swim)
+{
+	if (swim->health < HEALTH_MAX)
+		++swim->health;
+}
+
+/** Decrement local health score, see struct swim::health. */
+static inline void
+swim_health_improve(struct swim *swim)
+{
+	if (swim->health > 0)
+		--swim->health;
+}
+
 /**
  * Update status and incarnation of the member if needed. Statuses
  * are compared as a compound key: {incarnation, status}. So @a
@@ -1127,11 +1162,16 @@ swim_encode_failure_detection(struct swim *swim, struct swim_packet *packet,
 }
 
 /**
- * Encode dissemination component.
+ * Encode dissemination component. If the message addressee is
+ * suspected, its own record goes first regardless of the
+ * dissemination queue, so it learns about the suspicion and
+ * refutes it as soon as possible. It is called buddy system in
+ * Lifeguard.
  * @retval Number of key-values added to the packet's root map.
  */
 static int
-swim_encode_dissemination(struct swim *swim, struct swim_packet *packet)
+swim_encode_dissemination(struct swim *swim, struct swim_packet *packet,
+			  struct swim_member *addressee)
 {
 	struct swim_diss_header_bin diss_header_bin;
 	struct swim_member_payload_bin payload_header;
@@ -1142,9 +1182,18 @@ swim_encode_dissemination(struct swim *swim, struct swim_packet *packet)
 	swim_passport_bin_create(&passport_bin);
 	swim_member_payload_bin_create(&payload_header);
 	int i = 0;
+	if (addressee != NULL && addressee->status == MEMBER_SUSPECTED) {
+		if (swim_encode_member(packet, addressee, &passport_bin,
+				       &payload_header, false) == 0)
+			++i;
+		else
+			addressee = NULL;
+	}
 	struct swim_member *m;
 	rlist_foreach_entry(m, &swim->dissemination_queue,
 			    in_dissemination_queue) {
+		if (m == addressee)
+			continue;
 		if (swim_encode_member(packet, m, &passport_bin,
 				       &payload_header,
 				       m->payload_ttd > 0) != 0)
@@ -1156,10 +1205,13 @@ swim_encode_dissemination(struct swim *swim, struct swim_packet *packet)
 	return 1;
 }
 
-/** Encode SWIM components into a UDP packet. */
+/**
+ * Encode SWIM components into a UDP packet. @a addressee is the
+ * member the packet is sent to, if known.
+ */
 static void
 swim_encode_msg(struct swim *swim, struct swim_packet *packet,
-		enum swim_fd_msg_type fd_type)
+		enum swim_fd_msg_type fd_type, struct swim_member *addressee)
 {
 	char *header = swim_packet_alloc(packet, 1);
 	int map_size = 0;
@@ -1169,7 +1221,7 @@ swim_encode_msg(struct swim *swim, struct swim_packet *packet,
 		mp_encode_map(header, map_size);
 		return;
 	});
-	map_size += swim_encode_dissemination(swim, packet);
+	map_size += swim_encode_dissemination(swim, packet, addressee);
 	map_size += swim_encode_anti_entropy(swim, packet);
 
 	assert(mp_sizeof_map(map_size) == 1 && map_size >= 2);
@@ -1241,12 +1293,12 @@ swim_begin_step(struct ev_loop *loop, struct ev_timer *t, int events)
 		swim_ev_timer_stop(loop, t);
 		return;
 	}
-	struct swim_packet *packet = &swim->round_step_task.packet;
-	swim_packet_create(packet);
-	swim_encode_msg(swim, packet, SWIM_FD_MSG_PING);
 	struct swim_member *m =
 		rlist_first_entry(&swim->round_queue, struct swim_member,
 				  in_round_queue);
+	struct swim_packet *packet = &swim->round_step_task.packet;
+	swim_packet_create(packet);
+	swim_encode_msg(swim, packet, SWIM_FD_MSG_PING, m);
 	swim_task_send(&swim->round_step_task, &m->addr, &swim->scheduler);
 }
 
@@ -1289,11 +1341,14 @@ swim_complete_step(struct swim_task *task,
 	}
 }
 
-/** Schedule send of a failure detection message. */
+/**
+ * Schedule send of a failure detection message. @a addressee is
+ * the member the message is sent to, if known.
+ */
 static void
 swim_send_fd_msg(struct swim *swim, struct swim_task *task,
 		 const struct sockaddr_in *dst, enum swim_fd_msg_type type,
-		 const struct sockaddr_in *proxy)
+		 const struct sockaddr_in *proxy, struct swim_member *addressee)
 {
 	/*
 	 * Reset packet allocator in case if task is being reused.
@@ -1302,7 +1357,7 @@ swim_send_fd_msg(struct swim *swim, struct swim_task *task,
 	swim_packet_create(&task->packet);
 	if (proxy != NULL)
 		swim_task_set_proxy(task, proxy);
-	swim_encode_msg(swim, &task->packet, type);
+	swim_encode_msg(swim, &task->packet, type, addressee);
 	say_verbose("SWIM %d: schedule %s to %s", swim_fd(swim),
 		    swim_fd_msg_type_strs[type], swim_inaddr_str(dst));
 	swim_task_send(task, dst, &swim->scheduler);
@@ -1313,7 +1368,7 @@ static inline void
 swim_send_ack(struct swim *swim, struct swim_task *task,
 	      const struct sockaddr_in *dst)
 {
-	swim_send_fd_msg(swim, task, dst, SWIM_FD_MSG_ACK, NULL);
+	swim_send_fd_msg(swim, task, dst, SWIM_FD_MSG_ACK, NULL, NULL);
 }
 
 /**
@@ -1331,7 +1386,7 @@ swim_send_indirect_ack(struct swim *swim, const struct sockaddr_in *dst,
 			      "indirect ack");
 	if (task == NULL)
 		return -1;
-	swim_send_fd_msg(swim, task, dst, SWIM_FD_MSG_ACK, proxy);
+	swim_send_fd_msg(swim, task, dst, SWIM_FD_MSG_ACK, proxy, NULL);
 	return 0;
 }
 
@@ -1340,7 +1395,7 @@ static inline void
 swim_send_ping(struct swim *swim, struct swim_task *task,
 	       const struct sockaddr_in *dst)
 {
-	swim_send_fd_msg(swim, task, dst, SWIM_FD_MSG_PING, NULL);
+	swim_send_fd_msg(swim, task, dst, SWIM_FD_MSG_PING, NULL, NULL);
 }
 
 /** Indirect ping task completion callback. */
@@ -1376,7 +1431,7 @@ finish:
  * to the suspected member via them in parallel.
  */
 static inline int
-swim_send_indirect_pings(struct swim *swim, const struct swim_member *dst)
+swim_send_indirect_pings(struct swim *swim, struct swim_member *dst)
 {
 	struct mh_swim_table_t *t = swim->members;
 	int member_count = mh_size(t);
@@ -1400,7 +1455,7 @@ swim_send_indirect_pings(struct swim *swim, const struct swim_member *dst)
 			t->uuid = dst->uuid;
 			swim_task_set_proxy(t, &m->addr);
 			swim_send_fd_msg(swim, t, &dst->addr, SWIM_FD_MSG_PING,
-					 &m->addr);
+					 &m->addr, dst);
 		}
 		/*
 		 * First random member could be chosen too close
@@ -1465,7 +1520,8 @@ swim_check_acks(struct ev_loop *loop, struct ev_timer *t, int events)
 					     "ping");
 		if (m->ping_task != NULL) {
 			m->ping_task->member = m;
-			swim_send_ping(swim, m->ping_task, &m->addr);
+			swim_send_fd_msg(swim, m->ping_task, &m->addr,
+					 SWIM_FD_MSG_PING, NULL, m);
 		} else {
 			diag_log();
 		}
@@ -1612,6 +1668,11 @@ swim_upsert_member(struct swim *swim, const struct swim_member_def *def,
 		 */
 		self->incarnation.version++;
 		swim_on_member_update(swim, self, SWIM_EV_NEW_VERSION);
+		/*
+		 * Others failed to get acks from this instance
+		 * in time, likely it is slow itself.
+		 */
+		swim_health_worsen(swim);
 	}
 	return 0;
 skip:
@@ -1691,6 +1752,7 @@ swim_process_failure_detection(struct swim *swim, const char **pos,
 	 */
 	if (member == NULL)
 		return 0;
+	bool was_suspected = member->status == MEMBER_SUSPECTED;
 	/*
 	 * It is well known fact, that SWIM compares statuses as
 	 * compound keys {incarnation, status}. If inc1 == inc2,
@@ -1726,6 +1788,14 @@ swim_process_failure_detection(struct swim *swim, const char **pos,
 		break;
 	case SWIM_FD_MSG_ACK:
 		member->unacknowledged_pings = 0;
+		/*
+		 * A false suspicion means the acks were too slow
+		 * to arrive, likely because of this instance.
+		 */
+		if (was_suspected)
+			swim_health_worsen(swim);
+		else
+			swim_health_improve(swim);
 		if (! heap_node_is_stray(&member->in_wait_ack_heap))
 			wait_ack_heap_delete(&swim->wait_ack_heap, member);
 		break;
@@ -2129,6 +2199,14 @@ swim_set_payload(struct swim *swim, const char *payload, int payload_size)
 		return -1;
 	}
 	struct swim_member *self = swim->self;
+	/*
+	 * Applications tend to set the same payload periodically.
+	 * Do not make the whole cluster disseminate it again.
+	 */
+	if (payload_size == self->payload_size &&
+	    (payload_size == 0 ||
+	     memcmp(payload, self->payload, payload_size) == 0))
+		return 0;
 	if (swim_update_member_payload(swim, self, payload, payload_size) != 0)
 		return -1;
 	self->incarnation.version++;
@@ -343,13 +343,23 @@ swim_scheduler_fd(const struct swim_scheduler *scheduler)
 	return scheduler->transport.fd;
 }
 
+static void
+swim_on_output(struct ev_loop *loop, struct ev_io *io, int events);
+
+static void
+swim_on_input(struct ev_loop *loop, struct ev_io *io, int events);
+
 void
 swim_scheduler_create(struct swim_scheduler *scheduler,
 		      swim_scheduler_on_input_f on_input)
 {
 	scheduler->output.data = (void *) scheduler;
 	scheduler->input.data = (void *) scheduler;
+	swim_ev_set_cb(&scheduler->output, swim_on_output);
+	swim_ev_set_cb(&scheduler->input, swim_on_input);
 	rlist_create(&scheduler->queue_output);
+	rlist_create(&scheduler->queue_sent);
+	scheduler->is_destroyed = NULL;
 	scheduler->on_input = on_input;
 	swim_transport_create(&scheduler->transport);
 	scheduler->codec = NULL;
@@ -399,6 +409,13 @@ swim_scheduler_destroy(struct swim_scheduler *scheduler)
 		if (t->cancel != NULL)
 			t->cancel(t, scheduler, -1);
 	}
+	rlist_foreach_entry_safe(t, &scheduler->queue_sent, in_queue_output,
+				 tmp) {
+		if (t->cancel != NULL)
+			t->cancel(t, scheduler, -1);
+	}
+	if (scheduler->is_destroyed != NULL)
+		*scheduler->is_destroyed = true;
 	swim_transport_destroy(&scheduler->transport);
 	swim_ev_io_stop(swim_loop(), &scheduler->output);
 	swim_scheduler_stop_input(scheduler);
@@ -444,60 +461,24 @@ swim_decrypt(struct crypto_codec *c, const char *in, int in_size,
 }
 
 /**
- * Begin packet transmission. Prepare a next task in the queue to
- * send its packet: build a meta header, pop the task from the
- * queue.
- * @param scheduler Scheduler to pop a task from.
- * @param loop Event loop passed by libev.
- * @param io Descriptor to send to.
- * @param events Mask of happened events passed by libev.
- * @param[out] dst Destination address to send the packet to. Can
- *        be different from task.dst, for example, if task.proxy
- *        is specified.
+ * Prepare a task to be sent: build a meta header.
+ * @param scheduler Scheduler owning @a task.
+ * @param task Task to prepare.
  *
- * @retval NULL The queue is empty. Input has been stopped.
- * @retval not NULL A task ready to be sent.
+ * @return Destination address to send the packet to. Can be
+ *         different from task.dst, for example, if task.proxy is
+ *         specified.
  */
-static struct swim_task *
-swim_begin_send(struct swim_scheduler *scheduler, struct ev_loop *loop,
-		struct ev_io *io, int events, const struct sockaddr_in **dst)
+static const struct sockaddr_in *
+swim_begin_send(struct swim_scheduler *scheduler, struct swim_task *task)
 {
-	assert((events & EV_WRITE) != 0);
-	(void) events;
-	if (rlist_empty(&scheduler->queue_output)) {
-		/*
-		 * Possible, if a member pushed a task and then
-		 * was deleted together with it.
-		 */
-		swim_ev_io_stop(loop, io);
-		return NULL;
-	}
-	struct swim_task *task =
-		rlist_shift_entry(&scheduler->queue_output, struct swim_task,
-				  in_queue_output);
 	const struct sockaddr_in *src = &scheduler->transport.addr;
-	const char *dst_str = swim_inaddr_str(&task->dst);
 	if (! swim_inaddr_is_empty(&task->proxy)) {
-		*dst = &task->proxy;
-		dst_str = tt_sprintf("%s via %s", dst_str,
-				     swim_inaddr_str(*dst));
 		swim_packet_build_meta(&task->packet, src, src, &task->dst);
-	} else {
-		*dst = &task->dst;
-		swim_packet_build_meta(&task->packet, src, NULL, NULL);
+		return &task->proxy;
 	}
-	say_verbose("SWIM %d: send %s to %s", swim_scheduler_fd(scheduler),
-		    task->desc, dst_str);
-	return task;
-}
-
-/** Send a packet into the network. */
-static inline ssize_t
-swim_do_send(struct swim_scheduler *scheduler, const char *buf, int size,
-	     const struct sockaddr_in *dst)
-{
-	return swim_transport_send(&scheduler->transport, buf, size,
-				   (const struct sockaddr *) dst, sizeof(*dst));
+	swim_packet_build_meta(&task->packet, src, NULL, NULL);
+	return &task->dst;
 }
 
 /**
@@ -510,80 +491,97 @@ static inline void
 swim_complete_send(struct swim_scheduler *scheduler, struct swim_task *task,
 		   ssize_t size)
 {
-	if (size < 0)
+	if (size < 0) {
 		diag_log();
+	} else if (say_log_level_is_enabled(S_VERBOSE)) {
+		const char *dst_str = swim_inaddr_str(&task->dst);
+		if (! swim_inaddr_is_empty(&task->proxy)) {
+			dst_str = tt_sprintf("%s via %s", dst_str,
+					     swim_inaddr_str(&task->proxy));
+		}
+		say_verbose("SWIM %d: send %s to %s",
+			    swim_scheduler_fd(scheduler), task->desc, dst_str);
+	}
 	if (task->complete != NULL)
 		task->complete(task, scheduler, size);
 }
 
 /**
- * On a new EV_WRITE event send a next packet from the queue
- * encrypted with the currently chosen algorithm.
+ * On a new EV_WRITE event send a batch of packets from the head
+ * of the queue, encrypted with the currently chosen algorithm if
+ * there is one. The sent tasks are moved to a separate queue and
+ * completed one by one, because a completion callback can delete
+ * other tasks, or even the scheduler.
  */
 static void
-swim_on_encrypted_output(struct ev_loop *loop, struct ev_io *io, int events)
+swim_on_output(struct ev_loop *loop, struct ev_io *io, int events)
 {
+	assert((events & EV_WRITE) != 0);
+	(void) events;
 	struct swim_scheduler *scheduler = (struct swim_scheduler *) io->data;
-	const struct sockaddr_in *dst;
-	struct swim_task *task = swim_begin_send(scheduler, loop, io, events,
-						 &dst);
-	if (task == NULL)
+	if (rlist_empty(&scheduler->queue_output)) {
+		/*
+		 * Possible, if a member pushed a task and then
+		 * was deleted together with it.
+		 */
+		swim_ev_io_stop(loop, io);
 		return;
-	char *buf = static_alloc(UDP_PACKET_SIZE);
-	assert(buf != NULL);
-	ssize_t size = swim_encrypt(scheduler->codec, task->packet.buf,
-				    task->packet.pos - task->packet.buf,
-				    buf, UDP_PACKET_SIZE);
-	if (size > 0)
-		size = swim_do_send(scheduler, buf, size, dst);
-	swim_complete_send(scheduler, task, size);
-}
-
-/**
- * On a new EV_WRITE event send a next packet without encryption.
- */
-static void
-swim_on_plain_output(struct ev_loop *loop, struct ev_io *io, int events)
-{
-	struct swim_scheduler *scheduler = (struct swim_scheduler *) io->data;
-	const struct sockaddr_in *dst;
-	struct swim_task *task = swim_begin_send(scheduler, loop, io, events,
-						 &dst);
-	if (task == NULL)
+	}
+	struct swim_transport_msg msgs[SWIM_TRANSPORT_BATCH_MAX];
+	/*
+	 * Encrypted packets are stored on stack, because static
+	 * memory is too small to keep the whole batch.
+	 */
+	char bufs[SWIM_TRANSPORT_BATCH_MAX][UDP_PACKET_SIZE];
+	int count = 0;
+	struct swim_task *task;
+	rlist_foreach_entry(task, &scheduler->queue_output, in_queue_output) {
+		if (count == SWIM_TRANSPORT_BATCH_MAX)
+			break;
+		struct swim_transport_msg *msg = &msgs[count];
+		msg->addr = *swim_begin_send(scheduler, task);
+		msg->data = task->packet.buf;
+		msg->size = task->packet.pos - task->packet.buf;
+		if (scheduler->codec != NULL) {
+			int size = swim_encrypt(scheduler->codec, msg->data,
+						msg->size, bufs[count],
+						UDP_PACKET_SIZE);
+			if (size < 0)
+				break;
+			msg->data = bufs[count];
+			msg->size = size;
+		}
+		++count;
+	}
+	/* Encryption of the first packet could fail. */
+	int rc = -1;
+	if (count > 0) {
+		rc = swim_transport_send_batch(&scheduler->transport, msgs,
+					       count);
+	}
+	if (rc <= 0) {
+		task = rlist_shift_entry(&scheduler->queue_output,
+					 struct swim_task, in_queue_output);
+		swim_complete_send(scheduler, task, rc);
 		return;
-	ssize_t size = swim_do_send(scheduler, task->packet.buf,
-				    task->packet.pos - task->packet.buf, dst);
-	swim_complete_send(scheduler, task, size);
-}
-
-/**
- * Begin packet receipt. Note, this function is no-op, and exists
- * just for consistency with begin/do/complete_send() functions.
- */
-static inline void
-swim_begin_recv(struct swim_scheduler *scheduler, struct ev_loop *loop,
-		struct ev_io *io, int events)
-{
-	assert((events & EV_READ) != 0);
-	(void) io;
-	(void) scheduler;
-	(void) events;
-	(void) loop;
-}
-
-/** Receive a packet from the network. */
-static ssize_t
-swim_do_recv(struct swim_scheduler *scheduler, char *buf, int size)
-{
-	struct sockaddr_in src;
-	socklen_t len = sizeof(src);
-	ssize_t rc = swim_transport_recv(&scheduler->transport, buf, size,
-					 (struct sockaddr *) &src, &len);
-	if (rc <= 0)
-		return rc;
-	say_verbose("SWIM %d: received from %s", swim_scheduler_fd(scheduler),
-		    swim_inaddr_str(&src));
-	return rc;
+	}
+	for (int i = 0; i < rc; ++i) {
+		task = rlist_shift_entry(&scheduler->queue_output,
+					 struct swim_task, in_queue_output);
+		rlist_add_tail_entry(&scheduler->queue_sent, task,
+				     in_queue_output);
+	}
+	bool is_destroyed = false;
+	scheduler->is_destroyed = &is_destroyed;
+	while (! rlist_empty(&scheduler->queue_sent)) {
+		task = rlist_shift_entry(&scheduler->queue_sent,
+					 struct swim_task, in_queue_output);
+		swim_complete_send(scheduler, task,
+				   task->packet.pos - task->packet.buf);
+		if (is_destroyed)
+			return;
+	}
+	scheduler->is_destroyed = NULL;
 }
 
 /**
@@ -647,40 +645,47 @@ error:
 }
 
 /**
- * On a new EV_READ event receive an encrypted packet from the
- * network.
+ * On a new EV_READ event receive a batch of packets from the
+ * network and decrypt them if a codec is set.
  */
 static void
-swim_on_encrypted_input(struct ev_loop *loop, struct ev_io *io, int events)
+swim_on_input(struct ev_loop *loop, struct ev_io *io, int events)
 {
+	assert((events & EV_READ) != 0);
+	(void) events;
+	(void) loop;
 	struct swim_scheduler *scheduler = (struct swim_scheduler *) io->data;
 	/*
-	 * Buffer for decrypted data is on stack, not on static
-	 * memory, because the SWIM code uses static memory as
-	 * well and can accidentally rewrite the packet data.
+	 * Buffers are on stack, not on static memory, because the
+	 * SWIM code uses static memory as well and can
+	 * accidentally rewrite the packet data.
 	 */
+	char bufs[SWIM_TRANSPORT_BATCH_MAX][UDP_PACKET_SIZE];
 	char buf[UDP_PACKET_SIZE];
-	swim_begin_recv(scheduler, loop, io, events);
-
-	char *ibuf = static_alloc(UDP_PACKET_SIZE);
-	assert(ibuf != NULL);
-	ssize_t size = swim_do_recv(scheduler, ibuf, UDP_PACKET_SIZE);
-	if (size > 0) {
-		size = swim_decrypt(scheduler->codec, ibuf, size,
-				    buf, UDP_PACKET_SIZE);
+	struct swim_transport_msg msgs[SWIM_TRANSPORT_BATCH_MAX];
+	for (int i = 0; i < SWIM_TRANSPORT_BATCH_MAX; ++i) {
+		msgs[i].data = bufs[i];
+		msgs[i].size = UDP_PACKET_SIZE;
+	}
+	int count = swim_transport_recv_batch(&scheduler->transport, msgs,
+					      SWIM_TRANSPORT_BATCH_MAX);
+	if (count < 0) {
+		diag_log();
+		return;
+	}
+	for (int i = 0; i < count; ++i) {
+		say_verbose("SWIM %d: received from %s",
+			    swim_scheduler_fd(scheduler),
+			    swim_inaddr_str(&msgs[i].addr));
+		const char *data = msgs[i].data;
+		ssize_t size = msgs[i].size;
+		if (scheduler->codec != NULL && size > 0) {
+			size = swim_decrypt(scheduler->codec, data, size, buf,
+					    UDP_PACKET_SIZE);
+			data = buf;
+		}
+		swim_complete_recv(scheduler, data, size);
 	}
-	swim_complete_recv(scheduler, buf, size);
-}
-
-/** On a new EV_READ event receive a packet from the network. */
-static void
-swim_on_plain_input(struct ev_loop *loop, struct ev_io *io, int events)
-{
-	struct swim_scheduler *scheduler = (struct swim_scheduler *) io->data;
-	char buf[UDP_PACKET_SIZE];
-	swim_begin_recv(scheduler, loop, io, events);
-	ssize_t size = swim_do_recv(scheduler, buf, UDP_PACKET_SIZE);
-	swim_complete_recv(scheduler, buf, size);
 }
 
 int
@@ -693,8 +698,6 @@ swim_scheduler_set_codec(struct swim_scheduler *scheduler,
 			crypto_codec_delete(scheduler->codec);
 			scheduler->codec = NULL;
 		}
-		swim_ev_set_cb(&scheduler->output, swim_on_plain_output);
-		swim_ev_set_cb(&scheduler->input, swim_on_plain_input);
 		return 0;
 	}
 	struct crypto_codec *newc = crypto_codec_new(algo, mode, key, key_size);
@@ -703,8 +706,6 @@ swim_scheduler_set_codec(struct swim_scheduler *scheduler,
 	if (scheduler->codec != NULL)
 		crypto_codec_delete(scheduler->codec);
 	scheduler->codec = newc;
-	swim_ev_set_cb(&scheduler->output, swim_on_encrypted_output);
-	swim_ev_set_cb(&scheduler->input, swim_on_encrypted_input);
 	return 0;
 }
 
@@ -183,6 +183,17 @@ struct swim_scheduler {
 	struct ev_io output;
 	/** Queue of output tasks ready to write now. */
 	struct rlist queue_output;
+	/**
+	 * Tasks sent by the current output batch, but not
+	 * completed yet.
+	 */
+	struct rlist queue_sent;
+	/**
+	 * Flag on stack of the handler processing a batch. It is
+	 * set on destruction, because a task completion can
+	 * destroy the scheduler.
+	 */
+	bool *is_destroyed;
 };
 
 /** Initialize scheduler. */
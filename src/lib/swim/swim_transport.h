@@ -54,14 +54,46 @@ struct swim_transport {
  * corresponding system calls, working with UDP sockets.
  */
 
-ssize_t
-swim_transport_send(struct swim_transport *transport, const void *data,
-		    size_t size, const struct sockaddr *addr,
-		    socklen_t addr_size);
+enum {
+	/**
+	 * Maximal number of datagrams sent or received by one
+	 * batch call.
+	 */
+	SWIM_TRANSPORT_BATCH_MAX = 16,
+};
+
+/** A datagram to send, or a buffer to receive one into. */
+struct swim_transport_msg {
+	/** Datagram body, or a buffer for it. */
+	void *data;
+	/**
+	 * Body size, or the buffer capacity. Receipt updates it
+	 * to the real size of the datagram.
+	 */
+	size_t size;
+	/** Destination address, or source of a received one. */
+	struct sockaddr_in addr;
+};
 
-ssize_t
-swim_transport_recv(struct swim_transport *transport, void *buffer, size_t size,
-		    struct sockaddr *addr, socklen_t *addr_size);
+/**
+ * Send up to @a count datagrams. The server implementation does
+ * it in one system call, when the platform has sendmmsg().
+ * @retval >0 Number of sent datagrams. They are always the first
+ *         ones in @a msgs.
+ * @retval 0 The socket is not ready for write.
+ * @retval -1 The first datagram was not sent, diag is set.
+ */
+int
+swim_transport_send_batch(struct swim_transport *transport,
+			  struct swim_transport_msg *msgs, int count);
+
+/**
+ * Receive up to @a count datagrams, using recvmmsg() when it is
+ * available. Return values are the same as for the sending.
+ */
+int
+swim_transport_recv_batch(struct swim_transport *transport,
+			  struct swim_transport_msg *msgs, int count);
 
 /**
  * Bind @a transport to a new address. The old socket, if exists,
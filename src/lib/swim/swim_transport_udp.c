@@ -29,31 +29,92 @@
  * SUCH DAMAGE.
  */
 #include "swim_transport.h"
+#include "trivia/config.h"
 #include "evio.h"
 #include "diag.h"
 #include <ifaddrs.h>
 #include <net/if.h>
+#include <sys/socket.h>
+#include <string.h>
 
-ssize_t
-swim_transport_send(struct swim_transport *transport, const void *data,
-		    size_t size, const struct sockaddr *addr,
-		    socklen_t addr_size)
+#if defined(HAVE_SENDMMSG) || defined(HAVE_RECVMMSG)
+
+/** Fill system message headers to point at @a msgs. */
+static void
+swim_transport_fill_mmsg(struct mmsghdr *mmsg, struct iovec *iov,
+			 struct swim_transport_msg *msgs, int count)
 {
-	ssize_t ret = sio_sendto(transport->fd, data, size, 0, addr, addr_size);
-	if (ret == -1 && sio_wouldblock(errno))
-		return 0;
-	return ret;
+	memset(mmsg, 0, sizeof(*mmsg) * count);
+	for (int i = 0; i < count; ++i) {
+		iov[i].iov_base = msgs[i].data;
+		iov[i].iov_len = msgs[i].size;
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+		mmsg[i].msg_hdr.msg_name = &msgs[i].addr;
+		mmsg[i].msg_hdr.msg_namelen = sizeof(msgs[i].addr);
+	}
 }
 
-ssize_t
-swim_transport_recv(struct swim_transport *transport, void *buffer, size_t size,
-		    struct sockaddr *addr, socklen_t *addr_size)
+#endif
+
+int
+swim_transport_send_batch(struct swim_transport *transport,
+			  struct swim_transport_msg *msgs, int count)
 {
-	ssize_t ret = sio_recvfrom(transport->fd, buffer, size, 0, addr,
-				   addr_size);
-	if (ret == -1 && sio_wouldblock(errno))
+	assert(count > 0 && count <= SWIM_TRANSPORT_BATCH_MAX);
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr mmsg[SWIM_TRANSPORT_BATCH_MAX];
+	struct iovec iov[SWIM_TRANSPORT_BATCH_MAX];
+	swim_transport_fill_mmsg(mmsg, iov, msgs, count);
+	int rc = sendmmsg(transport->fd, mmsg, count, 0);
+	if (rc >= 0)
+		return rc;
+	if (sio_wouldblock(errno))
 		return 0;
-	return ret;
+	diag_set(SocketError, sio_socketname(transport->fd),
+		 "sendmmsg(%d)", count);
+	return -1;
+#else
+	(void) count;
+	ssize_t rc = sio_sendto(transport->fd, msgs->data, msgs->size, 0,
+				(const struct sockaddr *) &msgs->addr,
+				sizeof(msgs->addr));
+	if (rc >= 0)
+		return 1;
+	return sio_wouldblock(errno) ? 0 : -1;
+#endif
+}
+
+int
+swim_transport_recv_batch(struct swim_transport *transport,
+			  struct swim_transport_msg *msgs, int count)
+{
+	assert(count > 0 && count <= SWIM_TRANSPORT_BATCH_MAX);
+#ifdef HAVE_RECVMMSG
+	struct mmsghdr mmsg[SWIM_TRANSPORT_BATCH_MAX];
+	struct iovec iov[SWIM_TRANSPORT_BATCH_MAX];
+	swim_transport_fill_mmsg(mmsg, iov, msgs, count);
+	int rc = recvmmsg(transport->fd, mmsg, count, 0, NULL);
+	if (rc < 0) {
+		if (sio_wouldblock(errno))
+			return 0;
+		diag_set(SocketError, sio_socketname(transport->fd),
+			 "recvmmsg(%d)", count);
+		return -1;
+	}
+	for (int i = 0; i < rc; ++i)
+		msgs[i].size = mmsg[i].msg_len;
+	return rc;
+#else
+	(void) count;
+	socklen_t addr_size = sizeof(msgs->addr);
+	ssize_t rc = sio_recvfrom(transport->fd, msgs->data, msgs->size, 0,
+				  (struct sockaddr *) &msgs->addr, &addr_size);
+	if (rc < 0)
+		return sio_wouldblock(errno) ? 0 : -1;
+	msgs->size = rc;
+	return 1;
+#endif
 }
 
 int
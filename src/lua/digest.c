@@ -32,14 +32,24 @@
 #include <string.h>
 #include <lua/digest.h>
 #include <third_party/sha1.h>
+#include <third_party/PMurHash.h>
 #include <openssl/evp.h>
 #include <coio_task.h>
 #include <lua.h>
 #include <lauxlib.h>
+#include "crc32.h"
 #include "utils.h"
 
 #define PBKDF2_MAX_DIGEST_SIZE 128
 
+/** Inputs of at least this size are hashed in a coio thread. */
+#define DIGEST_COIO_THRESHOLD (64 * 1024)
+
+/** Initial value of CRC32, @sa digest.crc32. */
+#define DIGEST_CRC32_BEGIN 0xFFFFFFFFU
+/** Default seed of MurmurHash, @sa digest.murmur. */
+#define DIGEST_MURMUR_SEED 13
+
 unsigned char *
 SHA1internal(const unsigned char *d, size_t n, unsigned char *md)
 {
@@ -90,11 +100,139 @@ lua_pbkdf2(lua_State *L)
 	return 1;
 }
 
+static ssize_t
+digest_evp_f(va_list ap)
+{
+	const EVP_MD *md = va_arg(ap, const EVP_MD *);
+	const char *data = va_arg(ap, const char *);
+	size_t size = va_arg(ap, size_t);
+	unsigned char *digest = va_arg(ap, unsigned char *);
+	unsigned int *digest_len = va_arg(ap, unsigned int *);
+	if (EVP_Digest(data, size, digest, digest_len, md, NULL) != 1)
+		return -1;
+	return 0;
+}
+
+/**
+ * evp(name, str) computes an OpenSSL digest of a string. Large
+ * strings are hashed in a coio thread, so the call may yield.
+ */
+static int
+lua_digest_evp(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+	size_t size;
+	const char *data = luaL_checklstring(L, 2, &size);
+	const EVP_MD *md = EVP_get_digestbyname(name);
+	if (md == NULL)
+		return luaL_error(L, "unknown digest '%s'", name);
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_len;
+	ssize_t rc;
+	if (size >= DIGEST_COIO_THRESHOLD) {
+		rc = coio_call(digest_evp_f, md, data, size, digest,
+			       &digest_len);
+	} else {
+		rc = EVP_Digest(data, size, digest, &digest_len,
+				md, NULL) == 1 ? 0 : -1;
+	}
+	if (rc != 0)
+		return luaL_error(L, "failed to compute digest '%s'", name);
+	lua_pushlstring(L, (char *) digest, digest_len);
+	return 1;
+}
+
+/** Algorithms of batched hashing. */
+enum digest_batch_algo {
+	DIGEST_BATCH_CRC32,
+	DIGEST_BATCH_MURMUR,
+};
+
+static void
+digest_batch_calc(enum digest_batch_algo algo, const char **data,
+		  const size_t *sizes, uint32_t *hashes, int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (algo == DIGEST_BATCH_CRC32) {
+			hashes[i] = crc32_calc(DIGEST_CRC32_BEGIN, data[i],
+					       sizes[i]);
+		} else {
+			hashes[i] = PMurHash32(DIGEST_MURMUR_SEED, data[i],
+					       sizes[i]);
+		}
+	}
+}
+
+static ssize_t
+digest_batch_f(va_list ap)
+{
+	enum digest_batch_algo algo =
+		(enum digest_batch_algo) va_arg(ap, int);
+	const char **data = va_arg(ap, const char **);
+	const size_t *sizes = va_arg(ap, const size_t *);
+	uint32_t *hashes = va_arg(ap, uint32_t *);
+	int count = va_arg(ap, int);
+	digest_batch_calc(algo, data, sizes, hashes, count);
+	return 0;
+}
+
+/**
+ * batch(algo, strings) hashes an array of strings with crc32 or
+ * murmur in one call and returns an array of hashes. Batches of
+ * a large total size are hashed in a coio thread, so the call
+ * may yield.
+ */
+static int
+lua_digest_batch(lua_State *L)
+{
+	const char *algo_name = luaL_checkstring(L, 1);
+	enum digest_batch_algo algo;
+	if (strcmp(algo_name, "crc32") == 0)
+		algo = DIGEST_BATCH_CRC32;
+	else if (strcmp(algo_name, "murmur") == 0)
+		algo = DIGEST_BATCH_MURMUR;
+	else
+		return luaL_error(L, "unknown batch digest '%s'", algo_name);
+	luaL_checktype(L, 2, LUA_TTABLE);
+	int count = lua_objlen(L, 2);
+	size_t alloc_size = count * (sizeof(const char *) + sizeof(size_t) +
+				     sizeof(uint32_t));
+	/* Strings are referenced by the table during the call. */
+	const char **data = (const char **) lua_newuserdata(L, alloc_size);
+	size_t *sizes = (size_t *) (data + count);
+	uint32_t *hashes = (uint32_t *) (sizes + count);
+	size_t total_size = 0;
+	for (int i = 0; i < count; i++) {
+		lua_rawgeti(L, 2, i + 1);
+		if (lua_type(L, -1) != LUA_TSTRING)
+			return luaL_error(L, "batch item %d is not a string",
+					  i + 1);
+		data[i] = lua_tolstring(L, -1, &sizes[i]);
+		total_size += sizes[i];
+		lua_pop(L, 1);
+	}
+	if (total_size >= DIGEST_COIO_THRESHOLD) {
+		if (coio_call(digest_batch_f, (int) algo, data, sizes, hashes,
+			      count) != 0)
+			return luaL_error(L, "failed to compute digests");
+	} else {
+		digest_batch_calc(algo, data, sizes, hashes, count);
+	}
+	lua_createtable(L, count, 0);
+	for (int i = 0; i < count; i++) {
+		lua_pushnumber(L, hashes[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
 void
 tarantool_lua_digest_init(struct lua_State *L)
 {
 	static const struct luaL_Reg lua_digest_methods [] = {
 		{"pbkdf2", lua_pbkdf2},
+		{"evp", lua_digest_evp},
+		{"batch", lua_digest_batch},
 		{NULL, NULL}
 	};
 	luaL_register_module(L, "digest", lua_digest_methods);
@@ -258,6 +258,46 @@ for digest, _ in pairs(digest_shortcuts) do
     end
 end
 
+-- Variants of the digests above which hash large strings in a
+-- coio thread instead of blocking the event loop, so they may
+-- yield.
+local async = {}
+local async_digests = {sha1 = 'SHA1'}
+for digest, name in pairs(digest_shortcuts) do
+    async_digests[digest] = name
+end
+for digest, name in pairs(async_digests) do
+    async[digest] = function(str)
+        if type(str) ~= 'string' then
+            error('Usage: digest.async.'..digest..'(string)')
+        end
+        return internal.evp(name, str)
+    end
+    async[digest .. '_hex'] = function(str)
+        if type(str) ~= 'string' then
+            error('Usage: digest.async.'..digest..'_hex(string)')
+        end
+        return string.hex(internal.evp(name, str))
+    end
+end
+m.async = async
+
+-- Hash an array of strings in one call. Large batches are hashed
+-- in a coio thread, so the functions may yield.
+m.crc32_batch = function(strings)
+    if type(strings) ~= 'table' then
+        error('Usage: digest.crc32_batch(table)')
+    end
+    return internal.batch('crc32', strings)
+end
+
+m.murmur_batch = function(strings)
+    if type(strings) ~= 'table' then
+        error('Usage: digest.murmur_batch(table)')
+    end
+    return internal.batch('murmur', strings)
+end
+
 m['aes256cbc'] = {
     encrypt = function (str, key, iv)
         return crypto.cipher.aes256.cbc.encrypt(str, key, iv)
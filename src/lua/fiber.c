@@ -34,6 +34,7 @@
 #include "lua/utils.h"
 #include "backtrace.h"
 #include "tt_static.h"
+#include "clock.h"
 
 #include <lua.h>
 #include <lauxlib.h>
@@ -396,6 +397,16 @@ lbox_fiber_top_disable(struct lua_State *L)
 }
 #endif /* ENABLE_FIBER_TOP */
 
+static int
+lbox_fiber_set_slice_warn_threshold(struct lua_State *L)
+{
+	if (lua_gettop(L) != 1 || !lua_isnumber(L, 1))
+		luaL_error(L, "fiber.set_slice_warn_threshold(timeout): "
+			      "bad arguments");
+	fiber_set_slice_warn_threshold(lua_tonumber(L, 1));
+	return 0;
+}
+
 /**
  * Return fiber statistics.
  */
@@ -828,6 +839,131 @@ lbox_fiber_set_joinable(struct lua_State *L)
 	return 0;
 }
 
+/* {{{ Lua GC in idle time */
+
+/**
+ * Lua garbage collection driven by the event loop. When enabled,
+ * incremental GC steps are run from an idle watcher, i.e. only
+ * when the loop has no pending events, so that most of the work
+ * is done between requests rather than in the middle of them.
+ * The automatic GC is made less aggressive at the same time,
+ * which bounds the steps it takes during request processing.
+ */
+static struct {
+	/** Set if idle GC is enabled. */
+	bool is_enabled;
+	/** Size of a step, in KB, as in collectgarbage('step'). */
+	int step;
+	/** GC step multiplier to restore on disable. */
+	int saved_stepmul;
+	/** Lua memory usage at the end of the last cycle, in KB. */
+	int last_count;
+	/** Runs GC steps when the loop is idle. */
+	struct ev_idle idle;
+	/** Starts the idle watcher when there is new garbage. */
+	struct ev_prepare prepare;
+	/** Number of steps run in idle time. */
+	uint64_t steps;
+	/** Number of cycles completed in idle time. */
+	uint64_t cycles;
+	/** Total time spent in idle steps, in seconds. */
+	double time;
+	/** Maximal time of one idle step, in seconds. */
+	double max_time;
+} lua_gc_idle;
+
+static void
+lua_gc_idle_cb(ev_loop *loop, struct ev_idle *watcher, int revents)
+{
+	(void)revents;
+	struct lua_State *L = tarantool_L;
+	double start = clock_monotonic();
+	bool is_done = lua_gc(L, LUA_GCSTEP, lua_gc_idle.step) != 0;
+	double time = clock_monotonic() - start;
+	lua_gc_idle.steps++;
+	lua_gc_idle.time += time;
+	if (time > lua_gc_idle.max_time)
+		lua_gc_idle.max_time = time;
+	if (is_done) {
+		lua_gc_idle.cycles++;
+		lua_gc_idle.last_count = lua_gc(L, LUA_GCCOUNT, 0);
+		ev_idle_stop(loop, watcher);
+	}
+}
+
+static void
+lua_gc_prepare_cb(ev_loop *loop, struct ev_prepare *watcher, int revents)
+{
+	(void)watcher;
+	(void)revents;
+	if (ev_is_active(&lua_gc_idle.idle))
+		return;
+	if (lua_gc(tarantool_L, LUA_GCCOUNT, 0) >
+	    lua_gc_idle.last_count + lua_gc_idle.step)
+		ev_idle_start(loop, &lua_gc_idle.idle);
+}
+
+/**
+ * fiber.gc_idle_enable([step[, stepmul]])
+ * Run GC steps of @step KB (64 by default) in idle time and set
+ * the automatic GC step multiplier to @stepmul (100 by default).
+ */
+static int
+lbox_fiber_gc_idle_enable(struct lua_State *L)
+{
+	int step = luaL_optint(L, 1, 64);
+	int stepmul = luaL_optint(L, 2, 100);
+	if (step <= 0 || stepmul <= 0)
+		return luaL_error(L, "fiber.gc_idle_enable([step[, stepmul]]):"
+				  " arguments must be positive");
+	lua_gc_idle.step = step;
+	int saved_stepmul = lua_gc(L, LUA_GCSETSTEPMUL, stepmul);
+	if (lua_gc_idle.is_enabled)
+		return 0;
+	lua_gc_idle.saved_stepmul = saved_stepmul;
+	lua_gc_idle.last_count = lua_gc(L, LUA_GCCOUNT, 0);
+	ev_idle_init(&lua_gc_idle.idle, lua_gc_idle_cb);
+	ev_prepare_init(&lua_gc_idle.prepare, lua_gc_prepare_cb);
+	ev_prepare_start(loop(), &lua_gc_idle.prepare);
+	lua_gc_idle.is_enabled = true;
+	return 0;
+}
+
+/** fiber.gc_idle_disable() */
+static int
+lbox_fiber_gc_idle_disable(struct lua_State *L)
+{
+	if (!lua_gc_idle.is_enabled)
+		return 0;
+	ev_idle_stop(loop(), &lua_gc_idle.idle);
+	ev_prepare_stop(loop(), &lua_gc_idle.prepare);
+	lua_gc(L, LUA_GCSETSTEPMUL, lua_gc_idle.saved_stepmul);
+	lua_gc_idle.is_enabled = false;
+	return 0;
+}
+
+/** fiber.gc_stat() -> statistics of GC steps run in idle time */
+static int
+lbox_fiber_gc_stat(struct lua_State *L)
+{
+	lua_createtable(L, 0, 6);
+	lua_pushboolean(L, lua_gc_idle.is_enabled);
+	lua_setfield(L, -2, "idle_enabled");
+	lua_pushnumber(L, lua_gc_idle.steps);
+	lua_setfield(L, -2, "idle_steps");
+	lua_pushnumber(L, lua_gc_idle.cycles);
+	lua_setfield(L, -2, "idle_cycles");
+	lua_pushnumber(L, lua_gc_idle.time);
+	lua_setfield(L, -2, "idle_time");
+	lua_pushnumber(L, lua_gc_idle.max_time);
+	lua_setfield(L, -2, "idle_max_step_time");
+	lua_pushinteger(L, lua_gc(L, LUA_GCCOUNT, 0));
+	lua_setfield(L, -2, "memory_kb");
+	return 1;
+}
+
+/* }}} */
+
 /**
  * Alternative to fiber.sleep(infinite) which does not participate
  * in an event loop at all until an explicit wakeup. This is less
@@ -863,6 +999,10 @@ static const struct luaL_Reg fiberlib[] = {
 	{"top_enable", lbox_fiber_top_enable},
 	{"top_disable", lbox_fiber_top_disable},
 #endif /* ENABLE_FIBER_TOP */
+	{"set_slice_warn_threshold", lbox_fiber_set_slice_warn_threshold},
+	{"gc_idle_enable", lbox_fiber_gc_idle_enable},
+	{"gc_idle_disable", lbox_fiber_gc_idle_disable},
+	{"gc_stat", lbox_fiber_gc_stat},
 	{"sleep", lbox_fiber_sleep},
 	{"yield", lbox_fiber_yield},
 	{"self", lbox_fiber_self},
@@ -206,6 +206,95 @@ luaT_fiber_channel_get(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Parse an optional timeout argument at @a idx.
+ */
+static ev_tstamp
+luaT_fiber_channel_checktimeout(struct lua_State *L, int idx,
+				const char *usage)
+{
+	if (lua_isnoneornil(L, idx))
+		return TIMEOUT_INFINITY;
+	if (!lua_isnumber(L, idx) || lua_tonumber(L, idx) < 0)
+		luaL_error(L, "usage: %s", usage);
+	return lua_tonumber(L, idx);
+}
+
+/**
+ * channel:put_many(values [, timeout]) -> count
+ * Put all items of the array @a values in order. Only waits if
+ * the channel is full, @a timeout limits the total wait time.
+ * Returns the number of items put, which is less than #values
+ * on timeout or if the channel is closed.
+ */
+static int
+luaT_fiber_channel_put_many(struct lua_State *L)
+{
+	static const char usage[] = "channel:put_many(values [, timeout])";
+	struct fiber_channel *ch = luaT_checkfiberchannel(L, 1, usage);
+	if (!lua_istable(L, 2))
+		luaL_error(L, "usage: %s", usage);
+	ev_tstamp timeout = luaT_fiber_channel_checktimeout(L, 3, usage);
+	ev_tstamp deadline = ev_monotonic_now(loop()) + timeout;
+	int len = lua_objlen(L, 2);
+	int count = 0;
+	for (; count < len; count++) {
+		struct ipc_value *value = ipc_value_new();
+		if (value == NULL)
+			break;
+		value->base.destroy = lua_ipc_value_destroy;
+		lua_rawgeti(L, 2, count + 1);
+		value->i = luaL_ref(L, LUA_REGISTRYINDEX);
+		ev_tstamp left = deadline - ev_monotonic_now(loop());
+		if (fiber_channel_put_msg_timeout(ch, &value->base,
+						  left > 0 ? left : 0) != 0) {
+			value->base.destroy(&value->base);
+			luaL_testcancel(L);
+			break;
+		}
+	}
+	lua_pushinteger(L, count);
+	return 1;
+}
+
+/**
+ * channel:get_many(limit [, timeout]) -> values
+ * Wait for a message, then take all messages that are available
+ * without waiting, up to @a limit. Returns an empty table on
+ * timeout or if the channel is closed.
+ */
+static int
+luaT_fiber_channel_get_many(struct lua_State *L)
+{
+	static const char usage[] = "channel:get_many(limit [, timeout])";
+	struct fiber_channel *ch = luaT_checkfiberchannel(L, 1, usage);
+	if (!lua_isnumber(L, 2) || lua_tointeger(L, 2) <= 0)
+		luaL_error(L, "usage: %s", usage);
+	lua_Integer limit = lua_tointeger(L, 2);
+	ev_tstamp timeout = luaT_fiber_channel_checktimeout(L, 3, usage);
+	lua_newtable(L);
+	struct ipc_value *value;
+	if (fiber_channel_get_msg_timeout(ch, (struct ipc_msg **) &value,
+					  timeout) != 0) {
+		luaL_testcancel(L);
+		return 1;
+	}
+	lua_Integer count = 0;
+	while (true) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, value->i);
+		value->base.destroy(&value->base);
+		lua_rawseti(L, -2, ++count);
+		if (count == limit || (fiber_channel_is_empty(ch) &&
+				       !fiber_channel_has_writers(ch)))
+			break;
+		/* Doesn't wait, there's a message or a writer. */
+		if (fiber_channel_get_msg_timeout(ch,
+				(struct ipc_msg **) &value, 0) != 0)
+			break;
+	}
+	return 1;
+}
+
 static int
 luaT_fiber_channel_has_readers(struct lua_State *L)
 {
@@ -280,6 +369,8 @@ tarantool_lua_fiber_channel_init(struct lua_State *L)
 		{"is_empty",	luaT_fiber_channel_is_empty},
 		{"put",		luaT_fiber_channel_put},
 		{"get",		luaT_fiber_channel_get},
+		{"put_many",	luaT_fiber_channel_put_many},
+		{"get_many",	luaT_fiber_channel_get_many},
 		{"has_readers",	luaT_fiber_channel_has_readers},
 		{"has_writers",	luaT_fiber_channel_has_writers},
 		{"count",	luaT_fiber_channel_count},
@@ -41,6 +41,8 @@ local curl_mt
 --
 --  max_connections -  Maximum number of entries in the connection cache
 --  max_total_connections -  Maximum number of active connections
+--  http2 - Use HTTP/2 with servers supporting it over TLS and
+--          multiplex requests to the same host over one connection
 --
 --  Returns:
 --  curl object or raise error()
@@ -52,8 +54,12 @@ local http_new = function(opts)
 
     opts.max_connections = opts.max_connections or -1
     opts.max_total_connections = opts.max_total_connections or 0
+    if opts.http2 ~= nil and type(opts.http2) ~= 'boolean' then
+        error('http2 option must be a boolean')
+    end
 
-    local curl = driver.new(opts.max_connections, opts.max_total_connections)
+    local curl = driver.new(opts.max_connections, opts.max_total_connections,
+                            opts.http2)
     return setmetatable({ curl = curl, }, curl_mt )
 end
 
@@ -425,6 +431,12 @@ curl_mt = {
         --  failed_requests - this is a total number of requests which have
         --      failed (included systeme erros, curl errors, HTTP
         --      errors and so on)
+        --
+        --  connections_created - this is a total number of connections
+        --      established to serve requests
+        --
+        --  connections_reused - this is a total number of requests
+        --      served over an already open connection
         --  }
         --  or error()
         --
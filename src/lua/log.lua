@@ -29,6 +29,12 @@ ffi.cdef[[
     extern bool
     say_logger_initialized(void);
 
+    int
+    say_logger_set_async(void);
+
+    uint64_t
+    say_logger_dropped(void);
+
     extern sayfunc_t _say;
     extern struct ev_loop;
     extern struct ev_signal;
@@ -49,7 +55,8 @@ ffi.cdef[[
 
     enum say_format {
         SF_PLAIN,
-        SF_JSON
+        SF_JSON,
+        SF_BINARY
     };
     pid_t log_pid;
     extern int log_level;
@@ -85,12 +92,14 @@ local special_fields = {
 local fmt_num2str = {
     [ffi.C.SF_PLAIN]    = "plain",
     [ffi.C.SF_JSON]     = "json",
+    [ffi.C.SF_BINARY]   = "binary",
 }
 
 -- Map format string to number.
 local fmt_str2num = {
     ["plain"]           = ffi.C.SF_PLAIN,
     ["json"]            = ffi.C.SF_JSON,
+    ["binary"]          = ffi.C.SF_BINARY,
 }
 
 local function fmt_list()
@@ -126,6 +135,7 @@ end
 local log_cfg = {
     log             = nil,
     nonblock        = nil,
+    async           = nil,
     level           = S_INFO,
     format          = fmt_num2str[ffi.C.SF_PLAIN],
 }
@@ -136,6 +146,7 @@ local log_cfg = {
 local log2box_keys = {
     ['log']             = 'log',
     ['nonblock']        = 'log_nonblock',
+    ['async']           = 'log_async',
     ['level']           = 'log_level',
     ['format']          = 'log_format',
 }
@@ -143,6 +154,7 @@ local log2box_keys = {
 local box2log_keys = {
     ['log']             = 'log',
     ['log_nonblock']    = 'nonblock',
+    ['log_async']       = 'async',
     ['log_level']       = 'level',
     ['log_format']      = 'format',
 }
@@ -178,6 +190,7 @@ end
 local cfg_static_keys = {
     log         = true,
     nonblock    = true,
+    async       = true,
 }
 
 -- Test if static key is not changed.
@@ -218,10 +231,10 @@ local function verify_format(key, name, cfg)
         end
     end
 
-    if fmt_str2num[name] == ffi.C.SF_JSON then
+    if fmt_str2num[name] ~= ffi.C.SF_PLAIN then
         if log_type == ffi.C.SAY_LOGGER_SYSLOG then
             local m = "%s can't be used with syslog logger"
-            return false, m:format(fmt_num2str[ffi.C.SF_JSON])
+            return false, m:format(name)
         end
     end
 
@@ -248,6 +261,7 @@ end
 local verify_ops = {
     ['log']         = verify_static,
     ['nonblock']    = verify_static,
+    ['async']       = verify_static,
     ['format']      = verify_format,
     ['level']       = verify_level,
 }
@@ -349,11 +363,7 @@ end
 local function set_log_format(name, update_box_cfg)
     assert(fmt_str2num[name] ~= nil)
 
-    if fmt_str2num[name] == ffi.C.SF_JSON then
-        ffi.C.say_set_log_format(ffi.C.SF_JSON)
-    else
-        ffi.C.say_set_log_format(ffi.C.SF_PLAIN)
-    end
+    ffi.C.say_set_log_format(fmt_str2num[name])
 
     rawset(log_cfg, 'format', name)
 
@@ -375,6 +385,12 @@ local function log_format(name)
     set_log_format(name, true)
 end
 
+-- Returns the number of messages dropped by the asynchronous
+-- logger because its buffer was full.
+local function log_dropped()
+    return tonumber(ffi.C.say_logger_dropped())
+end
+
 -- Returns pid of a pipe process.
 local function log_pid()
     return tonumber(ffi.C.log_pid)
@@ -492,6 +508,12 @@ local function load_cfg(self, cfg)
         end
     end
 
+    if cfg.async ~= nil then
+        if type(cfg.async) ~= 'boolean' then
+            error("log.cfg: 'async' option must be 'true' or 'false'")
+        end
+    end
+
     if ffi.C.say_logger_initialized() == true then
         return reload_cfg(cfg)
     end
@@ -499,6 +521,7 @@ local function load_cfg(self, cfg)
     cfg.level = cfg.level or log_cfg.level
     cfg.format = cfg.format or log_cfg.format
     cfg.nonblock = cfg.nonblock or log_cfg.nonblock
+    cfg.async = cfg.async or log_cfg.async
 
     -- nonblock is special: it has to become integer
     -- for ffi call but in config we have to save
@@ -523,18 +546,130 @@ local function load_cfg(self, cfg)
         nonblock = nil
     end
 
+    if cfg.async and ffi.C.say_logger_set_async() ~= 0 then
+        error("log.cfg: failed to start the logger thread")
+    end
+
     -- Update log_cfg vars to show them in module
     -- configuration output.
     rawset(log_cfg, 'log', cfg.log)
     rawset(log_cfg, 'level', cfg.level)
     rawset(log_cfg, 'nonblock', nonblock)
+    rawset(log_cfg, 'async', cfg.async)
     rawset(log_cfg, 'format', cfg.format)
 
     -- and box.cfg output as well.
     box_cfg_update()
 
-    local m = "log.cfg({log=%s,level=%s,nonblock=%s,format=\'%s\'})"
-    say(S_DEBUG, m:format(cfg.log, cfg.level, cfg.nonblock, cfg.format))
+    local m = "log.cfg({log=%s,level=%s,nonblock=%s,async=%s,format=\'%s\'})"
+    say(S_DEBUG, m:format(cfg.log, cfg.level, cfg.nonblock, cfg.async,
+                          cfg.format))
+end
+
+-- Level names of the binary log format.
+local level_names = {
+    [ffi.C.S_FATAL]     = 'F',
+    [ffi.C.S_SYSERROR]  = '!',
+    [ffi.C.S_ERROR]     = 'E',
+    [ffi.C.S_CRIT]      = 'C',
+    [ffi.C.S_WARN]      = 'W',
+    [ffi.C.S_INFO]      = 'I',
+    [ffi.C.S_VERBOSE]   = 'V',
+    [ffi.C.S_DEBUG]     = 'D',
+}
+
+-- Render a C printf format with arguments stored by the binary
+-- log format: width and precision given with '*' are arguments
+-- too, length modifiers are dropped.
+local function binary_format(fmt, args)
+    local i = 0
+    local function next_arg()
+        i = i + 1
+        local v = args[i]
+        if type(v) == 'cdata' then
+            v = tonumber(v)
+        end
+        return v
+    end
+    return (fmt:gsub("%%([-+ #0']*)(%*?%d*)(%.?%*?%d*)[hlqjztL]*(.?)",
+                     function(flags, width, precision, conv)
+        if conv == '%' then
+            return '%'
+        end
+        flags = flags:gsub("'", '')
+        if width == '*' then
+            width = tostring(next_arg())
+        end
+        if precision == '.*' then
+            precision = '.' .. tostring(next_arg())
+        end
+        if not conv:match('^[diouxXcpeEfFgGaAs]$') then
+            -- Conversions which take no argument.
+            return ''
+        end
+        if conv == 'u' or conv == 'i' then
+            conv = 'd'
+        elseif conv == 'p' then
+            flags, conv = '#', 'x'
+        elseif conv == 'F' then
+            conv = 'f'
+        end
+        local v = next_arg()
+        local ok, res = pcall(string.format,
+                              '%' .. flags .. width .. precision .. conv, v)
+        return ok and res or tostring(v)
+    end))
+end
+
+-- Decode a log file written in the binary format. Returns an
+-- iterator over messages, each one is a table with the same
+-- fields as in the json format, the time is a number.
+local function log_decode(path)
+    local fio = require('fio')
+    local msgpack = require('msgpack')
+    local f, err = fio.open(path)
+    if f == nil then
+        error(err)
+    end
+    local data = f:read()
+    f:close()
+    local function opt(v)
+        if v == msgpack.NULL then
+            return nil
+        end
+        return v
+    end
+    local formats = {}
+    local pos = 1
+    return function()
+        while pos <= #data do
+            local rec
+            rec, pos = msgpack.decode(data, pos)
+            if rec[1] == 0 then
+                formats[rec[2]] = rec[3]
+            else
+                local fmt = formats[rec[10]]
+                local message
+                if fmt ~= nil then
+                    message = binary_format(fmt, rec[11])
+                else
+                    message = ('<unknown format %d>'):format(rec[10])
+                end
+                return {
+                    time = rec[2],
+                    level = level_names[rec[3]],
+                    pid = rec[4],
+                    cord_name = opt(rec[5]),
+                    fiber_id = opt(rec[6]),
+                    fiber_name = opt(rec[7]),
+                    file = opt(rec[8]),
+                    line = rec[9],
+                    message = message,
+                    error = opt(rec[12]),
+                }
+            end
+        end
+    end
 end
 
 local compat_warning_said = false
@@ -556,6 +691,8 @@ local log = {
     error = say_closure(S_ERROR),
     rotate = log_rotate,
     pid = log_pid,
+    dropped = log_dropped,
+    decode = log_decode,
     level = log_level,
     log_format = log_format,
     cfg = setmetatable(log_cfg, {
@@ -37,6 +37,8 @@
 #endif /* defined(LUAJIT) */
 #include <lauxlib.h> /* struct luaL_error */
 
+#include <limits.h>
+#include <string.h>
 #include <msgpuck.h>
 #include <small/region.h>
 #include <small/ibuf.h>
@@ -108,6 +110,9 @@ luamp_set_decode_extension(luamp_decode_extension_f handler)
 	}
 }
 
+static enum mp_type
+luamp_encode_object(struct lua_State *L, int idx, struct mpstream *stream);
+
 enum mp_type
 luamp_encode_r(struct lua_State *L, struct luaL_serializer *cfg,
 	       const struct serializer_opts *opts, struct mpstream *stream,
@@ -199,6 +204,10 @@ restart: /* used by MP_EXT of unidentified subtype */
 		case MP_ERROR:
 			return luamp_encode_extension(L, top, stream);
 		default:
+			/* A lazily decoded object is copied as is. */
+			type = luamp_encode_object(L, top, stream);
+			if (type != MP_EXT)
+				return type;
 			/* Run trigger if type can't be encoded */
 			type = luamp_encode_extension(L, top, stream);
 			if (type != MP_EXT)
@@ -565,6 +574,325 @@ lua_decode_map_header(lua_State *L)
 	return 2;
 }
 
+/* {{{ msgpack.object */
+
+static const char luamp_object_typename[] = "msgpack.object";
+
+/**
+ * A lazily decoded MsgPack value. Objects refer to the data
+ * they were created from instead of decoding it into Lua
+ * tables, so that a big document can be walked with constant
+ * memory. Nested arrays and maps are returned as objects too.
+ */
+struct luamp_object {
+	/** Start of the encoded value. */
+	const char *data;
+	/** End of the encoded value. */
+	const char *data_end;
+	/** Serializer used to decode scalars. */
+	struct luaL_serializer *cfg;
+	/**
+	 * Reference to a table holding the source string and
+	 * the serializer, which keeps them alive. Shared by all
+	 * objects created from the same source.
+	 */
+	int owner_ref;
+};
+
+static struct luamp_object *
+luamp_check_object(struct lua_State *L, int idx)
+{
+	return (struct luamp_object *)
+		luaL_checkudata(L, idx, luamp_object_typename);
+}
+
+/**
+ * Copy the encoded value if the Lua value at @a idx is an object.
+ * Return MP_EXT otherwise.
+ */
+static enum mp_type
+luamp_encode_object(struct lua_State *L, int idx, struct mpstream *stream)
+{
+	struct luamp_object *obj = (struct luamp_object *)
+		luaL_testudata(L, idx, luamp_object_typename);
+	if (obj == NULL)
+		return MP_EXT;
+	mpstream_memcpy(stream, obj->data, obj->data_end - obj->data);
+	return mp_typeof(*obj->data);
+}
+
+/**
+ * Push the value at @a data: an object for an array or a map,
+ * a decoded Lua value otherwise.
+ */
+static void
+luamp_object_push_value(struct lua_State *L, struct luamp_object *parent,
+			const char *data)
+{
+	enum mp_type type = mp_typeof(*data);
+	if (type != MP_ARRAY && type != MP_MAP) {
+		luamp_decode(L, parent->cfg, &data);
+		return;
+	}
+	struct luamp_object *obj = (struct luamp_object *)
+		lua_newuserdata(L, sizeof(*obj));
+	obj->data = data;
+	mp_next(&data);
+	obj->data_end = data;
+	obj->cfg = parent->cfg;
+	lua_rawgeti(L, LUA_REGISTRYINDEX, parent->owner_ref);
+	obj->owner_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	luaL_getmetatable(L, luamp_object_typename);
+	lua_setmetatable(L, -2);
+}
+
+/**
+ * msgpack.object_from_raw(data[, size]) -> object
+ * The data is checked once here, navigation doesn't check it.
+ * Data given as 'char *' is copied, a string is referenced.
+ */
+static int
+lua_msgpack_object_from_raw(struct lua_State *L)
+{
+	size_t size;
+	const char *data;
+	uint32_t cdata_type;
+	if (lua_type(L, 1) == LUA_TSTRING) {
+		data = lua_tolstring(L, 1, &size);
+	} else if (luaL_checkconstchar(L, 1, &data, &cdata_type) == 0) {
+		ptrdiff_t len = luaL_checkinteger(L, 2);
+		if (data == NULL || len < 0) {
+			return luaL_error(L, "msgpack.object_from_raw: "
+					  "invalid data or size");
+		}
+		lua_pushlstring(L, data, len);
+		lua_replace(L, 1);
+		data = lua_tolstring(L, 1, &size);
+	} else {
+		return luaL_error(L, "msgpack.object_from_raw: "
+				  "a Lua string or 'char *' expected");
+	}
+	const char *p = data;
+	if (size == 0 || mp_check(&p, data + size) != 0)
+		return luaL_error(L, "msgpack.object_from_raw: "
+				  "invalid MsgPack");
+	struct luamp_object root;
+	root.data = data;
+	root.data_end = p;
+	root.cfg = luaL_checkserializer(L);
+	lua_createtable(L, 2, 0);
+	lua_pushvalue(L, 1);
+	lua_rawseti(L, -2, 1);
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_rawseti(L, -2, 2);
+	root.owner_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	luamp_object_push_value(L, &root, data);
+	luaL_unref(L, LUA_REGISTRYINDEX, root.owner_ref);
+	return 1;
+}
+
+/** object:type() -> 'array', 'map', 'string', ... */
+static int
+lua_msgpack_object_type(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	lua_pushstring(L, mp_typeof(*obj->data) == MP_ARRAY ?
+		       "array" : "map");
+	return 1;
+}
+
+/** object:len() -> number of array items or map pairs. */
+static int
+lua_msgpack_object_len(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	const char *data = obj->data;
+	uint32_t len = mp_typeof(*data) == MP_ARRAY ?
+		       mp_decode_array(&data) : mp_decode_map(&data);
+	lua_pushinteger(L, len);
+	return 1;
+}
+
+/** object:decode() -> the whole value as Lua tables. */
+static int
+lua_msgpack_object_decode(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	const char *data = obj->data;
+	luamp_decode(L, obj->cfg, &data);
+	return 1;
+}
+
+/**
+ * Return true if the encoded map key at @a data equals the Lua
+ * value at @a idx. Only string and integer keys are supported.
+ */
+static bool
+luamp_object_key_equal(struct lua_State *L, int idx, const char *data)
+{
+	switch (mp_typeof(*data)) {
+	case MP_STR: {
+		if (lua_type(L, idx) != LUA_TSTRING)
+			return false;
+		size_t len;
+		const char *key = lua_tolstring(L, idx, &len);
+		uint32_t str_len;
+		const char *str = mp_decode_str(&data, &str_len);
+		return len == str_len && memcmp(key, str, len) == 0;
+	}
+	case MP_UINT:
+		return lua_type(L, idx) == LUA_TNUMBER &&
+		       lua_tonumber(L, idx) == (double)mp_decode_uint(&data);
+	case MP_INT:
+		return lua_type(L, idx) == LUA_TNUMBER &&
+		       lua_tonumber(L, idx) == (double)mp_decode_int(&data);
+	default:
+		return false;
+	}
+}
+
+/**
+ * Find the value @a idx-th argument refers to in the container
+ * at @a data. Return NULL if there's no such value.
+ */
+static const char *
+luamp_object_lookup(struct lua_State *L, int idx, const char *data)
+{
+	if (mp_typeof(*data) == MP_ARRAY) {
+		if (lua_type(L, idx) != LUA_TNUMBER)
+			return NULL;
+		lua_Integer i = lua_tointeger(L, idx);
+		uint32_t len = mp_decode_array(&data);
+		if (i < 1 || i > len)
+			return NULL;
+		for (lua_Integer k = 1; k < i; k++)
+			mp_next(&data);
+		return data;
+	}
+	if (mp_typeof(*data) != MP_MAP)
+		return NULL;
+	uint32_t len = mp_decode_map(&data);
+	for (uint32_t k = 0; k < len; k++) {
+		bool found = luamp_object_key_equal(L, idx, data);
+		mp_next(&data);
+		if (found)
+			return data;
+		mp_next(&data);
+	}
+	return NULL;
+}
+
+/**
+ * object:get(key1, key2, ...) -> value or nil
+ * Follow the given path of array indexes (1-based) and map
+ * keys, skipping siblings without decoding them.
+ */
+static int
+lua_msgpack_object_get(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	const char *data = obj->data;
+	int top = lua_gettop(L);
+	for (int idx = 2; idx <= top && data != NULL; idx++)
+		data = luamp_object_lookup(L, idx, data);
+	if (data == NULL) {
+		lua_pushnil(L);
+		return 1;
+	}
+	luamp_object_push_value(L, obj, data);
+	return 1;
+}
+
+/**
+ * Iteration step. Upvalues: the object, the position of the
+ * next item, the number of remaining items, the next index.
+ */
+static int
+lua_msgpack_object_next(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, lua_upvalueindex(1));
+	lua_Integer remaining = lua_tointeger(L, lua_upvalueindex(3));
+	if (remaining == 0)
+		return 0;
+	const char *data = obj->data +
+			   lua_tointeger(L, lua_upvalueindex(2));
+	if (mp_typeof(*obj->data) == MP_ARRAY) {
+		lua_Integer i = lua_tointeger(L, lua_upvalueindex(4));
+		lua_pushinteger(L, i + 1);
+		lua_replace(L, lua_upvalueindex(4));
+		lua_pushinteger(L, i);
+	} else {
+		luamp_decode(L, obj->cfg, &data);
+	}
+	luamp_object_push_value(L, obj, data);
+	mp_next(&data);
+	lua_pushinteger(L, data - obj->data);
+	lua_replace(L, lua_upvalueindex(2));
+	lua_pushinteger(L, remaining - 1);
+	lua_replace(L, lua_upvalueindex(3));
+	return 2;
+}
+
+/**
+ * object:pairs() -> iterator
+ * Yields (index, value) for an array and (key, value) for a map.
+ */
+static int
+lua_msgpack_object_pairs(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	const char *data = obj->data;
+	uint32_t len = mp_typeof(*data) == MP_ARRAY ?
+		       mp_decode_array(&data) : mp_decode_map(&data);
+	lua_pushvalue(L, 1);
+	lua_pushinteger(L, data - obj->data);
+	lua_pushinteger(L, len);
+	lua_pushinteger(L, 1);
+	lua_pushcclosure(L, lua_msgpack_object_next, 4);
+	return 1;
+}
+
+/**
+ * object:unpack() -> item1, item2, ...
+ * Return array items as multiple values. Nested containers
+ * stay objects, so a router can return a raw response of
+ * another call as its own results without re-encoding them.
+ */
+static int
+lua_msgpack_object_unpack(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	const char *data = obj->data;
+	if (mp_typeof(*data) != MP_ARRAY)
+		return luaL_error(L, "msgpack.object: unpack of a map");
+	uint32_t len = mp_decode_array(&data);
+	if (len > INT_MAX || !lua_checkstack(L, len))
+		return luaL_error(L, "msgpack.object: too many items");
+	for (uint32_t i = 0; i < len; i++) {
+		luamp_object_push_value(L, obj, data);
+		mp_next(&data);
+	}
+	return len;
+}
+
+static int
+lua_msgpack_object_tostring(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	lua_pushfstring(L, "msgpack.object: %p", obj);
+	return 1;
+}
+
+static int
+lua_msgpack_object_gc(struct lua_State *L)
+{
+	struct luamp_object *obj = luamp_check_object(L, 1);
+	luaL_unref(L, LUA_REGISTRYINDEX, obj->owner_ref);
+	return 0;
+}
+
+/* }}} msgpack.object */
+
 static int
 lua_msgpack_new(lua_State *L);
 
@@ -575,6 +903,7 @@ static const luaL_Reg msgpacklib[] = {
 	{ "ibuf_decode", lua_ibuf_msgpack_decode },
 	{ "decode_array_header", lua_decode_array_header },
 	{ "decode_map_header", lua_decode_map_header },
+	{ "object_from_raw", lua_msgpack_object_from_raw },
 	{ "new", lua_msgpack_new },
 	{ NULL, NULL }
 };
@@ -589,6 +918,19 @@ lua_msgpack_new(lua_State *L)
 LUALIB_API int
 luaopen_msgpack(lua_State *L)
 {
+	static const struct luaL_Reg luamp_object_meta[] = {
+		{ "type", lua_msgpack_object_type },
+		{ "len", lua_msgpack_object_len },
+		{ "decode", lua_msgpack_object_decode },
+		{ "get", lua_msgpack_object_get },
+		{ "pairs", lua_msgpack_object_pairs },
+		{ "unpack", lua_msgpack_object_unpack },
+		{ "__len", lua_msgpack_object_len },
+		{ "__tostring", lua_msgpack_object_tostring },
+		{ "__gc", lua_msgpack_object_gc },
+		{ NULL, NULL }
+	};
+	luaL_register_type(L, luamp_object_typename, luamp_object_meta);
 	luaL_msgpack_default = luaL_newserializer(L, "msgpack", msgpacklib);
 	return 1;
 }
@@ -1896,6 +1896,288 @@ usage:
 	return luaT_error(L);
 }
 
+/**
+ * Extract a file descriptor to splice data to or from.
+ *
+ * Accept a number, a socket object (anything with the fd()
+ * method), a fio handle or a popen handle. For a popen handle
+ * its stdin is used when @a is_dst is set, stdout otherwise.
+ *
+ * Return -1 in case of unexpected type or a closed stream.
+ */
+static int
+luaT_popen_check_splice_fd(struct lua_State *L, int idx, bool is_dst)
+{
+	bool is_closed;
+	struct popen_handle *handle = luaT_check_popen_handle(L, idx,
+							      &is_closed);
+	if (handle != NULL) {
+		if (is_closed)
+			return -1;
+		struct popen_stat st;
+		popen_stat(handle, &st);
+		return st.fds[is_dst ? STDIN_FILENO : STDOUT_FILENO];
+	}
+	switch (lua_type(L, idx)) {
+	case LUA_TNUMBER:
+		return lua_tointeger(L, idx);
+	case LUA_TTABLE:
+		break;
+	default:
+		return -1;
+	}
+	int fd = -1;
+	lua_getfield(L, idx, "fh");
+	if (lua_type(L, -1) == LUA_TNUMBER) {
+		fd = lua_tointeger(L, -1);
+		lua_pop(L, 1);
+		return fd;
+	}
+	lua_pop(L, 1);
+	lua_getfield(L, idx, "fd");
+	if (lua_type(L, -1) == LUA_TFUNCTION) {
+		lua_pushvalue(L, idx);
+		lua_call(L, 1, 1);
+		if (lua_type(L, -1) == LUA_TNUMBER)
+			fd = lua_tointeger(L, -1);
+	}
+	lua_pop(L, 1);
+	return fd;
+}
+
+/**
+ * Finish lbox_popen_read_to() and lbox_popen_write_from().
+ */
+static int
+luaT_popen_push_splice_result(struct lua_State *L, ssize_t rc)
+{
+	if (rc < 0) {
+		struct error *e = diag_last_error(diag_get());
+		if (e->type == &type_IllegalParams ||
+		    e->type == &type_FiberIsCancelled)
+			return luaT_error(L);
+		return luaT_push_nil_and_error(L);
+	}
+	lua_pushinteger(L, rc);
+	return 1;
+}
+
+/**
+ * Move output of a child to a file, a socket or another child.
+ *
+ * @param handle        a handle of a child process
+ * @param dst           a file descriptor number, a socket
+ *                      object, a fio handle or a popen handle
+ *                      (its stdin is used)
+ * @param opts          table of options
+ * @param opts.stdout   move data from stdout, boolean
+ *                      (default: true)
+ * @param opts.stderr   move data from stderr, boolean
+ *                      (default: false)
+ * @param opts.size     stop after this amount of bytes
+ *                      (default: until EOF)
+ * @param opts.timeout  time quota in seconds
+ *                      (default: 100 years)
+ *
+ * Unlike ph:read() data doesn't pass through Lua strings: on
+ * Linux it is moved by splice(2) without copying to the user
+ * space at all. It is handy to stream a large output of a
+ * child to a file or to a network peer:
+ *
+ *  | local popen = require('popen')
+ *  | local fio = require('fio')
+ *  |
+ *  | local ph = popen.shell('tar c /data | zstd', 'r')
+ *  | local fh = fio.open('/backup/data.tar.zst',
+ *  |                     {'O_WRONLY', 'O_CREAT'}, tonumber('644', 8))
+ *  | local size = ph:read_to(fh)
+ *  | fh:close()
+ *  | ph:close()
+ *
+ * Raise an error on incorrect parameters or when the fiber is
+ * cancelled:
+ *
+ * - IllegalParams:    incorrect type or value of a parameter.
+ * - IllegalParams:    called on a closed handle.
+ * - IllegalParams:    opts.stdout and opts.stderr are set both
+ * - IllegalParams:    a requested IO operation is not supported
+ *                     by the handle (stdout / stderr is not
+ *                     piped).
+ * - IllegalParams:    attempt to operate on a closed file
+ *                     descriptor.
+ * - FiberIsCancelled: cancelled by an outside code.
+ *
+ * Return amount of moved bytes on success: less than
+ * @a opts.size means EOF.
+ *
+ * Return `nil, err` on a failure. Possible reasons:
+ *
+ * - SystemError: an IO error occurs at splice().
+ * - TimedOut:    @a timeout quota is exceeded.
+ */
+static int
+lbox_popen_read_to(struct lua_State *L)
+{
+	struct popen_handle *handle;
+	bool is_closed;
+	unsigned int flags = POPEN_FLAG_NONE;
+	size_t size = SIZE_MAX;
+	ev_tstamp timeout = TIMEOUT_INFINITY;
+
+	/* Extract handle and destination. */
+	if ((handle = luaT_check_popen_handle(L, 1, &is_closed)) == NULL)
+		goto usage;
+	if (is_closed)
+		return luaT_popen_handle_closed_error(L);
+	int fd = luaT_popen_check_splice_fd(L, 2, true);
+	if (fd < 0)
+		goto usage;
+
+	/* Extract options. */
+	if (!lua_isnoneornil(L, 3)) {
+		if (lua_type(L, 3) != LUA_TTABLE)
+			goto usage;
+
+		lua_getfield(L, 3, "stdout");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TBOOLEAN)
+				goto usage;
+			if (lua_toboolean(L, -1) == 0)
+				flags &= ~POPEN_FLAG_FD_STDOUT;
+			else
+				flags |= POPEN_FLAG_FD_STDOUT;
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 3, "stderr");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TBOOLEAN)
+				goto usage;
+			if (lua_toboolean(L, -1) == 0)
+				flags &= ~POPEN_FLAG_FD_STDERR;
+			else
+				flags |= POPEN_FLAG_FD_STDERR;
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 3, "size");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TNUMBER ||
+			    lua_tonumber(L, -1) < 0)
+				goto usage;
+			size = MIN(lua_tonumber(L, -1), (double)SSIZE_MAX);
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 3, "timeout");
+		if (!lua_isnil(L, -1) &&
+		    (timeout = luaT_check_timeout(L, -1)) < 0.0)
+			goto usage;
+		lua_pop(L, 1);
+	}
+
+	/* Read from stdout by default. */
+	if (!(flags & (POPEN_FLAG_FD_STDOUT | POPEN_FLAG_FD_STDERR)))
+		flags |= POPEN_FLAG_FD_STDOUT;
+
+	ssize_t rc = popen_splice_timeout(handle, fd, size, flags, timeout);
+	return luaT_popen_push_splice_result(L, rc);
+
+usage:
+	diag_set(IllegalParams, "Bad params, use: ph:read_to(dst[, {"
+		 "stdout = <boolean>, "
+		 "stderr = <boolean>, "
+		 "size = <number>, "
+		 "timeout = <number>}])");
+	return luaT_error(L);
+}
+
+/**
+ * Feed a child with data from a file, a socket or another
+ * child.
+ *
+ * @param handle        a handle of a child process
+ * @param src           a file descriptor number, a socket
+ *                      object, a fio handle or a popen handle
+ *                      (its stdout is used)
+ * @param opts          table of options
+ * @param opts.size     stop after this amount of bytes
+ *                      (default: until EOF)
+ * @param opts.timeout  time quota in seconds
+ *                      (default: 100 years)
+ *
+ * Data is written to stdin of the child bypassing Lua strings,
+ * see ph:read_to(). The function doesn't close stdin on EOF,
+ * use ph:shutdown({stdin = true}) for that.
+ *
+ * Raise an error on incorrect parameters or when the fiber is
+ * cancelled:
+ *
+ * - IllegalParams:    incorrect type or value of a parameter.
+ * - IllegalParams:    called on a closed handle.
+ * - IllegalParams:    a requested IO operation is not supported
+ *                     by the handle (stdin is not piped).
+ * - IllegalParams:    attempt to operate on a closed file
+ *                     descriptor.
+ * - FiberIsCancelled: cancelled by an outside code.
+ *
+ * Return amount of moved bytes on success: less than
+ * @a opts.size means EOF of @a src.
+ *
+ * Return `nil, err` on a failure. Possible reasons:
+ *
+ * - SystemError: an IO error occurs at splice().
+ * - TimedOut:    @a timeout quota is exceeded.
+ */
+static int
+lbox_popen_write_from(struct lua_State *L)
+{
+	struct popen_handle *handle;
+	bool is_closed;
+	size_t size = SIZE_MAX;
+	ev_tstamp timeout = TIMEOUT_INFINITY;
+
+	/* Extract handle and source. */
+	if ((handle = luaT_check_popen_handle(L, 1, &is_closed)) == NULL)
+		goto usage;
+	if (is_closed)
+		return luaT_popen_handle_closed_error(L);
+	int fd = luaT_popen_check_splice_fd(L, 2, false);
+	if (fd < 0)
+		goto usage;
+
+	/* Extract options. */
+	if (!lua_isnoneornil(L, 3)) {
+		if (lua_type(L, 3) != LUA_TTABLE)
+			goto usage;
+
+		lua_getfield(L, 3, "size");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TNUMBER ||
+			    lua_tonumber(L, -1) < 0)
+				goto usage;
+			size = MIN(lua_tonumber(L, -1), (double)SSIZE_MAX);
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 3, "timeout");
+		if (!lua_isnil(L, -1) &&
+		    (timeout = luaT_check_timeout(L, -1)) < 0.0)
+			goto usage;
+		lua_pop(L, 1);
+	}
+
+	unsigned int flags = POPEN_FLAG_FD_STDIN;
+	ssize_t rc = popen_splice_timeout(handle, fd, size, flags, timeout);
+	return luaT_popen_push_splice_result(L, rc);
+
+usage:
+	diag_set(IllegalParams, "Bad params, use: ph:write_from(src[, {"
+		 "size = <number>, "
+		 "timeout = <number>}])");
+	return luaT_error(L);
+}
+
 /**
  * Close parent's ends of std* fds.
  *
@@ -2504,6 +2786,8 @@ tarantool_lua_popen_init(struct lua_State *L)
 		{"wait",		lbox_popen_wait,	},
 		{"read",		lbox_popen_read,	},
 		{"write",		lbox_popen_write,	},
+		{"read_to",		lbox_popen_read_to,	},
+		{"write_from",		lbox_popen_write_from,	},
 		{"shutdown",		lbox_popen_shutdown,	},
 		{"info",		lbox_popen_info,	},
 		{"close",		lbox_popen_close,	},
@@ -572,6 +572,15 @@ load_cfg(void)
 	if (background)
 		daemonize();
 
+	/*
+	 * The logger thread is started after daemonising, since
+	 * threads don't survive fork().
+	 */
+	if (cfg_getb("log_async") == 1 && say_logger_set_async() != 0) {
+		diag_log();
+		panic("failed to start the logger thread");
+	}
+
 	/*
 	 * after (optional) daemonising to avoid confusing messages with
 	 * different pids
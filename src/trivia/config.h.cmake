@@ -114,6 +114,14 @@
  * Defined if this platform has BSD specific sendfile(..).
  */
 #cmakedefine HAVE_SENDFILE_BSD 1
+/*
+ * Defined if this platform has sendmmsg(..).
+ */
+#cmakedefine HAVE_SENDMMSG 1
+/*
+ * Defined if this platform has recvmmsg(..).
+ */
+#cmakedefine HAVE_RECVMMSG 1
 /*
  * Set if this is a GNU system and libc has __libc_stack_end.
  */
@@ -175,6 +183,8 @@
 #cmakedefine HAVE_SO_NOSIGPIPE 1
 
 #cmakedefine HAVE_PRCTL_H 1
+#cmakedefine HAVE_LINUX_MEMPOLICY_H 1
+#cmakedefine HAVE_IO_URING 1
 
 #cmakedefine HAVE_UUIDGEN 1
 #cmakedefine HAVE_CLOCK_GETTIME 1
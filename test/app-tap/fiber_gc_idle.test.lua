@@ -0,0 +1,34 @@
+#!/usr/bin/env tarantool
+
+--
+-- fiber.gc_idle_enable() runs Lua GC steps when the event loop
+-- is idle.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('fiber_gc_idle')
+test:plan(6)
+
+test:is(fiber.gc_stat().idle_enabled, false, 'disabled by default')
+test:ok(not pcall(fiber.gc_idle_enable, 0), 'step must be positive')
+
+fiber.gc_idle_enable(16)
+test:is(fiber.gc_stat().idle_enabled, true, 'enabled')
+
+-- Produce garbage and let the loop idle.
+for _ = 1, 10 do
+    local t = {}
+    for i = 1, 10000 do
+        t[i] = {i}
+    end
+    fiber.sleep(0.01)
+end
+local stat = fiber.gc_stat()
+test:ok(stat.idle_steps > 0, 'steps are run in idle time')
+test:ok(stat.idle_time >= stat.idle_max_step_time, 'step time is accounted')
+
+fiber.gc_idle_disable()
+test:is(fiber.gc_stat().idle_enabled, false, 'disabled')
+
+os.exit(test:check() and 0 or 1)
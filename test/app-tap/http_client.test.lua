@@ -259,6 +259,22 @@ local function test_post_and_get(test, url, opts)
         "stats checking")
 end
 
+local function test_connections(test, url, opts)
+    test:plan(3)
+    local http = client:new()
+    for _ = 1, 3 do
+        http:get(url, opts)
+    end
+    local st = http:stat()
+    test:ok(st.connections_created >= 1, 'connections created')
+    test:is(st.connections_created + st.connections_reused, 3,
+            'connections reused')
+
+    local ok, err = pcall(client.new, {http2 = 'yes'})
+    test:ok(not ok and string.find(err, 'http2 option must be a boolean'),
+            'invalid http2 option')
+end
+
 local function test_errors(test)
     test:plan(2)
     local http = client:new()
@@ -583,7 +599,7 @@ local function test_concurrent(test, url, opts)
 end
 
 function run_tests(test, sock_family, sock_addr)
-    test:plan(11)
+    test:plan(12)
     local server, url, opts = start_server(test, sock_family, sock_addr)
     test:test("http.client", test_http_client, url, opts)
     test:test("http.client headers redefine", test_http_client_headers_redefine,
@@ -591,6 +607,7 @@ function run_tests(test, sock_family, sock_addr)
     test:test("cancel and errinj", test_cancel_and_errinj, url .. 'long_query', opts)
     test:test("basic http post/get", test_post_and_get, url, opts)
     test:test("errors", test_errors)
+    test:test("connections", test_connections, url, opts)
     test:test("request_headers", test_request_headers, url, opts)
     test:test("headers", test_headers, url, opts)
     test:test("special methods", test_special_methods, url, opts)
@@ -0,0 +1,55 @@
+#!/usr/bin/env tarantool
+
+--
+-- With async = true messages are written to the log by a
+-- dedicated logger thread.
+--
+local test = require('tap').test('log_async')
+local log = require('log')
+local fio = require('fio')
+local fiber = require('fiber')
+test:plan(7)
+
+local filename = fio.pathjoin(fio.tempdir(), 'async.log')
+
+local _, err = pcall(log.cfg, {log = filename, async = 'yes'})
+test:ok(tostring(err):find("'async' option must be") ~= nil, 'bad value')
+
+log.cfg({log = filename, async = true})
+test:is(log.cfg.async, true, 'log.cfg.async')
+
+_, err = pcall(log.cfg, {async = false})
+test:ok(tostring(err):find("can't be set dynamically") ~= nil, 'static')
+
+local function count(pattern)
+    local data = fio.open(filename):read()
+    local n = 0
+    for _ in data:gmatch(pattern) do
+        n = n + 1
+    end
+    return n
+end
+
+local function wait_count(pattern, expected)
+    for _ = 1, 500 do
+        if count(pattern) == expected then
+            return true
+        end
+        fiber.sleep(0.01)
+    end
+    return false
+end
+
+for i = 1, 1000 do
+    log.info('tx message %d', i)
+end
+test:ok(wait_count('tx message %d+', 1000), 'messages from tx')
+
+-- Messages from box threads.
+box.cfg{}
+test:is(box.cfg.log_async, true, 'box.cfg.log_async')
+test:ok(wait_count('ready to accept requests', 1), 'messages from box')
+
+test:is(log.dropped(), 0, 'nothing is dropped')
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,41 @@
+#!/usr/bin/env tarantool
+
+--
+-- The binary log format stores format strings once and message
+-- arguments as is. log.decode() turns it back into messages.
+--
+local test = require('tap').test('log_binary')
+local log = require('log')
+local fio = require('fio')
+test:plan(9)
+
+local _, err = pcall(log.cfg, {log = 'syslog:', format = 'binary'})
+test:ok(tostring(err):find("can't be used with syslog logger") ~= nil,
+        'no binary syslog')
+
+local filename = fio.pathjoin(fio.tempdir(), 'binary.log')
+log.cfg({log = filename, format = 'binary'})
+test:is(log.cfg.format, 'binary', 'log.cfg.format')
+
+for i = 1, 3 do
+    log.info('message %d', i)
+end
+log.warn({key = 'value'})
+box.cfg{}
+
+local messages = {}
+local levels = {}
+for m in log.decode(filename) do
+    table.insert(messages, m.message)
+    levels[m.message] = m
+end
+test:ok(levels['message 1'] ~= nil and levels['message 3'] ~= nil,
+        'messages from Lua')
+test:is(levels['message 2'].level, 'I', 'level')
+test:ok(levels['message 2'].file:match('logger_binary') ~= nil, 'file')
+test:is(levels['message 2'].cord_name, 'main', 'cord name')
+test:ok(levels['{"key":"value"}'] ~= nil, 'table message')
+test:ok(levels['log level 5'] ~= nil, 'message with an integer argument')
+test:ok(levels['ready to accept requests'] ~= nil, 'messages from box')
+
+os.exit(test:check() and 0 or 1)
@@ -258,9 +258,46 @@ local function test_decode_array_map_header(test, s)
     end
 end
 
+local function test_object(test, s)
+    test:plan(13)
+    local ffi = require('ffi')
+    local data = s.encode({1, {a = 'x', b = {10, 20, 30}}, 'tail'})
+    local obj = s.object_from_raw(data)
+    test:is(obj:type(), 'array', 'object type')
+    test:is(#obj, 3, 'object length')
+    test:is(obj:get(1), 1, 'scalars are decoded')
+    test:is(obj:get(2):type(), 'map', 'containers are objects')
+    test:is(obj:get(2, 'b', 3), 30, 'path lookup')
+    test:is(obj:get(2, 'c'), nil, 'missing map key')
+    test:is(obj:get(4), nil, 'missing array index')
+    test:is_deeply(obj:get(2, 'b'):decode(), {10, 20, 30}, 'decode')
+
+    local sum = 0
+    for i, v in obj:get(2, 'b'):pairs() do
+        sum = sum + i * v
+    end
+    test:is(sum, 140, 'array iteration')
+    local keys = {}
+    for k in obj:get(2):pairs() do
+        table.insert(keys, k)
+    end
+    table.sort(keys)
+    test:is_deeply(keys, {'a', 'b'}, 'map iteration')
+
+    local sub = obj:get(2)
+    obj = nil -- luacheck: no unused
+    data = nil -- luacheck: no unused
+    collectgarbage()
+    test:is(sub:get('a'), 'x', 'objects keep the data alive')
+
+    local ptr = ffi.cast('const char *', s.encode({{1}}))
+    test:is(s.object_from_raw(ptr, 3):get(1, 1), 1, "'char *' data")
+    test:ok(not pcall(s.object_from_raw, '\x93\x01'), 'invalid data')
+end
+
 tap.test("msgpack", function(test)
     local serializer = require('msgpack')
-    test:plan(13)
+    test:plan(14)
     test:test("unsigned", common.test_unsigned, serializer)
     test:test("signed", common.test_signed, serializer)
     test:test("double", common.test_double, serializer)
@@ -274,4 +311,5 @@ tap.test("msgpack", function(test)
     test:test("misc", test_misc, serializer)
     test:test("decode_array_map", test_decode_array_map_header, serializer)
     test:test("decode_buffer", common.test_decode_buffer, serializer)
+    test:test("object", test_object, serializer)
 end)
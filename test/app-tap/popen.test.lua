@@ -7,6 +7,7 @@ local fiber = require('fiber')
 local clock = require('clock')
 local tap = require('tap')
 local fun = require('fun')
+local fio = require('fio')
 
 -- For process_is_alive().
 ffi.cdef([[
@@ -308,6 +309,59 @@ local function test_read_chunk(test)
     ph:close()
 end
 
+--
+-- Move data between children and files with read_to() and
+-- write_from() bypassing Lua strings.
+--
+local function test_splice(test)
+    test:plan(7)
+
+    local size = 1000000
+    local dir = fio.tempdir()
+    local path = fio.pathjoin(dir, 'data')
+
+    -- Child's stdout to a file.
+    local ph = popen.shell(('yes | head -c %d'):format(size), 'r')
+    local fh = fio.open(path, {'O_WRONLY', 'O_CREAT'}, tonumber('644', 8))
+    test:is(ph:read_to(fh), size, 'read_to() a file')
+    fh:close()
+    ph:close()
+    fh = fio.open(path)
+    test:is(fh:read(), string.rep('y\n', size / 2), 'file content')
+    fh:close()
+
+    -- A file to child's stdin, child's stdout to another child.
+    local src = popen.shell('cat', 'rw')
+    local dst = popen.shell('wc -c', 'rw')
+    fh = fio.open(path)
+    local latch = fiber.channel(1)
+    fiber.create(function()
+        local res = src:write_from(fh)
+        src:shutdown({stdin = true})
+        latch:put(res)
+    end)
+    test:is(src:read_to(dst), size, 'read_to() another child')
+    test:is(latch:get(), size, 'write_from() a file')
+    dst:shutdown({stdin = true})
+    test:is(tonumber(dst:read()), size, 'data reaches the last child')
+    fh:close()
+    src:close()
+    dst:close()
+
+    -- Size limit and timeout.
+    ph = popen.shell('yes', 'r')
+    fh = fio.open(path, {'O_WRONLY', 'O_TRUNC'})
+    test:is(ph:read_to(fh, {size = 10}), 10, 'size limit')
+    ph:close()
+    ph = popen.shell('read -r prompt', 'rw')
+    local res, err = ph:read_to(fh, {timeout = 0.1})
+    test:is_deeply({res, err.type}, {nil, 'TimedOut'}, 'timeout error')
+    ph:close()
+    fh:close()
+
+    fio.rmtree(dir)
+end
+
 --
 -- Ensure that shutdown() closes asked streams: at least
 -- it is reflected in a handle information.
@@ -459,6 +513,8 @@ local function test_methods_on_closed_handle(test)
         wait      = {},
         read      = {},
         write     = {'hello'},
+        read_to   = {1},
+        write_from = {0},
         info      = {},
         -- Close call is idempotent one.
         close     = nil,
@@ -486,6 +542,8 @@ local function test_methods_on_invalid_handle(test)
         wait      = {},
         read      = {},
         write     = {'hello'},
+        read_to   = {1},
+        write_from = {0},
         info      = {},
         close     = {},
     }
@@ -517,7 +575,7 @@ local function test_methods_on_invalid_handle(test)
 end
 
 local test = tap.test('popen')
-test:plan(11)
+test:plan(12)
 
 test:test('trivial_echo_output', test_trivial_echo_output)
 test:test('kill_child_process', test_kill_child_process)
@@ -525,6 +583,7 @@ test:test('gc', test_gc)
 test:test('read_write', test_read_write)
 test:test('read_timeout', test_read_timeout)
 test:test('read_chunk', test_read_chunk)
+test:test('splice', test_splice)
 test:test('test_shutdown', test_shutdown)
 test:test('shell_invalid_args', test_shell_invalid_args)
 test:test('new_invalid_args', test_new_invalid_args)
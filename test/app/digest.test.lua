@@ -203,3 +203,16 @@ _ = fiber.create(test_pbkdf2)
 _ = sentry:get()
 _ = sentry:get()
 res
+
+-- Async and batched digests.
+digest = require('digest')
+big = string.rep('a', 100000)
+digest.async.sha256(big) == digest.sha256(big)
+digest.async.sha1_hex('abc') == digest.sha1_hex('abc')
+digest.async.md5_hex('') == digest.md5_hex('')
+strings = {'', 'abc', big}
+hashes = digest.crc32_batch(strings)
+hashes[1] == digest.crc32('') and hashes[2] == digest.crc32('abc') and hashes[3] == digest.crc32(big)
+hashes = digest.murmur_batch(strings)
+hashes[1] == digest.murmur('') and hashes[2] == digest.murmur('abc') and hashes[3] == digest.murmur(big)
+pcall(digest.crc32_batch, {1})
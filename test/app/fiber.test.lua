@@ -737,3 +737,13 @@ con = require('net.box').connect(box.cfg.listen)
 pcall(con.eval, con, 'fiber.cancel(fiber.self())')
 con:eval('fiber.sleep(0) return "Ok"')
 box.schema.user.revoke('guest', 'execute', 'universe')
+
+-- Long slice warnings.
+clock = require('clock')
+fiber.set_slice_warn_threshold(0.01)
+deadline = clock.monotonic() + 0.05
+while clock.monotonic() < deadline do end
+fiber.yield()
+fiber.set_slice_warn_threshold(0)
+test_run:grep_log("default", "has been running for [0-9.]+ ms without yielding") ~= nil
+fiber.set_slice_warn_threshold()
@@ -210,3 +210,19 @@ refs
 ch:close()
 collectgarbage('collect')
 refs -- must be zero
+
+-- batched put and get
+ch = fiber.channel(4)
+ch:put_many({1, 2, 3})
+ch:get_many(2)
+ch:get_many(10)
+ch:put_many({1, 2, 3, 4, 5}, 0)
+ch:get_many(10, 0)
+ch:get_many(10, 0)
+ch:put_many({})
+f = fiber.create(function() ch:put_many({1, 2, 3, 4, 5, 6, 7, 8}) end)
+ch:get_many(10)
+ch:get_many(10)
+ch:close()
+ch:put_many({1})
+ch:get_many(1)
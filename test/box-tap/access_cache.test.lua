@@ -0,0 +1,52 @@
+#!/usr/bin/env tarantool
+
+--
+-- Results of successful access checks are cached in session
+-- credentials. Check that the cache is invalidated by changes
+-- of privileges and objects.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+
+local test = tap.test('access_cache')
+test:plan(8)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+
+box.schema.user.create('tester', {password = 'secret'})
+box.schema.func.create('f')
+rawset(_G, 'f', function() return true end)
+local s = box.schema.space.create('test')
+s:create_index('pk')
+box.schema.user.grant('tester', 'read', 'space', 'test')
+box.schema.user.grant('tester', 'execute', 'function', 'f')
+
+local conn = net_box.connect(box.cfg.listen,
+                             {user = 'tester', password = 'secret'})
+local space = conn.space.test
+
+test:ok(pcall(space.select, space), 'select is allowed')
+test:ok(pcall(space.select, space), 'select is allowed again')
+test:ok(pcall(conn.call, conn, 'f'), 'call is allowed')
+test:ok(not pcall(space.replace, space, {1}), 'replace is denied')
+
+box.schema.user.revoke('tester', 'read', 'space', 'test')
+box.schema.user.revoke('tester', 'execute', 'function', 'f')
+test:ok(not pcall(space.select, space), 'select is denied after revoke')
+test:ok(not pcall(conn.call, conn, 'f'), 'call is denied after revoke')
+
+box.schema.user.grant('tester', 'read', 'space', 'test')
+test:ok(pcall(space.select, space), 'select is allowed after grant')
+s:drop()
+s = box.schema.space.create('test')
+s:create_index('pk')
+conn:reload_schema()
+test:ok(not pcall(conn.space.test.select, conn.space.test),
+        'select is denied in a recreated space')
+
+conn:close()
+s:drop()
+box.schema.func.drop('f')
+box.schema.user.drop('tester')
+
+os.exit(test:check() and 0 or 1)
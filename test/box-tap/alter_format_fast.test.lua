@@ -0,0 +1,57 @@
+#!/usr/bin/env tarantool
+
+--
+-- A format change that can't make stored tuples invalid doesn't
+-- scan the space. The scan refuses to run in a multi-statement
+-- transaction, which is used here to tell the two cases apart.
+--
+local tap = require('tap')
+
+local test = tap.test('alter_format_fast')
+test:plan(6)
+
+box.cfg{}
+
+local s = box.schema.space.create('test', {field_count = 2})
+s:create_index('pk')
+for i = 1, 100 do
+    s:insert({i, 'x'})
+end
+local aux = box.schema.space.create('aux')
+aux:create_index('pk')
+
+local function alter_in_txn(ops)
+    box.begin()
+    aux:replace({1})
+    local ok = pcall(box.space._space.update, box.space._space,
+                     {s.id}, ops)
+    if ok then
+        box.commit()
+    else
+        box.rollback()
+    end
+    return ok
+end
+
+local format = {
+    {'a', 'unsigned'},
+    {'b', 'string'},
+    {'c', 'string', is_nullable = true},
+}
+test:ok(alter_in_txn({{'=', 5, 0}, {'=', 7, format}}),
+        'field count is dropped and a field is added without a scan')
+test:is(s:count(), 100, 'data is intact')
+test:ok(pcall(s.insert, s, {101, 'x', 'y'}), 'new field can be used')
+
+table.insert(format, {'d', 'string', is_nullable = true})
+test:ok(not alter_in_txn({{'=', 7, format}}),
+        'a field that old tuples may have is checked')
+test:ok(pcall(s.format, s, format), 'the check passes')
+test:ok(not pcall(box.space._space.update, box.space._space,
+                  {s.id}, {{'=', 5, 3}}),
+        'field count is checked when set')
+
+aux:drop()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
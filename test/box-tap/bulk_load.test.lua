@@ -0,0 +1,69 @@
+#!/usr/bin/env tarantool
+
+--
+-- space:bulk_load() fills an empty memtx space with tuples
+-- sorted by the primary key, building indexes in bulk.
+--
+local tap = require('tap')
+local msgpack = require('msgpack')
+
+local test = tap.test('bulk_load')
+test:plan(12)
+
+box.cfg{}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+s:create_index('uk', {parts = {3, 'string'}})
+
+local loader = s:bulk_load()
+for i = 1, 500 do
+    loader:insert({i, i % 10, 'v' .. i})
+end
+local chunk = {}
+for i = 501, 1000 do
+    table.insert(chunk, msgpack.encode({i, i % 10, 'v' .. i}))
+end
+loader:write(table.concat(chunk))
+test:is(s:count(), 0, 'nothing is visible before commit')
+loader:commit()
+
+test:is(s:count(), 1000, 'primary index')
+test:is(s.index.sk:count({3}), 100, 'secondary index')
+test:is(s.index.uk:get({'v777'})[1], 777, 'unique secondary index')
+test:ok(s:bsize() > 0, 'bsize is updated')
+test:ok(not pcall(loader.insert, loader, {1001, 1, 'v1001'}),
+        'loader is closed by commit')
+
+local ok, err = pcall(s.bulk_load, s)
+test:ok(not ok and err.code == box.error.UNSUPPORTED, 'non-empty space')
+s:truncate()
+
+loader = s:bulk_load()
+loader:insert({2, 1, 'a'})
+ok, err = pcall(loader.insert, loader, {1, 1, 'b'})
+test:ok(not ok and err.code == box.error.ILLEGAL_PARAMS, 'unsorted input')
+ok, err = pcall(loader.insert, loader, {2, 1, 'b'})
+test:ok(not ok and err.code == box.error.TUPLE_FOUND, 'duplicate key')
+
+-- A duplicate in a secondary index rolls back the whole load.
+loader:insert({3, 1, 'a'})
+ok, err = pcall(loader.commit, loader)
+test:ok(not ok and err.code == box.error.TUPLE_FOUND and s:count() == 0,
+        'duplicate in unique secondary index')
+
+loader = s:bulk_load()
+loader:insert({1, 1, 'a'})
+loader:rollback()
+test:is(s:count(), 0, 'rollback')
+
+local v = box.schema.space.create('vinyl', {engine = 'vinyl'})
+v:create_index('pk')
+ok, err = pcall(v.bulk_load, v)
+test:ok(not ok and err.code == box.error.UNSUPPORTED, 'vinyl')
+
+v:drop()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
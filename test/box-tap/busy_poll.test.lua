@@ -0,0 +1,64 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cfg.busy_poll_timeout: tx and network threads poll their
+-- cbus endpoints for a while before going to sleep.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local net_box = require('net.box')
+
+local test = tap.test('busy_poll')
+test:plan(6)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local ok, err = pcall(box.cfg, {busy_poll_timeout = -1})
+test:ok(not ok and tostring(err):match('busy_poll_timeout') ~= nil,
+        'busy_poll_timeout must not be negative')
+
+box.cfg{busy_poll_timeout = 0.0001}
+test:is(box.cfg.busy_poll_timeout, 0.0001, 'box.cfg.busy_poll_timeout')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local function load(conn, fiber_count, row_count)
+    local cond = fiber.cond()
+    local done = 0
+    for i = 1, fiber_count do
+        fiber.create(function()
+            for j = 1, row_count do
+                conn.space.test:replace{(i - 1) * row_count + j}
+            end
+            done = done + 1
+            cond:signal()
+        end)
+    end
+    while done < fiber_count do
+        cond:wait()
+    end
+end
+
+local conn = net_box.connect(box.cfg.listen)
+load(conn, 10, 100)
+test:is(s:count(), 1000, 'requests are served while polling')
+
+-- An idle instance still responds.
+fiber.sleep(0.1)
+test:is(conn:ping(), true, 'ping after idle period')
+
+box.cfg{busy_poll_timeout = 0}
+s:truncate()
+load(conn, 10, 100)
+test:is(s:count(), 1000, 'requests are served after polling is off')
+
+box.cfg{busy_poll_timeout = 0.0001}
+box.cfg{busy_poll_timeout = 0.0001}
+test:is(conn.space.test:get{1000}[1], 1000, 'polling is set twice')
+
+conn:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
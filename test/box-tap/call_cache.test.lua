@@ -0,0 +1,43 @@
+#!/usr/bin/env tarantool
+
+--
+-- IPROTO_CALL remembers what a function name refers to. Check
+-- that redefinition of Lua functions and changes of registered
+-- functions are still seen by clients.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+
+local test = tap.test('call_cache')
+test:plan(7)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'execute', 'universe')
+
+local conn = net_box.connect(box.cfg.listen)
+
+rawset(_G, 'f', function() return 1 end)
+test:is(conn:call('f'), 1, 'global function')
+rawset(_G, 'f', function() return 2 end)
+test:is(conn:call('f'), 2, 'redefined global function')
+
+box.schema.func.create('f', {body = 'function() return 3 end'})
+test:is(conn:call('f'), 3, 'registered function')
+box.schema.func.drop('f')
+test:is(conn:call('f'), 2, 'dropped function')
+
+rawset(_G, 'm', {f = function() return 4 end})
+test:is(conn:call('m.f'), 4, 'function in a table')
+rawset(_G, 'm', {f = function() return 5 end})
+test:is(conn:call('m.f'), 5, 'redefined table')
+
+local obj = {x = 6}
+function obj:get() return self.x end
+rawset(_G, 'obj', obj)
+obj.x = 7
+test:is(conn:call('obj:get'), 7, 'method')
+
+conn:close()
+box.schema.user.revoke('guest', 'execute', 'universe')
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,86 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cdc cursors read changes of the given spaces from the
+-- in-memory WAL or xlog files and resume reading by vclock.
+--
+local tap = require('tap')
+
+local test = tap.test('cdc')
+test:plan(13)
+
+box.cfg{log = 'tarantool.log'}
+
+local feed = box.schema.space.create('feed', {engine = 'blackhole'})
+local other = box.schema.space.create('other')
+other:create_index('pk')
+
+local function keys(changes)
+    local result = {}
+    for _, change in ipairs(changes) do
+        table.insert(result, change.tuple ~= nil and change.tuple[1] or
+                             change.key[1])
+    end
+    return result
+end
+
+local cursor = box.cdc.cursor({name = 'feed', spaces = {feed}})
+local changes, vclock = cursor:fetch()
+test:is(#changes, 0, 'no changes')
+
+feed:insert({1, 'a'})
+other:insert({1})
+feed:replace({2, 'b'})
+feed:update({1}, {{'=', 2, 'c'}})
+feed:delete({2})
+changes, vclock = cursor:fetch()
+test:is_deeply(keys(changes), {1, 2, 1, 2}, 'changes of the space')
+test:is_deeply({changes[1].type, changes[2].type, changes[3].type,
+                changes[4].type}, {'INSERT', 'REPLACE', 'UPDATE', 'DELETE'},
+               'change types')
+test:is_deeply(changes[3].ops, {{'=', 2, 'c'}}, 'update operations')
+test:is(changes[4].lsn, vclock[box.info.id], 'vclock of the batch')
+
+local found = false
+for _, consumer in ipairs(box.info.gc().consumers) do
+    found = found or consumer.name == 'cdc feed'
+end
+test:ok(found, 'cursor pins WAL files')
+
+-- Transactions aren't split between batches.
+for i = 3, 5 do
+    feed:insert({i})
+end
+box.begin()
+for i = 6, 8 do
+    feed:insert({i})
+end
+box.commit()
+changes, vclock = cursor:fetch(2)
+test:is_deeply(keys(changes), {3, 4}, 'batch limit')
+test:is_deeply(keys(cursor:fetch(2)), {5, 6, 7, 8}, 'whole transaction')
+
+-- A new cursor opened at the vclock of a batch resumes after it.
+local resumed = box.cdc.cursor({spaces = {feed.id}, vclock = vclock})
+test:is_deeply(keys(resumed:fetch()), {5, 6, 7, 8}, 'resumed cursor')
+resumed:close()
+
+-- Read rows from xlog files if they aren't in memory.
+box.cfg{wal_tail_size = 0}
+box.snapshot()
+feed:insert({9})
+resumed = box.cdc.cursor({spaces = {feed.id}, vclock = vclock})
+test:is_deeply(keys(resumed:fetch()), {5, 6, 7, 8, 9}, 'read from disk')
+test:is_deeply(keys(resumed:fetch()), {}, 'no more changes on disk')
+resumed:close()
+
+local ok = pcall(cursor.ack, cursor, {[box.info.id] = box.info.lsn + 1})
+test:ok(not ok, 'ack of unread changes')
+cursor:ack()
+cursor:close()
+test:ok(not pcall(cursor.fetch, cursor), 'cursor is closed')
+
+feed:drop()
+other:drop()
+
+os.exit(test:check() and 0 or 1)
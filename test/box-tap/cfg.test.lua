@@ -6,7 +6,7 @@ local socket = require('socket')
 local fio = require('fio')
 local uuid = require('uuid')
 local msgpack = require('msgpack')
-test:plan(108)
+test:plan(113)
 
 --------------------------------------------------------------------------------
 -- Invalid values
@@ -160,6 +160,17 @@ test:ok(box.space._schema:delete{'read_only'}, "drop read_only")
 -- gh-2663: box.cfg() parameter to set the number of coio threads
 box.cfg({ worker_pool_threads = 1})
 test:is(box.cfg.worker_pool_threads, 1, 'worker_pool_threads')
+box.cfg({ worker_pool_file_threads = 2, worker_pool_resolve_threads = 1})
+test:is(box.cfg.worker_pool_file_threads, 2, 'worker_pool_file_threads')
+test:is(box.cfg.worker_pool_resolve_threads, 1,
+        'worker_pool_resolve_threads')
+status, result = pcall(box.cfg, {worker_pool_file_threads = 0})
+test:ok(not status and result:match('worker_pool_file_threads'),
+        'worker_pool_file_threads = 0')
+local stat = box.stat.worker_pool()
+test:ok(stat.file ~= nil and stat.resolve ~= nil and stat.call ~= nil,
+        'box.stat.worker_pool()')
+test:is(stat.file.queued, 0, 'no queued file tasks')
 
 local tarantool_bin = arg[-1]
 local PANIC = 256
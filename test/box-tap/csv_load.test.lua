@@ -0,0 +1,81 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.csv_load() parses a CSV file in a coio thread, converts
+-- fields according to the space format and inserts rows in
+-- batches.
+--
+local tap = require('tap')
+local fio = require('fio')
+
+local test = tap.test('csv_load')
+test:plan(10)
+
+box.cfg{log = 'tarantool.log'}
+
+local dir = fio.tempdir()
+local function write_file(name, data)
+    local path = fio.pathjoin(dir, name)
+    local f = fio.open(path, {'O_CREAT', 'O_WRONLY', 'O_TRUNC'},
+                       tonumber('644', 8))
+    f:write(data)
+    f:close()
+    return path
+end
+
+local s = box.schema.space.create('test', {format = {
+    {'id', 'unsigned'},
+    {'name', 'string'},
+    {'score', 'number', is_nullable = true},
+    {'delta', 'integer'},
+    {'flag', 'boolean'},
+}})
+s:create_index('pk')
+
+local path = write_file('data.csv', table.concat({
+    'id,name,score,delta,flag',
+    '1,one,1.5,-1,true',
+    '2,"two, quoted",,2,false',
+    '',
+    '3,three,7,-3,true,extra',
+}, '\n') .. '\n')
+
+test:is(box.csv_load(s.id, path, {skip_head_lines = 1}), 3, 'row count')
+test:is_deeply(s:get{1}:totable(), {1, 'one', 1.5, -1, true}, 'converted')
+local t = s:get{2}
+test:ok(t[2] == 'two, quoted' and t[3] == nil and t[4] == 2 and
+        t[5] == false, 'quoted and null')
+test:is_deeply(s:get{3}:totable(), {3, 'three', 7, -3, true, 'extra'},
+               'extra field')
+s:truncate()
+
+-- Many rows in small batches.
+local rows = {}
+for i = 1, 10000 do
+    table.insert(rows, string.format('%d;name%d;%d;%d;true', i, i, i, -i))
+end
+path = write_file('big.csv', table.concat(rows, '\n'))
+test:is(box.csv_load(s.id, path, {delimiter = ';', batch_size = 100}),
+        10000, 'big file')
+test:is(s:count(), 10000, 'big file is loaded')
+s:truncate()
+
+-- Conversion error.
+path = write_file('bad.csv', '1,a,1,1,true\n2,b,1,1,true\nx,c,1,1,true\n')
+local ok, err = pcall(box.csv_load, s.id, path, {batch_size = 1})
+test:ok(not ok and tostring(err):match('CSV row 3, field 1') ~= nil,
+        'conversion error')
+
+-- Insert error.
+path = write_file('dup.csv', '5,a,1,1,true\n5,b,1,1,true\n')
+ok, err = pcall(box.csv_load, s.id, path)
+test:ok(not ok and err.code == box.error.TUPLE_FOUND, 'duplicate key')
+test:is(s:get{5}, nil, 'failed batch is rolled back')
+
+ok = pcall(box.csv_load, s.id, fio.pathjoin(dir, 'missing.csv'))
+test:ok(not ok, 'missing file')
+
+s:drop()
+fio.rmtree(dir)
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,83 @@
+#!/usr/bin/env tarantool
+
+--
+-- Formats which guarantee that indexed fields are located in the
+-- first 64 KB of a tuple store 16-bit offsets in field maps.
+--
+local tap = require('tap')
+
+local test = tap.test('field_map_compact')
+test:plan(8)
+
+box.cfg{log = 'tarantool.log'}
+
+local long = string.rep('x', 70000)
+
+local function check(test, format, gen_b)
+    test:plan(4)
+    local s = box.schema.space.create('test', {format = format})
+    s:create_index('pk')
+    s:create_index('sk1', {parts = {3, 'unsigned'}, unique = false})
+    s:create_index('sk2', {parts = {{4, 'string'}, {1, 'unsigned'}}})
+    for i = 1, 100 do
+        s:replace{i, gen_b(i), i % 7, (i % 2 == 0 and long or '') .. i,
+                  long}
+    end
+    local ok = true
+    for i = 0, 6 do
+        for _, t in s.index.sk1:pairs({i}) do
+            ok = ok and t[3] == i and t[1] % 7 == i
+        end
+    end
+    test:ok(ok, 'lookup by the first secondary key')
+    local t = s.index.sk2:get({long .. '42', 42})
+    test:is(t ~= nil and t[2], gen_b(42), 'lookup by another key')
+    test:is(s.index.sk2:count({'41'}), 1, 'count')
+    s:update({50}, {{'=', 3, 1000}})
+    test:is(s.index.sk1:get({1000})[1], 50, 'update')
+    s:drop()
+end
+
+-- Indexed fields follow numeric fields only.
+test:test('compact', check, {{'a', 'unsigned'}, {'b', 'integer'},
+                             {'c', 'unsigned'}, {'d', 'string'}},
+          function(i) return 100 - i end)
+-- An indexed field may be beyond 64 KB.
+test:test('not compact', check, {{'a', 'unsigned'}, {'b', 'string'},
+                                 {'c', 'unsigned'}, {'d', 'string'}},
+          function(i) return long .. i end)
+
+-- The layout is chosen by format, tuples inserted before
+-- a format change keep the old one.
+local s = box.schema.space.create('test')
+s:format({{'a', 'unsigned'}, {'b', 'any'}})
+s:create_index('pk')
+s:create_index('sk', {parts = {3, 'unsigned'}})
+for i = 1, 10 do
+    s:replace{i, i, i * 10}
+end
+s:format({{'a', 'unsigned'}, {'b', 'unsigned'}})
+s:replace{11, 11, 110}
+test:is(s.index.sk:get{50}[1], 5, 'old tuples after format change')
+test:is(s.index.sk:get{110}[1], 11, 'new tuples after format change')
+s:drop()
+
+-- Nullable and missing fields.
+s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('sk', {parts = {{2, 'integer', is_nullable = true}},
+                      unique = false})
+s:create_index('tk', {parts = {{3, 'boolean', is_nullable = true}},
+                      unique = false})
+s:replace{1}
+s:replace{2, -2}
+s:replace{3, box.NULL, true}
+test:is(s.index.sk:select({box.NULL})[1][1], 1, 'missing field')
+test:is(s.index.tk:select({true})[1][1], 3, 'nullable field')
+box.snapshot()
+test:is(#s.index.sk:select({-2}), 1, 'after snapshot')
+s:drop()
+
+test:is(box.tuple.new({1, 2, 3}):totable()[3], 3, 'runtime tuple')
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,76 @@
+#!/usr/bin/env tarantool
+
+--
+-- On update a functional index compares the keys returned for
+-- the old and the new tuple and touches only the changed ones.
+-- Check that the index stays consistent with the space.
+--
+local tap = require('tap')
+
+local test = tap.test('func_index_diff')
+test:plan(5)
+
+box.cfg{}
+
+box.schema.func.create('keys', {
+    body = [[function(tuple)
+        local keys = {}
+        for _, v in ipairs(tuple[2]) do
+            table.insert(keys, {v})
+        end
+        return keys
+    end]],
+    is_deterministic = true, is_sandboxed = true,
+    opts = {is_multikey = true},
+})
+local s = box.schema.space.create('test')
+s:create_index('pk')
+local sk = s:create_index('sk', {func = 'keys', unique = false,
+                                 parts = {{1, 'unsigned'}}})
+local uk = s:create_index('uk', {func = 'keys', unique = true,
+                                 parts = {{1, 'unsigned'}}})
+
+local function check()
+    local expected = {}
+    for _, t in s:pairs() do
+        for _, v in ipairs(t[2]) do
+            table.insert(expected, {v, t[1]})
+        end
+    end
+    table.sort(expected, function(a, b)
+        return a[1] < b[1] or a[1] == b[1] and a[2] < b[2]
+    end)
+    for _, index in ipairs({sk, uk}) do
+        local got = {}
+        for _, t in index:pairs() do
+            table.insert(got, t[1])
+        end
+        if #got ~= #expected then
+            return false
+        end
+        for i, e in ipairs(expected) do
+            if got[i] ~= e[2] or uk:get({e[1]})[1] ~= e[2] then
+                return false
+            end
+        end
+    end
+    return true
+end
+
+s:insert({1, {1, 2, 3}, 'a'})
+s:insert({2, {4, 5}, 'a'})
+s:update(1, {{'=', 3, 'b'}})
+test:ok(check(), 'unchanged keys')
+s:update(1, {{'=', 2, {3, 6, 1}}})
+test:ok(check(), 'changed keys')
+s:replace({2, {5, 7, 8, 4}, 'c'})
+test:ok(check(), 'added keys')
+test:ok(not pcall(s.update, s, 2, {{'=', 2, {5, 6}}}),
+        'unique constraint')
+s:replace({1, {}, 'd'})
+test:ok(check(), 'removed keys')
+
+s:drop()
+box.schema.func.drop('keys')
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,91 @@
+#!/usr/bin/env tarantool
+
+--
+-- Sandboxed persistent Lua functions with the is_parallel
+-- option are executed in worker threads.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local net_box = require('net.box')
+
+local test = tap.test('func_parallel')
+test:plan(9)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0',
+        func_worker_threads = 2}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local ok, err = pcall(box.schema.func.create, 'f', {
+    body = 'function() return 1 end', opts = {is_parallel = true}})
+test:ok(not ok and err.code == box.error.CREATE_FUNCTION,
+        'a parallel function must be sandboxed')
+
+box.schema.func.create('sum', {
+    body = [[function(t, k)
+        local s = 0
+        for _, v in ipairs(t) do s = s + v * k end
+        return s, {sum = s}, 'done'
+    end]],
+    is_sandboxed = true, opts = {is_parallel = true}})
+test:is_deeply({box.func.sum:call({{1, 2, 3}, 2})}, {12, {sum = 12}, 'done'},
+               'call from Lua')
+
+local conn = net_box.connect(box.cfg.listen)
+test:is_deeply({conn:call('sum', {{4, 5}, 1})}, {9, {sum = 9}, 'done'},
+               'call over iproto')
+
+box.schema.func.create('spin', {
+    body = [[function(n)
+        local x = 0
+        for i = 1, n do x = x + i % 7 end
+        return x
+    end]],
+    is_sandboxed = true, opts = {is_parallel = true}})
+local ran = false
+fiber.new(function() ran = true end)
+box.func.spin:call({1e6})
+test:ok(ran, 'tx fibers run while a parallel function is executed')
+
+local futures = {}
+for i = 1, 8 do
+    futures[i] = conn:call('spin', {i}, {is_async = true})
+end
+local results = {}
+for i = 1, 8 do
+    results[i] = futures[i]:wait_result()[1]
+end
+test:is_deeply(results, {1, 3, 6, 10, 15, 21, 21, 22}, 'concurrent calls')
+
+box.schema.func.create('no_box', {
+    body = 'function() return box.space end',
+    is_sandboxed = true, opts = {is_parallel = true}})
+ok, err = pcall(box.func.no_box.call, box.func.no_box)
+test:ok(not ok and tostring(err):match("global 'box'") ~= nil,
+        'no database access')
+
+box.schema.func.create('fail', {
+    body = 'function() error("oops") end',
+    is_sandboxed = true, opts = {is_parallel = true}})
+ok, err = pcall(conn.call, conn, 'fail')
+test:ok(not ok and tostring(err):match('oops') ~= nil, 'error')
+
+-- A function redefined with the same name gets the new body.
+box.schema.func.drop('sum')
+box.schema.func.create('sum', {
+    body = 'function(a, b) return a + b end',
+    is_sandboxed = true, opts = {is_parallel = true}})
+test:is(conn:call('sum', {1, 2}), 3, 'redefined function')
+
+-- Library tables aren't shared by functions.
+box.schema.func.create('patch', {
+    body = 'function() string.sub = nil return 1 end',
+    is_sandboxed = true, opts = {is_parallel = true}})
+box.schema.func.create('use', {
+    body = "function() return string.sub('abc', 2) end",
+    is_sandboxed = true, opts = {is_parallel = true}})
+box.func.patch:call()
+test:is(box.func.use:call(), 'bc', 'sandboxes are isolated')
+
+conn:close()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,104 @@
+#!/usr/bin/env tarantool
+
+--
+-- index:get_batch() looks up several keys in one request.
+-- Missing keys are skipped, the order of found tuples follows
+-- the order of keys.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+
+local test = tap.test('get_batch')
+test:plan(6)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0',
+        log = 'tarantool.log'}
+box.schema.user.grant('guest', 'super')
+
+local function check(test, engine)
+    test:plan(7)
+    local s = box.schema.space.create('test', {engine = engine})
+    s:create_index('pk')
+    s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+    for i = 1, 100 do
+        s:replace{i, i % 10}
+    end
+    test:is_deeply(s:get_batch({5, {3}, 200, 1}), {{5, 5}, {3, 3}, {1, 1}},
+                   'found tuples in order of keys')
+    test:is_deeply(s:get_batch({}), {}, 'empty batch')
+    local ok = pcall(s.index.sk.get_batch, s.index.sk, {1})
+    test:ok(not ok, 'non-unique index')
+    ok = pcall(s.get_batch, s, {{1, 2}})
+    test:ok(not ok, 'partial key is not allowed')
+
+    box.snapshot()
+    local keys = {}
+    local expected = {}
+    for i = 100, 1, -3 do
+        table.insert(keys, i)
+        table.insert(expected, {i, i % 10})
+    end
+    test:is_deeply(s:get_batch(keys), expected, 'lookups after dump')
+
+    local c = net_box.connect(box.cfg.listen)
+    local remote = c.space.test
+    local res = {}
+    for _, t in ipairs(remote:get_batch({7, 101, 2})) do
+        table.insert(res, t:totable())
+    end
+    test:is_deeply(res, {{7, 7}, {2, 2}}, 'net.box space:get_batch()')
+    res = {}
+    for _, t in ipairs(remote.index.pk:get_batch(keys)) do
+        table.insert(res, t:totable())
+    end
+    test:is_deeply(res, expected, 'net.box index:get_batch()')
+    c:close()
+    s:drop()
+end
+
+test:test('memtx', check, 'memtx')
+test:test('vinyl', check, 'vinyl')
+
+-- Memtx indexes look keys up in chunks, check batches which
+-- do not fit in one chunk.
+local function check_memtx_index(test, opts)
+    test:plan(2)
+    local s = box.schema.space.create('test')
+    s:create_index('pk', opts)
+    for i = 1, 100, 2 do
+        s:replace{i}
+    end
+    local keys = {}
+    local expected = {}
+    for i = 1, 100 do
+        table.insert(keys, i)
+        if i % 2 == 1 then
+            table.insert(expected, {i})
+        end
+    end
+    test:is_deeply(s:get_batch(keys), expected, 'large batch')
+    box.begin()
+    s:delete{3}
+    s:replace{4}
+    test:is_deeply(s:get_batch({1, 3, 4, 5}), {{1}, {4}, {5}},
+                   'batch in a transaction')
+    box.rollback()
+    s:drop()
+end
+
+test:test('memtx tree', check_memtx_index, {type = 'tree'})
+test:test('memtx hash', check_memtx_index, {type = 'hash'})
+test:test('memtx swiss', check_memtx_index,
+          {type = 'hash', hash_type = 'swiss'})
+
+-- Lookups are accounted as SELECT requests.
+local s = box.schema.space.create('stat')
+s:create_index('pk')
+local select_total = box.stat().SELECT.total
+s:get_batch({1, 2, 3})
+test:is(box.stat().SELECT.total - select_total, 3, 'box.stat()')
+s:drop()
+
+box.schema.user.revoke('guest', 'super')
+
+os.exit(test:check() and 0 or 1)
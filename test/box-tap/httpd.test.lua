@@ -0,0 +1,109 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.httpd runs an HTTP/1.1 server in a separate thread and
+-- passes requests to a Lua handler in the tx thread.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local socket = require('socket')
+local http_client = require('http.client')
+
+local test = tap.test('httpd')
+test:plan(14)
+
+local ok, err = pcall(box.httpd.new, 'localhost:0', function() end)
+test:ok(not ok and err:match('box.cfg') ~= nil, 'box.cfg is required')
+
+box.cfg{log = 'tarantool.log'}
+
+local last
+local srv = box.httpd.new('localhost:0', function(req)
+    last = req
+    if req.path == '/error' then
+        error('handler error')
+    elseif req.path == '/table' then
+        return {status = 201, headers = {['x-test'] = 'yes'},
+                body = req.body}
+    end
+    return 'hello'
+end, {max_body_size = 16})
+local url = 'http://' .. srv:info().listen
+
+local client = http_client.new()
+local r = client:get(url .. '/path?a=b', {headers = {['X-Foo'] = 'bar'}})
+test:is(r.status, 200, 'status')
+test:is(r.body, 'hello', 'body')
+test:is_deeply({last.method, last.path, last.query, last.headers['x-foo']},
+               {'GET', '/path', 'a=b', 'bar'}, 'request')
+
+r = client:post(url .. '/table', 'data')
+test:is_deeply({r.status, r.headers['x-test'], r.body}, {201, 'yes', 'data'},
+               'table response')
+
+r = client:get(url .. '/error')
+test:is(r.status, 500, 'handler error')
+
+r = client:post(url .. '/table', string.rep('x', 17))
+test:is(r.status, 413, 'body is too large')
+
+--
+-- Pipelined requests on a keep-alive connection are answered
+-- in order.
+--
+local s = socket.tcp_connect(srv:info().listen:match('(.+):(%d+)$'))
+s:write('GET /1 HTTP/1.1\r\nHost: x\r\n\r\n' ..
+        'POST /table HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc' ..
+        'GET /3 HTTP/1.1\r\nConnection: close\r\n\r\n')
+local data = ''
+while true do
+    local chunk = s:read(4096, 5)
+    if chunk == nil or chunk == '' then
+        break
+    end
+    data = data .. chunk
+end
+s:close()
+local statuses = {}
+for status in data:gmatch('HTTP/1.1 (%d+)') do
+    table.insert(statuses, tonumber(status))
+end
+test:is_deeply(statuses, {200, 201, 200}, 'pipelining')
+test:ok(data:match('abc') ~= nil, 'pipelined body')
+
+s = socket.tcp_connect(srv:info().listen:match('(.+):(%d+)$'))
+s:write('GET / HTTP/2.0\r\n\r\n')
+test:ok(s:read(4096, 5):match('^HTTP/1.1 505') ~= nil, 'unsupported version')
+s:close()
+
+s = socket.tcp_connect(srv:info().listen:match('(.+):(%d+)$'))
+s:write('garbage\r\n\r\n')
+test:ok(s:read(4096, 5):match('^HTTP/1.1 400') ~= nil, 'bad request')
+s:close()
+
+test:is(srv:info().requests, 6, 'request count')
+
+--
+-- A handler can yield, other requests are served meanwhile.
+--
+local slow = box.httpd.new('localhost:0', function(req)
+    if req.path == '/slow' then
+        fiber.sleep(0.5)
+    end
+    return req.path
+end)
+local slow_url = 'http://' .. slow:info().listen
+local slow_status
+fiber.create(function()
+    slow_status = client:get(slow_url .. '/slow').status
+end)
+fiber.sleep(0.1)
+r = client:get(slow_url .. '/fast')
+test:ok(r.status == 200 and slow_status == nil, 'handler yields')
+slow:stop()
+test:is(slow_status, 200, 'stop waits for handlers')
+
+srv:stop()
+srv:stop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,65 @@
+#!/usr/bin/env tarantool
+
+--
+-- index:foreach() fetches tuples in batches without a Lua
+-- finalizer per tuple.
+--
+local tap = require('tap')
+
+local test = tap.test('index_foreach')
+test:plan(7)
+
+box.cfg{}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+for i = 1, 1000 do
+    s:insert({i, i % 10})
+end
+
+local function collect(index, key, opts)
+    local res = {}
+    index:foreach(function(t) table.insert(res, t[1]) end, key, opts)
+    return res
+end
+
+local function expected(index, key, opts)
+    local res = {}
+    for _, t in index:pairs(key, opts) do
+        table.insert(res, t[1])
+    end
+    return res
+end
+
+test:is_deeply(collect(s.index.pk), expected(s.index.pk), 'full scan')
+test:is_deeply(collect(s.index.pk, 500, {iterator = 'LE'}),
+               expected(s.index.pk, 500, {iterator = 'LE'}), 'range scan')
+test:is_deeply(collect(s.index.sk, 3), expected(s.index.sk, 3),
+               'secondary index')
+
+local n = 0
+s.index.pk:foreach(function() n = n + 1 return n < 300 end)
+test:is(n, 300, 'scan stops when fn returns false')
+
+local ok = pcall(s.index.pk.foreach, s.index.pk, function(t)
+    if t[1] == 700 then
+        error('stop')
+    end
+end)
+test:ok(not ok, 'error is propagated')
+
+local sum = 0
+s.index.pk:foreach(function(t)
+    s.index.sk:foreach(function(t2) sum = sum + t2[2] end, t[2])
+    return t[1] < 3
+end)
+test:is(sum, 100 * 1 + 100 * 2 + 100 * 3, 'nested scans')
+
+local before = collectgarbage('count')
+s.index.pk:foreach(function(t) return t ~= nil end)
+test:ok(collectgarbage('count') - before < 1024, 'no per-tuple garbage kept')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
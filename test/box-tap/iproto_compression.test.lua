@@ -0,0 +1,78 @@
+#!/usr/bin/env tarantool
+
+--
+-- A net.box connection with compression = 'zstd' sends COMPRESS
+-- request after the greeting, and all the data following it is
+-- compressed in both directions.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local net_box = require('net.box')
+
+local test = tap.test('iproto_compression')
+test:plan(7)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 100 do
+    s:insert{i, string.rep('x', 10000)}
+end
+
+local function sent(f)
+    local bytes = box.stat.net().SENT.total
+    f()
+    return box.stat.net().SENT.total - bytes
+end
+
+local conn = net_box.connect(box.cfg.listen, {compression = 'zstd'})
+test:is(conn.state, 'active', 'compressed connection is active')
+
+local res
+local zstd_bytes = sent(function() res = conn.space.test:select{} end)
+test:ok(#res == 100 and res[100][2] == string.rep('x', 10000),
+        'select result')
+
+local plain = net_box.connect(box.cfg.listen)
+local plain_bytes = sent(function() plain.space.test:select{} end)
+test:ok(zstd_bytes * 10 < plain_bytes, 'output is compressed')
+plain:close()
+
+-- Requests are compressed too.
+conn.space.test:replace{1, string.rep('y', 100000)}
+test:is(s:get{1}[2], string.rep('y', 100000), 'compressed request')
+
+-- Pipelined requests and responses.
+local ok = true
+local done = 0
+local cond = fiber.cond()
+for _ = 1, 10 do
+    fiber.create(function()
+        for i = 2, 100 do
+            ok = ok and conn.space.test:get{i}[2] == s:get{i}[2]
+        end
+        done = done + 1
+        cond:signal()
+    end)
+end
+while done < 10 do
+    cond:wait()
+end
+test:ok(ok, 'concurrent requests')
+conn:close()
+
+conn = net_box.connect(box.cfg.listen, {compression = 'lz77'})
+test:ok(conn.state == 'error' and
+        conn.error:match('does not support compression') ~= nil,
+        'unknown compression')
+conn:close()
+
+conn = net_box.connect(box.cfg.listen, {compression = 'none'})
+test:is(conn:ping(), true, 'no compression')
+conn:close()
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,83 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.session.priority() sets the priority class of an iproto
+-- session. Low priority sessions may use a quarter of
+-- net_msg_max, high priority ones may exceed it by a quarter.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local net_box = require('net.box')
+
+local test = tap.test('iproto_priority')
+test:plan(10)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0', net_msg_max = 4}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+test:is(box.session.priority(), 'normal', 'default priority')
+local ok, err = pcall(box.session.priority, 'low')
+test:ok(not ok and err.code == box.error.UNSUPPORTED,
+        'not an iproto session')
+
+local conn = net_box.connect(box.cfg.listen)
+test:is(conn:eval("return box.session.priority('low')"), 'low', 'set')
+test:is(conn:eval('return box.session.priority()'), 'low', 'get')
+ok, err = pcall(conn.eval, conn, "box.session.priority('urgent')")
+test:ok(not ok and err.code == box.error.ILLEGAL_PARAMS, 'invalid priority')
+conn:close()
+
+local blocked = 0
+local released = false
+local cond = fiber.cond()
+rawset(_G, 'block', function()
+    blocked = blocked + 1
+    while not released do
+        cond:wait()
+    end
+end)
+
+local function wait_blocked(count)
+    local deadline = fiber.clock() + 10
+    while blocked < count and fiber.clock() < deadline do
+        fiber.sleep(0.01)
+    end
+    -- Make sure no more requests get through.
+    fiber.sleep(0.1)
+    return blocked
+end
+
+local low = net_box.connect(box.cfg.listen)
+low:eval("box.session.priority('low')")
+local high = net_box.connect(box.cfg.listen)
+high:eval("box.session.priority('high')")
+local normal = net_box.connect(box.cfg.listen)
+
+local futures = {}
+for _ = 1, 5 do
+    table.insert(futures, low:call('block', {}, {is_async = true}))
+end
+test:is(wait_blocked(2), 2, 'low priority limit')
+
+for _ = 1, 5 do
+    table.insert(futures, normal:call('block', {}, {is_async = true}))
+end
+test:is(wait_blocked(5), 5, 'net_msg_max limit')
+
+local other = net_box.connect(box.cfg.listen, {wait_connected = false})
+test:is(other:ping({timeout = 0.1}), false, 'normal priority is stopped')
+test:is(high:ping(), true, 'high priority is served')
+
+released = true
+cond:broadcast()
+for _, f in ipairs(futures) do
+    f:wait_result()
+end
+test:is(blocked, 10, 'stopped requests are resumed')
+
+other:close()
+low:close()
+high:close()
+normal:close()
+
+os.exit(test:check() and 0 or 1)
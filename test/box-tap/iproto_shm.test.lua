@@ -0,0 +1,75 @@
+#!/usr/bin/env tarantool
+
+--
+-- A net.box connection to a unix socket with shm = true passes
+-- shared memory rings to the server after the greeting, and all
+-- the data following it goes through the rings.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local net_box = require('net.box')
+
+local test = tap.test('iproto_shm')
+test:plan(7)
+
+box.cfg{listen = 'unix/:./iproto_shm.sock'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 100 do
+    s:insert{i, string.rep('x', 10000)}
+end
+
+local disconnected = 0
+box.session.on_disconnect(function() disconnected = disconnected + 1 end)
+
+local conn = net_box.connect(box.cfg.listen, {shm = true})
+test:is(conn.state, 'active', 'shared memory connection is active')
+
+-- The response is bigger than the ring.
+local res = conn.space.test:select{}
+test:ok(#res == 100 and res[100][2] == string.rep('x', 10000),
+        'select result')
+
+conn.space.test:replace{1, string.rep('y', 100000)}
+test:is(s:get{1}[2], string.rep('y', 100000), 'big request')
+
+-- Pipelined requests and responses.
+local ok = true
+local done = 0
+local cond = fiber.cond()
+for _ = 1, 10 do
+    fiber.create(function()
+        for i = 2, 100 do
+            ok = ok and conn.space.test:get{i}[2] == s:get{i}[2]
+        end
+        done = done + 1
+        cond:signal()
+    end)
+end
+while done < 10 do
+    cond:wait()
+end
+test:ok(ok, 'concurrent requests')
+conn:close()
+
+local deadline = fiber.clock() + 10
+while disconnected < 1 and fiber.clock() < deadline do
+    fiber.sleep(0.01)
+end
+test:is(disconnected, 1, 'server sees the client is gone')
+
+conn = net_box.connect(box.cfg.listen, {shm = 1024 * 1024})
+test:is(#conn.space.test:select{}, 100, 'ring size')
+conn:close()
+
+-- Connections over TCP keep using the socket.
+box.cfg{listen = 'localhost:0'}
+conn = net_box.connect(box.info.listen, {shm = true})
+test:is(conn:ping(), true, 'shm is ignored for TCP')
+conn:close()
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
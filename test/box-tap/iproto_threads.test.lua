@@ -0,0 +1,74 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cfg.iproto_threads: connections are served by several
+-- network threads.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+local fiber = require('fiber')
+
+local test = tap.test('iproto_threads')
+test:plan(7)
+
+local ok, err = pcall(box.cfg, {iproto_threads = 0})
+test:ok(not ok and tostring(err):match('iproto_threads') ~= nil,
+        'iproto_threads must be positive')
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0', iproto_threads = 4}
+test:is(box.cfg.iproto_threads, 4, 'box.cfg.iproto_threads')
+
+ok = pcall(box.cfg, {iproto_threads = 2})
+test:ok(not ok, 'iproto_threads can not be changed dynamically')
+
+box.schema.user.grant('guest', 'super')
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local uri = box.info.listen
+local CONN_COUNT = 16
+local ROW_COUNT = 100
+local conns = {}
+for i = 1, CONN_COUNT do
+    conns[i] = net_box.connect(uri)
+end
+
+local cond = fiber.cond()
+local done = 0
+for i = 1, CONN_COUNT do
+    fiber.create(function()
+        for j = 1, ROW_COUNT do
+            conns[i].space.test:replace{(i - 1) * ROW_COUNT + j}
+        end
+        done = done + 1
+        cond:signal()
+    end)
+end
+while done < CONN_COUNT do
+    cond:wait()
+end
+
+local all_connected = true
+for i = 1, CONN_COUNT do
+    all_connected = all_connected and conns[i]:ping()
+end
+test:ok(all_connected, 'all connections are alive')
+test:is(s:count(), CONN_COUNT * ROW_COUNT, 'all requests are processed')
+test:ok(box.stat.net().CONNECTIONS.current >= CONN_COUNT,
+        'connections are accounted over all threads')
+
+for i = 1, CONN_COUNT do
+    conns[i]:close()
+end
+
+-- Listen rebinding detaches and reattaches all the threads.
+box.cfg{listen = ''}
+box.cfg{listen = uri}
+local c = net_box.connect(uri)
+test:ok(c:ping(), 'listen can be changed')
+c:close()
+
+s:drop()
+box.schema.user.revoke('guest', 'super')
+
+os.exit(test:check() and 0 or 1)
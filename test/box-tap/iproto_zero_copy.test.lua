@@ -0,0 +1,73 @@
+#!/usr/bin/env tarantool
+
+--
+-- Large tuples of a SELECT response are sent right from the
+-- tuple memory instead of being copied to the output buffer.
+-- The response must be the same as for small tuples.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local net_box = require('net.box')
+
+local test = tap.test('iproto_zero_copy')
+test:plan(5)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 100 do
+    -- Mix tuples sent with and without copying.
+    local len = i % 2 == 0 and 100 or 1000 * i
+    s:insert{i, string.rep(string.char(string.byte('a') + i % 26), len)}
+end
+
+local function check(tuples, from, to)
+    if #tuples ~= to - from + 1 then
+        return false
+    end
+    for i = from, to do
+        local t = tuples[i - from + 1]
+        if t[1] ~= i or t[2] ~= s:get{i}[2] then
+            return false
+        end
+    end
+    return true
+end
+
+local conn = net_box.connect(box.cfg.listen)
+test:ok(check(conn.space.test:select{}, 1, 100), 'select all')
+test:ok(check(conn.space.test:select({10}, {iterator = 'GE', limit = 3}),
+              10, 12), 'select with limit')
+
+-- Responses sent by many fibers at once are not mixed up.
+local ok = true
+local done = 0
+local cond = fiber.cond()
+for _ = 1, 10 do
+    fiber.create(function()
+        for i = 1, 100 do
+            local t = conn.space.test:get{i}
+            ok = ok and t[2] == s:get{i}[2]
+        end
+        done = done + 1
+        cond:signal()
+    end)
+end
+while done < 10 do
+    cond:wait()
+end
+test:ok(ok, 'concurrent selects')
+
+-- The tuples are pinned while being sent.
+local res = conn.space.test:select{}
+s:truncate()
+collectgarbage()
+test:is(#res, 100, 'select before truncate')
+test:is(#conn.space.test:select{}, 0, 'select after truncate')
+
+conn:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,105 @@
+#!/usr/bin/env tarantool
+
+--
+-- Index type 'art' stores keys in an adaptive radix tree
+-- (salad/art.h) in a binary comparable encoding.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_art')
+test:plan(19)
+
+box.cfg{log = 'tarantool.log'}
+
+local function ids(tuples, field)
+    local res = {}
+    for _, t in ipairs(tuples) do
+        table.insert(res, t[field or 1])
+    end
+    return res
+end
+
+local s = box.schema.space.create('test')
+s:create_index('pk', {type = 'art', parts = {1, 'integer'}})
+s:create_index('sk', {type = 'art', unique = false,
+                      parts = {{2, 'string'}, {3, 'boolean'}}})
+test:is(s.index.pk.type, 'ART', 'index info')
+
+local count = 1000
+for i = -count, count do
+    s:replace{i, 'k' .. (i % 10) .. '\0' .. (i % 3), i % 2 == 0}
+end
+test:is(s:count(), 2 * count + 1, 'count')
+local ok = true
+for i = -count, count do
+    ok = ok and s:get{i} ~= nil and s:get{i}[1] == i
+end
+test:ok(ok, 'get')
+test:is(s:get{count + 1}, nil, 'get missing')
+test:ok(s.index.pk:bsize() > 0, 'bsize')
+
+test:is_deeply(ids(s:select({-2}, {iterator = 'GE', limit = 3})),
+               {-2, -1, 0}, 'GE')
+test:is_deeply(ids(s:select({-2}, {iterator = 'GT', limit = 3})),
+               {-1, 0, 1}, 'GT')
+test:is_deeply(ids(s:select({1}, {iterator = 'LE', limit = 3})),
+               {1, 0, -1}, 'LE')
+test:is_deeply(ids(s:select({1}, {iterator = 'LT', limit = 3})),
+               {0, -1, -2}, 'LT')
+test:is_deeply({s.index.pk:min()[1], s.index.pk:max()[1]}, {-count, count},
+               'min and max')
+
+-- Partial keys and keys with zero bytes.
+local expected = {}
+for i = -count, count do
+    if i % 10 == 5 and i % 3 == 1 then
+        table.insert(expected, i)
+    end
+end
+local eq = s.index.sk:select({'k5\0' .. 1})
+test:is(#eq, #s.index.sk:select({'k5\0' .. 1}, {iterator = 'REQ'}),
+        'EQ and REQ by a partial key')
+test:is_deeply(ids(s.index.sk:select({'k5\0' .. 1, false})), expected,
+               'EQ by a non-unique key is ordered by primary key')
+test:is(s.index.sk:count({'k5'}), 0, 'EQ does not match a key prefix')
+
+-- Iteration is stable when the index is modified.
+local n = 0
+for _, t in s.index.pk:pairs({0}, {iterator = 'GE'}) do
+    n = n + 1
+    s:delete{t[1] + 1}
+end
+test:is(n, count / 2 + 1, 'iteration over a modified index')
+
+-- A read view does not see changes made after it was opened.
+local rv = box.read_view.open({s})
+for i = -count, -1 do
+    s:delete{i}
+end
+n = 0
+for _ in rv:pairs(s) do
+    n = n + 1
+end
+rv:close()
+test:is(n, count + count / 2 + 1, 'read view')
+
+s:truncate()
+for i = 1, 10 do
+    s:replace{i, 'x', true}
+end
+box.snapshot()
+test:is(s:count(), 10, 'snapshot')
+
+s.index.pk:alter({parts = {1, 'unsigned'}})
+test:is(s:get{3}[1], 3, 'alter to a compatible type')
+
+ok = pcall(s.create_index, s, 'tk', {type = 'art', parts = {2, 'number'}})
+test:ok(not ok, 'unsupported field type')
+ok = pcall(s.create_index, s, 'tk', {type = 'art',
+                                     parts = {{2, 'string',
+                                               collation = 'unicode'}}})
+test:ok(not ok, 'collations are not supported')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,57 @@
+#!/usr/bin/env tarantool
+
+--
+-- A non-unique memtx TREE index with count_keys maintains the
+-- number of tuples per full key, so that index:count(key) by
+-- a full key doesn't depend on the number of matching tuples.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_count_keys')
+test:plan(11)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 100 do
+    s:insert({i, i % 10})
+end
+local bucket = s:create_index('bucket', {parts = {2, 'unsigned'},
+                                         unique = false, count_keys = true})
+test:is(bucket.count_keys, true, 'option is set')
+test:is(bucket:count(3), 10, 'count after build')
+test:is(bucket:count(42), 0, 'count of a missing key')
+
+s:insert({101, 3})
+s:replace({1, 3})
+s:update({2}, {{'=', 2, 3}})
+s:delete({13})
+test:is(bucket:count(3), 12, 'count after changes')
+test:is(bucket:count(1), 9, 'count of an old key')
+test:is(bucket:count(3, {iterator = 'GE'}), 72, 'other iterators')
+
+box.begin()
+s:insert({102, 3})
+box.rollback()
+test:is(bucket:count(3), 12, 'count after rollback')
+
+-- A multipart index is counted by a full key only.
+local pair = s:create_index('pair', {parts = {{2, 'unsigned'},
+                                              {1, 'unsigned'}},
+                                     unique = false, count_keys = true})
+test:is(pair:count({3, 1}), 1, 'multipart key')
+test:is(pair:count(3), 12, 'partial key')
+
+bucket:alter({count_keys = false})
+bucket = s.index.bucket
+test:ok(bucket.count_keys == nil and bucket:count(3) == 12,
+        'option is dropped')
+
+local ok = pcall(s.create_index, s, 'unique',
+                 {parts = {2, 'unsigned'}, count_keys = true})
+test:ok(not ok, 'unique index can not count keys')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
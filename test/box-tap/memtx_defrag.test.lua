@@ -0,0 +1,68 @@
+#!/usr/bin/env tarantool
+
+--
+-- The memtx defragmentation fiber moves tuples out of sparsely
+-- used slabs after mass deletes. Check that slabs are freed and
+-- that the data and indexes stay intact.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('memtx_defrag')
+test:plan(7)
+
+box.cfg{log = 'tarantool.log'}
+
+test:ok(not pcall(box.cfg, {memtx_defrag_budget = -0.1}),
+        'negative budget is rejected')
+test:ok(not pcall(box.cfg, {memtx_defrag_budget = 1.5}),
+        'budget greater than 1 is rejected')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('sk', {parts = {2, 'string'}})
+local payload = string.rep('x', 100)
+box.begin()
+for i = 1, 50000 do
+    s:insert({i, tostring(i), payload})
+end
+box.commit()
+box.begin()
+for i = 1, 50000 do
+    if i % 10 ~= 0 then
+        s:delete(i)
+    end
+end
+box.commit()
+
+local items_size = box.slab.info().items_size
+box.cfg{memtx_defrag_budget = 0.5}
+local deadline = fiber.clock() + 30
+while box.slab.info().items_size >= items_size * 0.5 and
+      fiber.clock() < deadline do
+    fiber.sleep(0.1)
+end
+box.cfg{memtx_defrag_budget = 0}
+
+test:ok(box.slab.info().defrag_relocated > 0, 'tuples are moved')
+test:ok(box.slab.info().items_size < items_size * 0.5, 'slabs are freed')
+test:is(s:count(), 5000, 'tuple count')
+
+local ok = true
+for i = 10, 50000, 10 do
+    local t = s:get(i)
+    if t == nil or t[2] ~= tostring(i) or t[3] ~= payload or
+       s.index.sk:get(tostring(i)) ~= t then
+        ok = false
+        break
+    end
+end
+test:ok(ok, 'tuples are found by both indexes')
+
+s:insert({50001, '50001', payload})
+s:delete(10)
+test:is(s.index.sk:count(), 5000, 'space is usable')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
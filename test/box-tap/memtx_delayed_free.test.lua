@@ -0,0 +1,74 @@
+#!/usr/bin/env tarantool
+
+--
+-- While a snapshot iterator is open, tuples deleted from memtx
+-- spaces are kept alive only if the iterator may see them: tuples
+-- of other spaces are freed immediately.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_delayed_free')
+test:plan(5)
+
+box.cfg{log = 'tarantool.log'}
+
+local data = string.rep('x', 1000)
+local function fill(space)
+    space:create_index('pk')
+    for i = 1, 100 do
+        space:insert{i, data}
+    end
+end
+
+local s1 = box.schema.space.create('s1')
+fill(s1)
+local s2 = box.schema.space.create('s2')
+fill(s2)
+local s3 = box.schema.space.create('s3')
+fill(s3)
+-- The tuples of the space are stored in the indexes of the new
+-- space object created by alter with a new format.
+s3:create_index('sk', {parts = {2, 'string'}, unique = false})
+
+local rv = box.read_view.open({s1})
+
+local used = box.slab.info().items_used
+for i = 1, 100 do
+    s2:delete{i}
+end
+test:ok(box.slab.info().items_used < used - 50 * #data,
+        'tuples of a space without a read view are freed')
+
+used = box.slab.info().items_used
+for i = 1, 100 do
+    s1:delete{i}
+end
+test:ok(box.slab.info().items_used >= used,
+        'tuples of a space with a read view are kept')
+
+used = box.slab.info().items_used
+for i = 1, 100 do
+    s3:delete{i}
+end
+test:ok(box.slab.info().items_used >= used,
+        'tuples of an old format are kept')
+
+local count = 0
+local ok = true
+for _, t in rv:pairs(s1) do
+    count = count + 1
+    ok = ok and t[2] == data
+end
+test:ok(ok and count == 100, 'read view')
+rv:close()
+
+s2:insert{1, data}
+used = box.slab.info().items_used
+s2:delete{1}
+test:ok(box.slab.info().items_used < used, 'no read views')
+
+s1:drop()
+s2:drop()
+s3:drop()
+
+os.exit(test:check() and 0 or 1)
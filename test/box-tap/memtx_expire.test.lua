@@ -0,0 +1,72 @@
+#!/usr/bin/env tarantool
+
+--
+-- Tuples of a memtx space with expire_field are deleted by
+-- a background fiber once the time stored in the field passes.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('memtx_expire')
+test:plan(10)
+
+box.cfg{log = 'tarantool.log'}
+
+local function wait_count(s, count)
+    local deadline = fiber.clock() + 10
+    while s:count() ~= count and fiber.clock() < deadline do
+        fiber.sleep(0.01)
+    end
+    return s:count()
+end
+
+local s = box.schema.space.create('test', {
+    format = {{'id', 'unsigned'}, {'expire_at', 'any'}},
+    expire_field = 'expire_at',
+})
+s:create_index('pk')
+test:is(s.expire_field, 2, 'expire_field by name')
+
+local now = fiber.time()
+s:insert({1, now - 1})
+s:insert({2, now + 0.1})
+s:insert({3, now + 3600})
+s:insert({4, 'never'})
+s:insert({5})
+test:is(wait_count(s, 3), 3, 'expired tuples are deleted')
+test:is_deeply(s:select({}, {iterator = 'GE'}):map(function(t)
+    return t[1]
+end), {3, 4, 5}, 'other tuples are kept')
+
+-- Updating the expiration time extends the lifetime of a tuple.
+s:insert({6, fiber.time() + 0.1})
+s:update({6}, {{'=', 2, fiber.time() + 3600}})
+fiber.sleep(0.3)
+test:ok(s:get({6}) ~= nil, 'extended tuple is kept')
+s:update({6}, {{'=', 2, 0}})
+test:is(wait_count(s, 3), 3, 'shortened tuple is deleted')
+
+local ok = pcall(s.format, s, {{'id', 'unsigned'}, {'expire_at', 'number'}})
+test:ok(ok, 'format change keeps expire_field')
+ok = pcall(box.space._space.update, box.space._space, {s.id},
+           {{'=', 6, {expire_field = 0}}})
+test:ok(not ok, 'expire_field of a non-empty space can not be changed')
+s:drop()
+
+s = box.schema.space.create('test', {expire_field = 2})
+s:create_index('pk')
+test:is(s.expire_field, 2, 'expire_field by number')
+
+-- Expiration is disabled when the rate is zero.
+box.cfg{memtx_expire_rate = 0}
+s:insert({1, 0})
+fiber.sleep(0.3)
+test:is(s:count(), 1, 'expiration is disabled')
+box.cfg{memtx_expire_rate = 1000}
+s:drop()
+
+ok = pcall(box.schema.space.create, 'test',
+           {engine = 'vinyl', expire_field = 2})
+test:ok(not ok, 'vinyl does not support expiration')
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,54 @@
+#!/usr/bin/env tarantool
+
+--
+-- Option memtx_heap_dir backs the memtx arena with a temporary
+-- file, so that cold pages can be moved out of RAM.
+--
+local tap = require('tap')
+local fio = require('fio')
+
+local test = tap.test('memtx_heap_dir')
+test:plan(6)
+
+local ok = pcall(box.cfg, {memtx_heap_dir = 1})
+test:ok(not ok, 'wrong type')
+
+local dir = fio.tempdir()
+box.cfg{
+    log = 'tarantool.log',
+    memtx_memory = 64 * 1024 * 1024,
+    memtx_heap_dir = dir,
+}
+test:is(box.cfg.memtx_heap_dir, dir, 'cfg')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 10000 do
+    s:replace({i, string.rep('x', 100)})
+end
+local found = 0
+for i = 1, 10000 do
+    if s:get(i) ~= nil then
+        found = found + 1
+    end
+end
+test:is(found, 10000, 'tuples are stored in the heap file')
+
+-- The file is unlinked right after it is mapped.
+test:is(#fio.listdir(dir), 0, 'heap file is unlinked')
+local maps = io.open('/proc/self/maps')
+if maps ~= nil then
+    local mapped = maps:read('*a'):find(dir .. '/memtx.heap.', 1, true)
+    maps:close()
+    test:ok(mapped ~= nil, 'heap file is mapped')
+else
+    test:ok(true, 'heap file is mapped')
+end
+
+ok = pcall(box.cfg, {memtx_heap_dir = fio.tempdir()})
+test:ok(not ok, 'option is static')
+
+s:drop()
+fio.rmtree(dir)
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,36 @@
+#!/usr/bin/env tarantool
+
+--
+-- Option memtx_use_hugepages backs the memtx arena with huge
+-- pages.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_hugepages')
+test:plan(6)
+
+local ok = pcall(box.cfg, {memtx_use_hugepages = 'yes'})
+test:ok(not ok, 'wrong type')
+
+box.cfg{log = 'tarantool.log', memtx_use_hugepages = true}
+test:is(box.cfg.memtx_use_hugepages, true, 'cfg')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 10000 do
+    s:replace({i, string.rep('x', 100)})
+end
+
+-- Huge pages may be unsupported by the system.
+local info = box.slab.info()
+test:ok(info.hugepages == 'hugetlb' or info.hugepages == 'thp' or
+        info.hugepages == 'none', 'kind of huge pages in box.slab.info()')
+test:ok(info.hugepages_used >= 0, 'used huge pages in box.slab.info()')
+test:is(type(info.hugepages_ratio), 'string', 'huge page ratio')
+
+ok = pcall(box.cfg, {memtx_use_hugepages = false})
+test:ok(not ok, 'the option can not be changed')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
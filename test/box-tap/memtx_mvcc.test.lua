@@ -0,0 +1,113 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cfg.memtx_use_mvcc_engine: memtx transactions may yield,
+-- uncommitted changes are invisible to other transactions and
+-- conflicts are detected.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('memtx_mvcc')
+test:plan(13)
+
+box.cfg{log = 'tarantool.log', memtx_use_mvcc_engine = true}
+test:is(box.cfg.memtx_use_mvcc_engine, true, 'box.cfg.memtx_use_mvcc_engine')
+local ok, err = pcall(box.cfg, {memtx_use_mvcc_engine = false})
+test:ok(not ok, 'memtx_use_mvcc_engine can not be changed dynamically')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+
+local function totable(tuples)
+    local result = {}
+    for _, t in ipairs(tuples) do
+        table.insert(result, t:totable())
+    end
+    return result
+end
+
+local function is_conflict(err)
+    return err ~= nil and err.code == box.error.TRANSACTION_CONFLICT
+end
+
+s:replace{1, 1}
+
+-- Uncommitted changes are invisible to others.
+box.begin()
+s:replace{1, 10}
+s:replace{2, 20}
+local seen
+fiber.create(function()
+    seen = {totable(s:select()), totable(s.index.sk:select()),
+            s:get{2} == nil}
+end)
+test:is_deeply(seen, {{{1, 1}}, {{1, 1}}, true}, 'no dirty reads')
+test:is_deeply(totable(s.index.sk:select()), {{1, 10}, {2, 20}},
+               'own changes are visible')
+fiber.yield()
+ok = pcall(box.commit)
+test:ok(ok, 'transaction may yield')
+test:is_deeply(totable(s:select()), {{1, 10}, {2, 20}}, 'committed')
+
+-- Write-write conflict.
+box.begin()
+s:replace{3, 3}
+fiber.create(function()
+    ok, err = pcall(s.replace, s, {3, 30})
+end)
+test:ok(not ok and is_conflict(err), 'write conflict')
+box.commit()
+
+-- A transaction reads a tuple replaced by another one.
+box.begin()
+local v = s:get{1}[2]
+fiber.create(function() s:replace{1, 100} end)
+s:replace{4, v + 1}
+ok, err = pcall(box.commit)
+test:ok(not ok and is_conflict(err), 'read conflict')
+test:is(s:get{4}, nil, 'conflicted transaction is rolled back')
+
+-- Rollback restores the data.
+box.begin()
+s:delete{1}
+s:replace{2, 200}
+s:insert{5, 5}
+box.rollback()
+test:is_deeply(totable(s:select()), {{1, 100}, {2, 20}, {3, 3}},
+               'rollback')
+
+-- A read view doesn't see changes in progress.
+local rv
+box.begin()
+s:delete{1}
+s:replace{2, 200}
+s:insert{5, 5}
+fiber.create(function() rv = box.read_view.open({s}) end)
+box.commit()
+local rows = {}
+for _, t in rv:pairs(s) do
+    table.insert(rows, t:totable())
+end
+rv:close()
+test:is_deeply(rows, {{1, 100}, {2, 20}, {3, 3}}, 'read view')
+
+-- DDL aborts transactions changing the space.
+box.begin()
+s:replace{6, 6}
+fiber.create(function()
+    s:create_index('sk2', {parts = {2, 'unsigned'}})
+end)
+ok, err = pcall(s.replace, s, {7, 7})
+box.rollback()
+test:ok(not ok and is_conflict(err), 'aborted by DDL')
+while s.index.sk2 == nil do
+    fiber.sleep(0.01)
+end
+test:is_deeply(totable(s.index.sk2:select()), {{3, 3}, {5, 5}, {2, 200}},
+               'index is built')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,27 @@
+#!/usr/bin/env tarantool
+
+--
+-- Option memtx_numa_policy sets NUMA placement of the memtx
+-- arena.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_numa')
+test:plan(5)
+
+local ok = pcall(box.cfg, {memtx_numa_policy = 'foo'})
+test:ok(not ok, 'unknown policy')
+
+box.cfg{log = 'tarantool.log', memtx_numa_policy = 'interleave'}
+test:is(box.cfg.memtx_numa_policy, 'interleave', 'cfg')
+
+-- The policy may be unsupported by the system.
+local info = box.slab.info()
+test:ok(info.numa_policy == 'interleave' or info.numa_policy == 'default',
+        'policy in box.slab.info()')
+test:is(type(info.numa_node), 'number', 'node in box.slab.info()')
+
+ok = pcall(box.cfg, {memtx_numa_policy = 'local'})
+test:ok(not ok, 'the policy can not be changed')
+
+os.exit(test:check() and 0 or 1)
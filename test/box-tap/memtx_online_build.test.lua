@@ -0,0 +1,76 @@
+#!/usr/bin/env tarantool
+
+--
+-- Secondary tree indexes of large memtx spaces are built
+-- online: keys are sorted by a coio thread, while changes made
+-- to the space meanwhile are applied to the index afterwards.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('memtx_online_build')
+test:plan(5)
+
+box.cfg{log = 'tarantool.log'}
+
+local count = 50000
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, count do
+    s:replace{i, i * 2, 'v' .. i}
+end
+
+-- Check that a secondary index contains exactly the tuples
+-- of the primary index.
+local function check_index(index, field)
+    local n = 0
+    for _, t in s:pairs() do
+        local found = index:select{t[field]}
+        if #found ~= 1 or found[1][1] ~= t[1] then
+            return false
+        end
+        n = n + 1
+    end
+    return index:count() == n
+end
+
+-- Modify the space while the index is being built.
+local function dml(ch)
+    local i = 0
+    while ch:get(0) == nil do
+        i = i + 1
+        local id = math.random(2 * count)
+        if i % 3 == 0 then
+            s:delete{id}
+        else
+            s:replace{id, id * 2, 'w' .. id}
+        end
+        fiber.yield()
+    end
+end
+
+local ch = fiber.channel(1)
+local f = fiber.create(dml, ch)
+s:create_index('sk', {parts = {2, 'unsigned'}})
+ch:put(true)
+fiber.yield()
+test:is(f:status(), 'dead', 'concurrent changes')
+test:ok(check_index(s.index.sk, 2), 'unique index')
+
+ch = fiber.channel(1)
+f = fiber.create(dml, ch)
+s:create_index('tk', {parts = {3, 'string'}, unique = false})
+ch:put(true)
+fiber.yield()
+test:ok(check_index(s.index.tk, 3), 'non-unique index')
+
+s:replace{3 * count, 1, 'x'}
+s:replace{3 * count + 1, 3, 'x'}
+local ok, err = pcall(s.create_index, s, 'dup', {parts = {3, 'string'}})
+test:is(ok == false and err.code, box.error.TUPLE_FOUND, 'duplicate')
+test:is(s.index.dup, nil, 'the index is not created on duplicate')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
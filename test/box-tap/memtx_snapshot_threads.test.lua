@@ -0,0 +1,68 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cfg.memtx_snapshot_threads: a snapshot is written by
+-- several threads, each space being written by one of them.
+--
+local tap = require('tap')
+local fio = require('fio')
+local xlog = require('xlog')
+
+local test = tap.test('memtx_snapshot_threads')
+test:plan(6)
+
+local ok, err = pcall(box.cfg, {memtx_snapshot_threads = 0})
+test:ok(not ok and tostring(err):match('memtx_snapshot_threads') ~= nil,
+        'memtx_snapshot_threads must be positive')
+
+box.cfg{memtx_snapshot_threads = 4}
+test:is(box.cfg.memtx_snapshot_threads, 4, 'box.cfg.memtx_snapshot_threads')
+
+local SPACE_COUNT = 8
+local ROW_COUNT = 10000
+local spaces = {}
+for i = 1, SPACE_COUNT do
+    local s = box.schema.space.create('test' .. i)
+    s:create_index('pk')
+    box.begin()
+    for j = 1, ROW_COUNT do
+        s:replace{j, string.rep('x', 100)}
+    end
+    box.commit()
+    spaces[s.id] = 0
+end
+
+test:ok(pcall(box.snapshot), 'snapshot is written')
+
+local snap = fio.pathjoin(box.cfg.memtx_dir,
+                          string.format('%020d.snap', box.info.signature))
+local user_rows_seen = false
+local system_after_user = false
+for _, row in xlog.pairs(snap) do
+    local space_id = row.BODY and row.BODY.space_id
+    if space_id ~= nil then
+        if spaces[space_id] ~= nil then
+            spaces[space_id] = spaces[space_id] + 1
+            user_rows_seen = true
+        elseif user_rows_seen then
+            system_after_user = true
+        end
+    end
+end
+local all_rows = true
+for _, count in pairs(spaces) do
+    all_rows = all_rows and count == ROW_COUNT
+end
+test:ok(all_rows, 'all rows of all spaces are written')
+test:ok(not system_after_user, 'system spaces go first')
+
+-- The option is dynamic.
+box.cfg{memtx_snapshot_threads = 1}
+box.space.test1:replace{0}
+test:ok(pcall(box.snapshot), 'snapshot with one thread')
+
+for i = 1, SPACE_COUNT do
+    box.space['test' .. i]:drop()
+end
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,71 @@
+#!/usr/bin/env tarantool
+
+--
+-- Index option hash_type = 'swiss' makes a memtx HASH index use
+-- an open addressing hash table (salad/swiss.h).
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_swiss')
+test:plan(14)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk', {type = 'hash', hash_type = 'swiss'})
+s:create_index('sk', {type = 'hash', hash_type = 'swiss',
+                      parts = {2, 'string'}})
+test:is(s.index.pk.hash_type, 'swiss', 'index info')
+
+local count = 10000
+for i = 1, count do
+    s:replace{i, 'v' .. i}
+end
+test:is(s:count(), count, 'count after growth')
+local ok = true
+for i = 1, count do
+    ok = ok and s:get{i}[2] == 'v' .. i and
+         s.index.sk:get{'v' .. i}[1] == i
+end
+test:ok(ok, 'get')
+test:is(s:get{count + 1}, nil, 'get missing')
+test:ok(s.index.pk:bsize() > 0, 'bsize')
+
+for i = 1, count, 2 do
+    s:delete{i}
+end
+test:is(#s:select(), count / 2, 'select all after delete')
+test:is(s.index.sk:get{'v1'}, nil, 'secondary index after delete')
+
+local _, err = pcall(s.insert, s, {2, 'x'})
+test:is(err.code, box.error.TUPLE_FOUND, 'duplicate')
+
+local t = s:select({2}, {iterator = 'GT', limit = 1})[1]
+test:ok(t ~= nil and t[1] % 2 == 0, 'GT iterator')
+
+-- A read view is consistent while the table grows.
+local rv = box.read_view.open({s})
+for i = count + 1, 3 * count do
+    s:replace{i, 'v' .. i}
+end
+local n = 0
+for _, tuple in rv:pairs(s) do
+    n = n + (tuple[1] <= count and 1 or 0)
+end
+rv:close()
+test:is(n, count / 2, 'read view')
+
+box.snapshot()
+test:is(s:count(), count / 2 + 2 * count, 'snapshot')
+
+s.index.pk:alter({hash_type = 'light'})
+test:is(s.index.pk.hash_type, nil, 'alter to light')
+test:is(s:get{4}[2], 'v4', 'data after alter')
+
+ok = pcall(s.create_index, s, 'tk', {type = 'hash', hash_type = 'foo',
+                                     parts = {2, 'string'}})
+test:ok(not ok, 'unknown hash_type')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
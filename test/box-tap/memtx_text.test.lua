@@ -0,0 +1,78 @@
+#!/usr/bin/env tarantool
+
+--
+-- TEXT index is an inverted index of words of a string field.
+-- EQ and BITS_ALL_SET return tuples containing all words of
+-- a query, BITS_ANY_SET returns tuples containing any of them.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_text')
+test:plan(14)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+local text = s:create_index('text', {type = 'text', parts = {2, 'string'}})
+
+local function ids(tuples)
+    local result = {}
+    for _, t in ipairs(tuples) do
+        table.insert(result, t[1])
+    end
+    table.sort(result)
+    return result
+end
+
+local function search(query, iterator)
+    return ids(text:select(query, {iterator = iterator}))
+end
+
+s:insert({1, 'The quick brown fox'})
+s:insert({2, 'jumps over the lazy dog'})
+s:insert({3, 'Quick, quick! A FOX.'})
+s:insert({4, 'Быстрая лиса'})
+
+test:is_deeply(search('fox'), {1, 3}, 'single word')
+test:is_deeply(search('QUICK fox'), {1, 3}, 'case is ignored')
+test:is_deeply(search('quick dog', 'BITS_ALL_SET'), {}, 'all words')
+test:is_deeply(search('quick dog', 'BITS_ANY_SET'), {1, 2, 3}, 'any word')
+test:is_deeply(search('ЛИСА'), {4}, 'unicode words')
+test:is_deeply(search('cat'), {}, 'missing word')
+test:is(text:count('the'), 2, 'count')
+test:is(text:count(), 4, 'count all')
+
+s:update({1}, {{'=', 2, 'a slow dog'}})
+s:delete({3})
+test:is_deeply(search('fox'), {}, 'update and delete')
+test:is_deeply(search('dog'), {1, 2}, 'new words are indexed')
+
+-- Many documents take several posting list blocks.
+for i = 10, 1009 do
+    s:insert({i, i % 2 == 0 and 'even number' or 'odd number'})
+end
+test:is(text:count('number'), 1000, 'long posting list')
+for i = 10, 1009, 3 do
+    s:delete({i})
+end
+local expected = 0
+for i = 10, 1009 do
+    if (i - 10) % 3 ~= 0 and i % 2 == 0 then
+        expected = expected + 1
+    end
+end
+test:is(text:count('even number'), expected, 'intersection')
+
+-- An iterator sees changes made after it was opened.
+local gen, param, state = text:pairs('slow')
+s:delete({1})
+test:is(gen(param, state), nil, 'deleted tuple is skipped')
+
+local ok = pcall(s.create_index, s, 'unique',
+                 {type = 'text', parts = {2, 'string'}, unique = true})
+test:ok(not ok, 'TEXT index can not be unique')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,73 @@
+#!/usr/bin/env tarantool
+
+--
+-- Memtx tree indexes count tuples and skip the select offset
+-- using subtree cardinalities instead of iterating. Check that
+-- results are the same as the ones obtained by iteration.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_tree_offset')
+test:plan(4)
+
+box.cfg{}
+
+local s = box.schema.space.create('test')
+s:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned'}})
+s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+for i = 1, 2000 do
+    s:insert({math.random(100), i})
+end
+
+local iterators = {'EQ', 'REQ', 'GE', 'GT', 'LE', 'LT', 'ALL'}
+local keys = {{}, {0}, {1}, {50}, {100}, {101}}
+
+local function count_by_iteration(index, key, iterator)
+    local n = 0
+    for _ in index:pairs(key, {iterator = iterator}) do
+        n = n + 1
+    end
+    return n
+end
+
+local function check_count(index)
+    for _, key in ipairs(keys) do
+        for _, iterator in ipairs(iterators) do
+            local expected = count_by_iteration(index, key, iterator)
+            local count = index:count(key, {iterator = iterator})
+            if count ~= expected then
+                return false
+            end
+        end
+    end
+    return true
+end
+
+local function check_offset(index)
+    for _, key in ipairs(keys) do
+        for _, iterator in ipairs(iterators) do
+            local all = index:select(key, {iterator = iterator})
+            local offsets = {0, 1, 7, math.max(#all - 1, 0), #all, #all + 1}
+            for _, offset in ipairs(offsets) do
+                local res = index:select(key, {iterator = iterator,
+                                               offset = offset, limit = 3})
+                for i = 1, 3 do
+                    local tuple = all[offset + i]
+                    if (res[i] and res[i][2]) ~= (tuple and tuple[2]) then
+                        return false
+                    end
+                end
+            end
+        end
+    end
+    return true
+end
+
+test:ok(check_count(s.index.pk), 'count in the primary index')
+test:ok(check_count(s.index.sk), 'count in the secondary index')
+test:ok(check_offset(s.index.pk), 'offset in the primary index')
+test:ok(check_offset(s.index.sk), 'offset in the secondary index')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,67 @@
+#!/usr/bin/env tarantool
+
+--
+-- With memtx_update_in_place an update which changes neither the
+-- tuple size nor indexed fields is written into the old tuple.
+-- Tuples visible from outside of the space must stay intact.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_update_in_place')
+test:plan(9)
+
+box.cfg{log = 'tarantool.log', memtx_update_in_place = true}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('sk', {parts = {2, 'unsigned'}})
+for i = 1, 10 do
+    s:insert{i, i, 0, 'abc'}
+end
+
+for _ = 1, 100 do
+    s:update({1}, {{'+', 3, 1}})
+end
+test:is(s:get{1}[3], 100, 'counter')
+
+s:update({1}, {{'=', 4, 'xyz'}})
+test:is_deeply(s:get{1}:totable(), {1, 1, 100, 'xyz'}, 'same size string')
+
+box.begin()
+s:update({2}, {{'+', 3, 5}})
+box.rollback()
+test:is(s:get{2}[3], 0, 'rollback')
+
+local held = s:get{3}
+s:update({3}, {{'+', 3, 1}})
+test:ok(held[3] == 0 and s:get{3}[3] == 1, 'referenced tuple is kept')
+
+s:update({4}, {{'=', 2, 40}})
+test:ok(s.index.sk:get{40} ~= nil and s.index.sk:get{4} == nil,
+        'indexed field')
+
+s:update({5}, {{'=', 3, 1000000}})
+test:is(s:get{5}[3], 1000000, 'size is changed')
+
+local rv = box.read_view.open({s})
+s:update({6}, {{'+', 3, 1}})
+local value
+for _, t in rv:pairs(s) do
+    if t[1] == 6 then
+        value = t[3]
+    end
+end
+rv:close()
+test:ok(value == 0 and s:get{6}[3] == 1, 'read view')
+
+local ok = pcall(s.update, s, {7}, {{'=', 2, 'x'}})
+test:ok(not ok and s:get{7}[2] == 7, 'invalid field type')
+
+local old
+s:on_replace(function(o) old = o end)
+s:update({8}, {{'+', 3, 1}})
+test:ok(old[3] == 0 and s:get{8}[3] == 1, 'on_replace trigger')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
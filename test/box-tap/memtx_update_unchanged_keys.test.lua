@@ -0,0 +1,68 @@
+#!/usr/bin/env tarantool
+
+--
+-- An update which doesn't change the key of a secondary index
+-- swaps the tuple in the index instead of delete + insert.
+--
+local tap = require('tap')
+
+local test = tap.test('memtx_update_unchanged_keys')
+test:plan(8)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('tree', {parts = {2, 'unsigned'}, unique = false})
+s:create_index('multikey', {parts = {{3, 'unsigned', path = '[*]'}},
+                            unique = false})
+s:create_index('bitset', {type = 'bitset', parts = {4, 'unsigned'},
+                          unique = false})
+s:create_index('hash', {type = 'hash', parts = {5, 'string'}})
+for i = 1, 10 do
+    s:insert{i, i % 3, {i, i + 100, i}, i % 4, 'k' .. i, 0}
+end
+
+for i = 1, 10 do
+    s:update({i}, {{'+', 6, i}})
+end
+
+local function check_index(index, key, expected)
+    local ok = true
+    for _, t in index:pairs(key) do
+        ok = ok and t[6] == t[1] * expected
+    end
+    return ok
+end
+
+test:ok(check_index(s.index.tree, {1}, 1), 'tree')
+test:ok(check_index(s.index.multikey, {105}, 1), 'multikey')
+test:is(s.index.multikey:count(), 20, 'multikey count')
+test:ok(check_index(s.index.bitset, {1}, 1) and
+        s.index.bitset:count({1}, {iterator = 'BITS_ANY_SET'}) == 5,
+        'bitset')
+test:is(s.index.hash:get{'k7'}[6], 7, 'hash')
+
+box.begin()
+for i = 1, 10 do
+    s:update({i}, {{'+', 6, i}})
+end
+box.rollback()
+local ok = true
+for _, index in pairs({s.index.tree, s.index.multikey, s.index.bitset}) do
+    for _, t in index:pairs() do
+        ok = ok and t[6] == t[1]
+    end
+end
+test:ok(ok, 'rollback')
+
+-- Key changes go through a regular replace.
+s:update({5}, {{'=', 2, 10}, {'=', 3, {1000}}, {'=', 4, 8}})
+test:ok(s.index.tree:select{10}[1][1] == 5 and
+        s.index.multikey:select{1000}[1][1] == 5,
+        'changed key')
+test:is(s.index.multikey:count({105}), 0, 'old multikey entries are gone')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,91 @@
+#!/usr/bin/env tarantool
+
+--
+-- merger.new_netbox_source() reads a remote index by chunks and
+-- requests a next chunk while the current one is being merged.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+local key_def_lib = require('key_def')
+local merger = require('merger')
+
+local test = tap.test('merger_netbox_source')
+test:plan(8)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s1 = box.schema.space.create('s1')
+s1:create_index('pk')
+s1:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+local s2 = box.schema.space.create('s2')
+s2:create_index('pk')
+for i = 1, 100 do
+    local s = i % 3 == 0 and s2 or s1
+    s:insert({i, i % 10})
+end
+
+local conn = net_box.connect(box.cfg.listen)
+local key_def = key_def_lib.new({{fieldno = 1, type = 'unsigned'}})
+
+local function keys(tuples)
+    local res = {}
+    for _, t in ipairs(tuples) do
+        table.insert(res, t[1])
+    end
+    return res
+end
+
+local function range(from, to, step)
+    local res = {}
+    for i = from, to, step do
+        table.insert(res, i)
+    end
+    return res
+end
+
+-- A chunk is smaller than the data, the last chunk is full.
+local src = merger.new_netbox_source(conn.space.s2.index.pk, nil,
+                                     {fetch_size = 11})
+test:is_deeply(keys(src:select()), range(3, 99, 3), 'chunked select')
+
+local sources = {
+    merger.new_netbox_source(conn.space.s1.index.pk, nil, {fetch_size = 7}),
+    merger.new_netbox_source(conn.space.s2.index.pk, nil, {fetch_size = 5}),
+}
+local res = merger.new(key_def, sources):select()
+test:is_deeply(keys(res), range(1, 100, 1), 'merge')
+
+sources = {
+    merger.new_netbox_source(conn.space.s1.index.pk, {50},
+                             {iterator = 'LT', fetch_size = 4}),
+    merger.new_netbox_source(conn.space.s2.index.pk, {50},
+                             {iterator = 'le', fetch_size = 100}),
+}
+res = merger.new(key_def, sources, {reverse = true}):select()
+test:is_deeply(keys(res), range(49, 1, -1), 'reverse merge')
+
+src = merger.new_netbox_source(conn.space.s1.index.pk, {1000})
+test:is(#src:select(), 0, 'empty result')
+
+-- The merger stops before the end of a source.
+src = merger.new_netbox_source(conn.space.s2.index.pk, nil,
+                               {fetch_size = 2})
+test:is_deeply(keys(src:select({limit = 3})), {3, 6, 9}, 'limit')
+
+local ok, err = pcall(merger.new_netbox_source, conn.space.s1.index.sk)
+test:ok(not ok and err:match('should be unique') ~= nil, 'non-unique index')
+ok, err = pcall(merger.new_netbox_source, conn.space.s1.index.pk, nil,
+                {iterator = 'EQ'})
+test:ok(not ok and err:match('unsupported iterator') ~= nil, 'iterator')
+
+-- An error of a request is raised from the merger.
+src = merger.new_netbox_source(conn.space.s1.index.pk, {'x'})
+ok = pcall(src.select, src)
+test:ok(not ok, 'request error')
+
+conn:close()
+s1:drop()
+s2:drop()
+
+os.exit(test:check() and 0 or 1)
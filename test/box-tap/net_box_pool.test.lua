@@ -0,0 +1,48 @@
+#!/usr/bin/env tarantool
+
+--
+-- net.box.pool() sends write requests to the writable instance
+-- and spreads read requests across healthy instances.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+
+local test = tap.test('net_box_pool')
+test:plan(10)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'super')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:insert({1})
+rawset(_G, 'echo', function(...) return ... end)
+
+test:ok(not pcall(net_box.pool, {}), 'empty pool')
+
+-- The second instance is never available.
+local pool = net_box.pool({box.cfg.listen, 'localhost:1'},
+                          {check_interval = 0.1})
+local info = pool:info()
+test:ok(info[1].is_healthy and info[1].is_rw, 'live instance is healthy')
+test:ok(not info[2].is_healthy, 'dead instance is unhealthy')
+
+test:is_deeply({pool:call('echo', {1, 2})}, {1, 2}, 'call')
+test:is(pool:eval('return box.info.ro', {}, {mode = 'ro'}), false,
+        'eval in read-only mode')
+test:is(#pool:select('test', {}), 1, 'select')
+test:is(pool:get('test', 1)[1], 1, 'get')
+test:ok(pool:info()[1].latency > 0, 'latency is measured')
+test:ok(not pcall(pool.call, pool, 'echo', {}, {mode = 'foo'}),
+        'wrong mode')
+
+box.cfg{read_only = true}
+require('fiber').sleep(0.3)
+test:ok(not pcall(pool.call, pool, 'echo') and
+        pool:connection('ro') ~= nil, 'no writable instance')
+box.cfg{read_only = false}
+
+pool:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,52 @@
+#!/usr/bin/env tarantool
+
+--
+-- conn:atomic() sends DML operations in one BATCH request, which
+-- executes them in one transaction with a single WAL write.
+--
+local tap = require('tap')
+local net = require('net.box')
+
+local test = tap.test('netbox_atomic')
+test:plan(8)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:insert({1, 'a'})
+s:insert({2, 'b'})
+
+local conn = net.connect(box.cfg.listen)
+local lsn = box.info.lsn
+local res = conn:atomic({
+    {'insert', 'test', {3, 'c'}},
+    {'replace', s.id, {1, 'A'}},
+    {'update', 'test', {2}, {{'=', 2, 'B'}}},
+    {'delete', 'test', {42}},
+    {'upsert', 'test', {4, 'd'}, {{'=', 2, 'D'}}},
+})
+test:is(#res, 5, 'a result per operation')
+test:is_deeply({res[1]:totable(), res[2]:totable(), res[3]:totable()},
+               {{3, 'c'}, {1, 'A'}, {2, 'B'}}, 'results are in order')
+test:ok(res[4] == nil and res[5] == nil, 'operations without a result')
+test:is(box.info.lsn, lsn + 4, 'changes are written')
+test:is(s:count(), 4, 'changes are applied')
+
+-- Nothing is applied if one of the operations fails.
+local ok, err = pcall(conn.atomic, conn, {
+    {'delete', 'test', {1}},
+    {'insert', 'test', {2, 'dup'}},
+})
+test:ok(not ok and err.code == box.error.TUPLE_FOUND, 'error is returned')
+test:is(s:get({1})[2], 'A', 'transaction is rolled back')
+
+ok = pcall(conn.atomic, conn, {{'select', 'test', {}}})
+test:ok(not ok, 'only DML operations are allowed')
+
+conn:close()
+s:drop()
+box.schema.user.revoke('guest', 'read,write', 'universe')
+
+os.exit(test:check() and 0 or 1)
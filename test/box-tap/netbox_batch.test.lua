@@ -0,0 +1,61 @@
+#!/usr/bin/env tarantool
+
+--
+-- conn:batch() collects requests and sends them in one write,
+-- responses to them are dispatched to futures.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+
+local test = tap.test('netbox_batch')
+test:plan(9)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local conn = net_box.connect(box.cfg.listen)
+
+local batch = conn:batch()
+for i = 1, 1000 do
+    batch:insert('test', {i, i * 2})
+end
+local futures = batch:send()
+test:is(#futures, 1000, 'one future per request')
+
+local ok = true
+for i, f in ipairs(futures) do
+    local res = f:wait_result()
+    ok = ok and res[1] == i and res[2] == i * 2
+end
+test:ok(ok and s:count() == 1000, 'insert results')
+
+batch:ping()
+batch:get(s.id, {10})
+batch:select('test', {990}, {iterator = 'GT'})
+batch:update('test', {1}, {{'+', 2, 1}})
+batch:eval('return ...', {1, 2})
+batch:insert('test', {1})
+futures = batch:send()
+test:is(futures[2]:wait_result()[2], 20, 'get')
+test:is(#futures[3]:wait_result(), 10, 'select')
+test:is(futures[4]:wait_result()[2], 3, 'update')
+test:is_deeply(futures[5]:wait_result(), {1, 2}, 'eval')
+local res, err = futures[6]:wait_result()
+test:ok(res == nil and err.code == box.error.TUPLE_FOUND, 'error')
+
+-- Responses to discarded requests are ignored.
+batch:call('box.space.test:get', {{1}})
+futures = batch:send()
+futures[1]:discard()
+test:is(conn:ping(), true, 'discarded request')
+
+conn:close()
+batch:ping()
+test:ok(not pcall(batch.send, batch), 'closed connection')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
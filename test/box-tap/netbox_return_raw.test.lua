@@ -0,0 +1,53 @@
+#!/usr/bin/env tarantool
+
+--
+-- With the return_raw option net.box returns the response data
+-- as a msgpack.object, which can be forwarded without decoding.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+local msgpack = require('msgpack')
+
+local test = tap.test('netbox_return_raw')
+test:plan(9)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'super')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 10 do
+    s:insert({i, 'value' .. i})
+end
+rawset(_G, 'echo', function(...) return ... end)
+
+local conn = net_box.connect(box.cfg.listen)
+
+local res = conn.space.test:select({}, {return_raw = true})
+test:is(res:type(), 'array', 'select result is an object')
+test:is(#res, 10, 'all rows are returned')
+test:is(res:get(3, 2), 'value3', 'rows are decoded on access')
+test:is_deeply(res:decode(), conn.space.test:select(),
+               'decoded result is the same')
+
+res = conn:call('echo', {1, {2, 3}}, {return_raw = true})
+test:is_deeply(res:decode(), {1, {2, 3}}, 'call result')
+test:is(msgpack.encode(res), msgpack.encode({1, {2, 3}}),
+        'object is encoded as is')
+
+local future = conn:call('echo', {'x'}, {is_async = true, return_raw = true})
+test:is(future:wait_result():get(1), 'x', 'async request')
+
+-- A router returns results of a call as they are.
+rawset(_G, 'route', function(...)
+    return conn:call('echo', {...}, {return_raw = true}):unpack()
+end)
+test:is_deeply({conn:call('route', {1, {a = {2}}, 'x'})}, {1, {a = {2}}, 'x'},
+               'raw results are passed through')
+test:is(select('#', conn:call('route', {})), 0, 'empty result')
+
+conn:close()
+s:drop()
+box.schema.user.revoke('guest', 'super')
+
+os.exit(test:check() and 0 or 1)
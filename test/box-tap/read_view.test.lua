@@ -0,0 +1,108 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.read_view.open() returns a consistent read view of
+-- several memtx spaces which isn't affected by further writes.
+-- read_view:count() and read_view:aggregate() scan in reader
+-- threads (box.cfg.read_view_threads).
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('read_view')
+test:plan(13)
+
+box.cfg{log = 'tarantool.log', read_view_threads = 2}
+
+local s1 = box.schema.space.create('s1')
+s1:create_index('pk')
+local s2 = box.schema.space.create('s2')
+s2:create_index('pk', {type = 'hash'})
+for i = 1, 100 do
+    s1:replace{i, i}
+    s2:replace{i, -i}
+end
+
+local function scan(rv, space)
+    local result = {}
+    for _, t in rv:pairs(space) do
+        table.insert(result, t:totable())
+    end
+    return result
+end
+
+local rv = box.read_view.open({s1, s2.id})
+
+-- Writes are not blocked by the read view.
+local f = fiber.create(function()
+    for i = 1, 100, 2 do
+        s1:delete{i}
+        s2:update({i}, {{'=', 2, 0}})
+        fiber.yield()
+    end
+    s1:replace{200, 200}
+end)
+f:set_joinable(true)
+f:join()
+test:is(s1:count(), 51, 'writes are done')
+
+local v1 = scan(rv, s1)
+local ok = #v1 == 100
+for i, t in ipairs(v1) do
+    ok = ok and t[1] == i and t[2] == i
+end
+test:ok(ok, 'tree index read view')
+
+local v2 = scan(rv, s2)
+ok = #v2 == 100
+for _, t in ipairs(v2) do
+    ok = ok and t[2] == -t[1]
+end
+test:ok(ok, 'hash index read view')
+rv:close()
+
+-- Scans in reader threads.
+rv = box.read_view.open({s1, s2, box.space._space})
+s1:truncate()
+test:is(rv:count(s1), 51, 'read_view:count()')
+test:is_deeply(rv:aggregate(s2, 2),
+               {count = 100, sum = -2550, min = -100, max = 0},
+               'read_view:aggregate()')
+local res
+f = fiber.create(function() res = rv:aggregate(box.space._space, 1) end)
+f:set_joinable(true)
+ok = pcall(rv.close, rv)
+test:ok(not ok, 'read view is in use while scanned')
+f:join()
+test:ok(res.count > 0 and res.min >= 0, 'concurrent scan')
+s1:drop()
+rv:close()
+
+ok = pcall(rv.pairs, rv, s2)
+test:ok(not ok, 'closed read view')
+
+local s3 = box.schema.space.create('s3', {engine = 'vinyl'})
+s3:create_index('pk')
+local err
+ok, err = pcall(box.read_view.open, {s2, s3})
+test:is(tostring(err), 'vinyl does not support read view', 'vinyl space')
+s3:drop()
+
+local s4 = box.schema.space.create('s4', {temporary = true})
+s4:create_index('pk')
+ok, err = pcall(box.read_view.open, {s4})
+test:is(tostring(err), 'Temporary space does not support read view',
+        'temporary space')
+s4:drop()
+
+ok, err = pcall(box.read_view.open, {12345})
+test:is(tostring(err), "Space '12345' does not exist", 'missing space')
+
+rv = box.read_view.open({s2})
+ok = pcall(rv.pairs, rv, box.space._space)
+test:ok(not ok, 'space not in the read view')
+test:is(#scan(rv, s2), 100, 'read view of one space')
+rv:close()
+s2:drop()
+
+os.exit(test:check() and 0 or 1)
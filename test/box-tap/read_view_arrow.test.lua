@@ -0,0 +1,60 @@
+#!/usr/bin/env tarantool
+
+--
+-- read_view:arrow() and read_view:arrow_export() convert tuples
+-- of a space to the Apache Arrow IPC streaming format.
+--
+local tap = require('tap')
+local fio = require('fio')
+
+local test = tap.test('read_view_arrow')
+test:plan(10)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test', {format = {
+    {'id', 'unsigned'}, {'i', 'integer'}, {'d', 'double'},
+    {'b', 'boolean'}, {'str', 'string', is_nullable = true},
+    {'m', 'map', is_nullable = true},
+}})
+s:create_index('pk')
+for i = 1, 25 do
+    s:insert{i, -i, i / 2, i % 2 == 0, i % 5 ~= 0 and 'v' .. i or nil}
+end
+
+local rv = box.read_view.open({s})
+local opts = {fields = {'id', 'i', 'd', 'b', 'str'}, batch_size = 10}
+local chunks = {}
+for chunk in rv:arrow(s, opts) do
+    table.insert(chunks, chunk)
+end
+-- Schema, two full batches, the last batch with end-of-stream.
+test:is(#chunks, 4, 'one chunk per record batch')
+local stream = table.concat(chunks)
+test:is(stream:sub(1, 4), '\xff\xff\xff\xff', 'continuation marker')
+test:is(stream:sub(-8), '\xff\xff\xff\xff\0\0\0\0', 'end-of-stream marker')
+test:ok(stream:find('v24', 1, true) ~= nil, 'string data')
+test:ok(stream:find('str', 1, true) ~= nil, 'column name')
+
+-- A read view space can be scanned only once.
+rv:close()
+rv = box.read_view.open({s})
+local path = fio.pathjoin(fio.cwd(), 'read_view_arrow.arrow')
+test:is(rv:arrow_export(s, path, opts), 25, 'exported rows')
+local f = fio.open(path)
+test:is(f:read(), stream, 'file matches the stream')
+f:close()
+fio.unlink(path)
+
+local ok, err = pcall(rv.arrow, rv, s)
+test:ok(not ok and err.code == box.error.UNSUPPORTED, 'unsupported type')
+ok, err = pcall(rv.arrow, rv, s, {fields = {'x'}})
+test:ok(not ok and err.code == box.error.NO_SUCH_FIELD_NAME_IN_SPACE,
+        'unknown field')
+ok = pcall(rv.arrow, rv, s, {batch_size = 0})
+test:ok(not ok, 'invalid batch size')
+
+rv:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,83 @@
+#!/usr/bin/env tarantool
+
+--
+-- SELECT_OPEN keeps the iterator open on the server, next
+-- tuples are read with SELECT_FETCH from the same position.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+
+local test = tap.test('select_iterator')
+test:plan(12)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+for i = 1, 10 do
+    s:insert({i, i % 2})
+end
+
+local conn = net_box.connect(box.cfg.listen)
+local index = conn.space.test.index.pk
+
+local function keys(res)
+    local r = {}
+    for _, t in ipairs(res.tuples) do
+        table.insert(r, t[1])
+    end
+    return r
+end
+
+local res = index:select_open({3}, {iterator = 'GE', limit = 3})
+test:is_deeply(keys(res), {3, 4, 5}, 'open')
+local iterator_id = res.iterator_id
+test:ok(iterator_id ~= nil, 'iterator id')
+
+-- Tuples inserted behind the position are skipped, ahead of it
+-- are returned.
+s:insert({11, 1})
+s:delete({6})
+res = conn:select_fetch(iterator_id, 4)
+test:is_deeply(keys(res), {7, 8, 9, 10}, 'fetch')
+test:is(res.iterator_id, iterator_id, 'still open')
+res = conn:select_fetch(iterator_id, 4)
+test:is_deeply(keys(res), {11}, 'last chunk')
+test:is(res.iterator_id, nil, 'closed on end')
+
+local ok, err = pcall(conn.select_fetch, conn, iterator_id, 1)
+test:ok(not ok and err.code == box.error.NO_SUCH_ITERATOR, 'no iterator')
+
+-- The whole result fits the limit.
+res = index:select_open({8}, {iterator = 'LT', limit = 10})
+test:is_deeply({keys(res), res.iterator_id}, {{7, 5, 4, 3, 2, 1}},
+               'no iterator is opened')
+
+-- An equality iterator over a non-unique index outlives the
+-- request key.
+res = conn.space.test.index.sk:select_open({1}, {limit = 2})
+local r = keys(res)
+res = conn:select_fetch(res.iterator_id, 100)
+for _, k in ipairs(keys(res)) do
+    table.insert(r, k)
+end
+test:is_deeply(r, {1, 3, 5, 7, 9, 11}, 'EQ iterator')
+
+res = index:select_open(nil, {limit = 1})
+test:is(conn:select_close(res.iterator_id), nil, 'close')
+ok, err = pcall(conn.select_fetch, conn, res.iterator_id, 1)
+test:ok(not ok and err.code == box.error.NO_SUCH_ITERATOR, 'closed')
+
+-- Iterators are visible only in the session which opened them.
+res = index:select_open(nil, {limit = 1})
+local conn2 = net_box.connect(box.cfg.listen)
+ok = pcall(conn2.select_fetch, conn2, res.iterator_id, 1)
+test:ok(not ok, 'other session')
+conn2:close()
+
+conn:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,46 @@
+#!/usr/bin/env tarantool
+
+--
+-- A sequence with cache = N writes to _sequence_data only the
+-- last value of every block of N values it gives out.
+--
+local tap = require('tap')
+
+local test = tap.test('sequence_cache')
+test:plan(8)
+
+box.cfg{}
+
+local _sequence_data = box.space._sequence_data
+
+local function persisted(seq)
+    return _sequence_data:get(seq.id)[2]
+end
+
+local seq = box.schema.sequence.create('test', {cache = 10})
+test:is(seq:next(), 1, 'first value')
+test:is(persisted(seq), 10, 'block is reserved')
+for _ = 2, 10 do
+    seq:next()
+end
+test:is(persisted(seq), 10, 'values of the block are not written')
+test:is(seq:next(), 11, 'next value after the block')
+test:is(persisted(seq), 20, 'next block is reserved')
+
+box.begin()
+local value = seq:next()
+box.commit()
+test:is(persisted(seq), value, 'value is written in a transaction')
+
+seq:set(100)
+test:is(seq:next(), 101, 'value after set')
+seq:drop()
+
+seq = box.schema.sequence.create('test', {cache = 10, max = 5})
+for _ = 1, 3 do
+    seq:next()
+end
+test:is(persisted(seq), 5, 'block is limited by max')
+seq:drop()
+
+os.exit(test:check() and 0 or 1)
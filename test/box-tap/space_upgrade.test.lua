@@ -0,0 +1,53 @@
+#!/usr/bin/env tarantool
+
+--
+-- space:upgrade() converts tuples in background batches and
+-- installs the new format once all of them are converted.
+--
+local tap = require('tap')
+
+local test = tap.test('space_upgrade')
+test:plan(8)
+
+box.cfg{}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 1000 do
+    s:insert({i, tostring(i)})
+end
+
+local function convert(tuple)
+    if tuple[3] ~= nil then
+        return tuple
+    end
+    return {tuple[1], tuple[2], tuple[1] * 2}
+end
+
+local upgrade = s:upgrade({
+    func = convert,
+    format = {
+        {'id', 'unsigned'},
+        {'name', 'string'},
+        {'double', 'unsigned'},
+    },
+    batch_size = 100,
+})
+test:is(upgrade:info().status, 'inprogress', 'upgrade runs in background')
+-- Writes made during the upgrade must survive it.
+s:replace({1001, '1001', 2002})
+test:ok(upgrade:wait(), 'upgrade is done')
+test:is(upgrade:info().processed, 1001, 'all tuples are processed')
+test:is(s:get(500).double, 1000, 'tuples are converted')
+test:is(s:get(1001).double, 2002, 'concurrent writes are kept')
+test:ok(not pcall(s.insert, s, {1002, '1002'}), 'new format is installed')
+
+upgrade = s:upgrade({func = function(tuple)
+    return {tuple[1] + 10000, tuple[2], tuple[3]}
+end})
+test:ok(not upgrade:wait(), 'primary key change is refused')
+test:is(s:count(), 1001, 'space is intact')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
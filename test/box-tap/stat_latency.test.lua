@@ -0,0 +1,44 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.stat.latency() shows latency percentiles of iproto
+-- requests split into net queue, tx execution and WAL wait
+-- time.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+
+local test = tap.test('stat_latency')
+test:plan(8)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local conn = net_box.connect(box.cfg.listen)
+for i = 1, 10 do
+    conn.space.test:insert({i})
+end
+conn.space.test:select()
+
+local stat = box.stat.latency()
+test:is(stat.INSERT.count, 10, 'requests are counted by type')
+test:ok(stat.SELECT.count >= 1, 'select')
+test:ok(stat.INSERT.tx.p99 >= stat.INSERT.wal.p99, 'tx time includes WAL')
+test:is(stat.SELECT.wal.p99, 0, 'no WAL wait for reads')
+test:ok(stat.INSERT.net.p50 >= 0 and stat.INSERT.net.p50 <= stat.INSERT.net.p99,
+        'net queue time')
+test:is(stat.REPLACE, nil, 'types without requests are omitted')
+test:ok(stat.INSERT.region_max > 0 and
+        stat.INSERT.region_avg <= stat.INSERT.region_max,
+        'region memory used by requests')
+
+box.stat.reset()
+test:is(box.stat.latency().INSERT, nil, 'reset')
+
+conn:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
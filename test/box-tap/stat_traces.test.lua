@@ -0,0 +1,63 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.stat.traces() returns traces of requests carrying a trace
+-- id in the header and of requests sampled according to
+-- box.cfg.net_trace_sample_rate.
+--
+local tap = require('tap')
+local net_box = require('net.box')
+local msgpack = require('msgpack')
+local socket = require('socket')
+local uri = require('uri')
+
+local test = tap.test('stat_traces')
+test:plan(10)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local conn = net_box.connect(box.cfg.listen)
+conn.space.test:insert({1})
+test:is(#box.stat.traces(), 0, 'requests are not traced by default')
+
+box.cfg{net_trace_sample_rate = 1}
+conn.space.test:insert({2})
+local traces = box.stat.traces()
+test:is(#traces, 1, 'sampled request is traced')
+local trace = traces[1]
+test:is(trace.type, 'INSERT', 'request type')
+test:is(trace.id, 0, 'sampled requests have no trace id')
+test:ok(trace.tx >= trace.wal and trace.wal > 0, 'tx time includes WAL')
+test:ok(trace.net >= 0 and trace.limbo == 0, 'net queue and limbo time')
+box.cfg{net_trace_sample_rate = 0}
+
+-- A request with a trace id is traced regardless of sampling.
+local IPROTO_SELECT = 0x01
+local IPROTO_TRACE_ID = 0x0a
+local IPROTO_SPACE_ID = 0x10
+local IPROTO_KEY = 0x20
+local u = uri.parse(box.cfg.listen)
+local sock = socket.tcp_connect(u.host, u.service)
+sock:read(128)
+local request = msgpack.encode({[0x00] = IPROTO_SELECT, [0x01] = 7,
+                                [IPROTO_TRACE_ID] = 12345}) ..
+                msgpack.encode({[IPROTO_SPACE_ID] = s.id, [IPROTO_KEY] = {}})
+sock:write(msgpack.encode(#request) .. request)
+sock:read(5)
+sock:close()
+traces = box.stat.traces()
+test:is(#traces, 2, 'request with a trace id is traced')
+test:is(traces[2].id, 12345, 'trace id')
+test:is(traces[2].sync, 7, 'sync')
+
+box.stat.reset()
+test:is(#box.stat.traces(), 0, 'reset')
+
+conn:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,84 @@
+#!/usr/bin/env tarantool
+
+--
+-- Precompiled comparators for compound keys of unsigned,
+-- integer and string parts. If the first part is equal and
+-- fits in a hint, it isn't compared.
+--
+local tap = require('tap')
+
+local test = tap.test('tuple_compare_fast')
+test:plan(8)
+
+box.cfg{log = 'tarantool.log'}
+
+-- Some values don't fit in a tuple hint.
+local function gen_value(t, i)
+    if t == 'unsigned' then
+        return i % 11 == 0 and 0xFFFFFFFFFFFFFFF0ULL + i % 2 or i % 7
+    elseif t == 'integer' then
+        return i % 13 == 0 and -0x7FFFFFFFFFFFFFF0LL - i % 2 or i % 5 - 2
+    else
+        return string.rep('x', i % 3) .. tostring(i % 4)
+    end
+end
+
+local function less(a, b)
+    for i = 1, #a - 1 do
+        if a[i] ~= b[i] then
+            return a[i] < b[i]
+        end
+    end
+    return a[#a] < b[#b]
+end
+
+local function check(engine, types)
+    local s = box.schema.space.create('test', {engine = engine})
+    local parts = {}
+    for i, t in ipairs(types) do
+        table.insert(parts, {i, t})
+    end
+    -- The last field makes keys unique.
+    table.insert(parts, {#types + 1, 'unsigned'})
+    s:create_index('pk', {parts = parts})
+    local expected = {}
+    for i = 1, 200 do
+        local tuple = {}
+        for _, t in ipairs(types) do
+            table.insert(tuple, gen_value(t, i * 31 % 197))
+        end
+        table.insert(tuple, i)
+        s:replace(tuple)
+        table.insert(expected, tuple)
+    end
+    table.sort(expected, less)
+    local ok = true
+    for i, tuple in ipairs(s:select()) do
+        for j = 1, #types + 1 do
+            ok = ok and tuple[j] == expected[i][j]
+        end
+    end
+    local key = {expected[100][1], expected[100][2]}
+    local count = 0
+    for _, tuple in ipairs(expected) do
+        if tuple[1] == key[1] and tuple[2] == key[2] then
+            count = count + 1
+        end
+    end
+    ok = ok and s:count(key) == count
+    s:drop()
+    return ok
+end
+
+for _, engine in ipairs({'memtx', 'vinyl'}) do
+    test:ok(check(engine, {'integer', 'integer'}),
+            engine .. ': integer, integer, unsigned')
+    test:ok(check(engine, {'string', 'integer', 'unsigned'}),
+            engine .. ': string, integer, unsigned, unsigned')
+    test:ok(check(engine, {'integer', 'string'}),
+            engine .. ': integer, string, unsigned')
+    test:ok(check(engine, {'unsigned', 'string', 'string'}),
+            engine .. ': unsigned, string, string, unsigned')
+end
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,105 @@
+#!/usr/bin/env tarantool
+
+--
+-- Secondary keys of unsigned, integer and string parts, which may
+-- be nullable or collated, use comparators specialized by part
+-- types. Check that they order tuples the same way as the
+-- generic ones.
+--
+local tap = require('tap')
+
+local test = tap.test('tuple_compare_typed')
+test:plan(8)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('u', {parts = {{3, 'unsigned'}}})
+s:create_index('si', {parts = {{2, 'string'}, {4, 'integer'}},
+                      unique = false})
+s:create_index('ci', {parts = {{2, 'string', collation = 'unicode_ci'},
+                               {3, 'unsigned'}}})
+s:create_index('n', {parts = {{5, 'integer', is_nullable = true}},
+                     unique = false})
+s:create_index('nu', {parts = {{5, 'integer', is_nullable = true},
+                               {3, 'unsigned'}}})
+-- Scalar parts don't have typed comparators.
+s:create_index('sc', {parts = {{4, 'scalar'}}, unique = false})
+
+local strs = {'a', 'B', 'c', 'D', 'aa', 'Ab'}
+local tuples = {}
+for i = 1, 60 do
+    local n = i % 7 == 0 and box.NULL or (i * 37) % 11 - 5
+    local t = {i, strs[i % #strs + 1] .. (i % 5), 1000 - i, i % 9 - 4, n}
+    table.insert(tuples, t)
+    s:insert(t)
+end
+
+local function nil_lt(a, b)
+    if a == nil then
+        return b ~= nil
+    end
+    return b ~= nil and a < b
+end
+
+local function check(index, lt)
+    local expected = table.copy(tuples)
+    table.sort(expected, lt)
+    local ok = true
+    local i = 0
+    for _, t in index:pairs() do
+        i = i + 1
+        ok = ok and t[1] == expected[i][1]
+    end
+    return ok and i == #tuples
+end
+
+local function keys_lt(...)
+    local fields = {...}
+    return function(a, b)
+        for _, f in ipairs(fields) do
+            local x, y = f(a), f(b)
+            if x ~= y then
+                return nil_lt(x, y)
+            end
+        end
+        return false
+    end
+end
+
+local function field(no)
+    return function(t)
+        if t[no] == nil then
+            return nil
+        end
+        return t[no]
+    end
+end
+
+local function lower(no)
+    return function(t) return t[no]:lower() end
+end
+
+test:ok(check(s.index.u, keys_lt(field(3))), 'unsigned')
+test:ok(check(s.index.si, keys_lt(field(2), field(4), field(1))),
+        'string, integer + primary key')
+test:ok(check(s.index.ci, keys_lt(lower(2), field(3))), 'collation')
+test:ok(check(s.index.n, keys_lt(field(5), field(1))), 'nullable')
+test:ok(check(s.index.nu, keys_lt(field(5), field(3))),
+        'nullable unique')
+
+local count = 0
+for _, t in ipairs(tuples) do
+    if t[2] == 'B1' then
+        count = count + 1
+    end
+end
+test:is(#s.index.si:select({'B1'}), count, 'partial key')
+local t = s.index.ci:select({'ab1'})
+test:ok(#t > 0 and t[1][2]:lower() == 'ab1', 'collated key')
+test:ok(check(s.index.sc, keys_lt(field(4), field(1))), 'scalar')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
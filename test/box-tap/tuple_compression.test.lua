@@ -0,0 +1,61 @@
+#!/usr/bin/env tarantool
+
+--
+-- Field option compression = 'zstd': large values of the field
+-- are stored compressed in memtx and decompressed when returned
+-- to the user.
+--
+local tap = require('tap')
+
+local test = tap.test('tuple_compression')
+test:plan(13)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test', {format = {
+    {'id', 'unsigned'},
+    {'doc', 'string', compression = 'zstd'},
+    {'note', 'string', is_nullable = true, compression = 'zstd'},
+}})
+s:create_index('pk')
+
+local doc = string.rep('{"key": "value", "list": [1, 2, 3]} ', 100)
+local t = s:replace{1, doc, 'short'}
+test:is(t.doc, doc, 'replace returns the original value')
+test:is_deeply(s:get{1}:totable(), {1, doc, 'short'}, 'get')
+test:is_deeply(s:select()[1]:totable(), {1, doc, 'short'}, 'select')
+local rows = {}
+for _, tuple in s:pairs() do
+    table.insert(rows, tuple:totable())
+end
+test:is_deeply(rows, {{1, doc, 'short'}}, 'pairs')
+test:ok(s:bsize() < #doc / 4, 'the value is compressed')
+
+t = s:update({1}, {{'=', 'note', 'updated'}})
+test:is_deeply({t.doc, t.note}, {doc, 'updated'},
+               'update keeps a compressed field')
+test:is(s:get{1}.note, 'updated', 'short values are stored as is')
+
+local ok = pcall(s.replace, s, {2, {string.rep('x', 100)}})
+test:ok(not ok, 'type of a compressed value is checked')
+
+box.snapshot()
+test:is(s:get{1}.doc, doc, 'value is read after snapshot')
+
+ok = pcall(s.create_index, s, 'sk', {parts = {2, 'string'}})
+test:ok(not ok, 'compressed field can not be indexed')
+
+ok = pcall(s.format, s, {{'id', 'unsigned'}, {'doc', 'string'}})
+test:ok(not ok, 'compression can not be dropped from a non-empty space')
+
+ok = pcall(box.schema.space.create, 'test2',
+           {format = {{'f', 'string', compression = 'lz4'}}})
+test:ok(not ok, 'unknown compression type')
+
+ok = pcall(box.schema.space.create, 'test2',
+           {engine = 'vinyl', format = {{'f', compression = 'zstd'}}})
+test:ok(not ok, 'vinyl does not support compression')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,39 @@
+#!/usr/bin/env tarantool
+
+--
+-- tuple['path'] goes through FFI. Check that names, JSON paths
+-- and method lookups work as before.
+--
+local tap = require('tap')
+
+local test = tap.test('tuple_field_by_path')
+test:plan(9)
+
+box.cfg{log = 'tarantool.log'}
+
+local format = {{'id', 'unsigned'}, {'name', 'string'},
+                {'bsize', 'unsigned'}, {'data', 'map'},
+                {'opt', 'any', is_nullable = true}}
+local s = box.schema.space.create('test', {format = format})
+s:create_index('pk')
+local t = s:insert{1, 'abc', 10, {a = {b = {1, 2, 3}}}, box.NULL}
+
+test:is(t.id, 1, 'unsigned by name')
+test:is(t.name, 'abc', 'string by name')
+test:is(t.bsize, 10, 'field shadows a method')
+test:is(t['data.a.b[2]'], 2, 'JSON path')
+test:is(t['[2]'], 'abc', 'field number as a path')
+test:is(t.opt, nil, 'nil field')
+test:is(t[''], nil, 'empty path')
+test:is(t.tomap, box.tuple.tomap, 'method')
+
+local sum = 0
+for _ = 1, 1000 do
+    local tuple = s:get{1}
+    sum = sum + tuple.id + tuple.bsize
+end
+test:is(sum, 11000, 'hot loop')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
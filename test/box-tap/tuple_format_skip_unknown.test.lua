@@ -0,0 +1,67 @@
+#!/usr/bin/env tarantool
+
+--
+-- Field map construction stops decoding a map or an array once
+-- all the indexed paths it contains have been found. The rest of
+-- the document must not affect indexing and validation.
+--
+local tap = require('tap')
+
+local test = tap.test('tuple_format_skip_unknown')
+test:plan(9)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('a', {parts = {{2, 'unsigned', path = 'a'}}})
+s:create_index('bc', {parts = {{2, 'string', path = 'b.c'}},
+                      unique = false})
+s:create_index('arr', {parts = {{3, 'unsigned', path = '[2]'}},
+                       unique = false})
+
+local function doc(i)
+    local d = {a = i, b = {c = 'c' .. i % 3}}
+    for j = 1, 50 do
+        d['x' .. j] = {j, {y = j}}
+        d.b['y' .. j] = j
+    end
+    return d
+end
+
+for i = 1, 20 do
+    s:insert{i, doc(i), {i, i * 10, {z = i}, i}}
+end
+
+test:is(s.index.a:get{7}[1], 7, 'path in a wide map')
+test:is(s.index.bc:count{'c1'}, 7, 'path in a nested wide map')
+test:is(s.index.arr:get{50}[1], 5, 'path in an array')
+test:is(s.index.a:get{7}[2].x50[2].y, 50, 'skipped data is intact')
+
+local d = doc(100)
+d.b.c = 100
+local ok, err = pcall(s.insert, s, {100, d, {1, 1}})
+test:ok(not ok and err.code == box.error.FIELD_TYPE, 'type is checked')
+d = doc(100)
+d.b = {y = 1}
+ok, err = pcall(s.insert, s, {100, d, {1, 1}})
+test:ok(not ok and err.code == box.error.FIELD_MISSING,
+        'missing path is detected')
+
+s:update({3}, {{'=', 3, {3, 300, 'tail'}}})
+test:is(s.index.arr:get{300}[1], 3, 'update')
+
+local mk = box.schema.space.create('mk')
+mk:create_index('pk')
+mk:create_index('mk', {parts = {{2, 'unsigned', path = '[*].id'}}})
+mk:insert{1, {{id = 1, x = 1}, {x = 2, id = 2}, {id = 3}}}
+mk:insert{2, {{id = 4}, {x = 5, id = 5, y = 5}}}
+test:is(mk.index.mk:count(), 5, 'multikey')
+ok, err = pcall(mk.insert, mk, {3, {{id = 6}, {x = 7}}})
+test:ok(not ok and err.code == box.error.FIELD_MISSING,
+        'multikey missing path is detected')
+
+mk:drop()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,64 @@
+#!/usr/bin/env tarantool
+
+--
+-- Sequential keys of types without a pre-generated hasher are
+-- hashed without parsing every field. Tuple and key hashes must
+-- still match each other.
+--
+local tap = require('tap')
+local uuid = require('uuid')
+local decimal = require('decimal')
+
+local test = tap.test('tuple_hash_sequential')
+test:plan(6)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+s:create_index('int', {type = 'hash',
+                       parts = {{2, 'integer'}, {3, 'string'}}})
+s:create_index('mixed', {type = 'hash',
+                         parts = {{3, 'string'}, {4, 'boolean'},
+                                  {5, 'unsigned'}, {6, 'string'}}})
+s:create_index('ext', {type = 'hash',
+                       parts = {{7, 'uuid'}, {8, 'decimal'}}})
+
+local uuids = {}
+for i = 1, 100 do
+    uuids[i] = uuid.new()
+    s:insert{i, i - 50, 'k' .. i, i % 2 == 0, i * 1000, 'v' .. i,
+             uuids[i], decimal.new(i) / 10}
+end
+
+local ok = true
+for i = 1, 100 do
+    local t = s.index.int:get{i - 50, 'k' .. i}
+    ok = ok and t ~= nil and t[1] == i
+end
+test:ok(ok, 'integer and string')
+
+ok = true
+for i = 1, 100 do
+    local t = s.index.mixed:get{'k' .. i, i % 2 == 0, i * 1000, 'v' .. i}
+    ok = ok and t ~= nil and t[1] == i
+end
+test:ok(ok, 'mixed runs of raw and string fields')
+test:is(s.index.mixed:get{'k1', true, 1000, 'v1'}, nil, 'no false match')
+
+ok = true
+for i = 1, 100 do
+    local t = s.index.ext:get{uuids[i], decimal.new(i) / 10}
+    ok = ok and t ~= nil and t[1] == i
+end
+test:ok(ok, 'extension types')
+
+s:delete{10}
+test:is(s.index.int:get{-40, 'k10'}, nil, 'delete')
+s:replace{11, 1000, 'x', true, 1, 'y', uuid.new(), decimal.new(1)}
+test:ok(s.index.int:get{-39, 'k11'} == nil and
+        s.index.int:get{1000, 'x'}[1] == 11, 'replace')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,159 @@
+#!/usr/bin/env tarantool
+
+--
+-- Compound keys starting with integer parts get comparison hints
+-- composed of several parts. Check that the order of tuples and
+-- the results of range scans by full and partial keys are the
+-- same as the ones computed in Lua, including integers that
+-- don't fit in their share of the hint.
+--
+local tap = require('tap')
+
+local test = tap.test('tuple_hint_composite')
+test:plan(9)
+
+box.cfg{log = 'tarantool.log'}
+
+local integers = {
+    0, 1, 2, -1, -2, 7,
+    2^19 - 3, 2^19 - 2, 2^19 - 1, -2^19 + 1, -2^19, -2^19 - 1,
+    2^29 - 3, 2^29 - 2, 2^29 - 1, -2^29 + 1, -2^29, -2^29 - 1,
+    2^40, -2^40, 0x7FFFFFFFFFFFFFFFLL, -0x7FFFFFFFFFFFFFFFLL,
+}
+
+local function gen_value(t, i)
+    local v = integers[i % #integers + 1]
+    if t == 'unsigned' then
+        return v < 0 and -v or v
+    elseif t == 'integer' then
+        return v
+    elseif t == 'number' then
+        return v + (i % 3) / 4
+    else
+        return string.rep('x', i % 3) .. tostring(i % 4)
+    end
+end
+
+local function less(a, b)
+    for i = 1, #a do
+        if a[i] ~= b[i] then
+            return a[i] < b[i]
+        end
+    end
+    return false
+end
+
+local function same(a, b)
+    if #a ~= #b then
+        return false
+    end
+    for i = 1, #a do
+        for j = 1, #a[i] do
+            if a[i][j] ~= b[i][j] then
+                return false
+            end
+        end
+    end
+    return true
+end
+
+local function fill(s, types)
+    local expected = {}
+    for i = 1, 300 do
+        local tuple = {}
+        for _, t in ipairs(types) do
+            table.insert(tuple, gen_value(t, i * 31 % 293))
+        end
+        -- The last field makes keys unique.
+        table.insert(tuple, i)
+        s:replace(tuple)
+        table.insert(expected, tuple)
+    end
+    table.sort(expected, less)
+    return expected
+end
+
+local function key_less(tuple, key)
+    for i = 1, #key do
+        if tuple[i] ~= key[i] then
+            return tuple[i] < key[i]
+        end
+    end
+    return false
+end
+
+local function check_ranges(index, expected)
+    for i = 1, #expected, 17 do
+        local tuple = expected[i]
+        for part_count = 1, #tuple - 1 do
+            local key = {}
+            for j = 1, part_count do
+                key[j] = tuple[j]
+            end
+            local ge = {}
+            for _, t in ipairs(expected) do
+                if not key_less(t, key) then
+                    table.insert(ge, t)
+                end
+            end
+            if not same(index:select(key, {iterator = 'GE'}), ge) then
+                return false
+            end
+            local lt = {}
+            for j = #expected, 1, -1 do
+                if key_less(expected[j], key) then
+                    table.insert(lt, expected[j])
+                end
+            end
+            if not same(index:select(key, {iterator = 'LT'}), lt) then
+                return false
+            end
+        end
+    end
+    return true
+end
+
+local function check(engine, types)
+    local s = box.schema.space.create('test', {engine = engine})
+    local parts = {}
+    for i, t in ipairs(types) do
+        table.insert(parts, {i, t})
+    end
+    table.insert(parts, {#types + 1, 'unsigned'})
+    s:create_index('pk', {parts = parts})
+    local expected = fill(s, types)
+    local ok = same(s:select(), expected) and
+               check_ranges(s.index.pk, expected)
+    s:drop()
+    return ok
+end
+
+for _, engine in ipairs({'memtx', 'vinyl'}) do
+    test:ok(check(engine, {'unsigned', 'unsigned'}),
+            engine .. ': unsigned, unsigned, unsigned')
+    test:ok(check(engine, {'integer', 'string'}),
+            engine .. ': integer, string, unsigned')
+    test:ok(check(engine, {'integer', 'unsigned', 'number'}),
+            engine .. ': integer, unsigned, number, unsigned')
+    test:ok(check(engine, {'unsigned', 'integer', 'integer', 'string'}),
+            engine .. ': unsigned, integer, integer, string, unsigned')
+end
+
+--
+-- Altering the type of a leading part so that it can't be packed
+-- in a composite hint anymore rebuilds the index.
+--
+local s = box.schema.space.create('test')
+s:create_index('pk', {parts = {{1, 'unsigned'}, {2, 'unsigned'},
+                               {3, 'unsigned'}}})
+local expected = fill(s, {'unsigned', 'unsigned'})
+s.index.pk:alter({parts = {{1, 'number'}, {2, 'unsigned'},
+                           {3, 'unsigned'}}})
+s:replace({0.5, 1, 1000})
+table.insert(expected, {0.5, 1, 1000})
+table.sort(expected, less)
+test:ok(same(s:select(), expected) and check_ranges(s.index.pk, expected),
+        'alter of a leading part type')
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,53 @@
+#!/usr/bin/env tarantool
+
+--
+-- tuple:tojson() and space:select_json() encode tuples as JSON
+-- straight from MessagePack.
+--
+local tap = require('tap')
+local json = require('json')
+local decimal = require('decimal')
+local uuid = require('uuid')
+
+local test = tap.test('tuple_json')
+test:plan(10)
+
+box.cfg{log = 'tarantool.log'}
+
+local t = box.tuple.new{1, -2, 'a"b\n', true, box.NULL, {1, {x = 2}}, 1.5}
+test:is(t:tojson(), json.encode(t:totable()), 'no names')
+
+local s = box.schema.space.create('test', {format = {
+    {'id', 'unsigned'},
+    {'name', 'string'},
+    {'data', 'any', is_nullable = true},
+}})
+s:create_index('pk')
+s:insert{1, 'one', {a = {1, 2}}}
+s:insert{2, 'two', box.NULL, 'extra'}
+s:insert{3, 'three', decimal.new('1.25')}
+local u = uuid.new()
+s:insert{4, 'four', u}
+
+test:is_deeply(json.decode(s:get{1}:tojson()),
+               {id = 1, name = 'one', data = {a = {1, 2}}}, 'names')
+test:is_deeply(json.decode(s:get{2}:tojson()),
+               {id = 2, name = 'two', data = json.NULL, ['4'] = 'extra'},
+               'not named field')
+test:is(s:get{1}:tojson({names = false}), '[1,"one",{"a":[1,2]}]',
+        'names = false')
+test:is(s:get{3}:tojson({names = false}), '[3,"three","1.25"]', 'decimal')
+test:is(s:get{4}.data, u, 'uuid is stored')
+test:is(s:get{4}:tojson({names = false}),
+        string.format('[4,"four","%s"]', u:str()), 'uuid')
+
+test:is(s:select_json({2}, {iterator = 'LE', names = false}),
+        '[[2,"two",null,"extra"],[1,"one",{"a":[1,2]}]]', 'select_json')
+test:is(s:select_json({10}), '[]', 'empty select_json')
+
+local ok = pcall(t.tojson, t, 'bad')
+test:ok(not ok, 'bad options')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
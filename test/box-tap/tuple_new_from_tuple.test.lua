@@ -0,0 +1,31 @@
+#!/usr/bin/env tarantool
+
+--
+-- A tuple created from another tuple is built right from the
+-- source tuple data.
+--
+local tap = require('tap')
+local key_def = require('key_def')
+
+local test = tap.test('tuple_new_from_tuple')
+test:plan(5)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test', {format = {{'id', 'unsigned'},
+                                                     {'name', 'string'}}})
+s:create_index('pk')
+local src = s:insert{1, 'abc', {1, 2, 3}}
+
+local t = box.tuple.new(src)
+test:is_deeply(t:totable(), src:totable(), 'same data')
+test:ok(t ~= src, 'new tuple')
+test:is(t.name, nil, 'default format')
+test:is_deeply(box.tuple.new(box.tuple.new()):totable(), {}, 'empty tuple')
+
+local kd = key_def.new({{fieldno = 2, type = 'string'}})
+test:is_deeply(kd:extract_key(src):totable(), {'abc'}, 'key_def')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
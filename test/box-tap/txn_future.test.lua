@@ -0,0 +1,72 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.commit{wait = 'none' | 'wal'} returns a future, the commit
+-- including waiting for a quorum goes on in background.
+--
+local tap = require('tap')
+
+local test = tap.test('txn_future')
+test:plan(12)
+
+box.cfg{replication_synchro_quorum = 1, replication_synchro_timeout = 1000}
+
+local s = box.schema.space.create('sync', {is_sync = true})
+s:create_index('pk')
+
+box.begin()
+s:insert{0}
+local f = box.commit({wait = 'none'})
+test:ok(not f:is_ready() and not box.is_in_txn(), 'commit is in progress')
+test:is(f:wait(), true, 'wait')
+test:ok(f:is_ready() and s:get{0} ~= nil, 'committed')
+
+-- One fiber pipelines many transactions, they are committed in
+-- order, so it is enough to wait for the last one.
+local futures = {}
+for i = 1, 100 do
+    box.begin()
+    s:insert{i}
+    table.insert(futures, box.commit({wait = 'none'}))
+end
+futures[#futures]:wait()
+local ready = true
+for _, future in ipairs(futures) do
+    ready = ready and future:is_ready()
+end
+test:ok(ready and s:count() == 101, 'pipeline')
+
+box.begin()
+s:insert{101}
+f = box.commit({wait = 'wal'})
+test:is(f:wait(), true, 'wait for WAL')
+
+test:ok(box.commit({wait = 'none'}):is_ready(), 'no transaction')
+local ok = pcall(box.commit, {wait = 'disk'})
+test:ok(not ok, 'invalid wait mode')
+
+-- The future is not ready until a quorum is collected.
+box.cfg{replication_synchro_quorum = 2}
+box.begin()
+s:insert{102}
+f = box.commit({wait = 'wal'})
+local err
+ok, err = pcall(f.wait, f, 0.01)
+test:ok(not ok and err.code == box.error.TIMEOUT, 'wait timeout')
+test:ok(not f:is_ready(), 'waiting for quorum')
+box.cfg{replication_synchro_quorum = 1}
+test:is(f:wait(), true, 'quorum is collected')
+
+-- A transaction is rolled back on the quorum timeout.
+box.cfg{replication_synchro_quorum = 2, replication_synchro_timeout = 0.01}
+box.begin()
+s:insert{103}
+f = box.commit({wait = 'none'})
+ok, err = pcall(f.wait, f)
+test:ok(not ok and err.code == box.error.SYNC_QUORUM_TIMEOUT, 'rollback')
+test:is(s:get{103}, nil, 'rolled back')
+box.cfg{replication_synchro_quorum = 1}
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
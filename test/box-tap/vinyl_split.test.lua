@@ -0,0 +1,78 @@
+#!/usr/bin/env tarantool
+
+--
+-- index:split() returns keys splitting a vinyl index into ranges
+-- of about the same size, index:pairs_parallel() scans them in
+-- separate fibers.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('vinyl_split')
+test:plan(9)
+
+box.cfg{log = 'tarantool.log'}
+
+local s = box.schema.space.create('test', {engine = 'vinyl'})
+local pk = s:create_index('pk', {range_size = 16 * 1024, page_size = 1024})
+local sk = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false,
+                                 range_size = 16 * 1024, page_size = 1024})
+test:is_deeply(pk:split(4), {}, 'empty index makes one range')
+
+local pad = string.rep('x', 100)
+for i = 1, 2000 do
+    s:replace({i, i % 100, pad})
+end
+box.snapshot()
+pk:compact()
+sk:compact()
+local deadline = fiber.clock() + 30
+while (pk:stat().range_count < 4 or sk:stat().range_count < 4) and
+      fiber.clock() < deadline do
+    fiber.sleep(0.01)
+end
+
+local keys = pk:split(4)
+test:ok(#keys > 0 and #keys <= 3, 'index is split')
+local sorted = true
+for i = 2, #keys do
+    sorted = sorted and keys[i - 1][1] < keys[i][1]
+end
+test:ok(sorted, 'keys are sorted')
+test:is(#pk:split(1), 0, 'one range')
+keys = sk:split(4)
+test:ok(#keys > 0 and #keys[1] == 1, 'secondary key parts only')
+
+local function ids(ordered, gen, param, state)
+    local result = {}
+    for _, tuple in gen, param, state do
+        table.insert(result, tuple[1])
+    end
+    if not ordered then
+        table.sort(result)
+    end
+    return result
+end
+
+local expected = ids(true, pk:pairs())
+test:is_deeply(ids(false, pk:pairs_parallel({chunk = 10})), expected,
+               'unordered scan')
+test:is_deeply(ids(true, s:pairs_parallel({ordered = true})), expected,
+               'ordered scan')
+local by_sk = {}
+for _, tuple in sk:pairs() do
+    table.insert(by_sk, tuple[1])
+end
+local parallel = ids(true, sk:pairs_parallel({ordered = true, chunk = 7}))
+test:is_deeply(parallel, by_sk, 'ordered scan of a secondary index')
+s:drop()
+
+local m = box.schema.space.create('memtx')
+m:create_index('pk')
+m:insert({1})
+m:insert({2})
+test:is_deeply(ids(false, m:pairs_parallel()), {1, 2},
+               'memtx index is one range')
+m:drop()
+
+os.exit(test:check() and 0 or 1)
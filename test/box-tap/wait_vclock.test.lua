@@ -0,0 +1,94 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.wait_vclock() and IPROTO_WAIT_VCLOCK make a request wait
+-- until the replica set vclock reaches the given one.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+local msgpack = require('msgpack')
+local socket = require('socket')
+local uri = require('uri')
+
+local test = tap.test('wait_vclock')
+test:plan(9)
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read', 'universe')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local id = box.info.id
+local function next_vclock()
+    return {[id] = box.info.vclock[id] + 1}
+end
+
+test:ok(pcall(box.wait_vclock, box.info.vclock), 'reached vclock')
+test:ok(not pcall(box.wait_vclock, 'foo'), 'wrong vclock')
+local ok, err = pcall(box.wait_vclock, next_vclock(), 0.01)
+test:ok(not ok and tostring(err):find('timed out') ~= nil, 'timeout')
+
+local done = false
+local f = fiber.new(function()
+    box.wait_vclock(next_vclock())
+    done = true
+end)
+f:set_joinable(true)
+fiber.yield()
+test:ok(not done, 'fiber waits for a write')
+s:insert({1})
+f:join()
+test:ok(done, 'fiber is woken up by a write')
+
+local IPROTO_SELECT = 0x01
+local IPROTO_WAIT_VCLOCK = 0x0b
+local IPROTO_WAIT_VCLOCK_TIMEOUT = 0x0c
+local IPROTO_SPACE_ID = 0x10
+local IPROTO_KEY = 0x20
+local IPROTO_DATA = 0x30
+local u = uri.parse(box.cfg.listen)
+local sock = socket.tcp_connect(u.host, u.service)
+sock:read(128)
+
+local function map(vclock)
+    return setmetatable(vclock, {__serialize = 'map'})
+end
+
+local function send(header)
+    header[0x00] = IPROTO_SELECT
+    header[0x01] = 1
+    local request = msgpack.encode(header) ..
+                    msgpack.encode({[IPROTO_SPACE_ID] = s.id,
+                                    [IPROTO_KEY] = {}})
+    sock:write(msgpack.encode(#request) .. request)
+end
+
+local function recv()
+    local len = msgpack.decode(sock:read(5))
+    local response = sock:read(len)
+    local header, pos = msgpack.decode(response)
+    return header, msgpack.decode(response, pos)
+end
+
+send({[IPROTO_WAIT_VCLOCK] = map(box.info.vclock)})
+local header, body = recv()
+test:is(header[0x00], 0, 'request with a reached vclock')
+
+send({[IPROTO_WAIT_VCLOCK] = map(next_vclock()),
+      [IPROTO_WAIT_VCLOCK_TIMEOUT] = 0.01})
+header = recv()
+test:ok(header[0x00] >= 0x8000, 'request times out')
+
+-- The request sees the write it waited for.
+send({[IPROTO_WAIT_VCLOCK] = map(next_vclock())})
+fiber.sleep(0.01)
+s:insert({2})
+header, body = recv()
+test:is(header[0x00], 0, 'request waits for a write')
+test:is(#body[IPROTO_DATA], 2, 'request sees the write')
+
+sock:close()
+s:drop()
+
+os.exit(test:check() and 0 or 1)
@@ -0,0 +1,60 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cfg.wal_compression_*: big WAL blocks are split into parts
+-- compressed in parallel by wal_compression_threads.
+--
+local tap = require('tap')
+local fio = require('fio')
+local xlog = require('xlog')
+
+local test = tap.test('wal_compression')
+test:plan(5)
+
+local ok, err = pcall(box.cfg, {wal_compression_level = 0})
+test:ok(not ok and tostring(err):match('wal_compression_level') ~= nil,
+        'wal_compression_level must be positive')
+ok, err = pcall(box.cfg, {wal_compression_threads = -1})
+test:ok(not ok and tostring(err):match('wal_compression_threads') ~= nil,
+        'wal_compression_threads must not be negative')
+
+box.cfg{
+    wal_compression_level = 1,
+    wal_compression_threshold = 0,
+    wal_compression_threads = 3,
+}
+test:is(box.cfg.wal_compression_threads, 3, 'box.cfg.wal_compression_threads')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local ROW_COUNT = 20000
+box.begin()
+for i = 1, ROW_COUNT do
+    s:replace{i, string.rep(tostring(i), 20)}
+end
+box.commit()
+for i = 1, 100 do
+    s:replace{ROW_COUNT + i}
+end
+-- Close the current WAL.
+box.snapshot()
+
+local rows = 0
+local valid = true
+for _, path in ipairs(fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog'))) do
+    for _, row in xlog.pairs(path) do
+        if row.BODY and row.BODY.space_id == s.id then
+            local tuple = row.BODY.tuple
+            rows = rows + 1
+            valid = valid and (tuple[1] > ROW_COUNT or
+                               tuple[2] == string.rep(tostring(tuple[1]), 20))
+        end
+    end
+end
+test:is(rows, ROW_COUNT + 100, 'all rows are written')
+test:ok(valid, 'rows are decompressed correctly')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
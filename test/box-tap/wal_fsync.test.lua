@@ -0,0 +1,56 @@
+#!/usr/bin/env tarantool
+
+--
+-- wal_mode = 'fsync': the WAL file is synced in the background
+-- while the next batches are being written, transactions are
+-- committed once the sync completes.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('wal_fsync')
+test:plan(8)
+
+box.cfg{wal_mode = 'fsync'}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local FIBER_COUNT = 20
+local ROW_COUNT = 50
+local stat1 = box.stat.wal()
+local cond = fiber.cond()
+local done = 0
+for i = 1, FIBER_COUNT do
+    fiber.create(function()
+        for j = 1, ROW_COUNT do
+            s:replace{(i - 1) * ROW_COUNT + j}
+        end
+        done = done + 1
+        cond:signal()
+    end)
+end
+while done < FIBER_COUNT do
+    cond:wait()
+end
+local stat2 = box.stat.wal()
+
+test:is(s:count(), FIBER_COUNT * ROW_COUNT, 'all requests are committed')
+test:ok(stat2.syncs > stat1.syncs, 'WAL is synced')
+test:ok(stat2.syncs - stat1.syncs <= stat2.writes - stat1.writes,
+        'no more syncs than writes')
+
+-- Write and sync statistics.
+test:is(stat2.rows - stat1.rows, FIBER_COUNT * ROW_COUNT, 'rows')
+test:ok(stat2.bytes - stat1.bytes > 0, 'bytes')
+test:ok(stat2.batch.rows.p50 >= 1 and
+        stat2.batch.rows.p99 >= stat2.batch.rows.p50, 'batch size')
+test:ok(stat2.time.sync.p50 > 0 and
+        stat2.time.commit.p99 >= stat2.time.write.p50, 'latency')
+
+-- The file is synced before it's closed by a checkpoint.
+test:ok(pcall(box.snapshot), 'snapshot')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
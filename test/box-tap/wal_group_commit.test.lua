@@ -0,0 +1,65 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cfg.wal_group_commit_delay: batches of WAL requests are
+-- held in the WAL thread to be written and synced together.
+--
+local tap = require('tap')
+local fiber = require('fiber')
+
+local test = tap.test('wal_group_commit')
+test:plan(9)
+
+local ok, err = pcall(box.cfg, {wal_group_commit_delay = -1})
+test:ok(not ok and tostring(err):match('wal_group_commit_delay') ~= nil,
+        'wal_group_commit_delay must not be negative')
+ok, err = pcall(box.cfg, {wal_group_commit_max_size = 0})
+test:ok(not ok and tostring(err):match('wal_group_commit_max_size') ~= nil,
+        'wal_group_commit_max_size must be positive')
+
+box.cfg{wal_group_commit_delay = 0.01}
+test:is(box.cfg.wal_group_commit_delay, 0.01, 'box.cfg.wal_group_commit_delay')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+
+local function load(fiber_count, row_count)
+    local cond = fiber.cond()
+    local done = 0
+    for i = 1, fiber_count do
+        fiber.create(function()
+            for j = 1, row_count do
+                s:replace{(i - 1) * row_count + j}
+            end
+            done = done + 1
+            cond:signal()
+        end)
+    end
+    while done < fiber_count do
+        cond:wait()
+    end
+end
+
+local FIBER_COUNT = 50
+local ROW_COUNT = 20
+local stat1 = box.stat.wal()
+load(FIBER_COUNT, ROW_COUNT)
+local stat2 = box.stat.wal()
+test:is(s:count(), FIBER_COUNT * ROW_COUNT, 'all requests are committed')
+test:ok(stat2.group_commit.delayed > stat1.group_commit.delayed,
+        'batches are held')
+test:ok(stat2.group_commit.merged > stat1.group_commit.merged,
+        'batches are merged')
+test:ok(stat2.writes - stat1.writes < stat2.entries - stat1.entries,
+        'fewer writes than transactions')
+
+-- Pending rows are flushed before a checkpoint.
+box.cfg{wal_group_commit_delay = 10}
+fiber.create(function() s:replace{0} end)
+test:ok(pcall(box.snapshot), 'snapshot with a held batch')
+test:is(s:get{0} ~= nil, true, 'held batch is committed by snapshot')
+
+box.cfg{wal_group_commit_delay = 0}
+s:drop()
+
+os.exit(test:check() and 0 or 1)
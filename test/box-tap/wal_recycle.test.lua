@@ -0,0 +1,78 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.cfg.wal_recycle_count: WAL rotation renames preallocated
+-- spare files into place instead of creating new files.
+--
+local tap = require('tap')
+local fio = require('fio')
+local fiber = require('fiber')
+local xlog = require('xlog')
+
+local test = tap.test('wal_recycle')
+test:plan(7)
+
+local ok, err = pcall(box.cfg, {wal_recycle_count = -1})
+test:ok(not ok and tostring(err):match('wal_recycle_count') ~= nil,
+        'wal_recycle_count must not be negative')
+
+box.cfg{
+    log = 'tarantool.log',
+    wal_max_size = 1024,
+    checkpoint_count = 1,
+    wal_recycle_count = 3,
+}
+
+local function glob(pattern)
+    return fio.glob(fio.pathjoin(box.cfg.wal_dir, pattern))
+end
+
+local function wait_spares(count)
+    local deadline = fiber.clock() + 10
+    while #glob('*.spare') ~= count and fiber.clock() < deadline do
+        fiber.sleep(0.01)
+    end
+    return #glob('*.spare')
+end
+
+local function count_rows(space)
+    local rows = 0
+    for _, path in ipairs(glob('*.xlog')) do
+        for _, row in xlog.pairs(path) do
+            if row.BODY and row.BODY.space_id == space.id then
+                rows = rows + 1
+            end
+        end
+    end
+    return rows
+end
+
+test:is(wait_spares(1), 1, 'spare file is created')
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+local ROW_COUNT = 100
+for i = 1, ROW_COUNT do
+    s:insert({i, string.rep('x', 100)})
+end
+test:ok(#glob('*.xlog') > 2, 'WAL is rotated')
+test:is(wait_spares(1), 1, 'spare file is replenished')
+
+-- Old WAL files are turned into spare ones by garbage collection.
+box.snapshot()
+test:is(wait_spares(3), 3, 'old WAL files are recycled')
+
+-- Keep the WAL files written since the last checkpoint.
+box.cfg{checkpoint_count = 2}
+for i = 1, ROW_COUNT do
+    s:replace({i})
+end
+box.snapshot()
+test:is(count_rows(s), ROW_COUNT, 'recycled WAL files are readable')
+
+box.cfg{wal_recycle_count = 0}
+test:is(wait_spares(0), 0, 'spare files are removed')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
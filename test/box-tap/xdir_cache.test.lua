@@ -0,0 +1,73 @@
+#!/usr/bin/env tarantool
+
+--
+-- Headers of log files are cached in xlog.index and snap.index
+-- files on startup, so that the next startup doesn't have to
+-- read every file. Check that recovery works with a valid, a
+-- stale and a malformed cache.
+--
+local tap = require('tap')
+local fio = require('fio')
+
+local test = tap.test('xdir_cache')
+test:plan(7)
+
+local tarantool_bin = arg[-1]
+local dir = fio.tempdir()
+
+local function run_script(code)
+    local script_path = fio.pathjoin(dir, 'script.lua')
+    fio.unlink(script_path)
+    local script = fio.open(script_path, {'O_CREAT', 'O_WRONLY'},
+        tonumber('0666', 8))
+    script:write("box.cfg{log = 'tarantool.log'}\n")
+    script:write(code)
+    script:close()
+    local cmd = [[/bin/sh -c 'cd "%s" && "%s" ./script.lua 2> /dev/null']]
+    return os.execute(string.format(cmd, dir, tarantool_bin)) == 0
+end
+
+-- Write some snapshots and several xlogs.
+test:ok(run_script([[
+    local s = box.schema.space.create('test')
+    s:create_index('pk')
+    for i = 1, 50 do
+        s:replace({i})
+        if i % 10 == 0 then
+            box.snapshot()
+        end
+    end
+    os.exit(0)
+]]), 'bootstrap')
+
+local check = [[
+    os.exit(box.space.test:count() == %d and 0 or 1)
+]]
+
+test:ok(run_script(string.format(check, 50)), 'recovery without cache')
+test:ok(fio.path.exists(fio.pathjoin(dir, 'xlog.index')) and
+        fio.path.exists(fio.pathjoin(dir, 'snap.index')),
+        'cache files are created')
+
+test:ok(run_script(string.format(check, 50)), 'recovery with cache')
+
+-- Files removed by garbage collection and added after the
+-- cache was written.
+test:ok(run_script([[
+    box.cfg{checkpoint_count = 1}
+    for i = 51, 60 do
+        box.space.test:replace({i})
+        box.snapshot()
+    end
+    os.exit(0)
+]]), 'files added and removed')
+test:ok(run_script(string.format(check, 60)), 'recovery with stale cache')
+
+local f = fio.open(fio.pathjoin(dir, 'xlog.index'), {'O_WRONLY', 'O_TRUNC'})
+f:write('XLOG INDEX\n1 2 garbage\n')
+f:close()
+test:ok(run_script(string.format(check, 60)), 'recovery with malformed cache')
+
+fio.rmtree(dir)
+
+os.exit(test:check() and 0 or 1)
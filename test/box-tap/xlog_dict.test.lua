@@ -0,0 +1,82 @@
+#!/usr/bin/env tarantool
+
+--
+-- box.ctl.train_xlog_dict() trains a zstd dictionary on rows of
+-- existing files, box.cfg.xlog_compression_dict makes new WAL
+-- files and snapshots use it.
+--
+local tap = require('tap')
+local fio = require('fio')
+local xlog = require('xlog')
+
+local test = tap.test('xlog_dict')
+test:plan(8)
+
+box.cfg{wal_compression_threshold = 0}
+
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 20000 do
+    s:replace{i, 'name' .. i, i * 10, {tag = 'x' .. (i % 7)}}
+end
+box.snapshot()
+
+local ok, err = pcall(box.ctl.train_xlog_dict, 0)
+test:ok(not ok and tostring(err):match('must be positive') ~= nil,
+        'invalid dictionary size')
+
+local id = box.ctl.train_xlog_dict(16 * 1024)
+test:ok(type(id) == 'number' and id > 0, 'dictionary is trained')
+local name = string.format('%u.zdict', id)
+test:ok(fio.path.exists(fio.pathjoin(box.cfg.wal_dir, name)) and
+        fio.path.exists(fio.pathjoin(box.cfg.memtx_dir, name)),
+        'dictionary is saved to both directories')
+
+ok, err = pcall(box.cfg, {xlog_compression_dict = id + 1})
+test:ok(not ok, 'unknown dictionary')
+
+box.cfg{xlog_compression_dict = id}
+test:is(box.cfg.xlog_compression_dict, id, 'box.cfg.xlog_compression_dict')
+
+-- The WAL was closed by the snapshot, the next one uses the
+-- dictionary.
+for i = 1, 1000 do
+    s:replace{i, 'name' .. i, -i, {tag = 'y'}}
+end
+box.snapshot()
+
+local function meta_dict(path)
+    local f = fio.open(path)
+    local header = f:read(1024)
+    f:close()
+    return tonumber(header:match('Dictionary: (%d+)'))
+end
+
+local wal = fio.pathjoin(box.cfg.wal_dir,
+                         string.format('%020d.xlog', box.info.signature - 1000))
+local snap = fio.pathjoin(box.cfg.memtx_dir,
+                          string.format('%020d.snap', box.info.signature))
+test:ok(meta_dict(wal) == id and meta_dict(snap) == id,
+        'dictionary id is stored in file meta')
+
+local rows = 0
+local valid = true
+for _, row in xlog.pairs(wal) do
+    if row.BODY.space_id == s.id then
+        rows = rows + 1
+        valid = valid and row.BODY.tuple[3] == -row.BODY.tuple[1]
+    end
+end
+test:ok(rows == 1000 and valid, 'WAL rows are decompressed')
+
+rows = 0
+for _, row in xlog.pairs(snap) do
+    if row.BODY.space_id == s.id then
+        rows = rows + 1
+    end
+end
+test:is(rows, 20000, 'snapshot rows are decompressed')
+
+s:drop()
+
+os.exit(test:check() and 0 or 1)
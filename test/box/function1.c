@@ -289,3 +289,25 @@ test_return_mp(box_function_ctx_t *ctx, const char *args, const char *args_end)
 	rc = box_return_tuple(ctx, tuple);
 	return rc;
 }
+
+int
+test_return_mp_alloc(box_function_ctx_t *ctx, const char *args,
+		     const char *args_end)
+{
+	(void) args;
+	(void) args_end;
+	const char *str = "123456789101112131415";
+	uint32_t size = mp_sizeof_array(2) + mp_sizeof_uint(1) +
+			mp_sizeof_str(strlen(str));
+	char *buf = box_return_mp_alloc(ctx, size);
+	if (buf == NULL)
+		return -1;
+	char *pos = mp_encode_array(buf, 2);
+	pos = mp_encode_uint(pos, 1);
+	mp_encode_str(pos, str, strlen(str));
+	buf = box_return_mp_alloc(ctx, mp_sizeof_int(-1));
+	if (buf == NULL)
+		return -1;
+	mp_encode_int(buf, -1);
+	return 0;
+}
@@ -284,6 +284,14 @@ box.schema.user.revoke('guest', 'super')
 
 box.schema.func.drop(name)
 
+name = 'function1.test_return_mp_alloc'
+box.schema.func.create(name, {language = "C", exports = {'LUA'}})
+box.func[name]:call()
+box.schema.user.grant('guest', 'super')
+net:connect(box.cfg.listen):call(name)
+box.schema.user.revoke('guest', 'super')
+box.schema.func.drop(name)
+
 --
 -- gh-4182: Introduce persistent Lua functions.
 --
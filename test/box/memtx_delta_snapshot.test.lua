@@ -0,0 +1,54 @@
+test_run = require('test_run').new()
+fio = require('fio')
+
+--
+-- memtx_checkpoint_delta_ratio makes a snapshot store only the
+-- spaces changed since the last full snapshot, the rest is
+-- loaded from the full snapshot on recovery.
+--
+box.cfg{memtx_checkpoint_delta_ratio = -1}
+box.cfg{memtx_checkpoint_delta_ratio = 2}
+
+big = box.schema.space.create('big')
+_ = big:create_index('pk')
+small = box.schema.space.create('small')
+_ = small:create_index('pk')
+test_run:cmd("setopt delimiter ';'")
+box.begin()
+for i = 1, 10000 do
+    big:insert{i, string.rep('x', 100)}
+end
+box.commit();
+test_run:cmd("setopt delimiter ''");
+small:insert{1}
+box.snapshot()
+
+box.cfg{memtx_checkpoint_delta_ratio = 0.5}
+small:insert{2}
+box.snapshot()
+test_run:grep_log('default', 'saving delta snapshot') ~= nil
+#fio.glob(fio.pathjoin(box.cfg.memtx_dir, '*.snap'))
+
+-- The delta is based on the same full snapshot.
+small:insert{3}
+box.snapshot()
+
+test_run:cmd('restart server default')
+box.space.big:count()
+box.space.big:get{10000}[1]
+box.space.small:select()
+
+-- Changing the big space makes the snapshot a full one.
+box.cfg{memtx_checkpoint_delta_ratio = 0.5}
+box.space.big:delete{1}
+box.snapshot()
+box.space.small:insert{4}
+box.snapshot()
+
+test_run:cmd('restart server default')
+box.space.big:count()
+box.space.small:select()
+
+box.space.big:drop()
+box.space.small:drop()
+box.cfg{memtx_checkpoint_delta_ratio = 0}
@@ -49,6 +49,7 @@ end;
 for k, v in pairs(box.stat.DELETE) do
     table.insert(t, k)
 end;
+table.sort(t);
 t;
 
 ----------------
@@ -76,6 +77,8 @@ end;
 t;
 box.runtime.info().used > 0;
 box.runtime.info().maxalloc > 0;
+info = box.runtime.info();
+info.tuple >= 0 and info.region > 0 and info.net >= 0;
 
 --
 -- gh-502: box.slab.info() excessively sparse array
@@ -0,0 +1,31 @@
+clock = require('clock')
+
+box.profiler.stop()
+box.profiler.start({interval = 0})
+box.profiler.start({interval = 0.001})
+box.profiler.start()
+
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+function busy_loop(timeout)
+    local deadline = clock.proc() + timeout
+    local x = 0
+    while clock.proc() < deadline do
+        x = x + 1
+    end
+    return x
+end;
+test_run:cmd("setopt delimiter ''");
+_ = busy_loop(0.2)
+
+stacks = box.profiler.stop()
+stacks:match('busy_loop[^\n]* %d+\n') ~= nil
+
+-- Dump to a file.
+fio = require('fio')
+path = fio.pathjoin(fio.tempdir(), 'profile.folded')
+box.profiler.start({interval = 0.001, c_stack = false})
+_ = busy_loop(0.1)
+box.profiler.stop(path) > 0
+fio.path.exists(path)
+fio.rmtree(fio.dirname(path))
@@ -0,0 +1,36 @@
+--
+-- Per-space and per-index request counters.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+s:insert{1, 10}
+s:insert{2, 20}
+s:replace{3, 30}
+s:update(1, {{'=', 2, 11}})
+s:upsert({4, 40}, {{'=', 2, 41}})
+s:delete(2)
+st = s:stat()
+st.insert, st.replace, st.update, st.upsert, st.delete
+st.bytes > 0, st.time >= 0
+s:get(1)
+s.index.sk:get(30)
+s:select()
+s.index.sk:select({}, {iterator = 'GE'})
+st = s:stat()
+st.index.pk.lookup, st.index.pk.scan, st.index.pk.rows
+st.index.sk.lookup, st.index.sk.scan, st.index.sk.rows
+-- Counters survive ALTER.
+s:rename('test2')
+s:stat().insert
+-- And are reset by box.stat.reset().
+box.stat.reset()
+st = s:stat()
+st.insert, st.bytes, st.index.pk.lookup, st.index.sk.rows
+-- Memory usage isn't reset.
+st.memory.tuple > 0, st.memory.index > 0
+st.memory.index == st.index.pk.memory + st.index.sk.memory
+st.memory.index == s.index.pk:bsize() + s.index.sk:bsize()
+s:truncate()
+s:stat().memory.tuple
+s:drop()
@@ -0,0 +1,64 @@
+env = require('test_run')
+test_run = env.new()
+fiber = require('fiber')
+
+--
+-- box.cfg.replication_ack_interval: a replica sends ACKs to its
+-- master not more often than once per the interval, unless there
+-- are synchronous transactions waiting for a quorum.
+--
+box.cfg{replication_ack_interval = -1}
+box.cfg.replication_ack_interval
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+sync = box.schema.space.create('sync', {is_sync = true})
+_ = sync:create_index('pk')
+
+test_run:cmd('create server replica with rpl_master=default, script "replication/replica.lua"')
+test_run:cmd('start server replica')
+
+function acked_lsn()                                                        \
+    local r = box.info.replication[2]                                       \
+    if r == nil or r.downstream == nil or r.downstream.vclock == nil then   \
+        return 0                                                            \
+    end                                                                     \
+    return r.downstream.vclock[box.info.id] or 0                            \
+end
+s:replace{0}
+lsn = box.info.lsn
+test_run:wait_cond(function() return acked_lsn() == lsn end)
+
+test_run:cmd('switch replica')
+box.cfg{replication_ack_interval = 1000}
+test_run:cmd('switch default')
+
+-- ACKs of asynchronous transactions are delayed.
+s:replace{1}
+lsn = box.info.lsn
+test_run:cmd('switch replica')
+test_run:wait_cond(function() return box.space.test:get{1} ~= nil end)
+test_run:cmd('switch default')
+fiber.sleep(0.1)
+acked_lsn() < lsn
+
+-- A synchronous transaction is confirmed right away.
+box.cfg{replication_synchro_quorum = 2, replication_synchro_timeout = 30}
+sync:replace{1}
+box.cfg{replication_synchro_quorum = 1}
+acked_lsn() >= lsn
+
+-- The new interval applies on the next ACK.
+test_run:cmd('switch replica')
+box.cfg{replication_ack_interval = 0}
+test_run:cmd('switch default')
+s:replace{2}
+lsn = box.info.lsn
+test_run:wait_cond(function() return acked_lsn() == lsn end)
+
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+s:drop()
+sync:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,48 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- box.cfg.replication_apply_fibers: the applier applies
+-- transactions which don't change the same keys concurrently.
+--
+box.schema.user.grant('guest', 'replication')
+v = box.schema.space.create('v', {engine = 'vinyl'})
+_ = v:create_index('pk')
+m = box.schema.space.create('m')
+_ = m:create_index('pk')
+
+test_run:cmd('create server replica with rpl_master=default, script "replication/replica.lua"')
+test_run:cmd('start server replica')
+
+test_run:cmd('switch replica')
+box.cfg{replication_apply_fibers = 0}
+box.cfg{replication_apply_fibers = 4}
+-- The option takes effect on resubscribe.
+replication = box.cfg.replication
+box.cfg{replication = {}}
+box.cfg{replication = replication}
+test_run:wait_cond(function()\
+                       return box.info.replication[1].upstream.status == 'follow'\
+                   end)
+
+test_run:cmd('switch default')
+-- Rows changing the same keys must be applied in order,
+-- memtx transactions must not break the order either.
+for i = 1, 1000 do v:replace{i % 50, i} if i % 100 == 0 then m:replace{i} end end
+for i = 1, 10 do box.begin() v:delete{i} v:replace{100 + i, i} box.commit() end
+test_run:wait_lsn('replica', 'default')
+
+test_run:cmd('switch replica')
+box.space.v:count()
+s = 0 for _, t in box.space.v:pairs() do s = s + t[2] end
+s
+box.space.m:count()
+box.info.replication[1].upstream.status
+
+-- Cleanup.
+test_run:cmd('switch default')
+test_run:cmd('stop server replica')
+test_run:cmd('delete server replica')
+v:drop()
+m:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,64 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- box.cfg.replication_compression: a replica asks the master
+-- to compress the replication stream on subscribe.
+--
+box.cfg{replication_compression = 'lz4'}
+box.cfg.replication_compression
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+
+test_run:cmd('create server replica with rpl_master=default, script "replication/replica.lua"')
+test_run:cmd('start server replica')
+
+function wait_replica()                                                     \
+    local lsn = box.info.lsn                                                \
+    return test_run:wait_cond(function()                                    \
+        local r = box.info.replication[2]                                   \
+        return r ~= nil and r.downstream ~= nil and                         \
+               r.downstream.status == 'follow' and                          \
+               r.downstream.vclock ~= nil and                               \
+               r.downstream.vclock[box.info.id] == lsn                      \
+    end)                                                                    \
+end
+function compression() return box.info.replication[2].downstream.compression end
+
+for i = 1, 10 do s:replace{i, string.rep('x', 100)} end
+wait_replica()
+compression()
+
+-- The option applies to new subscriptions.
+test_run:cmd('switch replica')
+replication = box.cfg.replication
+box.cfg{replication_compression = 'zstd'}
+box.cfg{replication = {}}
+box.cfg{replication = replication}
+test_run:wait_upstream(1, {status='follow'})
+test_run:cmd('switch default')
+
+for i = 11, 1000 do s:replace{i, string.rep('x', 100)} end
+wait_replica()
+compression().algorithm
+compression().raw > compression().compressed
+compression().ratio > 1
+test_run:cmd('switch replica')
+box.space.test:count()
+box.space.test:get{1000}[2] == string.rep('x', 100)
+test_run:cmd('switch default')
+
+-- Heartbeats are compressed too, the replica doesn't time out.
+raw = compression().raw
+test_run:wait_cond(function() return compression().raw > raw end)
+test_run:cmd('switch replica')
+test_run:wait_upstream(1, {status='follow'})
+box.cfg{replication_compression = 'none'}
+test_run:cmd('switch default')
+
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+s:drop()
+box.schema.user.revoke('guest', 'replication')
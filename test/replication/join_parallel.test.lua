@@ -0,0 +1,43 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- With box.cfg.memtx_snapshot_threads > 1 the master reads user
+-- spaces sent to a joining replica in several threads and
+-- interleaves their rows in the stream.
+--
+box.cfg{memtx_snapshot_threads = 4}
+box.schema.user.grant('guest', 'replication')
+for i = 1, 8 do                                                             \
+    local s = box.schema.space.create('test' .. i)                          \
+    s:create_index('pk')                                                    \
+    s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})         \
+    box.begin()                                                             \
+    for j = 1, 1000 * i do s:insert{j, j % 7, string.rep('x', 100)} end     \
+    box.commit()                                                            \
+end
+v = box.schema.space.create('vinyl', {engine = 'vinyl'})
+_ = v:create_index('pk')
+for i = 1, 1000 do v:insert{i} end
+
+test_run:cmd('create server replica with rpl_master=default, script "replication/replica.lua"')
+test_run:cmd('start server replica')
+test_run:cmd('switch replica')
+ok = true
+for i = 1, 8 do                                                             \
+    local s = box.space['test' .. i]                                        \
+    ok = ok and s:count() == 1000 * i and s.index.sk:count() == 1000 * i and \
+         s:get{1000 * i}[1] == 1000 * i and                                 \
+         s.index.sk:select({3}, {limit = 1})[1][2] == 3                     \
+end
+ok
+box.space.vinyl:count()
+test_run:cmd('switch default')
+
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+for i = 1, 8 do box.space['test' .. i]:drop() end
+v:drop()
+box.schema.user.revoke('guest', 'replication')
+box.cfg{memtx_snapshot_threads = 1}
@@ -0,0 +1,42 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+--
+-- ACKs received while a CONFIRM is being written are coalesced
+-- into one next CONFIRM instead of a CONFIRM per transaction.
+--
+old_synchro_quorum = box.cfg.replication_synchro_quorum
+old_synchro_timeout = box.cfg.replication_synchro_timeout
+box.cfg{replication_synchro_quorum = 1, replication_synchro_timeout = 1000}
+
+_ = box.schema.space.create('sync', {is_sync = true})
+_ = _:create_index('pk')
+lsn_before_txn = box.info.lsn
+
+-- The first transaction is written, its CONFIRM write is delayed.
+box.error.injection.set('ERRINJ_WAL_DELAY_COUNTDOWN', 1)
+count = 0
+_ = fiber.create(function()                                                     \
+    box.space.sync:insert{0}                                                    \
+    count = count + 1                                                           \
+end)
+while not box.error.injection.get("ERRINJ_WAL_DELAY") do fiber.sleep(0.001) end
+
+for i = 1, 10 do                                                                \
+    fiber.create(function()                                                     \
+        box.space.sync:insert{i}                                                \
+        count = count + 1                                                       \
+    end)                                                                        \
+end
+box.error.injection.set("ERRINJ_WAL_DELAY", false)
+test_run:wait_cond(function() return count == 11 end)
+box.space.sync:count()
+
+-- 11 transactions and no more than 3 CONFIRMs: one for the first
+-- transaction, the others are confirmed by at most 2 ones.
+box.info.lsn - lsn_before_txn <= 14
+
+box.space.sync:drop()
+box.cfg{                                                                        \
+    replication_synchro_quorum = old_synchro_quorum,                            \
+    replication_synchro_timeout = old_synchro_timeout,                          \
+}
@@ -0,0 +1,50 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- box.cfg.replication_spaces: a replica asks the master to relay
+-- rows of the given user spaces only.
+--
+box.cfg{replication_spaces = {'a'}}
+box.cfg.replication_spaces
+box.schema.user.grant('guest', 'replication')
+a = box.schema.space.create('a')
+_ = a:create_index('pk')
+b = box.schema.space.create('b')
+_ = b:create_index('pk')
+
+test_run:cmd('create server replica with rpl_master=default, script "replication/replica.lua"')
+test_run:cmd('start server replica')
+
+test_run:cmd('switch replica')
+replication = box.cfg.replication
+box.cfg{replication_spaces = {box.space.a.id}}
+box.cfg{replication = {}}
+box.cfg{replication = replication}
+test_run:wait_upstream(1, {status='follow'})
+test_run:cmd('switch default')
+
+for i = 1, 10 do a:replace{i} b:replace{i} end
+box.begin() a:replace{11} b:replace{11} box.commit()
+c = box.schema.space.create('c')
+_ = c:create_index('pk')
+c:replace{1}
+test_run:wait_lsn('replica', 'default')
+
+-- Rows of the other spaces are skipped, DDL is not.
+test_run:cmd('switch replica')
+box.space.a:count()
+box.space.b:count()
+box.space.c ~= nil
+box.space.c:count()
+box.info.replication[1].upstream.status
+box.cfg{replication_spaces = {}}
+test_run:cmd('switch default')
+
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+a:drop()
+b:drop()
+c:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,54 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- box.cfg.wal_tail_size: the relay sends the rows recently
+-- written to WAL from memory rather than re-reading xlog files.
+--
+box.cfg{wal_tail_size = -1}
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+
+test_run:cmd('create server replica with rpl_master=default, script "replication/replica.lua"')
+test_run:cmd('start server replica')
+
+function wait_replica()                                                     \
+    local lsn = box.info.lsn                                                \
+    return test_run:wait_cond(function()                                    \
+        local r = box.info.replication[2]                                   \
+        return r ~= nil and r.downstream ~= nil and                         \
+               r.downstream.vclock ~= nil and                               \
+               r.downstream.vclock[box.info.id] == lsn                      \
+    end)                                                                    \
+end
+function wal_tail() return box.info.replication[2].downstream.wal_tail end
+
+for i = 1, 10 do s:replace{i} end
+wait_replica()
+wal_tail().hits > 0
+
+-- Zero size makes the relay read xlog files.
+box.cfg{wal_tail_size = 0}
+misses = wal_tail().misses
+for i = 11, 20 do s:replace{i} end
+wait_replica()
+wal_tail().misses > misses
+test_run:cmd('switch replica')
+box.space.test:count()
+test_run:cmd('switch default')
+
+box.cfg{wal_tail_size = 16 * 1024 * 1024}
+hits = wal_tail().hits
+for i = 21, 30 do s:replace{i} end
+wait_replica()
+wal_tail().hits > hits
+test_run:cmd('switch replica')
+box.space.test:count()
+test_run:cmd('switch default')
+
+test_run:cmd('stop server replica')
+test_run:cmd('cleanup server replica')
+test_run:cmd('delete server replica')
+s:drop()
+box.schema.user.revoke('guest', 'replication')
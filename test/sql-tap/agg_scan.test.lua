@@ -0,0 +1,110 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(16)
+
+--
+-- Aggregate queries without GROUP BY over numeric columns are
+-- evaluated by a batched scan (OP_AggScan), also with a WHERE
+-- clause made of simple conditions on numeric columns. Their
+-- results must be the same as the ones of the generic aggregate
+-- loop, which is used when there is a condition on the primary
+-- key.
+--
+local aggs = "count(*), count(u), sum(u), total(u), avg(u), min(u), "..
+             "max(u), count(i), sum(i), avg(i), min(i), max(i), "..
+             "count(d), sum(d), total(d), min(d), max(d)"
+
+local function check(label, select)
+    local expected = test:execsql(select.." WHERE id > -1")
+    test:do_execsql_test(label, select, expected)
+end
+
+test:execsql([[
+    CREATE TABLE t1(id INT PRIMARY KEY, u UNSIGNED, i INT, d DOUBLE);
+    CREATE TABLE t2(id INT PRIMARY KEY, u UNSIGNED, i INT, d DOUBLE);
+]])
+
+check("agg-scan-1.1", "SELECT "..aggs.." FROM t1")
+
+-- More than one batch of tuples, NULLs and missing fields.
+for id = 1, 1000 do
+    local u = id % 7 ~= 0 and id * 3 or box.NULL
+    local i = id % 5 ~= 0 and (id % 2 == 0 and id or -id) * 11 or box.NULL
+    local d = id % 3 ~= 0 and id / 4 + 0.125 or box.NULL
+    box.space.T1:insert({id, u, i, d})
+end
+box.space.T1:insert({1001})
+check("agg-scan-1.2", "SELECT "..aggs.." FROM t1")
+check("agg-scan-1.3", "SELECT sum(u) + count(*), max(i) - min(i) FROM t1")
+check("agg-scan-1.4", "SELECT avg(u), avg(u) FROM t1")
+
+local function check_where(label, select, where)
+    local expected = test:execsql(select.." WHERE id > -1 AND "..where)
+    test:do_execsql_test(label, select.." WHERE "..where, expected)
+end
+
+check_where("agg-scan-1.5", "SELECT "..aggs.." FROM t1", "u > 1500")
+check_where("agg-scan-1.6", "SELECT "..aggs.." FROM t1",
+            "i < -100 AND d >= 10.5 AND u <> 300")
+check_where("agg-scan-1.7", "SELECT count(*), sum(u) FROM t1",
+            "d < 100 AND i > -5000.5 AND d IS NOT NULL AND i <> 0")
+check_where("agg-scan-1.8", "SELECT count(*), count(u) FROM t1",
+            "u IS NULL OR i IS NULL")
+check_where("agg-scan-1.9", "SELECT count(*), max(d) FROM t1",
+            "i IS NULL AND u = 9 AND d <= 3")
+
+-- Only nulls.
+test:execsql("INSERT INTO t2(id) VALUES (1), (2);")
+check("agg-scan-2.1", "SELECT "..aggs.." FROM t2")
+
+test:do_execsql_test(
+    "agg-scan-3.1",
+    "EXPLAIN QUERY PLAN SELECT sum(u), max(d) FROM t1", {
+        0, 0, 0, "SCAN TABLE T1"
+    })
+
+test:do_execsql_test(
+    "agg-scan-3.5",
+    "EXPLAIN QUERY PLAN SELECT sum(u) FROM t1 WHERE i > 0 AND d < 1e9", {
+        0, 0, 0, "SCAN TABLE T1"
+    })
+
+-- A condition on the primary key is served by the index.
+test:do_test(
+    "agg-scan-3.6",
+    function()
+        local plan = test:execsql("EXPLAIN QUERY PLAN "..
+                                  "SELECT sum(u) FROM t1 WHERE id < 10")
+        return plan[4]:find("SEARCH TABLE T1 USING PRIMARY KEY") ~= nil
+    end, true)
+
+test:do_catchsql_test(
+    "agg-scan-3.2",
+    [[
+        INSERT INTO t2(id, u, i) VALUES (3, 18446744073709551615,
+                                         -9223372036854775807);
+        INSERT INTO t2(id, u, i) VALUES (4, 1, -2);
+        SELECT sum(u) FROM t2;
+    ]], {
+        1, "Failed to execute SQL statement: integer overflow"
+    })
+
+test:do_catchsql_test(
+    "agg-scan-3.3",
+    "SELECT sum(i) FROM t2", {
+        1, "Failed to execute SQL statement: integer overflow"
+    })
+
+test:do_execsql_test(
+    "agg-scan-3.4",
+    "SELECT total(u), count(i), min(i), max(u) FROM t2", {
+        18446744073709551616, 2, -9223372036854775807LL,
+        18446744073709551615ULL
+    })
+
+test:execsql([[
+    DROP TABLE t1;
+    DROP TABLE t2;
+]])
+
+test:finish_test()
@@ -0,0 +1,94 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(10)
+
+--
+-- Comparison of an integer column with another expression in
+-- WHERE is coded as OP_ColumnCompare, which compares integers
+-- without decoding the column into a register. Check that the
+-- results are the same as for generic comparison.
+--
+test:execsql([[
+    CREATE TABLE t1(id INT PRIMARY KEY, a INT, u UNSIGNED, s TEXT);
+    CREATE INDEX t1a ON t1(a);
+    INSERT INTO t1 VALUES (1, -5, 5, 'a'), (2, 0, 0, 'b'), (3, 7, 7, 'c'),
+                          (4, NULL, NULL, 'd'),
+                          (5, -9223372036854775808, 18446744073709551615, 'e');
+]])
+box.space.T1:insert({6})
+
+test:do_execsql_test(
+    "column-compare-1.1",
+    "SELECT id FROM t1 WHERE u > 4 ORDER BY id", {
+        1, 3, 5
+    })
+
+test:do_execsql_test(
+    "column-compare-1.2",
+    "SELECT id FROM t1 WHERE u < -1 OR u = 0 ORDER BY id", {
+        2
+    })
+
+test:do_execsql_test(
+    "column-compare-1.3",
+    "SELECT id FROM t1 WHERE NOT (u <> 7) ORDER BY id", {
+        3
+    })
+
+test:do_execsql_test(
+    "column-compare-1.4",
+    "SELECT id FROM t1 WHERE u >= 18446744073709551615 ORDER BY id", {
+        5
+    })
+
+-- Not integer operands are compared as usual.
+test:do_execsql_test(
+    "column-compare-1.5",
+    "SELECT id FROM t1 WHERE u <= 6.5 ORDER BY id", {
+        1, 2
+    })
+
+test:do_execsql_test(
+    "column-compare-1.6",
+    "SELECT id FROM t1 WHERE NOT (u > 0) ORDER BY id", {
+        2
+    })
+
+test:do_test(
+    "column-compare-1.7",
+    function()
+        local res = box.execute("SELECT id FROM t1 WHERE u = ? OR u = ? "..
+                                "ORDER BY id", {7, 0})
+        local ids = {}
+        for _, row in ipairs(res.rows) do
+            table.insert(ids, row[1])
+        end
+        return ids
+    end, {
+        2, 3
+    })
+
+-- Both operands are columns.
+test:do_execsql_test(
+    "column-compare-1.8",
+    "SELECT id FROM t1 WHERE u < a + 1 OR a < u - 10 ORDER BY id", {
+        2, 3, 5
+    })
+
+-- A scan using an index.
+test:do_execsql_test(
+    "column-compare-1.9",
+    "SELECT id FROM t1 INDEXED BY t1a WHERE a < 1 AND a > -6 ORDER BY id", {
+        1, 2
+    })
+
+-- A column of a sub-select.
+test:do_execsql_test(
+    "column-compare-1.10",
+    "SELECT id FROM (SELECT id, u FROM t1 LIMIT 10) WHERE u > 4 ORDER BY id", {
+        1, 3, 5
+    })
+
+test:execsql("DROP TABLE t1;")
+
+test:finish_test()
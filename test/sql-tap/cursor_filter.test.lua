@@ -0,0 +1,108 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(10)
+
+--
+-- Simple conditions on the columns of a scanned table are
+-- checked by the cursor (OP_CursorFilter) before tuples get into
+-- VDBE registers. Results must be the same as without a filter.
+--
+test:execsql([[
+    CREATE TABLE t1(id INT PRIMARY KEY, a INT, b TEXT, c DOUBLE,
+                    d TEXT COLLATE "unicode_ci", e SCALAR);
+    CREATE INDEX t1b ON t1(b);
+    CREATE TABLE t2(id INT PRIMARY KEY, x INT);
+]])
+box.begin()
+for id = 1, 100 do
+    local b = id % 10 ~= 0 and string.format("s%03d", id) or box.NULL
+    local e = id % 2 == 0 and id or id + 0.5
+    box.space.T1:insert({id, id % 7, b, id / 4, id % 3 == 0 and "A" or "a", e})
+    box.space.T2:insert({id, id % 5})
+end
+box.commit()
+
+local function has_filter(sql)
+    for _, v in pairs(test:execsql("EXPLAIN "..sql)) do
+        if v == "CursorFilter" then
+            return true
+        end
+    end
+    return false
+end
+
+test:do_test(
+    "cursor-filter-1.1",
+    function()
+        return {has_filter("SELECT id FROM t1 WHERE a = 3"),
+                has_filter("SELECT id FROM t1 WHERE b > 's050' AND a = 3"),
+                has_filter("SELECT id FROM t1 WHERE b < 's050' AND a = 3")}
+    end, {
+        true, true, false
+    })
+
+test:do_execsql_test(
+    "cursor-filter-1.2",
+    "SELECT id FROM t1 WHERE a = 3 AND c < 10", {
+        3, 10, 17, 24, 31, 38
+    })
+
+test:do_execsql_test(
+    "cursor-filter-1.3",
+    "SELECT count(*) FROM t1 WHERE b IS NULL", {
+        10
+    })
+
+test:do_execsql_test(
+    "cursor-filter-1.4",
+    "SELECT id FROM t1 WHERE b >= 's095' AND a IS NOT NULL", {
+        95, 96, 97, 98, 99
+    })
+
+-- Integers compared with doubles.
+test:do_execsql_test(
+    "cursor-filter-1.5",
+    "SELECT id FROM t1 WHERE c >= 2 AND c <= 2.25 AND a = 1", {
+        8
+    })
+
+test:do_execsql_test(
+    "cursor-filter-1.6",
+    "SELECT id FROM t1 WHERE id > 90 AND c > 23.5 AND a >= -1", {
+        95, 96, 97, 98, 99, 100
+    })
+
+-- Collated strings are left to the VDBE.
+test:do_execsql_test(
+    "cursor-filter-1.7",
+    "SELECT count(*) FROM t1 WHERE d = 'a'", {
+        100
+    })
+
+test:do_execsql_test(
+    "cursor-filter-1.8",
+    "SELECT count(*) FROM t1 WHERE e > 90", {
+        10
+    })
+
+-- WHERE terms don't filter the right table of a LEFT JOIN,
+-- ON terms don't filter the left one.
+test:do_execsql_test(
+    "cursor-filter-1.9",
+    [[SELECT t2.id, t1.id FROM t2 LEFT JOIN t1 ON t1.a = t2.x + 100
+      AND t2.x = 1 WHERE t2.id < 4]], {
+        1, "", 2, "", 3, ""
+    })
+
+test:do_execsql_test(
+    "cursor-filter-1.10",
+    [[SELECT t2.id FROM t2 LEFT JOIN t1 ON t1.id = t2.id
+      WHERE t1.a IS NULL AND t2.id < 10 AND t2.x = 1]], {
+    })
+
+test:execsql([[
+    DROP TABLE t1;
+    DROP TABLE t2;
+]])
+
+test:finish_test()
@@ -0,0 +1,55 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(4)
+
+--
+-- The planner uses estimates of key prefix selectivity provided
+-- by the engine for big spaces without ANALYZE statistics, so
+-- an index on a column having few distinct values isn't chosen
+-- over a more selective one.
+--
+test:execsql([[
+    CREATE TABLE t1(id INT PRIMARY KEY, a INT, b INT);
+    CREATE INDEX ia ON t1(a);
+    CREATE INDEX ib ON t1(b);
+    CREATE TABLE t2(id INT PRIMARY KEY, x INT);
+    CREATE INDEX ix ON t2(x);
+]])
+box.begin()
+for id = 1, 2000 do
+    box.space.T1:insert({id, id % 2, id})
+    box.space.T2:insert({id, id % 2})
+end
+box.commit()
+
+test:do_execsql_test(
+    "engine-stat-1.1",
+    "EXPLAIN QUERY PLAN SELECT id FROM t1 WHERE a = 1 AND b = 5", {
+        0, 0, 0, "SEARCH TABLE T1 USING COVERING INDEX IB (B=?)"
+    })
+
+test:do_execsql_test(
+    "engine-stat-1.2",
+    "EXPLAIN QUERY PLAN SELECT id FROM t1 WHERE b = 5 AND a = 1", {
+        0, 0, 0, "SEARCH TABLE T1 USING COVERING INDEX IB (B=?)"
+    })
+
+test:do_execsql_test(
+    "engine-stat-1.3",
+    "SELECT id FROM t1 WHERE a = 1 AND b = 5", {
+        5
+    })
+
+-- Half of the space matches x = 1, a range is more selective.
+test:do_execsql_test(
+    "engine-stat-2.1",
+    "EXPLAIN QUERY PLAN SELECT id FROM t2 WHERE x = 1 AND id > 1990", {
+        0, 0, 0, "SEARCH TABLE T2 USING PRIMARY KEY (ID>?)"
+    })
+
+test:execsql([[
+    DROP TABLE t1;
+    DROP TABLE t2;
+]])
+
+test:finish_test()
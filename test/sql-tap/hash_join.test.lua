@@ -0,0 +1,119 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(10)
+
+--
+-- A join of a large table without a suitable index is done by
+-- building a hash table over the table once and probing it for
+-- each row of the outer loop. Check that its results are the
+-- same as the ones of the nested loop join, which is used when
+-- the inner table is NOT INDEXED.
+--
+local function check(label, select, nested)
+    local expected = test:execsql(nested)
+    test:do_execsql_test(label, select, expected)
+end
+
+local function plan(select)
+    local res = {}
+    for _, row in ipairs(test:execsql("EXPLAIN QUERY PLAN "..select)) do
+        if type(row) == "string" then
+            table.insert(res, row)
+        end
+    end
+    return table.concat(res, "; ")
+end
+
+test:execsql([[
+    CREATE TABLE t1(id INT PRIMARY KEY, a INT, u UNSIGNED, s TEXT);
+    CREATE TABLE t2(id INT PRIMARY KEY, b INT, s TEXT,
+                    c TEXT COLLATE "unicode_ci");
+]])
+box.begin()
+for id = 1, 100 do
+    local a = id % 11 ~= 0 and id - 30 or box.NULL
+    box.space.T1:insert({id, a, id % 40, 'v'..id % 37})
+end
+for id = 1, 2000 do
+    local b = id % 13 ~= 0 and id % 50 - 25 or box.NULL
+    box.space.T2:insert({id, b, 'v'..id % 30, 'C'..id % 20})
+end
+box.commit()
+
+test:do_execsql_test(
+    "hash-join-1.1",
+    "EXPLAIN QUERY PLAN SELECT count(*) FROM t1 JOIN t2 ON t1.a = t2.b", {
+        0, 0, 0, "SCAN TABLE T1",
+        0, 1, 1, "SEARCH TABLE T2 USING HASH JOIN (B=?)"
+    })
+
+check("hash-join-1.2",
+      "SELECT count(*), sum(t1.id * t2.id) FROM t1 JOIN t2 "..
+      "ON t1.a = t2.b",
+      "SELECT count(*), sum(t1.id * t2.id) FROM t1 JOIN t2 NOT INDEXED "..
+      "ON t1.a = t2.b")
+
+check("hash-join-1.3",
+      "SELECT t1.id, t2.id FROM t1, t2 WHERE t2.b = t1.a AND "..
+      "t2.id > 1900 ORDER BY t1.id, t2.id",
+      "SELECT t1.id, t2.id FROM t1, t2 NOT INDEXED WHERE t2.b = t1.a AND "..
+      "t2.id > 1900 ORDER BY t1.id, t2.id")
+
+-- Unsigned and integer keys, an expression as the probe.
+check("hash-join-1.4",
+      "SELECT count(*), sum(t2.id) FROM t1 JOIN t2 ON t2.b = t1.u - 20",
+      "SELECT count(*), sum(t2.id) FROM t1 JOIN t2 NOT INDEXED "..
+      "ON t2.b = t1.u - 20")
+
+-- String keys.
+check("hash-join-1.5",
+      "SELECT count(*), sum(t1.id + t2.id) FROM t1 JOIN t2 ON t1.s = t2.s",
+      "SELECT count(*), sum(t1.id + t2.id) FROM t1 JOIN t2 NOT INDEXED "..
+      "ON t1.s = t2.s")
+
+-- Outer join: rows of t1 without a match are kept.
+check("hash-join-1.6",
+      "SELECT t1.id, count(t2.id) FROM t1 LEFT JOIN t2 "..
+      "ON t1.a = t2.b AND t2.id < 100 GROUP BY t1.id ORDER BY t1.id",
+      "SELECT t1.id, count(t2.id) FROM t1 LEFT JOIN t2 NOT INDEXED "..
+      "ON t1.a = t2.b AND t2.id < 100 GROUP BY t1.id ORDER BY t1.id")
+
+-- Several hash joins in a row.
+check("hash-join-1.7",
+      "SELECT count(*), sum(y.id) FROM t1 JOIN t2 AS x ON x.b = t1.a "..
+      "JOIN t2 AS y ON y.s = x.s WHERE t1.id BETWEEN 30 AND 33",
+      "SELECT count(*), sum(y.id) FROM t1 JOIN t2 AS x NOT INDEXED "..
+      "ON x.b = t1.a JOIN t2 AS y NOT INDEXED ON y.s = x.s "..
+      "WHERE t1.id BETWEEN 30 AND 33")
+
+-- Collated strings are not hashed.
+test:do_test(
+    "hash-join-2.1",
+    function()
+        return plan("SELECT count(*) FROM t1 JOIN t2 ON t1.s = t2.c")
+               :find("HASH JOIN") == nil
+    end, true)
+
+-- An index is preferred to the hash table.
+test:execsql("CREATE INDEX t2b ON t2(b);")
+test:do_test(
+    "hash-join-2.2",
+    function()
+        return plan("SELECT count(*) FROM t1 JOIN t2 ON t1.a = t2.b")
+               :find("HASH JOIN") == nil
+    end, true)
+
+-- Small tables are joined by nested loops.
+test:do_test(
+    "hash-join-2.3",
+    function()
+        return plan("SELECT count(*) FROM t2 JOIN t1 ON t1.s = t2.s")
+               :find("T1 USING HASH JOIN") == nil
+    end, true)
+
+test:execsql([[
+    DROP TABLE t1;
+    DROP TABLE t2;
+]])
+
+test:finish_test()
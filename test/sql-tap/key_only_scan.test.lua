@@ -0,0 +1,111 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(9)
+
+--
+-- Secondary indexes of vinyl spaces which don't defer deletes
+-- can be read without looking up full tuples in the primary
+-- index, if the index covers all the columns used.
+--
+local format = {{'ID', 'unsigned'}, {'A', 'unsigned'}, {'B', 'string'}}
+local s = box.schema.space.create('T', {engine = 'vinyl', format = format,
+                                        defer_deletes = false})
+s:create_index('PK')
+s:create_index('I1', {parts = {'A'}, unique = false})
+for id = 1, 10 do
+    s:insert({id, id % 4, 'b'..id})
+end
+
+local function totable(tuples)
+    local res = {}
+    for _, t in ipairs(tuples) do
+        table.insert(res, t:totable())
+    end
+    return res
+end
+
+test:do_test(
+    "key-only-1.1",
+    function()
+        return totable(s.index.I1:select({3}, {keys_only = true}))
+    end, {
+        {3, 3}, {3, 7}
+    })
+
+test:do_test(
+    "key-only-1.2",
+    function()
+        local ok, err = pcall(s.index.PK.select, s.index.PK, {},
+                              {keys_only = true})
+        return {ok, tostring(err):match("keys only iterator") ~= nil}
+    end, {
+        false, true
+    })
+
+test:do_test(
+    "key-only-1.3",
+    function()
+        local plan = test:execsql("EXPLAIN QUERY PLAN "..
+                                  "SELECT id FROM t WHERE a > 2")
+        return plan[4]:match("COVERING INDEX KEYS I1") ~= nil
+    end, true)
+
+test:do_test(
+    "key-only-1.4",
+    function()
+        local plan = test:execsql("EXPLAIN QUERY PLAN "..
+                                  "SELECT b FROM t WHERE a > 2")
+        return plan[4]:match("KEYS") == nil
+    end, true)
+
+-- No primary key lookups are made.
+test:do_test(
+    "key-only-1.5",
+    function()
+        local lookup = s.index.PK:stat().lookup
+        local res = test:execsql("SELECT id, a FROM t WHERE a > 2 "..
+                                 "ORDER BY id")
+        table.insert(res, s.index.PK:stat().lookup - lookup)
+        return res
+    end, {
+        3, 3, 7, 3, 0
+    })
+
+test:do_execsql_test(
+    "key-only-1.6",
+    "SELECT count(*), sum(a) FROM t INDEXED BY i1 WHERE a >= 1", {
+        8, 15
+    })
+
+-- Deleted and overwritten tuples are not seen, both in memory
+-- and on disk.
+test:do_test(
+    "key-only-1.7",
+    function()
+        s:replace({3, 0, 'c'})
+        s:delete({7})
+        return test:execsql("SELECT id FROM t WHERE a = 3")
+    end, {
+    })
+
+test:do_test(
+    "key-only-1.8",
+    function()
+        box.snapshot()
+        s:replace({4, 3, 'd'})
+        return test:execsql("SELECT id FROM t WHERE a = 3")
+    end, {
+        4
+    })
+
+test:do_test(
+    "key-only-1.9",
+    function()
+        local ok = pcall(box.space._space.update, box.space._space, s.id,
+                         {{'=', 6, {defer_deletes = true}}})
+        return ok
+    end, false)
+
+s:drop()
+
+test:finish_test()
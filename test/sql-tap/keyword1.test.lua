@@ -1,6 +1,6 @@
 #!/usr/bin/env tarantool
 test = require("sqltester")
-test:plan(184)
+test:plan(186)
 
 --!./tcltestrunner.lua
 -- 2009 January 29
@@ -39,6 +39,7 @@ local kwlist = {
 	"initially",
 	"instead",
 	"key",
+	"materialized",
 	"offset",
 	"plan",
 	"query",
@@ -0,0 +1,128 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(12)
+
+--
+-- A materialized view stores the result of an aggregate SELECT
+-- in a memtx space and is updated on each change of the source
+-- table, no matter whether it comes from SQL or Lua.
+--
+test:execsql([[
+    CREATE TABLE t(id INT PRIMARY KEY, g INT NOT NULL, x INT NOT NULL,
+                   y INT);
+    INSERT INTO t VALUES (1, 1, 10, NULL), (2, 1, 20, 5), (3, 2, 30, 6);
+    CREATE MATERIALIZED VIEW v AS SELECT g, COUNT(*) AS cnt, SUM(x) AS s,
+        MIN(x) AS mn, MAX(x) AS mx, COUNT(y) AS cy FROM t GROUP BY g;
+]])
+
+-- Rows stored before the view is created are accounted.
+test:do_execsql_test(
+    "matview-1.1",
+    "SELECT * FROM v ORDER BY g", {
+        1, 2, 30, 10, 20, 1,
+        2, 1, 30, 30, 30, 1
+    })
+
+test:do_test(
+    "matview-1.2",
+    function()
+        local v = box.space.V
+        return {v.engine, v.index[0].parts[1].fieldno, v.index[0]:get{2}[3]}
+    end, {
+        "memtx", 1, 30
+    })
+
+test:do_execsql_test(
+    "matview-1.3",
+    [[INSERT INTO t VALUES (4, 2, 40, NULL), (5, 3, 50, 7);
+      SELECT * FROM v ORDER BY g]], {
+        1, 2, 30, 10, 20, 1,
+        2, 2, 70, 30, 40, 1,
+        3, 1, 50, 50, 50, 1
+    })
+
+-- The minimum is deleted and recomputed from the group.
+test:do_test(
+    "matview-1.4",
+    function()
+        box.space.T:delete{1}
+        return test:execsql("SELECT * FROM v WHERE g = 1")
+    end, {
+        1, 1, 20, 20, 20, 1
+    })
+
+-- A tuple moves to another group.
+test:do_test(
+    "matview-1.5",
+    function()
+        box.space.T:update({4}, {{'=', 2, 1}})
+        return test:execsql("SELECT * FROM v WHERE g < 3 ORDER BY g")
+    end, {
+        1, 2, 60, 20, 40, 1,
+        2, 1, 30, 30, 30, 1
+    })
+
+-- The row of a group is deleted with its last tuple.
+test:do_execsql_test(
+    "matview-1.6",
+    [[DELETE FROM t WHERE g = 3;
+      SELECT g FROM v ORDER BY g]], {
+        1, 2
+    })
+
+-- Changes are rolled back along with the source.
+test:do_test(
+    "matview-1.7",
+    function()
+        box.begin()
+        box.space.T:replace{2, 2, 100, 1}
+        box.rollback()
+        return test:execsql("SELECT * FROM v ORDER BY g")
+    end, {
+        1, 2, 60, 20, 40, 1,
+        2, 1, 30, 30, 30, 1
+    })
+
+test:do_catchsql_test(
+    "matview-1.8",
+    [[CREATE MATERIALIZED VIEW v2 AS SELECT g, COUNT(*) FROM t
+      WHERE x > 0 GROUP BY g]], {
+        1, "Failed to create space 'V2': materialized view can't have "..
+           "WHERE, HAVING, ORDER BY, LIMIT, DISTINCT, WITH or compound "..
+           "SELECT"
+    })
+
+test:do_catchsql_test(
+    "matview-1.9",
+    [[CREATE MATERIALIZED VIEW v2 AS SELECT g, COUNT(*), SUM(y) FROM t
+      GROUP BY g]], {
+        1, "Failed to create space 'V2': materialized view SUM() argument "..
+           "must be NOT NULL"
+    })
+
+test:do_catchsql_test(
+    "matview-1.10",
+    "TRUNCATE TABLE t", {
+        1, "Can't modify space 'T': can not truncate a materialized view "..
+           "or its source"
+    })
+
+test:do_catchsql_test(
+    "matview-1.11",
+    "DROP TABLE t", {
+        1, "Can't drop space 'T': other views depend on this space"
+    })
+
+test:do_test(
+    "matview-1.12",
+    function()
+        test:execsql("DROP VIEW v")
+        test:execsql("INSERT INTO t VALUES (6, 1, 1, 1)")
+        return box.space.V == nil
+    end, true)
+
+test:execsql([[
+    DROP TABLE t;
+]])
+
+test:finish_test()
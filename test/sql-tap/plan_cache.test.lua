@@ -0,0 +1,118 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(9)
+
+--
+-- Statements executed without parameters have their literals
+-- replaced with parameters, so that statements differing only
+-- in literal values share a plan in the plan cache.
+--
+test:execsql([[
+    CREATE TABLE t1(id INT PRIMARY KEY AUTOINCREMENT, a INT, b TEXT);
+    INSERT INTO t1 VALUES (1, 10, 'a'), (2, 20, 'it''s'), (3, 30, 'abc');
+]])
+
+local function plan_stat()
+    return box.info.sql().plan_cache
+end
+
+test:do_test(
+    "plan-cache-1.1",
+    function()
+        local stat = plan_stat()
+        local res = {}
+        for id = 1, 3 do
+            local rows = box.execute("SELECT a FROM t1 WHERE id = "..id).rows
+            table.insert(res, rows[1][1])
+        end
+        local new_stat = plan_stat()
+        table.insert(res, new_stat.hits - stat.hits)
+        return res
+    end, {
+        10, 20, 30, 2
+    })
+
+-- Quotes of string literals are unescaped.
+test:do_execsql_test(
+    "plan-cache-1.2",
+    "SELECT id FROM t1 WHERE b = 'it''s'", {
+        2
+    })
+
+-- Result columns keep their literals and types.
+test:do_test(
+    "plan-cache-1.3",
+    function()
+        local res = box.execute("SELECT 1, 'x' FROM t1 WHERE id = 1")
+        return {res.metadata[1].type, res.metadata[2].type, res.rows[1][1],
+                res.rows[1][2]}
+    end, {
+        "integer", "string", 1, "x"
+    })
+
+-- ORDER BY column numbers are not parameters.
+test:do_execsql_test(
+    "plan-cache-1.4",
+    "SELECT id, a FROM t1 WHERE a > 5 ORDER BY 2 DESC", {
+        3, 30, 2, 20, 1, 10
+    })
+
+test:do_execsql_test(
+    "plan-cache-1.5",
+    "SELECT id FROM t1 WHERE b LIKE 'ab%'", {
+        3
+    })
+
+-- Autoincrement ids of a cached plan are not accumulated.
+test:do_test(
+    "plan-cache-1.6",
+    function()
+        box.execute("INSERT INTO t1(a, b) VALUES (40, 'd')")
+        local res = box.execute("INSERT INTO t1(a, b) VALUES (50, 'e')")
+        return res.autoincrement_ids
+    end, {
+        5
+    })
+
+-- A plan is recompiled when the schema changes.
+test:do_test(
+    "plan-cache-1.7",
+    function()
+        box.execute("SELECT b FROM t1 WHERE id = 1")
+        box.execute("CREATE INDEX i1 ON t1(b)")
+        return box.execute("SELECT b FROM t1 WHERE id = 2").rows[1]
+    end, {
+        "it's"
+    })
+
+-- Plans are evicted to fit into the memory limit.
+test:do_test(
+    "plan-cache-1.8",
+    function()
+        local size = box.cfg.sql_cache_size
+        box.cfg{sql_cache_size = 0}
+        local count = plan_stat().plan_count
+        box.cfg{sql_cache_size = size}
+        return count
+    end, {
+        0
+    })
+
+test:do_test(
+    "plan-cache-1.9",
+    function()
+        local stat = plan_stat()
+        box.execute("SELECT a FROM t1 WHERE id = 1")
+        box.execute("SELECT a FROM t1 WHERE id = 2")
+        local new_stat = plan_stat()
+        return {new_stat.misses - stat.misses, new_stat.hits - stat.hits,
+                new_stat.plan_count}
+    end, {
+        1, 1, 1
+    })
+
+test:execsql([[
+    DROP TABLE t1;
+]])
+
+test:finish_test()
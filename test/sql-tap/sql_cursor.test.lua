@@ -0,0 +1,166 @@
+#!/usr/bin/env tarantool
+local test = require("sqltester")
+test:plan(9)
+
+--
+-- EXECUTE with a fetch size returns the first rows of a result
+-- set and a cursor id, the rest is read with FETCH requests.
+--
+local net_box = require('net.box')
+
+box.cfg{listen = os.getenv('LISTEN') or 'localhost:0'}
+box.schema.user.grant('guest', 'read,write,execute,create', 'universe')
+
+test:execsql([[
+    CREATE TABLE t(id INT PRIMARY KEY, b TEXT);
+]])
+for id = 1, 10 do
+    box.space.T:insert({id, 'b'..id})
+end
+
+local cn = net_box.connect(box.cfg.listen)
+
+local function ids(res)
+    local r = {}
+    for _, row in ipairs(res.rows) do
+        table.insert(r, row[1])
+    end
+    return r
+end
+
+local cursor_id
+
+test:do_test(
+    "sql-cursor-1.1",
+    function()
+        local res = cn:execute("SELECT id FROM t ORDER BY id", nil,
+                               {fetch_size = 3})
+        cursor_id = res.cursor_id
+        local r = ids(res)
+        table.insert(r, res.metadata[1].name)
+        table.insert(r, cursor_id ~= nil)
+        return r
+    end, {
+        1, 2, 3, "ID", true
+    })
+
+test:do_test(
+    "sql-cursor-1.2",
+    function()
+        local res = cn:fetch(cursor_id, 4)
+        local r = ids(res)
+        table.insert(r, res.cursor_id == cursor_id)
+        table.insert(r, res.metadata == nil)
+        res = cn:fetch(cursor_id, 4)
+        for _, v in ipairs(ids(res)) do
+            table.insert(r, v)
+        end
+        table.insert(r, res.cursor_id == nil)
+        return r
+    end, {
+        4, 5, 6, 7, true, true, 8, 9, 10, true
+    })
+
+-- The cursor is closed when the result set is exhausted.
+test:do_test(
+    "sql-cursor-1.3",
+    function()
+        local ok, err = pcall(cn.fetch, cn, cursor_id, 1)
+        return {ok, tostring(err):match("SQL cursor with id") ~= nil}
+    end, {
+        false, true
+    })
+
+test:do_test(
+    "sql-cursor-1.4",
+    function()
+        local res = cn:execute("SELECT id FROM t WHERE id < 3", nil,
+                               {fetch_size = 5})
+        local r = ids(res)
+        table.insert(r, res.cursor_id == nil)
+        return r
+    end, {
+        1, 2, true
+    })
+
+test:do_test(
+    "sql-cursor-1.5",
+    function()
+        local res = cn:execute("INSERT INTO t VALUES (11, 'b11')", nil,
+                               {fetch_size = 1})
+        return {res.row_count, res.cursor_id == nil}
+    end, {
+        1, true
+    })
+
+-- Bound strings outlive the request that opened the cursor.
+test:do_test(
+    "sql-cursor-1.6",
+    function()
+        local res = cn:execute("SELECT id FROM t WHERE b > ? ORDER BY id",
+                               {'b5'}, {fetch_size = 2})
+        local r = ids(res)
+        res = cn:fetch(res.cursor_id, 10)
+        for _, v in ipairs(ids(res)) do
+            table.insert(r, v)
+        end
+        return r
+    end, {
+        6, 7, 8, 9
+    })
+
+-- Cursors are visible only in the session which opened them.
+test:do_test(
+    "sql-cursor-1.7",
+    function()
+        local res = cn:execute("SELECT id FROM t", nil, {fetch_size = 1})
+        local cn2 = net_box.connect(box.cfg.listen)
+        local ok = pcall(cn2.fetch, cn2, res.cursor_id, 1)
+        cn2:close()
+        local r = {ok}
+        res = cn:fetch(res.cursor_id, 1)
+        table.insert(r, res.rows[1][1])
+        return r
+    end, {
+        false, 2
+    })
+
+-- A cursor expires on schema change.
+test:do_test(
+    "sql-cursor-1.8",
+    function()
+        local res = cn:execute("SELECT id FROM t", nil, {fetch_size = 1})
+        box.execute("CREATE INDEX i1 ON t(b)")
+        local ok, err = pcall(cn.fetch, cn, res.cursor_id, 1)
+        local r = {ok, tostring(err):match("statement has expired") ~= nil}
+        ok = pcall(cn.fetch, cn, res.cursor_id, 1)
+        table.insert(r, ok)
+        return r
+    end, {
+        false, true, false
+    })
+
+test:do_test(
+    "sql-cursor-1.9",
+    function()
+        local stmt = cn:prepare("SELECT id FROM t WHERE id > ? ORDER BY id")
+        local res = cn:execute(stmt.stmt_id, {8}, {fetch_size = 2})
+        local r = ids(res)
+        res = cn:fetch(res.cursor_id, 2)
+        for _, v in ipairs(ids(res)) do
+            table.insert(r, v)
+        end
+        table.insert(r, res.cursor_id == nil)
+        cn:unprepare(stmt.stmt_id)
+        return r
+    end, {
+        9, 10, 11, true
+    })
+
+cn:close()
+
+test:execsql([[
+    DROP TABLE t;
+]])
+
+test:finish_test()
@@ -45,8 +45,8 @@ test_run:cmd("setopt delimiter ''");
 
 -- Check default cache statistics.
 --
-box.info.sql()
-box.info:sql()
+box.info.sql().cache
+box.info:sql().cache
 
 -- Test local interface and basic capabilities of prepared statements.
 --
@@ -0,0 +1,279 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <iterator>
+
+#include "unit.h"
+#include "salad/art.h"
+
+static size_t allocated = 0;
+/* If not zero, every N-th allocation fails. */
+static size_t fail_every = 0;
+static size_t alloc_count = 0;
+
+static void *
+test_alloc(void *ctx, size_t size)
+{
+	(void)ctx;
+	if (fail_every != 0 && ++alloc_count % fail_every == 0)
+		return NULL;
+	allocated += size;
+	return malloc(size);
+}
+
+static void
+test_free(void *ctx, void *ptr, size_t size)
+{
+	(void)ctx;
+	allocated -= size;
+	free(ptr);
+}
+
+typedef std::map<std::string, uintptr_t> ref_map;
+
+/*
+ * Keys consist of non-zero bytes and are terminated with zero
+ * so that no key is a prefix of another.
+ */
+static std::string
+random_key(int alphabet, int max_len)
+{
+	assert(alphabet < 256);
+	int first = alphabet <= 26 ? 'a' : 1;
+	std::string key;
+	int len = rand() % max_len;
+	for (int i = 0; i < len; i++)
+		key.push_back(first + rand() % alphabet);
+	key.push_back('\0');
+	return key;
+}
+
+static const unsigned char *
+key_data(const std::string &key)
+{
+	return (const unsigned char *)key.data();
+}
+
+static bool
+check_tree(struct art *tree, ref_map &ref)
+{
+	if (art_selfcheck(tree) != 0 || tree->count != ref.size())
+		return false;
+	struct art_leaf *random = art_random(tree, rand());
+	if ((random == NULL) != ref.empty() ||
+	    (random != NULL && ref.find(std::string((const char *)random->key,
+						    random->key_len)) ==
+			       ref.end()))
+		return false;
+	struct art_leaf *leaf = tree->first;
+	for (ref_map::iterator it = ref.begin(); it != ref.end(); ++it) {
+		if (leaf == NULL || (uintptr_t)leaf->value != it->second ||
+		    it->first != std::string((const char *)leaf->key,
+					     leaf->key_len))
+			return false;
+		leaf = leaf->next;
+	}
+	return leaf == NULL;
+}
+
+/** Insert and delete random keys. */
+static void
+fill(struct art *tree, ref_map &ref, int alphabet, int max_len, size_t rounds)
+{
+	for (size_t i = 0; i < rounds; i++) {
+		std::string key = random_key(alphabet, max_len);
+		uintptr_t value = i + 1;
+		if (rand() % 3 != 0) {
+			void *replaced;
+			if (art_insert(tree, key_data(key), key.size(),
+				       (void *)value, &replaced) != 0) {
+				fail("insert failed", "true");
+				continue;
+			}
+			ref_map::iterator it = ref.find(key);
+			uintptr_t expected = it != ref.end() ? it->second : 0;
+			if ((uintptr_t)replaced != expected)
+				fail("replaced value mismatch", "true");
+			ref[key] = value;
+		} else {
+			void *deleted = art_delete(tree, key_data(key),
+						   key.size());
+			ref_map::iterator it = ref.find(key);
+			uintptr_t expected = it != ref.end() ? it->second : 0;
+			if ((uintptr_t)deleted != expected)
+				fail("deleted value mismatch", "true");
+			if (it != ref.end())
+				ref.erase(it);
+		}
+		if (i % 100 == 0 && !check_tree(tree, ref))
+			fail("tree check failed", "true");
+	}
+	if (!check_tree(tree, ref))
+		fail("tree check failed", "true");
+}
+
+/** Delete all keys in random order making nodes shrink. */
+static void
+drain(struct art *tree, ref_map &ref)
+{
+	size_t i = 0;
+	while (!ref.empty()) {
+		ref_map::iterator it = ref.begin();
+		std::advance(it, rand() % ref.size());
+		void *deleted = art_delete(tree, key_data(it->first),
+					   it->first.size());
+		if ((uintptr_t)deleted != it->second)
+			fail("deleted value mismatch", "true");
+		ref.erase(it);
+		if (i++ % 100 == 0 && !check_tree(tree, ref))
+			fail("tree check failed", "true");
+	}
+	if (!check_tree(tree, ref) || tree->root != NULL)
+		fail("tree check failed", "true");
+}
+
+static void
+random_test(int alphabet, int max_len, size_t rounds)
+{
+	struct art tree;
+	art_create(&tree, test_alloc, test_free, NULL);
+	ref_map ref;
+	fill(&tree, ref, alphabet, max_len, rounds);
+	drain(&tree, ref);
+	fill(&tree, ref, alphabet, max_len, rounds);
+	art_destroy(&tree);
+	if (allocated != 0)
+		fail("memory leak", "true");
+}
+
+static void
+simple_test()
+{
+	header();
+	random_test(4, 8, 10000);
+	footer();
+}
+
+static void
+wide_test()
+{
+	header();
+	/* Make nodes grow to 256 children and shrink back. */
+	random_test(250, 3, 100000);
+	footer();
+}
+
+static void
+long_key_test()
+{
+	header();
+	random_test(2, 64, 10000);
+	footer();
+}
+
+static void
+bound_check(int alphabet, int max_len)
+{
+	struct art tree;
+	art_create(&tree, test_alloc, test_free, NULL);
+	ref_map ref;
+	for (int i = 0; i < 5000; i++) {
+		std::string key = random_key(alphabet, max_len);
+		art_insert(&tree, key_data(key), key.size(),
+			   (void *)(uintptr_t)(i + 1), NULL);
+		ref[key] = i + 1;
+	}
+	for (int i = 0; i < 5000; i++) {
+		/* Search with full keys and with prefixes. */
+		std::string key = random_key(alphabet + 1, max_len + 1);
+		if (rand() % 2 == 0)
+			key.resize(key.size() - 1);
+		struct art_leaf *leaf = art_lower_bound(&tree, key_data(key),
+							key.size());
+		ref_map::iterator it = ref.lower_bound(key);
+		if ((leaf == NULL) != (it == ref.end()) ||
+		    (leaf != NULL && (uintptr_t)leaf->value != it->second))
+			fail("lower bound mismatch", "true");
+
+		leaf = art_upper_bound(&tree, key_data(key), key.size());
+		while (it != ref.end() &&
+		       it->first.compare(0, key.size(), key) == 0)
+			++it;
+		if ((leaf == NULL) != (it == ref.end()) ||
+		    (leaf != NULL && (uintptr_t)leaf->value != it->second))
+			fail("upper bound mismatch", "true");
+
+		leaf = art_find(&tree, key_data(key), key.size());
+		it = ref.find(key);
+		if ((leaf == NULL) != (it == ref.end()))
+			fail("find mismatch", "true");
+	}
+	art_destroy(&tree);
+	if (allocated != 0)
+		fail("memory leak", "true");
+}
+
+static void
+bound_test()
+{
+	header();
+	bound_check(6, 6);
+	/* Long compressed paths. */
+	bound_check(2, 40);
+	footer();
+}
+
+static void
+alloc_failure_test()
+{
+	header();
+	struct art tree;
+	art_create(&tree, test_alloc, test_free, NULL);
+	ref_map ref;
+	for (int i = 0; i < 40000; i++) {
+		/* Allocations fail while the tree is being drained too. */
+		fail_every = i < 30000 ? 7 : 3;
+		std::string key = random_key(i < 30000 ? 20 : 3,
+					     i < 30000 ? 4 : 8);
+		if (rand() % 2 == 0) {
+			if (art_insert(&tree, key_data(key), key.size(),
+				       (void *)(uintptr_t)(i + 1), NULL) == 0)
+				ref[key] = i + 1;
+		} else {
+			/* Delete never fails. */
+			art_delete(&tree, key_data(key), key.size());
+			ref.erase(key);
+		}
+		if (i >= 30000 && rand() % 2 == 0 && !ref.empty()) {
+			ref_map::iterator it = ref.begin();
+			std::advance(it, rand() % ref.size());
+			art_delete(&tree, key_data(it->first),
+				   it->first.size());
+			ref.erase(it);
+		}
+		if (i % 100 == 0 && !check_tree(&tree, ref))
+			fail("tree check failed", "true");
+	}
+	fail_every = 0;
+	if (!check_tree(&tree, ref))
+		fail("tree check failed", "true");
+	art_destroy(&tree);
+	if (allocated != 0)
+		fail("memory leak", "true");
+	footer();
+}
+
+int
+main(int, const char**)
+{
+	srand(time(0));
+	simple_test();
+	wide_test();
+	long_key_test();
+	bound_test();
+	alloc_failure_test();
+}
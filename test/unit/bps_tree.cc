@@ -115,6 +115,28 @@ static int compare_key(const elem_t &a, long b)
 #define bps_tree_key_t uint32_t
 #define bps_tree_arg_t int
 #include "salad/bps_tree.h"
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef BPS_TREE_IS_IDENTICAL
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+
+/* tree with subtree cardinalities for offset test */
+#define BPS_TREE_NAME card
+#define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
+#define BPS_TREE_EXTENT_SIZE 2048 /* value is to low specially for tests */
+#define BPS_TREE_IS_IDENTICAL(a, b) (a == b)
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define BPS_INNER_CARD
+#define bps_tree_elem_t type_t
+#define bps_tree_key_t type_t
+#define bps_tree_arg_t int
+#include "salad/bps_tree.h"
 
 #define bps_insert_and_check(tree_name, tree, elem, replaced) \
 {\
@@ -858,6 +880,115 @@ delete_value_check()
 	footer();
 }
 
+static void
+find_batch_check()
+{
+	header();
+	test tree;
+	test_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	const long count = 10000;
+	for (long i = 0; i < count; i++)
+		test_insert(&tree, i * 2, NULL);
+	const size_t key_count = 1000;
+	type_t keys[key_count];
+	type_t *found[key_count];
+	for (size_t i = 0; i < key_count; i++)
+		keys[i] = rand() % (count * 2 + 10) - 5;
+	test_find_batch(&tree, keys, key_count, found);
+	for (size_t i = 0; i < key_count; i++) {
+		if (found[i] != test_find(&tree, keys[i]))
+			fail("batch lookup differs from single lookup", "true");
+		if (found[i] != NULL && *found[i] != keys[i])
+			fail("batch lookup found a wrong element", "true");
+	}
+	test_destroy(&tree);
+	test_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	test_find_batch(&tree, keys, key_count, found);
+	for (size_t i = 0; i < key_count; i++) {
+		if (found[i] != NULL)
+			fail("batch lookup in an empty tree", "true");
+	}
+	test_destroy(&tree);
+	footer();
+}
+
+static void
+offset_check()
+{
+	header();
+
+	if (card_debug_check_internal_functions(false))
+		fail("internal functions check", "true");
+
+	card tree;
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	const type_t count = 2000;
+	bool present[count];
+	memset(present, 0, sizeof(present));
+	for (long i = 0; i < 100000; i++) {
+		type_t v = rand() % count;
+		if (rand() % 3 != 0) {
+			card_insert(&tree, v, NULL);
+			present[v] = true;
+		} else {
+			card_delete(&tree, v);
+			present[v] = false;
+		}
+		if (i % 5000 != 0)
+			continue;
+		if (card_debug_check(&tree))
+			fail("debug check nonzero", "true");
+		size_t offset = 0;
+		for (type_t k = -1; k <= count; k++) {
+			bool exact;
+			bool in_tree = k >= 0 && k < count && present[k];
+			if (card_lower_bound_offset(&tree, k, &exact) != offset)
+				fail("lower bound offset", "true");
+			if (exact != in_tree)
+				fail("lower bound offset exact", "true");
+			if (in_tree)
+				offset++;
+			if (card_upper_bound_offset(&tree, k, &exact) != offset)
+				fail("upper bound offset", "true");
+			if (exact != in_tree)
+				fail("upper bound offset exact", "true");
+		}
+		if (offset != card_size(&tree))
+			fail("offset of the last element", "true");
+	}
+	card_destroy(&tree);
+
+	type_t arr[count];
+	for (type_t i = 0; i < count; i++)
+		arr[i] = i * 2;
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	if (card_build(&tree, arr, count))
+		fail("building failed", "true");
+	struct card_iterator end = card_iterator_at(&tree, count);
+	if (!card_iterator_is_invalid(&end))
+		fail("iterator at the end", "true");
+	if (card_debug_check(&tree))
+		fail("debug check nonzero", "true");
+	for (type_t i = 0; i < count; i++) {
+		if (card_lower_bound_offset(&tree, i * 2, NULL) != (size_t)i)
+			fail("lower bound offset after build", "true");
+		if (card_upper_bound_offset(&tree, i * 2 + 1, NULL) !=
+		    (size_t)i + 1)
+			fail("upper bound offset after build", "true");
+		struct card_iterator itr = card_iterator_at(&tree, i);
+		type_t *v = card_iterator_get_elem(&tree, &itr);
+		if (v == NULL || *v != i * 2)
+			fail("iterator at offset", "true");
+	}
+	for (type_t i = 0; i < count; i += 2)
+		card_delete(&tree, i * 2);
+	if (card_debug_check(&tree))
+		fail("debug check nonzero", "true");
+	card_destroy(&tree);
+
+	footer();
+}
+
 int
 main(void)
 {
@@ -873,4 +1004,6 @@ main(void)
 		fail("memory leak!", "true");
 	insert_get_iterator();
 	delete_value_check();
+	find_batch_check();
+	offset_check();
 }
@@ -8,6 +8,7 @@
 #include "memory.h"
 #include "fiber.h"
 #include "cbus.h"
+#include "clock.h"
 #include "unit.h"
 
 /*
@@ -27,6 +28,15 @@ static const int connect_prob = 30;
 /* Chance of disconnecting from a random neighbor in a loop iteration. */
 static const int disconnect_prob = 20;
 
+/* Number of messages sent back and forth by the benchmark. */
+static const int bench_count = 200000;
+
+/* Number of messages pushed by the benchmark before a flush. */
+static const int bench_batch = 64;
+
+/* Max number of benchmark messages in flight. */
+static const int bench_window = 1024;
+
 /* This structure represents a connection to a test thread. */
 struct conn {
 	bool active;
@@ -325,6 +335,76 @@ thread_func(va_list ap)
 	return 0;
 }
 
+struct bench_msg {
+	struct cmsg cmsg;
+	/* Sequence number, to check the order of delivery. */
+	int seq;
+};
+
+/* The next sequence number expected by the benchmark thread. */
+static int bench_thread_seq;
+/* The next sequence number expected by the main thread. */
+static int bench_main_seq;
+
+static void
+bench_msg_thread_cb(struct cmsg *cmsg)
+{
+	struct bench_msg *msg = container_of(cmsg, struct bench_msg, cmsg);
+	fail_unless(msg->seq == bench_thread_seq);
+	bench_thread_seq++;
+}
+
+static void
+bench_msg_main_cb(struct cmsg *cmsg)
+{
+	struct bench_msg *msg = container_of(cmsg, struct bench_msg, cmsg);
+	fail_unless(msg->seq == bench_main_seq);
+	bench_main_seq++;
+	free(msg);
+}
+
+/*
+ * Send messages to a test thread and back, in batches, and
+ * report the throughput. The pipes used are the only producers
+ * which own the rings of their endpoints, so the messages don't
+ * take the endpoint mutex on the way.
+ */
+static void
+bench(struct cbus_endpoint *endpoint)
+{
+	struct thread *t = NULL;
+	for (int i = 0; i < thread_count; i++) {
+		if (threads[i].main_pipe.ring != NULL)
+			t = &threads[i];
+	}
+	fail_unless(t != NULL);
+	fail_unless(t->thread_pipe.ring != NULL);
+	static struct cmsg_hop route[2] = {
+		{ bench_msg_thread_cb, NULL },
+		{ bench_msg_main_cb, NULL },
+	};
+	route[0].pipe = &t->main_pipe;
+
+	double start = clock_monotonic();
+	int sent = 0;
+	while (bench_main_seq < bench_count) {
+		for (int i = 0; i < bench_batch && sent < bench_count &&
+				sent - bench_main_seq < bench_window; i++) {
+			struct bench_msg *msg = malloc(sizeof(*msg));
+			fail_unless(msg != NULL);
+			cmsg_init(&msg->cmsg, route);
+			msg->seq = sent++;
+			cpipe_push_input(&t->thread_pipe, &msg->cmsg);
+		}
+		cpipe_flush_input(&t->thread_pipe);
+		cbus_process(endpoint);
+		fiber_yield_timeout(0);
+	}
+	double elapsed = clock_monotonic() - start;
+	diag("cbus: %d round trips in %.3f sec, %.0f per sec",
+	     bench_count, elapsed, bench_count / elapsed);
+}
+
 static int
 main_func(va_list ap)
 {
@@ -339,6 +419,8 @@ main_func(va_list ap)
 	for (int i = 0; i < thread_count; i++)
 		thread_create(&threads[i], i);
 
+	bench(&endpoint);
+
 	for (int i = 0; i < thread_count; i++)
 		thread_start_test(&threads[i]);
 
@@ -1,7 +1,9 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "unit.h"
@@ -17,7 +19,7 @@ int
 main()
 {
 	header();
-	plan(38);
+	plan(44);
 
 	srand(time(NULL));
 	double now = rand();
@@ -89,6 +91,31 @@ main()
 		   interval);
 	}
 
+	memset(&sched, 0, sizeof(sched));
+	is(checkpoint_schedule_wal_budget(&sched), INT64_MAX,
+	   "recovery time target disabled - WAL budget");
+
+	checkpoint_schedule_cfg_recovery_time(&sched, 10);
+	is(checkpoint_schedule_wal_budget(&sched),
+	   10 * (int64_t)CHECKPOINT_DEFAULT_REPLAY_RATE,
+	   "recovery time target 10 - default replay rate");
+
+	checkpoint_schedule_set_replay_rate(&sched, 1e6);
+	is(checkpoint_schedule_wal_budget(&sched), 10000000,
+	   "recovery time target 10 - measured replay rate");
+
+	checkpoint_schedule_add_checkpoint_time(&sched, 4);
+	is(checkpoint_schedule_wal_budget(&sched), 6000000,
+	   "recovery time target 10 - checkpoint load time");
+
+	checkpoint_schedule_add_checkpoint_time(&sched, 14);
+	ok(llabs(checkpoint_schedule_wal_budget(&sched) - 3000000) <= 1,
+	   "recovery time target 10 - average checkpoint load time");
+
+	checkpoint_schedule_add_checkpoint_time(&sched, 100);
+	is(checkpoint_schedule_wal_budget(&sched), 0,
+	   "recovery time target 10 - target can't be met");
+
 	check_plan();
 	footer();
 
@@ -2,9 +2,11 @@
 #include "fiber.h"
 #include "coio.h"
 #include "coio_task.h"
+#include "coio_file.h"
 #include "fio.h"
 #include "unit.h"
 #include "unit.h"
+#include <fcntl.h>
 
 int
 touch_f(va_list ap)
@@ -135,6 +137,57 @@ test_getaddrinfo(void)
 	footer();
 }
 
+static void
+test_getaddrinfo_cached(void)
+{
+	header();
+	plan(4);
+	const char *host = "127.0.0.1";
+	const char *port = "3333";
+	struct addrinfo *i1, *i2;
+	int rc = coio_getaddrinfo_cached(host, port, NULL, &i1, 1);
+	is(rc, 0, "cached getaddrinfo miss");
+	rc = coio_getaddrinfo_cached(host, port, NULL, &i2, 1);
+	is(rc, 0, "cached getaddrinfo hit");
+	ok(i1 != NULL && i2 != NULL && i1 != i2 &&
+	   i1->ai_addrlen == i2->ai_addrlen &&
+	   memcmp(i1->ai_addr, i2->ai_addr, i1->ai_addrlen) == 0,
+	   "cached result");
+	coio_freeaddrinfo(i1);
+	coio_freeaddrinfo(i2);
+
+	coio_dns_cache_set_ttl(0);
+	rc = coio_getaddrinfo_cached(host, port, NULL, &i1, 1);
+	is(rc, 0, "getaddrinfo with cache disabled");
+	coio_freeaddrinfo(i1);
+	coio_dns_cache_set_ttl(10);
+	check_plan();
+	footer();
+}
+
+static void
+test_file(void)
+{
+	header();
+	plan(8);
+	const char *filename = "2.out";
+	int fd = coio_file_open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	ok(fd >= 0, "open");
+	is(coio_write(fd, "hello world", 11), 11, "write");
+	is(coio_pwrite(fd, "HELLO", 5, 0), 5, "pwrite");
+	char buf[16];
+	memset(buf, 0, sizeof(buf));
+	is(coio_pread(fd, buf, sizeof(buf) - 1, 0), 11, "pread");
+	is(strcmp(buf, "HELLO world"), 0, "pread data");
+	is(coio_fdatasync(fd), 0, "fdatasync");
+	is(coio_file_close(fd), 0, "close");
+	ok(coio_file_open("/no/such/dir/file", O_RDONLY, 0) < 0 &&
+	   errno == ENOENT, "open error");
+	(void) remove(filename);
+	check_plan();
+	footer();
+}
+
 static int
 main_f(va_list ap)
 {
@@ -154,6 +207,8 @@ main_f(va_list ap)
 	fiber_join(call_fiber);
 
 	test_getaddrinfo();
+	test_getaddrinfo_cached();
+	test_file();
 
 	ev_break(loop(), EVBREAK_ALL);
 	return 0;
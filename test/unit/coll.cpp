@@ -184,6 +184,36 @@ cache_test()
 	footer();
 }
 
+void
+cmp_test()
+{
+	header();
+	plan(4);
+
+	struct coll_def def;
+	memset(&def, 0, sizeof(def));
+	snprintf(def.locale, sizeof(def.locale), "%s", "ru_RU");
+	def.type = COLL_TYPE_ICU;
+	def.icu.strength = COLL_ICU_STRENGTH_PRIMARY;
+	struct coll *coll = coll_new(&def);
+	assert(coll != NULL);
+
+	const char *s = "абв";
+	char t[16];
+	snprintf(t, sizeof(t), "%s", s);
+	is(coll->cmp(s, strlen(s), t, strlen(t), coll), 0,
+	   "identical strings are equal");
+	is(coll->cmp(s, strlen(s), "АБВ", strlen("АБВ"), coll), 0,
+	   "strings equal in terms of collation are equal");
+	ok(coll->cmp("аб", strlen("аб"), t, strlen(t), coll) < 0,
+	   "prefix is less");
+	ok(coll->cmp("", 0, "", 0, coll) == 0, "empty strings are equal");
+
+	coll_unref(coll);
+	check_plan();
+	footer();
+}
+
 int
 main(int, const char**)
 {
@@ -193,6 +223,7 @@ main(int, const char**)
 	manual_test();
 	hash_test();
 	cache_test();
+	cmp_test();
 	fiber_free();
 	memory_free();
 	coll_free();
@@ -30,6 +30,8 @@
  */
 #include "unit.h"
 #include "crc32.h"
+#include <stdlib.h>
+#include <third_party/crc32.h>
 
 static void
 test_alignment(void)
@@ -59,14 +61,42 @@ test_alignment(void)
 	footer();
 }
 
+/**
+ * Buffers long enough to be checksummed as parallel streams
+ * must get the same CRC as with the plain implementation.
+ */
+static void
+test_long_buffers(void)
+{
+	header();
+	plan(1);
+
+	static char buf[100000];
+	for (size_t i = 0; i < sizeof(buf); i++)
+		buf[i] = rand();
+	int mismatch = 0;
+	for (int offset = 0; offset < 9; offset++) {
+		for (unsigned int len = 0; len < 90000; len += 997) {
+			if (crc32_calc(1234, buf + offset, len) !=
+			    crc32c(1234, buf + offset, len))
+				mismatch++;
+		}
+	}
+	is(mismatch, 0, "long buffers");
+
+	check_plan();
+	footer();
+}
+
 int
 main(void)
 {
 	crc32_init();
 
 	header();
-	plan(1);
+	plan(2);
 	test_alignment();
+	test_long_buffers();
 	int rc = check_plan();
 	footer();
 	return rc;
@@ -330,10 +330,67 @@ test_mp_print(void)
 	check_plan();
 }
 
+#define dectest_fast(op, stra, strb, expected) ({\
+	decimal_t a, b, c;\
+	decimal_from_string(&a, stra);\
+	decimal_from_string(&b, strb);\
+	ok(decimal_##op(&c, &a, &b) == &c &&\
+	   strcmp(decimal_to_string(&c), expected) == 0,\
+	   "decimal_"#op"("stra", "strb") == "expected);\
+})
+
+#define dectest_fast_cmp(stra, strb, expected) ({\
+	decimal_t a, b;\
+	decimal_from_string(&a, stra);\
+	decimal_from_string(&b, strb);\
+	is(decimal_compare(&a, &b), expected,\
+	   "decimal_compare("stra", "strb") == "#expected);\
+})
+
+/**
+ * Operations on coefficients fitting in 128 bits are done with
+ * integer arithmetic. Check that the results are exactly the same
+ * as the ones of decNumber, including the scale and the sign of
+ * zero, and that the operations fall back to decNumber when the
+ * result needs rounding.
+ */
+static void
+test_fast_path(void)
+{
+	plan(41);
+	header();
+
+	dectest_fast(add, "1.10", "2.2", "3.30");
+	dectest_fast(add, "5", "-7.25", "-2.25");
+	dectest_fast(add, "-0", "-0", "-0");
+	dectest_fast(add, "99999999999999999999", "1", "100000000000000000000");
+	dectest_fast(add, "1e37", "0.1", "10000000000000000000000000000000000000");
+	dectest_fast(sub, "1", "1.00", "0.00");
+	dectest_fast(sub, "-3.5", "-10", "6.5");
+	dectest_fast(sub, "0", "0", "0");
+	dectest_fast(mul, "1.25", "-4", "-5.00");
+	dectest_fast(mul, "-1.5", "0", "-0.0");
+	dectest_fast(mul, "1234567890.123456789", "9876543210.987654321",
+		     "12193263113702179522.374638011112635269");
+	dectest_fast_cmp("1.0", "1", 0);
+	dectest_fast_cmp("-0", "0", 0);
+	dectest_fast_cmp("-2", "1.5", -1);
+	dectest_fast_cmp("0.3", "0.25", 1);
+	dectest_fast_cmp("-5", "-4.99", -1);
+	dectest_fast_cmp("1e37", "99999999999999999999999999999999999999", -1);
+
+	test_decpack("-0");
+	test_decpack("1234567890123456789");
+	test_decpack("-12345678901234567890");
+
+	footer();
+	check_plan();
+}
+
 int
 main(void)
 {
-	plan(304);
+	plan(305);
 
 	dectest(314, 271, uint64, uint64_t);
 	dectest(65535, 23456, uint64, uint64_t);
@@ -413,5 +470,7 @@ main(void)
 	dectest_is(is_int, 1.0000, true);
 	dectest_is(is_int, 1.0000001, false);
 
+	test_fast_path();
+
 	return check_plan();
 }
@@ -21,7 +21,7 @@ main_f(va_list ap)
 	struct fiber *fiber;
 
 	header();
-	plan(6);
+	plan(8);
 
 	/*
 	 * Set non-default stack size to prevent reusing of an
@@ -88,6 +88,23 @@ main_f(va_list ap)
 	used_after = slabc->allocated.stats.used;
 	ok(used_after > used_before, "expected leak detected");
 
+	/*
+	 * A fiber with a pooled stack is cached on death and
+	 * reused by a fiber with the same stack size.
+	 */
+	fiber_attr->flags |= FIBER_POOLED_STACK;
+	struct fiber *pooled = fiber_new_ex("test_pooled", fiber_attr, noop_f);
+	ok(pooled != NULL, "fiber with pooled stack");
+	fiber_set_joinable(pooled, true);
+	fiber_start(pooled);
+	fiber_join(pooled);
+
+	fiber = fiber_new_ex("test_pooled", fiber_attr, noop_f);
+	ok(fiber == pooled, "pooled stack is reused");
+	fiber_set_joinable(fiber, true);
+	fiber_start(fiber);
+	fiber_join(fiber);
+
 	fiber_attr_delete(fiber_attr);
 	footer();
 
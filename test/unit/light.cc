@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <inttypes.h>
 #include <vector>
@@ -39,6 +40,15 @@ equal_key(hash_value_t v1, hash_value_t v2)
 #define LIGHT_EQUAL_KEY(a, b, arg) equal_key(a, b)
 #include "salad/light.h"
 
+#define SWISS_NAME
+#define SWISS_DATA_TYPE uint64_t
+#define SWISS_KEY_TYPE uint64_t
+#define SWISS_CMP_ARG_TYPE int
+#define SWISS_EQUAL(a, b, arg) equal(a, b)
+#define SWISS_EQUAL_KEY(a, b, arg) equal_key(a, b)
+#define SWISS_HASH(a, arg) hash(a)
+#include "salad/swiss.h"
+
 inline void *
 my_light_alloc(void *ctx)
 {
@@ -317,6 +327,69 @@ iterator_freeze_check()
 	footer();
 }
 
+/**
+ * Compare light with salad/swiss.h on the same workload. Takes
+ * a while, so runs only if LIGHT_BENCH environment variable is
+ * set, e.g. LIGHT_BENCH=1000000 ./light.test
+ */
+static void
+swiss_bench(size_t count)
+{
+	std::vector<hash_value_t> keys(count);
+	for (size_t i = 0; i < count; i++)
+		keys[i] = ((uint64_t)rand() << 31) ^ rand();
+	hash_value_t found = 0;
+
+	struct light_core lt;
+	light_create(&lt, light_extent_size,
+		     my_light_alloc, my_light_free, &extents_count, 0);
+	clock_t start = clock();
+	for (size_t i = 0; i < count; i++)
+		light_insert(&lt, hash(keys[i]), keys[i]);
+	clock_t insert_time = clock() - start;
+	start = clock();
+	for (size_t i = 0; i < count; i++)
+		found += light_find_key(&lt, hash(keys[i]), keys[i]) !=
+			 light_end;
+	clock_t hit_time = clock() - start;
+	start = clock();
+	for (size_t i = 0; i < count; i++)
+		found += light_find_key(&lt, hash(~keys[i]), ~keys[i]) !=
+			 light_end;
+	clock_t miss_time = clock() - start;
+	printf("light: insert %.3f s, hit %.3f s, miss %.3f s\n",
+	       (double)insert_time / CLOCKS_PER_SEC,
+	       (double)hit_time / CLOCKS_PER_SEC,
+	       (double)miss_time / CLOCKS_PER_SEC);
+	light_destroy(&lt);
+
+	struct swiss_core st;
+	swiss_create(&st, light_extent_size,
+		     my_light_alloc, my_light_free, &extents_count, 0);
+	start = clock();
+	for (size_t i = 0; i < count; i++)
+		swiss_insert(&st, hash(keys[i]), keys[i]);
+	insert_time = clock() - start;
+	start = clock();
+	for (size_t i = 0; i < count; i++)
+		found += swiss_find_key(&st, hash(keys[i]), keys[i]) !=
+			 swiss_end;
+	hit_time = clock() - start;
+	start = clock();
+	for (size_t i = 0; i < count; i++)
+		found += swiss_find_key(&st, hash(~keys[i]), ~keys[i]) !=
+			 swiss_end;
+	miss_time = clock() - start;
+	printf("swiss: insert %.3f s, hit %.3f s, miss %.3f s\n",
+	       (double)insert_time / CLOCKS_PER_SEC,
+	       (double)hit_time / CLOCKS_PER_SEC,
+	       (double)miss_time / CLOCKS_PER_SEC);
+	swiss_destroy(&st);
+
+	if (found < count)
+		fail("benchmark lookup failed", "true");
+}
+
 int
 main(int, const char**)
 {
@@ -325,6 +398,9 @@ main(int, const char**)
 	collision_test();
 	iterator_test();
 	iterator_freeze_check();
+	const char *bench = getenv("LIGHT_BENCH");
+	if (bench != NULL)
+		swiss_bench(atoll(bench));
 	if (extents_count != 0)
 		fail("memory leak!", "true");
 }
@@ -275,12 +275,86 @@ neighbor_test()
 	footer();
 }
 
+static void
+bulk_build_test()
+{
+	header();
+
+	const size_t test_count = 1000;
+	struct rtree_rect arr[test_count];
+	static struct rtree_rect basis;
+
+	for (size_t i = 0; i < test_count; i++) {
+		rtree_set2d(&arr[i], i, i, i + 1, i + 1);
+	}
+
+	for (size_t i = 0; i <= test_count; i += 37) {
+		struct rtree tree;
+		rtree_init(&tree, 2, extent_size,
+			   extent_alloc, extent_free, &page_count,
+			   RTREE_EUCLID);
+
+		/* Feed the records in reverse order to test sorting */
+		char *entries = (char *)malloc(rtree_build_entry_size(&tree) *
+					       (i + 1));
+		for (size_t j = 0; j < i; j++) {
+			rtree_build_entry_set(&tree, entries, j,
+					      &arr[i - j - 1],
+					      (record_t)(i - j));
+		}
+		rtree_build(&tree, entries, i);
+		free(entries);
+
+		if (rtree_number_of_records(&tree) != i) {
+			fail("Tree count mismatch", "true");
+		}
+
+		struct rtree_iterator iterator;
+		rtree_iterator_init(&iterator);
+		if (!rtree_search(&tree, &basis, SOP_NEIGHBOR, &iterator) &&
+		    i != 0) {
+			fail("search is successful", "true");
+		}
+		for (size_t j = 0; j < i; j++) {
+			record_t rec = rtree_iterator_next(&iterator);
+			if (rec != record_t(j + 1)) {
+				fail("wrong neighbor search result", "true");
+			}
+		}
+		for (size_t j = 0; j < i; j++) {
+			if (!rtree_search(&tree, &arr[j], SOP_EQUALS,
+					  &iterator)) {
+				fail("element in tree", "false");
+			}
+			if (rtree_iterator_next(&iterator) != record_t(j + 1)) {
+				fail("right search result", "true");
+			}
+		}
+		/* The tree must stay usable after bulk load */
+		for (size_t j = 0; j < i; j += 2) {
+			if (!rtree_remove(&tree, &arr[j], record_t(j + 1))) {
+				fail("delete element in tree", "false");
+			}
+		}
+		for (size_t j = 0; j < i; j += 2) {
+			rtree_insert(&tree, &arr[j], record_t(j + 1));
+		}
+		if (rtree_number_of_records(&tree) != i) {
+			fail("Tree count mismatch", "true");
+		}
+		rtree_iterator_destroy(&iterator);
+		rtree_destroy(&tree);
+	}
+
+	footer();
+}
 
 int
 main(void)
 {
 	simple_check();
 	neighbor_test();
+	bulk_build_test();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
@@ -678,7 +678,7 @@ swim_test_broadcast(void)
 static void
 swim_test_payload_basic(void)
 {
-	swim_start_test(11);
+	swim_start_test(12);
 	int size, cluster_size = 3;
 	struct swim_cluster *cluster = swim_cluster_new(cluster_size);
 	for (int i = 0; i < cluster_size; ++i) {
@@ -712,6 +712,10 @@ swim_test_payload_basic(void)
 	   "payload is changed");
 	is(swim_cluster_member_incarnation(cluster, 0, 0).version, 2,
 	   "version is incremented on each payload update");
+	fail_if(swim_cluster_member_set_payload(cluster, 0, s0_payload,
+						s0_payload_size) != 0);
+	is(swim_cluster_member_incarnation(cluster, 0, 0).version, 2,
+	   "version is not incremented when payload is the same");
 	is(swim_cluster_wait_payload_everywhere(cluster, 0, s0_payload,
 						s0_payload_size, cluster_size),
 	   0, "second payload is disseminated");
@@ -277,49 +277,51 @@ swim_test_transport_free(void)
 
 /**
  * Wrap a packet and put into send queue. Packets are popped from
- * it on EV_WRITE event.
+ * it on EV_WRITE event. Only one packet is taken from a batch so
+ * as the fake event loop would see the same sequence of events
+ * as without batching.
  */
-ssize_t
-swim_transport_send(struct swim_transport *transport, const void *data,
-		    size_t size, const struct sockaddr *addr,
-		    socklen_t addr_size)
+int
+swim_transport_send_batch(struct swim_transport *transport,
+			  struct swim_transport_msg *msgs, int count)
 {
-	/*
-	 * Create packet. Put into sending queue.
-	 */
-	(void) addr_size;
-	assert(addr->sa_family == AF_INET);
+	assert(count > 0);
+	(void) count;
+	assert(msgs->addr.sin_family == AF_INET);
 	struct swim_test_packet *p =
-		swim_test_packet_new(data, size, &transport->addr,
-				     (const struct sockaddr_in *) addr);
+		swim_test_packet_new(msgs->data, msgs->size, &transport->addr,
+				     &msgs->addr);
 	struct swim_fd *src = &swim_fd[transport->fd - FAKE_FD_BASE];
 	assert(src->is_opened);
 	rlist_add_tail_entry(&src->send_queue, p, in_queue);
-	return size;
+	return 1;
 }
 
 /**
  * Move a packet from send to recv queue. The packet is popped and
- * processed on EV_READ event.
+ * processed on EV_READ event. One packet per call, like sending.
  */
-ssize_t
-swim_transport_recv(struct swim_transport *transport, void *buffer, size_t size,
-		    struct sockaddr *addr, socklen_t *addr_size)
+int
+swim_transport_recv_batch(struct swim_transport *transport,
+			  struct swim_transport_msg *msgs, int count)
 {
+	assert(count > 0);
+	(void) count;
 	/*
 	 * Pop a packet from a receiving queue.
 	 */
 	struct swim_fd *dst = &swim_fd[transport->fd - FAKE_FD_BASE];
 	assert(dst->is_opened);
+	if (rlist_empty(&dst->recv_queue))
+		return 0;
 	struct swim_test_packet *p =
 		rlist_shift_entry(&dst->recv_queue, struct swim_test_packet,
 				  in_queue);
-	*(struct sockaddr_in *) addr = p->src;
-	*addr_size = sizeof(p->src);
-	ssize_t result = MIN((size_t) p->size, size);
-	memcpy(buffer, p->data, result);
+	msgs->addr = p->src;
+	msgs->size = MIN((size_t) p->size, msgs->size);
+	memcpy(msgs->data, p->data, msgs->size);
 	swim_test_packet_delete(p);
-	return result;
+	return 1;
 }
 
 int
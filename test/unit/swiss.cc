@@ -0,0 +1,326 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <vector>
+#include <time.h>
+
+#include "unit.h"
+
+typedef uint64_t hash_value_t;
+typedef uint32_t hash_t;
+
+static const size_t swiss_extent_size = 16 * 1024;
+static size_t extents_count = 0;
+
+hash_t
+hash(hash_value_t value)
+{
+	return (hash_t) value;
+}
+
+bool
+equal(hash_value_t v1, hash_value_t v2)
+{
+	return v1 == v2;
+}
+
+bool
+equal_key(hash_value_t v1, hash_value_t v2)
+{
+	return v1 == v2;
+}
+
+/*
+ * The argument is a hash multiplier, used to test collisions.
+ */
+#define SWISS_NAME
+#define SWISS_DATA_TYPE uint64_t
+#define SWISS_KEY_TYPE uint64_t
+#define SWISS_CMP_ARG_TYPE uint32_t
+#define SWISS_EQUAL(a, b, arg) equal(a, b)
+#define SWISS_EQUAL_KEY(a, b, arg) equal_key(a, b)
+#define SWISS_HASH(a, arg) (hash(a) * (arg))
+#include "salad/swiss.h"
+
+inline void *
+my_swiss_alloc(void *ctx)
+{
+	size_t *p_extents_count = (size_t *)ctx;
+	assert(p_extents_count == &extents_count);
+	++*p_extents_count;
+	return malloc(swiss_extent_size);
+}
+
+inline void
+my_swiss_free(void *ctx, void *p)
+{
+	size_t *p_extents_count = (size_t *)ctx;
+	assert(p_extents_count == &extents_count);
+	--*p_extents_count;
+	free(p);
+}
+
+static void
+random_test(uint32_t multiplier, size_t rounds)
+{
+	struct swiss_core ht;
+	swiss_create(&ht, swiss_extent_size,
+		     my_swiss_alloc, my_swiss_free, &extents_count,
+		     multiplier);
+	std::vector<bool> vect;
+	size_t count = 0;
+	const size_t start_limits = 20;
+	for(size_t limits = start_limits; limits <= 2 * rounds; limits *= 10) {
+		while (vect.size() < limits)
+			vect.push_back(false);
+		for (size_t i = 0; i < rounds; i++) {
+
+			hash_value_t val = rand() % limits;
+			hash_t h = hash(val) * multiplier;
+			hash_t fnd = swiss_find(&ht, h, val);
+			bool has1 = fnd != swiss_end;
+			bool has2 = vect[val];
+			assert(has1 == has2);
+			if (has1 != has2) {
+				fail("find key failed!", "true");
+				return;
+			}
+
+			if (!has1) {
+				count++;
+				vect[val] = true;
+				swiss_insert(&ht, h, val);
+			} else {
+				count--;
+				vect[val] = false;
+				swiss_delete(&ht, h, fnd);
+			}
+
+			if (count != ht.count)
+				fail("count check failed!", "true");
+
+			bool identical = true;
+			for (hash_value_t test = 0; test < limits; test++) {
+				hash_t h = hash(test) * multiplier;
+				if (vect[test]) {
+					if (swiss_find_key(&ht, h, test) == swiss_end)
+						identical = false;
+				} else {
+					if (swiss_find_key(&ht, h, test) != swiss_end)
+						identical = false;
+				}
+			}
+			if (!identical)
+				fail("internal test failed!", "true");
+
+			int check = swiss_selfcheck(&ht);
+			if (check)
+				fail("internal test failed!", "true");
+		}
+	}
+	swiss_destroy(&ht);
+}
+
+static void
+simple_test()
+{
+	header();
+	random_test(1, 1000);
+	footer();
+}
+
+static void
+collision_test()
+{
+	header();
+	random_test(1024, 100);
+	footer();
+}
+
+static void
+grow_test()
+{
+	header();
+
+	struct swiss_core ht;
+	swiss_create(&ht, swiss_extent_size,
+		     my_swiss_alloc, my_swiss_free, &extents_count, 1);
+	const hash_value_t count = 100000;
+	for (hash_value_t val = 0; val < count; val++) {
+		uint32_t pos = swiss_insert(&ht, hash(val), val);
+		if (pos == swiss_end || swiss_get(&ht, pos) != val)
+			fail("insert failed!", "true");
+	}
+	if (ht.count != count || swiss_selfcheck(&ht) != 0)
+		fail("internal test failed!", "true");
+	for (hash_value_t val = 0; val < count; val += 2) {
+		if (swiss_delete_value(&ht, hash(val), val) != 0)
+			fail("delete failed!", "true");
+	}
+	if (swiss_delete_value(&ht, hash(0), 0) != 1)
+		fail("double delete succeeded!", "true");
+	for (hash_value_t val = 0; val < count; val++) {
+		bool found = swiss_find_key(&ht, hash(val), val) != swiss_end;
+		if (found != (val % 2 == 1))
+			fail("find key failed!", "true");
+	}
+	hash_value_t replaced = 0;
+	if (swiss_replace(&ht, hash(1), 1, &replaced) == swiss_end ||
+	    replaced != 1)
+		fail("replace failed!", "true");
+	if (swiss_replace(&ht, hash(2), 2, &replaced) != swiss_end)
+		fail("replace of a missing value succeeded!", "true");
+	if (ht.count != count / 2 || swiss_selfcheck(&ht) != 0)
+		fail("internal test failed!", "true");
+	swiss_destroy(&ht);
+
+	footer();
+}
+
+static void
+iterator_test()
+{
+	header();
+
+	struct swiss_core ht;
+	swiss_create(&ht, swiss_extent_size,
+		     my_swiss_alloc, my_swiss_free, &extents_count, 1);
+	const size_t rounds = 1000;
+	const size_t start_limits = 20;
+
+	const size_t iterator_count = 16;
+	struct swiss_iterator iterators[iterator_count];
+	for (size_t i = 0; i < iterator_count; i++)
+		swiss_iterator_begin(&ht, iterators + i);
+	size_t cur_iterator = 0;
+	hash_value_t strage_thing = 0;
+
+	for(size_t limits = start_limits; limits <= 2 * rounds; limits *= 10) {
+		for (size_t i = 0; i < rounds; i++) {
+			hash_value_t val = rand() % limits;
+			hash_t h = hash(val);
+			hash_t fnd = swiss_find(&ht, h, val);
+
+			if (fnd == swiss_end) {
+				swiss_insert(&ht, h, val);
+			} else {
+				swiss_delete(&ht, h, fnd);
+			}
+
+			hash_value_t *pval = swiss_iterator_get_and_next(&ht, iterators + cur_iterator);
+			if (pval)
+				strage_thing ^= *pval;
+			if (!pval || (rand() % iterator_count) == 0) {
+				if (rand() % iterator_count) {
+					hash_value_t val = rand() % limits;
+					hash_t h = hash(val);
+					swiss_iterator_key(&ht, iterators + cur_iterator, h, val);
+				} else {
+					swiss_iterator_begin(&ht, iterators + cur_iterator);
+				}
+			}
+
+			cur_iterator++;
+			if (cur_iterator >= iterator_count)
+				cur_iterator = 0;
+		}
+	}
+	swiss_destroy(&ht);
+
+	if (strage_thing >> 20) {
+		printf("impossible!\n"); // prevent strage_thing to be optimized out
+	}
+
+	footer();
+}
+
+static void
+iterator_freeze_check()
+{
+	header();
+
+	const int test_data_size = 1000;
+	hash_value_t comp_buf[test_data_size];
+	const int test_data_mod = 2000;
+	srand(0);
+	struct swiss_core ht;
+
+	for (int i = 0; i < 10; i++) {
+		swiss_create(&ht, swiss_extent_size,
+			     my_swiss_alloc, my_swiss_free, &extents_count, 1);
+		int comp_buf_size = 0;
+		for (int j = 0; j < test_data_size; j++) {
+			hash_value_t val = rand() % test_data_mod;
+			hash_t h = hash(val);
+			if (swiss_find(&ht, h, val) == swiss_end)
+				swiss_insert(&ht, h, val);
+		}
+		struct swiss_iterator iterator;
+		swiss_iterator_begin(&ht, &iterator);
+		hash_value_t *e;
+		while ((e = swiss_iterator_get_and_next(&ht, &iterator))) {
+			comp_buf[comp_buf_size++] = *e;
+		}
+		struct swiss_iterator iterator1;
+		swiss_iterator_begin(&ht, &iterator1);
+		swiss_iterator_freeze(&ht, &iterator1);
+		struct swiss_iterator iterator2;
+		swiss_iterator_begin(&ht, &iterator2);
+		swiss_iterator_freeze(&ht, &iterator2);
+		/* Enough to make the table grow. */
+		for (int j = 0; j < 2 * test_data_size; j++) {
+			hash_value_t val = test_data_mod + j;
+			swiss_insert(&ht, hash(val), val);
+		}
+		int tested_count = 0;
+		while ((e = swiss_iterator_get_and_next(&ht, &iterator1))) {
+			if (*e != comp_buf[tested_count]) {
+				fail("version restore failed (1)", "true");
+			}
+			tested_count++;
+			if (tested_count > comp_buf_size) {
+				fail("version restore failed (2)", "true");
+			}
+		}
+		swiss_iterator_destroy(&ht, &iterator1);
+		for (int j = 0; j < test_data_size; j++) {
+			hash_value_t val = rand() % test_data_mod;
+			hash_t h = hash(val);
+			hash_t pos = swiss_find(&ht, h, val);
+			if (pos != swiss_end)
+				swiss_delete(&ht, h, pos);
+		}
+
+		tested_count = 0;
+		while ((e = swiss_iterator_get_and_next(&ht, &iterator2))) {
+			if (*e != comp_buf[tested_count]) {
+				fail("version restore failed (3)", "true");
+			}
+			tested_count++;
+			if (tested_count > comp_buf_size) {
+				fail("version restore failed (4)", "true");
+			}
+		}
+		swiss_iterator_destroy(&ht, &iterator2);
+
+		if (swiss_selfcheck(&ht) != 0)
+			fail("internal test failed!", "true");
+		swiss_destroy(&ht);
+	}
+
+	footer();
+}
+
+int
+main(int, const char**)
+{
+	srand(time(0));
+	simple_test();
+	collision_test();
+	grow_test();
+	iterator_test();
+	iterator_freeze_check();
+	if (extents_count != 0)
+		fail("memory leak!", "true");
+}
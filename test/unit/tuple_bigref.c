@@ -135,11 +135,48 @@ test_bigrefs_non_consistent()
 	check_plan();
 }
 
+/**
+ * This test checks that a big reference counter is kept
+ * while the tuple reference counter hovers around
+ * TUPLE_REF_MAX and is released when it drops well below.
+ */
+static void
+test_bigrefs_hysteresis()
+{
+	header();
+	plan(3);
+	struct tuple *tuple = create_tuple();
+	for (int i = 1; i <= TUPLE_REF_MAX; ++i)
+		tuple_ref(tuple);
+	bool is_bigref = tuple->is_bigref;
+	uint16_t index = tuple->ref_index;
+	for (int i = 0; i < 100; ++i) {
+		tuple_unref(tuple);
+		is_bigref = is_bigref && tuple->is_bigref;
+		tuple_ref(tuple);
+		is_bigref = is_bigref && tuple->is_bigref &&
+			    tuple->ref_index == index;
+	}
+	ok(is_bigref, "Bigref is kept around TUPLE_REF_MAX.");
+	for (int i = 0; i <= TUPLE_REF_MAX / 2; ++i)
+		tuple_unref(tuple);
+	ok(tuple->is_bigref, "Bigref is kept above the threshold.");
+	int refs = TUPLE_REF_MAX - TUPLE_REF_MAX / 2;
+	tuple_unref(tuple);
+	--refs;
+	ok(!tuple->is_bigref && tuple->refs == refs,
+	   "Bigref is released at the threshold.");
+	while (refs-- > 0)
+		tuple_unref(tuple);
+	footer();
+	check_plan();
+}
+
 int
 main()
 {
 	header();
-	plan(2);
+	plan(3);
 
 	memory_init();
 	fiber_init(fiber_c_invoke);
@@ -150,6 +187,7 @@ main()
 
 	test_bigrefs_overall();
 	test_bigrefs_non_consistent();
+	test_bigrefs_hysteresis();
 
 	tuple_free();
 	fiber_free();
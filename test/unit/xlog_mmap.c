@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "crc32.h"
+#include "fiber.h"
+#include "memory.h"
+#include "unit.h"
+#include "tt_uuid.h"
+#include "iproto_constants.h"
+#include "xlog.h"
+#include "xrow.h"
+
+enum { ROW_COUNT = 1000 };
+
+/**
+ * Read all rows from a cursor and check that their LSNs go
+ * from 1 to ROW_COUNT. Returns the number of rows read.
+ */
+static int
+read_rows(struct xlog_cursor *cursor, bool *is_ordered)
+{
+	struct xrow_header row;
+	int count = 0;
+	*is_ordered = true;
+	while (xlog_cursor_next(cursor, &row, false) == 0) {
+		if (row.lsn != ++count)
+			*is_ordered = false;
+	}
+	return count;
+}
+
+static void
+test_mmap(const char *dir)
+{
+	header();
+	plan(8);
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/00000000000000000000.xlog", dir);
+	struct tt_uuid uuid;
+	tt_uuid_create(&uuid);
+	struct xlog_meta meta;
+	xlog_meta_create(&meta, "XLOG", &uuid, NULL, NULL);
+	struct xlog xlog;
+	if (xlog_create(&xlog, path, 0, &meta, &xlog_opts_default) != 0)
+		fail("xlog_create", "-1");
+
+	struct xrow_header row;
+	memset(&row, 0, sizeof(row));
+	row.type = IPROTO_NOP;
+	row.replica_id = 1;
+	for (int i = 1; i <= ROW_COUNT; i++) {
+		row.lsn = i;
+		if (xlog_write_row(&xlog, &row) < 0)
+			fail("xlog_write_row", "-1");
+	}
+	if (xlog_flush(&xlog) < 0)
+		fail("xlog_flush", "-1");
+
+	/* A file being written isn't mapped. */
+	bool is_ordered;
+	struct xlog_cursor cursor;
+	is(xlog_cursor_open_mmap(&cursor, xlog.filename), 0,
+	   "open incomplete file");
+	ok(cursor.map == NULL, "incomplete file isn't mapped");
+	is(read_rows(&cursor, &is_ordered), ROW_COUNT,
+	   "incomplete file rows");
+	xlog_cursor_close(&cursor, false);
+
+	char filename[PATH_MAX];
+	snprintf(filename, sizeof(filename), "%s", xlog.filename);
+	if (xlog_close(&xlog, false) != 0)
+		fail("xlog_close", "-1");
+
+	/* A complete file is mapped. */
+	is(xlog_cursor_open_mmap(&cursor, filename), 0,
+	   "open complete file");
+	ok(cursor.map != NULL, "complete file is mapped");
+	is(read_rows(&cursor, &is_ordered), ROW_COUNT,
+	   "complete file rows");
+	ok(is_ordered, "complete file rows order");
+	ok(xlog_cursor_is_eof(&cursor), "complete file eof");
+	xlog_cursor_close(&cursor, false);
+
+	unlink(filename);
+
+	check_plan();
+	footer();
+}
+
+int
+main()
+{
+	plan(1);
+
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	crc32_init();
+
+	char dir[] = "./xlog_mmap.XXXXXX";
+	if (mkdtemp(dir) == NULL)
+		fail("mkdtemp", "NULL");
+
+	test_mmap(dir);
+
+	rmdir(dir);
+
+	fiber_free();
+	memory_free();
+
+	return check_plan();
+}
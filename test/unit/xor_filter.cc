@@ -0,0 +1,132 @@
+#include "salad/xor_filter.h"
+#include <unordered_set>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+uint32_t h(uint32_t i)
+{
+	return i * 2654435761;
+}
+
+void
+simple_test()
+{
+	cout << "*** " << __func__ << " ***" << endl;
+	srand(time(0));
+	uint32_t error_count = 0;
+	uint32_t fp_rate_too_big = 0;
+	for (double p = 0.001; p < 0.5; p *= 1.3) {
+		uint64_t tests = 0;
+		uint64_t false_positive = 0;
+		for (uint32_t count = 1000; count <= 10000; count *= 2) {
+			unordered_set<uint32_t> check;
+			vector<uint32_t> hashes;
+			for (uint32_t i = 0; i < count; i++) {
+				uint32_t val = rand() % (count * 10);
+				check.insert(val);
+				hashes.push_back(h(val));
+			}
+			struct xor_filter filter;
+			xor_filter_create(&filter, hashes.data(),
+					  hashes.size(), p);
+			for (uint32_t i = 0; i < count * 10; i++) {
+				bool has = check.find(i) != check.end();
+				bool filter_possible =
+					xor_filter_maybe_has(&filter, h(i));
+				tests++;
+				if (has && !filter_possible)
+					error_count++;
+				if (!has && filter_possible)
+					false_positive++;
+			}
+			xor_filter_destroy(&filter);
+		}
+		double fp_rate = (double)false_positive / tests;
+		if (fp_rate > p + 0.001)
+			fp_rate_too_big++;
+	}
+	cout << "error_count = " << error_count << endl;
+	cout << "fp_rate_too_big = " << fp_rate_too_big << endl;
+}
+
+void
+store_load_test()
+{
+	cout << "*** " << __func__ << " ***" << endl;
+	srand(time(0));
+	uint32_t error_count = 0;
+	uint32_t fp_rate_too_big = 0;
+	for (double p = 0.01; p < 0.5; p *= 1.5) {
+		uint64_t tests = 0;
+		uint64_t false_positive = 0;
+		for (uint32_t count = 300; count <= 3000; count *= 10) {
+			unordered_set<uint32_t> check;
+			vector<uint32_t> hashes;
+			for (uint32_t i = 0; i < count; i++) {
+				uint32_t val = rand() % (count * 10);
+				check.insert(val);
+				hashes.push_back(h(val));
+			}
+			struct xor_filter filter;
+			xor_filter_create(&filter, hashes.data(),
+					  hashes.size(), p);
+			struct xor_filter test = filter;
+			char *buf = (char *)malloc(
+				xor_filter_store_size(&filter));
+			xor_filter_store(&filter, buf);
+			xor_filter_destroy(&filter);
+			memset(&filter, '#', sizeof(filter));
+			xor_filter_load_table(&test, buf);
+			free(buf);
+			for (uint32_t i = 0; i < count * 10; i++) {
+				bool has = check.find(i) != check.end();
+				bool filter_possible =
+					xor_filter_maybe_has(&test, h(i));
+				tests++;
+				if (has && !filter_possible)
+					error_count++;
+				if (!has && filter_possible)
+					false_positive++;
+			}
+			xor_filter_destroy(&test);
+		}
+		double fp_rate = (double)false_positive / tests;
+		if (fp_rate > p + 0.001)
+			fp_rate_too_big++;
+	}
+	cout << "error_count = " << error_count << endl;
+	cout << "fp_rate_too_big = " << fp_rate_too_big << endl;
+}
+
+void
+size_test()
+{
+	cout << "*** " << __func__ << " ***" << endl;
+	uint32_t too_big = 0;
+	for (double p = 0.001; p < 0.5; p *= 1.3) {
+		uint32_t count = 10000;
+		vector<uint32_t> hashes;
+		for (uint32_t i = 0; i < count; i++)
+			hashes.push_back(h(i));
+		struct xor_filter filter;
+		xor_filter_create(&filter, hashes.data(), hashes.size(), p);
+		/* 1.23 * log2(1 / fpr) bits per value plus rounding. */
+		double bits = 1.23 * ceil(-log2(p)) * count + 64 * 16;
+		if (xor_filter_store_size(&filter) * 8 > bits)
+			too_big++;
+		xor_filter_destroy(&filter);
+	}
+	cout << "too_big = " << too_big << endl;
+}
+
+int
+main(void)
+{
+	simple_test();
+	store_load_test();
+	size_test();
+}
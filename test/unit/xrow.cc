@@ -204,7 +204,7 @@ test_greeting()
 void
 test_xrow_header_encode_decode()
 {
-	plan(10);
+	plan(11);
 	struct xrow_header header;
 	char buffer[2048];
 	char *pos = mp_encode_uint(buffer, 300);
@@ -239,6 +239,12 @@ test_xrow_header_encode_decode()
 	is(decoded_header.sync, sync, "decoded sync");
 	is(decoded_header.bodycnt, 0, "decoded bodycnt");
 
+	char buf[XROW_HEADER_LEN_MAX];
+	char *buf_end = xrow_header_encode_buf(&header, sync, buf);
+	ok(buf_end - buf == (ptrdiff_t)vec[0].iov_len - fixheader_len &&
+	   memcmp(buf, (char *)vec[0].iov_base + fixheader_len,
+		  buf_end - buf) == 0, "encode to buffer");
+
 	check_plan();
 }
 
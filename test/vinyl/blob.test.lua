@@ -0,0 +1,38 @@
+test_run = require('test_run').new()
+fio = require('fio')
+--
+-- vinyl_blob_threshold: large statements of the primary index
+-- are stored in separate blob files, runs keep only references.
+--
+box.cfg{vinyl_blob_threshold = -1}
+box.cfg{vinyl_blob_threshold = 1000}
+box.cfg.vinyl_blob_threshold
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {run_count_per_level = 10})
+_ = s:create_index('sk', {parts = {2, 'unsigned'}})
+function value(i, n) return string.rep(tostring(i), n) end
+function dump(n) for i = 1, 50 do s:replace{i, i, value(i, i % 2 == 0 and 1000 or 10)} end for i = 1, 25 do s:replace{i, i + 100, value(i + n, 1000)} end box.snapshot() end
+function compact() s.index.pk:compact() test_run:wait_cond(function() return s.index.pk:stat().run_count == 1 end) end
+function check(n) local ok = true for _, t in s:pairs() do local i = t[1] ok = ok and t[3] == (i <= 25 and value(i + n, 1000) or value(i, i % 2 == 0 and 1000 or 10)) end return ok end
+function blob_count() return #fio.glob(fio.pathjoin(box.cfg.vinyl_dir, s.id, 0, '*.blob')) end
+dump(1)
+blob_count() > 0
+s:count()
+check(1)
+s.index.sk:get(110)[3] == value(11, 1000)
+dump(2)
+compact()
+s:count()
+check(2)
+s.index.pk:get(50)[3] == value(50, 1000)
+-- Blob files are preserved after restart.
+test_run:cmd('restart server default')
+test_run = require('test_run').new()
+s = box.space.test
+function value(i, n) return string.rep(tostring(i), n) end
+function check(n) local ok = true for _, t in s:pairs() do local i = t[1] ok = ok and t[3] == (i <= 25 and value(i + n, 1000) or value(i, i % 2 == 0 and 1000 or 10)) end return ok end
+box.cfg.vinyl_blob_threshold
+s:count()
+check(2)
+s.index.sk:select({125}, {iterator = 'le', limit = 1})[1][3] == value(27, 1000)
+s:drop()
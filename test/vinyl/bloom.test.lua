@@ -88,6 +88,9 @@ box.cfg{vinyl_cache = 0}
 
 s = box.space.test
 
+-- Bloom filters are loaded in the background after restart.
+test_run:wait_cond(function() return s.index.pk:stat().disk.bloom_size > 0 end)
+
 reflects = 0
 function cur_reflects() return box.space.test.index.pk:stat().disk.iterator.bloom.hit end
 function new_reflects() local o = reflects reflects = cur_reflects() return reflects - o end
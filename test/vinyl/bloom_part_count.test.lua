@@ -0,0 +1,51 @@
+test_run = require('test_run').new()
+--
+-- bloom_part_count index option makes vinyl build a bloom filter
+-- only for the given number of leading key parts.
+--
+-- Disable tuple cache to check bloom hit/miss ratio.
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+s1 = box.schema.space.create('test1', {engine = 'vinyl'})
+_ = s1:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned', 3, 'unsigned'}})
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned', 3, 'unsigned'}, bloom_part_count = 1})
+s1.index.pk.options.bloom_part_count
+s2.index.pk.options.bloom_part_count
+for i = 1, 200, 2 do s1:insert{i, i, i} s2:insert{i, i, i} end
+box.snapshot()
+-- The filter over a key prefix is smaller.
+s2.index.pk:stat().disk.bloom_size < s1.index.pk:stat().disk.bloom_size
+-- Lookups of missing prefixes are filtered out.
+for i = 2, 200, 2 do assert(#s2:select{i} == 0) end
+s2.index.pk:stat().disk.iterator.bloom.hit > 80
+-- Lookups by longer keys check only the prefix.
+for i = 2, 200, 2 do assert(s2:get{i, i, i} == nil) end
+s2.index.pk:stat().disk.iterator.bloom.hit > 160
+found = 0
+for i = 1, 200, 2 do found = found + #s2:select{i, i} end
+found
+found = 0
+for i = 1, 200, 2 do if s2:get{i, i + 1, i} == nil then found = found + 1 end end
+found
+-- The filters are recovered from index files.
+test_run:cmd('restart server default')
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+s1 = box.space.test1
+s2 = box.space.test2
+test_run:wait_cond(function() return s1.index.pk:stat().disk.bloom_size > 0 and s2.index.pk:stat().disk.bloom_size > 0 end)
+s2.index.pk:stat().disk.bloom_size < s1.index.pk:stat().disk.bloom_size
+for i = 2, 200, 2 do assert(#s2:select{i} == 0) end
+s2.index.pk:stat().disk.iterator.bloom.hit > 80
+#s2:select()
+-- The option can be changed, new runs use it.
+s2.index.pk:alter{bloom_part_count = 0}
+s2.index.pk.options.bloom_part_count
+s2:replace{1000, 1000, 1000}
+box.snapshot()
+for i = 2, 200, 2 do assert(s2:get{i, i, i} == nil) end
+#s2:select()
+s1:drop()
+s2:drop()
+box.cfg{vinyl_cache = vinyl_cache}
@@ -0,0 +1,46 @@
+test_run = require('test_run').new()
+--
+-- bloom_per_page index option makes vinyl build a bloom filter
+-- per each run page instead of one filter per run.
+--
+-- Disable tuple cache to check bloom hit/miss ratio.
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned'}, page_size = 256, bloom_per_page = true})
+s.index.pk.options.bloom_per_page
+for i = 1, 200, 2 do s:insert{i, i} end
+box.snapshot()
+stat = s.index.pk:stat()
+stat.disk.pages > 1
+stat.disk.bloom_size > 0
+-- Lookups of missing keys are filtered out by page filters.
+for i = 2, 200, 2 do assert(s:get{i, i} == nil) end
+stat = s.index.pk:stat()
+stat.disk.iterator.bloom.hit > 80
+stat.disk.iterator.read.pages < 20
+-- Lookups of existing keys by full and partial key.
+found = 0
+for i = 1, 200, 2 do if s:get{i, i} ~= nil then found = found + 1 end end
+found
+found = 0
+for i = 1, 200 do found = found + #s:select{i} end
+found
+-- The filters are recovered from index files.
+test_run:cmd('restart server default')
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+s = box.space.test
+s.index.pk:stat().disk.bloom_size > 0
+for i = 2, 200, 2 do assert(s:get{i, i} == nil) end
+s.index.pk:stat().disk.iterator.bloom.hit > 80
+#s:select()
+-- The option can be changed, new runs use it.
+s.index.pk:alter{bloom_per_page = false}
+s.index.pk.options.bloom_per_page
+s:replace{1000, 1000}
+box.snapshot()
+for i = 2, 200, 2 do assert(s:get{i, i} == nil) end
+#s:select()
+s:drop()
+box.cfg{vinyl_cache = vinyl_cache}
@@ -0,0 +1,56 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+--
+-- bloom_type index option selects the filter vinyl builds
+-- for runs: a classic bloom filter or a smaller xor filter.
+--
+-- Disable tuple cache to check bloom hit/miss ratio.
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {bloom_type = 'cuckoo'})
+_ = s:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned'}, bloom_type = 'xor'})
+_ = s:create_index('sk', {parts = {2, 'unsigned', 1, 'unsigned'}})
+s.index.pk.options.bloom_type
+s.index.sk.options.bloom_type
+for i = 1, 1000, 2 do s:insert{i, i} end
+box.snapshot()
+gst = box.stat.vinyl()
+gst.memory.xor_filter == s.index.pk:stat().disk.bloom_size
+gst.memory.bloom_filter == s.index.sk:stat().disk.bloom_size
+-- A xor filter is smaller than a bloom filter with the same fpr.
+s.index.pk:stat().disk.bloom_size < s.index.sk:stat().disk.bloom_size
+-- Lookups of missing keys by full and partial key are filtered out.
+for i = 2, 1000, 2 do assert(s:get{i, i} == nil) end
+for i = 2, 1000, 2 do assert(#s:select{i} == 0) end
+s.index.pk:stat().disk.iterator.bloom.hit > 900
+-- Lookups of existing keys by full and partial key.
+found = 0
+for i = 1, 1000, 2 do if s:get{i, i} ~= nil then found = found + 1 end end
+found
+found = 0
+for i = 1, 1000 do found = found + #s:select{i} end
+found
+-- The filters are recovered from index files.
+test_run:cmd('restart server default')
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+fiber = require('fiber')
+s = box.space.test
+test_run:wait_cond(function() return s.index.pk:stat().disk.bloom_size > 0 end)
+gst = box.stat.vinyl()
+gst.memory.xor_filter == s.index.pk:stat().disk.bloom_size
+for i = 2, 1000, 2 do assert(s:get{i, i} == nil) end
+s.index.pk:stat().disk.iterator.bloom.hit > 450
+#s:select()
+-- The option can be changed, new runs use it.
+s.index.pk:alter{bloom_type = 'bloom'}
+s.index.pk.options.bloom_type
+s:replace{1000, 1000}
+box.snapshot()
+s.index.pk:compact()
+while s.index.pk:stat().disk.compaction.count == 0 do fiber.sleep(0.01) end
+box.stat.vinyl().memory.xor_filter
+#s:select()
+s:drop()
+box.cfg{vinyl_cache = vinyl_cache}
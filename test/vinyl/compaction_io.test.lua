@@ -0,0 +1,33 @@
+test_run = require('test_run').new()
+--
+-- vinyl_compaction_direct_io and vinyl_compaction_readahead
+-- control how compaction reads runs.
+--
+box.cfg{vinyl_compaction_readahead = -1}
+box.cfg{vinyl_compaction_direct_io = true, vinyl_compaction_readahead = 64 * 1024}
+box.cfg.vinyl_compaction_direct_io
+box.cfg.vinyl_compaction_readahead
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {page_size = 1000, run_count_per_level = 10})
+function dump(n) for i = 1, 100 do s:replace{i * n, string.rep(tostring(i * n), 10)} end box.snapshot() end
+function compact() s.index.pk:compact() test_run:wait_cond(function() return s.index.pk:stat().run_count == 1 end) end
+function check() local ok = true for _, t in s:pairs() do ok = ok and t[2] == string.rep(tostring(t[1]), 10) end return ok end
+-- Direct I/O with read-ahead.
+for n = 1, 3 do dump(n) end
+compact()
+s:count()
+check()
+-- Read-ahead via the OS page cache.
+box.cfg{vinyl_compaction_direct_io = false}
+for n = 1000, 2000, 1000 do dump(n) end
+compact()
+s:count()
+check()
+-- Direct I/O without read-ahead.
+box.cfg{vinyl_compaction_direct_io = true, vinyl_compaction_readahead = 0}
+dump(3000)
+compact()
+s:count()
+check()
+s:drop()
+box.cfg{vinyl_compaction_direct_io = false}
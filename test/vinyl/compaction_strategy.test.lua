@@ -0,0 +1,42 @@
+test_run = require('test_run').new()
+digest = require('digest')
+--
+-- compaction_strategy index option selects the policy vinyl
+-- uses to choose runs for compaction.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {compaction_strategy = 'universal'})
+_ = s:create_index('pk')
+s.index.pk.options.compaction_strategy
+s.index.pk:alter{compaction_strategy = 'tiered'}
+s.index.pk.options.compaction_strategy
+s.index.pk:alter{compaction_strategy = 'leveled'}
+s.index.pk.options.compaction_strategy
+s:drop()
+--
+-- Size-tiered compaction rewrites data less often than leveled.
+--
+s1 = box.schema.space.create('test1', {engine = 'vinyl'})
+_ = s1:create_index('pk')
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('pk', {compaction_strategy = 'tiered'})
+s2.index.pk.options.compaction_strategy
+test_run:cmd("setopt delimiter ';'")
+function dump(n)
+    for i = n * 10 + 1, n * 10 + 10 do
+        s1:replace{i, digest.urandom(1000)}
+        s2:replace{i, digest.urandom(1000)}
+    end
+    box.snapshot()
+    test_run:wait_cond(function()
+        local stat = box.stat.vinyl().scheduler
+        return stat.compaction_queue == 0 and stat.tasks_inprogress == 0
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+for n = 1, 12 do dump(n) end
+s1:count()
+s2:count()
+s2.index.pk:stat().disk.compaction.output.bytes < s1.index.pk:stat().disk.compaction.output.bytes
+s1:drop()
+s2:drop()
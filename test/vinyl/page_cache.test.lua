@@ -0,0 +1,46 @@
+test_run = require('test_run').new()
+--
+-- box.cfg.vinyl_page_cache: decompressed run pages are cached
+-- and shared by all reads.
+--
+vinyl_cache = box.cfg.vinyl_cache
+-- Disable tuple cache to make reads go to disk.
+box.cfg{vinyl_cache = 0}
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {page_size = 1024, range_size = 1024 * 1024})
+pad = string.rep('x', 100)
+for i = 1, 100 do s:replace{i, pad} end
+box.snapshot()
+function read_pages() return s.index.pk:stat().disk.iterator.read.pages end
+-- The page cache is disabled by default.
+box.cfg.vinyl_page_cache
+pages = read_pages()
+s:get{1} ~= nil
+s:get{1} ~= nil
+read_pages() - pages -- 2
+box.cfg{vinyl_page_cache = 1024 * 1024}
+pages = read_pages()
+s:get{1} ~= nil
+read_pages() - pages -- 1
+pages = read_pages()
+for i = 1, 5 do s:get{1} end
+read_pages() - pages -- 0
+s:select({}, {limit = 1})[1][1]
+read_pages() - pages -- 0
+-- Disabling the cache frees cached pages.
+box.cfg{vinyl_page_cache = 0}
+pages = read_pages()
+s:get{1} ~= nil
+read_pages() - pages -- 1
+-- Pages are dropped from the cache with their runs.
+box.cfg{vinyl_page_cache = 1024 * 1024}
+s:get{1} ~= nil
+s.index.pk:compact()
+test_run:wait_cond(function() return s.index.pk:stat().disk.compaction.count > 0 end)
+pages = read_pages()
+s:get{1} ~= nil
+read_pages() - pages -- 1
+#s:select()
+s:drop()
+box.cfg{vinyl_page_cache = 0}
+box.cfg{vinyl_cache = vinyl_cache}
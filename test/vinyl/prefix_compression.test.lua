@@ -0,0 +1,55 @@
+test_run = require('test_run').new()
+--
+-- prefix_compression index option makes vinyl store only the
+-- part of a statement that differs from the previous statement
+-- in a run page.
+--
+-- Disable tuple cache to make lookups read pages.
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+s1 = box.schema.space.create('test1', {engine = 'vinyl'})
+_ = s1:create_index('pk', {parts = {1, 'string'}})
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('pk', {parts = {1, 'string'}, prefix_compression = true})
+_ = s2:create_index('sk', {parts = {2, 'string'}, unique = false, prefix_compression = true})
+s1.index.pk.options.prefix_compression
+s2.index.pk.options.prefix_compression
+prefix = string.rep('x', 50)
+function key(i) return prefix .. string.format('%05d', i) end
+for i = 1, 1000 do s1:insert{key(i), 'group' .. i % 10} s2:insert{key(i), 'group' .. i % 10} end
+box.snapshot()
+-- Pages hold more statements.
+s2.index.pk:stat().disk.bytes < s1.index.pk:stat().disk.bytes / 2
+s2.index.pk:stat().disk.pages < s1.index.pk:stat().disk.pages
+-- Lookups and scans restore statements.
+found = 0
+for i = 1, 1000 do if s2:get{key(i)} ~= nil then found = found + 1 end end
+found
+s2:get{key(1000)}
+s2:get{key(1001)}
+#s2:select({key(500)}, {iterator = 'GE'})
+#s2:select({key(500)}, {iterator = 'LT'})
+s2:select({key(17)}, {iterator = 'GT', limit = 2})
+s2.index.sk:count('group3')
+-- Pages are recovered from run files.
+test_run:cmd('restart server default')
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+prefix = string.rep('x', 50)
+function key(i) return prefix .. string.format('%05d', i) end
+s2 = box.space.test2
+#s2:select()
+s2.index.sk:count('group3')
+-- The option can be changed, new runs use it.
+for i = 1, 1000, 3 do s2:delete{key(i)} end
+box.snapshot()
+s2.index.pk:alter{prefix_compression = false}
+s2.index.pk.options.prefix_compression
+s2.index.pk:compact()
+test_run:wait_cond(function() return s2.index.pk:stat().run_count == 1 end)
+#s2:select()
+s2:get{key(2)}
+s2:get{key(4)}
+box.space.test1:drop()
+s2:drop()
+box.cfg{vinyl_cache = vinyl_cache}
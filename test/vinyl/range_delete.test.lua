@@ -0,0 +1,54 @@
+test_run = require('test_run').new()
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+pk = s:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned'}})
+
+-- Keys stored on disk, in memory and in both.
+for i = 1, 10 do s:replace{i, 1} end
+box.snapshot()
+for i = 1, 10, 2 do s:replace{i, 2} end
+
+-- The begin key is inclusive, the end key is exclusive,
+-- both are compared by prefix.
+s:delete_range({3}, {6})
+s:select()
+s:get{4, 1}
+s:count()
+
+-- Omitted keys stand for infinity.
+s:delete_range(nil, 2)
+s:delete_range(9)
+s:select()
+
+-- New statements aren't affected.
+s:insert{4, 1}
+s:select()
+
+-- Deleted keys don't reappear after dump and restart.
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+s:select()
+
+-- Compaction purges deleted statements.
+s.index.pk:compact()
+test_run:wait_cond(function() return s.index.pk:stat().disk.compaction.queue.rows == 0 end)
+s:select()
+
+-- Unsupported cases.
+box.begin() s:replace{100, 1} ok, err = pcall(s.delete_range, s, {1}, {2}) box.rollback()
+tostring(err)
+box.begin() s:delete_range({1}, {2}) ok, err = pcall(s.replace, s, {100, 1}) box.rollback()
+tostring(err)
+sk = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+s:delete_range({1}, {2})
+sk:delete_range({1}, {2})
+sk:drop()
+s.index.pk:delete_range({'a'}, {2})
+
+m = box.schema.space.create('test_memtx')
+_ = m:create_index('pk')
+m:delete_range({1}, {2})
+m:drop()
+
+s:drop()
@@ -92,6 +92,10 @@ function gstat()
     st.regulator = nil
     st.scheduler.dump_time = nil
     st.scheduler.compaction_time = nil
+    -- Conflict check counters depend on read set filter collisions.
+    st.tx.conflict_check = nil
+    st.tx.conflict_check_skip = nil
+    st.tx.conflict_check_visit = nil
     return st
 end;
 
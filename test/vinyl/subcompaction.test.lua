@@ -0,0 +1,74 @@
+test_run = require('test_run').new()
+--
+-- vinyl_max_subcompactions makes vinyl split compaction of a range
+-- into key sub-ranges compacted in parallel threads. The pages
+-- they write are merged into a single run.
+--
+box.cfg{vinyl_max_subcompactions = 0}
+box.cfg.vinyl_max_subcompactions
+max_subcompactions = box.cfg.vinyl_max_subcompactions
+box.cfg{vinyl_max_subcompactions = 4}
+box.cfg.vinyl_max_subcompactions
+opts = {run_count_per_level = 100, page_size = 128, range_size = 1024 * 1024}
+s1 = box.schema.space.create('test1', {engine = 'vinyl'})
+_ = s1:create_index('pk', opts)
+-- Primary index compaction of a space with secondary indexes
+-- isn't split, because it generates deferred DELETEs.
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('pk', opts)
+opts.parts = {2, 'unsigned'}
+opts.unique = false
+_ = s2:create_index('sk', opts)
+pad = string.rep('x', 50)
+for i = 1, 1000 do s1:replace{i, i % 100, pad} s2:replace{i, i % 100, pad} end
+box.snapshot()
+for i = 1, 1000, 3 do s1:delete{i} s2:delete{i} end
+for i = 2, 1000, 3 do s1:update(i, {{'+', 2, 1}}) s2:update(i, {{'+', 2, 1}}) end
+box.snapshot()
+-- Check that an index is sorted and contains all expected tuples.
+test_run:cmd("setopt delimiter ';'")
+function compact(index)
+    index:compact()
+    test_run:wait_cond(function() return index:stat().run_count == 1 end)
+end;
+function less(a, b, fields)
+    for _, f in ipairs(fields) do
+        if a[f] ~= b[f] then
+            return a[f] < b[f]
+        end
+    end
+    return false
+end;
+function check(index, fields)
+    local count = 0
+    local prev = nil
+    for _, t in index:pairs() do
+        local i = t[1]
+        if i % 3 == 1 or t[2] ~= i % 100 + (i % 3 == 2 and 1 or 0) or
+                (prev ~= nil and not less(prev, t, fields)) then
+            return false
+        end
+        prev = t
+        count = count + 1
+    end
+    return count == 666
+end;
+test_run:cmd("setopt delimiter ''");
+compact(s1.index.pk)
+s1.index.pk:stat().disk.pages > 4
+test_run:grep_log('default', 'started compacting range .*, threads 4') ~= nil
+check(s1.index.pk, {1})
+compact(s2.index.pk)
+box.snapshot()
+compact(s2.index.sk)
+check(s2.index.pk, {1})
+check(s2.index.sk, {2, 1})
+-- The option can be changed dynamically.
+box.cfg{vinyl_max_subcompactions = 1}
+for i = 1, 1000, 3 do s1:replace{i, i % 100, pad} end
+box.snapshot()
+compact(s1.index.pk)
+s1:count()
+s1:drop()
+s2:drop()
+box.cfg{vinyl_max_subcompactions = max_subcompactions}
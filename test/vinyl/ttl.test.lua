@@ -0,0 +1,46 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+fun = require('fun')
+--
+-- ttl index option makes dump and compaction discard tuples
+-- whose time stored in ttl_field is older than ttl seconds.
+--
+format = {{'id', 'unsigned'}, {'time', 'number'}, {'data', 'string'}}
+s = box.schema.space.create('test', {engine = 'vinyl', format = format})
+s:create_index('pk', {ttl = -1})
+s:create_index('pk', {ttl = 10, ttl_field = 'time.x'})
+pk = s:create_index('pk', {ttl = 10, ttl_field = 'time', run_count_per_level = 10})
+pk.options.ttl
+pk.options.ttl_field
+s:create_index('sk', {parts = {3, 'string'}, ttl = 10, ttl_field = 2})
+sk = s:create_index('sk', {parts = {2, 'number'}, ttl = 10, ttl_field = 2, run_count_per_level = 10})
+sk.options.ttl_field
+function ids(index) return fun.iter(index:select()):map(function(t) return t.id end):totable() end
+-- Odd tuples are expired.
+now = fiber.time()
+for i = 1, 10 do s:replace{i, i % 2 == 1 and now - 100 - i or now + 1000 + i, 'x'} end
+-- The first dump writes the last level so it discards
+-- expired tuples.
+box.snapshot()
+pk:stat().disk.rows
+sk:stat().disk.rows
+ids(pk)
+ids(sk)
+-- Expired tuples are kept until they reach the last level.
+for i = 11, 15 do s:replace{i, now - 100 - i, 'x'} end
+box.snapshot()
+pk:stat().disk.rows
+sk:stat().disk.rows
+pk:compact()
+sk:compact()
+test_run:wait_cond(function() return pk:stat().run_count == 1 end)
+test_run:wait_cond(function() return sk:stat().run_count == 1 end)
+pk:stat().disk.rows
+sk:stat().disk.rows
+ids(pk)
+ids(sk)
+-- ttl = 0 disables expiration.
+pk:alter{ttl = 0}
+pk.options.ttl
+pk.options.ttl_field
+s:drop()
@@ -0,0 +1,29 @@
+test_run = require('test_run').new()
+--
+-- vinyl_upsert_squash_threshold sets the number of upserts for
+-- the same key which triggers background squashing.
+--
+box.cfg.vinyl_upsert_squash_threshold
+box.cfg{vinyl_upsert_squash_threshold = 0}
+box.cfg{vinyl_upsert_squash_threshold = 129}
+box.cfg{vinyl_upsert_squash_threshold = 10}
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+s:replace{1, 0}
+box.snapshot()
+
+gstat = box.stat.vinyl().upsert
+for i = 1, 10 do s:upsert({1, 0}, {{'+', 2, 1}}) end
+s.index.pk:stat().upsert.squashed
+s:upsert({1, 0}, {{'+', 2, 1}})
+test_run:wait_cond(function() return s.index.pk:stat().upsert.squashed == 1 end)
+box.stat.vinyl().upsert.squashed - gstat.squashed
+
+-- Reads don't apply squashed upserts.
+applied = box.stat.vinyl().upsert.applied_on_read
+s:get{1}
+box.stat.vinyl().upsert.applied_on_read - applied
+
+s:drop()
+box.cfg{vinyl_upsert_squash_threshold = 128}
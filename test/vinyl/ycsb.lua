@@ -0,0 +1,293 @@
+-- YCSB-like workloads for vinyl.
+--
+-- The module loads a space with fixed size records and runs the
+-- core YCSB workloads against it:
+--
+--   a  50% read, 50% update
+--   b  95% read, 5% update
+--   c  100% read
+--   d  95% read of the latest records, 5% insert
+--   e  95% short scan, 5% insert
+--   f  50% read, 50% read-modify-write
+--
+-- Keys are drawn from a scrambled zipfian (the default) or a
+-- uniform distribution. Every run reports throughput, per-operation
+-- latency percentiles and write/read amplification computed from
+-- box.stat.vinyl() and index:stat() deltas. Reports are written to
+-- the log and, if YCSB_REPORT is set, appended to that file as
+-- JSON lines, so that results of different builds can be compared.
+
+local fiber = require('fiber')
+local clock = require('clock')
+local json = require('json')
+local log = require('log')
+
+local ZIPFIAN_THETA = 0.99
+
+local workloads = {
+    a = {read = 50, update = 50},
+    b = {read = 95, update = 5},
+    c = {read = 100},
+    d = {read = 95, insert = 5, latest = true},
+    e = {scan = 95, insert = 5},
+    f = {read = 50, rmw = 50},
+}
+
+-- Zipfian generator over [0, n) as described in "Quickly
+-- Generating Billion-Record Synthetic Databases" by Gray et al.
+local function zipfian_new(n)
+    local zetan = 0
+    for i = 1, n do
+        zetan = zetan + 1 / math.pow(i, ZIPFIAN_THETA)
+    end
+    local zeta2 = 1 + 1 / math.pow(2, ZIPFIAN_THETA)
+    local alpha = 1 / (1 - ZIPFIAN_THETA)
+    local eta = (1 - math.pow(2 / n, 1 - ZIPFIAN_THETA)) /
+                (1 - zeta2 / zetan)
+    return function()
+        local u = math.random()
+        local uz = u * zetan
+        if uz < 1 then
+            return 0
+        end
+        if uz < 1 + math.pow(0.5, ZIPFIAN_THETA) then
+            return 1
+        end
+        return math.floor(n * math.pow(eta * u - eta + 1, alpha))
+    end
+end
+
+-- Spread popular keys over the whole key space so that they
+-- don't end up in the same range.
+local function scramble(key, n)
+    return (key * 2654435761) % n
+end
+
+local function key_generator(distribution, n)
+    if distribution == 'uniform' then
+        return function() return math.random(0, n - 1) end
+    end
+    assert(distribution == 'zipfian')
+    local zipfian = zipfian_new(n)
+    return function() return scramble(zipfian(), n) end
+end
+
+local function payload(size)
+    return string.rep('x', size)
+end
+
+--
+-- Create a vinyl space and fill it with @count records of
+-- @size bytes in batches.
+--
+local function load(count, size, opts)
+    opts = opts or {}
+    local space = box.schema.space.create('ycsb', {engine = 'vinyl'})
+    space:create_index('pk', {
+        run_count_per_level = opts.run_count_per_level,
+        run_size_ratio = opts.run_size_ratio,
+        bloom_fpr = opts.bloom_fpr,
+    })
+    local data = payload(size)
+    local batch = 1000
+    for first = 0, count - 1, batch do
+        box.begin()
+        for key = first, math.min(first + batch, count) - 1 do
+            space:replace({key, data})
+        end
+        box.commit()
+    end
+    box.snapshot()
+    return space:len()
+end
+
+local function percentile(samples, p)
+    if #samples == 0 then
+        return 0
+    end
+    return samples[math.max(1, math.ceil(#samples * p / 100))]
+end
+
+local function amplification(stat1, stat2, idx1, idx2)
+    local s1, s2 = stat1.scheduler, stat2.scheduler
+    local dump_input = s2.dump_input - s1.dump_input
+    local written = (s2.dump_output - s1.dump_output) +
+                    (s2.compaction_output - s1.compaction_output)
+    local lookups = idx2.lookup - idx1.lookup
+    local read = idx2.disk.iterator.read
+    local read_before = idx1.disk.iterator.read
+    return {
+        write = dump_input > 0 and written / dump_input or 0,
+        read = lookups > 0 and
+               (read.rows - read_before.rows) / lookups or 0,
+        read_bytes = read.bytes - read_before.bytes,
+        bloom_hit = idx2.disk.bloom.hit - idx1.disk.bloom.hit,
+        bloom_miss = idx2.disk.bloom.miss - idx1.disk.bloom.miss,
+    }
+end
+
+--
+-- Run workload @name ('a'..'f') against the space created by
+-- load(). Options:
+--
+--   ops           total number of operations (100000)
+--   fibers        number of concurrent fibers (8)
+--   distribution  'zipfian' or 'uniform' ('zipfian')
+--   size          record size used by updates and inserts (1000)
+--   scan_length   max number of records returned by a scan (100)
+--
+local function run(name, opts)
+    opts = opts or {}
+    local workload = workloads[name]
+    assert(workload ~= nil, 'unknown workload ' .. tostring(name))
+    local ops = opts.ops or 100000
+    local fibers = opts.fibers or 8
+    local distribution = opts.distribution or 'zipfian'
+    local scan_length = opts.scan_length or 100
+    local data = payload(opts.size or 1000)
+    local space = box.space.ycsb
+    local index = space.index.pk
+    local record_count = index:max()[1] + 1
+    local next_key = record_count
+    local keygen = key_generator(distribution, record_count)
+    local latest = zipfian_new(record_count)
+
+    local function next_read_key()
+        if workload.latest then
+            return math.max(0, next_key - 1 - latest())
+        end
+        return keygen()
+    end
+
+    local ops_by_type = {
+        read = function()
+            index:get({next_read_key()})
+        end,
+        update = function()
+            space:update({next_read_key()}, {{'=', 2, data}})
+        end,
+        insert = function()
+            local key = next_key
+            next_key = next_key + 1
+            space:insert({key, data})
+        end,
+        scan = function()
+            index:select({next_read_key()}, {iterator = 'GE',
+                          limit = math.random(scan_length)})
+        end,
+        rmw = function()
+            local key = next_read_key()
+            box.begin()
+            local tuple = index:get({key})
+            if tuple ~= nil then
+                space:replace({key, data})
+            end
+            box.commit()
+        end,
+    }
+
+    local mix = {}
+    for op, weight in pairs(workload) do
+        if ops_by_type[op] ~= nil then
+            table.insert(mix, {op = op, weight = weight})
+        end
+    end
+    table.sort(mix, function(a, b) return a.op < b.op end)
+
+    local latencies = {}
+    local errors = {}
+    for _, m in ipairs(mix) do
+        latencies[m.op] = {}
+        errors[m.op] = 0
+    end
+
+    local function pick()
+        local r = math.random(100)
+        for _, m in ipairs(mix) do
+            if r <= m.weight then
+                return m.op
+            end
+            r = r - m.weight
+        end
+        return mix[#mix].op
+    end
+
+    local stat_before = box.stat.vinyl()
+    local index_before = index:stat()
+    local remaining = ops
+    local function worker()
+        while remaining > 0 do
+            remaining = remaining - 1
+            local op = pick()
+            local start = clock.monotonic()
+            local ok = pcall(ops_by_type[op])
+            local samples = latencies[op]
+            samples[#samples + 1] = clock.monotonic() - start
+            if not ok then
+                errors[op] = errors[op] + 1
+                if box.is_in_txn() then
+                    box.rollback()
+                end
+            end
+        end
+    end
+
+    local start = clock.monotonic()
+    local workers = {}
+    for i = 1, fibers do
+        workers[i] = fiber.new(worker)
+        workers[i]:set_joinable(true)
+    end
+    for i = 1, fibers do
+        workers[i]:join()
+    end
+    local elapsed = clock.monotonic() - start
+
+    local report = {
+        workload = name,
+        distribution = distribution,
+        records = record_count,
+        ops = ops,
+        fibers = fibers,
+        time = elapsed,
+        throughput = ops / elapsed,
+        latency = {},
+        amplification = amplification(stat_before, box.stat.vinyl(),
+                                      index_before, index:stat()),
+    }
+    for op, samples in pairs(latencies) do
+        table.sort(samples)
+        report.latency[op] = {
+            count = #samples,
+            errors = errors[op],
+            p50 = percentile(samples, 50) * 1e6,
+            p95 = percentile(samples, 95) * 1e6,
+            p99 = percentile(samples, 99) * 1e6,
+            p999 = percentile(samples, 99.9) * 1e6,
+            max = percentile(samples, 100) * 1e6,
+        }
+    end
+
+    local line = json.encode(report)
+    log.info('ycsb: %s', line)
+    local path = os.getenv('YCSB_REPORT')
+    if path ~= nil then
+        local f = io.open(path, 'a')
+        if f ~= nil then
+            f:write(line, '\n')
+            f:close()
+        end
+    end
+    return report
+end
+
+local function teardown()
+    box.space.ycsb:drop()
+end
+
+return {
+    workloads = workloads,
+    load = load,
+    run = run,
+    teardown = teardown,
+}
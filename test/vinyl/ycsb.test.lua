@@ -0,0 +1,23 @@
+--
+-- YCSB-like workloads over a dataset that doesn't fit in
+-- memory. Throughput, latencies and amplification are
+-- reported to the log and to $YCSB_REPORT, see ycsb.lua.
+--
+test_run = require('test_run').new()
+test_run:cmd("create server ycsb with script='vinyl/low_quota.lua'")
+test_run:cmd("start server ycsb with args='67108864'")
+test_run:cmd('switch ycsb')
+box.cfg{vinyl_cache = 4 * 1024 * 1024}
+ycsb = require('ycsb')
+ycsb.load(200000, 1000)
+_ = ycsb.run('a')
+_ = ycsb.run('b')
+_ = ycsb.run('c')
+_ = ycsb.run('c', {distribution = 'uniform'})
+_ = ycsb.run('d')
+_ = ycsb.run('e', {ops = 20000})
+_ = ycsb.run('f')
+ycsb.teardown()
+test_run:cmd('switch default')
+test_run:cmd("stop server ycsb")
+test_run:cmd("cleanup server ycsb")
@@ -384,10 +384,10 @@ eio_warn_uninitialized()
   assert(0);
 }
 
-static struct etp_pool eio_pool;
+static struct etp_pool eio_pools[EIO_NUM_POOLS];
 static __thread struct etp_pool_user eio_pool_user;
 static struct etp_pool_user *eio_main_user;
-#define EIO_POOL (&eio_pool)
+#define EIO_POOL (&eio_pools[0])
 #define EIO_POOL_USER (ecb_expect_true(eio_pool_user.pool) ? \
   &eio_pool_user : \
   (eio_warn_uninitialized(), eio_main_user))
@@ -479,7 +479,8 @@ eio_cancel (eio_req *req)
 void
 eio_submit (eio_req *req)
 {
-  etp_submit (EIO_POOL_USER, req);
+  assert (req->pool < EIO_NUM_POOLS);
+  etp_submit_to (EIO_POOL_USER, &eio_pools[req->pool], req);
 }
 
 unsigned int
@@ -515,25 +516,29 @@ eio_set_max_poll_reqs (unsigned int maxreqs)
 void
 eio_set_thread_on_start(int (*on_start_cb)(void *), void *data)
 {
-  etp_set_thread_on_start(EIO_POOL, on_start_cb, data);
+  for (int i = 0; i < EIO_NUM_POOLS; ++i)
+    etp_set_thread_on_start(&eio_pools[i], on_start_cb, data);
 }
 
 void
 eio_set_thread_on_stop(int (*on_stop)(void *), void *data)
 {
-  etp_set_thread_on_stop(EIO_POOL, on_stop, data);
+  for (int i = 0; i < EIO_NUM_POOLS; ++i)
+    etp_set_thread_on_stop(&eio_pools[i], on_stop, data);
 }
 
 void ecb_cold
 eio_set_max_idle (unsigned int nthreads)
 {
-  etp_set_max_idle (EIO_POOL, nthreads);
+  for (int i = 0; i < EIO_NUM_POOLS; ++i)
+    etp_set_max_idle (&eio_pools[i], nthreads);
 }
 
 void ecb_cold
 eio_set_idle_timeout (unsigned int seconds)
 {
-  etp_set_idle_timeout (EIO_POOL, seconds);
+  for (int i = 0; i < EIO_NUM_POOLS; ++i)
+    etp_set_idle_timeout (&eio_pools[i], seconds);
 }
 
 void ecb_cold
@@ -548,6 +553,33 @@ eio_set_max_parallel (unsigned int nthreads)
   etp_set_max_parallel (EIO_POOL, nthreads);
 }
 
+void ecb_cold
+eio_set_pool_min_parallel (unsigned int pool, unsigned int nthreads)
+{
+  assert (pool < EIO_NUM_POOLS);
+  etp_set_min_parallel (&eio_pools[pool], nthreads);
+}
+
+void ecb_cold
+eio_set_pool_max_parallel (unsigned int pool, unsigned int nthreads)
+{
+  assert (pool < EIO_NUM_POOLS);
+  etp_set_max_parallel (&eio_pools[pool], nthreads);
+}
+
+void
+eio_pool_stat (unsigned int pool, unsigned int *nthreads,
+               unsigned int *nrunning, unsigned int *nqueued)
+{
+  assert (pool < EIO_NUM_POOLS);
+  etp_pool p = &eio_pools[pool];
+  X_LOCK (p->lock);
+  *nthreads = p->started;
+  *nrunning = p->nreqs_run;
+  *nqueued = p->req_queue.size;
+  X_UNLOCK (p->lock);
+}
+
 int eio_poll (void)
 {
   return etp_poll (EIO_POOL_USER);
@@ -1736,24 +1768,27 @@ eio__statvfsat (int dirfd, const char *path, struct statvfs *buf)
 
 /*****************************************************************************/
 
-static int eio_threads;
+static int eio_threads[EIO_NUM_POOLS];
 
 static void ecb_cold
 eio_prefork()
 {
-    eio_threads = etp_set_max_parallel(EIO_POOL, 0);
+    for (int i = 0; i < EIO_NUM_POOLS; ++i)
+      eio_threads[i] = etp_set_max_parallel(&eio_pools[i], 0);
 }
 
 static void ecb_cold
 eio_postfork()
 {
-    etp_set_min_parallel(EIO_POOL, eio_threads);
+    for (int i = 0; i < EIO_NUM_POOLS; ++i)
+      etp_set_min_parallel(&eio_pools[i], eio_threads[i]);
 }
 
 static void ecb_cold
 eio_init_once()
 {
-  etp_init (EIO_POOL);
+  for (int i = 0; i < EIO_NUM_POOLS; ++i)
+    etp_init (&eio_pools[i]);
   eio_main_user = &eio_pool_user;
   X_THREAD_ATFORK(eio_prefork, eio_postfork, eio_postfork);
 }
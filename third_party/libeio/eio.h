@@ -268,6 +268,7 @@ struct eio_req
 
   signed char type;/* EIO_xxx constant ETP */
   signed char pri;     /* the priority ETP */
+  unsigned char pool;  /* thread pool to run in, < EIO_NUM_POOLS */
 #if __i386 || __amd64
   unsigned char cancelled; /* ETP */
 #else
@@ -327,6 +328,16 @@ unsigned int eio_nreqs    (void); /* number of requests in-flight */
 unsigned int eio_npending (void); /* number of finished but unhandled requests */
 unsigned int eio_nthreads (void); /* number of worker threads in use currently */
 
+/* requests are run by the thread pool set in req->pool, pool 0 by
+ * default; the functions above configure pool 0 only, except for the
+ * thread callbacks and idle settings, which apply to all pools */
+#define EIO_NUM_POOLS 4
+void eio_set_pool_min_parallel (unsigned int pool, unsigned int nthreads);
+void eio_set_pool_max_parallel (unsigned int pool, unsigned int nthreads);
+/* number of started threads, running and queued requests of a pool */
+void eio_pool_stat (unsigned int pool, unsigned int *nthreads,
+                    unsigned int *nrunning, unsigned int *nqueued);
+
 /*****************************************************************************/
 /* convenience wrappers */
 
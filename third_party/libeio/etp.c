@@ -508,7 +508,7 @@ etp_grp_cancel (etp_pool_user user, ETP_REQ *grp)
 }
 
 ETP_API_DECL void
-etp_submit (etp_pool_user user, ETP_REQ *req)
+etp_submit_to (etp_pool_user user, etp_pool pool, ETP_REQ *req)
 {
   req->pri -= ETP_PRI_MIN;
 
@@ -527,7 +527,6 @@ etp_submit (etp_pool_user user, ETP_REQ *req)
     }
   else
     {
-      etp_pool pool = user->pool;
       int need_thread = 0;
 
       X_LOCK (pool->lock);
@@ -547,6 +546,12 @@ etp_submit (etp_pool_user user, ETP_REQ *req)
     }
 }
 
+ETP_API_DECL void
+etp_submit (etp_pool_user user, ETP_REQ *req)
+{
+  etp_submit_to (user, user->pool, req);
+}
+
 ETP_API_DECL void ecb_cold
 etp_set_max_poll_time (etp_pool_user user, double seconds)
 {
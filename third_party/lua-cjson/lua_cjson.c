@@ -51,6 +51,8 @@
 #include "mp_extension_types.h" /* MP_DECIMAL, MP_UUID */
 #include "tt_static.h"
 #include "uuid/tt_uuid.h" /* tt_uuid_to_string(), UUID_STR_LEN */
+#include "uuid/mp_uuid.h" /* uuid_unpack() */
+#include "lua_cjson.h"
 
 #define DEFAULT_ENCODE_KEEP_BUFFER 1
 
@@ -461,6 +463,180 @@ static int json_encode(lua_State *l) {
     return 1;
 }
 
+/* ===== ENCODING OF MSGPACK ===== */
+
+static void json_append_mp_data(lua_State *l, struct luaL_serializer *cfg,
+                                int current_depth, strbuf_t *json,
+                                const char **data);
+
+static void json_append_mp_key(lua_State *l, struct luaL_serializer *cfg,
+                               strbuf_t *json, const char **data)
+{
+    uint32_t len;
+    const char *str;
+    switch (mp_typeof(**data)) {
+    case MP_UINT:
+        strbuf_append_char(json, '"');
+        json_append_uint(cfg, json, mp_decode_uint(data));
+        strbuf_append_mem(json, "\":", 2);
+        break;
+    case MP_INT:
+        strbuf_append_char(json, '"');
+        json_append_int(cfg, json, mp_decode_int(data));
+        strbuf_append_mem(json, "\":", 2);
+        break;
+    case MP_STR:
+        str = mp_decode_str(data, &len);
+        json_append_string(cfg, json, str, len);
+        strbuf_append_char(json, ':');
+        break;
+    default:
+        luaL_error(l, "table key must be a number or string");
+    }
+}
+
+static void json_append_mp_ext(lua_State *l, struct luaL_serializer *cfg,
+                               strbuf_t *json, const char **data)
+{
+    int8_t ext_type;
+    uint32_t len = mp_decode_extl(data, &ext_type);
+    switch (ext_type) {
+    case MP_DECIMAL:
+    {
+        decimal_t dec;
+        if (decimal_unpack(data, len, &dec) == NULL)
+            luaL_error(l, "Invalid MsgPack decimal");
+        const char *str = decimal_to_string(&dec);
+        return json_append_string(cfg, json, str, strlen(str));
+    }
+    case MP_UUID:
+    {
+        struct tt_uuid uuid;
+        if (uuid_unpack(data, len, &uuid) == NULL)
+            luaL_error(l, "Invalid MsgPack UUID");
+        return json_append_string(cfg, json, tt_uuid_str(&uuid),
+                                  UUID_STR_LEN);
+    }
+    default:
+        luaL_error(l, "Unsupported MsgPack extension type %d", ext_type);
+    }
+}
+
+static void json_append_mp_data(lua_State *l, struct luaL_serializer *cfg,
+                                int current_depth, strbuf_t *json,
+                                const char **data)
+{
+    uint32_t len, i;
+    const char *str;
+    switch (mp_typeof(**data)) {
+    case MP_UINT:
+        return json_append_uint(cfg, json, mp_decode_uint(data));
+    case MP_INT:
+        return json_append_int(cfg, json, mp_decode_int(data));
+    case MP_STR:
+        str = mp_decode_str(data, &len);
+        return json_append_string(cfg, json, str, len);
+    case MP_BIN:
+        str = mp_decode_bin(data, &len);
+        return json_append_string(cfg, json, str, len);
+    case MP_FLOAT:
+        return json_append_number(cfg, json, mp_decode_float(data));
+    case MP_DOUBLE:
+        return json_append_number(cfg, json, mp_decode_double(data));
+    case MP_BOOL:
+        if (mp_decode_bool(data))
+            strbuf_append_mem(json, "true", 4);
+        else
+            strbuf_append_mem(json, "false", 5);
+        return;
+    case MP_NIL:
+        mp_decode_nil(data);
+        return json_append_nil(cfg, json);
+    case MP_ARRAY:
+        if (current_depth >= cfg->encode_max_depth) {
+            if (! cfg->encode_deep_as_nil)
+                luaL_error(l, "Too high nest level");
+            mp_next(data);
+            return json_append_nil(cfg, json); /* Limit nested arrays */
+        }
+        len = mp_decode_array(data);
+        strbuf_append_char(json, '[');
+        for (i = 0; i < len; i++) {
+            if (i > 0)
+                strbuf_append_char(json, ',');
+            json_append_mp_data(l, cfg, current_depth + 1, json, data);
+        }
+        strbuf_append_char(json, ']');
+        return;
+    case MP_MAP:
+        if (current_depth >= cfg->encode_max_depth) {
+            if (! cfg->encode_deep_as_nil)
+                luaL_error(l, "Too high nest level");
+            mp_next(data);
+            return json_append_nil(cfg, json); /* Limit nested maps */
+        }
+        len = mp_decode_map(data);
+        strbuf_append_char(json, '{');
+        for (i = 0; i < len; i++) {
+            if (i > 0)
+                strbuf_append_char(json, ',');
+            json_append_mp_key(l, cfg, json, data);
+            json_append_mp_data(l, cfg, current_depth + 1, json, data);
+        }
+        strbuf_append_char(json, '}');
+        return;
+    case MP_EXT:
+        return json_append_mp_ext(l, cfg, json, data);
+    }
+}
+
+void
+json_mp_start(void)
+{
+    strbuf_reset(&encode_buf);
+}
+
+void
+json_mp_append_char(char c)
+{
+    strbuf_append_char(&encode_buf, c);
+}
+
+void
+json_mp_append(lua_State *L, struct luaL_serializer *cfg, const char **data,
+               const char *const *names, uint32_t name_count)
+{
+    if (cfg == NULL)
+        cfg = luaL_json_default;
+    if (names == NULL || mp_typeof(**data) != MP_ARRAY)
+        return json_append_mp_data(L, cfg, 0, &encode_buf, data);
+    /* Named fields go first, the rest are keyed by number. */
+    uint32_t len = mp_decode_array(data);
+    strbuf_append_char(&encode_buf, '{');
+    for (uint32_t i = 0; i < len; i++) {
+        if (i > 0)
+            strbuf_append_char(&encode_buf, ',');
+        if (i < name_count) {
+            json_append_string(cfg, &encode_buf, names[i],
+                               strlen(names[i]));
+            strbuf_append_char(&encode_buf, ':');
+        } else {
+            strbuf_append_char(&encode_buf, '"');
+            json_append_uint(cfg, &encode_buf, i + 1);
+            strbuf_append_mem(&encode_buf, "\":", 2);
+        }
+        json_append_mp_data(L, cfg, 1, &encode_buf, data);
+    }
+    strbuf_append_char(&encode_buf, '}');
+}
+
+void
+json_mp_push(lua_State *L)
+{
+    char *json = strbuf_string(&encode_buf, NULL);
+    lua_pushlstring(L, json, strbuf_length(&encode_buf));
+}
+
 /* ===== DECODING ===== */
 
 static void json_process_value(lua_State *l, json_parse_t *json,
@@ -5,11 +5,49 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include <lua.h>
 
+struct luaL_serializer;
+
 LUALIB_API  int
 luaopen_json(lua_State *L);
 
+/*
+ * Encoding of MessagePack straight into JSON without decoding
+ * it into Lua objects first. The output is accumulated in the
+ * encoding buffer shared with json.encode():
+ *
+ *   json_mp_start();
+ *   json_mp_append(L, NULL, &data, NULL, 0);
+ *   json_mp_push(L);
+ *
+ * Errors are raised as Lua errors.
+ */
+
+/** Reset the encoding buffer. */
+void
+json_mp_start(void);
+
+/** Append a raw character, e.g. a separator, to the buffer. */
+void
+json_mp_append_char(char c);
+
+/**
+ * Encode the MessagePack value at @a data and advance @a data
+ * past it. @a cfg defaults to the options of the json module if
+ * NULL. If @a names is not NULL and the value is an array, it is
+ * encoded as an object: the first @a name_count elements are
+ * keyed by @a names, the rest by their 1-based number.
+ */
+void
+json_mp_append(lua_State *L, struct luaL_serializer *cfg, const char **data,
+               const char *const *names, uint32_t name_count);
+
+/** Push the contents of the buffer as a Lua string. */
+void
+json_mp_push(lua_State *L);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif